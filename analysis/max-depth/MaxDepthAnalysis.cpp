@@ -7,196 +7,121 @@
 
 #include "MaxDepthAnalysis.h"
 
-#include "AbstractDomain.h"
-#include "ConstantAbstractDomain.h"
-#include "ControlFlow.h"
+#include <numeric>
+#include <optional>
+
+#include "CallGraph.h"
 #include "DexClass.h"
-#include "HashedSetAbstractDomain.h"
 #include "IRCode.h"
 #include "IRInstruction.h"
-#include "PatriciaTreeMapAbstractEnvironment.h"
-#include "SpartaInterprocedural.h"
+#include "MethodOverrideGraph.h"
+#include "Resolver.h"
+#include "SccCondensation.h"
+#include "WorkQueue.h"
 
 namespace {
 
-using namespace sparta;
-using namespace sparta_interprocedural;
-
 // Description for the analysis
 
-// - We initialize the max depth of each method to Top, which means unknown or
-//   potentially infinite depth of calls.
-// - Every step will progressively reduce the depth by considering the cases
-//   where the depth is known and is not Top.
-// - The steps are iterated until a global fixpoint for the summaries is found.
-
-// Define an abstract domain as a summary for a method. The summary should
-// contain what properties we are interested in knowing such a method.
-struct DepthDomain : public AbstractDomain<DepthDomain> {
-  explicit DepthDomain() : m_depth(0), m_kind(sparta::AbstractValueKind::Top) {}
-
-  explicit DepthDomain(unsigned i)
-      : m_depth(i), m_kind(sparta::AbstractValueKind::Value) {}
-
-  bool is_bottom() const override {
-    return m_kind == sparta::AbstractValueKind::Bottom;
-  }
-
-  bool is_value() const { return m_kind == sparta::AbstractValueKind::Value; }
+// - The depth of a method without calls is 0. A call to a method that does not
+//   resolve counts as a call to such a method.
+// - The depth of any other method is one more than the largest depth of its
+//   callees.
+// - Methods that may reach recursion, or a resolved callee that is not in the
+//   call graph, have unknown or potentially infinite depth, and no result.
+//
+// Depths are computed in one bottom-up walk over the strongly connected
+// components of the calls, instead of iterating to a fixpoint. Only scanning
+// the code for calls is done in parallel, as the walk itself is linear.
+
+struct Calls {
+  std::vector<const DexMethod*> callees;
+  bool unresolved{false};
+};
 
-  bool is_top() const override {
-    return m_kind == sparta::AbstractValueKind::Top;
+Calls calls_of(const DexMethod* method) {
+  Calls calls;
+  auto code = method->get_code();
+  if (!code) {
+    return calls;
   }
-
-  bool leq(const DepthDomain& other) const override {
-    if (is_bottom()) {
-      return true;
-    } else if (m_kind == sparta::AbstractValueKind::Value) {
-      return m_depth <= other.m_depth;
-    } else {
-      return other.is_top();
+  for (auto& mie : InstructionIterable(code)) {
+    always_assert_log(mie.insn,
+                      "IR is malformed, MIE holding an nullptr instruction.");
+    auto insn = mie.insn;
+    if (!opcode::is_an_invoke(insn->opcode())) {
+      continue;
     }
-  }
-
-  bool equals(const DepthDomain& other) const override {
-    if (m_kind != other.m_kind) {
-      return false;
+    auto callee =
+        resolve_method(insn->get_method(), opcode_to_search(insn), method);
+    if (callee) {
+      calls.callees.push_back(callee);
     } else {
-      return (m_kind == sparta::AbstractValueKind::Value)
-                 ? m_depth == other.m_depth
-                 : true;
-    }
-  }
-
-  void set_to_bottom() override { not_reached(); }
-  virtual void set_value(unsigned depth) {
-    m_kind = sparta::AbstractValueKind::Value;
-    m_depth = depth;
-  }
-  void set_to_top() override { m_kind = sparta::AbstractValueKind::Top; }
-
-  void join_with(const DepthDomain& other) override {
-    if (is_bottom() || other.is_top()) {
-      *this = other;
-    } else if (is_value() && other.is_value()) {
-      if (other.m_depth > m_depth) {
-        m_depth = other.m_depth;
-      }
+      calls.unresolved = true;
     }
   }
+  return calls;
+}
 
-  void widen_with(const DepthDomain& other) override { join_with(other); }
+} // namespace
 
-  void meet_with(const DepthDomain& /* other */) override {
-    throw std::runtime_error("meet_with not implemented!");
+void MaxDepthAnalysisPass::run_pass(DexStoresVector& stores,
+                                    ConfigFiles& /* conf */,
+                                    PassManager& /* pm */) {
+  auto scope = build_class_scope(stores);
+  constexpr uint32_t big_override_threshold = 5;
+  auto graph = call_graph::multiple_callee_graph(
+      *method_override_graph::build_graph(scope), scope,
+      big_override_threshold);
+
+  std::vector<const DexMethod*> methods;
+  methods.reserve(graph.nodes().size());
+  for (const auto& entry : graph.nodes()) {
+    methods.push_back(entry.first);
   }
-
-  void narrow_with(const DepthDomain& /* other */) override {
-    throw std::runtime_error("narrow_with not implemented!");
+  std::sort(methods.begin(), methods.end(), compare_dexmethods);
+
+  std::vector<Calls> calls(methods.size());
+  std::vector<size_t> indices(methods.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) { calls[i] = calls_of(methods[i]); }, indices);
+  std::unordered_map<const DexMethod*, const Calls*> calls_of_method;
+  calls_of_method.reserve(methods.size());
+  for (size_t i = 0; i < methods.size(); ++i) {
+    calls_of_method.emplace(methods[i], &calls[i]);
   }
 
-  unsigned depth() const { return m_depth; }
-
- private:
-  unsigned m_depth;
-  AbstractValueKind m_kind;
-};
-
-// Callsite is mostly used to describe calling context. It can be partitioned
-// based on call edges. In this analysis, the call depth is irrelevant to the
-// calling context, so we leave it unused.
-struct Caller {
-  using Domain = HashedSetAbstractDomain<DexMethod*>;
-};
-
-// Core part of the analysis. This analyzer should be similar to an
-// intraprocedural analysis, except that we have access to the summaries and the
-// calling context.
-template <typename Base>
-class MaxDepthFunctionAnalyzer : public Base {
- private:
-  const DexMethod* m_method;
-  DepthDomain m_domain;
-
- public:
-  explicit MaxDepthFunctionAnalyzer(const DexMethod* method)
-      : m_method(method), m_domain(0) {}
+  static const std::vector<const DexMethod*> no_callees;
+  SccCondensation<const DexMethod*> sccs(
+      methods,
+      [&](const DexMethod* method) -> const std::vector<const DexMethod*>& {
+        auto it = calls_of_method.find(method);
+        return it == calls_of_method.end() ? no_callees : it->second->callees;
+      });
 
-  void analyze() override {
-    if (!m_method) {
-      return;
-    }
-    auto code = m_method->get_code();
-    if (!code) {
-      return;
-    }
-    for (auto& mie : InstructionIterable(code)) {
-      always_assert_log(mie.insn,
-                        "IR is malformed, MIE holding an nullptr instruction.");
-
-      analyze_insn(mie.insn);
+  m_result = std::make_shared<std::unordered_map<const DexMethod*, int>>();
+  std::vector<std::optional<int>> depths(sccs.size());
+  for (size_t c = 0; c < sccs.size(); ++c) {
+    if (sccs.is_recursive(c)) {
+      continue;
     }
-  }
-
-  void analyze_insn(IRInstruction* insn) {
-    if (opcode::is_an_invoke(insn->opcode())) {
-      analyze_invoke(insn);
+    const auto* method = sccs.component(c).front();
+    auto it = calls_of_method.find(method);
+    if (it == calls_of_method.end()) {
+      continue;
     }
-  }
-
-  void analyze_invoke(IRInstruction* insn) {
-    auto callee = insn->get_method();
-    auto callee_method =
-        resolve_method(callee, opcode_to_search(insn), m_method);
-    if (callee_method) {
-      auto summary =
-          this->get_summaries()->get(callee_method, DepthDomain::top());
-      if (summary.is_value()) {
-        m_domain.join_with(DepthDomain(summary.depth() + 1u));
-      } else {
-        m_domain.join_with(summary);
+    std::optional<int> depth = it->second->unresolved ? 1 : 0;
+    for (auto s : sccs.successors(c)) {
+      if (!depths[s]) {
+        depth = std::nullopt;
+        break;
       }
-    } else {
-      m_domain.join_with(DepthDomain(1u));
-    }
-  }
-
-  void summarize() override {
-    if (!m_method) {
-      return;
+      depth = std::max(*depth, *depths[s] + 1);
     }
-    this->get_summaries()->update(m_method,
-                                  [&](const DepthDomain&) { return m_domain; });
-  }
-};
-
-// The adaptor supplies the necessary typenames to the analyzer so that template
-// instantiation assembles the different parts. It's also possible to override
-// type aliases in the adaptor base class.
-struct MaxDepthAnalysisAdaptor : public BottomUpAnalysisAdaptorBase {
-  // Registry is used to hold the summaries.
-  using Registry = MethodSummaryRegistry<DepthDomain>;
-  using FunctionSummary = DepthDomain;
-
-  template <typename IntraproceduralBase>
-  using FunctionAnalyzer = MaxDepthFunctionAnalyzer<IntraproceduralBase>;
-  using Callsite = Caller;
-};
-
-using Analysis = InterproceduralAnalyzer<MaxDepthAnalysisAdaptor>;
-
-} // namespace
-
-void MaxDepthAnalysisPass::run_pass(DexStoresVector& stores,
-                                    ConfigFiles& /* conf */,
-                                    PassManager& /* pm */) {
-  auto analysis = Analysis(build_class_scope(stores), m_max_iteration);
-  analysis.run();
-  m_result = std::make_shared<std::unordered_map<const DexMethod*, int>>();
-
-  for (const auto& entry : analysis.registry.get_map()) {
-    if (entry.second.is_value()) {
-      (*m_result)[entry.first] = entry.second.depth();
+    if (depth) {
+      depths[c] = depth;
+      (*m_result)[method] = *depth;
     }
   }
 }
@@ -15,7 +15,6 @@
 class MaxDepthAnalysisPass : public Pass {
  public:
   MaxDepthAnalysisPass() : Pass("MaxDepthAnalysisPass", Pass::ANALYSIS) {}
-  void bind_config() override { bind("max_iteration", 20U, m_max_iteration); }
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
   using Result = std::unordered_map<const DexMethod*, int>;
@@ -25,6 +24,5 @@ class MaxDepthAnalysisPass : public Pass {
   void destroy_analysis_result() override { m_result = nullptr; }
 
  private:
-  unsigned m_max_iteration;
   std::shared_ptr<Result> m_result = nullptr;
 };
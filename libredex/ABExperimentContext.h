@@ -20,6 +20,9 @@ namespace ab_test {
  * RAII object that controls whether mutations happening to a CFG after the
  * experiment context has been created and before it has been flushed will
  * actually be visible (i.e. applied) or not, depending on its setup.
+ *
+ * No copy of the code of registered methods is kept: passes ask use_test()
+ * or use_control() before mutating, so the context holds no IR of its own.
  */
 class ABExperimentContext {
   friend RedexTest;
@@ -34,9 +37,8 @@ class ABExperimentContext {
   virtual bool use_test() = 0;
 
   /**
-   * Decide which version (CONTROL/TEST) of code will be applied and also clears
-   * the CFG that was created by the constructor. The method's CFG
-   * should not be used anymore after the context is flushed.
+   * Checks that the context is in TEST mode, i.e. that the mutations made
+   * while it was alive are the ones to keep.
    */
   virtual void flush() = 0;
 
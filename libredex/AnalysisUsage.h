@@ -31,7 +31,8 @@ AnalysisID get_analysis_id_by_pass(const Pass* pass);
  * get_analysis_usage virtual function.
  *
  * Currently we support only preserving either all, none, or specific analysis
- * passes.
+ * passes. Independently, a pass may preserve the results of intraprocedural
+ * analyses that the MethodAnalysisCache holds.
  */
 
 class AnalysisUsage {
@@ -52,6 +53,16 @@ class AnalysisUsage {
     m_preserve_specific.emplace(get_analysis_id_by_pass<AnalysisPassType>());
   }
 
+  // Declares that this current pass edits nothing but method bodies, so that
+  // the cached analyses of the methods it did not edit remain valid. The cache
+  // detects edits of the code of a method by itself.
+  void set_preserve_method_analyses(bool preserve = true) {
+    m_preserve_method_analyses = preserve;
+  }
+
+  // Independent of set_preserve_all, which only covers analysis passes.
+  bool preserves_method_analyses() const { return m_preserve_method_analyses; }
+
   // Returns a set of passes used by (thus should precede) this current pass.
   const std::unordered_set<AnalysisID>& get_required_passes() {
     return m_required_passes;
@@ -69,6 +80,7 @@ class AnalysisUsage {
 
  private:
   bool m_preserve_all = false;
+  bool m_preserve_method_analyses = false;
   std::unordered_set<AnalysisID> m_required_passes;
   std::unordered_set<AnalysisID> m_preserve_specific;
 };
@@ -13,6 +13,7 @@
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace api {
 
@@ -196,12 +197,18 @@ void LevelChecker::propagate_levels(const Scope& scope) {
     }
   }
 
-  // And then for the rest.
+  // And then for the rest. The levels of the interfaces are final by now, and
+  // every class is reached from exactly one root, so the roots can be
+  // processed in parallel.
+  std::vector<DexClass*> roots;
   for (DexClass* cls : scope) {
     if (!is_interface(cls) && cls->get_super_class() == obj_type) {
-      ::api::propagate_levels(ch, cls, s_min_level);
+      roots.push_back(cls);
     }
   }
+  workqueue_run<DexClass*>(
+      [&](DexClass* cls) { ::api::propagate_levels(ch, cls, s_min_level); },
+      roots);
 }
 
 } // namespace api
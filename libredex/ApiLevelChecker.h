@@ -84,8 +84,11 @@ class LevelChecker {
         }
         always_assert(elems.size() == 1);
         const DexAnnotationElement& api_elem = elems[0];
-        always_assert(api_elem.string == DexString::get_string("api") ||
-                      api_elem.string == DexString::get_string("value"));
+        // Compare the names in place rather than interning the expected names
+        // again, which would take a lookup in the global string table for
+        // every annotated member.
+        always_assert(api_elem.string->str() == "api" ||
+                      api_elem.string->str() == "value");
         const auto& value = api_elem.encoded_value;
         always_assert(value->evtype() == DEVT_INT);
         int32_t result = static_cast<int32_t>(value->value());
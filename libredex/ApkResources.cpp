@@ -50,15 +50,6 @@
 #endif
 
 namespace apk {
-std::string get_string_from_pool(const android::ResStringPool& pool,
-                                 size_t idx) {
-  size_t u16_len;
-  auto wide_chars = pool.stringAt(idx, &u16_len);
-  android::String16 s16(wide_chars, u16_len);
-  android::String8 string8(s16);
-  return std::string(string8.string());
-}
-
 // The import of AOSP code that Redex has right now predates
 // https://cs.android.com/android/_/android/platform/frameworks/base/+/d0f116b619feede0cfdb647157ce5ab4d50a1c46
 // which properly returns UTF-8 lengths when reading UTF-8 string data. We have
@@ -73,6 +64,33 @@ size_t read_utf8_length_from_string_pool_data(const char* s) {
   }
   return len;
 }
+
+std::string_view get_string_view_from_pool(const android::ResStringPool& pool,
+                                           size_t idx,
+                                           std::string* storage) {
+  size_t len;
+  if (pool.isUTF8()) {
+    auto s = pool.string8At(idx, &len);
+    if (s == nullptr) {
+      return std::string_view();
+    }
+    return std::string_view(s, read_utf8_length_from_string_pool_data(s));
+  }
+  auto wide_chars = pool.stringAt(idx, &len);
+  if (wide_chars == nullptr) {
+    return std::string_view();
+  }
+  android::String8 string8(wide_chars, len);
+  storage->assign(string8.string(), string8.size());
+  return *storage;
+}
+
+std::string get_string_from_pool(const android::ResStringPool& pool,
+                                 size_t idx) {
+  std::string storage;
+  auto view = get_string_view_from_pool(pool, idx, &storage);
+  return pool.isUTF8() ? std::string(view) : storage;
+}
 } // namespace apk
 
 namespace {
@@ -375,18 +393,46 @@ bool is_binary_xml(const void* data, size_t size) {
          android::RES_XML_TYPE;
 }
 
-std::string read_attribute_name_at_idx(const android::ResXMLTree& parser,
-                                       size_t idx) {
-  size_t len;
-  auto name_chars = parser.getAttributeName8(idx, &len);
-  if (name_chars != nullptr) {
-    return std::string(name_chars);
-  } else {
-    auto wide_chars = parser.getAttributeName(idx, &len);
-    android::String16 s16(wide_chars, len);
-    auto converted = convert_from_string16(s16);
-    return converted;
+// Decodes each string of the pool of a binary XML document at most once, as
+// the same element and attribute names recur throughout a document.
+class XmlStringCache {
+ public:
+  explicit XmlStringCache(const android::ResStringPool& pool)
+      : m_pool(pool), m_strings(pool.size()) {}
+
+  // Returns nullptr for an invalid index.
+  const std::string* get(int32_t idx) {
+    if (idx < 0 || static_cast<size_t>(idx) >= m_strings.size()) {
+      return nullptr;
+    }
+    auto& str = m_strings[idx];
+    if (!str) {
+      str = apk::get_string_from_pool(m_pool, idx);
+    }
+    return &*str;
   }
+
+ private:
+  const android::ResStringPool& m_pool;
+  std::vector<boost::optional<std::string>> m_strings;
+};
+
+// Returns the string value of the first attribute of the current element with
+// the given name.
+std::string get_string_attribute_value(const android::ResXMLTree& parser,
+                                       XmlStringCache& strings,
+                                       const std::string& attribute_name) {
+  const size_t attr_count = parser.getAttributeCount();
+  for (size_t i = 0; i < attr_count; ++i) {
+    auto key = strings.get(parser.getAttributeNameID(i));
+    if (key != nullptr && *key == attribute_name) {
+      auto value = strings.get(parser.getAttributeValueStringID(i));
+      if (value != nullptr) {
+        return *value;
+      }
+    }
+  }
+  return std::string("");
 }
 
 void extract_classes_from_layout(
@@ -402,58 +448,55 @@ void extract_classes_from_layout(
   android::ResXMLTree parser;
   parser.setTo(data, size);
 
-  android::String16 name("name");
-  android::String16 klazz("class");
-  android::String16 target_class("targetClass");
+  const std::string name("name");
+  const std::string klazz("class");
+  const std::string target_class("targetClass");
 
   if (parser.getError() != android::NO_ERROR) {
     return;
   }
 
+  XmlStringCache strings(parser.getStrings());
   std::unordered_map<int, std::string> namespace_prefix_map;
   android::ResXMLParser::event_code_t type;
   do {
     type = parser.next();
     if (type == android::ResXMLParser::START_TAG) {
-      size_t len;
-      android::String16 tag(parser.getElementName(&len));
-      std::string classname = convert_from_string16(tag);
-      if (!strcmp(classname.c_str(), "fragment") ||
-          !strcmp(classname.c_str(), "view") ||
-          !strcmp(classname.c_str(), "dialog") ||
-          !strcmp(classname.c_str(), "activity") ||
-          !strcmp(classname.c_str(), "intent")) {
-        classname = get_string_attribute_value(parser, klazz);
+      auto tag = strings.get(parser.getElementNameID());
+      std::string classname = tag != nullptr ? *tag : std::string("");
+      if (classname == "fragment" || classname == "view" ||
+          classname == "dialog" || classname == "activity" ||
+          classname == "intent") {
+        classname = get_string_attribute_value(parser, strings, klazz);
         if (classname.empty()) {
-          classname = get_string_attribute_value(parser, name);
+          classname = get_string_attribute_value(parser, strings, name);
         }
         if (classname.empty()) {
-          classname = get_string_attribute_value(parser, target_class);
+          classname = get_string_attribute_value(parser, strings, target_class);
         }
       }
-      std::string converted = std::string("L") + classname + std::string(";");
-
-      bool is_classname = converted.find('.') != std::string::npos;
-      if (is_classname) {
+      if (classname.find('.') != std::string::npos) {
+        std::string converted = std::string("L") + classname + std::string(";");
         std::replace(converted.begin(), converted.end(), '.', '/');
         out_classes->insert(converted);
       }
       if (!attributes_to_read.empty()) {
         for (size_t i = 0; i < parser.getAttributeCount(); i++) {
           auto ns_id = parser.getAttributeNamespaceID(i);
-          std::string attr_name = read_attribute_name_at_idx(parser, i);
+          auto attr_name = strings.get(parser.getAttributeNameID(i));
+          if (attr_name == nullptr) {
+            continue;
+          }
           std::string fully_qualified;
           if (ns_id >= 0) {
-            fully_qualified = namespace_prefix_map[ns_id] + ":" + attr_name;
+            fully_qualified = namespace_prefix_map[ns_id] + ":" + *attr_name;
           } else {
-            fully_qualified = attr_name;
+            fully_qualified = *attr_name;
           }
           if (attributes_to_read.count(fully_qualified) != 0) {
-            auto val = parser.getAttributeStringValue(i, &len);
+            auto val = strings.get(parser.getAttributeValueStringID(i));
             if (val != nullptr) {
-              android::String16 s16(val, len);
-              out_attributes->emplace(fully_qualified,
-                                      convert_from_string16(s16));
+              out_attributes->emplace(fully_qualified, *val);
             }
           }
         }
@@ -640,19 +683,18 @@ int ApkResources::replace_in_xml_string_pool(
       0};
   android::ResStringPool new_pool(&new_pool_header, pool_header_size);
 
+  std::string storage;
   for (size_t i = 0; i < num_strings; i++) {
     // Public accessors for strings are a bit of a foot gun. string8ObjectAt
-    // does not reliably return lengths with chars outside the BMP. Work around
-    // to get a proper String8.
-    size_t u16_len;
-    auto wide_chars = pool.stringAt(i, &u16_len);
-    android::String16 s16(wide_chars, u16_len);
-    android::String8 string8(s16);
-    std::string existing_str(string8.string());
+    // does not reliably return lengths with chars outside the BMP, so read
+    // the UTF-8 bytes ourselves.
+    auto existing = apk::get_string_view_from_pool(pool, i, &storage);
+    std::string existing_str(existing);
 
     auto replacement = rename_map.find(existing_str);
     if (replacement == rename_map.end()) {
-      new_pool.appendString(string8);
+      new_pool.appendString(
+          android::String8(existing_str.data(), existing_str.size()));
     } else {
       android::String8 replacement8(replacement->second.c_str());
       new_pool.appendString(replacement8);
@@ -869,7 +911,29 @@ void ResourcesArscFile::remap_res_ids_and_serialize(
     const std::vector<std::string>& /* resource_files */,
     const std::map<uint32_t, uint32_t>& old_to_new) {
   remap_ids(old_to_new);
-  serialize();
+  if (m_entries_deleted) {
+    serialize();
+  } else {
+    // Remapping only rewrites IDs, so there is no need to rebuild the table.
+    write_edits_in_place();
+  }
+}
+
+void ResourcesArscFile::write_edits_in_place() {
+  always_assert(!m_file_closed);
+  always_assert(res_table.getTableCount() == 1);
+  const auto* edited = (const char*)res_table.getTableData(0);
+  size_t size = res_table.getTableSize(0);
+  always_assert(size <= m_arsc_len);
+  // Compare page by page, so that only the pages with edits get dirtied.
+  constexpr size_t kPageSize = 4096;
+  char* data = m_f.data();
+  for (size_t offset = 0; offset < size; offset += kPageSize) {
+    size_t len = std::min(kPageSize, size - offset);
+    if (memcmp(data + offset, edited + offset, len) != 0) {
+      memcpy(data + offset, edited + offset, len);
+    }
+  }
 }
 
 namespace {
@@ -1360,6 +1424,7 @@ void ResourcesArscFile::walk_references_for_resource(
 
 void ResourcesArscFile::delete_resource(uint32_t res_id) {
   res_table.deleteResource(res_id);
+  m_entries_deleted = true;
 }
 
 void ResourcesArscFile::collect_resid_values_and_hashes(
@@ -1458,13 +1523,13 @@ std::vector<std::string> ResourcesArscFile::get_resource_strings_by_name(
 
       // just in case there's a reference
       res_table.resolveReference(&res_value, 0);
-      size_t len = 0;
-
       // aapt is using 0, so why not?
-      const char16_t* str =
-          res_table.getTableStringBlock(0)->stringAt(res_value.data, &len);
-      if (str) {
-        ret.push_back(android::String8(str, len).string());
+      std::string storage;
+      auto str = apk::get_string_view_from_pool(
+          *res_table.getTableStringBlock(0), res_value.data, &storage);
+      // A null view denotes an invalid index, unlike an empty string.
+      if (str.data() != nullptr) {
+        ret.emplace_back(str);
       }
     }
   }
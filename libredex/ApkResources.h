@@ -10,6 +10,7 @@
 #include <boost/optional.hpp>
 #include <map>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -41,6 +42,15 @@ bool get_bool_attribute_value(const android::ResXMLTree& parser,
 namespace apk {
 std::string get_string_from_pool(const android::ResStringPool& pool,
                                  size_t idx);
+
+/*
+ * The string at `idx` as UTF-8, without going through String16/String8. For
+ * a UTF-8 pool this views the bytes in place in the pool data; only strings of
+ * UTF-16 pools are transcoded, into `storage`.
+ */
+std::string_view get_string_view_from_pool(const android::ResStringPool& pool,
+                                           size_t idx,
+                                           std::string* storage);
 } // namespace apk
 
 class ResourcesArscFile : public ResourceTableFile {
@@ -83,10 +93,17 @@ class ResourcesArscFile : public ResourceTableFile {
   size_t get_length() const;
 
  private:
+  // Writes the edits made to res_table back to the file, in place. Only valid
+  // as long as they did not change the size of anything.
+  void write_edits_in_place();
+
   RedexMappedFile m_f;
   size_t m_arsc_len;
   std::map<uint32_t, android::Vector<android::Res_value>> tmp_id_to_values;
   bool m_file_closed = false;
+  // Whether entries were deleted from res_table, which reshapes the table when
+  // it is serialized.
+  bool m_entries_deleted = false;
 };
 
 class ApkResources : public AndroidResources {
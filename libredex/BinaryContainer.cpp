@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "BinaryContainer.h"
+
+#include <cinttypes>
+#include <cstring>
+
+#include "RedexMappedFile.h"
+
+namespace binary_serialization {
+
+namespace {
+
+struct Header {
+  uint32_t magic;
+  uint32_t container_version;
+  uint32_t version;
+  uint32_t padding;
+};
+
+struct Trailer {
+  uint64_t num_sections;
+  uint64_t table_offset;
+};
+
+template <class T>
+T read_at(const char* data, size_t size, uint64_t offset) {
+  always_assert_log(offset <= size && size - offset >= sizeof(T),
+                    "Truncated container: %zu bytes at offset %" PRIu64
+                    " of %zu",
+                    sizeof(T), offset, size);
+  T value;
+  memcpy(&value, data + offset, sizeof(T));
+  return value;
+}
+
+} // namespace
+
+ContainerWriter::ContainerWriter(std::ostream& os, uint32_t version)
+    : m_os(os), m_start(os.tellp()) {
+  Header header{CONTAINER_MAGIC, CONTAINER_VERSION, version, 0};
+  m_os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+uint64_t ContainerWriter::position() const {
+  return static_cast<uint64_t>(m_os.tellp()) - m_start;
+}
+
+std::ostream& ContainerWriter::begin_section(uint32_t id) {
+  always_assert(!m_finished);
+  end_section();
+  for (const auto& section : m_sections) {
+    always_assert_log(section.id != id, "Duplicate section %u", id);
+  }
+  auto offset = position();
+  while (offset % CONTAINER_ALIGNMENT != 0) {
+    m_os.put(0);
+    ++offset;
+  }
+  m_sections.push_back(ContainerSection{id, 0, offset, 0});
+  m_in_section = true;
+  return m_os;
+}
+
+void ContainerWriter::end_section() {
+  if (!m_in_section) {
+    return;
+  }
+  auto& section = m_sections.back();
+  section.size = position() - section.offset;
+  m_in_section = false;
+}
+
+void ContainerWriter::finish() {
+  always_assert(!m_finished);
+  end_section();
+  auto table_offset = position();
+  while (table_offset % CONTAINER_ALIGNMENT != 0) {
+    m_os.put(0);
+    ++table_offset;
+  }
+  m_os.write(reinterpret_cast<const char*>(m_sections.data()),
+             m_sections.size() * sizeof(ContainerSection));
+  Trailer trailer{m_sections.size(), table_offset};
+  m_os.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+  always_assert_log(!m_os.fail(), "Failed to write container");
+  m_finished = true;
+}
+
+ContainerReader::ContainerReader(const char* data, size_t size)
+    : m_data(data), m_size(size) {
+  read_table();
+}
+
+ContainerReader::ContainerReader(const std::string& path)
+    : m_file(std::make_unique<RedexMappedFile>(RedexMappedFile::open(path))),
+      m_data(m_file->const_data()),
+      m_size(m_file->size()) {
+  read_table();
+}
+
+ContainerReader::~ContainerReader() = default;
+
+void ContainerReader::read_table() {
+  always_assert_log(
+      reinterpret_cast<uintptr_t>(m_data) % CONTAINER_ALIGNMENT == 0,
+      "Container data must be aligned to %zu bytes", CONTAINER_ALIGNMENT);
+  auto header = read_at<Header>(m_data, m_size, 0);
+  always_assert_log(header.magic == CONTAINER_MAGIC,
+                    "Not a container, or of a different endianness");
+  always_assert_log(header.container_version == CONTAINER_VERSION,
+                    "Unsupported container version %u",
+                    header.container_version);
+  m_version = header.version;
+
+  always_assert_log(m_size >= sizeof(Header) + sizeof(Trailer),
+                    "Truncated container");
+  auto trailer = read_at<Trailer>(m_data, m_size, m_size - sizeof(Trailer));
+  // The table ends right where the trailer starts.
+  always_assert_log(
+      trailer.table_offset <= m_size - sizeof(Trailer) &&
+          trailer.num_sections ==
+              (m_size - sizeof(Trailer) - trailer.table_offset) /
+                  sizeof(ContainerSection) &&
+          (m_size - sizeof(Trailer) - trailer.table_offset) %
+                  sizeof(ContainerSection) ==
+              0,
+      "Corrupt section table");
+  m_sections.resize(trailer.num_sections);
+  memcpy(m_sections.data(), m_data + trailer.table_offset,
+         m_sections.size() * sizeof(ContainerSection));
+  for (const auto& section : m_sections) {
+    always_assert_log(section.offset <= trailer.table_offset &&
+                          section.size <= trailer.table_offset - section.offset,
+                      "Corrupt section %u", section.id);
+  }
+}
+
+bool ContainerReader::has_section(uint32_t id) const {
+  for (const auto& section : m_sections) {
+    if (section.id == id) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string_view ContainerReader::section(uint32_t id) const {
+  for (const auto& section : m_sections) {
+    if (section.id == id) {
+      return std::string_view(m_data + section.offset, section.size);
+    }
+  }
+  not_reached_log("Missing section %u", id);
+}
+
+} // namespace binary_serialization
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <boost/range/iterator_range.hpp>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "Debug.h"
+
+struct RedexMappedFile;
+
+/*
+ * A versioned binary container of sections, laid out so that it can be read
+ * in place from a memory-mapped file:
+ *
+ *   header   magic, container version, payload version, padding (uint32 each)
+ *   sections each starting at an offset aligned to 8 bytes
+ *   table    per section: id (uint32), padding (uint32), offset, size (uint64)
+ *   trailer  number of sections, offset of the table (uint64 each)
+ *
+ * The table comes last, so that sections can be streamed out one after the
+ * other without holding them in memory. All integers are in the byte order of
+ * the host; the magic serves as the endianness check.
+ */
+
+namespace binary_serialization {
+
+constexpr uint32_t CONTAINER_MAGIC = 0xfaceb001;
+constexpr uint32_t CONTAINER_VERSION = 1;
+constexpr size_t CONTAINER_ALIGNMENT = 8;
+
+// An entry of the section table.
+struct ContainerSection {
+  uint32_t id;
+  uint32_t padding;
+  uint64_t offset;
+  uint64_t size;
+};
+
+class ContainerWriter {
+ public:
+  /*
+   * The payload version is stored in the header and handed back to readers;
+   * it describes the contents of the sections.
+   */
+  ContainerWriter(std::ostream& os, uint32_t version);
+
+  /*
+   * Ends the current section, if any, and starts a new one with the given id.
+   * Everything written to the returned stream until the next section is
+   * started or the container is finished is the content of the section.
+   */
+  std::ostream& begin_section(uint32_t id);
+
+  /*
+   * Writes a section holding an array of trivially copyable values, which
+   * ContainerReader::array_section() reads back in place.
+   */
+  template <class T>
+  void write_array_section(uint32_t id, const std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "array sections must be trivially copyable");
+    static_assert(alignof(T) <= CONTAINER_ALIGNMENT,
+                  "array sections are only aligned to 8 bytes");
+    begin_section(id).write(reinterpret_cast<const char*>(values.data()),
+                            values.size() * sizeof(T));
+  }
+
+  /*
+   * Ends the last section and writes the section table. Nothing may be
+   * written to the container afterwards.
+   */
+  void finish();
+
+ private:
+  void end_section();
+  uint64_t position() const;
+
+  std::ostream& m_os;
+  uint64_t m_start;
+  std::vector<ContainerSection> m_sections;
+  bool m_in_section{false};
+  bool m_finished{false};
+};
+
+class ContainerReader {
+ public:
+  /*
+   * Reads the container in [data, data + size), which must outlive the
+   * reader.
+   */
+  ContainerReader(const char* data, size_t size);
+
+  /*
+   * Maps the container file into memory for the lifetime of the reader.
+   */
+  explicit ContainerReader(const std::string& path);
+
+  ~ContainerReader();
+
+  uint32_t version() const { return m_version; }
+
+  bool has_section(uint32_t id) const;
+
+  /*
+   * The bytes of the section with the given id, which must exist.
+   */
+  std::string_view section(uint32_t id) const;
+
+  /*
+   * The values of a section written with write_array_section(), in place.
+   */
+  template <class T>
+  boost::iterator_range<const T*> array_section(uint32_t id) const {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "array sections must be trivially copyable");
+    auto bytes = section(id);
+    always_assert_log(bytes.size() % sizeof(T) == 0,
+                      "Section %u is not an array of %zu-byte values", id,
+                      sizeof(T));
+    auto begin = reinterpret_cast<const T*>(bytes.data());
+    return {begin, begin + bytes.size() / sizeof(T)};
+  }
+
+ private:
+  void read_table();
+
+  std::unique_ptr<RedexMappedFile> m_file;
+  const char* m_data;
+  size_t m_size;
+  uint32_t m_version{0};
+  std::vector<ContainerSection> m_sections;
+};
+
+} // namespace binary_serialization
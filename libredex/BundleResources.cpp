@@ -16,11 +16,14 @@
 #include <boost/range/iterator_range.hpp>
 #include <fstream>
 #include <iomanip>
+#include <iterator>
 #include <map>
+#include <numeric>
 #include <queue>
 #include <stdexcept>
 #include <string>
 
+#include <google/protobuf/arena.h>
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/message.h>
@@ -31,6 +34,7 @@
 #include "RedexMappedFile.h"
 #include "RedexResources.h"
 #include "Trace.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -54,6 +58,19 @@ void read_protobuf_file_contents(
   });
 }
 
+// Parses a message on `arena`, which frees all of its fields at once instead
+// of one by one.
+template <typename Message>
+Message* parse_on_arena(google::protobuf::io::CodedInputStream& input,
+                        const std::string& file,
+                        google::protobuf::Arena* arena) {
+  auto* message = google::protobuf::Arena::CreateMessage<Message>(arena);
+  bool read_finish = message->ParseFromCodedStream(&input);
+  always_assert_log(read_finish, "BundleResoource failed to read %s",
+                    file.c_str());
+  return message;
+}
+
 bool has_attribute(const aapt::pb::XmlElement& element,
                    const std::string& name) {
   for (const aapt::pb::XmlAttribute& pb_attr : element.attribute()) {
@@ -401,15 +418,34 @@ boost::optional<int32_t> BundleResources::get_min_sdk() {
 }
 
 ManifestClassInfo BundleResources::get_manifest_class_info() {
-  ManifestClassInfo manifest_classes;
+  std::vector<std::string> manifests;
   boost::filesystem::path dir(m_directory);
   for (auto& entry : boost::make_iterator_range(
            boost::filesystem::directory_iterator(dir), {})) {
     auto manifest = entry.path() / "manifest/AndroidManifest.xml";
     if (boost::filesystem::exists(manifest)) {
-      read_single_manifest(manifest.string(), &manifest_classes);
+      manifests.emplace_back(manifest.string());
     }
   }
+  // The manifests of the modules are read in parallel, and merged in order.
+  std::vector<ManifestClassInfo> module_classes(manifests.size());
+  std::vector<size_t> indices(manifests.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) { read_single_manifest(manifests[i], &module_classes[i]); },
+      indices);
+  ManifestClassInfo manifest_classes;
+  for (auto& classes : module_classes) {
+    manifest_classes.application_classes.insert(
+        classes.application_classes.begin(), classes.application_classes.end());
+    manifest_classes.instrumentation_classes.insert(
+        classes.instrumentation_classes.begin(),
+        classes.instrumentation_classes.end());
+    manifest_classes.component_tags.insert(
+        manifest_classes.component_tags.end(),
+        std::make_move_iterator(classes.component_tags.begin()),
+        std::make_move_iterator(classes.component_tags.end()));
+  }
   return manifest_classes;
 }
 
@@ -771,12 +807,11 @@ void BundleResources::collect_layout_classes_and_attributes_for_file(
   read_protobuf_file_contents(
       file_path,
       [&](google::protobuf::io::CodedInputStream& input, size_t size) {
-        aapt::pb::XmlNode pb_node;
-        bool read_finish = pb_node.ParseFromCodedStream(&input);
-        always_assert_log(read_finish, "BundleResoource failed to read %s",
-                          file_path.c_str());
-        if (pb_node.has_element()) {
-          const auto& root = pb_node.element();
+        google::protobuf::Arena arena;
+        auto* pb_node =
+            parse_on_arena<aapt::pb::XmlNode>(input, file_path, &arena);
+        if (pb_node->has_element()) {
+          const auto& root = pb_node->element();
           std::unordered_map<std::string, std::string> ns_uri_to_prefix;
           for (const auto& ns_decl : root.namespace_declaration()) {
             if (!ns_decl.uri().empty() && !ns_decl.prefix().empty()) {
@@ -881,35 +916,36 @@ std::unordered_set<uint32_t> BundleResources::get_xml_reference_attributes(
 void ResourcesPbFile::remap_res_ids_and_serialize(
     const std::vector<std::string>& resource_files,
     const std::map<uint32_t, uint32_t>& old_to_new) {
-  for (const auto& resources_pb_path : resource_files) {
-    TRACE(RES,
-          9,
-          "BundleResources changing resource data for file: %s",
-          resources_pb_path.c_str());
-    read_protobuf_file_contents(
-        resources_pb_path,
-        [&](google::protobuf::io::CodedInputStream& input,
-            size_t /* unused */) {
-          aapt::pb::ResourceTable pb_restable;
-          bool read_finish = pb_restable.ParseFromCodedStream(&input);
-          always_assert_log(read_finish,
-                            "BundleResoource failed to read %s",
-                            resources_pb_path.c_str());
-          int package_size = pb_restable.package_size();
-          for (int i = 0; i < package_size; i++) {
-            auto package = pb_restable.mutable_package(i);
-            auto current_package_id = package->package_id().id();
-            int type_size = package->type_size();
-            for (int j = 0; j < type_size; j++) {
-              auto type = package->mutable_type(j);
-              remove_or_change_resource_ids(m_ids_to_remove, old_to_new,
-                                            current_package_id, type);
-            }
-          }
-          std::ofstream out(resources_pb_path, std::ofstream::binary);
-          always_assert(pb_restable.SerializeToOstream(&out));
-        });
-  }
+  // The resource tables of the modules are independent.
+  workqueue_run<std::string>(
+      [&](const std::string& resources_pb_path) {
+        TRACE(RES,
+              9,
+              "BundleResources changing resource data for file: %s",
+              resources_pb_path.c_str());
+        read_protobuf_file_contents(
+            resources_pb_path,
+            [&](google::protobuf::io::CodedInputStream& input,
+                size_t /* unused */) {
+              google::protobuf::Arena arena;
+              auto* pb_restable = parse_on_arena<aapt::pb::ResourceTable>(
+                  input, resources_pb_path, &arena);
+              int package_size = pb_restable->package_size();
+              for (int i = 0; i < package_size; i++) {
+                auto package = pb_restable->mutable_package(i);
+                auto current_package_id = package->package_id().id();
+                int type_size = package->type_size();
+                for (int j = 0; j < type_size; j++) {
+                  auto type = package->mutable_type(j);
+                  remove_or_change_resource_ids(m_ids_to_remove, old_to_new,
+                                                current_package_id, type);
+                }
+              }
+              std::ofstream out(resources_pb_path, std::ofstream::binary);
+              always_assert(pb_restable->SerializeToOstream(&out));
+            });
+      },
+      resource_files);
 }
 
 namespace {
@@ -941,39 +977,40 @@ void remap_entry_file_paths(
 void ResourcesPbFile::remap_file_paths_and_serialize(
     const std::vector<std::string>& resource_files,
     const std::unordered_map<std::string, std::string>& old_to_new) {
-  for (const auto& resources_pb_path : resource_files) {
-    TRACE(RES,
-          9,
-          "BundleResources changing file paths for file: %s",
-          resources_pb_path.c_str());
-    read_protobuf_file_contents(
-        resources_pb_path,
-        [&](google::protobuf::io::CodedInputStream& input,
-            size_t /* unused */) {
-          aapt::pb::ResourceTable pb_restable;
-          bool read_finish = pb_restable.ParseFromCodedStream(&input);
-          always_assert_log(read_finish,
-                            "BundleResoource failed to read %s",
-                            resources_pb_path.c_str());
-          int package_size = pb_restable.package_size();
-          for (int i = 0; i < package_size; i++) {
-            auto package = pb_restable.mutable_package(i);
-            auto current_package_id = package->package_id().id();
-            int type_size = package->type_size();
-            for (int j = 0; j < type_size; j++) {
-              auto type = package->mutable_type(j);
-              auto current_type_id = type->type_id().id();
-              int entry_size = type->entry_size();
-              for (int k = 0; k < entry_size; k++) {
-                remap_entry_file_paths(old_to_new, current_package_id,
-                                       current_type_id, type->mutable_entry(k));
+  workqueue_run<std::string>(
+      [&](const std::string& resources_pb_path) {
+        TRACE(RES,
+              9,
+              "BundleResources changing file paths for file: %s",
+              resources_pb_path.c_str());
+        read_protobuf_file_contents(
+            resources_pb_path,
+            [&](google::protobuf::io::CodedInputStream& input,
+                size_t /* unused */) {
+              google::protobuf::Arena arena;
+              auto* pb_restable = parse_on_arena<aapt::pb::ResourceTable>(
+                  input, resources_pb_path, &arena);
+              int package_size = pb_restable->package_size();
+              for (int i = 0; i < package_size; i++) {
+                auto package = pb_restable->mutable_package(i);
+                auto current_package_id = package->package_id().id();
+                int type_size = package->type_size();
+                for (int j = 0; j < type_size; j++) {
+                  auto type = package->mutable_type(j);
+                  auto current_type_id = type->type_id().id();
+                  int entry_size = type->entry_size();
+                  for (int k = 0; k < entry_size; k++) {
+                    remap_entry_file_paths(old_to_new, current_package_id,
+                                           current_type_id,
+                                           type->mutable_entry(k));
+                  }
+                }
               }
-            }
-          }
-          std::ofstream out(resources_pb_path, std::ofstream::binary);
-          always_assert(pb_restable.SerializeToOstream(&out));
-        });
-  }
+              std::ofstream out(resources_pb_path, std::ofstream::binary);
+              always_assert(pb_restable->SerializeToOstream(&out));
+            });
+      },
+      resource_files);
 }
 
 namespace {
@@ -1099,72 +1136,88 @@ void reorder_config_value_repeated_field(aapt::pb::ResourceTable* pb_restable) {
     }
   }
 }
-} // namespace
 
-void ResourcesPbFile::collect_resource_data_for_file(
-    const std::string& resources_pb_path) {
+// Parses a resources.pb file on `arena`, and normalizes the table for
+// comparing config values. Returns nullptr for an unreadable file.
+aapt::pb::ResourceTable* read_resource_table(
+    const std::string& resources_pb_path, google::protobuf::Arena* arena) {
   TRACE(RES,
         9,
         "BundleResources collecting resource data for file: %s",
         resources_pb_path.c_str());
+  aapt::pb::ResourceTable* pb_restable = nullptr;
   read_protobuf_file_contents(
       resources_pb_path,
       [&](google::protobuf::io::CodedInputStream& input, size_t /* unused */) {
-        aapt::pb::ResourceTable pb_restable;
-        bool read_finish = pb_restable.ParseFromCodedStream(&input);
-        always_assert_log(read_finish, "BundleResoource failed to read %s",
-                          resources_pb_path.c_str());
-        if (pb_restable.has_source_pool()) {
+        pb_restable = parse_on_arena<aapt::pb::ResourceTable>(
+            input, resources_pb_path, arena);
+        if (pb_restable->has_source_pool()) {
           // Source positions refer to ResStringPool entries which are file
           // paths from the perspective of the build machine. Not relevant for
           // further operations, set them to a predictable value.
           // NOTE: Not all input .aab files will have this data; release style
           // bundles should omit this data.
-          reset_pb_source(&pb_restable);
+          reset_pb_source(pb_restable);
         }
         // Repeated fields might not be comming in ordered, to make following
         // config_value comparison work with different order, reorder repeated
         // fields in config_value's value
-        reorder_config_value_repeated_field(&pb_restable);
-        for (const aapt::pb::Package& pb_package : pb_restable.package()) {
-          auto current_package_id = pb_package.package_id().id();
-          TRACE(RES, 9, "Package: %s %X", pb_package.package_name().c_str(),
-                current_package_id);
-          m_package_id_to_module_name.emplace(
-              current_package_id, module_name_from_pb_path(resources_pb_path));
-          for (const aapt::pb::Type& pb_type : pb_package.type()) {
-            auto current_type_id = pb_type.type_id().id();
-            const auto& current_type_name = pb_type.name();
-            TRACE(RES, 9, "  Type: %s %X", current_type_name.c_str(),
-                  current_type_id);
-            always_assert(m_type_id_to_names.count(current_type_id) == 0 ||
-                          m_type_id_to_names.at(current_type_id) ==
-                              current_type_name);
-            m_type_id_to_names[current_type_id] = current_type_name;
-            for (const aapt::pb::Entry& pb_entry : pb_type.entry()) {
-              if (m_package_id == 0xFFFFFFFF) {
-                m_package_id = current_package_id;
-              }
-              always_assert_log(
-                  m_package_id == current_package_id,
-                  "Broken assumption for only one package for resources.");
-              std::string name_string = pb_entry.name();
-              auto current_entry_id = pb_entry.entry_id().id();
-              auto current_resource_id = MAKE_RES_ID(
-                  current_package_id, current_type_id, current_entry_id);
-              TRACE(RES, 9, "    Entry: %s %X %X", pb_entry.name().c_str(),
-                    current_entry_id, current_resource_id);
-              sorted_res_ids.add(current_resource_id);
-              always_assert(m_existed_res_ids.count(current_resource_id) == 0);
-              m_existed_res_ids.emplace(current_resource_id);
-              id_to_name.emplace(current_resource_id, name_string);
-              name_to_ids[name_string].push_back(current_resource_id);
-              m_res_id_to_configvalue.emplace(current_resource_id,
-                                              pb_entry.config_value());
-            }
-          }
-        }
+        reorder_config_value_repeated_field(pb_restable);
       });
+  return pb_restable;
+}
+} // namespace
+
+void ResourcesPbFile::collect_resource_data_for_file(
+    const std::string& resources_pb_path) {
+  google::protobuf::Arena arena;
+  auto* pb_restable = read_resource_table(resources_pb_path, &arena);
+  if (pb_restable != nullptr) {
+    collect_resource_data(resources_pb_path, *pb_restable);
+  }
+}
+
+void ResourcesPbFile::collect_resource_data(
+    const std::string& resources_pb_path,
+    const aapt::pb::ResourceTable& pb_restable) {
+  for (const aapt::pb::Package& pb_package : pb_restable.package()) {
+    auto current_package_id = pb_package.package_id().id();
+    TRACE(RES, 9, "Package: %s %X", pb_package.package_name().c_str(),
+          current_package_id);
+    m_package_id_to_module_name.emplace(
+        current_package_id, module_name_from_pb_path(resources_pb_path));
+    for (const aapt::pb::Type& pb_type : pb_package.type()) {
+      auto current_type_id = pb_type.type_id().id();
+      const auto& current_type_name = pb_type.name();
+      TRACE(RES, 9, "  Type: %s %X", current_type_name.c_str(),
+            current_type_id);
+      always_assert(m_type_id_to_names.count(current_type_id) == 0 ||
+                    m_type_id_to_names.at(current_type_id) ==
+                        current_type_name);
+      m_type_id_to_names[current_type_id] = current_type_name;
+      for (const aapt::pb::Entry& pb_entry : pb_type.entry()) {
+        if (m_package_id == 0xFFFFFFFF) {
+          m_package_id = current_package_id;
+        }
+        always_assert_log(
+            m_package_id == current_package_id,
+            "Broken assumption for only one package for resources.");
+        std::string name_string = pb_entry.name();
+        auto current_entry_id = pb_entry.entry_id().id();
+        auto current_resource_id = MAKE_RES_ID(
+            current_package_id, current_type_id, current_entry_id);
+        TRACE(RES, 9, "    Entry: %s %X %X", pb_entry.name().c_str(),
+              current_entry_id, current_resource_id);
+        sorted_res_ids.add(current_resource_id);
+        always_assert(m_existed_res_ids.count(current_resource_id) == 0);
+        m_existed_res_ids.emplace(current_resource_id);
+        id_to_name.emplace(current_resource_id, name_string);
+        name_to_ids[name_string].push_back(current_resource_id);
+        m_res_id_to_configvalue.emplace(current_resource_id,
+                                        pb_entry.config_value());
+      }
+    }
+  }
 }
 
 std::unordered_set<uint32_t> ResourcesPbFile::get_types_by_name(
@@ -1301,8 +1354,21 @@ void ResourcesPbFile::walk_references_for_resource(
 std::unique_ptr<ResourceTableFile> BundleResources::load_res_table() {
   const auto& res_pb_file_paths = find_resources_files();
   auto to_return = std::make_unique<ResourcesPbFile>(ResourcesPbFile());
-  for (const auto& res_pb_file_path : res_pb_file_paths) {
-    to_return->collect_resource_data_for_file(res_pb_file_path);
+  // The modules are parsed in parallel, each on its own arena, and then
+  // collected in order.
+  std::vector<google::protobuf::Arena> arenas(res_pb_file_paths.size());
+  std::vector<aapt::pb::ResourceTable*> tables(res_pb_file_paths.size());
+  std::vector<size_t> indices(res_pb_file_paths.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        tables[i] = read_resource_table(res_pb_file_paths[i], &arenas[i]);
+      },
+      indices);
+  for (size_t i = 0; i < tables.size(); i++) {
+    if (tables[i] != nullptr) {
+      to_return->collect_resource_data(res_pb_file_paths[i], *tables[i]);
+    }
   }
   return to_return;
 }
@@ -47,6 +47,8 @@ class ResourcesPbFile : public ResourceTableFile {
       std::unordered_set<std::string>* potential_file_paths) override;
   void delete_resource(uint32_t res_id) override;
   void collect_resource_data_for_file(const std::string& resources_pb_path);
+  void collect_resource_data(const std::string& resources_pb_path,
+                             const aapt::pb::ResourceTable& pb_restable);
   size_t get_hash_from_values(const ConfigValues& config_values);
 
   const std::map<uint32_t, const ConfigValues>& get_res_id_to_configvalue()
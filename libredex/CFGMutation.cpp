@@ -22,6 +22,13 @@ void CFGMutation::flush() {
     return;
   }
 
+  for (Block* b : m_cfg.blocks()) {
+    if (m_changes.empty()) {
+      return;
+    }
+    flush_in_place(b);
+  }
+
   auto ii = InstructionIterable(m_cfg);
   for (auto it = ii.begin(); !m_changes.empty() && !it.is_end();) {
     auto c = m_changes.find(it->insn);
@@ -44,8 +51,107 @@ void CFGMutation::flush() {
   clear();
 }
 
+bool CFGMutation::flush_in_place(Block* b) {
+  bool block_throws = !m_cfg.get_succ_edges_of_type(b, EDGE_THROW).empty();
+  auto last = b->get_last_insn();
+  std::vector<std::pair<IRList::iterator, ChangeSet*>> anchors;
+  for (auto it = b->begin(); it != b->end(); ++it) {
+    if (it->type != MFLOW_OPCODE) {
+      continue;
+    }
+    auto c = m_changes.find(it->insn);
+    if (c == m_changes.end()) {
+      continue;
+    }
+    if (!c->second.can_apply_in_place(it->insn, block_throws, it == last)) {
+      return false;
+    }
+    anchors.emplace_back(it, &c->second);
+  }
+  for (auto& [it, change] : anchors) {
+    // The anchor may be replaced.
+    auto insn = it->insn;
+    change->apply_in_place(m_cfg, b, it);
+    m_changes.erase(insn);
+  }
+  return true;
+}
+
 CFGMutation::ChangeSet::~ChangeSet() {}
 
+bool CFGMutation::ChangeSet::can_apply_in_place(const IRInstruction* anchor,
+                                                bool block_throws,
+                                                bool last) const {
+  if (!m_insert_before_var.empty() || !m_insert_after_var.empty()) {
+    return false;
+  }
+  auto stays_in_block = [block_throws](const IRInstruction* insn) {
+    auto op = insn->opcode();
+    return !is_terminal(op) && !(block_throws && opcode::may_throw(op));
+  };
+  auto all_stay_in_block = [&](const std::vector<IRInstruction*>& insns) {
+    return std::all_of(insns.begin(), insns.end(), stays_in_block);
+  };
+  if (!all_stay_in_block(m_insert_before) ||
+      !all_stay_in_block(m_insert_after) ||
+      (m_replace && !all_stay_in_block(*m_replace))) {
+    return false;
+  }
+  if (m_replace || (!m_insert_before.empty() && !m_insert_after.empty())) {
+    // The anchor is removed.
+    return stays_in_block(anchor) && !anchor->has_move_result_any();
+  }
+  if (!m_insert_after.empty()) {
+    // Inserting after the end of a block that throws starts a new block.
+    return !is_terminal(anchor->opcode()) && !(block_throws && last);
+  }
+  return true;
+}
+
+void CFGMutation::ChangeSet::apply_in_place(ControlFlowGraph& cfg,
+                                            Block* b,
+                                            const IRList::iterator& anchor) {
+  // The same steps as `apply`, in the same order.
+  auto& entries = b->m_entries;
+  for (auto&& pos : m_insert_pos_before) {
+    entries.insert_before(anchor, std::move(pos));
+  }
+  for (auto&& pos : m_insert_pos_after) {
+    entries.insert_after(anchor, std::move(pos));
+  }
+  for (auto&& sb : m_insert_sb_before) {
+    entries.insert_before(anchor, std::move(sb));
+  }
+  for (auto&& sb : m_insert_sb_after) {
+    entries.insert_after(anchor, std::move(sb));
+  }
+
+  auto insert_all = [&](const IRList::iterator& pos,
+                        const std::vector<IRInstruction*>& insns) {
+    cfg.m_mutations++;
+    for (auto* insn : insns) {
+      entries.insert_before(pos, insn);
+    }
+  };
+  if (!m_replace.has_value() && m_insert_after.empty()) {
+    insert_all(anchor, m_insert_before);
+  } else if (!m_replace.has_value() && m_insert_before.empty()) {
+    insert_all(std::next(anchor), m_insert_after);
+  } else {
+    insert_all(anchor, m_insert_before);
+    if (m_replace.has_value()) {
+      insert_all(anchor, m_replace.get());
+    } else {
+      // Copying to avoid problem, replacing insn B with A-B-C
+      insert_all(anchor, {new IRInstruction(*anchor->insn)});
+    }
+    insert_all(anchor, m_insert_after);
+    cfg.m_mutations++;
+    cfg.m_removed_insns.push_back(anchor->insn);
+    entries.erase_and_dispose(anchor);
+  }
+}
+
 void CFGMutation::ChangeSet::apply(ControlFlowGraph& cfg,
                                    InstructionIterator& it) {
   always_assert_log(
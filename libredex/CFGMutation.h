@@ -176,11 +176,19 @@ class CFGMutation {
   /// Apply all the changes that have been added since the last flush or clear
   /// (or since the mutation was created).  Changes are applied in the order
   /// they are added to the mutation.
+  ///
+  /// Blocks whose changes cannot split the block or change its edges are
+  /// edited directly, in one pass over each block. The other changes go
+  /// through the CFG insertion methods one at a time.
   void flush();
 
  private:
   static bool is_terminal(IROpcode op);
 
+  /// Applies the changes anchored in \p b if they all leave the edges and the
+  /// boundaries of the block alone, and returns whether it did.
+  bool flush_in_place(Block* b);
+
   /// A memento of a change we wish to make to the CFG.
   class ChangeSet {
    public:
@@ -196,6 +204,20 @@ class CFGMutation {
     ///    applied.
     void apply(ControlFlowGraph& cfg, InstructionIterator& it);
 
+    /// Whether \p apply_in_place can apply this change at \p anchor, which
+    /// is the last instruction of its block iff \p last. That is the case if
+    /// no instruction that the change adds or removes ends the block, throws
+    /// in a block with throw edges, or has a move-result.
+    bool can_apply_in_place(const IRInstruction* anchor,
+                            bool block_throws,
+                            bool last) const;
+
+    /// Apply this change on the entries of \p b, with the same result as
+    /// \p apply, but without any of the checks of the CFG insertion methods.
+    void apply_in_place(ControlFlowGraph& cfg,
+                        Block* b,
+                        const IRList::iterator& anchor);
+
     /// Accumulates changes for a specific instruction.
     /// Check \link CFGMutation::add_change \endlink for more details
     void add_change(Insert where, std::vector<IRInstruction*> insn_change);
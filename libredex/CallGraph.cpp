@@ -12,6 +12,7 @@
 #include "ConcurrentContainers.h"
 #include "MethodOverrideGraph.h"
 #include "Show.h"
+#include "StlUtil.h"
 #include "Trace.h"
 #include "Walkers.h"
 
@@ -479,6 +480,123 @@ void Graph::add_edge(const NodeId& caller,
   callee->m_predecessors.emplace_back(edge);
 }
 
+uint32_t Graph::remove_edges(const std::vector<EdgeId>& edges) {
+  std::unordered_set<const Edge*> removed;
+  std::unordered_set<Node*> callers;
+  std::unordered_set<Node*> callees;
+  for (const auto& edge : edges) {
+    if (!removed.emplace(edge.get()).second) {
+      continue;
+    }
+    callers.emplace(edge->caller().get());
+    callees.emplace(edge->callee().get());
+    auto* insn = edge->invoke_insn();
+    if (insn == nullptr) {
+      continue;
+    }
+    auto it = m_insn_to_callee.find(insn);
+    if (it != m_insn_to_callee.end()) {
+      it->second.erase(edge->callee()->method());
+      if (it->second.empty()) {
+        m_insn_to_callee.erase(it);
+      }
+    }
+  }
+  // Each list is filtered once, however many of its edges go away, as the
+  // exit node and popular callees have very many predecessors.
+  auto is_removed = [&](const EdgeId& edge) {
+    return removed.count(edge.get()) != 0;
+  };
+  for (auto* caller : callers) {
+    std20::erase_if(caller->m_successors, is_removed);
+  }
+  for (auto* callee : callees) {
+    std20::erase_if(callee->m_predecessors, is_removed);
+  }
+  return removed.size();
+}
+
+CallgraphUpdateStats Graph::update_callers(
+    const BuildStrategy& strat, const std::vector<const DexMethod*>& callers) {
+  CallgraphUpdateStats stats;
+  std::vector<const DexMethod*> existing_callers;
+  Edges stale_edges;
+  for (const DexMethod* caller : callers) {
+    auto it = m_nodes.find(caller);
+    if (it == m_nodes.end()) {
+      continue;
+    }
+    existing_callers.push_back(caller);
+    const auto& callees = it->second->m_successors;
+    stale_edges.insert(stale_edges.end(), callees.begin(), callees.end());
+  }
+  stats.edges_removed = remove_edges(stale_edges);
+
+  // As in the constructor, but only the callers and the callees that are new
+  // to the graph are visited.
+  MethodSet visited;
+  auto visit = [&](const DexMethod* caller, auto& visit_fn) -> void {
+    if (!visited.emplace(caller).second) {
+      return;
+    }
+    auto callsites = strat.get_callsites(caller);
+    if (callsites.empty()) {
+      this->add_edge(make_node(caller), m_exit, nullptr);
+      ++stats.edges_added;
+    }
+    for (const auto& callsite : callsites) {
+      bool is_new = !has_node(callsite.callee);
+      this->add_edge(make_node(caller), make_node(callsite.callee),
+                     callsite.invoke_insn);
+      ++stats.edges_added;
+      m_insn_to_callee[callsite.invoke_insn].emplace(callsite.callee);
+      if (is_new) {
+        ++stats.nodes_added;
+        visit_fn(callsite.callee, visit_fn);
+      }
+    }
+  };
+  for (const DexMethod* caller : existing_callers) {
+    visit(caller, visit);
+  }
+  return stats;
+}
+
+CallgraphUpdateStats Graph::remove_methods(
+    const std::vector<const DexMethod*>& methods) {
+  CallgraphUpdateStats stats;
+  std::vector<NodeId> removed_nodes;
+  Edges stale_edges;
+  for (const DexMethod* method : methods) {
+    auto it = m_nodes.find(method);
+    if (it == m_nodes.end()) {
+      continue;
+    }
+    const auto& node = it->second;
+    stale_edges.insert(stale_edges.end(), node->m_predecessors.begin(),
+                       node->m_predecessors.end());
+    stale_edges.insert(stale_edges.end(), node->m_successors.begin(),
+                       node->m_successors.end());
+    removed_nodes.push_back(node);
+  }
+  stats.edges_removed = remove_edges(stale_edges);
+  for (const auto& node : removed_nodes) {
+    m_nodes.erase(node->method());
+    m_dynamic_methods.erase(node->method());
+    ++stats.nodes_removed;
+  }
+  // Remaining callers without callees exit, as they would in a rebuilt graph.
+  for (const auto& edge : stale_edges) {
+    auto caller = edge->caller();
+    if (caller->method() != nullptr && has_node(caller->method()) &&
+        caller->m_successors.empty()) {
+      add_edge(caller, m_exit, nullptr);
+      ++stats.edges_added;
+    }
+  }
+  return stats;
+}
+
 MethodSet resolve_callees_in_graph(const Graph& graph,
                                    const DexMethod* method,
                                    const IRInstruction* insn) {
@@ -540,4 +658,23 @@ CallgraphStats get_num_nodes_edges(const Graph& graph) {
   return CallgraphStats(visited_node.size(), num_edge, num_callsites);
 }
 
+SccCondensation<const DexMethod*> condense(const Graph& graph) {
+  auto callees_of = [](const NodeId& node) {
+    std::vector<const DexMethod*> callees;
+    callees.reserve(node->callees().size());
+    for (const auto& edge : node->callees()) {
+      // Leaves have an edge to the ghost exit, which has no method.
+      if (edge->callee()->method() != nullptr) {
+        callees.push_back(edge->callee()->method());
+      }
+    }
+    return callees;
+  };
+  std::vector<const DexMethod*> roots = callees_of(graph.entry());
+  return SccCondensation<const DexMethod*>(
+      roots, [&](const DexMethod* method) {
+        return callees_of(graph.node(method));
+      });
+}
+
 } // namespace call_graph
@@ -13,6 +13,7 @@
 #include "IRCode.h"
 #include "MonotonicFixpointIterator.h"
 #include "Resolver.h"
+#include "SccCondensation.h"
 
 namespace method_override_graph {
 class Graph;
@@ -127,10 +128,39 @@ class Edge {
   IRInstruction* m_invoke_insn;
 };
 
+struct CallgraphUpdateStats {
+  uint32_t nodes_added{0};
+  uint32_t nodes_removed{0};
+  uint32_t edges_added{0};
+  uint32_t edges_removed{0};
+};
+
 class Graph final {
  public:
   explicit Graph(const BuildStrategy&);
 
+  /*
+   * Recomputes the callees of the given methods after their code changed,
+   * e.g. because calls were inlined into them or devirtualized. `strat` must
+   * be equivalent to the strategy that the graph was built with. Callees that
+   * were not in the graph yet are visited recursively, like the constructor
+   * does. Methods without a node are not reachable from the entry and are
+   * skipped.
+   *
+   * Unlike a rebuild, this leaves in the graph the nodes that are no longer
+   * reachable from the entry, which the fixpoint iterators never visit.
+   */
+  CallgraphUpdateStats update_callers(
+      const BuildStrategy& strat, const std::vector<const DexMethod*>& callers);
+
+  /*
+   * Removes the nodes of methods that are about to be deleted, along with all
+   * their edges. The remaining callers of these methods, if any, must be
+   * updated separately.
+   */
+  CallgraphUpdateStats remove_methods(
+      const std::vector<const DexMethod*>& methods);
+
   NodeId entry() const { return m_entry; }
   NodeId exit() const { return m_exit; }
 
@@ -155,6 +185,10 @@ class Graph final {
     return m_dynamic_methods;
   }
 
+  const std::unordered_map<const DexMethod*, NodeId>& nodes() const {
+    return m_nodes;
+  }
+
  private:
   NodeId make_node(const DexMethod*);
 
@@ -162,6 +196,10 @@ class Graph final {
                 const NodeId& callee,
                 IRInstruction* invoke_insn);
 
+  // Detaches the given edges from the nodes at both of their ends, and
+  // returns how many edges were removed.
+  uint32_t remove_edges(const std::vector<EdgeId>& edges);
+
   std::shared_ptr<Node> m_entry;
   std::shared_ptr<Node> m_exit;
   std::unordered_map<const DexMethod*, NodeId> m_nodes;
@@ -278,4 +316,10 @@ struct CallgraphStats {
 
 CallgraphStats get_num_nodes_edges(const Graph& graph);
 
+/*
+ * The strongly connected components of the methods reachable from the entry,
+ * bottom-up. Recursive components are the cycles of the call graph.
+ */
+SccCondensation<const DexMethod*> condense(const Graph& graph);
+
 } // namespace call_graph
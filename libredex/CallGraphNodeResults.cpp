@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "CallGraphNodeResults.h"
+
+#include "Resolver.h"
+
+namespace call_graph {
+
+bool refers_to_any(const Graph& graph,
+                   const DexMethod* method,
+                   const std::unordered_set<const DexField*>& fields,
+                   const std::unordered_set<const DexMethod*>& methods) {
+  for (auto& mie : InstructionIterable(method->get_code()->cfg())) {
+    auto* insn = mie.insn;
+    if (insn->has_field()) {
+      auto* field = resolve_field(insn->get_field());
+      if (field != nullptr && fields.count(field)) {
+        return true;
+      }
+    } else if (insn->has_method()) {
+      auto* callee = resolve_method(insn->get_method(), opcode_to_search(insn));
+      if (callee == nullptr &&
+          opcode_to_search(insn) == MethodSearch::Virtual) {
+        callee =
+            resolve_method(insn->get_method(), MethodSearch::InterfaceVirtual);
+      }
+      if (callee != nullptr && methods.count(callee)) {
+        return true;
+      }
+      for (auto* cg_callee : resolve_callees_in_graph(graph, insn)) {
+        if (methods.count(cg_callee)) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+} // namespace call_graph
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "CallGraph.h"
+#include "ConcurrentContainers.h"
+#include "WorkQueue.h"
+
+namespace call_graph {
+
+/*
+ * Whether the code of :method refers to any of :fields or :methods. Callees
+ * are looked up both by resolving the invoked method and through the call
+ * graph.
+ */
+bool refers_to_any(const Graph& graph,
+                   const DexMethod* method,
+                   const std::unordered_set<const DexField*>& fields,
+                   const std::unordered_set<const DexMethod*>& methods);
+
+/*
+ * The results of analyzing methods in an interprocedural fixpoint over the
+ * call graph, kept across runs of the fixpoint. A result is reused as long as
+ * the entry state of its method is the same, and the summaries of the fields
+ * and methods that its code refers to did not change in between, see
+ * invalidate().
+ *
+ * Each result can also hold what its method contributed to the summaries of
+ * the program, so that they can be collected again without reanalyzing the
+ * method.
+ */
+template <typename Domain, typename Contributions>
+class NodeResults final {
+ public:
+  /*
+   * If the result of :method was computed from the entry state :state, sets
+   * :state to the exit state of that result and returns true.
+   */
+  bool reuse(const DexMethod* method, Domain* state) const {
+    auto result = m_results.get(method, nullptr);
+    if (result == nullptr || !result->entry_state.equals(*state)) {
+      return false;
+    }
+    *state = result->exit_state;
+    return true;
+  }
+
+  void record(const DexMethod* method, Domain entry_state, Domain exit_state) {
+    m_results.insert_or_assign(std::make_pair(
+        method, std::make_shared<const Result>(
+                    Result{std::move(entry_state), std::move(exit_state)})));
+  }
+
+  /*
+   * Returns the contributions that were last recorded for :method, if the
+   * result of its analysis holds for :entry_state.
+   */
+  std::shared_ptr<const Contributions> get_contributions(
+      const DexMethod* method, const Domain& entry_state) const {
+    auto result = get_current_result(method, entry_state);
+    return result == nullptr ? nullptr : result->contributions;
+  }
+
+  // The contributions are only recorded while no fixpoint is running.
+  void set_contributions(
+      const DexMethod* method,
+      const Domain& entry_state,
+      std::shared_ptr<const Contributions> contributions) const {
+    auto result = get_current_result(method, entry_state);
+    if (result != nullptr) {
+      result->contributions = std::move(contributions);
+    }
+  }
+
+  /*
+   * Drops the results of the methods that refer to any of :fields or
+   * :methods, whose summaries changed. Returns the number of results dropped.
+   */
+  size_t invalidate(const Graph& graph,
+                    const std::unordered_set<const DexField*>& fields,
+                    const std::unordered_set<const DexMethod*>& methods) {
+    std::vector<const DexMethod*> analyzed;
+    analyzed.reserve(m_results.size());
+    for (auto& pair : m_results) {
+      analyzed.push_back(pair.first);
+    }
+    ConcurrentSet<const DexMethod*> stale;
+    workqueue_run<const DexMethod*>(
+        [&](const DexMethod* method) {
+          if (refers_to_any(graph, method, fields, methods)) {
+            stale.insert(method);
+          }
+        },
+        analyzed);
+    for (auto* method : stale) {
+      m_results.erase(method);
+    }
+    return stale.size();
+  }
+
+  void clear() { m_results.clear(); }
+
+  size_t size() const { return m_results.size(); }
+
+ private:
+  struct Result {
+    Domain entry_state;
+    Domain exit_state;
+    mutable std::shared_ptr<const Contributions> contributions;
+  };
+
+  std::shared_ptr<const Result> get_current_result(
+      const DexMethod* method, const Domain& entry_state) const {
+    auto result = m_results.get(method, nullptr);
+    if (result == nullptr || !result->entry_state.equals(entry_state)) {
+      return nullptr;
+    }
+    return result;
+  }
+
+  ConcurrentMap<const DexMethod*, std::shared_ptr<const Result>> m_results;
+};
+
+} // namespace call_graph
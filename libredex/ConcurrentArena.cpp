@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ConcurrentArena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "Debug.h"
+
+namespace {
+
+size_t shard_index(size_t num_shards) {
+  static std::atomic<size_t> next_index{0};
+  thread_local size_t index =
+      next_index.fetch_add(1, std::memory_order_relaxed);
+  return index % num_shards;
+}
+
+} // namespace
+
+ConcurrentArena::~ConcurrentArena() {
+  for (auto& shard : m_shards) {
+    for (auto* chunk : shard.chunks) {
+      delete[] chunk;
+    }
+  }
+}
+
+void* ConcurrentArena::allocate(size_t size, size_t alignment) {
+  always_assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  auto& shard = m_shards[shard_index(kNumShards)];
+  std::lock_guard<std::mutex> guard(shard.lock);
+  auto align = [alignment](char* p) {
+    auto addr = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<char*>((addr + alignment - 1) & ~(alignment - 1));
+  };
+  char* p = shard.cur == nullptr ? nullptr : align(shard.cur);
+  if (p == nullptr || p + size > shard.end) {
+    // Large objects get a chunk of their own, so that the current chunk is
+    // not abandoned for them.
+    size_t chunk_size = std::max(kChunkSize, size + alignment);
+    auto* chunk = new char[chunk_size];
+    shard.chunks.push_back(chunk);
+    shard.reserved_bytes += chunk_size;
+    p = align(chunk);
+    if (chunk_size == kChunkSize) {
+      shard.end = chunk + chunk_size;
+    } else {
+      return p;
+    }
+  }
+  shard.cur = p + size;
+  return p;
+}
+
+size_t ConcurrentArena::reserved_bytes() const {
+  size_t bytes = 0;
+  for (const auto& shard : m_shards) {
+    std::lock_guard<std::mutex> guard(shard.lock);
+    bytes += shard.reserved_bytes;
+  }
+  return bytes;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "Thread.h"
+
+/*
+ * A bump allocator that many threads allocate from at once, for objects that
+ * live as long as the arena, like the interned references of a RedexContext.
+ * Objects are packed into large chunks, and all chunks are returned at once
+ * when the arena is destroyed; memory is never returned earlier.
+ *
+ * The arena does not run destructors. Owners either only put trivially
+ * destructible objects into it, or destroy the objects themselves before the
+ * arena goes away.
+ *
+ * Each thread allocates from one of a fixed number of shards, so that threads
+ * rarely contend on a shard's lock.
+ */
+class ConcurrentArena final {
+ public:
+  ConcurrentArena() = default;
+  ~ConcurrentArena();
+
+  ConcurrentArena(const ConcurrentArena&) = delete;
+  ConcurrentArena& operator=(const ConcurrentArena&) = delete;
+
+  // Returns memory for `size` bytes with the given (power-of-two) alignment.
+  void* allocate(size_t size, size_t alignment);
+
+  // Total bytes reserved in chunks, for statistics.
+  size_t reserved_bytes() const;
+
+ private:
+  static constexpr size_t kNumShards = 16;
+  static constexpr size_t kChunkSize = 256 * 1024;
+
+  struct alignas(CACHE_LINE_SIZE) Shard {
+    mutable std::mutex lock;
+    char* cur{nullptr};
+    char* end{nullptr};
+    std::vector<char*> chunks;
+    size_t reserved_bytes{0};
+  };
+
+  std::array<Shard, kNumShards> m_shards;
+};
@@ -7,12 +7,17 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <initializer_list>
 #include <iterator>
+#include <memory>
+#include <stdexcept>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <boost/thread.hpp>
 
@@ -24,6 +29,14 @@ namespace cc_impl {
 template <typename Container, size_t n_slots>
 class ConcurrentContainerIterator;
 
+template <typename Slot, typename ValueType, size_t n_slots>
+class ReadOptimizedIterator;
+
+// Marks erased buckets in ReadOptimizedConcurrentMap. Entries are
+// heap-allocated and thus suitably aligned, so this can never be the address of
+// an actual entry.
+constexpr uintptr_t kReadOptimizedTombstone = 1;
+
 } // namespace cc_impl
 
 /*
@@ -536,6 +549,495 @@ class InsertOnlyConcurrentSet final
   size_t erase(const Key& key) = delete;
 };
 
+/*
+ * A concurrent map for read-mostly workloads, e.g. caches that are queried far
+ * more often than they are filled. It offers the same API as ConcurrentMap,
+ * but readers never take a lock:
+ *  - Each slot is an open-addressing hash table whose buckets are atomic
+ *    pointers to immutable entries. Writers still lock the slot.
+ *  - Entries are never modified in place by thread-safe operations. Assigning
+ *    or updating a value publishes a new entry; erasing leaves a tombstone.
+ *  - Replaced entries and outgrown tables are retired rather than freed, since
+ *    a concurrent reader may still be looking at them. Retired memory is only
+ *    reclaimed by `clear()` or when the map is destroyed.
+ *
+ * As a consequence, `at()`, `get()`, `count()` and `find()` are thread-safe
+ * even while other threads insert, and references obtained from `at_unsafe()`
+ * or iterators stay valid (though possibly stale) until `clear()`. The price
+ * is that every `update()` or `insert_or_assign()` on an existing key copies
+ * the entry, so this is a poor fit for maps whose values change frequently.
+ */
+template <typename Key,
+          typename Value,
+          typename Hash = std::hash<Key>,
+          typename Equal = std::equal_to<Key>,
+          size_t n_slots = 31>
+class ReadOptimizedConcurrentMap final {
+ public:
+  static_assert(n_slots > 0, "The concurrent container has no slots");
+
+  using value_type = std::pair<const Key, Value>;
+
+ private:
+  class Table {
+   public:
+    explicit Table(size_t capacity)
+        : m_mask(capacity - 1),
+          m_buckets(new std::atomic<value_type*>[capacity]) {
+      always_assert((capacity & m_mask) == 0);
+      for (size_t i = 0; i < capacity; ++i) {
+        m_buckets[i].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+    size_t mask() const { return m_mask; }
+
+    std::atomic<value_type*>& operator[](size_t i) { return m_buckets[i]; }
+
+    const std::atomic<value_type*>& operator[](size_t i) const {
+      return m_buckets[i];
+    }
+
+   private:
+    const size_t m_mask;
+    std::unique_ptr<std::atomic<value_type*>[]> m_buckets;
+  };
+
+  struct Slot {
+    mutable boost::mutex lock;
+    std::atomic<Table*> table{nullptr};
+    // Guarded by `lock`.
+    size_t size{0};
+    // Live entries plus tombstones; guarded by `lock`.
+    size_t used{0};
+    // The current table and all the retired ones.
+    std::vector<std::unique_ptr<Table>> tables;
+    std::vector<std::unique_ptr<value_type>> retired;
+
+    Slot() = default;
+
+    Slot(Slot&& other) noexcept { *this = std::move(other); }
+
+    Slot& operator=(Slot&& other) noexcept {
+      clear();
+      table.store(other.table.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+      other.table.store(nullptr, std::memory_order_relaxed);
+      size = other.size;
+      used = other.used;
+      other.size = other.used = 0;
+      tables = std::move(other.tables);
+      retired = std::move(other.retired);
+      return *this;
+    }
+
+    ~Slot() { clear(); }
+
+    void clear() {
+      Table* t = table.load(std::memory_order_relaxed);
+      if (t != nullptr) {
+        for (size_t i = 0; i < t->capacity(); ++i) {
+          value_type* entry = (*t)[i].load(std::memory_order_relaxed);
+          if (is_live(entry)) {
+            delete entry;
+          }
+        }
+      }
+      table.store(nullptr, std::memory_order_relaxed);
+      tables.clear();
+      retired.clear();
+      size = used = 0;
+    }
+  };
+
+ public:
+  using iterator = cc_impl::ReadOptimizedIterator<Slot, value_type, n_slots>;
+
+  using const_iterator =
+      cc_impl::ReadOptimizedIterator<const Slot, const value_type, n_slots>;
+
+  ReadOptimizedConcurrentMap() = default;
+
+  ReadOptimizedConcurrentMap(const ReadOptimizedConcurrentMap& other) {
+    for (const auto& entry : other) {
+      insert(entry);
+    }
+  }
+
+  ReadOptimizedConcurrentMap(ReadOptimizedConcurrentMap&& other) noexcept {
+    for (size_t i = 0; i < n_slots; ++i) {
+      m_slots[i] = std::move(other.m_slots[i]);
+    }
+  }
+
+  template <typename InputIt>
+  ReadOptimizedConcurrentMap(InputIt first, InputIt last) {
+    insert(first, last);
+  }
+
+  /*
+   * Using iterators while the container is concurrently modified will result
+   * in undefined behavior.
+   */
+
+  iterator begin() { return iterator(m_slots, 0, 0); }
+
+  iterator end() { return iterator(m_slots); }
+
+  const_iterator begin() const { return const_iterator(m_slots, 0, 0); }
+
+  const_iterator end() const { return const_iterator(m_slots); }
+
+  const_iterator cbegin() const { return begin(); }
+
+  const_iterator cend() const { return end(); }
+
+  /*
+   * This operation is always thread-safe. The returned iterator must not be
+   * advanced while the map is concurrently modified.
+   */
+  iterator find(const Key& key) {
+    size_t hash = Hash()(key);
+    size_t slot = hash % n_slots;
+    size_t bucket;
+    if (find_entry(m_slots[slot], key, hash, &bucket) == nullptr) {
+      return end();
+    }
+    return iterator(m_slots, slot, bucket);
+  }
+
+  const_iterator find(const Key& key) const {
+    size_t hash = Hash()(key);
+    size_t slot = hash % n_slots;
+    size_t bucket;
+    if (find_entry(m_slots[slot], key, hash, &bucket) == nullptr) {
+      return end();
+    }
+    return const_iterator(m_slots, slot, bucket);
+  }
+
+  size_t size() const {
+    size_t s = 0;
+    for (size_t slot = 0; slot < n_slots; ++slot) {
+      s += m_slots[slot].size;
+    }
+    return s;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  void reserve(size_t capacity) {
+    size_t slot_capacity = capacity / n_slots;
+    if (slot_capacity > 0) {
+      for (size_t i = 0; i < n_slots; ++i) {
+        boost::lock_guard<boost::mutex> lock(m_slots[i].lock);
+        grow(m_slots[i], slot_capacity);
+      }
+    }
+  }
+
+  /*
+   * This operation is not thread-safe. It also reclaims all the memory held
+   * by retired entries and tables.
+   */
+  void clear() {
+    for (size_t slot = 0; slot < n_slots; ++slot) {
+      m_slots[slot].clear();
+    }
+  }
+
+  /*
+   * This operation is always thread-safe and lock-free.
+   */
+  size_t count(const Key& key) const {
+    size_t hash = Hash()(key);
+    return find_entry(m_slots[hash % n_slots], key, hash) != nullptr;
+  }
+
+  size_t count_unsafe(const Key& key) const { return count(key); }
+
+  /*
+   * This operation is always thread-safe and lock-free. As opposed to
+   * ConcurrentMap, the reference is not invalidated by concurrent insertions;
+   * but we still return a copy for drop-in compatibility.
+   */
+  Value at(const Key& key) const { return at_unsafe(key); }
+
+  const Value& at_unsafe(const Key& key) const {
+    size_t hash = Hash()(key);
+    const value_type* entry = find_entry(m_slots[hash % n_slots], key, hash);
+    if (entry == nullptr) {
+      throw std::out_of_range("ReadOptimizedConcurrentMap::at");
+    }
+    return entry->second;
+  }
+
+  Value& at_unsafe(const Key& key) {
+    return const_cast<Value&>(
+        static_cast<const ReadOptimizedConcurrentMap*>(this)->at_unsafe(key));
+  }
+
+  /*
+   * This operation is always thread-safe and lock-free.
+   */
+  Value get(const Key& key, Value default_value) const {
+    size_t hash = Hash()(key);
+    const value_type* entry = find_entry(m_slots[hash % n_slots], key, hash);
+    if (entry == nullptr) {
+      return default_value;
+    }
+    return entry->second;
+  }
+
+  /*
+   * The Boolean return value denotes whether the insertion took place.
+   * This operation is always thread-safe.
+   */
+  bool insert(const std::pair<Key, Value>& entry) {
+    size_t hash = Hash()(entry.first);
+    Slot& slot = m_slots[hash % n_slots];
+    boost::lock_guard<boost::mutex> lock(slot.lock);
+    if (find_entry(slot, entry.first, hash) != nullptr) {
+      return false;
+    }
+    add_entry(slot, hash, std::make_unique<value_type>(entry));
+    return true;
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  void insert(std::initializer_list<std::pair<Key, Value>> l) {
+    for (const auto& entry : l) {
+      insert(entry);
+    }
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  template <typename InputIt>
+  void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  void insert_or_assign(const std::pair<Key, Value>& entry) {
+    size_t hash = Hash()(entry.first);
+    Slot& slot = m_slots[hash % n_slots];
+    boost::lock_guard<boost::mutex> lock(slot.lock);
+    size_t bucket;
+    if (find_entry(slot, entry.first, hash, &bucket) != nullptr) {
+      replace_entry(slot, bucket, std::make_unique<value_type>(entry));
+    } else {
+      add_entry(slot, hash, std::make_unique<value_type>(entry));
+    }
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  template <typename... Args>
+  bool emplace(Args&&... args) {
+    auto entry = std::make_unique<value_type>(std::forward<Args>(args)...);
+    size_t hash = Hash()(entry->first);
+    Slot& slot = m_slots[hash % n_slots];
+    boost::lock_guard<boost::mutex> lock(slot.lock);
+    if (find_entry(slot, entry->first, hash) != nullptr) {
+      return false;
+    }
+    add_entry(slot, hash, std::move(entry));
+    return true;
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  size_t erase(const Key& key) {
+    size_t hash = Hash()(key);
+    Slot& slot = m_slots[hash % n_slots];
+    boost::lock_guard<boost::mutex> lock(slot.lock);
+    size_t bucket;
+    value_type* entry = find_entry(slot, key, hash, &bucket);
+    if (entry == nullptr) {
+      return 0;
+    }
+    slot.table.load(std::memory_order_relaxed)
+        ->operator[](bucket)
+        .store(tombstone(), std::memory_order_release);
+    slot.retired.emplace_back(entry);
+    --slot.size;
+    return 1;
+  }
+
+  /*
+   * This operation atomically modifies an entry in the map. If the entry
+   * doesn't exist, it is created. The third argument of the updater function is
+   * a Boolean flag denoting whether the entry exists or not.
+   *
+   * The updater operates on a copy of the entry, which then replaces the
+   * original one, so that concurrent readers never observe a partial update.
+   */
+  template <
+      typename UpdateFn = const std::function<void(const Key&, Value&, bool)>&>
+  void update(const Key& key, UpdateFn updater) {
+    size_t hash = Hash()(key);
+    Slot& slot = m_slots[hash % n_slots];
+    boost::lock_guard<boost::mutex> lock(slot.lock);
+    size_t bucket;
+    value_type* entry = find_entry(slot, key, hash, &bucket);
+    if (entry == nullptr) {
+      auto fresh = std::make_unique<value_type>(key, Value());
+      updater(fresh->first, fresh->second, false);
+      add_entry(slot, hash, std::move(fresh));
+    } else {
+      auto copy = std::make_unique<value_type>(*entry);
+      updater(copy->first, copy->second, true);
+      replace_entry(slot, bucket, std::move(copy));
+    }
+  }
+
+  /*
+   * This operation modifies the entry in place and must not run concurrently
+   * with any other operation on the map.
+   */
+  template <
+      typename UpdateFn = const std::function<void(const Key&, Value&, bool)>&>
+  void update_unsafe(const Key& key, UpdateFn updater) {
+    size_t hash = Hash()(key);
+    Slot& slot = m_slots[hash % n_slots];
+    value_type* entry = find_entry(slot, key, hash);
+    if (entry == nullptr) {
+      auto fresh = std::make_unique<value_type>(key, Value());
+      updater(fresh->first, fresh->second, false);
+      add_entry(slot, hash, std::move(fresh));
+    } else {
+      updater(entry->first, entry->second, true);
+    }
+  }
+
+ private:
+  static value_type* tombstone() {
+    return reinterpret_cast<value_type*>(cc_impl::kReadOptimizedTombstone);
+  }
+
+  static bool is_live(const value_type* entry) {
+    return entry != nullptr && entry != tombstone();
+  }
+
+  // The low bits of the hash code select the slot; scramble the code so that
+  // identity hashes (e.g. on pointers) still spread across buckets.
+  static size_t bucket_of(size_t hash, size_t mask) {
+    uint64_t h = hash;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h) & mask;
+  }
+
+  value_type* find_entry(const Slot& slot,
+                         const Key& key,
+                         size_t hash,
+                         size_t* bucket_out = nullptr) const {
+    Table* table = slot.table.load(std::memory_order_acquire);
+    if (table == nullptr) {
+      return nullptr;
+    }
+    size_t mask = table->mask();
+    for (size_t i = bucket_of(hash, mask), probes = 0; probes <= mask;
+         i = (i + 1) & mask, ++probes) {
+      value_type* entry = (*table)[i].load(std::memory_order_acquire);
+      if (entry == nullptr) {
+        return nullptr;
+      }
+      if (entry != tombstone() && Equal()(entry->first, key)) {
+        if (bucket_out != nullptr) {
+          *bucket_out = i;
+        }
+        return entry;
+      }
+    }
+    return nullptr;
+  }
+
+  // Requires the slot lock.
+  void replace_entry(Slot& slot,
+                     size_t bucket,
+                     std::unique_ptr<value_type> entry) {
+    auto& cell = (*slot.table.load(std::memory_order_relaxed))[bucket];
+    slot.retired.emplace_back(cell.load(std::memory_order_relaxed));
+    cell.store(entry.release(), std::memory_order_release);
+  }
+
+  // Requires the slot lock, and the key must not be in the slot yet.
+  void add_entry(Slot& slot, size_t hash, std::unique_ptr<value_type> entry) {
+    Table* table = slot.table.load(std::memory_order_relaxed);
+    // Keep the load factor, tombstones included, below 3/4.
+    if (table == nullptr || (slot.used + 1) * 4 > table->capacity() * 3) {
+      table = grow(slot, slot.size + 1);
+    }
+    size_t mask = table->mask();
+    size_t i = bucket_of(hash, mask);
+    while (true) {
+      value_type* current = (*table)[i].load(std::memory_order_relaxed);
+      if (current == nullptr || current == tombstone()) {
+        if (current == nullptr) {
+          ++slot.used;
+        }
+        break;
+      }
+      i = (i + 1) & mask;
+    }
+    (*table)[i].store(entry.release(), std::memory_order_release);
+    ++slot.size;
+  }
+
+  // Requires the slot lock. Rehashes the slot into a table that holds at least
+  // `min_size` entries, dropping all tombstones. The old table is retired.
+  Table* grow(Slot& slot, size_t min_size) {
+    Table* old_table = slot.table.load(std::memory_order_relaxed);
+    size_t capacity = 16;
+    while (capacity * 3 < std::max(min_size, slot.size) * 8) {
+      // Aim for a load factor of at most 3/8 right after growing.
+      capacity *= 2;
+    }
+    if (old_table != nullptr && capacity < old_table->capacity()) {
+      capacity = old_table->capacity();
+    }
+    auto table = std::make_unique<Table>(capacity);
+    size_t mask = table->mask();
+    if (old_table != nullptr) {
+      for (size_t b = 0; b < old_table->capacity(); ++b) {
+        value_type* entry = (*old_table)[b].load(std::memory_order_relaxed);
+        if (!is_live(entry)) {
+          continue;
+        }
+        size_t i = bucket_of(Hash()(entry->first), mask);
+        while ((*table)[i].load(std::memory_order_relaxed) != nullptr) {
+          i = (i + 1) & mask;
+        }
+        (*table)[i].store(entry, std::memory_order_relaxed);
+      }
+    }
+    slot.used = slot.size;
+    Table* raw = table.get();
+    slot.tables.emplace_back(std::move(table));
+    slot.table.store(raw, std::memory_order_release);
+    return raw;
+  }
+
+  Slot m_slots[n_slots];
+
+  template <typename, typename, size_t>
+  friend class cc_impl::ReadOptimizedIterator;
+};
+
 namespace cc_impl {
 
 template <typename Container, size_t n_slots>
@@ -621,4 +1123,81 @@ class ConcurrentContainerIterator final {
   base_iterator m_position;
 };
 
+template <typename Slot, typename ValueType, size_t n_slots>
+class ReadOptimizedIterator final {
+ public:
+  using difference_type = std::ptrdiff_t;
+  using value_type = ValueType;
+  using pointer = ValueType*;
+  using reference = ValueType&;
+  using iterator_category = std::forward_iterator_tag;
+
+  explicit ReadOptimizedIterator(Slot* slots)
+      : m_slots(slots), m_slot(n_slots), m_bucket(0) {}
+
+  ReadOptimizedIterator(Slot* slots, size_t slot, size_t bucket)
+      : m_slots(slots), m_slot(slot), m_bucket(bucket) {
+    skip_empty_buckets();
+  }
+
+  ReadOptimizedIterator& operator++() {
+    always_assert(m_slot < n_slots);
+    ++m_bucket;
+    skip_empty_buckets();
+    return *this;
+  }
+
+  ReadOptimizedIterator operator++(int) {
+    ReadOptimizedIterator retval = *this;
+    ++(*this);
+    return retval;
+  }
+
+  bool operator==(const ReadOptimizedIterator& other) const {
+    return m_slots == other.m_slots && m_slot == other.m_slot &&
+           m_bucket == other.m_bucket;
+  }
+
+  bool operator!=(const ReadOptimizedIterator& other) const {
+    return !(*this == other);
+  }
+
+  reference operator*() const {
+    always_assert(m_slot < n_slots);
+    return *entry();
+  }
+
+  pointer operator->() const {
+    always_assert(m_slot < n_slots);
+    return entry();
+  }
+
+ private:
+  pointer entry() const {
+    auto* table = m_slots[m_slot].table.load(std::memory_order_acquire);
+    return (*table)[m_bucket].load(std::memory_order_acquire);
+  }
+
+  void skip_empty_buckets() {
+    for (; m_slot < n_slots; ++m_slot, m_bucket = 0) {
+      auto* table = m_slots[m_slot].table.load(std::memory_order_acquire);
+      if (table == nullptr) {
+        continue;
+      }
+      for (; m_bucket < table->capacity(); ++m_bucket) {
+        auto* e = (*table)[m_bucket].load(std::memory_order_acquire);
+        if (e != nullptr &&
+            reinterpret_cast<uintptr_t>(e) != kReadOptimizedTombstone) {
+          return;
+        }
+      }
+    }
+    m_bucket = 0;
+  }
+
+  Slot* m_slots;
+  size_t m_slot;
+  size_t m_bucket;
+};
+
 } // namespace cc_impl
@@ -20,13 +20,37 @@
 #include "MethodProfiles.h"
 #include "ProguardMap.h"
 
+namespace {
+
+std::shared_future<std::unique_ptr<ProguardMap>> parse_proguard_map_async(
+    const Json::Value& config) {
+  auto filename = config.get("proguard_map", "").asString();
+  auto use_new_rename_map = config.get("use_new_rename_map", 0).asBool();
+  // Without a map there is nothing to overlap, so don't spawn a thread.
+  auto policy = filename.empty() ? std::launch::deferred : std::launch::async;
+  return std::async(policy, [filename, use_new_rename_map]() {
+    return std::make_unique<ProguardMap>(filename, use_new_rename_map);
+  });
+}
+
+} // namespace
+
 ConfigFiles::ConfigFiles(const Json::Value& config, const std::string& outdir)
+    : ConfigFiles(config, outdir, parse_proguard_map_async(config)) {}
+
+ConfigFiles::ConfigFiles(const ConfigFiles& parent,
+                         const Json::Value& config,
+                         const std::string& outdir)
+    : ConfigFiles(config, outdir, parent.m_proguard_map) {}
+
+ConfigFiles::ConfigFiles(
+    const Json::Value& config,
+    const std::string& outdir,
+    std::shared_future<std::unique_ptr<ProguardMap>> proguard_map)
     : m_json(config),
       outdir(outdir),
       m_global_config(GlobalConfig::default_registry()),
-      m_proguard_map(
-          new ProguardMap(config.get("proguard_map", "").asString(),
-                          config.get("use_new_rename_map", 0).asBool())),
+      m_proguard_map(std::move(proguard_map)),
       m_printseeds(config.get("printseeds", "").asString()),
       m_method_profiles(new method_profiles::MethodProfiles()) {
 
@@ -155,7 +179,7 @@ std::vector<std::string> ConfigFiles::load_coldstart_classes() {
                       clzname.c_str(), file);
     clzname.replace(position, lentail, ";");
     coldstart_classes.emplace_back(
-        m_proguard_map->translate_class("L" + clzname));
+        get_proguard_map().translate_class("L" + clzname));
   }
   return coldstart_classes;
 }
@@ -213,7 +237,7 @@ const std::vector<std::string>& ConfigFiles::get_dead_class_list() {
       while (input >> classname) {
         std::string converted = std::string("L") + classname + std::string(";");
         std::replace(converted.begin(), converted.end(), '.', '/');
-        auto translated = m_proguard_map->translate_class(converted);
+        auto translated = get_proguard_map().translate_class(converted);
         m_dead_class_list.push_back(std::move(translated));
       }
     }
@@ -255,6 +279,8 @@ void ConfigFiles::load_inliner_config(inliner::InlinerConfig* inliner_config) {
          inliner_config->use_call_site_summaries);
   jw.get("intermediate_shrinking", false,
          inliner_config->intermediate_shrinking);
+  jw.get("fast_intermediate_shrinking", false,
+         inliner_config->fast_intermediate_shrinking);
   jw.get("multiple_callers", false, inliner_config->multiple_callers);
   auto& shrinker_config = inliner_config->shrinker;
   jw.get("run_const_prop", false, shrinker_config.run_const_prop);
@@ -334,7 +360,7 @@ const api::AndroidSDK& ConfigFiles::get_android_sdk_api(int32_t min_sdk_api) {
 }
 
 const ProguardMap& ConfigFiles::get_proguard_map() const {
-  return *m_proguard_map;
+  return *m_proguard_map.get();
 }
 
 bool ConfigFiles::force_single_dex() const {
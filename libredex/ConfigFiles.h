@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <future>
 #include <map>
 #include <memory>
 #include <string>
@@ -43,6 +44,14 @@ class MethodProfiles;
 struct ConfigFiles {
   explicit ConfigFiles(const Json::Value& config);
   ConfigFiles(const Json::Value& config, const std::string& outdir);
+  /**
+   * The config of a variant of the build whose input `parent` loaded. The
+   * input was deobfuscated with the ProGuard map of the parent, so the variant
+   * shares it instead of parsing its own.
+   */
+  ConfigFiles(const ConfigFiles& parent,
+              const Json::Value& config,
+              const std::string& outdir);
   ~ConfigFiles();
 
   const std::vector<std::string>& get_coldstart_classes() {
@@ -162,13 +171,19 @@ struct ConfigFiles {
   std::string outdir;
   GlobalConfig m_global_config;
 
+  ConfigFiles(const Json::Value& config,
+              const std::string& outdir,
+              std::shared_future<std::unique_ptr<ProguardMap>> proguard_map);
+
   std::vector<std::string> load_coldstart_classes();
   std::unordered_map<std::string, std::vector<std::string>> load_class_lists();
   void ensure_agg_method_stats_loaded();
   void load_inliner_config(inliner::InlinerConfig*);
 
   bool m_load_class_lists_attempted{false};
-  std::unique_ptr<ProguardMap> m_proguard_map;
+  // The ProGuard map is parsed in the background from construction on, in
+  // parallel with dex loading, until get_proguard_map() waits for it.
+  std::shared_future<std::unique_ptr<ProguardMap>> m_proguard_map;
   std::string m_coldstart_class_filename;
   std::vector<std::string> m_coldstart_classes;
   std::unordered_map<std::string, std::vector<std::string>> m_class_lists;
@@ -660,6 +660,8 @@ ControlFlowGraph::ControlFlowGraph(IRList* ir,
   }
 
   TRACE_NO_LINE(CFG, 5, "editable %d, %s", m_editable, SHOW(*this));
+  // Building the graph doesn't count.
+  m_mutations = 0;
 }
 
 void ControlFlowGraph::find_block_boundaries(IRList* ir,
@@ -669,6 +671,9 @@ void ControlFlowGraph::find_block_boundaries(IRList* ir,
   // create the entry block
   auto* block = create_block();
   IRList::iterator block_begin;
+  // The number of entries from `block_begin` to `it`, inclusive, so that moving
+  // them into the block does not walk them again.
+  size_t block_size = 0;
   if (m_editable) {
     block_begin = ir->begin();
   } else {
@@ -682,6 +687,7 @@ void ControlFlowGraph::find_block_boundaries(IRList* ir,
   DexPosition* last_pos_before_this_block = nullptr;
   for (auto it = ir->begin(); it != ir->end(); it = next) {
     next = std::next(it);
+    ++block_size;
     if (it->type == MFLOW_TRY) {
       if (it->tentry->type == TRY_START) {
         // Assumption: TRY_STARTs are only at the beginning of blocks
@@ -710,7 +716,7 @@ void ControlFlowGraph::find_block_boundaries(IRList* ir,
       // This is safe to do while iterating in ir because iterators in ir now
       // point to elements of block->m_entries (and we already computed next).
       block->m_entries.splice_selection(block->m_entries.end(), *ir,
-                                        block_begin, next);
+                                        block_begin, next, block_size);
       if (last_pos_before_this_block != nullptr) {
         auto first_insn = block->get_first_insn_before_position();
         if (first_insn != block->end()) {
@@ -740,6 +746,7 @@ void ControlFlowGraph::find_block_boundaries(IRList* ir,
     if (m_editable) {
       last_pos_before_this_block = current_position;
       block_begin = next;
+      block_size = 0;
     } else {
       block->m_begin = next;
     }
@@ -993,8 +1000,8 @@ std::pair<uint32_t, bool> ControlFlowGraph::remove_unreachable_blocks() {
       // Deletion of a block deletes MIEs, but MIEs do not delete instructions.
       // Gotta do this manually for now.
       b->free();
-      delete b;
       it = m_blocks.erase(it);
+      free_block(b);
     } else {
       ++it;
     }
@@ -1162,8 +1169,8 @@ void ControlFlowGraph::remove_empty_blocks() {
       }
     }
     b->free();
-    delete b;
     it = m_blocks.erase(it);
+    free_block(b);
   }
   fix_dangling_parents(std::move(dangling));
 }
@@ -1337,6 +1344,7 @@ reg_t ControlFlowGraph::compute_registers_size() const {
 }
 
 void ControlFlowGraph::recompute_registers_size() {
+  m_mutations++;
   m_registers_size = compute_registers_size();
 }
 
@@ -1568,10 +1576,12 @@ void ControlFlowGraph::deep_copy(ControlFlowGraph* new_cfg) const {
   std::unordered_map<const Edge*, Edge*> old_edge_to_new;
   size_t num_edges = this->m_edges.size();
   new_cfg->m_edges.reserve(num_edges);
+  new_cfg->m_edge_pool.reserve(num_edges);
+  new_cfg->m_block_pool.reserve(this->m_blocks.size());
   old_edge_to_new.reserve(num_edges);
   for (const Edge* old_edge : this->m_edges) {
     // this shallowly copies block pointers inside, then we patch them later
-    Edge* new_edge = new Edge(*old_edge);
+    Edge* new_edge = new_cfg->create_edge(*old_edge);
     new_cfg->m_edges.insert(new_edge);
     old_edge_to_new.emplace(old_edge, new_edge);
   }
@@ -1581,7 +1591,8 @@ void ControlFlowGraph::deep_copy(ControlFlowGraph* new_cfg) const {
   for (const auto& entry : this->m_blocks) {
     const Block* block = entry.second;
     // this shallowly copies edge pointers inside, then we patch them later
-    Block* new_block = new Block(*block, &cloner);
+    Block* new_block =
+        new (new_cfg->m_block_pool.allocate()) Block(*block, &cloner);
     new_block->m_parent = new_cfg;
     new_cfg->m_blocks.emplace(new_block->id(), new_block);
   }
@@ -2099,8 +2110,9 @@ ControlFlowGraph::~ControlFlowGraph() {
 }
 
 Block* ControlFlowGraph::create_block() {
+  m_mutations++;
   size_t id = next_block_id();
-  Block* b = new Block(this, id);
+  Block* b = new (m_block_pool.allocate()) Block(this, id);
   m_blocks.emplace(id, b);
   return b;
 }
@@ -2292,17 +2304,17 @@ void ControlFlowGraph::free_all_blocks_and_edges_and_removed_insns() {
     for (const auto& entry : m_blocks) {
       Block* b = entry.second;
       b->free();
-      delete b;
+      free_block(b);
     }
   } else {
     for (const auto& entry : m_blocks) {
-      Block* b = entry.second;
-      delete b;
+      free_block(entry.second);
     }
   }
 
   for (Edge* e : m_edges) {
-    delete e;
+    e->~Edge();
+    m_edge_pool.deallocate(e);
   }
 
   if (m_owns_removed_insns) {
@@ -2366,8 +2378,10 @@ void ControlFlowGraph::cleanup_deleted_edges(const EdgeSet& edges) {
 }
 
 void ControlFlowGraph::free_edge(Edge* edge) {
+  m_mutations++;
   m_edges.erase(edge);
-  delete edge;
+  edge->~Edge();
+  m_edge_pool.deallocate(edge);
 }
 
 void ControlFlowGraph::free_edges(const EdgeSet& edges) {
@@ -2462,7 +2476,7 @@ Block* ControlFlowGraph::split_block_before(Block* old_block,
     if (e->type() != EDGE_THROW) {
       continue;
     }
-    auto new_edge = new Edge(*e);
+    auto new_edge = create_edge(*e);
     new_edge->set_src(new_block);
     add_edge(new_edge);
   }
@@ -2479,6 +2493,7 @@ Block* ControlFlowGraph::split_block_before(
 }
 
 void ControlFlowGraph::merge_blocks(Block* pred, Block* succ) {
+  m_mutations++;
   const auto& not_throws = [](const Edge* e) {
     return e->type() != EDGE_THROW;
   };
@@ -2510,7 +2525,7 @@ void ControlFlowGraph::merge_blocks(Block* pred, Block* succ) {
   delete_pred_edges(succ);
   delete_succ_edges(succ);
   m_blocks.erase(succ->id());
-  delete succ;
+  free_block(succ);
 }
 
 void ControlFlowGraph::set_edge_target(Edge* edge, Block* new_target) {
@@ -2528,6 +2543,7 @@ void ControlFlowGraph::move_edge(Edge* edge,
                                  Block* new_target) {
   // remove this edge from the graph temporarily but do not delete it because
   // we're going to move it elsewhere
+  m_mutations++;
   remove_edge(edge, /* cleanup */ false);
 
   if (new_source != nullptr) {
@@ -2572,6 +2588,7 @@ bool ControlFlowGraph::replace_insn(const InstructionIterator& it,
 
 void ControlFlowGraph::remove_insn(const InstructionIterator& it) {
   always_assert(m_editable);
+  m_mutations++;
 
   MethodItemEntry& mie = *it;
   auto insn = mie.insn;
@@ -2771,7 +2788,7 @@ void ControlFlowGraph::copy_succ_edges_if(Block* from,
   const auto& edges = get_succ_edges_if(from, std::move(edge_predicate));
 
   for (auto e : edges) {
-    Edge* copy = new Edge(*e);
+    Edge* copy = create_edge(*e);
     copy->set_src(to);
     add_edge(copy);
   }
@@ -2816,6 +2833,7 @@ bool ControlFlowGraph::push_back(Block* b, IRInstruction* insn) {
 }
 
 uint32_t ControlFlowGraph::remove_blocks(const std::vector<Block*>& blocks) {
+  m_mutations++;
   std::vector<std::unique_ptr<DexPosition>> dangling;
   uint32_t insns_removed = 0;
 
@@ -2844,7 +2862,7 @@ uint32_t ControlFlowGraph::remove_blocks(const std::vector<Block*>& blocks) {
     always_assert_log(num_removed == 1,
                       "Block %zu wasn't in CFG. Attempted double delete?", id);
     block->m_entries.clear_and_dispose();
-    delete block;
+    free_block(block);
   }
 
   fix_dangling_parents(std::move(dangling));
@@ -17,6 +17,7 @@
 
 #include "DexPosition.h"
 #include "IRCode.h"
+#include "ObjectPool.h"
 #include "SingletonIterable.h"
 #include "WeakTopologicalOrdering.h"
 
@@ -401,6 +402,7 @@ class Block final {
  private:
   friend class ControlFlowGraph;
   friend class CFGInliner;
+  friend class CFGMutation;
   friend class InstructionIteratorImpl<false>;
   friend class InstructionIteratorImpl<true>;
   friend struct ::source_blocks::impl::BlockAccessor;
@@ -521,16 +523,13 @@ class ControlFlowGraph {
    */
   void calculate_exit_block();
 
-  // args are arguments to an Edge constructor
+  // args are arguments to an Edge constructor, e.g. an edge to copy. Returns
+  // the new edge, which is owned by the graph.
   template <class... Args>
-  void add_edge(Args&&... args) {
-    add_edge(new Edge(std::forward<Args>(args)...));
-  }
-
-  void add_edge(Edge* e) {
-    m_edges.insert(e);
-    e->src()->m_succs.emplace_back(e);
-    e->target()->m_preds.emplace_back(e);
+  Edge* add_edge(Args&&... args) {
+    Edge* e = create_edge(std::forward<Args>(args)...);
+    add_edge(e);
+    return e;
   }
 
   // copies all edges from one block to another
@@ -858,6 +857,10 @@ class ControlFlowGraph {
   // Do writes to this CFG propagate back to IR and Dex code?
   bool editable() const { return m_editable; }
 
+  // The number of edits made through this CFG's API since it was built. Edits
+  // of instructions in place, e.g. of their operands, are not counted.
+  size_t mutations() const { return m_mutations; }
+
   size_t num_blocks() const { return m_blocks.size(); }
   size_t num_edges() const { return m_edges.size(); }
 
@@ -891,9 +894,13 @@ class ControlFlowGraph {
 
   uint32_t sum_opcode_sizes() const;
 
-  reg_t allocate_temp() { return m_registers_size++; }
+  reg_t allocate_temp() {
+    m_mutations++;
+    return m_registers_size++;
+  }
 
   reg_t allocate_wide_temp() {
+    m_mutations++;
     reg_t new_reg = m_registers_size;
     m_registers_size += 2;
     return new_reg;
@@ -901,7 +908,10 @@ class ControlFlowGraph {
 
   reg_t get_registers_size() const { return m_registers_size; }
 
-  void set_registers_size(reg_t sz) { m_registers_size = sz; }
+  void set_registers_size(reg_t sz) {
+    m_mutations++;
+    m_registers_size = sz;
+  }
 
   // Find the highest register in use and set m_registers_size
   //
@@ -994,6 +1004,7 @@ class ControlFlowGraph {
   friend class InstructionIteratorImpl<false>;
   friend class InstructionIteratorImpl<true>;
   friend class CFGInliner;
+  friend class CFGMutation;
 
   // Find block boundaries in IRCode and create the blocks
   // For use by the constructor. You probably don't want to call this from
@@ -1204,6 +1215,26 @@ class ControlFlowGraph {
     return to_remove;
   }
 
+  // Allocates an edge in this graph without adding it.
+  template <class... Args>
+  Edge* create_edge(Args&&... args) {
+    return new (m_edge_pool.allocate()) Edge(std::forward<Args>(args)...);
+  }
+
+  // Adds an edge that was allocated with `create_edge`.
+  void add_edge(Edge* e) {
+    m_mutations++;
+    m_edges.insert(e);
+    e->src()->m_succs.emplace_back(e);
+    e->target()->m_preds.emplace_back(e);
+  }
+
+  // Does not remove the block from `m_blocks`, nor free its instructions.
+  void free_block(Block* block) {
+    block->~Block();
+    m_block_pool.deallocate(block);
+  }
+
   // Assumes the edge is already removed.
   void free_edge(Edge* edge);
 
@@ -1236,11 +1267,14 @@ class ControlFlowGraph {
   // The memory of all blocks and edges in this graph are owned here
   Blocks m_blocks;
   EdgeSet m_edges;
+  ObjectPool<Block> m_block_pool;
+  ObjectPool<Edge> m_edge_pool;
 
   IRList* m_orig_list{nullptr}; // Only set when !m_editable.
   Block* m_entry_block{nullptr};
   Block* m_exit_block{nullptr};
   reg_t m_registers_size{0};
+  size_t m_mutations{0};
   bool m_editable{true};
   bool m_owns_insns{false};
   bool m_owns_removed_insns{true};
@@ -1506,6 +1540,7 @@ bool ControlFlowGraph::insert(const InstructionIterator& position,
   IRList::iterator pos =
       before ? position.unwrap() : std::next(position.unwrap());
 
+  m_mutations++;
   bool invalidated_its = false;
   for (auto insns_it = begin_index; insns_it != end_index; insns_it++) {
     // Coercing everything to a variant allows us to handle the complicated
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/*
+ * A map from DexTypes, DexFieldRefs or DexMethodRefs to values of type T,
+ * stored in flat arrays indexed by the dense ids of the keys, instead of in a
+ * hash table keyed by pointers.
+ *
+ * Every key is mapped: values start out value-initialized. The arrays are
+ * segments of doubling sizes, which are allocated when a key in them is first
+ * accessed through operator[]. Allocating a segment is thread-safe and never
+ * moves existing values, so references to values stay valid. Accesses to the
+ * same value from several threads must be synchronized by the caller, e.g. by
+ * making T an atomic.
+ *
+ * As ids are dense over the whole RedexContext, this fits side tables about
+ * most of the references, e.g. the methods of the scope. For tables about a
+ * few of them, a hash map takes less memory.
+ */
+template <typename Key, typename T>
+class DenseMap final {
+ public:
+  DenseMap() = default;
+  DenseMap(const DenseMap&) = delete;
+  DenseMap& operator=(const DenseMap&) = delete;
+
+  ~DenseMap() {
+    for (auto& segment : m_segments) {
+      delete[] segment.load();
+    }
+  }
+
+  T& operator[](const Key* key) {
+    auto [segment, offset] = locate(key->get_id());
+    auto* values = m_segments[segment].load(std::memory_order_acquire);
+    if (values == nullptr) {
+      values = allocate(segment);
+    }
+    return values[offset];
+  }
+
+  // Returns nullptr if the value of the key was never accessed through
+  // operator[], in which case it is value-initialized.
+  const T* find(const Key* key) const {
+    auto [segment, offset] = locate(key->get_id());
+    auto* values = m_segments[segment].load(std::memory_order_acquire);
+    return values == nullptr ? nullptr : values + offset;
+  }
+
+ private:
+  // The first segment holds 2^kFirstSegmentBits values, and each one after it
+  // twice as many as the one before.
+  static constexpr size_t kFirstSegmentBits = 10;
+  static constexpr size_t kNumSegments = 33 - kFirstSegmentBits;
+
+  static size_t segment_size(size_t segment) {
+    return size_t(1) << (kFirstSegmentBits + segment);
+  }
+
+  static std::pair<size_t, size_t> locate(uint32_t id) {
+    uint64_t n = (uint64_t(id) >> kFirstSegmentBits) + 1;
+    size_t segment = 63 - __builtin_clzll(n);
+    size_t first = ((uint64_t(1) << segment) - 1) << kFirstSegmentBits;
+    return {segment, id - first};
+  }
+
+  T* allocate(size_t segment) {
+    auto* values = new T[segment_size(segment)]();
+    T* expected = nullptr;
+    if (!m_segments[segment].compare_exchange_strong(
+            expected, values, std::memory_order_acq_rel)) {
+      delete[] values;
+      return expected;
+    }
+    return values;
+  }
+
+  std::array<std::atomic<T*>, kNumSegments> m_segments{};
+};
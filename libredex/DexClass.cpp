@@ -27,6 +27,7 @@
 #include "Util.h"
 #include "Walkers.h"
 #include "Warning.h"
+#include "WorkQueue.h"
 
 #include <algorithm>
 #include <boost/functional/hash.hpp>
@@ -351,6 +352,26 @@ static std::vector<DexDebugEntry> eval_debug_instructions(
   std::vector<DexDebugEntry> entries;
   uint32_t pc = 0;
   while (true) {
+    // Most of the opcodes only move the position, and are decoded in place
+    // instead of being materialized as instructions that are dropped at once.
+    auto& encdata = *encdata_ptr;
+    uint8_t raw_op = *encdata;
+    if (raw_op >= DBG_FIRST_SPECIAL) {
+      encdata++;
+      uint8_t adjustment = raw_op - DBG_FIRST_SPECIAL;
+      absolute_line += DBG_LINE_BASE + (adjustment % DBG_LINE_RANGE);
+      pc += adjustment / DBG_LINE_RANGE;
+      entries.emplace_back(pc, std::make_unique<DexPosition>(absolute_line));
+      continue;
+    } else if (raw_op == DBG_ADVANCE_LINE) {
+      encdata++;
+      absolute_line += read_sleb128(&encdata);
+      continue;
+    } else if (raw_op == DBG_ADVANCE_PC) {
+      encdata++;
+      pc += read_uleb128(&encdata);
+      continue;
+    }
     std::unique_ptr<DexDebugInstruction> opcode(
         DexDebugInstruction::make_instruction(idx, encdata_ptr));
     if (opcode == nullptr) {
@@ -358,10 +379,6 @@ static std::vector<DexDebugEntry> eval_debug_instructions(
     }
     auto op = opcode->opcode();
     switch (op) {
-    case DBG_ADVANCE_LINE: {
-      absolute_line += opcode->value();
-      continue;
-    }
     case DBG_END_LOCAL:
     case DBG_RESTART_LOCAL:
     case DBG_START_LOCAL:
@@ -373,25 +390,35 @@ static std::vector<DexDebugEntry> eval_debug_instructions(
       entries.emplace_back(pc, std::move(opcode));
       break;
     }
-    case DBG_ADVANCE_PC: {
-      pc += opcode->uvalue();
-      continue;
+    default:
+      not_reached_log("Unexpected debug opcode %d", op);
     }
-    default: {
-      uint8_t adjustment = op - DBG_FIRST_SPECIAL;
-      absolute_line += DBG_LINE_BASE + (adjustment % DBG_LINE_RANGE);
-      pc += adjustment / DBG_LINE_RANGE;
-      entries.emplace_back(pc, std::make_unique<DexPosition>(absolute_line));
+  }
+  return entries;
+}
+
+static void bind_entries(std::vector<DexDebugEntry>* entries,
+                         DexMethod* method,
+                         const DexString* file) {
+  auto* method_str = DexString::make_string(show(method));
+  for (auto& entry : *entries) {
+    switch (entry.type) {
+    case DexDebugEntryType::Position:
+      entry.pos->bind(method_str, file);
+      break;
+    case DexDebugEntryType::Instruction:
       break;
-    }
     }
   }
-  return entries;
 }
 
 DexDebugItem::DexDebugItem(DexIdx* idx, uint32_t offset)
     : m_source_checksum(idx->get_checksum()), m_source_offset(offset) {
-  const uint8_t* encdata = idx->get_uleb_data(offset);
+  decode(idx);
+}
+
+void DexDebugItem::decode(DexIdx* idx) {
+  const uint8_t* encdata = idx->get_uleb_data(m_source_offset);
   const uint8_t* base_encdata = encdata;
   uint32_t line_start = read_uleb128(&encdata);
   uint32_t paramcount = read_uleb128(&encdata);
@@ -406,7 +433,20 @@ DexDebugItem::DexDebugItem(DexIdx* idx, uint32_t offset)
   m_on_disk_size = encdata - base_encdata;
 }
 
+void DexDebugItem::decode_lazily() const {
+  // The entries are logically part of the value of a const DexDebugItem.
+  auto* self = const_cast<DexDebugItem*>(this);
+  std::call_once(m_lazy->decoded, [self] {
+    auto& lazy = *self->m_lazy;
+    self->decode(lazy.idx.get());
+    bind_entries(&self->m_dbg_entries, lazy.method, lazy.source_file);
+    // Don't hold on to the input dex any longer than needed.
+    lazy.idx.reset();
+  });
+}
+
 uint32_t DexDebugItem::get_line_start() const {
+  ensure_decoded();
   for (auto& entry : m_dbg_entries) {
     switch (entry.type) {
     case DexDebugEntryType::Position: {
@@ -420,6 +460,7 @@ uint32_t DexDebugItem::get_line_start() const {
 }
 
 DexDebugItem::DexDebugItem(const DexDebugItem& that) {
+  that.ensure_decoded();
   std::unordered_map<DexPosition*, DexPosition*> pos_map;
   m_dbg_entries.reserve(that.m_dbg_entries.size());
   for (auto& entry : that.m_dbg_entries) {
@@ -444,6 +485,22 @@ std::unique_ptr<DexDebugItem> DexDebugItem::get_dex_debug(DexIdx* idx,
   return std::unique_ptr<DexDebugItem>(new DexDebugItem(idx, offset));
 }
 
+std::unique_ptr<DexDebugItem> DexDebugItem::get_lazy_dex_debug(
+    std::shared_ptr<DexIdx> idx,
+    uint32_t offset,
+    DexMethod* method,
+    const DexString* source_file) {
+  if (offset == 0) return nullptr;
+  std::unique_ptr<DexDebugItem> dbg(new DexDebugItem());
+  dbg->m_source_checksum = idx->get_checksum();
+  dbg->m_source_offset = offset;
+  dbg->m_lazy = std::make_unique<LazyState>();
+  dbg->m_lazy->idx = std::move(idx);
+  dbg->m_lazy->method = method;
+  dbg->m_lazy->source_file = source_file;
+  return dbg;
+}
+
 /*
  * Convert DexDebugEntries into debug opcodes.
  */
@@ -546,19 +603,12 @@ int DexDebugItem::encode(
 }
 
 void DexDebugItem::bind_positions(DexMethod* method, const DexString* file) {
-  auto* method_str = DexString::make_string(show(method));
-  for (auto& entry : m_dbg_entries) {
-    switch (entry.type) {
-    case DexDebugEntryType::Position:
-      entry.pos->bind(method_str, file);
-      break;
-    case DexDebugEntryType::Instruction:
-      break;
-    }
-  }
+  ensure_decoded();
+  bind_entries(&m_dbg_entries, method, file);
 }
 
 void DexDebugItem::gather_types(std::vector<DexType*>& ltype) const {
+  ensure_decoded();
   for (auto& entry : m_dbg_entries) {
     entry.gather_types(ltype);
   }
@@ -566,6 +616,7 @@ void DexDebugItem::gather_types(std::vector<DexType*>& ltype) const {
 
 void DexDebugItem::gather_strings(
     std::vector<const DexString*>& lstring) const {
+  ensure_decoded();
   for (auto& entry : m_dbg_entries) {
     entry.gather_strings(lstring);
   }
@@ -574,10 +625,10 @@ void DexDebugItem::gather_strings(
 DexCode::DexCode(const DexCode& that)
     : m_registers_size(that.m_registers_size),
       m_ins_size(that.m_ins_size),
-      m_outs_size(that.m_outs_size),
-      m_insns(that.m_insns ? std::make_optional<std::vector<DexInstruction*>>()
-                           : std::nullopt) {
+      m_outs_size(that.m_outs_size) {
+  that.ensure_loaded();
   if (that.m_insns) {
+    m_insns.emplace();
     for (auto& insn : *that.m_insns) {
       m_insns->emplace_back(insn->clone());
     }
@@ -598,25 +649,30 @@ DexCode::~DexCode() {
   }
 }
 
-std::unique_ptr<DexCode> DexCode::get_dex_code(DexIdx* idx, uint32_t offset) {
-  if (offset == 0) return std::unique_ptr<DexCode>();
+std::unique_ptr<DexCode> DexCode::make_from_header(DexIdx* idx,
+                                                  uint32_t offset) {
   const dex_code_item* code = (const dex_code_item*)idx->get_uint_data(offset);
   std::unique_ptr<DexCode> dc(new DexCode());
   dc->m_registers_size = code->registers_size;
   dc->m_ins_size = code->ins_size;
   dc->m_outs_size = code->outs_size;
-  dc->m_insns = std::vector<DexInstruction*>();
+  return dc;
+}
+
+uint32_t DexCode::load_body(DexIdx* idx, uint32_t offset) {
+  const dex_code_item* code = (const dex_code_item*)idx->get_uint_data(offset);
+  m_insns = std::vector<DexInstruction*>();
   const uint16_t* cdata = (const uint16_t*)(code + 1);
   uint32_t tries = code->tries_size;
   if (code->insns_size) {
     // On average there seem to be about two code units per instruction
-    dc->m_insns->reserve(code->insns_size / 2);
+    m_insns->reserve(code->insns_size / 2);
     const uint16_t* end = cdata + code->insns_size;
     while (cdata < end) {
       DexInstruction* dop = DexInstruction::make_instruction(idx, &cdata);
       always_assert_log(dop != nullptr,
                         "Failed to parse method at offset 0x%08x", offset);
-      dc->m_insns->push_back(dop);
+      m_insns->push_back(dop);
     }
     /*
      * Padding, see dex-spec.
@@ -649,13 +705,48 @@ std::unique_ptr<DexCode> DexCode::get_dex_code(DexIdx* idx, uint32_t offset) {
         auto hoff = read_uleb128(&handler);
         dextry->m_catches.push_back(std::make_pair(nullptr, hoff));
       }
-      dc->m_tries.emplace_back(dextry);
+      m_tries.emplace_back(dextry);
     }
   }
-  dc->m_dbg = DexDebugItem::get_dex_debug(idx, code->debug_info_off);
+  return code->debug_info_off;
+}
+
+std::unique_ptr<DexCode> DexCode::get_dex_code(DexIdx* idx, uint32_t offset) {
+  if (offset == 0) return std::unique_ptr<DexCode>();
+  auto dc = make_from_header(idx, offset);
+  auto debug_info_off = dc->load_body(idx, offset);
+  dc->m_dbg = DexDebugItem::get_dex_debug(idx, debug_info_off);
+  return dc;
+}
+
+std::unique_ptr<DexCode> DexCode::get_lazy_dex_code(
+    std::shared_ptr<DexIdx> idx,
+    uint32_t offset,
+    DexMethod* method,
+    const DexString* source_file) {
+  if (offset == 0) return std::unique_ptr<DexCode>();
+  auto dc = make_from_header(idx.get(), offset);
+  dc->m_lazy = std::make_unique<LazyState>();
+  dc->m_lazy->idx = std::move(idx);
+  dc->m_lazy->offset = offset;
+  dc->m_lazy->method = method;
+  dc->m_lazy->source_file = source_file;
   return dc;
 }
 
+void DexCode::load_lazily() const {
+  // The lazy parts are logically part of the value of a const DexCode.
+  auto* self = const_cast<DexCode*>(this);
+  std::call_once(m_lazy->loaded, [self] {
+    auto& lazy = *self->m_lazy;
+    auto debug_info_off = self->load_body(lazy.idx.get(), lazy.offset);
+    self->m_dbg = DexDebugItem::get_lazy_dex_debug(
+        lazy.idx, debug_info_off, lazy.method, lazy.source_file);
+    // Don't hold on to the input dex any longer than needed.
+    lazy.idx.reset();
+  });
+}
+
 int DexCode::encode(DexOutputIdx* dodx, uint32_t* output) {
   dex_code_item* code = (dex_code_item*)output;
   code->registers_size = m_registers_size;
@@ -792,9 +883,13 @@ DexMethod* DexMethod::make_method_from(DexMethod* that,
   m->m_concrete = that->m_concrete;
   m->m_virtual = that->m_virtual;
   m->m_external = that->m_external;
-  for (auto& pair : that->m_param_anno) {
-    // note: DexAnnotation's copy ctor only does a shallow copy
-    m->m_param_anno.emplace(pair.first, new DexAnnotationSet(*pair.second));
+  if (auto* param_anno = that->get_param_anno()) {
+    m->m_param_anno = std::make_unique<ParamAnnotations>();
+    for (auto& pair : *param_anno) {
+      // note: DexAnnotation's copy ctor only does a shallow copy
+      m->m_param_anno->emplace(pair.first,
+                               new DexAnnotationSet(*pair.second));
+    }
   }
 
   return m;
@@ -883,12 +978,19 @@ void DexMethod::combine_annotations_with(DexMethod* other) {
       m_anno->combine_with(*other->m_anno);
     }
   }
-  for (auto& pair : other->m_param_anno) {
-    if (m_param_anno.count(pair.first) == 0 ||
-        m_param_anno[pair.first] == nullptr) {
-      m_param_anno.emplace(pair.first, new DexAnnotationSet(*pair.second));
+  auto* other_param_anno = other->get_param_anno();
+  if (other_param_anno == nullptr) {
+    return;
+  }
+  if (!m_param_anno) {
+    m_param_anno = std::make_unique<ParamAnnotations>();
+  }
+  for (auto& pair : *other_param_anno) {
+    auto& param_anno_set = (*m_param_anno)[pair.first];
+    if (param_anno_set == nullptr) {
+      param_anno_set = std::make_unique<DexAnnotationSet>(*pair.second);
     } else {
-      m_param_anno[pair.first]->combine_with(*pair.second);
+      param_anno_set->combine_with(*pair.second);
     }
   }
 }
@@ -906,11 +1008,14 @@ void DexMethod::attach_param_annotation_set(
     int paramno, std::unique_ptr<DexAnnotationSet> aset) {
   always_assert_type_log(!m_concrete, RedexError::BAD_ANNOTATION,
                          "method %s is concrete\n", self_show().c_str());
-  always_assert_type_log(m_param_anno.count(paramno) == 0,
+  if (!m_param_anno) {
+    m_param_anno = std::make_unique<ParamAnnotations>();
+  }
+  always_assert_type_log(m_param_anno->count(paramno) == 0,
                          RedexError::BAD_ANNOTATION,
                          "param %d annotation to method %s exists\n", paramno,
                          self_show().c_str());
-  m_param_anno[paramno] = std::move(aset);
+  (*m_param_anno)[paramno] = std::move(aset);
 }
 
 std::unique_ptr<DexAnnotationSet> DexMethod::release_annotations() {
@@ -1042,7 +1147,7 @@ void DexMethod::make_non_concrete() {
   m_concrete = false;
   m_code.reset();
   m_virtual = false;
-  m_param_anno.clear();
+  m_param_anno.reset();
 }
 
 void DexMethod::set_deobfuscated_name(const std::string& name) {
@@ -1086,7 +1191,8 @@ std::string DexMethod::get_simple_deobfuscated_name() const {
 void DexClass::load_class_data_item(
     DexIdx* idx,
     uint32_t cdi_off,
-    std::unique_ptr<DexEncodedValueArray> svalues) {
+    std::unique_ptr<DexEncodedValueArray> svalues,
+    bool lazy_code) {
   if (cdi_off == 0) return;
   const uint8_t* encd = idx->get_uleb_data(cdi_off);
   uint32_t sfield_count = read_uleb128(&encd);
@@ -1129,16 +1235,27 @@ void DexClass::load_class_data_item(
   std::unordered_set<DexMethod*> method_pointer_cache;
   method_pointer_cache.reserve(dmethod_count + vmethod_count);
 
-  auto process_method = [this, &encd, &idx, &method_pointer_cache](
-                            uint32_t& ndex, bool is_virtual) {
+  std::shared_ptr<DexIdx> shared_idx;
+  if (lazy_code) {
+    shared_idx = idx->shared_from_this();
+  }
+
+  auto process_method = [this, &encd, &idx, &shared_idx, lazy_code,
+                         &method_pointer_cache](uint32_t& ndex,
+                                                bool is_virtual) {
     ndex += read_uleb128(&encd);
     auto access_flags = (DexAccessFlags)read_uleb128(&encd);
     uint32_t code_off = read_uleb128(&encd);
     // Find method in method index, returns same pointer for same method.
     DexMethod* dm = static_cast<DexMethod*>(idx->get_methodidx(ndex));
-    std::unique_ptr<DexCode> dc = DexCode::get_dex_code(idx, code_off);
-    if (dc && dc->get_debug_item()) {
-      dc->get_debug_item()->bind_positions(dm, m_source_file);
+    std::unique_ptr<DexCode> dc;
+    if (lazy_code) {
+      dc = DexCode::get_lazy_dex_code(shared_idx, code_off, dm, m_source_file);
+    } else {
+      dc = DexCode::get_dex_code(idx, code_off);
+      if (dc && dc->get_debug_item()) {
+        dc->get_debug_item()->bind_positions(dm, m_source_file);
+      }
     }
     dm->make_concrete(access_flags, std::move(dc), is_virtual);
 
@@ -1483,21 +1600,37 @@ DexAnnotationDirectory* DexClass::get_annotation_directory() {
 
 DexClass* DexClass::create(DexIdx* idx,
                            const dex_class_def* cdef,
-                           const std::string& location) {
+                           const std::string& location,
+                           bool lazy_code) {
+  DexClass* cls = claim(idx, cdef, location);
+  if (cls != nullptr) {
+    cls->load_claimed(idx, cdef, lazy_code);
+  }
+  return cls;
+}
+
+DexClass* DexClass::claim(DexIdx* idx,
+                          const dex_class_def* cdef,
+                          const std::string& location) {
   DexClass* cls = new DexClass(idx, cdef, location);
   if (g_redex->class_already_loaded(cls)) {
-    // FIXME: This isn't deterministic. We're keeping whichever class we loaded
-    // first, which may not always be from the same dex (if we load them in
-    // parallel, for example).
+    // Which definition is kept depends on the order of the claims. Loaders
+    // claim the classes of a dex in order, see DexLoader::claim_classes.
     delete cls;
     return nullptr;
   }
-  cls->load_class_annotations(idx, cdef->annotations_off);
+  return cls;
+}
+
+void DexClass::load_claimed(DexIdx* idx,
+                            const dex_class_def* cdef,
+                            bool lazy_code) {
+  load_class_annotations(idx, cdef->annotations_off);
   auto deva = std::unique_ptr<DexEncodedValueArray>(
       load_static_values(idx, cdef->static_values_off));
-  cls->load_class_data_item(idx, cdef->class_data_offset, std::move(deva));
-  g_redex->publish_class(cls);
-  return cls;
+  load_class_data_item(idx, cdef->class_data_offset, std::move(deva),
+                       lazy_code);
+  g_redex->publish_class(this);
 }
 
 DexClass::DexClass(const std::string& location) : m_location(location) {}
@@ -1753,6 +1886,10 @@ DexField* DexFieldRef::as_def() {
   }
 }
 
+const DexString* DexFieldRef::get_qualified_name() const {
+  return g_redex->get_qualified_name(this);
+}
+
 // Find methods and fields from a class using its obfuscated name.
 DexField* DexClass::find_field_from_simple_deobfuscated_name(
     const std::string& field_name) {
@@ -2059,6 +2196,10 @@ DexMethod* DexMethodRef::as_def() {
   }
 }
 
+const DexString* DexMethodRef::get_qualified_name() const {
+  return g_redex->get_qualified_name(this);
+}
+
 template <typename C>
 void DexMethodRef::gather_types_shallow(C& ltype) const {
   ltype.insert(ltype.end(), m_spec.cls);
@@ -2148,41 +2289,60 @@ void gather_components(std::vector<const DexString*>& lstring,
                        std::vector<DexMethodHandle*>& lmethodhandle,
                        const DexClasses& classes,
                        bool exclude_loads) {
-  // Gather references reachable from each class.
-  std::unordered_set<const DexString*> strings;
-  std::unordered_set<DexType*> types;
-  std::unordered_set<DexFieldRef*> fields;
-  std::unordered_set<DexMethodRef*> methods;
-  std::unordered_set<DexCallSite*> callsites;
-  std::unordered_set<DexMethodHandle*> methodhandles;
-  // Inside a lambda to ensure only visibility of the sets.
-  [&classes, &exclude_loads, &strings, &types, &fields, &methods, &callsites,
-   &methodhandles]() {
-    for (auto const& cls : classes) {
-      cls->gather_strings(strings, exclude_loads);
-      cls->gather_types(types);
-      cls->gather_fields(fields);
-      cls->gather_methods(methods);
-      cls->gather_callsites(callsites);
-      cls->gather_methodhandles(methodhandles);
-    }
-
-    // Gather types and strings needed for field and method refs.
-    for (auto meth : methods) {
-      meth->gather_types_shallow(types);
-      meth->gather_strings_shallow(strings);
-    }
-
-    for (auto field : fields) {
-      field->gather_types_shallow(types);
-      field->gather_strings_shallow(strings);
-    }
-
-    // Gather strings needed for each type.
-    for (auto type : types) {
-      if (type) strings.insert(type->get_name());
-    }
-  }();
+  struct Components {
+    std::unordered_set<const DexString*> strings;
+    std::unordered_set<DexType*> types;
+    std::unordered_set<DexFieldRef*> fields;
+    std::unordered_set<DexMethodRef*> methods;
+    std::unordered_set<DexCallSite*> callsites;
+    std::unordered_set<DexMethodHandle*> methodhandles;
+  };
+  // Gather references reachable from each class, into one set per worker.
+  auto num_threads = redex_parallel::default_num_threads();
+  std::vector<Components> per_worker(num_threads);
+  workqueue_run<DexClass*>(
+      [&](sparta::SpartaWorkerState<DexClass*>* state, DexClass* cls) {
+        auto& c = per_worker[state->worker_id()];
+        cls->gather_strings(c.strings, exclude_loads);
+        cls->gather_types(c.types);
+        cls->gather_fields(c.fields);
+        cls->gather_methods(c.methods);
+        cls->gather_callsites(c.callsites);
+        cls->gather_methodhandles(c.methodhandles);
+      },
+      classes, num_threads);
+  auto& strings = per_worker[0].strings;
+  auto& types = per_worker[0].types;
+  auto& fields = per_worker[0].fields;
+  auto& methods = per_worker[0].methods;
+  auto& callsites = per_worker[0].callsites;
+  auto& methodhandles = per_worker[0].methodhandles;
+  for (size_t i = 1; i < per_worker.size(); ++i) {
+    auto& c = per_worker[i];
+    strings.insert(c.strings.begin(), c.strings.end());
+    types.insert(c.types.begin(), c.types.end());
+    fields.insert(c.fields.begin(), c.fields.end());
+    methods.insert(c.methods.begin(), c.methods.end());
+    callsites.insert(c.callsites.begin(), c.callsites.end());
+    methodhandles.insert(c.methodhandles.begin(), c.methodhandles.end());
+    c = Components();
+  }
+
+  // Gather types and strings needed for field and method refs.
+  for (auto meth : methods) {
+    meth->gather_types_shallow(types);
+    meth->gather_strings_shallow(strings);
+  }
+
+  for (auto field : fields) {
+    field->gather_types_shallow(types);
+    field->gather_strings_shallow(strings);
+  }
+
+  // Gather strings needed for each type.
+  for (auto type : types) {
+    if (type) strings.insert(type->get_name());
+  }
 
   lstring.insert(lstring.end(), strings.begin(), strings.end());
   ltype.insert(ltype.end(), types.begin(), types.end());
@@ -2216,4 +2376,3 @@ void DexMethodRef::erase_method(DexMethodRef* mref) {
   }
 }
 
-DexClass* type_class(const DexType* t) { return g_redex->type_class(t); }
@@ -7,12 +7,15 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <initializer_list>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <utility>
@@ -63,6 +66,7 @@ class DexEncodedValueArray;
 class DexField;
 class DexIdx;
 class DexInstruction;
+class DexMethod;
 class DexMethodHandle;
 class DexOutputIdx;
 struct DexPosition;
@@ -87,11 +91,24 @@ class DexString {
 
   std::string m_storage;
   uint32_t m_utfsize;
+  // The first 8 bytes of the string, zero-padded, as a big-endian integer.
+  // Comparing keys orders strings like comparing their first 8 bytes does.
+  uint64_t m_prefix_key;
 
   // See UNIQUENESS above for the rationale for the private constructor pattern.
   explicit DexString(std::string nstr)
       : m_storage(std::move(nstr)),
-        m_utfsize(length_of_utf8_string(m_storage.c_str())) {}
+        m_utfsize(length_of_utf8_string(m_storage.c_str())),
+        m_prefix_key(compute_prefix_key(m_storage)) {}
+
+  static uint64_t compute_prefix_key(const std::string& str) {
+    uint64_t key = 0;
+    size_t len = std::min<size_t>(str.size(), sizeof(key));
+    for (size_t i = 0; i < len; ++i) {
+      key |= uint64_t(static_cast<uint8_t>(str[i])) << (56 - 8 * i);
+    }
+    return key;
+  }
 
  public:
   uint32_t size() const { return static_cast<uint32_t>(m_storage.size()); }
@@ -118,6 +135,8 @@ class DexString {
   const char* c_str() const { return m_storage.c_str(); }
   const std::string& str() const { return m_storage; }
 
+  uint64_t prefix_key() const { return m_prefix_key; }
+
   uint32_t get_entry_size() const {
     uint32_t len = uleb128_encoding_size(m_utfsize);
     len += size();
@@ -138,12 +157,22 @@ inline bool compare_dexstrings(const DexString* a, const DexString* b) {
   } else if (b == nullptr) {
     return false;
   }
-  if (a->is_simple() && b->is_simple())
+  if (a->is_simple() && b->is_simple()) {
+    // Most strings differ in their first 8 bytes. Simple strings have no
+    // embedded NUL, so equal keys of a string shorter than that mean equal
+    // strings.
+    if (a->prefix_key() != b->prefix_key()) {
+      return a->prefix_key() < b->prefix_key();
+    }
+    if (a->size() < 8) {
+      return false;
+    }
 #if defined(__SSE4_2__) && defined(__linux__) && defined(__STRCMP_LESS__)
-    return strcmp_less(a->c_str(), b->c_str());
+    return strcmp_less(a->c_str() + 8, b->c_str() + 8);
 #else
-    return (strcmp(a->c_str(), b->c_str()) < 0);
+    return (strcmp(a->c_str() + 8, b->c_str() + 8) < 0);
 #endif
+  }
   /*
    * Bother, need to do code-point character-by-character
    * comparison.
@@ -180,8 +209,17 @@ struct dexstrings_comparator {
 
 class DexType {
   friend struct RedexContext;
+  friend DexClass* type_class(const DexType* t);
 
   const DexString* m_name;
+  uint32_t m_id{0};
+  // The class of the type, set once when the class is published. Reading it
+  // is safe while other classes are being published.
+  std::atomic<DexClass*> m_class{nullptr};
+  // The first class definition loaded for the type, claimed before the class
+  // is loaded and published, so that duplicates are detected while classes
+  // load concurrently. See RedexContext::class_already_loaded.
+  std::atomic<DexClass*> m_claimed_class{nullptr};
 
   // See UNIQUENESS above for the rationale for the private constructor pattern.
   explicit DexType(const DexString* dstring) { m_name = dstring; }
@@ -220,6 +258,9 @@ class DexType {
   const DexString* get_name() const { return m_name; }
   const char* c_str() const { return get_name()->c_str(); }
   const std::string& str() const { return get_name()->str(); }
+  // A dense id, unique among the types of the RedexContext. It is assigned at
+  // creation and does not change when the type is renamed. See DenseMap.
+  uint32_t get_id() const { return m_id; }
   DexProto* get_non_overlapping_proto(const DexString*, DexProto*);
 };
 
@@ -258,6 +299,7 @@ class DexFieldRef {
   DexFieldSpec m_spec;
   bool m_concrete;
   bool m_external;
+  uint32_t m_id{0};
 
   virtual ~DexFieldRef() {}
   DexFieldRef(DexType* container, const DexString* name, DexType* type) {
@@ -280,6 +322,13 @@ class DexFieldRef {
   const char* c_str() const { return get_name()->c_str(); }
   const std::string& str() const { return get_name()->str(); }
   DexType* get_type() const { return m_spec.type; }
+  // The interned qualified name, as show() prints it, e.g. "LFoo;.bar:I". It
+  // is computed once, and again only after the field or a type is renamed, so
+  // that lookups keyed by it compare pointers rather than strings.
+  const DexString* get_qualified_name() const;
+  // A dense id, unique among the fields of the RedexContext. It is assigned at
+  // creation and does not change with the spec. See DenseMap.
+  uint32_t get_id() const { return m_id; }
 
   template <typename C>
   void gather_types_shallow(C& ltype) const;
@@ -626,7 +675,24 @@ class DexDebugItem {
   uint32_t m_on_disk_size{0};
   uint32_t m_source_checksum{0};
   uint32_t m_source_offset{0};
+  // Non-null if the entries are decoded from the input dex on first access.
+  // See get_lazy_dex_debug.
+  struct LazyState {
+    std::once_flag decoded;
+    std::shared_ptr<DexIdx> idx;
+    DexMethod* method;
+    const DexString* source_file;
+  };
+  std::unique_ptr<LazyState> m_lazy;
+
   DexDebugItem(DexIdx* idx, uint32_t offset);
+  void decode(DexIdx* idx);
+  void ensure_decoded() const {
+    if (m_lazy) {
+      decode_lazily();
+    }
+  }
+  void decode_lazily() const;
 
  public:
   DexDebugItem() = default;
@@ -634,14 +700,36 @@ class DexDebugItem {
   static std::unique_ptr<DexDebugItem> get_dex_debug(DexIdx* idx,
                                                      uint32_t offset);
 
+  /*
+   * Like get_dex_debug, but the debug_info_item is only decoded, and its
+   * positions bound to `method`, the first time the entries are accessed.
+   * Until then the item takes no more memory than its raw bytes in the input
+   * dex, which it keeps alive. Decoding is thread-safe.
+   */
+  static std::unique_ptr<DexDebugItem> get_lazy_dex_debug(
+      std::shared_ptr<DexIdx> idx,
+      uint32_t offset,
+      DexMethod* method,
+      const DexString* source_file);
+
  public:
-  std::vector<DexDebugEntry>& get_entries() { return m_dbg_entries; }
-  const auto& get_entries() const { return m_dbg_entries; }
+  std::vector<DexDebugEntry>& get_entries() {
+    ensure_decoded();
+    return m_dbg_entries;
+  }
+  const auto& get_entries() const {
+    ensure_decoded();
+    return m_dbg_entries;
+  }
   void set_entries(std::vector<DexDebugEntry> dbg_entries) {
+    ensure_decoded();
     m_dbg_entries.swap(dbg_entries);
   }
   uint32_t get_line_start() const;
-  uint32_t get_on_disk_size() const { return m_on_disk_size; }
+  uint32_t get_on_disk_size() const {
+    ensure_decoded();
+    return m_on_disk_size;
+  }
   uint32_t get_source_checksum() const { return m_source_checksum; }
   uint32_t get_source_offset() const { return m_source_offset; }
   void bind_positions(DexMethod* method, const DexString* file);
@@ -691,10 +779,44 @@ class DexCode {
   std::optional<std::vector<DexInstruction*>> m_insns{std::nullopt};
   std::vector<std::unique_ptr<DexTryItem>> m_tries;
   std::unique_ptr<DexDebugItem> m_dbg;
+  // Non-null if the instructions, tries and debug item are decoded from the
+  // input dex on first access. See get_lazy_dex_code.
+  struct LazyState {
+    std::once_flag loaded;
+    std::shared_ptr<DexIdx> idx;
+    uint32_t offset;
+    DexMethod* method;
+    const DexString* source_file;
+  };
+  std::unique_ptr<LazyState> m_lazy;
+
+  static std::unique_ptr<DexCode> make_from_header(DexIdx* idx,
+                                                   uint32_t offset);
+  // Returns the offset of the debug_info_item, which is left to the caller.
+  uint32_t load_body(DexIdx* idx, uint32_t offset);
+  void ensure_loaded() const {
+    if (m_lazy) {
+      load_lazily();
+    }
+  }
+  void load_lazily() const;
 
  public:
   static std::unique_ptr<DexCode> get_dex_code(DexIdx* idx, uint32_t offset);
 
+  /*
+   * Like get_dex_code, but only the register counts are read right away. The
+   * rest is decoded the first time it is accessed, except for the debug item,
+   * which is a lazy one bound to the positions of `method`, see
+   * get_lazy_dex_debug. The code keeps `idx`, and thus the input dex, alive
+   * until then. Decoding is thread-safe.
+   */
+  static std::unique_ptr<DexCode> get_lazy_dex_code(
+      std::shared_ptr<DexIdx> idx,
+      uint32_t offset,
+      DexMethod* method,
+      const DexString* source_file);
+
   // TODO: make it private and find a better way to allow code creation
   DexCode()
       : m_registers_size(0),
@@ -708,37 +830,54 @@ class DexCode {
   ~DexCode();
 
  public:
-  const DexDebugItem* get_debug_item() const { return m_dbg.get(); }
+  const DexDebugItem* get_debug_item() const {
+    ensure_loaded();
+    return m_dbg.get();
+  }
   void set_debug_item(std::unique_ptr<DexDebugItem> dbg) {
+    ensure_loaded();
     m_dbg = std::move(dbg);
   }
-  DexDebugItem* get_debug_item() { return m_dbg.get(); }
+  DexDebugItem* get_debug_item() {
+    ensure_loaded();
+    return m_dbg.get();
+  }
   std::unique_ptr<DexDebugItem> release_debug_item() {
+    ensure_loaded();
     return std::move(m_dbg);
   }
   std::vector<DexInstruction*> release_instructions() {
+    ensure_loaded();
     redex_assert(m_insns);
     auto ret = std::move(*m_insns);
     m_insns = std::nullopt;
     return ret;
   }
   std::vector<DexInstruction*>& reset_instructions() {
+    ensure_loaded();
     m_insns = std::vector<DexInstruction*>{};
     return *m_insns;
   }
   std::vector<DexInstruction*>& get_instructions() {
+    ensure_loaded();
     redex_assert(m_insns);
     return *m_insns;
   }
   const std::vector<DexInstruction*>& get_instructions() const {
+    ensure_loaded();
     redex_assert(m_insns);
     return *m_insns;
   }
   void set_instructions(std::vector<DexInstruction*> insns) {
+    ensure_loaded();
     m_insns.emplace(std::move(insns));
   }
-  std::vector<std::unique_ptr<DexTryItem>>& get_tries() { return m_tries; }
+  std::vector<std::unique_ptr<DexTryItem>>& get_tries() {
+    ensure_loaded();
+    return m_tries;
+  }
   const std::vector<std::unique_ptr<DexTryItem>>& get_tries() const {
+    ensure_loaded();
     return m_tries;
   }
   uint16_t get_registers_size() const { return m_registers_size; }
@@ -789,6 +928,7 @@ class DexMethodRef {
   DexMethodSpec m_spec;
   bool m_concrete;
   bool m_external;
+  uint32_t m_id{0};
 
   ~DexMethodRef() {}
   DexMethodRef(DexType* type, const DexString* name, DexProto* proto)
@@ -809,6 +949,13 @@ class DexMethodRef {
   const char* c_str() const { return get_name()->c_str(); }
   const std::string& str() const { return get_name()->str(); }
   DexProto* get_proto() const { return m_spec.proto; }
+  // The interned qualified name, as show() prints it, e.g. "LFoo;.bar:(I)V".
+  // It is computed once, and again only after the method or a type is renamed,
+  // so that lookups keyed by it compare pointers rather than strings.
+  const DexString* get_qualified_name() const;
+  // A dense id, unique among the methods of the RedexContext. It is assigned
+  // at creation and does not change with the spec. See DenseMap.
+  uint32_t get_id() const { return m_id; }
 
   template <typename C>
   void gather_types_shallow(C& ltype) const;
@@ -846,7 +993,9 @@ class DexMethod : public DexMethodRef {
   std::unique_ptr<DexAnnotationSet> m_anno;
   std::unique_ptr<DexCode> m_dex_code;
   std::unique_ptr<IRCode> m_code;
-  ParamAnnotations m_param_anno;
+  // Few methods have parameter annotations, so the map is only allocated
+  // for those that do.
+  std::unique_ptr<ParamAnnotations> m_param_anno;
   const DexString* m_deobfuscated_name{nullptr};
 
   // See UNIQUENESS above for the rationale for the private constructor pattern.
@@ -962,12 +1111,12 @@ class DexMethod : public DexMethodRef {
     return m_access;
   }
   const ParamAnnotations* get_param_anno() const {
-    if (m_param_anno.empty()) return nullptr;
-    return &m_param_anno;
+    if (!m_param_anno || m_param_anno->empty()) return nullptr;
+    return m_param_anno.get();
   }
   ParamAnnotations* get_param_anno() {
-    if (m_param_anno.empty()) return nullptr;
-    return &m_param_anno;
+    if (!m_param_anno || m_param_anno->empty()) return nullptr;
+    return m_param_anno.get();
   }
 
   void set_deobfuscated_name(const std::string& name);
@@ -1100,7 +1249,8 @@ class DexClass {
   void load_class_annotations(DexIdx* idx, uint32_t anno_off);
   void load_class_data_item(DexIdx* idx,
                             uint32_t cdi_off,
-                            std::unique_ptr<DexEncodedValueArray> svalues);
+                            std::unique_ptr<DexEncodedValueArray> svalues,
+                            bool lazy_code);
 
   friend struct ClassCreator;
 
@@ -1114,10 +1264,23 @@ class DexClass {
 
   ~DexClass();
 
-  // May return nullptr on benign duplicate class
+  // May return nullptr on benign duplicate class.
+  // With `lazy_code`, method code is decoded on first access (see
+  // DexCode::get_lazy_dex_code); `idx` must then be owned by a shared_ptr.
   static DexClass* create(DexIdx* idx,
                           const dex_class_def* cdef,
-                          const std::string& location);
+                          const std::string& location,
+                          bool lazy_code = false);
+
+  // The two steps of create(). claim() makes the class without its members,
+  // or returns nullptr on benign duplicate class; whichever definition of a
+  // type claims it first is the one that is kept. load_claimed() then loads
+  // the members and publishes the class, and may run concurrently for
+  // different classes.
+  static DexClass* claim(DexIdx* idx,
+                         const dex_class_def* cdef,
+                         const std::string& location);
+  void load_claimed(DexIdx* idx, const dex_class_def* cdef, bool lazy_code);
 
   const std::vector<DexMethod*>& get_dmethods() const { return m_dmethods; }
   std::vector<DexMethod*>& get_dmethods() {
@@ -1337,7 +1500,9 @@ struct dexmethods_comparator {
  * Return the DexClass that represents the DexType in input or nullptr if
  * no such DexClass exists.
  */
-DexClass* type_class(const DexType* t);
+inline DexClass* type_class(const DexType* t) {
+  return t->m_class.load(std::memory_order_acquire);
+}
 
 /**
  * Return the DexClass that represents an internal DexType or nullptr if
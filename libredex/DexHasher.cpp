@@ -8,7 +8,9 @@
 #include "DexHasher.h"
 
 #include <cinttypes>
+#include <numeric>
 #include <ostream>
+#include <unordered_map>
 
 #include "Debug.h"
 #include "DexAccess.h"
@@ -20,10 +22,12 @@
 #include "IRCode.h"
 #include "IRInstruction.h"
 #include "IROpcode.h"
+#include "ParallelPrint.h"
 #include "Sha1.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace hashing {
 
@@ -33,7 +37,8 @@ namespace {
 
 class Impl final {
  public:
-  explicit Impl(DexClass* cls) : m_cls(cls) {}
+  explicit Impl(DexClass* cls, CodeHashCache* code_hashes = nullptr)
+      : m_cls(cls), m_code_hashes(code_hashes) {}
   DexHash run();
   void print(std::ostream&);
 
@@ -47,7 +52,8 @@ class Impl final {
   void hash(uint16_t value);
   void hash(uint8_t value);
   void hash(bool value);
-  void hash(const IRCode* c);
+  void hash_code(const DexMethod* m);
+  CodeHash compute_code_hash(const IRCode* c);
   void hash(const IRInstruction* insn);
   void hash(const EncodedAnnotations* a);
   void hash(const ParamAnnotations* m);
@@ -108,10 +114,15 @@ class Impl final {
   }
 
   DexClass* m_cls;
+  CodeHashCache* m_code_hashes;
   size_t m_hash{0};
   size_t m_code_hash{0};
   size_t m_registers_hash{0};
   size_t m_positions_hash{0};
+  // Scratch space of compute_code_hash, kept across the methods of a class to
+  // not reallocate the tables for each of them.
+  std::unordered_map<const MethodItemEntry*, uint32_t> m_mie_ids;
+  std::unordered_map<DexPosition*, uint32_t> m_pos_ids;
 };
 
 void Impl::hash(const std::string& str) {
@@ -158,7 +169,12 @@ void Impl::hash(const IRInstruction* insn) {
 
   auto old_hash = m_hash;
   m_hash = 0;
-  hash(insn->srcs_vec());
+  // Same as hashing srcs_vec(), without building the vector.
+  auto srcs = insn->srcs();
+  hash((uint64_t)srcs.size());
+  for (auto src : srcs) {
+    hash(src);
+  }
   if (insn->has_dest()) {
     hash(insn->dest());
   }
@@ -188,15 +204,35 @@ void Impl::hash(const IRInstruction* insn) {
   }
 }
 
-void Impl::hash(const IRCode* c) {
+void Impl::hash_code(const DexMethod* m) {
+  const auto* c = m->get_code();
   if (!c) {
     return;
   }
 
+  CodeHash code_hash;
+  if (m_code_hashes == nullptr || !m_code_hashes->lookup(m, c, &code_hash)) {
+    code_hash = compute_code_hash(c);
+    if (m_code_hashes != nullptr) {
+      m_code_hashes->record(m, c, code_hash);
+    }
+  }
+  boost::hash_combine(m_positions_hash, code_hash.positions_hash);
+  boost::hash_combine(m_registers_hash, code_hash.registers_hash);
+  boost::hash_combine(m_code_hash, code_hash.code_hash);
+}
+
+// Hashes the code on its own, so that the result can be cached.
+CodeHash Impl::compute_code_hash(const IRCode* c) {
   auto old_hash = m_hash;
+  auto old_positions_hash = m_positions_hash;
+  auto old_registers_hash = m_registers_hash;
   m_hash = 0;
+  m_positions_hash = 0;
+  m_registers_hash = 0;
 
-  std::unordered_map<const MethodItemEntry*, uint32_t> mie_ids;
+  auto& mie_ids = m_mie_ids;
+  mie_ids.clear();
   auto get_mie_id = [&mie_ids](const MethodItemEntry* mie) {
     auto it = mie_ids.find(mie);
     if (it != mie_ids.end()) {
@@ -208,7 +244,8 @@ void Impl::hash(const IRCode* c) {
     }
   };
 
-  std::unordered_map<DexPosition*, uint32_t> pos_ids;
+  auto& pos_ids = m_pos_ids;
+  pos_ids.clear();
   auto get_pos_id = [&pos_ids](DexPosition* pos) {
     auto it = pos_ids.find(pos);
     if (it != pos_ids.end()) {
@@ -297,8 +334,11 @@ void Impl::hash(const IRCode* c) {
     mie_index++;
   }
 
-  boost::hash_combine(m_code_hash, m_hash);
+  CodeHash code_hash{m_positions_hash, m_registers_hash, m_hash};
   m_hash = old_hash;
+  m_positions_hash = old_positions_hash;
+  m_registers_hash = old_registers_hash;
+  return code_hash;
 }
 
 void Impl::hash(const DexProto* p) {
@@ -321,10 +361,11 @@ void Impl::hash(const DexMethod* m) {
   hash(m->get_access());
   hash(m->get_deobfuscated_name_or_empty());
   hash(m->get_param_anno());
-  hash(m->get_code());
+  hash_code(m);
 }
 
 void Impl::hash(const DexFieldRef* f) {
+  hash(f->get_class());
   hash(f->get_name());
   hash(f->is_concrete());
   hash(f->is_external());
@@ -492,23 +533,30 @@ std::string hash_to_string(size_t hash) {
 }
 
 DexHash DexScopeHasher::run() {
-  std::unordered_map<DexClass*, size_t> class_indices;
-  walk::classes(m_scope, [&](DexClass* cls) {
-    class_indices.emplace(cls, class_indices.size());
-  });
-  std::vector<size_t> class_positions_hashes(class_indices.size());
-  std::vector<size_t> class_registers_hashes(class_indices.size());
-  std::vector<size_t> class_code_hashes(class_indices.size());
-  std::vector<size_t> class_signature_hashes(class_indices.size());
-  walk::parallel::classes(m_scope, [&](DexClass* cls) {
-    Impl class_hasher(cls);
-    DexHash class_hash = class_hasher.run();
-    auto index = class_indices.at(cls);
-    class_positions_hashes.at(index) = class_hash.positions_hash;
-    class_registers_hashes.at(index) = class_hash.registers_hash;
-    class_code_hashes.at(index) = class_hash.code_hash;
-    class_signature_hashes.at(index) = class_hash.signature_hash;
-  });
+  // Classes are hashed in parallel, each into its own slot, and then combined
+  // in the order of the scope, which is part of what the hash captures.
+  const size_t num_classes = m_scope.size();
+  std::vector<DexHash> class_hashes(num_classes);
+  std::vector<size_t> indices(num_classes);
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t index) {
+        Impl class_hasher(m_scope[index], m_code_hashes);
+        class_hashes[index] = class_hasher.run();
+      },
+      indices);
+
+  std::vector<size_t> class_positions_hashes(num_classes);
+  std::vector<size_t> class_registers_hashes(num_classes);
+  std::vector<size_t> class_code_hashes(num_classes);
+  std::vector<size_t> class_signature_hashes(num_classes);
+  for (size_t index = 0; index < num_classes; ++index) {
+    const auto& class_hash = class_hashes[index];
+    class_positions_hashes[index] = class_hash.positions_hash;
+    class_registers_hashes[index] = class_hash.registers_hash;
+    class_code_hashes[index] = class_hash.code_hash;
+    class_signature_hashes[index] = class_hash.signature_hash;
+  }
 
   return DexHash{boost::hash_value(class_positions_hashes),
                  boost::hash_value(class_registers_hashes),
@@ -516,6 +564,24 @@ DexHash DexScopeHasher::run() {
                  boost::hash_value(class_signature_hashes)};
 }
 
+bool CodeHashCache::lookup(const DexMethod* method,
+                           const IRCode* code,
+                           CodeHash* hash) {
+  auto entry = m_entries.get(method, Entry());
+  if (entry.code != code || entry.mutation_epoch != code->mutation_epoch()) {
+    return false;
+  }
+  *hash = entry.hash;
+  return true;
+}
+
+void CodeHashCache::record(const DexMethod* method,
+                           const IRCode* code,
+                           CodeHash hash) {
+  m_entries.insert_or_assign(
+      std::make_pair(method, Entry{code, code->mutation_epoch(), hash}));
+}
+
 struct DexClassHasher::Fwd final {
   Impl impl;
 
@@ -534,15 +600,10 @@ DexHash DexClassHasher::run() { return m_fwd->run(); }
 void DexClassHasher::print(std::ostream& os) { m_fwd->print(os); }
 
 void print_classes(std::ostream& output, const Scope& classes) {
-  std::unordered_map<DexClass*, std::stringstream> class_strs;
-  walk::classes(classes, [&](DexClass* cls) {
-    class_strs.emplace(cls, std::stringstream());
-  });
-  walk::parallel::classes(classes, [&](DexClass* cls) {
-    DexClassHasher(cls).print(class_strs.at(cls));
-  });
-  walk::classes(classes,
-                [&](DexClass* cls) { output << class_strs.at(cls).rdbuf(); });
+  redex::print_in_parallel(
+      output, classes, [](std::ostream& out, DexClass* cls) {
+        DexClassHasher(cls).print(out);
+      });
 }
 
 } // namespace hashing
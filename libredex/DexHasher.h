@@ -21,7 +21,11 @@
 #include <string>
 #include <vector>
 
+#include "ConcurrentContainers.h"
+
 class DexClass;
+class DexMethod;
+class IRCode;
 
 using Scope = std::vector<DexClass*>;
 
@@ -36,13 +40,52 @@ struct DexHash {
   size_t signature_hash;
 };
 
+// What the code of a method contributes to the hashes of its class.
+struct CodeHash {
+  size_t positions_hash{0};
+  size_t registers_hash{0};
+  size_t code_hash{0};
+};
+
+/*
+ * The hashes of the code of methods, keyed by the code and its mutation epoch
+ * (see IRCode::mutation_epoch), so that rehashing a scope after a pass only
+ * hashes the code that the pass edited.
+ *
+ * The hash of code also covers the names of the types and members it refers
+ * to, which can change without the code changing, so the cache must be
+ * cleared whenever that may have happened. Instructions that are edited in
+ * place without IRCode::mark_mutated are not noticed either, which is why the
+ * PassManager only uses a cache when asked to.
+ */
+class CodeHashCache final {
+ public:
+  // Whether there is a hash of the current code of `method`, in `hash`.
+  bool lookup(const DexMethod* method, const IRCode* code, CodeHash* hash);
+
+  void record(const DexMethod* method, const IRCode* code, CodeHash hash);
+
+  void clear() { m_entries.clear(); }
+
+ private:
+  struct Entry {
+    const IRCode* code{nullptr};
+    size_t mutation_epoch{0};
+    CodeHash hash;
+  };
+  ConcurrentMap<const DexMethod*, Entry> m_entries;
+};
+
 class DexScopeHasher final {
  public:
-  explicit DexScopeHasher(const Scope& scope) : m_scope(scope) {}
+  explicit DexScopeHasher(const Scope& scope,
+                          CodeHashCache* code_hashes /* nullable */ = nullptr)
+      : m_scope(scope), m_code_hashes(code_hashes) {}
   DexHash run();
 
  private:
   const Scope& m_scope;
+  CodeHashCache* m_code_hashes;
 };
 
 class DexClassHasher final {
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <assert.h>
+#include <memory>
 #include <string>
 
 #include "Debug.h"
@@ -24,7 +25,8 @@ class DexProto;
 class DexCallSite;
 class DexMethodHandle;
 
-class DexIdx {
+// Lazily loaded code holds on to its DexIdx, see DexCode::get_lazy_dex_code.
+class DexIdx : public std::enable_shared_from_this<DexIdx> {
  private:
   const uint8_t* m_dexbase;
 
@@ -83,7 +83,7 @@ void DexLoader::gather_input_stats(dex_stats_t* stats, const dex_header* dh) {
   std::unordered_set<uint32_t> anno_offsets;
 
   for (uint32_t cidx = 0; cidx < dh->class_defs_size; ++cidx) {
-    auto* clz = m_classes->at(cidx);
+    auto* clz = m_classes.at(cidx);
     if (clz == nullptr) {
       // Skip nulls, they may have been introduced by benign duplicate classes
       continue;
@@ -162,7 +162,7 @@ void DexLoader::gather_input_stats(dex_stats_t* stats, const dex_header* dh) {
   }
 
   const dex_map_list* map_list =
-      reinterpret_cast<const dex_map_list*>(m_file->const_data() + dh->map_off);
+      reinterpret_cast<const dex_map_list*>((const uint8_t*)dh + dh->map_off);
   bool header_seen = false;
   uint32_t header_index = 0;
   for (uint32_t i = 0; i < map_list->size; i++) {
@@ -447,14 +447,86 @@ void DexLoader::gather_input_stats(dex_stats_t* stats, const dex_header* dh) {
   }
 }
 
-void DexLoader::load_dex_class(int num) {
-  const dex_class_def* cdef = m_class_defs + num;
-  DexClass* dc = DexClass::create(m_idx.get(), cdef, m_dex_location);
-  // We may be inserting a nullptr here. Need to remove them later
-  //
-  // We're inserting nullptr because we can't mess up the indices of the other
-  // classes in the vector. This vector is used via random access.
-  m_classes->at(num) = dc;
+namespace {
+
+// Runs `fn` on the items in parallel, and rethrows all exceptions that the
+// workers raised together.
+template <typename Item, typename Fn>
+void run_rethrowing_all(const std::vector<Item>& items, const Fn& fn) {
+  auto num_threads = redex_parallel::default_num_threads();
+  std::vector<std::vector<std::exception_ptr>> exceptions_vec(num_threads);
+  workqueue_run<Item>(
+      [&](sparta::SpartaWorkerState<Item>* state, const Item& item) {
+        try {
+          fn(item);
+        } catch (const std::exception& exc) {
+          TRACE(MAIN, 1, "Worker throw the exception:%s", exc.what());
+          exceptions_vec[state->worker_id()].emplace_back(
+              std::current_exception());
+        }
+      },
+      items,
+      num_threads);
+
+  std::vector<std::exception_ptr> all_exceptions;
+  for (auto& exceptions : exceptions_vec) {
+    all_exceptions.insert(all_exceptions.end(), exceptions.begin(),
+                          exceptions.end());
+  }
+  if (!all_exceptions.empty()) {
+    // At least one of the workers raised an exception
+    aggregate_exception ae(all_exceptions);
+    throw ae;
+  }
+}
+
+} // namespace
+
+void DexLoader::claim_classes(const dex_header* dh, bool lazy_code) {
+  m_dh = dh;
+  m_lazy_code = lazy_code;
+  if (dh->class_defs_size == 0) {
+    return;
+  }
+  if (lazy_code) {
+    // Lazily loaded code references the DexIdx, which points into the mapping
+    // or the buffer.
+    m_idx = std::shared_ptr<DexIdx>(
+        new DexIdx(dh),
+        [file = m_file, buffer = m_buffer](DexIdx* idx) { delete idx; });
+  } else {
+    m_idx = std::make_shared<DexIdx>(dh);
+  }
+  auto off = (uint64_t)dh->class_defs_off;
+  m_class_defs =
+      reinterpret_cast<const dex_class_def*>((const uint8_t*)dh + off);
+  // We may be inserting a nullptr here, for benign duplicate classes. They
+  // are removed by finish_dex().
+  m_classes.resize(dh->class_defs_size);
+  for (size_t num = 0; num < m_classes.size(); ++num) {
+    m_classes[num] =
+        DexClass::claim(m_idx.get(), m_class_defs + num, m_dex_location);
+  }
+}
+
+void DexLoader::load_claimed_class(size_t num) {
+  if (m_classes[num] != nullptr) {
+    m_classes[num]->load_claimed(m_idx.get(), m_class_defs + num, m_lazy_code);
+  }
+}
+
+DexClasses DexLoader::finish_dex(dex_stats_t* stats) {
+  if (m_dh->class_defs_size == 0) {
+    return DexClasses(0);
+  }
+  gather_input_stats(stats, m_dh);
+
+  // Remove nulls from the classes list. They may have been introduced by benign
+  // duplicate classes.
+  m_classes.erase(std::remove(m_classes.begin(), m_classes.end(), nullptr),
+                  m_classes.end());
+
+  return std::move(m_classes);
 }
 
 const dex_header* DexLoader::get_dex_header(const char* location) {
@@ -468,62 +540,33 @@ const dex_header* DexLoader::get_dex_header(const char* location) {
 
 DexClasses DexLoader::load_dex(const char* location,
                                dex_stats_t* stats,
-                               int support_dex_version) {
+                               int support_dex_version,
+                               bool lazy_code) {
   const dex_header* dh = get_dex_header(location);
   validate_dex_header(dh, m_file->size(), support_dex_version);
-  return load_dex(dh, stats);
+  return load_dex(dh, stats, lazy_code);
 }
 
-DexClasses DexLoader::load_dex(const dex_header* dh, dex_stats_t* stats) {
-  if (dh->class_defs_size == 0) {
-    return DexClasses(0);
-  }
-  m_idx = std::make_unique<DexIdx>(dh);
-  auto off = (uint64_t)dh->class_defs_off;
-  m_class_defs =
-      reinterpret_cast<const dex_class_def*>((const uint8_t*)dh + off);
-  DexClasses classes(dh->class_defs_size);
-  m_classes = &classes;
-
-  {
-    auto num_threads = redex_parallel::default_num_threads();
-    std::vector<std::vector<std::exception_ptr>> exceptions_vec(num_threads);
-    std::vector<size_t> indices(dh->class_defs_size);
-    std::iota(indices.begin(), indices.end(), 0);
-    workqueue_run<size_t>(
-        [&exceptions_vec, this](sparta::SpartaWorkerState<size_t>* state,
-                                size_t num) {
-          try {
-            load_dex_class(num);
-          } catch (const std::exception& exc) {
-            TRACE(MAIN, 1, "Worker throw the exception:%s", exc.what());
-            exceptions_vec[state->worker_id()].emplace_back(
-                std::current_exception());
-          }
-        },
-        indices,
-        num_threads);
-
-    std::vector<std::exception_ptr> all_exceptions;
-    for (auto& exceptions : exceptions_vec) {
-      all_exceptions.insert(all_exceptions.end(), exceptions.begin(),
-                            exceptions.end());
-    }
-    if (!all_exceptions.empty()) {
-      // At least one of the workers raised an exception
-      aggregate_exception ae(all_exceptions);
-      throw ae;
-    }
-  }
-
-  gather_input_stats(stats, dh);
-
-  // Remove nulls from the classes list. They may have been introduced by benign
-  // duplicate classes.
-  classes.erase(std::remove(classes.begin(), classes.end(), nullptr),
-                classes.end());
+DexClasses DexLoader::load_dex(std::shared_ptr<const std::string> buffer,
+                               dex_stats_t* stats,
+                               int support_dex_version,
+                               bool lazy_code) {
+  m_buffer = std::move(buffer);
+  always_assert_log(m_buffer->size() >= sizeof(dex_header),
+                    "Dex %s is too small", m_dex_location.c_str());
+  auto dh = reinterpret_cast<const dex_header*>(m_buffer->data());
+  validate_dex_header(dh, m_buffer->size(), support_dex_version);
+  return load_dex(dh, stats, lazy_code);
+}
 
-  return classes;
+DexClasses DexLoader::load_dex(const dex_header* dh,
+                               dex_stats_t* stats,
+                               bool lazy_code) {
+  claim_classes(dh, lazy_code);
+  std::vector<size_t> indices(num_class_defs());
+  std::iota(indices.begin(), indices.end(), 0);
+  run_rethrowing_all(indices, [this](size_t num) { load_claimed_class(num); });
+  return finish_dex(stats);
 }
 
 static void balloon_all(const Scope& scope, bool throw_on_error) {
@@ -570,7 +613,8 @@ DexClasses load_classes_from_dex(const char* location,
                                  int support_dex_version) {
   TRACE(MAIN, 1, "Loading classes from dex from %s", location);
   DexLoader dl(location);
-  auto classes = dl.load_dex(location, stats, support_dex_version);
+  auto classes = dl.load_dex(location, stats, support_dex_version,
+                             /* lazy_code */ !balloon);
   if (balloon) {
     balloon_all(classes, throw_on_balloon_error);
   }
@@ -589,10 +633,71 @@ DexClasses load_classes_from_dex(const dex_header* dh,
   return classes;
 }
 
+DexClasses load_classes_from_dex(std::shared_ptr<const std::string> buffer,
+                                 const char* location,
+                                 dex_stats_t* stats,
+                                 bool balloon,
+                                 bool throw_on_balloon_error,
+                                 int support_dex_version) {
+  TRACE(MAIN, 1, "Loading classes from dex in memory from %s", location);
+  DexLoader dl(location);
+  auto classes = dl.load_dex(std::move(buffer), stats, support_dex_version,
+                             /* lazy_code */ !balloon);
+  if (balloon) {
+    balloon_all(classes, throw_on_balloon_error);
+  }
+  return classes;
+}
+
 std::string load_dex_magic_from_dex(const char* location) {
   DexLoader dl(location);
   auto dh = dl.get_dex_header(location);
   return dh->magic;
 }
 
+std::vector<DexClasses> load_classes_from_dexes(
+    const std::vector<std::string>& locations,
+    std::vector<dex_stats_t>* stats,
+    bool balloon,
+    bool throw_on_balloon_error,
+    int support_dex_version) {
+  // Claiming in the order of the files keeps the same classes as loading the
+  // files one after the other. Only the members are loaded in parallel, over
+  // the classes of all files at once.
+  std::vector<std::unique_ptr<DexLoader>> loaders;
+  std::vector<std::pair<DexLoader*, size_t>> classes_to_load;
+  for (const auto& location : locations) {
+    TRACE(MAIN, 1, "Loading classes from dex from %s", location.c_str());
+    loaders.push_back(std::make_unique<DexLoader>(location.c_str()));
+    auto& loader = *loaders.back();
+    const dex_header* dh = loader.get_dex_header(location.c_str());
+    validate_dex_header(dh, loader.get_dex_size(), support_dex_version);
+    loader.claim_classes(dh, /* lazy_code */ !balloon);
+    for (size_t num = 0; num < loader.num_class_defs(); ++num) {
+      classes_to_load.emplace_back(&loader, num);
+    }
+  }
+  run_rethrowing_all(classes_to_load,
+                     [](const std::pair<DexLoader*, size_t>& p) {
+                       p.first->load_claimed_class(p.second);
+                     });
+
+  std::vector<DexClasses> result;
+  result.reserve(loaders.size());
+  Scope all_classes;
+  for (auto& loader : loaders) {
+    dex_stats_t dex_stats;
+    result.push_back(loader->finish_dex(&dex_stats));
+    if (stats != nullptr) {
+      stats->push_back(dex_stats);
+    }
+    all_classes.insert(all_classes.end(), result.back().begin(),
+                       result.back().end());
+  }
+  if (balloon) {
+    balloon_all(all_classes, throw_on_balloon_error);
+  }
+  return result;
+}
+
 void balloon_for_test(const Scope& scope) { balloon_all(scope, true); }
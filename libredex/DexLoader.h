@@ -16,25 +16,59 @@
 #include "DexUtil.h"
 
 class DexLoader {
-  std::unique_ptr<DexIdx> m_idx;
+  std::shared_ptr<DexIdx> m_idx;
+  const dex_header* m_dh{nullptr};
   const dex_class_def* m_class_defs;
-  DexClasses* m_classes;
-  std::unique_ptr<boost::iostreams::mapped_file> m_file;
+  DexClasses m_classes;
+  std::shared_ptr<boost::iostreams::mapped_file> m_file;
+  std::shared_ptr<const std::string> m_buffer;
   std::string m_dex_location;
+  bool m_lazy_code{false};
 
  public:
   explicit DexLoader(const char* location);
 
   const dex_header* get_dex_header(const char* location);
+  // The size of the file mapped by get_dex_header().
+  size_t get_dex_size() const { return m_file->size(); }
+  /*
+   * With `lazy_code`, only the classes and their members are loaded up front.
+   * Method code and debug info are decoded on first access, and keep the
+   * memory-mapped dex alive until then.
+   */
   DexClasses load_dex(const char* location,
                       dex_stats_t* stats,
-                      int support_dex_version);
-  DexClasses load_dex(const dex_header* dh, dex_stats_t* stats);
-  void load_dex_class(int num);
+                      int support_dex_version,
+                      bool lazy_code = false);
+  // Loads the dex held in `buffer`, e.g. inflated from an APK. With
+  // `lazy_code`, the buffer is kept alive like a mapped dex.
+  DexClasses load_dex(std::shared_ptr<const std::string> buffer,
+                      dex_stats_t* stats,
+                      int support_dex_version,
+                      bool lazy_code = false);
+  // With `lazy_code`, `dh` must be in the file mapped by get_dex_header or in
+  // the buffer given to load_dex.
+  DexClasses load_dex(const dex_header* dh,
+                      dex_stats_t* stats,
+                      bool lazy_code = false);
+
+  /*
+   * The steps of load_dex(). claim_classes() claims the types of the class
+   * definitions in order, so that of duplicate classes, the first one is kept
+   * deterministically. load_claimed_class() loads the members of a claimed
+   * class, concurrently for different classes. Claiming the classes of all
+   * dexes in order before loading any lets many dexes load in parallel, see
+   * load_classes_from_dexes().
+   */
+  void claim_classes(const dex_header* dh, bool lazy_code);
+  size_t num_class_defs() const { return m_classes.size(); }
+  void load_claimed_class(size_t num);
+  DexClasses finish_dex(dex_stats_t* stats);
   void gather_input_stats(dex_stats_t* stats, const dex_header* dh);
   DexIdx* get_idx() { return m_idx.get(); }
 };
 
+// Without `balloon`, method code is decoded lazily, see DexLoader::load_dex.
 DexClasses load_classes_from_dex(const char* location,
                                  bool balloon = true,
                                  bool throw_on_balloon_error = true,
@@ -48,6 +82,21 @@ DexClasses load_classes_from_dex(const dex_header* dh,
                                  const char* location,
                                  bool balloon = true,
                                  bool throw_on_balloon_error = true);
+DexClasses load_classes_from_dex(std::shared_ptr<const std::string> buffer,
+                                 const char* location,
+                                 dex_stats_t* stats,
+                                 bool balloon = true,
+                                 bool throw_on_balloon_error = true,
+                                 int support_dex_version = 35);
+// Loads the dex files like successive calls to load_classes_from_dex() would,
+// keeping the first of duplicate classes, but loads all of them in parallel.
+// Returns the classes of each file, and their stats into `stats` if given.
+std::vector<DexClasses> load_classes_from_dexes(
+    const std::vector<std::string>& locations,
+    std::vector<dex_stats_t>* stats,
+    bool balloon = true,
+    bool throw_on_balloon_error = true,
+    int support_dex_version = 35);
 std::string load_dex_magic_from_dex(const char* location);
 void balloon_for_test(const Scope& scope);
 
@@ -18,6 +18,7 @@
 #include <list>
 #include <memory>
 #include <stdlib.h>
+#include <string_view>
 #include <sys/stat.h>
 #include <unordered_set>
 
@@ -48,6 +49,7 @@
 #include "Macros.h"
 #include "MethodProfiles.h"
 #include "MethodSimilarityOrderer.h"
+#include "ParallelPrint.h"
 #include "Pass.h"
 #include "Resolver.h"
 #include "Sha1.h"
@@ -129,6 +131,45 @@ GatheredTypes::keep_cls_strings_together_emitlist() {
       CustomSort<DexString, cmp_dstring>(m_cls_strings, compare_dexstrings));
 }
 
+std::vector<const DexString*>
+GatheredTypes::get_startup_order_dexstring_emitlist() {
+  // The strings of the methods that cold start executes come first, in the
+  // order in which those methods are first called, so that the string data
+  // touched during startup spans few pages. This only moves string data
+  // items; the string ids keep their required sort order.
+  auto startup_methods = get_startup_methods();
+  std::vector<const DexMethod*> methods;
+  walk::methods(*m_classes, [&](DexMethod* m) {
+    if (startup_methods.count(m)) {
+      methods.push_back(m);
+    }
+  });
+  std::stable_sort(methods.begin(), methods.end(),
+                   [&](const DexMethod* a, const DexMethod* b) {
+                     return startup_methods.at(a) < startup_methods.at(b);
+                   });
+  std::unordered_map<const DexString*, unsigned int> startup_strings;
+  unsigned int index = 0;
+  for (const auto* m : methods) {
+    // The name and signature are read when the method is linked, and the
+    // code's const-string loads when it runs. Annotations are mostly cold.
+    std::vector<const DexString*> method_strings;
+    m->gather_strings_shallow(method_strings);
+    if (const auto* code = m->get_code()) {
+      code->gather_strings(method_strings);
+    }
+    for (const auto* s : method_strings) {
+      if (startup_strings.emplace(s, index).second) {
+        index++;
+      }
+    }
+  }
+  TRACE(CUSTOMSORT, 2, "%zu startup strings from %zu startup methods",
+        startup_strings.size(), methods.size());
+  return get_dexstring_emitlist(
+      CustomSort<DexString, cmp_dstring>(startup_strings, compare_dexstrings));
+}
+
 std::vector<DexMethodHandle*> GatheredTypes::get_dexmethodhandle_emitlist() {
   return m_lmethodhandle;
 }
@@ -192,6 +233,58 @@ void GatheredTypes::sort_dexmethod_emitlist_profiled_order(
   std::stable_sort(lmeth.begin(), lmeth.end(), std::ref(comparator));
 }
 
+std::unordered_map<const DexMethod*, double>
+GatheredTypes::get_startup_methods() {
+  std::unordered_map<const DexMethod*, double> startup_methods;
+  if (m_config == nullptr) {
+    return startup_methods;
+  }
+  const auto& method_profiles = m_config->get_method_profiles();
+  if (!method_profiles.has_stats()) {
+    return startup_methods;
+  }
+  MethodProfileOrderingConfig* config =
+      m_config->get_global_config()
+          .get_config_by_name<MethodProfileOrderingConfig>(
+              "method_profile_order");
+  // Older aggregate profiles only have cold start, without an interaction id.
+  const auto* stats_map =
+      &method_profiles.method_stats(method_profiles::COLD_START);
+  if (stats_map->empty()) {
+    stats_map = &method_profiles.method_stats("");
+  }
+  for (const auto& [method_ref, stat] : *stats_map) {
+    if (stat.appear_percent < config->min_appear_percent) {
+      continue;
+    }
+    auto* method = method_ref->as_def();
+    if (method != nullptr) {
+      startup_methods.emplace(method, stat.order_percent);
+    }
+  }
+  return startup_methods;
+}
+
+void GatheredTypes::sort_dexmethod_emitlist_startup_order(
+    std::vector<DexMethod*>& lmeth) {
+  // Startup methods come first, in the order in which they are first called,
+  // so that the pages of code touched during cold start are few and
+  // contiguous. All other methods keep their relative order.
+  auto startup_methods = get_startup_methods();
+  std::stable_sort(lmeth.begin(), lmeth.end(),
+                   [&](const DexMethod* a, const DexMethod* b) {
+                     auto a_it = startup_methods.find(a);
+                     auto b_it = startup_methods.find(b);
+                     if (b_it == startup_methods.end()) {
+                       return a_it != startup_methods.end();
+                     }
+                     if (a_it == startup_methods.end()) {
+                       return false;
+                     }
+                     return a_it->second < b_it->second;
+                   });
+}
+
 void GatheredTypes::sort_dexmethod_emitlist_clinit_order(
     std::vector<DexMethod*>& lmeth) {
   std::stable_sort(lmeth.begin(), lmeth.end(),
@@ -465,7 +558,8 @@ DexOutput::DexOutput(
     std::unordered_map<DexMethod*, uint64_t>* method_to_id,
     std::unordered_map<DexCode*, std::vector<DebugLineItem>>* code_debug_lines,
     PostLowering* post_lowering,
-    int min_sdk)
+    int min_sdk,
+    DexOutputSequencer* sequencer)
     : m_classes(classes),
       m_gtypes(std::move(gtypes)),
       // Required because the BytecodeDebugger setting creates huge amounts
@@ -474,13 +568,15 @@ DexOutput::DexOutput(
                          ? get_dex_output_size(config_files) * 2
                          : get_dex_output_size(config_files)) +
                     k_output_red_zone),
-      m_output(std::make_unique<uint8_t[]>(m_output_size)),
+      m_output(static_cast<uint8_t*>(calloc(m_output_size, 1)), free),
       m_offset(0),
       m_iodi_metadata(iodi_metadata),
       m_config_files(config_files),
-      m_min_sdk(min_sdk) {
-  // Ensure a clean slate.
-  memset(m_output.get(), 0, m_output_size);
+      m_min_sdk(min_sdk),
+      m_sequencer(sequencer) {
+  always_assert_log(m_output != nullptr,
+                    "Failed to allocate %zu bytes for the output dex",
+                    m_output_size);
 
   m_dodx = std::make_unique<DexOutputIdx>(*m_gtypes->get_dodx(m_output.get()));
 
@@ -684,6 +780,9 @@ void DexOutput::generate_string_data(SortMode mode) {
   } else if (mode == SortMode::CLASS_STRINGS) {
     TRACE(CUSTOMSORT, 2, "using class names pack for string pool sorting");
     string_order = m_gtypes->keep_cls_strings_together_emitlist();
+  } else if (mode == SortMode::METHOD_STARTUP_ORDER) {
+    TRACE(CUSTOMSORT, 2, "using startup order for string pool sorting");
+    string_order = m_gtypes->get_startup_order_dexstring_emitlist();
   } else {
     TRACE(CUSTOMSORT, 2, "using default string pool sorting");
     string_order = m_gtypes->get_dexstring_emitlist();
@@ -938,8 +1037,7 @@ void DexOutput::generate_class_data_items() {
   insert_map_item(TYPE_CLASS_DATA_ITEM, count, cdi_start, m_offset - cdi_start);
 }
 
-static void sync_all(const Scope& scope) {
-  constexpr bool serial = false; // for debugging
+static void sync_all(const Scope& scope, bool serial) {
   auto fn = [&](DexMethod* m, IRCode&) {
     if (serial) {
       TRACE(MTRANS, 2, "Syncing %s", SHOW(m));
@@ -961,7 +1059,9 @@ void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
    * emitlist to optimize pagecache efficiency.
    */
   uint32_t ci_start = align(m_offset);
-  sync_all(*m_classes);
+  // When dexes are emitted concurrently, don't nest another level of
+  // parallelism.
+  sync_all(*m_classes, /* serial */ m_sequencer != nullptr);
 
   // Get all methods.
   std::vector<DexMethod*> lmeth = m_gtypes->get_dexmethod_emitlist();
@@ -992,12 +1092,21 @@ void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
       TRACE(CUSTOMSORT, 2, "using method refs order");
       m_gtypes->sort_dexmethod_emitlist_method_ref_order(lmeth);
       break;
+    case SortMode::METHOD_STARTUP_ORDER:
+      TRACE(CUSTOMSORT, 2, "using method startup order for bytecode sorting");
+      m_gtypes->sort_dexmethod_emitlist_startup_order(lmeth);
+      break;
     case SortMode::DEFAULT:
       TRACE(CUSTOMSORT, 2, "using default sorting order");
       m_gtypes->sort_dexmethod_emitlist_default_order(lmeth);
       break;
     }
   }
+  // Estimate how many pages of code cold start touches, assuming that all of
+  // a startup method's code item gets paged in.
+  constexpr uint32_t kPageSize = 4096;
+  auto startup_methods = m_gtypes->get_startup_methods();
+  boost::optional<uint32_t> last_startup_page;
   for (DexMethod* meth : lmeth) {
     if (meth->get_access() & (ACC_ABSTRACT | ACC_NATIVE)) {
       // There is no code item for ABSTRACT or NATIVE methods.
@@ -1019,6 +1128,16 @@ void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
                                    (dex_code_item*)(m_output.get() + m_offset));
     auto insns_size =
         ((const dex_code_item*)(m_output.get() + m_offset))->insns_size;
+    if (startup_methods.count(meth)) {
+      uint32_t first_page = m_offset / kPageSize;
+      uint32_t last_page = (m_offset + size - 1) / kPageSize;
+      if (last_startup_page && *last_startup_page == first_page) {
+        first_page++;
+      }
+      m_stats.num_startup_code_items++;
+      m_stats.startup_code_pages += last_page + 1 - first_page;
+      last_startup_page = last_page;
+    }
     inc_offset(size);
     m_stats.num_instructions += code->get_instructions().size();
     m_stats.instruction_bytes += insns_size * 2;
@@ -1084,11 +1203,52 @@ void DexOutput::check_method_instruction_size_limit(const ConfigFiles& conf,
   }
 }
 
+namespace {
+
+// Encodes the static values of `cls` as the elements of an encoded array,
+// without the trailing zero values that the runtime implies. Returns false
+// if all of them are zero. This writes straight from the fields, instead of
+// cloning their values into a DexEncodedValueArray first.
+bool encode_static_values(DexOutputIdx* dodx,
+                          const DexClass* cls,
+                          uint8_t*& encdata) {
+  const auto& sfields = cls->get_sfields();
+  auto size = sfields.size();
+  while (size > 0 && sfields[size - 1]->get_static_value()->is_zero()) {
+    --size;
+  }
+  if (size == 0) {
+    return false;
+  }
+  encdata = write_uleb128(encdata, (uint32_t)size);
+  for (size_t i = 0; i < size; ++i) {
+    sfields[i]->get_static_value()->encode(dodx, encdata);
+  }
+  return true;
+}
+
+} // namespace
+
 void DexOutput::generate_static_values() {
   uint32_t sv_start = m_offset;
-  std::unordered_map<DexEncodedValueArray, uint32_t,
-                     boost::hash<DexEncodedValueArray>>
-      enc_arrays;
+  // Each array is encoded in place, and deduplicated on its bytes. In one
+  // dex, equal bytes mean equal values, since the indices of the strings,
+  // types and members they refer to are fixed by now.
+  std::unordered_map<std::string_view, uint32_t> enc_arrays;
+  auto emit = [&](const uint8_t* output) {
+    std::string_view bytes(reinterpret_cast<const char*>(m_output.get()) +
+                               m_offset,
+                           output - (m_output.get() + m_offset));
+    auto [it, emplaced] = enc_arrays.emplace(bytes, m_offset);
+    if (!emplaced) {
+      // Keep the unused space zeroed like the rest of the buffer.
+      memset(m_output.get() + m_offset, 0, bytes.size());
+      return it->second;
+    }
+    inc_offset(bytes.size());
+    m_stats.num_static_values++;
+    return it->second;
+  };
   for (uint32_t i = 0; i < hdr.class_defs_size; i++) {
     DexClass* clz = m_classes->at(i);
     // Fields need to be sorted otherwise static values may end up out of order
@@ -1096,19 +1256,10 @@ void DexOutput::generate_static_values() {
     std::sort(sfields.begin(), sfields.end(), compare_dexfields);
     auto& ifields = clz->get_ifields();
     std::sort(ifields.begin(), ifields.end(), compare_dexfields);
-    std::unique_ptr<DexEncodedValueArray> deva(clz->get_static_values());
-    if (!deva) continue;
-    if (enc_arrays.count(*deva)) {
-      m_static_values[clz] = enc_arrays.at(*deva);
-    } else {
-      uint8_t* output = m_output.get() + m_offset;
-      uint8_t* outputsv = output;
-      /* No alignment requirements */
-      deva->encode(m_dodx.get(), output);
-      enc_arrays.emplace(std::move(*deva.release()), m_offset);
-      m_static_values[clz] = m_offset;
-      inc_offset(output - outputsv);
-      m_stats.num_static_values++;
+    /* No alignment requirements */
+    uint8_t* output = m_output.get() + m_offset;
+    if (encode_static_values(m_dodx.get(), clz, output)) {
+      m_static_values[clz] = emit(output);
     }
   }
   {
@@ -1116,18 +1267,9 @@ void DexOutput::generate_static_values() {
     for (uint32_t i = 0; i < callsites.size(); i++) {
       auto callsite = callsites[i];
       auto eva = callsite->as_encoded_value_array();
-      uint32_t offset;
-      if (enc_arrays.count(eva)) {
-        offset = m_call_site_items[callsite] = enc_arrays.at(eva);
-      } else {
-        uint8_t* output = m_output.get() + m_offset;
-        uint8_t* outputsv = output;
-        eva.encode(m_dodx.get(), output);
-        enc_arrays.emplace(std::move(eva), m_offset);
-        offset = m_call_site_items[callsite] = m_offset;
-        inc_offset(output - outputsv);
-        m_stats.num_static_values++;
-      }
+      uint8_t* output = m_output.get() + m_offset;
+      eva.encode(m_dodx.get(), output);
+      m_call_site_items[callsite] = emit(output);
     }
   }
   if (!m_static_values.empty() || !m_call_site_items.empty()) {
@@ -2725,38 +2867,39 @@ void write_pg_mapping(
 
   std::ofstream ofs(filename.c_str(), std::ofstream::out | std::ofstream::app);
 
-  for (auto cls : *classes) {
+  auto print_class = [&](std::ostream& out, DexClass* cls) {
     auto deobf_cls = deobf_class(cls);
-    ofs << java_names::internal_to_external(deobf_cls) << " -> "
+    out << java_names::internal_to_external(deobf_cls) << " -> "
         << java_names::internal_to_external(cls->get_type()->c_str()) << ":"
         << std::endl;
     for (auto field : cls->get_ifields()) {
       auto deobf = deobf_field(field);
-      ofs << "    " << deobf << " -> " << field->c_str() << std::endl;
+      out << "    " << deobf << " -> " << field->c_str() << std::endl;
     }
     for (auto field : cls->get_sfields()) {
       auto deobf = deobf_field(field);
-      ofs << "    " << deobf << " -> " << field->c_str() << std::endl;
+      out << "    " << deobf << " -> " << field->c_str() << std::endl;
     }
     for (auto meth : cls->get_dmethods()) {
       auto deobf = deobf_meth(meth);
-      ofs << "    " << deobf << " -> " << meth->c_str() << std::endl;
+      out << "    " << deobf << " -> " << meth->c_str() << std::endl;
     }
     for (auto meth : cls->get_vmethods()) {
       auto deobf = deobf_meth(meth);
-      ofs << "    " << deobf << " -> " << meth->c_str() << std::endl;
+      out << "    " << deobf << " -> " << meth->c_str() << std::endl;
     }
     if (detached_methods) {
       auto it = detached_methods->find(cls);
       if (it != detached_methods->end()) {
-        ofs << "    --- detached methods ---" << std::endl;
+        out << "    --- detached methods ---" << std::endl;
         for (auto meth : it->second) {
           auto deobf = deobf_meth(meth);
-          ofs << "    " << deobf << " -> " << meth->c_str() << std::endl;
+          out << "    " << deobf << " -> " << meth->c_str() << std::endl;
         }
       }
     }
-  }
+  };
+  redex::print_in_parallel(ofs, *classes, print_class);
 }
 
 void write_full_mapping(const std::string& filename, DexClasses* classes) {
@@ -2842,11 +2985,36 @@ void DexOutput::prepare(SortMode string_mode,
   generate_callsite_data();
   generate_methodhandle_data();
   generate_annotations();
-  generate_debug_items();
+  in_order(DexOutputSequencer::Step::DebugItems,
+           [this] { generate_debug_items(); });
   generate_map();
   finalize_header();
-  compute_method_to_id_map(m_dodx.get(), m_classes, hdr.signature,
-                           m_method_to_id);
+  in_order(DexOutputSequencer::Step::MethodIds, [this] {
+    compute_method_to_id_map(m_dodx.get(), m_classes, hdr.signature,
+                             m_method_to_id);
+  });
+}
+
+void DexOutput::replay(const DexOutputCache::Entry& entry) {
+  always_assert(entry.dex.size() >= sizeof(hdr));
+  always_assert(entry.dex.size() + k_output_red_zone < m_output_size);
+  memcpy(m_output.get(), entry.dex.data(), entry.dex.size());
+  m_offset = entry.dex.size();
+  memcpy(&hdr, entry.dex.data(), sizeof(hdr));
+  m_stats = entry.stats;
+  m_method_bytecode_offsets = entry.bytecode_offsets;
+  // There are no debug items or method ids to compute, but the steps must
+  // still be taken so as not to hold up the following dexes.
+  in_order(DexOutputSequencer::Step::DebugItems, [] {});
+  in_order(DexOutputSequencer::Step::MethodIds, [] {});
+}
+
+DexOutputCache::Entry DexOutput::to_cache_entry() const {
+  DexOutputCache::Entry entry;
+  entry.dex.assign(reinterpret_cast<const char*>(m_output.get()), m_offset);
+  entry.stats = m_stats;
+  entry.bytecode_offsets = m_method_bytecode_offsets;
+  return entry;
 }
 
 void DexOutput::write() {
@@ -2854,6 +3022,8 @@ void DexOutput::write() {
   int fd = open(m_filename, O_CREAT | O_TRUNC | O_WRONLY | O_BINARY, 0660);
   if (fd == -1) {
     perror("Error writing dex");
+    // Don't hold up the following dexes.
+    in_order(DexOutputSequencer::Step::SymbolFiles, [] {});
     return;
   }
   ::write(fd, m_output.get(), m_offset);
@@ -2862,7 +3032,8 @@ void DexOutput::write() {
   }
   close(fd);
 
-  write_symbol_files();
+  in_order(DexOutputSequencer::Step::SymbolFiles,
+           [this] { write_symbol_files(); });
 }
 
 class UniqueReferences {
@@ -2882,6 +3053,10 @@ class UniqueReferences {
 UniqueReferences s_unique_references;
 
 void DexOutput::metrics() {
+  in_order(DexOutputSequencer::Step::Metrics, [this] { update_metrics(); });
+}
+
+void DexOutput::update_metrics() {
   if (s_unique_references.dexes++ == 1 && !m_normal_primary_dex) {
     // clear out info from first (primary) dex
     s_unique_references.strings.clear();
@@ -2942,6 +3117,8 @@ static SortMode make_sort_bytecode(const std::string& sort_bytecode) {
     return SortMode::METHOD_PROFILED_ORDER;
   } else if (sort_bytecode == "method_similarity_order") {
     return SortMode::METHOD_SIMILARITY;
+  } else if (sort_bytecode == "method_startup_order") {
+    return SortMode::METHOD_STARTUP_ORDER;
   } else {
     return SortMode::DEFAULT;
   }
@@ -2963,7 +3140,10 @@ dex_stats_t write_classes_to_dex(
     const std::string& dex_magic,
     PostLowering* post_lowering,
     int min_sdk,
-    bool disable_method_similarity_order) {
+    bool disable_method_similarity_order,
+    DexOutputSequencer* sequencer,
+    DexOutputCache* cache,
+    const std::string& cache_key) {
   const JsonWrapper& json_cfg = conf.get_json_config();
   bool force_single_dex = json_cfg.get("force_single_dex", false);
   if (force_single_dex) {
@@ -2975,6 +3155,8 @@ dex_stats_t write_classes_to_dex(
     string_sort_mode = SortMode::CLASS_STRINGS;
   } else if (sort_strings == "class_order") {
     string_sort_mode = SortMode::CLASS_ORDER;
+  } else if (sort_strings == "startup_order") {
+    string_sort_mode = SortMode::METHOD_STARTUP_ORDER;
   }
 
   auto interdex_config = json_cfg.get("InterDexPass", Json::Value());
@@ -3007,9 +3189,21 @@ dex_stats_t write_classes_to_dex(
   DexOutput dout(filename.c_str(), classes, std::move(gtypes), locator_index,
                  normal_primary_dex, store_number, dex_number,
                  redex_options.debug_info_kind, iodi_metadata, conf, pos_mapper,
-                 method_to_id, code_debug_lines, post_lowering, min_sdk);
-
-  dout.prepare(string_sort_mode, code_sort_mode, conf, dex_magic);
+                 method_to_id, code_debug_lines, post_lowering, min_sdk,
+                 sequencer);
+
+  DexOutputCache::Entry entry;
+  if (cache != nullptr && !cache_key.empty() &&
+      cache->lookup(cache_key, &entry)) {
+    TRACE(OPUT, 2, "[write_classes_to_dex] reusing cached %s",
+          filename.c_str());
+    dout.replay(entry);
+  } else {
+    dout.prepare(string_sort_mode, code_sort_mode, conf, dex_magic);
+    if (cache != nullptr && !cache_key.empty()) {
+      cache->record(cache_key, dout.to_cache_entry());
+    }
+  }
   dout.write();
   dout.metrics();
   return dout.m_stats;
@@ -3053,6 +3247,44 @@ LocatorIndex make_locator_index(DexStoresVector& stores) {
   return index;
 }
 
+void DexOutput::in_order(DexOutputSequencer::Step step,
+                         const std::function<void()>& fn) {
+  if (m_sequencer == nullptr) {
+    fn();
+    return;
+  }
+  m_sequencer->run_in_order(step, m_dex_number, fn);
+}
+
+void DexOutputSequencer::run_in_order(Step step,
+                                      size_t dex_number,
+                                      const std::function<void()>& fn) {
+  auto& next = m_next[static_cast<size_t>(step)];
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [&] { return next == dex_number; });
+  }
+  fn();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++next;
+  }
+  m_cv.notify_all();
+}
+
+void DexOutputSequencer::finish(size_t dex_number) {
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (auto& next : m_next) {
+      m_cv.wait(lock, [&] { return next >= dex_number; });
+      if (next == dex_number) {
+        ++next;
+      }
+    }
+  }
+  m_cv.notify_all();
+}
+
 void DexOutput::inc_offset(uint32_t v) {
   // If this asserts hits, we already wrote out of bounds.
   always_assert(m_offset + v < m_output_size);
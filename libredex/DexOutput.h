@@ -7,7 +7,11 @@
 
 #pragma once
 
+#include <array>
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 
 #include <boost/optional/optional.hpp>
@@ -15,6 +19,7 @@
 #include "ConfigFiles.h"
 #include "DexClass.h"
 #include "DexMethodHandle.h"
+#include "DexOutputCache.h"
 #include "DexStats.h"
 #include "DexUtil.h"
 #include "Pass.h"
@@ -46,6 +51,7 @@ enum class SortMode {
   CLINIT_FIRST,
   METHOD_PROFILED_ORDER,
   METHOD_SIMILARITY,
+  METHOD_STARTUP_ORDER,
   DEFAULT
 };
 
@@ -130,6 +136,61 @@ class DexOutputIdx {
 class IODIMetadata;
 class GatheredTypes;
 
+/*
+ * Allows the dexes of a store to be emitted concurrently while keeping the
+ * output identical to serial emission. The steps of DexOutput that update
+ * state shared between dexes -- the position mapper, the IODI metadata, the
+ * debug line map, the symbol files and the statistics -- run for one dex at
+ * a time, in the order of the dex numbers.
+ *
+ * Every dex number from 0 up must eventually run every step, otherwise later
+ * dexes wait forever. A Guard ensures this when a dex fails.
+ */
+class DexOutputSequencer {
+ public:
+  enum class Step : size_t {
+    DebugItems,
+    MethodIds,
+    SymbolFiles,
+    Metrics,
+    Count,
+  };
+
+  /*
+   * Marks the steps that a dex did not run as done when it goes out of scope,
+   * so that an exception thrown while emitting the dex does not leave the
+   * following dexes waiting. Create one per dex before its first step.
+   */
+  class Guard {
+   public:
+    Guard(DexOutputSequencer* sequencer /* nullable */, size_t dex_number)
+        : m_sequencer(sequencer), m_dex_number(dex_number) {}
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+    ~Guard() {
+      if (m_sequencer != nullptr) {
+        m_sequencer->finish(m_dex_number);
+      }
+    }
+
+   private:
+    DexOutputSequencer* m_sequencer;
+    size_t m_dex_number;
+  };
+
+  void run_in_order(Step step, size_t dex_number,
+                    const std::function<void()>& fn);
+
+ private:
+  // Takes every step that `dex_number` has not taken yet, without doing
+  // anything, once the previous dexes took it.
+  void finish(size_t dex_number);
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::array<size_t, static_cast<size_t>(Step::Count)> m_next{};
+};
+
 dex_stats_t write_classes_to_dex(
     const RedexOptions&,
     const std::string& filename,
@@ -146,7 +207,10 @@ dex_stats_t write_classes_to_dex(
     const std::string& dex_magic,
     PostLowering* post_lowering = nullptr,
     int min_sdk = 0,
-    bool disable_method_similarity_order = false);
+    bool disable_method_similarity_order = false,
+    DexOutputSequencer* sequencer /* nullable */ = nullptr,
+    DexOutputCache* cache /* nullable */ = nullptr,
+    const std::string& cache_key = "");
 
 using cmp_dstring = bool (*)(const DexString*, const DexString*);
 using cmp_dtype = bool (*)(const DexType*, const DexType*);
@@ -254,6 +318,7 @@ class GatheredTypes {
       T cmp = compare_dexstrings);
   std::vector<const DexString*> get_cls_order_dexstring_emitlist();
   std::vector<const DexString*> keep_cls_strings_together_emitlist();
+  std::vector<const DexString*> get_startup_order_dexstring_emitlist();
   std::vector<DexMethod*> get_dexmethod_emitlist();
   std::vector<DexMethodHandle*> get_dexmethodhandle_emitlist();
   std::vector<DexCallSite*> get_dexcallsite_emitlist();
@@ -265,6 +330,10 @@ class GatheredTypes {
   void sort_dexmethod_emitlist_cls_order(std::vector<DexMethod*>& lmeth);
   void sort_dexmethod_emitlist_clinit_order(std::vector<DexMethod*>& lmeth);
   void sort_dexmethod_emitlist_profiled_order(std::vector<DexMethod*>& lmeth);
+  void sort_dexmethod_emitlist_startup_order(std::vector<DexMethod*>& lmeth);
+  // The methods that cold start commonly executes, with the average
+  // percentile of the time of their first call. Empty without profiles.
+  std::unordered_map<const DexMethod*, double> get_startup_methods();
   void set_config(ConfigFiles* config);
 
   std::unordered_set<const DexString*> index_type_names();
@@ -311,7 +380,9 @@ class DexOutput {
   std::unique_ptr<DexOutputIdx> m_dodx;
   std::shared_ptr<GatheredTypes> m_gtypes;
   const size_t m_output_size;
-  std::unique_ptr<uint8_t[]> m_output;
+  // Sized for the largest possible dex, and zero-filled by calloc. Pages past
+  // the end of the actual dex are never touched, and so never committed.
+  std::unique_ptr<uint8_t[], void (*)(void*)> m_output;
   uint32_t m_offset;
   const char* m_filename;
   size_t m_store_number;
@@ -338,6 +409,7 @@ class DexOutput {
   bool m_normal_primary_dex;
   const ConfigFiles& m_config_files;
   int m_min_sdk;
+  DexOutputSequencer* m_sequencer;
 
   void insert_map_item(uint16_t maptype,
                        uint32_t size,
@@ -378,6 +450,7 @@ class DexOutput {
   void finalize_header();
   void init_header_offsets(const std::string& dex_magic);
   void write_symbol_files();
+  void update_metrics();
   uint32_t align(uint32_t offset) { return (offset + 3) & ~3; }
   void align_output() { m_offset = align(m_offset); }
   void emit_locator(Locator locator);
@@ -388,6 +461,9 @@ class DexOutput {
 
   void inc_offset(uint32_t v);
 
+  // Runs `fn` in dex order if emitting concurrently, directly otherwise.
+  void in_order(DexOutputSequencer::Step step, const std::function<void()>& fn);
+
   friend struct DexOutputTestHelper;
 
  public:
@@ -406,11 +482,17 @@ class DexOutput {
             std::unordered_map<DexCode*, std::vector<DebugLineItem>>*
                 code_debug_lines,
             PostLowering* post_lowering = nullptr,
-            int min_sdk = 0);
+            int min_sdk = 0,
+            DexOutputSequencer* sequencer = nullptr);
   void prepare(SortMode string_mode,
                const std::vector<SortMode>& code_mode,
                ConfigFiles& conf,
                const std::string& dex_magic);
+  // Takes the place of prepare() for a dex whose classes are unchanged since
+  // `entry` was recorded.
+  void replay(const DexOutputCache::Entry& entry);
+  // The result of prepare(), to replay it in later builds.
+  DexOutputCache::Entry to_cache_entry() const;
   void write();
   void metrics();
   static void check_method_instruction_size_limit(const ConfigFiles& conf,
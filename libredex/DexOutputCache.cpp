@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "DexOutputCache.h"
+
+#include <boost/filesystem.hpp>
+#include <json/json.h>
+#include <sstream>
+#include <type_traits>
+
+#include "ConfigFiles.h"
+#include "DexClass.h"
+#include "DexHasher.h"
+#include "RedexOptions.h"
+#include "Trace.h"
+
+namespace {
+
+// Bump when the format of the entries or the keys changes, or when DexOutput
+// changes how it encodes dexes.
+constexpr const char* kFormatVersion = "1";
+
+static_assert(std::is_trivially_copyable_v<dex_stats_t>,
+              "dex_stats_t is stored as raw bytes");
+
+// These orders depend on method profiles, which the keys don't capture.
+bool is_profile_order(const std::string& mode) {
+  return mode == "method_profiled_order" || mode == "method_startup_order" ||
+         mode == "startup_order";
+}
+
+void write_u32(std::ostream& out, uint32_t value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+uint32_t read_u32(std::istream& in) {
+  uint32_t value = 0;
+  in.read(reinterpret_cast<char*>(&value), sizeof(value));
+  return value;
+}
+
+std::string read_string(std::istream& in, uint32_t size) {
+  std::string str(size, '\0');
+  in.read(str.data(), size);
+  return str;
+}
+
+} // namespace
+
+std::unique_ptr<DexOutputCache> DexOutputCache::create(
+    const ConfigFiles& conf,
+    const RedexOptions& redex_options,
+    const std::string& dex_magic,
+    bool emit_locators,
+    bool post_lowering) {
+  const auto& json_cfg = conf.get_json_config();
+  std::string dir;
+  json_cfg.get("dex_output_cache_dir", "", dir);
+  if (dir.empty()) {
+    return nullptr;
+  }
+  if (redex_options.debug_info_kind != DebugInfoKind::NoCustomSymbolication ||
+      emit_locators || post_lowering) {
+    TRACE(OPUT, 1, "Not caching dexes: the output depends on other dexes");
+    return nullptr;
+  }
+
+  std::ostringstream salt;
+  salt << dex_magic << '\n' << redex_options.min_sdk << '\n';
+  auto string_sort_mode = json_cfg.get("string_sort_mode", std::string());
+  salt << string_sort_mode << '\n';
+  std::vector<std::string> code_sort_modes;
+  auto sort_bytecode_cfg = json_cfg.get("bytecode_sort_mode", Json::Value());
+  if (sort_bytecode_cfg.isString()) {
+    code_sort_modes.push_back(sort_bytecode_cfg.asString());
+  } else if (sort_bytecode_cfg.isArray()) {
+    for (const auto& val : sort_bytecode_cfg) {
+      code_sort_modes.push_back(val.asString());
+    }
+  }
+  bool disable_method_similarity_order =
+      json_cfg.get("disable_method_similarity_order", false);
+  for (const auto& mode : code_sort_modes) {
+    if (disable_method_similarity_order && mode == "method_similarity_order") {
+      continue;
+    }
+    if (is_profile_order(mode)) {
+      TRACE(OPUT, 1, "Not caching dexes: the code order comes from profiles");
+      return nullptr;
+    }
+    salt << mode << ' ';
+  }
+  if (is_profile_order(string_sort_mode)) {
+    TRACE(OPUT, 1, "Not caching dexes: the string order comes from profiles");
+    return nullptr;
+  }
+  salt << '\n' << json_cfg.get("lower_with_cfg", true) << '\n';
+
+  boost::filesystem::create_directories(dir);
+  return std::make_unique<DexOutputCache>(dir, salt.str());
+}
+
+DexOutputCache::DexOutputCache(std::string dir, std::string salt)
+    : m_store(std::move(dir)), m_salt(std::move(salt)) {}
+
+std::string DexOutputCache::key(const std::vector<DexClass*>& classes) const {
+  std::ostringstream oss;
+  oss << kFormatVersion << '\n' << m_salt << '\n';
+  for (auto* cls : classes) {
+    auto hash = hashing::DexClassHasher(cls).run();
+    // The source file is emitted in the class def, but not hashed.
+    const auto* source_file = cls->get_source_file();
+    oss << hash << ' ' << (source_file ? source_file->str() : "") << '\n';
+  }
+  return DiskCache::key(oss.str());
+}
+
+bool DexOutputCache::lookup(const std::string& key, Entry* entry) {
+  auto in = m_store.open(key, std::ios::binary);
+  if (!in) {
+    m_store.count_miss();
+    return false;
+  }
+  // An entry is the size of the statistics, the statistics, the dex and the
+  // bytecode offsets, each with its size first.
+  if (read_u32(in) == sizeof(dex_stats_t)) {
+    in.read(reinterpret_cast<char*>(&entry->stats), sizeof(dex_stats_t));
+    entry->dex = read_string(in, read_u32(in));
+    auto num_offsets = read_u32(in);
+    entry->bytecode_offsets.clear();
+    entry->bytecode_offsets.reserve(num_offsets);
+    for (uint32_t i = 0; in && i < num_offsets; ++i) {
+      auto name = read_string(in, read_u32(in));
+      entry->bytecode_offsets.emplace_back(std::move(name), read_u32(in));
+    }
+    if (in && in.peek() == std::ifstream::traits_type::eof()) {
+      m_store.count_hit();
+      return true;
+    }
+  }
+  TRACE(OPUT, 1, "Ignoring unreadable cache entry %s",
+        m_store.path(key).c_str());
+  entry->dex.clear();
+  entry->bytecode_offsets.clear();
+  m_store.count_miss();
+  return false;
+}
+
+void DexOutputCache::record(const std::string& key, const Entry& entry) {
+  m_store.write(
+      key,
+      [&](std::ostream& out) {
+        write_u32(out, sizeof(dex_stats_t));
+        out.write(reinterpret_cast<const char*>(&entry.stats),
+                  sizeof(dex_stats_t));
+        write_u32(out, entry.dex.size());
+        out.write(entry.dex.data(), entry.dex.size());
+        write_u32(out, entry.bytecode_offsets.size());
+        for (const auto& [name, offset] : entry.bytecode_offsets) {
+          write_u32(out, name.size());
+          out.write(name.data(), name.size());
+          write_u32(out, offset);
+        }
+      },
+      std::ios::binary);
+}
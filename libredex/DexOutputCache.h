@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DexStats.h"
+#include "DiskCache.h"
+
+class DexClass;
+struct ConfigFiles;
+class RedexOptions;
+
+/*
+ * A persistent, content-addressed cache of output dexes, shared across builds.
+ *
+ * An entry is keyed on the hashes of the classes of a dex, in order, and on
+ * all configuration that affects how they are encoded. It holds the bytes of
+ * the dex along with the statistics and bytecode offsets of its emission, so
+ * that a dex whose classes did not change since an earlier build is copied
+ * instead of being encoded again.
+ *
+ * Only dexes that depend on nothing but their own classes can be cached. The
+ * cache is thus unavailable when the output refers to state shared between
+ * dexes: custom symbolication (the line number map), IODI, class locators,
+ * post-lowering, and method orders that come from profiles.
+ *
+ * The cache is enabled by setting `dex_output_cache_dir` in the config.
+ * The keys do not cover how the running version of Redex encodes classes, so
+ * the directory must not be shared between different versions of Redex.
+ */
+class DexOutputCache final {
+ public:
+  struct Entry {
+    std::string dex;
+    dex_stats_t stats;
+    std::vector<std::pair<std::string, uint32_t>> bytecode_offsets;
+  };
+
+  // Returns nullptr if the cache is not enabled, or if the output cannot be
+  // cached with this configuration.
+  static std::unique_ptr<DexOutputCache> create(
+      const ConfigFiles& conf,
+      const RedexOptions& redex_options,
+      const std::string& dex_magic,
+      bool emit_locators,
+      bool post_lowering);
+
+  DexOutputCache(std::string dir, std::string salt);
+
+  // The key of a dex with the given classes. This must be computed before
+  // instruction lowering, as the class hashes are over IR code.
+  std::string key(const std::vector<DexClass*>& classes) const;
+
+  // If there is an entry for `key`, stores it in `entry` and returns true.
+  bool lookup(const std::string& key, Entry* entry);
+
+  void record(const std::string& key, const Entry& entry);
+
+  size_t hits() const { return m_store.hits(); }
+  size_t misses() const { return m_store.misses(); }
+
+ private:
+  DiskCache m_store;
+  std::string m_salt;
+};
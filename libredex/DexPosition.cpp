@@ -112,20 +112,37 @@ std::unique_ptr<DexPosition> PositionPatternSwitchManager::make_switch_position(
                                        switch_id);
 }
 
+DexPosition* RealPositionMapper::canonicalize(DexPosition* pos) {
+  if (pos == nullptr) {
+    return nullptr;
+  }
+  auto it = m_canonical_of.find(pos);
+  if (it != m_canonical_of.end()) {
+    return it->second;
+  }
+  PositionKey key{pos->method, pos->file, pos->line, canonicalize(pos->parent)};
+  auto* canonical = m_canonical_positions.emplace(key, pos).first->second;
+  m_canonical_of.emplace(pos, canonical);
+  return canonical;
+}
+
 void RealPositionMapper::register_position(DexPosition* pos) {
   always_assert(pos->file);
-  m_pos_line_map[pos] = -1;
+  m_pos_line_map.emplace(canonicalize(pos), -1);
 }
 
 uint32_t RealPositionMapper::get_line(DexPosition* pos) {
-  return m_pos_line_map.at(pos) + 1;
+  return m_pos_line_map.at(canonicalize(pos)) + 1;
 }
 
 uint32_t RealPositionMapper::position_to_line(DexPosition* pos) {
-  auto idx = m_positions.size();
-  m_positions.emplace_back(pos);
-  m_pos_line_map[pos] = idx;
-  return get_line(pos);
+  pos = canonicalize(pos);
+  auto& line = m_pos_line_map.emplace(pos, -1).first->second;
+  if (line == -1) {
+    line = m_positions.size();
+    m_positions.emplace_back(pos);
+  }
+  return line + 1;
 }
 
 void RealPositionMapper::write_map() {
@@ -206,7 +223,8 @@ void RealPositionMapper::process_pattern_switch_positions() {
       if (!reachable_patterns.count(c.pattern_id)) {
         continue;
       }
-      for (auto pos = c.position; pos && pos->file; pos = pos->parent) {
+      for (auto pos = canonicalize(c.position); pos && pos->file;
+           pos = canonicalize(pos->parent)) {
         auto it = m_pos_line_map.find(pos);
         if (it != m_pos_line_map.end()) {
           always_assert(it->second != -1);
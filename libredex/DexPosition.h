@@ -153,11 +153,39 @@ class PositionMapper {
  * position can be found.
  */
 class RealPositionMapper : public PositionMapper {
+  // A position by value, with its parent chain reduced to the canonical
+  // parent.
+  struct PositionKey {
+    const DexString* method;
+    const DexString* file;
+    uint32_t line;
+    DexPosition* parent;
+    bool operator==(const PositionKey& other) const {
+      return method == other.method && file == other.file &&
+             line == other.line && parent == other.parent;
+    }
+  };
+  friend size_t hash_value(const PositionKey& key) {
+    size_t seed = 0;
+    boost::hash_combine(seed, key.method);
+    boost::hash_combine(seed, key.file);
+    boost::hash_combine(seed, key.line);
+    boost::hash_combine(seed, key.parent);
+    return seed;
+  }
+
   std::string m_filename_v2;
   std::vector<DexPosition*> m_positions;
   std::unordered_map<DexPosition*, int64_t> m_pos_line_map;
   std::vector<std::unique_ptr<DexPosition>> m_owned_auxiliary_positions;
-
+  // Inlining copies whole parent chains, so that many positions are equal
+  // by value. Each is mapped to the first one seen, and only that one gets a
+  // line in the map.
+  std::unordered_map<PositionKey, DexPosition*, boost::hash<PositionKey>>
+      m_canonical_positions;
+  std::unordered_map<DexPosition*, DexPosition*> m_canonical_of;
+
+  DexPosition* canonicalize(DexPosition* pos);
   void process_pattern_switch_positions();
 
  protected:
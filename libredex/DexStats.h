@@ -45,6 +45,11 @@ struct dex_stats_t {
 
   int instruction_bytes = 0;
 
+  // Code items of methods that cold start commonly executes, and the pages
+  // of the dex that they span.
+  int num_startup_code_items = 0;
+  int startup_code_pages = 0;
+
   /* Stats collected from the Map List section of a Dex. */
   int header_item_count = 0;
   int header_item_bytes = 0;
@@ -6,6 +6,7 @@
  */
 
 #include <fstream>
+#include <limits>
 #include <sstream>
 
 #include <json/json.h>
@@ -163,35 +164,72 @@ std::unordered_set<const DexType*> get_root_store_types(
 }
 
 XStoreRefs::XStoreRefs(const DexStoresVector& stores)
-    : m_transitive_resolved_dependencies(
+    : m_type_stores(std::make_shared<DenseMap<DexType, uint16_t>>()),
+      m_transitive_resolved_dependencies(
           build_transitive_resolved_dependencies(stores)) {
-  m_xstores.push_back(std::unordered_set<const DexType*>());
-  m_stores.push_back(&stores[0]);
-  for (const auto& cls : stores[0].get_dexen()[0]) {
-    m_xstores.back().insert(cls->get_type());
-  }
+  // A type that is in several stores belongs to the first one.
+  auto add_store = [&](const DexStore* store, size_t first_dex,
+                       size_t end_dex) {
+    m_stores.push_back(store);
+    auto store_idx_plus_one = m_stores.size();
+    always_assert(store_idx_plus_one <= std::numeric_limits<uint16_t>::max());
+    const auto& dexen = store->get_dexen();
+    for (size_t i = first_dex; i < end_dex; i++) {
+      for (const auto& cls : dexen[i]) {
+        auto& type_store = (*m_type_stores)[cls->get_type()];
+        if (type_store == 0) {
+          type_store = store_idx_plus_one;
+        }
+      }
+    }
+  };
+  add_store(&stores[0], 0, 1);
   m_root_stores = 1;
   if (stores[0].get_dexen().size() > 1) {
     m_root_stores++;
-    m_xstores.push_back(std::unordered_set<const DexType*>());
-    m_stores.push_back(&stores[0]);
-    for (size_t i = 1; i < stores[0].get_dexen().size(); i++) {
-      for (const auto& cls : stores[0].get_dexen()[i]) {
-        m_xstores.back().insert(cls->get_type());
-      }
-    }
+    add_store(&stores[0], 1, stores[0].get_dexen().size());
   }
   for (size_t i = 1; i < stores.size(); i++) {
-    m_xstores.push_back(std::unordered_set<const DexType*>());
-    m_stores.push_back(&stores[i]);
-    for (const auto& classes : stores[i].get_dexen()) {
-      for (const auto& cls : classes) {
-        m_xstores.back().insert(cls->get_type());
-      }
+    add_store(&stores[i], 0, stores[i].get_dexen().size());
+  }
+  m_num_stores = m_stores.size();
+
+  m_illegal_refs.resize(m_num_stores * m_num_stores);
+  for (size_t caller = 0; caller < m_num_stores; caller++) {
+    for (size_t callee = 0; callee < m_num_stores; callee++) {
+      m_illegal_refs[caller * m_num_stores + callee] =
+          compute_illegal_ref_between_stores(caller, callee);
     }
   }
 }
 
+bool XStoreRefs::compute_illegal_ref_between_stores(
+    size_t caller_store_idx, size_t callee_store_idx) const {
+  if (caller_store_idx == callee_store_idx) {
+    return false;
+  }
+
+  bool callee_in_root_store = callee_store_idx < m_root_stores;
+
+  if (callee_in_root_store) {
+    // Check if primary to secondary reference
+    return callee_store_idx > caller_store_idx;
+  }
+
+  // Check if the caller depends on the callee,
+  if (caller_store_idx >= m_root_stores) {
+    const auto& callee_store = get_store(callee_store_idx);
+    const auto& caller_store = get_store(caller_store_idx);
+    const auto& caller_dependencies =
+        get_transitive_resolved_dependencies(caller_store);
+    if (caller_dependencies.count(callee_store)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 bool XStoreRefs::illegal_ref_load_types(const DexType* location,
                                         const DexClass* cls) const {
   std::unordered_set<DexType*> types;
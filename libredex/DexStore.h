@@ -9,11 +9,13 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "Debug.h"
+#include "DenseMap.h"
 #include "DexClass.h"
 
 class DexStore;
@@ -164,10 +166,24 @@ std::unordered_set<const DexType*> get_root_store_types(
 class XStoreRefs {
  private:
   /**
-   * Set of classes in each logical store. A primary DEX goes in its own
-   * bucket (first element in the array).
+   * The logical store of each class, plus one, indexed by the dense id of its
+   * type. Zero means that the type is in no store. A primary DEX goes in its
+   * own store (the first one). Shared, so that copies are cheap; it is only
+   * written to by the constructor.
    */
-  std::vector<std::unordered_set<const DexType*>> m_xstores;
+  std::shared_ptr<DenseMap<DexType, uint16_t>> m_type_stores;
+
+  /**
+   * Number of logical stores.
+   */
+  size_t m_num_stores{0};
+
+  /**
+   * Whether a reference from the code in one logical store to a type in
+   * another one is illegal, at [caller_store_idx * m_num_stores +
+   * callee_store_idx].
+   */
+  std::vector<bool> m_illegal_refs;
 
   /**
    * Pointers to original stores in the same order as used to populate
@@ -189,6 +205,17 @@ class XStoreRefs {
   static std::string show_type(const DexType* type); // To avoid "Show.h" in the
                                                      // header.
 
+  /**
+   * The store index of the type plus one, or zero if it is in no store.
+   */
+  size_t find_store_idx_plus_one(const DexType* type) const {
+    const auto* store = m_type_stores->find(type);
+    return store == nullptr ? 0 : *store;
+  }
+
+  bool compute_illegal_ref_between_stores(size_t caller_store_idx,
+                                          size_t callee_store_idx) const;
+
  public:
   explicit XStoreRefs(const DexStoresVector& stores);
 
@@ -212,10 +239,10 @@ class XStoreRefs {
    * api.
    */
   size_t get_store_idx(const DexType* type) const {
-    for (size_t store_idx = 0; store_idx < m_xstores.size(); store_idx++) {
-      if (m_xstores[store_idx].count(type) > 0) return store_idx;
-    }
-    not_reached_log("type %s not in the current APK", show_type(type).c_str());
+    auto store_idx_plus_one = find_store_idx_plus_one(type);
+    always_assert_log(store_idx_plus_one != 0, "type %s not in the current APK",
+                      show_type(type).c_str());
+    return store_idx_plus_one - 1;
   }
 
   /**
@@ -225,17 +252,12 @@ class XStoreRefs {
    * the current scope.
    */
   bool is_in_root_store(const DexType* type) const {
-    for (size_t store_idx = 0; store_idx < m_root_stores; store_idx++) {
-      if (m_xstores[store_idx].count(type) > 0) {
-        return true;
-      }
-    }
-
-    return false;
+    auto store_idx_plus_one = find_store_idx_plus_one(type);
+    return store_idx_plus_one != 0 && store_idx_plus_one <= m_root_stores;
   }
 
   bool is_in_primary_dex(const DexType* type) const {
-    return !m_xstores.empty() && m_xstores[0].count(type);
+    return find_store_idx_plus_one(type) == 1;
   }
 
   const DexStore* get_store(size_t idx) const { return m_stores[idx]; }
@@ -271,12 +293,12 @@ class XStoreRefs {
     if (type_class_internal(type) == nullptr) return false;
     // Temporary HACK: optimizations may leave references to dead classes and
     // if we just call get_store_idx() - as we should - the assert will fire...
-    size_t type_store_idx = 0;
-    for (; type_store_idx < m_xstores.size(); type_store_idx++) {
-      if (m_xstores[type_store_idx].count(type) > 0) break;
-    }
-    if ((store_idx >= m_xstores.size()) ||
-        (type_store_idx >= m_xstores.size())) {
+    // Such types are treated as being in a store past the last one.
+    auto type_store_idx_plus_one = find_store_idx_plus_one(type);
+    size_t type_store_idx = type_store_idx_plus_one == 0
+                                ? m_num_stores
+                                : type_store_idx_plus_one - 1;
+    if ((store_idx >= m_num_stores) || (type_store_idx >= m_num_stores)) {
       return type_store_idx > store_idx;
     }
     return illegal_ref_between_stores(store_idx, type_store_idx);
@@ -284,29 +306,7 @@ class XStoreRefs {
 
   bool illegal_ref_between_stores(size_t caller_store_idx,
                                   size_t callee_store_idx) const {
-    if (caller_store_idx == callee_store_idx) {
-      return false;
-    }
-
-    bool callee_in_root_store = callee_store_idx < m_root_stores;
-
-    if (callee_in_root_store) {
-      // Check if primary to secondary reference
-      return callee_store_idx > caller_store_idx;
-    }
-
-    // Check if the caller depends on the callee,
-    if (caller_store_idx >= m_root_stores) {
-      const auto& callee_store = get_store(callee_store_idx);
-      const auto& caller_store = get_store(caller_store_idx);
-      const auto& caller_dependencies =
-          get_transitive_resolved_dependencies(caller_store);
-      if (caller_dependencies.count(callee_store)) {
-        return false;
-      }
-    }
-
-    return true;
+    return m_illegal_refs[caller_store_idx * m_num_stores + callee_store_idx];
   }
 
   bool cross_store_ref(const DexMethod* caller, const DexMethod* callee) const {
@@ -314,7 +314,7 @@ class XStoreRefs {
     return illegal_ref(store_idx, callee->get_class());
   }
 
-  size_t size() const { return m_xstores.size(); }
+  size_t size() const { return m_num_stores; }
 };
 
 /**
@@ -7,6 +7,7 @@
 
 #include "DexTypeEnvironment.h"
 
+#include <algorithm>
 #include <boost/optional/optional_io.hpp>
 #include <ostream>
 
@@ -182,7 +183,9 @@ bool SmallSetDexTypeDomain::leq(const SmallSetDexTypeDomain& other) const {
   if (is_top()) {
     return false;
   }
-  return m_types.is_subset_of(other.m_types);
+  return std::includes(other.m_types.begin(),
+                       other.m_types.begin() + other.m_size, m_types.begin(),
+                       m_types.begin() + m_size);
 }
 
 bool SmallSetDexTypeDomain::equals(const SmallSetDexTypeDomain& other) const {
@@ -192,7 +195,9 @@ bool SmallSetDexTypeDomain::equals(const SmallSetDexTypeDomain& other) const {
   if (is_top()) {
     return other.is_top();
   }
-  return m_types.equals(other.m_types);
+  return std::equal(m_types.begin(), m_types.begin() + m_size,
+                    other.m_types.begin(),
+                    other.m_types.begin() + other.m_size);
 }
 
 void SmallSetDexTypeDomain::join_with(const SmallSetDexTypeDomain& other) {
@@ -204,14 +209,21 @@ void SmallSetDexTypeDomain::join_with(const SmallSetDexTypeDomain& other) {
     return;
   }
   if (is_bottom()) {
-    m_kind = other.m_kind;
-    m_types = other.m_types;
+    *this = other;
     return;
   }
-  m_types.union_with(other.m_types);
-  if (m_types.size() > MAX_SET_SIZE) {
+  std::array<const DexType*, 2 * MAX_SET_SIZE> types;
+  auto end = std::set_union(m_types.begin(), m_types.begin() + m_size,
+                            other.m_types.begin(),
+                            other.m_types.begin() + other.m_size,
+                            types.begin());
+  size_t size = end - types.begin();
+  if (size > MAX_SET_SIZE) {
     set_to_top();
+    return;
   }
+  std::copy(types.begin(), end, m_types.begin());
+  m_size = size;
 }
 
 void SmallSetDexTypeDomain::widen_with(const SmallSetDexTypeDomain& other) {
@@ -223,11 +235,10 @@ void SmallSetDexTypeDomain::widen_with(const SmallSetDexTypeDomain& other) {
     return;
   }
   if (is_bottom()) {
-    m_kind = other.m_kind;
-    m_types = other.m_types;
+    *this = other;
     return;
   }
-  if (m_types.size() + other.m_types.size() > MAX_SET_SIZE) {
+  if (m_size + other.m_size > MAX_SET_SIZE) {
     set_to_top();
     return;
   }
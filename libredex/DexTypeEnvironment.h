@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <array>
 #include <iosfwd>
 
 #include <boost/optional.hpp>
@@ -182,10 +183,8 @@ class SmallSetDexTypeDomain final
  public:
   SmallSetDexTypeDomain() : m_kind(sparta::AbstractValueKind::Value) {}
 
-  explicit SmallSetDexTypeDomain(const DexType* type) {
-    m_types.insert(type);
-    m_kind = sparta::AbstractValueKind::Value;
-  }
+  explicit SmallSetDexTypeDomain(const DexType* type)
+      : m_types{type}, m_size(1), m_kind(sparta::AbstractValueKind::Value) {}
 
   bool is_bottom() const override {
     return m_kind == sparta::AbstractValueKind::Bottom;
@@ -197,19 +196,20 @@ class SmallSetDexTypeDomain final
 
   void set_to_bottom() override {
     m_kind = sparta::AbstractValueKind::Bottom;
-    m_types.clear();
+    m_size = 0;
   }
 
   void set_to_top() override {
     m_kind = sparta::AbstractValueKind::Top;
-    m_types.clear();
+    m_size = 0;
   }
 
   sparta::AbstractValueKind kind() const { return m_kind; }
 
   sparta::PatriciaTreeSet<const DexType*> get_types() const {
     always_assert(!is_top());
-    return m_types;
+    return sparta::PatriciaTreeSet<const DexType*>(m_types.begin(),
+                                                   m_types.begin() + m_size);
   }
 
   bool leq(const SmallSetDexTypeDomain& other) const override;
@@ -232,7 +232,10 @@ class SmallSetDexTypeDomain final
                                   const SmallSetDexTypeDomain& x);
 
  private:
-  sparta::PatriciaTreeSet<const DexType*> m_types;
+  // The types are kept sorted in place, so that copies, joins and comparisons
+  // of these small sets never allocate.
+  std::array<const DexType*, MAX_SET_SIZE> m_types{};
+  uint8_t m_size{0};
   sparta::AbstractValueKind m_kind;
 };
 
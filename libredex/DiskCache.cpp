@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "DiskCache.h"
+
+#include <boost/filesystem.hpp>
+#include <iomanip>
+#include <sstream>
+
+DiskCache::KeyHasher::KeyHasher() { sha1_init(&m_context); }
+
+void DiskCache::KeyHasher::update(const char* data, size_t size) {
+  sha1_update(&m_context, reinterpret_cast<const unsigned char*>(data), size);
+}
+
+std::string DiskCache::KeyHasher::finish() {
+  unsigned char digest[20];
+  sha1_final(digest, &m_context);
+  std::ostringstream oss;
+  oss << std::hex << std::setfill('0');
+  for (auto byte : digest) {
+    oss << std::setw(2) << static_cast<unsigned>(byte);
+  }
+  return oss.str();
+}
+
+std::string DiskCache::key(const std::string& data) {
+  KeyHasher hasher;
+  hasher.update(data);
+  return hasher.finish();
+}
+
+std::string DiskCache::path(const std::string& key) const {
+  // Shard on the first byte to keep directories reasonably small.
+  auto dir = boost::filesystem::path(m_dir) / key.substr(0, 2);
+  return (dir / key.substr(2)).string();
+}
+
+std::ifstream DiskCache::open(const std::string& key,
+                              std::ios::openmode mode) const {
+  return std::ifstream(path(key), mode | std::ios::in);
+}
+
+void DiskCache::write(const std::string& key,
+                      const std::function<void(std::ostream&)>& write,
+                      std::ios::openmode mode) const {
+  // Write to a temporary file first so that concurrent builds never see a
+  // partial entry.
+  auto final_path = boost::filesystem::path(path(key));
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(final_path.parent_path(), ec);
+  auto tmp_path = final_path;
+  tmp_path += boost::filesystem::unique_path(".%%%%-%%%%-%%%%");
+  {
+    std::ofstream out(tmp_path.string(), mode | std::ios::out);
+    write(out);
+    if (!out) {
+      boost::filesystem::remove(tmp_path, ec);
+      return;
+    }
+  }
+  boost::filesystem::rename(tmp_path, final_path, ec);
+  if (ec) {
+    boost::filesystem::remove(tmp_path, ec);
+  }
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <string>
+
+#include "Sha1.h"
+
+/*
+ * The storage of the persistent, content-addressed caches that are shared
+ * across builds, such as the MethodResultCache, the ResourceScanCache and the
+ * DexOutputCache.
+ *
+ * Each entry is a file in `dir` named after its key, the hex SHA-1 of all the
+ * inputs of the cached result. Entries are never evicted. They are written
+ * atomically, so that the directory is safe to share between concurrent
+ * builds. The caches count their hits and misses here, as an entry that exists
+ * but cannot be read is a miss too.
+ */
+class DiskCache final {
+ public:
+  // Computes a key incrementally.
+  class KeyHasher {
+   public:
+    KeyHasher();
+
+    void update(const char* data, size_t size);
+    void update(const std::string& data) { update(data.data(), data.size()); }
+
+    // The hex digest of the data so far. The hasher cannot be used after.
+    std::string finish();
+
+   private:
+    Sha1Context m_context;
+  };
+
+  static std::string key(const std::string& data);
+
+  explicit DiskCache(std::string dir) : m_dir(std::move(dir)) {}
+
+  const std::string& dir() const { return m_dir; }
+
+  std::string path(const std::string& key) const;
+
+  // The entry of `key`, which is not open if there is none.
+  std::ifstream open(const std::string& key,
+                     std::ios::openmode mode = std::ios::in) const;
+
+  // Records the entry of `key` as the output of `write`, replacing any
+  // previous one. Failing to record an entry is not an error.
+  void write(const std::string& key,
+             const std::function<void(std::ostream&)>& write,
+             std::ios::openmode mode = std::ios::out) const;
+
+  void count_hit() { ++m_hits; }
+  void count_miss() { ++m_misses; }
+
+  size_t hits() const { return m_hits; }
+  size_t misses() const { return m_misses; }
+
+ private:
+  std::string m_dir;
+  std::atomic<size_t> m_hits{0};
+  std::atomic<size_t> m_misses{0};
+};
@@ -9,6 +9,8 @@
 
 #include <boost/optional/optional.hpp>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "GraphUtil.h"
 
@@ -70,6 +72,11 @@ class SimpleFastDominators {
 
   NodeId get_idom(NodeId node) const { return m_idoms.at(node); }
 
+  // The nodes that are reachable from the entry, in postorder.
+  const std::vector<NodeId>& get_postordering() const {
+    return m_postordering;
+  }
+
   // Find the common dominator block that is closest to both blocks.
   NodeId intersect(NodeId finger1, NodeId finger2) {
     while (finger1 != finger2) {
@@ -89,4 +96,77 @@ class SimpleFastDominators {
   std::unordered_map<NodeId, size_t> m_postorder_map;
 };
 
+/*
+ * The dominator tree of a graph, numbered so that dominance queries take
+ * constant time instead of a walk up the immediate dominators: a node
+ * dominates another iff its interval in a depth-first traversal of the tree
+ * contains the interval of the other.
+ *
+ * Like SimpleFastDominators, this is a snapshot of the graph at the time of
+ * construction, and must be rebuilt after the graph changes.
+ */
+template <class GraphInterface>
+class DominatorTree {
+ public:
+  using NodeId = typename GraphInterface::NodeId;
+
+  explicit DominatorTree(const typename GraphInterface::Graph& graph)
+      : m_doms(graph) {
+    const auto& postordering = m_doms.get_postordering();
+    const auto& entry = GraphInterface::entry(graph);
+    std::unordered_map<NodeId, std::vector<NodeId>> children;
+    for (auto rit = postordering.rbegin(); rit != postordering.rend(); ++rit) {
+      if (*rit != entry) {
+        children[m_doms.get_idom(*rit)].push_back(*rit);
+      }
+    }
+
+    // Number the tree without recursion since it can be as deep as the graph
+    // is large.
+    uint32_t counter = 0;
+    std::vector<std::pair<NodeId, size_t>> stack{{entry, 0}};
+    m_intervals[entry].first = counter++;
+    while (!stack.empty()) {
+      auto& [node, next_child] = stack.back();
+      auto it = children.find(node);
+      if (it == children.end() || next_child == it->second.size()) {
+        m_intervals[node].second = counter++;
+        stack.pop_back();
+        continue;
+      }
+      auto child = it->second[next_child++];
+      m_intervals[child].first = counter++;
+      stack.emplace_back(child, 0);
+    }
+  }
+
+  NodeId get_idom(NodeId node) const { return m_doms.get_idom(node); }
+
+  const SimpleFastDominators<GraphInterface>& get_dominators() const {
+    return m_doms;
+  }
+
+  // Whether every path from the entry to `node` goes through `dominator`. A
+  // node dominates itself. Nodes that are not reachable from the entry
+  // neither dominate nor are dominated.
+  bool dominates(NodeId dominator, NodeId node) const {
+    auto dominator_it = m_intervals.find(dominator);
+    auto node_it = m_intervals.find(node);
+    if (dominator_it == m_intervals.end() || node_it == m_intervals.end()) {
+      return false;
+    }
+    return dominator_it->second.first <= node_it->second.first &&
+           node_it->second.second <= dominator_it->second.second;
+  }
+
+  bool strictly_dominates(NodeId dominator, NodeId node) const {
+    return dominator != node && dominates(dominator, node);
+  }
+
+ private:
+  SimpleFastDominators<GraphInterface> m_doms;
+  // The numbers at which the traversal enters and leaves each node.
+  std::unordered_map<NodeId, std::pair<uint32_t, uint32_t>> m_intervals;
+};
+
 } // namespace dominators
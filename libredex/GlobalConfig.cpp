@@ -12,6 +12,8 @@ void InlinerConfig::bind_config() {
   bind("true_virtual_inline", true_virtual_inline, true_virtual_inline);
   bind("intermediate_shrinking", intermediate_shrinking,
        intermediate_shrinking);
+  bind("fast_intermediate_shrinking", fast_intermediate_shrinking,
+       fast_intermediate_shrinking);
   bind("enforce_method_size_limit", enforce_method_size_limit,
        enforce_method_size_limit);
   bind("throws", throws_inline, throws_inline);
@@ -141,6 +143,8 @@ void GlobalConfig::bind_config() {
   bind("write_cfg_each_pass", false, bool_param);
   bind("dump_cfg_classes", "", string_param);
   bind("slow_invariants_debug", false, bool_param);
+  bind("ir_arena", false, bool_param,
+       "Allocate the instructions of each method from a per-method arena.");
   // Enabled for ease of testing, apps expected to opt-out
   bind("enable_bleeding_edge_app_bundle_support", true, bool_param);
   bind("no_devirtualize_annos", {}, string_vector_param);
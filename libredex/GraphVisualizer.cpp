@@ -9,8 +9,10 @@
 
 #include <fstream>
 #include <iostream>
+#include <numeric>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/range/adaptors.hpp>
 
 #include "ControlFlow.h"
@@ -18,6 +20,7 @@
 #include "DexPosition.h"
 #include "IRCode.h"
 #include "Show.h"
+#include "WorkQueue.h"
 
 // The "Hotspot Client Compiler Visualizer" (c1visualizer) is a tool consuming
 // Hotspot C1 compiler debug info to display control flow graphs of compilation
@@ -615,9 +618,47 @@ std::vector<DexMethod*> get_all_methods(DexClass* klass) {
 
 // A stream storage for CFG visualization. On request, will not emit a pass if
 // the CFG did not change.
-MethodCFGStream::MethodCFGStream(DexMethod* m) : m_method(m) {
+MethodCFGStream::MethodCFGStream(DexMethod* m, std::string spill_file)
+    : m_method(m), m_spill_file(std::move(spill_file)) {
   m_orig_name = vshow(m, false);
-  print_compilation_header(m_ss, m_orig_name, m_orig_name);
+  std::stringstream header;
+  print_compilation_header(header, m_orig_name, m_orig_name);
+  if (!m_spill_file.empty()) {
+    std::ofstream os(m_spill_file, std::ios::trunc);
+    always_assert_log(os, "Could not create %s", m_spill_file.c_str());
+  }
+  append(header.str());
+}
+
+void MethodCFGStream::append(const std::string& s) {
+  if (m_spill_file.empty()) {
+    m_ss << s;
+    return;
+  }
+  std::ofstream os(m_spill_file, std::ios::app);
+  os << s;
+  always_assert_log(os, "Could not write to %s", m_spill_file.c_str());
+}
+
+std::string MethodCFGStream::get_output() const {
+  if (m_spill_file.empty()) {
+    return m_ss.str();
+  }
+  std::stringstream ss;
+  write(ss);
+  return ss.str();
+}
+
+void MethodCFGStream::write(std::ostream& os) const {
+  if (m_spill_file.empty()) {
+    os << m_ss.str();
+    return;
+  }
+  std::ifstream is(m_spill_file);
+  always_assert_log(is, "Could not read %s", m_spill_file.c_str());
+  if (is.peek() != std::ifstream::traits_type::eof()) {
+    os << is.rdbuf();
+  }
 }
 
 void MethodCFGStream::add_pass(const std::string& pass_name,
@@ -658,16 +699,26 @@ void MethodCFGStream::add_pass(const std::string& pass_name,
     redex_assert(pos != std::string::npos);
     new_pass.replace(pos, strlen(FAKE_PASS_NAME), pass_name);
 
-    m_ss << new_pass;
+    append(new_pass);
   }
 }
 
-ClassCFGStream::ClassCFGStream(DexClass* klass) : m_class(klass) {
+ClassCFGStream::ClassCFGStream(DexClass* klass, std::string spill_prefix)
+    : m_class(klass), m_spill_prefix(std::move(spill_prefix)) {
   for (auto* method : get_all_methods(klass)) {
-    m_methods.push_back(MethodState{method, MethodCFGStream(method), false});
+    add_method(method);
   }
 }
 
+void ClassCFGStream::add_method(DexMethod* method) {
+  auto spill_file = m_spill_prefix.empty()
+                        ? std::string()
+                        : m_spill_prefix + std::to_string(m_methods.size());
+  m_methods.push_back(
+      MethodState{method, MethodCFGStream(method, std::move(spill_file)),
+                  false});
+}
+
 void ClassCFGStream::add_pass(const std::string& pass_name, Options o) {
   auto all_methods = get_all_methods(m_class);
   for (auto& m : m_methods) {
@@ -679,7 +730,7 @@ void ClassCFGStream::add_pass(const std::string& pass_name, Options o) {
     }
   }
   for (auto* method : all_methods) {
-    m_methods.push_back(MethodState{method, MethodCFGStream(method), false});
+    add_method(method);
   }
 
   for (auto& m : m_methods) {
@@ -692,7 +743,19 @@ void ClassCFGStream::add_pass(const std::string& pass_name, Options o) {
 
 void ClassCFGStream::write(std::ostream& os) const {
   for (auto& m : m_methods) {
-    os << m.stream.get_output();
+    m.stream.write(os);
+  }
+}
+
+Classes::Classes(const std::string& file_name, bool write_after_arch_pass)
+    : m_file_name(file_name),
+      m_spill_dir(file_name + ".parts"),
+      m_write_after_each_pass(write_after_arch_pass) {}
+
+Classes::~Classes() {
+  if (!m_class_cfgs.empty()) {
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(m_spill_dir, ec);
   }
 }
 
@@ -726,7 +789,17 @@ bool Classes::add(const std::string& class_name, bool add_initial_pass) {
 }
 
 void Classes::add(DexClass* klass, bool add_initial_pass) {
-  m_class_cfgs.emplace_back(klass);
+  // The classes print in parallel, so each must only be tracked once.
+  for (const auto& class_cfg : m_class_cfgs) {
+    if (class_cfg.get_class() == klass) {
+      return;
+    }
+  }
+  if (m_class_cfgs.empty()) {
+    boost::filesystem::create_directories(m_spill_dir);
+  }
+  m_class_cfgs.emplace_back(
+      klass, m_spill_dir + "/" + std::to_string(m_class_cfgs.size()) + "_");
   if (add_initial_pass) {
     m_class_cfgs.back().add_pass("Initial");
   }
@@ -750,9 +823,11 @@ void Classes::add_pass(const std::function<std::string()>& pass_name_lazy,
     return;
   }
   std::string pass_name = pass_name_lazy();
-  for (auto& class_cfg : m_class_cfgs) {
-    class_cfg.add_pass(pass_name, o);
-  }
+  // Each class only prints its own methods into their own files.
+  std::vector<size_t> indices(m_class_cfgs.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) { m_class_cfgs[i].add_pass(pass_name, o); }, indices);
   if (m_write_after_each_pass) {
     write();
   }
@@ -49,20 +49,28 @@ enum Options {
 
 // A stream storage for CFG visualization. By default will not emit a pass if
 // the CFG did not change.
+//
+// With a spill file, each pass is appended to that file as it is added, so
+// that only the last pass of the method is held in memory.
 class MethodCFGStream {
  public:
-  explicit MethodCFGStream(DexMethod* m);
+  explicit MethodCFGStream(DexMethod* m, std::string spill_file = "");
 
   void add_pass(const std::string& pass_name,
                 Options o = (Options)(SKIP_NO_CHANGE | PRINT_CODE),
                 const optional<std::string>& extra_prefix = boost::none);
 
-  std::string get_output() const { return m_ss.str(); }
+  std::string get_output() const;
+
+  void write(std::ostream& os) const;
 
  private:
+  void append(const std::string& s);
+
   DexMethod* m_method;
   std::string m_orig_name;
   std::string m_last;
+  std::string m_spill_file;
   std::stringstream m_ss;
 };
 
@@ -78,22 +86,36 @@ class ClassCFGStream {
   };
 
  public:
-  explicit ClassCFGStream(DexClass* klass);
+  // The streams of the methods spill to files named by :spill_prefix and an
+  // index, if given.
+  explicit ClassCFGStream(DexClass* klass, std::string spill_prefix = "");
 
   void add_pass(const std::string& pass_name, Options o = SKIP_NO_CHANGE);
 
   void write(std::ostream& os) const;
 
+  DexClass* get_class() const { return m_class; }
+
  private:
+  void add_method(DexMethod* method);
+
   DexClass* m_class;
+  std::string m_spill_prefix;
   std::vector<MethodState> m_methods;
 };
 
+// The CFG streams of a set of classes, written to a single file.
+//
+// The methods spill their passes to files in a directory next to that file,
+// which are concatenated in order on write(), so that the dumps of large
+// methods over many passes do not accumulate in memory. The classes are
+// printed in parallel.
 class Classes {
  public:
-  explicit Classes(const std::string& file_name, bool write_after_arch_pass)
-      : m_file_name(file_name),
-        m_write_after_each_pass(write_after_arch_pass) {}
+  explicit Classes(const std::string& file_name, bool write_after_arch_pass);
+  Classes(const Classes&) = delete;
+  Classes& operator=(const Classes&) = delete;
+  ~Classes();
 
   bool add(const std::string& class_name, bool add_initial_pass = true);
   void add(DexClass* klass, bool add_initial_pass = true);
@@ -109,6 +131,7 @@ class Classes {
   std::vector<visualizer::ClassCFGStream> m_class_cfgs;
   std::vector<std::string> m_not_found;
   const std::string m_file_name;
+  const std::string m_spill_dir;
   const bool m_write_after_each_pass;
 };
 
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "HotCounters.h"
+
+#if REDEX_HOT_COUNTERS
+
+#include <algorithm>
+#include <mutex>
+
+namespace hot_counters {
+
+namespace {
+
+struct Registry {
+  std::mutex lock;
+  std::vector<const detail::Metric*> metrics;
+};
+
+// Constructed on first use, so that counters can be declared statically in
+// any translation unit.
+Registry& registry() {
+  static Registry* registry = new Registry();
+  return *registry;
+}
+
+// The upper bound of the bucket that holds the value of the given rank.
+uint64_t bucket_bound(const std::vector<uint64_t>& counts, uint64_t rank) {
+  uint64_t seen = 0;
+  for (size_t k = 0; k < counts.size(); ++k) {
+    seen += counts[k];
+    if (seen > rank) {
+      return k == 0 ? 0 : (k >= 64 ? UINT64_MAX : (uint64_t(1) << k) - 1);
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+namespace detail {
+
+size_t shard_index() {
+  static std::atomic<size_t> next_index{0};
+  thread_local size_t index =
+      next_index.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+  return index;
+}
+
+Metric::Metric(std::string name) : m_name(std::move(name)) {
+  auto& r = registry();
+  std::lock_guard<std::mutex> guard(r.lock);
+  r.metrics.push_back(this);
+}
+
+Metric::~Metric() {
+  auto& r = registry();
+  std::lock_guard<std::mutex> guard(r.lock);
+  r.metrics.erase(std::remove(r.metrics.begin(), r.metrics.end(), this),
+                  r.metrics.end());
+}
+
+} // namespace detail
+
+uint64_t Counter::get() const {
+  uint64_t sum = 0;
+  for (const auto& shard : m_shards) {
+    sum += shard.value.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+void Counter::read(Snapshot* values) const { values->push_back(get()); }
+
+void Counter::report(const uint64_t* before,
+                     const uint64_t* after,
+                     const MetricFn& fn) const {
+  fn(name(), static_cast<int64_t>(after[0] - before[0]));
+}
+
+void Histogram::read(Snapshot* values) const {
+  size_t begin = values->size();
+  values->resize(begin + num_values(), 0);
+  uint64_t* out = values->data() + begin;
+  for (const auto& shard : m_shards) {
+    for (size_t k = 0; k < kNumBuckets; ++k) {
+      out[k] += shard.buckets[k].load(std::memory_order_relaxed);
+    }
+    out[kNumBuckets] += shard.sum.load(std::memory_order_relaxed);
+  }
+}
+
+void Histogram::report(const uint64_t* before,
+                       const uint64_t* after,
+                       const MetricFn& fn) const {
+  std::vector<uint64_t> counts(kNumBuckets);
+  uint64_t count = 0;
+  for (size_t k = 0; k < kNumBuckets; ++k) {
+    counts[k] = after[k] - before[k];
+    count += counts[k];
+  }
+  fn(name() + ".count", static_cast<int64_t>(count));
+  fn(name() + ".sum",
+     static_cast<int64_t>(after[kNumBuckets] - before[kNumBuckets]));
+  fn(name() + ".p50", static_cast<int64_t>(bucket_bound(counts, count / 2)));
+  fn(name() + ".p99",
+     static_cast<int64_t>(bucket_bound(counts, count * 99 / 100)));
+}
+
+Snapshot snapshot() {
+  auto& r = registry();
+  std::lock_guard<std::mutex> guard(r.lock);
+  Snapshot values;
+  for (const auto* metric : r.metrics) {
+    metric->read(&values);
+  }
+  return values;
+}
+
+void report_since(const Snapshot& before, const MetricFn& fn) {
+  auto& r = registry();
+  std::lock_guard<std::mutex> guard(r.lock);
+  Snapshot after;
+  for (const auto* metric : r.metrics) {
+    metric->read(&after);
+  }
+  // Counters that were registered after `before` was taken started at 0.
+  Snapshot padded_before(after.size(), 0);
+  std::copy_n(before.begin(), std::min(before.size(), after.size()),
+              padded_before.begin());
+  size_t offset = 0;
+  for (const auto* metric : r.metrics) {
+    auto n = metric->num_values();
+    bool changed = !std::equal(after.begin() + offset,
+                               after.begin() + offset + n,
+                               padded_before.begin() + offset);
+    if (changed) {
+      metric->report(padded_before.data() + offset, after.data() + offset, fn);
+    }
+    offset += n;
+  }
+}
+
+} // namespace hot_counters
+
+#endif // REDEX_HOT_COUNTERS
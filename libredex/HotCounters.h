@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Thread.h"
+
+/*
+ * Counters and histograms for hot paths, e.g. per-instruction loops, where the
+ * atomic add of an AccumulatingTimer on a shared counter becomes a contention
+ * point. Each thread adds to its own shard, on its own cache line, and the
+ * shards are only summed up when the counters are read.
+ *
+ * Counters are declared statically, and each pass run reports the counters
+ * that changed during the run as metrics of the pass:
+ *
+ *   static hot_counters::Counter s_visited("MyPass.visited_insns");
+ *   ...
+ *   s_visited.add();
+ *
+ * Like TRACE, the counters compile to nothing in NDEBUG builds, unless
+ * REDEX_HOT_COUNTERS is defined to 1.
+ */
+#ifndef REDEX_HOT_COUNTERS
+#ifdef NDEBUG
+#define REDEX_HOT_COUNTERS 0
+#else
+#define REDEX_HOT_COUNTERS 1
+#endif
+#endif
+
+namespace hot_counters {
+
+// The values of all counters at some point, see `snapshot`.
+using Snapshot = std::vector<uint64_t>;
+
+using MetricFn = std::function<void(const std::string&, int64_t)>;
+
+#if REDEX_HOT_COUNTERS
+
+namespace detail {
+
+// Threads beyond this many share shards.
+constexpr size_t kNumShards = 64;
+
+size_t shard_index();
+
+// A counter or histogram, registered when it is constructed.
+class Metric {
+ public:
+  explicit Metric(std::string name);
+  virtual ~Metric();
+
+  Metric(const Metric&) = delete;
+  Metric& operator=(const Metric&) = delete;
+
+  const std::string& name() const { return m_name; }
+
+  // The number of values that `read` appends.
+  virtual size_t num_values() const = 0;
+
+  virtual void read(Snapshot* values) const = 0;
+
+  // Calls `fn` with the metrics for the change from `before` to `after`.
+  virtual void report(const uint64_t* before,
+                      const uint64_t* after,
+                      const MetricFn& fn) const = 0;
+
+ private:
+  std::string m_name;
+};
+
+} // namespace detail
+
+class Counter final : public detail::Metric {
+ public:
+  explicit Counter(std::string name) : Metric(std::move(name)) {}
+
+  void add(uint64_t n = 1) {
+    m_shards[detail::shard_index()].value.fetch_add(n,
+                                                    std::memory_order_relaxed);
+  }
+
+  uint64_t get() const;
+
+  size_t num_values() const override { return 1; }
+  void read(Snapshot* values) const override;
+  void report(const uint64_t* before,
+              const uint64_t* after,
+              const MetricFn& fn) const override;
+
+ private:
+  struct alignas(CACHE_LINE_SIZE) Shard {
+    std::atomic<uint64_t> value{0};
+  };
+  std::array<Shard, detail::kNumShards> m_shards;
+};
+
+// Counts values in power-of-two buckets: bucket k holds the values in
+// [2^(k-1), 2^k), and bucket 0 holds 0.
+class Histogram final : public detail::Metric {
+ public:
+  static constexpr size_t kNumBuckets = 65;
+
+  explicit Histogram(std::string name) : Metric(std::move(name)) {}
+
+  void add(uint64_t value) {
+    auto& shard = m_shards[detail::shard_index()];
+    size_t bucket = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+  }
+
+  // The number of values in each bucket, followed by their sum.
+  size_t num_values() const override { return kNumBuckets + 1; }
+  void read(Snapshot* values) const override;
+  // Reports the count, the sum, and the upper bounds of the buckets of the
+  // median and the 99th percentile.
+  void report(const uint64_t* before,
+              const uint64_t* after,
+              const MetricFn& fn) const override;
+
+ private:
+  struct alignas(CACHE_LINE_SIZE) Shard {
+    std::array<std::atomic<uint64_t>, kNumBuckets> buckets{};
+    std::atomic<uint64_t> sum{0};
+  };
+  std::array<Shard, detail::kNumShards> m_shards;
+};
+
+// Reads all counters.
+Snapshot snapshot();
+
+// Calls `fn` with the metrics of the counters that changed since `before`.
+void report_since(const Snapshot& before, const MetricFn& fn);
+
+#else // REDEX_HOT_COUNTERS
+
+class Counter final {
+ public:
+  explicit Counter(const char*) {}
+  void add(uint64_t = 1) {}
+  uint64_t get() const { return 0; }
+};
+
+class Histogram final {
+ public:
+  explicit Histogram(const char*) {}
+  void add(uint64_t) {}
+};
+
+inline Snapshot snapshot() { return Snapshot(); }
+
+inline void report_since(const Snapshot&, const MetricFn&) {}
+
+#endif // REDEX_HOT_COUNTERS
+
+} // namespace hot_counters
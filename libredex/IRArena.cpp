@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "IRArena.h"
+
+#include <algorithm>
+#include <boost/align/aligned_alloc.hpp>
+
+#include "Debug.h"
+
+bool IRArena::s_enabled{false};
+thread_local IRArena* IRArena::t_current{nullptr};
+
+namespace ir_arena {
+namespace detail {
+
+thread_local Allocation t_last_allocated;
+thread_local Allocation t_last_destroyed;
+
+} // namespace detail
+} // namespace ir_arena
+
+namespace {
+
+constexpr size_t kAlignment = 8;
+
+size_t align_up(size_t size) {
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+size_t chunk_size(uint8_t size_class) {
+  return size_t(1) << (IRArena::kMinChunkLog2 + size_class - 1);
+}
+
+} // namespace
+
+IRArena* IRArena::create(size_t size_hint) { return new IRArena(size_hint); }
+
+IRArena::IRArena(size_t size_hint) {
+  size_t log2 = kMinChunkLog2;
+  while (log2 < kMaxChunkLog2 &&
+         (size_t(1) << log2) < size_hint + sizeof(ChunkHeader)) {
+    ++log2;
+  }
+  m_next_chunk_log2 = log2;
+}
+
+IRArena::~IRArena() {
+  for (void* chunk : m_chunks) {
+    boost::alignment::aligned_free(chunk);
+  }
+}
+
+bool IRArena::new_chunk(size_t min_payload) {
+  size_t log2 = m_next_chunk_log2;
+  while ((size_t(1) << log2) < min_payload + align_up(sizeof(ChunkHeader))) {
+    if (log2 == kMaxChunkLog2) {
+      return false;
+    }
+    ++log2;
+  }
+  size_t size = size_t(1) << log2;
+  void* chunk = boost::alignment::aligned_alloc(size, size);
+  if (chunk == nullptr) {
+    throw std::bad_alloc();
+  }
+  m_chunks.push_back(chunk);
+  m_reserved_bytes += size;
+  new (chunk) ChunkHeader{this};
+  m_cur = static_cast<char*>(chunk) + align_up(sizeof(ChunkHeader));
+  m_end = static_cast<char*>(chunk) + size;
+  m_cur_size_class = static_cast<uint8_t>(log2 - kMinChunkLog2 + 1);
+  // Grow geometrically, so that large methods only need a few chunks.
+  m_next_chunk_log2 = std::min(log2 + 1, kMaxChunkLog2);
+  return true;
+}
+
+void* IRArena::allocate(size_t size, uint8_t* size_class) {
+  size = align_up(size);
+  if (static_cast<size_t>(m_end - m_cur) < size && !new_chunk(size)) {
+    return nullptr;
+  }
+  void* ptr = m_cur;
+  m_cur += size;
+  *size_class = m_cur_size_class;
+  m_refs.fetch_add(1, std::memory_order_relaxed);
+  return ptr;
+}
+
+void IRArena::deallocate(void* ptr, uint8_t size_class) {
+  redex_assert(size_class != 0);
+  auto base = reinterpret_cast<uintptr_t>(ptr) & ~(chunk_size(size_class) - 1);
+  reinterpret_cast<ChunkHeader*>(base)->arena->release();
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+/*
+ * An optional bump allocator for the IR of a single method.
+ *
+ * When enabled (see `set_enabled`), an IRCode creates an arena while it is
+ * being built from a DexCode, assembled or copied, and all the IRInstructions,
+ * MethodItemEntries and spilled source register arrays allocated at that time
+ * are carved out of a handful of chunks instead of being allocated one by one.
+ *
+ * Objects in an arena may still be deleted individually, and may outlive the
+ * IRCode that created them, e.g. when the CFG defers freeing removed
+ * instructions or when instructions move to another method. The arena keeps a
+ * count of its live objects plus one reference held by its owner, and returns
+ * all its chunks at once when that count drops to zero. Memory of objects
+ * deleted earlier is not reused.
+ *
+ * Only the thread that has the arena in scope allocates from it. Releasing
+ * objects is thread-safe.
+ */
+class IRArena final {
+ public:
+  // Chunks are aligned to their (power-of-two) size, so that the chunk of an
+  // object can be found from its address given the chunk size class. Size
+  // class `c` (1-based) denotes chunks of `1 << (kMinChunkLog2 + c - 1)` bytes;
+  // 0 denotes an object that is not in an arena.
+  static constexpr size_t kMinChunkLog2 = 10;
+  static constexpr size_t kMaxChunkLog2 = 20;
+
+  static void set_enabled(bool enabled) { s_enabled = enabled; }
+  static bool enabled() { return s_enabled; }
+
+  // Creates an arena whose first chunk holds about `size_hint` bytes. The
+  // caller holds the owner reference.
+  static IRArena* create(size_t size_hint);
+
+  // Gives up the owner reference.
+  void release_owner() { release(); }
+
+  // The arena that serves allocations on this thread, if any.
+  static IRArena* current() { return t_current; }
+
+  /*
+   * Makes `arena` the target of arena-aware allocations on this thread until
+   * the scope ends. A null arena disables arena allocation for the scope.
+   */
+  class Scope final {
+   public:
+    explicit Scope(IRArena* arena) : m_previous(t_current) {
+      t_current = arena;
+    }
+    ~Scope() { t_current = m_previous; }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    IRArena* m_previous;
+  };
+
+  /*
+   * Returns memory for `size` bytes, 8-byte aligned, or nullptr if the request
+   * is too large for a chunk. `size_class` receives the chunk size class.
+   */
+  void* allocate(size_t size, uint8_t* size_class);
+
+  // Returns memory obtained from `allocate` to its arena.
+  static void deallocate(void* ptr, uint8_t size_class);
+
+  // Total bytes reserved in chunks, for statistics.
+  size_t reserved_bytes() const { return m_reserved_bytes; }
+
+ private:
+  struct ChunkHeader {
+    IRArena* arena;
+  };
+
+  explicit IRArena(size_t size_hint);
+  ~IRArena();
+
+  void release() {
+    if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+  bool new_chunk(size_t min_payload);
+
+  static bool s_enabled;
+  static thread_local IRArena* t_current;
+
+  std::atomic<size_t> m_refs{1};
+  char* m_cur{nullptr};
+  char* m_end{nullptr};
+  uint8_t m_cur_size_class{0};
+  size_t m_next_chunk_log2;
+  size_t m_reserved_bytes{0};
+  std::vector<void*> m_chunks;
+};
+
+namespace ir_arena {
+
+namespace detail {
+
+struct Allocation {
+  const char* begin{nullptr};
+  const char* end{nullptr};
+  uint8_t size_class{0};
+};
+
+// The last arena allocation made on this thread, not yet claimed by the
+// constructor of the object placed into it.
+extern thread_local Allocation t_last_allocated;
+// The last arena-allocated object that was destroyed on this thread, not yet
+// deallocated.
+extern thread_local Allocation t_last_destroyed;
+
+} // namespace detail
+
+/*
+ * A one-byte member of arena-aware classes that records whether the enclosing
+ * object lives in an arena. Operator new and delete cannot pass information to
+ * constructors and destructors, so the allocation and the destruction are
+ * handed over through thread-local variables, and matched by address.
+ */
+class Tag final {
+ public:
+  Tag() : m_size_class(claim(this)) {}
+  // Where an object lives is not part of its value.
+  Tag(const Tag&) : Tag() {}
+  Tag& operator=(const Tag&) { return *this; }
+
+  ~Tag() {
+    if (m_size_class != 0) {
+      auto* addr = reinterpret_cast<const char*>(this);
+      detail::t_last_destroyed = {addr, addr + 1, m_size_class};
+    }
+  }
+
+  bool in_arena() const { return m_size_class != 0; }
+
+  uint8_t size_class() const { return m_size_class; }
+
+ private:
+  static uint8_t claim(const void* member) {
+    auto* addr = reinterpret_cast<const char*>(member);
+    auto& last = detail::t_last_allocated;
+    if (addr >= last.begin && addr < last.end) {
+      uint8_t size_class = last.size_class;
+      last = detail::Allocation();
+      return size_class;
+    }
+    return 0;
+  }
+
+  uint8_t m_size_class;
+};
+
+// To be used by the class-specific operator new of arena-aware classes.
+inline void* allocate_object(size_t size) {
+  if (auto* arena = IRArena::current()) {
+    uint8_t size_class;
+    if (void* ptr = arena->allocate(size, &size_class)) {
+      auto* begin = static_cast<const char*>(ptr);
+      detail::t_last_allocated = {begin, begin + size, size_class};
+      return ptr;
+    }
+  }
+  return ::operator new(size);
+}
+
+// To be used by the class-specific operator delete of arena-aware classes.
+inline void deallocate_object(void* ptr, size_t size) {
+  auto& last = detail::t_last_destroyed;
+  auto* begin = static_cast<const char*>(ptr);
+  if (last.begin >= begin && last.begin < begin + size) {
+    uint8_t size_class = last.size_class;
+    last = detail::Allocation();
+    IRArena::deallocate(ptr, size_class);
+    return;
+  }
+  ::operator delete(ptr);
+}
+
+} // namespace ir_arena
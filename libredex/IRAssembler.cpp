@@ -43,9 +43,17 @@ using LabelRefs =
 
 reg_t reg_from_str(const std::string& reg_str) {
   always_assert(reg_str.at(0) == 'v');
-  reg_t reg;
-  sscanf(&reg_str.c_str()[1], "%u", &reg);
-  return reg;
+  return static_cast<reg_t>(strtoul(reg_str.c_str() + 1, nullptr, 10));
+}
+
+// Like s_patn::must_match, but only builds the message when matching fails.
+void must_match(s_patn pattern,
+                const s_expr& e,
+                const char* msg,
+                const std::string& opcode_str) {
+  if (!pattern.match_with(e)) {
+    pattern.must_match(e, msg + opcode_str);
+  }
 }
 
 std::string reg_to_str(reg_t reg) { return "v" + std::to_string(reg); }
@@ -178,8 +186,8 @@ std::unique_ptr<IRInstruction> instruction_from_s_expr(
   std::string reg_str;
   s_expr tail = e;
   if (insn->has_dest()) {
-    s_patn({s_patn(&reg_str)}, tail)
-        .must_match(tail, "Expected dest reg for " + opcode_str);
+    must_match(s_patn({s_patn(&reg_str)}, tail), tail,
+               "Expected dest reg for ", opcode_str);
     insn->set_dest(reg_from_str(reg_str));
   }
   if (opcode::has_variable_srcs_size(op)) {
@@ -191,8 +199,8 @@ std::unique_ptr<IRInstruction> instruction_from_s_expr(
     }
   } else {
     for (size_t i = 0; i < insn->srcs_size(); ++i) {
-      s_patn({s_patn(&reg_str)}, tail)
-          .must_match(tail, "Expected src reg for" + opcode_str);
+      must_match(s_patn({s_patn(&reg_str)}, tail), tail,
+                 "Expected src reg for", opcode_str);
       insn->set_src(i, reg_from_str(reg_str));
     }
   }
@@ -204,42 +212,39 @@ std::unique_ptr<IRInstruction> instruction_from_s_expr(
     break;
   case opcode::Ref::Field: {
     std::string str;
-    s_patn({s_patn(&str)}, tail)
-        .must_match(tail, "Expecting string literal for " + opcode_str);
+    must_match(s_patn({s_patn(&str)}, tail), tail,
+               "Expecting string literal for ", opcode_str);
     auto* dex_field = DexField::make_field(str);
     insn->set_field(dex_field);
     break;
   }
   case opcode::Ref::Method: {
     std::string str;
-    s_patn({s_patn(&str)}, tail)
-        .must_match(tail, "Expecting string literal for " + opcode_str);
+    must_match(s_patn({s_patn(&str)}, tail), tail,
+               "Expecting string literal for ", opcode_str);
     auto* dex_method = DexMethod::make_method(str);
     insn->set_method(dex_method);
     break;
   }
   case opcode::Ref::String: {
     std::string str;
-    s_patn({s_patn(&str)}, tail)
-        .must_match(tail, "Expecting string literal for " + opcode_str);
+    must_match(s_patn({s_patn(&str)}, tail), tail,
+               "Expecting string literal for ", opcode_str);
     auto* dex_str = DexString::make_string(str);
     insn->set_string(dex_str);
     break;
   }
   case opcode::Ref::Literal: {
     std::string num_str;
-    s_patn({s_patn(&num_str)}, tail)
-        .must_match(tail, "Expecting numeric literal for " + opcode_str);
-    int64_t num;
-    std::istringstream in(num_str);
-    in >> num;
-    insn->set_literal(num);
+    must_match(s_patn({s_patn(&num_str)}, tail), tail,
+               "Expecting numeric literal for ", opcode_str);
+    insn->set_literal(strtoll(num_str.c_str(), nullptr, 10));
     break;
   }
   case opcode::Ref::Type: {
     std::string type_str;
-    s_patn({s_patn(&type_str)}, tail)
-        .must_match(tail, "Expecting type specifier for " + opcode_str);
+    must_match(s_patn({s_patn(&type_str)}, tail), tail,
+               "Expecting type specifier for ", opcode_str);
     DexType* ty = DexType::make_type(type_str.c_str());
     insn->set_type(ty);
     break;
@@ -258,14 +263,14 @@ std::unique_ptr<IRInstruction> instruction_from_s_expr(
     std::string label_str;
     if (opcode::is_switch(op)) {
       s_expr list;
-      s_patn({s_patn(list)}, tail)
-          .must_match(tail, "Expecting list of labels for " + opcode_str);
+      must_match(s_patn({s_patn(list)}, tail), tail,
+                 "Expecting list of labels for ", opcode_str);
       while (s_patn({s_patn(&label_str)}, list).match_with(list)) {
         (*label_refs)[insn.get()].push_back(label_str);
       }
     } else {
-      s_patn({s_patn(&label_str)}, tail)
-          .must_match(tail, "Expecting label for " + opcode_str);
+      must_match(s_patn({s_patn(&label_str)}, tail), tail,
+                 "Expecting label for ", opcode_str);
       (*label_refs)[insn.get()].push_back(label_str);
     }
   }
@@ -640,7 +645,7 @@ s_expr create_source_block_expr(const MethodItemEntry* mie) {
   result.emplace_back(std::to_string(src->id));
 
   std::vector<s_expr> vals;
-  for (const auto& val : src->vals) {
+  for (const auto& val : src->vals()) {
     if (val) {
       vals.emplace_back(
           std::vector<s_expr>{s_expr(std::to_string(val->val)),
@@ -798,6 +803,8 @@ std::unique_ptr<IRCode> ircode_from_s_expr(const s_expr& e) {
   always_assert(matched);
   always_assert_log(insns_expr.size() > 0, "Empty instruction list?! %s",
                     e.str().c_str());
+  code->create_arena(insns_expr.size());
+  IRArena::Scope arena_scope(code->arena());
   LabelDefs label_defs;
   LabelRefs label_refs;
   boost::optional<reg_t> max_reg;
@@ -582,10 +582,35 @@ IRCode::~IRCode() {
   }
 
   delete m_ir_list;
+
+  if (m_arena != nullptr) {
+    m_arena->release_owner();
+  }
+}
+
+namespace {
+
+// Rough estimate of the arena memory needed for a method of `num_insns`
+// instructions, accounting for entries of positions, targets, etc.
+size_t arena_size_hint(size_t num_insns) {
+  return num_insns * (sizeof(IRInstruction) + 2 * sizeof(MethodItemEntry));
+}
+
+} // namespace
+
+void IRCode::create_arena(size_t num_insns) {
+  always_assert(m_arena == nullptr && m_ir_list->empty() && !m_cfg);
+  if (IRArena::enabled()) {
+    m_arena = IRArena::create(arena_size_hint(num_insns));
+  }
 }
 
 IRCode::IRCode(DexMethod* method) : m_ir_list(new IRList()) {
   auto* dc = method->get_dex_code();
+  if (IRArena::enabled()) {
+    m_arena = IRArena::create(arena_size_hint(dc->get_instructions().size()));
+  }
+  IRArena::Scope arena_scope(m_arena);
   generate_load_params(method, dc->get_registers_size() - dc->get_ins_size(),
                        this);
   balloon(const_cast<DexMethod*>(method), m_ir_list);
@@ -598,6 +623,14 @@ IRCode::IRCode(DexMethod* method, size_t temp_regs) : m_ir_list(new IRList()) {
 }
 
 IRCode::IRCode(const IRCode& code) {
+  if (IRArena::enabled()) {
+    m_arena = IRArena::create(arena_size_hint(
+        code.editable_cfg_built() ? code.m_cfg->num_opcodes()
+                                  : code.m_ir_list->size()));
+  }
+  // MethodItemEntryCloner and cfg deep copies allocate with plain `new`, so
+  // the copies land in our arena.
+  IRArena::Scope arena_scope(m_arena);
   if (code.editable_cfg_built()) {
     m_ir_list = new IRList(); // Empty.
     m_cfg = std::make_unique<cfg::ControlFlowGraph>();
@@ -647,6 +680,7 @@ void IRCode::clear_cfg(
   }
 
   if (m_cfg->editable()) {
+    m_mutation_epoch += m_cfg->mutations();
     m_registers_size = m_cfg->get_registers_size();
     if (m_ir_list != nullptr) {
       m_ir_list->clear_and_dispose();
@@ -675,6 +709,10 @@ bool IRCode::editable_cfg_built() const {
   return m_cfg != nullptr && m_cfg->editable();
 }
 
+size_t IRCode::mutation_epoch() const {
+  return m_mutation_epoch + (editable_cfg_built() ? m_cfg->mutations() : 0);
+}
+
 namespace {
 
 using RegMap = transform::RegMap;
@@ -718,6 +756,43 @@ void calculate_ins_size(const DexMethod* method, DexCode* dex_code) {
   dex_code->set_ins_size(ins_size);
 }
 
+/*
+ * The addresses of the MethodItemEntries of a method, in code units. All the
+ * entries of a method are added in one pass, after which `finalize` sorts
+ * them for lookup. Unlike a hash map, this takes a single allocation per sync
+ * attempt instead of one for each entry.
+ */
+class EntryAddrs {
+ public:
+  explicit EntryAddrs(size_t size) { m_addrs.reserve(size); }
+
+  void add(const MethodItemEntry* mie, uint32_t addr) {
+    m_addrs.emplace_back(mie, addr);
+  }
+
+  void finalize() { std::sort(m_addrs.begin(), m_addrs.end()); }
+
+  // Returns nullptr if `mie` was not added.
+  uint32_t* find(const MethodItemEntry* mie) {
+    auto it = std::lower_bound(m_addrs.begin(), m_addrs.end(),
+                               std::make_pair(mie, uint32_t(0)));
+    return it != m_addrs.end() && it->first == mie ? &it->second : nullptr;
+  }
+
+  uint32_t& at(const MethodItemEntry* mie) {
+    auto addr = find(mie);
+    always_assert_log(addr != nullptr, "no address for %p", mie);
+    return *addr;
+  }
+
+  uint32_t at(const MethodItemEntry* mie) const {
+    return const_cast<EntryAddrs*>(this)->at(mie);
+  }
+
+ private:
+  std::vector<std::pair<const MethodItemEntry*, uint32_t>> m_addrs;
+};
+
 /*
  * Gather the debug opcodes and DexPositions in :ir_list and put them in
  * :entries. As part of this process, we do some pruning of redundant
@@ -746,7 +821,7 @@ void calculate_ins_size(const DexMethod* method, DexCode* dex_code) {
  */
 void gather_debug_entries(
     IRList* ir_list,
-    const std::unordered_map<MethodItemEntry*, uint32_t>& entry_to_addr,
+    const EntryAddrs& entry_to_addr,
     std::vector<DexDebugEntry>* entries) {
   bool next_pos_is_root{false};
   // A root is the first DexPosition that precedes an opcode
@@ -849,7 +924,7 @@ std::unique_ptr<DexCode> IRCode::sync(const DexMethod* method) {
 }
 
 bool IRCode::try_sync(DexCode* code) {
-  std::unordered_map<MethodItemEntry*, uint32_t> entry_to_addr;
+  EntryAddrs entry_to_addr(m_ir_list->size());
   uint32_t addr = 0;
   // Step 1, regenerate opcode list for the method, and
   // and calculate the opcode entries address offsets.
@@ -857,12 +932,13 @@ bool IRCode::try_sync(DexCode* code) {
   for (auto miter = m_ir_list->begin(); miter != m_ir_list->end(); ++miter) {
     MethodItemEntry* mentry = &*miter;
     TRACE(MTRANS, 5, "Analyzing mentry %p", mentry);
-    entry_to_addr[mentry] = addr;
+    entry_to_addr.add(mentry, addr);
     if (mentry->type == MFLOW_DEX_OPCODE) {
       TRACE(MTRANS, 5, "Emitting mentry %p at %08x", mentry, addr);
       addr += mentry->dex_insn->size();
     }
   }
+  entry_to_addr.finalize();
   // Step 2, Branch relaxation: calculate branch offsets for if-* and goto
   // opcodes, resizing them where necessary. Since resizing opcodes affects
   // address offsets, we need to iterate this to a fixed point.
@@ -877,7 +953,7 @@ bool IRCode::try_sync(DexCode* code) {
   bool needs_resync = false;
   for (auto miter = m_ir_list->begin(); miter != m_ir_list->end(); ++miter) {
     MethodItemEntry* mentry = &*miter;
-    if (entry_to_addr.find(mentry) == entry_to_addr.end()) {
+    if (entry_to_addr.find(mentry) == nullptr) {
       continue;
     }
     if (mentry->type == MFLOW_DEX_OPCODE) {
@@ -897,10 +973,10 @@ bool IRCode::try_sync(DexCode* code) {
                  dex_opcode::is_branch(bt->src->dex_insn->opcode())) {
         MethodItemEntry* branch_op_mie = bt->src;
         auto branch_addr = entry_to_addr.find(branch_op_mie);
-        always_assert_log(branch_addr != entry_to_addr.end(),
+        always_assert_log(branch_addr != nullptr,
                           "%s refers to nonexistent branch instruction",
                           SHOW(*mentry));
-        int32_t branch_offset = entry_to_addr.at(mentry) - branch_addr->second;
+        int32_t branch_offset = entry_to_addr.at(mentry) - *branch_addr;
         needs_resync |= !encode_offset(m_ir_list, mentry, branch_offset);
       }
     }
@@ -43,7 +43,14 @@ class IRCode {
   IRList* m_ir_list;
   std::unique_ptr<cfg::ControlFlowGraph> m_cfg;
 
+  // Backs the instructions and entries created when this code was built, if
+  // IRArena is enabled. We only hold the owner reference; see IRArena.
+  IRArena* m_arena{nullptr};
+
   reg_t m_registers_size{0};
+  // Edits made through the IRList API, and through editable CFGs that have
+  // been cleared since.
+  size_t m_mutation_epoch{0};
   bool m_cfg_serialized_with_custom_strategy = false;
 
   // Hack: in general the IRCode is not handled as owning instructions, as they
@@ -58,12 +65,14 @@ class IRCode {
   IRList::iterator make_if_block(const IRList::iterator& cur,
                                  IRInstruction* insn,
                                  IRList::iterator* if_block) {
+    m_mutation_epoch++;
     return m_ir_list->make_if_block(cur, insn, if_block);
   }
   IRList::iterator make_if_else_block(const IRList::iterator& cur,
                                       IRInstruction* insn,
                                       IRList::iterator* if_block,
                                       IRList::iterator* else_block) {
+    m_mutation_epoch++;
     return m_ir_list->make_if_else_block(cur, insn, if_block, else_block);
   }
   IRList::iterator make_switch_block(
@@ -71,6 +80,7 @@ class IRCode {
       IRInstruction* insn,
       IRList::iterator* default_block,
       std::map<SwitchIndices, IRList::iterator>& cases) {
+    m_mutation_epoch++;
     return m_ir_list->make_switch_block(cur, insn, default_block, cases);
   }
 
@@ -103,6 +113,13 @@ class IRCode {
   ~IRCode();
 
   void set_insn_ownership(bool owns_insns) { m_owns_insns = owns_insns; }
+  bool owns_insns() const { return m_owns_insns; }
+
+  // For code that is built up piecewise: creates an arena for about
+  // `num_insns` instructions if IRArena is enabled, to be put in scope while
+  // the IR is allocated. Must be called before anything was added.
+  void create_arena(size_t num_insns);
+  IRArena* arena() const { return m_arena; }
 
   bool structural_equals(const IRCode& other) const {
     return m_ir_list->structural_equals(*other.m_ir_list,
@@ -118,11 +135,18 @@ class IRCode {
 
   reg_t get_registers_size() const { return m_registers_size; }
 
-  void set_registers_size(reg_t sz) { m_registers_size = sz; }
+  void set_registers_size(reg_t sz) {
+    m_mutation_epoch++;
+    m_registers_size = sz;
+  }
 
-  reg_t allocate_temp() { return m_registers_size++; }
+  reg_t allocate_temp() {
+    m_mutation_epoch++;
+    return m_registers_size++;
+  }
 
   reg_t allocate_wide_temp() {
+    m_mutation_epoch++;
     reg_t new_reg = m_registers_size;
     m_registers_size += 2;
     return new_reg;
@@ -182,6 +206,16 @@ class IRCode {
   bool cfg_built() const;
   bool editable_cfg_built() const;
 
+  /*
+   * Increases with every edit made through the API of this IRCode or of its
+   * editable CFG, so that callers can tell whether the code changed since they
+   * last looked at it. Building and clearing a CFG without edits doesn't
+   * count. Instructions that are modified in place are not noticed; call
+   * `mark_mutated` after such edits.
+   */
+  size_t mutation_epoch() const;
+  void mark_mutated() { m_mutation_epoch++; }
+
   /* Generate DexCode from IRCode */
   std::unique_ptr<DexCode> sync(const DexMethod*);
 
@@ -189,6 +223,7 @@ class IRCode {
    * which is O(1) instead of O(n). */
   /* Passes memory ownership of "from" to callee.  It will delete it. */
   void replace_opcode(IRInstruction* from, IRInstruction* to) {
+    m_mutation_epoch++;
     m_ir_list->replace_opcode(from, to);
   }
 
@@ -197,12 +232,14 @@ class IRCode {
   /* Passes memory ownership of "from" to callee.  It will delete it. */
   void replace_opcode(IRInstruction* to_delete,
                       const std::vector<IRInstruction*>& replacements) {
+    m_mutation_epoch++;
     m_ir_list->replace_opcode(to_delete, replacements);
   }
 
   /* Passes memory ownership of "from" to callee.  It will delete it. */
   void replace_opcode(const IRList::iterator& it,
                       const std::vector<IRInstruction*>& replacements) {
+    m_mutation_epoch++;
     m_ir_list->replace_opcode(it, replacements);
   }
 
@@ -211,22 +248,28 @@ class IRCode {
    * to appease the compiler in various scenarios of unreachable code.
    */
   void replace_opcode_with_infinite_loop(IRInstruction* from) {
+    m_mutation_epoch++;
     m_ir_list->replace_opcode_with_infinite_loop(from);
   }
 
   /* Like replace_opcode, but both :from and :to must be branch opcodes.
    * :to will end up jumping to the same destination as :from. */
   void replace_branch(IRInstruction* from, IRInstruction* to) {
+    m_mutation_epoch++;
     m_ir_list->replace_branch(from, to);
   }
 
   template <class... Args>
   void push_back(Args&&... args) {
+    m_mutation_epoch++;
     m_ir_list->push_back(*(new MethodItemEntry(std::forward<Args>(args)...)));
   }
 
   /* Passes memory ownership of "mie" to callee. */
-  void push_back(MethodItemEntry& mie) { m_ir_list->push_back(mie); }
+  void push_back(MethodItemEntry& mie) {
+    m_mutation_epoch++;
+    m_ir_list->push_back(mie);
+  }
 
   /*
    * Insert after instruction :position.
@@ -238,22 +281,26 @@ class IRCode {
    */
   void insert_after(IRInstruction* position,
                     const std::vector<IRInstruction*>& opcodes) {
+    m_mutation_epoch++;
     m_ir_list->insert_after(position, opcodes);
   }
 
   IRList::iterator insert_before(const IRList::iterator& position,
                                  MethodItemEntry& mie) {
+    m_mutation_epoch++;
     return m_ir_list->insert_before(position, mie);
   }
 
   IRList::iterator insert_after(const IRList::iterator& position,
                                 MethodItemEntry& mie) {
+    m_mutation_epoch++;
     return m_ir_list->insert_after(position, mie);
   }
 
   template <class... Args>
   IRList::iterator insert_before(const IRList::iterator& position,
                                  Args&&... args) {
+    m_mutation_epoch++;
     return m_ir_list->insert_before(
         position, *(new MethodItemEntry(std::forward<Args>(args)...)));
   }
@@ -262,6 +309,7 @@ class IRCode {
   IRList::iterator insert_after(const IRList::iterator& position,
                                 Args&&... args) {
     always_assert(position != m_ir_list->end());
+    m_mutation_epoch++;
     return m_ir_list->insert_after(
         position, *(new MethodItemEntry(std::forward<Args>(args)...)));
   }
@@ -269,7 +317,10 @@ class IRCode {
   /* DEPRECATED! Use the version below that passes in the iterator instead,
    * which is O(1) instead of O(n). */
   /* Memory ownership of "insn" passes to callee, it will delete it. */
-  void remove_opcode(IRInstruction* insn) { m_ir_list->remove_opcode(insn); }
+  void remove_opcode(IRInstruction* insn) {
+    m_mutation_epoch++;
+    m_ir_list->remove_opcode(insn);
+  }
 
   /*
    * Remove the instruction that :it points to.
@@ -278,6 +329,7 @@ class IRCode {
    * remove both that instruction and the move-result-pseudo that follows.
    */
   void remove_opcode(const IRList::iterator& it) {
+    m_mutation_epoch++;
     m_ir_list->remove_opcode(it);
   }
 
@@ -310,9 +362,11 @@ class IRCode {
   IRList::iterator main_block() { return m_ir_list->main_block(); }
 
   IRList::iterator erase(const IRList::iterator& it) {
+    m_mutation_epoch++;
     return m_ir_list->erase(it);
   }
   IRList::iterator erase_and_dispose(const IRList::iterator& it) {
+    m_mutation_epoch++;
     return m_ir_list->erase_and_dispose(it);
   }
 
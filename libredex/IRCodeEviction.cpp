@@ -0,0 +1,459 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "IRCodeEviction.h"
+
+#include <boost/filesystem.hpp>
+#include <cinttypes>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <unordered_map>
+
+#include "BinaryContainer.h"
+#include "DexDebugInstruction.h"
+#include "DexPosition.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "ParallelPrint.h"
+#include "Trace.h"
+#include "Walkers.h"
+#include "WorkQueue.h"
+
+namespace ir_eviction {
+
+namespace {
+
+constexpr uint32_t EVICTED_CODE_VERSION = 1;
+constexpr uint32_t CODE_SECTION = 1;
+constexpr uint32_t NO_ENTRY = std::numeric_limits<uint32_t>::max();
+
+class Writer {
+ public:
+  template <class T>
+  void put(const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable values can be written");
+    m_data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  void put_ptr(const void* ptr) { put<uint64_t>((uintptr_t)ptr); }
+
+  const std::string& data() const { return m_data; }
+
+ private:
+  std::string m_data;
+};
+
+class Reader {
+ public:
+  explicit Reader(std::string_view data) : m_data(data) {}
+
+  template <class T>
+  void get(T* value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable values can be read");
+    always_assert_log(m_data.size() - m_pos >= sizeof(T),
+                      "Truncated evicted code");
+    memcpy(value, m_data.data() + m_pos, sizeof(T));
+    m_pos += sizeof(T);
+  }
+
+  template <class T>
+  T get() {
+    T value;
+    get(&value);
+    return value;
+  }
+
+  template <class T>
+  T* get_ptr() {
+    return reinterpret_cast<T*>((uintptr_t)get<uint64_t>());
+  }
+
+  bool done() const { return m_pos == m_data.size(); }
+
+ private:
+  std::string_view m_data;
+  size_t m_pos{0};
+};
+
+using EntryIndex = std::unordered_map<const MethodItemEntry*, uint32_t>;
+using PositionIndex = std::unordered_map<const DexPosition*, uint32_t>;
+
+/*
+ * Numbers the entries of the code, and checks that everything they point to
+ * is part of the code. Returns false if the code cannot be written.
+ */
+bool index_entries(IRCode* code, EntryIndex* index, PositionIndex* pos_index) {
+  if (code->cfg_built() || !code->owns_insns()) {
+    return false;
+  }
+  for (const auto& mie : *code) {
+    if (mie.type == MFLOW_DEX_OPCODE) {
+      return false;
+    }
+    auto idx = (uint32_t)index->size();
+    index->emplace(&mie, idx);
+    if (mie.type == MFLOW_POSITION) {
+      pos_index->emplace(mie.pos.get(), idx);
+    }
+  }
+  for (const auto& mie : *code) {
+    switch (mie.type) {
+    case MFLOW_TRY:
+      if (!index->count(mie.tentry->catch_start)) {
+        return false;
+      }
+      break;
+    case MFLOW_CATCH:
+      if (mie.centry->next != nullptr && !index->count(mie.centry->next)) {
+        return false;
+      }
+      break;
+    case MFLOW_TARGET:
+      if (!index->count(mie.target->src)) {
+        return false;
+      }
+      break;
+    case MFLOW_POSITION:
+      if (mie.pos->parent != nullptr && !pos_index->count(mie.pos->parent)) {
+        return false;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  return true;
+}
+
+void write_insn(const IRInstruction* insn, Writer* w) {
+  w->put<uint16_t>(insn->opcode());
+  if (insn->has_dest()) {
+    w->put<uint32_t>(insn->dest());
+  }
+  w->put<uint32_t>(insn->srcs_size());
+  for (auto src : insn->srcs()) {
+    w->put<uint32_t>(src);
+  }
+  switch (opcode::ref(insn->opcode())) {
+  case opcode::Ref::None:
+    break;
+  case opcode::Ref::Literal:
+    w->put<int64_t>(insn->get_literal());
+    break;
+  case opcode::Ref::String:
+    w->put_ptr(insn->get_string());
+    break;
+  case opcode::Ref::Type:
+    w->put_ptr(insn->get_type());
+    break;
+  case opcode::Ref::Field:
+    w->put_ptr(insn->get_field());
+    break;
+  case opcode::Ref::Method:
+    w->put_ptr(insn->get_method());
+    break;
+  case opcode::Ref::CallSite:
+    w->put_ptr(insn->get_callsite());
+    break;
+  case opcode::Ref::MethodHandle:
+    w->put_ptr(insn->get_methodhandle());
+    break;
+  case opcode::Ref::Data:
+    // Switch and array payloads are not owned by their instructions.
+    w->put_ptr(insn->get_data());
+    break;
+  }
+}
+
+IRInstruction* read_insn(Reader* r) {
+  auto* insn = new IRInstruction((IROpcode)r->get<uint16_t>());
+  if (insn->has_dest()) {
+    insn->set_dest(r->get<uint32_t>());
+  }
+  auto srcs_size = r->get<uint32_t>();
+  insn->set_srcs_size(srcs_size);
+  for (uint32_t i = 0; i < srcs_size; ++i) {
+    insn->set_src(i, r->get<uint32_t>());
+  }
+  switch (opcode::ref(insn->opcode())) {
+  case opcode::Ref::None:
+    break;
+  case opcode::Ref::Literal:
+    insn->set_literal(r->get<int64_t>());
+    break;
+  case opcode::Ref::String:
+    insn->set_string(r->get_ptr<const DexString>());
+    break;
+  case opcode::Ref::Type:
+    insn->set_type(r->get_ptr<DexType>());
+    break;
+  case opcode::Ref::Field:
+    insn->set_field(r->get_ptr<DexFieldRef>());
+    break;
+  case opcode::Ref::Method:
+    insn->set_method(r->get_ptr<DexMethodRef>());
+    break;
+  case opcode::Ref::CallSite:
+    insn->set_callsite(r->get_ptr<DexCallSite>());
+    break;
+  case opcode::Ref::MethodHandle:
+    insn->set_methodhandle(r->get_ptr<DexMethodHandle>());
+    break;
+  case opcode::Ref::Data:
+    insn->set_data(r->get_ptr<DexOpcodeData>());
+    break;
+  }
+  return insn;
+}
+
+void write_source_blocks(const SourceBlock* sb, Writer* w) {
+  uint32_t length = 0;
+  for (auto* cur = sb; cur != nullptr; cur = cur->next.get()) {
+    ++length;
+  }
+  w->put<uint32_t>(length);
+  for (auto* cur = sb; cur != nullptr; cur = cur->next.get()) {
+    w->put_ptr(cur->src);
+    w->put<uint32_t>(cur->id);
+    w->put<uint32_t>(cur->vals_size());
+    for (const auto& val : cur->vals()) {
+      w->put<SourceBlock::Val>(val);
+    }
+  }
+}
+
+std::unique_ptr<SourceBlock> read_source_blocks(Reader* r) {
+  std::unique_ptr<SourceBlock> head;
+  auto* tail = &head;
+  auto length = r->get<uint32_t>();
+  std::vector<SourceBlock::Val> vals;
+  for (uint32_t i = 0; i < length; ++i) {
+    auto* src = r->get_ptr<const DexString>();
+    auto id = r->get<uint32_t>();
+    vals.assign(r->get<uint32_t>(), SourceBlock::Val::none());
+    for (auto& val : vals) {
+      r->get(&val);
+    }
+    *tail = std::make_unique<SourceBlock>(src, id, vals);
+    tail = &(*tail)->next;
+  }
+  return head;
+}
+
+} // namespace
+
+EvictedCode::EvictedCode(const Scope& scope, std::string path)
+    : m_path(std::move(path)) {
+  std::vector<DexMethod*> methods;
+  walk::methods(scope, [&](DexMethod* method) {
+    if (method->get_code() != nullptr) {
+      methods.push_back(method);
+    }
+  });
+  std::vector<Method> written(methods.size());
+  std::vector<size_t> indices(methods.size());
+  std::iota(indices.begin(), indices.end(), 0);
+
+  std::ofstream ofs(m_path, std::ios::binary);
+  always_assert_log(ofs.good(), "Cannot write evicted code to %s",
+                    m_path.c_str());
+  binary_serialization::ContainerWriter writer(ofs, EVICTED_CODE_VERSION);
+  auto& os = writer.begin_section(CODE_SECTION);
+  redex::print_in_parallel(os, indices, [&](std::ostream& out, size_t i) {
+    auto* method = methods[i];
+    auto& m = written[i];
+    auto* code = method->get_code();
+    EntryIndex index;
+    PositionIndex pos_index;
+    if (!index_entries(code, &index, &pos_index)) {
+      return;
+    }
+    m.method = method;
+    Writer w;
+    w.put<uint32_t>(code->get_registers_size());
+    w.put<uint32_t>(index.size());
+    for (auto& mie : *code) {
+      w.put<uint8_t>(mie.type);
+      switch (mie.type) {
+      case MFLOW_TRY:
+        w.put<uint8_t>(mie.tentry->type);
+        w.put<uint32_t>(index.at(mie.tentry->catch_start));
+        break;
+      case MFLOW_CATCH:
+        w.put_ptr(mie.centry->catch_type);
+        w.put<uint32_t>(mie.centry->next == nullptr
+                            ? NO_ENTRY
+                            : index.at(mie.centry->next));
+        break;
+      case MFLOW_OPCODE:
+        write_insn(mie.insn, &w);
+        break;
+      case MFLOW_TARGET:
+        w.put<uint8_t>(mie.target->type);
+        w.put<int32_t>(mie.target->case_key);
+        w.put<uint32_t>(index.at(mie.target->src));
+        break;
+      case MFLOW_DEBUG:
+        w.put<uint32_t>(m.dbgops.size());
+        m.dbgops.push_back(std::move(mie.dbgop));
+        break;
+      case MFLOW_POSITION:
+        w.put_ptr(mie.pos->method);
+        w.put_ptr(mie.pos->file);
+        w.put<uint32_t>(mie.pos->line);
+        w.put<uint32_t>(mie.pos->parent == nullptr
+                            ? NO_ENTRY
+                            : pos_index.at(mie.pos->parent));
+        break;
+      case MFLOW_SOURCE_BLOCK:
+        write_source_blocks(mie.src_block.get(), &w);
+        break;
+      case MFLOW_FALLTHROUGH:
+        break;
+      case MFLOW_DEX_OPCODE:
+        not_reached();
+      }
+    }
+    m.dbg = code->release_debug_item();
+    m.size = w.data().size();
+    out.write(w.data().data(), w.data().size());
+    method->release_code();
+  });
+  writer.finish();
+  always_assert_log(!ofs.fail(), "Cannot write evicted code to %s",
+                    m_path.c_str());
+
+  for (auto& m : written) {
+    if (m.method == nullptr) {
+      continue;
+    }
+    m.offset = m_num_bytes;
+    m_num_bytes += m.size;
+    m_methods.push_back(std::move(m));
+  }
+  TRACE(MAIN, 2, "Evicted the code of %zu of %zu methods into %s (%" PRIu64
+        " bytes)", m_methods.size(), methods.size(), m_path.c_str(),
+        m_num_bytes);
+}
+
+EvictedCode::~EvictedCode() {
+  if (!m_reloaded) {
+    boost::system::error_code ec;
+    boost::filesystem::remove(m_path, ec);
+  }
+}
+
+void EvictedCode::reload() {
+  always_assert(!m_reloaded);
+  {
+    binary_serialization::ContainerReader reader(m_path);
+    always_assert_log(reader.version() == EVICTED_CODE_VERSION,
+                      "Unexpected version of evicted code in %s",
+                      m_path.c_str());
+    auto section = reader.section(CODE_SECTION);
+    always_assert_log(section.size() == m_num_bytes,
+                      "Evicted code in %s was changed", m_path.c_str());
+    workqueue_run<Method*>(
+        [&](Method* m) {
+          Reader r(section.substr(m->offset, m->size));
+          auto code = std::make_unique<IRCode>();
+          code->set_registers_size(r.get<uint32_t>());
+          std::vector<MethodItemEntry*> entries(r.get<uint32_t>());
+          // Entries that point to others are linked once all exist. A try
+          // entry cannot be created before the catch it points to.
+          std::vector<std::pair<uint32_t, uint32_t>> links;
+          std::vector<std::tuple<uint32_t, TryEntryType, uint32_t>> tries;
+          for (uint32_t i = 0; i < entries.size(); ++i) {
+            auto type = (MethodItemType)r.get<uint8_t>();
+            switch (type) {
+            case MFLOW_TRY: {
+              auto try_type = (TryEntryType)r.get<uint8_t>();
+              tries.emplace_back(i, try_type, r.get<uint32_t>());
+              break;
+            }
+            case MFLOW_CATCH:
+              entries[i] = new MethodItemEntry(r.get_ptr<DexType>());
+              links.emplace_back(i, r.get<uint32_t>());
+              break;
+            case MFLOW_OPCODE:
+              entries[i] = new MethodItemEntry(read_insn(&r));
+              break;
+            case MFLOW_TARGET: {
+              auto* target = new BranchTarget();
+              target->type = (BranchTargetType)r.get<uint8_t>();
+              target->case_key = r.get<int32_t>();
+              entries[i] = new MethodItemEntry(target);
+              links.emplace_back(i, r.get<uint32_t>());
+              break;
+            }
+            case MFLOW_DEBUG:
+              entries[i] = new MethodItemEntry(
+                  std::move(m->dbgops.at(r.get<uint32_t>())));
+              break;
+            case MFLOW_POSITION: {
+              auto* method = r.get_ptr<const DexString>();
+              auto* file = r.get_ptr<const DexString>();
+              auto line = r.get<uint32_t>();
+              entries[i] = new MethodItemEntry(
+                  std::make_unique<DexPosition>(method, file, line));
+              links.emplace_back(i, r.get<uint32_t>());
+              break;
+            }
+            case MFLOW_SOURCE_BLOCK:
+              entries[i] = new MethodItemEntry(read_source_blocks(&r));
+              break;
+            case MFLOW_FALLTHROUGH:
+              entries[i] = new MethodItemEntry();
+              break;
+            case MFLOW_DEX_OPCODE:
+              not_reached_log("Evicted code in %s is corrupt", m_path.c_str());
+            }
+          }
+          always_assert_log(r.done(), "Evicted code in %s is corrupt",
+                            m_path.c_str());
+          for (const auto& [i, try_type, catch_start] : tries) {
+            entries[i] = new MethodItemEntry(try_type, entries.at(catch_start));
+          }
+          for (const auto& [i, j] : links) {
+            auto* mie = entries[i];
+            if (mie->type == MFLOW_TARGET) {
+              mie->target->src = entries.at(j);
+            } else if (j == NO_ENTRY) {
+              continue;
+            } else if (mie->type == MFLOW_CATCH) {
+              mie->centry->next = entries.at(j);
+            } else {
+              mie->pos->parent = entries.at(j)->pos.get();
+            }
+          }
+          for (auto* mie : entries) {
+            code->push_back(*mie);
+          }
+          code->set_debug_item(std::move(m->dbg));
+          m->dbgops.clear();
+          m->method->set_code(std::move(code));
+        },
+        [&] {
+          std::vector<Method*> methods;
+          methods.reserve(m_methods.size());
+          for (auto& m : m_methods) {
+            methods.push_back(&m);
+          }
+          return methods;
+        }());
+  }
+  m_reloaded = true;
+  boost::system::error_code ec;
+  boost::filesystem::remove(m_path, ec);
+}
+
+} // namespace ir_eviction
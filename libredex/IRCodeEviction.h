@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "DexClass.h"
+
+class DexDebugInstruction;
+
+namespace ir_eviction {
+
+/*
+ * Moves the IRCode of the methods of some classes out of memory, into a
+ * compact spill file, until reload() brings it back.
+ *
+ * The spill file is only meaningful to the process that wrote it: strings,
+ * types, fields, methods, call sites, method handles and switch payloads are
+ * written as pointers, which stay valid as the RedexContext keeps them alive.
+ * Debug instructions and the debug items of the code are few and small; they
+ * stay in memory.
+ *
+ * Code that cannot be written this way stays in place: code with a built CFG,
+ * code that does not own its instructions, lowered code, and code with
+ * positions whose parents belong to other methods.
+ *
+ * Until its code is reloaded, an evicted method looks like one without code,
+ * so nothing may look at the code of the classes in the meantime.
+ */
+class EvictedCode {
+ public:
+  /*
+   * Writes the code of the methods of `scope` to the file at `path`, and frees
+   * it.
+   */
+  EvictedCode(const Scope& scope, std::string path);
+
+  EvictedCode(const EvictedCode&) = delete;
+  EvictedCode& operator=(const EvictedCode&) = delete;
+
+  // Removes the spill file, if the code was not reloaded.
+  ~EvictedCode();
+
+  /*
+   * Restores the code of all evicted methods, and removes the spill file.
+   */
+  void reload();
+
+  size_t num_methods() const { return m_methods.size(); }
+  uint64_t num_bytes() const { return m_num_bytes; }
+
+ private:
+  struct Method {
+    DexMethod* method{nullptr};
+    uint64_t offset{0};
+    uint64_t size{0};
+    std::unique_ptr<DexDebugItem> dbg;
+    std::vector<std::unique_ptr<DexDebugInstruction>> dbgops;
+  };
+
+  std::string m_path;
+  std::vector<Method> m_methods;
+  uint64_t m_num_bytes{0};
+  bool m_reloaded{false};
+};
+
+} // namespace ir_eviction
@@ -14,17 +14,44 @@
 #include "DexUtil.h"
 #include "Show.h"
 
+#include <algorithm>
 #include <boost/range/any_range.hpp>
 #include <cstring>
 #include <iterator>
 
+IRInstruction::SpilledSrcs* IRInstruction::allocate_spilled_srcs(size_t size) {
+  always_assert(size <= std::numeric_limits<uint16_t>::max());
+  size_t bytes = sizeof(SpilledSrcs) + size * sizeof(reg_t);
+  void* mem = nullptr;
+  uint8_t size_class = 0;
+  if (auto* arena = IRArena::current()) {
+    mem = arena->allocate(bytes, &size_class);
+  }
+  if (mem == nullptr) {
+    mem = ::operator new(bytes);
+    size_class = 0;
+  }
+  auto* srcs = new (mem) SpilledSrcs{static_cast<uint32_t>(size),
+                                     static_cast<uint16_t>(size), size_class};
+  std::fill_n(srcs->regs(), size, 0);
+  return srcs;
+}
+
+void IRInstruction::free_spilled_srcs(SpilledSrcs* srcs) {
+  if (srcs->size_class != 0) {
+    IRArena::deallocate(srcs, srcs->size_class);
+  } else {
+    ::operator delete(srcs);
+  }
+}
+
 IRInstruction::IRInstruction(IROpcode op) : m_opcode(op) {
   auto count = opcode_impl::min_srcs_size(op);
   if (count <= MAX_NUM_INLINE_SRCS) {
     m_num_inline_srcs = count;
   } else {
     m_num_inline_srcs = MAX_NUM_INLINE_SRCS + 1;
-    m_srcs = new std::vector<reg_t>(count);
+    m_srcs = allocate_spilled_srcs(count);
   }
 }
 
@@ -38,13 +65,14 @@ IRInstruction::IRInstruction(const IRInstruction& other)
       m_inline_srcs[i] = other.m_inline_srcs[i];
     }
   } else {
-    m_srcs = new std::vector<reg_t>(*other.m_srcs);
+    m_srcs = allocate_spilled_srcs(other.m_srcs->size);
+    std::copy_n(other.m_srcs->regs(), other.m_srcs->size, m_srcs->regs());
   }
 }
 
 IRInstruction::~IRInstruction() {
   if (m_num_inline_srcs > MAX_NUM_INLINE_SRCS) {
-    delete m_srcs;
+    free_spilled_srcs(m_srcs);
   }
 }
 
@@ -67,7 +95,9 @@ bool IRInstruction::operator==(const IRInstruction& that) const {
     }
     return true;
   } else {
-    return *m_srcs == *that.m_srcs;
+    return m_srcs->size == that.m_srcs->size &&
+           std::equal(m_srcs->regs(), m_srcs->regs() + m_srcs->size,
+                      that.m_srcs->regs());
   }
 }
 
@@ -76,7 +106,8 @@ reg_t IRInstruction::src(src_index_t i) const {
     always_assert(i < m_num_inline_srcs);
     return m_inline_srcs[i];
   }
-  return m_srcs->at(i);
+  always_assert(i < m_srcs->size);
+  return m_srcs->regs()[i];
 }
 
 IRInstruction::reg_range IRInstruction::srcs() const {
@@ -85,8 +116,8 @@ IRInstruction::reg_range IRInstruction::srcs() const {
     const reg_t* end = begin + m_num_inline_srcs;
     return reg_range(begin, end);
   }
-  const reg_t* begin = m_srcs->data();
-  const reg_t* end = begin + m_srcs->size();
+  const reg_t* begin = m_srcs->regs();
+  const reg_t* end = begin + m_srcs->size;
   return reg_range(begin, end);
 }
 
@@ -104,7 +135,8 @@ IRInstruction* IRInstruction::set_src(src_index_t i, reg_t reg) {
     always_assert(i < m_num_inline_srcs);
     m_inline_srcs[i] = reg;
   } else {
-    m_srcs->at(i) = reg;
+    always_assert(i < m_srcs->size);
+    m_srcs->regs()[i] = reg;
   }
   return this;
 }
@@ -113,7 +145,7 @@ size_t IRInstruction::srcs_size() const {
   if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
     return m_num_inline_srcs;
   }
-  return m_srcs->size();
+  return m_srcs->size;
 }
 
 IRInstruction* IRInstruction::set_srcs_size(size_t count) {
@@ -122,27 +154,31 @@ IRInstruction* IRInstruction::set_srcs_size(size_t count) {
       // staying in the inline state
       m_num_inline_srcs = count;
     } else {
-      // inline regs -> vector
-      auto srcs = new std::vector<reg_t>();
-      srcs->reserve(count);
-      for (auto i = 0; i < m_num_inline_srcs; ++i) {
-        srcs->push_back(m_inline_srcs[i]);
-      }
-      srcs->resize(count);
+      // inline regs -> spill
+      auto srcs = allocate_spilled_srcs(count);
+      std::copy_n(m_inline_srcs, m_num_inline_srcs, srcs->regs());
       m_num_inline_srcs = MAX_NUM_INLINE_SRCS + 1;
       m_srcs = srcs;
     }
   } else {
     if (count <= MAX_NUM_INLINE_SRCS) {
-      // vector -> inline regs
+      // spill -> inline regs
       auto old_srcs_ptr = m_srcs;
       m_num_inline_srcs = count;
-      always_assert(count <= old_srcs_ptr->size());
-      std::memcpy(m_inline_srcs, old_srcs_ptr->data(), count * sizeof(reg_t));
-      delete old_srcs_ptr;
+      always_assert(count <= old_srcs_ptr->size);
+      std::memcpy(m_inline_srcs, old_srcs_ptr->regs(), count * sizeof(reg_t));
+      free_spilled_srcs(old_srcs_ptr);
+    } else if (count <= m_srcs->capacity) {
+      // staying in the spill
+      std::fill(m_srcs->regs() + std::min<size_t>(m_srcs->size, count),
+                m_srcs->regs() + count, 0);
+      m_srcs->size = count;
     } else {
-      // staying in the vector state
-      m_srcs->resize(count);
+      // growing the spill
+      auto srcs = allocate_spilled_srcs(count);
+      std::copy_n(m_srcs->regs(), m_srcs->size, srcs->regs());
+      free_spilled_srcs(m_srcs);
+      m_srcs = srcs;
     }
   }
   return this;
@@ -329,17 +365,9 @@ void IRInstruction::denormalize_registers() {
     }
 
     // update m_inline_srcs or m_srcs
-    if (m_num_inline_srcs > MAX_NUM_INLINE_SRCS) {
-      delete m_srcs;
-    }
-    if (srcs.size() <= MAX_NUM_INLINE_SRCS) {
-      m_num_inline_srcs = srcs.size();
-      for (size_t i = 0; i < srcs.size(); ++i) {
-        m_inline_srcs[i] = srcs.at(i);
-      }
-    } else {
-      m_num_inline_srcs = MAX_NUM_INLINE_SRCS + 1;
-      m_srcs = new std::vector<reg_t>(std::move(srcs));
+    set_srcs_size(srcs.size());
+    for (size_t i = 0; i < srcs.size(); ++i) {
+      set_src(i, srcs[i]);
     }
   }
 }
@@ -929,7 +929,7 @@ std::string SourceBlock::show(bool quoted_src) const {
     }
     o << "@" << cur->id;
     o << "(";
-    for (const auto& val : cur->vals) {
+    for (const auto& val : cur->vals()) {
       if (val) {
         o << val->val << ":" << val->appear100;
       } else {
@@ -10,6 +10,7 @@
 #include <boost/intrusive/list.hpp>
 #include <boost/optional.hpp>
 #include <boost/range/sub_range.hpp>
+#include <algorithm>
 #include <functional>
 #include <iosfwd>
 #include <limits>
@@ -23,6 +24,7 @@
 #include <vector>
 
 #include "Debug.h"
+#include "IRArena.h"
 
 class DexCallSite;
 class DexDebugInstruction;
@@ -110,6 +112,8 @@ struct BranchTarget {
   bool operator==(const BranchTarget& other) const;
 };
 
+class SourceBlockValsArena;
+
 /**
  * A SourceBlock refers to a method and block ID that the following code came
  * from. It also has a float payload at the moment (though that is in flow),
@@ -168,35 +172,91 @@ struct SourceBlock {
    private:
     ValPair m_val;
   };
-  std::vector<Val> vals;
+
+  /*
+   * The values of a block, one per interaction. Inlining copies blocks, and
+   * many blocks have the same values, often all zero, so the values are
+   * interned in the RedexContext and shared, and a block only holds a
+   * pointer to them. Values never change once interned; a block that gets
+   * new values points to another interned array.
+   */
+  class Vals {
+   public:
+    Vals() = default;
+
+    size_t size() const { return m_data == nullptr ? 0 : *m_data; }
+    bool empty() const { return size() == 0; }
+    const Val* begin() const {
+      return m_data == nullptr ? nullptr
+                               : reinterpret_cast<const Val*>(m_data + 1);
+    }
+    const Val* end() const { return begin() + size(); }
+    const Val& operator[](size_t i) const { return begin()[i]; }
+
+    bool operator==(const Vals& other) const {
+      return m_data == other.m_data ||
+             std::equal(begin(), end(), other.begin(), other.end());
+    }
+
+    // Returns the interned array of the given values.
+    static Vals intern(const Val* vals, size_t size);
+    static Vals intern(const std::vector<Val>& vals) {
+      return intern(vals.data(), vals.size());
+    }
+
+   private:
+    // The number of values, followed by the values.
+    explicit Vals(const uint32_t* data) : m_data(data) {}
+    const uint32_t* m_data{nullptr};
+
+    friend class SourceBlockValsArena;
+  };
 
   SourceBlock() = default;
   SourceBlock(const DexString* src, size_t id) : src(src), id(id) {}
-  SourceBlock(const DexString* src, size_t id, std::vector<Val> v)
-      : src(src), id(id), vals(std::move(v)) {}
+  SourceBlock(const DexString* src, size_t id, const std::vector<Val>& v)
+      : src(src), id(id), m_vals(Vals::intern(v)) {}
   SourceBlock(const SourceBlock& other)
       : src(other.src),
         next(other.next == nullptr ? nullptr : new SourceBlock(*other.next)),
         id(other.id),
-        vals(other.vals) {}
+        m_vals(other.m_vals) {}
+
+  const Vals& vals() const { return m_vals; }
+  size_t vals_size() const { return m_vals.size(); }
+
+  void set_vals(const std::vector<Val>& vals) { m_vals = Vals::intern(vals); }
+
+  void set_val(size_t i, const Val& val) {
+    update_vals([&](std::vector<Val>& vals) { vals[i] = val; });
+  }
+
+  // Lets `fn` change a copy of the values, and interns the result.
+  template <typename Fn>
+  void update_vals(const Fn& fn) {
+    std::vector<Val> vals(m_vals.begin(), m_vals.end());
+    fn(vals);
+    set_vals(vals);
+  }
 
   boost::optional<float> get_val(size_t i) const {
-    return vals[i] ? boost::optional<float>(vals[i]->val) : boost::none;
+    return m_vals[i] ? boost::optional<float>(m_vals[i]->val) : boost::none;
   }
   boost::optional<float> get_appear100(size_t i) const {
-    return vals[i] ? boost::optional<float>(vals[i]->appear100) : boost::none;
+    return m_vals[i] ? boost::optional<float>(m_vals[i]->appear100)
+                     : boost::none;
   }
 
   template <typename Fn>
   void foreach_val(const Fn& fn) const {
-    for (const auto& val : vals) {
+    for (const auto& val : m_vals) {
       fn(val);
     }
   }
 
   template <typename Fn>
   bool foreach_val_early(const Fn& fn) const {
-    for (const auto& val : vals) {
+    for (const auto& val : m_vals) {
       if (fn(val)) {
         return true;
       }
@@ -205,7 +265,7 @@ struct SourceBlock {
   }
 
   bool operator==(const SourceBlock& other) const {
-    return src == other.src && id == other.id && vals == other.vals;
+    return src == other.src && id == other.id && m_vals == other.m_vals;
   }
 
   void append(std::unique_ptr<SourceBlock> sb) {
@@ -217,8 +277,12 @@ struct SourceBlock {
   }
 
   std::string show(bool quoted_src = false) const;
+
+ private:
+  Vals m_vals;
 };
 
+
 /*
  * MethodItemEntry (and the IRLists that it gets linked into) is a data
  * structure of DEX methods that is easier to modify than DexMethod.
@@ -260,6 +324,8 @@ std::ostream& operator<<(std::ostream&, const MethodItemType& type);
 struct MethodItemEntry {
   boost::intrusive::list_member_hook<> list_hook_;
   MethodItemType type;
+  // Fits in the padding after `type`.
+  ir_arena::Tag arena_tag;
 
   union {
     TryEntry* tentry{nullptr};
@@ -303,6 +369,14 @@ struct MethodItemEntry {
   MethodItemEntry() : type(MFLOW_FALLTHROUGH) {}
   ~MethodItemEntry();
 
+  // Entries are allocated in the current IRArena, if any.
+  static void* operator new(size_t size) {
+    return ir_arena::allocate_object(size);
+  }
+  static void operator delete(void* ptr, size_t size) {
+    ir_arena::deallocate_object(ptr, size);
+  }
+
   /*
    * This should only ever be used by the instruction lowering step. Do NOT use
    * it in passes!
@@ -511,6 +585,15 @@ class IRList {
     m_list.splice(pos, other.m_list, begin, end);
   }
 
+  // Same as above, for a range of `n` entries, without counting them.
+  void splice_selection(IRList::const_iterator pos,
+                        IRList& other,
+                        IRList::const_iterator begin,
+                        IRList::const_iterator end,
+                        size_t n) {
+    m_list.splice(pos, other.m_list, begin, end, n);
+  }
+
   template <typename Predicate>
   void remove_and_dispose_if(Predicate predicate) {
     m_list.remove_and_dispose_if(predicate, disposer);
@@ -10,6 +10,7 @@
 #include <fstream>
 #include <iostream>
 
+#include "RedexMappedFile.h"
 #include "Show.h"
 #include "StringBuilder.h"
 #include "Walkers.h"
@@ -171,12 +172,10 @@ void serialize_class_data(const Scope& classes, std::ofstream& ostrm) {
   });
 }
 
-void deserialize_class_data(std::ifstream& istrm, uint32_t data_size) {
-  auto data = std::make_unique<char[]>(data_size);
-  istrm.read((char*)data.get(), data_size);
-  char* ptr = data.get();
+void deserialize_class_data(const char* data, uint32_t data_size) {
+  const char* ptr = data;
   DexClass* cls = nullptr;
-  while (ptr - data.get() < data_size) {
+  while (ptr - data < data_size) {
     BlockType btype = (BlockType)*ptr++;
     always_assert(btype >= 0 && btype < BlockType::EndOfBlock);
     int strsize = read_uleb128((const uint8_t**)&ptr);
@@ -187,19 +186,19 @@ void deserialize_class_data(std::ifstream& istrm, uint32_t data_size) {
       cls = type_class(type);
       always_assert(cls != nullptr);
       ptr += strsize + 1;
-      deserialize_name_and_rstate((const char**)&ptr, cls);
+      deserialize_name_and_rstate(&ptr, cls);
       break;
     }
     case BlockType::FieldBlock: {
       DexField* field = find_field(cls, std::string(ptr, strsize));
       ptr += strsize + 1;
-      deserialize_name_and_rstate((const char**)&ptr, field);
+      deserialize_name_and_rstate(&ptr, field);
       break;
     }
     case BlockType::MethodBlock: {
       DexMethod* method = find_method(cls, std::string(ptr, strsize));
       ptr += strsize + 1;
-      deserialize_name_and_rstate((const char**)&ptr, method);
+      deserialize_name_and_rstate(&ptr, method);
       break;
     }
     default: {
@@ -236,14 +235,22 @@ void dump(const Scope& classes, const std::string& output_dir) {
 
 bool load(const std::string& input_dir) {
   std::string input_file = input_dir + IRMETA_FILE_NAME;
-  std::ifstream istrm(input_file, std::ios::binary | std::ios::in);
-  if (!istrm.is_open()) {
+  // The class data is read in place from the mapped file.
+  std::unique_ptr<RedexMappedFile> file;
+  try {
+    file = std::make_unique<RedexMappedFile>(
+        RedexMappedFile::open(input_file));
+  } catch (const std::runtime_error&) {
     std::cerr << "Can not open " << input_file << std::endl;
     return false;
   }
 
   ir_meta_header_t meta_header;
-  istrm.read((char*)&meta_header, sizeof(meta_header));
+  if (file->size() < sizeof(meta_header)) {
+    std::cerr << "May be not valid meta file\n";
+    return false;
+  }
+  memcpy(&meta_header, file->const_data(), sizeof(meta_header));
   if (strcmp(meta_header.magic, IRMETA_MAGIC_NUMBER) != 0) {
     std::cerr << "May be not valid meta file\n";
     return false;
@@ -252,9 +259,13 @@ bool load(const std::string& input_dir) {
     std::cerr << "Could not load the outdated IR meta data\n";
     return false;
   }
-  // file size
+  if (meta_header.classes_size > file->size() - sizeof(meta_header)) {
+    std::cerr << "Truncated meta file\n";
+    return false;
+  }
 
-  deserialize_class_data(istrm, meta_header.classes_size);
+  deserialize_class_data(file->const_data() + sizeof(meta_header),
+                         meta_header.classes_size);
 
   return true;
 }
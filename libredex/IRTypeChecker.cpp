@@ -13,6 +13,7 @@
 #include "DexPosition.h"
 #include "DexUtil.h"
 #include "Match.h"
+#include "MethodAnalysisCache.h"
 #include "MonitorCount.h"
 #include "RedexContext.h"
 #include "Resolver.h"
@@ -799,19 +800,26 @@ void IRTypeChecker::run() {
     return;
   }
 
-  m_type_inference = std::make_unique<TypeInference>(cfg);
-  m_type_inference->run(m_dex_method);
+  // The type checker runs after every pass, while most methods are left
+  // untouched by any one pass: the types inferred for them are reused.
+  m_type_envs = g_redex->method_analysis_cache().get(
+      m_dex_method, cfg, "TypeInference", [&]() {
+        TypeInference type_inference(cfg);
+        type_inference.run(m_dex_method);
+        return std::move(type_inference.get_type_environments());
+      });
 
   // Finally, we use the inferred types to type-check each instruction in the
   // method. We stop at the first type error encountered.
-  auto& type_envs = m_type_inference->get_type_environments();
+  const auto& type_envs = *m_type_envs;
   for (const MethodItemEntry& mie : InstructionIterable(code)) {
     IRInstruction* insn = mie.insn;
     try {
       auto it = type_envs.find(insn);
       always_assert_log(
           it != type_envs.end(), "%s in:\n%s", SHOW(mie), SHOW(code));
-      check_instruction(insn, &it->second);
+      auto type_env = it->second;
+      check_instruction(insn, &type_env);
     } catch (const TypeCheckingException& e) {
       m_good = false;
       std::ostringstream out;
@@ -845,7 +853,7 @@ void IRTypeChecker::run() {
 
   if (traceEnabled(TYPE, 9)) {
     std::ostringstream out;
-    m_type_inference->print(out);
+    out << *this;
     TRACE(TYPE, 9, "%s", out.str().c_str());
   }
 }
@@ -1453,7 +1461,7 @@ void IRTypeChecker::check_instruction(IRInstruction* insn,
 
 IRType IRTypeChecker::get_type(IRInstruction* insn, reg_t reg) const {
   check_completion();
-  auto& type_envs = m_type_inference->get_type_environments();
+  const auto& type_envs = *m_type_envs;
   auto it = type_envs.find(insn);
   if (it == type_envs.end()) {
     // The instruction doesn't belong to this method. We treat this as
@@ -1466,7 +1474,7 @@ IRType IRTypeChecker::get_type(IRInstruction* insn, reg_t reg) const {
 boost::optional<const DexType*> IRTypeChecker::get_dex_type(IRInstruction* insn,
                                                             reg_t reg) const {
   check_completion();
-  auto& type_envs = m_type_inference->get_type_environments();
+  const auto& type_envs = *m_type_envs;
   auto it = type_envs.find(insn);
   if (it == type_envs.end()) {
     // The instruction doesn't belong to this method. We treat this as
@@ -1477,7 +1485,15 @@ boost::optional<const DexType*> IRTypeChecker::get_dex_type(IRInstruction* insn,
 }
 
 std::ostream& operator<<(std::ostream& output, const IRTypeChecker& checker) {
-  checker.m_type_inference->print(output);
+  const auto& type_envs = *checker.m_type_envs;
+  for (cfg::Block* block : checker.m_dex_method->get_code()->cfg().blocks()) {
+    for (auto& mie : InstructionIterable(block)) {
+      IRInstruction* insn = mie.insn;
+      auto it = type_envs.find(insn);
+      always_assert(it != type_envs.end());
+      output << SHOW(insn) << " -- " << it->second << std::endl;
+    }
+  }
   return output;
 }
 
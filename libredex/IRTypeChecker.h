@@ -31,14 +31,12 @@ class IRInstruction;
 class IRTypeChecker final {
 
   using TypeEnvironment = type_inference::TypeEnvironment;
+  using TypeEnvironments =
+      std::unordered_map<const IRInstruction*, TypeEnvironment>;
 
  public:
   using reg_t = uint32_t;
 
-  // If we don't declare a destructor for this class, a default destructor will
-  // be generated by the compiler, which requires a complete definition of
-  // TypeInference, thus causing a compilation error. Note that the destructor's
-  // definition must be located after the definition of TypeInference.
   ~IRTypeChecker();
 
   explicit IRTypeChecker(DexMethod* dex_method,
@@ -154,7 +152,9 @@ class IRTypeChecker final {
   bool m_check_no_overwrite_this;
   bool m_good;
   std::string m_what;
-  std::unique_ptr<type_inference::TypeInference> m_type_inference;
+  // Shared with the MethodAnalysisCache, which keeps them for as long as the
+  // code of the method does not change.
+  std::shared_ptr<const TypeEnvironments> m_type_envs;
 
   friend std::ostream& operator<<(std::ostream&, const IRTypeChecker&);
 };
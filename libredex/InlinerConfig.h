@@ -26,6 +26,9 @@ struct InlinerConfig {
   bool multiple_callers{false};
   bool use_call_site_summaries{true};
   bool intermediate_shrinking{false};
+  // Whether intermediate shrinking only runs constant-propagation and
+  // local-dce, leaving the full shrinking sequence to the final shrinking.
+  bool fast_intermediate_shrinking{false};
   shrinker::ShrinkerConfig shrinker;
   bool shrink_other_methods{true};
   bool unique_inlined_registers{true};
@@ -518,7 +518,10 @@ Stats lower(DexMethod* method, bool lower_with_cfg) {
 }
 
 Stats run(DexStoresVector& stores, bool lower_with_cfg) {
-  auto scope = build_class_scope(stores);
+  return run(build_class_scope(stores), lower_with_cfg);
+}
+
+Stats run(const Scope& scope, bool lower_with_cfg) {
   return walk::parallel::methods<Stats>(scope, [lower_with_cfg](DexMethod* m) {
     Stats stats;
     if (m->get_code() == nullptr) {
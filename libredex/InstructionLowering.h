@@ -11,6 +11,7 @@
 #include <cstdint>
 #include <vector>
 
+class DexClass;
 class DexMethod;
 class DexStore;
 class IRInstruction;
@@ -19,6 +20,7 @@ struct MethodItemEntry;
 enum DexOpcode : uint16_t;
 
 using DexStoresVector = std::vector<DexStore>;
+using Scope = std::vector<DexClass*>;
 
 namespace instruction_lowering {
 
@@ -46,6 +48,7 @@ struct Stats {
 Stats lower(DexMethod*, bool lower_with_cfg = false);
 
 Stats run(DexStoresVector&, bool lower_with_cfg = false);
+Stats run(const Scope&, bool lower_with_cfg = false);
 
 namespace impl {
 
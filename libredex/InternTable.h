@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "ConcurrentArena.h"
+#include "Debug.h"
+
+/*
+ * A hash table for interning: it maps keys to pointers, and inserts a value
+ * only if there is none for its key yet. No operation takes a lock, apart
+ * from the rare refill of an arena chunk.
+ *
+ * The table is open-addressed with linear probing. Each bucket is an atomic
+ * word that goes from empty to an entry with a single CAS, and entries never
+ * change afterwards. Entries are allocated from an append-only arena.
+ *
+ * When a table is half full, a table twice as large is chained after it, and
+ * the thread that created it migrates the entries:
+ *  - Empty buckets of the old table are frozen one at a time. Inserters that
+ *    reach a frozen bucket move on to the next table. An entry still lands in
+ *    the old table if its bucket was not reached yet, and is then migrated.
+ *  - Lookups follow the chain and stop at the first empty bucket.
+ *  - Once all entries are copied, new operations start at the next table.
+ *    Old tables stay alive until the table is destroyed, as concurrent
+ *    operations may still be in them.
+ *
+ * Erasing an entry leaves a tombstone. The key can then be inserted again.
+ * Erasing a key while another thread inserts the same key is racy, as it is
+ * for any map.
+ */
+template <typename Key,
+          typename T,
+          typename Hash = std::hash<Key>,
+          typename Equal = std::equal_to<Key>>
+class InternTable final {
+  static_assert(std::is_trivially_destructible_v<Key>,
+                "Entries live in an arena");
+
+ public:
+  explicit InternTable(size_t initial_capacity = 1 << 12)
+      : m_first(new Table(initial_capacity)), m_current(m_first) {}
+
+  InternTable(const InternTable&) = delete;
+  InternTable& operator=(const InternTable&) = delete;
+
+  ~InternTable() {
+    for (Table* t = m_first; t != nullptr;) {
+      Table* next = t->next.load();
+      delete t;
+      t = next;
+    }
+  }
+
+  // Returns the value of the key, or nullptr if there is none.
+  T* get(const Key& key) const {
+    auto hash = hash_of(key);
+    for (Table* t = m_current.load(std::memory_order_acquire); t != nullptr;
+         t = t->next.load(std::memory_order_acquire)) {
+      size_t i = hash & t->mask;
+      for (size_t probes = 0; probes <= t->mask;
+           ++probes, i = (i + 1) & t->mask) {
+        auto bits = t->buckets[i].load(std::memory_order_acquire);
+        if (bits == kEmpty) {
+          return nullptr;
+        }
+        if (bits == kFrozen) {
+          break;
+        }
+        auto* entry = to_entry(bits);
+        if (!(bits & kDead) && matches(entry, key, hash)) {
+          return entry->value;
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  // Maps the key to the value if it has no value yet. Returns the value of
+  // the key, and whether it is the one given.
+  std::pair<T*, bool> get_or_emplace(const Key& key, T* value) {
+    auto* entry = new (m_arena.allocate(sizeof(Entry), alignof(Entry)))
+        Entry{key, value, hash_of(key)};
+    auto* stored = insert(m_current.load(std::memory_order_acquire), entry);
+    if (stored != entry) {
+      // The entry stays in the arena, unused.
+      return {stored->value, false};
+    }
+    m_size.fetch_add(1, std::memory_order_relaxed);
+    return {value, true};
+  }
+
+  // Returns whether the key had a value.
+  bool erase(const Key& key) {
+    auto hash = hash_of(key);
+    bool erased = false;
+    for (Table* t = m_current.load(std::memory_order_acquire); t != nullptr;
+         t = t->next.load(std::memory_order_acquire)) {
+      erased |= kill(t, hash, [&](const Entry* entry) {
+        return matches(entry, key, hash);
+      });
+    }
+    if (erased) {
+      m_size.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return erased;
+  }
+
+  size_t size() const { return m_size.load(std::memory_order_relaxed); }
+
+  // Calls `fn(key, value)` on all entries. This must not run concurrently
+  // with insertions.
+  template <typename Fn>
+  void for_each(const Fn& fn) const {
+    // Migrations finish before the thread that started them returns, so the
+    // last table holds all the entries.
+    Table* last = m_current.load();
+    while (last->next.load() != nullptr) {
+      last = last->next.load();
+    }
+    for (size_t i = 0; i <= last->mask; ++i) {
+      auto bits = last->buckets[i].load();
+      if (bits != kEmpty && bits != kFrozen && !(bits & kDead)) {
+        const auto* entry = to_entry(bits);
+        fn(entry->key, entry->value);
+      }
+    }
+  }
+
+ private:
+  struct Entry {
+    Key key;
+    T* value;
+    size_t hash;
+  };
+
+  // Bucket states. Entries are aligned, so the low bits of their addresses
+  // are free for the tombstone tag.
+  static constexpr uintptr_t kEmpty = 0;
+  static constexpr uintptr_t kFrozen = 1;
+  static constexpr uintptr_t kDead = 2;
+  static_assert(alignof(Entry) >= 4, "Low bits of entries must be free");
+
+  struct Table {
+    explicit Table(size_t capacity)
+        : mask(capacity - 1), buckets(new std::atomic<uintptr_t>[capacity]) {
+      always_assert(capacity > 0 && (capacity & mask) == 0);
+      for (size_t i = 0; i < capacity; ++i) {
+        buckets[i].store(kEmpty, std::memory_order_relaxed);
+      }
+    }
+    ~Table() { delete[] buckets; }
+
+    const size_t mask;
+    std::atomic<uintptr_t>* const buckets;
+    std::atomic<size_t> used{0};
+    std::atomic<Table*> next{nullptr};
+    std::atomic<bool> migrated{false};
+  };
+
+  static Entry* to_entry(uintptr_t bits) {
+    return reinterpret_cast<Entry*>(bits & ~kDead);
+  }
+
+  static size_t hash_of(const Key& key) {
+    // The finalizer of MurmurHash3, as linear probing needs good low bits,
+    // and std::hash is the identity on pointers.
+    uint64_t x = Hash()(key);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+  }
+
+  static bool matches(const Entry* entry, const Key& key, size_t hash) {
+    return entry->hash == hash && Equal()(entry->key, key);
+  }
+
+  // Inserts the entry into `t` or a later table, unless there is a live
+  // entry with the same key. Returns the entry that is in the table.
+  Entry* insert(Table* t, Entry* entry) {
+    while (true) {
+      size_t i = entry->hash & t->mask;
+      size_t probes = 0;
+      while (probes <= t->mask) {
+        auto bits = t->buckets[i].load(std::memory_order_acquire);
+        if (bits == kEmpty) {
+          if (t->buckets[i].compare_exchange_strong(
+                  bits, reinterpret_cast<uintptr_t>(entry),
+                  std::memory_order_acq_rel)) {
+            if (t->used.fetch_add(1, std::memory_order_relaxed) + 1 >
+                (t->mask + 1) / 2) {
+              next_table(t);
+            }
+            return entry;
+          }
+          // Another thread took or froze the bucket; look at it again.
+          continue;
+        }
+        if (bits == kFrozen) {
+          break;
+        }
+        auto* other = to_entry(bits);
+        if (!(bits & kDead) &&
+            (other == entry ||
+             matches(other, entry->key, entry->hash))) {
+          return other;
+        }
+        ++probes;
+        i = (i + 1) & t->mask;
+      }
+      t = next_table(t);
+    }
+  }
+
+  // Marks the live entries with the hash in `t` for which `pred` holds as
+  // dead. Returns whether this killed any.
+  template <typename Pred>
+  static bool kill(Table* t, size_t hash, const Pred& pred) {
+    bool killed = false;
+    size_t i = hash & t->mask;
+    for (size_t probes = 0; probes <= t->mask;
+         ++probes, i = (i + 1) & t->mask) {
+      auto bits = t->buckets[i].load(std::memory_order_acquire);
+      if (bits == kEmpty || bits == kFrozen) {
+        break;
+      }
+      if (!(bits & kDead) && pred(to_entry(bits))) {
+        // Entries only ever change into tombstones, so a failed CAS means
+        // that another thread killed this one.
+        killed |= t->buckets[i].compare_exchange_strong(
+            bits, bits | kDead, std::memory_order_acq_rel);
+      }
+    }
+    return killed;
+  }
+
+  // Returns the table after `t`. If there is none yet, creates it and
+  // migrates the entries of `t` into it.
+  Table* next_table(Table* t) {
+    Table* next = t->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+      return next;
+    }
+    auto* created = new Table(2 * (t->mask + 1));
+    if (!t->next.compare_exchange_strong(next, created,
+                                         std::memory_order_acq_rel)) {
+      delete created;
+      return next;
+    }
+    migrate(t, created);
+    return created;
+  }
+
+  void migrate(Table* from, Table* to) {
+    for (size_t i = 0; i <= from->mask; ++i) {
+      auto bits = from->buckets[i].load(std::memory_order_acquire);
+      if (bits == kEmpty &&
+          from->buckets[i].compare_exchange_strong(
+              bits, kFrozen, std::memory_order_acq_rel)) {
+        continue;
+      }
+      // Otherwise, an entry took the bucket; `bits` holds it.
+      if (bits & kDead) {
+        continue;
+      }
+      auto* entry = to_entry(bits);
+      insert(to, entry);
+      // If the entry died while it was copied, it must die in the copy too.
+      if (from->buckets[i].load(std::memory_order_acquire) & kDead) {
+        for (Table* t = to; t != nullptr;
+             t = t->next.load(std::memory_order_acquire)) {
+          kill(t, entry->hash, [entry](const Entry* e) { return e == entry; });
+        }
+      }
+    }
+    from->migrated.store(true, std::memory_order_release);
+    Table* current = m_current.load(std::memory_order_acquire);
+    while (current->migrated.load(std::memory_order_acquire)) {
+      Table* next = current->next.load(std::memory_order_acquire);
+      if (m_current.compare_exchange_weak(current, next,
+                                          std::memory_order_acq_rel)) {
+        current = next;
+      }
+    }
+  }
+
+  Table* const m_first;
+  std::atomic<Table*> m_current;
+  std::atomic<size_t> m_size{0};
+  ConcurrentArena m_arena;
+};
@@ -7,8 +7,15 @@
 
 #include <boost/iostreams/device/mapped_file.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <numeric>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <zlib.h>
@@ -29,6 +36,7 @@
 #include "Show.h"
 #include "Trace.h"
 #include "Util.h"
+#include "WorkQueue.h"
 
 /******************
  * Begin Class Loading code.
@@ -361,6 +369,43 @@ static DexMethod* make_dexmethod(std::vector<cp_entry>& cpool,
   return method;
 }
 
+// Returns true, after reporting it, if a class for `self` already exists.
+static bool is_duplicate_class(DexType* self, const std::string& jar_location) {
+  DexClass* cls = type_class(self);
+  if (!cls) {
+    return false;
+  }
+  // We are seeing duplicate classes when parsing jar file
+  if (cls->is_external()) {
+    // Two external classes in .jar file has the same name
+    // Just issue an warning for now
+    TRACE(MAIN, 1,
+          "Warning: Found a duplicate class '%s' in two .jar files:\n "
+          "  Current: '%s'\n"
+          "  Previous: '%s'",
+          SHOW(self), jar_location.c_str(), cls->get_location().c_str());
+  } else if (!dup_classes::is_known_dup(cls)) {
+    TRACE(MAIN, 1,
+          "Warning: Found a duplicate class '%s' in .dex and .jar file."
+          "  Current: '%s'\n"
+          "  Previous: '%s'\n",
+          SHOW(self), jar_location.c_str(), cls->get_location().c_str());
+
+    // TODO: There are still blocking issues in instrumentation test that are
+    // blocking. We currently only fail for duplicate `android*` classes,
+    // we can make this throw for all the classes once they are fixed.
+
+    if (boost::starts_with(cls->str(), "Landroid")) {
+      throw RedexException(RedexError::DUPLICATE_CLASSES,
+                           "Found duplicate class in two different files.",
+                           {{"class", SHOW(self)},
+                            {"jar", jar_location},
+                            {"dex", cls->get_location()}});
+    }
+  }
+  return true;
+}
+
 bool parse_class(uint8_t* buffer,
                  Scope* classes,
                  attribute_hook_t attr_hook,
@@ -398,36 +443,7 @@ bool parse_class(uint8_t* buffer,
   }
 
   DexType* self = make_dextype_from_cref(cpool, clazz);
-  DexClass* cls = type_class(self);
-  if (cls) {
-    // We are seeing duplicate classes when parsing jar file
-    if (cls->is_external()) {
-      // Two external classes in .jar file has the same name
-      // Just issue an warning for now
-      TRACE(MAIN, 1,
-            "Warning: Found a duplicate class '%s' in two .jar files:\n "
-            "  Current: '%s'\n"
-            "  Previous: '%s'",
-            SHOW(self), jar_location.c_str(), cls->get_location().c_str());
-    } else if (!dup_classes::is_known_dup(cls)) {
-      TRACE(MAIN, 1,
-            "Warning: Found a duplicate class '%s' in .dex and .jar file."
-            "  Current: '%s'\n"
-            "  Previous: '%s'\n",
-            SHOW(self), jar_location.c_str(), cls->get_location().c_str());
-
-      // TODO: There are still blocking issues in instrumentation test that are
-      // blocking. We currently only fail for duplicate `android*` classes,
-      // we can make this throw for all the classes once they are fixed.
-
-      if (boost::starts_with(cls->str(), "Landroid")) {
-        throw RedexException(RedexError::DUPLICATE_CLASSES,
-                             "Found duplicate class in two different files.",
-                             {{"class", SHOW(self)},
-                              {"jar", jar_location},
-                              {"dex", cls->get_location()}});
-      }
-    }
+  if (is_duplicate_class(self, jar_location)) {
     return true;
   }
 
@@ -809,18 +825,18 @@ static bool decompress_class(jar_entry& file,
   return true;
 }
 
-static const int kStartBufferSize = 128 * 1024;
+// The number of class files that are inflated together, before they are
+// parsed. This bounds the memory that holds inflated class files.
+static const size_t kInflateBatchSize = 1024;
 
 static bool process_jar_entries(const char* location,
                                 std::vector<jar_entry>& files,
                                 const uint8_t* mapping,
                                 Scope* classes,
                                 const attribute_hook_t& attr_hook) {
-  ssize_t bufsize = kStartBufferSize;
-  uint8_t* outbuffer = (uint8_t*)malloc(bufsize);
   static char classEndString[] = ".class";
   static size_t classEndStringLen = strlen(classEndString);
-  init_basic_types();
+  std::vector<jar_entry*> class_files;
   for (auto& file : files) {
     if (file.cd_entry.ucomp_size == 0) continue;
     if (file.cd_entry.fname_len < (classEndStringLen + 1)) continue;
@@ -829,34 +845,315 @@ static bool process_jar_entries(const char* location,
     uint8_t* endcomp =
         file.filename + (file.cd_entry.fname_len - classEndStringLen);
     if (memcmp(endcomp, classEndString, classEndStringLen) != 0) continue;
+    class_files.push_back(&file);
+  }
 
-    // Resize output if necessary.
-    if (bufsize < file.cd_entry.ucomp_size) {
-      while (bufsize < file.cd_entry.ucomp_size)
-        bufsize *= 2;
-      free(outbuffer);
-      outbuffer = (uint8_t*)malloc(bufsize);
+  init_basic_types();
+  // Inflating is independent for each entry, and runs in parallel. Parsing
+  // creates the classes, and stays serial and in jar order, so that the
+  // first of two duplicate classes still wins.
+  std::vector<std::unique_ptr<uint8_t[]>> buffers(kInflateBatchSize);
+  std::vector<size_t> indices(kInflateBatchSize);
+  for (size_t begin = 0; begin < class_files.size();
+       begin += kInflateBatchSize) {
+    size_t count = std::min(kInflateBatchSize, class_files.size() - begin);
+    indices.resize(count);
+    std::iota(indices.begin(), indices.end(), 0);
+    std::atomic<bool> inflated{true};
+    workqueue_run<size_t>(
+        [&](size_t i) {
+          auto& file = *class_files[begin + i];
+          ssize_t bufsize = file.cd_entry.ucomp_size;
+          buffers[i].reset(new uint8_t[bufsize]);
+          if (!decompress_class(file, mapping, buffers[i].get(), bufsize)) {
+            inflated = false;
+          }
+        },
+        indices);
+    if (!inflated) {
+      return false;
     }
 
-    if (!decompress_class(file, mapping, outbuffer, bufsize)) {
-      free(outbuffer);
-      return false;
+    for (size_t i = 0; i < count; ++i) {
+      auto buffer = std::move(buffers[i]);
+      if (!parse_class(buffer.get(), classes, attr_hook, location)) {
+        return false;
+      }
     }
+  }
+  return true;
+}
 
-    if (!parse_class(outbuffer, classes, attr_hook, location)) {
-      free(outbuffer);
-      return false;
+/*
+ * A class snapshot holds the external class shells that load_jar_file
+ * creates, in a form that loads without inflating and parsing class files.
+ * All numbers are uint32s in host byte order:
+ *
+ * kSnapshotMagic, kSnapshotVersion
+ * string_count, then each string as its length and its bytes
+ * class_count, then for each class:
+ *   type, location, access flags, super type or kNoString,
+ *   interface count, then the interface types
+ *   field count, then for each field: name, type, access flags
+ *   method count, then for each method: name, return type, argument count,
+ *     the argument types, access flags, whether it is virtual
+ *
+ * Strings and types are indices into the string table.
+ */
+namespace {
+
+constexpr uint32_t kSnapshotMagic = 0x53435852; // "RXCS" on little-endian
+constexpr uint32_t kSnapshotVersion = 1;
+constexpr uint32_t kNoString = 0xFFFFFFFF;
+
+class SnapshotReader {
+ public:
+  SnapshotReader(const uint8_t* begin, const uint8_t* end)
+      : m_ptr(begin), m_end(end) {}
+
+  uint32_t read() {
+    uint32_t value = 0;
+    if (m_end - m_ptr < (ssize_t)sizeof(value)) {
+      m_ok = false;
+      return 0;
     }
+    memcpy(&value, m_ptr, sizeof(value));
+    m_ptr += sizeof(value);
+    return value;
+  }
+
+  std::string_view read_bytes(uint32_t size) {
+    if (m_end - m_ptr < (ssize_t)size) {
+      m_ok = false;
+      return {};
+    }
+    std::string_view bytes((const char*)m_ptr, size);
+    m_ptr += size;
+    return bytes;
+  }
+
+  bool ok() const { return m_ok; }
+  void fail() { m_ok = false; }
+
+ private:
+  const uint8_t* m_ptr;
+  const uint8_t* m_end;
+  bool m_ok{true};
+};
+
+} // namespace
+
+static bool is_class_snapshot(const uint8_t* mapping, ssize_t size) {
+  uint32_t magic;
+  if (size < (ssize_t)sizeof(magic)) {
+    return false;
+  }
+  memcpy(&magic, mapping, sizeof(magic));
+  return magic == kSnapshotMagic;
+}
+
+static bool process_class_snapshot(const char* location,
+                                   const uint8_t* mapping,
+                                   ssize_t size,
+                                   Scope* classes) {
+  SnapshotReader reader(mapping, mapping + size);
+  reader.read();
+  if (reader.read() != kSnapshotVersion) {
+    fprintf(stderr, "Unsupported class snapshot version in %s\n", location);
+    return false;
+  }
+  std::vector<std::string_view> strings(reader.read());
+  for (auto& str : strings) {
+    str = reader.read_bytes(reader.read());
+  }
+  if (!reader.ok()) {
+    fprintf(stderr, "Truncated class snapshot %s\n", location);
+    return false;
+  }
+  auto read_string = [&]() -> std::string_view {
+    auto id = reader.read();
+    if (id >= strings.size()) {
+      reader.fail();
+      return {};
+    }
+    return strings[id];
+  };
+  auto read_type = [&]() { return DexType::make_type(read_string()); };
+
+  uint32_t class_count = reader.read();
+  for (uint32_t i = 0; i < class_count && reader.ok(); i++) {
+    DexType* self = read_type();
+    std::string jar_location(read_string());
+    auto access = (DexAccessFlags)reader.read();
+    auto super_id = reader.read();
+    if (!reader.ok()) {
+      break;
+    }
+    // The members of duplicate classes are still read, but not created.
+    std::optional<ClassCreator> cc;
+    if (!is_duplicate_class(self, jar_location)) {
+      cc.emplace(self, jar_location);
+      cc->set_external();
+      if (super_id != kNoString) {
+        if (super_id >= strings.size()) {
+          reader.fail();
+          break;
+        }
+        cc->set_super(DexType::make_type(strings[super_id]));
+      }
+      cc->set_access(access);
+    }
+
+    uint32_t ifcount = reader.read();
+    for (uint32_t j = 0; j < ifcount && reader.ok(); j++) {
+      DexType* iftype = read_type();
+      if (cc) {
+        cc->add_interface(iftype);
+      }
+    }
+
+    uint32_t fcount = reader.read();
+    for (uint32_t j = 0; j < fcount && reader.ok(); j++) {
+      auto name = read_string();
+      DexType* type = read_type();
+      auto faccess = (DexAccessFlags)reader.read();
+      if (!cc) {
+        continue;
+      }
+      DexField* field = static_cast<DexField*>(
+          DexField::make_field(self, DexString::make_string(name), type));
+      field->set_access(faccess);
+      field->set_external();
+      cc->add_field(field);
+    }
+
+    uint32_t mcount = reader.read();
+    for (uint32_t j = 0; j < mcount && reader.ok(); j++) {
+      auto name = read_string();
+      DexType* rtype = read_type();
+      DexTypeList::ContainerType args(reader.read());
+      for (auto& arg : args) {
+        if (!reader.ok()) {
+          break;
+        }
+        arg = read_type();
+      }
+      auto maccess = (DexAccessFlags)reader.read();
+      bool is_virtual = reader.read() != 0;
+      if (!cc || !reader.ok()) {
+        continue;
+      }
+      DexProto* proto = DexProto::make_proto(
+          rtype, DexTypeList::make_type_list(std::move(args)));
+      DexMethod* method = static_cast<DexMethod*>(
+          DexMethod::make_method(self, DexString::make_string(name), proto));
+      if (method->is_concrete()) {
+        fprintf(stderr, "Pre-concrete method attempted to load '%s', bailing\n",
+                SHOW(method));
+        return false;
+      }
+      method->set_access(maccess);
+      method->set_virtual(is_virtual);
+      method->set_external();
+      cc->add_method(method);
+    }
+
+    if (cc && reader.ok()) {
+      DexClass* dc = cc->create();
+      if (classes != nullptr) {
+        classes->emplace_back(dc);
+      }
+    }
+  }
+  if (!reader.ok()) {
+    fprintf(stderr, "Malformed class snapshot %s\n", location);
+    return false;
   }
-  free(outbuffer);
   return true;
 }
 
+bool write_class_snapshot(const char* location, const Scope& classes) {
+  std::unordered_map<std::string_view, uint32_t> string_ids;
+  std::vector<std::string_view> strings;
+  std::vector<uint32_t> data;
+  auto add_string = [&](std::string_view str) {
+    auto it = string_ids.emplace(str, strings.size()).first;
+    if (it->second == strings.size()) {
+      strings.push_back(str);
+    }
+    data.push_back(it->second);
+  };
+  auto add_type = [&](const DexType* type) {
+    if (type == nullptr) {
+      data.push_back(kNoString);
+    } else {
+      add_string(type->str());
+    }
+  };
+
+  data.push_back(classes.size());
+  for (const auto* cls : classes) {
+    add_type(cls->get_type());
+    add_string(cls->get_location());
+    data.push_back(cls->get_access());
+    add_type(cls->get_super_class());
+    const auto* interfaces = cls->get_interfaces();
+    data.push_back(interfaces->size());
+    for (const auto* iftype : *interfaces) {
+      add_type(iftype);
+    }
+    data.push_back(cls->get_sfields().size() + cls->get_ifields().size());
+    for (const auto* field : cls->get_all_fields()) {
+      add_string(field->get_name()->str());
+      add_type(field->get_type());
+      data.push_back(field->get_access());
+    }
+    data.push_back(cls->get_dmethods().size() + cls->get_vmethods().size());
+    for (const auto* method : cls->get_all_methods()) {
+      add_string(method->get_name()->str());
+      const auto* proto = method->get_proto();
+      add_type(proto->get_rtype());
+      data.push_back(proto->get_args()->size());
+      for (const auto* arg : *proto->get_args()) {
+        add_type(arg);
+      }
+      data.push_back(method->get_access());
+      data.push_back(method->is_virtual());
+    }
+  }
+
+  std::ofstream out(location, std::ofstream::binary | std::ofstream::trunc);
+  if (!out) {
+    fprintf(stderr, "error: cannot open class snapshot: %s\n", location);
+    return false;
+  }
+  auto write32 = [&](uint32_t value) {
+    out.write((const char*)&value, sizeof(value));
+  };
+  write32(kSnapshotMagic);
+  write32(kSnapshotVersion);
+  write32(strings.size());
+  for (auto str : strings) {
+    write32(str.size());
+    out.write(str.data(), str.size());
+  }
+  out.write((const char*)data.data(), data.size() * sizeof(uint32_t));
+  return out.good();
+}
+
 bool process_jar(const char* location,
                  const uint8_t* mapping,
                  ssize_t size,
                  Scope* classes,
                  const attribute_hook_t& attr_hook) {
+  if (is_class_snapshot(mapping, size)) {
+    if (attr_hook != nullptr) {
+      fprintf(stderr, "Class snapshot %s has no attributes to hook\n",
+              location);
+      return false;
+    }
+    return process_class_snapshot(location, mapping, size, classes);
+  }
   pk_cdir_end pce;
   std::vector<jar_entry> files;
   if (!find_central_directory(mapping, size, pce)) return false;
@@ -887,6 +1184,57 @@ bool load_jar_file(const char* location,
   return true;
 }
 
+bool inflate_zip_entries(const char* location,
+                         const std::function<bool(const std::string&)>& select,
+                         zip_entries_t* entries) {
+  boost::iostreams::mapped_file file;
+  try {
+    file.open(location, boost::iostreams::mapped_file::readonly);
+  } catch (const std::exception& e) {
+    fprintf(stderr, "error: cannot open zip file: %s\n", location);
+    return false;
+  }
+
+  auto mapping = reinterpret_cast<const uint8_t*>(file.const_data());
+  ssize_t size = file.size();
+  pk_cdir_end pce;
+  std::vector<jar_entry> files;
+  if (!find_central_directory(mapping, size, pce) || !validate_pce(pce, size) ||
+      !get_jar_entries(mapping, pce, files)) {
+    fprintf(stderr, "error: cannot process zip: %s\n", location);
+    return false;
+  }
+
+  entries->clear();
+  std::vector<jar_entry*> selected;
+  for (auto& file : files) {
+    std::string name((const char*)file.filename, file.cd_entry.fname_len);
+    if (!select(name)) continue;
+    entries->emplace_back(
+        std::move(name),
+        std::make_shared<std::string>((size_t)file.cd_entry.ucomp_size, '\0'));
+    selected.push_back(&file);
+  }
+
+  std::vector<size_t> indices(selected.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  std::atomic<bool> inflated{true};
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        auto& buffer = *(*entries)[i].second;
+        if (!decompress_class(*selected[i], mapping,
+                              reinterpret_cast<uint8_t*>(buffer.data()),
+                              buffer.size())) {
+          inflated = false;
+        }
+      },
+      indices);
+  if (!inflated) {
+    fprintf(stderr, "error: cannot inflate zip: %s\n", location);
+  }
+  return inflated;
+}
+
 //#define LOCAL_MAIN
 #ifdef LOCAL_MAIN
 int main(int argc, char* argv[]) {
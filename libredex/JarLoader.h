@@ -15,6 +15,10 @@ class DexMethod;
 #include "ConfigFiles.h"
 
 #include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace JarLoaderUtil {
 uint32_t read32(uint8_t*& buffer);
@@ -32,6 +36,25 @@ bool load_jar_file(const char* location,
 
 bool load_class_file(const std::string& filename, Scope* classes = nullptr);
 
+using zip_entries_t =
+    std::vector<std::pair<std::string, std::shared_ptr<std::string>>>;
+
+/*
+ * Inflates the entries of the zip at `location` whose names `select` accepts
+ * into memory, in parallel. The entries keep the order of the zip.
+ */
+bool inflate_zip_entries(const char* location,
+                         const std::function<bool(const std::string&)>& select,
+                         zip_entries_t* entries);
+
+/*
+ * Writes the shells of external `classes`, as load_jar_file creates them, to
+ * a class snapshot at `location`. load_jar_file and process_jar accept a
+ * snapshot in place of a jar, and load it without parsing class files.
+ * Attribute hooks are not supported for snapshots.
+ */
+bool write_class_snapshot(const char* location, const Scope& classes);
+
 void init_basic_types();
 bool process_jar(const char* location,
                  const uint8_t* mapping,
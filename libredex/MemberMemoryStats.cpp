@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MemberMemoryStats.h"
+
+#include "DexAnnotation.h"
+#include "DexInstruction.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "IRList.h"
+
+namespace member_memory {
+
+namespace {
+
+void add(Components* components, const std::string& component, size_t bytes) {
+  auto& c = (*components)[component];
+  c.count++;
+  c.bytes += bytes;
+}
+
+size_t annotation_set_bytes(const DexAnnotationSet& set) {
+  size_t bytes = sizeof(DexAnnotationSet) +
+                 set.get_annotations().capacity() *
+                     sizeof(std::unique_ptr<DexAnnotation>);
+  for (const auto& anno : set.get_annotations()) {
+    bytes += sizeof(DexAnnotation) +
+             anno->anno_elems().capacity() * sizeof(DexAnnotationElement);
+  }
+  return bytes;
+}
+
+void add_annotations(Components* components, const DexAnnotationSet* set) {
+  if (set != nullptr) {
+    add(components, "annotations", annotation_set_bytes(*set));
+  }
+}
+
+template <typename T>
+size_t vector_bytes(const std::vector<T>& vector) {
+  return vector.capacity() * sizeof(T);
+}
+
+} // namespace
+
+Stats compute(const Scope& scope) {
+  Stats stats;
+  for (const auto* cls : scope) {
+    add(&stats.classes, "objects", sizeof(DexClass));
+    add(&stats.classes, "member_vectors",
+        vector_bytes(cls->get_sfields()) + vector_bytes(cls->get_ifields()) +
+            vector_bytes(cls->get_dmethods()) +
+            vector_bytes(cls->get_vmethods()));
+    add_annotations(&stats.classes, cls->get_anno_set());
+
+    for (const auto* fields : {&cls->get_sfields(), &cls->get_ifields()}) {
+      for (const auto* field : *fields) {
+        add(&stats.fields, "objects", sizeof(DexField));
+        add_annotations(&stats.fields, field->get_anno_set());
+        if (field->get_static_value() != nullptr) {
+          add(&stats.fields, "static_values", sizeof(DexEncodedValue));
+        }
+      }
+    }
+
+    for (const auto* methods : {&cls->get_dmethods(), &cls->get_vmethods()}) {
+      for (const auto* method : *methods) {
+        add(&stats.methods, "objects", sizeof(DexMethod));
+        add_annotations(&stats.methods, method->get_anno_set());
+        if (const auto* param_anno = method->get_param_anno()) {
+          // A red-black tree node holds three pointers and a color next to
+          // the value.
+          constexpr size_t node_overhead = 4 * sizeof(void*);
+          size_t bytes = sizeof(ParamAnnotations);
+          for (const auto& [_, set] : *param_anno) {
+            bytes += node_overhead + sizeof(ParamAnnotations::value_type);
+            if (set != nullptr) {
+              bytes += annotation_set_bytes(*set);
+            }
+          }
+          add(&stats.methods, "param_annotations", bytes);
+        }
+        if (const auto* code = method->get_code()) {
+          add(&stats.methods, "ir_code",
+              sizeof(IRCode) + sizeof(IRList) +
+                  code->count_opcodes() *
+                      (sizeof(MethodItemEntry) + sizeof(IRInstruction)));
+        }
+        if (const auto* dex_code = method->get_dex_code()) {
+          const auto& insns = dex_code->get_instructions();
+          add(&stats.methods, "dex_code",
+              sizeof(DexCode) + vector_bytes(insns) +
+                  insns.size() * sizeof(DexInstruction));
+        }
+      }
+    }
+  }
+  return stats;
+}
+
+Json::Value to_json(const Stats& stats) {
+  auto components_to_json = [](const Components& components) {
+    Json::Value value(Json::objectValue);
+    size_t total = 0;
+    for (const auto& [name, component] : components) {
+      value[name]["count"] = (Json::UInt64)component.count;
+      value[name]["bytes"] = (Json::UInt64)component.bytes;
+      total += component.bytes;
+    }
+    value["total"]["bytes"] = (Json::UInt64)total;
+    return value;
+  };
+  Json::Value value(Json::objectValue);
+  value["classes"] = components_to_json(stats.classes);
+  value["fields"] = components_to_json(stats.fields);
+  value["methods"] = components_to_json(stats.methods);
+  return value;
+}
+
+} // namespace member_memory
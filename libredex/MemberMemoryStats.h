@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <json/value.h>
+#include <map>
+#include <string>
+
+#include "DexClass.h"
+
+/*
+ * An estimate of the memory that the classes, fields and methods of a scope
+ * take, split by component, to find the parts of their layout that are worth
+ * compacting.
+ *
+ * The bytes of a component count its objects and the buffers they own, but
+ * not allocator overhead. Objects that members share, like strings, types
+ * and protos, are not counted.
+ */
+namespace member_memory {
+
+struct Component {
+  // The number of members that have this component.
+  size_t count{0};
+  size_t bytes{0};
+};
+
+using Components = std::map<std::string, Component>;
+
+struct Stats {
+  Components classes;
+  Components fields;
+  Components methods;
+};
+
+Stats compute(const Scope& scope);
+
+// {"classes": {"<component>": {"count": n, "bytes": n}, ...}, ...} with a
+// "total" component in each kind of member.
+Json::Value to_json(const Stats& stats);
+
+} // namespace member_memory
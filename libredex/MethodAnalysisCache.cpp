@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MethodAnalysisCache.h"
+
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "IRInstruction.h"
+
+namespace {
+
+uint64_t word(const void* ptr) { return reinterpret_cast<uintptr_t>(ptr); }
+
+uint64_t operand(const IRInstruction* insn) {
+  if (insn->has_literal()) {
+    return static_cast<uint64_t>(insn->get_literal());
+  } else if (insn->has_string()) {
+    return word(insn->get_string());
+  } else if (insn->has_type()) {
+    return word(insn->get_type());
+  } else if (insn->has_field()) {
+    return word(insn->get_field());
+  } else if (insn->has_method()) {
+    return word(insn->get_method());
+  } else if (insn->has_callsite()) {
+    return word(insn->get_callsite());
+  } else if (insn->has_methodhandle()) {
+    return word(insn->get_methodhandle());
+  } else if (insn->has_data()) {
+    return word(insn->get_data());
+  }
+  return 0;
+}
+
+} // namespace
+
+CodeFingerprint::CodeFingerprint(const DexMethodRef* method,
+                                 const cfg::ControlFlowGraph& cfg) {
+  m_words.push_back(word(method->get_class()));
+  m_words.push_back(word(method->get_proto()));
+  if (method->is_def()) {
+    m_words.push_back(method->as_def()->get_access());
+  }
+  m_words.push_back(cfg.entry_block()->id());
+  for (const cfg::Block* block : cfg.blocks()) {
+    m_words.push_back(block->id());
+    for (const auto& mie : *block) {
+      if (mie.type != MFLOW_OPCODE) {
+        continue;
+      }
+      const IRInstruction* insn = mie.insn;
+      m_words.push_back(word(insn));
+      m_words.push_back(insn->opcode());
+      m_words.push_back(insn->has_dest() ? insn->dest() : -1);
+      for (size_t i = 0; i < insn->srcs_size(); ++i) {
+        m_words.push_back(insn->src(i));
+      }
+      m_words.push_back(operand(insn));
+    }
+    // Separates the instructions from the edges, as the number of sources
+    // of an instruction varies.
+    m_words.push_back(-1);
+    for (const cfg::Edge* edge : block->succs()) {
+      m_words.push_back(edge->type());
+      m_words.push_back(edge->target()->id());
+      if (edge->type() == cfg::EDGE_THROW) {
+        m_words.push_back(word(edge->throw_info()->catch_type));
+        m_words.push_back(edge->throw_info()->index);
+      } else if (edge->case_key()) {
+        m_words.push_back(static_cast<uint32_t>(*edge->case_key()));
+      } else {
+        m_words.push_back(-1);
+      }
+    }
+    m_words.push_back(-1);
+  }
+}
+
+void MethodAnalysisCache::invalidate(const DexMethodRef* method) {
+  m_entries.erase(method);
+}
+
+void MethodAnalysisCache::clear() { m_entries.clear(); }
+
+std::shared_ptr<MethodAnalysisCache::Entry> MethodAnalysisCache::get_entry(
+    const DexMethodRef* method) {
+  std::shared_ptr<Entry> entry;
+  m_entries.update(method,
+                   [&](const DexMethodRef*, std::shared_ptr<Entry>& value,
+                       bool exists) {
+                     if (!exists) {
+                       value = std::make_shared<Entry>();
+                     }
+                     entry = value;
+                   });
+  return entry;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ConcurrentContainers.h"
+
+class DexMethodRef;
+
+namespace cfg {
+class ControlFlowGraph;
+} // namespace cfg
+
+/*
+ * A summary of everything an intraprocedural analysis of a method can observe:
+ * the signature of the method, and the blocks, edges and instructions of its
+ * CFG, including the identity of each instruction.
+ *
+ * Two fingerprints are equal exactly when the code they were taken from has
+ * not been edited in between, up to rebuilding its CFG. Blocks are identified
+ * by their ids rather than their addresses, so that the non-editable CFGs that
+ * are built and cleared around each use of a method compare equal, while the
+ * instructions are identified by their addresses, so that results keyed by
+ * instruction remain meaningful.
+ */
+class CodeFingerprint final {
+ public:
+  CodeFingerprint() = default;
+
+  CodeFingerprint(const DexMethodRef* method,
+                  const cfg::ControlFlowGraph& cfg);
+
+  bool operator==(const CodeFingerprint& that) const {
+    return m_words == that.m_words;
+  }
+
+  bool operator!=(const CodeFingerprint& that) const {
+    return !(*this == that);
+  }
+
+ private:
+  std::vector<uint64_t> m_words;
+};
+
+/*
+ * Memoizes the results of intraprocedural analyses of methods, so that an
+ * analysis that is requested again for a method whose code did not change
+ * since is not run again.
+ *
+ * Results are stored per method and per analysis key, along with the
+ * fingerprint of the code they were computed on. A lookup with a different
+ * fingerprint drops all the results of the method. Results must not refer to
+ * the blocks or edges of the CFG, which do not survive it being rebuilt.
+ *
+ * The fingerprint captures the code of a method but not the rest of the
+ * program, e.g. the class hierarchy or the definitions of the fields and
+ * methods that the code refers to. The PassManager thus clears the cache after
+ * every pass that does not declare, through its AnalysisUsage, that it only
+ * edits method bodies.
+ *
+ * All operations are thread-safe. The analyses of distinct methods run
+ * concurrently, the analyses of one method run one at a time.
+ */
+class MethodAnalysisCache final {
+ public:
+  /*
+   * Returns the result of the analysis `key` for the current code of
+   * `method`, whose CFG is `cfg`, computing it with `compute()` if there is no
+   * valid one. The result type of `compute` must be the same for all uses of
+   * a key.
+   */
+  template <typename Compute>
+  auto get(const DexMethodRef* method,
+           const cfg::ControlFlowGraph& cfg,
+           const std::string& key,
+           const Compute& compute)
+      -> std::shared_ptr<const decltype(compute())> {
+    using Result = decltype(compute());
+    CodeFingerprint fingerprint(method, cfg);
+    auto entry = get_entry(method);
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if (entry->fingerprint != fingerprint) {
+      entry->fingerprint = std::move(fingerprint);
+      entry->results.clear();
+    }
+    auto it = entry->results.find(key);
+    if (it != entry->results.end()) {
+      m_hits.fetch_add(1, std::memory_order_relaxed);
+      return std::static_pointer_cast<const Result>(it->second);
+    }
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    auto result = std::make_shared<const Result>(compute());
+    entry->results.emplace(key, result);
+    return result;
+  }
+
+  // Drops all the results about the method.
+  void invalidate(const DexMethodRef* method);
+
+  // Drops all the results.
+  void clear();
+
+  // The number of methods with results.
+  size_t size() const { return m_entries.size(); }
+
+  size_t hits() const { return m_hits.load(std::memory_order_relaxed); }
+
+  size_t misses() const { return m_misses.load(std::memory_order_relaxed); }
+
+ private:
+  struct Entry {
+    std::mutex mutex;
+    CodeFingerprint fingerprint;
+    std::unordered_map<std::string, std::shared_ptr<const void>> results;
+  };
+
+  std::shared_ptr<Entry> get_entry(const DexMethodRef* method);
+
+  ConcurrentMap<const DexMethodRef*, std::shared_ptr<Entry>> m_entries;
+  std::atomic<size_t> m_hits{0};
+  std::atomic<size_t> m_misses{0};
+};
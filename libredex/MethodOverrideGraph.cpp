@@ -8,10 +8,12 @@
 #include "MethodOverrideGraph.h"
 
 #include <boost/range/adaptor/map.hpp>
+#include <mutex>
 
 #include "BinarySerialization.h"
 #include "PatriciaTreeMap.h"
 #include "PatriciaTreeSet.h"
+#include "RedexContext.h"
 #include "Show.h"
 #include "Timer.h"
 #include "Walkers.h"
@@ -77,7 +79,6 @@ class GraphBuilder {
   explicit GraphBuilder(const Scope& scope) : m_scope(scope) {}
 
   std::unique_ptr<Graph> run() {
-    m_graph = std::make_unique<Graph>();
     walk::parallel::classes(m_scope, [&](const DexClass* cls) {
       if (is_interface(cls)) {
         analyze_interface(cls);
@@ -85,7 +86,13 @@ class GraphBuilder {
         analyze_non_interface(cls);
       }
     });
-    return std::move(m_graph);
+    Graph::Edges edges;
+    for (const auto& [overridden, overriding_set] : m_children) {
+      for (const auto* overriding : overriding_set) {
+        edges.emplace_back(overridden, overriding);
+      }
+    }
+    return std::make_unique<Graph>(edges);
   }
 
  private:
@@ -115,7 +122,7 @@ class GraphBuilder {
           class_signatures.implemented.at(method->get_name())
               .at(method->get_proto());
       for (auto overridden : overridden_set) {
-        m_graph->add_edge(overridden, method);
+        add_edge(overridden, method);
       }
       // Replace the overridden methods by the overriding ones.
       update_signature_map(
@@ -142,7 +149,7 @@ class GraphBuilder {
         always_assert(implemented_set.size() == 1);
         auto implementation = *implemented_set.begin();
         for (auto unimplemented : ms_pair.second) {
-          m_graph->add_edge(unimplemented, implementation);
+          add_edge(unimplemented, implementation);
         }
         new_implementations.push_back(implementation);
       }
@@ -188,7 +195,7 @@ class GraphBuilder {
       // to find them. This design reduces the number of edges necessary for
       // building the graph.
       for (auto overridden : overridden_set) {
-        m_graph->add_edge(overridden, method);
+        add_edge(overridden, method);
       }
       update_signature_map(method, MethodSet{method}, &interface_signatures);
     }
@@ -211,12 +218,77 @@ class GraphBuilder {
     return super_interface_signatures;
   }
 
-  std::unique_ptr<Graph> m_graph;
+  void add_edge(const DexMethod* overridden, const DexMethod* overriding) {
+    m_children.update(overridden,
+                      [&](const DexMethod*,
+                          std::unordered_set<const DexMethod*>& children,
+                          bool /* exists */) { children.insert(overriding); });
+  }
+
+  ConcurrentMap<const DexMethod*, std::unordered_set<const DexMethod*>>
+      m_children;
   ClassSignatureMaps m_class_signature_maps;
   InterfaceSignatureMaps m_interface_signature_maps;
   const Scope& m_scope;
 };
 
+uint64_t word(const void* ptr) { return reinterpret_cast<uintptr_t>(ptr); }
+
+/*
+ * Everything that the graph of a scope is built from: the classes of the
+ * scope and their superclasses and superinterfaces, with their access flags,
+ * their direct supertypes and the signatures of their virtual methods.
+ */
+std::vector<uint64_t> fingerprint_hierarchy(const Scope& scope) {
+  std::vector<uint64_t> words;
+  std::unordered_set<const DexClass*> visited;
+  std::vector<const DexClass*> stack(scope.rbegin(), scope.rend());
+  while (!stack.empty()) {
+    const DexClass* cls = stack.back();
+    stack.pop_back();
+    if (!visited.insert(cls).second) {
+      continue;
+    }
+    words.push_back(word(cls));
+    words.push_back(cls->get_access());
+    auto* super_cls = type_class(cls->get_super_class());
+    words.push_back(word(cls->get_super_class()));
+    words.push_back(word(super_cls));
+    words.push_back(word(cls->get_interfaces()));
+    for (auto* intf : *cls->get_interfaces()) {
+      auto* intf_cls = type_class(intf);
+      words.push_back(word(intf_cls));
+      if (intf_cls != nullptr) {
+        stack.push_back(intf_cls);
+      }
+    }
+    if (super_cls != nullptr) {
+      stack.push_back(super_cls);
+    }
+    for (auto* method : cls->get_vmethods()) {
+      words.push_back(word(method));
+      words.push_back(word(method->get_name()));
+      words.push_back(word(method->get_proto()));
+      words.push_back(method->get_access());
+    }
+    words.push_back(-1);
+  }
+  return words;
+}
+
+// The last graph built, which stays valid until the hierarchy changes.
+struct Snapshot {
+  std::mutex mutex;
+  std::vector<uint64_t> fingerprint;
+  std::unique_ptr<const Graph> graph;
+  bool registered{false};
+
+  static Snapshot& get() {
+    static Snapshot snapshot;
+    return snapshot;
+  }
+};
+
 bool may_be_interface_method(const DexMethod* method) {
   if (method == nullptr) {
     return false;
@@ -229,25 +301,58 @@ bool may_be_interface_method(const DexMethod* method) {
 
 namespace method_override_graph {
 
-Node Graph::empty_node;
-
-const Node& Graph::get_node(const DexMethod* method) const {
-  auto it = m_nodes.find(method);
-  if (it == m_nodes.end()) {
-    return empty_node;
+Graph::Graph() : m_storage(std::make_shared<Storage>()) {}
+
+Graph::Graph(const Edges& edges) {
+  auto storage = std::make_shared<Storage>();
+  auto& nodes = storage->nodes;
+  auto& indices = storage->indices;
+  // Nodes are numbered in order of first appearance. The edges of node i are
+  // at [offsets[i], offsets[i + 1]) of their array.
+  std::vector<uint32_t> parent_offsets{0};
+  std::vector<uint32_t> child_offsets{0};
+  auto index_of = [&](const DexMethod* method) {
+    auto [it, inserted] = indices.emplace(method, nodes.size());
+    if (inserted) {
+      nodes.emplace_back(method, Node());
+      parent_offsets.push_back(0);
+      child_offsets.push_back(0);
+    }
+    return it->second;
+  };
+  for (const auto& [overridden, overriding] : edges) {
+    ++child_offsets[index_of(overridden) + 1];
+    ++parent_offsets[index_of(overriding) + 1];
+  }
+  for (size_t i = 1; i < parent_offsets.size(); ++i) {
+    parent_offsets[i] += parent_offsets[i - 1];
+    child_offsets[i] += child_offsets[i - 1];
+  }
+  storage->parents.resize(edges.size());
+  storage->children.resize(edges.size());
+  auto parent_cursors = parent_offsets;
+  auto child_cursors = child_offsets;
+  for (const auto& [overridden, overriding] : edges) {
+    storage->children[child_cursors[indices.at(overridden)]++] = overriding;
+    storage->parents[parent_cursors[indices.at(overriding)]++] = overridden;
+  }
+  const auto* parents = storage->parents.data();
+  const auto* children = storage->children.data();
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    nodes[i].second.parents = MethodSpan(parents + parent_offsets[i],
+                                         parents + parent_offsets[i + 1]);
+    nodes[i].second.children = MethodSpan(children + child_offsets[i],
+                                          children + child_offsets[i + 1]);
   }
-  return it->second;
+  m_storage = std::move(storage);
 }
 
-void Graph::add_edge(const DexMethod* overridden, const DexMethod* overriding) {
-  m_nodes.update(overridden,
-                 [&](const DexMethod*, Node& node, bool /* exists */) {
-                   node.children.insert(overriding);
-                 });
-  m_nodes.update(overriding,
-                 [&](const DexMethod*, Node& node, bool /* exists */) {
-                   node.parents.insert(overridden);
-                 });
+Node Graph::get_node(const DexMethod* method) const {
+  auto it = m_storage->indices.find(method);
+  if (it == m_storage->indices.end()) {
+    return Node();
+  }
+  return m_storage->nodes[it->second].second;
 }
 
 void Graph::dump(std::ostream& os) const {
@@ -260,17 +365,37 @@ void Graph::dump(std::ostream& os) const {
         os << s;
       },
       [&](const DexMethod* method) -> std::vector<const DexMethod*> {
-        const auto& node = get_node(method);
+        auto node = get_node(method);
         std::vector<const DexMethod*> succs(node.children.begin(),
                                             node.children.end());
         return succs;
       });
-  gw.write(os, boost::adaptors::keys(m_nodes));
+  gw.write(os, boost::adaptors::keys(m_storage->nodes));
 }
 
 std::unique_ptr<const Graph> build_graph(const Scope& scope) {
+  auto fingerprint = fingerprint_hierarchy(scope);
+  auto& snapshot = Snapshot::get();
+  std::lock_guard<std::mutex> lock(snapshot.mutex);
+  if (snapshot.graph != nullptr && snapshot.fingerprint == fingerprint) {
+    return std::make_unique<Graph>(*snapshot.graph);
+  }
   Timer t("Building method override graph");
-  return GraphBuilder(scope).run();
+  auto graph = GraphBuilder(scope).run();
+  snapshot.fingerprint = std::move(fingerprint);
+  snapshot.graph = std::make_unique<Graph>(*graph);
+  if (!snapshot.registered) {
+    // The methods of the graph die with the context.
+    snapshot.registered = true;
+    g_redex->add_destruction_task([]() {
+      auto& snapshot = Snapshot::get();
+      std::lock_guard<std::mutex> lock(snapshot.mutex);
+      snapshot.fingerprint.clear();
+      snapshot.graph = nullptr;
+      snapshot.registered = false;
+    });
+  }
+  return graph;
 }
 
 std::vector<const DexMethod*> get_overriding_methods(const Graph& graph,
@@ -7,6 +7,11 @@
 
 #pragma once
 
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "ConcurrentContainers.h"
 #include "DexClass.h"
 #include "DexStore.h"
@@ -59,28 +64,77 @@ bool is_true_virtual(const Graph& graph, const DexMethod* method);
 std::unordered_set<DexMethod*> get_non_true_virtuals(const Graph& graph,
                                                      const Scope& scope);
 
+/*
+ * A contiguous slice of the methods of a Graph.
+ */
+class MethodSpan {
+ public:
+  using value_type = const DexMethod*;
+  using const_iterator = const DexMethod* const*;
+
+  MethodSpan() = default;
+  MethodSpan(const_iterator begin, const_iterator end)
+      : m_begin(begin), m_end(end) {}
+
+  const_iterator begin() const { return m_begin; }
+  const_iterator end() const { return m_end; }
+  size_t size() const { return m_end - m_begin; }
+  bool empty() const { return m_begin == m_end; }
+
+ private:
+  const_iterator m_begin{nullptr};
+  const_iterator m_end{nullptr};
+};
+
 /*
  * The `children` edges point to the overriders / implementors of the current
  * Node's method.
  */
 struct Node {
-  std::unordered_set<const DexMethod*> parents;
-  std::unordered_set<const DexMethod*> children;
+  MethodSpan parents;
+  MethodSpan children;
 };
 
+/*
+ * The graph is immutable, and stored in compressed sparse row form: the
+ * parents and the children of all nodes are laid out in two arrays, so that
+ * the edges of a node are contiguous.
+ *
+ * Copies share their storage. build_graph() hands out copies of the last
+ * graph it built for as long as the class hierarchy and the virtual methods
+ * it was built from do not change.
+ */
 class Graph {
  public:
-  const Node& get_node(const DexMethod* method) const;
+  using Edges = std::vector<std::pair<const DexMethod*, const DexMethod*>>;
+
+  Graph();
 
-  const ConcurrentMap<const DexMethod*, Node>& nodes() const { return m_nodes; }
+  // From distinct (overridden, overriding) pairs.
+  explicit Graph(const Edges& edges);
 
-  void add_edge(const DexMethod* overridden, const DexMethod* overriding);
+  Node get_node(const DexMethod* method) const;
+
+  const std::vector<std::pair<const DexMethod*, Node>>& nodes() const {
+    return m_storage->nodes;
+  }
 
   void dump(std::ostream&) const;
 
+  // Whether both graphs are copies of the same one.
+  bool shares_storage_with(const Graph& other) const {
+    return m_storage == other.m_storage;
+  }
+
  private:
-  static Node empty_node;
-  ConcurrentMap<const DexMethod*, Node> m_nodes;
+  struct Storage {
+    std::vector<std::pair<const DexMethod*, Node>> nodes;
+    std::unordered_map<const DexMethod*, uint32_t> indices;
+    std::vector<const DexMethod*> parents;
+    std::vector<const DexMethod*> children;
+  };
+
+  std::shared_ptr<const Storage> m_storage;
 };
 
 } // namespace method_override_graph
@@ -8,6 +8,7 @@
 #include "MethodProfiles.h"
 
 #include <boost/algorithm/string.hpp>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <stdio.h>
@@ -15,6 +16,7 @@
 
 #include "CppUtil.h"
 #include "GlobalConfig.h"
+#include "ReadMaybeMapped.h"
 #include "Show.h"
 
 using namespace method_profiles;
@@ -43,6 +45,72 @@ bool parse_cells(std::string_view line, const Func& parse_cell) {
 
 bool empty_column(std::string_view sv) { return sv.empty() || sv == "\n"; }
 
+/*
+ * The binary profile format. All values are in host byte order. A file is a
+ * Header, followed by the Interactions, the Rows of all the interactions and
+ * the characters of all the names. Names are referenced by their offset into
+ * the characters.
+ */
+namespace binary {
+
+constexpr char MAGIC[8] = {'R', 'D', 'X', 'M', 'P', 'R', 'O', 'F'};
+constexpr uint32_t VERSION = 1;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_interactions;
+  uint64_t num_rows;
+  uint64_t names_size;
+};
+
+struct Interaction {
+  uint32_t id_offset;
+  uint32_t id_size;
+  // Whether the csv file had a metadata section with the interaction count.
+  uint32_t has_count;
+  uint32_t count;
+  uint64_t first_row;
+  uint64_t num_rows;
+};
+
+struct Row {
+  uint32_t name_offset;
+  uint32_t name_size;
+  double appear_percent;
+  double call_count;
+  double order_percent;
+  int16_t min_api_level;
+  uint8_t padding[6];
+};
+
+static_assert(sizeof(Header) == 32);
+static_assert(sizeof(Interaction) == 32);
+static_assert(sizeof(Row) == 40);
+
+// The contents need not be aligned, so the records are copied out.
+template <typename T>
+T read(std::string_view contents, size_t offset) {
+  T value;
+  memcpy(&value, contents.data() + offset, sizeof(T));
+  return value;
+}
+
+} // namespace binary
+
+// A line of the main section of a csv file with the given stats, so that an
+// unresolved row can be handled like those from csv files.
+std::string to_csv_line(std::string_view name, const Stats& stats) {
+  char numbers[128];
+  snprintf(numbers, sizeof(numbers), ",%.17g,0,%.17g,0,%.17g,%d",
+           stats.appear_percent, stats.call_count, stats.order_percent,
+           stats.min_api_level);
+  std::string line("0,");
+  line.append(name);
+  line.append(numbers);
+  return line;
+}
+
 } // namespace
 
 const StatsMap& MethodProfiles::method_stats(
@@ -80,6 +148,15 @@ bool MethodProfiles::parse_stats_file(const std::string& csv_filename) {
     return false;
   }
 
+  char magic[sizeof(binary::MAGIC)];
+  if (ifs.read(magic, sizeof(magic)) &&
+      memcmp(magic, binary::MAGIC, sizeof(magic)) == 0) {
+    ifs.close();
+    return parse_binary_file(csv_filename);
+  }
+  ifs.clear();
+  ifs.seekg(0);
+
   // getline will allocate a buffer and put a pointer to it here
   std::string line;
   while (std::getline(ifs, line)) {
@@ -177,7 +254,7 @@ bool MethodProfiles::parse_main(std::string_view line) {
   always_assert(m_mode == MAIN);
   Stats stats;
   std::string interaction_id;
-  DexMethodRef* ref = nullptr;
+  std::string_view name;
   auto parse_cell = [&](std::string_view cell, uint32_t col) -> bool {
     switch (col) {
     case INDEX:
@@ -185,10 +262,7 @@ bool MethodProfiles::parse_main(std::string_view line) {
       // the file)
       return true;
     case NAME:
-      ref = DexMethod::get_method</*kCheckFormat=*/true>(std::string(cell));
-      if (ref == nullptr) {
-        TRACE(METH_PROF, 6, "failed to resolve %s", SHOW(cell));
-      }
+      name = cell;
       return true;
     case APPEAR100:
       stats.appear_percent = parse_double(cell);
@@ -234,6 +308,14 @@ bool MethodProfiles::parse_main(std::string_view line) {
     // is the conservative approach.
     interaction_id = m_interaction_id;
   }
+  if (m_named_rows != nullptr) {
+    m_named_rows->push_back({interaction_id, std::string(name), stats});
+    return true;
+  }
+  auto* ref = DexMethod::get_method</*kCheckFormat=*/true>(name);
+  if (ref == nullptr) {
+    TRACE(METH_PROF, 6, "failed to resolve %s", SHOW(name));
+  }
   if (ref != nullptr) {
     TRACE(METH_PROF, 6, "(%s, %s) -> {%f, %f, %f, %d}", SHOW(ref),
           interaction_id.c_str(), stats.appear_percent, stats.call_count,
@@ -247,6 +329,189 @@ bool MethodProfiles::parse_main(std::string_view line) {
   return true;
 }
 
+bool MethodProfiles::parse_binary_file(const std::string& binary_filename) {
+  bool success = false;
+  redex::read_file_with_contents(binary_filename,
+                                 [&](const char* data, size_t size) {
+                                   success = parse_binary({data, size});
+                                 });
+  if (success) {
+    TRACE(METH_PROF, 1,
+          "MethodProfiles successfully parsed %zu rows; %zu unresolved lines",
+          size(), unresolved_size());
+  }
+  return success;
+}
+
+bool MethodProfiles::parse_binary(std::string_view contents) {
+  if (contents.size() < sizeof(binary::Header)) {
+    std::cerr << "FAILED to parse binary profile. Truncated header\n";
+    return false;
+  }
+  auto header = binary::read<binary::Header>(contents, 0);
+  if (header.version != binary::VERSION) {
+    std::cerr << "FAILED to parse binary profile. Unsupported version "
+              << header.version << "\n";
+    return false;
+  }
+  if (header.num_rows > contents.size() / sizeof(binary::Row)) {
+    std::cerr << "FAILED to parse binary profile. Too many rows\n";
+    return false;
+  }
+  const size_t interactions_offset = sizeof(binary::Header);
+  const size_t rows_offset =
+      interactions_offset +
+      header.num_interactions * sizeof(binary::Interaction);
+  const size_t names_offset =
+      rows_offset + header.num_rows * sizeof(binary::Row);
+  if (contents.size() != names_offset + header.names_size) {
+    std::cerr << "FAILED to parse binary profile. Unexpected size "
+              << contents.size() << "\n";
+    return false;
+  }
+  auto names = contents.substr(names_offset);
+  auto get_name = [&](uint32_t offset, uint32_t size,
+                      std::string_view* name) -> bool {
+    if (offset > names.size() || size > names.size() - offset) {
+      std::cerr << "FAILED to parse binary profile. Bad name reference\n";
+      return false;
+    }
+    *name = names.substr(offset, size);
+    return true;
+  };
+
+  for (uint32_t i = 0; i < header.num_interactions; ++i) {
+    auto interaction = binary::read<binary::Interaction>(
+        contents, interactions_offset + i * sizeof(binary::Interaction));
+    std::string_view id;
+    if (!get_name(interaction.id_offset, interaction.id_size, &id)) {
+      return false;
+    }
+    if (interaction.first_row > header.num_rows ||
+        interaction.num_rows > header.num_rows - interaction.first_row) {
+      std::cerr << "FAILED to parse binary profile. Bad row range\n";
+      return false;
+    }
+    std::string interaction_id(id);
+    if (interaction.has_count) {
+      m_interaction_counts.emplace(interaction_id, interaction.count);
+    }
+    StatsMap* stats_map = nullptr;
+    for (uint64_t r = interaction.first_row;
+         r < interaction.first_row + interaction.num_rows;
+         ++r) {
+      auto row = binary::read<binary::Row>(
+          contents, rows_offset + r * sizeof(binary::Row));
+      std::string_view name;
+      if (!get_name(row.name_offset, row.name_size, &name)) {
+        return false;
+      }
+      Stats stats;
+      stats.appear_percent = row.appear_percent;
+      stats.call_count = row.call_count;
+      stats.order_percent = row.order_percent;
+      stats.min_api_level = row.min_api_level;
+      if (m_named_rows != nullptr) {
+        m_named_rows->push_back({interaction_id, std::string(name), stats});
+        continue;
+      }
+      auto* ref = DexMethod::get_method</*kCheckFormat=*/true>(name);
+      if (ref != nullptr) {
+        if (stats_map == nullptr) {
+          stats_map = &m_method_stats[interaction_id];
+          stats_map->reserve(stats_map->size() + interaction.num_rows);
+        }
+        stats_map->emplace(ref, stats);
+      } else {
+        TRACE(METH_PROF, 6, "unresolved: %s", SHOW(name));
+        m_unresolved_lines[interaction_id].push_back(to_csv_line(name, stats));
+      }
+    }
+  }
+  return true;
+}
+
+bool MethodProfiles::convert_to_binary(const std::string& csv_filename,
+                                       const std::string& binary_filename) {
+  MethodProfiles profiles;
+  std::vector<NamedRow> rows;
+  profiles.m_named_rows = &rows;
+  if (!profiles.parse_stats_file(csv_filename)) {
+    return false;
+  }
+
+  // Group the rows by interaction, keeping their order otherwise.
+  std::map<std::string, std::vector<const NamedRow*>> rows_by_interaction;
+  for (const auto& [id, count] : profiles.m_interaction_counts) {
+    rows_by_interaction[id];
+  }
+  for (const auto& row : rows) {
+    rows_by_interaction[row.interaction_id].push_back(&row);
+  }
+
+  std::string names;
+  auto add_name = [&](std::string_view name, uint32_t* offset,
+                      uint32_t* size) {
+    always_assert_log(names.size() + name.size() <=
+                          std::numeric_limits<uint32_t>::max(),
+                      "Too many names for a binary profile");
+    *offset = names.size();
+    *size = name.size();
+    names.append(name);
+  };
+
+  std::vector<binary::Interaction> interactions;
+  std::vector<binary::Row> binary_rows;
+  binary_rows.reserve(rows.size());
+  for (const auto& [id, interaction_rows] : rows_by_interaction) {
+    binary::Interaction interaction{};
+    add_name(id, &interaction.id_offset, &interaction.id_size);
+    auto count_it = profiles.m_interaction_counts.find(id);
+    if (count_it != profiles.m_interaction_counts.end()) {
+      interaction.has_count = 1;
+      interaction.count = count_it->second;
+    }
+    interaction.first_row = binary_rows.size();
+    interaction.num_rows = interaction_rows.size();
+    interactions.push_back(interaction);
+    for (const auto* row : interaction_rows) {
+      binary::Row binary_row{};
+      add_name(row->name, &binary_row.name_offset, &binary_row.name_size);
+      binary_row.appear_percent = row->stats.appear_percent;
+      binary_row.call_count = row->stats.call_count;
+      binary_row.order_percent = row->stats.order_percent;
+      binary_row.min_api_level = row->stats.min_api_level;
+      binary_rows.push_back(binary_row);
+    }
+  }
+
+  binary::Header header{};
+  memcpy(header.magic, binary::MAGIC, sizeof(header.magic));
+  header.version = binary::VERSION;
+  header.num_interactions = interactions.size();
+  header.num_rows = binary_rows.size();
+  header.names_size = names.size();
+
+  std::ofstream ofs(binary_filename, std::ios::binary);
+  if (!ofs.good()) {
+    std::cerr << "FAILED to open " << binary_filename << std::endl;
+    return false;
+  }
+  ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  ofs.write(reinterpret_cast<const char*>(interactions.data()),
+            interactions.size() * sizeof(binary::Interaction));
+  ofs.write(reinterpret_cast<const char*>(binary_rows.data()),
+            binary_rows.size() * sizeof(binary::Row));
+  ofs.write(names.data(), names.size());
+  if (!ofs.good()) {
+    std::cerr << "FAILED to write " << binary_filename << std::endl;
+    return false;
+  }
+  TRACE(METH_PROF, 1, "Wrote %zu rows of %zu interactions to %s",
+        binary_rows.size(), interactions.size(), binary_filename.c_str());
+  return true;
+}
+
 bool MethodProfiles::parse_line(std::string_view line) {
   if (m_mode == MAIN) {
     return parse_main(line);
@@ -270,6 +535,9 @@ boost::optional<uint32_t> MethodProfiles::get_interaction_count(
 void MethodProfiles::process_unresolved_lines() {
   auto unresolved_lines = std::move(m_unresolved_lines);
   m_unresolved_lines.clear();
+  // The lines are from the main section, even if the last file parsed was a
+  // binary profile.
+  m_mode = MAIN;
   for (auto& pair : unresolved_lines) {
     m_interaction_id = pair.first;
     for (auto& line : pair.second) {
@@ -79,6 +79,12 @@ class MethodProfiles {
     }
   }
 
+  // Converts a csv profile into the binary format, which `initialize` also
+  // accepts and loads without allocating per row. Methods are kept by name,
+  // so no classes need to be loaded.
+  static bool convert_to_binary(const std::string& csv_filename,
+                                const std::string& binary_filename);
+
   // For testing purposes.
   static MethodProfiles initialize(
       const std::string& interaction_id,
@@ -148,10 +154,24 @@ class MethodProfiles {
   std::string m_interaction_id;
   bool m_initialized{false};
 
-  // Read a "simple" csv file (no quoted commas or extra spaces) and populate
-  // m_method_stats
+  // A row of a csv file whose method has not been resolved.
+  struct NamedRow {
+    std::string interaction_id;
+    std::string name;
+    Stats stats;
+  };
+  // When set, the rows of the main section are collected here instead of
+  // being resolved.
+  std::vector<NamedRow>* m_named_rows{nullptr};
+
+  // Read a "simple" csv file (no quoted commas or extra spaces), or a binary
+  // profile, and populate m_method_stats
   bool parse_stats_file(const std::string& csv_filename);
 
+  // Read a file written by `convert_to_binary`.
+  bool parse_binary_file(const std::string& binary_filename);
+  bool parse_binary(std::string_view contents);
+
   // Read a line of data (not a header)
   bool parse_line(std::string_view line);
   // Read a line from the main section of the aggregated stats file and put an
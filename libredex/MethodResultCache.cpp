@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MethodResultCache.h"
+
+#include <boost/filesystem.hpp>
+#include <sstream>
+
+#include "ConfigFiles.h"
+#include "DexClass.h"
+#include "DexPosition.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "PassManager.h"
+#include "Show.h"
+#include "Trace.h"
+
+namespace {
+
+// Bump when the format of the entries or the keys changes.
+constexpr const char* kFormatVersion = "1";
+
+// The IRAssembler format cannot represent everything.
+bool is_representable(const IRCode* code) {
+  for (const auto& mie : *code) {
+    switch (mie.type) {
+    case MFLOW_OPCODE:
+      switch (opcode::ref(mie.insn->opcode())) {
+      case opcode::Ref::Data:
+      case opcode::Ref::CallSite:
+      case opcode::Ref::MethodHandle:
+        return false;
+      default:
+        break;
+      }
+      break;
+    case MFLOW_POSITION:
+      for (auto* pos = mie.pos.get(); pos != nullptr; pos = pos->parent) {
+        if (pos->method == nullptr || pos->file == nullptr) {
+          return false;
+        }
+      }
+      break;
+    case MFLOW_DEX_OPCODE:
+      return false;
+    default:
+      break;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+std::unique_ptr<MethodResultCache> MethodResultCache::create(
+    const ConfigFiles& conf,
+    const std::string& pass_name,
+    const std::string& salt) {
+  std::string dir;
+  conf.get_json_config().get("method_result_cache_dir", "", dir);
+  if (dir.empty()) {
+    return nullptr;
+  }
+  auto pass_dir = boost::filesystem::path(dir) / pass_name;
+  boost::filesystem::create_directories(pass_dir);
+  return std::make_unique<MethodResultCache>(pass_dir.string(), salt);
+}
+
+MethodResultCache::MethodResultCache(std::string dir, std::string salt)
+    : m_store(std::move(dir)), m_salt(std::move(salt)) {}
+
+boost::optional<std::string> MethodResultCache::key(
+    const DexMethod* method) const {
+  const auto* code = method->get_code();
+  if (code == nullptr || code->editable_cfg_built() ||
+      !is_representable(code)) {
+    return boost::none;
+  }
+  std::ostringstream oss;
+  oss << kFormatVersion << '\n'
+      << m_salt << '\n'
+      << show(method) << '\n'
+      << method->get_access() << '\n'
+      << code->get_registers_size() << '\n'
+      << assembler::to_s_expr(code);
+  return DiskCache::key(oss.str());
+}
+
+boost::optional<Json::Value> MethodResultCache::replay(const std::string& key,
+                                                       DexMethod* method) {
+  auto in = m_store.open(key);
+  if (!in) {
+    m_store.count_miss();
+    return boost::none;
+  }
+  Json::Value entry;
+  try {
+    in >> entry;
+    auto code = assembler::ircode_from_string(entry["code"].asString());
+    code->set_registers_size(entry["registers_size"].asUInt());
+    // The entry holds the positions, but not the debug item that the code
+    // needs to emit them. The pass would have kept the one of the input code.
+    code->set_debug_item(method->get_code()->release_debug_item());
+    method->set_code(std::move(code));
+  } catch (const std::exception& e) {
+    TRACE(PM, 1, "Ignoring unreadable cache entry %s for %s: %s",
+          m_store.path(key).c_str(), SHOW(method), e.what());
+    m_store.count_miss();
+    return boost::none;
+  }
+  m_store.count_hit();
+  return entry["stats"];
+}
+
+void MethodResultCache::record(const std::string& key,
+                               const IRCode* code,
+                               const Json::Value& stats) {
+  always_assert(!code->editable_cfg_built());
+  Json::Value entry;
+  entry["code"] = assembler::to_string(code);
+  entry["registers_size"] = code->get_registers_size();
+  entry["stats"] = stats;
+
+  m_store.write(key, [&](std::ostream& out) { out << entry; });
+}
+
+void MethodResultCache::report_metrics(PassManager& mgr) const {
+  mgr.incr_metric("method_result_cache_hits", m_store.hits());
+  mgr.incr_metric("method_result_cache_misses", m_store.misses());
+}
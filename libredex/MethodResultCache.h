@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <boost/optional/optional.hpp>
+#include <json/json.h>
+#include <memory>
+#include <string>
+
+#include "DiskCache.h"
+
+struct ConfigFiles;
+class DexMethod;
+class IRCode;
+class PassManager;
+
+/*
+ * A persistent, content-addressed cache of the results of method-local
+ * transformations, shared across builds.
+ *
+ * Only passes whose output for a method depends on nothing but the method's
+ * signature, access flags and code, and on the pass configuration, may use it.
+ * An entry is keyed on a hash of all of these, and holds the resulting code in
+ * the IRAssembler format along with the pass statistics for the method, so that
+ * a replayed method reports the same metrics as a recomputed one.
+ *
+ * The cache is enabled by setting `method_result_cache_dir` in the config.
+ */
+class MethodResultCache final {
+ public:
+  // Returns nullptr if the cache is not enabled. `salt` must capture all pass
+  // configuration that affects the result, and a version that the pass bumps
+  // whenever it changes how it transforms code.
+  static std::unique_ptr<MethodResultCache> create(const ConfigFiles& conf,
+                                                   const std::string& pass_name,
+                                                   const std::string& salt);
+
+  MethodResultCache(std::string dir, std::string salt);
+
+  // The key of the current code of `method`, or none if the code is not in a
+  // form that can be cached.
+  boost::optional<std::string> key(const DexMethod* method) const;
+
+  // If there is an entry for `key`, replaces the code of `method` with it and
+  // returns the recorded statistics.
+  boost::optional<Json::Value> replay(const std::string& key,
+                                      DexMethod* method);
+
+  void record(const std::string& key,
+              const IRCode* code,
+              const Json::Value& stats);
+
+  size_t hits() const { return m_store.hits(); }
+  size_t misses() const { return m_store.misses(); }
+
+  void report_metrics(PassManager& mgr) const;
+
+ private:
+  DiskCache m_store;
+  std::string m_salt;
+};
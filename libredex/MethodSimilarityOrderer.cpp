@@ -7,6 +7,10 @@
 
 #include "MethodSimilarityOrderer.h"
 
+#include <array>
+#include <limits>
+#include <numeric>
+
 #include "DexInstruction.h"
 #include "Show.h"
 #include "Trace.h"
@@ -28,6 +32,50 @@ struct Chunk {
   uint32_t end;
 };
 
+// MinHash sketches have NUM_BANDS bands of ROWS_PER_BAND rows. Scores are
+// only non-negative when the hash ids of two methods overlap a lot, with a
+// Jaccard similarity of about 0.4 or more, for which two rows per band find
+// more than nine in ten pairs, and closer pairs almost surely.
+constexpr size_t NUM_BANDS = 16;
+constexpr size_t ROWS_PER_BAND = 2;
+constexpr size_t NUM_HASHES = NUM_BANDS * ROWS_PER_BAND;
+// Groups in an LSH bucket are only candidates of the groups that are at most
+// this far away in the bucket, i.e. close in the source order.
+constexpr size_t BUCKET_WINDOW = 16;
+
+using Sketch = std::array<uint64_t, NUM_HASHES>;
+
+// The finalizer of SplitMix64.
+inline uint64_t mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+Sketch min_hashes(
+    const std::vector<MethodSimilarityOrderer::CodeHashId>& code_hash_ids) {
+  Sketch sketch;
+  sketch.fill(std::numeric_limits<uint64_t>::max());
+  for (auto id : code_hash_ids) {
+    for (size_t k = 0; k < NUM_HASHES; k++) {
+      sketch[k] =
+          std::min(sketch[k], mix(id + (k + 1) * 0x9e3779b97f4a7c15ULL));
+    }
+  }
+  return sketch;
+}
+
+uint64_t band_key(const Sketch& sketch, size_t band) {
+  uint64_t key = 0;
+  for (size_t r = 0; r < ROWS_PER_BAND; r++) {
+    key = mix(key ^ sketch[band * ROWS_PER_BAND + r]);
+  }
+  return key;
+}
+
 template <typename T>
 struct CountingFakeOutputIterator {
   uint32_t& counter;
@@ -136,44 +184,92 @@ static inline Score get_score(
   return score;
 }
 
-void MethodSimilarityOrderer::compute_score() {
-  m_score_map.clear();
-  m_score_map.resize(m_id_to_method.size());
-
-  std::vector<MethodId> method_ids;
+void MethodSimilarityOrderer::group_methods() {
+  m_method_id_to_group.clear();
+  m_group_code_hash_ids.clear();
+  m_group_members.clear();
+  std::map<std::vector<CodeHashId>, GroupId> groups;
   for (auto& p : m_id_to_method) {
     auto method_id = p.first;
-    m_method_id_to_buffer_id[method_id] = method_ids.size();
-    method_ids.push_back(method_id);
+    const auto& code_hash_ids = m_method_id_to_code_hash_ids[method_id];
+    auto [it, emplaced] =
+        groups.emplace(code_hash_ids, m_group_code_hash_ids.size());
+    if (emplaced) {
+      m_group_code_hash_ids.push_back(&code_hash_ids);
+      m_group_members.emplace_back();
+    }
+    m_method_id_to_group[method_id] = it->second;
+    m_group_members[it->second].insert(method_id);
   }
+}
 
-  std::vector<uint32_t> indices(method_ids.size());
+std::vector<std::vector<MethodSimilarityOrderer::GroupId>>
+MethodSimilarityOrderer::find_candidates() const {
+  size_t num_groups = m_group_code_hash_ids.size();
+  std::vector<Sketch> sketches(num_groups);
+  std::vector<uint32_t> indices(num_groups);
   std::iota(indices.begin(), indices.end(), 0);
   workqueue_run<uint32_t>(
-      [&](uint32_t i) {
-        MethodId method_i = method_ids[i];
-        const auto& code_hash_ids_i = m_method_id_to_code_hash_ids[method_i];
-        std::unordered_map<ScoreValue, std::vector<MethodId>> score_map;
-
-        for (uint32_t j = 0; j < (uint32_t)method_ids.size(); j++) {
-          if (i == j) {
-            continue;
-          }
+      [&](uint32_t g) { sketches[g] = min_hashes(*m_group_code_hash_ids[g]); },
+      indices);
 
-          MethodId method_j = method_ids[j];
-          const auto& code_hash_ids_j = m_method_id_to_code_hash_ids[method_j];
-          auto score = get_score(code_hash_ids_i, code_hash_ids_j);
+  std::vector<std::vector<GroupId>> candidates(num_groups);
+  for (size_t band = 0; band < NUM_BANDS; band++) {
+    std::unordered_map<uint64_t, std::vector<GroupId>> buckets;
+    for (GroupId g = 0; g < num_groups; g++) {
+      // Methods without hash ids only have a non-negative score against each
+      // other, i.e. within their group.
+      if (!m_group_code_hash_ids[g]->empty()) {
+        buckets[band_key(sketches[g], band)].push_back(g);
+      }
+    }
+    for (auto& p : buckets) {
+      const auto& bucket = p.second;
+      for (size_t i = 0; i < bucket.size(); i++) {
+        size_t end = std::min(bucket.size(), i + BUCKET_WINDOW + 1);
+        for (size_t j = i + 1; j < end; j++) {
+          candidates[bucket[i]].push_back(bucket[j]);
+          candidates[bucket[j]].push_back(bucket[i]);
+        }
+      }
+    }
+  }
+  return candidates;
+}
+
+void MethodSimilarityOrderer::compute_score() {
+  group_methods();
+  auto candidates = find_candidates();
+  size_t num_groups = m_group_code_hash_ids.size();
+  m_group_scores.clear();
+  m_group_scores.resize(num_groups);
+
+  std::vector<uint32_t> indices(num_groups);
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<uint32_t>(
+      [&](uint32_t g) {
+        auto& candidates_g = candidates[g];
+        candidates_g.push_back(g);
+        std::sort(candidates_g.begin(), candidates_g.end());
+        candidates_g.erase(
+            std::unique(candidates_g.begin(), candidates_g.end()),
+            candidates_g.end());
+
+        const auto& code_hash_ids_g = *m_group_code_hash_ids[g];
+        auto& scores = m_group_scores[g];
+        for (auto c : candidates_g) {
+          auto score = get_score(code_hash_ids_g, *m_group_code_hash_ids[c]);
           if (score.value() >= 0) {
-            score_map[score.value()].push_back(method_j);
+            scores.emplace_back(score.value(), c);
           }
         }
-
-        // Mapping from score value (key) to Method Ids. The key is in a
-        // decreasing score order. Becuase it iterates Method Id in order,
-        // the vector is already sorted by Method index (source order).
-        std::map<ScoreValue, std::vector<MethodId>, std::greater<ScoreValue>>
-            map(score_map.begin(), score_map.end());
-        m_score_map[i] = std::move(map);
+        // In a decreasing score order. Groups are in the order of their first
+        // method, so ties go to the group first in the source order.
+        std::sort(scores.begin(), scores.end(),
+                  [](const auto& a, const auto& b) {
+                    return a.first != b.first ? a.first > b.first
+                                              : a.second < b.second;
+                  });
       },
       indices);
 }
@@ -210,18 +306,26 @@ MethodSimilarityOrderer::get_next() {
   bool is_next_perf_sensitive = m_method_id_to_code_hash_ids[method_id].empty();
 
   if (!is_next_perf_sensitive && m_last_method_id != boost::none) {
-    // Iterate m_score_map from the highest score..
-    for (auto& p : m_score_map[m_method_id_to_buffer_id[*m_last_method_id]]) {
-      for (auto& m_id : p.second) {
-        // The first match is the one with the highest score
-        // at the smallest index in the source order.
-        if (m_id_to_method.count(m_id)) {
-          TRACE(OPUT, 3,
-                "[method-similarity-orderer] selected %s with score %d",
-                SHOW(m_id_to_method[m_id]), p.first);
-          return m_id;
+    // Iterate the candidate groups from the highest score.
+    const auto& scores =
+        m_group_scores[m_method_id_to_group.at(*m_last_method_id)];
+    for (size_t i = 0; i < scores.size();) {
+      // The best match is the one with the highest score at the smallest
+      // index in the source order.
+      auto score = scores[i].first;
+      boost::optional<MethodId> best;
+      for (; i < scores.size() && scores[i].first == score; i++) {
+        const auto& members = m_group_members[scores[i].second];
+        if (!members.empty() && (!best || *members.begin() < *best)) {
+          best = *members.begin();
         }
       }
+      if (best) {
+        TRACE(OPUT, 3,
+              "[method-similarity-orderer] selected %s with score %d",
+              SHOW(m_id_to_method[*best]), score);
+        return best;
+      }
     }
   }
   boost::optional<MethodId> best_method_id = m_id_to_method.begin()->first;
@@ -238,6 +342,7 @@ void MethodSimilarityOrderer::remove_method(DexMethod* meth) {
   auto method_id = m_method_to_id[meth];
   m_id_to_method.erase(method_id);
   m_method_to_id.erase(meth);
+  m_group_members[m_method_id_to_group.at(method_id)].erase(method_id);
 }
 
 void MethodSimilarityOrderer::order(std::vector<DexMethod*>& methods) {
@@ -9,6 +9,8 @@
 
 #include <set>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include <unordered_set>
 
 #include "DexClass.h"
@@ -28,6 +30,13 @@ class DexInstruction;
  * highly similar methods. For example, methods with a small body like "return
  * true;" would all get co-located right after the first such method, resulting
  * in better compression.
+ *
+ * Methods with the same hash ids form a group, and scores are computed
+ * between groups. Rather than scoring all pairs of groups, candidate groups
+ * are found with locality-sensitive hashing: each group gets a MinHash sketch
+ * of its hash ids, and groups whose sketches agree on all rows of some band
+ * are candidates of each other. Only a bounded window of neighbors in each
+ * bucket is scored, so that buckets of many near-identical groups stay cheap.
  */
 class MethodSimilarityOrderer {
  public:
@@ -43,7 +52,9 @@ class MethodSimilarityOrderer {
 
   using ScoreValue = int32_t;
 
-  using BufferId = uint32_t;
+  // Index of a group of methods with the same hash ids, in the order of the
+  // first method of each group.
+  using GroupId = uint32_t;
 
  private:
   // Mirrors the order in each the methods have been added to the orderer
@@ -56,14 +67,18 @@ class MethodSimilarityOrderer {
   std::unordered_map<MethodId, std::vector<CodeHashId>>
       m_method_id_to_code_hash_ids;
 
-  // Mapping from Method Id to buffer index to m_score_map.
-  std::unordered_map<MethodId, BufferId> m_method_id_to_buffer_id;
+  // Mapping from each method to its group.
+  std::unordered_map<MethodId, GroupId> m_method_id_to_group;
+
+  // The hash ids of each group.
+  std::vector<const std::vector<CodeHashId>*> m_group_code_hash_ids;
+
+  // The methods of each group that are not ordered yet.
+  std::vector<std::set<MethodId>> m_group_members;
 
-  // Vector to contain similarity score among all Methods for the given
-  // buffer indexed Method. ThreadPool accesses this vector concurrently.
-  std::vector<
-      std::map<ScoreValue, std::vector<MethodId>, std::greater<ScoreValue>>>
-      m_score_map;
+  // For each group, the candidate groups (including itself) with a
+  // non-negative score, in decreasing score order and then group order.
+  std::vector<std::vector<std::pair<ScoreValue, GroupId>>> m_group_scores;
 
   // Last Method Id that is ordered.
   boost::optional<MethodId> m_last_method_id;
@@ -83,6 +98,11 @@ class MethodSimilarityOrderer {
 
   boost::optional<MethodId> get_next();
 
+  void group_methods();
+
+  // The groups that may be similar to each group, by MinHash and LSH.
+  std::vector<std::vector<GroupId>> find_candidates() const;
+
   void compute_score();
 
  public:
@@ -54,6 +54,17 @@ class ClInitSideEffectsAnalysis {
     return last_cls;
   }
 
+  bool run_own(const DexClass* cls) {
+    for (auto c = cls; c && !c->is_external();
+         c = type_class(c->get_super_class())) {
+      m_initialized.insert(c->get_type());
+    }
+    auto clinit = cls->get_clinit();
+    bool res = clinit && method_may_have_side_effects(clinit, clinit);
+    always_assert(m_active.empty());
+    return res;
+  }
+
  private:
   bool clinit_has_no_side_effects(DexType* type) {
     return m_clinit_has_no_side_effects &&
@@ -487,6 +498,15 @@ const DexClass* clinit_may_have_side_effects(
   return analysis.run(cls);
 }
 
+bool own_clinit_may_have_side_effects(
+    const DexClass* cls,
+    const ClInitHasNoSideEffectsPredicate* clinit_has_no_side_effects,
+    const std::unordered_set<DexMethod*>* non_true_virtuals) {
+  ClInitSideEffectsAnalysis analysis(clinit_has_no_side_effects,
+                                     non_true_virtuals);
+  return analysis.run_own(cls);
+}
+
 bool no_invoke_super(const IRCode& code) {
   always_assert(!code.editable_cfg_built());
   for (const auto& mie : InstructionIterable(code)) {
@@ -53,6 +53,17 @@ const DexClass* clinit_may_have_side_effects(
     const ClInitHasNoSideEffectsPredicate* clinit_has_no_side_effects = nullptr,
     const std::unordered_set<DexMethod*>* non_true_virtuals = nullptr);
 
+/**
+ * Return true if the <clinit> of the cls itself, not of its super types, may
+ * have side effects, when the cls and its super types are being initialized.
+ * This is the question that clinit_may_have_side_effects answers for each
+ * type along the chain of super types that the predicate does not rule out.
+ */
+bool own_clinit_may_have_side_effects(
+    const DexClass* cls,
+    const ClInitHasNoSideEffectsPredicate* clinit_has_no_side_effects = nullptr,
+    const std::unordered_set<DexMethod*>* non_true_virtuals = nullptr);
+
 /**
  * Check that the method contains no invoke-super instruction; this is a
  * requirement to relocate a method outside of its original inheritance
@@ -153,4 +164,27 @@ inline unsigned count_opcode_of_types(
   return ret;
 }
 
+/*
+ * Whether an instruction of `code` satisfies `pred`. This is a plain scan of
+ * the instructions, which pattern-matching passes use to skip the methods
+ * that cannot match before building a CFG for them.
+ */
+template <typename Predicate>
+inline bool any_insn(const IRCode& code, const Predicate& pred) {
+  if (code.editable_cfg_built()) {
+    for (auto&& mie : cfg::ConstInstructionIterable(code.cfg())) {
+      if (pred(mie.insn)) {
+        return true;
+      }
+    }
+    return false;
+  }
+  for (auto&& mie : ::InstructionIterable(code)) {
+    if (pred(mie.insn)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 }; // namespace method
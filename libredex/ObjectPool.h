@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+/*
+ * Storage for objects of one type that are created and destroyed together
+ * with an owner, e.g. the blocks and edges of a CFG. Slots are carved out of
+ * contiguous slabs that grow geometrically, and the slots of destroyed objects
+ * are reused, so that a long-lived owner does not grow without bounds.
+ *
+ * The pool only hands out raw slots; the owner constructs objects in them with
+ * placement new, and must destroy the live objects before returning their
+ * slots, or before destroying the pool. The pool is not thread-safe.
+ */
+template <typename T>
+class ObjectPool final {
+ public:
+  ObjectPool() = default;
+
+  ObjectPool(const ObjectPool&) = delete;
+  ObjectPool& operator=(const ObjectPool&) = delete;
+
+  ~ObjectPool() {
+    for (auto* slab : m_slabs) {
+      delete[] slab;
+    }
+  }
+
+  // Returns uninitialized memory for one T.
+  void* allocate() {
+    if (m_free != nullptr) {
+      Slot* slot = m_free;
+      m_free = slot->next;
+      return slot;
+    }
+    if (m_cur == m_end) {
+      new_slab();
+    }
+    return m_cur++;
+  }
+
+  // Returns the memory of a destroyed T to the pool.
+  void deallocate(void* ptr) {
+    auto* slot = static_cast<Slot*>(ptr);
+    slot->next = m_free;
+    m_free = slot;
+  }
+
+  // Makes sure that the first slab holds at least `n` objects. Only has an
+  // effect before the first allocation.
+  void reserve(size_t n) {
+    if (m_slabs.empty()) {
+      m_next_slab_size = std::max(m_next_slab_size, n);
+    }
+  }
+
+ private:
+  union Slot {
+    Slot* next;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  static constexpr size_t kMinSlabSize = 8;
+  static constexpr size_t kMaxSlabSize = 1024;
+
+  void new_slab() {
+    auto size = m_next_slab_size;
+    m_cur = new Slot[size];
+    m_end = m_cur + size;
+    m_slabs.push_back(m_cur);
+    m_next_slab_size = std::min(size * 2, std::max(size, kMaxSlabSize));
+  }
+
+  Slot* m_free{nullptr};
+  Slot* m_cur{nullptr};
+  Slot* m_end{nullptr};
+  size_t m_next_slab_size{kMinSlabSize};
+  std::vector<Slot*> m_slabs;
+};
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "WorkQueue.h"
+
+namespace redex {
+
+/*
+ * Prints the items to `output` with `print(std::ostream&, const Item&)`, in
+ * the order of the items, as printing them one after the other would.
+ *
+ * Runs of consecutive items are printed in parallel into buffers of their
+ * own, which are then written to `output` in order, each in a single write.
+ * Only a window of a few runs per thread is buffered at any time, so that
+ * large outputs are not held in memory all at once.
+ */
+template <typename Item, typename Print>
+void print_in_parallel(std::ostream& output,
+                       const std::vector<Item>& items,
+                       const Print& print,
+                       size_t items_per_run = 256) {
+  const size_t num_threads = redex_parallel::default_num_threads();
+  const size_t runs_per_window = num_threads * 4;
+  std::vector<std::string> buffers(runs_per_window);
+  std::vector<size_t> runs;
+  runs.reserve(runs_per_window);
+  const size_t items_per_window = items_per_run * runs_per_window;
+  for (size_t begin = 0; begin < items.size(); begin += items_per_window) {
+    size_t end = std::min(items.size(), begin + items_per_window);
+    size_t num_runs = (end - begin + items_per_run - 1) / items_per_run;
+    runs.resize(num_runs);
+    std::iota(runs.begin(), runs.end(), 0);
+    workqueue_run<size_t>(
+        [&](size_t run) {
+          std::ostringstream buffer;
+          size_t run_begin = begin + run * items_per_run;
+          size_t run_end = std::min(end, run_begin + items_per_run);
+          for (size_t i = run_begin; i < run_end; ++i) {
+            print(buffer, items[i]);
+          }
+          buffers[run] = buffer.str();
+        },
+        runs, std::min(num_threads, num_runs));
+    for (size_t run = 0; run < num_runs; ++run) {
+      output.write(buffers[run].data(), buffers[run].size());
+      buffers[run] = std::string();
+    }
+  }
+}
+
+} // namespace redex
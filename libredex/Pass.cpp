@@ -11,6 +11,7 @@
 #include "Debug.h"
 #include "DexUtil.h"
 #include "PassRegistry.h"
+#include "Walkers.h"
 
 Pass::Pass(const std::string& name, Kind kind) : m_name(name), m_kind(kind) {
   PassRegistry::get().register_pass(this);
@@ -21,6 +22,7 @@ void Pass::set_analysis_usage(AnalysisUsage& analysis_usage) const {
   // transformation passes preserves none.
   if (m_kind == ANALYSIS) {
     analysis_usage.set_preserve_all();
+    analysis_usage.set_preserve_method_analyses();
   }
 }
 
@@ -52,3 +54,14 @@ Scope PartialPass::build_class_scope_with_packages_config(
     return build_class_scope_for_packages(stores, m_select_packages);
   }
 }
+
+void MethodPass::run_pass(DexStoresVector& stores,
+                          ConfigFiles& conf,
+                          PassManager& mgr) {
+  auto run = prepare(stores, conf, mgr);
+  walk::parallel::code(build_class_scope(stores),
+                       [&](DexMethod* method, IRCode& code) {
+                         run->run_on_method(method, code);
+                       });
+  run->finish(mgr);
+}
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -18,6 +20,8 @@
 
 class AnalysisUsage;
 struct ConfigFiles;
+class DexMethod;
+class IRCode;
 class PassManager;
 
 class Pass : public Configurable {
@@ -58,6 +62,16 @@ class Pass : public Configurable {
 
   virtual void set_analysis_usage(AnalysisUsage& analysis_usage) const;
 
+  /**
+   * Whether the pass is CFG-legal: it works on the editable CFGs of the
+   * methods, building them only if they are not built yet (see
+   * cfg::ScopedCFG), and leaves CFGs that were built before in place. With
+   * `keep_editable_cfg` set in the config, the PassManager keeps the CFGs
+   * built between consecutive CFG-legal passes instead of linearizing them
+   * after one pass and rebuilding them in the next.
+   */
+  virtual bool is_cfg_legal() const { return false; }
+
   Configurable::Reflection reflect() override;
 
  private:
@@ -99,3 +113,72 @@ class PartialPass : public Pass {
  private:
   std::unordered_set<std::string> m_select_packages;
 };
+
+/**
+ * A pass that transforms each method on its own: the work on a method reads
+ * and writes nothing but the code of that method, apart from state computed
+ * up front in `prepare` and state that method passes never write, such as the
+ * class hierarchy.
+ *
+ * With `fuse_method_passes` set in the config, the PassManager runs a stretch
+ * of consecutive method passes as a single parallel walk, running all of them
+ * on one method before moving on to the next. `prepare` then runs before the
+ * preceding method passes of the stretch have visited any method, so it must
+ * not depend on their effects.
+ */
+class MethodPass : public Pass {
+ public:
+  /**
+   * The state of one run of the pass.
+   */
+  class Run {
+   public:
+    virtual ~Run() = default;
+
+    // Called concurrently, once for each method with code. It may replace the
+    // code of the method.
+    virtual void run_on_method(DexMethod* method, IRCode& code) = 0;
+
+    // Called once all methods were visited, e.g. to report metrics.
+    virtual void finish(PassManager& /* mgr */) {}
+
+    // Whether `run_on_method` works on the editable CFG, building it only if
+    // it is not built yet (see cfg::ScopedCFG) and leaving the code in the
+    // form it found it in. A fused walk then keeps the CFG of a method built
+    // across consecutive such runs instead of rebuilding it for each.
+    virtual bool uses_editable_cfg() const { return false; }
+  };
+
+  /**
+   * A run that sums up per-method statistics, which must support `+=`.
+   */
+  template <typename Stats>
+  class AccumulatingRun : public Run {
+   public:
+    virtual Stats visit(DexMethod* method, IRCode& code) = 0;
+
+    virtual void report(PassManager& mgr, const Stats& stats) = 0;
+
+    void run_on_method(DexMethod* method, IRCode& code) final {
+      auto stats = visit(method, code);
+      std::lock_guard<std::mutex> lock(m_stats_mutex);
+      m_stats += stats;
+    }
+
+    void finish(PassManager& mgr) final { report(mgr, m_stats); }
+
+   private:
+    std::mutex m_stats_mutex;
+    Stats m_stats{};
+  };
+
+  explicit MethodPass(const std::string& name) : Pass(name) {}
+
+  virtual std::unique_ptr<Run> prepare(DexStoresVector& stores,
+                                       ConfigFiles& conf,
+                                       PassManager& mgr) = 0;
+
+  void run_pass(DexStoresVector& stores,
+                ConfigFiles& conf,
+                PassManager& mgr) final;
+};
@@ -8,10 +8,13 @@
 #include "PassManager.h"
 #include "DexAssessments.h"
 
+#include <atomic>
+#include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include <cinttypes>
 #include <cstdio>
 #include <cstdlib>
+#include <ctime>
 #include <iostream>
 #include <limits>
 #include <list>
@@ -29,6 +32,7 @@
 #include "ApiLevelChecker.h"
 #include "AssetManager.h"
 #include "CommandProfiling.h"
+#include "ConcurrentContainers.h"
 #include "ConfigFiles.h"
 #include "Debug.h"
 #include "DexClass.h"
@@ -36,14 +40,17 @@
 #include "DexOutput.h"
 #include "DexUtil.h"
 #include "GraphVisualizer.h"
+#include "HotCounters.h"
 #include "IRCode.h"
 #include "IRTypeChecker.h"
 #include "InstructionLowering.h"
 #include "JemallocUtil.h"
+#include "MethodAnalysisCache.h"
 #include "MethodProfiles.h"
 #include "Native.h"
 #include "OptData.h"
 #include "Pass.h"
+#include "PerfCounters.h"
 #include "PrintSeeds.h"
 #include "ProguardPrintConfiguration.h"
 #include "ProguardReporting.h"
@@ -55,6 +62,7 @@
 #include "SourceBlocks.h"
 #include "Timer.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -73,6 +81,46 @@ const Pass* get_profiled_pass(const PassManager& mgr) {
   return pass;
 }
 
+// The passes whose hardware events are counted, from the comma-separated names
+// in PERF_COUNTERS_PASSES.
+std::unordered_set<const Pass*> get_perf_counted_passes(
+    const PassManager& mgr) {
+  std::unordered_set<const Pass*> passes;
+  const char* names = getenv("PERF_COUNTERS_PASSES");
+  if (names == nullptr) {
+    return passes;
+  }
+  std::vector<std::string> split_names;
+  boost::split(split_names, names, boost::is_any_of(","));
+  for (const auto& name : split_names) {
+    if (name.empty()) {
+      continue;
+    }
+    auto pass = mgr.find_pass(name);
+    always_assert_log(pass != nullptr,
+                      "Unknown pass %s in PERF_COUNTERS_PASSES", name.c_str());
+    std::cerr << "Will count perf events for " << pass->name() << std::endl;
+    passes.insert(pass);
+  }
+  return passes;
+}
+
+void set_perf_metrics(PassManager* mgr,
+                      const perf_counters::ScopedPerfCounters& counters) {
+  auto counts = counters.read();
+  if (!counts) {
+    return;
+  }
+  mgr->set_metric("perf_cycles", counts->cycles);
+  mgr->set_metric("perf_instructions", counts->instructions);
+  mgr->set_metric("perf_cache_misses", counts->cache_misses);
+  mgr->set_metric("perf_branch_misses", counts->branch_misses);
+  if (counts->cycles > 0) {
+    mgr->set_metric("perf_ipc_x1000",
+                    counts->instructions * 1000 / counts->cycles);
+  }
+}
+
 std::string get_apk_dir(const Json::Value& config) {
   auto apkdir = config["apk_dir"].asString();
   apkdir.erase(std::remove(apkdir.begin(), apkdir.end(), '"'), apkdir.end());
@@ -103,6 +151,8 @@ class CheckerConfig {
 
     m_check_num_of_refs =
         type_checker_args.get("check_num_of_refs", false).asBool();
+    m_only_changed_methods_after_pass =
+        type_checker_args.get("only_changed_methods", false).asBool();
 
     for (auto& trigger_pass : type_checker_args["run_after_passes"]) {
       m_type_checker_trigger_passes.insert(trigger_pass.asString());
@@ -219,10 +269,18 @@ class CheckerConfig {
     return ret;
   }
 
+  // With `after_pass`, and if so configured, methods whose code did not
+  // change since they were last checked after a pass are skipped. Changes are
+  // detected the way the MethodAnalysisCache detects them.
   boost::optional<std::string> run_verifier(const Scope& scope,
-                                            bool exit_on_fail = true) {
+                                            bool exit_on_fail = true,
+                                            bool after_pass = false) {
     TRACE(PM, 1, "Running IRTypeChecker...");
-    Timer t("IRTypeChecker");
+    bool only_changed_methods = after_pass && m_only_changed_methods_after_pass;
+    Timer t(only_changed_methods ? "IRTypeChecker (changed methods)"
+                                 : "IRTypeChecker");
+    std::atomic<size_t> checked_methods{0};
+    std::atomic<size_t> unchanged_methods{0};
 
     struct Result {
       size_t errors{0};
@@ -277,12 +335,33 @@ class CheckerConfig {
 
     auto res =
         walk::parallel::methods<Result>(scope, [&](DexMethod* dex_method) {
-          auto checker = run_checker(dex_method);
-          if (!checker.fail()) {
+          auto* code = dex_method->get_code();
+          if (only_changed_methods && code != nullptr) {
+            // The outcome is kept with the other analyses of the method, so
+            // it is dropped when its code changes, and after the passes that
+            // may change what its verification depends on.
+            code->build_cfg(/* editable */ false);
+            bool checked = false;
+            auto passed = g_redex->method_analysis_cache().get(
+                dex_method, code->cfg(), "PassedTypeCheckerAfterPass", [&] {
+                  checked = true;
+                  return !run_checker(dex_method).fail();
+                });
+            (checked ? checked_methods : unchanged_methods)++;
+            if (*passed) {
+              return Result();
+            }
+            return Result(dex_method);
+          }
+          checked_methods++;
+          if (!run_checker(dex_method).fail()) {
             return Result();
           }
           return Result(dex_method);
         });
+    TRACE(PM, 1,
+          "IRTypeChecker: checked %zu methods, skipped %zu unchanged methods",
+          checked_methods.load(), unchanged_methods.load());
 
     if (res.errors == 0) {
       return boost::none;
@@ -324,41 +403,163 @@ class CheckerConfig {
   bool m_validate_invoke_super;
   bool m_check_no_overwrite_this;
   bool m_check_num_of_refs;
+  bool m_only_changed_methods_after_pass;
   // TODO(fengliu): Kill the `validate_access` flag.
   bool m_validate_access{true};
   bool m_annotated_cfg_on_error{false};
   bool m_annotated_cfg_on_error_reduced{true};
 };
 
-class ScopedVmHWM {
+// Records how much memory the process used before and after a pass, and its
+// peak during the pass if the high water mark is reset at the start. The
+// usage comes from the jemalloc statistics when they are available, and is
+// the resident set size otherwise.
+class ScopedMemStats {
  public:
-  explicit ScopedVmHWM(bool enabled, bool reset) : m_enabled(enabled) {
+  explicit ScopedMemStats(bool enabled, bool reset) : m_enabled(enabled) {
     if (enabled) {
       if (reset) {
         try_reset_hwm_mem_stat();
       }
-      m_before = get_mem_stats().vm_hwm;
+      auto vm_stats = get_mem_stats();
+      m_hwm_before = vm_stats.vm_hwm;
+      m_rss_before = vm_stats.vm_rss;
+      m_jemalloc_before = jemalloc_util::get_stats();
     }
   }
 
   void trace_log(PassManager* mgr, const Pass* pass) {
-    if (m_enabled) {
-      uint64_t after = get_mem_stats().vm_hwm;
-      if (mgr != nullptr) {
-        mgr->set_metric("vm_hwm_after", after);
-        mgr->set_metric("vm_hwm_delta", after - m_before);
-      }
-      TRACE(STATS, 1, "VmHWM for %s was %s (%s over start).",
-            pass->name().c_str(), pretty_bytes(after).c_str(),
-            pretty_bytes(after - m_before).c_str());
+    if (!m_enabled) {
+      return;
+    }
+    auto vm_stats = get_mem_stats();
+    uint64_t after = vm_stats.vm_hwm;
+    if (mgr != nullptr) {
+      mgr->set_metric("vm_hwm_after", after);
+      mgr->set_metric("vm_hwm_delta", after - m_hwm_before);
+    }
+    TRACE(STATS, 1, "VmHWM for %s was %s (%s over start).",
+          pass->name().c_str(), pretty_bytes(after).c_str(),
+          pretty_bytes(after - m_hwm_before).c_str());
+
+    auto jemalloc_after = jemalloc_util::get_stats();
+    if (m_jemalloc_before && jemalloc_after) {
+      set_metrics(mgr, "mem_allocated", m_jemalloc_before->allocated,
+                  jemalloc_after->allocated);
+      set_metrics(mgr, "mem_active", m_jemalloc_before->active,
+                  jemalloc_after->active);
+      set_metrics(mgr, "mem_resident", m_jemalloc_before->resident,
+                  jemalloc_after->resident);
+      TRACE(STATS, 1, "Allocated for %s: %s before, %s after.",
+            pass->name().c_str(),
+            pretty_bytes(m_jemalloc_before->allocated).c_str(),
+            pretty_bytes(jemalloc_after->allocated).c_str());
+    } else {
+      set_metrics(mgr, "vm_rss", m_rss_before, vm_stats.vm_rss);
+      TRACE(STATS, 1, "VmRSS for %s: %s before, %s after.",
+            pass->name().c_str(), pretty_bytes(m_rss_before).c_str(),
+            pretty_bytes(vm_stats.vm_rss).c_str());
     }
   }
 
  private:
-  uint64_t m_before;
+  static void set_metrics(PassManager* mgr,
+                          const std::string& name,
+                          uint64_t before,
+                          uint64_t after) {
+    if (mgr == nullptr) {
+      return;
+    }
+    mgr->set_metric(name + "_before", before);
+    mgr->set_metric(name + "_after", after);
+    mgr->set_metric(name + "_delta",
+                    static_cast<int64_t>(after) - static_cast<int64_t>(before));
+  }
+
+  uint64_t m_hwm_before;
+  uint64_t m_rss_before;
+  boost::optional<jemalloc_util::Stats> m_jemalloc_before;
   bool m_enabled;
 };
 
+// The wall and CPU time of a pass, and how busy the work queues kept their
+// threads.
+struct PassCpuStats {
+  double wall_s{0};
+  double cpu_s{0};
+  double workqueue_busy_s{0};
+  double workqueue_capacity_s{0};
+
+  // The average number of cores that the pass kept busy.
+  double parallelism() const { return wall_s > 0 ? cpu_s / wall_s : 0; }
+
+  // The fraction of the thread time of the work queues that their workers
+  // spent idle.
+  double workqueue_idle() const {
+    return workqueue_capacity_s > 0
+               ? 1 - workqueue_busy_s / workqueue_capacity_s
+               : 0;
+  }
+
+  void set_metrics(PassManager* mgr) const {
+    mgr->set_metric("wall_time_ms", static_cast<int64_t>(wall_s * 1000));
+    mgr->set_metric("cpu_time_ms", static_cast<int64_t>(cpu_s * 1000));
+    mgr->set_metric("effective_parallelism_pct",
+                    static_cast<int64_t>(parallelism() * 100));
+    if (workqueue_capacity_s > 0) {
+      mgr->set_metric("workqueue_busy_ms",
+                      static_cast<int64_t>(workqueue_busy_s * 1000));
+      mgr->set_metric("workqueue_idle_ms",
+                      static_cast<int64_t>(
+                          (workqueue_capacity_s - workqueue_busy_s) * 1000));
+    }
+  }
+};
+
+class ScopedCpuStats {
+ public:
+  ScopedCpuStats()
+      : m_wall_begin(std::chrono::steady_clock::now()),
+        m_cpu_begin(std::clock()),
+        m_workqueue_begin(sparta::get_workqueue_times()) {}
+
+  // The stats since the start of the scope.
+  PassCpuStats get() const {
+    auto workqueue = sparta::get_workqueue_times();
+    PassCpuStats stats;
+    stats.wall_s = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - m_wall_begin)
+                       .count();
+    // The CPU time of all threads of the process.
+    stats.cpu_s = static_cast<double>(std::clock() - m_cpu_begin) /
+                  CLOCKS_PER_SEC;
+    stats.workqueue_busy_s =
+        (workqueue.busy_us - m_workqueue_begin.busy_us) / 1000000.0;
+    stats.workqueue_capacity_s =
+        (workqueue.capacity_us - m_workqueue_begin.capacity_us) / 1000000.0;
+    return stats;
+  }
+
+ private:
+  std::chrono::steady_clock::time_point m_wall_begin;
+  std::clock_t m_cpu_begin;
+  sparta::WorkQueueTimes m_workqueue_begin;
+};
+
+void trace_cpu_summary(
+    const std::vector<std::pair<std::string, PassCpuStats>>& summary) {
+  if (!traceEnabled(PM, 1)) {
+    return;
+  }
+  TRACE(PM, 1, "%-60s %9s %9s %6s %7s", "Pass", "wall (s)", "cpu (s)",
+        "cores", "wq idle");
+  for (const auto& [name, stats] : summary) {
+    TRACE(PM, 1, "%-60s %9.1f %9.1f %6.1f %6.1f%%", name.c_str(),
+          stats.wall_s, stats.cpu_s, stats.parallelism(),
+          stats.workqueue_idle() * 100);
+  }
+}
+
 class CheckUniqueDeobfuscatedNames {
  public:
   bool m_after_each_pass{false};
@@ -466,6 +667,19 @@ class AnalysisUsageHelper {
 
   void pre_pass(Pass* pass) { pass->set_analysis_usage(m_analysis_usage); }
 
+  // Called as soon as the pass ran, so that the verifiers that run after it
+  // already see the cache as the next pass will.
+  void invalidate_method_analyses(
+      hashing::CodeHashCache* code_hashes /* nullable */) {
+    if (!m_analysis_usage.preserves_method_analyses()) {
+      g_redex->method_analysis_cache().clear();
+      // The code hashes also cover the names of what the code refers to.
+      if (code_hashes != nullptr) {
+        code_hashes->clear();
+      }
+    }
+  }
+
   void post_pass(Pass* pass) {
     // Invalidate existing preserved analyses according to policy set by each
     // pass.
@@ -669,6 +883,47 @@ AssessorConfig get_assessor_config(const ConfigFiles& conf,
   return res;
 }
 
+// Dumps a jemalloc heap profile before the first pass and after each pass into
+// the directory given by MALLOC_PROFILE_DUMP_DIR. A profile holds the sampled
+// live allocations, so diffing the profiles before and after a pass with
+// tools/python/heap_profile_diff.py shows what the pass retained, by
+// allocation site. Sampling needs a jemalloc with profiling support, started
+// with e.g. MALLOC_CONF=prof:true,prof_active:false.
+class HeapProfileDumps {
+ public:
+  HeapProfileDumps() {
+    const char* dir = getenv("MALLOC_PROFILE_DUMP_DIR");
+    if (dir == nullptr) {
+      return;
+    }
+    m_dir = dir;
+    boost::filesystem::create_directories(m_dir);
+    m_profiling = std::make_unique<jemalloc_util::ScopedProfiling>(true);
+    dump("000.begin");
+  }
+
+  bool enabled() const { return !m_dir.empty(); }
+
+  void dump_after(const Pass* pass, size_t index) {
+    if (!enabled()) {
+      return;
+    }
+    char prefix[16];
+    snprintf(prefix, sizeof(prefix), "%03zu.", index + 1);
+    dump(prefix + pass->name());
+  }
+
+ private:
+  void dump(const std::string& name) {
+    auto path = boost::filesystem::path(m_dir) / (name + ".heap");
+    TRACE(PM, 1, "Dumping heap profile to %s", path.string().c_str());
+    jemalloc_util::dump(path.string());
+  }
+
+  std::string m_dir;
+  std::unique_ptr<jemalloc_util::ScopedProfiling> m_profiling;
+};
+
 class AfterPassSizes {
  private:
   PassManager* m_mgr;
@@ -699,6 +954,8 @@ class AfterPassSizes {
     json.get("after_pass_size_queue", m_max_jobs, m_max_jobs);
   }
 
+  bool enabled() const { return m_enabled; }
+
   bool handle(PassManager::PassInfo* pass_info,
               DexStoresVector* stores,
               ConfigFiles* conf) {
@@ -925,6 +1182,8 @@ class TraceClassAfterEachPass {
     }
   }
 
+  bool enabled() const { return trace_class_name != nullptr; }
+
   void dump(const std::string& pass_name) {
     if (trace_class_name) {
       fprintf(fd, "After Pass  %s\n", pass_name.c_str());
@@ -1047,7 +1306,7 @@ hashing::DexHash PassManager::run_hasher(const char* pass_name,
   TRACE(PM, 2, "Running hasher...");
   Timer t("Hasher");
   auto timer = m_hashers_timer.scope();
-  hashing::DexScopeHasher hasher(scope);
+  hashing::DexScopeHasher hasher(scope, m_code_hashes.get());
   auto hash = hasher.run();
   if (pass_name) {
     // log metric value in a way that fits into JSON number value
@@ -1091,6 +1350,7 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
   }
   auto profiler_all_info =
       ScopedCommandProfiling::maybe_info_from_env("ALL_PASSES_");
+  const auto perf_counted_passes = get_perf_counted_passes(*this);
 
   if (conf.force_single_dex()) {
     // Squash the dexes into one, so that the passes all see only one dex and
@@ -1139,6 +1399,10 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
   conf.get_method_profiles();
 
   if (run_hasher_after_each_pass) {
+    m_code_hashes.reset();
+    if (conf.get_json_config()["hasher"].get("incremental", false).asBool()) {
+      m_code_hashes = std::make_unique<hashing::CodeHashCache>();
+    }
     m_initial_hash = run_hasher(nullptr, scope);
   }
 
@@ -1153,6 +1417,7 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
       traceEnabled(STATS, 1) || conf.get_json_config().get("mem_stats", true);
   const bool hwm_per_pass =
       conf.get_json_config().get("mem_stats_per_pass", true);
+  std::vector<std::pair<std::string, PassCpuStats>> cpu_summary;
 
   size_t min_pass_idx_for_dex_ref_check =
       checker_conf.min_pass_idx_for_dex_ref_check(m_activated_passes);
@@ -1161,6 +1426,7 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
   AnalysisUsage::check_dependencies(m_activated_passes);
 
   AfterPassSizes after_pass_size(this, conf);
+  HeapProfileDumps heap_profile_dumps;
 
   // For core loop legibility, have a lambda here.
 
@@ -1170,14 +1436,39 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
     }
   };
 
+  // With `keep_editable_cfg`, the editable CFGs of the methods stay built
+  // between consecutive CFG-legal passes (see Pass::is_cfg_legal), as long as
+  // nothing looks at the code in between. They are linearized before any other
+  // pass, and after the last pass.
+  const bool keep_editable_cfg =
+      conf.get_json_config().get("keep_editable_cfg", false);
+  size_t total_linearizations_avoided = 0;
+
+  // The code and mutation epoch of each method after the last pass, to report
+  // how many methods each pass changed.
+  ConcurrentMap<const DexMethod*, std::pair<const IRCode*, size_t>>
+      code_epochs;
+  walk::parallel::code(scope, [&code_epochs](DexMethod* m, IRCode& code) {
+    code_epochs.emplace(m, std::make_pair(&code, code.mutation_epoch()));
+  });
+
   auto post_pass_verifiers = [&](Pass* pass, size_t i, size_t size) {
-    walk::parallel::code(build_class_scope(stores), [](DexMethod* m,
-                                                       IRCode& code) {
+    std::atomic<size_t> changed_methods{0};
+    walk::parallel::code(build_class_scope(stores), [&](DexMethod* m,
+                                                        IRCode& code) {
       // Ensure that pass authors deconstructed the editable CFG at the end of
       // their pass. Currently, passes assume the incoming code will be in
-      // IRCode form
-      always_assert_log(!code.editable_cfg_built(), "%s has a cfg!", SHOW(m));
+      // IRCode form, unless the PassManager keeps the CFGs.
+      always_assert_log(keep_editable_cfg || !code.editable_cfg_built(),
+                        "%s has a cfg!", SHOW(m));
+      auto epoch = std::make_pair<const IRCode*, size_t>(
+          &code, code.mutation_epoch());
+      if (code_epochs.get(m, {}) != epoch) {
+        code_epochs.insert_or_assign(std::make_pair(m, epoch));
+        changed_methods++;
+      }
     });
+    set_metric("~result~changed~methods~", changed_methods.load());
 
     bool run_hasher = run_hasher_after_each_pass;
     bool run_assessor = assessor_config.run_after_each_pass ||
@@ -1202,7 +1493,8 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
         // output phase -- the register allocator can fix it up later.
         checker_conf.check_no_overwrite_this(false)
             .validate_access(false)
-            .run_verifier(scope);
+            .run_verifier(scope, /* exit_on_fail= */ true,
+                          /* after_pass= */ true);
       }
       if (i >= min_pass_idx_for_dex_ref_check) {
         CheckerConfig::ref_validation(stores, pass->name());
@@ -1217,21 +1509,236 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
 
   std::unordered_map<const Pass*, size_t> runs;
 
+  const bool fuse_method_passes =
+      conf.get_json_config().get("fuse_method_passes", false);
+  const bool write_cfg_each_pass =
+      conf.get_json_config().get("write_cfg_each_pass", false);
+
+  // Whether the program is looked at right after the pass, which rules out
+  // fusing the pass with the next one.
+  auto observed_after = [&](const Pass* pass) {
+    return run_hasher_after_each_pass || assessor_config.run_after_each_pass ||
+           checker_conf.run_after_pass(pass) ||
+           check_unique_deobfuscated.m_after_each_pass ||
+           after_pass_size.enabled() || trace_cls.enabled() ||
+           heap_profile_dumps.enabled() || write_cfg_each_pass;
+  };
+
+  // Whether the CFGs stay built after the pass at `i`.
+  auto keep_cfgs_after = [&](size_t i) {
+    return keep_editable_cfg && i + 1 < m_activated_passes.size() &&
+           m_activated_passes[i]->is_cfg_legal() &&
+           m_activated_passes[i + 1]->is_cfg_legal() &&
+           !observed_after(m_activated_passes[i]);
+  };
+
+  // Before the pass at `i`, builds the CFGs that are missing if they are to
+  // stay built after it, as a CFG-legal pass clears the ones it builds itself.
+  auto build_kept_cfgs = [&](size_t i) {
+    if (!keep_cfgs_after(i)) {
+      return;
+    }
+    std::atomic<size_t> built{0};
+    walk::parallel::code(build_class_scope(stores),
+                         [&built](DexMethod*, IRCode& code) {
+                           if (!code.editable_cfg_built()) {
+                             code.build_cfg(/* editable */ true);
+                             ++built;
+                           }
+                         });
+    if (built > 0) {
+      incr_metric("cfg_prebuilt", built);
+    }
+  };
+
+  // After the pass at `i`, keeps the CFGs or linearizes them.
+  auto keep_or_linearize_cfgs = [&](size_t i) {
+    if (!keep_editable_cfg) {
+      return;
+    }
+    const bool keep = keep_cfgs_after(i);
+    std::atomic<size_t> count{0};
+    walk::parallel::code(build_class_scope(stores),
+                         [keep, &count](DexMethod*, IRCode& code) {
+                           if (code.editable_cfg_built()) {
+                             if (!keep) {
+                               code.clear_cfg();
+                             }
+                             ++count;
+                           }
+                         });
+    if (count == 0) {
+      return;
+    }
+    if (keep) {
+      incr_metric("cfg_linearizations_avoided", count);
+      total_linearizations_avoided += count;
+    } else {
+      incr_metric("cfg_linearized", count);
+    }
+  };
+
+  // The number of consecutive method passes starting at `i` that can run as
+  // one walk.
+  auto fusable_method_passes = [&](size_t i) {
+    size_t count = 0;
+    if (!fuse_method_passes || profiler_all_info) {
+      return count;
+    }
+    for (size_t j = i; j < m_activated_passes.size(); ++j) {
+      Pass* pass = m_activated_passes[j];
+      if (dynamic_cast<MethodPass*>(pass) == nullptr ||
+          pass == profiler_info_pass || pass == m_malloc_profile_pass ||
+          perf_counted_passes.count(pass)) {
+        break;
+      }
+      AnalysisUsage analysis_usage;
+      pass->set_analysis_usage(analysis_usage);
+      if (!analysis_usage.get_required_passes().empty()) {
+        break;
+      }
+      ++count;
+      if (observed_after(pass)) {
+        break;
+      }
+    }
+    return count;
+  };
+
+  // Runs the method passes [begin, end) as one walk. Everything that happens
+  // per pass, but for the walk itself, happens for each pass in turn.
+  auto run_fused_method_passes = [&](size_t begin, size_t end) {
+    std::vector<AnalysisUsageHelper> analysis_usage_helpers;
+    analysis_usage_helpers.reserve(end - begin);
+    std::vector<std::unique_ptr<MethodPass::Run>> method_pass_runs;
+    std::string names;
+    ScopedMemStats mem_stats{hwm_pass_stats, hwm_per_pass};
+    ScopedCpuStats cpu_stats;
+    const auto hot_counters_before = hot_counters::snapshot();
+    for (size_t i = begin; i < end; ++i) {
+      auto* pass = static_cast<MethodPass*>(m_activated_passes[i]);
+      const size_t pass_run = ++runs[pass];
+      analysis_usage_helpers.emplace_back(m_preserved_analysis_passes);
+      analysis_usage_helpers.back().pre_pass(pass);
+
+      TRACE(PM, 1, "Preparing %s...", pass->name().c_str());
+      Timer t(pass->name() + " " + std::to_string(pass_run) + " (prepare)");
+      m_current_pass_info = &m_pass_info[i];
+      pre_pass_verifiers(pass, i);
+      method_pass_runs.push_back(pass->prepare(stores, conf, *this));
+      names += (names.empty() ? "" : "+") + pass->name();
+    }
+    m_current_pass_info = nullptr;
+
+    // The CFG of a method stays built across consecutive runs that use it.
+    // Each reuse saves the building and clearing that the run would otherwise
+    // have done itself.
+    AccumulatingTimer cfg_timer;
+    std::atomic<size_t> cfg_builds{0};
+    std::vector<std::atomic<size_t>> cfg_reuses(end - begin);
+    {
+      TRACE(PM, 1, "Running %s...", names.c_str());
+      Timer t(names + " (fused run)");
+      walk::parallel::code(
+          build_class_scope(stores), [&](DexMethod* method, IRCode&) {
+            for (size_t k = 0; k < method_pass_runs.size(); ++k) {
+              auto& run = method_pass_runs[k];
+              // Passes may replace the code.
+              auto* code = method->get_code();
+              if (run->uses_editable_cfg()) {
+                if (code->editable_cfg_built()) {
+                  ++cfg_reuses[k];
+                } else {
+                  auto scope = cfg_timer.scope();
+                  code->build_cfg(/* editable */ true);
+                  ++cfg_builds;
+                }
+              } else if (code->editable_cfg_built()) {
+                auto scope = cfg_timer.scope();
+                code->clear_cfg();
+              }
+              run->run_on_method(method, *code);
+            }
+            auto* code = method->get_code();
+            if (code->editable_cfg_built() && !keep_cfgs_after(end - 1)) {
+              auto scope = cfg_timer.scope();
+              code->clear_cfg();
+            }
+          });
+    }
+    Timer::add_timer(names + " (fused CFG build and clear)",
+                     cfg_timer.get_seconds());
+    // Estimate the time saved by the average cost of a CFG in this walk.
+    const double us_per_cfg =
+        cfg_builds == 0
+            ? 0
+            : static_cast<double>(cfg_timer.get_microseconds()) / cfg_builds;
+    size_t total_reuses = 0;
+    for (auto& reuses : cfg_reuses) {
+      total_reuses += reuses;
+    }
+    TRACE(PM, 1, "%s built %zu CFGs and reused %zu, saving about %.3fs",
+          names.c_str(), cfg_builds.load(), total_reuses,
+          us_per_cfg * total_reuses / 1000000);
+
+    // The passes share the walk, so they all get the stats of the whole run.
+    auto pass_cpu_stats = cpu_stats.get();
+    cpu_summary.emplace_back(names + " (fused)", pass_cpu_stats);
+
+    for (size_t i = begin; i < end; ++i) {
+      Pass* pass = m_activated_passes[i];
+      m_current_pass_info = &m_pass_info[i];
+      method_pass_runs[i - begin]->finish(*this);
+      if (i == end - 1) {
+        keep_or_linearize_cfgs(i);
+      }
+      if (cfg_reuses[i - begin] > 0) {
+        incr_metric("fused_cfg_reused", cfg_reuses[i - begin]);
+        incr_metric("fused_cfg_saved_us",
+                    static_cast<int64_t>(us_per_cfg * cfg_reuses[i - begin]));
+      }
+      mem_stats.trace_log(this, pass);
+      pass_cpu_stats.set_metrics(this);
+      hot_counters::report_since(
+          hot_counters_before,
+          [this](const std::string& key, int64_t value) {
+            set_metric(key, value);
+          });
+      graph_visualizer.add_pass(pass, i);
+      analysis_usage_helpers[i - begin].invalidate_method_analyses(
+          m_code_hashes.get());
+      post_pass_verifiers(pass, i, m_activated_passes.size());
+      analysis_usage_helpers[i - begin].post_pass(pass);
+      process_method_profiles(*this, conf);
+      m_current_pass_info = nullptr;
+    }
+  };
+
   /////////////////////
   // MAIN PASS LOOP. //
   /////////////////////
   for (size_t i = 0; i < m_activated_passes.size(); ++i) {
+    size_t fused = fusable_method_passes(i);
+    if (fused > 1) {
+      run_fused_method_passes(i, i + fused);
+      i += fused - 1;
+      continue;
+    }
+
     Pass* pass = m_activated_passes[i];
     const size_t pass_run = ++runs[pass];
     AnalysisUsageHelper analysis_usage_helper{m_preserved_analysis_passes};
     analysis_usage_helper.pre_pass(pass);
 
     TRACE(PM, 1, "Running %s...", pass->name().c_str());
-    ScopedVmHWM vm_hwm{hwm_pass_stats, hwm_per_pass};
+    ScopedMemStats mem_stats{hwm_pass_stats, hwm_per_pass};
+    ScopedCpuStats cpu_stats;
+    const auto hot_counters_before = hot_counters::snapshot();
     Timer t(pass->name() + " " + std::to_string(pass_run) + " (run)");
     m_current_pass_info = &m_pass_info[i];
 
     pre_pass_verifiers(pass, i);
+    build_kept_cfgs(i);
 
     {
       auto scoped_command_prof = profiler_info_pass == pass
@@ -1241,20 +1748,41 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
       auto scoped_command_all_prof = ScopedCommandProfiling::maybe_from_info(
           profiler_all_info, &pass->name());
       jemalloc_util::ScopedProfiling malloc_prof(m_malloc_profile_pass == pass);
+      auto perf_scope =
+          perf_counted_passes.count(pass)
+              ? std::make_unique<perf_counters::ScopedPerfCounters>()
+              : nullptr;
       pass->run_pass(stores, conf, *this);
+      if (perf_scope) {
+        set_perf_metrics(this, *perf_scope);
+      }
       trace_cls.dump(pass->name());
     }
+    keep_or_linearize_cfgs(i);
 
-    vm_hwm.trace_log(this, pass);
+    mem_stats.trace_log(this, pass);
+    {
+      auto pass_cpu_stats = cpu_stats.get();
+      pass_cpu_stats.set_metrics(this);
+      cpu_summary.emplace_back(pass->name() + " " + std::to_string(pass_run),
+                               pass_cpu_stats);
+    }
+    hot_counters::report_since(hot_counters_before,
+                               [this](const std::string& key, int64_t value) {
+                                 set_metric(key, value);
+                               });
 
     sanitizers::lsan_do_recoverable_leak_check();
 
     graph_visualizer.add_pass(pass, i);
 
+    analysis_usage_helper.invalidate_method_analyses(m_code_hashes.get());
     post_pass_verifiers(pass, i, m_activated_passes.size());
 
     analysis_usage_helper.post_pass(pass);
 
+    heap_profile_dumps.dump_after(pass, i);
+
     process_method_profiles(*this, conf);
 
     if (after_pass_size.handle(m_current_pass_info, &stores, &conf)) {
@@ -1265,6 +1793,11 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
     m_current_pass_info = nullptr;
   }
 
+  if (keep_editable_cfg) {
+    TRACE(PM, 1, "Keeping editable CFGs avoided %zu linearizations",
+          total_linearizations_avoided);
+  }
+
   after_pass_size.wait();
 
   // Always run the type checker before generating the optimized dex code.
@@ -1284,6 +1817,8 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
 
   sanitizers::lsan_do_recoverable_leak_check();
 
+  trace_cpu_summary(cpu_summary);
+
   Timer::add_timer("PassManager.Hashers", m_hashers_timer.get_seconds());
   Timer::add_timer("PassManager.CheckUniqueDeobfuscateds",
                    m_check_unique_deobfuscateds_timer.get_seconds());
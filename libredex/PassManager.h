@@ -32,6 +32,10 @@ namespace Json {
 class Value;
 } // namespace Json
 
+namespace reachability {
+struct InstantiationFacts;
+} // namespace reachability
+
 // Must match DexStore.
 using DexStoresVector = std::vector<DexStore>;
 
@@ -107,6 +111,22 @@ class PassManager {
   }
   bool unreliable_virtual_scopes() const { return m_unreliable_virtual_scopes; }
 
+  // Hands what the reachability analysis of the current pass gathered about
+  // the code to the next pass. Any pass after that may have changed the code.
+  void set_instantiation_facts(
+      std::shared_ptr<const reachability::InstantiationFacts> facts) {
+    m_instantiation_facts = std::move(facts);
+    m_instantiation_facts_order = m_current_pass_info->order;
+  }
+  const reachability::InstantiationFacts* instantiation_facts_of_previous_pass()
+      const {
+    if (m_instantiation_facts == nullptr ||
+        m_instantiation_facts_order + 1 != m_current_pass_info->order) {
+      return nullptr;
+    }
+    return m_instantiation_facts.get();
+  }
+
   template <typename PassType>
   PassType* get_preserved_analysis() const {
     auto pass =
@@ -148,10 +168,16 @@ class PassManager {
   bool m_init_class_lowering_has_run{false};
   bool m_interdex_has_run{false};
   bool m_unreliable_virtual_scopes{false};
+  std::shared_ptr<const reachability::InstantiationFacts>
+      m_instantiation_facts;
+  size_t m_instantiation_facts_order{0};
 
   Pass* m_malloc_profile_pass{nullptr};
 
   boost::optional<hashing::DexHash> m_initial_hash;
+  // With "hasher.incremental", the hashes of the code that did not change
+  // since the last hasher run.
+  std::unique_ptr<hashing::CodeHashCache> m_code_hashes;
   AccumulatingTimer m_hashers_timer;
   AccumulatingTimer m_check_unique_deobfuscateds_timer;
 
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PassPerfRecord.h"
+
+#include <cinttypes>
+#include <map>
+#include <utility>
+
+#include "Debug.h"
+#include "Pass.h"
+
+namespace pass_perf {
+
+const std::vector<Field>& fields() {
+  static const std::vector<Field> fields{
+      {"wall_time_ms", "wall_time_ms", 100},
+      {"cpu_time_ms", "cpu_time_ms", 100},
+      {"vm_hwm_delta", "vm_hwm_delta", 64 << 20},
+      {"workqueue_busy_ms", "workqueue_busy_ms", 100},
+      {"workqueue_idle_ms", "workqueue_idle_ms", 100},
+      {"changed_methods", "~result~changed~methods~", -1},
+  };
+  return fields;
+}
+
+Json::Value to_json(const std::vector<PassManager::PassInfo>& pass_info) {
+  Json::Value passes(Json::ValueType::arrayValue);
+  for (const auto& info : pass_info) {
+    Json::Value entry(Json::ValueType::objectValue);
+    entry["pass"] = info.pass->name();
+    entry["order"] = (Json::UInt64)info.order;
+    entry["repeat"] = (Json::UInt64)info.repeat;
+    entry["total_repeat"] = (Json::UInt64)info.total_repeat;
+    for (const auto& field : fields()) {
+      auto it = info.metrics.find(field.metric);
+      entry[field.name] = it == info.metrics.end()
+                              ? Json::Value()
+                              : Json::Value((Json::Int64)it->second);
+    }
+    passes.append(entry);
+  }
+  Json::Value record(Json::ValueType::objectValue);
+  record["schema_version"] = (Json::Int64)SCHEMA_VERSION;
+  record["passes"] = passes;
+  return record;
+}
+
+namespace {
+
+void check_schema_version(const Json::Value& record) {
+  const auto& version = record["schema_version"];
+  always_assert_log(version.isIntegral() && version.asInt64() == SCHEMA_VERSION,
+                    "Expected a pass performance record of schema version "
+                    "%" PRId64,
+                    SCHEMA_VERSION);
+}
+
+std::string run_name(const Json::Value& entry) {
+  return entry["pass"].asString() + "#" +
+         std::to_string(entry["repeat"].asUInt64() + 1);
+}
+
+} // namespace
+
+std::vector<Regression> find_regressions(const Json::Value& before,
+                                         const Json::Value& after,
+                                         double threshold) {
+  check_schema_version(before);
+  check_schema_version(after);
+  std::map<std::string, const Json::Value*> before_runs;
+  for (const auto& entry : before["passes"]) {
+    before_runs.emplace(run_name(entry), &entry);
+  }
+
+  std::vector<Regression> regressions;
+  for (const auto& entry : after["passes"]) {
+    auto name = run_name(entry);
+    auto it = before_runs.find(name);
+    if (it == before_runs.end()) {
+      continue;
+    }
+    const auto& before_entry = *it->second;
+    for (const auto& field : fields()) {
+      const auto& before_value = before_entry[field.name];
+      const auto& after_value = entry[field.name];
+      if (field.noise_floor < 0 || !before_value.isIntegral() ||
+          !after_value.isIntegral()) {
+        continue;
+      }
+      auto b = before_value.asInt64();
+      auto a = after_value.asInt64();
+      if (a - b > field.noise_floor && a - b > threshold * b) {
+        regressions.push_back(Regression{name, field.name, b, a});
+      }
+    }
+  }
+  return regressions;
+}
+
+} // namespace pass_perf
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <json/json.h>
+#include <string>
+#include <vector>
+
+#include "PassManager.h"
+
+/*
+ * A per-pass performance record for the "pass_perf" section of the stats,
+ * meant to be compared across builds (see `redex-tool diff-pass-perf`):
+ *
+ *   {
+ *     "schema_version": 1,
+ *     "passes": [
+ *       {"pass": "RemoveUnreachablePass", "order": 3, "repeat": 0,
+ *        "total_repeat": 2, "wall_time_ms": 1234, "cpu_time_ms": 5678, ...},
+ *       ...
+ *     ]
+ *   }
+ *
+ * There is one entry per run of a pass, in pipeline order. Every entry has all
+ * the fields of the schema; a value that was not measured is null, e.g. the
+ * peak memory delta without "hwm_pass_stats". Fused passes each report the
+ * times of the whole fused run. Bump the schema version when the meaning of a
+ * field changes; adding fields does not need a new version.
+ */
+
+namespace pass_perf {
+
+constexpr int64_t SCHEMA_VERSION = 1;
+
+// A measured value of the records, and the pass metric that it comes from.
+struct Field {
+  const char* name;
+  const char* metric;
+  // Growth up to this much is noise, and never a regression. Fields with a
+  // negative floor are not costs, and are never flagged.
+  int64_t noise_floor;
+};
+
+const std::vector<Field>& fields();
+
+Json::Value to_json(const std::vector<PassManager::PassInfo>& pass_info);
+
+struct Regression {
+  std::string pass; // The pass name with the 1-based run, e.g. "Foo#2".
+  std::string field;
+  int64_t before;
+  int64_t after;
+};
+
+/*
+ * The fields of the passes in `after` that grew by more than `threshold` (a
+ * fraction) over their value in `before`, and by more than the noise floor of
+ * the field. The runs of passes are matched by name and repetition. Throws if
+ * either record has another schema version.
+ */
+std::vector<Regression> find_regressions(const Json::Value& before,
+                                         const Json::Value& after,
+                                         double threshold);
+
+} // namespace pass_perf
@@ -11,6 +11,7 @@
 #include <ostream>
 
 #include "DexUtil.h"
+#include "ParallelPrint.h"
 #include "ProguardConfiguration.h"
 #include "ProguardMap.h"
 #include "ProguardReporting.h"
@@ -83,7 +84,7 @@ void keep_rules::print_seeds(std::ostream& output,
                              const Scope& classes,
                              const bool allowshrinking_filter,
                              const bool allowobfuscation_filter) {
-  for (const auto& cls : classes) {
+  auto print_class = [&](std::ostream& out, const DexClass* cls) {
     const auto& deob = [&]() {
       const auto& s = cls->get_deobfuscated_name_or_empty();
       if (!s.empty()) {
@@ -96,31 +97,32 @@ void keep_rules::print_seeds(std::ostream& output,
     std::string name = java_names::internal_to_external(deob);
     if (impl::KeepState::has_keep(cls)) {
       show_class(
-          output, cls, name, allowshrinking_filter, allowobfuscation_filter);
+          out, cls, name, allowshrinking_filter, allowobfuscation_filter);
     }
-    print_field_seeds(output,
+    print_field_seeds(out,
                       pg_map,
                       name,
                       cls->get_ifields(),
                       allowshrinking_filter,
                       allowobfuscation_filter);
-    print_field_seeds(output,
+    print_field_seeds(out,
                       pg_map,
                       name,
                       cls->get_sfields(),
                       allowshrinking_filter,
                       allowobfuscation_filter);
-    print_method_seeds(output,
+    print_method_seeds(out,
                        pg_map,
                        name,
                        cls->get_dmethods(),
                        allowshrinking_filter,
                        allowobfuscation_filter);
-    print_method_seeds(output,
+    print_method_seeds(out,
                        pg_map,
                        name,
                        cls->get_vmethods(),
                        allowshrinking_filter,
                        allowobfuscation_filter);
-  }
+  };
+  redex::print_in_parallel(output, classes, print_class);
 }
@@ -21,6 +21,7 @@
 
 #include "Debug.h"
 #include "SpartaWorkQueue.h" // For `default_num_threads`.
+#include "Timeline.h"
 #include "WorkQueue.h" // For redex_queue_exception_handler.
 
 /*
@@ -43,6 +44,13 @@ class PriorityThreadPool {
   size_t m_running_work_items{0};
   std::chrono::duration<double> m_waited_time{0};
   bool m_shutdown{false};
+  // Thread-seconds spent running work items, per slice of time since the
+  // first work item was posted.
+  static constexpr std::chrono::milliseconds kUtilizationSlice{10};
+  std::vector<double> m_busy_slices;
+  std::chrono::steady_clock::time_point m_start;
+  std::chrono::steady_clock::time_point m_last_change;
+  bool m_started{false};
 
  public:
   // Creates an instance with a default number of threads
@@ -68,6 +76,32 @@ class PriorityThreadPool {
         .count();
   }
 
+  // The average fraction of the threads that were running work items, for
+  // each of `num_periods` equally long periods between the first work item
+  // being posted and the last one finishing.
+  std::vector<double> get_utilization(size_t num_periods) {
+    std::unique_lock<std::mutex> lock{m_mutex};
+    std::vector<double> utilization(num_periods);
+    auto num_slices = m_busy_slices.size();
+    if (num_slices == 0 || m_pool.empty()) {
+      return utilization;
+    }
+    for (size_t i = 0; i < num_periods; ++i) {
+      auto begin = i * num_slices / num_periods;
+      auto end = (i + 1) * num_slices / num_periods;
+      if (begin == end) {
+        continue;
+      }
+      double busy = 0;
+      for (auto j = begin; j < end; ++j) {
+        busy += m_busy_slices[j];
+      }
+      std::chrono::duration<double> slice = kUtilizationSlice;
+      utilization[i] = busy / ((end - begin) * slice.count() * m_pool.size());
+    }
+    return utilization;
+  }
+
   // The number of threads may be set at most once to a positive number
   void set_num_threads(int num_threads) {
     always_assert(m_pool.empty());
@@ -90,6 +124,10 @@ class PriorityThreadPool {
     always_assert(!m_pool.empty());
     std::unique_lock<std::mutex> lock{m_mutex};
     always_assert(!m_shutdown);
+    if (!m_started) {
+      m_started = true;
+      m_start = m_last_change = std::chrono::steady_clock::now();
+    }
     m_pending_work_items[priority].push(f);
     m_work_condition.notify_one();
   }
@@ -128,6 +166,30 @@ class PriorityThreadPool {
   }
 
  private:
+  // Accounts the time since the last change of the number of running work
+  // items. Must be called with the mutex held, before changing it.
+  void record_busy_time() {
+    auto now = std::chrono::steady_clock::now();
+    if (m_running_work_items > 0) {
+      auto slice = std::chrono::duration_cast<
+          std::chrono::steady_clock::duration>(kUtilizationSlice);
+      auto from = m_last_change - m_start;
+      auto to = now - m_start;
+      while (from < to) {
+        size_t index = from / slice;
+        auto until = std::min<std::chrono::steady_clock::duration>(
+            to, slice * (index + 1));
+        if (m_busy_slices.size() <= index) {
+          m_busy_slices.resize(index + 1);
+        }
+        std::chrono::duration<double> busy = until - from;
+        m_busy_slices[index] += m_running_work_items * busy.count();
+        from = until;
+      }
+    }
+    m_last_change = now;
+  }
+
   void run() {
     for (;;) {
       auto highest_priority_f =
@@ -151,6 +213,7 @@ class PriorityThreadPool {
           auto highest_priority = p.first;
           m_pending_work_items.erase(highest_priority);
         }
+        record_busy_time();
         m_running_work_items++;
         return f;
       }();
@@ -160,6 +223,7 @@ class PriorityThreadPool {
 
       // Run!
       try {
+        timeline::TaskScope task_scope("thread_pool");
         (*highest_priority_f)();
       } catch (std::exception& e) {
         redex_workqueue_impl::redex_queue_exception_handler(e);
@@ -169,6 +233,7 @@ class PriorityThreadPool {
       // Notify when *all* work is done, i.e. nothing is running or pending.
       {
         std::unique_lock<std::mutex> lock{m_mutex};
+        record_busy_time();
         if (--m_running_work_items == 0 && m_pending_work_items.empty()) {
           m_done_condition.notify_one();
         }
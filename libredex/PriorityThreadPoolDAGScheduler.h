@@ -15,6 +15,7 @@
 template <class Task>
 class PriorityThreadPoolDAGScheduler {
   using Executor = std::function<void(Task)>;
+  using WeightFn = std::function<int(Task)>;
 
  private:
   PriorityThreadPool m_priority_thread_pool;
@@ -22,6 +23,8 @@ class PriorityThreadPoolDAGScheduler {
   std::unordered_map<Task, std::unordered_set<Task>> m_waiting_for;
   std::unordered_map<Task, uint32_t> m_wait_counts;
   std::unique_ptr<std::unordered_map<Task, int>> m_priorities;
+  std::unique_ptr<std::unordered_map<Task, int>> m_depths;
+  WeightFn m_weight_fn;
   int m_max_priority{-1};
   struct ConcurrentState {
     uint32_t wait_count{0};
@@ -29,7 +32,27 @@ class PriorityThreadPoolDAGScheduler {
   };
   std::unique_ptr<ConcurrentMap<Task, ConcurrentState>> m_concurrent_states;
 
-  int compute_priority(Task task) {
+  // The number of tasks on the longest chain of tasks waiting for this one.
+  int compute_depth(Task task) {
+    auto it = m_depths->find(task);
+    if (it != m_depths->end()) {
+      return it->second;
+    }
+    auto value = 0;
+    auto it2 = m_waiting_for.find(task);
+    if (it2 != m_waiting_for.end()) {
+      for (auto other_task : it2->second) {
+        value = std::max(value, compute_depth(other_task) + 1);
+      }
+    }
+    m_depths->emplace(task, value);
+    m_max_priority = std::max(m_max_priority, value);
+    return value;
+  }
+
+  // The weight of the heaviest chain of tasks starting with this one and
+  // continuing with the tasks waiting for it.
+  int compute_weighted_priority(Task task) {
     auto it = m_priorities->find(task);
     if (it != m_priorities->end()) {
       return it->second;
@@ -38,11 +61,11 @@ class PriorityThreadPoolDAGScheduler {
     auto it2 = m_waiting_for.find(task);
     if (it2 != m_waiting_for.end()) {
       for (auto other_task : it2->second) {
-        value = std::max(value, compute_priority(other_task) + 1);
+        value = std::max(value, compute_weighted_priority(other_task));
       }
     }
+    value += m_weight_fn(task);
     m_priorities->emplace(task, value);
-    m_max_priority = std::max(m_max_priority, value);
     return value;
   }
 
@@ -130,6 +153,12 @@ class PriorityThreadPoolDAGScheduler {
 
   PriorityThreadPool& get_thread_pool() { return m_priority_thread_pool; }
 
+  // By default, tasks are prioritized by the length of the longest chain of
+  // tasks waiting for them. With a weight function, they are prioritized by
+  // the total weight of the heaviest such chain instead, i.e. by the estimated
+  // work on the critical path that they unblock. Weights must be positive.
+  void set_weight_fn(WeightFn weight_fn) { m_weight_fn = std::move(weight_fn); }
+
   // The dependency must be scheduled before the task
   void add_dependency(Task task, Task dependency) {
     always_assert(!m_concurrent_states);
@@ -160,14 +189,23 @@ class PriorityThreadPoolDAGScheduler {
   uint32_t run(const ForwardIt& begin, const ForwardIt& end) {
     always_assert(!m_concurrent_states);
     m_priorities = std::make_unique<std::unordered_map<Task, int>>();
+    m_depths = std::make_unique<std::unordered_map<Task, int>>();
     for (auto it = begin; it != end; it++) {
-      compute_priority(*it);
+      compute_depth(*it);
     }
-    for (auto& p : *m_priorities) {
-      auto it = m_wait_counts.find(p.first);
-      p.second =
-          (p.second << 16) + (it == m_wait_counts.end() ? 0 : it->second);
+    if (m_weight_fn) {
+      for (auto it = begin; it != end; it++) {
+        compute_weighted_priority(*it);
+      }
+    } else {
+      for (auto& p : *m_depths) {
+        auto it = m_wait_counts.find(p.first);
+        m_priorities->emplace(
+            p.first,
+            (p.second << 16) + (it == m_wait_counts.end() ? 0 : it->second));
+      }
     }
+    m_depths = nullptr;
 
     m_concurrent_states =
         std::make_unique<ConcurrentMap<Task, ConcurrentState>>();
@@ -8,6 +8,7 @@
 #include "ProguardConfiguration.h"
 
 #include <algorithm>
+#include <unordered_map>
 #include <boost/functional/hash.hpp>
 
 #include "StlUtil.h"
@@ -90,4 +91,18 @@ void KeepSpecSet::erase_if(const std::function<bool(const KeepSpec&)>& pred) {
       m_ordered.end());
 }
 
+void KeepSpecSet::append(KeepSpecSet&& that) {
+  std::unordered_map<const KeepSpec*, std::unique_ptr<KeepSpec>> owned;
+  owned.reserve(that.m_unordered_set.size());
+  while (!that.m_unordered_set.empty()) {
+    auto node = that.m_unordered_set.extract(that.m_unordered_set.begin());
+    const KeepSpec* spec = node.value().get();
+    owned.emplace(spec, std::move(node.value()));
+  }
+  for (const auto* spec : that.m_ordered) {
+    emplace(std::move(owned.at(spec)));
+  }
+  that.m_ordered.clear();
+}
+
 } // namespace keep_rules
@@ -123,6 +123,10 @@ class KeepSpecSet {
 
   void erase_if(const std::function<bool(const KeepSpec&)>&);
 
+  // Moves the specs of `that` to the end, in their order, as emplacing them
+  // one by one would.
+  void append(KeepSpecSet&& that);
+
  private:
   std::vector<KeepSpec*> m_ordered;
   std::unordered_set<std::unique_ptr<KeepSpec>,
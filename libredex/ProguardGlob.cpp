@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ProguardGlob.h"
+
+#include <algorithm>
+
+namespace keep_rules {
+namespace proguard_parser {
+
+namespace {
+
+// Wildcards and parts of the regex syntax that form_type_regex passes
+// through, and that the trie cannot represent.
+bool is_unsupported(char ch) {
+  switch (ch) {
+  case '%':
+  case '.':
+  case '|':
+  case '+':
+  case '(':
+  case ')':
+  case '{':
+  case '}':
+  case ']':
+  case '^':
+  case '\\':
+  case '!':
+  case ',':
+    return true;
+  default:
+    return false;
+  }
+}
+
+// The characters that ? and * match.
+bool is_in_class_name(char ch) { return ch != '/' && ch != '['; }
+
+} // namespace
+
+GlobSet::GlobSet() : m_nodes(1) {}
+
+uint32_t GlobSet::get_or_add_child(uint32_t node,
+                                   uint32_t Node::*child,
+                                   Loop loop) {
+  if (m_nodes[node].*child == NONE) {
+    m_nodes[node].*child = m_nodes.size();
+    m_nodes.emplace_back().loop = loop;
+  }
+  return m_nodes[node].*child;
+}
+
+bool GlobSet::add(const std::string& pattern, uint32_t id) {
+  if (pattern.empty()) {
+    return false;
+  }
+  // Mirrors the special case in form_type_regex.
+  const std::string& glob = pattern == "L*;" ? "L**;" : pattern;
+  for (size_t i = 0; i < glob.size(); ++i) {
+    if (is_unsupported(glob[i]) || glob.compare(i, 3, "***") == 0) {
+      return false;
+    }
+  }
+
+  uint32_t node = 0;
+  for (size_t i = 0; i < glob.size(); ++i) {
+    const char ch = glob[i];
+    if (ch == '?') {
+      node = get_or_add_child(node, &Node::any, Loop::NONE);
+    } else if (ch == '*' && i + 1 < glob.size() && glob[i + 1] == '*') {
+      node = get_or_add_child(node, &Node::double_star, Loop::DOUBLE_STAR);
+      ++i;
+    } else if (ch == '*') {
+      node = get_or_add_child(node, &Node::star, Loop::STAR);
+    } else {
+      auto it = m_nodes[node].chars.find(ch);
+      if (it != m_nodes[node].chars.end()) {
+        node = it->second;
+      } else {
+        uint32_t child = m_nodes.size();
+        m_nodes[node].chars.emplace(ch, child);
+        m_nodes.emplace_back();
+        node = child;
+      }
+    }
+  }
+  m_nodes[node].ids.push_back(id);
+  ++m_size;
+  return true;
+}
+
+// Adds `node`, and the nodes after the wildcards that follow it, which may
+// match nothing.
+void GlobSet::add_closure(uint32_t node, std::vector<uint32_t>* states) const {
+  states->push_back(node);
+  const auto& n = m_nodes[node];
+  if (n.star != NONE) {
+    add_closure(n.star, states);
+  }
+  if (n.double_star != NONE) {
+    add_closure(n.double_star, states);
+  }
+}
+
+void GlobSet::match(std::string_view name, std::vector<uint32_t>* ids) const {
+  std::vector<uint32_t> states;
+  std::vector<uint32_t> next_states;
+  add_closure(0, &states);
+  for (const char ch : name) {
+    next_states.clear();
+    for (auto state : states) {
+      const auto& n = m_nodes[state];
+      if ((n.loop == Loop::STAR && is_in_class_name(ch)) ||
+          (n.loop == Loop::DOUBLE_STAR && ch != '[')) {
+        next_states.push_back(state);
+      }
+      auto it = n.chars.find(ch);
+      if (it != n.chars.end()) {
+        add_closure(it->second, &next_states);
+      }
+      if (n.any != NONE && is_in_class_name(ch)) {
+        add_closure(n.any, &next_states);
+      }
+    }
+    if (next_states.empty()) {
+      return;
+    }
+    // Different paths may reach the same states.
+    std::sort(next_states.begin(), next_states.end());
+    next_states.erase(std::unique(next_states.begin(), next_states.end()),
+                      next_states.end());
+    std::swap(states, next_states);
+  }
+  for (auto state : states) {
+    const auto& n = m_nodes[state];
+    ids->insert(ids->end(), n.ids.begin(), n.ids.end());
+  }
+}
+
+} // namespace proguard_parser
+} // namespace keep_rules
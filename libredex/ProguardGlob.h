@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace keep_rules {
+namespace proguard_parser {
+
+/*
+ * Matches a name against many ProGuard type patterns at once.
+ *
+ * The patterns share a trie, where the ? and * wildcards are edges like the
+ * characters, and a * can also loop over the characters it matches. Matching
+ * a name walks all its trie paths in a single pass over the name, so that the
+ * cost depends on how many patterns share its prefix, not on the total number
+ * of patterns.
+ *
+ * A match has the same result as a boost::regex_match against the
+ * form_type_regex of the pattern. Patterns that use any other syntax, such as
+ * %, *** or negation, are rejected by `add`, and must be matched as regexes.
+ */
+class GlobSet {
+ public:
+  GlobSet();
+
+  // Adds `pattern`, an internal type descriptor with wildcards as returned by
+  // convert_wildcard_type. Returns false, without adding it, if the pattern
+  // is not supported.
+  bool add(const std::string& pattern, uint32_t id);
+
+  // Appends the ids of all patterns that match the whole of `name`, in no
+  // particular order.
+  void match(std::string_view name, std::vector<uint32_t>* ids) const;
+
+  size_t size() const { return m_size; }
+
+ private:
+  enum class Loop : uint8_t {
+    NONE,
+    // A *, which matches any characters but the package separator and the
+    // array prefix.
+    STAR,
+    // A **, which matches any characters but the array prefix.
+    DOUBLE_STAR,
+  };
+
+  static constexpr uint32_t NONE = 0xFFFFFFFF;
+
+  struct Node {
+    Loop loop{Loop::NONE};
+    std::unordered_map<char, uint32_t> chars;
+    uint32_t any{NONE};
+    uint32_t star{NONE};
+    uint32_t double_star{NONE};
+    // The ids of the patterns that end here.
+    std::vector<uint32_t> ids;
+  };
+
+  uint32_t get_or_add_child(uint32_t node, uint32_t Node::*child, Loop loop);
+  void add_closure(uint32_t node, std::vector<uint32_t>* states) const;
+
+  std::vector<Node> m_nodes;
+  size_t m_size{0};
+};
+
+} // namespace proguard_parser
+} // namespace keep_rules
@@ -7,9 +7,14 @@
 
 #include "ProguardMap.h"
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
 #include "DexPosition.h"
 #include "DexUtil.h"
 #include "IRCode.h"
+#include "ReadMaybeMapped.h"
 #include "Show.h"
 #include "Timer.h"
 #include "Trace.h"
@@ -17,12 +22,36 @@
 
 namespace {
 
-std::string find_or_same(
-    const std::string& key,
-    const std::unordered_map<std::string, std::string>& map) {
-  auto it = map.find(key);
-  if (it == map.end()) return key;
-  return it->second;
+// Classes are parsed in batches of about this many lines.
+constexpr size_t kLinesPerBatch = 16 * 1024;
+
+template <typename Table>
+std::string find_or_same(const std::string& key, const Table& table) {
+  auto* value = table.find(key);
+  if (value == nullptr) return key;
+  return std::string(*value);
+}
+
+// Like getline, the last line has no terminating newline, and there is no
+// empty line after the last newline.
+std::vector<std::string_view> split_lines(std::string_view contents) {
+  std::vector<std::string_view> lines;
+  size_t pos = 0;
+  while (pos < contents.size()) {
+    auto end = contents.find('\n', pos);
+    if (end == std::string_view::npos) {
+      end = contents.size();
+    }
+    lines.push_back(contents.substr(pos, end - pos));
+    pos = end + 1;
+  }
+  return lines;
+}
+
+std::string_view method_lines_key(std::string_view method_name) {
+  std::size_t end = method_name.rfind(':');
+  always_assert(end != std::string::npos);
+  return method_name.substr(0, end);
 }
 
 std::string convert_scalar_type(const std::string& type) {
@@ -192,6 +221,20 @@ bool method_full_format(const char*& p, std::string& s) {
   return true;
 }
 
+bool parse_class(const std::string& line,
+                 std::string* cls,
+                 std::string* new_cls) {
+  std::string classname;
+  std::string newname;
+  auto p = line.c_str();
+  if (!id(p, classname)) return false;
+  if (!literal(p, " -> ")) return false;
+  if (!id(p, newname)) return false;
+  *cls = convert_type(classname);
+  *new_cls = convert_type(newname);
+  return true;
+}
+
 bool comment(const std::string& line) {
   auto p = line.c_str();
   whitespace(p);
@@ -226,19 +269,105 @@ bool is_maybe_proguard_generated_member(const std::string& s) {
 }
 } // namespace
 
+struct ProguardMap::Members {
+  struct Field {
+    std::string_view pgold;
+    std::string_view pgnew;
+    std::string_view pgnew_notype;
+  };
+
+  struct Method {
+    std::string_view pgold;
+    std::string_view pgnew;
+    std::string_view pgnew_no_rtype;
+    std::unique_ptr<ProguardLineRange> lines;
+  };
+
+  // The classes in the batch, as indices into the classes of the map in the
+  // order of their lines.
+  size_t first_class;
+  size_t last_class;
+  StringStore strings;
+  std::vector<Field> fields;
+  std::vector<Method> methods;
+  // Types that are touched by Proguard, with the field that shows it.
+  std::vector<std::pair<std::string_view, std::string_view>>
+      coalesced_interfaces;
+};
+
+std::string_view ProguardMap::StringStore::store(std::string_view s) {
+  if (s.empty()) {
+    return {};
+  }
+  if (s.size() > m_left) {
+    constexpr size_t kBlockSize = 16 * 1024;
+    size_t size = std::max(s.size(), kBlockSize);
+    m_blocks.emplace_back(new char[size]);
+    m_cur = m_blocks.back().get();
+    m_left = size;
+  }
+  memcpy(m_cur, s.data(), s.size());
+  std::string_view stored(m_cur, s.size());
+  m_cur += s.size();
+  m_left -= s.size();
+  return stored;
+}
+
+void ProguardMap::StringStore::splice(StringStore&& other) {
+  m_blocks.insert(m_blocks.end(),
+                  std::make_move_iterator(other.m_blocks.begin()),
+                  std::make_move_iterator(other.m_blocks.end()));
+  other.m_blocks.clear();
+  other.m_cur = nullptr;
+  other.m_left = 0;
+}
+
+void ProguardMap::NameTable::finalize() {
+  std::stable_sort(
+      m_entries.begin(), m_entries.end(),
+      [](const auto& a, const auto& b) { return a.first < b.first; });
+  auto out = m_entries.begin();
+  for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+    auto next = std::next(it);
+    if (next != m_entries.end() && next->first == it->first) {
+      continue;
+    }
+    *out++ = *it;
+  }
+  m_entries.erase(out, m_entries.end());
+  m_entries.shrink_to_fit();
+}
+
+const std::string_view* ProguardMap::NameTable::find(
+    std::string_view key) const {
+  auto it = std::lower_bound(
+      m_entries.begin(), m_entries.end(), key,
+      [](const auto& entry, std::string_view k) { return entry.first < k; });
+  if (it == m_entries.end() || it->first != key) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
 ProguardMap::ProguardMap(const std::string& filename, bool use_new_rename_map) {
   if (filename.empty()) {
     return;
   }
   Timer t("Parsing proguard map");
-  std::ifstream fp(filename);
-  always_assert_log(fp, "Can't open proguard map: %s\n", filename.c_str());
+  redex::read_file_with_contents(filename, [&](const char* data, size_t size) {
+    std::string_view contents(data, size);
+    if (use_new_rename_map) {
+      parse_full_map(contents);
+    } else {
+      parse_proguard_map(contents);
+    }
+  });
+}
 
-  if (use_new_rename_map) {
-    parse_full_map(fp);
-  } else {
-    parse_proguard_map(fp);
-  }
+ProguardMap::ProguardMap(std::istream& is) {
+  std::string contents{std::istreambuf_iterator<char>(is),
+                       std::istreambuf_iterator<char>()};
+  parse_proguard_map(contents);
 }
 
 std::string ProguardMap::translate_class(const std::string& cls) const {
@@ -270,7 +399,7 @@ std::vector<ProguardMap::Frame> ProguardMap::deobfuscate_frame(
     const DexString* method_name, uint32_t line) const {
   std::vector<Frame> frames;
   auto ranges_it =
-      m_obfMethodLinesMap.find(pg_impl::lines_key(method_name->str()));
+      m_obfMethodLinesMap.find(method_lines_key(method_name->str()));
   if (ranges_it != m_obfMethodLinesMap.end()) {
     for (const auto& range : ranges_it->second) {
       if (!range->matches(line)) {
@@ -295,41 +424,132 @@ std::vector<ProguardMap::Frame> ProguardMap::deobfuscate_frame(
 
 ProguardLineRangeVector& ProguardMap::method_lines(
     const std::string& obfuscated_method) {
-  return m_obfMethodLinesMap.at(pg_impl::lines_key(obfuscated_method));
+  return m_obfMethodLinesMap.at(method_lines_key(obfuscated_method));
 }
 
-void ProguardMap::parse_proguard_map(std::istream& fp) {
+void ProguardMap::parse_proguard_map(std::string_view contents) {
+  auto lines = split_lines(contents);
+
+  // Members refer to the new names of classes that may be declared after
+  // them, so all the class lines are parsed first. The members of different
+  // classes can then be parsed in parallel. Class 0 holds the members before
+  // the first class line, if any, which belong to no class.
+  std::vector<std::string> classes(1);
+  std::vector<std::string> new_classes(1);
+  // The members of class `c` are the lines in [begins[c], ends[c]).
+  std::vector<size_t> begins{0};
+  std::vector<size_t> ends;
   std::string line;
-  while (std::getline(fp, line)) {
-    parse_class(line);
-  }
-  fp.clear();
-  fp.seekg(0);
-  assert_log(!fp.fail(), "Can't use ProguardMap with non-seekable stream");
-  while (std::getline(fp, line)) {
-    if (parse_class(line)) {
-      continue;
-    }
-    if (parse_field(line)) {
-      continue;
-    }
-    if (parse_method(line)) {
+  std::string cls;
+  std::string new_cls;
+  for (size_t i = 0; i < lines.size(); ++i) {
+    line.assign(lines[i]);
+    if (!parse_class(line, &cls, &new_cls)) {
       continue;
     }
-    if (comment(line)) {
-      continue;
-    }
-    not_reached_log("Bogus line encountered in proguard map: %s\n",
-                    line.c_str());
+    ends.push_back(i);
+    begins.push_back(i + 1);
+    auto cls_view = m_strings.store(cls);
+    auto new_cls_view = m_strings.store(new_cls);
+    m_classMap.add(cls_view, new_cls_view);
+    m_obfClassMap.add(new_cls_view, cls_view);
+    classes.push_back(std::move(cls));
+    new_classes.push_back(std::move(new_cls));
+  }
+  ends.push_back(lines.size());
+  m_classMap.finalize();
+  m_obfClassMap.finalize();
+
+  std::vector<Members> batches;
+  for (size_t c = 0; c < begins.size();) {
+    auto& batch = batches.emplace_back();
+    batch.first_class = c;
+    size_t batch_lines = 0;
+    do {
+      batch_lines += ends[c] - begins[c] + 1;
+      ++c;
+    } while (c < begins.size() && batch_lines < kLinesPerBatch);
+    batch.last_class = c;
+  }
+  std::vector<Members*> work;
+  for (auto& batch : batches) {
+    work.push_back(&batch);
+  }
+  workqueue_run<Members*>(
+      [&](Members* members) {
+        std::string member_line;
+        for (size_t c = members->first_class; c < members->last_class; ++c) {
+          for (size_t i = begins[c]; i < ends[c]; ++i) {
+            member_line.assign(lines[i]);
+            if (parse_field(member_line, classes[c], new_classes[c],
+                            members)) {
+              continue;
+            }
+            if (parse_method(member_line, classes[c], new_classes[c],
+                             members)) {
+              continue;
+            }
+            if (comment(member_line)) {
+              continue;
+            }
+            not_reached_log("Bogus line encountered in proguard map: %s\n",
+                            member_line.c_str());
+          }
+        }
+      },
+      work);
+
+  // Merging in the order of the lines keeps the last of duplicate entries.
+  size_t num_fields = 0;
+  size_t num_methods = 0;
+  for (const auto& batch : batches) {
+    num_fields += batch.fields.size();
+    num_methods += batch.methods.size();
+  }
+  m_fieldMap.reserve(num_fields);
+  m_obfFieldMap.reserve(num_fields);
+  m_obfUntypedFieldMap.reserve(num_fields);
+  m_methodMap.reserve(num_methods);
+  m_obfMethodMap.reserve(num_methods);
+  m_obfUntypedMethodMap.reserve(num_methods);
+  for (auto& batch : batches) {
+    add_members(&batch);
+  }
+
+  std::vector<NameTable*> tables{&m_fieldMap,         &m_obfFieldMap,
+                                 &m_obfUntypedFieldMap, &m_methodMap,
+                                 &m_obfMethodMap,       &m_obfUntypedMethodMap};
+  workqueue_run<NameTable*>([](NameTable* table) { table->finalize(); },
+                            tables);
+}
+
+void ProguardMap::add_members(Members* members) {
+  for (const auto& [type, field] : members->coalesced_interfaces) {
+    fprintf(stderr,
+            "Type '%s' is touched by Proguard in '%s'\n",
+            std::string(type).c_str(),
+            std::string(field).c_str());
+    m_pg_coalesced_interfaces.insert(type);
+  }
+  for (const auto& field : members->fields) {
+    m_fieldMap.add(field.pgold, field.pgnew);
+    m_obfFieldMap.add(field.pgnew, field.pgold);
+    m_obfUntypedFieldMap.add(field.pgnew_notype, field.pgold);
+  }
+  for (auto& method : members->methods) {
+    m_methodMap.add(method.pgold, method.pgnew);
+    m_obfMethodMap.add(method.pgnew, method.pgold);
+    m_obfUntypedMethodMap.add(method.pgnew_no_rtype, method.pgold);
+    m_obfMethodLinesMap[method_lines_key(method.pgnew)].push_back(
+        std::move(method.lines));
   }
+  m_strings.splice(std::move(members->strings));
 }
 
-void ProguardMap::parse_full_map(std::istream& fp) {
+void ProguardMap::parse_full_map(std::string_view contents) {
   std::string line;
-  fp.seekg(0);
-  assert_log(!fp.fail(),
-             "Can't use the full rename map with non-seekable stream");
-  while (std::getline(fp, line)) {
+  for (auto line_view : split_lines(contents)) {
+    line.assign(line_view);
     if (parse_class_full_format(line)) {
       continue;
     }
@@ -345,6 +565,12 @@ void ProguardMap::parse_full_map(std::istream& fp) {
     not_reached_log("Bogus line encountered in the full map: %s\n",
                     line.c_str());
   }
+  std::vector<NameTable*> tables{&m_classMap,  &m_obfClassMap, &m_fieldMap,
+                                 &m_obfFieldMap, &m_methodMap,
+                                 &m_obfMethodMap};
+  for (auto* table : tables) {
+    table->finalize();
+  }
 }
 
 bool ProguardMap::parse_class_full_format(const std::string& line) {
@@ -356,10 +582,10 @@ bool ProguardMap::parse_class_full_format(const std::string& line) {
   if (!literal(p, " -> ")) return false;
   if (!id(p, new_class_name)) return false;
 
-  m_currClass = old_class_name;
-  m_currNewClass = new_class_name;
-  m_classMap[m_currClass] = m_currNewClass;
-  m_obfClassMap[m_currNewClass] = m_currClass;
+  auto pgold = m_strings.store(old_class_name);
+  auto pgnew = m_strings.store(new_class_name);
+  m_classMap.add(pgold, pgnew);
+  m_obfClassMap.add(pgnew, pgold);
   return true;
 }
 
@@ -386,11 +612,11 @@ bool ProguardMap::parse_field_full_format(const std::string& line) {
     return false;
   }
 
-  auto pgnew = new_field_name;
-  auto pgold = old_field_name;
+  auto pgnew = m_strings.store(new_field_name);
+  auto pgold = m_strings.store(old_field_name);
 
-  m_fieldMap[pgold] = pgnew;
-  m_obfFieldMap[pgnew] = pgold;
+  m_fieldMap.add(pgold, pgnew);
+  m_obfFieldMap.add(pgnew, pgold);
   return true;
 }
 
@@ -416,28 +642,17 @@ bool ProguardMap::parse_method_full_format(const std::string& line) {
     return false;
   }
 
-  auto pgold = old_method_name;
-  auto pgnew = new_method_name;
-  m_methodMap[pgold] = pgnew;
-  m_obfMethodMap[pgnew] = pgold;
+  auto pgold = m_strings.store(old_method_name);
+  auto pgnew = m_strings.store(new_method_name);
+  m_methodMap.add(pgold, pgnew);
+  m_obfMethodMap.add(pgnew, pgold);
   return true;
 }
 
-bool ProguardMap::parse_class(const std::string& line) {
-  std::string classname;
-  std::string newname;
-  auto p = line.c_str();
-  if (!id(p, classname)) return false;
-  if (!literal(p, " -> ")) return false;
-  if (!id(p, newname)) return false;
-  m_currClass = convert_type(classname);
-  m_currNewClass = convert_type(newname);
-  m_classMap[m_currClass] = m_currNewClass;
-  m_obfClassMap[m_currNewClass] = m_currClass;
-  return true;
-}
-
-bool ProguardMap::parse_field(const std::string& line) {
+bool ProguardMap::parse_field(const std::string& line,
+                              const std::string& cls,
+                              const std::string& new_cls,
+                              Members* members) const {
   std::string type;
   std::string fieldname;
   std::string newname;
@@ -452,27 +667,26 @@ bool ProguardMap::parse_field(const std::string& line) {
 
   auto ctype = convert_type(type);
   auto xtype = translate_type(ctype, *this);
-  auto pgnew = convert_field(m_currNewClass, xtype, newname);
-  auto pgnew_notype = convert_field(m_currNewClass, "", newname);
-  auto pgold = convert_field(m_currClass, ctype, fieldname);
+  auto& strings = members->strings;
+  auto pgnew = strings.store(convert_field(new_cls, xtype, newname));
+  auto pgold = strings.store(convert_field(cls, ctype, fieldname));
+  // The untyped name is a prefix of the typed one.
+  auto pgnew_notype = pgnew.substr(0, new_cls.size() + 1 + newname.size());
   // Record interfaces that are coalesced by Proguard.
   if (ctype[0] == 'L' && is_maybe_proguard_generated_member(fieldname)) {
-    fprintf(stderr,
-            "Type '%s' is touched by Proguard in '%s'\n",
-            ctype.c_str(),
-            pgold.c_str());
-    m_pg_coalesced_interfaces.insert(ctype);
+    members->coalesced_interfaces.emplace_back(strings.store(ctype), pgold);
   }
-  m_fieldMap[pgold] = pgnew;
-  m_obfFieldMap[pgnew] = pgold;
-  m_obfUntypedFieldMap[pgnew_notype] = pgold;
+  members->fields.push_back({pgold, pgnew, pgnew_notype});
   return true;
 }
 
-bool ProguardMap::parse_method(const std::string& line) {
+bool ProguardMap::parse_method(const std::string& line,
+                               const std::string& cls,
+                               const std::string& new_cls,
+                               Members* members) const {
   std::string type;
   std::string methodname;
-  std::string classname = m_currClass;
+  std::string classname = cls;
   std::string old_args;
   std::string new_args;
   std::string newname;
@@ -512,14 +726,16 @@ bool ProguardMap::parse_method(const std::string& line) {
 
   auto old_rtype = convert_type(type);
   auto new_rtype = translate_type(old_rtype, *this);
-  auto pgold = convert_method(classname, old_rtype, methodname, old_args);
-  auto pgnew = convert_method(m_currNewClass, new_rtype, newname, new_args);
-  auto pgnew_no_rtype = convert_method(m_currNewClass, "", newname, new_args);
-  m_methodMap[pgold] = pgnew;
-  m_obfMethodMap[pgnew] = pgold;
-  m_obfUntypedMethodMap[pgnew_no_rtype] = pgold;
-  lines->original_name = pgold;
-  m_obfMethodLinesMap[pg_impl::lines_key(pgnew)].push_back(std::move(lines));
+  auto& strings = members->strings;
+  auto pgold =
+      strings.store(convert_method(classname, old_rtype, methodname, old_args));
+  auto pgnew =
+      strings.store(convert_method(new_cls, new_rtype, newname, new_args));
+  // The name without the return type is a prefix of the full one.
+  auto pgnew_no_rtype = pgnew.substr(0, pgnew.size() - new_rtype.size());
+  lines->original_name = std::string(pgold);
+  members->methods.push_back(
+      {pgold, pgnew, pgnew_no_rtype, std::move(lines)});
   return true;
 }
 
@@ -590,9 +806,7 @@ void apply_deobfuscated_positions(IRCode* code, const ProguardMap& pm) {
  * method_name should be a method as returned from convert_method
  */
 std::string lines_key(const std::string& method_name) {
-  std::size_t end = method_name.rfind(':');
-  always_assert(end != std::string::npos);
-  return method_name.substr(0, end);
+  return std::string(method_lines_key(method_name));
 }
 
 } // namespace pg_impl
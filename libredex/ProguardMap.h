@@ -9,9 +9,13 @@
 
 #include <cstddef>
 #include <fstream>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "DexClass.h"
 #include "ProguardLineRange.h"
@@ -53,7 +57,7 @@ struct ProguardMap {
   /**
    * Construct map from a given stream.
    */
-  explicit ProguardMap(std::istream& is) { parse_proguard_map(is); }
+  explicit ProguardMap(std::istream& is);
 
   /**
    * Translate un-obfuscated class name to obfuscated name.
@@ -112,43 +116,93 @@ struct ProguardMap {
   }
 
  private:
-  void parse_proguard_map(std::istream& fp);
-  void parse_full_map(std::istream& fp);
+  /**
+   * Owns the characters of all the names in the map. Names are copied into
+   * large blocks and live as long as the map. A name that appears in several
+   * tables, e.g. as the key of one and the value of another, is stored once.
+   */
+  class StringStore {
+   public:
+    std::string_view store(std::string_view s);
+
+    // Takes over the blocks of `other`, leaving the views into them valid.
+    void splice(StringStore&& other);
+
+   private:
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    char* m_cur{nullptr};
+    size_t m_left{0};
+  };
+
+  /**
+   * A name to name map, stored as a vector sorted by key. All the entries are
+   * added first, then `finalize` sorts them, before the first lookup.
+   */
+  class NameTable {
+   public:
+    void reserve(size_t size) { m_entries.reserve(size); }
+
+    void add(std::string_view key, std::string_view value) {
+      m_entries.emplace_back(key, value);
+    }
 
-  bool parse_class(const std::string& line);
-  bool parse_field(const std::string& line);
-  bool parse_method(const std::string& line);
+    // Of all the entries with the same key, the one added last is kept.
+    void finalize();
+
+    const std::string_view* find(std::string_view key) const;
+
+    bool empty() const { return m_entries.empty(); }
+
+   private:
+    std::vector<std::pair<std::string_view, std::string_view>> m_entries;
+  };
+
+  // The members of a run of classes, parsed independently of the others.
+  struct Members;
+
+  void parse_proguard_map(std::string_view contents);
+  void parse_full_map(std::string_view contents);
+
+  bool parse_field(const std::string& line,
+                   const std::string& cls,
+                   const std::string& new_cls,
+                   Members* members) const;
+  bool parse_method(const std::string& line,
+                    const std::string& cls,
+                    const std::string& new_cls,
+                    Members* members) const;
+  void add_members(Members* members);
 
   bool parse_class_full_format(const std::string& line);
   bool parse_field_full_format(const std::string& line);
   bool parse_method_full_format(const std::string& line);
 
  private:
+  StringStore m_strings;
+
   // Unobfuscated to obfuscated maps
-  std::unordered_map<std::string, std::string> m_classMap;
-  std::unordered_map<std::string, std::string> m_fieldMap;
-  std::unordered_map<std::string, std::string> m_methodMap;
+  NameTable m_classMap;
+  NameTable m_fieldMap;
+  NameTable m_methodMap;
 
   // Obfuscated to unobfuscated maps from proguard
-  std::unordered_map<std::string, std::string> m_obfClassMap;
-  std::unordered_map<std::string, std::string> m_obfFieldMap;
-  std::unordered_map<std::string, std::string> m_obfMethodMap;
+  NameTable m_obfClassMap;
+  NameTable m_obfFieldMap;
+  NameTable m_obfMethodMap;
 
   // Field map for reflection analysis when type is unknown
   // Stores Lcom/facebook/Class;.field -> original name without class name
-  std::unordered_map<std::string, std::string> m_obfUntypedFieldMap;
+  NameTable m_obfUntypedFieldMap;
 
   // Method map for reflection analysis when return type is unknown
   // Stores Lcom/facebook/Class;.method(II) -> original name without class name
-  std::unordered_map<std::string, std::string> m_obfUntypedMethodMap;
+  NameTable m_obfUntypedMethodMap;
 
-  std::unordered_map<std::string, ProguardLineRangeVector> m_obfMethodLinesMap;
+  std::unordered_map<std::string_view, ProguardLineRangeVector>
+      m_obfMethodLinesMap;
 
   // Interfaces that are (most likely) coalesced by Proguard.
-  std::unordered_set<std::string> m_pg_coalesced_interfaces;
-
-  std::string m_currClass;
-  std::string m_currNewClass;
+  std::unordered_set<std::string_view> m_pg_coalesced_interfaces;
 };
 
 /**
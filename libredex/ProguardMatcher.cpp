@@ -6,10 +6,12 @@
  */
 
 #include <algorithm>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/regex.hpp>
 #include <iostream>
 #include <mutex>
 #include <sstream>
+#include <string_view>
 #include <thread>
 #include <unordered_set>
 
@@ -18,6 +20,7 @@
 #include "DexAnnotation.h"
 #include "DexUtil.h"
 #include "IRCode.h"
+#include "ProguardGlob.h"
 #include "ProguardMatcher.h"
 #include "ProguardPrintConfiguration.h"
 #include "ProguardRegex.h"
@@ -84,6 +87,11 @@ struct ClassMatcher {
     if (m_class_name != "*" && m_class_name != "**" && !match_name(cls)) {
       return false;
     }
+    return match_except_name(cls);
+  }
+
+  // For classes whose name is already known to match.
+  bool match_except_name(const DexClass* cls) {
     // Check for access match
     if (!match_access(cls)) {
       return false;
@@ -221,6 +229,25 @@ void build_extends_or_implements_hierarchy(const Scope& scope,
   }
 }
 
+using ClassesByAnnotation =
+    std::unordered_map<std::string_view, std::vector<DexClass*>>;
+
+/*
+ * Lets rules that require a specific annotation only visit the classes that
+ * have it, instead of all classes.
+ */
+void index_classes_by_annotation(const Scope& scope,
+                                 ClassesByAnnotation* classes_by_annotation) {
+  for (const auto& cls : scope) {
+    const auto* annos = cls->get_anno_set();
+    if (!annos) continue;
+    for (const auto& anno : annos->get_annotations()) {
+      (*classes_by_annotation)[get_deobfuscated_name(anno->type())].push_back(
+          cls);
+    }
+  }
+}
+
 /*
  * This class contains the logic for matching against a single keep rule.
  */
@@ -337,6 +364,8 @@ class ProguardMatcher {
     // may, for instance, forbid renaming of all classes that inherit from a
     // given external class.
     build_extends_or_implements_hierarchy(m_external_classes, &m_hierarchy);
+    index_classes_by_annotation(m_classes, &m_classes_by_annotation);
+    index_classes_by_annotation(m_external_classes, &m_classes_by_annotation);
   }
 
   void process_proguard_rules(const ProguardConfiguration& pg_config);
@@ -357,6 +386,8 @@ class ProguardMatcher {
   const Scope& m_classes;
   const Scope& m_external_classes;
   ClassHierarchy m_hierarchy;
+  // The classes with each annotation, by the deobfuscated annotation type.
+  ClassesByAnnotation m_classes_by_annotation;
   ConcurrentSet<const KeepSpec*> m_unused_rules;
 };
 
@@ -454,20 +485,37 @@ bool KeepRuleMatcher::has_annotation(const DexMember* member,
 
 // From a fully qualified descriptor for a field, exract just the
 // name of the field which occurs between the ;. and : characters.
-std::string extract_field_name(std::string qualified_fieldname) {
+// The result points into the given name, which the interned deobfuscated
+// names of members outlive.
+std::string_view extract_field_name(std::string_view qualified_fieldname) {
   auto p = qualified_fieldname.find(";.");
-  if (p == std::string::npos) {
+  if (p == std::string_view::npos) {
     return qualified_fieldname;
   }
   return qualified_fieldname.substr(p + 2);
 }
 
-std::string extract_method_name_and_type(
-    const std::string& qualified_fieldname) {
+std::string_view extract_method_name_and_type(
+    std::string_view qualified_fieldname) {
   auto p = qualified_fieldname.find(";.");
   return qualified_fieldname.substr(p + 2);
 }
 
+// The part of a member name pattern before any wildcard or character that
+// form_member_regex leaves to the regex syntax. Every name that the pattern
+// matches starts with it, which is much cheaper to check than the regex.
+std::string_view literal_name_prefix(const std::string& name_pattern) {
+  size_t size = 0;
+  while (size < name_pattern.size()) {
+    unsigned char ch = name_pattern[size];
+    if (!isalnum(ch) && ch != '_' && ch != '<' && ch != '>') {
+      break;
+    }
+    ++size;
+  }
+  return std::string_view(name_pattern).substr(0, size);
+}
+
 bool KeepRuleMatcher::field_level_match(
     const MemberSpecification& fieldSpecification,
     const DexField* field,
@@ -487,7 +535,12 @@ bool KeepRuleMatcher::field_level_match(
   // Match field name against regex.
   auto dequalified_name =
       extract_field_name(field->get_deobfuscated_name().str());
-  return boost::regex_match(dequalified_name, fieldname_regex);
+  if (!boost::starts_with(dequalified_name,
+                          literal_name_prefix(fieldSpecification.name))) {
+    return false;
+  }
+  return boost::regex_match(dequalified_name.begin(), dequalified_name.end(),
+                            fieldname_regex);
 }
 
 template <class Container>
@@ -542,7 +595,12 @@ bool KeepRuleMatcher::method_level_match(
   }
   auto dequalified_name =
       extract_method_name_and_type(method->get_deobfuscated_name().str());
-  return boost::regex_match(dequalified_name.c_str(), method_regex);
+  if (!boost::starts_with(dequalified_name,
+                          literal_name_prefix(methodSpecification.name))) {
+    return false;
+  }
+  return boost::regex_match(dequalified_name.begin(), dequalified_name.end(),
+                            method_regex);
 }
 
 template <class Container>
@@ -824,6 +882,8 @@ void ProguardMatcher::process_keep(const KeepSpecSet& keep_rules,
     }
   });
 
+  proguard_parser::GlobSet class_name_globs;
+  std::vector<const KeepSpec*> glob_rules;
   RegexMap regex_map;
   for (const auto& keep_rule_ptr : keep_rules) {
     const auto& keep_rule = *keep_rule_ptr;
@@ -860,12 +920,88 @@ void ProguardMatcher::process_keep(const KeepSpecSet& keep_rules,
       continue;
     }
 
+    // Likewise if the rule requires a specific annotation.
+    const auto& annotationType = keep_rule.class_spec.annotationType;
+    if (!annotationType.empty() &&
+        !classname_contains_wildcard(annotationType) &&
+        annotationType.find('.') == std::string::npos) {
+      KeepRuleMatcher rule_matcher(rule_type, keep_rule, regex_map);
+      auto it = m_classes_by_annotation.find(annotationType);
+      if (it != m_classes_by_annotation.end()) {
+        for (auto* cls : it->second) {
+          process_single_keep(class_match, rule_matcher, cls);
+        }
+      }
+      if (rule_matcher.is_unused()) {
+        m_unused_rules.insert(&keep_rule);
+      }
+      continue;
+    }
+
+    // Otherwise, all classes need to be matched. Most class name patterns
+    // only use simple wildcards, so match them all at once below.
+    if (class_name_globs.add(
+            proguard_parser::convert_wildcard_type(className),
+            glob_rules.size())) {
+      glob_rules.push_back(&keep_rule);
+      continue;
+    }
+
     TRACE(PGR, 2, "Slow rule: %s", show_keep(keep_rule).c_str());
-    // Otherwise, it might take a longer time. Add to the work queue.
+    // This might take a longer time. Add to the work queue.
     wq.add_item(&keep_rule);
   }
 
   wq.run_all();
+
+  if (glob_rules.empty()) {
+    return;
+  }
+  TRACE(PGR, 2, "Matching %zu class name patterns at once", glob_rules.size());
+  std::vector<DexClass*> classes(m_classes.begin(), m_classes.end());
+  if (process_external) {
+    classes.insert(classes.end(), m_external_classes.begin(),
+                   m_external_classes.end());
+  }
+
+  // A single pass over each class name finds all the rules that it matches.
+  std::vector<std::vector<uint32_t>> rules_per_class(classes.size());
+  auto match_wq = workqueue_foreach<size_t>([&](size_t i) {
+    class_name_globs.match(classes[i]->get_deobfuscated_name().str(),
+                           &rules_per_class[i]);
+  });
+  for (size_t i = 0; i < classes.size(); ++i) {
+    match_wq.add_item(i);
+  }
+  match_wq.run_all();
+
+  // Then process the rules one by one as above, but only on the classes that
+  // they matched, in the same order.
+  std::vector<std::vector<DexClass*>> classes_per_rule(glob_rules.size());
+  for (size_t i = 0; i < classes.size(); ++i) {
+    for (auto rule_idx : rules_per_class[i]) {
+      classes_per_rule[rule_idx].push_back(classes[i]);
+    }
+  }
+  auto glob_wq = workqueue_foreach<size_t>([&](size_t rule_idx) {
+    const auto* keep_rule = glob_rules[rule_idx];
+    RegexMap regex_map;
+    ClassMatcher class_match(*keep_rule);
+    KeepRuleMatcher rule_matcher(rule_type, *keep_rule, regex_map);
+    for (auto* cls : classes_per_rule[rule_idx]) {
+      if (class_match.match_except_name(cls)) {
+        std::unique_lock<std::mutex> lock(get_lock(cls));
+        rule_matcher.keep_processor(cls);
+      }
+    }
+    if (rule_matcher.is_unused()) {
+      m_unused_rules.insert(keep_rule);
+    }
+  });
+  for (size_t i = 0; i < glob_rules.size(); ++i) {
+    glob_wq.add_item(i);
+  }
+  glob_wq.run_all();
 }
 
 void ProguardMatcher::process_proguard_rules(
@@ -5,8 +5,15 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <unordered_map>
 #include <vector>
 
 #include "Debug.h"
@@ -16,6 +23,7 @@
 #include "ProguardParser.h"
 #include "ProguardRegex.h"
 #include "ReadMaybeMapped.h"
+#include "WorkQueue.h"
 
 namespace keep_rules {
 namespace proguard_parser {
@@ -24,10 +32,13 @@ namespace {
 struct TokenIndex {
   const std::vector<Token>& vec;
   std::vector<Token>::const_iterator it;
+  // Where parse errors are reported.
+  std::ostream& err;
 
   TokenIndex(const std::vector<Token>& vec,
-             std::vector<Token>::const_iterator it)
-      : vec(vec), it(it) {}
+             std::vector<Token>::const_iterator it,
+             std::ostream& err)
+      : vec(vec), it(it), err(err) {}
 
   void skip_comments() {
     while (it != vec.end() && it->type == TokenType::comment) {
@@ -126,7 +137,7 @@ bool parse_single_filepath_command(TokenIndex& idx,
     idx.next(); // Consume the command token.
     // Fail without consumption if this is an end of file token.
     if (idx.type() == TokenType::eof_token) {
-      std::cerr
+      idx.err
           << "Expecting at least one file as an argument but found end of "
              "file at line "
           << line_number << std::endl
@@ -135,16 +146,16 @@ bool parse_single_filepath_command(TokenIndex& idx,
     }
     // Fail without consumption if this is a command token.
     if (idx.it->is_command()) {
-      std::cerr << "Expecting a file path argument but got command "
-                << idx.show() << " at line  " << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expecting a file path argument but got command "
+              << idx.show() << " at line  " << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       return true;
     }
     // Parse the filename.
     if (idx.type() != TokenType::filepath) {
-      std::cerr << "Expected a filepath but got " << idx.show() << " at line "
-                << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expected a filepath but got " << idx.show() << " at line "
+              << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       return true;
     }
     *filepath = idx.str();
@@ -159,9 +170,9 @@ void parse_filepaths(TokenIndex& idx, std::vector<std::string>* into) {
   std::vector<std::string> filepaths;
   if (idx.type() != TokenType::filepath) {
     if (!kOptional) {
-      std::cerr << "Expected filepath but got " << idx.show() << " at line "
-                << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expected filepath but got " << idx.show() << " at line "
+              << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
     }
     return;
   }
@@ -180,7 +191,7 @@ bool parse_filepath_command(TokenIndex& idx,
     idx.next(); // Consume the command token.
     // Fail without consumption if this is an end of file token.
     if (idx.type() == TokenType::eof_token) {
-      std::cerr
+      idx.err
           << "Expecting at least one file as an argument but found end of "
              "file at line "
           << line_number << std::endl;
@@ -188,16 +199,16 @@ bool parse_filepath_command(TokenIndex& idx,
     }
     // Fail without consumption if this is a command token.
     if (idx.it->is_command()) {
-      std::cerr << "Expecting a file path argument but got command "
-                << idx.show() << " at line  " << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expecting a file path argument but got command "
+              << idx.show() << " at line  " << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       return true;
     }
     // Parse the filename.
     if (idx.type() != TokenType::filepath) {
-      std::cerr << "Expected a filepath but got " << idx.show() << " at line "
-                << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expected a filepath but got " << idx.show() << " at line "
+              << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       return true;
     }
     parse_filepaths(idx, filepaths);
@@ -227,7 +238,7 @@ bool parse_jars(TokenIndex& idx,
     idx.next(); // Consume the jar token.
     // Fail without consumption if this is an end of file token.
     if (idx.type() == TokenType::eof_token) {
-      std::cerr
+      idx.err
           << "Expecting at least one file as an argument but found end of "
              "file at line "
           << line_number << std::endl
@@ -288,8 +299,8 @@ bool parse_repackageclasses(TokenIndex& idx) {
   // Ignore repackageclasses.
   idx.next();
   if (idx.type() == TokenType::identifier) {
-    std::cerr << "Ignoring -repackageclasses " << idx.data() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Ignoring -repackageclasses " << idx.data() << std::endl
+            << idx.show_context(2) << std::endl;
     idx.next();
   }
   return true;
@@ -300,9 +311,9 @@ bool parse_target(TokenIndex& idx, std::string* target_version) {
     idx.next(); // Consume the target command token.
     // Check to make sure the next TokenType is a version token.
     if (idx.type() != TokenType::target_version_token) {
-      std::cerr << "Expected a target version but got " << idx.show()
-                << " at line " << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expected a target version but got " << idx.show()
+              << " at line " << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       return true;
     }
     *target_version = idx.str();
@@ -358,9 +369,9 @@ bool parse_modifiers(TokenIndex& idx, KeepSpec* keep) {
   while (idx.type() == TokenType::comma) {
     idx.next();
     if (!is_modifier(idx.type())) {
-      std::cerr << "Expected keep option modifier but found : " << idx.show()
-                << " at line number " << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expected keep option modifier but found : " << idx.show()
+              << " at line number " << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       return false;
     }
     switch (idx.type()) {
@@ -438,9 +449,9 @@ std::string parse_annotation_type(TokenIndex& idx) {
   }
   idx.next();
   if (idx.type() != TokenType::identifier) {
-    std::cerr << "Expecting a class identifier after @ but got " << idx.show()
-              << " at line " << idx.line() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expecting a class identifier after @ but got " << idx.show()
+            << " at line " << idx.line() << std::endl
+            << idx.show_context(2) << std::endl;
     return "";
   }
   const auto& typ = idx.data();
@@ -476,20 +487,20 @@ bool parse_access_flags(TokenIndex& idx,
       idx.it = ++access_it;
       if (negated) {
         if (is_access_flag_set(setFlags_, access_flag)) {
-          std::cerr << "Access flag " << idx.show()
-                    << " occurs with conflicting settings at line "
-                    << idx.line() << std::endl
-                    << idx.show_context(2) << std::endl;
+          idx.err << "Access flag " << idx.show()
+                  << " occurs with conflicting settings at line "
+                  << idx.line() << std::endl
+                  << idx.show_context(2) << std::endl;
           return false;
         }
         set_access_flag(unsetFlags_, access_flag);
         negated = false;
       } else {
         if (is_access_flag_set(unsetFlags_, access_flag)) {
-          std::cerr << "Access flag " << idx.show()
-                    << " occurs with conflicting settings at line "
-                    << idx.line() << std::endl
-                    << idx.show_context(2) << std::endl;
+          idx.err << "Access flag " << idx.show()
+                  << " occurs with conflicting settings at line "
+                  << idx.line() << std::endl
+                  << idx.show_context(2) << std::endl;
           return false;
         }
         set_access_flag(setFlags_, access_flag);
@@ -527,9 +538,9 @@ bool parse_class_token(TokenIndex& idx,
   case TokenType::classToken:
     break;
   default:
-    std::cerr << "Expected interface, class or enum but got " << idx.show()
-              << " at line number " << idx.line() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expected interface, class or enum but got " << idx.show()
+            << " at line number " << idx.line() << std::endl
+            << idx.show_context(2) << std::endl;
     return false;
   }
   idx.next();
@@ -541,8 +552,8 @@ bool parse_class_token(TokenIndex& idx,
 // is returned.
 bool consume_token(TokenIndex& idx, const TokenType& tok) {
   if (idx.type() != tok) {
-    std::cerr << "Unexpected TokenType " << idx.show() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Unexpected TokenType " << idx.show() << std::endl
+            << idx.show_context(2) << std::endl;
     return false;
   }
   idx.next();
@@ -553,9 +564,9 @@ bool consume_token(TokenIndex& idx, const TokenType& tok) {
 void gobble_semicolon(TokenIndex& idx, bool* ok) {
   *ok = consume_token(idx, TokenType::semiColon);
   if (!*ok) {
-    std::cerr << "Expecting a semicolon but found " << idx.show() << " at line "
-              << idx.line() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expecting a semicolon but found " << idx.show() << " at line "
+            << idx.line() << std::endl
+            << idx.show_context(2) << std::endl;
     return;
   }
 }
@@ -581,16 +592,16 @@ void parse_member_specification(TokenIndex& idx,
                           member_specification.requiredUnsetAccessFlags)) {
     // There was a problem parsing the access flags. Return an empty class spec
     // for now.
-    std::cerr << "Problem parsing access flags for member specification.\n";
+    idx.err << "Problem parsing access flags for member specification.\n";
     *ok = false;
     skip_to_semicolon(idx);
     return;
   }
   // The next TokenType better be an identifier.
   if (idx.type() != TokenType::identifier) {
-    std::cerr << "Expecting field or member specification but got "
-              << idx.show() << " at line " << idx.line() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expecting field or member specification but got "
+            << idx.show() << " at line " << idx.line() << std::endl
+            << idx.show_context(2) << std::endl;
     *ok = false;
     skip_to_semicolon(idx);
     return;
@@ -634,9 +645,9 @@ void parse_member_specification(TokenIndex& idx,
   } else {
     // This TokenType is the type for the member specification.
     if (idx.type() != TokenType::identifier) {
-      std::cerr << "Expecting type identifier but got " << idx.show()
-                << " at line " << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expecting type identifier but got " << idx.show()
+              << " at line " << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       *ok = false;
       skip_to_semicolon(idx);
       return;
@@ -645,9 +656,9 @@ void parse_member_specification(TokenIndex& idx,
     idx.next();
     member_specification.descriptor = convert_wildcard_type(typ);
     if (idx.type() != TokenType::identifier) {
-      std::cerr << "Expecting identifier name for class member but got "
-                << idx.show() << " at line " << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expecting identifier name for class member but got "
+              << idx.show() << " at line " << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       *ok = false;
       skip_to_semicolon(idx);
       return;
@@ -666,9 +677,9 @@ void parse_member_specification(TokenIndex& idx,
         break;
       }
       if (idx.type() != TokenType::identifier) {
-        std::cerr << "Expecting type identifier but got " << idx.show()
-                  << " at line " << idx.line() << std::endl
-                  << idx.show_context(2) << std::endl;
+        idx.err << "Expecting type identifier but got " << idx.show()
+                << " at line " << idx.line() << std::endl
+                << idx.show_context(2) << std::endl;
         *ok = false;
         return;
       }
@@ -678,9 +689,9 @@ void parse_member_specification(TokenIndex& idx,
       // The next TokenType better be a comma or a closing bracket.
       if (idx.type() != TokenType::comma &&
           idx.type() != TokenType::closeBracket) {
-        std::cerr << "Expecting comma or ) but got " << idx.show()
-                  << " at line " << idx.line() << std::endl
-                  << idx.show_context(2) << std::endl;
+        idx.err << "Expecting comma or ) but got " << idx.show()
+                << " at line " << idx.line() << std::endl
+                << idx.show_context(2) << std::endl;
         *ok = false;
         return;
       }
@@ -689,9 +700,9 @@ void parse_member_specification(TokenIndex& idx,
       if (idx.type() == TokenType::comma) {
         consume_token(idx, TokenType::comma);
         if (idx.type() != TokenType::identifier) {
-          std::cerr << "Expecting type identifier after comma but got "
-                    << idx.show() << " at line " << idx.line() << std::endl
-                    << idx.show_context(2) << std::endl;
+          idx.err << "Expecting type identifier after comma but got "
+                  << idx.show() << " at line " << idx.line() << std::endl
+                  << idx.show_context(2) << std::endl;
           *ok = false;
           return;
         }
@@ -763,7 +774,7 @@ ClassSpecification parse_class_specification(TokenIndex& idx, bool* ok) {
           idx, class_spec.setAccessFlags, class_spec.unsetAccessFlags)) {
     // There was a problem parsing the access flags. Return an empty class spec
     // for now.
-    std::cerr << "Problem parsing access flags for class specification.\n";
+    idx.err << "Problem parsing access flags for class specification.\n";
     *ok = false;
     return class_spec;
   }
@@ -774,9 +785,9 @@ ClassSpecification parse_class_specification(TokenIndex& idx, bool* ok) {
   }
   // Parse the class name.
   if (idx.type() != TokenType::identifier) {
-    std::cerr << "Expected class name but got " << idx.show() << " at line "
-              << idx.line() << std::endl
-              << idx.show_context(2) << std::endl;
+    idx.err << "Expected class name but got " << idx.show() << " at line "
+            << idx.line() << std::endl
+            << idx.show_context(2) << std::endl;
     *ok = false;
     return class_spec;
   }
@@ -788,9 +799,9 @@ ClassSpecification parse_class_specification(TokenIndex& idx, bool* ok) {
     idx.next();
     class_spec.extendsAnnotationType = parse_annotation_type(idx);
     if (idx.type() != TokenType::identifier) {
-      std::cerr << "Expecting a class name after extends/implements but got "
-                << idx.show() << " at line " << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expecting a class name after extends/implements but got "
+              << idx.show() << " at line " << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       *ok = false;
       class_spec.extendsClassName = "";
     } else {
@@ -840,10 +851,11 @@ bool parse_keep(TokenIndex& idx,
 void parse(const std::vector<Token>& vec,
            ProguardConfiguration* pg_config,
            unsigned int* parse_errors,
-           const std::string& filename) {
+           const std::string& filename,
+           std::ostream& err) {
   *parse_errors = 0;
   bool ok;
-  TokenIndex idx{vec, vec.begin()};
+  TokenIndex idx{vec, vec.begin(), err};
   while (idx.it != idx.vec.end()) {
     // Break out if we are at the end of the TokenType stream.
     if (idx.type() == TokenType::eof_token) {
@@ -855,9 +867,9 @@ void parse(const std::vector<Token>& vec,
     }
     uint32_t line = idx.line();
     if (!idx.it->is_command()) {
-      std::cerr << "Expecting command but found " << idx.show() << " at line "
-                << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Expecting command but found " << idx.show() << " at line "
+              << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       idx.next();
       skip_to_next_command(idx);
       continue;
@@ -1102,14 +1114,14 @@ void parse(const std::vector<Token>& vec,
       const auto& name = idx.data();
       // It is benign to drop -dontnote
       if (name != "dontnote") {
-        std::cerr << "Unimplemented command (skipping): " << idx.show()
-                  << " at line " << idx.line() << std::endl
-                  << idx.show_context(2) << std::endl;
+        idx.err << "Unimplemented command (skipping): " << idx.show()
+                << " at line " << idx.line() << std::endl
+                << idx.show_context(2) << std::endl;
       }
     } else {
-      std::cerr << "Unexpected TokenType " << idx.show() << " at line "
-                << idx.line() << std::endl
-                << idx.show_context(2) << std::endl;
+      idx.err << "Unexpected TokenType " << idx.show() << " at line "
+              << idx.line() << std::endl
+              << idx.show_context(2) << std::endl;
       (*parse_errors)++;
     }
     idx.next();
@@ -1119,7 +1131,8 @@ void parse(const std::vector<Token>& vec,
 
 void parse(const std::string_view& config,
            ProguardConfiguration* pg_config,
-           const std::string& filename) {
+           const std::string& filename,
+           std::ostream& err = std::cerr) {
   std::vector<Token> tokens = lex(config);
   bool ok = true;
   // Check for bad tokens.
@@ -1132,19 +1145,141 @@ void parse(const std::string_view& config,
   }
   unsigned int parse_errors = 0;
   if (ok) {
-    parse(tokens, pg_config, &parse_errors, filename);
+    parse(tokens, pg_config, &parse_errors, filename, err);
   } else {
-    std::cerr << "Found unkown tokens in " << filename << "\n";
+    err << "Found unkown tokens in " << filename << "\n";
   }
 
   if (parse_errors == 0) {
     pg_config->ok = ok;
   } else {
     pg_config->ok = false;
-    std::cerr << "Found " << parse_errors << " parse errors\n";
+    err << "Found " << parse_errors << " parse errors\n";
   }
 }
 
+// The result of parsing a single file, without the files it includes, into a
+// configuration of its own.
+struct ParsedFile {
+  std::unique_ptr<ProguardConfiguration> pg_config;
+  // The parse errors, which are reported when the file is merged so that they
+  // come in the order in which the files are parsed one after the other.
+  std::string errors;
+};
+
+ParsedFile parse_single_file(const std::string& filename) {
+  ParsedFile parsed;
+  try {
+    redex::read_file_with_contents(filename, [&](const char* data, size_t s) {
+      auto pg_config = std::make_unique<ProguardConfiguration>();
+      std::ostringstream err;
+      parse(std::string_view(data, s), pg_config.get(), filename, err);
+      parsed.pg_config = std::move(pg_config);
+      parsed.errors = err.str();
+    });
+  } catch (const std::exception&) {
+    // Reading the file is retried when merging it, and fails again at the
+    // same point of the sequence of files.
+    parsed.pg_config = nullptr;
+  }
+  return parsed;
+}
+
+template <typename T>
+void append(std::vector<T>&& from, std::vector<T>* into) {
+  into->insert(into->end(), std::make_move_iterator(from.begin()),
+               std::make_move_iterator(from.end()));
+}
+
+// Merges the configuration of a file into the configuration of the files
+// parsed before it, as parsing the file into the latter would have.
+void merge(ProguardConfiguration&& from, ProguardConfiguration* into) {
+  into->ok = from.ok;
+  append(std::move(from.includes), &into->includes);
+  if (!from.basedirectory.empty()) {
+    into->basedirectory = std::move(from.basedirectory);
+  }
+  append(std::move(from.injars), &into->injars);
+  append(std::move(from.outjars), &into->outjars);
+  append(std::move(from.libraryjars), &into->libraryjars);
+  append(std::move(from.printmapping), &into->printmapping);
+  append(std::move(from.printconfiguration), &into->printconfiguration);
+  append(std::move(from.printseeds), &into->printseeds);
+  append(std::move(from.printusage), &into->printusage);
+  append(std::move(from.keepdirectories), &into->keepdirectories);
+  // Commands only ever move these away from their defaults.
+  into->shrink &= from.shrink;
+  into->optimize &= from.optimize;
+  into->allowaccessmodification |= from.allowaccessmodification;
+  into->dontobfuscate |= from.dontobfuscate;
+  into->dontusemixedcaseclassnames |= from.dontusemixedcaseclassnames;
+  into->dontpreverify |= from.dontpreverify;
+  into->verbose |= from.verbose;
+  if (!from.target_version.empty()) {
+    into->target_version = std::move(from.target_version);
+  }
+  into->keep_rules.append(std::move(from.keep_rules));
+  into->assumenosideeffects_rules.append(
+      std::move(from.assumenosideeffects_rules));
+  into->whyareyoukeeping_rules.append(std::move(from.whyareyoukeeping_rules));
+  append(std::move(from.optimization_filters), &into->optimization_filters);
+  append(std::move(from.keepattributes), &into->keepattributes);
+  append(std::move(from.dontwarn), &into->dontwarn);
+  append(std::move(from.keeppackagenames), &into->keeppackagenames);
+}
+
+struct Visit {
+  std::string filename;
+  bool included;
+};
+
+/*
+ * Returns the files in the order in which parsing them one after the other
+ * visits them, each file being followed by the files that it includes and
+ * that were not included before. Files that are not parsed yet are added to
+ * `unparsed`, and their includes are not followed. The order stops at the
+ * first file that cannot be read.
+ */
+std::vector<Visit> visit_order(
+    const std::vector<std::string>& filenames,
+    const ProguardConfiguration& pg_config,
+    const std::unordered_map<std::string, ParsedFile>& parsed,
+    std::vector<std::string>* unparsed) {
+  std::vector<Visit> order;
+  std::vector<std::string> includes = pg_config.includes;
+  std::set<std::string> already_included = pg_config.already_included;
+  bool failed = false;
+  std::function<void(const std::string&, bool)> visit =
+      [&](const std::string& filename, bool included) {
+        order.push_back({filename, included});
+        auto it = parsed.find(filename);
+        if (it == parsed.end()) {
+          unparsed->push_back(filename);
+          return;
+        }
+        if (it->second.pg_config == nullptr) {
+          failed = true;
+          return;
+        }
+        const auto& file_includes = it->second.pg_config->includes;
+        includes.insert(includes.end(), file_includes.begin(),
+                        file_includes.end());
+        // Files included while visiting the includes are visited as well.
+        for (size_t i = 0; i < includes.size() && !failed; ++i) {
+          if (already_included.emplace(includes[i]).second) {
+            visit(std::string(includes[i]), /* included */ true);
+          }
+        }
+      };
+  for (const auto& filename : filenames) {
+    visit(filename, /* included */ false);
+    if (failed) {
+      break;
+    }
+  }
+  return order;
+}
+
 } // namespace
 
 void parse(std::istream& config,
@@ -1156,19 +1291,55 @@ void parse(std::istream& config,
 }
 
 void parse_file(const std::string& filename, ProguardConfiguration* pg_config) {
-  redex::read_file_with_contents(filename, [&](const char* data, size_t s) {
-    std::string_view view(data, s);
-    parse(view, pg_config, filename);
-    // Parse the included files.
-    for (const auto& included_filename : pg_config->includes) {
-      if (pg_config->already_included.find(included_filename) !=
-          pg_config->already_included.end()) {
-        continue;
-      }
-      pg_config->already_included.emplace(included_filename);
-      parse_file(included_filename, pg_config);
+  parse_files({filename}, pg_config);
+}
+
+void parse_files(const std::vector<std::string>& filenames,
+                 ProguardConfiguration* pg_config) {
+  // Which files are included is only known once the including files are
+  // parsed, so files are parsed in waves, each wave in parallel, until the
+  // order of the files is complete.
+  std::unordered_map<std::string, ParsedFile> parsed;
+  std::vector<Visit> order;
+  while (true) {
+    std::vector<std::string> unparsed;
+    order = visit_order(filenames, *pg_config, parsed, &unparsed);
+    if (unparsed.empty()) {
+      break;
     }
-  });
+    std::sort(unparsed.begin(), unparsed.end());
+    unparsed.erase(std::unique(unparsed.begin(), unparsed.end()),
+                   unparsed.end());
+    std::vector<ParsedFile> wave(unparsed.size());
+    std::vector<size_t> indices(unparsed.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    workqueue_run<size_t>(
+        [&](size_t i) { wave[i] = parse_single_file(unparsed[i]); }, indices);
+    for (size_t i = 0; i < unparsed.size(); ++i) {
+      parsed.emplace(std::move(unparsed[i]), std::move(wave[i]));
+    }
+  }
+
+  for (const auto& visit : order) {
+    if (visit.included) {
+      pg_config->already_included.emplace(visit.filename);
+    }
+    auto& file = parsed.at(visit.filename);
+    if (file.pg_config == nullptr) {
+      // A file that is visited twice is parsed again, and a file that could
+      // not be read throws here.
+      redex::read_file_with_contents(
+          visit.filename, [&](const char* data, size_t s) {
+            ProguardConfiguration file_pg_config;
+            parse(std::string_view(data, s), &file_pg_config, visit.filename);
+            merge(std::move(file_pg_config), pg_config);
+          });
+      continue;
+    }
+    std::cerr << file.errors;
+    merge(std::move(*file.pg_config), pg_config);
+    file.pg_config = nullptr;
+  }
 }
 
 void remove_blocklisted_rules(ProguardConfiguration* pg_config) {
@@ -9,6 +9,7 @@
 
 #include <iosfwd>
 #include <string>
+#include <vector>
 
 #include "ProguardConfiguration.h"
 
@@ -16,6 +17,15 @@ namespace keep_rules {
 namespace proguard_parser {
 
 void parse_file(const std::string& filename, ProguardConfiguration* pg_config);
+
+/*
+ * Parses the files, and the files that they include, into pg_config in the
+ * same order as parsing them one after the other with parse_file. The files
+ * are read and parsed in parallel into configurations of their own, which are
+ * then merged in order.
+ */
+void parse_files(const std::vector<std::string>& filenames,
+                 ProguardConfiguration* pg_config);
 void parse(std::istream& config,
            ProguardConfiguration* pg_config,
            const std::string& filename = "");
@@ -11,6 +11,7 @@
 #include <ostream>
 
 #include "DexClass.h"
+#include "ParallelPrint.h"
 #include "ReachableClasses.h"
 
 std::string extract_suffix(std::string class_name) {
@@ -208,9 +209,10 @@ void redex::print_class(std::ostream& output,
 void redex::print_classes(std::ostream& output,
                           const ProguardMap& pg_map,
                           const Scope& classes) {
-  for (const auto& cls : classes) {
-    if (!cls->is_external()) {
-      redex::print_class(output, pg_map, cls);
-    }
-  }
+  redex::print_in_parallel(
+      output, classes, [&](std::ostream& out, const DexClass* cls) {
+        if (!cls->is_external()) {
+          redex::print_class(out, pg_map, cls);
+        }
+      });
 }
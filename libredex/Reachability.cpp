@@ -9,11 +9,15 @@
 
 #include <boost/bimap/bimap.hpp>
 #include <boost/bimap/unordered_set_of.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/range/adaptor/map.hpp>
 
 #include "BinarySerialization.h"
+#include "ControlFlow.h"
 #include "DexAnnotation.h"
 #include "DexUtil.h"
+#include "EditableCfgAdapter.h"
+#include "IRInstruction.h"
 #include "ProguardConfiguration.h"
 #include "ReachableClasses.h"
 #include "Resolver.h"
@@ -225,11 +229,11 @@ void TransitiveClosureMarker::push(const Parent* parent, const DexClass* cls) {
   if (!cls) {
     return;
   }
+  record_push(cls);
   record_reachability(parent, cls);
-  if (m_reachable_objects->marked(cls)) {
+  if (!m_reachable_objects->mark(cls)) {
     return;
   }
-  m_reachable_objects->mark(cls);
   m_worker_state->push_task(ReachableObject(cls));
 }
 
@@ -239,15 +243,11 @@ void TransitiveClosureMarker::push(const Parent* parent,
   if (!field) {
     return;
   }
+  record_push(field);
   record_reachability(parent, field);
-  if (m_reachable_objects->marked(field)) {
+  if (!m_reachable_objects->mark(field)) {
     return;
   }
-  auto f = field->as_def();
-  if (f) {
-    gather_and_push(f);
-  }
-  m_reachable_objects->mark(field);
   m_worker_state->push_task(ReachableObject(field));
 }
 
@@ -258,11 +258,11 @@ void TransitiveClosureMarker::push(const Parent* parent,
     return;
   }
 
+  record_push(method);
   record_reachability(parent, method);
-  if (m_reachable_objects->marked(method)) {
+  if (!m_reachable_objects->mark(method)) {
     return;
   }
-  m_reachable_objects->mark(method);
   m_worker_state->push_task(ReachableObject(method));
 }
 
@@ -272,7 +272,11 @@ void TransitiveClosureMarker::push(const DexMethodRef* parent,
 }
 
 void TransitiveClosureMarker::push_cond(const DexMethod* method) {
-  if (!method || m_reachable_objects->marked(method)) return;
+  if (!method) return;
+  if (m_recorded_visit) {
+    m_recorded_visit->cond_pushed.push_back(method);
+  }
+  if (m_reachable_objects->marked(method)) return;
   TRACE(REACH, 4, "Conditionally marking method: %s", SHOW(method));
   auto clazz = type_class(method->get_class());
   m_cond_marked->methods.insert(method);
@@ -283,7 +287,10 @@ void TransitiveClosureMarker::push_cond(const DexMethod* method) {
   // after visit(DexClass*) has finished moving its contents over to
   // m_reachable_objects.
   if (m_reachable_objects->marked(clazz)) {
+    // Replaying the visit calls push_cond() again, rather than this push().
+    auto* recorded_visit = std::exchange(m_recorded_visit, nullptr);
     push(clazz, method);
+    m_recorded_visit = recorded_visit;
   }
 }
 
@@ -332,13 +339,13 @@ void TransitiveClosureMarker::gather_and_push(DexMethod* meth) {
     check_strings = true;
   }
   if (m_ignore_sets.string_literals.count(type)) {
-    ++m_stats->num_ignore_check_strings;
+    count_ignore_check_strings();
     check_strings = false;
   }
   if (cls && check_strings) {
     for (const auto& ignore_anno_type : m_ignore_sets.string_literal_annos) {
       if (has_anno(cls, ignore_anno_type)) {
-        ++m_stats->num_ignore_check_strings;
+        count_ignore_check_strings();
         check_strings = false;
         break;
       }
@@ -353,6 +360,37 @@ void TransitiveClosureMarker::gather_and_push(DexMethod* meth) {
   for (auto* cond_meth : refs.cond_methods) {
     push_cond(cond_meth);
   }
+  gather_instantiation_facts(meth);
+}
+
+void TransitiveClosureMarker::gather_instantiation_facts(DexMethod* meth) {
+  auto* code = meth->get_code();
+  if (code == nullptr) {
+    return;
+  }
+  auto& facts = *m_reachable_objects->m_instantiation_facts;
+  editable_cfg_adapter::iterate(code, [&](MethodItemEntry& mie) {
+    auto insn = mie.insn;
+    auto op = insn->opcode();
+    if (op == OPCODE_NEW_INSTANCE || op == OPCODE_CONST_CLASS) {
+      facts.instantiated_types.insert(insn->get_type());
+      if (m_recorded_visit) {
+        m_recorded_visit->instantiated_types.push_back(insn->get_type());
+      }
+    } else if (op == OPCODE_INVOKE_SUPER) {
+      if (m_recorded_visit) {
+        m_recorded_visit->replayable = false;
+      }
+      auto callee_ref = insn->get_method();
+      auto callee = resolve_method(callee_ref, MethodSearch::Super, meth);
+      if (callee == nullptr) {
+        facts.unresolved_super_invoked_methods.insert(callee_ref);
+      } else {
+        facts.super_invoked_methods.insert(callee);
+      }
+    }
+    return editable_cfg_adapter::LOOP_CONTINUE;
+  });
 }
 
 template <typename T>
@@ -443,6 +481,10 @@ void TransitiveClosureMarker::visit_field_ref(const DexFieldRef* field) {
   }
   push(field, field->get_class());
   push(field, field->get_type());
+  auto f = field->as_def();
+  if (f) {
+    gather_and_push(f);
+  }
 }
 
 DexMethod* TransitiveClosureMarker::resolve_without_context(
@@ -481,6 +523,9 @@ void TransitiveClosureMarker::visit_method_ref(const DexMethodRef* method) {
       resolve_without_context(method, type_class(method->get_class()));
   if (resolved_method != nullptr) {
     TRACE(REACH, 5, "    Resolved to: %s", SHOW(resolved_method));
+    if (m_recorded_visit && resolved_method != method) {
+      m_recorded_visit->resolved = resolved_method;
+    }
     push(method, resolved_method);
     gather_and_push(resolved_method);
   }
@@ -513,6 +558,51 @@ void TransitiveClosureMarker::record_reachability(Parent* parent,
   }
 }
 
+template <class Object>
+void TransitiveClosureMarker::record_push(const Object* object) {
+  if (m_recorded_visit) {
+    m_recorded_visit->pushed.emplace_back(object);
+  }
+}
+
+void TransitiveClosureMarker::count_ignore_check_strings() {
+  ++m_stats->num_ignore_check_strings;
+  if (m_recorded_visit) {
+    ++m_recorded_visit->num_ignore_check_strings;
+  }
+}
+
+void TransitiveClosureMarker::replay(const RecordedVisit& visit) {
+  for (const auto& obj : visit.pushed) {
+    bool newly_marked = false;
+    switch (obj.type) {
+    case ReachableObjectType::CLASS:
+      newly_marked = m_reachable_objects->mark(obj.cls);
+      break;
+    case ReachableObjectType::FIELD:
+      newly_marked = m_reachable_objects->mark(obj.field);
+      break;
+    case ReachableObjectType::METHOD:
+      newly_marked = m_reachable_objects->mark(obj.method);
+      break;
+    case ReachableObjectType::ANNO:
+    case ReachableObjectType::SEED:
+      not_reached_log("Unexpected ReachableObject type");
+    }
+    if (newly_marked) {
+      m_worker_state->push_task(obj);
+    }
+  }
+  for (const auto* method : visit.cond_pushed) {
+    push_cond(method);
+  }
+  auto& facts = *m_reachable_objects->m_instantiation_facts;
+  for (const auto* type : visit.instantiated_types) {
+    facts.instantiated_types.insert(type);
+  }
+  m_stats->num_ignore_check_strings += visit.num_ignore_check_strings;
+}
+
 std::unique_ptr<ReachableObjects> compute_reachable_objects(
     const DexStoresVector& stores,
     const IgnoreSets& ignore_sets,
@@ -520,13 +610,22 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
     bool record_reachability,
     bool should_mark_all_as_seed,
     std::unique_ptr<const mog::Graph>* out_method_override_graph,
-    bool remove_no_argument_constructors) {
+    bool remove_no_argument_constructors,
+    MarkingHistory* history) {
   Timer t("Marking");
   auto scope = build_class_scope(stores);
-  auto reachable_objects = std::make_unique<ReachableObjects>();
+  auto reachable_objects = std::make_unique<ReachableObjects>(scope);
   ConditionallyMarked cond_marked;
   auto method_override_graph = mog::build_graph(scope);
 
+  if (history && (record_reachability || should_mark_all_as_seed)) {
+    history->clear();
+    history = nullptr;
+  }
+  if (history && !history->begin(scope, *method_override_graph)) {
+    TRACE(REACH, 1, "Marking from scratch");
+  }
+
   ConcurrentSet<ReachableObject, ReachableObjectHash> root_set;
   RootSetMarker root_set_marker(*method_override_graph,
                                 record_reachability,
@@ -539,6 +638,13 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
   } else {
     root_set_marker.mark(scope);
   }
+  if (history) {
+    for (const auto* cls : history->new_classes()) {
+      if (reachable_objects->mark(cls)) {
+        root_set.emplace(cls);
+      }
+    }
+  }
 
   size_t num_threads = redex_parallel::default_num_threads();
   auto stats_arr = std::make_unique<Stats[]>(num_threads);
@@ -549,7 +655,18 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
             &cond_marked, reachable_objects.get(), worker_state,
             &stats_arr[worker_state->worker_id()],
             remove_no_argument_constructors);
+        if (!history || obj.type == ReachableObjectType::CLASS) {
+          transitive_closure_marker.visit(obj);
+          return nullptr;
+        }
+        if (const auto* recorded_visit = history->replayable(obj)) {
+          transitive_closure_marker.replay(*recorded_visit);
+          return nullptr;
+        }
+        RecordedVisit visit;
+        transitive_closure_marker.record_visits(&visit);
         transitive_closure_marker.visit(obj);
+        history->record(obj, std::move(visit));
         return nullptr;
       },
       root_set,
@@ -562,6 +679,10 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
     }
   }
 
+  if (history) {
+    history->end(scope, *reachable_objects, *method_override_graph);
+  }
+
   if (out_method_override_graph) {
     *out_method_override_graph = std::move(method_override_graph);
   }
@@ -569,6 +690,449 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
   return reachable_objects;
 }
 
+namespace {
+
+std::vector<const DexFieldRef*> fields_of(const Scope& scope) {
+  std::vector<const DexFieldRef*> fields;
+  for (const auto* cls : scope) {
+    fields.insert(fields.end(), cls->get_sfields().begin(),
+                  cls->get_sfields().end());
+    fields.insert(fields.end(), cls->get_ifields().begin(),
+                  cls->get_ifields().end());
+  }
+  return fields;
+}
+
+std::vector<const DexMethodRef*> methods_of(const Scope& scope) {
+  std::vector<const DexMethodRef*> methods;
+  for (const auto* cls : scope) {
+    methods.insert(methods.end(), cls->get_dmethods().begin(),
+                   cls->get_dmethods().end());
+    methods.insert(methods.end(), cls->get_vmethods().begin(),
+                   cls->get_vmethods().end());
+  }
+  return methods;
+}
+
+} // namespace
+
+ReachableObjects::ReachableObjects(const Scope& scope)
+    : m_marked_classes(
+          std::vector<const DexClass*>(scope.begin(), scope.end())),
+      m_marked_fields(fields_of(scope)),
+      m_marked_methods(methods_of(scope)) {}
+
+namespace {
+
+template <class T>
+void hash_gathered(const T& t, size_t* seed) {
+  std::vector<const DexString*> strings;
+  std::vector<DexType*> types;
+  std::vector<DexFieldRef*> fields;
+  std::vector<DexMethodRef*> methods;
+  t.gather_strings(strings);
+  t.gather_types(types);
+  t.gather_fields(fields);
+  t.gather_methods(methods);
+  boost::hash_range(*seed, strings.begin(), strings.end());
+  boost::hash_range(*seed, types.begin(), types.end());
+  boost::hash_range(*seed, fields.begin(), fields.end());
+  boost::hash_range(*seed, methods.begin(), methods.end());
+}
+
+void hash_entry(const MethodItemEntry& mie, size_t* seed) {
+  switch (mie.type) {
+  case MFLOW_OPCODE: {
+    const auto* insn = mie.insn;
+    boost::hash_combine(*seed, static_cast<uint16_t>(insn->opcode()));
+    if (insn->has_string()) {
+      boost::hash_combine(*seed, insn->get_string());
+    } else if (insn->has_type()) {
+      boost::hash_combine(*seed, insn->get_type());
+    } else if (insn->has_field()) {
+      boost::hash_combine(*seed, insn->get_field());
+    } else if (insn->has_method()) {
+      boost::hash_combine(*seed, insn->get_method());
+    } else if (insn->has_callsite()) {
+      boost::hash_combine(*seed, insn->get_callsite());
+    } else if (insn->has_methodhandle()) {
+      boost::hash_combine(*seed, insn->get_methodhandle());
+    }
+    break;
+  }
+  case MFLOW_CATCH:
+    boost::hash_combine(*seed, mie.centry->catch_type);
+    break;
+  case MFLOW_DEBUG:
+    boost::hash_combine(*seed, mie.dbgop.get());
+    break;
+  case MFLOW_DEX_OPCODE:
+    boost::hash_combine(*seed, mie.dex_insn);
+    break;
+  default:
+    break;
+  }
+}
+
+// Covers the opcodes and the references of the code, which is all that
+// marking reads from it.
+void hash_code(const IRCode& code, size_t* seed) {
+  if (code.editable_cfg_built()) {
+    for (const auto* block : code.cfg().blocks()) {
+      for (const auto& mie : *block) {
+        hash_entry(mie, seed);
+      }
+    }
+    std::vector<DexType*> catch_types;
+    code.cfg().gather_catch_types(catch_types);
+    boost::hash_range(*seed, catch_types.begin(), catch_types.end());
+  } else {
+    for (const auto& mie : code) {
+      hash_entry(mie, seed);
+    }
+  }
+  if (const auto* dbg = code.get_debug_item()) {
+    std::vector<DexType*> types;
+    std::vector<const DexString*> strings;
+    dbg->gather_types(types);
+    dbg->gather_strings(strings);
+    boost::hash_range(*seed, types.begin(), types.end());
+    boost::hash_range(*seed, strings.begin(), strings.end());
+  }
+}
+
+size_t ref_fingerprint(const ReachableObject& obj) {
+  size_t seed = static_cast<size_t>(obj.type);
+  if (obj.type == ReachableObjectType::FIELD) {
+    const auto* field = obj.field;
+    boost::hash_combine(seed, field->get_class());
+    boost::hash_combine(seed, field->get_name());
+    boost::hash_combine(seed, field->get_type());
+    boost::hash_combine(seed, field->is_def());
+    if (const auto* def = field->as_def()) {
+      boost::hash_combine(seed, def->is_concrete());
+      boost::hash_combine(seed, static_cast<uint32_t>(def->get_access()));
+    }
+  } else {
+    always_assert(obj.type == ReachableObjectType::METHOD);
+    const auto* method = obj.method;
+    boost::hash_combine(seed, method->get_class());
+    boost::hash_combine(seed, method->get_name());
+    boost::hash_combine(seed, method->get_proto());
+    boost::hash_combine(seed, method->is_def());
+    if (const auto* def = method->as_def()) {
+      boost::hash_combine(seed, def->is_virtual());
+      boost::hash_combine(seed, def->is_concrete());
+      boost::hash_combine(seed, static_cast<uint32_t>(def->get_access()));
+    }
+  }
+  return seed;
+}
+
+// Whether strings are checked for class names depends on these.
+size_t annotation_types(const DexClass* cls) {
+  size_t seed = 0;
+  if (const auto* anno_set = cls->get_anno_set()) {
+    for (const auto& anno : anno_set->get_annotations()) {
+      boost::hash_combine(seed, anno->type());
+    }
+  }
+  return seed;
+}
+
+size_t field_fingerprint(const DexField* field) {
+  auto seed = ref_fingerprint(ReachableObject(field));
+  hash_gathered(*field, &seed);
+  return seed;
+}
+
+size_t method_fingerprint(const DexMethod* method, size_t class_annos) {
+  auto seed = ref_fingerprint(ReachableObject(method));
+  boost::hash_combine(seed, class_annos);
+  if (const auto* code = method->get_code()) {
+    hash_code(*code, &seed);
+  }
+  if (const auto* anno_set = method->get_anno_set()) {
+    hash_gathered(*anno_set, &seed);
+  }
+  if (const auto* param_annos = method->get_param_anno()) {
+    for (const auto& pair : *param_annos) {
+      boost::hash_combine(seed, pair.first);
+      hash_gathered(*pair.second, &seed);
+    }
+  }
+  return seed;
+}
+
+// Covers what resolving a reference through the class reads. Only the
+// :marked members count, if given.
+size_t class_fingerprint(const DexClass* cls,
+                         const ReachableObjects* marked = nullptr) {
+  size_t seed = 0;
+  boost::hash_combine(seed, cls->get_type());
+  boost::hash_combine(seed, cls->get_name());
+  boost::hash_combine(seed, cls->get_super_class());
+  for (const auto* intf : *cls->get_interfaces()) {
+    boost::hash_combine(seed, intf);
+  }
+  boost::hash_combine(seed, annotation_types(cls));
+  // Sweeping reorders the members, so their order does not count.
+  size_t members = 0;
+  auto hash_members = [&](const auto& list) {
+    for (const auto* member : list) {
+      if (marked && !marked->marked_unsafe(member)) {
+        continue;
+      }
+      size_t member_seed = 0;
+      boost::hash_combine(member_seed, member);
+      boost::hash_combine(member_seed,
+                          ref_fingerprint(ReachableObject(member)));
+      members += member_seed;
+    }
+  };
+  hash_members(cls->get_ifields());
+  hash_members(cls->get_sfields());
+  hash_members(cls->get_dmethods());
+  hash_members(cls->get_vmethods());
+  boost::hash_combine(seed, members);
+  return seed;
+}
+
+void fingerprint_scope(
+    const Scope& scope,
+    ConcurrentMap<ReachableObject, size_t, ReachableObjectHash>* out) {
+  walk::parallel::classes(scope, [&](const DexClass* cls) {
+    out->emplace(ReachableObject(cls), class_fingerprint(cls));
+    for (const auto* field : cls->get_ifields()) {
+      out->emplace(ReachableObject(field), field_fingerprint(field));
+    }
+    for (const auto* field : cls->get_sfields()) {
+      out->emplace(ReachableObject(field), field_fingerprint(field));
+    }
+    auto class_annos = annotation_types(cls);
+    for (const auto* method : cls->get_dmethods()) {
+      out->emplace(ReachableObject(method),
+                   method_fingerprint(method, class_annos));
+    }
+    for (const auto* method : cls->get_vmethods()) {
+      out->emplace(ReachableObject(method),
+                   method_fingerprint(method, class_annos));
+    }
+  });
+}
+
+} // namespace
+
+void MarkingHistory::clear() {
+  m_defs.clear();
+  m_refs.clear();
+  m_class_names.clear();
+  m_visits.clear();
+  m_method_override_graph = mog::Graph();
+  m_current.clear();
+  m_affected_types.clear();
+  m_new_classes.clear();
+  m_new_visits.clear();
+  m_num_replayed = 0;
+  m_num_visited = 0;
+}
+
+bool MarkingHistory::begin(const Scope& scope, const mog::Graph& graph) {
+  m_num_replayed = 0;
+  m_num_visited = 0;
+  if (empty()) {
+    return false;
+  }
+  fingerprint_scope(scope, &m_current);
+
+  std::unordered_set<const DexType*> changed_types;
+  for (const auto* cls : scope) {
+    ReachableObject obj(cls);
+    auto it = m_defs.find(obj);
+    if (it == m_defs.end()) {
+      m_new_classes.push_back(cls);
+      changed_types.insert(cls->get_type());
+    } else if (m_class_names.at(cls) != cls->get_name()) {
+      // Unchanged code may have named the class in a string.
+      TRACE(REACH, 1, "%s was renamed", SHOW(cls));
+      clear();
+      return false;
+    } else if (it->second != m_current.at_unsafe(obj)) {
+      changed_types.insert(cls->get_type());
+    }
+  }
+
+  // Resolving a reference goes through the class of the reference and through
+  // its super classes and interfaces.
+  std::unordered_map<const DexType*, bool> affected;
+  std::function<bool(const DexType*)> is_affected = [&](const DexType* type) {
+    auto it = affected.find(type);
+    if (it != affected.end()) {
+      return it->second;
+    }
+    affected[type] = false;
+    bool result = false;
+    if (const auto* cls = type_class(type)) {
+      result = changed_types.count(type) ||
+               (cls->get_super_class() && is_affected(cls->get_super_class()));
+      for (const auto* intf : *cls->get_interfaces()) {
+        result = result || is_affected(intf);
+      }
+    }
+    affected[type] = result;
+    return result;
+  };
+  for (const auto* cls : scope) {
+    if (is_affected(cls->get_type())) {
+      m_affected_types.insert(cls->get_type());
+    }
+  }
+
+  // Visiting a method looks up its overriders, so they must be the same if
+  // the method override graph changed, e.g. because of removed methods.
+  bool same_graph = graph.shares_storage_with(m_method_override_graph);
+  auto same_overriders = [&](const ReachableObject& obj,
+                             const RecordedVisit& visit) {
+    if (same_graph || obj.type != ReachableObjectType::METHOD) {
+      return true;
+    }
+    const auto* method = obj.method->as_def();
+    if (!method || (!method->is_virtual() && method->is_concrete())) {
+      return true;
+    }
+    auto overriders = mog::get_overriding_methods(graph, method);
+    auto recorded = visit.cond_pushed;
+    std::sort(overriders.begin(), overriders.end());
+    std::sort(recorded.begin(), recorded.end());
+    return overriders == recorded;
+  };
+
+  using Entry = std::pair<const ReachableObject, Recorded>;
+  std::vector<Entry*> entries;
+  entries.reserve(m_visits.size());
+  for (auto& entry : m_visits) {
+    entries.push_back(&entry);
+  }
+  workqueue_run<Entry*>(
+      [&](Entry* entry) {
+        const auto& visit = entry->second.visit;
+        auto pushed_exists = [this](const ReachableObject& obj) {
+          return exists(obj);
+        };
+        auto cond_pushed_exists = [this](const DexMethod* method) {
+          return exists(ReachableObject(method));
+        };
+        entry->second.replay =
+            unchanged(entry->first) && same_overriders(entry->first, visit) &&
+            (!visit.resolved || unchanged(ReachableObject(visit.resolved))) &&
+            std::all_of(visit.pushed.begin(), visit.pushed.end(),
+                        pushed_exists) &&
+            std::all_of(visit.cond_pushed.begin(), visit.cond_pushed.end(),
+                        cond_pushed_exists);
+      },
+      entries);
+  return true;
+}
+
+bool MarkingHistory::unchanged(const ReachableObject& obj) const {
+  if (m_current.count_unsafe(obj)) {
+    auto it = m_defs.find(obj);
+    return it != m_defs.end() && it->second == m_current.at_unsafe(obj);
+  }
+  if (m_defs.count(obj)) {
+    // It was removed from the scope.
+    return false;
+  }
+  auto it = m_refs.find(obj);
+  if (it == m_refs.end() || it->second != ref_fingerprint(obj)) {
+    return false;
+  }
+  const auto* type = obj.type == ReachableObjectType::FIELD
+                         ? obj.field->get_class()
+                         : obj.method->get_class();
+  return !m_affected_types.count(type);
+}
+
+bool MarkingHistory::exists(const ReachableObject& obj) const {
+  // All the objects of the scope that were marked have a fingerprint, so the
+  // ones without one are not part of the scope and are never deleted.
+  return m_current.count_unsafe(obj) || !m_defs.count(obj);
+}
+
+const RecordedVisit* MarkingHistory::replayable(const ReachableObject& obj) {
+  auto it = m_visits.find(obj);
+  if (it == m_visits.end() || !it->second.replay) {
+    return nullptr;
+  }
+  ++m_num_replayed;
+  return &it->second.visit;
+}
+
+void MarkingHistory::record(const ReachableObject& obj, RecordedVisit visit) {
+  ++m_num_visited;
+  if (visit.replayable) {
+    m_new_visits.emplace(obj, std::move(visit));
+  }
+}
+
+void MarkingHistory::end(const Scope& scope,
+                         const ReachableObjects& reachable_objects,
+                         const mog::Graph& graph) {
+  if (m_current.empty()) {
+    fingerprint_scope(scope, &m_current);
+  }
+  auto marked = [&](const ReachableObject& obj) {
+    return obj.type == ReachableObjectType::FIELD
+               ? reachable_objects.marked_unsafe(obj.field)
+               : reachable_objects.marked_unsafe(obj.method);
+  };
+  std::unordered_map<ReachableObject, Recorded, ReachableObjectHash> visits;
+  for (auto& pair : m_visits) {
+    // The marked objects whose visit could be replayed were replayed.
+    if (pair.second.replay && marked(pair.first)) {
+      visits.emplace(pair.first, std::move(pair.second));
+    }
+  }
+  for (auto& pair : m_new_visits) {
+    visits.emplace(pair.first, Recorded{std::move(pair.second)});
+  }
+  m_visits = std::move(visits);
+
+  m_defs.clear();
+  m_refs.clear();
+  m_class_names.clear();
+  for (const auto* cls : scope) {
+    if (reachable_objects.marked_unsafe(cls)) {
+      m_defs.emplace(ReachableObject(cls),
+                     class_fingerprint(cls, &reachable_objects));
+      m_class_names.emplace(cls, cls->get_name());
+    }
+    auto fingerprint_marked = [&](const auto& members) {
+      for (const auto* member : members) {
+        ReachableObject obj(member);
+        if (reachable_objects.marked_unsafe(member)) {
+          m_defs.emplace(obj, m_current.at_unsafe(obj));
+        }
+      }
+    };
+    fingerprint_marked(cls->get_ifields());
+    fingerprint_marked(cls->get_sfields());
+    fingerprint_marked(cls->get_dmethods());
+    fingerprint_marked(cls->get_vmethods());
+  }
+  for (const auto& pair : m_visits) {
+    if (!m_current.count_unsafe(pair.first)) {
+      m_refs.emplace(pair.first, ref_fingerprint(pair.first));
+    }
+  }
+  m_method_override_graph = graph;
+
+  m_current.clear();
+  m_affected_types.clear();
+  m_new_classes.clear();
+  m_new_visits.clear();
+}
+
 void ReachableObjects::record_reachability(const DexMethodRef* member,
                                            const DexClass* cls) {
   // Each class member trivially retains its containing class; let's filter out
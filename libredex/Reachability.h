@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "ConcurrentContainers.h"
 #include "DexClass.h"
@@ -91,36 +94,121 @@ using ReachableObjectSet =
 using ReachableObjectGraph =
     ConcurrentMap<ReachableObject, ReachableObjectSet, ReachableObjectHash>;
 
+/*
+ * The mark bits of one kind of object. The objects that are known up front get
+ * an index into a bit vector, and marking them is a single atomic operation;
+ * the index table is only read while marking. Any other object, e.g. a
+ * reference to an external method, is marked in a concurrent set instead.
+ */
+template <class Object>
+class MarkBits {
+ public:
+  MarkBits() = default;
+
+  explicit MarkBits(const std::vector<const Object*>& objects)
+      : m_bits((objects.size() + 63) / 64) {
+    m_indices.reserve(objects.size());
+    for (const auto* obj : objects) {
+      m_indices.emplace(obj, m_indices.size());
+    }
+  }
+
+  // Returns whether the object was not marked before.
+  bool mark(const Object* obj) {
+    auto it = m_indices.find(obj);
+    if (it == m_indices.end()) {
+      return m_others.insert(obj);
+    }
+    auto mask = uint64_t(1) << (it->second % 64);
+    return !(m_bits[it->second / 64].fetch_or(mask) & mask);
+  }
+
+  bool marked(const Object* obj) const {
+    auto it = m_indices.find(obj);
+    if (it == m_indices.end()) {
+      return m_others.count(obj);
+    }
+    return m_bits[it->second / 64].load() & (uint64_t(1) << (it->second % 64));
+  }
+
+  bool marked_unsafe(const Object* obj) const {
+    auto it = m_indices.find(obj);
+    if (it == m_indices.end()) {
+      return m_others.count_unsafe(obj);
+    }
+    return m_bits[it->second / 64].load(std::memory_order_relaxed) &
+           (uint64_t(1) << (it->second % 64));
+  }
+
+  size_t size() const {
+    size_t size = m_others.size();
+    for (const auto& word : m_bits) {
+      size += __builtin_popcountll(word.load(std::memory_order_relaxed));
+    }
+    return size;
+  }
+
+ private:
+  std::unordered_map<const Object*, uint32_t> m_indices;
+  std::vector<std::atomic<uint64_t>> m_bits;
+  ConcurrentSet<const Object*> m_others;
+};
+
+/*
+ * What the code of the reachable methods instantiates and invokes as super.
+ * Since only reachable methods survive the sweep, this covers all the code
+ * that is left afterwards, so that passes can use it instead of scanning all
+ * of it again.
+ */
+struct InstantiationFacts {
+  // Types of new-instance and const-class instructions.
+  ConcurrentSet<const DexType*> instantiated_types;
+  // Targets of invoke-super instructions, and the ones that did not resolve.
+  ConcurrentSet<const DexMethod*> super_invoked_methods;
+  ConcurrentSet<const DexMethodRef*> unresolved_super_invoked_methods;
+};
+
 class ReachableObjects {
  public:
+  ReachableObjects() = default;
+
+  // Gives mark bits to the classes of the scope and to their members.
+  explicit ReachableObjects(const Scope& scope);
+
   const ReachableObjectGraph& retainers_of() const { return m_retainers_of; }
 
-  void mark(const DexClass* cls) { m_marked_classes.insert(cls); }
+  // These return whether the object was not marked before.
+
+  bool mark(const DexClass* cls) { return m_marked_classes.mark(cls); }
 
-  void mark(const DexMethodRef* method) { m_marked_methods.insert(method); }
+  bool mark(const DexMethodRef* method) {
+    return m_marked_methods.mark(method);
+  }
 
-  void mark(const DexFieldRef* field) { m_marked_fields.insert(field); }
+  bool mark(const DexFieldRef* field) { return m_marked_fields.mark(field); }
 
-  bool marked(const DexClass* cls) const { return m_marked_classes.count(cls); }
+  bool marked(const DexClass* cls) const {
+    return m_marked_classes.marked(cls);
+  }
 
   bool marked(const DexMethodRef* method) const {
-    return m_marked_methods.count(method);
+    return m_marked_methods.marked(method);
   }
 
   bool marked(const DexFieldRef* field) const {
-    return m_marked_fields.count(field);
+    return m_marked_fields.marked(field);
   }
 
   bool marked_unsafe(const DexClass* cls) const {
-    return m_marked_classes.count_unsafe(cls);
+    return m_marked_classes.marked_unsafe(cls);
   }
 
   bool marked_unsafe(const DexMethodRef* method) const {
-    return m_marked_methods.count_unsafe(method);
+    return m_marked_methods.marked_unsafe(method);
   }
 
   bool marked_unsafe(const DexFieldRef* field) const {
-    return m_marked_fields.count_unsafe(field);
+    return m_marked_fields.marked_unsafe(field);
   }
 
   size_t num_marked_classes() const { return m_marked_classes.size(); }
@@ -129,6 +217,10 @@ class ReachableObjects {
 
   size_t num_marked_methods() const { return m_marked_methods.size(); }
 
+  const std::shared_ptr<InstantiationFacts>& instantiation_facts() const {
+    return m_instantiation_facts;
+  }
+
  private:
   template <class Seed>
   void record_is_seed(Seed* seed);
@@ -143,10 +235,12 @@ class ReachableObjects {
 
   void record_reachability(const DexMethodRef* member, const DexClass* cls);
 
-  ConcurrentSet<const DexClass*> m_marked_classes;
-  ConcurrentSet<const DexFieldRef*> m_marked_fields;
-  ConcurrentSet<const DexMethodRef*> m_marked_methods;
+  MarkBits<DexClass> m_marked_classes;
+  MarkBits<DexFieldRef> m_marked_fields;
+  MarkBits<DexMethodRef> m_marked_methods;
   ReachableObjectGraph m_retainers_of;
+  std::shared_ptr<InstantiationFacts> m_instantiation_facts{
+      std::make_shared<InstantiationFacts>()};
 
   friend class RootSetMarker;
   friend class TransitiveClosureMarker;
@@ -167,6 +261,24 @@ struct References {
   std::vector<const DexMethod*> cond_methods;
 };
 
+/*
+ * What the visit of a field or method did, so that a later marking can replay
+ * it instead of visiting the object again. See MarkingHistory.
+ */
+struct RecordedVisit {
+  // The objects passed to push(), whether they were marked already or not.
+  std::vector<ReachableObject> pushed;
+  // The methods passed to push_cond().
+  std::vector<const DexMethod*> cond_pushed;
+  std::vector<const DexType*> instantiated_types;
+  // The method that a method reference resolved to, if it is another one.
+  const DexMethod* resolved{nullptr};
+  int num_ignore_check_strings{0};
+  // Resolving invoke-super depends on the class hierarchy, so visits of code
+  // that has one are not replayed.
+  bool replayable{true};
+};
+
 // Each thread will have its own instance of Stats, so align it in order to
 // avoid false sharing.
 struct alignas(CACHE_LINE_SIZE) Stats {
@@ -180,8 +292,8 @@ using MarkWorkerState = sparta::SpartaWorkerState<ReachableObject>;
  *
  * Conceptually we start at roots, which are defined by -keep rules in the
  * config file, and perform a depth-first search to find all references.
- * Elements visited in this manner will be retained, and are found in the
- * m_marked_* sets.
+ * Elements visited in this manner will be retained, and are marked in
+ * ReachableObjects.
  *
  * -keepclassmembers rules are a bit more complicated, because they require
  * "conditional" marking: these members are kept only if their containing class
@@ -280,6 +392,16 @@ class TransitiveClosureMarker {
 
   void visit_field_ref(const DexFieldRef* field);
 
+  /*
+   * Records what the next visits do into :visit, until it is called again.
+   */
+  void record_visits(RecordedVisit* visit) { m_recorded_visit = visit; }
+
+  /*
+   * Has the same effect as the visit that :visit recorded.
+   */
+  void replay(const RecordedVisit& visit);
+
   virtual References gather(const DexAnnotation* anno) const;
 
   virtual References gather(const DexMethod* method) const;
@@ -312,6 +434,8 @@ class TransitiveClosureMarker {
 
   void gather_and_push(DexMethod* meth);
 
+  void gather_instantiation_facts(DexMethod* meth);
+
   template <typename T>
   void gather_and_push(T t);
 
@@ -322,6 +446,11 @@ class TransitiveClosureMarker {
   template <class Parent, class Object>
   void record_reachability(Parent* parent, Object* object);
 
+  template <class Object>
+  void record_push(const Object* object);
+
+  void count_ignore_check_strings();
+
   /*
    * Resolve the method reference more conservatively without the context of the
    * call, such as call instruction, target type and the caller method.
@@ -337,13 +466,99 @@ class TransitiveClosureMarker {
   MarkWorkerState* m_worker_state;
   Stats* m_stats;
   bool m_remove_no_argument_constructors;
+  RecordedVisit* m_recorded_visit{nullptr};
 
   static DexMethodRef* s_class_forname;
 };
 
+/*
+ * The state that incremental marking keeps from one marking to the next: the
+ * recorded visits of the marked fields and methods, and fingerprints of what
+ * these visits depend on.
+ *
+ * A marking from a history still starts from the roots and still visits all
+ * the classes it reaches, so that removed roots and conditionally marked
+ * members are handled as usual. But it replays the recorded visit of a field
+ * or method instead of gathering its references again, unless the object
+ * changed, or resolving it goes through a class whose members changed, or the
+ * visit pushed an object that no longer exists or looked up overriders that
+ * changed since. The classes that did not exist at the last marking are marked
+ * unconditionally, since unchanged code may reach them through their name.
+ * Otherwise the result is the one of a marking from scratch. The history is
+ * dropped, and the marking starts from scratch, when a class was renamed.
+ */
+class MarkingHistory {
+ public:
+  bool empty() const { return m_defs.empty(); }
+
+  void clear();
+
+  // How many fields and methods the last marking replayed and visited.
+  size_t num_replayed() const { return m_num_replayed; }
+  size_t num_visited() const { return m_num_visited; }
+
+  /*
+   * Prepares a marking of :scope. Returns false, after clearing the history,
+   * if the marking has to start from scratch.
+   */
+  bool begin(const Scope& scope, const method_override_graph::Graph& graph);
+
+  // The classes of the scope that did not exist at the last marking.
+  const std::vector<const DexClass*>& new_classes() const {
+    return m_new_classes;
+  }
+
+  // The recorded visit of :obj, if it can be replayed.
+  const RecordedVisit* replayable(const ReachableObject& obj);
+
+  void record(const ReachableObject& obj, RecordedVisit visit);
+
+  /*
+   * Keeps the visits of the objects that the marking of :scope marked, for
+   * the next marking.
+   */
+  void end(const Scope& scope,
+           const ReachableObjects& reachable_objects,
+           const method_override_graph::Graph& graph);
+
+ private:
+  struct Recorded {
+    RecordedVisit visit;
+    bool replay{false};
+  };
+
+  using Fingerprints =
+      std::unordered_map<ReachableObject, size_t, ReachableObjectHash>;
+
+  bool unchanged(const ReachableObject& obj) const;
+
+  bool exists(const ReachableObject& obj) const;
+
+  // Of the marked classes of the scope and of their marked members.
+  Fingerprints m_defs;
+  // Of the other objects that have a recorded visit, e.g. external methods.
+  Fingerprints m_refs;
+  std::unordered_map<const DexClass*, const DexString*> m_class_names;
+  std::unordered_map<ReachableObject, Recorded, ReachableObjectHash> m_visits;
+  method_override_graph::Graph m_method_override_graph;
+
+  // The state of the current marking.
+  ConcurrentMap<ReachableObject, size_t, ReachableObjectHash> m_current;
+  std::unordered_set<const DexType*> m_affected_types;
+  std::vector<const DexClass*> m_new_classes;
+  ConcurrentMap<ReachableObject, RecordedVisit, ReachableObjectHash>
+      m_new_visits;
+  std::atomic<size_t> m_num_replayed{0};
+  std::atomic<size_t> m_num_visited{0};
+};
+
 /*
  * Compute all reachable objects from the existing configurations
  * (e.g. proguard rules).
+ *
+ * With a :history that is not empty, the marking reuses the previous one; see
+ * MarkingHistory. The history is not used when recording reachability or
+ * marking everything as seed.
  */
 std::unique_ptr<ReachableObjects> compute_reachable_objects(
     const DexStoresVector& stores,
@@ -353,7 +568,8 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
     bool should_mark_all_as_seed = false,
     std::unique_ptr<const method_override_graph::Graph>*
         out_method_override_graph = nullptr,
-    bool remove_no_argument_constructors = false);
+    bool remove_no_argument_constructors = false,
+    MarkingHistory* history = nullptr);
 
 void sweep(DexStoresVector& stores,
            const ReachableObjects& reachables,
@@ -21,6 +21,7 @@
 #include "Match.h"
 #include "RedexResources.h"
 #include "ReflectionAnalysis.h"
+#include "ResourceScanCache.h"
 #include "Show.h"
 #include "StringUtil.h"
 #include "Trace.h"
@@ -529,7 +530,8 @@ void mark_reachable_by_xml(const std::string& classname) {
 // 2) Marks candidate methods that could be called via android:onClick
 // attributes.
 void analyze_reachable_from_xml_layouts(const Scope& scope,
-                                        const std::string& apk_dir) {
+                                        const std::string& apk_dir,
+                                        ResourceScanCache* cache = nullptr) {
   std::unordered_set<std::string> layout_classes;
   std::unordered_set<std::string> attrs_to_read;
   // Method names used by reflection
@@ -537,7 +539,7 @@ void analyze_reachable_from_xml_layouts(const Scope& scope,
   std::unordered_multimap<std::string, std::string> attribute_values;
   auto resources = create_resource_reader(apk_dir);
   resources->collect_layout_classes_and_attributes(
-      attrs_to_read, &layout_classes, &attribute_values);
+      attrs_to_read, &layout_classes, &attribute_values, cache);
   for (const std::string& classname : layout_classes) {
     TRACE(PGR, 3, "xml_layout: %s", classname.c_str());
     mark_reachable_by_xml(classname);
@@ -657,20 +659,22 @@ void init_reachable_classes(const Scope& scope,
   }
 
   if (!config.apk_dir.empty()) {
+    auto cache = ResourceScanCache::create(config.resource_scan_cache_dir);
     if (config.compute_xml_reachability) {
       Timer t{"Computing XML reachability"};
       // Classes present in manifest
       analyze_reachable_from_manifest(config.apk_dir,
                                       config.prune_unexported_components);
       // Classes present in XML layouts
-      analyze_reachable_from_xml_layouts(scope, config.apk_dir);
+      analyze_reachable_from_xml_layouts(scope, config.apk_dir, cache.get());
     }
 
     if (config.analyze_native_lib_reachability) {
       Timer t{"Computing native reachability"};
       // Classnames present in native libraries (lib/*/*.so)
       auto resources = create_resource_reader(config.apk_dir);
-      for (const std::string& classname : resources->get_native_classes()) {
+      for (const std::string& classname :
+           resources->get_native_classes(cache.get())) {
         auto type = DexType::get_type(classname.c_str());
         if (type == nullptr) continue;
         TRACE(PGR, 3, "native_lib: %s", classname.c_str());
@@ -682,6 +686,10 @@ void init_reachable_classes(const Scope& scope,
         mark_native_classes_from_fbjni_configs(config.fbjni_json_files);
       }
     }
+    if (cache != nullptr) {
+      TRACE(PGR, 1, "Resource scan cache: %zu hits, %zu misses", cache->hits(),
+            cache->misses());
+    }
     walk::methods(scope, [&](DexMethod* meth) {
       // These were probably already marked by the native lib reachability
       // analysis above, but just to be doubly sure...
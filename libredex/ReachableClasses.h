@@ -22,6 +22,9 @@ struct ReachableClassesConfig {
   std::vector<std::string> keep_methods;
   std::vector<std::string> json_serde_supercls;
   std::vector<std::string> fbjni_json_files;
+  // Where to cache the classes found in layouts and native libraries across
+  // builds, see ResourceScanCache. Empty disables the cache.
+  std::string resource_scan_cache_dir;
 
   ReachableClassesConfig() {}
 
@@ -37,6 +40,7 @@ struct ReachableClassesConfig {
     config.get("keep_methods", {}, keep_methods);
     config.get("json_serde_supercls", {}, json_serde_supercls);
     config.get("fbjni_json_files", {}, fbjni_json_files);
+    config.get("resource_scan_cache_dir", "", resource_scan_cache_dir);
   }
 };
 
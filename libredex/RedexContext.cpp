@@ -19,9 +19,12 @@
 #include "DexPosition.h"
 #include "DuplicateClasses.h"
 #include "KeepReason.h"
+#include "MethodAnalysisCache.h"
 #include "ProguardConfiguration.h"
 #include "Show.h"
+#include "SourceBlockValsArena.h"
 #include "Trace.h"
+#include "VirtualScope.h"
 
 static_assert(std::is_same<DexTypeList::ContainerType,
                            RedexContext::DexTypeListContainerType>::value);
@@ -29,54 +32,35 @@ static_assert(std::is_same<DexTypeList::ContainerType,
 RedexContext* g_redex;
 
 RedexContext::RedexContext(bool allow_class_duplicates)
-    : m_allow_class_duplicates(allow_class_duplicates) {}
+    : m_method_analysis_cache(std::make_unique<MethodAnalysisCache>()),
+      m_sb_vals_arena(std::make_unique<SourceBlockValsArena>()),
+      m_class_scopes_cache(std::make_unique<ClassScopesCache>()),
+      m_allow_class_duplicates(allow_class_duplicates) {}
 
 RedexContext::~RedexContext() {
-  // Delete DexStrings.
-  for (auto& segment : s_string_map) {
-    for (auto const& p : segment) {
-      delete p.second;
-    }
-  }
-  // Delete DexTypes.  NB: This table intentionally contains aliases (multiple
-  // DexStrings map to the same DexType), so we have to dedup the set of types
-  // before deleting to avoid double-frees.
-  std::unordered_set<DexType*> delete_types;
-  for (auto const& p : s_type_map) {
-    delete_types.emplace(p.second);
-  }
-  for (auto const& t : delete_types) {
-    delete t;
-  }
-  // Delete DexFields. Use set to prevent double freeing aliases
-  std::unordered_set<DexField*> delete_fields;
-  for (auto const& it : s_field_map) {
-    delete_fields.emplace(static_cast<DexField*>(it.second));
-  }
-  for (auto const& f : delete_fields) {
-    delete f;
-  }
-  // Delete DexTypeLists.
-  std::vector<const DexTypeListContainerType*> keys;
-  keys.reserve(s_typelist_map.size());
+  // DexStrings live in the arena, but own their characters.
+  s_string_map.for_each([](std::string_view, const DexString* dexstring) {
+    dexstring->~DexString();
+  });
+  // DexTypes, DexTypeLists and DexProtos go with the arena.
+  static_assert(std::is_trivially_destructible<DexType>::value);
+  static_assert(std::is_trivially_destructible<DexTypeList>::value);
+  static_assert(std::is_trivially_destructible<DexProto>::value);
   for (auto const& p : s_typelist_map) {
-    delete p.second;
-    keys.push_back(p.first);
-  }
-  for (auto* p : keys) {
-    delete p;
+    delete p.first;
   }
-  // Delete DexProtos.
-  for (auto const& p : s_proto_map) {
-    delete p.second;
+  // Delete DexFields and DexMethods. The tables also map aliases (e.g. the
+  // deobfuscated names) to them, so only the entry under a member's own spec
+  // owns it.
+  for (auto const& it : s_field_map) {
+    if (it.first == it.second->m_spec) {
+      delete static_cast<DexField*>(it.second);
+    }
   }
-  // Delete DexMethods. Use set to prevent double freeing aliases
-  std::unordered_set<DexMethod*> delete_methods;
   for (auto const& it : s_method_map) {
-    delete_methods.emplace(static_cast<DexMethod*>(it.second));
-  }
-  for (auto const& m : delete_methods) {
-    delete m;
+    if (it.first == it.second->m_spec) {
+      delete static_cast<DexMethod*>(it.second);
+    }
   }
   // Delete DexClasses.
   for (auto const& it : m_type_to_class) {
@@ -93,6 +77,13 @@ RedexContext::~RedexContext() {
   delete m_position_pattern_switch_manager;
 }
 
+// For objects in the arena of the context: a losing insert only destroys the
+// object, its memory stays in the arena.
+template <class T>
+struct ArenaDeleter {
+  void operator()(T* p) const { p->~T(); }
+};
+
 /*
  * Try and insert (:key, :value) into :container. This insertion may fail if
  * another thread has already inserted that key. In that case, return the
@@ -118,9 +109,7 @@ static StoredValue* try_insert(Key key,
 }
 
 const DexString* RedexContext::make_string(std::string_view str) {
-  auto& segment = s_string_map.at(str);
-
-  auto rv = segment.get(str, nullptr);
+  auto rv = s_string_map.get(str);
   if (rv != nullptr) {
     return rv;
   }
@@ -128,43 +117,50 @@ const DexString* RedexContext::make_string(std::string_view str) {
   // std::string. The string_view is valid until a the string is destroyed, or
   // until a non-const function is called on the string (but note the
   // std::string itself is const)
-  auto dexstring = new DexString(std::string(str));
+  auto dexstring = arena_new<DexString>(std::string(str));
   auto p2 = std::string_view(dexstring->c_str(), str.size());
-  return try_insert<DexString, const DexString>(p2, dexstring, &segment);
+  auto [stored, inserted] = s_string_map.get_or_emplace(p2, dexstring);
+  if (!inserted) {
+    // Its memory stays in the arena.
+    dexstring->~DexString();
+  }
+  return stored;
 }
 
 const DexString* RedexContext::get_string(std::string_view str) {
-  auto& segment = s_string_map.at(str);
-  return segment.get(str, nullptr);
+  return s_string_map.get(str);
 }
 
 DexType* RedexContext::make_type(const DexString* dstring) {
   always_assert(dstring != nullptr);
-  auto rv = s_type_map.get(dstring, nullptr);
+  auto rv = s_type_map.get(dstring);
   if (rv != nullptr) {
     return rv;
   }
-  return try_insert(dstring, new DexType(dstring), &s_type_map);
+  auto type = arena_new<DexType>(dstring);
+  type->m_id = m_next_type_id++;
+  return s_type_map.get_or_emplace(dstring, type).first;
 }
 
 DexType* RedexContext::get_type(const DexString* dstring) {
   if (dstring == nullptr) {
     return nullptr;
   }
-  return s_type_map.get(dstring, nullptr);
+  return s_type_map.get(dstring);
 }
 
 void RedexContext::set_type_name(DexType* type, const DexString* new_name) {
   alias_type_name(type, new_name);
   type->m_name = new_name;
+  m_type_names_epoch.fetch_add(1);
 }
 
 void RedexContext::alias_type_name(DexType* type, const DexString* new_name) {
   always_assert_log(
-      !s_type_map.count(new_name),
+      s_type_map.get(new_name) == nullptr,
       "Bailing, attempting to alias a symbol that already exists! '%s'\n",
       new_name->c_str());
-  s_type_map.emplace(new_name, type);
+  s_type_map.get_or_emplace(new_name, type);
 }
 
 void RedexContext::remove_type_name(const DexString* name) {
@@ -183,6 +179,7 @@ DexFieldRef* RedexContext::make_field(const DexType* container,
   }
   auto field = new DexField(const_cast<DexType*>(container), name,
                             const_cast<DexType*>(type));
+  field->m_id = m_next_field_id++;
   return try_insert<DexField, DexFieldRef>(r, field, &s_field_map);
 }
 
@@ -209,6 +206,7 @@ void RedexContext::alias_field_name(DexFieldRef* field,
 
 void RedexContext::erase_field(DexFieldRef* field) {
   s_field_map.erase(field->m_spec);
+  m_qualified_field_names.erase(field);
   // Also remove the alias from the map
   if (field->is_def()) {
     if (field->DexFieldRef::as_def()->get_deobfuscated_name_or_null() !=
@@ -235,6 +233,7 @@ void RedexContext::mutate_field(DexFieldRef* field,
   std::lock_guard<std::mutex> lock(s_field_lock);
   DexFieldSpec& r = field->m_spec;
   s_field_map.erase(r);
+  m_qualified_field_names.erase(field);
   r.cls = ref.cls != nullptr ? ref.cls : field->m_spec.cls;
   r.name = ref.name != nullptr ? ref.name : field->m_spec.name;
   r.type = ref.type != nullptr ? ref.type : field->m_spec.type;
@@ -263,8 +262,9 @@ DexTypeList* RedexContext::make_type_list(
   if (rv != nullptr) {
     return rv;
   }
-  auto typelist = new DexTypeList(on_heap.get());
-  auto ret = try_insert(typelist->m_list, typelist, &s_typelist_map);
+  auto typelist = arena_new<DexTypeList>(on_heap.get());
+  auto ret = try_insert<DexTypeList, DexTypeList, ArenaDeleter<DexTypeList>>(
+      typelist->m_list, typelist, &s_typelist_map);
   if (ret == typelist) {
     (void)on_heap.release();
   }
@@ -285,11 +285,11 @@ DexProto* RedexContext::make_proto(const DexType* rtype,
   if (rv != nullptr) {
     return rv;
   }
-  return try_insert(key,
-                    new DexProto(const_cast<DexType*>(rtype),
-                                 const_cast<DexTypeList*>(args),
-                                 shorty),
-                    &s_proto_map);
+  return try_insert<DexProto, DexProto, ArenaDeleter<DexProto>>(
+      key,
+      arena_new<DexProto>(const_cast<DexType*>(rtype),
+                          const_cast<DexTypeList*>(args), shorty),
+      &s_proto_map);
 }
 
 DexProto* RedexContext::get_proto(const DexType* rtype,
@@ -315,8 +315,10 @@ DexMethodRef* RedexContext::make_method(const DexType* type_,
   if (rv != nullptr) {
     return rv;
   }
+  auto method = new DexMethod(type, name, proto);
+  method->m_id = m_next_method_id++;
   return try_insert<DexMethod, DexMethodRef, DexMethod::Deleter>(
-      r, new DexMethod(type, name, proto), &s_method_map);
+      r, method, &s_method_map);
 }
 
 DexMethodRef* RedexContext::get_method(const DexType* type,
@@ -342,6 +344,8 @@ void RedexContext::alias_method_name(DexMethodRef* method,
 
 void RedexContext::erase_method(DexMethodRef* method) {
   s_method_map.erase(method->m_spec);
+  m_qualified_method_names.erase(method);
+  m_method_analysis_cache->invalidate(method);
   // Also remove the alias from the map
   if (method->is_def()) {
     if (method->DexMethodRef::as_def()->get_deobfuscated_name_or_null() !=
@@ -369,6 +373,7 @@ void RedexContext::mutate_method(DexMethodRef* method,
   std::lock_guard<std::mutex> lock(s_method_lock);
   DexMethodSpec old_spec = method->m_spec;
   s_method_map.erase(method->m_spec);
+  m_qualified_method_names.erase(method);
 
   DexMethodSpec& r = method->m_spec;
   r.cls = new_spec.cls != nullptr ? new_spec.cls : method->m_spec.cls;
@@ -446,6 +451,34 @@ void RedexContext::mutate_method(DexMethodRef* method,
   s_method_map.emplace(r, method);
 }
 
+namespace {
+
+template <typename Ref, typename QualifiedName>
+const DexString* get_or_compute_qualified_name(
+    const Ref* ref,
+    uint32_t epoch,
+    ConcurrentMap<const Ref*, QualifiedName>* names) {
+  auto cached = names->get(ref, QualifiedName{nullptr, 0});
+  if (cached.name != nullptr && cached.epoch == epoch) {
+    return cached.name;
+  }
+  auto name = DexString::make_string(show(ref));
+  names->insert_or_assign(std::make_pair(ref, QualifiedName{name, epoch}));
+  return name;
+}
+
+} // namespace
+
+const DexString* RedexContext::get_qualified_name(const DexFieldRef* field) {
+  return get_or_compute_qualified_name(field, m_type_names_epoch.load(),
+                                       &m_qualified_field_names);
+}
+
+const DexString* RedexContext::get_qualified_name(const DexMethodRef* method) {
+  return get_or_compute_qualified_name(method, m_type_names_epoch.load(),
+                                       &m_qualified_method_names);
+}
+
 PositionPatternSwitchManager*
 RedexContext::get_position_pattern_switch_manager() {
   if (!m_position_pattern_switch_manager) {
@@ -458,57 +491,55 @@ RedexContext::get_position_pattern_switch_manager() {
 // Return true on benign duplicate classes
 // Throw RedexException on problematic duplicate classes
 bool RedexContext::class_already_loaded(DexClass* cls) {
-  std::lock_guard<std::mutex> l(m_type_system_mutex);
-  const DexType* type = cls->get_type();
-  const auto& it = m_type_to_class.find(type);
-  if (it == m_type_to_class.end()) {
-    return false;
+  DexType* type = cls->get_type();
+  auto prev = type->m_class.load(std::memory_order_acquire);
+  if (prev == nullptr) {
+    // The first claim of the type wins, without taking the lock.
+    if (type->m_claimed_class.compare_exchange_strong(
+            prev, cls, std::memory_order_acq_rel)) {
+      return false;
+    }
+  }
+  const auto& prev_loc = prev->get_location();
+  const auto& cur_loc = cls->get_location();
+  if (prev_loc == cur_loc || dup_classes::is_known_dup(cls)) {
+    // benign duplicates
+    TRACE(MAIN, 1, "Warning: found a duplicate class: %s", SHOW(cls));
   } else {
-    const auto& prev_loc = it->second->get_location();
-    const auto& cur_loc = cls->get_location();
-    if (prev_loc == cur_loc || dup_classes::is_known_dup(cls)) {
-      // benign duplicates
-      TRACE(MAIN, 1, "Warning: found a duplicate class: %s", SHOW(cls));
-    } else {
-      const std::string& class_name = show(cls);
-      TRACE(MAIN,
-            1,
-            "Found a duplicate class: %s in two dexes:\ndex 1: %s\ndex "
-            "2: %s\n",
-            class_name.c_str(),
-            prev_loc.c_str(),
-            cur_loc.c_str());
-
-      if (!m_allow_class_duplicates) {
-        throw RedexException(
-            RedexError::DUPLICATE_CLASSES,
-            "Found duplicate class in two different files.",
-            {{"class", class_name}, {"dex1", prev_loc}, {"dex2", cur_loc}});
-      }
+    const std::string& class_name = show(cls);
+    TRACE(MAIN,
+          1,
+          "Found a duplicate class: %s in two dexes:\ndex 1: %s\ndex "
+          "2: %s\n",
+          class_name.c_str(),
+          prev_loc.c_str(),
+          cur_loc.c_str());
+
+    if (!m_allow_class_duplicates) {
+      throw RedexException(
+          RedexError::DUPLICATE_CLASSES,
+          "Found duplicate class in two different files.",
+          {{"class", class_name}, {"dex1", prev_loc}, {"dex2", cur_loc}});
     }
-    return true;
   }
+  return true;
 }
 
 void RedexContext::publish_class(DexClass* cls) {
   std::lock_guard<std::mutex> l(m_type_system_mutex);
-  const DexType* type = cls->get_type();
-  const auto& pair = m_type_to_class.emplace(type, cls);
-  bool insertion_took_place = pair.second;
+  DexType* type = cls->get_type();
+  bool insertion_took_place = m_type_to_class.emplace(type, cls).second;
   always_assert_log(insertion_took_place,
                     "No insertion for class: %s with deobfuscated name: %s",
                     cls->get_name()->c_str(),
                     cls->get_deobfuscated_name().c_str());
+  // Publish the class last, as readers of the slot do not take the lock.
+  type->m_class.store(cls, std::memory_order_release);
   if (cls->is_external()) {
     m_external_classes.emplace_back(cls);
   }
 }
 
-DexClass* RedexContext::type_class(const DexType* t) {
-  auto it = m_type_to_class.find(t);
-  return it != m_type_to_class.end() ? it->second : nullptr;
-}
-
 void RedexContext::set_field_value(DexField* field,
                                    keep_rules::AssumeReturnValue& val) {
   field_values.emplace(field,
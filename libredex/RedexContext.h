@@ -8,6 +8,7 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <boost/functional/hash.hpp>
 #include <cstring>
 #include <deque>
@@ -15,17 +16,21 @@
 #include <limits>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <string_view>
 #include <unordered_map>
 #include <vector>
 
+#include "ConcurrentArena.h"
 #include "ConcurrentContainers.h"
 #include "Debug.h"
 #include "DexMemberRefs.h"
 #include "FrequentlyUsedPointersCache.h"
+#include "InternTable.h"
 
+class ClassScopesCache;
 class DexCallSite;
 class DexClass;
 class DexDebugInstruction;
@@ -38,7 +43,9 @@ class DexProto;
 class DexString;
 class DexType;
 class DexTypeList;
+class MethodAnalysisCache;
 class PositionPatternSwitchManager;
+class SourceBlockValsArena;
 struct DexDebugEntry;
 struct DexFieldSpec;
 struct DexPosition;
@@ -131,8 +138,32 @@ struct RedexContext {
                      const DexMethodSpec& new_spec,
                      bool rename_on_collision);
 
+  // The interned qualified names of refs, as show() prints them. See
+  // DexFieldRef::get_qualified_name and DexMethodRef::get_qualified_name.
+  const DexString* get_qualified_name(const DexFieldRef* field);
+  const DexString* get_qualified_name(const DexMethodRef* method);
+
   PositionPatternSwitchManager* get_position_pattern_switch_manager();
 
+  // The results of intraprocedural analyses of methods, kept for as long as
+  // the code they were computed on does not change.
+  MethodAnalysisCache& method_analysis_cache() {
+    return *m_method_analysis_cache;
+  }
+
+  // The interned values of SourceBlocks.
+  SourceBlockValsArena& sb_vals_arena() { return *m_sb_vals_arena; }
+
+  // The last ClassScopes built by ClassScopes::get_or_build.
+  ClassScopesCache& class_scopes_cache() { return *m_class_scopes_cache; }
+
+  // Upper bounds of the ids of the DexTypes, DexFieldRefs and DexMethodRefs
+  // created so far. Ids are handed out in order of creation, so they are
+  // dense, with rare gaps from concurrent creations of the same reference.
+  uint32_t num_type_ids() const { return m_next_type_id.load(); }
+  uint32_t num_field_ids() const { return m_next_field_id.load(); }
+  uint32_t num_method_ids() const { return m_next_method_id.load(); }
+
   // Return false on unique classes
   // Return true on benign duplicate classes
   // Throw RedexException on problematic duplicate classes
@@ -140,7 +171,6 @@ struct RedexContext {
 
   void publish_class(DexClass* cls);
 
-  DexClass* type_class(const DexType* t);
   template <class TypeClassWalkerFn = void(const DexType*, const DexClass*)>
   void walk_type_class(TypeClassWalkerFn walker) {
     for (const auto& type_cls : m_type_to_class) {
@@ -204,87 +234,31 @@ struct RedexContext {
   bool instrument_mode{false};
 
  private:
-  struct Strcmp;
-  struct TruncatedStringHash;
-
-  // Hashing is expensive on large strings (long Java type names, string
-  // literals), so we avoid using `std::unordered_map` directly.
-  //
-  // For leaf-level storage we use `std::map` (i.e., a tree). In a sparse
-  // string keyset with large keys this performs better as only the suffix
-  // until first change needs to be compared.
-  //
-  // For sharding, we use two layers. The first layer is a partial string
-  // hash as defined by `TruncatedStringHash`. It picks a segment "close"
-  // to the front and performs reasonably well. A std::array is used for
-  // sharding here (see `LargeStringMap`).
-  //
-  // The second layer optimizes the string comparison. We have additional
-  // data besides the string data pointer, namely the UTF size. We can
-  // avoid comparisons for different string lengths. The second layer
-  // thus shards over it. We use the `ConcurrentContainer` sharding for
-  // this (see `ConcurrentProjectedStringMap`).
-  //
-  // The two layers give infrastructure overhead, however, the base size
-  // of a `std::map` and `ConcurrentContainer` is quite small.
-
-  using StringMapKey = std::string_view;
-  struct StringMapKeyHash {
-    size_t operator()(const StringMapKey& k) const { return k.size(); }
-  };
-
-  template <size_t n_slots = 31>
-  using ConcurrentProjectedStringMap =
-      ConcurrentMapContainer<std::map<std::string_view, const DexString*>,
-                             StringMapKey,
-                             const DexString*,
-                             StringMapKeyHash,
-                             Identity,
-                             n_slots>;
-
-  template <size_t n_slots, size_t m_slots>
-  struct LargeStringMap {
-    using AType = std::array<ConcurrentProjectedStringMap<n_slots>, m_slots>;
-
-    AType map;
-
-    ConcurrentProjectedStringMap<n_slots>& at(const StringMapKey& k) {
-      size_t hashed = TruncatedStringHash()(k.data(), k.size()) % m_slots;
-      return map[hashed];
-    }
-
-    typename AType::iterator begin() { return map.begin(); }
-    typename AType::iterator end() { return map.end(); }
-  };
+  // Constructs an interned object in `m_ref_arena`.
+  template <typename T, typename... Args>
+  T* arena_new(Args&&... args) {
+    return new (m_ref_arena.allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+  }
 
-  // Hash a 32-byte subsequence of a given string, offset by 32 bytes from the
-  // start. Dex files tend to contain many strings with the same prefixes,
-  // because every class / method under a given package will share the same
-  // prefix. The offset ensures that we have more unique subsequences to hash.
-  //
-  // An offset of 32 and hash prefix length of 32 seemed to perform best on the
-  // typical strings in an android app. It's important to remain within one
-  // cache line (offset + hash_prefix_len <= 64) and hash enough of the string
-  // to minimize the chance of duplicate sections
-  struct TruncatedStringHash {
-    size_t operator()(const char* s, uint32_t string_size) {
-      constexpr size_t hash_prefix_len = 32;
-      constexpr size_t offset = 32;
-      size_t len = std::min<size_t>(string_size, offset + hash_prefix_len);
-      size_t start = std::max<int64_t>(0, int64_t(len - hash_prefix_len));
-      return boost::hash_range(s + start, s + len);
-    }
-  };
+  // Holds the DexStrings, DexTypes, DexTypeLists and DexProtos, which are
+  // never freed on their own. Declared first, so that it goes last.
+  ConcurrentArena m_ref_arena;
 
-  // DexString
-  LargeStringMap<31, 127> s_string_map;
+  // DexString. Strings and types are interned by every pass that creates new
+  // names, often from many threads at once, so their tables take no locks.
+  // Strings are hashed in full: names share long prefixes, which would make
+  // for long probe sequences with a hash of only part of them.
+  InternTable<std::string_view, const DexString> s_string_map{1 << 16};
 
   // DexType
-  ConcurrentMap<const DexString*, DexType*> s_type_map;
+  InternTable<const DexString*, DexType> s_type_map{1 << 14};
+  std::atomic<uint32_t> m_next_type_id{0};
 
   // DexFieldRef
   ConcurrentMap<DexFieldSpec, DexFieldRef*> s_field_map;
   std::mutex s_field_lock;
+  std::atomic<uint32_t> m_next_field_id{0};
 
   // DexTypeList
   struct DexTypeListContainerTypePtrHash {
@@ -311,11 +285,30 @@ struct RedexContext {
   // DexMethod
   ConcurrentMap<DexMethodSpec, DexMethodRef*> s_method_map;
   std::mutex s_method_lock;
+  std::atomic<uint32_t> m_next_method_id{0};
+
+  // The qualified names of the refs that were asked for. Renaming a ref drops
+  // its name, while renaming a type, which can change the names of any number
+  // of refs, moves to a new epoch, in which older names are recomputed.
+  struct QualifiedName {
+    const DexString* name;
+    uint32_t epoch;
+  };
+  ConcurrentMap<const DexFieldRef*, QualifiedName> m_qualified_field_names;
+  ConcurrentMap<const DexMethodRef*, QualifiedName> m_qualified_method_names;
+  std::atomic<uint32_t> m_type_names_epoch{0};
 
   // DexPositionSwitch and DexPositionPattern
   PositionPatternSwitchManager* m_position_pattern_switch_manager{nullptr};
 
-  // Type-to-class map
+  std::unique_ptr<MethodAnalysisCache> m_method_analysis_cache;
+
+  std::unique_ptr<SourceBlockValsArena> m_sb_vals_arena;
+
+  std::unique_ptr<ClassScopesCache> m_class_scopes_cache;
+
+  // Type-to-class map, for walking the classes. Lookups read the class slot of
+  // the type instead.
   std::mutex m_type_system_mutex;
   std::unordered_map<const DexType*, DexClass*> m_type_to_class;
   std::vector<DexClass*> m_external_classes;
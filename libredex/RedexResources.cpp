@@ -9,8 +9,11 @@
 
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <algorithm>
+#include <cstring>
 #include <map>
 #include <mutex>
+#include <numeric>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -24,6 +27,7 @@
 #include "IOUtil.h"
 #include "Macros.h"
 #include "ReadMaybeMapped.h"
+#include "ResourceScanCache.h"
 #include "StringUtil.h"
 #include "Trace.h"
 #include "WorkQueue.h"
@@ -39,9 +43,12 @@ namespace {
 constexpr size_t MIN_CLASSNAME_LENGTH = 10;
 constexpr size_t MAX_CLASSNAME_LENGTH = 500;
 
+// For rewriting binary XML files.
 constexpr decltype(redex_parallel::default_num_threads()) kReadXMLThreads = 4u;
+// Large libraries are split into chunks, so scanning scales with threads;
+// file reads are memory-mapped.
 constexpr decltype(redex_parallel::default_num_threads()) kReadNativeThreads =
-    2u;
+    8u;
 
 using path_t = boost::filesystem::path;
 using dir_iterator = boost::filesystem::directory_iterator;
@@ -64,23 +71,72 @@ std::unique_ptr<AndroidResources> create_resource_reader(
 }
 
 namespace {
+
+// Native libraries larger than this are scanned in parallel, one chunk each.
+constexpr size_t kNativeLibChunkSize = 4 * 1024 * 1024;
+
+bool is_classname_char(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '/' || c == '_' || c == '$';
+}
+
+/*
+ * Whether any byte of the word is a lowercase letter or an 'L', i.e. may start
+ * a classname. Bytes are tested eight at a time with the `hasbetween` and
+ * `haszero` tricks of "Bit Twiddling Hacks".
+ */
+bool may_start_classname(uint64_t x) {
+  constexpr uint64_t kOnes = ~uint64_t(0) / 255;
+  constexpr uint64_t kLow7 = kOnes * 127;
+  constexpr uint64_t kHigh = kOnes * 128;
+  uint64_t lowercase = ((kOnes * (127 + 'z' + 1)) - (x & kLow7)) & ~x &
+                       ((x & kLow7) + kOnes * (127 - ('a' - 1))) & kHigh;
+  uint64_t l = x ^ (kOnes * 'L');
+  uint64_t has_l = (l - kOnes) & ~l & kHigh;
+  return (lowercase | has_l) != 0;
+}
+
 /*
- * Returns all strings that look like java class names from a native library.
+ * The scan below never carries state past a byte that cannot be part of a
+ * classname. Returns the first position at or after `pos` that follows such a
+ * byte, or `size`, from where a scan of any chunk can start.
+ */
+size_t next_sync_point(const char* data, size_t size, size_t pos) {
+  while (pos > 0 && pos < size && is_classname_char(data[pos - 1])) {
+    ++pos;
+  }
+  return pos;
+}
+
+/*
+ * Adds all strings that look like java class names from a native library, and
+ * that start in the chunk [begin, end) of its contents.
  *
- * Return values will be formatted the way that the dex spec formats class
- * names:
+ * Values will be formatted the way that the dex spec formats class names:
  *
  *   "Ljava/lang/String;"
  *
  */
-std::unordered_set<std::string> extract_classes_from_native_lib(
-    const char* data, size_t size) {
-  std::unordered_set<std::string> classes;
+void extract_classes_from_native_lib(const char* data,
+                                     size_t size,
+                                     size_t begin,
+                                     size_t end,
+                                     std::unordered_set<std::string>* classes) {
   char buffer[MAX_CLASSNAME_LENGTH + 2]; // +2 for the trailing ";\0"
-  const char* inptr = data;
-  const char* end = inptr + size;
-
-  while (inptr < end) {
+  const char* inptr = data + next_sync_point(data, size, begin);
+  // A run that starts before the end of the chunk ends before its next sync
+  // point.
+  const char* stop = data + next_sync_point(data, size, end);
+
+  while (inptr < stop) {
+    if (stop - inptr >= 8) {
+      uint64_t word;
+      memcpy(&word, inptr, sizeof(word));
+      if (!may_start_classname(word)) {
+        inptr += sizeof(word);
+        continue;
+      }
+    }
     char* outptr = buffer;
     size_t length = 0;
     // All classnames start with a package, which starts with a lowercase
@@ -93,11 +149,7 @@ std::unordered_set<std::string> extract_classes_from_native_lib(
         length++;
       }
 
-      while (inptr < end &&
-             ((*inptr >= 'a' && *inptr <= 'z') ||
-              (*inptr >= 'A' && *inptr <= 'Z') ||
-              (*inptr >= '0' && *inptr <= '9') || *inptr == '/' ||
-              *inptr == '_' || *inptr == '$') &&
+      while (inptr < stop && is_classname_char(*inptr) &&
              length < MAX_CLASSNAME_LENGTH) {
         *outptr++ = *inptr++;
         length++;
@@ -105,12 +157,11 @@ std::unordered_set<std::string> extract_classes_from_native_lib(
       if (length >= MIN_CLASSNAME_LENGTH) {
         *outptr++ = ';';
         *outptr = '\0';
-        classes.insert(std::string(buffer));
+        classes->insert(std::string(buffer));
       }
     }
     inptr++;
   }
-  return classes;
 }
 } // namespace
 
@@ -129,9 +180,14 @@ void parse_authorities(const std::string& text,
 
 // For external testing.
 std::unordered_set<std::string> extract_classes_from_native_lib(
-    const std::string& lib_contents) {
-  return extract_classes_from_native_lib(lib_contents.data(),
-                                         lib_contents.size());
+    const std::string& lib_contents, size_t chunk_size) {
+  std::unordered_set<std::string> classes;
+  for (size_t begin = 0; begin < lib_contents.size(); begin += chunk_size) {
+    size_t end = begin + std::min(chunk_size, lib_contents.size() - begin);
+    extract_classes_from_native_lib(lib_contents.data(), lib_contents.size(),
+                                    begin, end, &classes);
+  }
+  return classes;
 }
 
 std::unordered_set<std::string> get_files_by_suffix(
@@ -211,7 +267,18 @@ void find_resource_xml_files(const std::string& dir,
 void AndroidResources::collect_layout_classes_and_attributes(
     const std::unordered_set<std::string>& attributes_to_read,
     std::unordered_set<std::string>* out_classes,
-    std::unordered_multimap<std::string, std::string>* out_attributes) {
+    std::unordered_multimap<std::string, std::string>* out_attributes,
+    ResourceScanCache* cache) {
+  std::string cache_salt;
+  if (cache != nullptr) {
+    std::vector<std::string> attributes(attributes_to_read.begin(),
+                                        attributes_to_read.end());
+    std::sort(attributes.begin(), attributes.end());
+    cache_salt = "layout";
+    for (const auto& attribute : attributes) {
+      cache_salt += '\n' + attribute;
+    }
+  }
   auto collect_fn = [&](const std::vector<std::string>& prefixes) {
     std::mutex out_mutex;
     workqueue_run<std::string>(
@@ -233,12 +300,21 @@ void AndroidResources::collect_layout_classes_and_attributes(
             return;
           }
 
-          std::unordered_set<std::string> local_out_classes;
-          std::unordered_multimap<std::string, std::string>
-              local_out_attributes;
-          collect_layout_classes_and_attributes_for_file(
-              input, attributes_to_read, &local_out_classes,
-              &local_out_attributes);
+          ResourceScanCache::Entry entry;
+          auto& local_out_classes = entry.classes;
+          auto& local_out_attributes = entry.attributes;
+          std::string cache_key;
+          if (cache != nullptr) {
+            cache_key = cache->key(input, cache_salt);
+          }
+          if (cache == nullptr || !cache->lookup(cache_key, &entry)) {
+            collect_layout_classes_and_attributes_for_file(
+                input, attributes_to_read, &local_out_classes,
+                &local_out_attributes);
+            if (cache != nullptr) {
+              cache->record(cache_key, entry);
+            }
+          }
           if (!local_out_classes.empty() || !local_out_attributes.empty()) {
             std::unique_lock<std::mutex> lock(out_mutex);
             // C++17: use merge to avoid copies.
@@ -249,7 +325,8 @@ void AndroidResources::collect_layout_classes_and_attributes(
           }
         },
         std::vector<std::string>{""},
-        std::min(redex_parallel::default_num_threads(), kReadXMLThreads),
+        // Files are memory-mapped and only read, so use all threads.
+        redex_parallel::default_num_threads(),
         /*push_tasks_while_running=*/true);
   };
 
@@ -354,42 +431,85 @@ void find_native_library_files(const std::string& lib_root, Fn handler) {
 /**
  * Return all potential java class names located in native libraries.
  */
-std::unordered_set<std::string> AndroidResources::get_native_classes() {
-  std::mutex out_mutex;
-  std::unordered_set<std::string> all_classes;
-  workqueue_run<std::string>(
-      [&](sparta::SpartaWorkerState<std::string>* worker_state,
-          const std::string& input) {
-        if (input.empty()) {
-          // Dispatcher, find files and create tasks.
-          auto directories = find_lib_directories();
-          for (const auto& dir : directories) {
-            TRACE(RES, 9, "Scanning %s for so files for class names",
-                  dir.c_str());
-            find_native_library_files(dir, [&](const std::string& file) {
-              worker_state->push_task(file);
-            });
-          }
-          return;
-        }
+std::unordered_set<std::string> AndroidResources::get_native_classes(
+    ResourceScanCache* cache) {
+  std::vector<std::string> files;
+  for (const auto& dir : find_lib_directories()) {
+    TRACE(RES, 9, "Scanning %s for so files for class names", dir.c_str());
+    find_native_library_files(
+        dir, [&](const std::string& file) { files.push_back(file); });
+  }
+  auto num_threads =
+      std::min(redex_parallel::default_num_threads(), kReadNativeThreads);
+
+  // With a cache, only the libraries that are not in it are scanned, and
+  // their classes are recorded once all of their chunks are done.
+  std::vector<ResourceScanCache::Entry> entries(files.size());
+  std::vector<std::string> keys(files.size());
+  std::vector<size_t> to_scan;
+  if (cache != nullptr) {
+    std::vector<uint8_t> found(files.size(), false);
+    std::vector<size_t> indices(files.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    workqueue_run<size_t>(
+        [&](size_t i) {
+          keys[i] = cache->key(files[i], "native");
+          found[i] = cache->lookup(keys[i], &entries[i]);
+        },
+        indices, num_threads);
+    for (size_t i = 0; i < files.size(); i++) {
+      if (!found[i]) {
+        to_scan.push_back(i);
+      }
+    }
+  } else {
+    to_scan.resize(files.size());
+    std::iota(to_scan.begin(), to_scan.end(), 0);
+  }
 
+  struct Chunk {
+    size_t file;
+    size_t begin;
+    size_t end;
+  };
+  std::vector<Chunk> chunks;
+  for (size_t i : to_scan) {
+    size_t size = boost::filesystem::file_size(files[i]);
+    for (size_t begin = 0; begin < size; begin += kNativeLibChunkSize) {
+      chunks.push_back(
+          Chunk{i, begin, std::min(begin + kNativeLibChunkSize, size)});
+    }
+  }
+  std::vector<std::mutex> entry_mutexes(files.size());
+  workqueue_run<Chunk>(
+      [&](const Chunk& input) {
         redex::read_file_with_contents(
-            input,
+            files[input.file],
             [&](const char* data, size_t size) {
-              std::unordered_set<std::string> classes_from_native =
-                  extract_classes_from_native_lib(data, size);
+              std::unordered_set<std::string> classes_from_native;
+              extract_classes_from_native_lib(
+                  data, size, std::min(input.begin, size),
+                  std::min(input.end, size), &classes_from_native);
               if (!classes_from_native.empty()) {
-                std::unique_lock<std::mutex> lock(out_mutex);
+                std::unique_lock<std::mutex> lock(entry_mutexes[input.file]);
                 // C++17: use merge to avoid copies.
-                all_classes.insert(classes_from_native.begin(),
-                                   classes_from_native.end());
+                entries[input.file].classes.insert(classes_from_native.begin(),
+                                                   classes_from_native.end());
               }
             },
             64 * 1024);
       },
-      std::vector<std::string>{""},
-      std::min(redex_parallel::default_num_threads(), kReadNativeThreads),
-      /*push_tasks_while_running=*/true);
+      chunks, num_threads);
+  if (cache != nullptr) {
+    for (size_t i : to_scan) {
+      cache->record(keys[i], entries[i]);
+    }
+  }
+
+  std::unordered_set<std::string> all_classes;
+  for (const auto& entry : entries) {
+    all_classes.insert(entry.classes.begin(), entry.classes.end());
+  }
   return all_classes;
 }
 
@@ -12,6 +12,7 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/optional.hpp>
+#include <limits>
 #include <map>
 #include <memory>
 #include <set>
@@ -25,6 +26,8 @@
 
 #include "RedexMappedFile.h"
 
+class ResourceScanCache;
+
 const char* const ONCLICK_ATTRIBUTE = "android:onClick";
 
 const uint32_t PACKAGE_RESID_START = 0x7f000000;
@@ -166,11 +169,13 @@ class AndroidResources {
   // Iterates through all layouts in the given directory. Adds all class names
   // to the output set, and allows for any specified attribute values to be
   // returned as well. Attribute names should specify their namespace, if any
-  // (so android:onClick instead of just onClick)
+  // (so android:onClick instead of just onClick). With a `cache`, only the
+  // layouts that are not in it are parsed.
   void collect_layout_classes_and_attributes(
       const std::unordered_set<std::string>& attributes_to_read,
       std::unordered_set<std::string>* out_classes,
-      std::unordered_multimap<std::string, std::string>* out_attributes);
+      std::unordered_multimap<std::string, std::string>* out_attributes,
+      ResourceScanCache* cache = nullptr);
 
   // Same as above, for single file.
   virtual void collect_layout_classes_and_attributes_for_file(
@@ -185,8 +190,10 @@ class AndroidResources {
   virtual std::unordered_set<std::string> find_all_xml_files() = 0;
   virtual std::vector<std::string> find_resources_files() = 0;
   virtual std::string get_base_assets_dir() = 0;
-  // Classnames present in native libraries (lib/*/*.so)
-  std::unordered_set<std::string> get_native_classes();
+  // Classnames present in native libraries (lib/*/*.so). With a `cache`, only
+  // the libraries that are not in it are scanned.
+  std::unordered_set<std::string> get_native_classes(
+      ResourceScanCache* cache = nullptr);
 
   const std::string& get_directory() { return m_directory; }
 
@@ -223,9 +230,11 @@ inline bool is_resource_xml(const std::string& str) {
   return is_resource_file(str) && boost::algorithm::ends_with(str, ".xml");
 }
 
-// For testing only!
+// For testing only! Scans the contents in chunks of the given size, as
+// large native libraries are.
 std::unordered_set<std::string> extract_classes_from_native_lib(
-    const std::string& lib_contents);
+    const std::string& lib_contents,
+    size_t chunk_size = std::numeric_limits<size_t>::max());
 
 std::unordered_set<std::string> get_files_by_suffix(
     const std::string& directory, const std::string& suffix);
@@ -9,6 +9,21 @@
 #include "EditableCfgAdapter.h"
 #include "Resolver.h"
 #include "TypeUtil.h"
+#include "WorkQueue.h"
+
+namespace {
+
+template <typename T>
+void move_verdicts(ConcurrentMap<const T*, boost::optional<bool>>& cache,
+                   std::unordered_map<const T*, bool>* precomputed) {
+  precomputed->reserve(cache.size());
+  for (auto& [ref, verdict] : cache) {
+    precomputed->emplace(ref, *verdict);
+  }
+  cache.clear();
+}
+
+} // namespace
 
 CodeRefs::CodeRefs(const DexMethod* method) {
   if (!method->get_code()) {
@@ -67,7 +82,32 @@ CodeRefs::CodeRefs(const DexMethod* method) {
   std::copy(fields_set.begin(), fields_set.end(), std::back_inserter(fields));
 }
 
+RefChecker::RefChecker(const XStoreRefs* xstores,
+                       size_t store_idx,
+                       const api::AndroidSDK* min_sdk_api,
+                       const Scope& scope)
+    : RefChecker(xstores, store_idx, min_sdk_api) {
+  workqueue_run<DexClass*>(
+      [this](DexClass* cls) {
+        check_type(cls->get_type());
+        for (auto* field : cls->get_all_fields()) {
+          check_field(field);
+        }
+        for (auto* method : cls->get_all_methods()) {
+          check_method(method);
+        }
+      },
+      scope);
+  move_verdicts(m_type_cache, &m_precomputed_types);
+  move_verdicts(m_method_cache, &m_precomputed_methods);
+  move_verdicts(m_field_cache, &m_precomputed_fields);
+}
+
 bool RefChecker::check_type(const DexType* type) const {
+  auto it = m_precomputed_types.find(type);
+  if (it != m_precomputed_types.end()) {
+    return it->second;
+  }
   auto res = m_type_cache.get(type, boost::none);
   if (res == boost::none) {
     res = check_type_internal(type);
@@ -81,6 +121,10 @@ bool RefChecker::check_type(const DexType* type) const {
 }
 
 bool RefChecker::check_method(const DexMethod* method) const {
+  auto it = m_precomputed_methods.find(method);
+  if (it != m_precomputed_methods.end()) {
+    return it->second;
+  }
   auto res = m_method_cache.get(method, boost::none);
   if (res == boost::none) {
     res = check_method_internal(method);
@@ -95,6 +139,10 @@ bool RefChecker::check_method(const DexMethod* method) const {
 }
 
 bool RefChecker::check_field(const DexField* field) const {
+  auto it = m_precomputed_fields.find(field);
+  if (it != m_precomputed_fields.end()) {
+    return it->second;
+  }
   auto res = m_field_cache.get(field, boost::none);
   if (res == boost::none) {
     res = check_field_internal(field);
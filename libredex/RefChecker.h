@@ -8,6 +8,7 @@
 #pragma once
 
 #include <boost/optional.hpp>
+#include <unordered_map>
 
 #include "ConcurrentContainers.h"
 #include "DexClass.h"
@@ -46,6 +47,15 @@ class RefChecker {
         m_store_idx(store_idx),
         m_min_sdk_api(min_sdk_api) {}
 
+  // Also computes, in parallel, the verdicts of all classes, methods and
+  // fields defined in :scope, along with the types they refer to in their
+  // signatures. Checking these afterwards is a lookup in a read-only table,
+  // without taking any lock.
+  RefChecker(const XStoreRefs* xstores,
+             size_t store_idx,
+             const api::AndroidSDK* min_sdk_api,
+             const Scope& scope);
+
   bool check_type(const DexType* type) const;
 
   bool check_method(const DexMethod* method) const;
@@ -76,6 +86,11 @@ class RefChecker {
   size_t m_store_idx;
   const api::AndroidSDK* m_min_sdk_api;
 
+  // Filled at construction, and never changed afterwards.
+  std::unordered_map<const DexType*, bool> m_precomputed_types;
+  std::unordered_map<const DexMethod*, bool> m_precomputed_methods;
+  std::unordered_map<const DexField*, bool> m_precomputed_fields;
+
   mutable ConcurrentMap<const DexType*, boost::optional<bool>> m_type_cache;
   mutable ConcurrentMap<const DexMethod*, boost::optional<bool>> m_method_cache;
   mutable ConcurrentMap<const DexField*, boost::optional<bool>> m_field_cache;
@@ -25,6 +25,7 @@
 #include "Resolver.h"
 #include "Show.h"
 #include "Trace.h"
+#include "Walkers.h"
 
 using namespace sparta;
 
@@ -1213,4 +1214,55 @@ CallingContextMap ReflectionAnalysis::get_calling_context_partition() const {
   return this->m_analyzer->get_exit_state().get_calling_context_partition();
 }
 
+bool may_have_reflection_sites(const IRCode& code, const MetadataCache& cache) {
+  for (const auto& mie : InstructionIterable(code)) {
+    auto* insn = mie.insn;
+    switch (insn->opcode()) {
+    case OPCODE_CONST_CLASS:
+      return true;
+    case OPCODE_IGET_OBJECT:
+    case OPCODE_SGET_OBJECT:
+      if (cache.primitive_field_to_type.count(insn->get_field())) {
+        return true;
+      }
+      break;
+    default:
+      if (insn->has_method()) {
+        // A Class object that is not from reflection, e.g. a parameter, still
+        // yields METHOD and FIELD objects through the Class getters.
+        auto* callee = insn->get_method();
+        if (callee->get_class() == type::java_lang_Class() ||
+            callee == cache.get_class || callee == cache.get_method_name ||
+            callee == cache.get_field_name) {
+          return true;
+        }
+      }
+      break;
+    }
+  }
+  return false;
+}
+
+ConcurrentMap<DexMethod*, ReflectionSites> get_reflection_sites(
+    const Scope& scope, const MetadataCache* cache) {
+  std::unique_ptr<MetadataCache> own_cache;
+  if (!cache) {
+    own_cache = std::make_unique<MetadataCache>();
+    cache = own_cache.get();
+  }
+  ConcurrentMap<DexMethod*, ReflectionSites> sites;
+  walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
+    if (!may_have_reflection_sites(code, *cache)) {
+      return;
+    }
+    ReflectionAnalysis analysis(method, /* context */ nullptr,
+                                /* summary_query_fn */ nullptr, cache);
+    auto method_sites = analysis.get_reflection_sites();
+    if (!method_sites.empty()) {
+      sites.emplace(method, std::move(method_sites));
+    }
+  });
+  return sites;
+}
+
 } // namespace reflection
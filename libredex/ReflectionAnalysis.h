@@ -14,6 +14,7 @@
 #include <utility>
 
 #include "AbstractDomain.h"
+#include "ConcurrentContainers.h"
 #include "ConstantAbstractDomain.h"
 #include "DexClass.h"
 #include "DexUtil.h"
@@ -225,6 +226,11 @@ using CallingContextMap =
 using SummaryQueryFn =
     std::function<AbstractObjectDomain(const IRInstruction*)>;
 
+/*
+ * The method and field references that the analysis looks for. They are
+ * created once and never change, so one instance can be shared by analyses
+ * running on any number of threads.
+ */
 struct MetadataCache {
   DexMethodRef* const get_class{DexMethod::make_method(
       "Ljava/lang/Object;", "getClass", {}, "Ljava/lang/Class;")};
@@ -356,6 +362,23 @@ class ReflectionAnalysis final {
       std::map<reg_t, ReflectionAbstractObject>* abstract_objects) const;
 };
 
+/*
+ * Whether the intraprocedural analysis of the code, without a calling context
+ * or summaries, may find any reflection site. This is a cheap scan of the
+ * opcodes: only const-class, the TYPE fields of the boxed primitives and the
+ * java.lang.Class and java.lang.reflect APIs produce reflection objects.
+ */
+bool may_have_reflection_sites(const IRCode& code, const MetadataCache& cache);
+
+/*
+ * Runs the intraprocedural analysis on all methods of the scope in parallel,
+ * and returns the reflection sites of the methods that have any. Methods for
+ * which `may_have_reflection_sites` is false are not analyzed. All analyses
+ * share `cache`, or a single MetadataCache created for the call if it is null.
+ */
+ConcurrentMap<DexMethod*, ReflectionSites> get_reflection_sites(
+    const Scope& scope, const MetadataCache* cache = nullptr);
+
 } // namespace reflection
 
 std::ostream& operator<<(std::ostream& out,
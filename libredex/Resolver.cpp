@@ -8,6 +8,11 @@
 #include "Resolver.h"
 #include "DexUtil.h"
 
+uint64_t ConcurrentMethodRefCache::next_epoch() {
+  static std::atomic<uint64_t> s_next_epoch{1};
+  return s_next_epoch.fetch_add(1);
+}
+
 namespace {
 
 inline bool match(const DexString* name,
@@ -12,6 +12,9 @@
 #include "DexUtil.h"
 #include "IRInstruction.h"
 
+#include <array>
+#include <atomic>
+#include <thread>
 #include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
@@ -74,8 +77,103 @@ struct MethodRefCacheKeyHash {
 using MethodRefCache =
     std::unordered_map<MethodRefCacheKey, DexMethod*, MethodRefCacheKeyHash>;
 
-using ConcurrentMethodRefCache =
-    ConcurrentMap<MethodRefCacheKey, DexMethod*, MethodRefCacheKeyHash>;
+/**
+ * A thread-safe cache from refs to defs, in two levels. Each thread first
+ * looks into a small direct-mapped cache of its own, then into a map shared
+ * by all threads. Resolution results are looked up far more often than they
+ * are inserted, so the shared map does not lock on lookups either.
+ *
+ * Thread-local entries are tagged with an epoch that is unique to the cache
+ * and to each of its invalidations, so that entries left behind by other or
+ * older caches never match. `invalidate()` must not race with lookups.
+ */
+class ConcurrentMethodRefCache final {
+ public:
+  ConcurrentMethodRefCache() : m_epoch(next_epoch()) {}
+
+  // Returns nullptr if the key is not cached.
+  DexMethod* get(const MethodRefCacheKey& key) {
+    auto& entry = l1_entry(key);
+    auto& counters = m_counters[counters_slot()];
+    if (entry.epoch == m_epoch && entry.key == key) {
+      counters.l1_hits.fetch_add(1, std::memory_order_relaxed);
+      return entry.def;
+    }
+    auto def = m_l2.get(key, nullptr);
+    if (def == nullptr) {
+      counters.misses.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    counters.l2_hits.fetch_add(1, std::memory_order_relaxed);
+    entry = L1Entry{key, def, m_epoch};
+    return def;
+  }
+
+  void emplace(const MethodRefCacheKey& key, DexMethod* def) {
+    m_l2.emplace(key, def);
+    l1_entry(key) = L1Entry{key, def, m_epoch};
+  }
+
+  // Drops all entries, e.g. after the hierarchy or the methods changed.
+  void invalidate() {
+    m_epoch = next_epoch();
+    m_l2.clear();
+  }
+
+  size_t l1_hits() const { return sum(&Counters::l1_hits); }
+  size_t l2_hits() const { return sum(&Counters::l2_hits); }
+  size_t misses() const { return sum(&Counters::misses); }
+
+ private:
+  struct L1Entry {
+    MethodRefCacheKey key{nullptr, MethodSearch::Direct};
+    DexMethod* def{nullptr};
+    uint64_t epoch{0};
+  };
+
+  // Counted per group of threads, so that threads rarely share a line.
+  struct alignas(64) Counters {
+    std::atomic<size_t> l1_hits{0};
+    std::atomic<size_t> l2_hits{0};
+    std::atomic<size_t> misses{0};
+  };
+
+  static constexpr size_t kL1Size = 256;
+  static constexpr size_t kCountersSlots = 16;
+
+  static uint64_t next_epoch();
+
+  static size_t counters_slot() {
+    static thread_local const size_t s_slot =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) %
+        kCountersSlots;
+    return s_slot;
+  }
+
+  size_t sum(std::atomic<size_t> Counters::*counter) const {
+    size_t total = 0;
+    for (const auto& counters : m_counters) {
+      total += (counters.*counter).load();
+    }
+    return total;
+  }
+
+  static L1Entry& l1_entry(const MethodRefCacheKey& key) {
+    static thread_local std::array<L1Entry, kL1Size> s_l1;
+    // Refs are at least 8-byte aligned, and distinct searches of a ref are
+    // rare.
+    auto slot = (reinterpret_cast<uintptr_t>(key.method) >> 3) ^
+                static_cast<uintptr_t>(key.search);
+    return s_l1[slot % kL1Size];
+  }
+
+  uint64_t m_epoch;
+  ReadOptimizedConcurrentMap<MethodRefCacheKey,
+                             DexMethod*,
+                             MethodRefCacheKeyHash>
+      m_l2;
+  std::array<Counters, kCountersSlots> m_counters;
+};
 
 /**
  * Helper to map an opcode to a MethodSearch rule.
@@ -272,8 +370,7 @@ inline DexMethod* resolve_method(DexMethodRef* method,
   if (m) {
     return m;
   }
-  auto def =
-      concurrent_ref_cache.get(MethodRefCacheKey{method, search}, nullptr);
+  auto def = concurrent_ref_cache.get(MethodRefCacheKey{method, search});
   if (def != nullptr) {
     return def;
   }
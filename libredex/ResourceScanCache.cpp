@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ResourceScanCache.h"
+
+#include <boost/filesystem.hpp>
+#include <json/json.h>
+
+#include "ReadMaybeMapped.h"
+#include "Trace.h"
+
+namespace {
+
+// Bump when the format of the entries or the keys changes.
+constexpr const char* kFormatVersion = "1";
+
+} // namespace
+
+std::unique_ptr<ResourceScanCache> ResourceScanCache::create(
+    const std::string& dir) {
+  if (dir.empty()) {
+    return nullptr;
+  }
+  boost::filesystem::create_directories(dir);
+  return std::make_unique<ResourceScanCache>(dir);
+}
+
+ResourceScanCache::ResourceScanCache(std::string dir)
+    : m_store(std::move(dir)) {}
+
+std::string ResourceScanCache::key(const std::string& file,
+                                   const std::string& salt) const {
+  DiskCache::KeyHasher hasher;
+  hasher.update(std::string(kFormatVersion) + '\n' + salt + '\n');
+  redex::read_file_with_contents(
+      file, [&](const char* data, size_t size) { hasher.update(data, size); });
+  return hasher.finish();
+}
+
+bool ResourceScanCache::lookup(const std::string& key, Entry* entry) {
+  auto in = m_store.open(key);
+  if (!in) {
+    m_store.count_miss();
+    return false;
+  }
+  Json::Value value;
+  try {
+    in >> value;
+    for (const auto& cls : value["classes"]) {
+      entry->classes.emplace(cls.asString());
+    }
+    for (const auto& attribute : value["attributes"]) {
+      entry->attributes.emplace(attribute[0].asString(),
+                                attribute[1].asString());
+    }
+  } catch (const std::exception& e) {
+    TRACE(RES, 1, "Ignoring unreadable cache entry %s: %s",
+          m_store.path(key).c_str(), e.what());
+    entry->classes.clear();
+    entry->attributes.clear();
+    m_store.count_miss();
+    return false;
+  }
+  m_store.count_hit();
+  return true;
+}
+
+void ResourceScanCache::record(const std::string& key, const Entry& entry) {
+  Json::Value value;
+  value["classes"] = Json::arrayValue;
+  for (const auto& cls : entry.classes) {
+    value["classes"].append(cls);
+  }
+  value["attributes"] = Json::arrayValue;
+  for (const auto& [name, attribute_value] : entry.attributes) {
+    Json::Value attribute(Json::arrayValue);
+    attribute.append(name);
+    attribute.append(attribute_value);
+    value["attributes"].append(attribute);
+  }
+
+  m_store.write(key, [&](std::ostream& out) { out << value; });
+}
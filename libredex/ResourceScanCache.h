@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "DiskCache.h"
+
+/*
+ * A persistent, content-addressed cache of the class names and attribute
+ * values that resource scanning extracts from layouts and native libraries,
+ * shared across builds.
+ *
+ * An entry is keyed on a hash of the contents of one file, the kind of scan
+ * and its parameters, so that only files that changed since an earlier build
+ * are parsed again.
+ *
+ * The cache is enabled by setting `resource_scan_cache_dir` in the config.
+ */
+class ResourceScanCache final {
+ public:
+  struct Entry {
+    std::unordered_set<std::string> classes;
+    std::unordered_multimap<std::string, std::string> attributes;
+  };
+
+  // Returns nullptr if `dir` is empty.
+  static std::unique_ptr<ResourceScanCache> create(const std::string& dir);
+
+  explicit ResourceScanCache(std::string dir);
+
+  // The key of scanning the current contents of `file`. `salt` must capture
+  // the kind of scan and all its parameters that affect the result.
+  std::string key(const std::string& file, const std::string& salt) const;
+
+  // If there is an entry for `key`, stores it in `entry` and returns true.
+  bool lookup(const std::string& key, Entry* entry);
+
+  void record(const std::string& key, const Entry& entry);
+
+  size_t hits() const { return m_store.hits(); }
+  size_t misses() const { return m_store.misses(); }
+
+ private:
+  DiskCache m_store;
+};
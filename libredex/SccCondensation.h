@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Debug.h"
+
+/*
+ * The strongly connected components of the nodes reachable from a set of
+ * roots, as computed by Tarjan's algorithm, and the acyclic graph of the
+ * components.
+ *
+ * Components are numbered bottom-up: every component comes after the
+ * components it reaches. Walking them in order thus visits callees before
+ * callers, which is the order that bottom-up analyses need, and a component
+ * is recursive iff it has more than one node or a node calling itself.
+ *
+ * `successors(node)` must return an iterable of nodes. The traversal is
+ * iterative, so deep graphs do not overflow the stack.
+ */
+template <typename Node, typename Hash = std::hash<Node>>
+class SccCondensation final {
+ public:
+  template <typename Successors>
+  SccCondensation(const std::vector<Node>& roots,
+                  const Successors& successors) {
+    for (const auto& root : roots) {
+      if (!m_info.count(root)) {
+        visit(root, successors);
+      }
+    }
+    link();
+    m_info.clear();
+  }
+
+  size_t size() const { return m_components.size(); }
+
+  const std::vector<Node>& component(size_t c) const {
+    return m_components.at(c);
+  }
+
+  // The components that the component has edges to, which all come before
+  // it. This does not include the component itself.
+  const std::vector<size_t>& successors(size_t c) const {
+    return m_successors.at(c);
+  }
+
+  bool is_recursive(size_t c) const { return m_recursive.at(c); }
+
+  bool contains(const Node& node) const { return m_component_of.count(node); }
+
+  size_t component_of(const Node& node) const {
+    return m_component_of.at(node);
+  }
+
+ private:
+  struct Info {
+    size_t index;
+    size_t lowlink;
+    bool on_stack;
+  };
+
+  struct Frame {
+    Node node;
+    std::vector<Node> succs;
+    size_t next{0};
+  };
+
+  template <typename Successors>
+  void visit(const Node& root, const Successors& successors) {
+    std::vector<Frame> frames;
+    std::vector<Node> stack;
+    auto push = [&](const Node& node) {
+      auto index = m_info.size();
+      m_info.emplace(node, Info{index, index, true});
+      stack.push_back(node);
+      const auto& succs = successors(node);
+      frames.push_back(
+          Frame{node, std::vector<Node>(succs.begin(), succs.end())});
+    };
+    push(root);
+    while (!frames.empty()) {
+      auto& frame = frames.back();
+      if (frame.next < frame.succs.size()) {
+        Node succ = frame.succs[frame.next++];
+        auto it = m_info.find(succ);
+        if (it == m_info.end()) {
+          // This invalidates `frame`.
+          push(succ);
+        } else if (it->second.on_stack) {
+          auto& info = m_info.at(frame.node);
+          info.lowlink = std::min(info.lowlink, it->second.index);
+        }
+        continue;
+      }
+
+      Node node = frame.node;
+      m_node_succs.emplace(node, std::move(frame.succs));
+      frames.pop_back();
+      const auto& info = m_info.at(node);
+      auto lowlink = info.lowlink;
+      if (lowlink == info.index) {
+        std::vector<Node> component;
+        Node member;
+        do {
+          member = stack.back();
+          stack.pop_back();
+          m_info.at(member).on_stack = false;
+          m_component_of.emplace(member, m_components.size());
+          component.push_back(member);
+        } while (!(member == node));
+        m_components.push_back(std::move(component));
+      }
+      if (!frames.empty()) {
+        auto& parent = m_info.at(frames.back().node);
+        parent.lowlink = std::min(parent.lowlink, lowlink);
+      }
+    }
+    always_assert(stack.empty());
+  }
+
+  void link() {
+    m_successors.resize(m_components.size());
+    m_recursive.resize(m_components.size());
+    for (size_t c = 0; c < m_components.size(); ++c) {
+      const auto& component = m_components[c];
+      m_recursive[c] = component.size() > 1;
+      std::unordered_set<size_t> seen;
+      for (const auto& node : component) {
+        for (const auto& succ : m_node_succs.at(node)) {
+          auto s = m_component_of.at(succ);
+          if (s == c) {
+            m_recursive[c] = true;
+          } else if (seen.insert(s).second) {
+            always_assert(s < c);
+            m_successors[c].push_back(s);
+          }
+        }
+      }
+      std::sort(m_successors[c].begin(), m_successors[c].end());
+    }
+    m_node_succs.clear();
+  }
+
+  std::unordered_map<Node, Info, Hash> m_info;
+  std::unordered_map<Node, std::vector<Node>, Hash> m_node_succs;
+  std::unordered_map<Node, size_t, Hash> m_component_of;
+  std::vector<std::vector<Node>> m_components;
+  std::vector<std::vector<size_t>> m_successors;
+  std::vector<bool> m_recursive;
+};
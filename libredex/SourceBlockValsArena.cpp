@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "SourceBlockValsArena.h"
+
+#include <cstring>
+#include <functional>
+#include <type_traits>
+
+#include "RedexContext.h"
+
+static_assert(std::is_trivially_copyable<SourceBlock::Val>::value);
+static_assert(alignof(SourceBlock::Val) <= alignof(uint32_t));
+
+SourceBlock::Vals SourceBlock::Vals::intern(const Val* vals, size_t size) {
+  if (size == 0) {
+    return Vals();
+  }
+  return g_redex->sb_vals_arena().intern(vals, size);
+}
+
+SourceBlock::Vals SourceBlockValsArena::intern(const SourceBlock::Val* vals,
+                                               size_t size) {
+  std::string_view bytes(reinterpret_cast<const char*>(vals),
+                         size * sizeof(SourceBlock::Val));
+  auto& shard = m_shards[std::hash<std::string_view>()(bytes) % kNumShards];
+  std::lock_guard<std::mutex> lock(shard.lock);
+  auto it = shard.map.find(bytes);
+  if (it != shard.map.end()) {
+    return SourceBlock::Vals(it->second);
+  }
+  auto* data = static_cast<uint32_t*>(
+      m_arena.allocate(sizeof(uint32_t) + bytes.size(), alignof(uint32_t)));
+  data[0] = static_cast<uint32_t>(size);
+  memcpy(data + 1, bytes.data(), bytes.size());
+  shard.map.emplace(
+      std::string_view(reinterpret_cast<const char*>(data + 1), bytes.size()),
+      data);
+  return SourceBlock::Vals(data);
+}
+
+size_t SourceBlockValsArena::size() const {
+  size_t size = 0;
+  for (const auto& shard : m_shards) {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    size += shard.map.size();
+  }
+  return size;
+}
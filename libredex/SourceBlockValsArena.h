@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include "ConcurrentArena.h"
+#include "IRList.h"
+
+/*
+ * Holds the interned SourceBlock::Vals of a RedexContext. Arrays with the same
+ * bytes are stored once, and live as long as the context. Interning is
+ * thread-safe.
+ */
+class SourceBlockValsArena final {
+ public:
+  SourceBlockValsArena() = default;
+  SourceBlockValsArena(const SourceBlockValsArena&) = delete;
+  SourceBlockValsArena& operator=(const SourceBlockValsArena&) = delete;
+
+  SourceBlock::Vals intern(const SourceBlock::Val* vals, size_t size);
+
+  // The number of distinct arrays.
+  size_t size() const;
+  // The bytes that the arrays take.
+  size_t reserved_bytes() const { return m_arena.reserved_bytes(); }
+
+ private:
+  static constexpr size_t kNumShards = 16;
+
+  struct Shard {
+    mutable std::mutex lock;
+    // Keyed on the bytes of the values, which live in `m_arena`.
+    std::unordered_map<std::string_view, const uint32_t*> map;
+  };
+
+  std::array<Shard, kNumShards> m_shards;
+  ConcurrentArena m_arena;
+};
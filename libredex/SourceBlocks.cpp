@@ -7,10 +7,14 @@
 
 #include "SourceBlocks.h"
 
+#include <cerrno>
+#include <cstdlib>
 #include <limits>
 #include <optional>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 #include "ControlFlow.h"
@@ -19,7 +23,6 @@
 #include "Dominators.h"
 #include "IROpcode.h"
 #include "Macros.h"
-#include "S_Expression.h"
 #include "ScopedCFG.h"
 #include "ScopedMetrics.h"
 #include "Show.h"
@@ -48,25 +51,70 @@ struct InsertHelper {
   bool serialize;
   bool insert_after_excs;
 
+  // A cursor into the profile of one interaction. A profile lists the blocks
+  // and edges of the CFG in the order that they are visited, so matching
+  // only ever looks at the next token, and never copies the profile.
   struct ProfileParserState {
-    s_expr root_expr;
-    std::vector<s_expr> expr_stack;
+    // Empty if there is no profile string.
+    std::string_view profile;
+    size_t pos{0};
     bool had_profile_failure{false};
     boost::optional<SourceBlock::Val> default_val;
     boost::optional<SourceBlock::Val> error_val;
-    ProfileParserState(s_expr root_expr,
-                       std::vector<s_expr> expr_stack,
-                       bool had_profile_failure,
+    ProfileParserState(std::string_view profile,
                        const boost::optional<SourceBlock::Val>& default_val,
                        const boost::optional<SourceBlock::Val>& error_val)
-        : root_expr(std::move(root_expr)),
-          expr_stack(std::move(expr_stack)),
-          had_profile_failure(had_profile_failure),
-          default_val(default_val),
-          error_val(error_val) {}
+        : profile(profile), default_val(default_val), error_val(error_val) {}
+
+    bool has_profile() const { return !profile.empty(); }
+
+    // The next token: a parenthesis, an atom, or empty at the end.
+    std::string_view peek() const {
+      size_t begin = profile.find_first_not_of(kWhitespace, pos);
+      if (begin == std::string_view::npos) {
+        return std::string_view();
+      }
+      if (profile[begin] == '(' || profile[begin] == ')') {
+        return profile.substr(begin, 1);
+      }
+      size_t end = profile.find_first_of(kDelimiters, begin);
+      return profile.substr(begin, end == std::string_view::npos
+                                       ? std::string_view::npos
+                                       : end - begin);
+    }
+
+    void consume(std::string_view token) {
+      pos = token.data() + token.size() - profile.data();
+    }
+
+    std::string rest() const { return std::string(profile.substr(pos)); }
   };
   std::vector<ProfileParserState> parser_state;
 
+  static constexpr const char* kWhitespace = " \t\n\r";
+  static constexpr const char* kDelimiters = " \t\n\r()";
+
+  // Only checks that the parentheses of the first expression balance, which
+  // the matching relies on.
+  static bool is_balanced(std::string_view profile) {
+    size_t depth = 0;
+    for (size_t i = profile.find_first_not_of(kWhitespace);
+         i < profile.size(); ++i) {
+      if (profile[i] == '(') {
+        ++depth;
+      } else if (profile[i] == ')') {
+        if (depth == 0) {
+          return false;
+        }
+        --depth;
+      }
+      if (depth == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   InsertHelper(const DexString* method,
                const std::vector<ProfileData>& profiles,
                bool serialize,
@@ -74,12 +122,13 @@ struct InsertHelper {
       : method(method),
         serialize(serialize),
         insert_after_excs(insert_after_excs) {
+    parser_state.reserve(profiles.size());
     for (const auto& p : profiles) {
       switch (p.index()) {
       case 0:
         // Nothing.
-        parser_state.emplace_back(s_expr(), std::vector<s_expr>(), false,
-                                  boost::none, boost::none);
+        parser_state.emplace_back(std::string_view(), boost::none,
+                                  boost::none);
         break;
 
       case 1:
@@ -87,26 +136,19 @@ struct InsertHelper {
         {
           const auto& pair = std::get<1>(p);
           const std::string& profile = pair.first;
-          std::istringstream iss{profile};
-          s_expr_istream s_expr_input(iss);
-          s_expr root_expr;
-          s_expr_input >> root_expr;
-          always_assert_log(!s_expr_input.fail(),
-                            "Failed parsing profile %s for %s: %s",
+          always_assert_log(is_balanced(profile),
+                            "Failed parsing profile %s for %s: unbalanced "
+                            "parentheses",
                             profile.c_str(),
-                            SHOW(method),
-                            s_expr_input.what().c_str());
-          std::vector<s_expr> expr_stack;
-          expr_stack.push_back(s_expr({root_expr}));
-          parser_state.emplace_back(std::move(root_expr), std::move(expr_stack),
-                                    false, boost::none, pair.second);
+                            SHOW(method));
+          parser_state.emplace_back(profile, boost::none, pair.second);
           break;
         }
 
       case 2:
         // A default Val.
-        parser_state.emplace_back(s_expr(), std::vector<s_expr>(), false,
-                                  std::get<2>(p), boost::none);
+        parser_state.emplace_back(std::string_view(), std::get<2>(p),
+                                  boost::none);
         break;
 
       default:
@@ -115,28 +157,43 @@ struct InsertHelper {
     }
   }
 
-  static SourceBlock::Val parse_val(const std::string& val_str) {
+  // Like std::stof, but without copying. The characters after `str` must not
+  // continue a float, which holds for the delimiters that end a token.
+  static float parse_float(std::string_view str, size_t* idx) {
+    const char* begin = str.data();
+    char* end;
+    errno = 0;
+    float f = std::strtof(begin, &end);
+    if (end == begin || end > begin + str.size()) {
+      throw std::invalid_argument("stof");
+    }
+    if (errno == ERANGE) {
+      throw std::out_of_range("stof");
+    }
+    *idx = end - begin;
+    return f;
+  }
+
+  static SourceBlock::Val parse_val(std::string_view val_str) {
     if (val_str == "x") {
       return kXVal;
     }
     size_t after_idx;
-    float nested_val = std::stof(val_str, &after_idx); // May throw.
+    float nested_val = parse_float(val_str, &after_idx); // May throw.
     always_assert_log(after_idx > 0,
                       "Could not parse first part of %s as float",
-                      val_str.c_str());
+                      std::string(val_str).c_str());
     always_assert_log(after_idx + 1 < val_str.size(),
                       "Could not find separator of %s",
-                      val_str.c_str());
+                      std::string(val_str).c_str());
     always_assert_log(val_str[after_idx] == ':',
                       "Did not find separating ':' in %s",
-                      val_str.c_str());
-    // This isn't efficient, but let's not play with low-level char* view.
-    // Small-string optimization is likely enough.
+                      std::string(val_str).c_str());
     auto appear_part = val_str.substr(after_idx + 1);
-    float appear100 = std::stof(appear_part, &after_idx);
+    float appear100 = parse_float(appear_part, &after_idx);
     always_assert_log(after_idx == appear_part.size(),
                       "Could not parse second part of %s as float",
-                      val_str.c_str());
+                      std::string(val_str).c_str());
 
     return SourceBlock::Val{nested_val, appear100};
   }
@@ -214,46 +271,49 @@ struct InsertHelper {
     if (p_state.had_profile_failure) {
       return kFailVal;
     }
-    if (p_state.root_expr.is_nil()) {
+    if (!p_state.has_profile()) {
       if (p_state.default_val) {
         return *p_state.default_val;
       }
       return kFailVal;
     }
-    if (p_state.expr_stack.empty()) {
+    auto open = p_state.peek();
+    if (open.empty()) {
       p_state.had_profile_failure = true;
       TRACE(MMINL, 3,
             "Failed profile matching for %s: missing element for block %zu",
             SHOW(method), cur->id());
       return kFailVal;
     }
-    std::string val_str;
-    const s_expr& e = p_state.expr_stack.back();
-    s_expr tail, inner_tail;
-    if (!s_patn({s_patn({s_patn(&val_str)}, inner_tail)}, tail).match_with(e)) {
+    if (open != "(") {
+      p_state.had_profile_failure = true;
+      TRACE(MMINL, 3,
+            "Failed profile matching for %s: cannot match string for %s",
+            SHOW(method), p_state.rest().c_str());
+      return kFailVal;
+    }
+    p_state.consume(open);
+    auto val_str = p_state.peek();
+    if (val_str.empty() || val_str == "(" || val_str == ")") {
       p_state.had_profile_failure = true;
       TRACE(MMINL, 3,
             "Failed profile matching for %s: cannot match string for %s",
-            SHOW(method), e.str().c_str());
+            SHOW(method), p_state.rest().c_str());
       return kFailVal;
     }
+    p_state.consume(val_str);
     if (empty_inner_tail) {
-      redex_assert(inner_tail.is_nil());
+      auto close = p_state.peek();
+      redex_assert(close == ")");
+      p_state.consume(close);
     }
     auto val = parse_val(val_str);
     TRACE(MMINL,
           5,
-          "Started block with val=%f/%f. Popping %s, pushing %s + %s",
+          "Started block with val=%f/%f. Remaining %s",
           val ? val->val : std::numeric_limits<float>::quiet_NaN(),
           val ? val->appear100 : std::numeric_limits<float>::quiet_NaN(),
-          e.str().c_str(),
-          tail.str().c_str(),
-          inner_tail.str().c_str());
-    p_state.expr_stack.pop_back();
-    p_state.expr_stack.push_back(tail);
-    if (!empty_inner_tail) {
-      p_state.expr_stack.push_back(inner_tail);
-    }
+          p_state.rest().c_str());
     return val;
   }
 
@@ -288,37 +348,29 @@ struct InsertHelper {
   void edge_profile_one(Block* /*cur*/,
                         const Edge* e,
                         ProfileParserState& p_state) {
-    // If running with profile, there should be at least a nil on.
-    if (p_state.had_profile_failure || p_state.expr_stack.empty()) {
+    if (p_state.had_profile_failure || !p_state.has_profile()) {
       return;
     }
-    std::string val;
-    s_expr& expr = p_state.expr_stack.back();
-    s_expr tail;
-    if (!s_patn({s_patn(&val)}, tail).match_with(expr)) {
+    auto val = p_state.peek();
+    if (val.empty() || val == "(" || val == ")") {
       p_state.had_profile_failure = true;
       TRACE(MMINL, 3,
             "Failed profile matching for %s: cannot match string for %s",
-            SHOW(method), expr.str().c_str());
+            SHOW(method), p_state.rest().c_str());
       return;
     }
-    std::string expected(1, get_edge_char(e));
-    if (expected != val) {
+    char expected = get_edge_char(e);
+    if (val.size() != 1 || val[0] != expected) {
       p_state.had_profile_failure = true;
       TRACE(MMINL, 3,
             "Failed profile matching for %s: edge type \"%s\" did not match "
-            "expectation \"%s\"",
-            SHOW(method), val.c_str(), expected.c_str());
+            "expectation \"%c\"",
+            SHOW(method), std::string(val).c_str(), expected);
       return;
     }
-    TRACE(MMINL,
-          5,
-          "Matched edge %s. Popping %s, pushing %s",
-          val.c_str(),
-          expr.str().c_str(),
-          tail.str().c_str());
-    p_state.expr_stack.pop_back();
-    p_state.expr_stack.push_back(tail);
+    p_state.consume(val);
+    TRACE(MMINL, 5, "Matched edge %c. Remaining %s", expected,
+          p_state.rest().c_str());
   }
 
   void end(Block* cur) {
@@ -338,10 +390,11 @@ struct InsertHelper {
     if (p_state.had_profile_failure) {
       return;
     }
-    if (p_state.root_expr.is_nil()) {
+    if (!p_state.has_profile()) {
       return;
     }
-    if (p_state.expr_stack.empty()) {
+    auto close = p_state.peek();
+    if (close.empty()) {
       TRACE(MMINL,
             3,
             "Failed profile matching for %s: empty stack on close",
@@ -349,7 +402,7 @@ struct InsertHelper {
       p_state.had_profile_failure = true;
       return;
     }
-    if (!p_state.expr_stack.back().is_nil()) {
+    if (close != ")") {
       TRACE(MMINL,
             3,
             "Failed profile matching for %s: edge sentinel not NIL",
@@ -357,15 +410,14 @@ struct InsertHelper {
       p_state.had_profile_failure = true;
       return;
     }
-    TRACE(MMINL, 5, "Popping %s", p_state.expr_stack.back().str().c_str());
-    p_state.expr_stack.pop_back(); // Remove sentinel nil.
+    p_state.consume(close);
   }
 
   bool wipe_profile_failures(ControlFlowGraph& cfg) {
     bool ret = false;
     for (size_t i = 0; i != parser_state.size(); ++i) {
       auto& p_state = parser_state[i];
-      if (p_state.root_expr.is_nil()) {
+      if (!p_state.has_profile()) {
         continue;
       }
       if (!p_state.had_profile_failure) {
@@ -381,7 +433,7 @@ struct InsertHelper {
       for (auto* b : cfg.blocks()) {
         auto vec = gather_source_blocks(b);
         for (auto* sb : vec) {
-          const_cast<SourceBlock*>(sb)->vals[i] = val;
+          const_cast<SourceBlock*>(sb)->set_val(i, val);
         }
       }
     }
@@ -513,7 +565,7 @@ size_t chain_hot_violations_tmpl(Block* block, const Fn& fn) {
       // next SourceBlock.
       auto* next = sb->next.get();
       size_t local_sum{0};
-      for (size_t i = 0; i != sb->vals.size(); ++i) {
+      for (size_t i = 0; i != sb->vals_size(); ++i) {
         auto sb_val = sb->get_val(i);
         auto next_val = next->get_val(i);
         if (sb_val) {
@@ -559,7 +611,7 @@ size_t chain_and_dom_violations(
   size_t sum{0};
   foreach_source_block(block, [&sum, &last](const auto* sb) {
     if (last != nullptr) {
-      for (size_t i = 0; i != sb->vals.size(); ++i) {
+      for (size_t i = 0; i != sb->vals_size(); ++i) {
         auto last_val = last->get_val(i);
         auto sb_val = sb->get_val(i);
         if (last_val) {
@@ -908,7 +960,7 @@ struct ViolationsHelper::ViolationsHelperImpl {
         os << " !!! B" << immediate_dominator->id() << ": ";
         auto sb = first_sb_immediate_dominator;
         os << " \"" << show(sb->src) << "\"@" << sb->id;
-        for (const auto& val : sb->vals) {
+        for (const auto& val : sb->vals()) {
           os << " ";
           if (val) {
             os << val->val << "/" << val->appear100;
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Timeline.h"
+
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Debug.h"
+
+namespace timeline {
+
+namespace detail {
+std::atomic<bool> s_enabled{false};
+} // namespace detail
+
+namespace {
+
+// Tasks that start at most this long after the previous one ended on the same
+// thread belong to the same batch.
+constexpr std::chrono::microseconds kMaxTaskGap{100};
+
+struct Event {
+  std::string name;
+  const char* category;
+  Clock::time_point begin;
+  Clock::time_point end;
+  // The number of tasks of a batch, or 0 for other events.
+  size_t tasks;
+};
+
+struct ThreadBuffer {
+  explicit ThreadBuffer(uint32_t tid) : tid(tid) {}
+
+  void flush_batch() {
+    if (batch.tasks > 0) {
+      events.push_back(std::move(batch));
+      batch = Event();
+    }
+  }
+
+  const uint32_t tid;
+  // A deque, so that growing it does not copy the events.
+  std::deque<Event> events;
+  Event batch{"", nullptr, {}, {}, 0};
+};
+
+// Taken only to register the buffer of a new thread, and to write the events.
+std::mutex s_buffers_lock;
+std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;
+const Clock::time_point s_epoch = Clock::now();
+
+thread_local ThreadBuffer* t_buffer = nullptr;
+
+ThreadBuffer* get_buffer() {
+  if (t_buffer == nullptr) {
+    std::lock_guard<std::mutex> guard(s_buffers_lock);
+    s_buffers.push_back(std::make_unique<ThreadBuffer>(s_buffers.size() + 1));
+    t_buffer = s_buffers.back().get();
+  }
+  return t_buffer;
+}
+
+int64_t to_micros(Clock::duration d) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+void write_escaped(std::ostream& out, const std::string& s) {
+  static const char* hex = "0123456789abcdef";
+  out << '"';
+  for (unsigned char c : s) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (c < 0x20) {
+      out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+} // namespace
+
+void set_enabled(bool enabled) {
+  detail::s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void record(std::string name,
+            const char* category,
+            Clock::time_point begin,
+            Clock::time_point end) {
+  if (!is_enabled()) {
+    return;
+  }
+  get_buffer()->events.push_back(
+      Event{std::move(name), category, begin, end, 0});
+}
+
+void record_task(const char* category,
+                 Clock::time_point begin,
+                 Clock::time_point end) {
+  if (!is_enabled()) {
+    return;
+  }
+  auto* buffer = get_buffer();
+  auto& batch = buffer->batch;
+  if (batch.tasks > 0 && batch.category == category &&
+      begin - batch.end <= kMaxTaskGap) {
+    batch.end = end;
+    ++batch.tasks;
+    return;
+  }
+  buffer->flush_batch();
+  batch = Event{category, category, begin, end, 1};
+}
+
+void write_chrome_trace(const std::string& path) {
+  std::lock_guard<std::mutex> guard(s_buffers_lock);
+  std::ofstream out(path);
+  always_assert_log(out, "Cannot write the timeline to %s", path.c_str());
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool first = true;
+  for (auto& buffer : s_buffers) {
+    buffer->flush_batch();
+    out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\","
+        << "\"pid\":0,\"tid\":" << buffer->tid << ",\"args\":{\"name\":"
+        << "\"thread " << buffer->tid << "\"}}";
+    first = false;
+    for (const auto& event : buffer->events) {
+      out << ",\n{\"name\":";
+      write_escaped(out, event.name);
+      out << ",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"ts\":"
+          << to_micros(event.begin - s_epoch)
+          << ",\"dur\":" << to_micros(event.end - event.begin)
+          << ",\"pid\":0,\"tid\":" << buffer->tid;
+      if (event.tasks > 0) {
+        out << ",\"args\":{\"tasks\":" << event.tasks << "}";
+      }
+      out << "}";
+    }
+  }
+  out << "\n]}\n";
+}
+
+} // namespace timeline
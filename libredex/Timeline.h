@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/*
+ * A timeline of what each thread was doing, for finding long tails and idle
+ * cores. It is written in the Chrome trace-event format, which chrome://tracing
+ * and Perfetto can show.
+ *
+ * Each thread records its events into its own buffer, without locking, so the
+ * recording is cheap enough to stay on in production builds. A thread only
+ * takes a lock the first time it records an event, to register its buffer.
+ *
+ * Work queue tasks are too many to record one by one, so consecutive tasks of a
+ * thread are coalesced into batches: a thread that goes idle for a while, or
+ * that starts running the tasks of another kind of queue, starts a new batch.
+ */
+namespace timeline {
+
+using Clock = std::chrono::high_resolution_clock;
+
+namespace detail {
+extern std::atomic<bool> s_enabled;
+} // namespace detail
+
+inline bool is_enabled() {
+  return detail::s_enabled.load(std::memory_order_relaxed);
+}
+
+void set_enabled(bool enabled);
+
+// Records an event that ran from `begin` to `end` on the current thread.
+// `category` must be a string literal.
+void record(std::string name,
+            const char* category,
+            Clock::time_point begin,
+            Clock::time_point end);
+
+// Records a work queue task that ran from `begin` to `end` on the current
+// thread, coalescing it with the previous one. `category` must be a string
+// literal.
+void record_task(const char* category,
+                 Clock::time_point begin,
+                 Clock::time_point end);
+
+// Records the tasks of a work queue, for one scope.
+class TaskScope {
+ public:
+  explicit TaskScope(const char* category)
+      : m_category(is_enabled() ? category : nullptr) {
+    if (m_category != nullptr) {
+      m_begin = Clock::now();
+    }
+  }
+
+  ~TaskScope() {
+    if (m_category != nullptr) {
+      record_task(m_category, m_begin, Clock::now());
+    }
+  }
+
+  TaskScope(const TaskScope&) = delete;
+  TaskScope& operator=(const TaskScope&) = delete;
+
+ private:
+  const char* m_category;
+  Clock::time_point m_begin;
+};
+
+// Writes all events recorded so far. There should be no threads recording
+// events when this function is called.
+void write_chrome_trace(const std::string& path);
+
+} // namespace timeline
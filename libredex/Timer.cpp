@@ -7,9 +7,10 @@
 
 #include "Timer.h"
 
+#include "Timeline.h"
 #include "Trace.h"
 
-unsigned Timer::s_indent = 0;
+thread_local unsigned Timer::s_indent = 0;
 std::mutex Timer::s_lock;
 Timer::times_t Timer::s_times;
 
@@ -24,6 +25,7 @@ Timer::~Timer() {
   auto duration_s = std::chrono::duration<double>(end - m_start).count();
   TRACE(TIME, 1, "%*s%s completed in %.1lf seconds", 4 * s_indent, "",
         m_msg.c_str(), duration_s);
+  timeline::record(m_msg, "timer", m_start, end);
 
   Timer::add_timer(std::move(m_msg), duration_s);
 }
@@ -27,7 +27,8 @@ struct Timer {
  private:
   static std::mutex s_lock;
   static times_t s_times;
-  static unsigned s_indent;
+  // Per thread, so that timers of background work nest on their own.
+  static thread_local unsigned s_indent;
   std::string m_msg;
   std::chrono::high_resolution_clock::time_point m_start;
 };
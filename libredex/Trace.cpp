@@ -8,6 +8,8 @@
 #include "Trace.h"
 
 #include <array>
+#include <chrono>
+#include <condition_variable>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
@@ -16,8 +18,11 @@
 #include <iostream>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include "ControlFlow.h"
 #include "Debug.h"
@@ -26,9 +31,91 @@
 #include "Macros.h"
 #include "Show.h"
 #include "TraceContextAccess.h"
+#include "TraceRecord.h"
 
 namespace {
 
+/*
+ * Writes blocks of encoded trace records to a file on a thread of its own, so
+ * that tracing threads do not wait for the file.
+ */
+class BufferedWriter {
+ public:
+  explicit BufferedWriter(FILE* file) : m_file(file) {
+    m_thread = std::thread([this]() { run(); });
+  }
+
+  ~BufferedWriter() {
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_done = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+  }
+
+  void submit(std::string block) {
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      m_blocks.push_back(std::move(block));
+    }
+    m_cv.notify_one();
+  }
+
+ private:
+  void run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+      m_cv.wait(lock, [this]() { return m_done || !m_blocks.empty(); });
+      auto blocks = std::move(m_blocks);
+      m_blocks.clear();
+      bool done = m_done;
+      lock.unlock();
+      for (const auto& block : blocks) {
+        fwrite(block.data(), 1, block.size(), m_file);
+      }
+      fflush(m_file);
+      lock.lock();
+      if (done && m_blocks.empty()) {
+        return;
+      }
+    }
+  }
+
+  FILE* m_file;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::vector<std::string> m_blocks;
+  bool m_done{false};
+  std::thread m_thread;
+};
+
+/*
+ * The records that a thread traced but did not hand to the writer yet. Only
+ * the thread itself appends to it; the mutex is only contended when the
+ * tracer flushes all buffers at exit.
+ */
+struct ThreadBuffer {
+  // Threads hand their records over in blocks of about this size.
+  static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+  std::mutex mutex;
+  std::string data;
+  uint32_t thread{0};
+  uint64_t seq{0};
+};
+
+struct Tracer;
+
+// Registers the buffer of a thread on first use, and flushes it when the
+// thread exits.
+struct ThreadBufferHolder {
+  ThreadBuffer* buffer{nullptr};
+  ~ThreadBufferHolder();
+};
+
+thread_local ThreadBufferHolder t_buffer;
+
 struct Tracer {
 
   bool m_show_timestamps{false};
@@ -41,6 +128,7 @@ struct Tracer {
     const char* envfile = getenv("TRACEFILE");
     const char* show_timestamps = getenv("SHOW_TIMESTAMPS");
     const char* show_tracemodule = getenv("SHOW_TRACEMODULE");
+    const char* buffered = getenv("TRACE_BUFFERED");
     m_method_filter = getenv("TRACE_METHOD_FILTER");
     if (!traceenv) {
       init_trace_file(nullptr);
@@ -59,6 +147,8 @@ struct Tracer {
     std::cerr << "TRACE_METHOD_FILTER="
               << (m_method_filter == nullptr ? "" : m_method_filter)
               << std::endl;
+    std::cerr << "TRACE_BUFFERED=" << (buffered == nullptr ? "" : buffered)
+              << std::endl;
 
     init_trace_modules(traceenv);
     init_trace_file(envfile);
@@ -73,9 +163,28 @@ struct Tracer {
 #define TM(x) m_module_id_name_map[static_cast<int>(x)] = #x;
     TMS
 #undef TM
+
+    if (buffered != nullptr && strcmp(buffered, "0") != 0) {
+      if (m_file == stderr) {
+        fprintf(stderr, "TRACE_BUFFERED needs a TRACEFILE, not buffering\n");
+      } else {
+        init_buffered();
+      }
+    }
   }
 
   ~Tracer() {
+    if (m_writer) {
+      std::lock_guard<std::mutex> guard(m_buffers_mutex);
+      for (auto* buffer : m_buffers) {
+        std::lock_guard<std::mutex> buffer_guard(buffer->mutex);
+        hand_over(buffer);
+      }
+      // The buffers of threads that are still running stay allocated, as
+      // the threads may still use them.
+      m_buffers.clear();
+      m_writer.reset();
+    }
     if (m_file != nullptr && m_file != stderr) {
       fclose(m_file);
     }
@@ -112,6 +221,10 @@ struct Tracer {
              va_list ap) {
     // Assume that `trace` is never called without `traceEnabled`, so we
     // do not need to check anything (including context) here.
+    if (m_writer) {
+      trace_buffered(module, level, suppress_newline, fmt, ap);
+      return;
+    }
     std::lock_guard<std::mutex> guard(m_trace_mutex);
     if (m_show_timestamps) {
       auto t = std::time(nullptr);
@@ -138,7 +251,108 @@ struct Tracer {
     fflush(m_file);
   }
 
+  // Unregisters the buffer of an exiting thread, and hands its records to
+  // the writer.
+  void release_buffer(ThreadBuffer* buffer) {
+    {
+      std::lock_guard<std::mutex> guard(m_buffers_mutex);
+      if (m_buffers.erase(buffer) == 0) {
+        // Already flushed at exit.
+        return;
+      }
+    }
+    {
+      std::lock_guard<std::mutex> guard(buffer->mutex);
+      hand_over(buffer);
+    }
+    delete buffer;
+  }
+
  private:
+  void init_buffered() {
+    auto write = [this](const void* data, size_t size) {
+      fwrite(data, 1, size, m_file);
+    };
+    write(trace_record::MAGIC, sizeof(trace_record::MAGIC));
+    uint32_t version = trace_record::VERSION;
+    write(&version, sizeof(version));
+    uint32_t num_modules = N_TRACE_MODULES;
+    write(&num_modules, sizeof(num_modules));
+    for (uint32_t module = 0; module < num_modules; ++module) {
+      const auto& name = m_module_id_name_map[module];
+      uint32_t length = name.size();
+      write(&length, sizeof(length));
+      write(name.data(), length);
+    }
+    m_writer = std::make_unique<BufferedWriter>(m_file);
+  }
+
+  ThreadBuffer* thread_buffer() {
+    auto* buffer = t_buffer.buffer;
+    if (buffer == nullptr) {
+      buffer = new ThreadBuffer();
+      buffer->data.reserve(ThreadBuffer::BLOCK_SIZE);
+      std::lock_guard<std::mutex> guard(m_buffers_mutex);
+      buffer->thread = m_next_thread++;
+      m_buffers.insert(buffer);
+      t_buffer.buffer = buffer;
+    }
+    return buffer;
+  }
+
+  // Must hold the mutex of the buffer.
+  void hand_over(ThreadBuffer* buffer) {
+    if (buffer->data.empty()) {
+      return;
+    }
+    std::string block;
+    block.reserve(ThreadBuffer::BLOCK_SIZE);
+    std::swap(block, buffer->data);
+    m_writer->submit(std::move(block));
+  }
+
+  void trace_buffered(TraceModule module,
+                      int level,
+                      bool suppress_newline,
+                      const char* fmt,
+                      va_list ap) {
+    std::array<char, 1024> small;
+    va_list ap_copy;
+    va_copy(ap_copy, ap);
+    int length = vsnprintf(small.data(), small.size(), fmt, ap_copy);
+    va_end(ap_copy);
+    if (length < 0) {
+      return;
+    }
+    std::string large;
+    const char* message = small.data();
+    if (static_cast<size_t>(length) >= small.size()) {
+      large.resize(length + 1);
+      vsnprintf(&large[0], large.size(), fmt, ap);
+      message = large.data();
+    }
+
+    auto* buffer = thread_buffer();
+    trace_record::Header header{};
+    header.timestamp_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    header.thread = buffer->thread;
+    header.length = length;
+    header.module = module;
+    header.level = level;
+    header.suppress_newline = suppress_newline;
+
+    std::lock_guard<std::mutex> guard(buffer->mutex);
+    header.seq = buffer->seq++;
+    buffer->data.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    buffer->data.append(message, length);
+    if (buffer->data.size() >= ThreadBuffer::BLOCK_SIZE) {
+      hand_over(buffer);
+    }
+  }
+
   void init_trace_modules(const char* traceenv) {
     std::unordered_map<std::string, int> module_id_map{{
 #define TM(x) {std::string(#x), x},
@@ -200,9 +414,21 @@ struct Tracer {
   std::array<long, N_TRACE_MODULES> m_traces;
 
   std::mutex m_trace_mutex;
+
+  // Non-null iff tracing is buffered.
+  std::unique_ptr<BufferedWriter> m_writer;
+  std::mutex m_buffers_mutex;
+  std::unordered_set<ThreadBuffer*> m_buffers;
+  uint32_t m_next_thread{0};
 };
 
 static Tracer tracer;
+
+ThreadBufferHolder::~ThreadBufferHolder() {
+  if (buffer != nullptr) {
+    tracer.release_buffer(buffer);
+  }
+}
 } // namespace
 
 #ifndef NDEBUG
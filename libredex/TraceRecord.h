@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+/*
+ * The binary format of buffered traces (TRACE_BUFFERED=1), as turned into
+ * text by tools/trace-formatter.
+ *
+ * A file starts with MAGIC, the VERSION as a uint32_t, and the number of
+ * trace modules as a uint32_t, followed by the name of each module as a
+ * uint32_t length and that many chars. Then come the records, each a Header
+ * followed by `length` chars of message, in the order in which the buffers of
+ * the threads were written. All integers are in the byte order of the host.
+ *
+ * Records of a thread are in the order of their sequence numbers, but the
+ * records of different threads interleave in blocks, so readers order them by
+ * timestamp, then thread, then sequence number.
+ */
+namespace trace_record {
+
+constexpr char MAGIC[8] = {'R', 'D', 'X', 'T', 'R', 'A', 'C', 'E'};
+constexpr uint32_t VERSION = 1;
+
+struct Header {
+  // Nanoseconds since the epoch of the system clock.
+  uint64_t timestamp_ns;
+  // Per-thread sequence number, starting at 0.
+  uint64_t seq;
+  // Small number of the thread, in the order in which threads first traced.
+  uint32_t thread;
+  // Length of the message that follows.
+  uint32_t length;
+  uint16_t module;
+  uint8_t level;
+  uint8_t suppress_newline;
+  uint32_t padding;
+};
+
+static_assert(sizeof(Header) == 32, "Header must not have implicit padding");
+
+} // namespace trace_record
@@ -72,7 +72,8 @@ void load_interface_children(const Scope& scope, ClassHierarchy& children) {
 const TypeSet TypeSystem::empty_set = TypeSet();
 const TypeVector TypeSystem::empty_vec = TypeVector();
 
-TypeSystem::TypeSystem(const Scope& scope) : m_class_scopes(scope) {
+TypeSystem::TypeSystem(const Scope& scope)
+    : m_class_scopes(ClassScopes::get_or_build(scope)) {
   load_interface_children(scope, m_intf_children);
   make_instanceof_interfaces_table();
 }
@@ -130,7 +131,7 @@ const VirtualScope* TypeSystem::find_virtual_scope(
   auto type = meth->get_class();
   while (type != nullptr) {
     TRACE(VIRT, 5, "check... %s", SHOW(type));
-    for (const auto& scope : m_class_scopes.get(type)) {
+    for (const auto& scope : m_class_scopes->get(type)) {
       TRACE(VIRT, 5, "check... %s", SHOW(scope->methods[0].first));
       if (match(scope->methods[0].first, meth)) {
         TRACE(VIRT, 5, "return scope");
@@ -173,7 +174,7 @@ std::vector<const DexMethod*> TypeSystem::select_from(
 
 void TypeSystem::make_instanceof_interfaces_table() {
   TypeVector no_parents;
-  const auto& hierarchy = m_class_scopes.get_class_hierarchy();
+  const auto& hierarchy = m_class_scopes->get_class_hierarchy();
   for (const auto& children_it : hierarchy) {
     const auto parent = children_it.first;
     const auto parent_cls = type_class(parent);
@@ -187,6 +188,36 @@ void TypeSystem::make_instanceof_interfaces_table() {
   for (const auto& root : no_parents) {
     make_interfaces_table(root);
   }
+  for (const auto& root : no_parents) {
+    // java.lang.Object is also a root without parent when it has no class.
+    if (m_class_nodes.count(root) == 0) {
+      number_classes(root);
+    }
+  }
+}
+
+void TypeSystem::number_classes(const DexType* type) {
+  ClassNode node;
+  node.pre = m_preorder.size();
+  m_preorder.push_back(type);
+  node.intfs_begin = m_implemented_intfs.size();
+  for (const auto& intf : get_implemented_interfaces(type)) {
+    auto id = m_interface_ids.emplace(intf, m_interface_ids.size()).first;
+    m_implemented_intfs.push_back(id->second);
+  }
+  node.intfs_end = m_implemented_intfs.size();
+  std::sort(m_implemented_intfs.begin() + node.intfs_begin,
+            m_implemented_intfs.end());
+
+  const auto& hierarchy = m_class_scopes->get_class_hierarchy();
+  const auto& children = hierarchy.find(type);
+  if (children != hierarchy.end()) {
+    for (const auto& child : children->second) {
+      number_classes(child);
+    }
+  }
+  node.last = m_preorder.size() - 1;
+  m_class_nodes.emplace(type, node);
 }
 
 void TypeSystem::make_interfaces_table(const DexType* type) {
@@ -206,7 +237,7 @@ void TypeSystem::make_interfaces_table(const DexType* type) {
     }
   }
 
-  const auto& hierarchy = m_class_scopes.get_class_hierarchy();
+  const auto& hierarchy = m_class_scopes->get_class_hierarchy();
   const auto& children = hierarchy.find(type);
   if (children == hierarchy.end()) return;
   for (const auto& child : children->second) {
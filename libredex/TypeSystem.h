@@ -11,7 +11,9 @@
 #include "DexClass.h"
 #include "VirtualScope.h"
 
+#include <algorithm>
 #include <unordered_map>
+#include <vector>
 
 using TypeVector = std::vector<const DexType*>;
 using InstanceOfTable = std::unordered_map<const DexType*, TypeVector>;
@@ -34,11 +36,27 @@ class TypeSystem {
   static const TypeSet empty_set;
   static const TypeVector empty_vec;
 
-  ClassScopes m_class_scopes;
+  std::shared_ptr<const ClassScopes> m_class_scopes;
   ClassHierarchy m_intf_children;
   InstanceOfTable m_instanceof_table;
   TypeToTypeSet m_interfaces;
 
+  // The class hierarchy, flattened for the queries that are issued the most.
+  // Classes are numbered in DFS preorder, so that the subtree of a class is
+  // the range [pre, last] of numbers. The interfaces a class implements are
+  // the sorted range [intfs_begin, intfs_end) of interface ids in
+  // m_implemented_intfs.
+  struct ClassNode {
+    uint32_t pre;
+    uint32_t last;
+    uint32_t intfs_begin;
+    uint32_t intfs_end;
+  };
+  std::unordered_map<const DexType*, ClassNode> m_class_nodes;
+  TypeVector m_preorder;
+  std::unordered_map<const DexType*, uint32_t> m_interface_ids;
+  std::vector<uint32_t> m_implemented_intfs;
+
  public:
   explicit TypeSystem(const Scope& scope);
 
@@ -47,8 +65,8 @@ class TypeSystem {
    * The type must be a class (not an interface).
    */
   const TypeSet& get_children(const DexType* type) const {
-    const auto& children = m_class_scopes.get_class_hierarchy().find(type);
-    return children != m_class_scopes.get_class_hierarchy().end()
+    const auto& children = m_class_scopes->get_class_hierarchy().find(type);
+    return children != m_class_scopes->get_class_hierarchy().end()
                ? children->second
                : empty_set;
   }
@@ -58,8 +76,14 @@ class TypeSystem {
    * The type must be a class (not an interface).
    */
   void get_all_children(const DexType* type, TypeSet& children) const {
-    return ::get_all_children(
-        m_class_scopes.get_class_hierarchy(), type, children);
+    const auto& node = m_class_nodes.find(type);
+    if (node == m_class_nodes.end()) {
+      ::get_all_children(m_class_scopes->get_class_hierarchy(), type,
+                         children);
+      return;
+    }
+    children.insert(m_preorder.begin() + node->second.pre + 1,
+                    m_preorder.begin() + node->second.last + 1);
   }
 
   /**
@@ -106,16 +130,14 @@ class TypeSystem {
    * The type must be a class (not an interface).
    */
   bool is_subtype(const DexType* parent, const DexType* child) const {
-    const auto& parent_it = m_instanceof_table.find(parent);
-    const auto& child_it = m_instanceof_table.find(child);
-    if (parent_it == m_instanceof_table.end() ||
-        child_it == m_instanceof_table.end()) {
+    const auto& parent_it = m_class_nodes.find(parent);
+    const auto& child_it = m_class_nodes.find(child);
+    if (parent_it == m_class_nodes.end() || child_it == m_class_nodes.end()) {
       return false;
     }
-    const auto& p_chain = parent_it->second;
-    const auto& c_chain = child_it->second;
-    if (p_chain.size() > c_chain.size()) return false;
-    return c_chain.at(p_chain.size() - 1) == parent;
+    const auto& p_node = parent_it->second;
+    const auto& c_node = child_it->second;
+    return p_node.pre <= c_node.pre && c_node.pre <= p_node.last;
   }
 
   /**
@@ -124,9 +146,15 @@ class TypeSystem {
    * or an interface DAG.
    */
   bool implements(const DexType* cls, const DexType* intf) const {
-    const auto& implementors = m_class_scopes.get_interface_map().find(intf);
-    if (implementors == m_class_scopes.get_interface_map().end()) return false;
-    return implementors->second.count(cls) > 0;
+    const auto& node_it = m_class_nodes.find(cls);
+    const auto& id_it = m_interface_ids.find(intf);
+    if (node_it == m_class_nodes.end() || id_it == m_interface_ids.end()) {
+      return false;
+    }
+    const auto& node = node_it->second;
+    return std::binary_search(
+        m_implemented_intfs.begin() + node.intfs_begin,
+        m_implemented_intfs.begin() + node.intfs_end, id_it->second);
   }
 
   /**
@@ -137,8 +165,8 @@ class TypeSystem {
    * interface will be included in the returning set.
    */
   const TypeSet& get_implementors(const DexType* intf) const {
-    const auto& implementors = m_class_scopes.get_interface_map().find(intf);
-    if (implementors == m_class_scopes.get_interface_map().end()) {
+    const auto& implementors = m_class_scopes->get_interface_map().find(intf);
+    if (implementors == m_class_scopes->get_interface_map().end()) {
       return empty_set;
     }
     return implementors->second;
@@ -181,14 +209,14 @@ class TypeSystem {
    * The ClassScopes lifetime is tied to that of the TypeSystem, as
    * such it should not exceed it.
    */
-  const ClassScopes& get_class_scopes() const { return m_class_scopes; }
+  const ClassScopes& get_class_scopes() const { return *m_class_scopes; }
 
   /**
    * Given a DexMethod return the scope the method is in.
    */
   const VirtualScope* find_virtual_scope(const DexMethod* meth) const;
   InterfaceScope find_interface_scope(const DexMethod* meth) const {
-    return m_class_scopes.find_interface_scope(meth);
+    return m_class_scopes->find_interface_scope(meth);
   }
 
   /**
@@ -223,4 +251,5 @@ class TypeSystem {
  private:
   void make_instanceof_interfaces_table();
   void make_interfaces_table(const DexType* type);
+  void number_classes(const DexType* type);
 };
@@ -10,12 +10,17 @@
 #include "DexAccess.h"
 #include "DexUtil.h"
 #include "ReachableClasses.h"
+#include "RedexContext.h"
 #include "Show.h"
 #include "Timer.h"
 #include "Trace.h"
+#include "WorkQueue.h"
 
+#include <algorithm>
 #include <map>
+#include <numeric>
 #include <set>
+#include <unordered_map>
 
 namespace {
 
@@ -320,15 +325,16 @@ void build_interface_scope(const DexType* type,
 }
 
 /**
- * Merge 2 signatures map. The map from derived_sig_map is copied in
- * base_sig_map.
+ * Merge the scopes of the signatures with the given name in a derived type
+ * into those of base, whose signatures with that name are `name_map`.
  * Interface methods in base don't have an entry yet, that will be build later
  * because it's a straight copy of the class virtual scope.
  */
 void merge(const BaseSigs& base_sigs,
            const BaseIntfSigs& base_intf_sig_map,
-           SignatureMap& base_sig_map,
-           const SignatureMap& derived_sig_map) {
+           const DexString* name,
+           ProtoMap& name_map,
+           const ProtoMap& derived_protos_map) {
 
   // Helpers
 
@@ -357,105 +363,114 @@ void merge(const BaseSigs& base_sigs,
       };
 
   // walk all derived signatures
-  for (const auto& derived_sig_entry : derived_sig_map) {
-    const auto name = derived_sig_entry.first;
-    auto& name_map = base_sig_map[name];
-    auto& derived_protos_map = derived_sig_entry.second;
-    for (const auto& derived_scopes_it : derived_protos_map) {
-      const auto proto = derived_scopes_it.first;
-      auto& virt_scopes = name_map[proto];
-      // the signature in derived does not exists in base
-      if (!is_base_sig(name, proto)) {
-        TRACE(VIRT,
-              4,
-              "- no scope (%s:%s) in base, copy over",
-              SHOW(name),
-              SHOW(proto));
-        // not a known signature in original base, copy over
-        const auto& scopes = derived_scopes_it.second;
-        virt_scopes.insert(virt_scopes.end(), scopes.begin(), scopes.end());
-        if (traceEnabled(VIRT, 4)) {
-          for (const auto& scope : scopes) {
-            TRACE(VIRT,
-                  4,
-                  "- copy %s (%s:%s): (%ld) %s",
-                  SHOW(scope.type),
-                  SHOW(name),
-                  SHOW(proto),
-                  scope.methods.size(),
-                  SHOW(scope.methods[0].first));
-          }
-        }
-        continue;
-      }
-
-      // it's a sig (name, proto) in original base, the derived entry
-      // needs to merge
-      // first scope in base_sig_map must be that of the type under
-      // analysis because we built it first and added to the empty vector
-      always_assert(!virt_scopes.empty());
+  for (const auto& derived_scopes_it : derived_protos_map) {
+    const auto proto = derived_scopes_it.first;
+    auto& virt_scopes = name_map[proto];
+    // the signature in derived does not exists in base
+    if (!is_base_sig(name, proto)) {
       TRACE(VIRT,
             4,
-            "- found existing scopes for %s:%s (%ld) - first: %s, %ld, %ld",
+            "- no scope (%s:%s) in base, copy over",
             SHOW(name),
-            SHOW(proto),
-            virt_scopes.size(),
-            SHOW(virt_scopes[0].type),
-            virt_scopes[0].methods.size(),
-            virt_scopes[0].interfaces.size());
-      always_assert(virt_scopes[0].type == type::java_lang_Object() ||
-                    !is_interface(type_class(virt_scopes[0].type)));
-      // walk every scope in derived that we have to merge
-      TRACE(VIRT, 4, "-- walking scopes");
-      for (const auto& scope : derived_scopes_it.second) {
-        // if the scope was for a class (!interface) we merge
-        // with that of base which is now the top definition
-        TRACE(VIRT,
-              4,
-              "-- checking scope type %s(%ld)",
-              SHOW(scope.type),
-              scope.methods.size());
-        TRACE(VIRT,
-              4,
-              "-- is interface 0x%p %d",
-              scope.type,
-              scope.type != type::java_lang_Object() &&
-                  is_interface(type_class(scope.type)));
-        if (scope.type == type::java_lang_Object() ||
-            !is_interface(type_class(scope.type))) {
+            SHOW(proto));
+      // not a known signature in original base, copy over
+      const auto& scopes = derived_scopes_it.second;
+      virt_scopes.insert(virt_scopes.end(), scopes.begin(), scopes.end());
+      if (traceEnabled(VIRT, 4)) {
+        for (const auto& scope : scopes) {
           TRACE(VIRT,
                 4,
-                "-- merging with base scopes %s(%ld) : %s",
-                SHOW(virt_scopes[0].type),
-                virt_scopes[0].methods.size(),
-                SHOW(virt_scopes[0].methods[0].first));
-          merge(virt_scopes[0], scope);
-          continue;
-        }
-        // interface case. If derived was for an interface in base
-        // do nothing because we will create those entries later
-        if (!is_base_intf_sig(name, proto, scope.type)) {
-          TRACE(VIRT,
-                4,
-                "-- unimplemented interface %s:%s - %s, %s",
+                "- copy %s (%s:%s): (%ld) %s",
+                SHOW(scope.type),
                 SHOW(name),
                 SHOW(proto),
-                SHOW(scope.type),
+                scope.methods.size(),
                 SHOW(scope.methods[0].first));
-          virt_scopes.push_back(scope);
-          continue;
         }
+      }
+      continue;
+    }
+
+    // it's a sig (name, proto) in original base, the derived entry
+    // needs to merge
+    // first scope in base_sig_map must be that of the type under
+    // analysis because we built it first and added to the empty vector
+    always_assert(!virt_scopes.empty());
+    TRACE(VIRT,
+          4,
+          "- found existing scopes for %s:%s (%ld) - first: %s, %ld, %ld",
+          SHOW(name),
+          SHOW(proto),
+          virt_scopes.size(),
+          SHOW(virt_scopes[0].type),
+          virt_scopes[0].methods.size(),
+          virt_scopes[0].interfaces.size());
+    always_assert(virt_scopes[0].type == type::java_lang_Object() ||
+                  !is_interface(type_class(virt_scopes[0].type)));
+    // walk every scope in derived that we have to merge
+    TRACE(VIRT, 4, "-- walking scopes");
+    for (const auto& scope : derived_scopes_it.second) {
+      // if the scope was for a class (!interface) we merge
+      // with that of base which is now the top definition
+      TRACE(VIRT,
+            4,
+            "-- checking scope type %s(%ld)",
+            SHOW(scope.type),
+            scope.methods.size());
+      TRACE(VIRT,
+            4,
+            "-- is interface 0x%p %d",
+            scope.type,
+            scope.type != type::java_lang_Object() &&
+                is_interface(type_class(scope.type)));
+      if (scope.type == type::java_lang_Object() ||
+          !is_interface(type_class(scope.type))) {
         TRACE(VIRT,
               4,
-              "-- implemented interface %s:%s - %s",
+              "-- merging with base scopes %s(%ld) : %s",
+              SHOW(virt_scopes[0].type),
+              virt_scopes[0].methods.size(),
+              SHOW(virt_scopes[0].methods[0].first));
+        merge(virt_scopes[0], scope);
+        continue;
+      }
+      // interface case. If derived was for an interface in base
+      // do nothing because we will create those entries later
+      if (!is_base_intf_sig(name, proto, scope.type)) {
+        TRACE(VIRT,
+              4,
+              "-- unimplemented interface %s:%s - %s, %s",
               SHOW(name),
               SHOW(proto),
-              SHOW(scope.type));
+              SHOW(scope.type),
+              SHOW(scope.methods[0].first));
+        virt_scopes.push_back(scope);
+        continue;
       }
+      TRACE(VIRT,
+            4,
+            "-- implemented interface %s:%s - %s",
+            SHOW(name),
+            SHOW(proto),
+            SHOW(scope.type));
     }
   }
 }
 
+/**
+ * Merge 2 signatures map. The map from derived_sig_map is copied in
+ * base_sig_map.
+ */
+void merge(const BaseSigs& base_sigs,
+           const BaseIntfSigs& base_intf_sig_map,
+           SignatureMap& base_sig_map,
+           const SignatureMap& derived_sig_map) {
+  for (const auto& [name, derived_protos_map] : derived_sig_map) {
+    merge(base_sigs, base_intf_sig_map, name, base_sig_map[name],
+          derived_protos_map);
+  }
+}
+
 //
 // Helpers to load interface methods in a MethodMap.
 //
@@ -609,10 +624,70 @@ void load_methods(const DexType* type, SignatureMap& sig_map) {
   }
 }
 
+// Merge the children of a type in parallel, one signature name per task, once
+// they have at least that many names in total. Below that, the tasks cost more
+// than they save, and the type is built in parallel with the others at its
+// height anyway.
+constexpr size_t kParallelMergeMinNames = 4096;
+
+/**
+ * The SignatureMap of a type while building that of java.lang.Object, and
+ * whether anything in or under the type escapes.
+ */
+struct TypeSigs {
+  SignatureMap sig_map;
+  bool escape{false};
+};
+
+/**
+ * Merge the signature maps of all the children of a type into its own, in
+ * parallel across signature names. The children are merged in order for each
+ * name, which is the same as merging them one after the other.
+ */
+void merge_parallel(const BaseSigs& base_sigs,
+                    const BaseIntfSigs& base_intf_sig_map,
+                    SignatureMap& base_sig_map,
+                    const std::vector<const SignatureMap*>& derived_sig_maps) {
+  struct NameMerge {
+    const DexString* name;
+    ProtoMap* name_map;
+    std::vector<const ProtoMap*> derived_protos_maps;
+  };
+  // Create all the entries of base first, so that tasks don't insert in it.
+  std::vector<NameMerge> merges;
+  std::unordered_map<const DexString*, size_t> merge_indices;
+  for (const auto* derived_sig_map : derived_sig_maps) {
+    for (const auto& [name, derived_protos_map] : *derived_sig_map) {
+      auto [it, emplaced] = merge_indices.emplace(name, merges.size());
+      if (emplaced) {
+        merges.push_back({name, &base_sig_map[name], {}});
+      }
+      merges[it->second].derived_protos_maps.push_back(&derived_protos_map);
+    }
+  }
+  std::vector<NameMerge*> tasks;
+  tasks.reserve(merges.size());
+  for (auto& name_merge : merges) {
+    tasks.push_back(&name_merge);
+  }
+  workqueue_run<NameMerge*>(
+      [&](NameMerge* name_merge) {
+        for (const auto* derived_protos_map :
+             name_merge->derived_protos_maps) {
+          merge(base_sigs,
+                base_intf_sig_map,
+                name_merge->name,
+                *name_merge->name_map,
+                *derived_protos_map);
+        }
+      },
+      tasks);
+}
+
 /**
  * Compute VirtualScopes and virtual method flags.
- * Starting from java.lang.Object recursively walk the type hierarchy down
- * and while unwinding compare each method in the class being traversed with
+ * Starting from the leaves of the java.lang.Object hierarchy walk the type
+ * hierarchy up and compare each method in the class being traversed with
  * all methods coming from the children.
  * Then perform the following:
  * 1- if a method in the parent does not exist in any children mark it FINAL
@@ -647,11 +722,13 @@ void load_methods(const DexType* type, SignatureMap& sig_map) {
  * ESCAPED but methods in D are not, so in this case they are just FINAL and
  * effectively D.k() would be non virtual as opposed to C.k() which is ESCAPED.
  */
-bool build_signature_map(const ClassHierarchy& hierarchy,
-                         const DexType* type,
-                         SignatureMap& sig_map) {
-  always_assert_log(sig_map.empty(),
-                    "intf_methods and children_methods are out params");
+void build_signature_map(
+    const ClassHierarchy& hierarchy,
+    const DexType* type,
+    std::unordered_map<const DexType*, TypeSigs>& type_sigs,
+    bool parallel_merge) {
+  auto& sigs = type_sigs.at(type);
+  auto& sig_map = sigs.sig_map;
   const TypeSet& children = hierarchy.at(type);
   TRACE(VIRT, 3, "* Visit %s", SHOW(type));
 
@@ -662,19 +739,34 @@ bool build_signature_map(const ClassHierarchy& hierarchy,
   BaseSigs base_sigs = load_base_sigs(sig_map);
   TRACE(VIRT, 3, "* Sig map computed for %s", SHOW(type));
 
-  // recurse through every child to collect all methods
+  // the children are all built by now, merge all methods
   // and interface methods under type
   bool escape_up = false;
+  std::vector<const SignatureMap*> child_sig_maps;
   for (const auto& child : children) {
-    SignatureMap child_sig_map;
-    escape_up =
-        build_signature_map(hierarchy, child, child_sig_map) || escape_up;
+    const auto& child_sigs = type_sigs.at(child);
+    escape_up = escape_up || child_sigs.escape;
+    child_sig_maps.push_back(&child_sigs.sig_map);
+  }
+  if (parallel_merge) {
     TRACE(VIRT,
           3,
-          "* Merging sig map of %s with child %s",
+          "* Merging sig map of %s with %zu children in parallel",
           SHOW(type),
-          SHOW(child));
-    merge(base_sigs, intf_sig_map, sig_map, child_sig_map);
+          children.size());
+    merge_parallel(base_sigs, intf_sig_map, sig_map, child_sig_maps);
+  } else {
+    for (const auto& child : children) {
+      TRACE(VIRT,
+            3,
+            "* Merging sig map of %s with child %s",
+            SHOW(type),
+            SHOW(child));
+      merge(base_sigs, intf_sig_map, sig_map, type_sigs.at(child).sig_map);
+    }
+  }
+  for (const auto& child : children) {
+    type_sigs.at(child).sig_map.clear();
   }
 
   TRACE(VIRT, 3, "* Marking methods at %s", SHOW(type));
@@ -685,7 +777,25 @@ bool build_signature_map(const ClassHierarchy& hierarchy,
   }
 
   TRACE(VIRT, 3, "* Visited %s(%d, %d)", SHOW(type), escape_up, escape_down);
-  return escape_up | escape_down;
+  sigs.escape = escape_up || escape_down;
+}
+
+/**
+ * Group type and the types under it by their height in the hierarchy, leaves
+ * first. Returns the height of type.
+ */
+size_t group_by_height(const ClassHierarchy& hierarchy,
+                       const DexType* type,
+                       std::vector<std::vector<const DexType*>>& levels) {
+  size_t height = 0;
+  for (const auto& child : hierarchy.at(type)) {
+    height = std::max(height, group_by_height(hierarchy, child, levels) + 1);
+  }
+  if (levels.size() <= height) {
+    levels.resize(height + 1);
+  }
+  levels[height].push_back(type);
+  return height;
 }
 
 const VirtualScope* find_rooted_scope(const SignatureMap& sig_map,
@@ -715,7 +825,7 @@ const VirtualScope* find_rooted_scope(const SignatureMap& sig_map,
 void get_rooted_interface_scope(const SignatureMap& sig_map,
                                 const DexType* type,
                                 const DexClass* cls,
-                                Scopes& cls_scopes) {
+                                std::vector<const VirtualScope*>& type_scopes) {
   for (const auto& intf : *cls->get_interfaces()) {
     const DexClass* intf_cls = type_class(intf);
     if (intf_cls == nullptr) continue;
@@ -723,15 +833,9 @@ void get_rooted_interface_scope(const SignatureMap& sig_map,
       const auto scope = find_rooted_scope(sig_map, type, meth);
       if (scope != nullptr && scope->type == type &&
           !scope->methods[0].first->is_def()) {
-        const auto& existing_scopes = cls_scopes.find(type);
-        if (existing_scopes != cls_scopes.end()) {
-          bool already_found = false;
-          for (const auto& existing_scope : existing_scopes->second) {
-            if (existing_scope == scope) {
-              already_found = true;
-            }
-          }
-          if (already_found) continue;
+        if (std::find(type_scopes.begin(), type_scopes.end(), scope) !=
+            type_scopes.end()) {
+          continue;
         }
         TRACE(VIRT,
               9,
@@ -739,20 +843,20 @@ void get_rooted_interface_scope(const SignatureMap& sig_map,
               show_deobfuscated(meth).c_str(),
               SHOW(meth->get_name()),
               SHOW(type));
-        cls_scopes[type].emplace_back(scope);
+        type_scopes.emplace_back(scope);
       }
     }
-    get_rooted_interface_scope(sig_map, type, intf_cls, cls_scopes);
+    get_rooted_interface_scope(sig_map, type, intf_cls, type_scopes);
   }
 }
 
 /**
- * Find all scopes rooted to a given type and adds it to
- * ClassScope for the given type.
+ * Find all scopes rooted to a given type and adds them to
+ * the scopes of the type.
  */
 void get_root_scopes(const SignatureMap& sig_map,
                      const DexType* type,
-                     Scopes& cls_scopes) {
+                     std::vector<const VirtualScope*>& type_scopes) {
   const std::vector<DexMethod*>& methods = get_vmethods(type);
   TRACE(VIRT, 9, "found %ld vmethods for %s", methods.size(), SHOW(type));
   for (const auto meth : methods) {
@@ -764,19 +868,55 @@ void get_root_scopes(const SignatureMap& sig_map,
       if (scope.type == type) {
         TRACE(VIRT, 9, "add virtual scope for %s", SHOW(type));
         always_assert(scope.methods[0].first == meth);
-        cls_scopes[type].emplace_back(&scope);
+        type_scopes.emplace_back(&scope);
       }
     }
   }
-  get_rooted_interface_scope(sig_map, type, type_class(type), cls_scopes);
+  get_rooted_interface_scope(sig_map, type, type_class(type), type_scopes);
 }
 
 } // namespace
 
 SignatureMap build_signature_map(const ClassHierarchy& class_hierarchy) {
-  SignatureMap signature_map;
-  build_signature_map(class_hierarchy, type::java_lang_Object(), signature_map);
-  return signature_map;
+  // The subtrees of the types at a given height are disjoint, and all the
+  // types under them are lower, so the types at each height are built in
+  // parallel once those below are.
+  std::vector<std::vector<const DexType*>> levels;
+  group_by_height(class_hierarchy, type::java_lang_Object(), levels);
+  std::unordered_map<const DexType*, TypeSigs> type_sigs;
+  for (const auto& level : levels) {
+    for (const auto* type : level) {
+      type_sigs[type];
+    }
+  }
+
+  for (const auto& level : levels) {
+    std::vector<const DexType*> types;
+    std::vector<const DexType*> large_merges;
+    for (const auto* type : level) {
+      const auto& children = class_hierarchy.at(type);
+      size_t num_names = 0;
+      for (const auto& child : children) {
+        num_names += type_sigs.at(child).sig_map.size();
+      }
+      if (children.size() > 1 && num_names >= kParallelMergeMinNames) {
+        large_merges.push_back(type);
+      } else {
+        types.push_back(type);
+      }
+    }
+    workqueue_run<const DexType*>(
+        [&](const DexType* type) {
+          build_signature_map(class_hierarchy, type, type_sigs,
+                              /* parallel_merge */ false);
+        },
+        types);
+    for (const auto* type : large_merges) {
+      build_signature_map(class_hierarchy, type, type_sigs,
+                          /* parallel_merge */ true);
+    }
+  }
+  return std::move(type_sigs.at(type::java_lang_Object()).sig_map);
 }
 
 const std::vector<DexMethod*>& get_vmethods(const DexType* type) {
@@ -852,7 +992,7 @@ ClassScopes::ClassScopes(const Scope& scope) {
   m_hierarchy = build_type_hierarchy(scope);
   m_interface_map = build_interface_map(m_hierarchy);
   m_sig_map = build_signature_map(m_hierarchy);
-  build_class_scopes(type::java_lang_Object());
+  build_class_scopes();
   build_interface_scopes();
 }
 
@@ -861,19 +1001,37 @@ const ClassHierarchy& ClassScopes::get_parent_to_children() const {
 }
 
 /**
- * Builds the ClassScope for type and children.
- * Calling with type::java_lang_Object() builds the ClassScope
+ * Builds the ClassScope for java.lang.Object and all its children, that is
  * for the entire system as redex knows it.
  */
-void ClassScopes::build_class_scopes(const DexType* type) {
-  auto cls = type_class(type);
-  always_assert(cls != nullptr || type == type::java_lang_Object());
-  get_root_scopes(m_sig_map, type, m_scopes);
+void ClassScopes::build_class_scopes() {
+  std::vector<const DexType*> types;
+  std::vector<const DexType*> stack{type::java_lang_Object()};
+  while (!stack.empty()) {
+    const auto* type = stack.back();
+    stack.pop_back();
+    types.push_back(type);
+    const auto& children_it = m_hierarchy.find(type);
+    if (children_it != m_hierarchy.end()) {
+      stack.insert(stack.end(), children_it->second.begin(),
+                   children_it->second.end());
+    }
+  }
 
-  const auto& children_it = m_hierarchy.find(type);
-  if (children_it != m_hierarchy.end()) {
-    for (const auto& child : children_it->second) {
-      build_class_scopes(child);
+  std::vector<std::vector<const VirtualScope*>> type_scopes(types.size());
+  std::vector<size_t> indices(types.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        const auto* type = types[i];
+        auto cls = type_class(type);
+        always_assert(cls != nullptr || type == type::java_lang_Object());
+        get_root_scopes(m_sig_map, type, type_scopes[i]);
+      },
+      indices);
+  for (size_t i = 0; i < types.size(); ++i) {
+    if (!type_scopes[i].empty()) {
+      m_scopes.emplace(types[i], std::move(type_scopes[i]));
     }
   }
 }
@@ -919,3 +1077,52 @@ InterfaceScope ClassScopes::find_interface_scope(const DexMethod* meth) const {
 }
 
 std::string ClassScopes::show_type(const DexType* type) { return show(type); }
+
+std::shared_ptr<const ClassScopes> ClassScopes::get_or_build(
+    const Scope& scope) {
+  return g_redex->class_scopes_cache().get(scope);
+}
+
+namespace {
+
+std::vector<uint64_t> snapshot_scope(const Scope& scope) {
+  std::vector<uint64_t> words;
+  auto add = [&words](const void* ptr) {
+    words.push_back(reinterpret_cast<uintptr_t>(ptr));
+  };
+  for (const auto* cls : scope) {
+    add(cls);
+    add(cls->get_super_class());
+    words.push_back(cls->get_access());
+    // Interfaces outside of scope may also be defined or not.
+    const auto* interfaces = cls->get_interfaces();
+    add(interfaces);
+    for (const auto* intf : *interfaces) {
+      add(type_class(intf));
+    }
+    const auto& vmethods = cls->get_vmethods();
+    words.push_back(vmethods.size());
+    for (const auto* method : vmethods) {
+      add(method);
+      add(method->get_name());
+      add(method->get_proto());
+    }
+  }
+  return words;
+}
+
+} // namespace
+
+std::shared_ptr<const ClassScopes> ClassScopesCache::get(const Scope& scope) {
+  auto snapshot = snapshot_scope(scope);
+  std::lock_guard<std::mutex> lock(m_lock);
+  if (m_class_scopes != nullptr && snapshot == m_snapshot) {
+    TRACE(VIRT, 2, "Reusing class scopes of %zu classes", scope.size());
+    return m_class_scopes;
+  }
+  // Drop the stale scopes before building new ones.
+  m_class_scopes = nullptr;
+  m_class_scopes = std::make_shared<const ClassScopes>(scope);
+  m_snapshot = std::move(snapshot);
+  return m_class_scopes;
+}
@@ -12,6 +12,8 @@
 #include "DexUtil.h"
 #include "Timer.h"
 #include <map>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -274,6 +276,14 @@ class ClassScopes {
  public:
   explicit ClassScopes(const Scope& scope);
 
+  /**
+   * Return the ClassScopes of the given scope, shared with the callers before
+   * for as long as the classes in scope, their hierarchy and their virtual
+   * methods do not change. Prefer this to building the ClassScopes directly
+   * when they are not edited.
+   */
+  static std::shared_ptr<const ClassScopes> get_or_build(const Scope& scope);
+
   const ClassHierarchy& get_parent_to_children() const;
 
   /**
@@ -432,10 +442,27 @@ class ClassScopes {
   const SignatureMap& get_signature_map() const { return m_sig_map; }
 
  private:
-  void build_class_scopes(const DexType* type);
+  void build_class_scopes();
   void build_interface_scopes();
 };
 
+/**
+ * Holds the ClassScopes last built by ClassScopes::get_or_build, along with a
+ * snapshot of the scope they were built from: every class in order, with its
+ * super class, interfaces, access flags and virtual methods. A scope with the
+ * same snapshot has the same ClassScopes, so they are reused across passes
+ * until one of them edits the hierarchy.
+ */
+class ClassScopesCache final {
+ public:
+  std::shared_ptr<const ClassScopes> get(const Scope& scope);
+
+ private:
+  std::mutex m_lock;
+  std::vector<uint64_t> m_snapshot;
+  std::shared_ptr<const ClassScopes> m_class_scopes;
+};
+
 /**
  * Return the list of virtual methods for a given type.
  * If the type is java.lang.Object and it is not known (no DexClass for it)
@@ -8,7 +8,10 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <functional>
+#include <limits>
+#include <numeric>
 #include <thread>
 #include <vector>
 
@@ -252,6 +255,109 @@ class walk {
     }
   }
 
+  // The methods of `classes`, in decreasing order of their number of
+  // instructions.
+  template <class Classes>
+  static std::vector<DexMethod*> sorted_by_cost(const Classes& classes) {
+    std::vector<std::pair<size_t, DexMethod*>> costs;
+    for (auto* cls : classes) {
+      iterate_methods(cls, [&costs](DexMethod* method) {
+        auto* code = method->get_code();
+        costs.emplace_back(code ? code->count_opcodes() : 0, method);
+      });
+    }
+    // Ties keep the scope order, so that the schedule is deterministic.
+    std::stable_sort(costs.begin(), costs.end(),
+                     [](const auto& a, const auto& b) {
+                       return a.first > b.first;
+                     });
+    std::vector<DexMethod*> methods;
+    methods.reserve(costs.size());
+    for (auto& p : costs) {
+      methods.push_back(p.second);
+    }
+    return methods;
+  }
+
+  // The classes of `classes`, cut into contiguous ranges of about the same
+  // number of instructions. `ends[i]` is the end of the i-th range.
+  struct Chunks {
+    std::vector<DexClass*> classes;
+    std::vector<size_t> ends;
+  };
+
+  // Chunks `classes` into about `num_chunks` ranges. Classes come in the
+  // order in which their code was allocated, approximated by the lowest
+  // address of the code of their methods, so that a range touches memory
+  // that is mostly contiguous. Every class counts for at least one
+  // instruction, so that classes without code are spread out too.
+  template <class Classes>
+  static Chunks chunk_by_cost(const Classes& classes, size_t num_chunks) {
+    struct Entry {
+      uintptr_t address;
+      size_t cost;
+      DexClass* cls;
+    };
+    std::vector<Entry> entries;
+    size_t total = 0;
+    for (auto* cls : classes) {
+      Entry entry{std::numeric_limits<uintptr_t>::max(), 1, cls};
+      iterate_methods(cls, [&entry](DexMethod* method) {
+        auto* code = method->get_code();
+        if (code) {
+          entry.address =
+              std::min(entry.address, reinterpret_cast<uintptr_t>(code));
+          entry.cost += code->count_opcodes();
+        }
+      });
+      total += entry.cost;
+      entries.push_back(entry);
+    }
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry& a, const Entry& b) {
+                       return a.address < b.address;
+                     });
+
+    Chunks chunks;
+    chunks.classes.reserve(entries.size());
+    size_t target = (total + num_chunks - 1) / std::max<size_t>(num_chunks, 1);
+    size_t cost = 0;
+    for (auto& entry : entries) {
+      chunks.classes.push_back(entry.cls);
+      cost += entry.cost;
+      if (cost >= target) {
+        chunks.ends.push_back(chunks.classes.size());
+        cost = 0;
+      }
+    }
+    if (cost > 0) {
+      chunks.ends.push_back(chunks.classes.size());
+    }
+    return chunks;
+  }
+
+  // Calls `fn` on each class of each chunk, with a chunk per work item.
+  template <typename Fn>
+  static void run_chunked(const Chunks& chunks,
+                          const Fn& fn,
+                          size_t num_threads) {
+    std::vector<size_t> indices(chunks.ends.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    workqueue_run<size_t>(
+        [&](size_t i) {
+          size_t begin = i == 0 ? 0 : chunks.ends[i - 1];
+          for (size_t c = begin; c < chunks.ends[i]; ++c) {
+            fn(chunks.classes[c]);
+          }
+        },
+        indices,
+        num_threads);
+  }
+
+  // Work items per thread for the chunked walkers. More than one, so that
+  // threads that get cheaper chunks pick up more of them.
+  static constexpr size_t CHUNKS_PER_THREAD = 16;
+
   template <typename WalkerFn>
   static void iterate_fields(const DexClass* cls, const WalkerFn& walker) {
     for (auto ifield : cls->get_ifields()) {
@@ -512,6 +618,68 @@ class walk {
           init);
     }
 
+    // Like `methods`, but the unit of parallelization is a method, and the
+    // methods are scheduled in decreasing order of their number of
+    // instructions. This is meant for passes whose cost grows faster than the
+    // size of the methods, where a few huge methods that happen to come last in
+    // the scope would otherwise keep one thread busy long after the others are
+    // done. Methods without code come last.
+    //
+    // WalkerFn should accept `(DexMethod*, Accumulator&)`.
+    template <
+        class Accumulator,
+        class Reduce = plus_assign<Accumulator>,
+        class Classes,
+        typename WalkerFn,
+        typename std::enable_if<Arity<WalkerFn>::value == 2, int>::type = 0>
+    static Accumulator methods_by_cost(
+        const Classes& classes,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads(),
+        Accumulator init = Accumulator()) {
+      std::vector<CacheAligned<Accumulator>> acc_vec(num_threads, init);
+
+      // The work queue hands out the items of each worker in order, so
+      // dealing it the sorted methods approximates the longest-processing-
+      // time-first schedule.
+      workqueue_run<DexMethod*>(
+          [&](sparta::SpartaWorkerState<DexMethod*>* state, DexMethod* method) {
+            Accumulator& acc = acc_vec[state->worker_id()];
+            TraceContext context(method);
+            walker(method, &acc);
+          },
+          sorted_by_cost(classes),
+          num_threads);
+
+      auto reduce = Reduce();
+      for (Accumulator& acc : acc_vec) {
+        reduce(acc, &init);
+      }
+      return init;
+    }
+
+    // WalkerFn should accept a `DexMethod*` and return `Accumulator`.
+    template <
+        class Accumulator,
+        class Reduce = plus_assign<Accumulator>,
+        class Classes,
+        typename WalkerFn,
+        typename std::enable_if<Arity<WalkerFn>::value == 1, int>::type = 0>
+    static Accumulator methods_by_cost(
+        const Classes& classes,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads(),
+        Accumulator init = Accumulator()) {
+      auto reduce = Reduce();
+      return methods_by_cost<Accumulator, Reduce, Classes>(
+          classes,
+          [&](DexMethod* method, Accumulator* acc) {
+            reduce(walker(method), acc);
+          },
+          num_threads,
+          init);
+    }
+
     //
     // Call `walker` on all fields in `classes` in parallel.
     //   WalkerFn should accept a `DexField*`.
@@ -553,6 +721,49 @@ class walk {
       walk::parallel::code(classes, all_methods, walker, num_threads);
     }
 
+    // Like `methods()`, but a work item is a contiguous range of classes of
+    // about the same number of instructions rather than a single class, which
+    // saves the per-item overhead for scopes of many small classes. The
+    // classes are visited in the order in which their code was allocated, for
+    // locality, so the walker must not depend on the order of the classes.
+    //   WalkerFn should accept a `DexMethod*`.
+    template <class Classes, typename WalkerFn>
+    static void chunked_methods(
+        const Classes& classes,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads()) {
+      walk::run_chunked(
+          walk::chunk_by_cost(classes, num_threads * CHUNKS_PER_THREAD),
+          [&walker](DexClass* cls) { walk::iterate_methods(cls, walker); },
+          num_threads);
+    }
+
+    // Like `code()`, but chunked as in `chunked_methods()`.
+    //   FilterFn should accept a `DexMethod*` and return a bool.
+    //   WalkerFn should accept `(DexMethod*, IRCode&)`.
+    template <class Classes, typename FilterFn, typename WalkerFn>
+    static void chunked_code(
+        const Classes& classes,
+        const FilterFn& filter,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads()) {
+      walk::run_chunked(
+          walk::chunk_by_cost(classes, num_threads * CHUNKS_PER_THREAD),
+          [&filter, &walker](DexClass* cls) {
+            walk::iterate_code(cls, filter, walker);
+          },
+          num_threads);
+    }
+
+    // Same as `chunked_code()` but with a filter that accepts all methods
+    template <class Classes, typename WalkerFn>
+    static void chunked_code(
+        const Classes& classes,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads()) {
+      walk::parallel::chunked_code(classes, all_methods, walker, num_threads);
+    }
+
     // Call `walker` on all opcodes (of methods approved by `filter`) in
     // `classes` in parallel.
     //   FilterFn should accept a `DexMethod*` and return a bool.
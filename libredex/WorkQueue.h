@@ -11,6 +11,7 @@
 #include <exception>
 
 #include "SpartaWorkQueue.h"
+#include "Timeline.h"
 
 namespace redex_workqueue_impl {
 
@@ -21,6 +22,7 @@ template <typename Input, typename Fn>
 struct NoStateWorkQueueHelper {
   Fn fn;
   void operator()(sparta::SpartaWorkerState<Input>*, Input a) {
+    timeline::TaskScope task_scope("workqueue");
     try {
       fn(a);
     } catch (std::exception& e) {
@@ -34,6 +36,7 @@ template <typename Input, typename Fn>
 struct WithStateWorkQueueHelper {
   Fn fn;
   void operator()(sparta::SpartaWorkerState<Input>* state, Input a) {
+    timeline::TaskScope task_scope("workqueue");
     try {
       fn(state, a);
     } catch (std::exception& e) {
@@ -62,13 +65,15 @@ sparta::SpartaWorkQueue<Input,
 workqueue_foreach(
     const Fn& fn,
     unsigned int num_threads = redex_parallel::default_num_threads(),
-    bool push_tasks_while_running = false) {
+    bool push_tasks_while_running = false,
+    sparta::WorkQueueDeque deque = sparta::WorkQueueDeque::Locked) {
   return sparta::SpartaWorkQueue<
       Input,
       redex_workqueue_impl::NoStateWorkQueueHelper<Input, Fn>>(
       redex_workqueue_impl::NoStateWorkQueueHelper<Input, Fn>{fn},
       num_threads,
-      push_tasks_while_running);
+      push_tasks_while_running,
+      deque);
 }
 template <class Input,
           typename Fn,
@@ -79,13 +84,15 @@ sparta::SpartaWorkQueue<
 workqueue_foreach(
     const Fn& fn,
     unsigned int num_threads = redex_parallel::default_num_threads(),
-    bool push_tasks_while_running = false) {
+    bool push_tasks_while_running = false,
+    sparta::WorkQueueDeque deque = sparta::WorkQueueDeque::Locked) {
   return sparta::SpartaWorkQueue<
       Input,
       redex_workqueue_impl::WithStateWorkQueueHelper<Input, Fn>>(
       redex_workqueue_impl::WithStateWorkQueueHelper<Input, Fn>{fn},
       num_threads,
-      push_tasks_while_running);
+      push_tasks_while_running,
+      deque);
 }
 
 template <class Input,
@@ -5892,6 +5892,16 @@ int32_t ResTable::getTableCookie(size_t index) const
     return mHeaders[index]->cookie;
 }
 
+const void* ResTable::getTableData(size_t index) const
+{
+    return mHeaders[index]->header;
+}
+
+size_t ResTable::getTableSize(size_t index) const
+{
+    return mHeaders[index]->size;
+}
+
 const DynamicRefTable* ResTable::getDynamicRefTableForCookie(int32_t cookie) const
 {
     const size_t N = mPackageGroups.size();
@@ -7054,8 +7064,8 @@ void ResTable::deleteResource(uint32_t resID)
 
 static uint32_t getRemappedEntry(
     uint32_t reference,
-    SortedVector<uint32_t> originalIds,
-    Vector<uint32_t> newIds)
+    const SortedVector<uint32_t>& originalIds,
+    const Vector<uint32_t>& newIds)
 {
     ssize_t index = originalIds.indexOf(reference);
     if (index < 0) {
@@ -7071,8 +7081,8 @@ static uint32_t getRemappedEntry(
 // align based on index.
 void ResTable::remapReferenceValuesForResource(
     uint32_t resID,
-    SortedVector<uint32_t> originalIds,
-    Vector<uint32_t> newIds)
+    const SortedVector<uint32_t>& originalIds,
+    const Vector<uint32_t>& newIds)
 {
     resource_name resName;
     if (!this->getResourceName(resID, /* allowUtf8 */ true, &resName)) {
@@ -1835,6 +1835,10 @@ public:
     const ResStringPool* getTableStringBlock(size_t index) const;
     // Return unique cookie identifier for the given resource table.
     int32_t getTableCookie(size_t index) const;
+    // Return the data of the resource table at the given index, as edited in
+    // place, and its size in bytes.
+    const void* getTableData(size_t index) const;
+    size_t getTableSize(size_t index) const;
 
     const DynamicRefTable* getDynamicRefTableForCookie(int32_t cookie) const;
 
@@ -1891,8 +1895,8 @@ public:
     // align based on index.
     void remapReferenceValuesForResource(
         uint32_t resID,
-        SortedVector<uint32_t> originalIds,
-        Vector<uint32_t> newIds);
+        const SortedVector<uint32_t>& originalIds,
+        const Vector<uint32_t>& newIds);
 
     // For the given resource ID, looks across all configurations and inlines
     // all reference Res_value entries based on the given keys -> inline_values
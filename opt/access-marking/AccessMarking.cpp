@@ -134,7 +134,10 @@ std::unordered_set<DexMethod*> find_private_methods(
         }
         auto callee =
             resolve_method(inst->get_method(), opcode_to_search(inst), caller);
-        if (callee == nullptr || callee->get_class() == caller->get_class()) {
+        // Only the candidates matter; `candidates` is not mutated during the
+        // walk.
+        if (callee == nullptr || callee->get_class() == caller->get_class() ||
+            !candidates.count(callee)) {
           return;
         }
         externally_referenced.emplace(callee);
@@ -146,8 +149,14 @@ std::unordered_set<DexMethod*> find_private_methods(
   return candidates;
 }
 
-void fix_call_sites_private(const std::vector<DexClass*>& scope,
-                            const std::unordered_set<DexMethod*>& privates) {
+void fix_call_sites_private(const std::unordered_set<DexMethod*>& privates) {
+  // Methods that are referenced from other classes are not privatized, so all
+  // the call sites to fix are in the classes of the privatized methods.
+  std::unordered_set<DexClass*> owners;
+  for (auto* method : privates) {
+    owners.insert(type_class(method->get_class()));
+  }
+  std::vector<DexClass*> scope(owners.begin(), owners.end());
   walk::parallel::code(scope, [&](DexMethod* caller, IRCode& code) {
     for (const MethodItemEntry& mie : InstructionIterable(code)) {
       IRInstruction* insn = mie.insn;
@@ -209,7 +218,7 @@ void AccessMarkingPass::run_pass(DexStoresVector& stores,
   }
   if (m_privatize_methods) {
     auto privates = find_private_methods(scope, *override_graph);
-    fix_call_sites_private(scope, privates);
+    fix_call_sites_private(privates);
     mark_methods_private(privates);
     pm.incr_metric("privatized_methods", privates.size());
     TRACE(ACCESS, 1, "Privatized %lu methods", privates.size());
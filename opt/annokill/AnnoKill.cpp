@@ -7,6 +7,8 @@
 
 #include "AnnoKill.h"
 
+#include <mutex>
+
 #include "ClassHierarchy.h"
 #include "Debug.h"
 #include "DexAnnotation.h"
@@ -44,6 +46,7 @@ AnnoKill::AnnoKill(
     const std::unordered_map<std::string, std::vector<std::string>>&
         annotated_keep_annos)
     : m_scope(scope),
+      m_scope_classes(scope.begin(), scope.end()),
       m_only_force_kill(only_force_kill),
       m_kill_bad_signatures(kill_bad_signatures) {
   TRACE(ANNO,
@@ -125,6 +128,25 @@ AnnoKill::AnnoKill(
   }
 }
 
+AnnoKill::AnnoKillStats& AnnoKill::AnnoKillStats::operator+=(
+    const AnnoKillStats& that) {
+  annotations += that.annotations;
+  annotations_killed += that.annotations_killed;
+  class_asets += that.class_asets;
+  class_asets_cleared += that.class_asets_cleared;
+  method_asets += that.method_asets;
+  method_asets_cleared += that.method_asets_cleared;
+  method_param_asets += that.method_param_asets;
+  method_param_asets_cleared += that.method_param_asets_cleared;
+  field_asets += that.field_asets;
+  field_asets_cleared += that.field_asets_cleared;
+  visibility_build_count += that.visibility_build_count;
+  visibility_runtime_count += that.visibility_runtime_count;
+  visibility_system_count += that.visibility_system_count;
+  signatures_killed += that.signatures_killed;
+  return *this;
+}
+
 AnnoKill::AnnoSet AnnoKill::get_referenced_annos() {
   AnnoKill::AnnoSet all_annos;
 
@@ -353,29 +375,38 @@ AnnoKill::AnnoSet AnnoKill::get_removable_annotation_instances() {
   return bannotations;
 }
 
-void AnnoKill::count_annotation(const DexAnnotation* da) {
-  std::string annoName(da->type()->get_name()->c_str());
+void AnnoKill::count_annotation(const DexAnnotation* da,
+                                ClassStats* class_stats) {
+  auto& stats = class_stats->stats;
+  std::map<std::string, size_t>* anno_map;
   if (da->system_visible()) {
-    m_system_anno_map[annoName]++;
-    m_stats.visibility_system_count++;
+    anno_map = &class_stats->system_anno_map;
+    stats.visibility_system_count++;
   } else if (da->runtime_visible()) {
-    m_runtime_anno_map[annoName]++;
-    m_stats.visibility_runtime_count++;
+    anno_map = &class_stats->runtime_anno_map;
+    stats.visibility_runtime_count++;
   } else if (da->build_visible()) {
-    m_build_anno_map[annoName]++;
-    m_stats.visibility_build_count++;
+    anno_map = &class_stats->build_anno_map;
+    stats.visibility_build_count++;
+  } else {
+    return;
+  }
+  if (traceEnabled(ANNO, 3)) {
+    (*anno_map)[da->type()->str()]++;
   }
 }
 
 void AnnoKill::cleanup_aset(
     DexAnnotationSet* aset,
     const AnnoKill::AnnoSet& referenced_annos,
-    const std::unordered_set<const DexType*>& keep_annos) {
-  m_stats.annotations += aset->size();
+    const std::unordered_set<const DexType*>& keep_annos,
+    ClassStats* class_stats) {
+  auto& stats = class_stats->stats;
+  stats.annotations += aset->size();
   auto& annos = aset->get_annotations();
   auto fn = [&](const auto& da) {
     auto anno_type = da->type();
-    count_annotation(da.get());
+    count_annotation(da.get(), class_stats);
 
     if (referenced_annos.count(anno_type) > 0) {
       TRACE(ANNO,
@@ -409,7 +440,7 @@ void AnnoKill::cleanup_aset(
             "annotation: %s",
             SHOW(anno_type),
             SHOW(da.get()));
-      m_stats.annotations_killed++;
+      stats.annotations_killed++;
       return true;
     }
 
@@ -420,19 +451,19 @@ void AnnoKill::cleanup_aset(
             "annotation: %s",
             SHOW(anno_type),
             SHOW(da.get()));
-      m_stats.annotations_killed++;
+      stats.annotations_killed++;
       return true;
     }
 
     if (!m_only_force_kill && !da->system_visible()) {
       TRACE(ANNO, 3, "Killing annotation instance %s", SHOW(da.get()));
-      m_stats.annotations_killed++;
+      stats.annotations_killed++;
       return true;
     }
 
     if (anno_type == DexType::get_type("Ldalvik/annotation/Signature;")) {
       if (should_kill_bad_signature(da.get())) {
-        m_stats.signatures_killed++;
+        stats.signatures_killed++;
         return true;
       }
     }
@@ -491,20 +522,11 @@ bool AnnoKill::should_kill_bad_signature(DexAnnotation* da) {
           auto* sigcls = type_class(sigtype);
           if (!sigcls) {
             sigtype = nullptr;
-          } else if (!sigcls->is_external()) {
-            bool found = false;
-            for (auto cls : m_scope) {
-              if (cls == sigcls) {
-                // Valid class, we're good, go to element in array
-                found = true;
-                continue;
-              }
-            }
+          } else if (!sigcls->is_external() &&
+                     !m_scope_classes.count(sigcls)) {
             // Could not find the (non-external) class in Scope, so set signal
             // to kill
-            if (!found) {
-              sigtype = nullptr;
-            }
+            sigtype = nullptr;
           }
         }
         if (!sigtype) {
@@ -521,44 +543,43 @@ std::unordered_set<const DexType*> AnnoKill::build_anno_keep(
     DexAnnotationSet* aset) {
   std::unordered_set<const DexType*> keep_list;
   for (const auto& anno : aset->get_annotations()) {
-    auto& keeps = m_annotated_keep_annos[anno->type()];
-    keep_list.insert(keeps.begin(), keeps.end());
+    auto it = m_annotated_keep_annos.find(anno->type());
+    if (it != m_annotated_keep_annos.end()) {
+      keep_list.insert(it->second.begin(), it->second.end());
+    }
   }
   return keep_list;
 }
 
-bool AnnoKill::kill_annotations() {
-  const auto& referenced_annos = get_referenced_annos();
-  if (!m_only_force_kill) {
-    m_kill = get_removable_annotation_instances();
-  }
-
-  for (auto clazz : m_scope) {
-    DexAnnotationSet* aset = clazz->get_anno_set();
-    if (!aset) {
-      continue;
-    }
+void AnnoKill::kill_annotations(DexClass* clazz,
+                                const AnnoSet& referenced_annos,
+                                ClassStats* class_stats) {
+  auto& stats = class_stats->stats;
+  DexAnnotationSet* aset = clazz->get_anno_set();
+  if (aset) {
     auto keep_list = build_anno_keep(aset);
-    auto& class_hier_keep_list = m_anno_class_hierarchy_keep[clazz->get_type()];
-    keep_list.insert(class_hier_keep_list.begin(), class_hier_keep_list.end());
+    auto it = m_anno_class_hierarchy_keep.find(clazz->get_type());
+    if (it != m_anno_class_hierarchy_keep.end()) {
+      keep_list.insert(it->second.begin(), it->second.end());
+    }
 
-    m_stats.class_asets++;
-    cleanup_aset(aset, referenced_annos, keep_list);
+    stats.class_asets++;
+    cleanup_aset(aset, referenced_annos, keep_list, class_stats);
     if (aset->size() == 0) {
       TRACE(
           ANNO, 3, "Clearing annotation for class %s", SHOW(clazz->get_type()));
       clazz->clear_annotations();
-      m_stats.class_asets_cleared++;
+      stats.class_asets_cleared++;
     }
   }
 
-  walk::methods(m_scope, [&](DexMethod* method) {
+  for (auto* method : clazz->get_all_methods()) {
     // Method annotations
     auto method_aset = method->get_anno_set();
     if (method_aset) {
-      m_stats.method_asets++;
+      stats.method_asets++;
       auto keep_list = build_anno_keep(method_aset);
-      cleanup_aset(method_aset, referenced_annos, keep_list);
+      cleanup_aset(method_aset, referenced_annos, keep_list, class_stats);
       if (method_aset->size() == 0) {
         TRACE(ANNO,
               3,
@@ -567,14 +588,14 @@ bool AnnoKill::kill_annotations() {
               SHOW(method->get_name()),
               SHOW(method->get_proto()));
         method->clear_annotations();
-        m_stats.method_asets_cleared++;
+        stats.method_asets_cleared++;
       }
     }
 
     // Parameter annotations.
     auto param_annos = method->get_param_anno();
     if (param_annos) {
-      m_stats.method_param_asets += param_annos->size();
+      stats.method_param_asets += param_annos->size();
       bool clear_pas = true;
       for (auto& pa : *param_annos) {
         auto& param_aset = pa.second;
@@ -582,7 +603,8 @@ bool AnnoKill::kill_annotations() {
           continue;
         }
         auto keep_list = build_anno_keep(param_aset.get());
-        cleanup_aset(param_aset.get(), referenced_annos, keep_list);
+        cleanup_aset(param_aset.get(), referenced_annos, keep_list,
+                     class_stats);
         if (param_aset->size() == 0) {
           continue;
         }
@@ -595,21 +617,21 @@ bool AnnoKill::kill_annotations() {
               SHOW(method->get_class()),
               SHOW(method->get_name()),
               SHOW(method->get_proto()));
-        m_stats.method_param_asets_cleared += param_annos->size();
+        stats.method_param_asets_cleared += param_annos->size();
         param_annos->clear();
       }
     }
-  });
+  }
 
-  walk::fields(m_scope, [&](DexField* field) {
-    DexAnnotationSet* aset = field->get_anno_set();
-    if (!aset) {
-      return;
+  for (auto* field : clazz->get_all_fields()) {
+    DexAnnotationSet* field_aset = field->get_anno_set();
+    if (!field_aset) {
+      continue;
     }
-    m_stats.field_asets++;
-    auto keep_list = build_anno_keep(aset);
-    cleanup_aset(aset, referenced_annos, keep_list);
-    if (aset->size() == 0) {
+    stats.field_asets++;
+    auto keep_list = build_anno_keep(field_aset);
+    cleanup_aset(field_aset, referenced_annos, keep_list, class_stats);
+    if (field_aset->size() == 0) {
       TRACE(ANNO,
             3,
             "Clearing annotations for field %s.%s:%s",
@@ -617,8 +639,34 @@ bool AnnoKill::kill_annotations() {
             SHOW(field->get_name()),
             SHOW(field->get_type()));
       field->clear_annotations();
-      m_stats.field_asets_cleared++;
+      stats.field_asets_cleared++;
     }
+  }
+}
+
+bool AnnoKill::kill_annotations() {
+  const auto& referenced_annos = get_referenced_annos();
+  if (!m_only_force_kill) {
+    m_kill = get_removable_annotation_instances();
+  }
+
+  // Classes only share read-only state, so that they can be cleaned up in
+  // parallel. Their statistics are merged when each class is done.
+  std::mutex stats_mutex;
+  walk::parallel::classes(m_scope, [&](DexClass* clazz) {
+    ClassStats class_stats;
+    kill_annotations(clazz, referenced_annos, &class_stats);
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    m_stats += class_stats.stats;
+    auto merge = [](const std::map<std::string, size_t>& from,
+                    std::map<std::string, size_t>* to) {
+      for (const auto& [name, count] : from) {
+        (*to)[name] += count;
+      }
+    };
+    merge(class_stats.build_anno_map, &m_build_anno_map);
+    merge(class_stats.runtime_anno_map, &m_runtime_anno_map);
+    merge(class_stats.system_anno_map, &m_system_anno_map);
   });
 
   bool classes_removed = false;
@@ -39,6 +39,8 @@ class AnnoKill {
     size_t signatures_killed;
 
     AnnoKillStats() { memset(this, 0, sizeof(AnnoKillStats)); }
+
+    AnnoKillStats& operator+=(const AnnoKillStats& that);
   };
 
   AnnoKill(Scope& scope,
@@ -67,13 +69,28 @@ class AnnoKill {
   // of annotation types to be removed.
   AnnoSet get_removable_annotation_instances();
 
+  // The statistics of processing some of the classes, which are merged once
+  // per class so that classes can be processed in parallel.
+  struct ClassStats {
+    AnnoKillStats stats;
+    // Only filled in when the ANNO trace at level 3 is enabled.
+    std::map<std::string, size_t> build_anno_map;
+    std::map<std::string, size_t> runtime_anno_map;
+    std::map<std::string, size_t> system_anno_map;
+  };
+
+  void kill_annotations(DexClass* clazz,
+                        const AnnoSet& referenced_annos,
+                        ClassStats* class_stats);
   void cleanup_aset(DexAnnotationSet* aset,
                     const AnnoSet& referenced_annos,
-                    const std::unordered_set<const DexType*>& keep_annos =
-                        std::unordered_set<const DexType*>{});
-  void count_annotation(const DexAnnotation* da);
+                    const std::unordered_set<const DexType*>& keep_annos,
+                    ClassStats* class_stats);
+  void count_annotation(const DexAnnotation* da, ClassStats* class_stats);
 
   Scope& m_scope;
+  // The classes of `m_scope`, for fast membership tests.
+  std::unordered_set<const DexClass*> m_scope_classes;
   const bool m_only_force_kill;
   const bool m_kill_bad_signatures;
   AnnoSet m_kill;
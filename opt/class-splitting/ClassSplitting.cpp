@@ -457,10 +457,14 @@ class ClassSplittingImpl {
 
     // Part 1: Upgrade non-static invokes to static invokes
     std::unordered_set<DexMethod*> methods_to_staticize;
+    // Invokes can only resolve to methods of the same name, so only invokes
+    // of these names need to be resolved below.
+    std::unordered_set<const DexString*> names_to_staticize;
     for (auto& p : m_methods_to_relocate) {
       DexMethod* method = p.first;
       if (!is_static(method)) {
         methods_to_staticize.insert(method);
+        names_to_staticize.insert(method->get_name());
       }
     }
 
@@ -473,9 +477,13 @@ class ClassSplittingImpl {
       rewritten_invokes[op] = 0;
     }
     walk::parallel::opcodes(
-        final_scope, [](DexMethod*) { return true; },
+        final_scope, [&](DexMethod*) { return !names_to_staticize.empty(); },
         [&](DexMethod* method, IRInstruction* insn) {
           auto op = insn->opcode();
+          if (opcode::is_an_invoke(op) &&
+              !names_to_staticize.count(insn->get_method()->get_name())) {
+            return;
+          }
           switch (op) {
           case OPCODE_INVOKE_DIRECT:
           case OPCODE_INVOKE_VIRTUAL:
@@ -137,7 +137,8 @@ std::unique_ptr<FixpointIterator> PassImpl::analyze(
   m_stats.callgraph_edges = cg_stats.num_edges;
   m_stats.callgraph_callsites = cg_stats.num_callsites;
   auto fp_iter = std::make_unique<FixpointIterator>(
-      cg, AnalyzerGenerator(immut_analyzer_state, api_level_analyzer_state));
+      cg, AnalyzerGenerator(immut_analyzer_state, api_level_analyzer_state),
+      m_config.incremental_heap_analysis);
   // Run the bootstrap. All field value and method return values are
   // represented by Top.
   fp_iter->run({{CURRENT_PARTITION_LABEL, ArgumentDomain()}});
@@ -28,6 +28,9 @@ class PassImpl : public Pass {
     // Setting this to zero means that all field values and return values will
     // be treated as Top.
     uint64_t max_heap_analysis_iterations{0};
+    // Whether each heap analysis iteration reanalyzes only the methods whose
+    // arguments changed, or that refer to a field or method whose value did.
+    bool incremental_heap_analysis{true};
     uint32_t big_override_threshold{5};
     std::unordered_set<const DexType*> field_blocklist;
     bool compute_definitely_assigned_ifields{true};
@@ -59,6 +62,9 @@ class PassImpl : public Pass {
     bind("max_heap_analysis_iterations",
          UINT64_C(0),
          m_config.max_heap_analysis_iterations);
+    bind("incremental_heap_analysis",
+         true,
+         m_config.incremental_heap_analysis);
     bind("field_blocklist",
          {},
          m_config.field_blocklist,
@@ -8,17 +8,66 @@
 #include "CopyPropagationPass.h"
 
 #include <cinttypes>
+#include <mutex>
 
 #include "DexUtil.h"
 #include "PassManager.h"
 
 using namespace copy_propagation_impl;
 
-void CopyPropagationPass::run_pass(DexStoresVector& stores,
-                                   ConfigFiles& /* unused */,
-                                   PassManager& mgr) {
-  auto scope = build_class_scope(stores);
+namespace {
 
+class CopyPropagationRun : public MethodPass::AccumulatingRun<Stats> {
+ public:
+  explicit CopyPropagationRun(const Config& config)
+      : m_config(config), m_impl(config) {}
+
+  // The type checker of the debug mode works on the linear code.
+  bool uses_editable_cfg() const override { return !m_config.debug; }
+
+  Stats visit(DexMethod* method, IRCode& /* code */) override {
+    if (m_config.debug) {
+      // Keep the output of the debug mode readable.
+      std::lock_guard<std::mutex> lock(m_debug_mutex);
+      return m_impl.run_on_method(method);
+    }
+    return m_impl.run_on_method(method);
+  }
+
+  void report(PassManager& mgr, const Stats& stats) override {
+    mgr.incr_metric("redundant_moves_eliminated", stats.moves_eliminated);
+    mgr.incr_metric("source_regs_replaced_with_representative",
+                    stats.replaced_sources);
+    mgr.incr_metric("method_type_inferences", stats.type_inferences);
+    mgr.incr_metric("lock_fixups", stats.lock_fixups);
+    mgr.incr_metric("non_singleton_lock_rdefs",
+                    stats.non_singleton_lock_rdefs);
+    TRACE(RME,
+          1,
+          "%" PRId64 " redundant moves eliminated",
+          mgr.get_metric("redundant_moves_eliminated"));
+    TRACE(RME,
+          1,
+          "%" PRId64 " source registers replaced with representative",
+          mgr.get_metric("source_regs_replaced_with_representative"));
+    TRACE(RME,
+          1,
+          "%" PRId64 " methods had type inference computed",
+          mgr.get_metric("method_type_inferences"));
+  }
+
+ private:
+  const Config& m_config;
+  CopyPropagation m_impl;
+  std::mutex m_debug_mutex;
+};
+
+} // namespace
+
+std::unique_ptr<MethodPass::Run> CopyPropagationPass::prepare(
+    DexStoresVector& /* stores */,
+    ConfigFiles& /* unused */,
+    PassManager& mgr) {
   if (m_config.eliminate_const_literals &&
       !mgr.get_redex_options().verify_none_enabled) {
     // This option is not safe with the verifier
@@ -30,26 +79,7 @@ void CopyPropagationPass::run_pass(DexStoresVector& stores,
   }
   m_config.regalloc_has_run = mgr.regalloc_has_run();
 
-  CopyPropagation impl(m_config);
-  auto stats = impl.run(scope);
-  mgr.incr_metric("redundant_moves_eliminated", stats.moves_eliminated);
-  mgr.incr_metric("source_regs_replaced_with_representative",
-                  stats.replaced_sources);
-  mgr.incr_metric("method_type_inferences", stats.type_inferences);
-  mgr.incr_metric("lock_fixups", stats.lock_fixups);
-  mgr.incr_metric("non_singleton_lock_rdefs", stats.non_singleton_lock_rdefs);
-  TRACE(RME,
-        1,
-        "%" PRId64 " redundant moves eliminated",
-        mgr.get_metric("redundant_moves_eliminated"));
-  TRACE(RME,
-        1,
-        "%" PRId64 " source registers replaced with representative",
-        mgr.get_metric("source_regs_replaced_with_representative"));
-  TRACE(RME,
-        1,
-        "%" PRId64 " methods had type inference computed",
-        mgr.get_metric("method_type_inferences"));
+  return std::make_unique<CopyPropagationRun>(m_config);
 }
 
 static CopyPropagationPass s_pass;
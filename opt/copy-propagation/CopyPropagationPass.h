@@ -10,14 +10,19 @@
 #include "CopyPropagation.h"
 #include "Pass.h"
 
-class CopyPropagationPass : public Pass {
+class CopyPropagationPass : public MethodPass {
  public:
-  CopyPropagationPass() : Pass("CopyPropagationPass") {}
+  CopyPropagationPass() : MethodPass("CopyPropagationPass") {}
 
-  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  std::unique_ptr<Run> prepare(DexStoresVector&,
+                               ConfigFiles&,
+                               PassManager&) override;
+
+  // Debug mode works on the linear code.
+  bool is_cfg_legal() const override { return !m_config.debug; }
 
   void bind_config() override {
-    // This option can only be safely enabled in verify-none. `run_pass` will
+    // This option can only be safely enabled in verify-none. `prepare` will
     // override this value to false if we aren't in verify-none. Here's why:
     //
     // const v0, 0
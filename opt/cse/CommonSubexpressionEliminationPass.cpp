@@ -38,13 +38,21 @@ constexpr const char* METRIC_CONDITIONALLY_PURE_METHODS =
     "num_conditionally_pure_methods";
 constexpr const char* METRIC_CONDITIONALLY_PURE_METHODS_ITERATIONS =
     "num_conditionally_pure_methods_iterations";
+constexpr const char* METRIC_METHOD_BARRIERS_CACHE_HITS =
+    "num_method_barriers_cache_hits";
 constexpr const char* METRIC_MAX_ITERATIONS = "num_max_iterations";
 
 } // namespace
 
+CommonSubexpressionEliminationPass::~CommonSubexpressionEliminationPass() =
+    default;
+
 void CommonSubexpressionEliminationPass::bind_config() {
   bind("debug", false, m_debug);
   bind("runtime_assertions", false, m_runtime_assertions);
+  bind("cache_method_barriers", false, m_cache_method_barriers,
+       "Reuse the inferred barriers of unchanged methods across the runs of "
+       "this pass.");
 }
 
 void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
@@ -71,7 +79,11 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
       [&](const DexType* type) {
         return !init_classes_with_side_effects.refine(type);
       };
-  shared_state.init_scope(scope, clinit_has_no_side_effects);
+  if (m_cache_method_barriers && !m_barriers_cache) {
+    m_barriers_cache = std::make_unique<MethodBarriersCache>();
+  }
+  shared_state.init_scope(scope, clinit_has_no_side_effects,
+                          m_barriers_cache.get());
 
   // The following default 'features' of copy propagation would only
   // interfere with what CSE is trying to do.
@@ -79,7 +91,7 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
   copy_prop_config.eliminate_const_classes = false;
   copy_prop_config.eliminate_const_strings = false;
   copy_prop_config.static_finals = false;
-  const auto stats = walk::parallel::methods<Stats>(
+  const auto stats = walk::parallel::methods_by_cost<Stats>(
       scope,
       [&](DexMethod* method) {
         const auto code = method->get_code();
@@ -144,6 +156,8 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
                   shared_state_stats.conditionally_pure_methods);
   mgr.incr_metric(METRIC_CONDITIONALLY_PURE_METHODS_ITERATIONS,
                   shared_state_stats.conditionally_pure_methods_iterations);
+  mgr.incr_metric(METRIC_METHOD_BARRIERS_CACHE_HITS,
+                  shared_state_stats.method_barriers_cache_hits);
   for (auto& p : stats.eliminated_opcodes) {
     std::string name = METRIC_INSTR_PREFIX;
     name += SHOW(static_cast<IROpcode>(p.first));
@@ -7,18 +7,34 @@
 
 #pragma once
 
+#include <memory>
+
+#include "AnalysisUsage.h"
 #include "Pass.h"
 #include "PassManager.h"
 
+namespace cse_impl {
+class MethodBarriersCache;
+} // namespace cse_impl
+
 class CommonSubexpressionEliminationPass : public Pass {
  public:
   CommonSubexpressionEliminationPass()
       : Pass("CommonSubexpressionEliminationPass") {}
+  ~CommonSubexpressionEliminationPass() override;
 
   void bind_config() override;
+
+  // Only rewrites method bodies.
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.set_preserve_method_analyses();
+  }
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
  private:
   bool m_debug;
   bool m_runtime_assertions;
+  bool m_cache_method_barriers;
+  // Outlives the runs of the pass, when m_cache_method_barriers is set.
+  std::unique_ptr<cse_impl::MethodBarriersCache> m_barriers_cache;
 };
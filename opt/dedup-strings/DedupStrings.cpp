@@ -22,7 +22,9 @@
 #include "PassManager.h"
 #include "ScopedCFG.h"
 #include "Show.h"
+#include "Timer.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 #include "locator.h"
 
 namespace {
@@ -49,6 +51,10 @@ constexpr const char* METRIC_EXCLUDED_DUPLICATE_NON_LOAD_STRINGS =
 constexpr const char* METRIC_FACTORY_METHODS = "num_factory_methods";
 constexpr const char* METRIC_EXCLUDED_OUT_OF_FACTORY_METHODS_STRINGS =
     "num_excluded_out_of_factory_methods_strings";
+constexpr const char* METRIC_GATHERING_US = "gathering_us";
+constexpr const char* METRIC_COUNTING_US = "counting_us";
+constexpr const char* METRIC_SELECTING_US = "selecting_us";
+constexpr const char* METRIC_REWRITING_US = "rewriting_us";
 } // namespace
 
 void DedupStrings::run(
@@ -69,32 +75,51 @@ void DedupStrings::run(
       get_perf_sensitive_methods(dexen);
 
   // Compute set of non-load strings in each dex
+  AccumulatingTimer gathering_timer;
   std::unordered_set<const DexString*> non_load_strings[dexen.size()];
-  std::vector<size_t> indices(dexen.size());
-  std::iota(indices.begin(), indices.end(), 0);
-  workqueue_run<size_t>(
-      [&](size_t i) {
-        auto& strings = non_load_strings[i];
-        gather_non_load_strings(dexen[i], &strings);
-      },
-      indices);
+  {
+    auto timer_scope = gathering_timer.scope();
+    std::vector<size_t> indices(dexen.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    workqueue_run<size_t>(
+        [&](size_t i) {
+          auto& strings = non_load_strings[i];
+          gather_non_load_strings(dexen[i], &strings);
+        },
+        indices);
+  }
+  m_stats.gathering_us = gathering_timer.get_microseconds();
 
   // For each string, figure out how many times it's loaded per dex
+  AccumulatingTimer counting_timer;
   ConcurrentMap<const DexString*, std::unordered_map<size_t, size_t>>
-      occurrences = get_occurrences(scope, methods_to_dex,
-                                    perf_sensitive_methods, non_load_strings);
+      occurrences = [&]() {
+        auto timer_scope = counting_timer.scope();
+        return get_occurrences(scope, methods_to_dex, perf_sensitive_methods,
+                               non_load_strings);
+      }();
+  m_stats.counting_us = counting_timer.get_microseconds();
 
   // Use heuristics to determine which strings to dedup,
   // and figure out factory method details
+  AccumulatingTimer selecting_timer;
   std::unordered_map<const DexString*, DedupStrings::DedupStringInfo>
-      strings_to_dedup =
-          get_strings_to_dedup(dexen, occurrences, methods_to_dex,
-                               perf_sensitive_methods, non_load_strings);
+      strings_to_dedup = [&]() {
+        auto timer_scope = selecting_timer.scope();
+        return get_strings_to_dedup(dexen, occurrences, methods_to_dex,
+                                    perf_sensitive_methods, non_load_strings);
+      }();
+  m_stats.selecting_us = selecting_timer.get_microseconds();
 
   // Rewrite const-string instructions
-  rewrite_const_string_instructions(scope, methods_to_dex,
-                                    perf_sensitive_methods, strings_to_dedup,
-                                    ab_experiment_context);
+  AccumulatingTimer rewriting_timer;
+  {
+    auto timer_scope = rewriting_timer.scope();
+    rewrite_const_string_instructions(scope, methods_to_dex,
+                                      perf_sensitive_methods, strings_to_dedup,
+                                      ab_experiment_context);
+  }
+  m_stats.rewriting_us = rewriting_timer.get_microseconds();
 }
 
 std::unordered_set<const DexMethod*> DedupStrings::get_perf_sensitive_methods(
@@ -260,50 +285,100 @@ DedupStrings::get_occurrences(
     const std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
     const std::unordered_set<const DexMethod*>& perf_sensitive_methods,
     std::unordered_set<const DexString*> non_load_strings[]) {
-  // For each string, figure out how many times it's loaded per dex
+  // For each string, figure out how many times it's loaded per dex. Each
+  // worker counts into its own maps, split into shards by string, and the
+  // shards are then merged in parallel, so that no map is ever shared.
+  using Counts =
+      std::unordered_map<const DexString*, std::unordered_map<size_t, size_t>>;
+  using DexSets =
+      std::unordered_map<const DexString*, std::unordered_set<size_t>>;
+  const size_t num_threads = redex_parallel::default_num_threads();
+  const size_t num_shards = num_threads;
+  auto shard_of = [num_shards](const DexString* str) {
+    return std::hash<const DexString*>()(str) / alignof(DexString) %
+           num_shards;
+  };
+  struct WorkerCounts {
+    std::vector<Counts> occurrences;
+    std::vector<DexSets> perf_sensitive_strings;
+  };
+  std::vector<WorkerCounts> worker_counts(num_threads);
+  for (auto& counts : worker_counts) {
+    counts.occurrences.resize(num_shards);
+    counts.perf_sensitive_strings.resize(num_shards);
+  }
+  workqueue_run<DexClass*>(
+      [&](sparta::SpartaWorkerState<DexClass*>* state, DexClass* cls) {
+        auto& counts = worker_counts[state->worker_id()];
+        for (auto* method : cls->get_all_methods()) {
+          auto* code = method->get_code();
+          if (code == nullptr) {
+            continue;
+          }
+          const auto dexnr = methods_to_dex.at(method);
+          const auto perf_sensitive = perf_sensitive_methods.count(method) != 0;
+          for (auto& mie : InstructionIterable(*code)) {
+            const auto insn = mie.insn;
+            if (insn->opcode() == OPCODE_CONST_STRING) {
+              const auto str = insn->get_string();
+              const auto shard = shard_of(str);
+              if (perf_sensitive) {
+                counts.perf_sensitive_strings[shard][str].emplace(dexnr);
+              } else {
+                ++counts.occurrences[shard][str][dexnr];
+              }
+            }
+          }
+        }
+      },
+      scope, num_threads);
+
   ConcurrentMap<const DexString*, std::unordered_map<size_t, size_t>>
       occurrences;
-  ConcurrentMap<const DexString*, std::unordered_set<size_t>>
-      perf_sensitive_strings;
-  walk::parallel::code(
-      scope, [&occurrences, &perf_sensitive_strings, &methods_to_dex,
-              &perf_sensitive_methods](DexMethod* method, IRCode& code) {
-        const auto dexnr = methods_to_dex.at(method);
-        const auto perf_sensitive = perf_sensitive_methods.count(method) != 0;
-        for (auto& mie : InstructionIterable(code)) {
-          const auto insn = mie.insn;
-          if (insn->opcode() == OPCODE_CONST_STRING) {
-            const auto str = insn->get_string();
-            if (perf_sensitive) {
-              perf_sensitive_strings.update(
-                  str,
-                  [dexnr](const DexString*,
-                          std::unordered_set<size_t>& s,
-                          bool /* exists */) { s.emplace(dexnr); });
-            } else {
-              occurrences.update(str,
-                                 [dexnr](const DexString*,
-                                         std::unordered_map<size_t, size_t>& m,
-                                         bool /* exists */) { ++m[dexnr]; });
+  std::vector<DexSets> perf_sensitive_shards(num_shards);
+  std::vector<size_t> shards(num_shards);
+  std::iota(shards.begin(), shards.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t shard) {
+        Counts merged;
+        auto& perf_sensitive_strings = perf_sensitive_shards[shard];
+        for (auto& counts : worker_counts) {
+          for (auto& [str, dex_counts] : counts.occurrences[shard]) {
+            auto& merged_counts = merged[str];
+            for (const auto& [dexnr, count] : dex_counts) {
+              merged_counts[dexnr] += count;
             }
           }
+          for (auto& [str, dexes] : counts.perf_sensitive_strings[shard]) {
+            perf_sensitive_strings[str].insert(dexes.begin(), dexes.end());
+          }
+          counts.occurrences[shard].clear();
+          counts.perf_sensitive_strings[shard].clear();
         }
-      });
+        for (auto& [str, dex_counts] : merged) {
+          occurrences.emplace(str, std::move(dex_counts));
+        }
+      },
+      shards, num_threads);
 
   // Also, add all the strings that occurred in perf-sensitive methods
   // to the non_load_strings datastructure, as we won't attempt to dedup them.
-  for (const auto& it : perf_sensitive_strings) {
-    const auto str = it.first;
-    TRACE(DS, 3, "[dedup strings] perf sensitive string: {%s}", SHOW(str));
-
-    const auto& dexes = it.second;
-    for (const auto dexnr : dexes) {
-      auto& strings = non_load_strings[dexnr];
-      strings.emplace(str);
+  size_t num_perf_sensitive_strings = 0;
+  for (const auto& perf_sensitive_strings : perf_sensitive_shards) {
+    num_perf_sensitive_strings += perf_sensitive_strings.size();
+    for (const auto& it : perf_sensitive_strings) {
+      const auto str = it.first;
+      TRACE(DS, 3, "[dedup strings] perf sensitive string: {%s}", SHOW(str));
+
+      const auto& dexes = it.second;
+      for (const auto dexnr : dexes) {
+        auto& strings = non_load_strings[dexnr];
+        strings.emplace(str);
+      }
     }
   }
 
-  m_stats.perf_sensitive_strings = perf_sensitive_strings.size();
+  m_stats.perf_sensitive_strings = num_perf_sensitive_strings;
   m_stats.non_perf_sensitive_strings = occurrences.size();
   return occurrences;
 }
@@ -739,6 +814,11 @@ void DedupStringsPass::run_pass(DexStoresVector& stores,
         stats.duplicate_string_loads, stats.expected_size_reduction,
         stats.dexes_without_host_cls, stats.excluded_duplicate_non_load_strings,
         stats.factory_methods, stats.excluded_out_of_factory_methods_strings);
+
+  mgr.incr_metric(METRIC_GATHERING_US, stats.gathering_us);
+  mgr.incr_metric(METRIC_COUNTING_US, stats.counting_us);
+  mgr.incr_metric(METRIC_SELECTING_US, stats.selecting_us);
+  mgr.incr_metric(METRIC_REWRITING_US, stats.rewriting_us);
   ab_experiment_context->flush();
 }
 
@@ -31,6 +31,11 @@ class DedupStrings {
     size_t dexes_without_host_cls{0};
     size_t factory_methods{0};
     size_t excluded_out_of_factory_methods_strings{0};
+    // Time spent in each phase of run().
+    uint64_t gathering_us{0};
+    uint64_t counting_us{0};
+    uint64_t selecting_us{0};
+    uint64_t rewriting_us{0};
   };
 
   DedupStrings(size_t max_factory_methods,
@@ -503,7 +503,7 @@ void EvaluateTypeChecksPass::run_pass(DexStoresVector& stores,
   shrinker::Shrinker shrinker(
       stores, scope, init_classes_with_side_effects, shrinker_config, min_sdk);
 
-  auto stats = walk::parallel::methods<RemoveResult>(
+  auto stats = walk::parallel::methods_by_cost<RemoveResult>(
       scope, [&shrinker](DexMethod* method) {
         auto code = method->get_code();
         if (code == nullptr || method->rstate.no_optimizations()) {
@@ -0,0 +1,518 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "HotColdSplittingPass.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_set>
+
+#include <boost/optional.hpp>
+
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "DexStore.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "Liveness.h"
+#include "MethodUtil.h"
+#include "PassManager.h"
+#include "ScopedCFG.h"
+#include "Show.h"
+#include "SourceBlocks.h"
+#include "TypeInference.h"
+#include "TypeUtil.h"
+#include "Walkers.h"
+
+// Splitting a region turns
+//
+//   B0: ... if-eqz v0 :B1      (hot)
+//   B1: <cold code using v1, v2> return vX
+//
+// into
+//
+//   B0: ... if-eqz v0 :B1
+//   B1: invoke-static {v1, v2} Foo.bar$cold:(..)
+//       move-result vR
+//       return vR
+//
+// where the split method starts with load-params for v1 and v2, followed by
+// a copy of the blocks of the region.
+//
+// The region must be closed under successors, so that nothing but a return or
+// a throw leaves it. Regions that rejoin hot code would need the split method
+// to return more than one value, and are not considered.
+
+namespace {
+
+using Stats = HotColdSplittingPass::Stats;
+using Config = HotColdSplittingPass::Config;
+
+// Whether all source blocks of the block say that it was never executed.
+// Blocks without source blocks, or without profile values, are unknown.
+bool is_cold(const cfg::Block* block) {
+  bool has_source_blocks = false;
+  bool cold = true;
+  source_blocks::foreach_source_block(block, [&](const SourceBlock* sb) {
+    has_source_blocks = true;
+    if (sb->vals().empty()) {
+      cold = false;
+    }
+    sb->foreach_val([&](const auto& val) {
+      if (!val || val->val > 0) {
+        cold = false;
+      }
+    });
+  });
+  return has_source_blocks && cold;
+}
+
+bool is_hot(const cfg::ControlFlowGraph& cfg) {
+  return source_blocks::has_source_block_positive_val(
+      source_blocks::get_first_source_block(cfg.entry_block()));
+}
+
+bool is_narrow_int(const DexType* type) {
+  return type == type::_boolean() || type == type::_byte() ||
+         type == type::_char() || type == type::_short();
+}
+
+struct Region {
+  cfg::Block* entry;
+  std::vector<cfg::Block*> blocks;
+  std::unordered_set<const cfg::Block*> block_set;
+  size_t code_units{0};
+};
+
+// The blocks reachable from `entry`, if they can only be reached through it.
+boost::optional<Region> get_region(cfg::ControlFlowGraph& cfg,
+                                   cfg::Block* entry) {
+  if (entry == cfg.entry_block() || entry->starts_with_move_result() ||
+      entry->starts_with_move_exception()) {
+    return boost::none;
+  }
+  Region region{entry, {entry}, {entry}};
+  for (size_t i = 0; i < region.blocks.size(); ++i) {
+    for (auto* e : region.blocks[i]->succs()) {
+      if (e->type() == cfg::EDGE_GHOST) {
+        continue;
+      }
+      if (region.block_set.insert(e->target()).second) {
+        region.blocks.push_back(e->target());
+      }
+    }
+  }
+  if (region.block_set.count(cfg.entry_block())) {
+    return boost::none;
+  }
+  for (auto* block : region.blocks) {
+    for (auto* e : block->preds()) {
+      if (block == entry && e->type() == cfg::EDGE_THROW) {
+        return boost::none;
+      }
+      if (block != entry && e->type() != cfg::EDGE_GHOST &&
+          !region.block_set.count(e->src())) {
+        return boost::none;
+      }
+    }
+    region.code_units += block->sum_opcode_sizes();
+  }
+  return region;
+}
+
+// Instructions that depend on the frame of the method they are in.
+bool has_unsupported_insns(const Region& region) {
+  for (auto* block : region.blocks) {
+    for (const auto& mie : InstructionIterable(block)) {
+      switch (mie.insn->opcode()) {
+      case OPCODE_INVOKE_SUPER:
+      case OPCODE_MONITOR_ENTER:
+      case OPCODE_MONITOR_EXIT:
+        return true;
+      default:
+        break;
+      }
+    }
+  }
+  return false;
+}
+
+using Params = std::vector<std::pair<reg_t, const DexType*>>;
+
+// The registers that are live into the region, with the types the split
+// method takes them as.
+boost::optional<Params> get_params(const DexMethod* method,
+                                   const Region& region,
+                                   const LivenessFixpointIterator& liveness,
+                                   type_inference::TypeInference& types) {
+  auto live_in = liveness.get_live_in_vars_at(region.entry);
+  std::vector<reg_t> regs(live_in.elements().begin(),
+                          live_in.elements().end());
+  std::sort(regs.begin(), regs.end());
+
+  const auto& env = types.get_entry_state_at(region.entry);
+  Params params;
+  std::unordered_set<reg_t> int_regs;
+  std::unordered_set<reg_t> ref_regs;
+  for (auto reg : regs) {
+    switch (env.get_type(reg).element()) {
+    case INT:
+      params.emplace_back(reg, type::_int());
+      int_regs.insert(reg);
+      break;
+    case FLOAT:
+      params.emplace_back(reg, type::_float());
+      break;
+    case LONG1:
+      params.emplace_back(reg, type::_long());
+      break;
+    case DOUBLE1:
+      params.emplace_back(reg, type::_double());
+      break;
+    case REFERENCE: {
+      auto dex_type = env.get_dex_type(reg);
+      if (!dex_type) {
+        return boost::none;
+      }
+      params.emplace_back(reg, *dex_type);
+      ref_regs.insert(reg);
+      break;
+    }
+    default:
+      // Constants and scalars have no single type to pass them as.
+      return boost::none;
+    }
+  }
+
+  // Follow the copies of the live-ins within the region. This ignores the
+  // order of the instructions, which can only refuse more regions.
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (auto* block : region.blocks) {
+      for (const auto& mie : InstructionIterable(block)) {
+        auto* insn = mie.insn;
+        if (insn->opcode() == OPCODE_MOVE && int_regs.count(insn->src(0))) {
+          changed |= int_regs.insert(insn->dest()).second;
+        } else if (insn->opcode() == OPCODE_MOVE_OBJECT &&
+                   ref_regs.count(insn->src(0))) {
+          changed |= ref_regs.insert(insn->dest()).second;
+        }
+      }
+    }
+  }
+
+  // An int might be a boolean, byte, char or short, which the verifier would
+  // not accept where one of those is expected. And uninitialized objects
+  // cannot be passed at all.
+  auto* rtype = method->get_proto()->get_rtype();
+  for (auto* block : region.blocks) {
+    for (const auto& mie : InstructionIterable(block)) {
+      auto* insn = mie.insn;
+      auto op = insn->opcode();
+      switch (op) {
+      case OPCODE_RETURN:
+        if (is_narrow_int(rtype) && int_regs.count(insn->src(0))) {
+          return boost::none;
+        }
+        break;
+      case OPCODE_IPUT_BOOLEAN:
+      case OPCODE_IPUT_BYTE:
+      case OPCODE_IPUT_CHAR:
+      case OPCODE_IPUT_SHORT:
+      case OPCODE_SPUT_BOOLEAN:
+      case OPCODE_SPUT_BYTE:
+      case OPCODE_SPUT_CHAR:
+      case OPCODE_SPUT_SHORT:
+      case OPCODE_APUT_BOOLEAN:
+      case OPCODE_APUT_BYTE:
+      case OPCODE_APUT_CHAR:
+      case OPCODE_APUT_SHORT:
+        if (int_regs.count(insn->src(0))) {
+          return boost::none;
+        }
+        break;
+      default:
+        if (opcode::is_an_invoke(op)) {
+          auto* callee = insn->get_method();
+          size_t offset = op == OPCODE_INVOKE_STATIC ? 0 : 1;
+          if (offset == 1 && method::is_init(callee) &&
+              ref_regs.count(insn->src(0))) {
+            return boost::none;
+          }
+          const auto* args = callee->get_proto()->get_args();
+          for (size_t i = 0; i < args->size(); ++i) {
+            if (is_narrow_int(args->at(i)) &&
+                int_regs.count(insn->src(i + offset))) {
+              return boost::none;
+            }
+          }
+        }
+        break;
+      }
+    }
+  }
+  return params;
+}
+
+DexMethod* make_split_method(DexMethod* method,
+                             const IRCode& code,
+                             const Region& region,
+                             const Params& params) {
+  DexTypeList::ContainerType arg_types;
+  for (const auto& [reg, type] : params) {
+    arg_types.push_back(const_cast<DexType*>(type));
+  }
+  auto* proto =
+      DexProto::make_proto(method->get_proto()->get_rtype(),
+                           DexTypeList::make_type_list(std::move(arg_types)));
+  auto* name = DexMethod::get_unique_name(
+      method->get_class(), DexString::make_string(method->str() + "$cold"),
+      proto);
+
+  // The copy keeps the block ids, so the region is found again by its entry.
+  auto split_code = std::make_unique<IRCode>(code);
+  {
+    auto& cfg = split_code->cfg();
+    // Load the parameters into registers at the end of the frame, and move
+    // them to where the region expects them.
+    std::vector<IRInstruction*> loads;
+    std::vector<IRInstruction*> moves;
+    for (const auto& [reg, type] : params) {
+      auto temp = type::is_wide_type(type) ? cfg.allocate_wide_temp()
+                                           : cfg.allocate_temp();
+      loads.push_back(
+          (new IRInstruction(opcode::load_opcode(type)))->set_dest(temp));
+      moves.push_back((new IRInstruction(opcode::move_opcode(type)))
+                          ->set_dest(reg)
+                          ->set_src(0, temp));
+    }
+    auto* entry = cfg.create_block();
+    entry->push_back(loads);
+    entry->push_back(moves);
+    cfg.add_edge(entry, cfg.get_block(region.entry->id()), cfg::EDGE_GOTO);
+    cfg.set_entry_block(entry);
+    cfg.remove_unreachable_blocks();
+    cfg.calculate_exit_block();
+  }
+  split_code->clear_cfg();
+
+  auto* split = DexMethod::make_method(method->get_class(), name, proto)
+                    ->make_concrete(ACC_PRIVATE | ACC_STATIC,
+                                    std::move(split_code),
+                                    /* is_virtual */ false);
+  split->set_deobfuscated_name(show_deobfuscated(split));
+  // Don't undo our work.
+  split->rstate.set_dont_inline();
+  return split;
+}
+
+// Replaces the region by an invocation of `split`.
+void replace_region(cfg::ControlFlowGraph& cfg,
+                    const Region& region,
+                    const Params& params,
+                    DexMethod* split) {
+  auto* call = cfg.create_block();
+  // The call site is as cold as the region was. The split method keeps the
+  // source blocks of the region, so this one must not repeat their ids.
+  auto* sb = source_blocks::get_first_source_block(region.entry);
+  if (sb != nullptr) {
+    auto call_sb = std::make_unique<SourceBlock>(*sb);
+    call_sb->id = SourceBlock::kSyntheticId;
+    call_sb->next = nullptr;
+    call->insert_before(call->end(), std::move(call_sb));
+  }
+
+  std::vector<IRInstruction*> insns;
+  auto* invoke = (new IRInstruction(OPCODE_INVOKE_STATIC))
+                     ->set_method(split)
+                     ->set_srcs_size(params.size());
+  for (size_t i = 0; i < params.size(); ++i) {
+    invoke->set_src(i, params[i].first);
+  }
+  insns.push_back(invoke);
+  auto* rtype = split->get_proto()->get_rtype();
+  if (type::is_void(rtype)) {
+    insns.push_back(new IRInstruction(OPCODE_RETURN_VOID));
+  } else {
+    auto result = type::is_wide_type(rtype) ? cfg.allocate_wide_temp()
+                                            : cfg.allocate_temp();
+    insns.push_back(
+        (new IRInstruction(opcode::move_result_for_invoke(split)))
+            ->set_dest(result));
+    insns.push_back(
+        (new IRInstruction(opcode::return_opcode(rtype)))->set_src(0, result));
+  }
+  call->push_back(insns);
+
+  std::vector<cfg::Edge*> entering;
+  for (auto* e : region.entry->preds()) {
+    if (!region.block_set.count(e->src())) {
+      entering.push_back(e);
+    }
+  }
+  for (auto* e : entering) {
+    cfg.set_edge_target(e, call);
+  }
+  cfg.remove_unreachable_blocks();
+  cfg.calculate_exit_block();
+}
+
+bool can_split(const DexMethod* method) {
+  return method->get_code() != nullptr && !method::is_any_init(method) &&
+         !method->rstate.no_optimizations() &&
+         !is_interface(type_class(method->get_class()));
+}
+
+} // namespace
+
+Stats& Stats::operator+=(const Stats& that) {
+  hot_methods += that.hot_methods;
+  methods_split += that.methods_split;
+  regions_split += that.regions_split;
+  code_units_moved += that.code_units_moved;
+  regions_too_small += that.regions_too_small;
+  regions_unsupported_insns += that.regions_unsupported_insns;
+  regions_unsupported_live_ins += that.regions_unsupported_live_ins;
+  return *this;
+}
+
+std::vector<DexMethod*> HotColdSplittingPass::split(DexMethod* method,
+                                                    const Config& config,
+                                                    Stats* stats) {
+  std::vector<DexMethod*> split_methods;
+  auto* code = method->get_code();
+  cfg::ScopedCFG cfg(code);
+  if (!is_hot(*cfg)) {
+    return split_methods;
+  }
+  stats->hot_methods++;
+
+  // Only start regions at the border of cold code; regions that start
+  // further in are contained in those.
+  std::vector<Region> regions;
+  for (auto* block : cfg->blocks()) {
+    if (!is_cold(block)) {
+      continue;
+    }
+    const auto& preds = block->preds();
+    if (std::all_of(preds.begin(), preds.end(), [](const cfg::Edge* e) {
+          return is_cold(e->src());
+        })) {
+      continue;
+    }
+    auto region = get_region(*cfg, block);
+    if (!region) {
+      continue;
+    }
+    if (region->code_units < config.min_region_size) {
+      stats->regions_too_small++;
+      continue;
+    }
+    if (has_unsupported_insns(*region)) {
+      stats->regions_unsupported_insns++;
+      continue;
+    }
+    regions.push_back(std::move(*region));
+  }
+  if (regions.empty()) {
+    return split_methods;
+  }
+
+  // Regions are either disjoint or nested. Prefer the largest ones.
+  std::sort(regions.begin(), regions.end(),
+            [](const Region& a, const Region& b) {
+              if (a.code_units != b.code_units) {
+                return a.code_units > b.code_units;
+              }
+              return a.entry->id() < b.entry->id();
+            });
+
+  LivenessFixpointIterator liveness(*cfg);
+  liveness.run(LivenessDomain());
+  type_inference::TypeInference types(*cfg);
+  types.run(method);
+
+  std::unordered_set<const cfg::Block*> split_blocks;
+  for (const auto& region : regions) {
+    if (split_methods.size() >= config.max_splits_per_method) {
+      break;
+    }
+    if (split_blocks.count(region.entry)) {
+      continue;
+    }
+    auto params = get_params(method, region, liveness, types);
+    if (!params) {
+      stats->regions_unsupported_live_ins++;
+      continue;
+    }
+    split_blocks.insert(region.blocks.begin(), region.blocks.end());
+    split_methods.push_back(make_split_method(method, *code, region, *params));
+    // Removes the region's blocks, which other regions analyzed above do not
+    // overlap.
+    replace_region(*cfg, region, *params, split_methods.back());
+    stats->regions_split++;
+    stats->code_units_moved += region.code_units;
+  }
+  if (!split_methods.empty()) {
+    stats->methods_split++;
+  }
+  return split_methods;
+}
+
+void HotColdSplittingPass::bind_config() {
+  bind("min_region_size",
+       m_config.min_region_size,
+       m_config.min_region_size,
+       "Smallest cold region, in code units, that is split out of a method");
+  bind("max_splits_per_method",
+       m_config.max_splits_per_method,
+       m_config.max_splits_per_method,
+       "Maximum number of cold regions split out of a single method");
+}
+
+void HotColdSplittingPass::run_pass(DexStoresVector& stores,
+                                    ConfigFiles& /* conf */,
+                                    PassManager& mgr) {
+  // Don't run under instrumentation.
+  if (mgr.get_redex_options().instrument_pass_enabled) {
+    return;
+  }
+
+  Stats stats;
+  std::mutex stats_mutex;
+  const auto& scope = build_class_scope(stores);
+  // New methods are added to their class once all of its methods are done.
+  walk::parallel::classes(scope, [&](DexClass* cls) {
+    Stats cls_stats;
+    std::vector<DexMethod*> split_methods;
+    for (auto* method : cls->get_all_methods()) {
+      if (!can_split(method)) {
+        continue;
+      }
+      auto methods = split(method, m_config, &cls_stats);
+      split_methods.insert(split_methods.end(), methods.begin(),
+                           methods.end());
+    }
+    for (auto* method : split_methods) {
+      cls->add_method(method);
+    }
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    stats += cls_stats;
+  });
+
+  mgr.set_metric("hot_methods", stats.hot_methods);
+  mgr.set_metric("methods_split", stats.methods_split);
+  mgr.set_metric("regions_split", stats.regions_split);
+  mgr.set_metric("code_units_moved", stats.code_units_moved);
+  mgr.set_metric("regions_too_small", stats.regions_too_small);
+  mgr.set_metric("regions_unsupported_insns",
+                 stats.regions_unsupported_insns);
+  mgr.set_metric("regions_unsupported_live_ins",
+                 stats.regions_unsupported_live_ins);
+}
+
+static HotColdSplittingPass s_pass;
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "Pass.h"
+
+class DexMethod;
+
+/*
+ * Moves regions of hot methods that were never executed, according to their
+ * source blocks, into separate static methods, so that the hot code stays
+ * compact.
+ *
+ * A region starts at a cold block, and consists of all blocks reachable from
+ * it. It can only be entered through its first block, and so it only ever
+ * leaves the method, by returning or throwing. This allows replacing it by an
+ * invocation of the split method, passing the registers that are live into
+ * the region and returning the result.
+ */
+class HotColdSplittingPass : public Pass {
+ public:
+  struct Config {
+    // Smallest region, in code units, that is worth an extra method.
+    uint32_t min_region_size{32};
+    // Maximum number of regions split out of a single method.
+    uint32_t max_splits_per_method{4};
+  };
+
+  struct Stats {
+    size_t hot_methods{0};
+    size_t methods_split{0};
+    size_t regions_split{0};
+    // Code units moved out of hot methods into the split methods.
+    size_t code_units_moved{0};
+    size_t regions_too_small{0};
+    size_t regions_unsupported_insns{0};
+    size_t regions_unsupported_live_ins{0};
+
+    Stats& operator+=(const Stats& that);
+  };
+
+  HotColdSplittingPass() : Pass("HotColdSplittingPass") {}
+
+  void bind_config() override;
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  // Splits the cold regions out of `method`, which must be hot, and returns
+  // the new methods. The caller must add them to their class.
+  static std::vector<DexMethod*> split(DexMethod* method,
+                                       const Config& config,
+                                       Stats* stats);
+
+ private:
+  Config m_config;
+};
@@ -9,13 +9,11 @@
 
 #include <algorithm>
 #include <boost/algorithm/string.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index_container.hpp>
 #include <boost/utility/string_view.hpp>
 #include <cstdint>
 #include <fstream>
-#include <mutex>
+#include <numeric>
+#include <string_view>
 
 #include "ConfigFiles.h"
 #include "DexClass.h"
@@ -47,61 +45,27 @@ source_blocks::InsertResult source_blocks(
                                              serialize, exc_inject);
 }
 
-using namespace boost::multi_index;
-
 struct ProfileFile {
   RedexMappedFile mapped_file;
   std::string interaction;
-
-  using StringPos = std::pair<size_t, size_t>;
-
-  using MethodMeta = std::unordered_map<const DexMethodRef*, StringPos>;
-  MethodMeta method_meta;
-
-  // Consider std::string_view in C++17.
-  struct StringViewEquals {
-    bool operator()(const std::string& s1, const std::string& s2) const {
-      return s1 == s2;
-    }
-    bool operator()(const std::string& s1, const boost::string_view& v2) const {
-      return v2 == s1;
-    }
-    bool operator()(const boost::string_view& v1, const std::string& s2) const {
-      return v1 == s2;
-    }
-    bool operator()(const boost::string_view& v1,
-                    const boost::string_view& v2) const {
-      return v1 == v2;
-    }
-  };
-  using UnresolvedMethodMeta = multi_index_container<
-      std::pair<boost::string_view, StringPos>,
-      indexed_by<hashed_unique<
-          member<std::pair<boost::string_view, StringPos>,
-                 boost::string_view,
-                 &std::pair<boost::string_view, StringPos>::first>,
-          boost::hash<boost::string_view>,
-          StringViewEquals>>>;
-
-  UnresolvedMethodMeta unresolved_method_meta;
+  // Where the lines of methods start, after the header.
+  size_t body_pos;
 
   ProfileFile(RedexMappedFile mapped_file,
               std::string interaction,
-              MethodMeta method_meta,
-              UnresolvedMethodMeta unresolved_method_meta)
+              size_t body_pos)
       : mapped_file(std::move(mapped_file)),
         interaction(std::move(interaction)),
-        method_meta(std::move(method_meta)),
-        unresolved_method_meta(std::move(unresolved_method_meta)) {}
+        body_pos(body_pos) {}
 
+  // Only reads the header. The lines of methods are resolved later, see
+  // ProfileTable.
   static std::unique_ptr<ProfileFile> prepare_profile_file(
       const std::string& profile_file_name) {
     if (profile_file_name.empty()) {
       return std::unique_ptr<ProfileFile>();
     }
     auto file = RedexMappedFile::open(profile_file_name, /*read_only=*/true);
-    MethodMeta meta;
-    UnresolvedMethodMeta unresolved_meta;
 
     boost::string_view data{file.const_data(), file.size()};
     size_t pos = 0;
@@ -139,62 +103,112 @@ struct ProfileFile {
       check_components(next_line_fn(), 0, {"name", "profiled_srcblks_exprs"});
     }
 
-    while (pos < data.length()) {
-      const size_t src_pos = pos;
+    return std::make_unique<ProfileFile>(std::move(file),
+                                         std::move(interaction), pos);
+  }
+};
 
-      // Find the next '\n' or EOF.
-      size_t linefeed_pos = data.find('\n', src_pos);
-      if (linefeed_pos == std::string::npos) {
-        linefeed_pos = data.length();
+// The basic block profiles of all methods with code, resolved once to
+// DexMethodRefs. Row `i` holds the profiles of `methods[i]`, one column per
+// profile file, as positions into the mapped files.
+struct ProfileTable {
+  using StringPos = std::pair<size_t, size_t>;
+  static constexpr StringPos kNone{0, std::string::npos};
+
+  std::vector<DexMethod*> methods;
+  size_t num_columns;
+  std::vector<StringPos> positions;
+  size_t unresolved{0};
+
+  ProfileTable(const Scope& scope,
+               const std::vector<std::unique_ptr<ProfileFile>>& profile_files)
+      : num_columns(profile_files.size()) {
+    walk::methods(scope, [&](DexMethod* method) {
+      if (method->get_code() != nullptr) {
+        methods.push_back(method);
       }
-      pos = linefeed_pos + 1;
-      // Do not use pos anymore! Ensure by scope from lambda.
-      [&data, &src_pos, &linefeed_pos, &meta, &unresolved_meta]() {
-        size_t comma_pos = data.find(',', src_pos);
-        always_assert(comma_pos < linefeed_pos);
-
-        auto string_pos =
-            std::make_pair(comma_pos + 1, linefeed_pos - comma_pos - 1);
-
-        auto method_view = data.substr(src_pos, comma_pos - src_pos);
-        // Would be nice to avoid the conversion.
-        auto mref = DexMethod::get_method</*kCheckFormat=*/true>(
-            method_view.to_string());
-        if (mref == nullptr) {
-          TRACE(METH_PROF,
-                6,
-                "failed to resolve %s",
-                method_view.to_string().c_str());
-          unresolved_meta.emplace(method_view, string_pos);
-          return;
-        }
-        meta.emplace(mref, string_pos);
-      }();
+    });
+    if (profile_files.empty()) {
+      return;
+    }
+
+    std::unordered_map<const DexMethodRef*, uint32_t> rows;
+    rows.reserve(methods.size());
+    for (uint32_t i = 0; i != methods.size(); ++i) {
+      rows.emplace(methods[i], i);
     }
+    positions.resize(methods.size() * num_columns, kNone);
+
+    // Each file fills its own column, so they are read concurrently.
+    std::atomic<size_t> unresolved_lines{0};
+    std::vector<size_t> columns(num_columns);
+    std::iota(columns.begin(), columns.end(), 0);
+    workqueue_run<size_t>(
+        [&](size_t column) {
+          const auto& file = *profile_files[column];
+          std::string_view data{file.mapped_file.const_data(),
+                                file.mapped_file.size()};
+          for (size_t pos = file.body_pos; pos < data.size();) {
+            // Find the next '\n' or EOF.
+            size_t linefeed_pos = data.find('\n', pos);
+            if (linefeed_pos == std::string::npos) {
+              linefeed_pos = data.size();
+            }
+            size_t comma_pos = data.find(',', pos);
+            always_assert(comma_pos < linefeed_pos);
+
+            auto method_view = data.substr(pos, comma_pos - pos);
+            pos = linefeed_pos + 1;
+
+            auto mref =
+                DexMethod::get_method</*kCheckFormat=*/true>(method_view);
+            auto it = mref == nullptr ? rows.end() : rows.find(mref);
+            if (it == rows.end()) {
+              TRACE(METH_PROF, 6, "failed to resolve %s",
+                    std::string(method_view).c_str());
+              unresolved_lines.fetch_add(1, std::memory_order_relaxed);
+              continue;
+            }
+            auto& string_pos = positions[it->second * num_columns + column];
+            // The first line of a method wins.
+            if (string_pos == kNone) {
+              string_pos = {comma_pos + 1, linefeed_pos - comma_pos - 1};
+            }
+          }
+        },
+        columns);
+    unresolved = unresolved_lines.load();
+  }
 
-    return std::make_unique<ProfileFile>(
-        std::move(file), std::move(interaction), std::move(meta),
-        std::move(unresolved_meta));
+  const StringPos& get(size_t row, size_t column) const {
+    return positions[row * num_columns + column];
   }
 };
 
-boost::optional<SourceBlock::Val> maybe_val_from_mp(
+// The method profiles of `interaction`, or nullptr if there are none.
+const method_profiles::StatsMap* find_method_profiles(
     const method_profiles::MethodProfiles& method_profiles,
-    const std::string& interaction,
-    const DexMethodRef* mref) {
+    const std::string& interaction) {
   if (!method_profiles.has_stats()) {
-    return boost::none;
+    return nullptr;
   }
 
   const auto& mp_map = method_profiles.all_interactions();
   const auto& inter_it = mp_map.find(interaction);
   if (inter_it == mp_map.end()) {
+    return nullptr;
+  }
+  return &inter_it->second;
+}
+
+boost::optional<SourceBlock::Val> maybe_val_from_mp(
+    const method_profiles::StatsMap* inter_map, const DexMethodRef* mref) {
+  if (inter_map == nullptr) {
     return boost::none;
   }
 
-  const auto& inter_map = inter_it->second;
-  auto it = inter_map.find(mref);
-  if (it == inter_map.end()) {
+  auto it = inter_map->find(mref);
+  if (it == inter_map->end()) {
     return boost::none;
   }
 
@@ -214,17 +228,38 @@ void run_source_blocks(DexStoresVector& stores,
                        const std::vector<std::string>& interactions) {
   auto scope = build_class_scope(stores);
 
-  std::mutex serialized_guard;
-  std::vector<std::pair<const DexMethod*, std::string>> serialized;
-  size_t blocks{0};
-  size_t profile_count{0};
+  ProfileTable table = [&]() {
+    Timer t("resolving profiles");
+    return ProfileTable(scope, profile_files);
+  }();
+
+  // Resolve the method profiles of the interactions once, rather than looking
+  // up the interaction by name for every method.
+  std::vector<const method_profiles::StatsMap*> mp_stats;
+  if (profile_files.empty()) {
+    // Some effort to recover from method profiles in general.
+    redex_assert(!always_inject || method_profiles.has_stats() ||
+                 interactions.empty());
+    for (const auto& inter : interactions) {
+      mp_stats.push_back(find_method_profiles(method_profiles, inter));
+    }
+  } else {
+    for (const auto& profile_file : profile_files) {
+      mp_stats.push_back(
+          find_method_profiles(method_profiles, profile_file->interaction));
+    }
+  }
 
+  std::vector<std::string> serialized(table.methods.size());
+  std::vector<char> handled(table.methods.size(), 0);
+  std::atomic<size_t> blocks{0};
+  std::atomic<size_t> profile_count{0};
   std::atomic<size_t> skipped{0};
 
-  auto find_profiles = [&profile_files, &always_inject, &method_profiles,
-                        &interactions](const DexMethodRef* mref) {
+  auto find_profiles = [&](size_t row) {
+    const DexMethodRef* mref = table.methods[row];
     std::vector<source_blocks::ProfileData> profiles;
-    profiles.reserve(profile_files.size());
+    profiles.reserve(mp_stats.size());
 
     auto val_to_str = [](const auto& v) -> std::string {
       if (!v) {
@@ -238,11 +273,8 @@ void run_source_blocks(DexStoresVector& stores,
 
     if (profile_files.empty()) {
       if (always_inject) {
-        // Some effort to recover from method profiles in general.
-        redex_assert(method_profiles.has_stats() || interactions.empty());
-
-        for (const auto& inter : interactions) {
-          auto val_opt = maybe_val_from_mp(method_profiles, inter, mref);
+        for (const auto* inter_map : mp_stats) {
+          auto val_opt = maybe_val_from_mp(inter_map, mref);
           profiles.emplace_back(val_opt ? *val_opt : SourceBlock::Val(0, 0));
         }
       }
@@ -250,12 +282,11 @@ void run_source_blocks(DexStoresVector& stores,
     }
 
     bool found_one = false;
-    for (auto& profile_file : profile_files) {
-      auto val_opt =
-          maybe_val_from_mp(method_profiles, profile_file->interaction, mref);
+    for (size_t column = 0; column != profile_files.size(); ++column) {
+      auto val_opt = maybe_val_from_mp(mp_stats[column], mref);
 
-      auto it = profile_file->method_meta.find(mref);
-      if (it == profile_file->method_meta.end()) {
+      const auto& pos = table.get(row, column);
+      if (pos == ProfileTable::kNone) {
         if (always_inject) {
           TRACE(METH_PROF, 3,
                 "No basic block profile for %s. Always-inject=true, falling "
@@ -279,10 +310,10 @@ void run_source_blocks(DexStoresVector& stores,
         continue;
       }
       found_one = true;
-      const auto& pos = it->second;
       profiles.emplace_back(std::make_pair(
-          std::string(profile_file->mapped_file.const_data() + pos.first,
-                      pos.second),
+          std::string(
+              profile_files[column]->mapped_file.const_data() + pos.first,
+              pos.second),
           val_opt));
       TRACE(METH_PROF, 3,
             "Found basic block profile for %s. Error fallback is %s.",
@@ -295,48 +326,59 @@ void run_source_blocks(DexStoresVector& stores,
     return std::make_pair(std::move(profiles), found_one);
   };
 
-  walk::parallel::methods(scope, [&](DexMethod* method) {
-    auto code = method->get_code();
-    if (code != nullptr) {
-      auto profiles = find_profiles(method);
-      if (!profiles.second && !always_inject) {
-        // Skip without profile.
-        skipped.fetch_add(1);
-        return;
-      }
+  // Every method has its own row, so the results need no synchronization.
+  std::vector<size_t> rows(table.methods.size());
+  std::iota(rows.begin(), rows.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t row) {
+        auto profiles = find_profiles(row);
+        if (!profiles.second && !always_inject) {
+          // Skip without profile.
+          skipped.fetch_add(1);
+          return;
+        }
 
-      auto res =
-          source_blocks(method, code, profiles.first, serialize, exc_inject);
-      std::unique_lock<std::mutex> lock(serialized_guard);
-      serialized.emplace_back(method, std::move(res.serialized));
-      blocks += res.block_count;
-      profile_count += profiles.second ? 1 : 0;
-    }
-  });
+        auto* method = table.methods[row];
+        auto res = source_blocks(method, method->get_code(), profiles.first,
+                                 serialize, exc_inject);
+        serialized[row] = std::move(res.serialized);
+        handled[row] = 1;
+        blocks.fetch_add(res.block_count);
+        if (profiles.second) {
+          profile_count.fetch_add(1);
+        }
+      },
+      rows);
 
   if (mgr.get_assessor_config().run_sb_consistency) {
     source_blocks::get_sbcc().initialize(scope);
   }
 
-  mgr.set_metric("inserted_source_blocks", blocks);
-  mgr.set_metric("handled_methods", serialized.size());
+  mgr.set_metric("inserted_source_blocks", blocks.load());
+  mgr.set_metric("handled_methods",
+                 std::count(handled.begin(), handled.end(), 1));
   mgr.set_metric("skipped_methods", skipped.load());
-  mgr.set_metric("methods_with_profiles", profile_count);
+  mgr.set_metric("methods_with_profiles", profile_count.load());
+  mgr.set_metric("unresolved_profile_methods", table.unresolved);
 
   if (!serialize) {
     return;
   }
 
-  std::sort(serialized.begin(),
-            serialized.end(),
-            [](const auto& lhs, const auto& rhs) {
-              return compare_dexmethods(lhs.first, rhs.first);
-            });
+  std::vector<size_t> order;
+  for (size_t row = 0; row != handled.size(); ++row) {
+    if (handled[row]) {
+      order.push_back(row);
+    }
+  }
+  std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+    return compare_dexmethods(table.methods[lhs], table.methods[rhs]);
+  });
 
   std::ofstream ofs(conf.metafile("redex-source-blocks.csv"));
   ofs << "type,version\nredex-source-blocks,1\nname,serialized\n";
-  for (const auto& p : serialized) {
-    ofs << show(p.first) << "," << p.second << "\n";
+  for (auto row : order) {
+    ofs << show(table.methods[row]) << "," << serialized[row] << "\n";
   }
 }
 
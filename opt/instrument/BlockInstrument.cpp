@@ -10,6 +10,7 @@
 #include "ConfigFiles.h"
 #include "DexClass.h"
 #include "DexUtil.h"
+#include "Dominators.h"
 #include "GraphUtil.h"
 #include "MethodReference.h"
 #include "ScopedMetrics.h"
@@ -47,6 +48,7 @@ enum class BlockType {
   Catch = 1 << 4,
   MoveException = 1 << 5,
   NoSourceBlock = 1 << 6,
+  Coalesced = 1 << 7,
 };
 
 enum class InstrumentedType {
@@ -138,6 +140,15 @@ std::ostream& operator<<(std::ostream& os, const BlockType& bt) {
     type = type ^ BlockType::NoSourceBlock;
   }
 
+  if ((type & BlockType::Coalesced) == BlockType::Coalesced) {
+    if (written) {
+      os << ",";
+    }
+    os << "Coalesced";
+    written = true;
+    type = type ^ BlockType::Coalesced;
+  }
+
   if (type != BlockType::Unspecified) {
     if (written) {
       os << ",";
@@ -195,6 +206,7 @@ struct MethodInfo {
   size_t num_empty_blocks = 0;
   size_t num_useless_blocks = 0;
   size_t num_no_source_blocks = 0;
+  size_t num_coalesced_blocks = 0;
   size_t num_blocks_too_large = 0;
   size_t num_catches = 0;
   size_t num_instrumented_catches = 0;
@@ -216,6 +228,7 @@ struct MethodInfo {
     num_empty_blocks += rhs.num_empty_blocks;
     num_useless_blocks += rhs.num_useless_blocks;
     num_no_source_blocks += rhs.num_no_source_blocks;
+    num_coalesced_blocks += rhs.num_coalesced_blocks;
     num_blocks_too_large += rhs.num_blocks_too_large;
     num_catches += rhs.num_catches;
     num_instrumented_catches += rhs.num_instrumented_catches;
@@ -832,6 +845,113 @@ void create_block_info(
       {block, BlockType::Instrumentable | type, insert_pos});
 }
 
+// The CFG with its edges reversed, and a virtual exit as entry, which is the
+// nullptr. Every block that may leave the method, by returning or by throwing,
+// has an edge from the exit.
+struct ReversedCfg {
+  explicit ReversedCfg(const cfg::ControlFlowGraph& cfg) {
+    for (auto* b : cfg.blocks()) {
+      auto ii = InstructionIterable(b);
+      if (b->succs().empty() ||
+          std::any_of(ii.begin(), ii.end(), [](const auto& mie) {
+            return opcode::may_throw(mie.insn->opcode());
+          })) {
+        exits.insert(b);
+      }
+    }
+  }
+
+  std::unordered_set<cfg::Block*> exits;
+};
+
+class ReversedCfgInterface {
+ public:
+  using Graph = ReversedCfg;
+  using NodeId = cfg::Block*;
+  // The source and the target in the reversed graph.
+  using EdgeId = std::pair<cfg::Block*, cfg::Block*>;
+
+  static NodeId entry(const Graph&) { return nullptr; }
+  static std::vector<EdgeId> predecessors(const Graph& graph,
+                                          const NodeId& b) {
+    std::vector<EdgeId> preds;
+    if (b == nullptr) {
+      return preds;
+    }
+    for (auto* e : b->succs()) {
+      preds.emplace_back(e->target(), b);
+    }
+    if (graph.exits.count(b)) {
+      preds.emplace_back(nullptr, b);
+    }
+    return preds;
+  }
+  static std::vector<EdgeId> successors(const Graph& graph, const NodeId& b) {
+    std::vector<EdgeId> succs;
+    if (b == nullptr) {
+      for (auto* exit : graph.exits) {
+        succs.emplace_back(nullptr, exit);
+      }
+      return succs;
+    }
+    for (auto* e : b->preds()) {
+      succs.emplace_back(b, e->src());
+    }
+    return succs;
+  }
+  static NodeId source(const Graph&, const EdgeId& e) { return e.first; }
+  static NodeId target(const Graph&, const EdgeId& e) { return e.second; }
+};
+
+// Two blocks execute together iff one dominates the other and is
+// post-dominated by it. Of each such class, only the first instrumentable
+// block in dominator order keeps its bit, and the source blocks of the others
+// are merged into it.
+//
+// Blocks that may throw count as exits, so a block is not coalesced with one
+// that an exception can skip.
+void coalesce_equivalent_blocks(
+    const cfg::ControlFlowGraph& cfg,
+    const std::vector<cfg::Block*>& blocks,
+    const std::unordered_map<const cfg::Block*, BlockInfo*>& block_mapping) {
+  dominators::SimpleFastDominators<cfg::GraphInterface> doms(cfg);
+  ReversedCfg reversed(cfg);
+  dominators::DominatorTree<ReversedCfgInterface> post_doms(reversed);
+
+  // The first block of the class of each block: as a block that dominates
+  // another and is post-dominated by it is also post-dominated by all the
+  // dominators in between, only the immediate dominator must be checked.
+  std::unordered_map<const cfg::Block*, cfg::Block*> leaders;
+  const auto& postordering = doms.get_postordering();
+  for (auto rit = postordering.rbegin(); rit != postordering.rend(); ++rit) {
+    auto* b = *rit;
+    auto* idom = doms.get_idom(b);
+    leaders[b] =
+        idom != b && post_doms.dominates(b, idom) ? leaders.at(idom) : b;
+  }
+
+  // Blocks come in the order of the source blocks, so a block comes after
+  // its dominators.
+  std::unordered_map<const cfg::Block*, BlockInfo*> holders;
+  for (auto* b : blocks) {
+    auto* info = block_mapping.at(b);
+    if (!info->is_instrumentable()) {
+      continue;
+    }
+    auto [it, emplaced] = holders.emplace(leaders.at(b), info);
+    if (emplaced) {
+      continue;
+    }
+    auto& merge_in = it->second->merge_in;
+    merge_in.push_back(b);
+    merge_in.insert(merge_in.end(), info->merge_in.begin(),
+                    info->merge_in.end());
+    info->merge_in.clear();
+    info->type =
+        (info->type ^ BlockType::Instrumentable) | BlockType::Coalesced;
+  }
+}
+
 auto get_blocks_to_instrument(const DexMethod* m,
                               const cfg::ControlFlowGraph& cfg,
                               const size_t max_num_blocks,
@@ -868,9 +988,15 @@ auto get_blocks_to_instrument(const DexMethod* m,
     block_mapping[b] = &block_info_list.back();
   }
 
-  BitId id = 0;
   for (cfg::Block* b : blocks) {
     create_block_info(m, b, options, block_mapping);
+  }
+  if (options.coalesce_equivalent_blocks) {
+    coalesce_equivalent_blocks(cfg, blocks, block_mapping);
+  }
+
+  BitId id = 0;
+  for (cfg::Block* b : blocks) {
     auto* info = block_mapping[b];
     if ((info->type & BlockType::Instrumentable) == BlockType::Instrumentable) {
       if (id >= max_num_blocks) {
@@ -1029,9 +1155,11 @@ MethodInfo instrument_basic_blocks(IRCode& code,
   info.num_empty_blocks = count(BlockType::Empty);
   info.num_useless_blocks = count(BlockType::Useless);
   info.num_no_source_blocks = count(BlockType::NoSourceBlock);
+  info.num_coalesced_blocks = count(BlockType::Coalesced);
   info.num_blocks_too_large = too_many_blocks ? info.num_non_entry_blocks : 0;
-  info.num_catches =
-      count(BlockType::Catch) - count(BlockType::Catch | BlockType::Useless);
+  info.num_catches = count(BlockType::Catch) -
+                     count(BlockType::Catch | BlockType::Useless) -
+                     count(BlockType::Catch | BlockType::Coalesced);
   info.num_instrumented_catches =
       count(BlockType::Catch | BlockType::Instrumentable);
   info.num_instrumented_blocks = num_to_instrument;
@@ -1054,7 +1182,8 @@ MethodInfo instrument_basic_blocks(IRCode& code,
 
   const size_t num_rejected_blocks =
       info.num_empty_blocks + info.num_useless_blocks +
-      info.num_no_source_blocks + info.num_blocks_too_large +
+      info.num_no_source_blocks + info.num_coalesced_blocks +
+      info.num_blocks_too_large +
       (info.num_catches - info.num_instrumented_catches);
   always_assert(info.num_non_entry_blocks ==
                 info.num_instrumented_blocks + num_rejected_blocks);
@@ -1252,6 +1381,9 @@ void print_stats(ScopedMetrics& sm,
           print_ratio(total.num_merged_not_instrumented).c_str());
     sm.set_metric("merged_not_instrumentable",
                   total.num_merged_not_instrumented);
+    TRACE(INSTRUMENT, 4, "- Coalesced blocks: %s",
+          print_ratio(total.num_coalesced_blocks).c_str());
+    sm.set_metric("coalesced", total.num_coalesced_blocks);
     TRACE(INSTRUMENT, 4, "- Skipped catch blocks: %s",
           SHOW(print_ratio(total_catches - total_instrumented_catches)));
     {
@@ -558,6 +558,10 @@ void InstrumentPass::bind_config() {
   bind("instrument_catches", true, m_options.instrument_catches);
   bind("instrument_blocks_without_source_block", true,
        m_options.instrument_blocks_without_source_block);
+  bind("coalesce_equivalent_blocks", false,
+       m_options.coalesce_equivalent_blocks,
+       "Share one bit between blocks that always execute together, i.e., a "
+       "block and the blocks that it dominates and that post-dominate it.");
   bind("instrument_only_root_store", false,
        m_options.instrument_only_root_store);
 
@@ -941,7 +945,7 @@ void InstrumentPass::run_pass(DexStoresVector& stores,
     exit(1);
   }
 
-  DexClass* analysis_cls = g_redex->type_class(analysis_class_type);
+  DexClass* analysis_cls = type_class(analysis_class_type);
   always_assert(analysis_cls != nullptr);
 
   // Check whether the analysis class is in the primary dex. We use a heuristic
@@ -78,6 +78,7 @@ class InstrumentPass : public Pass {
     int64_t max_num_blocks;
     bool instrument_catches;
     bool instrument_blocks_without_source_block;
+    bool coalesce_equivalent_blocks;
     bool instrument_only_root_store;
   };
 
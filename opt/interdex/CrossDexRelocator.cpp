@@ -14,10 +14,153 @@
 #include "DexUtil.h"
 #include "Mutators.h"
 #include "ReachableClasses.h"
+#include "Resolver.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
+
+namespace {
+
+// Whether the method meets the requirements that do not depend on its kind.
+bool can_relocate_common(const XStoreRefs* xstore_refs,
+                         size_t store_idx,
+                         DexMethod* m) {
+  bool basic_constraints = m->is_concrete() && m->get_code() &&
+                           can_rename(m) && !root(m) &&
+                           !m->rstate.no_optimizations() &&
+                           method::no_invoke_super(*m->get_code());
+  if (!basic_constraints) {
+    return false;
+  }
+
+  if (xstore_refs == nullptr) {
+    return true;
+  }
+
+  // Also do not relocate if any type mentioned in the code is missing or
+  // in another store.
+  std::vector<DexType*> types;
+  m->gather_types(types);
+  for (const auto* t : types) {
+    if (xstore_refs->illegal_ref(store_idx, t)) {
+      return false;
+    }
+  }
+
+  if (!get_visibility_changes(m).empty()) {
+    return false;
+  }
+
+  return true;
+}
+
+// The methods that the code refers to, and the definitions that they resolve
+// to, sorted.
+std::vector<const DexMethodRef*> gather_method_refs(DexMethod* m) {
+  std::vector<const DexMethodRef*> refs;
+  auto* code = m->get_code();
+  if (code == nullptr) {
+    return refs;
+  }
+  for (const auto& mie : InstructionIterable(code)) {
+    auto* insn = mie.insn;
+    if (!insn->has_method()) {
+      continue;
+    }
+    refs.push_back(insn->get_method());
+    if (opcode::is_an_invoke(insn->opcode())) {
+      auto* callee =
+          resolve_method(insn->get_method(), opcode_to_search(insn), m);
+      if (callee != nullptr) {
+        refs.push_back(callee);
+      }
+    }
+  }
+  std::sort(refs.begin(), refs.end());
+  refs.erase(std::unique(refs.begin(), refs.end()), refs.end());
+  return refs;
+}
+
+} // namespace
 
 namespace interdex {
+
+size_t CrossDexRelocator::get_store_idx(const DexClass* cls) const {
+  return m_xstore_refs == nullptr
+             ? 0
+             : m_xstore_refs->get_store_idx(cls->get_type());
+}
+
+void CrossDexRelocator::precompute(const Scope& scope) {
+  std::vector<std::pair<DexMethod*, size_t>> methods;
+  for (DexClass* cls : scope) {
+    if (cls->is_external()) {
+      continue;
+    }
+    size_t store_idx = get_store_idx(cls);
+    bool relocate_static_methods =
+        m_config.relocate_static_methods && !cls->get_clinit();
+    for (DexMethod* m : cls->get_dmethods()) {
+      if ((relocate_static_methods && is_static(m)) ||
+          (m_config.relocate_non_static_direct_methods && !is_static(m) &&
+           !method::is_init(m))) {
+        methods.emplace_back(m, store_idx);
+      }
+    }
+    if (m_config.relocate_virtual_methods) {
+      for (DexMethod* m : cls->get_vmethods()) {
+        methods.emplace_back(m, store_idx);
+      }
+    }
+  }
+
+  std::vector<MethodFacts> facts(methods.size());
+  std::vector<size_t> indices(methods.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        auto [m, store_idx] = methods[i];
+        auto& f = facts[i];
+        f.can_relocate = can_relocate_common(m_xstore_refs, store_idx, m);
+        if (!f.can_relocate) {
+          return;
+        }
+        std::unordered_set<DexMethodRef*> methods_preventing_relocation;
+        f.no_methods_prevent_relocation =
+            gather_invoked_methods_that_prevent_relocation(
+                m, &methods_preventing_relocation);
+        f.methods_preventing_relocation.assign(
+            methods_preventing_relocation.begin(),
+            methods_preventing_relocation.end());
+        std::sort(f.methods_preventing_relocation.begin(),
+                  f.methods_preventing_relocation.end(), compare_dexmethods);
+        f.method_refs = gather_method_refs(m);
+      },
+      indices);
+
+  m_method_facts.reserve(methods.size());
+  for (size_t i = 0; i < methods.size(); i++) {
+    m_method_facts.emplace(methods[i].first, std::move(facts[i]));
+  }
+}
+
+const CrossDexRelocator::MethodFacts* CrossDexRelocator::get_facts(
+    const DexMethod* m) const {
+  auto it = m_method_facts.find(m);
+  if (it == m_method_facts.end()) {
+    return nullptr;
+  }
+  // The facts only depend on the method and the methods it refers to, and
+  // only relocations change those.
+  const auto& refs = it->second.method_refs;
+  if (std::any_of(refs.begin(), refs.end(), [this](const DexMethodRef* ref) {
+        return m_relocated_methods.count(ref);
+      })) {
+    return nullptr;
+  }
+  return &it->second;
+}
+
 void CrossDexRelocator::gather_possibly_relocatable_methods(
     DexClass* cls, std::vector<DexMethod*>& possibly_relocatable_methods) {
   if (cls->is_external()) {
@@ -32,37 +175,11 @@ void CrossDexRelocator::gather_possibly_relocatable_methods(
       m_config.relocate_non_static_direct_methods;
   bool relocate_virtual_methods = m_config.relocate_virtual_methods;
 
-  size_t store_idx = m_xstore_refs == nullptr
-                         ? 0
-                         : m_xstore_refs->get_store_idx(cls->get_type());
-  auto can_relocate_common = [&](DexMethod* m) {
-    bool basic_constraints = m->is_concrete() && m->get_code() &&
-                             can_rename(m) && !root(m) &&
-                             !m->rstate.no_optimizations() &&
-                             method::no_invoke_super(*m->get_code());
-    if (!basic_constraints) {
-      return false;
-    }
-
-    if (m_xstore_refs == nullptr) {
-      return true;
-    }
-
-    // Also do not relocate if any type mentioned in the code is missing or
-    // in another store.
-    std::vector<DexType*> types;
-    m->gather_types(types);
-    for (const auto* t : types) {
-      if (m_xstore_refs->illegal_ref(store_idx, t)) {
-        return false;
-      }
-    }
-
-    if (!get_visibility_changes(m).empty()) {
-      return false;
-    }
-
-    return true;
+  size_t store_idx = get_store_idx(cls);
+  auto can_relocate = [&](DexMethod* m) {
+    const auto* facts = get_facts(m);
+    return facts != nullptr ? facts->can_relocate
+                            : can_relocate_common(m_xstore_refs, store_idx, m);
   };
 
   if (relocate_static_methods || relocate_non_static_direct_methods) {
@@ -70,7 +187,7 @@ void CrossDexRelocator::gather_possibly_relocatable_methods(
       if (((relocate_static_methods && is_static(m)) ||
            (relocate_non_static_direct_methods && !is_static(m) &&
             !method::is_init(m))) &&
-          can_relocate_common(m)) {
+          can_relocate(m)) {
         possibly_relocatable_methods.push_back(m);
       }
     }
@@ -78,7 +195,7 @@ void CrossDexRelocator::gather_possibly_relocatable_methods(
 
   if (relocate_virtual_methods) {
     for (DexMethod* m : cls->get_vmethods()) {
-      if (can_relocate_common(m)) {
+      if (can_relocate(m)) {
         // Limitation: We only support non-true virtuals.
         auto virt_scope = m_type_system.find_virtual_scope(m);
         if (virt_scope != nullptr && is_non_virtual_scope(virt_scope)) {
@@ -92,9 +209,19 @@ void CrossDexRelocator::gather_possibly_relocatable_methods(
 bool CrossDexRelocator::handle_invoked_direct_methods_that_prevent_relocation(
     DexMethod* meth,
     std::unordered_map<DexMethod*, DexClass*>& relocated_methods) {
-  std::unordered_set<DexMethodRef*> methods_preventing_relocation;
-  if (gather_invoked_methods_that_prevent_relocation(
-          meth, &methods_preventing_relocation)) {
+  std::vector<DexMethodRef*> methods_preventing_relocation;
+  const auto* facts = get_facts(meth);
+  bool no_methods_prevent_relocation;
+  if (facts != nullptr) {
+    no_methods_prevent_relocation = facts->no_methods_prevent_relocation;
+    methods_preventing_relocation = facts->methods_preventing_relocation;
+  } else {
+    std::unordered_set<DexMethodRef*> methods;
+    no_methods_prevent_relocation =
+        gather_invoked_methods_that_prevent_relocation(meth, &methods);
+    methods_preventing_relocation.assign(methods.begin(), methods.end());
+  }
+  if (no_methods_prevent_relocation) {
     always_assert(methods_preventing_relocation.empty());
     // No issues with direct methods.
     return true;
@@ -194,6 +321,7 @@ void CrossDexRelocator::relocate_methods(
 
         int api_level = api::LevelChecker::get_method_level(m);
         relocate_method(m, new_type);
+        m_relocated_methods.insert(m);
 
         m_relocated_method_infos.insert(
             {relocated_cls, {kind, m, cls, api_level}});
@@ -47,6 +47,11 @@ class CrossDexRelocator {
         m_dexes_structure(dexes_structure),
         m_xstore_refs(xstore_refs) {}
 
+  // Check in parallel which methods of `scope` could be relocated, ahead of
+  // the relocate_methods calls. Results that later relocations may affect
+  // are computed again when needed.
+  void precompute(const Scope& scope);
+
   // Analyze given class, and relocate eligible methods to separate classes.
   void relocate_methods(DexClass* cls,
                         std::vector<DexClass*>& relocated_classes);
@@ -82,8 +87,25 @@ class CrossDexRelocator {
     size_t size{0}; // number of methods
   };
 
+  // What relocate_methods checks about a method, computed ahead of time.
+  struct MethodFacts {
+    bool can_relocate{false};
+    // The result of gather_invoked_methods_that_prevent_relocation.
+    bool no_methods_prevent_relocation{false};
+    std::vector<DexMethodRef*> methods_preventing_relocation;
+    // The methods that the code refers to, and their resolved definitions,
+    // sorted.
+    std::vector<const DexMethodRef*> method_refs;
+  };
+
   std::string create_new_type_name(RelocatedMethodKind kind);
 
+  size_t get_store_idx(const DexClass* cls) const;
+
+  // The precomputed facts of the method, or nullptr if there are none or a
+  // method it refers to was relocated since.
+  const MethodFacts* get_facts(const DexMethod* m) const;
+
   void gather_possibly_relocatable_methods(
       DexClass* cls, std::vector<DexMethod*>& possibly_relocatable_methods);
 
@@ -105,6 +127,9 @@ class CrossDexRelocator {
       m_source_class_to_relocated_method_infos_map;
   std::unordered_set<DexClass*> m_classes_in_current_dex;
   std::unordered_set<DexMethod*> m_relocated_non_static_methods;
+  std::unordered_map<const DexMethod*, MethodFacts> m_method_facts;
+  // All methods relocated so far.
+  std::unordered_set<const DexMethodRef*> m_relocated_methods;
   size_t m_next_method_id{0};
   CrossDexRelocatorStats m_stats;
   const CrossDexRelocatorConfig m_config;
@@ -31,7 +31,9 @@
 #include "Show.h"
 #include "StlUtil.h"
 #include "StringUtil.h"
+#include "Timer.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 #include "file-utils.h"
 
 namespace {
@@ -152,32 +154,33 @@ std::unordered_set<DexClass*> find_unrefenced_coldstart_classes(
   return unreferenced_classes;
 }
 
-void gather_refs(
+interdex::ClassRefs gather_class_refs(const DexClass* cls) {
+  interdex::ClassRefs refs;
+  cls->gather_methods(refs.method_refs);
+  cls->gather_fields(refs.field_refs);
+  cls->gather_types(refs.type_refs);
+  cls->gather_init_classes(refs.init_type_refs);
+  return refs;
+}
+
+void collect_refs(
     const std::vector<std::unique_ptr<interdex::InterDexPassPlugin>>& plugins,
     const interdex::DexInfo& dex_info,
     const DexClass* cls,
+    interdex::ClassRefs refs,
     interdex::MethodRefs* mrefs,
     interdex::FieldRefs* frefs,
     interdex::TypeRefs* trefs,
     interdex::TypeRefs* itrefs) {
-  std::vector<DexMethodRef*> method_refs;
-  std::vector<DexFieldRef*> field_refs;
-  std::vector<DexType*> type_refs;
-  std::vector<DexType*> init_type_refs;
-  cls->gather_methods(method_refs);
-  cls->gather_fields(field_refs);
-  cls->gather_types(type_refs);
-  cls->gather_init_classes(init_type_refs);
-
   for (const auto& plugin : plugins) {
-    plugin->gather_refs(dex_info, cls, method_refs, field_refs, type_refs,
-                        init_type_refs);
+    plugin->gather_refs(dex_info, cls, refs.method_refs, refs.field_refs,
+                        refs.type_refs, refs.init_type_refs);
   }
 
-  mrefs->insert(method_refs.begin(), method_refs.end());
-  frefs->insert(field_refs.begin(), field_refs.end());
-  trefs->insert(type_refs.begin(), type_refs.end());
-  itrefs->insert(init_type_refs.begin(), init_type_refs.end());
+  mrefs->insert(refs.method_refs.begin(), refs.method_refs.end());
+  frefs->insert(refs.field_refs.begin(), refs.field_refs.end());
+  trefs->insert(refs.type_refs.begin(), refs.type_refs.end());
+  itrefs->insert(refs.init_type_refs.begin(), refs.init_type_refs.end());
 }
 
 void print_stats(interdex::DexesStructure* dexes_structure) {
@@ -331,6 +334,41 @@ bool InterDex::should_not_relocate_methods_of_class(const DexClass* clazz) {
   return false;
 }
 
+void InterDex::prefetch_refs(const std::vector<DexType*>& types) {
+  std::vector<const DexClass*> classes;
+  for (DexType* type : types) {
+    DexClass* cls = type_class(type);
+    if (cls == nullptr || is_canary(cls) || m_dexes_structure.has_class(cls)) {
+      continue;
+    }
+    if (m_prefetched_refs.emplace(cls, ClassRefs()).second) {
+      classes.push_back(cls);
+    }
+  }
+  // The map is not resized any more, so each worker can fill in its own
+  // entry.
+  workqueue_run<const DexClass*>(
+      [&](const DexClass* cls) {
+        m_prefetched_refs.at(cls) = gather_class_refs(cls);
+      },
+      classes);
+  TRACE(IDEX, 2, "[interdex classes]: Prefetched the refs of %zu classes.",
+        classes.size());
+}
+
+void InterDex::gather_refs(const DexInfo& dex_info,
+                           const DexClass* cls,
+                           MethodRefs* mrefs,
+                           FieldRefs* frefs,
+                           TypeRefs* trefs,
+                           TypeRefs* itrefs) {
+  auto it = m_prefetched_refs.find(cls);
+  collect_refs(m_plugins, dex_info, cls,
+               it != m_prefetched_refs.end() ? it->second
+                                             : gather_class_refs(cls),
+               mrefs, frefs, trefs, itrefs);
+}
+
 InterDex::EmitResult InterDex::emit_class(DexInfo& dex_info,
                                           DexClass* clazz,
                                           bool check_if_skip,
@@ -361,8 +399,8 @@ InterDex::EmitResult InterDex::emit_class(DexInfo& dex_info,
   FieldRefs clazz_frefs;
   TypeRefs clazz_trefs;
   TypeRefs clazz_itrefs;
-  gather_refs(m_plugins, dex_info, clazz, &clazz_mrefs, &clazz_frefs,
-              &clazz_trefs, &clazz_itrefs);
+  gather_refs(dex_info, clazz, &clazz_mrefs, &clazz_frefs, &clazz_trefs,
+              &clazz_itrefs);
 
   bool fits_current_dex = m_dexes_structure.add_class_to_current_dex(
       clazz_mrefs, clazz_frefs, clazz_trefs, clazz_itrefs, clazz);
@@ -383,8 +421,8 @@ InterDex::EmitResult InterDex::emit_class(DexInfo& dex_info,
     clazz_frefs.clear();
     clazz_trefs.clear();
     clazz_itrefs.clear();
-    gather_refs(m_plugins, dex_info, clazz, &clazz_mrefs, &clazz_frefs,
-                &clazz_trefs, &clazz_itrefs);
+    gather_refs(dex_info, clazz, &clazz_mrefs, &clazz_frefs, &clazz_trefs,
+                &clazz_itrefs);
 
     m_dexes_structure.add_class_no_checks(clazz_mrefs, clazz_frefs, clazz_trefs,
                                           clazz_itrefs, clazz);
@@ -462,6 +500,12 @@ void InterDex::emit_interdex_classes(
     return;
   }
 
+  Timer t(m_prefetch_betamap_refs ? "emit_interdex_classes (prefetched refs)"
+                                  : "emit_interdex_classes");
+  if (m_prefetch_betamap_refs) {
+    prefetch_refs(interdex_types);
+  }
+
   // NOTE: coldstart has no interaction with extended and scroll set, but that
   //       is not true for the later 2.
   dex_info.coldstart = true;
@@ -587,6 +631,7 @@ void InterDex::emit_interdex_classes(
   always_assert_log(!m_emitting_bg_set, "Unterminated background set marker");
 
   m_emitting_extended = false;
+  m_prefetched_refs.clear();
 }
 
 namespace {
@@ -792,6 +837,7 @@ void InterDex::init_cross_dex_ref_minimizer_and_relocate_methods() {
     m_cross_dex_relocator =
         new CrossDexRelocator(m_cross_dex_relocator_config, m_original_scope,
                               m_xstore_refs, m_dexes_structure);
+    m_cross_dex_relocator->precompute(m_scope);
 
     TRACE(IDEX, 2,
           "[dex ordering] Cross-dex-relocator active, max relocated methods "
@@ -962,8 +1008,8 @@ void InterDex::run_in_force_single_dex_mode() {
     FieldRefs clazz_frefs;
     TypeRefs clazz_trefs;
     TypeRefs clazz_itrefs;
-    gather_refs(m_plugins, dex_info, cls, &clazz_mrefs, &clazz_frefs,
-                &clazz_trefs, &clazz_itrefs);
+    gather_refs(dex_info, cls, &clazz_mrefs, &clazz_frefs, &clazz_trefs,
+                &clazz_itrefs);
 
     m_dexes_structure.add_class_no_checks(clazz_mrefs, clazz_frefs, clazz_trefs,
                                           clazz_itrefs, cls);
@@ -1217,8 +1263,8 @@ void InterDex::flush_out_dex(DexInfo& dex_info, DexClass* canary_cls) {
     FieldRefs clazz_frefs;
     TypeRefs clazz_trefs;
     TypeRefs clazz_itrefs;
-    gather_refs(m_plugins, dex_info, canary_cls, &clazz_mrefs, &clazz_frefs,
-                &clazz_trefs, &clazz_itrefs);
+    gather_refs(dex_info, canary_cls, &clazz_mrefs, &clazz_frefs, &clazz_trefs,
+                &clazz_itrefs);
 
     bool canary_added = m_dexes_structure.add_class_to_current_dex(
         clazz_mrefs, clazz_frefs, clazz_trefs, clazz_itrefs, canary_cls);
@@ -7,7 +7,9 @@
 
 #pragma once
 
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "AssetManager.h"
 #include "CrossDexRefMinimizer.h"
@@ -30,6 +32,14 @@ DexClass* create_canary(int dexnum, const DexString* store_name = nullptr);
 
 bool compare_dexclasses_for_compressed_size(DexClass* c1, DexClass* c2);
 
+// The refs of a class itself, before plugins had a chance to adjust them.
+struct ClassRefs {
+  std::vector<DexMethodRef*> method_refs;
+  std::vector<DexFieldRef*> field_refs;
+  std::vector<DexType*> type_refs;
+  std::vector<DexType*> init_type_refs;
+};
+
 class InterDex {
  public:
   InterDex(const Scope& original_scope,
@@ -57,7 +67,8 @@ class InterDex {
            std::vector<std::string> methods_for_canary_clinit_reference,
            const init_classes::InitClassesWithSideEffects&
                init_classes_with_side_effects,
-           bool transitively_close_interdex_order)
+           bool transitively_close_interdex_order,
+           bool prefetch_betamap_refs)
       : m_dexen(dexen),
         m_asset_manager(asset_manager),
         m_conf(conf),
@@ -81,7 +92,8 @@ class InterDex {
         m_sort_remaining_classes(sort_remaining_classes),
         m_methods_for_canary_clinit_reference(
             std::move(methods_for_canary_clinit_reference)),
-        m_transitively_close_interdex_order(transitively_close_interdex_order) {
+        m_transitively_close_interdex_order(transitively_close_interdex_order),
+        m_prefetch_betamap_refs(prefetch_betamap_refs) {
     m_dexes_structure.set_linear_alloc_limit(linear_alloc_limit);
     m_dexes_structure.set_reserve_frefs(reserve_frefs);
     m_dexes_structure.set_reserve_trefs(reserve_trefs);
@@ -171,6 +183,17 @@ class InterDex {
       const std::vector<DexType*>& interdex_types,
       const std::unordered_set<DexClass*>& unreferenced_classes,
       DexClass** canary_cls);
+  /**
+   * Gathers the refs of the given classes in parallel ahead of packing them,
+   * so that add_class_if_fits only has to wait for the plugins.
+   */
+  void prefetch_refs(const std::vector<DexType*>& types);
+  void gather_refs(const DexInfo& dex_info,
+                   const DexClass* cls,
+                   MethodRefs* mrefs,
+                   FieldRefs* frefs,
+                   TypeRefs* trefs,
+                   TypeRefs* itrefs);
   void init_cross_dex_ref_minimizer_and_relocate_methods();
   void emit_remaining_classes(DexInfo& dex_info, DexClass** canary_cls);
   DexClass* get_canary_cls(DexInfo& dex_info);
@@ -232,6 +255,8 @@ class InterDex {
   size_t m_transitive_closure_added{0};
   size_t m_transitive_closure_moved{0};
   const bool m_transitively_close_interdex_order;
+  const bool m_prefetch_betamap_refs;
+  std::unordered_map<const DexClass*, ClassRefs> m_prefetched_refs;
 };
 
 } // namespace interdex
@@ -116,6 +116,12 @@ void InterDexPass::bind_config() {
   bind("transitively_close_interdex_order", m_transitively_close_interdex_order,
        m_transitively_close_interdex_order);
 
+  bind("prefetch_betamap_refs", m_prefetch_betamap_refs,
+       m_prefetch_betamap_refs,
+       "Whether to gather the refs of the betamap-ordered classes in parallel "
+       "before packing them. This assumes that plugins don't edit classes that "
+       "have not been emitted yet.");
+
   trait(Traits::Pass::unique, true);
 }
 
@@ -146,7 +152,7 @@ void InterDexPass::run_pass(
       refs_info.frefs, refs_info.trefs, refs_info.mrefs, &xstore_refs,
       mgr.get_redex_options().min_sdk, m_sort_remaining_classes,
       m_methods_for_canary_clinit_reference, init_classes_with_side_effects,
-      m_transitively_close_interdex_order);
+      m_transitively_close_interdex_order, m_prefetch_betamap_refs);
 
   if (m_expect_order_list) {
     always_assert_log(
@@ -237,7 +243,8 @@ void InterDexPass::run_pass_on_nonroot_store(
       cross_dex_relocator_config, refs_info.frefs, refs_info.trefs,
       refs_info.mrefs, &xstore_refs, mgr.get_redex_options().min_sdk,
       m_sort_remaining_classes, m_methods_for_canary_clinit_reference,
-      init_classes_with_side_effects, m_transitively_close_interdex_order);
+      init_classes_with_side_effects, m_transitively_close_interdex_order,
+      /* prefetch_betamap_refs */ false);
 
   interdex.run_on_nonroot_store();
 
@@ -11,12 +11,14 @@
 #include "ConcurrentContainers.h"
 #include "Creators.h"
 #include "IRCode.h"
+#include "KotlinUseSites.h"
 #include "LiveRange.h"
 #include "Mutators.h"
 #include "PassManager.h"
 #include "ScopedCFG.h"
 #include "Show.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 void dump_cls(DexClass* cls) {
@@ -360,12 +362,16 @@ void KotlinObjectInliner::run_pass(DexStoresVector& stores,
       bad.insert(iter.first);
     }
   }
+  // Only the methods that reference a candidate can use it.
+  std::unordered_set<const DexType*> candidate_types;
+  for (auto& iter : map) {
+    candidate_types.insert(iter.first->get_type());
+  }
+  KotlinUseSites use_sites(scope, candidate_types);
+
   // Filter out any instance whose use is not tractable
-  walk::parallel::methods(scope, [&](DexMethod* method) {
+  workqueue_run<DexMethod*>([&](DexMethod* method) {
     auto code = method->get_code();
-    if (!code) {
-      return;
-    }
 
     // we cannot relocate returning companion obect.
     auto* rtype = type_class(method->get_proto()->get_rtype());
@@ -488,15 +494,17 @@ void KotlinObjectInliner::run_pass(DexStoresVector& stores,
         break;
       }
     }
-  });
+  }, use_sites.get_any(candidate_types));
   stats.kotlin_untrackable_companion_objects = bad.size();
   // Inline objects in candidate to maped class
   //
   std::unordered_set<DexMethodRef*> relocated_methods;
+  std::vector<const DexType*> relocated_types;
   for (auto& p : map) {
     auto* from_cls = p.first;
     auto* to_cls = p.second;
     if (!bad.count(from_cls)) {
+      relocated_types.push_back(from_cls->get_type());
       TRACE(KOTLIN_OBJ_INLINE,
             2,
             "Relocate : %s -> %s",
@@ -507,12 +515,9 @@ void KotlinObjectInliner::run_pass(DexStoresVector& stores,
     }
   }
 
-  // Fix virtual call arguments
-  walk::parallel::methods(scope, [&](DexMethod* method) {
-    auto code = method->get_code();
-    if (code == nullptr) {
-      return;
-    }
+  // Fix virtual call arguments. The relocated methods and the fields of the
+  // relocated classes are only referenced where their classes were.
+  workqueue_run<DexMethod*>([&](DexMethod* method) {
     bool changed = false;
     cfg::ScopedCFG cfg(method->get_code());
     cfg::CFGMutation m(*cfg);
@@ -557,7 +562,7 @@ void KotlinObjectInliner::run_pass(DexStoresVector& stores,
       TRACE(KOTLIN_OBJ_INLINE, 5, "After : %s\n", SHOW(method));
       TRACE(KOTLIN_OBJ_INLINE, 5, "%s\n", SHOW(*cfg));
     }
-  });
+  }, use_sites.get_any(relocated_types));
   stats.report(mgr);
 }
 
@@ -56,9 +56,86 @@ constexpr const char* METRIC_INIT_CLASS_INSTRUCTIONS_REFINED =
 
 } // namespace
 
-void LocalDcePass::run_pass(DexStoresVector& stores,
-                            ConfigFiles& conf,
-                            PassManager& mgr) {
+namespace {
+
+class LocalDceRun : public MethodPass::AccumulatingRun<LocalDce::Stats> {
+ public:
+  LocalDceRun(
+      std::unique_ptr<const method_override_graph::Graph> override_graph,
+      std::unique_ptr<init_classes::InitClassesWithSideEffects>
+          init_classes_with_side_effects,
+      std::unordered_set<DexMethodRef*> pure_methods,
+      size_t computed_no_side_effects_methods,
+      size_t computed_no_side_effects_methods_iterations,
+      bool may_allocate_registers)
+      : m_override_graph(std::move(override_graph)),
+        m_init_classes_with_side_effects(
+            std::move(init_classes_with_side_effects)),
+        m_pure_methods(std::move(pure_methods)),
+        m_computed_no_side_effects_methods(computed_no_side_effects_methods),
+        m_computed_no_side_effects_methods_iterations(
+            computed_no_side_effects_methods_iterations),
+        m_may_allocate_registers(may_allocate_registers) {}
+
+  bool uses_editable_cfg() const override { return true; }
+
+  LocalDce::Stats visit(DexMethod* m, IRCode& code) override {
+    if (m->rstate.no_optimizations()) {
+      return LocalDce::Stats();
+    }
+
+    LocalDce ldce(m_init_classes_with_side_effects.get(), m_pure_methods,
+                  m_override_graph.get(), m_may_allocate_registers);
+    ldce.dce(&code, /* normalize_new_instances */ true, m->get_class());
+    return ldce.get_stats();
+  }
+
+  void report(PassManager& mgr, const LocalDce::Stats& stats) override {
+    mgr.incr_metric(METRIC_NPE_INSTRUCTIONS, stats.npe_instruction_count);
+    mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS_ADDED,
+                    stats.init_class_instructions_added);
+    mgr.incr_metric(METRIC_DEAD_INSTRUCTIONS, stats.dead_instruction_count);
+    mgr.incr_metric(METRIC_UNREACHABLE_INSTRUCTIONS,
+                    stats.unreachable_instruction_count);
+    mgr.incr_metric(METRIC_NORMALIZED_NEW_INSTANCES,
+                    stats.normalized_new_instances);
+    mgr.incr_metric(METRIC_ALIASED_NEW_INSTANCES,
+                    stats.aliased_new_instances);
+    mgr.incr_metric(METRIC_COMPUTED_NO_SIDE_EFFECTS_METHODS,
+                    m_computed_no_side_effects_methods);
+    mgr.incr_metric(METRIC_COMPUTED_NO_SIDE_EFFECTS_METHODS_ITERATIONS,
+                    m_computed_no_side_effects_methods_iterations);
+    mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS,
+                    stats.init_classes.init_class_instructions);
+    mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS_REMOVED,
+                    stats.init_classes.init_class_instructions_removed);
+    mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS_REFINED,
+                    stats.init_classes.init_class_instructions_refined);
+    TRACE(DCE, 1,
+          "instructions removed -- npe: %zu, dead: %zu, init-class added: "
+          "%zu, unreachable: %zu; "
+          "normalized %zu new-instance instructions, %zu aliasaed",
+          stats.npe_instruction_count, stats.dead_instruction_count,
+          stats.init_class_instructions_added,
+          stats.unreachable_instruction_count, stats.normalized_new_instances,
+          stats.aliased_new_instances);
+  }
+
+ private:
+  std::unique_ptr<const method_override_graph::Graph> m_override_graph;
+  std::unique_ptr<init_classes::InitClassesWithSideEffects>
+      m_init_classes_with_side_effects;
+  std::unordered_set<DexMethodRef*> m_pure_methods;
+  size_t m_computed_no_side_effects_methods;
+  size_t m_computed_no_side_effects_methods_iterations;
+  bool m_may_allocate_registers;
+};
+
+} // namespace
+
+std::unique_ptr<MethodPass::Run> LocalDcePass::prepare(DexStoresVector& stores,
+                                                       ConfigFiles& conf,
+                                                       PassManager& mgr) {
   auto scope = build_class_scope(stores);
 
   auto pure_methods = get_pure_methods();
@@ -105,45 +182,10 @@ void LocalDcePass::run_pass(DexStoresVector& stores,
     });
   }
 
-  auto stats =
-      walk::parallel::methods<LocalDce::Stats>(scope, [&](DexMethod* m) {
-        auto* code = m->get_code();
-        if (code == nullptr || m->rstate.no_optimizations()) {
-          return LocalDce::Stats();
-        }
-
-        LocalDce ldce(init_classes_with_side_effects.get(), pure_methods,
-                      override_graph.get(), may_allocate_registers);
-        ldce.dce(code, /* normalize_new_instances */ true, m->get_class());
-        return ldce.get_stats();
-      });
-  mgr.incr_metric(METRIC_NPE_INSTRUCTIONS, stats.npe_instruction_count);
-  mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS_ADDED,
-                  stats.init_class_instructions_added);
-  mgr.incr_metric(METRIC_DEAD_INSTRUCTIONS, stats.dead_instruction_count);
-  mgr.incr_metric(METRIC_UNREACHABLE_INSTRUCTIONS,
-                  stats.unreachable_instruction_count);
-  mgr.incr_metric(METRIC_NORMALIZED_NEW_INSTANCES,
-                  stats.normalized_new_instances);
-  mgr.incr_metric(METRIC_ALIASED_NEW_INSTANCES, stats.aliased_new_instances);
-  mgr.incr_metric(METRIC_COMPUTED_NO_SIDE_EFFECTS_METHODS,
-                  computed_no_side_effects_methods.size());
-  mgr.incr_metric(METRIC_COMPUTED_NO_SIDE_EFFECTS_METHODS_ITERATIONS,
-                  computed_no_side_effects_methods_iterations);
-  mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS,
-                  stats.init_classes.init_class_instructions);
-  mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS_REMOVED,
-                  stats.init_classes.init_class_instructions_removed);
-  mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS_REFINED,
-                  stats.init_classes.init_class_instructions_refined);
-  TRACE(DCE, 1,
-        "instructions removed -- npe: %zu, dead: %zu, init-class added: %zu, "
-        "unreachable: %zu; "
-        "normalized %zu new-instance instructions, %zu aliasaed",
-        stats.npe_instruction_count, stats.dead_instruction_count,
-        stats.init_class_instructions_added,
-        stats.unreachable_instruction_count, stats.normalized_new_instances,
-        stats.aliased_new_instances);
+  return std::make_unique<LocalDceRun>(
+      std::move(override_graph), std::move(init_classes_with_side_effects),
+      std::move(pure_methods), computed_no_side_effects_methods.size(),
+      computed_no_side_effects_methods_iterations, may_allocate_registers);
 }
 
 static LocalDcePass s_pass;
@@ -10,9 +10,13 @@
 #include "LocalDce.h"
 #include "Pass.h"
 
-class LocalDcePass : public Pass {
+class LocalDcePass : public MethodPass {
  public:
-  LocalDcePass() : Pass("LocalDcePass") {}
+  LocalDcePass() : MethodPass("LocalDcePass") {}
 
-  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  std::unique_ptr<Run> prepare(DexStoresVector&,
+                               ConfigFiles&,
+                               PassManager&) override;
+
+  bool is_cfg_legal() const override { return true; }
 };
@@ -16,6 +16,7 @@
 #include "PassManager.h"
 #include "Resolver.h"
 #include "Show.h"
+#include "Timer.h"
 #include "Trace.h"
 #include "TypeReference.h"
 #include "TypeSystem.h"
@@ -636,16 +637,30 @@ void MergeInterfacePass::run_pass(DexStoresVector& stores,
   auto scope = build_class_scope(stores);
   TypeSystem type_system(scope);
 
-  auto can_merge =
-      collect_can_merge(scope, type_system, classes_groups, &m_metric);
-  // Remove interfaces that if merged could cause virtual method collision
-  strip_out_collision(scope, &can_merge);
-  strip_out_dmethod_relo_problem_intf(scope, &can_merge);
+  AccumulatingTimer collecting_timer;
+  auto can_merge = [&]() {
+    auto timer_scope = collecting_timer.scope();
+    auto can_merge =
+        collect_can_merge(scope, type_system, classes_groups, &m_metric);
+    // Remove interfaces that if merged could cause virtual method collision
+    strip_out_collision(scope, &can_merge);
+    strip_out_dmethod_relo_problem_intf(scope, &can_merge);
+    return can_merge;
+  }();
+  AccumulatingTimer merging_timer;
   std::unordered_map<DexMethodRef*, DexMethodRef*> old_to_new_method;
-  auto intf_merge_map =
-      merge_interfaces(can_merge, &m_metric, &old_to_new_method);
-  auto& ch = type_system.get_class_scopes().get_parent_to_children();
-  update_after_merge(scope, intf_merge_map, old_to_new_method, ch);
+  auto intf_merge_map = [&]() {
+    auto timer_scope = merging_timer.scope();
+    return merge_interfaces(can_merge, &m_metric, &old_to_new_method);
+  }();
+  // The merge map of all groups is applied in a single update of the
+  // references.
+  AccumulatingTimer updating_timer;
+  {
+    auto timer_scope = updating_timer.scope();
+    auto& ch = type_system.get_class_scopes().get_parent_to_children();
+    update_after_merge(scope, intf_merge_map, old_to_new_method, ch);
+  }
   remove_merged_interfaces(scope, intf_merge_map);
   post_dexen_changes(scope, stores);
   write_interface_merging_mapping_file(
@@ -655,6 +670,9 @@ void MergeInterfacePass::run_pass(DexStoresVector& stores,
   mgr.set_metric("num_created_interfaces", m_metric.interfaces_created);
   mgr.set_metric("num_interfaces_in_anno_not_merging",
                  m_metric.interfaces_in_annotation);
+  mgr.set_metric("collecting_us", collecting_timer.get_microseconds());
+  mgr.set_metric("merging_us", merging_timer.get_microseconds());
+  mgr.set_metric("updating_references_us", updating_timer.get_microseconds());
 }
 
 static MergeInterfacePass s_pass;
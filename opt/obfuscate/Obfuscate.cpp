@@ -6,6 +6,7 @@
  */
 
 #include <list>
+#include <numeric>
 
 #include "ClassHierarchy.h"
 #include "DexClass.h"
@@ -20,6 +21,7 @@
 #include "Trace.h"
 #include "VirtualRenamer.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -138,11 +140,137 @@ void get_totals(Scope& scope, RenameStats& stats) {
   }
 }
 
+// Picks the new names of the fields and direct methods of `cls`. The names
+// only depend on the classes in the hierarchy of `cls`.
+void obfuscate_class(DexClass* cls,
+                     const ClassHierarchy& ch,
+                     DexFieldManager& field_name_manager,
+                     DexMethodManager& method_name_manager,
+                     std::unordered_map<const DexClass*, int>* next_seeds) {
+  always_assert_log(!cls->is_external(),
+                    "Shouldn't rename members of external classes. %s",
+                    SHOW(cls));
+  // Checks to short-circuit expensive name-gathering logic (code is still
+  // correct w/o this, but does unnecessary work)
+  bool operate_on_ifields =
+      contains_renamable_elem(cls->get_ifields(), field_name_manager);
+  bool operate_on_sfields =
+      contains_renamable_elem(cls->get_sfields(), field_name_manager);
+  bool operate_on_dmethods =
+      contains_renamable_elem(cls->get_dmethods(), method_name_manager);
+  if (operate_on_ifields || operate_on_sfields) {
+    FieldObfuscationState f_ob_state;
+    FieldNameGenerator field_name_generator(f_ob_state.ids_to_avoid,
+                                            f_ob_state.used_ids);
+
+    TRACE(OBFUSCATE, 3, "Renaming the fields of class %s",
+          SHOW(cls->get_name()));
+
+    f_ob_state.populate_ids_to_avoid(cls, field_name_manager,
+                                     /* unused */ ch);
+
+    if (operate_on_ifields) {
+      obfuscate_elems(
+          FieldRenamingContext(cls->get_ifields(), field_name_generator),
+          field_name_manager);
+    }
+    if (operate_on_sfields) {
+      obfuscate_elems(
+          FieldRenamingContext(cls->get_sfields(), field_name_generator),
+          field_name_manager);
+    }
+
+    // Make sure to bind the new names otherwise not all generators will
+    // assign names to the members
+    field_name_generator.bind_names();
+  }
+
+  // =========== Obfuscate Methods Below ==========
+  if (operate_on_dmethods) {
+    MethodObfuscationState m_ob_state;
+    MethodNameGenerator direct_method_name_gen(m_ob_state.ids_to_avoid,
+                                               m_ob_state.used_ids);
+
+    TRACE(OBFUSCATE, 3, "Renaming the methods of class %s",
+          SHOW(cls->get_name()));
+    m_ob_state.populate_ids_to_avoid(cls, method_name_manager, ch);
+
+    obfuscate_elems(MethodRenamingContext(cls->get_dmethods(),
+                                          direct_method_name_gen,
+                                          method_name_manager),
+                    method_name_manager);
+
+    direct_method_name_gen.bind_names();
+    auto next_ctr = direct_method_name_gen.next_ctr();
+    if (next_ctr) {
+      next_seeds->emplace(cls, direct_method_name_gen.next_ctr());
+    }
+  }
+}
+
+// Creates the name wrappers of all the members that obfuscate_class looks at,
+// i.e. those of the scope and of the external superclasses, so that it only
+// looks them up and may run concurrently.
+void create_name_wrappers(const Scope& scope,
+                          DexFieldManager& field_name_manager,
+                          DexMethodManager& method_name_manager) {
+  auto add_methods = [&](const DexClass* cls) {
+    for (auto* m : cls->get_dmethods()) {
+      method_name_manager[m];
+    }
+    for (auto* m : cls->get_vmethods()) {
+      method_name_manager[m];
+    }
+  };
+  std::unordered_set<const DexClass*> external_supers;
+  for (const auto* cls : scope) {
+    for (auto* f : cls->get_ifields()) {
+      field_name_manager[f];
+    }
+    for (auto* f : cls->get_sfields()) {
+      field_name_manager[f];
+    }
+    add_methods(cls);
+  }
+  for (const auto* cls : scope) {
+    for (auto* super = type_class(cls->get_super_class()); super != nullptr;
+         super = type_class(super->get_super_class())) {
+      if (super->is_external() && external_supers.insert(super).second) {
+        add_methods(super);
+      }
+    }
+  }
+}
+
+// Groups the classes by the top-most internal class of their hierarchy. The
+// new member names of a class only depend on its superclasses and
+// subclasses, and not on those of another group, so that the groups can be
+// named in parallel with the same result as a serial run. The groups, and the
+// classes within them, are in the order of `scope`.
+std::vector<std::vector<DexClass*>> partition_by_hierarchy(const Scope& scope) {
+  std::vector<std::vector<DexClass*>> groups;
+  std::unordered_map<const DexClass*, size_t> group_of_root;
+  for (auto* cls : scope) {
+    const DexClass* root = cls;
+    for (auto* super = type_class(root->get_super_class());
+         super != nullptr && !super->is_external();
+         super = type_class(super->get_super_class())) {
+      root = super;
+    }
+    auto it = group_of_root.emplace(root, groups.size()).first;
+    if (it->second == groups.size()) {
+      groups.emplace_back();
+    }
+    groups[it->second].push_back(cls);
+  }
+  return groups;
+}
+
 } // end namespace
 
 void obfuscate(Scope& scope,
                RenameStats& stats,
-               bool avoid_colliding_debug_name) {
+               const ObfuscatePass::Config& config) {
   get_totals(scope, stats);
   ClassHierarchy ch = build_type_hierarchy(scope);
 
@@ -150,65 +278,30 @@ void obfuscate(Scope& scope,
   DexMethodManager method_name_manager = new_dex_method_manager();
 
   std::unordered_map<const DexClass*, int> next_dmethod_seeds;
-  for (DexClass* cls : scope) {
-    always_assert_log(!cls->is_external(),
-                      "Shouldn't rename members of external classes. %s",
-                      SHOW(cls));
-    // Checks to short-circuit expensive name-gathering logic (code is still
-    // correct w/o this, but does unnecessary work)
-    bool operate_on_ifields =
-        contains_renamable_elem(cls->get_ifields(), field_name_manager);
-    bool operate_on_sfields =
-        contains_renamable_elem(cls->get_sfields(), field_name_manager);
-    bool operate_on_dmethods =
-        contains_renamable_elem(cls->get_dmethods(), method_name_manager);
-    if (operate_on_ifields || operate_on_sfields) {
-      FieldObfuscationState f_ob_state;
-      FieldNameGenerator field_name_generator(f_ob_state.ids_to_avoid,
-                                              f_ob_state.used_ids);
-
-      TRACE(OBFUSCATE, 3, "Renaming the fields of class %s",
-            SHOW(cls->get_name()));
-
-      f_ob_state.populate_ids_to_avoid(cls, field_name_manager,
-                                       /* unused */ ch);
-
-      if (operate_on_ifields) {
-        obfuscate_elems(
-            FieldRenamingContext(cls->get_ifields(), field_name_generator),
-            field_name_manager);
-      }
-      if (operate_on_sfields) {
-        obfuscate_elems(
-            FieldRenamingContext(cls->get_sfields(), field_name_generator),
-            field_name_manager);
-      }
-
-      // Make sure to bind the new names otherwise not all generators will
-      // assign names to the members
-      field_name_generator.bind_names();
+  if (config.parallel_name_assignment) {
+    create_name_wrappers(scope, field_name_manager, method_name_manager);
+    auto groups = partition_by_hierarchy(scope);
+    TRACE(OBFUSCATE, 2, "Picking new names for %zu hierarchies in parallel",
+          groups.size());
+    std::vector<std::unordered_map<const DexClass*, int>> group_seeds(
+        groups.size());
+    std::vector<size_t> group_indices(groups.size());
+    std::iota(group_indices.begin(), group_indices.end(), 0);
+    workqueue_run<size_t>(
+        [&](size_t i) {
+          for (auto* cls : groups[i]) {
+            obfuscate_class(cls, ch, field_name_manager, method_name_manager,
+                            &group_seeds[i]);
+          }
+        },
+        group_indices);
+    for (auto& seeds : group_seeds) {
+      next_dmethod_seeds.insert(seeds.begin(), seeds.end());
     }
-
-    // =========== Obfuscate Methods Below ==========
-    if (operate_on_dmethods) {
-      MethodObfuscationState m_ob_state;
-      MethodNameGenerator direct_method_name_gen(m_ob_state.ids_to_avoid,
-                                                 m_ob_state.used_ids);
-
-      TRACE(OBFUSCATE, 3, "Renaming the methods of class %s",
-            SHOW(cls->get_name()));
-      m_ob_state.populate_ids_to_avoid(cls, method_name_manager, ch);
-
-      obfuscate_elems(MethodRenamingContext(cls->get_dmethods(),
-                                            direct_method_name_gen,
-                                            method_name_manager),
-                      method_name_manager);
-
-      direct_method_name_gen.bind_names();
-      auto next_ctr = direct_method_name_gen.next_ctr();
-      if (next_ctr) {
-        next_dmethod_seeds.emplace(cls, direct_method_name_gen.next_ctr());
-      }
+  } else {
+    for (DexClass* cls : scope) {
+      obfuscate_class(cls, ch, field_name_manager, method_name_manager,
+                      &next_dmethod_seeds);
     }
   }
   field_name_manager.print_elements();
@@ -228,7 +321,8 @@ void obfuscate(Scope& scope,
   stats.dmethods_renamed = method_name_manager.commit_renamings_to_dex();
 
   stats.vmethods_renamed =
-      rename_virtuals(scope, avoid_colliding_debug_name, next_dmethod_seeds);
+      rename_virtuals(scope, config.avoid_colliding_debug_name,
+                      next_dmethod_seeds);
 
   debug_logging(scope);
 
@@ -254,7 +348,9 @@ void ObfuscatePass::run_pass(DexStoresVector& stores,
   auto scope = build_class_scope(stores);
   RenameStats stats;
   auto debug_info_kind = mgr.get_redex_options().debug_info_kind;
-  obfuscate(scope, stats, is_iodi(debug_info_kind));
+  auto config = m_config;
+  config.avoid_colliding_debug_name = is_iodi(debug_info_kind);
+  obfuscate(scope, stats, config);
   mgr.incr_metric(METRIC_FIELD_TOTAL, static_cast<int>(stats.fields_total));
   mgr.incr_metric(METRIC_FIELD_RENAMED, static_cast<int>(stats.fields_renamed));
   mgr.incr_metric(METRIC_DMETHODS_TOTAL,
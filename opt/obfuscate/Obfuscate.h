@@ -15,10 +15,18 @@ class ObfuscatePass : public Pass {
 
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
-  void bind_config() final { trait(Traits::Pass::unique, true); }
+  void bind_config() final {
+    bind("parallel_name_assignment", false,
+         m_config.parallel_name_assignment,
+         "Pick the new names of fields and direct methods of independent "
+         "class hierarchies in parallel. The names are the same as in a "
+         "serial run.");
+    trait(Traits::Pass::unique, true);
+  }
 
   struct Config {
     bool avoid_colliding_debug_name{false};
+    bool parallel_name_assignment{false};
   };
 
  private:
@@ -528,9 +528,28 @@ class DexElemManager {
   // void lock_elements() { mark_all_unrenamable = true; }
   // void unlock_elements() { mark_all_unrenamable = false; }
 
+  // Only looks up the maps, so that lookups of existing wrappers may run
+  // concurrently.
+  inline DexNameWrapper<T>* find_wrapper(DexType* cls,
+                                         K sig,
+                                         const DexString* name) {
+    auto cls_it = elements.find(cls);
+    if (cls_it == elements.end()) {
+      return nullptr;
+    }
+    auto sig_it = cls_it->second.find(sig);
+    if (sig_it == cls_it->second.end()) {
+      return nullptr;
+    }
+    auto name_it = sig_it->second.find(name);
+    if (name_it == sig_it->second.end()) {
+      return nullptr;
+    }
+    return name_it->second.get();
+  }
+
   inline bool contains_elem(DexType* cls, K sig, const DexString* name) {
-    return elements.count(cls) > 0 && elements[cls].count(sig) > 0 &&
-           elements[cls][sig].count(name) > 0;
+    return find_wrapper(cls, sig, name) != nullptr;
   }
 
   inline bool contains_elem(R elem) {
@@ -551,10 +570,9 @@ class DexElemManager {
   // Mirrors the map get operator, but ensures we create correct wrappers
   // if they don't exist
   inline DexNameWrapper<T>* operator[](T elem) {
-    return contains_elem(elem) ? elements[elem->get_class()]
-                                         [sig_getter_fn(elem)][elem->get_name()]
-                                             .get()
-                               : emplace(elem);
+    auto* wrap =
+        find_wrapper(elem->get_class(), sig_getter_fn(elem), elem->get_name());
+    return wrap != nullptr ? wrap : emplace(elem);
   }
 
   // Commits all the renamings in elements to the dex by modifying the
@@ -512,7 +512,8 @@ size_t rename_virtuals(
     bool avoid_stack_trace_collision,
     const std::unordered_map<const DexClass*, int>& next_dmethod_seeds) {
   // build a ClassScope a RefsMap and a VirtualRenamer
-  ClassScopes class_scopes(scope);
+  auto class_scopes_ptr = ClassScopes::get_or_build(scope);
+  const auto& class_scopes = *class_scopes_ptr;
   scope_info(class_scopes);
   RefsMap def_refs;
   collect_refs(scope, def_refs);
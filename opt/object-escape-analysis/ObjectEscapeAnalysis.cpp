@@ -964,25 +964,39 @@ void ObjectEscapeAnalysisPass::run_pass(DexStoresVector& stores,
                                         ConfigFiles& conf,
                                         PassManager& mgr) {
   const auto scope = build_class_scope(stores);
-  auto method_override_graph = mog::build_graph(scope);
-  init_classes::InitClassesWithSideEffects init_classes_with_side_effects(
-      scope, conf.create_init_class_insns(), method_override_graph.get());
-  auto non_true_virtual =
-      mog::get_non_true_virtuals(*method_override_graph, scope);
 
-  std::unordered_map<DexType*, Locations> new_instances;
-  std::unordered_map<DexMethod*, Locations> invokes;
-  std::unordered_map<DexMethod*, std::unordered_set<DexMethod*>> dependencies;
-  analyze_scope(scope, non_true_virtual, &new_instances, &invokes,
-                &dependencies);
+  // Only the method summaries and the root methods are needed to reduce the
+  // root methods. Everything else the analysis builds is released before the
+  // reduction starts copying and inlining code, so that both never take up
+  // memory at the same time.
+  std::unordered_map<DexMethod*, MethodSummary> method_summaries;
+  std::unordered_map<DexMethod*, std::unordered_map<DexType*, bool>>
+      root_methods;
+  {
+    std::unordered_map<DexType*, Locations> new_instances;
+    std::unordered_map<DexMethod*, Locations> invokes;
+    {
+      std::unordered_set<DexMethod*> non_true_virtual;
+      {
+        auto method_override_graph = mog::build_graph(scope);
+        non_true_virtual =
+            mog::get_non_true_virtuals(*method_override_graph, scope);
+      }
+      std::unordered_map<DexMethod*, std::unordered_set<DexMethod*>>
+          dependencies;
+      analyze_scope(scope, non_true_virtual, &new_instances, &invokes,
+                    &dependencies);
 
-  auto method_summaries =
-      compute_method_summaries(mgr, scope, dependencies, non_true_virtual);
+      method_summaries =
+          compute_method_summaries(mgr, scope, dependencies, non_true_virtual);
+    }
 
-  auto inline_anchors = compute_inline_anchors(scope, method_summaries);
+    auto inline_anchors = compute_inline_anchors(scope, method_summaries);
 
-  auto root_methods = compute_root_methods(mgr, new_instances, invokes,
-                                           method_summaries, inline_anchors);
+    root_methods = compute_root_methods(mgr, new_instances, invokes,
+                                        method_summaries, inline_anchors);
+  }
+  mgr.set_metric("vm_hwm_after_analysis", get_mem_stats().vm_hwm);
 
   Stats stats;
   reduce(stores, scope, conf, method_summaries, root_methods, &stats);
@@ -9,6 +9,7 @@
 
 #include <fstream>
 #include <functional>
+#include <map>
 
 #include "ConcurrentContainers.h"
 #include "ConfigFiles.h"
@@ -145,6 +146,18 @@ void ObjectSensitiveDcePass::run_pass(DexStoresVector& stores,
                                           escape_summaries.end());
   auto ptrs_fp_iter_map =
       ptrs::analyze_scope(scope, call_graph, &escape_summaries_cmap);
+  if (m_escape_summaries_output_file) {
+    std::map<const DexMethodRef*, ptrs::EscapeSummary, dexmethods_comparator>
+        own_summaries;
+    for (auto& [method, summary] : escape_summaries_cmap) {
+      if (!method->is_external()) {
+        own_summaries.emplace(method, summary);
+      }
+    }
+    std::ofstream file_output(*m_escape_summaries_output_file);
+    summary_serialization::print(file_output, own_summaries);
+    mgr.set_metric("escape_summaries_written", own_summaries.size());
+  }
 
   side_effects::SummaryMap effect_summaries;
   if (m_external_side_effect_summaries_file) {
@@ -27,6 +27,12 @@ class ObjectSensitiveDcePass final : public Pass {
     bind("escape_summaries", {boost::none}, m_external_escape_summaries_file,
          "TODO: Document me!",
          Configurable::bindflags::optionals::skip_empty_string);
+    bind("escape_summaries_output", {boost::none},
+         m_escape_summaries_output_file,
+         "File to write the escape summaries of the methods in this build to. "
+         "A build against these classes as a library can read it back with "
+         "`escape_summaries`.",
+         Configurable::bindflags::optionals::skip_empty_string);
 
     if (!m_external_escape_summaries_file ||
         !m_external_side_effect_summaries_file) {
@@ -41,4 +47,5 @@ class ObjectSensitiveDcePass final : public Pass {
  private:
   boost::optional<std::string> m_external_side_effect_summaries_file;
   boost::optional<std::string> m_external_escape_summaries_file;
+  boost::optional<std::string> m_escape_summaries_output_file;
 };
@@ -19,6 +19,9 @@
 #include "TypeReference.h"
 #include "UsedVarsAnalysis.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
+
+#include <numeric>
 
 /**
  * We already get a set of candidate enums which are safe to be replaced with
@@ -1061,11 +1064,24 @@ class EnumTransformer final {
   EnumTransformer(const Config& config, DexStoresVector* stores)
       : m_stores(*stores), m_int_objs(0) {
     m_enum_util = std::make_unique<EnumUtil>(config);
-    for (auto it = config.candidate_enums.begin();
-         it != config.candidate_enums.end();
-         ++it) {
-      auto enum_cls = type_class(*it);
-      auto attributes = optimize_enums::analyze_enum_clinit(enum_cls);
+    std::vector<DexType*> candidates(config.candidate_enums.begin(),
+                                     config.candidate_enums.end());
+    std::sort(candidates.begin(), candidates.end(), compare_dextypes);
+    // The <clinit>s are independent of each other, only cleaning the classes
+    // up needs to be serial.
+    std::vector<EnumAttributes> candidate_attributes(candidates.size());
+    std::vector<size_t> indices(candidates.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    workqueue_run<size_t>(
+        [&](size_t i) {
+          candidate_attributes[i] =
+              optimize_enums::analyze_enum_clinit(type_class(candidates[i]));
+        },
+        indices);
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      auto type = candidates[i];
+      auto enum_cls = type_class(type);
+      auto& attributes = candidate_attributes[i];
       size_t num_enum_constants = attributes.m_constants_map.size();
       if (num_enum_constants == 0) {
         TRACE(ENUM, 2, "\tCannot analyze enum %s : ord %lu sfields %lu",
@@ -1073,7 +1089,7 @@ class EnumTransformer final {
               enum_cls->get_sfields().size());
         continue;
       } else if (num_enum_constants > config.max_enum_size) {
-        if (!config.breaking_reference_equality_allowlist.count(*it)) {
+        if (!config.breaking_reference_equality_allowlist.count(type)) {
           TRACE(ENUM, 2, "\tSkip %s %lu values", SHOW(enum_cls),
                 num_enum_constants);
           continue;
@@ -1086,7 +1102,7 @@ class EnumTransformer final {
       }
       m_int_objs = std::max<uint32_t>(m_int_objs, num_enum_constants);
       m_enum_objs += num_enum_constants;
-      m_enum_attributes_map.emplace(*it, attributes);
+      m_enum_attributes_map.emplace(type, std::move(attributes));
       clean_generated_methods_fields(enum_cls);
       opt_metadata::log_opt(ENUM_OPTIMIZED, enum_cls);
     }
@@ -1184,7 +1200,11 @@ class EnumTransformer final {
   }
 
   void create_substitute_methods(const ConcurrentSet<DexMethodRef*>& methods) {
-    for (auto ref : methods) {
+    // The code transformation only interned the references; create all the
+    // methods at once, in a deterministic order.
+    std::vector<DexMethodRef*> refs(methods.begin(), methods.end());
+    std::sort(refs.begin(), refs.end(), compare_dexmethods);
+    for (auto ref : refs) {
       if (ref->get_name() == m_enum_util->REDEX_NAME) {
         create_name_method(ref);
       } else if (ref->get_name() == m_enum_util->REDEX_HASHCODE) {
@@ -14,7 +14,9 @@
  * instructions in a block occurs sufficiently often. The average complexity is
  * held down by filtering out instruction sequences where adjacent sequences of
  * abstracted instructions ("cores") of fixed lengths never occur twice anywhere
- * in the scope (seems good enough, even without a suffix tree).
+ * in the scope. In addition, a suffix array over the cores of all outlinable
+ * instructions yields, for each instruction, how long the sequence starting
+ * there can get before it no longer occurs anywhere else.
  *
  * When reaching a conditional branch or switch instruction, different control-
  * paths are explored as well, as long as they eventually all arrive at a common
@@ -65,6 +67,7 @@
 #include "InstructionSequenceOutliner.h"
 
 #include <algorithm>
+#include <limits>
 #include <list>
 #include <map>
 #include <memory>
@@ -106,6 +109,7 @@
 #include "Resolver.h"
 #include "Show.h"
 #include "StlUtil.h"
+#include "SuffixArray.h"
 #include "Trace.h"
 #include "Walkers.h"
 
@@ -788,6 +792,10 @@ using MethodCandidates =
                        std::vector<CandidateMethodLocation>,
                        CandidateHasher>;
 
+// For each instruction that may start a candidate, an upper bound on the
+// number of instructions of the root of any candidate starting there.
+using MaxRootSizes = std::unordered_map<const IRInstruction*, uint32_t>;
+
 // Callback invoked when either...
 // - one more instruction was successfully appended to the partial candidate,
 // and a point was reached that could potentially mark the end of an outlined
@@ -802,7 +810,8 @@ using ExploredCallback =
                        cfg::Block* next_block)>;
 
 // Look for and add entire candidate sequences starting at a
-// particular point in a big block.
+// particular point in a big block, with at most max_root_size instructions
+// before the first branch.
 // Result indicates whether the big block was successfully explored to the end.
 static bool explore_candidates_from(
     LazyReachingInitializedsEnvironments& reaching_initialized_new_instances,
@@ -811,6 +820,7 @@ static bool explore_candidates_from(
     const Config& config,
     const RefChecker& ref_checker,
     const CandidateInstructionCoresSet& recurring_cores,
+    size_t max_root_size,
     PartialCandidate* pc,
     PartialCandidateNode* pcn,
     big_blocks::InstructionIterator it,
@@ -824,6 +834,9 @@ static bool explore_candidates_from(
     if (pc->insns_size >= config.max_insns_size) {
       return false;
     }
+    if (pcn == &pc->root && pcn->insns.size() >= max_root_size) {
+      return false;
+    }
     auto insn = it->insn;
     if (pcn->insns.size() + 1 < MIN_INSNS_SIZE &&
         !can_outline_insn(ref_checker, reaching_initialized_init_first_param,
@@ -870,11 +883,11 @@ static bool explore_candidates_from(
           always_assert(
               is_uniquely_reached_via_pred(succ_big_block->get_first_block()));
           auto succ_ii = big_blocks::InstructionIterable(*succ_big_block);
-          if (!explore_candidates_from(reaching_initialized_new_instances,
-                                       reaching_initialized_init_first_param,
-                                       config, ref_checker, recurring_cores, pc,
-                                       succ_pcn.get(), succ_ii.begin(),
-                                       succ_ii.end())) {
+          if (!explore_candidates_from(
+                  reaching_initialized_new_instances,
+                  reaching_initialized_init_first_param, config, ref_checker,
+                  recurring_cores, max_root_size, pc, succ_pcn.get(),
+                  succ_ii.begin(), succ_ii.end())) {
             return false;
           }
         }
@@ -948,6 +961,7 @@ static MethodCandidates find_method_candidates(
     DexMethod* method,
     cfg::ControlFlowGraph& cfg,
     const CandidateInstructionCoresSet& recurring_cores,
+    const MaxRootSizes& max_root_sizes,
     FindCandidatesStats* stats) {
   MethodCandidates candidates;
   Lazy<LivenessFixpointIterator> liveness_fp_iter([&cfg] {
@@ -1171,11 +1185,17 @@ static MethodCandidates find_method_candidates(
         // We cannot start a sequence at a move-result-any instruction
         continue;
       }
+      // Instructions of big blocks that cannot be outlined from have no
+      // bound; their candidates are only explored for statistics.
+      auto max_root_size_it = max_root_sizes.find(it->insn);
+      size_t max_root_size = max_root_size_it == max_root_sizes.end()
+                                 ? std::numeric_limits<size_t>::max()
+                                 : max_root_size_it->second;
       PartialCandidate pc;
       explore_candidates_from(reaching_initialized_new_instances,
                               reaching_initialized_init_first_param, config,
-                              ref_checker, recurring_cores, &pc, &pc.root, it,
-                              end, &explored_callback);
+                              ref_checker, recurring_cores, max_root_size, &pc,
+                              &pc.root, it, end, &explored_callback);
     }
   }
 
@@ -1198,6 +1218,12 @@ static bool can_outline_from_method(DexMethod* method) {
   return true;
 }
 
+// The instructions of the big blocks of a method that can be outlined from, in
+// order, where nullptr separates big blocks and takes the place of
+// instructions that cannot be outlined.
+using OutlinableSequences =
+    ConcurrentMap<DexMethod*, std::vector<IRInstruction*>>;
+
 // Gather set of recurring small (MIN_INSNS_SIZE) adjacent instruction
 // sequences that are outlinable. Note that all longer recurring outlinable
 // instruction sequences must be comprised of shorter recurring ones.
@@ -1209,14 +1235,15 @@ static void get_recurring_cores(
     const std::unordered_set<DexMethod*>& sufficiently_hot_methods,
     const RefChecker& ref_checker,
     CandidateInstructionCoresSet* recurring_cores,
-    ConcurrentMap<DexMethod*, CanOutlineBlockDecider>* block_deciders) {
+    ConcurrentMap<DexMethod*, CanOutlineBlockDecider>* block_deciders,
+    OutlinableSequences* outlinable_sequences) {
   ConcurrentMap<CandidateInstructionCores, size_t,
                 CandidateInstructionCoresHasher>
       concurrent_cores;
   walk::parallel::code(
       scope, [&config, &ref_checker, &sufficiently_warm_methods,
-              &sufficiently_hot_methods, &concurrent_cores,
-              block_deciders](DexMethod* method, IRCode& code) {
+              &sufficiently_hot_methods, &concurrent_cores, block_deciders,
+              outlinable_sequences](DexMethod* method, IRCode& code) {
         if (!can_outline_from_method(method)) {
           return;
         }
@@ -1233,6 +1260,7 @@ static void get_recurring_cores(
               reaching_initializeds::get_reaching_initializeds(
                   cfg, reaching_initializeds::Mode::FirstLoadParam);
         }
+        std::vector<IRInstruction*> sequence;
         for (auto& big_block : big_blocks::get_big_blocks(cfg)) {
           if (block_decider.can_outline_from_big_block(big_block) !=
               CanOutlineBlockDecider::Result::CanOutline) {
@@ -1244,8 +1272,10 @@ static void get_recurring_cores(
             if (!can_outline_insn(
                     ref_checker, reaching_initialized_init_first_param, insn)) {
               cores_builder.clear();
+              sequence.push_back(nullptr);
               continue;
             }
+            sequence.push_back(insn);
             cores_builder.push_back(insn);
             if (cores_builder.has_value()) {
               concurrent_cores.update(cores_builder.get_value(),
@@ -1254,8 +1284,12 @@ static void get_recurring_cores(
                                          bool /* exists */) { occurrences++; });
             }
           }
+          sequence.push_back(nullptr);
         }
         block_deciders->emplace(method, std::move(block_decider));
+        if (!sequence.empty()) {
+          outlinable_sequences->emplace(method, std::move(sequence));
+        }
       });
   size_t singleton_cores{0};
   for (auto& p : concurrent_cores) {
@@ -1294,6 +1328,60 @@ struct ReusableOutlinedMethods {
   std::vector<Candidate> order;
 };
 
+// A candidate is only beneficial if it occurs at least twice, or if it can
+// reuse an earlier outlined method; either way, the cores of the instructions
+// of its root also appear at some other position of the outlinable sequences,
+// or in the root of a reusable candidate. To bound the exploration of
+// candidates, we concatenate all of those into one string of core ids, and
+// find the longest repeated prefix at each instruction via its suffix array.
+static MaxRootSizes get_max_root_sizes(
+    PassManager& mgr,
+    const OutlinableSequences& outlinable_sequences,
+    const ReusableOutlinedMethods& outlined_methods) {
+  // Id 0 separates sequences.
+  std::unordered_map<CandidateInstructionCore, uint32_t,
+                     CandidateInstructionCoreHasher>
+      core_ids;
+  std::vector<uint32_t> text;
+  std::vector<const IRInstruction*> insns;
+  auto push_core = [&](const CandidateInstructionCore& core,
+                       const IRInstruction* insn) {
+    auto id = core_ids.emplace(core, core_ids.size() + 1).first->second;
+    text.push_back(id);
+    insns.push_back(insn);
+  };
+  auto push_separator = [&]() {
+    text.push_back(0);
+    insns.push_back(nullptr);
+  };
+  for (auto& p : outlinable_sequences) {
+    for (auto insn : p.second) {
+      if (insn == nullptr) {
+        push_separator();
+      } else {
+        push_core(to_core(insn), insn);
+      }
+    }
+  }
+  for (auto& p : outlined_methods.map) {
+    for (auto& ci : p.first.root.insns) {
+      push_core(ci.core, nullptr);
+    }
+    push_separator();
+  }
+
+  auto lengths = suffix_array::longest_repeated_prefixes(
+      text, static_cast<uint32_t>(core_ids.size() + 1));
+  MaxRootSizes max_root_sizes;
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (insns[i] != nullptr) {
+      max_root_sizes.emplace(insns[i], lengths[i]);
+    }
+  }
+  mgr.incr_metric("num_outlinable_insns", max_root_sizes.size());
+  return max_root_sizes;
+}
+
 std::unordered_set<const DexType*> get_declaring_types(
     const CandidateInfo& ci) {
   std::unordered_set<const DexType*> types;
@@ -1481,6 +1569,7 @@ static void get_beneficial_candidates(
     const Scope& scope,
     const RefChecker& ref_checker,
     const CandidateInstructionCoresSet& recurring_cores,
+    const MaxRootSizes& max_root_sizes,
     const ConcurrentMap<DexMethod*, CanOutlineBlockDecider>& block_deciders,
     const ReusableOutlinedMethods* outlined_methods,
     std::vector<CandidateWithInfo>* candidates_with_infos,
@@ -1490,14 +1579,15 @@ static void get_beneficial_candidates(
       concurrent_candidates;
   FindCandidatesStats stats;
   walk::parallel::code(scope, [&config, &ref_checker, &recurring_cores,
-                               &concurrent_candidates, &block_deciders,
+                               &max_root_sizes, &concurrent_candidates,
+                               &block_deciders,
                                &stats](DexMethod* method, IRCode& code) {
     if (!can_outline_from_method(method)) {
       return;
     }
     for (auto& p : find_method_candidates(
              config, ref_checker, block_deciders.at_unsafe(method), method,
-             code.cfg(), recurring_cores, &stats)) {
+             code.cfg(), recurring_cores, max_root_sizes, &stats)) {
       std::vector<CandidateMethodLocation>& cmls = p.second;
       concurrent_candidates.update(p.first,
                                    [method, &cmls](const Candidate&,
@@ -3096,15 +3186,22 @@ void InstructionSequenceOutliner::run_pass(DexStoresVector& stores,
       RefChecker ref_checker{&xstores, store_idx, min_sdk_api};
       CandidateInstructionCoresSet recurring_cores;
       ConcurrentMap<DexMethod*, CanOutlineBlockDecider> block_deciders;
+      OutlinableSequences outlinable_sequences;
       get_recurring_cores(m_config, mgr, dex, sufficiently_warm_methods,
                           sufficiently_hot_methods, ref_checker,
-                          &recurring_cores, &block_deciders);
+                          &recurring_cores, &block_deciders,
+                          &outlinable_sequences);
+      auto max_root_sizes =
+          get_max_root_sizes(mgr, outlinable_sequences, outlined_methods);
+      outlinable_sequences.clear();
       std::vector<CandidateWithInfo> candidates_with_infos;
       std::unordered_map<DexMethod*, std::unordered_set<CandidateId>>
           candidate_ids_by_methods;
-      get_beneficial_candidates(
-          m_config, mgr, dex, ref_checker, recurring_cores, block_deciders,
-          &outlined_methods, &candidates_with_infos, &candidate_ids_by_methods);
+      get_beneficial_candidates(m_config, mgr, dex, ref_checker,
+                                recurring_cores, max_root_sizes,
+                                block_deciders, &outlined_methods,
+                                &candidates_with_infos,
+                                &candidate_ids_by_methods);
 
       // TODO: Merge candidates that are equivalent except that one returns
       // something and the other doesn't. Affects around 1.5% of candidates.
@@ -213,20 +213,19 @@ using ArgExclusivityVector =
 // Determine whether, or to what extent, the instructions to compute arguments
 // to an invocation are exclusive to that invocation. (If not, then eliminating
 // the argument in the invocation likely won't give us expected cost savings.)
-ArgExclusivityVector get_arg_exclusivity(const UseDefChains& use_def_chains,
-                                         const DefUseChains& def_use_chains,
+ArgExclusivityVector get_arg_exclusivity(const FlatChains& chains,
                                          bool needs_range,
                                          IRInstruction* insn) {
   ArgExclusivityVector aev;
   for (param_index_t src_idx = 0; src_idx < insn->srcs_size(); src_idx++) {
-    const auto& defs = use_def_chains.at((Use){insn, src_idx});
+    const auto& defs = chains.get_defs(insn, src_idx);
     if (defs.size() != 1) {
       continue;
     }
     const auto def = *defs.begin();
     bool other_use = false;
     param_index_t count = 0;
-    for (const auto& use : def_use_chains.at(def)) {
+    for (const auto& use : chains.get_uses(def)) {
       if (!opcode::is_a_move(use.insn->opcode()) &&
           (use.insn->opcode() != insn->opcode() ||
            use.insn->get_method() != insn->get_method())) {
@@ -280,8 +279,10 @@ void gather_caller_callees(
         profile_guidance_config, sufficiently_warm_methods.count(caller),
         sufficiently_hot_methods.count(caller));
     MoveAwareChains move_aware_chains(code.cfg());
-    const auto use_def_chains = move_aware_chains.get_use_def_chains();
-    const auto def_use_chains = move_aware_chains.get_def_use_chains();
+    const auto chains = move_aware_chains.get_flat_chains();
+    // Aggregate the occurrences of this caller first, so that the shared maps
+    // are only updated once per (caller, callee) pair, not once per invoke.
+    std::unordered_map<DexMethod*, size_t> callees;
     for (auto& big_block : big_blocks::get_big_blocks(code.cfg())) {
       auto can_outline = block_decider.can_outline_from_big_block(big_block) ==
                          CanOutlineBlockDecider::Result::CanOutline;
@@ -296,30 +297,31 @@ void gather_caller_callees(
           continue;
         }
         auto needs_range = analyze_args(callee).second;
-        auto ae = get_arg_exclusivity(use_def_chains, def_use_chains,
-                                      needs_range, insn);
+        auto ae = get_arg_exclusivity(chains, needs_range, insn);
         if (ae.empty()) {
           concurrent_excluded_invoke_insns.insert(insn);
           continue;
         }
-        concurrent_callee_caller.update(
-            callee,
-            [caller](const DexMethod*,
-                     std::unordered_map<DexMethod*, size_t>& v,
-                     bool) { ++v[caller]; });
-        concurrent_caller_callee.update(
-            caller,
-            [callee](const DexMethod*,
-                     std::unordered_map<DexMethod*, size_t>& v,
-                     bool) { ++v[callee]; });
+        ++callees[callee];
         concurrent_arg_exclusivity.emplace(insn, std::move(ae));
-        concurrent_callee_caller_classes.update(
-            callee,
-            [caller](const DexMethod*,
-                     std::unordered_set<const DexType*>& value,
-                     bool) { value.insert(caller->get_class()); });
       }
     }
+    if (callees.empty()) {
+      return;
+    }
+    for (auto& [callee, count] : callees) {
+      concurrent_callee_caller.update(
+          callee,
+          [caller, count = count](const DexMethod*,
+                                  std::unordered_map<DexMethod*, size_t>& v,
+                                  bool) { v[caller] += count; });
+      concurrent_callee_caller_classes.update(
+          callee,
+          [caller](const DexMethod*,
+                   std::unordered_set<const DexType*>& value,
+                   bool) { value.insert(caller->get_class()); });
+    }
+    concurrent_caller_callee.emplace(caller, std::move(callees));
   });
 
   for (auto& p : concurrent_callee_caller) {
@@ -8,9 +8,12 @@
 #include "Peephole.h"
 
 #include <algorithm>
+#include <atomic>
+#include <bitset>
 #include <cinttypes>
 #include <cmath>
 #include <iostream>
+#include <mutex>
 #include <numeric>
 #include <unordered_map>
 #include <unordered_set>
@@ -25,8 +28,8 @@
 #include "IRInstruction.h"
 #include "PassManager.h"
 #include "RedundantCheckCastRemover.h"
+#include "ScopedCFG.h"
 #include "Show.h"
-#include "SpartaWorkQueue.h"
 #include "Trace.h"
 #include "Walkers.h"
 
@@ -157,8 +160,28 @@ static const char* LjavaString = "Ljava/lang/String;";
 static const char* LjavaStringBuilder = "Ljava/lang/StringBuilder;";
 static const char* LjavaObject = "Ljava/lang/Object;";
 
+// One past the largest IROpcode.
+constexpr size_t kNumIROpcodes = 0
+#define OP(...) +1
+#define IOP(...) +1
+#define OPRANGE(...)
+#include "IROpcodes.def"
+    ;
+
+using OpcodeBits = std::bitset<kNumIROpcodes>;
+
+OpcodeBits to_opcode_bits(const std::unordered_set<uint16_t>& opcodes) {
+  OpcodeBits bits;
+  for (auto op : opcodes) {
+    bits.set(op);
+  }
+  return bits;
+}
+
 struct DexPattern {
   const std::unordered_set<uint16_t> opcodes;
+  // The same opcodes, which matching tests with a table lookup.
+  const OpcodeBits opcode_bits;
   const std::vector<Register> srcs;
   const std::vector<Register> dests;
 
@@ -186,6 +209,7 @@ struct DexPattern {
              std::vector<Register>&& srcs,
              std::vector<Register>&& dests)
       : opcodes(std::move(opcodes)),
+        opcode_bits(to_opcode_bits(this->opcodes)),
         srcs(std::move(srcs)),
         dests(std::move(dests)),
         kind(DexPattern::Kind::none),
@@ -196,6 +220,7 @@ struct DexPattern {
              std::vector<Register>&& dests,
              DexMethodRef* const method)
       : opcodes(std::move(opcodes)),
+        opcode_bits(to_opcode_bits(this->opcodes)),
         srcs(std::move(srcs)),
         dests(std::move(dests)),
         kind(DexPattern::Kind::method),
@@ -206,6 +231,7 @@ struct DexPattern {
              std::vector<Register>&& dests,
              const String string)
       : opcodes(std::move(opcodes)),
+        opcode_bits(to_opcode_bits(this->opcodes)),
         srcs(std::move(srcs)),
         dests(std::move(dests)),
         kind(DexPattern::Kind::string),
@@ -216,6 +242,7 @@ struct DexPattern {
              std::vector<Register>&& dests,
              const Literal literal)
       : opcodes(std::move(opcodes)),
+        opcode_bits(to_opcode_bits(this->opcodes)),
         srcs(std::move(srcs)),
         dests(std::move(dests)),
         kind(DexPattern::Kind::literal),
@@ -226,6 +253,7 @@ struct DexPattern {
              std::vector<Register>&& dests,
              const Type type)
       : opcodes(std::move(opcodes)),
+        opcode_bits(to_opcode_bits(this->opcodes)),
         srcs(std::move(srcs)),
         dests(std::move(dests)),
         kind(DexPattern::Kind::type),
@@ -236,6 +264,7 @@ struct DexPattern {
              std::vector<Register>&& dests,
              const Field field)
       : opcodes(std::move(opcodes)),
+        opcode_bits(to_opcode_bits(this->opcodes)),
         srcs(std::move(srcs)),
         dests(std::move(dests)),
         kind(DexPattern::Kind::field),
@@ -341,8 +370,7 @@ struct Matcher {
 
     // Does 'insn' match to the given DexPattern?
     auto match_instruction = [&](const DexPattern& dex_pattern) {
-      if (dex_pattern.opcodes.find(insn->opcode()) ==
-              end(dex_pattern.opcodes) ||
+      if (!dex_pattern.opcode_bits.test(insn->opcode()) ||
           dex_pattern.srcs.size() != insn->srcs_size() ||
           dex_pattern.dests.size() != insn->has_dest()) {
         return false;
@@ -381,6 +409,12 @@ struct Matcher {
     };
 
     redex_assert(match_index < pattern.match.size());
+    // Most instructions cannot start a match, and there is no state to reset
+    // before the first one.
+    if (match_index == 0 &&
+        !pattern.match[0].opcode_bits.test(insn->opcode())) {
+      return false;
+    }
     if (!match_instruction(pattern.match[match_index])) {
       // Okay, this is the PG's heuristic. Retry only if the failure occurs on
       // the second opcode of the pattern.
@@ -1730,9 +1764,8 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
   PeepholeOptimizer& operator=(const PeepholeOptimizer&) = delete;
 
   void peephole(DexMethod* method) {
-    auto code = method->get_code();
-    code->build_cfg(/* editable */ true);
-    auto& cfg = code->cfg();
+    cfg::ScopedCFG scoped_cfg(method->get_code());
+    auto& cfg = *scoped_cfg;
 
     // do optimizations one at a time
     // so they can match on the same pattern without interfering
@@ -1795,8 +1828,6 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
       // Apply the mutator.
       mutator.flush();
     }
-
-    code->clear_cfg();
   }
 
   void print_stats() {
@@ -1823,61 +1854,85 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
     }
   }
 
-  void run_method(DexMethod* m) {
-    if (m->get_code()) {
-      peephole(m);
-    }
-  }
-
   void incr_all_metrics() {
     for (size_t i = 0; i < m_matchers.size(); i++) {
       m_mgr.incr_metric(m_matchers[i].pattern.name, m_stats[i]);
     }
   }
 };
-} // namespace
 
-void PeepholePass::run_pass(DexStoresVector& stores,
-                            ConfigFiles& /*cfg*/,
-                            PassManager& mgr) {
-  auto scope = build_class_scope(stores);
-  auto num_threads = redex_parallel::default_num_threads();
-  std::vector<std::unique_ptr<PeepholeOptimizer>> peephole_optimizers;
-  const std::vector<std::vector<Pattern>> pats = patterns::get_all_patterns();
-  for (size_t i = 0; i < num_threads; ++i) {
-    peephole_optimizers.emplace_back(std::make_unique<PeepholeOptimizer>(
-        mgr, pats, config.disabled_peepholes));
+class PeepholeRun : public MethodPass::Run {
+ public:
+  PeepholeRun(PassManager& mgr, const std::vector<std::string>& disabled)
+      : m_mgr(mgr),
+        m_patterns(patterns::get_all_patterns()),
+        m_disabled_peepholes(disabled),
+        m_remove_check_casts(
+            !contains(disabled, RedundantCheckCastRemover::get_name())) {}
+
+  // Removing redundant check-casts works on the linear code.
+  bool uses_editable_cfg() const override { return !m_remove_check_casts; }
+
+  void run_on_method(DexMethod* method, IRCode& /* code */) override {
+    auto* ph = acquire_optimizer();
+    ph->peephole(method);
+    release_optimizer(ph);
+    if (m_remove_check_casts) {
+      m_check_casts_removed += RedundantCheckCastRemover::run(method);
+    }
   }
 
-  workqueue_run<DexClass*>(
-      [&peephole_optimizers](sparta::SpartaWorkerState<DexClass*>* state,
-                             DexClass* cls) {
-        auto& ph = peephole_optimizers[state->worker_id()];
-        for (const auto& m : cls->get_dmethods()) {
-          TraceContext context(m);
-          ph->run_method(m);
-        }
-        for (const auto& m : cls->get_vmethods()) {
-          TraceContext context(m);
-          ph->run_method(m);
-        }
-      },
-      scope,
-      num_threads);
+  void finish(PassManager& mgr) override {
+    for (auto& ph : m_optimizers) {
+      ph->incr_all_metrics();
+    }
 
-  for (size_t i = 0; i < num_threads; ++i) {
-    peephole_optimizers[i]->incr_all_metrics();
+    if (m_remove_check_casts) {
+      mgr.incr_metric("redundant_check_casts_removed", m_check_casts_removed);
+    } else {
+      TRACE(PEEPHOLE,
+            2,
+            "not running disabled peephole opt %s",
+            RedundantCheckCastRemover::get_name().c_str());
+    }
   }
 
-  if (!contains<std::string>(config.disabled_peepholes,
-                             RedundantCheckCastRemover::get_name())) {
-    RedundantCheckCastRemover(mgr, scope).run();
-  } else {
-    TRACE(PEEPHOLE,
-          2,
-          "not running disabled peephole opt %s",
-          RedundantCheckCastRemover::get_name().c_str());
+ private:
+  // An optimizer holds matching state, so each thread needs its own. They
+  // are created on demand, so there are at most as many as threads.
+  PeepholeOptimizer* acquire_optimizer() {
+    std::lock_guard<std::mutex> lock(m_optimizers_mutex);
+    if (m_idle_optimizers.empty()) {
+      m_optimizers.emplace_back(std::make_unique<PeepholeOptimizer>(
+          m_mgr, m_patterns, m_disabled_peepholes));
+      return m_optimizers.back().get();
+    }
+    auto* ph = m_idle_optimizers.back();
+    m_idle_optimizers.pop_back();
+    return ph;
   }
+
+  void release_optimizer(PeepholeOptimizer* ph) {
+    std::lock_guard<std::mutex> lock(m_optimizers_mutex);
+    m_idle_optimizers.push_back(ph);
+  }
+
+  PassManager& m_mgr;
+  const std::vector<std::vector<Pattern>> m_patterns;
+  const std::vector<std::string> m_disabled_peepholes;
+  const bool m_remove_check_casts;
+  std::atomic<size_t> m_check_casts_removed{0};
+
+  std::mutex m_optimizers_mutex;
+  std::vector<std::unique_ptr<PeepholeOptimizer>> m_optimizers;
+  std::vector<PeepholeOptimizer*> m_idle_optimizers;
+};
+
+} // namespace
+
+std::unique_ptr<MethodPass::Run> PeepholePass::prepare(
+    DexStoresVector& /* stores */, ConfigFiles& /* cfg */, PassManager& mgr) {
+  return std::make_unique<PeepholeRun>(mgr, config.disabled_peepholes);
 }
 
 static PeepholePass s_pass;
@@ -10,11 +10,13 @@
 #include "Pass.h"
 #include <vector>
 
-class PeepholePass : public Pass {
+class PeepholePass : public MethodPass {
  public:
-  PeepholePass() : Pass("PeepholePass") {}
+  PeepholePass() : MethodPass("PeepholePass") {}
 
-  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  std::unique_ptr<Run> prepare(DexStoresVector&,
+                               ConfigFiles&,
+                               PassManager&) override;
 
   void bind_config() override {
     bind("disabled_peepholes", {}, config.disabled_peepholes);
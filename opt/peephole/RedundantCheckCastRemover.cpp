@@ -7,32 +7,23 @@
 
 #include "RedundantCheckCastRemover.h"
 
-#include <unordered_map>
-
 #include "DexClass.h"
 #include "DexUtil.h"
 #include "IRCode.h"
 #include "Match.h"
-#include "PassManager.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
 
-RedundantCheckCastRemover::RedundantCheckCastRemover(
-    PassManager& mgr, const std::vector<DexClass*>& scope)
-    : m_mgr(mgr), m_scope(scope) {}
-
-void RedundantCheckCastRemover::run() {
+size_t RedundantCheckCastRemover::run(DexMethod* method) {
   auto match = std::make_tuple(m::an_invoke(),
                                m::move_result_object_(),
                                m::check_cast_(),
                                m::move_result_pseudo_object_());
 
-  std::unordered_map<DexMethod*, std::vector<IRInstruction*>> to_remove;
-
-  std::atomic<uint32_t> num_check_casts_removed(0);
-  walk::parallel::matching_opcodes_in_block(
-      m_scope,
+  size_t num_check_casts_removed = 0;
+  walk::matching_opcodes_in_block(
+      *method,
       match,
       [&num_check_casts_removed](DexMethod* method,
                                  cfg::Block*,
@@ -48,8 +39,7 @@ void RedundantCheckCastRemover::run() {
           }
         }
       });
-
-  m_mgr.incr_metric("redundant_check_casts_removed", num_check_casts_removed);
+  return num_check_casts_removed;
 }
 
 bool RedundantCheckCastRemover::can_remove_check_cast(
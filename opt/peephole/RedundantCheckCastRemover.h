@@ -10,9 +10,8 @@
 #include <string>
 #include <vector>
 
-class DexClass;
+class DexMethod;
 class IRInstruction;
-class PassManager;
 
 class RedundantCheckCastRemover {
  public:
@@ -21,13 +20,10 @@ class RedundantCheckCastRemover {
     return name;
   }
 
-  explicit RedundantCheckCastRemover(PassManager& mgr,
-                                     const std::vector<DexClass*>& scope);
-  void run();
+  // Removes the check-casts of the result of an invoke to its return type
+  // from `method`, and returns how many it removed.
+  static size_t run(DexMethod* method);
 
  private:
   static bool can_remove_check_cast(const std::vector<IRInstruction*>&);
-
-  PassManager& m_mgr;
-  const std::vector<DexClass*>& m_scope;
 };
@@ -18,6 +18,7 @@
 #include "IRCode.h"
 #include "IRInstruction.h"
 #include "InterDexPass.h"
+#include "MethodUtil.h"
 #include "PassManager.h"
 #include "PatriciaTreeMap.h"
 #include "PatriciaTreeMapAbstractEnvironment.h"
@@ -683,6 +684,11 @@ void ReduceArrayLiteralsPass::run_pass(DexStoresVector& stores,
         if (code == nullptr || m->rstate.no_optimizations()) {
           return ReduceArrayLiterals::Stats();
         }
+        if (!method::any_insn(*code, [](const IRInstruction* insn) {
+              return insn->opcode() == OPCODE_NEW_ARRAY;
+            })) {
+          return ReduceArrayLiterals::Stats();
+        }
 
         code->build_cfg(/* editable */ true);
         ReduceArrayLiterals ral(code->cfg(), m_max_filled_elements, min_sdk,
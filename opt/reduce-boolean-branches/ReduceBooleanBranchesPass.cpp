@@ -12,6 +12,7 @@
 #include "LocalDce.h"
 #include "PassManager.h"
 #include "Purity.h"
+#include "ScopedCFG.h"
 #include "Trace.h"
 #include "Walkers.h"
 
@@ -25,64 +26,85 @@ constexpr const char* METRIC_XORS_REDUCED = "num_xors_reduced";
 
 } // namespace
 
-void ReduceBooleanBranchesPass::run_pass(DexStoresVector& stores,
-                                         ConfigFiles& /* unused */,
-                                         PassManager& mgr) {
-  std::unique_ptr<ab_test::ABExperimentContext> experiment =
-      ab_test::ABExperimentContext::create("reduce_boolean_branches");
+namespace {
+
+class ReduceBooleanBranchesRun
+    : public MethodPass::AccumulatingRun<reduce_boolean_branches_impl::Stats> {
+ public:
+  using Stats = reduce_boolean_branches_impl::Stats;
+
+  ReduceBooleanBranchesRun(
+      const reduce_boolean_branches_impl::Config& config,
+      std::unique_ptr<ab_test::ABExperimentContext> experiment)
+      : m_config(config),
+        m_experiment(std::move(experiment)),
+        m_pure_methods(get_pure_methods()) {
+    m_copy_prop_config.eliminate_const_classes = false;
+    m_copy_prop_config.eliminate_const_strings = false;
+    m_copy_prop_config.static_finals = false;
+  }
+
+  bool uses_editable_cfg() const override { return true; }
+
+  Stats visit(DexMethod* method, IRCode& code) override {
+    if (m_experiment->use_control()) {
+      return Stats{};
+    }
+
+    cfg::ScopedCFG cfg(&code);
+    std::function<void()> on_change = [this, method]() {
+      m_experiment->try_register_method(method);
+    };
 
-  if (experiment->use_control()) {
-    return;
+    reduce_boolean_branches_impl::ReduceBooleanBranches rbb(
+        m_config, is_static(method), method->get_proto()->get_args(), &code,
+        &on_change);
+    while (rbb.run()) {
+      // clean up
+      copy_propagation_impl::CopyPropagation copy_propagation(
+          m_copy_prop_config);
+      copy_propagation.run(&code, method);
+      LocalDce(/* init_classes_with_side_effects */ nullptr, m_pure_methods)
+          .dce(&code);
+    }
+    return rbb.get_stats();
   }
 
-  auto scope = build_class_scope(stores);
-
-  copy_propagation_impl::Config copy_prop_config;
-  copy_prop_config.eliminate_const_classes = false;
-  copy_prop_config.eliminate_const_strings = false;
-  copy_prop_config.static_finals = false;
-  auto pure_methods = get_pure_methods();
-  auto stats = walk::parallel::methods<reduce_boolean_branches_impl::Stats>(
-      scope, [&config = m_config, &copy_prop_config, &pure_methods,
-              &experiment](DexMethod* method) {
-        const auto code = method->get_code();
-        if (!code) {
-          return reduce_boolean_branches_impl::Stats{};
-        }
-
-        code->build_cfg(/* editable */ true);
-        std::function<void()> on_change = [&experiment, method]() {
-          experiment->try_register_method(method);
-        };
-
-        reduce_boolean_branches_impl::ReduceBooleanBranches rbb(
-            config, is_static(method), method->get_proto()->get_args(), code,
-            &on_change);
-        while (rbb.run()) {
-          // clean up
-          copy_propagation_impl::CopyPropagation copy_propagation(
-              copy_prop_config);
-          copy_propagation.run(code, method);
-          LocalDce(/* init_classes_with_side_effects */ nullptr, pure_methods)
-              .dce(code);
-        }
-
-        code->clear_cfg();
-        return rbb.get_stats();
-      });
-
-  experiment->flush();
-
-  mgr.incr_metric(METRIC_BOOLEAN_BRANCHES_REMOVED,
-                  stats.boolean_branches_removed);
-  mgr.incr_metric(METRIC_OBJECT_BRANCHES_REMOVED,
-                  stats.object_branches_removed);
-  mgr.incr_metric(METRIC_XORS_REDUCED, stats.xors_reduced);
-  TRACE(RBB, 1,
-        "[reduce boolean branches] Removed %zu boolean branches, %zu object "
-        "branches, reduced %zu xors",
-        stats.boolean_branches_removed, stats.object_branches_removed,
-        stats.xors_reduced);
+  void report(PassManager& mgr, const Stats& stats) override {
+    if (m_experiment->use_control()) {
+      return;
+    }
+
+    m_experiment->flush();
+
+    mgr.incr_metric(METRIC_BOOLEAN_BRANCHES_REMOVED,
+                    stats.boolean_branches_removed);
+    mgr.incr_metric(METRIC_OBJECT_BRANCHES_REMOVED,
+                    stats.object_branches_removed);
+    mgr.incr_metric(METRIC_XORS_REDUCED, stats.xors_reduced);
+    TRACE(RBB, 1,
+          "[reduce boolean branches] Removed %zu boolean branches, %zu object "
+          "branches, reduced %zu xors",
+          stats.boolean_branches_removed, stats.object_branches_removed,
+          stats.xors_reduced);
+  }
+
+ private:
+  const reduce_boolean_branches_impl::Config& m_config;
+  std::unique_ptr<ab_test::ABExperimentContext> m_experiment;
+  copy_propagation_impl::Config m_copy_prop_config;
+  std::unordered_set<DexMethodRef*> m_pure_methods;
+};
+
+} // namespace
+
+std::unique_ptr<MethodPass::Run> ReduceBooleanBranchesPass::prepare(
+    DexStoresVector& /* stores */,
+    ConfigFiles& /* unused */,
+    PassManager& /* mgr */) {
+  return std::make_unique<ReduceBooleanBranchesRun>(
+      m_config,
+      ab_test::ABExperimentContext::create("reduce_boolean_branches"));
 }
 
 static ReduceBooleanBranchesPass s_pass;
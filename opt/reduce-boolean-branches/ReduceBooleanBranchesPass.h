@@ -10,10 +10,14 @@
 #include "Pass.h"
 #include "ReduceBooleanBranches.h"
 
-class ReduceBooleanBranchesPass : public Pass {
+class ReduceBooleanBranchesPass : public MethodPass {
  public:
-  ReduceBooleanBranchesPass() : Pass("ReduceBooleanBranchesPass") {}
-  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  ReduceBooleanBranchesPass() : MethodPass("ReduceBooleanBranchesPass") {}
+  std::unique_ptr<Run> prepare(DexStoresVector&,
+                               ConfigFiles&,
+                               PassManager&) override;
+
+  bool is_cfg_legal() const override { return true; }
 
  private:
   reduce_boolean_branches_impl::Config m_config;
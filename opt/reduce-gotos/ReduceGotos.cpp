@@ -33,6 +33,7 @@
 #include "IRInstruction.h"
 #include "IROpcode.h"
 #include "Liveness.h"
+#include "MethodResultCache.h"
 #include "PassManager.h"
 #include "Show.h"
 #include "Trace.h"
@@ -62,6 +63,59 @@ constexpr const char* METRIC_INVERTED_CONDITIONAL_BRANCHES =
 constexpr const char* METRIC_NUM_GOTOS_REPLACED_WITH_THROWS =
     "num_gotos_replaced_with_throws";
 
+// Bump when the pass changes how it transforms code, to invalidate the results
+// cached by previous versions.
+constexpr const char* kCacheVersion = "1";
+
+Json::Value stats_to_json(const ReduceGotosPass::Stats& stats) {
+  Json::Value json;
+  json["removed_switches"] = Json::UInt64(stats.removed_switches);
+  json["reduced_switches"] = Json::UInt64(stats.reduced_switches);
+  json["replaced_trivial_switches"] =
+      Json::UInt64(stats.replaced_trivial_switches);
+  json["remaining_trivial_switches"] =
+      Json::UInt64(stats.remaining_trivial_switches);
+  json["remaining_two_case_switches"] =
+      Json::UInt64(stats.remaining_two_case_switches);
+  json["remaining_range_switches"] =
+      Json::UInt64(stats.remaining_range_switches);
+  json["remaining_range_switch_cases"] =
+      Json::UInt64(stats.remaining_range_switch_cases);
+  json["removed_switch_cases"] = Json::UInt64(stats.removed_switch_cases);
+  json["replaced_gotos_with_returns"] =
+      Json::UInt64(stats.replaced_gotos_with_returns);
+  json["removed_trailing_moves"] = Json::UInt64(stats.removed_trailing_moves);
+  json["inverted_conditional_branches"] =
+      Json::UInt64(stats.inverted_conditional_branches);
+  json["replaced_gotos_with_throws"] =
+      Json::UInt64(stats.replaced_gotos_with_throws);
+  return json;
+}
+
+ReduceGotosPass::Stats stats_from_json(const Json::Value& json) {
+  ReduceGotosPass::Stats stats;
+  stats.removed_switches = json["removed_switches"].asUInt64();
+  stats.reduced_switches = json["reduced_switches"].asUInt64();
+  stats.replaced_trivial_switches =
+      json["replaced_trivial_switches"].asUInt64();
+  stats.remaining_trivial_switches =
+      json["remaining_trivial_switches"].asUInt64();
+  stats.remaining_two_case_switches =
+      json["remaining_two_case_switches"].asUInt64();
+  stats.remaining_range_switches = json["remaining_range_switches"].asUInt64();
+  stats.remaining_range_switch_cases =
+      json["remaining_range_switch_cases"].asUInt64();
+  stats.removed_switch_cases = json["removed_switch_cases"].asUInt64();
+  stats.replaced_gotos_with_returns =
+      json["replaced_gotos_with_returns"].asUInt64();
+  stats.removed_trailing_moves = json["removed_trailing_moves"].asUInt64();
+  stats.inverted_conditional_branches =
+      json["inverted_conditional_branches"].asUInt64();
+  stats.replaced_gotos_with_throws =
+      json["replaced_gotos_with_throws"].asUInt64();
+  return stats;
+}
+
 } // namespace
 
 void ReduceGotosPass::shift_registers(cfg::ControlFlowGraph* cfg, reg_t* reg) {
@@ -491,18 +545,29 @@ ReduceGotosPass::Stats ReduceGotosPass::process_code(IRCode* code) {
   return stats;
 }
 
-void ReduceGotosPass::run_pass(DexStoresVector& stores,
-                               ConfigFiles& /* unused */,
-                               PassManager& mgr) {
-  auto scope = build_class_scope(stores);
+namespace {
+
+class ReduceGotosRun
+    : public MethodPass::AccumulatingRun<ReduceGotosPass::Stats> {
+ public:
+  using Stats = ReduceGotosPass::Stats;
+
+  explicit ReduceGotosRun(std::unique_ptr<MethodResultCache> cache)
+      : m_cache(std::move(cache)) {}
 
-  Stats stats = walk::parallel::methods<Stats>(scope, [](DexMethod* method) {
-    const auto code = method->get_code();
-    if (!code) {
-      return Stats{};
+  Stats visit(DexMethod* method, IRCode& code) override {
+    auto cache_key = m_cache ? m_cache->key(method)
+                             : boost::optional<std::string>(boost::none);
+    if (cache_key) {
+      if (auto cached = m_cache->replay(*cache_key, method)) {
+        return stats_from_json(*cached);
+      }
     }
 
-    Stats stats = ReduceGotosPass::process_code(code);
+    Stats stats = ReduceGotosPass::process_code(&code);
+    if (cache_key) {
+      m_cache->record(*cache_key, &code, stats_to_json(stats));
+    }
     if (stats.replaced_gotos_with_returns ||
         stats.inverted_conditional_branches) {
       TRACE(RG, 3,
@@ -513,32 +578,51 @@ void ReduceGotosPass::run_pass(DexStoresVector& stores,
             stats.inverted_conditional_branches, SHOW(method));
     }
     return stats;
-  });
-
-  mgr.incr_metric(METRIC_REMOVED_SWITCHES, stats.removed_switches);
-  mgr.incr_metric(METRIC_REDUCED_SWITCHES, stats.reduced_switches);
-  mgr.incr_metric(METRIC_REMAINING_TRIVIAL_SWITCHES,
-                  stats.remaining_trivial_switches);
-  mgr.incr_metric(METRIC_REPLACED_TRIVIAL_SWITCHES,
-                  stats.replaced_trivial_switches);
-  mgr.incr_metric(METRIC_REMAINING_RANGE_SWITCHES,
-                  stats.remaining_range_switches);
-  mgr.incr_metric(METRIC_REMAINING_RANGE_SWITCH_CASES,
-                  stats.remaining_range_switch_cases);
-  mgr.incr_metric(METRIC_REMAINING_TWO_CASE_SWITCHES,
-                  stats.remaining_two_case_switches);
-  mgr.incr_metric(METRIC_REMOVED_SWITCH_CASES, stats.removed_switch_cases);
-  mgr.incr_metric(METRIC_GOTOS_REPLACED_WITH_RETURNS,
-                  stats.replaced_gotos_with_returns);
-  mgr.incr_metric(METRIC_TRAILING_MOVES_REMOVED, stats.removed_trailing_moves);
-  mgr.incr_metric(METRIC_INVERTED_CONDITIONAL_BRANCHES,
-                  stats.inverted_conditional_branches);
-  mgr.incr_metric(METRIC_NUM_GOTOS_REPLACED_WITH_THROWS,
-                  stats.replaced_gotos_with_throws);
-  TRACE(RG, 1,
-        "[reduce gotos] Replaced %zu gotos with returns, inverted %zu "
-        "conditional brnaches in total",
-        stats.replaced_gotos_with_returns, stats.inverted_conditional_branches);
+  }
+
+  void report(PassManager& mgr, const Stats& stats) override {
+    if (m_cache) {
+      m_cache->report_metrics(mgr);
+    }
+
+    mgr.incr_metric(METRIC_REMOVED_SWITCHES, stats.removed_switches);
+    mgr.incr_metric(METRIC_REDUCED_SWITCHES, stats.reduced_switches);
+    mgr.incr_metric(METRIC_REMAINING_TRIVIAL_SWITCHES,
+                    stats.remaining_trivial_switches);
+    mgr.incr_metric(METRIC_REPLACED_TRIVIAL_SWITCHES,
+                    stats.replaced_trivial_switches);
+    mgr.incr_metric(METRIC_REMAINING_RANGE_SWITCHES,
+                    stats.remaining_range_switches);
+    mgr.incr_metric(METRIC_REMAINING_RANGE_SWITCH_CASES,
+                    stats.remaining_range_switch_cases);
+    mgr.incr_metric(METRIC_REMAINING_TWO_CASE_SWITCHES,
+                    stats.remaining_two_case_switches);
+    mgr.incr_metric(METRIC_REMOVED_SWITCH_CASES, stats.removed_switch_cases);
+    mgr.incr_metric(METRIC_GOTOS_REPLACED_WITH_RETURNS,
+                    stats.replaced_gotos_with_returns);
+    mgr.incr_metric(METRIC_TRAILING_MOVES_REMOVED,
+                    stats.removed_trailing_moves);
+    mgr.incr_metric(METRIC_INVERTED_CONDITIONAL_BRANCHES,
+                    stats.inverted_conditional_branches);
+    mgr.incr_metric(METRIC_NUM_GOTOS_REPLACED_WITH_THROWS,
+                    stats.replaced_gotos_with_throws);
+    TRACE(RG, 1,
+          "[reduce gotos] Replaced %zu gotos with returns, inverted %zu "
+          "conditional brnaches in total",
+          stats.replaced_gotos_with_returns,
+          stats.inverted_conditional_branches);
+  }
+
+ private:
+  std::unique_ptr<MethodResultCache> m_cache;
+};
+
+} // namespace
+
+std::unique_ptr<MethodPass::Run> ReduceGotosPass::prepare(
+    DexStoresVector& /* stores */, ConfigFiles& conf, PassManager& /* mgr */) {
+  return std::make_unique<ReduceGotosRun>(
+      MethodResultCache::create(conf, name(), kCacheVersion));
 }
 
 ReduceGotosPass::Stats& ReduceGotosPass::Stats::operator+=(
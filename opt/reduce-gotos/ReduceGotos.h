@@ -13,7 +13,7 @@ namespace cfg {
 class ControlFlowGraph;
 } // namespace cfg
 
-class ReduceGotosPass : public Pass {
+class ReduceGotosPass : public MethodPass {
  public:
   struct Stats {
     size_t removed_switches{0};
@@ -32,9 +32,11 @@ class ReduceGotosPass : public Pass {
     Stats& operator+=(const Stats&);
   };
 
-  ReduceGotosPass() : Pass("ReduceGotosPass") {}
+  ReduceGotosPass() : MethodPass("ReduceGotosPass") {}
 
-  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  std::unique_ptr<Run> prepare(DexStoresVector&,
+                               ConfigFiles&,
+                               PassManager&) override;
 
   static Stats process_code(IRCode*);
   static void process_code_switches(cfg::ControlFlowGraph&, Stats&);
@@ -10,6 +10,7 @@
 #include "Debug.h"
 #include "DexUtil.h"
 #include "GraphColoring.h"
+#include "MethodResultCache.h"
 #include "PassManager.h"
 #include "RegisterAllocation.h"
 #include "Trace.h"
@@ -19,25 +20,106 @@ namespace regalloc {
 
 using Stats = graph_coloring::Allocator::Stats;
 
+namespace {
+
+// Bump when the allocator changes how it allocates or which stats it records,
+// to invalidate the results cached by previous versions.
+constexpr const char* kCacheVersion = "2";
+
+Json::Value stats_to_json(const Stats& stats) {
+  Json::Value json;
+  json["reiteration_count"] = Json::UInt64(stats.reiteration_count);
+  json["reiterated_methods"] = Json::UInt64(stats.reiterated_methods);
+  json["max_reiteration_count"] = Json::UInt64(stats.max_reiteration_count);
+  json["param_spill_moves"] = Json::UInt64(stats.param_spill_moves);
+  json["range_spill_moves"] = Json::UInt64(stats.range_spill_moves);
+  json["global_spill_moves"] = Json::UInt64(stats.global_spill_moves);
+  json["split_moves"] = Json::UInt64(stats.split_moves);
+  json["moves_coalesced"] = Json::UInt64(stats.moves_coalesced);
+  json["params_spill_early"] = Json::UInt64(stats.params_spill_early);
+  json["linear_scan_methods"] = Json::UInt64(stats.linear_scan_methods);
+  json["linear_scan_moves"] = Json::UInt64(stats.linear_scan_moves);
+  json["linear_scan_code_units"] = Json::UInt64(stats.linear_scan_code_units);
+  json["graph_coloring_code_units"] =
+      Json::UInt64(stats.graph_coloring_code_units);
+  return json;
+}
+
+Stats stats_from_json(const Json::Value& json) {
+  Stats stats;
+  stats.reiteration_count = json["reiteration_count"].asUInt64();
+  stats.reiterated_methods = json["reiterated_methods"].asUInt64();
+  stats.max_reiteration_count = json["max_reiteration_count"].asUInt64();
+  stats.param_spill_moves = json["param_spill_moves"].asUInt64();
+  stats.range_spill_moves = json["range_spill_moves"].asUInt64();
+  stats.global_spill_moves = json["global_spill_moves"].asUInt64();
+  stats.split_moves = json["split_moves"].asUInt64();
+  stats.moves_coalesced = json["moves_coalesced"].asUInt64();
+  stats.params_spill_early = json["params_spill_early"].asUInt64();
+  stats.linear_scan_methods = json["linear_scan_methods"].asUInt64();
+  stats.linear_scan_moves = json["linear_scan_moves"].asUInt64();
+  stats.linear_scan_code_units = json["linear_scan_code_units"].asUInt64();
+  stats.graph_coloring_code_units =
+      json["graph_coloring_code_units"].asUInt64();
+  return stats;
+}
+
+} // namespace
+
 void RegAllocPass::eval_pass(DexStoresVector&, ConfigFiles&, PassManager&) {
   ++m_eval;
 }
 
 void RegAllocPass::run_pass(DexStoresVector& stores,
-                            ConfigFiles&,
+                            ConfigFiles& conf,
                             PassManager& mgr) {
   graph_coloring::Allocator::Config allocator_config;
   const auto& jw = mgr.get_current_pass_info()->config;
   jw.get("live_range_splitting", false, allocator_config.use_splitting);
+  jw.get("bit_vector_liveness", false,
+         allocator_config.use_bit_vector_liveness);
+  jw.get("linear_scan_threshold", 0, allocator_config.linear_scan_threshold);
+  jw.get("measure_linear_scan", false, allocator_config.measure_linear_scan);
   allocator_config.no_overwrite_this =
       mgr.get_redex_options().no_overwrite_this();
 
+  auto cache = MethodResultCache::create(
+      conf, name(),
+      std::string(kCacheVersion) +
+          ";use_splitting=" + std::to_string(allocator_config.use_splitting) +
+          ";no_overwrite_this=" +
+          std::to_string(allocator_config.no_overwrite_this) +
+          ";linear_scan_threshold=" +
+          std::to_string(allocator_config.linear_scan_threshold) +
+          // The cached stats only hold the graph coloring cost of the linear
+          // scan methods when it was measured.
+          ";measure_linear_scan=" +
+          std::to_string(allocator_config.measure_linear_scan));
+
   auto scope = build_class_scope(stores);
-  auto stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* m) {
-    return graph_coloring::allocate(allocator_config, m);
+  // The cost of the allocation grows faster than the size of the methods, so
+  // start with the largest ones.
+  auto stats = walk::parallel::methods_by_cost<Stats>(scope, [&](DexMethod* m) {
+    auto cache_key =
+        cache ? cache->key(m) : boost::optional<std::string>(boost::none);
+    if (cache_key) {
+      if (auto cached = cache->replay(*cache_key, m)) {
+        return stats_from_json(*cached);
+      }
+    }
+    auto method_stats = graph_coloring::allocate(allocator_config, m);
+    if (cache_key) {
+      cache->record(*cache_key, m->get_code(), stats_to_json(method_stats));
+    }
+    return method_stats;
   });
+  if (cache) {
+    cache->report_metrics(mgr);
+  }
 
   TRACE(REG, 1, "Total reiteration count: %lu", stats.reiteration_count);
+  TRACE(REG, 1, "  Methods reiterated: %zu, at most %zu times",
+        stats.reiterated_methods, stats.max_reiteration_count);
   TRACE(REG, 1, "Total Params spilled early: %lu", stats.params_spill_early);
   TRACE(REG, 1, "Total spill count: %lu", stats.moves_inserted());
   TRACE(REG, 1, "  Total param spills: %lu", stats.param_spill_moves);
@@ -49,10 +131,28 @@ void RegAllocPass::run_pass(DexStoresVector& stores,
 
   mgr.incr_metric("param spilled too early", stats.params_spill_early);
   mgr.incr_metric("reiteration_count", stats.reiteration_count);
+  mgr.incr_metric("reiterated_methods", stats.reiterated_methods);
+  mgr.incr_metric("max_reiteration_count", stats.max_reiteration_count);
   mgr.incr_metric("spill_count", stats.moves_inserted());
   mgr.incr_metric("coalesce_count", stats.moves_coalesced);
   mgr.incr_metric("net_moves", stats.net_moves());
 
+  if (stats.linear_scan_methods > 0) {
+    TRACE(REG, 1, "Methods allocated by linear scan: %zu, with %zu moves",
+          stats.linear_scan_methods, stats.linear_scan_moves);
+    mgr.incr_metric("linear_scan_methods", stats.linear_scan_methods);
+    mgr.incr_metric("linear_scan_moves", stats.linear_scan_moves);
+    mgr.incr_metric("linear_scan_code_units", stats.linear_scan_code_units);
+    if (allocator_config.measure_linear_scan) {
+      // How many code units the linear scan costs, compared to allocating
+      // the same methods by graph coloring.
+      mgr.incr_metric("linear_scan_code_units_delta",
+                      static_cast<int64_t>(stats.linear_scan_code_units) -
+                          static_cast<int64_t>(
+                              stats.graph_coloring_code_units));
+    }
+  }
+
   ++m_run;
   // For the last invocation, record that final register allocation has been
   // done.
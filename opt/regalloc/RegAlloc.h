@@ -21,6 +21,23 @@ class RegAllocPass : public Pass {
   void bind_config() override {
     bool unused;
     bind("live_range_splitting", false, unused);
+    bind("bit_vector_liveness",
+         false,
+         unused,
+         "Compute liveness with dense bit vectors, which is faster on methods "
+         "with many registers. Register assignments are unaffected.");
+    size_t unused_threshold;
+    bind("linear_scan_threshold",
+         0,
+         unused_threshold,
+         "Allocate methods with more instructions than this by linear scan, "
+         "which is faster than graph coloring on huge methods but needs more "
+         "moves. Zero disables it.");
+    bind("measure_linear_scan",
+         false,
+         unused,
+         "Also allocate the methods that are allocated by linear scan by "
+         "graph coloring, to report the code size difference.");
     trait(Traits::Pass::atleast, 1);
   }
 
@@ -10,6 +10,7 @@
 #include <boost/regex.hpp>
 #include <tuple>
 
+#include "ConcurrentContainers.h"
 #include "ConfigFiles.h"
 #include "Dataflow.h"
 #include "DexUtil.h"
@@ -18,6 +19,7 @@
 #include "RemoveBuildersHelper.h"
 #include "Resolver.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -210,13 +212,14 @@ std::vector<DexType*> RemoveBuildersPass::created_builders(DexMethod* m) {
 // checks if any instances of :builder that get created in the method ever get
 // passed to a method (aside from when its own instance methods get invoked),
 // or if they get stored in a field, or if they escape as a return value.
-bool RemoveBuildersPass::escapes_stack(DexType* builder, DexMethod* method) {
+//
+// :blocks are those of the CFG of the method, in reverse post order.
+bool RemoveBuildersPass::escapes_stack(DexType* builder,
+                                       DexMethod* method,
+                                       const std::vector<cfg::Block*>& blocks) {
   always_assert(builder != nullptr);
   always_assert(method != nullptr);
 
-  auto code = method->get_code();
-  code->build_cfg(/* editable */ false);
-  const auto& blocks = code->cfg().blocks_reverse_post_deprecated();
   auto regs_size = method->get_code()->get_registers_size();
   auto taint_map = get_tainted_regs(regs_size, blocks, builder);
   return tainted_reg_escapes(
@@ -250,11 +253,23 @@ void RemoveBuildersPass::run_pass(DexStoresVector& stores,
     }
   }
 
-  std::unordered_set<DexType*> escaped_builders;
-  walk::methods(scope, [&](DexMethod* m) {
+  // The methods are analyzed in parallel. The CFG of each method, and its
+  // block order, are computed once and shared by the analyses of all the
+  // builders that the method creates.
+  ConcurrentSet<DexType*> escaped_builders;
+  walk::parallel::methods(scope, [&](DexMethod* m) {
     auto builders = created_builders(m);
+    if (builders.empty()) {
+      return;
+    }
+    std::sort(builders.begin(), builders.end(), compare_dextypes);
+    builders.erase(std::unique(builders.begin(), builders.end()),
+                   builders.end());
+    auto code = m->get_code();
+    code->build_cfg(/* editable */ false);
+    const auto blocks = code->cfg().blocks_reverse_post_deprecated();
     for (DexType* builder : builders) {
-      if (escapes_stack(builder, m)) {
+      if (escapes_stack(builder, m, blocks)) {
         TRACE(BUILDERS,
               3,
               "%s escapes in %s",
@@ -267,7 +282,7 @@ void RemoveBuildersPass::run_pass(DexStoresVector& stores,
 
   std::unordered_set<DexType*> stack_only_builders;
   for (DexType* builder : m_builders) {
-    if (escaped_builders.find(builder) == escaped_builders.end()) {
+    if (!escaped_builders.count(builder)) {
       stack_only_builders.emplace(builder);
     }
   }
@@ -281,14 +296,16 @@ void RemoveBuildersPass::run_pass(DexStoresVector& stores,
     }
   }
 
-  std::unordered_set<DexType*> this_escapes;
-  for (DexType* cls_ty : builders_and_supers) {
-    DexClass* cls = type_class(cls_ty);
-    if (cls->is_external() ||
-        this_arg_escapes(cls, m_enable_buildee_constr_change)) {
-      this_escapes.emplace(cls_ty);
-    }
-  }
+  ConcurrentSet<DexType*> this_escapes;
+  workqueue_run<DexType*>(
+      [&](DexType* cls_ty) {
+        DexClass* cls = type_class(cls_ty);
+        if (cls->is_external() ||
+            this_arg_escapes(cls, m_enable_buildee_constr_change)) {
+          this_escapes.insert(cls_ty);
+        }
+      },
+      builders_and_supers);
 
   // set of builders that neither escape the stack nor pass their 'this' arg
   // to another function
@@ -297,7 +314,7 @@ void RemoveBuildersPass::run_pass(DexStoresVector& stores,
     DexType* cls = builder;
     bool hierarchy_has_escape = false;
     while (cls != nullptr) {
-      if (this_escapes.find(cls) != this_escapes.end()) {
+      if (this_escapes.count(cls)) {
         hierarchy_has_escape = true;
         break;
       }
@@ -15,6 +15,7 @@
 #include "IRCode.h"
 #include "NullPointerExceptionUtil.h"
 #include "PassManager.h"
+#include "Reachability.h"
 #include "Resolver.h"
 #include "Show.h"
 #include "Trace.h"
@@ -61,7 +62,7 @@ IRInstruction* ir_move_result_pseudo_object(uint32_t dest) {
 struct VirtualScopeId {
   const DexString* name;
   DexProto* proto;
-  static VirtualScopeId make(DexMethodRef* method) {
+  static VirtualScopeId make(const DexMethodRef* method) {
     return VirtualScopeId{method->get_name(), method->get_proto()};
   }
 };
@@ -88,10 +89,11 @@ class OverriddenVirtualScopesAnalysis {
   std::unordered_map<DexType*, VirtualScopeIdSet>
       m_transitively_defined_virtual_scopes;
 
-  ConcurrentSet<DexType*> m_instantiated_types;
-  ConcurrentSet<VirtualScopeId, VirtualScopeIdHasher>
-      m_unresolved_super_invoked_virtual_scopes;
-  ConcurrentSet<DexMethod*> m_resolved_super_invoked_methods;
+  // Either gathered by the scan of all code, or by the reachability analysis
+  // of the pass that ran right before.
+  reachability::InstantiationFacts m_scanned_facts;
+  const reachability::InstantiationFacts& m_facts;
+  VirtualScopeIdSet m_unresolved_super_invoked_virtual_scopes;
 
   // This helper method initializes
   // m_transitively_defined_virtual_scopes for a particular type
@@ -156,16 +158,15 @@ class OverriddenVirtualScopesAnalysis {
           // occurrences of "const-class" doesn't actually mean that the class
           // can be instantiated, but since it's then possible via reflection,
           // we treat it as such
-          m_instantiated_types.insert(insn->get_type());
+          m_scanned_facts.instantiated_types.insert(insn->get_type());
         }
         if (insn->opcode() == OPCODE_INVOKE_SUPER) {
           auto callee_ref = insn->get_method();
           auto callee = resolve_method(callee_ref, MethodSearch::Super, method);
           if (callee == nullptr) {
-            m_unresolved_super_invoked_virtual_scopes.insert(
-                VirtualScopeId::make(callee_ref));
+            m_scanned_facts.unresolved_super_invoked_methods.insert(callee_ref);
           } else {
-            m_resolved_super_invoked_methods.insert(callee);
+            m_scanned_facts.super_invoked_methods.insert(callee);
           }
         }
         return editable_cfg_adapter::LOOP_CONTINUE;
@@ -176,7 +177,7 @@ class OverriddenVirtualScopesAnalysis {
   bool is_instantiated(DexType* t) const {
     auto cls = type_class(t);
     return is_native(cls) || root(cls) || !can_rename(cls) ||
-           m_instantiated_types.count(t);
+           m_facts.instantiated_types.count(t);
   }
 
  public:
@@ -184,11 +185,19 @@ class OverriddenVirtualScopesAnalysis {
       const Scope& scope,
       const std::unordered_set<DexType*>& scoped_uninstantiable_types,
       const std::unordered_map<DexType*, std::unordered_set<DexType*>>&
-          instantiable_children)
-      : m_scoped_uninstantiable_types(scoped_uninstantiable_types) {
+          instantiable_children,
+      const reachability::InstantiationFacts* reachability_facts)
+      : m_scoped_uninstantiable_types(scoped_uninstantiable_types),
+        m_facts(reachability_facts ? *reachability_facts : m_scanned_facts) {
     Timer timer("OverriddenVirtualScopesAnalysis");
 
-    scan_code(scope);
+    if (reachability_facts == nullptr) {
+      scan_code(scope);
+    }
+    for (auto* method_ref : m_facts.unresolved_super_invoked_methods) {
+      m_unresolved_super_invoked_virtual_scopes.insert(
+          VirtualScopeId::make(method_ref));
+    }
 
     ConcurrentMap<const DexType*, VirtualScopeIdSet> defined_virtual_scopes;
     walk::parallel::classes(scope, [&](DexClass* cls) {
@@ -216,7 +225,7 @@ class OverriddenVirtualScopesAnalysis {
     if (!method->is_virtual()) {
       return true;
     }
-    if (m_resolved_super_invoked_methods.count(method) ||
+    if (m_facts.super_invoked_methods.count(method) ||
         m_unresolved_super_invoked_virtual_scopes.count(
             VirtualScopeId::make(method))) {
       return true;
@@ -445,8 +454,13 @@ void RemoveUninstantiablesPass::run_pass(DexStoresVector& stores,
       instantiable_children;
   std::unordered_set<DexType*> scoped_uninstantiable_types =
       compute_scoped_uninstantiable_types(scope, &instantiable_children);
+  // Right after RemoveUnreachablePass, what its reachability analysis found
+  // in the code that is left saves scanning all of it again.
+  auto reachability_facts = mgr.instantiation_facts_of_previous_pass();
+  mgr.set_metric("reused_reachability_facts", reachability_facts != nullptr);
   OverriddenVirtualScopesAnalysis overridden_virtual_scopes_analysis(
-      scope, scoped_uninstantiable_types, instantiable_children);
+      scope, scoped_uninstantiable_types, instantiable_children,
+      reachability_facts);
   // We perform structural changes, i.e. whether a method has a body and
   // removal, as a post-processing step, to streamline the main operations
   struct ClassPostProcessing {
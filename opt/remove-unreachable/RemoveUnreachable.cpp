@@ -219,8 +219,10 @@ void RemoveUnreachablePassBase::run_pass(DexStoresVector& stores,
     // references of removed symbols (which, of course, will be from dead code).
     gather_references_from_removed_symbols(stores, *reachables, references);
   }
+  before_sweep(pm, *reachables);
   reachability::sweep(stores, *reachables,
                       output_unreachable_symbols ? &removed_symbols : nullptr);
+  pm.set_instantiation_facts(reachables->instantiation_facts());
 
   reachability::ObjectCounts after = reachability::count_objects(stores);
   TRACE(RMU, 1, "after: %lu classes, %lu fields, %lu methods",
@@ -284,13 +286,19 @@ void RemoveUnreachablePassBase::write_out_removed_symbols(
 std::unique_ptr<reachability::ReachableObjects>
 RemoveUnreachablePass::compute_reachable_objects(
     const DexStoresVector& stores,
-    PassManager& /* pm */,
+    PassManager& pm,
     int* num_ignore_check_strings,
     bool emit_graph_this_run,
     bool remove_no_argument_constructors) {
-  return reachability::compute_reachable_objects(
+  auto reachables = reachability::compute_reachable_objects(
       stores, m_ignore_sets, num_ignore_check_strings, emit_graph_this_run,
-      false, nullptr, remove_no_argument_constructors);
+      false, nullptr, remove_no_argument_constructors,
+      m_incremental_marking ? &m_marking_history : nullptr);
+  if (m_incremental_marking) {
+    pm.set_metric("marking_replayed_visits", m_marking_history.num_replayed());
+    pm.set_metric("marking_visits", m_marking_history.num_visited());
+  }
+  return reachables;
 }
 
 static RemoveUnreachablePass s_pass;
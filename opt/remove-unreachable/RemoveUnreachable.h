@@ -45,6 +45,10 @@ class RemoveUnreachablePassBase : public Pass {
                             bool emit_graph_this_run,
                             bool remove_no_argument_constructors) = 0;
 
+  // Called before the unreachable objects are deleted.
+  virtual void before_sweep(PassManager& /* pm */,
+                            const reachability::ReachableObjects&) {}
+
   void write_out_removed_symbols(
       const std::string& filepath,
       const ConcurrentSet<std::string>& removed_symbols);
@@ -62,10 +66,21 @@ class RemoveUnreachablePass : public RemoveUnreachablePassBase {
   RemoveUnreachablePass()
       : RemoveUnreachablePassBase("RemoveUnreachablePass") {}
 
+  void bind_config() override {
+    RemoveUnreachablePassBase::bind_config();
+    // Each run reuses the marking of the previous run of this pass, see
+    // reachability::MarkingHistory. This costs the memory of the history.
+    bind("incremental_marking", false, m_incremental_marking);
+  }
+
   std::unique_ptr<reachability::ReachableObjects> compute_reachable_objects(
       const DexStoresVector& stores,
       PassManager& pm,
       int* num_ignore_check_strings,
       bool emit_graph_this_run,
       bool remove_no_argument_constructors) override;
+
+ private:
+  bool m_incremental_marking{false};
+  reachability::MarkingHistory m_marking_history;
 };
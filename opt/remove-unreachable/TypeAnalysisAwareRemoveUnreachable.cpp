@@ -234,7 +234,7 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects_with_type_anaysis(
     code.cfg().calculate_exit_block();
   });
 
-  auto reachable_objects = std::make_unique<ReachableObjects>();
+  auto reachable_objects = std::make_unique<ReachableObjects>(scope);
   ConditionallyMarked cond_marked;
   auto method_override_graph = mog::build_graph(scope);
 
@@ -290,4 +290,29 @@ TypeAnalysisAwareRemoveUnreachablePass::compute_reachable_objects(
       remove_no_argument_constructors);
 }
 
+void TypeAnalysisAwareRemoveUnreachablePass::before_sweep(
+    PassManager& pm, const reachability::ReachableObjects& reachables) {
+  auto analysis =
+      pm.template get_preserved_analysis<TypeAnalysisCallGraphGenerationPass>();
+  if (analysis == nullptr || analysis->get_result() == nullptr) {
+    return;
+  }
+  auto& graph = *analysis->get_result();
+  AccumulatingTimer timer;
+  call_graph::CallgraphUpdateStats stats;
+  {
+    auto timer_scope = timer.scope();
+    std::vector<const DexMethod*> removed;
+    for (const auto& [method, node] : graph.nodes()) {
+      if (!reachables.marked_unsafe(method)) {
+        removed.push_back(method);
+      }
+    }
+    stats = graph.remove_methods(removed);
+  }
+  pm.incr_metric("callgraph_nodes_removed", stats.nodes_removed);
+  pm.incr_metric("callgraph_edges_removed", stats.edges_removed);
+  pm.incr_metric("callgraph_update_us", timer.get_microseconds());
+}
+
 static TypeAnalysisAwareRemoveUnreachablePass s_pass;
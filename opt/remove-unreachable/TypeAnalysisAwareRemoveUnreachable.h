@@ -10,6 +10,7 @@
 #include "GlobalTypeAnalysisPass.h"
 #include "Pass.h"
 #include "RemoveUnreachable.h"
+#include "TypeAnalysisCallGraphGenerationPass.h"
 
 class TypeAnalysisAwareRemoveUnreachablePass
     : public RemoveUnreachablePassBase {
@@ -28,4 +29,9 @@ class TypeAnalysisAwareRemoveUnreachablePass
       int* num_ignore_check_strings,
       bool emit_graph_this_run,
       bool remove_no_argument_constructors) override;
+
+  // Removes the deleted methods from the preserved call graph, if any, which
+  // would otherwise have to be rebuilt after this pass.
+  void before_sweep(PassManager& pm,
+                    const reachability::ReachableObjects& reachables) override;
 };
@@ -134,7 +134,7 @@ static bool compare_weighted_dexprotos(const std::pair<DexProto*, size_t>& a,
   return compare_dexprotos(a.first, b.first);
 }
 
-static bool any_external(const std::unordered_set<const DexMethod*>& methods) {
+static bool any_external(const mog::MethodSpan& methods) {
   for (auto method : methods) {
     auto cls = type_class(method->get_class());
     if (cls == nullptr || cls->is_external()) {
@@ -175,7 +175,7 @@ void RemoveArgs::compute_reordered_protos(const mog::Graph& override_graph) {
             // we assume the worst.
             record_fixed_proto(caller_proto, 0);
           } else {
-            auto& node = override_graph.get_node(caller);
+            auto node = override_graph.get_node(caller);
             if (any_external(node.parents)) {
               // We can't change the signature of an overriding method when the
               // overridden method is external
@@ -422,6 +422,7 @@ static void compute_dead_insns_and_remove_result(
     DexMethod* method,
     const mog::Graph& override_graph,
     const ConcurrentSet<DexMethod*>& results_used,
+    LiveArgsCache* live_args_cache,
     std::deque<uint16_t>* live_arg_idxs,
     std::vector<IRInstruction*>* dead_insns,
     bool* remove_result) {
@@ -455,7 +456,20 @@ static void compute_dead_insns_and_remove_result(
     return;
   }
 
+  if (live_args_cache == nullptr) {
+    *live_arg_idxs = compute_live_args(method, num_args, dead_insns);
+    return;
+  }
+  auto cached = live_args_cache->get(method, nullptr);
+  if (cached) {
+    *live_arg_idxs = cached->live_arg_idxs;
+    *dead_insns = cached->dead_insns;
+    return;
+  }
   *live_arg_idxs = compute_live_args(method, num_args, dead_insns);
+  live_args_cache->emplace(
+      method, std::make_shared<const LiveArgs>(
+                  LiveArgs{*live_arg_idxs, *dead_insns}));
 }
 
 // When reordering a method's proto, we need to update the method's load-param
@@ -540,8 +554,9 @@ RemoveArgs::MethodStats RemoveArgs::update_method_protos(
     } else {
       // Only if there's no reordering, we'll look at dead args and results
       compute_dead_insns_and_remove_result(method, override_graph,
-                                           m_result_used, &live_arg_idxs,
-                                           &dead_insns, &remove_result);
+                                           m_result_used, m_live_args_cache,
+                                           &live_arg_idxs, &dead_insns,
+                                           &remove_result);
       if (dead_insns.empty() && !remove_result) {
         return;
       }
@@ -602,6 +617,9 @@ RemoveArgs::MethodStats RemoveArgs::update_method_protos(
     for (auto& p : class_entries.at(cls)) {
       DexMethod* method = p.first;
       const Entry& entry = p.second;
+      if (m_live_args_cache != nullptr) {
+        m_live_args_cache->erase(method);
+      }
 
       if (!entry.dead_insns.empty()) {
         // We update the method signature, so we must remove unused
@@ -645,10 +663,11 @@ RemoveArgs::MethodStats RemoveArgs::update_method_protos(
 }
 
 /**
- * Removes dead arguments from the given invoke instr if applicable.
- * Returns the number of arguments removed.
+ * Removes dead arguments from the given invoke instr if applicable, and sets
+ * `updated` if it changed the instr, which reordering does without removing
+ * any arguments. Returns the number of arguments removed.
  */
-size_t RemoveArgs::update_callsite(IRInstruction* instr) {
+size_t RemoveArgs::update_callsite(IRInstruction* instr, bool* updated) {
   auto method = instr->get_method()->as_def();
   if (!method) {
     // TODO: T31388603 -- Remove unused args for true virtuals.
@@ -660,6 +679,7 @@ size_t RemoveArgs::update_callsite(IRInstruction* instr) {
     // No removable arguments, so do nothing.
     return 0;
   }
+  *updated = true;
   auto& updated_srcs = kv_pair->second;
   std::vector<reg_t> new_srcs;
   for (size_t i = 0; i < updated_srcs.size(); ++i) {
@@ -689,16 +709,22 @@ size_t RemoveArgs::update_callsites() {
           return 0;
         }
         size_t callsite_args_removed = 0;
+        bool updated = false;
         for (const auto& mie : InstructionIterable(code)) {
           auto insn = mie.insn;
           if (opcode::is_an_invoke(insn->opcode())) {
-            size_t insn_args_removed = update_callsite(insn);
+            size_t insn_args_removed = update_callsite(insn, &updated);
             if (insn_args_removed > 0) {
               log_opt(CALLSITE_ARGS_REMOVED, method, insn);
               callsite_args_removed += insn_args_removed;
             }
           }
         }
+        // The callers of updated methods are the only other methods whose
+        // code changed, and whose liveness must be computed again.
+        if (updated && m_live_args_cache != nullptr) {
+          m_live_args_cache->erase(method);
+        }
         return callsite_args_removed;
       });
 }
@@ -717,10 +743,11 @@ void RemoveUnusedArgsPass::run_pass(DexStoresVector& stores,
   size_t num_method_protos_reordered_count = 0;
   size_t num_iterations = 0;
   LocalDce::Stats local_dce_stats;
+  LiveArgsCache live_args_cache;
   while (true) {
     num_iterations++;
     RemoveArgs rm_args(scope, init_classes_with_side_effects, m_blocklist,
-                       m_total_iterations++);
+                       m_total_iterations++, &live_args_cache);
     auto pass_stats = rm_args.run(conf);
     if (pass_stats.methods_updated_count == 0) {
       break;
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <memory>
 #include <mutex>
 
 #include "ConcurrentContainers.h"
@@ -23,6 +24,19 @@ std::deque<uint16_t> compute_live_args(DexMethod* method,
                                        size_t num_args,
                                        std::vector<IRInstruction*>* dead_insns);
 
+// The result of compute_live_args for a method, which stays valid for as long
+// as neither the code nor the proto of the method changes.
+struct LiveArgs {
+  std::deque<uint16_t> live_arg_idxs;
+  std::vector<IRInstruction*> dead_insns;
+};
+
+// Live args of methods that were not changed since their liveness was last
+// computed, kept across iterations of the pass so that only the methods that
+// were updated, or whose callsites were, are analyzed again.
+using LiveArgsCache =
+    ConcurrentMap<const DexMethod*, std::shared_ptr<const LiveArgs>>;
+
 class RemoveArgs {
  public:
   struct MethodStats {
@@ -45,11 +59,13 @@ class RemoveArgs {
              const init_classes::InitClassesWithSideEffects&
                  init_classes_with_side_effects,
              const std::vector<std::string>& blocklist,
-             size_t iteration = 0)
+             size_t iteration = 0,
+             LiveArgsCache* live_args_cache = nullptr)
       : m_scope(scope),
         m_init_classes_with_side_effects(init_classes_with_side_effects),
         m_blocklist(blocklist),
-        m_iteration(iteration) {}
+        m_iteration(iteration),
+        m_live_args_cache(live_args_cache) {}
   RemoveArgs::PassStats run(ConfigFiles& conf);
 
  private:
@@ -70,6 +86,7 @@ class RemoveArgs {
   std::unordered_map<DexProto*, DexProto*> m_reordered_protos;
   const std::vector<std::string>& m_blocklist;
   size_t m_iteration;
+  LiveArgsCache* m_live_args_cache;
 
   DexTypeList::ContainerType get_live_arg_type_list(
       DexMethod* method, const std::deque<uint16_t>& live_arg_idxs);
@@ -80,7 +97,7 @@ class RemoveArgs {
   MethodStats update_method_protos(
       const mog::Graph& override_graph,
       const std::unordered_set<DexType*>& no_devirtualize_anno);
-  size_t update_callsite(IRInstruction* instr);
+  size_t update_callsite(IRInstruction* instr, bool* updated);
   size_t update_callsites();
   void gather_results_used();
   void compute_reordered_protos(const mog::Graph& override_graph);
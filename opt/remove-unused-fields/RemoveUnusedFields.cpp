@@ -115,21 +115,23 @@ class RemoveUnusedFields final {
   }
 
   void analyze() {
-    field_op_tracker::FieldStatsMap field_stats =
-        field_op_tracker::analyze(m_scope);
-
-    // analyze_non_zero_writes and the later transform() need (editable) cfg
+    // analyze_with_writes and the later transform() need (editable) cfg
     walk::parallel::code(m_scope, [&](const DexMethod*, IRCode& code) {
       code.build_cfg(/* editable = true*/);
     });
 
+    field_op_tracker::FieldStatsMap field_stats;
     boost::optional<field_op_tracker::FieldWrites> field_writes;
     if (m_config.remove_zero_written_fields ||
         m_config.remove_vestigial_objects_written_fields) {
-      field_writes = field_op_tracker::analyze_writes(
-          m_scope, field_stats,
+      auto field_ops = field_op_tracker::analyze_with_writes(
+          m_scope,
           m_config.remove_vestigial_objects_written_fields ? &m_type_lifetimes
                                                            : nullptr);
+      field_stats = std::move(field_ops.field_stats);
+      field_writes = std::move(field_ops.field_writes);
+    } else {
+      field_stats = field_op_tracker::analyze(m_scope);
     }
 
     for (auto& pair : field_stats) {
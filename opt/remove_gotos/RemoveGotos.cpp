@@ -21,6 +21,7 @@
 #include "IRCode.h"
 #include "IRInstruction.h"
 #include "PassManager.h"
+#include "ScopedCFG.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
@@ -120,18 +121,20 @@ class RemoveGotos {
     TRACE(RMGOTO, 4, "Initial opcode count: %zu", init_opcode_count);
 
     TRACE(RMGOTO, 3, "input code\n%s", SHOW(code));
-    code->build_cfg(/* editable */ true);
-    auto& cfg = code->cfg();
+    size_t num_goto_removed;
+    {
+      // Reuses the CFG if the caller already built it.
+      cfg::ScopedCFG cfg(code);
 
-    TRACE(RMGOTO, 3, "before %s", SHOW(cfg));
+      TRACE(RMGOTO, 3, "before %s", SHOW(*cfg));
 
-    size_t num_goto_removed = merge_blocks(cfg);
+      num_goto_removed = merge_blocks(*cfg);
 
-    TRACE(RMGOTO, 3, "%zu blocks merged", num_goto_removed);
-    TRACE(RMGOTO, 3, "after %s", SHOW(cfg));
-    TRACE(RMGOTO, 5, "Opcode count: %zu", code->count_opcodes());
+      TRACE(RMGOTO, 3, "%zu blocks merged", num_goto_removed);
+      TRACE(RMGOTO, 3, "after %s", SHOW(*cfg));
+      TRACE(RMGOTO, 5, "Opcode count: %zu", code->count_opcodes());
+    }
 
-    code->clear_cfg();
     auto final_opcode_count = code->count_opcodes();
     if (final_opcode_count > init_opcode_count) {
       TRACE(RMGOTO,
@@ -152,22 +155,30 @@ size_t RemoveGotosPass::run(DexMethod* method) {
   return RemoveGotos::process_method(method);
 }
 
-void RemoveGotosPass::run_pass(DexStoresVector& stores,
-                               ConfigFiles& /* unused */,
-                               PassManager& mgr) {
-  auto scope = build_class_scope(stores);
+namespace {
 
-  size_t total_gotos_removed =
-      walk::parallel::methods<size_t>(scope, [](DexMethod* m) -> size_t {
-        if (!m->get_code()) {
-          return 0;
-        }
-        return RemoveGotos::process_method(m);
-      });
+class RemoveGotosRun : public MethodPass::AccumulatingRun<size_t> {
+ public:
+  bool uses_editable_cfg() const override { return true; }
+
+  size_t visit(DexMethod* method, IRCode& /* code */) override {
+    return RemoveGotos::process_method(method);
+  }
+
+  void report(PassManager& mgr, const size_t& total_gotos_removed) override {
+    mgr.incr_metric(METRIC_GOTO_REMOVED, total_gotos_removed);
+    TRACE(RMGOTO, 1, "Number of unnecessary gotos removed: %zu",
+          total_gotos_removed);
+  }
+};
+
+} // namespace
 
-  mgr.incr_metric(METRIC_GOTO_REMOVED, total_gotos_removed);
-  TRACE(RMGOTO, 1, "Number of unnecessary gotos removed: %zu",
-        total_gotos_removed);
+std::unique_ptr<MethodPass::Run> RemoveGotosPass::prepare(
+    DexStoresVector& /* stores */,
+    ConfigFiles& /* unused */,
+    PassManager& /* mgr */) {
+  return std::make_unique<RemoveGotosRun>();
 }
 
 static RemoveGotosPass s_pass;
@@ -9,11 +9,15 @@
 
 #include "Pass.h"
 
-class RemoveGotosPass : public Pass {
+class RemoveGotosPass : public MethodPass {
  public:
-  RemoveGotosPass() : Pass("RemoveGotosPass") {}
+  RemoveGotosPass() : MethodPass("RemoveGotosPass") {}
 
-  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  std::unique_ptr<Run> prepare(DexStoresVector&,
+                               ConfigFiles&,
+                               PassManager&) override;
+
+  bool is_cfg_legal() const override { return true; }
 
   size_t run(DexMethod*);
 };
@@ -40,8 +40,9 @@ void RemoveRedundantCheckCastsPass::run_pass(DexStoresVector& stores,
                                              PassManager& mgr) {
   auto scope = build_class_scope(stores);
 
-  auto stats =
-      walk::parallel::methods<impl::Stats>(scope, [&](DexMethod* method) {
+  // Type inference takes more than linear time in the size of a method.
+  auto stats = walk::parallel::methods_by_cost<impl::Stats>(
+      scope, [&](DexMethod* method) {
         return remove_redundant_check_casts(m_config, method);
       });
 
@@ -7,9 +7,12 @@
 
 #include "ResultPropagation.h"
 
+#include <algorithm>
+#include <unordered_set>
 #include <vector>
 
 #include "BaseIRAnalyzer.h"
+#include "ConcurrentContainers.h"
 #include "ConstantAbstractDomain.h"
 #include "ControlFlow.h"
 #include "IRCode.h"
@@ -19,6 +22,7 @@
 #include "Resolver.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 using namespace sparta;
 
@@ -314,6 +318,30 @@ boost::optional<ParamIndex> ReturnParamResolver::get_return_param_index(
   return param.get_constant();
 }
 
+void ReturnParamResolver::get_dependencies(
+    const IRInstruction* insn,
+    MethodRefCache& resolved_refs,
+    std::vector<const DexMethod*>* dependencies) const {
+  always_assert(opcode::is_an_invoke(insn->opcode()));
+  const auto method = insn->get_method();
+  if (method->get_proto()->is_void()) {
+    return;
+  }
+  const auto callee =
+      resolve_method(method, opcode_to_search(insn), resolved_refs);
+  if (callee == nullptr) {
+    return;
+  }
+  dependencies->push_back(callee);
+  const auto opcode = insn->opcode();
+  if (opcode == OPCODE_INVOKE_VIRTUAL || opcode == OPCODE_INVOKE_INTERFACE) {
+    const auto overriding_methods =
+        method_override_graph::get_overriding_methods(m_graph, callee);
+    dependencies->insert(dependencies->end(), overriding_methods.begin(),
+                         overriding_methods.end());
+  }
+}
+
 bool ReturnParamResolver::returns_compatible_with_receiver(
     const DexMethodRef* method) const {
   // Because of covariance and implemented interfaces, we might be looking at a
@@ -528,8 +556,6 @@ void ResultPropagationPass::run_pass(DexStoresVector& stores,
         stats.patched_move_results, stats.unverifiable_move_results);
 }
 
-using ParamIndexMap = std::unordered_map<const DexMethod*, ParamIndex>;
-
 std::unordered_map<const DexMethod*, ParamIndex>
 ResultPropagationPass::find_methods_which_return_parameter(
     PassManager& mgr, const Scope& scope, const ReturnParamResolver& resolver) {
@@ -541,63 +567,86 @@ ResultPropagationPass::find_methods_which_return_parameter(
     }
   });
 
+  // The summary of a method only depends on the summaries of the methods it
+  // may invoke. Record the inverse, so that after the first iteration only the
+  // callers of newly found methods need to be analyzed again.
+  ConcurrentMap<const DexMethod*, std::vector<DexMethod*>> dependents;
+  walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
+    if (method->get_proto()->is_void()) {
+      return;
+    }
+    MethodRefCache resolved_refs;
+    std::vector<const DexMethod*> dependencies;
+    for (const auto& mie : InstructionIterable(code.cfg())) {
+      if (opcode::is_an_invoke(mie.insn->opcode())) {
+        resolver.get_dependencies(mie.insn, resolved_refs, &dependencies);
+      }
+    }
+    std::sort(dependencies.begin(), dependencies.end());
+    dependencies.erase(std::unique(dependencies.begin(), dependencies.end()),
+                       dependencies.end());
+    for (auto* dependency : dependencies) {
+      dependents.update(dependency,
+                        [method](const DexMethod*,
+                                 std::vector<DexMethod*>& methods,
+                                 bool /* exists */) {
+                          methods.push_back(method);
+                        });
+    }
+  });
+
+  std::vector<DexMethod*> worklist;
+  walk::code(scope, [&](DexMethod* method, IRCode&) {
+    if (!method->get_proto()->is_void()) {
+      worklist.push_back(method);
+    }
+  });
+
   std::unordered_map<const DexMethod*, ParamIndex>
       methods_which_return_parameter;
   // We iterate a few times to capture chains of method calls that all
   // eventually return `this`.
   // TODO(perf): Add flag to limit number of iterations
-  // TODO(perf): For each analyzed method, keep track of the reasons (a set of
-  // methods) why the call resolution gave up, and use that "dependency"
-  // information to limit what needs to be processed in subsequent iterations
-  while (true) {
+  while (!worklist.empty()) {
     mgr.incr_metric(METRIC_METHODS_WHICH_RETURN_PARAMETER_ITERATIONS, 1);
-    const auto next_methods_which_return_parameter =
-        walk::parallel::methods<ParamIndexMap, MergeContainers<ParamIndexMap>>(
-            scope, [&](DexMethod* method) {
-              std::unordered_map<const DexMethod*, ParamIndex> res;
-
-              const auto code = method->get_code();
-              if (code == nullptr) {
-                return res;
-              }
-              const auto proto = method->get_proto();
-              if (proto->is_void()) {
-                // void methods cannot return a parameter, skip expensive
-                // analysis
-                return res;
-              }
-
-              const auto mwrpit = methods_which_return_parameter.find(method);
-              if (mwrpit != methods_which_return_parameter.end()) {
-                // Short-circuit re-computing for perf
-                res.insert({method, mwrpit->second});
-                return res;
-              }
-
-              // TODO(T35815704): Make the cfg const
-              cfg::ControlFlowGraph& cfg = code->cfg();
-              const auto return_param_index = resolver.get_return_param_index(
-                  cfg, methods_which_return_parameter);
-              if (return_param_index) {
-                res.insert({method, *return_param_index});
-              }
-
-              return res;
-            });
-
-    if (next_methods_which_return_parameter.size() ==
-        methods_which_return_parameter.size()) {
-
-      walk::parallel::code(scope, [](DexMethod* method, IRCode& code) {
-        const auto proto = method->get_proto();
-        if (!proto->is_void()) {
-          code.clear_cfg();
+    ConcurrentMap<const DexMethod*, ParamIndex> found;
+    workqueue_run<DexMethod*>(
+        [&](DexMethod* method) {
+          // TODO(T35815704): Make the cfg const
+          cfg::ControlFlowGraph& cfg = method->get_code()->cfg();
+          const auto return_param_index = resolver.get_return_param_index(
+              cfg, methods_which_return_parameter);
+          if (return_param_index) {
+            found.emplace(method, *return_param_index);
+          }
+        },
+        worklist);
+
+    std::unordered_set<DexMethod*> next_worklist;
+    for (const auto& [method, param_index] : found) {
+      methods_which_return_parameter.emplace(method, param_index);
+    }
+    for (const auto& [method, param_index] : found) {
+      auto it = dependents.find(method);
+      if (it == dependents.end()) {
+        continue;
+      }
+      for (auto* dependent : it->second) {
+        if (!methods_which_return_parameter.count(dependent)) {
+          next_worklist.insert(dependent);
         }
-      });
-      return methods_which_return_parameter;
+      }
     }
-    methods_which_return_parameter = next_methods_which_return_parameter;
+    worklist.assign(next_worklist.begin(), next_worklist.end());
   }
+
+  walk::parallel::code(scope, [](DexMethod* method, IRCode& code) {
+    const auto proto = method->get_proto();
+    if (!proto->is_void()) {
+      code.clear_cfg();
+    }
+  });
+  return methods_which_return_parameter;
 }
 
 static ResultPropagationPass s_pass;
@@ -61,6 +61,14 @@ class ReturnParamResolver {
           methods_which_return_parameter,
       MethodRefCache& resolved_refs) const;
 
+  /*
+   * Appends the methods whose entries in methods_which_return_parameter the
+   * above function may look up for the given invocation.
+   */
+  void get_dependencies(const IRInstruction* insn,
+                        MethodRefCache& resolved_refs,
+                        std::vector<const DexMethod*>* dependencies) const;
+
   /*
    * For a method given by its cfg, figure out whether all regular return
    * instructions would return a particular incoming parameter.
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "AnalysisUsage.h"
 #include "Pass.h"
 #include "ShrinkerConfig.h"
 
@@ -15,6 +16,11 @@ class ShrinkerPass : public Pass {
   ShrinkerPass() : Pass("ShrinkerPass") {}
 
   void bind_config() override;
+
+  // Only rewrites method bodies.
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.set_preserve_method_analyses();
+  }
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
  private:
@@ -107,6 +107,9 @@ void SingleImplPass::run_pass(DexStoresVector& stores,
   size_t previous_invoke_intf_count = s_invoke_intf_count;
   OptimizeStats stats;
   const auto& pg_map = conf.get_proguard_map();
+  // After the first step, only the code that referred to a single impl in
+  // the step before needs to be analyzed again.
+  std::unique_ptr<std::unordered_set<DexMethod*>> code_to_scan;
   while (true) {
     Timer t{std::string("Iteration ").append(std::to_string(max_steps + 1))};
     TRACE(INTF, 9, "\tOPTIMIZE ROUND %d", max_steps);
@@ -119,7 +122,9 @@ void SingleImplPass::run_pass(DexStoresVector& stores,
 
     std::unique_ptr<SingleImplAnalysis> single_impls =
         SingleImplAnalysis::analyze(scope, stores, single_impl, intfs, pg_map,
-                                    m_pass_config);
+                                    m_pass_config, code_to_scan.get());
+    code_to_scan = std::make_unique<std::unordered_set<DexMethod*>>(
+        std::move(single_impls->get_referencing_code()));
 
     auto optimized_stats =
         optimize(std::move(single_impls), ch, scope, m_pass_config);
@@ -11,6 +11,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include "ConcurrentContainers.h"
 #include "Debug.h"
 #include "DexOutput.h"
 #include "DexStore.h"
@@ -35,7 +36,8 @@ struct AnalysisImpl : SingleImplAnalysis {
                           const SingleImplConfig& config);
   void collect_field_defs();
   void collect_method_defs();
-  void analyze_opcodes();
+  void analyze_opcodes(const std::unordered_set<DexMethod*>* code_to_scan);
+  void collect_referencing_code();
   void escape_cross_stores();
   void remove_escaped();
 
@@ -55,6 +57,8 @@ struct AnalysisImpl : SingleImplAnalysis {
   const Scope& scope;
   const ProguardMap& pg_map;
   XStoreRefs xstores;
+  // Code that refers to a single impl without being recorded in its data.
+  ConcurrentSet<DexMethod*> escaping_code;
 };
 
 /**
@@ -359,7 +363,8 @@ void AnalysisImpl::collect_method_defs() {
  * Find all opcodes that reference a single implemented interface in a typeref,
  * fieldref or methodref.
  */
-void AnalysisImpl::analyze_opcodes() {
+void AnalysisImpl::analyze_opcodes(
+    const std::unordered_set<DexMethod*>* code_to_scan) {
 
   auto check_arg = [&](DexMethod* referrer,
                        const IRList::iterator& insn_it,
@@ -395,6 +400,7 @@ void AnalysisImpl::analyze_opcodes() {
     cls = get_and_check_single_impl(cls);
     if (cls) {
       escape_interface(cls, HAS_FIELD_REF);
+      escaping_code.insert(referrer);
     }
     const auto type = field->get_type();
     auto intf = get_and_check_single_impl(type);
@@ -406,7 +412,10 @@ void AnalysisImpl::analyze_opcodes() {
     }
   };
 
-  walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
+  auto filter = [code_to_scan](DexMethod* method) {
+    return code_to_scan == nullptr || code_to_scan->count(method);
+  };
+  walk::parallel::code(scope, filter, [&](DexMethod* method, IRCode& code) {
     redex_assert(!code.editable_cfg_built()); // Need *one* way to
     auto ii = ir_list::InstructionIterable(code);
     const auto& end = ii.end();
@@ -471,6 +480,7 @@ void AnalysisImpl::analyze_opcodes() {
           const auto& meths = type_class(intf)->get_vmethods();
           if (std::find(meths.begin(), meths.end(), meth) == meths.end()) {
             escape_interface(intf, UNKNOWN_MREF);
+            escaping_code.insert(method);
           } else {
             auto& si = single_impls.at(intf);
             std::lock_guard<std::mutex> lock(si.mutex);
@@ -497,6 +507,19 @@ void AnalysisImpl::analyze_opcodes() {
   });
 }
 
+/**
+ * Collect the methods whose code refers to any single impl, before the escaped
+ * ones are removed.
+ */
+void AnalysisImpl::collect_referencing_code() {
+  referencing_code.insert(escaping_code.begin(), escaping_code.end());
+  for (const auto& p : single_impls) {
+    for (const auto& q : p.second.referencing_methods) {
+      referencing_code.insert(q.first);
+    }
+  }
+}
+
 /**
  * Main analysis method
  */
@@ -506,13 +529,15 @@ std::unique_ptr<SingleImplAnalysis> SingleImplAnalysis::analyze(
     const TypeMap& single_impl,
     const TypeSet& intfs,
     const ProguardMap& pg_map,
-    const SingleImplConfig& config) {
+    const SingleImplConfig& config,
+    const std::unordered_set<DexMethod*>* code_to_scan) {
   std::unique_ptr<AnalysisImpl> single_impls(
       new AnalysisImpl(scope, pg_map, stores));
   single_impls->create_single_impl(single_impl, intfs, config);
   single_impls->collect_field_defs();
   single_impls->collect_method_defs();
-  single_impls->analyze_opcodes();
+  single_impls->analyze_opcodes(code_to_scan);
+  single_impls->collect_referencing_code();
   single_impls->escape_cross_stores();
   single_impls->remove_escaped();
   return std::move(single_impls);
@@ -137,7 +137,8 @@ struct SingleImplAnalysis {
   virtual ~SingleImplAnalysis() = default;
 
   /**
-   * Create a SingleImplAnalysis from a given Scope.
+   * Create a SingleImplAnalysis from a given Scope. If `code_to_scan` is
+   * given, only the code of those methods is analyzed.
    */
   static std::unique_ptr<SingleImplAnalysis> analyze(
       const Scope& scope,
@@ -145,7 +146,8 @@ struct SingleImplAnalysis {
       const TypeMap& single_impl,
       const TypeSet& intfs,
       const ProguardMap& pg_map,
-      const SingleImplConfig& config);
+      const SingleImplConfig& config,
+      const std::unordered_set<DexMethod*>* code_to_scan = nullptr);
 
   /**
    * Escape an interface and all parent interfaces.
@@ -178,8 +180,19 @@ struct SingleImplAnalysis {
     return single_impls.at(intf);
   }
 
+  /**
+   * The methods whose code refers to any single impl, including the escaped
+   * ones. The single impls of a later step are among those of this one, and
+   * optimizing only changes the code of these methods, so the next step only
+   * needs to analyze their code again.
+   */
+  std::unordered_set<DexMethod*>& get_referencing_code() {
+    return referencing_code;
+  }
+
  protected:
   SingleImpls single_impls;
+  std::unordered_set<DexMethod*> referencing_code;
 };
 
 struct OptimizeStats {
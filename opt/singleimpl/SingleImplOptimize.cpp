@@ -172,6 +172,13 @@ bool update_method_proto(const DexType* old_type_ref,
 
 using CheckCastSet = std::unordered_set<const IRInstruction*>;
 
+// The check-casts to the implementation of one interface that an
+// instruction list needs, as the instructions and their sources to cast.
+struct CheckCastFixup {
+  DexType* cls;
+  std::vector<std::pair<IRList::iterator, std::vector<src_index_t>>> insns;
+};
+
 struct OptimizationImpl {
   OptimizationImpl(std::unique_ptr<SingleImplAnalysis> analysis,
                    const ClassHierarchy& ch)
@@ -183,7 +190,7 @@ struct OptimizationImpl {
   EscapeReason can_optimize(const DexType* intf,
                             const SingleImplData& data,
                             bool rename_on_collision);
-  CheckCastSet do_optimize(const DexType* intf, const SingleImplData& data);
+  void do_optimize(const DexType* intf, const SingleImplData& data);
   EscapeReason check_field_collision(const DexType* intf,
                                      const SingleImplData& data);
   EscapeReason check_method_collision(const DexType* intf,
@@ -193,8 +200,8 @@ struct OptimizationImpl {
                                   DexMethod* method);
   void set_field_defs(const DexType* intf, const SingleImplData& data);
   void set_field_refs(const DexType* intf, const SingleImplData& data);
-  CheckCastSet fix_instructions(const DexType* intf,
-                                const SingleImplData& data);
+  void fix_instructions(const DexType* intf, const SingleImplData& data);
+  CheckCastSet insert_check_casts();
   void set_method_defs(const DexType* intf, const SingleImplData& data);
   void set_method_refs(const DexType* intf, const SingleImplData& data);
   void rewrite_interface_methods(const DexType* intf,
@@ -214,6 +221,8 @@ struct OptimizationImpl {
   std::unordered_set<DexType*> optimized;
   const ClassHierarchy& ch;
   std::unordered_map<std::string, size_t> deobfuscated_name_counters;
+  // Check-casts to insert after all the interfaces of the step are rewritten.
+  std::unordered_map<IRCode*, std::vector<CheckCastFixup>> m_check_cast_fixups;
 };
 
 /**
@@ -304,118 +313,117 @@ void for_all_methods(const T& methods, Fn fn, bool parallel = true) {
 //     foo(i); // Java source needs cast here.
 //   }
 //
-// This method inserts check-casts for each invoke parameter and
-// field value. Expectation is that unnecessary insertions (e.g.,
-// duplicate check-casts) will be eliminated, for example, in
-// `post_process`.
-CheckCastSet OptimizationImpl::fix_instructions(const DexType* intf,
-                                                const SingleImplData& data) {
-  if (data.referencing_methods.empty()) {
-    return {};
-  }
-  std::vector<const DexMethod*> methods;
-  methods.reserve(data.referencing_methods.size());
-  std::transform(data.referencing_methods.begin(),
-                 data.referencing_methods.end(), std::back_inserter(methods),
-                 [](auto& p) { return p.first; });
-  // The typical number of methods is too small, it is actually significant
-  // overhead to spin up pool threads to just let them die.
-  constexpr bool PARALLEL = false;
-
-  std::mutex ret_lock;
-  CheckCastSet ret;
-
-  for_all_methods(
-      methods,
-      [&](const DexMethod* caller_const) {
-        auto caller = const_cast<DexMethod*>(caller_const);
-        std::vector<reg_t> temps; // Cached temps.
-        auto code = caller->get_code();
-        redex_assert(!code->editable_cfg_built());
-
-        for (const auto& insn_it_pair : data.referencing_methods.at(caller)) {
-          auto insn_it = insn_it_pair.second;
-          auto insn = insn_it_pair.first;
-
-          auto temp_it = temps.begin();
-          auto add_check_cast = [&](reg_t reg) {
-            auto check_cast = new IRInstruction(OPCODE_CHECK_CAST);
-            check_cast->set_src(0, reg);
-            check_cast->set_type(data.cls);
-            code->insert_before(insn_it, *new MethodItemEntry(check_cast));
-
-            if (PARALLEL) {
-              std::unique_lock<std::mutex> lock(ret_lock);
-              ret.insert(check_cast);
-            } else {
-              ret.insert(check_cast);
-            }
-
-            // See if we need a new temp.
-            reg_t out;
-            if (temp_it == temps.end()) {
-              reg_t new_temp = code->allocate_temp();
-              temps.push_back(new_temp);
-              temp_it = temps.end();
-              out = new_temp;
-            } else {
-              out = *temp_it;
-              temp_it++;
-            }
-
-            auto pseudo_move_result =
-                new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO_OBJECT);
-            pseudo_move_result->set_dest(out);
-            code->insert_before(insn_it,
-                                *new MethodItemEntry(pseudo_move_result));
-
-            return out;
-          };
+// This method finds the invoke parameters and field values that need a
+// check-cast. They are inserted by `insert_check_casts` once all interfaces
+// of the step are rewritten, which only changes the types that the sources
+// are compared against here, not the instructions. Expectation is that
+// unnecessary insertions (e.g., duplicate check-casts) will be eliminated,
+// for example, in `post_process`.
+void OptimizationImpl::fix_instructions(const DexType* intf,
+                                        const SingleImplData& data) {
+  for (const auto& p : data.referencing_methods) {
+    auto code = p.first->get_code();
+    redex_assert(!code->editable_cfg_built());
+    CheckCastFixup fixup{data.cls, {}};
+    for (const auto& insn_it_pair : p.second) {
+      auto insn = insn_it_pair.first;
+      std::vector<src_index_t> srcs;
+
+      if (opcode::is_an_invoke(insn->opcode())) {
+        // We need check-casts for receiver and parameters, but not
+        // return type.
+
+        auto mref = insn->get_method();
+
+        // Receiver.
+        if (mref->get_class() == intf) {
+          srcs.push_back(0);
+        }
 
-          if (opcode::is_an_invoke(insn->opcode())) {
-            // We need check-casts for receiver and parameters, but not
-            // return type.
+        // Parameters.
+        const auto* arg_list = mref->get_proto()->get_args();
+        src_index_t idx = insn->opcode() == OPCODE_INVOKE_STATIC ? 0 : 1;
+        for (const auto arg : *arg_list) {
+          if (arg == intf) {
+            srcs.push_back(idx);
+          }
+          idx++;
+        }
+      } else if (opcode::is_an_iput(insn->opcode()) ||
+                 opcode::is_an_sput(insn->opcode())) {
+        // If the field type is the interface, need a check-cast.
+        auto fdef = insn->get_field();
+        if (fdef->get_type() == intf) {
+          srcs.push_back(0);
+        }
+      }
+      // Others do not need fixup.
 
-            auto mref = insn->get_method();
+      if (!srcs.empty()) {
+        fixup.insns.emplace_back(insn_it_pair.second, std::move(srcs));
+      }
+    }
+    if (!fixup.insns.empty()) {
+      m_check_cast_fixups[code].push_back(std::move(fixup));
+    }
+  }
+}
 
-            // Receiver.
-            if (mref->get_class() == intf) {
-              reg_t new_receiver = add_check_cast(insn->src(0));
-              insn->set_src(0, new_receiver);
-            }
+/**
+ * Insert the check-casts found by `fix_instructions`. The fixups of a method
+ * are applied in the order of the interfaces, as they would have been one
+ * interface at a time, and different methods are fixed in parallel.
+ */
+CheckCastSet OptimizationImpl::insert_check_casts() {
+  std::vector<IRCode*> codes;
+  codes.reserve(m_check_cast_fixups.size());
+  for (auto& p : m_check_cast_fixups) {
+    codes.push_back(p.first);
+  }
 
-            // Parameters.
-            const auto* arg_list = mref->get_proto()->get_args();
-            size_t idx = insn->opcode() == OPCODE_INVOKE_STATIC ? 0 : 1;
-            for (const auto arg : *arg_list) {
-              if (arg != intf) {
-                idx++;
-                continue;
+  std::mutex ret_lock;
+  CheckCastSet ret;
+  workqueue_run<IRCode*>(
+      [&](IRCode* code) {
+        std::vector<const IRInstruction*> inserted;
+        for (const auto& fixup : m_check_cast_fixups.at(code)) {
+          std::vector<reg_t> temps; // Cached temps.
+          for (const auto& [insn_it, srcs] : fixup.insns) {
+            auto insn = insn_it->insn;
+            auto temp_it = temps.begin();
+            for (auto idx : srcs) {
+              auto check_cast = new IRInstruction(OPCODE_CHECK_CAST);
+              check_cast->set_src(0, insn->src(idx));
+              check_cast->set_type(fixup.cls);
+              code->insert_before(insn_it, *new MethodItemEntry(check_cast));
+              inserted.push_back(check_cast);
+
+              // See if we need a new temp.
+              reg_t out;
+              if (temp_it == temps.end()) {
+                reg_t new_temp = code->allocate_temp();
+                temps.push_back(new_temp);
+                temp_it = temps.end();
+                out = new_temp;
+              } else {
+                out = *temp_it;
+                temp_it++;
               }
 
-              reg_t new_param = add_check_cast(insn->src(idx));
-              insn->set_src(idx, new_param);
-              idx++;
+              auto pseudo_move_result =
+                  new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO_OBJECT);
+              pseudo_move_result->set_dest(out);
+              code->insert_before(insn_it,
+                                  *new MethodItemEntry(pseudo_move_result));
+              insn->set_src(idx, out);
             }
-            continue;
           }
-
-          if (opcode::is_an_iput(insn->opcode()) ||
-              opcode::is_an_sput(insn->opcode())) {
-            // If the field type is the interface, need a check-cast.
-            auto fdef = insn->get_field();
-            if (fdef->get_type() == intf) {
-              reg_t new_param = add_check_cast(insn->src(0));
-              insn->set_src(0, new_param);
-            }
-            continue;
-          }
-
-          // Others do not need fixup.
         }
+        std::unique_lock<std::mutex> lock(ret_lock);
+        ret.insert(inserted.begin(), inserted.end());
       },
-      PARALLEL);
-
+      codes);
+  m_check_cast_fixups.clear();
   return ret;
 }
 
@@ -699,9 +707,9 @@ void OptimizationImpl::rename_possible_collisions(const DexType* intf,
 /**
  * Perform the optimization.
  */
-CheckCastSet OptimizationImpl::do_optimize(const DexType* intf,
-                                           const SingleImplData& data) {
-  CheckCastSet ret = fix_instructions(intf, data);
+void OptimizationImpl::do_optimize(const DexType* intf,
+                                   const SingleImplData& data) {
+  fix_instructions(intf, data);
   set_type_refs(intf, data);
   set_field_defs(intf, data);
   set_field_refs(intf, data);
@@ -709,7 +717,6 @@ CheckCastSet OptimizationImpl::do_optimize(const DexType* intf,
   set_method_refs(intf, data);
   rewrite_interface_methods(intf, data);
   remove_interface(intf, data);
-  return ret;
 }
 
 /**
@@ -721,7 +728,6 @@ OptimizeStats OptimizationImpl::optimize(Scope& scope,
   single_impls->get_interfaces(to_optimize);
   std::sort(to_optimize.begin(), to_optimize.end(), compare_dextypes);
   std::unordered_set<DexMethod*> for_post_processing;
-  CheckCastSet inserted_check_casts;
   for (auto intf : to_optimize) {
     auto& intf_data = single_impls->get_single_impl_data(intf);
     if (intf_data.is_escaped()) continue;
@@ -731,13 +737,13 @@ OptimizeStats OptimizationImpl::optimize(Scope& scope,
       single_impls->escape_interface(intf, escape);
       continue;
     }
-    auto check_casts = do_optimize(intf, intf_data);
-    inserted_check_casts.insert(check_casts.begin(), check_casts.end());
+    do_optimize(intf, intf_data);
     for (auto& p : intf_data.referencing_methods) {
       for_post_processing.insert(p.first);
     }
     optimized.insert(intf);
   }
+  CheckCastSet inserted_check_casts = insert_check_casts();
 
   // make a new scope deleting all single impl interfaces
   Scope new_scope;
@@ -7,6 +7,9 @@
 
 #include "StaticReloV2.h"
 
+#include <limits>
+#include <numeric>
+
 #include "ApiLevelChecker.h"
 #include "ClassHierarchy.h"
 #include "PassManager.h"
@@ -14,6 +17,7 @@
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 /**
  * Implementation:
@@ -29,6 +33,11 @@
  *    b. If a static method has no color, relocate it if it has only one caller,
  *       log it if it has no caller ( should be deleted by other pass ).
  *    c. If a static method has multiple colors, keep it unchanged.
+ *
+ * The code of the candidates and of the other classes is scanned in parallel.
+ * Coloring only follows call edges, so each weakly connected component of the
+ * graph is colored on its own, in parallel. The relocations are then decided
+ * in parallel and applied in the order of the vertices.
  */
 
 namespace {
@@ -84,6 +93,32 @@ struct StaticCallGraph {
   }
 };
 
+/**
+ * The vertices that the invoke-statics in the code call.
+ */
+std::vector<int> static_callees(const StaticCallGraph& graph,
+                                const IRCode* code) {
+  std::vector<int> callees;
+  for (const auto& mie : InstructionIterable(code)) {
+    if (mie.insn->opcode() != OPCODE_INVOKE_STATIC) {
+      continue;
+    }
+    DexMethod* callee =
+        resolve_method(mie.insn->get_method(), MethodSearch::Static);
+    auto it = graph.method_id_map.find(callee);
+    if (it != graph.method_id_map.end()) {
+      callees.push_back(it->second);
+    }
+  }
+  return callees;
+}
+
+std::vector<size_t> indices(size_t size) {
+  std::vector<size_t> result(size);
+  std::iota(result.begin(), result.end(), 0);
+  return result;
+}
+
 /**
  * Build call graph for all static methods in candidate classes
  */
@@ -99,28 +134,21 @@ void build_call_graph(const std::vector<DexClass*>& candidate_classes,
   graph.callers.resize(graph.vertices.size());
   graph.callees.resize(graph.vertices.size());
 
-  for (auto& meth_id : graph.method_id_map) {
-    DexMethod* caller = meth_id.first;
-    int caller_id = meth_id.second;
-    for (const auto& mie : InstructionIterable(caller->get_code())) {
-      if (mie.insn->has_method()) {
-        if (mie.insn->opcode() != OPCODE_INVOKE_STATIC) {
-          continue;
-        }
-        DexMethod* callee =
-            resolve_method(mie.insn->get_method(), MethodSearch::Static);
-        if (graph.method_id_map.find(callee) != graph.method_id_map.end()) {
-          int callee_id = graph.method_id_map[callee];
-          graph.callers[callee_id].insert(caller_id);
-          graph.callees[caller_id].insert(callee_id);
-        }
-      }
+  std::vector<std::vector<int>> callees(graph.vertices.size());
+  workqueue_run<size_t>(
+      [&](size_t id) {
+        callees[id] =
+            static_callees(graph, graph.vertices[id].method->get_code());
+      },
+      indices(graph.vertices.size()));
+  for (size_t caller_id = 0; caller_id < callees.size(); caller_id++) {
+    for (int callee_id : callees[caller_id]) {
+      graph.callers[callee_id].insert(caller_id);
+      graph.callees[caller_id].insert(callee_id);
     }
   }
 }
 
-void color_vertex(StaticCallGraph& graph, DexMethod* method, int color);
-
 void color_vertex(StaticCallGraph& graph,
                   StaticCallGraph::Vertex& vertex,
                   int color) {
@@ -132,8 +160,8 @@ void color_vertex(StaticCallGraph& graph,
     if (is_private(vertex.method)) {
       // color callers within the same class of this private vertex.method
       for (int caller_id : graph.callers[vertex.id]) {
-        DexMethod* caller = graph.vertices[caller_id].method;
-        if (caller->get_class() == vertex.method->get_class()) {
+        auto& caller = graph.vertices[caller_id];
+        if (caller.method->get_class() == vertex.method->get_class()) {
           color_vertex(graph, caller, color);
         }
       }
@@ -141,83 +169,167 @@ void color_vertex(StaticCallGraph& graph,
   }
 }
 
-void color_vertex(StaticCallGraph& graph, DexMethod* method, int color) {
-  // Assume the method is in the map
-  always_assert(graph.method_id_map.count(method) == 1);
-  int method_id = graph.method_id_map[method];
-  color_vertex(graph, graph.vertices[method_id], color);
+/**
+ * Number the weakly connected components of the graph. Coloring a vertex only
+ * reaches vertices in its component.
+ */
+std::vector<size_t> connected_components(const StaticCallGraph& graph,
+                                         size_t* num_components) {
+  constexpr size_t NONE = std::numeric_limits<size_t>::max();
+  std::vector<size_t> component(graph.vertices.size(), NONE);
+  size_t count = 0;
+  std::vector<int> stack;
+  for (size_t root = 0; root < graph.vertices.size(); root++) {
+    if (component[root] != NONE) {
+      continue;
+    }
+    component[root] = count;
+    stack.push_back(root);
+    while (!stack.empty()) {
+      int id = stack.back();
+      stack.pop_back();
+      for (const auto* neighbors : {&graph.callees[id], &graph.callers[id]}) {
+        for (int other : *neighbors) {
+          if (component[other] == NONE) {
+            component[other] = count;
+            stack.push_back(other);
+          }
+        }
+      }
+    }
+    count++;
+  }
+  *num_components = count;
+  return component;
 }
 
 /**
- * Color the vertices for a class
+ * Color the vertices from all the classes that are not candidates. A class
+ * colors the static methods that it calls with its index in the scope.
  * For private static method, should color all the caller within the class to
  * the same color
  */
-void color_from_a_class(StaticCallGraph& graph, DexClass* cls, int color) {
-  auto process_method = [&](DexMethod* caller) {
-    IRCode* code = caller->get_code();
-    if (code == nullptr) {
-      return;
-    }
-    for (const auto& mie : InstructionIterable(code)) {
-      if (mie.insn->has_method()) {
-        if (mie.insn->opcode() != OPCODE_INVOKE_STATIC) {
-          continue;
+void color_from_classes(const Scope& scope,
+                        const std::unordered_set<DexClass*>& candidates,
+                        StaticCallGraph& graph) {
+  std::vector<std::vector<int>> class_callees(scope.size());
+  workqueue_run<size_t>(
+      [&](size_t color) {
+        DexClass* cls = scope[color];
+        if (candidates.count(cls)) {
+          return;
         }
-        DexMethod* callee =
-            resolve_method(mie.insn->get_method(), MethodSearch::Static);
-        if (graph.method_id_map.find(callee) != graph.method_id_map.end()) {
-          color_vertex(graph, callee, color);
+        auto& callees = class_callees[color];
+        auto process_method = [&](DexMethod* caller) {
+          IRCode* code = caller->get_code();
+          if (code == nullptr) {
+            return;
+          }
+          auto ids = static_callees(graph, code);
+          callees.insert(callees.end(), ids.begin(), ids.end());
+        };
+        for (DexMethod* method : cls->get_vmethods()) {
+          process_method(method);
         }
-      }
+        for (DexMethod* method : cls->get_dmethods()) {
+          process_method(method);
+        }
+      },
+      indices(scope.size()));
+
+  size_t num_components;
+  auto component = connected_components(graph, &num_components);
+  // The (color, vertex) pairs to color in each component. Colored vertices
+  // only depend on the set of colors that reach them, but the colors are
+  // still applied in the order of the scope.
+  std::vector<std::vector<std::pair<int, int>>> seeds(num_components);
+  for (size_t color = 0; color < class_callees.size(); color++) {
+    for (int id : class_callees[color]) {
+      seeds[component[id]].emplace_back(color, id);
     }
-  };
-  for (DexMethod* method : cls->get_vmethods()) {
-    process_method(method);
   }
-  for (DexMethod* method : cls->get_dmethods()) {
-    process_method(method);
+  workqueue_run<size_t>(
+      [&](size_t c) {
+        for (const auto& [color, id] : seeds[c]) {
+          color_vertex(graph, graph.vertices[id], color);
+        }
+      },
+      indices(num_components));
+}
+
+/**
+ * Where a static method goes, if anywhere.
+ */
+struct Relocation {
+  // The class to relocate to
+  DexType* to_type{nullptr};
+  // For a method without color, the caller into whose class it goes. Callers
+  // may move too, so the class is only looked up when relocating.
+  DexMethod* to_caller_class{nullptr};
+  bool make_public{false};
+};
+
+Relocation decide_relocation(const StaticCallGraph& graph,
+                             const StaticCallGraph::Vertex& vertex,
+                             const Scope& scope) {
+  Relocation relocation;
+  // Vertex is not colored, which means the method is unreachable outside the
+  // static call graph. Do the proper logging or relocation for them if there
+  // are such kind of unreachable static methods.
+  if (vertex.color == -1) {
+    int number_of_callers = graph.callers[vertex.id].size();
+    TRACE(STATIC_RELO, 4,
+          "method %s has %d static method callers, and the method and its "
+          "callers are all unreachable from other classes. Enable "
+          "RemoveUnreachablePass to remove them.",
+          show(vertex.method).c_str(), number_of_callers);
+    if (number_of_callers == 1) {
+      // Relocate the unreachable method to its caller class if only one
+      // caller
+      int caller_id = *graph.callers[vertex.id].begin();
+      relocation.to_caller_class = graph.vertices[caller_id].method;
+      relocation.make_public = true;
+    }
+  } else if (vertex.color >= 0) {
+    // only one color
+    auto to_class = type_class(scope[vertex.color]->get_type());
+    // We can relocate method to a class only if the api level of the class is
+    // higher or equal to the api level of the method.
+    if (to_class->rstate.get_api_level() >=
+        api::LevelChecker::get_method_level(vertex.method)) {
+      relocation.to_type = to_class->get_type();
+    }
+    relocation.make_public = true;
   }
+  // keep multiple colored vertices untouched
+  return relocation;
 }
 
 /**
  * Relocate static methods in the graph to their callers
  */
 int relocate_clusters(const StaticCallGraph& graph, const Scope& scope) {
+  std::vector<Relocation> relocations(graph.vertices.size());
+  workqueue_run<size_t>(
+      [&](size_t id) {
+        relocations[id] = decide_relocation(graph, graph.vertices[id], scope);
+      },
+      indices(graph.vertices.size()));
+
   int relocated_methods = 0;
-  for (const StaticCallGraph::Vertex& vertex : graph.vertices) {
-    // Vertex is not colored, which means the method is unreachable outside the
-    // static call graph. Do the proper logging or relocation for them if there
-    // are such kind of unreachable static methods.
-    if (vertex.color == -1) {
-      int number_of_callers = graph.callers[vertex.id].size();
-      TRACE(STATIC_RELO, 4,
-            "method %s has %d static method callers, and the method and its "
-            "callers are all unreachable from other classes. Enable "
-            "RemoveUnreachablePass to remove them.",
-            show(vertex.method).c_str(), number_of_callers);
-      if (number_of_callers == 1) {
-        // Relocate the unreachable method to its caller class if only one
-        // caller
-        int caller_id = *graph.callers[vertex.id].begin();
-        DexMethod* caller = graph.vertices[caller_id].method;
-        relocate_method(vertex.method, caller->get_class());
-        relocated_methods++;
-        set_public(vertex.method);
-      }
-    } else if (vertex.color >= 0) {
-      // only one color
-      auto to_class = type_class(scope[vertex.color]->get_type());
-      // We can relocate method to a class only if the api level of the class is
-      // higher or equal to the api level of the method.
-      if (to_class->rstate.get_api_level() >=
-          api::LevelChecker::get_method_level(vertex.method)) {
-        relocate_method(vertex.method, to_class->get_type());
-        relocated_methods++;
-      }
-      set_public(vertex.method);
+  for (size_t id = 0; id < relocations.size(); id++) {
+    DexMethod* method = graph.vertices[id].method;
+    const auto& relocation = relocations[id];
+    DexType* to_type = relocation.to_caller_class != nullptr
+                           ? relocation.to_caller_class->get_class()
+                           : relocation.to_type;
+    if (to_type != nullptr) {
+      relocate_method(method, to_type);
+      relocated_methods++;
+    }
+    if (relocation.make_public) {
+      set_public(method);
     }
-    // keep multiple colored vertices untouched
   }
   return relocated_methods;
 }
@@ -231,29 +343,39 @@ namespace static_relo_v2 {
  * and deleted.
  */
 std::vector<DexClass*> StaticReloPassV2::gen_candidates(const Scope& scope) {
-  std::vector<DexClass*> candidate_classes;
   ClassHierarchy ch = build_type_hierarchy(scope);
-  walk::classes(scope, [&](DexClass* cls) {
-    if (!cls->is_external() && get_children(ch, cls->get_type()).empty() &&
-        !is_interface(cls) && cls->get_ifields().empty() &&
-        cls->get_sfields().empty() && cls->get_vmethods().empty()) {
-      for (const auto& method : cls->get_dmethods()) {
-        if (!is_static(method) || !can_rename(method) || !can_delete(method) ||
-            method->rstate.no_optimizations()) {
-          return;
-        }
-        if (method->get_code() == nullptr) {
-          return;
-        }
+  auto is_candidate = [&](DexClass* cls) {
+    if (cls->is_external() || !get_children(ch, cls->get_type()).empty() ||
+        is_interface(cls) || !cls->get_ifields().empty() ||
+        !cls->get_sfields().empty() || !cls->get_vmethods().empty()) {
+      return false;
+    }
+    for (const auto& method : cls->get_dmethods()) {
+      if (!is_static(method) || !can_rename(method) || !can_delete(method) ||
+          method->rstate.no_optimizations()) {
+        return false;
       }
-      if (method::clinit_may_have_side_effects(cls)) {
-        TRACE(STATIC_RELO, 9, "%s class initializer may have side effects",
-              SHOW(cls));
-        return;
+      if (method->get_code() == nullptr) {
+        return false;
       }
-      candidate_classes.push_back(cls);
     }
-  });
+    if (method::clinit_may_have_side_effects(cls)) {
+      TRACE(STATIC_RELO, 9, "%s class initializer may have side effects",
+            SHOW(cls));
+      return false;
+    }
+    return true;
+  };
+  std::vector<uint8_t> candidates(scope.size());
+  workqueue_run<size_t>(
+      [&](size_t i) { candidates[i] = is_candidate(scope[i]); },
+      indices(scope.size()));
+  std::vector<DexClass*> candidate_classes;
+  for (size_t i = 0; i < scope.size(); i++) {
+    if (candidates[i]) {
+      candidate_classes.push_back(scope[i]);
+    }
+  }
   return candidate_classes;
 }
 
@@ -263,12 +385,7 @@ int StaticReloPassV2::run_relocation(
   build_call_graph(candidate_classes, graph);
   std::unordered_set<DexClass*> set(candidate_classes.begin(),
                                     candidate_classes.end());
-  for (size_t color = 0; color < scope.size(); color++) {
-    if (set.find(scope[color]) != set.end()) {
-      continue;
-    }
-    color_from_a_class(graph, scope[color], color);
-  }
+  color_from_classes(scope, set, graph);
 
   return relocate_clusters(graph, scope);
 }
@@ -16,6 +16,7 @@
 #include "ControlFlow.h"
 #include "DexClass.h"
 #include "IRCode.h"
+#include "MethodUtil.h"
 #include "PassManager.h"
 #include "Resolver.h"
 #include "Show.h"
@@ -388,6 +389,12 @@ void StringConcatenatorPass::run_pass(DexStoresVector& stores,
           // will have to consider StringBuilders passed in as arguments.
           return Stats{};
         }
+        if (!method::any_insn(*code, [&config](const IRInstruction* insn) {
+              return insn->opcode() == OPCODE_NEW_INSTANCE &&
+                     insn->get_type() == config.string_builder;
+            })) {
+          return Stats{};
+        }
 
         code->build_cfg(/* editable */ true);
         Stats stats =
@@ -14,6 +14,7 @@
 #include "Creators.h"
 #include "DexAsm.h"
 #include "DexClass.h"
+#include "MethodUtil.h"
 #include "PassManager.h"
 #include "Show.h"
 #include "Trace.h"
@@ -197,6 +198,15 @@ void Outliner::gather_outline_candidate_typelists(
 }
 
 void Outliner::analyze(IRCode& code) {
+  // Most methods have no StringBuilder.toString() calls, so check for them
+  // before building a CFG.
+  if (!method::any_insn(code, [this](const IRInstruction* insn) {
+        return insn->opcode() == OPCODE_INVOKE_VIRTUAL &&
+               insn->get_method() == m_stringbuilder_tostring;
+      })) {
+    return;
+  }
+
   code.build_cfg(/* editable */ false); // Not editable because of T42743620
   auto& cfg = code.cfg();
   cfg.calculate_exit_block();
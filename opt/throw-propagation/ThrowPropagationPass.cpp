@@ -66,29 +66,34 @@ void ThrowPropagationPass::bind_config() {
        "have no return.");
 }
 
+bool ThrowPropagationPass::is_no_return_method(const Config& config,
+                                               DexMethod* method) {
+  if (is_abstract(method) || method->is_external() || is_native(method) ||
+      method->rstate.no_optimizations()) {
+    return false;
+  }
+  if (config.blocklist.count(method->get_class())) {
+    TRACE(TP, 4, "black-listed method: %s", SHOW(method));
+    return false;
+  }
+  bool can_return{false};
+  editable_cfg_adapter::iterate_with_iterator(
+      method->get_code(), [&can_return](const IRList::iterator& it) {
+        if (opcode::is_a_return(it->insn->opcode())) {
+          can_return = true;
+          return editable_cfg_adapter::LOOP_BREAK;
+        } else {
+          return editable_cfg_adapter::LOOP_CONTINUE;
+        }
+      });
+  return !can_return;
+}
+
 std::unordered_set<DexMethod*> ThrowPropagationPass::get_no_return_methods(
     const Config& config, const Scope& scope) {
   ConcurrentSet<DexMethod*> concurrent_no_return_methods;
   walk::parallel::methods(scope, [&](DexMethod* method) {
-    if (is_abstract(method) || method->is_external() || is_native(method) ||
-        method->rstate.no_optimizations()) {
-      return;
-    }
-    if (config.blocklist.count(method->get_class())) {
-      TRACE(TP, 4, "black-listed method: %s", SHOW(method));
-      return;
-    }
-    bool can_return{false};
-    editable_cfg_adapter::iterate_with_iterator(
-        method->get_code(), [&can_return](const IRList::iterator& it) {
-          if (opcode::is_a_return(it->insn->opcode())) {
-            can_return = true;
-            return editable_cfg_adapter::LOOP_BREAK;
-          } else {
-            return editable_cfg_adapter::LOOP_CONTINUE;
-          }
-        });
-    if (!can_return) {
+    if (is_no_return_method(config, method)) {
       concurrent_no_return_methods.insert(method);
     }
   });
@@ -101,9 +106,26 @@ ThrowPropagationPass::Stats ThrowPropagationPass::run(
     const Config& config,
     const std::unordered_set<DexMethod*>& no_return_methods,
     const method_override_graph::Graph& graph,
-    IRCode* code) {
+    IRCode* code,
+    NoReturnInvokes* no_return_invokes) {
   ThrowPropagationPass::Stats stats;
   cfg::ScopedCFG cfg(code);
+  auto is_no_return_callee = [&](DexMethod* method) {
+    bool invoke_can_return{false};
+    auto check_for_no_return = [&](DexMethod* other_method) {
+      if (!no_return_methods.count(other_method)) {
+        invoke_can_return = true;
+      }
+      return true;
+    };
+    if (!process_base_and_overriding_methods(
+            &graph, method, /* methods_to_ignore */ nullptr,
+            /* ignore_methods_with_assumenosideeffects */ false,
+            check_for_no_return)) {
+      return false;
+    }
+    return !invoke_can_return;
+  };
   auto is_no_return_invoke = [&](IRInstruction* insn) {
     if (!opcode::is_an_invoke(insn->opcode())) {
       return false;
@@ -122,20 +144,16 @@ ThrowPropagationPass::Stats ThrowPropagationPass::run(
       TRACE(TP, 4, "annotation interface method: %s", SHOW(method));
       return false;
     }
-    bool invoke_can_return{false};
-    auto check_for_no_return = [&](DexMethod* other_method) {
-      if (!no_return_methods.count(other_method)) {
-        invoke_can_return = true;
-      }
-      return true;
-    };
-    if (!process_base_and_overriding_methods(
-            &graph, method, /* methods_to_ignore */ nullptr,
-            /* ignore_methods_with_assumenosideeffects */ false,
-            check_for_no_return)) {
-      return false;
+    if (no_return_invokes == nullptr) {
+      return is_no_return_callee(method);
     }
-    return !invoke_can_return;
+    auto it = no_return_invokes->find(method);
+    if (it != no_return_invokes->end()) {
+      return it->second;
+    }
+    bool no_return = is_no_return_callee(method);
+    no_return_invokes->emplace(method, no_return);
+    return no_return;
   };
 
   boost::optional<std::pair<reg_t, reg_t>> regs;
@@ -298,13 +316,15 @@ void ThrowPropagationPass::run_pass(DexStoresVector& stores,
     }
   });
   auto override_graph = method_override_graph::build_graph(scope);
+  // Inserting throws only ever removes returns, so after the first iteration
+  // only the methods that were changed can join the no-return methods.
+  std::unordered_set<DexMethod*> no_return_methods =
+      get_no_return_methods(m_config, scope);
   size_t last_no_return_methods{0};
   int iterations = 0;
   Stats stats;
   while (true) {
     iterations++;
-    std::unordered_set<DexMethod*> no_return_methods =
-        get_no_return_methods(m_config, scope);
     TRACE(TP,
           2,
           "iteration %d, no_return_methods: %zu",
@@ -314,6 +334,8 @@ void ThrowPropagationPass::run_pass(DexStoresVector& stores,
       break;
     }
     last_no_return_methods = no_return_methods.size();
+    NoReturnInvokes no_return_invokes;
+    ConcurrentSet<DexMethod*> changed_methods;
     auto last_stats =
         walk::parallel::methods<Stats>(scope, [&](DexMethod* method) -> Stats {
           auto code = method->get_code();
@@ -321,12 +343,22 @@ void ThrowPropagationPass::run_pass(DexStoresVector& stores,
             return {};
           }
 
-          return run(m_config, no_return_methods, *override_graph, code);
+          auto method_stats = run(m_config, no_return_methods,
+                                  *override_graph, code, &no_return_invokes);
+          if (method_stats.throws_inserted > 0) {
+            changed_methods.insert(method);
+          }
+          return method_stats;
         });
     if (last_stats.throws_inserted == 0) {
       break;
     }
     stats += last_stats;
+    for (auto* method : changed_methods) {
+      if (is_no_return_method(m_config, method)) {
+        no_return_methods.insert(method);
+      }
+    }
   }
 
   walk::parallel::code(scope, [&](const DexMethod* method, IRCode& code) {
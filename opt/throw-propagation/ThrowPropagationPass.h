@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "ConcurrentContainers.h"
 #include "DexStore.h"
 #include "MethodOverrideGraph.h"
 #include "Pass.h"
@@ -33,12 +34,20 @@ class ThrowPropagationPass : public Pass {
 
   void bind_config() override;
 
+  // Whether invoking a resolved method never returns, given all the methods
+  // that may be invoked in its place. It only depends on the set of no-return
+  // methods, so it can be shared by all invokes until that set changes.
+  using NoReturnInvokes = ReadOptimizedConcurrentMap<const DexMethod*, bool>;
+
+  static bool is_no_return_method(const Config& config, DexMethod* method);
+
   static std::unordered_set<DexMethod*> get_no_return_methods(
       const Config& config, const Scope& scope);
 
   static Stats run(const Config& config,
                    const std::unordered_set<DexMethod*>& no_return_methods,
                    const method_override_graph::Graph& graph,
-                   IRCode* code);
+                   IRCode* code,
+                   NoReturnInvokes* no_return_invokes = nullptr);
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 };
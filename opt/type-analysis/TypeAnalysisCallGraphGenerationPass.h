@@ -38,6 +38,7 @@ class TypeAnalysisCallGraphGenerationPass : public Pass {
   void set_analysis_usage(AnalysisUsage& au) const override {
     au.add_required<GlobalTypeAnalysisPass>();
     au.set_preserve_all();
+    au.set_preserve_method_analyses();
   }
 
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
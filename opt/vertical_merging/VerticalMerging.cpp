@@ -71,6 +71,21 @@ void record_dont_merge_state(
   }
 }
 
+// Joins the states recorded on different threads, kStrict winning over
+// kConditional as above.
+struct JoinDontMergeStatus {
+  void operator()(
+      const std::unordered_map<const DexType*, DontMergeState>& addend,
+      std::unordered_map<const DexType*, DontMergeState>* accumulator) const {
+    for (const auto& pair : addend) {
+      auto [it, inserted] = accumulator->emplace(pair);
+      if (!inserted && pair.second == kStrict) {
+        it->second = kStrict;
+      }
+    }
+  }
+};
+
 /**
  * Check child class and parent class's DontMergeState and decide which class
  * should be merged into which class, or not merge at all.
@@ -323,73 +338,68 @@ void record_annotation(
  * mergeables.
  */
 void record_code_reference(
-    const Scope& scope,
+    IRInstruction* insn,
     std::unordered_map<const DexType*, DontMergeState>* dont_merge_status) {
-  walk::opcodes(
-      scope,
-      [](DexMethod* method) { return true; },
-      [&](DexMethod* method, IRInstruction* insn) {
-        if (insn->has_type()) {
-          auto type = type::get_element_type_if_array(insn->get_type());
-          if (opcode::is_instance_of(insn->opcode())) {
-            // We don't want to merge class if either merger or
-            // mergeable was ever accessed in instance_of to prevent
-            // semantic error.
-            record_dont_merge_state(type, kStrict, dont_merge_status);
-            return;
-          } else {
-            DexClass* cls = type_class(type);
-            if (cls && !is_abstract(cls)) {
-              // If a type is referenced and not an abstract type then
-              // add it to don't use this type as mergeable.
-              record_dont_merge_state(type, kConditional, dont_merge_status);
-              TRACE(VMERGE, 9, "dont_merge %s as mergeable for type usage: %s",
-                    SHOW(type), SHOW(insn));
-            }
-          }
-        } else if (insn->has_field()) {
-          DexField* field = resolve_field(insn->get_field());
-          if (field != nullptr) {
-            bool resolve_differently =
-                field->get_class() != insn->get_field()->get_class();
-            if (resolve_differently) {
-              // If a field reference need to be resolved, don't merge as
-              // renaming it might cause problems.
-              // If a field that can't be renamed is being referenced. Don't
-              // merge it as we need the field and this field can't be renamed
-              // if having collision.
-              // TODO(suree404): can improve.
-              record_dont_merge_state(field->get_class(), kStrict,
-                                      dont_merge_status);
-              record_dont_merge_state(insn->get_field()->get_class(), kStrict,
-                                      dont_merge_status);
-            }
-          } else {
-            record_dont_merge_state(insn->get_field()->get_class(),
-                                    kConditional, dont_merge_status);
-          }
-        } else if (insn->has_method()) {
-          auto callee_ref = insn->get_method();
-          if (opcode::is_invoke_super(insn->opcode())) {
-            // The only allowed pure ref is in invoke-super.
-            return;
-          }
-          if (!is_internal_def(callee_ref)) {
-            record_dont_merge_state(callee_ref->get_class(), kStrict,
-                                    dont_merge_status);
-            TRACE(VMERGE, 9, "dont_merge %s for pure ref %s",
-                  SHOW(callee_ref->get_class()), SHOW(callee_ref));
-            DexMethod* callee = resolve_method(callee_ref, MethodSearch::Any);
-            if (callee) {
-              record_dont_merge_state(callee->get_class(), kStrict,
-                                      dont_merge_status);
-              TRACE(VMERGE, 9,
-                    "dont_merge %s for it may be invoked as a pure ref %s",
-                    SHOW(callee->get_class()), SHOW(callee_ref));
-            }
-          }
-        }
-      });
+  if (insn->has_type()) {
+    auto type = type::get_element_type_if_array(insn->get_type());
+    if (opcode::is_instance_of(insn->opcode())) {
+      // We don't want to merge class if either merger or
+      // mergeable was ever accessed in instance_of to prevent
+      // semantic error.
+      record_dont_merge_state(type, kStrict, dont_merge_status);
+      return;
+    } else {
+      DexClass* cls = type_class(type);
+      if (cls && !is_abstract(cls)) {
+        // If a type is referenced and not an abstract type then
+        // add it to don't use this type as mergeable.
+        record_dont_merge_state(type, kConditional, dont_merge_status);
+        TRACE(VMERGE, 9, "dont_merge %s as mergeable for type usage: %s",
+              SHOW(type), SHOW(insn));
+      }
+    }
+  } else if (insn->has_field()) {
+    DexField* field = resolve_field(insn->get_field());
+    if (field != nullptr) {
+      bool resolve_differently =
+          field->get_class() != insn->get_field()->get_class();
+      if (resolve_differently) {
+        // If a field reference need to be resolved, don't merge as
+        // renaming it might cause problems.
+        // If a field that can't be renamed is being referenced. Don't
+        // merge it as we need the field and this field can't be renamed
+        // if having collision.
+        // TODO(suree404): can improve.
+        record_dont_merge_state(field->get_class(), kStrict,
+                                dont_merge_status);
+        record_dont_merge_state(insn->get_field()->get_class(), kStrict,
+                                dont_merge_status);
+      }
+    } else {
+      record_dont_merge_state(insn->get_field()->get_class(), kConditional,
+                              dont_merge_status);
+    }
+  } else if (insn->has_method()) {
+    auto callee_ref = insn->get_method();
+    if (opcode::is_invoke_super(insn->opcode())) {
+      // The only allowed pure ref is in invoke-super.
+      return;
+    }
+    if (!is_internal_def(callee_ref)) {
+      record_dont_merge_state(callee_ref->get_class(), kStrict,
+                              dont_merge_status);
+      TRACE(VMERGE, 9, "dont_merge %s for pure ref %s",
+            SHOW(callee_ref->get_class()), SHOW(callee_ref));
+      DexMethod* callee = resolve_method(callee_ref, MethodSearch::Any);
+      if (callee) {
+        record_dont_merge_state(callee->get_class(), kStrict,
+                                dont_merge_status);
+        TRACE(VMERGE, 9,
+              "dont_merge %s for it may be invoked as a pure ref %s",
+              SHOW(callee->get_class()), SHOW(callee_ref));
+      }
+    }
+  }
 }
 
 /**
@@ -398,19 +408,40 @@ void record_code_reference(
  * signature.
  */
 void record_method_signature(
-    const Scope& scope,
+    DexMethod* method,
     std::unordered_map<const DexType*, DontMergeState>* dont_merge_status) {
-  walk::methods(scope, [&](DexMethod* method) {
-    if (is_native(method) || !can_rename(method)) {
-      DexProto* proto = method->get_proto();
-      record_dont_merge_state(proto->get_rtype(), kConditional,
-                              dont_merge_status);
-      DexTypeList* args = proto->get_args();
-      for (const DexType* type : *args) {
-        record_dont_merge_state(type, kConditional, dont_merge_status);
-      }
+  if (is_native(method) || !can_rename(method)) {
+    DexProto* proto = method->get_proto();
+    record_dont_merge_state(proto->get_rtype(), kConditional,
+                            dont_merge_status);
+    DexTypeList* args = proto->get_args();
+    for (const DexType* type : *args) {
+      record_dont_merge_state(type, kConditional, dont_merge_status);
     }
-  });
+  }
+}
+
+/**
+ * Records the code references and method signatures of all methods in a
+ * single parallel walk, each thread into a map of its own.
+ */
+void record_methods(
+    const Scope& scope,
+    std::unordered_map<const DexType*, DontMergeState>* dont_merge_status) {
+  using DontMergeStatus = std::unordered_map<const DexType*, DontMergeState>;
+  auto status = walk::parallel::methods<DontMergeStatus, JoinDontMergeStatus>(
+      scope, [](DexMethod* method, DontMergeStatus* thread_status) {
+        record_method_signature(method, thread_status);
+        auto code = method->get_code();
+        if (code == nullptr) {
+          return;
+        }
+        editable_cfg_adapter::iterate(code, [&](MethodItemEntry& mie) {
+          record_code_reference(mie.insn, thread_status);
+          return editable_cfg_adapter::LOOP_CONTINUE;
+        });
+      });
+  JoinDontMergeStatus()(status, dont_merge_status);
 }
 
 void record_blocklist(
@@ -473,9 +504,8 @@ void record_referenced(
     std::unordered_map<const DexType*, DontMergeState>* dont_merge_status,
     const std::vector<std::string>& blocklist) {
   record_annotation(scope, dont_merge_status);
-  record_code_reference(scope, dont_merge_status);
+  record_methods(scope, dont_merge_status);
   record_field_reference(scope, dont_merge_status);
-  record_method_signature(scope, dont_merge_status);
   record_blocklist(scope, dont_merge_status, blocklist);
 }
 
@@ -760,7 +790,8 @@ void VerticalMergingPass::move_methods(DexClass* from_cls,
 }
 
 void VerticalMergingPass::merge_classes(const Scope& scope,
-                                        const ClassMap& mergeable_to_merger) {
+                                        const ClassMap& mergeable_to_merger,
+                                        AccumulatingTimer* updating_timer) {
   std::unordered_map<DexType*, DexType*> update_map;
   // To store the needed changes from `Mergeable.method` to `Merger.method`.
   MethodRefMap methodref_update_map;
@@ -788,6 +819,7 @@ void VerticalMergingPass::merge_classes(const Scope& scope,
     merger->combine_annotations_with(mergeable);
     merger->rstate.join_with(mergeable->rstate);
   }
+  auto timer_scope = updating_timer->scope();
   update_references(scope, update_map, methodref_update_map);
 }
 
@@ -796,20 +828,36 @@ void VerticalMergingPass::run_pass(DexStoresVector& stores,
                                    PassManager& mgr) {
   auto scope = build_class_scope(stores);
 
-  std::unordered_map<const DexType*, DontMergeState> dont_merge_status;
-  record_referenced(scope, &dont_merge_status, m_blocklist);
-  XStoreRefs xstores(stores);
+  AccumulatingTimer collecting_timer;
+  ClassMap mergeable_to_merger;
   size_t num_single_extend;
-  auto mergeable_to_merger =
-      collect_can_merge(scope, xstores, dont_merge_status, &num_single_extend);
-
-  remove_both_have_clinit(&mergeable_to_merger);
+  {
+    auto timer_scope = collecting_timer.scope();
+    std::unordered_map<const DexType*, DontMergeState> dont_merge_status;
+    record_referenced(scope, &dont_merge_status, m_blocklist);
+    XStoreRefs xstores(stores);
+    mergeable_to_merger = collect_can_merge(scope, xstores, dont_merge_status,
+                                            &num_single_extend);
+
+    remove_both_have_clinit(&mergeable_to_merger);
+  }
 
-  merge_classes(scope, mergeable_to_merger);
-  remove_merged(scope, mergeable_to_merger);
+  // All merges are applied at once, so that their references are updated in a
+  // single sweep over the scope.
+  AccumulatingTimer merging_timer;
+  AccumulatingTimer updating_timer;
+  {
+    auto timer_scope = merging_timer.scope();
+    merge_classes(scope, mergeable_to_merger, &updating_timer);
+    remove_merged(scope, mergeable_to_merger);
+  }
   post_dexen_changes(scope, stores);
   mgr.set_metric("num_single_extend", num_single_extend);
   mgr.set_metric("num_merged", mergeable_to_merger.size());
+  mgr.set_metric("collecting_us", collecting_timer.get_microseconds());
+  mgr.set_metric("merging_us", merging_timer.get_microseconds());
+  mgr.set_metric("updating_references_us",
+                 updating_timer.get_microseconds());
 }
 
 static VerticalMergingPass s_pass;
@@ -10,6 +10,7 @@
 #include "DexClass.h"
 #include "Inliner.h"
 #include "Pass.h"
+#include "Timer.h"
 
 /**
  * Merge classes vertically. (see below situation)
@@ -30,7 +31,8 @@ class VerticalMergingPass : public Pass {
 
  private:
   void merge_classes(const Scope&,
-                     const std::unordered_map<DexClass*, DexClass*>&);
+                     const std::unordered_map<DexClass*, DexClass*>&,
+                     AccumulatingTimer* updating_timer);
 
   void move_methods(DexClass*,
                     DexClass*,
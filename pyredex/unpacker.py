@@ -829,10 +829,17 @@ class ZipManager:
 
     per_file_compression: typing.Dict[str, int] = {}
 
-    def __init__(self, input_apk: str, extracted_apk_dir: str, output_apk: str) -> None:
+    def __init__(
+        self,
+        input_apk: str,
+        extracted_apk_dir: str,
+        output_apk: str,
+        repack_binary: typing.Optional[str] = None,
+    ) -> None:
         self.input_apk = input_apk
         self.extracted_apk_dir = extracted_apk_dir
         self.output_apk = output_apk
+        self.repack_binary = repack_binary
 
     def __enter__(self) -> None:
         log("Extracting apk...")
@@ -847,6 +854,17 @@ class ZipManager:
             os.remove(self.output_apk)
 
         log("Creating output apk")
+        if self.repack_binary:
+            # Writes the same entries, with the same compression, in parallel.
+            subprocess.check_call(
+                [
+                    self.repack_binary,
+                    self.input_apk,
+                    self.extracted_apk_dir,
+                    self.output_apk,
+                ]
+            )
+            return
         with zipfile.ZipFile(self.output_apk, "w") as new_apk:
             # Need sorted output for deterministic zip file. Sorting `dirnames` will
             # ensure the tree walk order. Sorting `filenames` will ensure the files
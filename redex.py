@@ -291,6 +291,10 @@ def run_redex_binary(
 
     args += state.dexen
 
+    # Resume from intermediate dex and IR meta data written by a previous run.
+    if state.args.input_ir:
+        args += ["--input-ir", state.args.input_ir]
+
     # Stop before a pass and output intermediate dex and IR meta data.
     if state.stop_pass_idx != -1:
         args += [
@@ -520,6 +524,13 @@ Given an APK, produce a better APK!
         "--redex-binary", nargs="?", default=binary, help="Path to redex binary"
     )
 
+    parser.add_argument(
+        "--zip-repack-binary",
+        default=None,
+        help="Path to a zip-repack binary, which creates the output apk in "
+        "parallel instead of the Python zip writer",
+    )
+
     parser.add_argument("-c", "--config", default=config, help="Configuration file")
 
     argparse_yes_no_flag(parser, "sign", help="Sign the apk after optimizing it")
@@ -661,6 +672,11 @@ Given an APK, produce a better APK!
         default="",
         help="Stop before stop_pass and dump intermediate dex and IR meta data to output_ir folder",
     )
+    parser.add_argument(
+        "--input-ir",
+        default="",
+        help="Resume from the intermediate dex and IR meta data in an output_ir folder, skipping the passes before its stop_pass. The passes list must be the one it was written with",
+    )
     parser.add_argument(
         "--debug-source-root",
         default=None,
@@ -981,7 +997,12 @@ def prepare_redex(args: argparse.Namespace) -> State:
 
         directory = make_temp_dir(".redex_unaligned", False)
         unaligned_apk_path = join(directory, "redex-unaligned." + file_ext)
-        zip_manager = ZipManager(args.input_apk, extracted_apk_dir, unaligned_apk_path)
+        zip_manager = ZipManager(
+            args.input_apk,
+            extracted_apk_dir,
+            unaligned_apk_path,
+            args.zip_repack_binary,
+        )
         zip_manager.__enter__()
 
         if not dex_dir:
@@ -45,7 +45,8 @@ void set_up(ConfigFiles& conf) {
 std::unique_ptr<RefChecker> create_ref_checker(const bool per_dex_grouping,
                                                XStoreRefs* xstores,
                                                ConfigFiles& conf,
-                                               int min_sdk) {
+                                               int min_sdk,
+                                               const Scope& scope) {
   auto min_sdk_api_file = conf.get_android_sdk_api_file(min_sdk);
   const api::AndroidSDK* min_sdk_api{nullptr};
   if (!min_sdk_api_file) {
@@ -66,7 +67,7 @@ std::unique_ptr<RefChecker> create_ref_checker(const bool per_dex_grouping,
     // largest root_store id.
     store_id = xstores->largest_root_store_id();
   }
-  return std::make_unique<RefChecker>(xstores, store_id, min_sdk_api);
+  return std::make_unique<RefChecker>(xstores, store_id, min_sdk_api, scope);
 }
 
 void load_roots_subtypes_as_merging_targets(const TypeSystem& type_system,
@@ -139,7 +140,7 @@ const ModelStats merge_model(const TypeSystem& type_system,
   int32_t min_sdk = mgr.get_redex_options().min_sdk;
   XStoreRefs xstores(stores);
   auto refchecker =
-      create_ref_checker(spec.per_dex_grouping, &xstores, conf, min_sdk);
+      create_ref_checker(spec.per_dex_grouping, &xstores, conf, min_sdk, scope);
   auto model =
       Model::build_model(scope, stores, conf, spec, type_system, *refchecker);
   ModelStats stats = model.get_model_stats();
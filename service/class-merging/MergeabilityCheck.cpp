@@ -7,6 +7,8 @@
 
 #include "MergeabilityCheck.h"
 
+#include <numeric>
+
 #include "LiveRange.h"
 #include "Model.h"
 #include "ReachableClasses.h"
@@ -16,6 +18,7 @@
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 using namespace class_merging;
 
@@ -236,16 +239,28 @@ void MergeabilityChecker::exclude_static_fields(TypeSet& non_mergeables) {
 
 void MergeabilityChecker::exclude_unsafe_sdk_and_store_refs(
     TypeSet& non_mergeables) {
+  std::vector<const DexType*> types;
   for (auto type : m_spec.merging_targets) {
-    if (non_mergeables.count(type)) {
-      continue;
-    }
-    auto cls = type_class(type);
-    if (!m_ref_checker.check_class(cls)) {
-      non_mergeables.insert(type);
+    if (!non_mergeables.count(type)) {
+      types.push_back(type);
     }
-    if (!m_spec.include_primary_dex && m_ref_checker.is_in_primary_dex(type)) {
-      non_mergeables.insert(type);
+  }
+  // Checking the references of a class is costly, and independent of the
+  // other classes.
+  std::vector<uint8_t> is_unsafe(types.size());
+  std::vector<size_t> indices(types.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        auto type = types[i];
+        is_unsafe[i] = !m_ref_checker.check_class(type_class(type)) ||
+                       (!m_spec.include_primary_dex &&
+                        m_ref_checker.is_in_primary_dex(type));
+      },
+      indices);
+  for (size_t i = 0; i < types.size(); i++) {
+    if (is_unsafe[i]) {
+      non_mergeables.insert(types[i]);
     }
   }
 }
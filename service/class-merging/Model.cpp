@@ -7,6 +7,7 @@
 
 #include "Model.h"
 
+#include <chrono>
 #include <ostream>
 #include <sstream>
 
@@ -1384,6 +1385,7 @@ Model Model::build_model(const Scope& scope,
                          const TypeSystem& type_system,
                          const RefChecker& refchecker) {
   Timer t("build_model");
+  auto start = std::chrono::steady_clock::now();
 
   TRACE(CLMG, 3, "Build Model for %s", to_string(spec).c_str());
   Model model(scope, stores, conf, spec, type_system, refchecker);
@@ -1397,6 +1399,10 @@ Model Model::build_model(const Scope& scope,
   model.collect_methods();
   TRACE(CLMG, 3, "Model:\n%s\nFinal Model done", model.print().c_str());
 
+  model.m_stats.m_build_model_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count();
   return model;
 }
 
@@ -1418,6 +1424,7 @@ ModelStats& ModelStats::operator+=(const ModelStats& stats) {
   m_num_static_non_virt_dedupped += stats.m_num_static_non_virt_dedupped;
   m_num_vmethods_dedupped += stats.m_num_vmethods_dedupped;
   m_num_const_lifted_methods += stats.m_num_const_lifted_methods;
+  m_build_model_us += stats.m_build_model_us;
   return *this;
 }
 
@@ -1446,6 +1453,7 @@ void ModelStats::update_redex_stats(const std::string& prefix,
                   m_num_static_non_virt_dedupped);
   mgr.incr_metric(prefix + "_vmethods_dedupped", m_num_vmethods_dedupped);
   mgr.set_metric(prefix + "_const_lifted_methods", m_num_const_lifted_methods);
+  mgr.incr_metric(prefix + "_build_model_us", m_build_model_us);
 }
 
 } // namespace class_merging
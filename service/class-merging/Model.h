@@ -209,6 +209,8 @@ struct ModelStats {
   uint32_t m_num_static_non_virt_dedupped = 0;
   uint32_t m_num_vmethods_dedupped = 0;
   uint32_t m_num_const_lifted_methods = 0;
+  // Wall time of building the model
+  uint64_t m_build_model_us = 0;
 
   ModelStats& operator+=(const ModelStats& stats);
 
@@ -189,20 +189,44 @@ void WholeProgramState::collect(
     if (code == nullptr) {
       return;
     }
-    auto& cfg = code->cfg();
-    auto intra_cp = fp_iter.get_intraprocedural_analysis(method);
-    for (cfg::Block* b : cfg.blocks()) {
-      auto env = intra_cp->get_entry_state_at(b);
-      auto last_insn = b->get_last_insn();
-      for (auto& mie : InstructionIterable(b)) {
-        auto* insn = mie.insn;
-        intra_cp->analyze_instruction(insn, &env, insn == last_insn->insn);
-        collect_field_values(insn, env,
-                             method::is_clinit(method) ? method->get_class()
-                                                       : nullptr,
-                             &fields_value_tmp);
-        collect_return_values(insn, env, method, &methods_value_tmp);
+    auto contributions = fp_iter.get_contributions(method);
+    if (contributions == nullptr) {
+      auto new_contributions = std::make_shared<MethodContributions>();
+      auto& cfg = code->cfg();
+      auto intra_cp = fp_iter.get_intraprocedural_analysis(method);
+      for (cfg::Block* b : cfg.blocks()) {
+        auto env = intra_cp->get_entry_state_at(b);
+        auto last_insn = b->get_last_insn();
+        for (auto& mie : InstructionIterable(b)) {
+          auto* insn = mie.insn;
+          intra_cp->analyze_instruction(insn, &env, insn == last_insn->insn);
+          collect_field_values(insn, env,
+                               method::is_clinit(method) ? method->get_class()
+                                                         : nullptr,
+                               new_contributions.get());
+          collect_return_values(insn, env, new_contributions.get());
+        }
       }
+      fp_iter.set_contributions(method, new_contributions);
+      contributions = std::move(new_contributions);
+    }
+    for (auto& [field, value] : contributions->field_values) {
+      fields_value_tmp.update(field,
+                              [&value](const DexField*,
+                                       std::vector<ConstantValue>& s,
+                                       bool /* exists */) {
+                                s.emplace_back(value);
+                              });
+    }
+    if (!contributions->return_values.empty()) {
+      methods_value_tmp.update(method,
+                               [&](const DexMethod*,
+                                   std::vector<ConstantValue>& s,
+                                   bool /* exists */) {
+                                 s.insert(s.end(),
+                                          contributions->return_values.begin(),
+                                          contributions->return_values.end());
+                               });
     }
   });
   for (const auto& pair : fields_value_tmp) {
@@ -221,6 +245,50 @@ void WholeProgramState::collect(
   }
 }
 
+bool WholeProgramState::get_changed_members(
+    const WholeProgramState& other,
+    std::unordered_set<const DexField*>* fields,
+    std::unordered_set<const DexMethod*>* methods) const {
+  // get_return_value_from_cg reads the method partition of any callee, known
+  // or not, so we need to compare all its bindings.
+  if (m_method_partition.is_top() != other.m_method_partition.is_top()) {
+    return false;
+  }
+  auto check_field = [&](const DexField* field) {
+    if (!get_field_value(field).equals(other.get_field_value(field))) {
+      fields->emplace(field);
+    }
+  };
+  auto check_method = [&](const DexMethod* method) {
+    if (!get_return_value(method).equals(other.get_return_value(method)) ||
+        !m_method_partition.get(method).equals(
+            other.m_method_partition.get(method))) {
+      methods->emplace(method);
+    }
+  };
+  for (auto* field : m_known_fields) {
+    check_field(field);
+  }
+  for (auto* field : other.m_known_fields) {
+    check_field(field);
+  }
+  for (auto* method : m_known_methods) {
+    check_method(method);
+  }
+  for (auto* method : other.m_known_methods) {
+    check_method(method);
+  }
+  if (!m_method_partition.is_top()) {
+    for (auto& pair : m_method_partition.bindings()) {
+      check_method(pair.first);
+    }
+    for (auto& pair : other.m_method_partition.bindings()) {
+      check_method(pair.first);
+    }
+  }
+  return true;
+}
+
 /*
  * For each field, do a join over all the values that may have been
  * written to it at any point in the program.
@@ -234,8 +302,7 @@ void WholeProgramState::collect_field_values(
     const IRInstruction* insn,
     const ConstantEnvironment& env,
     const DexType* clinit_cls,
-    ConcurrentMap<const DexField*, std::vector<ConstantValue>>*
-        fields_value_tmp) {
+    MethodContributions* contributions) {
   if (!opcode::is_an_sput(insn->opcode()) &&
       !opcode::is_an_iput(insn->opcode())) {
     return;
@@ -246,12 +313,7 @@ void WholeProgramState::collect_field_values(
         field->get_class() == clinit_cls) {
       return;
     }
-    auto value = env.get(insn->src(0));
-    fields_value_tmp->update(
-        field,
-        [value](const DexField*,
-                std::vector<ConstantValue>& s,
-                bool /* exists */) { s.emplace_back(value); });
+    contributions->field_values.emplace_back(field, env.get(insn->src(0)));
   }
 }
 
@@ -264,9 +326,7 @@ void WholeProgramState::collect_field_values(
 void WholeProgramState::collect_return_values(
     const IRInstruction* insn,
     const ConstantEnvironment& env,
-    const DexMethod* method,
-    ConcurrentMap<const DexMethod*, std::vector<ConstantValue>>*
-        methods_value_tmp) {
+    MethodContributions* contributions) {
   auto op = insn->opcode();
   if (!opcode::is_a_return(op)) {
     return;
@@ -276,19 +336,10 @@ void WholeProgramState::collect_return_values(
     // does indeed return -- even though `void` is not actually a return value,
     // this tells us that the code following any invoke of this method is
     // reachable.
-    methods_value_tmp->update(
-        method,
-        [](const DexMethod*, std::vector<ConstantValue>& s, bool /* exists */) {
-          s.emplace_back(ConstantValue::top());
-        });
+    contributions->return_values.emplace_back(ConstantValue::top());
     return;
   }
-  auto value = env.get(insn->src(0));
-  methods_value_tmp->update(
-      method,
-      [value](const DexMethod*,
-              std::vector<ConstantValue>& s,
-              bool /* exists */) { s.emplace_back(value); });
+  contributions->return_values.emplace_back(env.get(insn->src(0)));
 }
 
 void WholeProgramState::collect_static_finals(const DexClass* cls,
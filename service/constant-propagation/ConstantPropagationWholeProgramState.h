@@ -30,6 +30,16 @@ using ConstantFieldPartition =
 using ConstantMethodPartition =
     sparta::HashedAbstractPartition<const DexMethod*, ConstantValue>;
 
+/*
+ * The values that a single method writes to fields and returns, as found by
+ * WholeProgramState::collect. They only change when the analysis of the
+ * method does, so they can be kept from one WholeProgramState to the next.
+ */
+struct MethodContributions {
+  std::vector<std::pair<const DexField*, ConstantValue>> field_values;
+  std::vector<ConstantValue> return_values;
+};
+
 /*
  * This class contains flow-insensitive information about fields and method
  * return values, i.e. it can tells us if a field or a return value is constant
@@ -117,6 +127,16 @@ class WholeProgramState {
     return m_method_partition;
   }
 
+  /*
+   * Collects the fields and methods whose values, as seen through
+   * get_field_value, get_return_value and get_return_value_from_cg, differ
+   * between this state and :other. Returns false if that cannot be told, in
+   * which case any of them may have changed.
+   */
+  bool get_changed_members(const WholeProgramState& other,
+                           std::unordered_set<const DexField*>* fields,
+                           std::unordered_set<const DexMethod*>* methods) const;
+
   bool has_call_graph() const { return m_call_graph != boost::none; }
 
   ConstantValue get_return_value_from_cg(const IRInstruction* insn) const {
@@ -149,19 +169,14 @@ class WholeProgramState {
       const interprocedural::FixpointIterator& fp_iter,
       const std::unordered_set<const DexField*>& definitely_assigned_ifields);
 
-  void collect_field_values(
-      const IRInstruction* insn,
-      const ConstantEnvironment& env,
-      const DexType* clinit_cls,
-      ConcurrentMap<const DexField*, std::vector<ConstantValue>>*
-          fields_value_tmp);
-
-  void collect_return_values(
-      const IRInstruction* insn,
-      const ConstantEnvironment& env,
-      const DexMethod* method,
-      ConcurrentMap<const DexMethod*, std::vector<ConstantValue>>*
-          methods_value_tmp);
+  void collect_field_values(const IRInstruction* insn,
+                            const ConstantEnvironment& env,
+                            const DexType* clinit_cls,
+                            MethodContributions* contributions);
+
+  void collect_return_values(const IRInstruction* insn,
+                             const ConstantEnvironment& env,
+                             MethodContributions* contributions);
 
   boost::optional<call_graph::Graph> m_call_graph;
 
@@ -8,6 +8,7 @@
 #include "IPConstantPropagationAnalysis.h"
 
 #include "DexAnnotation.h"
+#include "Trace.h"
 
 namespace constant_propagation {
 
@@ -37,6 +38,15 @@ ConstantEnvironment env_with_params(bool is_static,
   return env;
 }
 
+uint64_t FixpointIterator::estimate_cost(call_graph::NodeId const& node) const {
+  const DexMethod* method = node->method();
+  if (method == nullptr || method->get_code() == nullptr) {
+    return 1;
+  }
+  // Analyzing a method takes roughly time linear in the size of its code.
+  return 1 + method->get_code()->sum_opcode_sizes();
+}
+
 void FixpointIterator::analyze_node(call_graph::NodeId const& node,
                                     Domain* current_state) const {
   const DexMethod* method = node->method();
@@ -53,6 +63,13 @@ void FixpointIterator::analyze_node(call_graph::NodeId const& node,
     // never run.
     return;
   }
+  Domain entry_state;
+  if (m_reuse_unchanged_results) {
+    if (m_node_results.reuse(method, current_state)) {
+      return;
+    }
+    entry_state = *current_state;
+  }
   auto& cfg = code->cfg();
   auto intra_cp = get_intraprocedural_analysis(method);
   const auto outgoing_edges =
@@ -81,6 +98,49 @@ void FixpointIterator::analyze_node(call_graph::NodeId const& node,
       intra_cp->analyze_instruction(insn, &state, insn == last_insn->insn);
     }
   }
+  if (m_reuse_unchanged_results) {
+    m_node_results.record(method, std::move(entry_state), *current_state);
+  }
+}
+
+std::shared_ptr<const MethodContributions> FixpointIterator::get_contributions(
+    const DexMethod* method) const {
+  if (!m_reuse_unchanged_results || !m_call_graph.has_node(method)) {
+    return nullptr;
+  }
+  return m_node_results.get_contributions(
+      method, this->get_entry_state_at(m_call_graph.node(method)));
+}
+
+void FixpointIterator::set_contributions(
+    const DexMethod* method,
+    std::shared_ptr<const MethodContributions> contributions) const {
+  if (!m_reuse_unchanged_results || !m_call_graph.has_node(method)) {
+    return;
+  }
+  m_node_results.set_contributions(
+      method, this->get_entry_state_at(m_call_graph.node(method)),
+      std::move(contributions));
+}
+
+void FixpointIterator::set_whole_program_state(
+    std::unique_ptr<WholeProgramState> wps) {
+  if (m_reuse_unchanged_results) {
+    std::unordered_set<const DexField*> changed_fields;
+    std::unordered_set<const DexMethod*> changed_methods;
+    if (!m_wps->get_changed_members(*wps, &changed_fields, &changed_methods)) {
+      m_node_results.clear();
+    } else {
+      auto analyzed = m_node_results.size();
+      auto stale = m_node_results.invalidate(m_call_graph, changed_fields,
+                                             changed_methods);
+      TRACE(ICONSTP, 2,
+            "%zu fields and %zu methods changed, reanalyzing %zu of %zu "
+            "methods",
+            changed_fields.size(), changed_methods.size(), stale, analyzed);
+    }
+  }
+  m_wps = std::move(wps);
 }
 
 Domain FixpointIterator::analyze_edge(
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "CallGraph.h"
+#include "CallGraphNodeResults.h"
 #include "ConstantEnvironment.h"
 #include "ConstantPropagationAnalysis.h"
 #include "ConstantPropagationWholeProgramState.h"
@@ -63,16 +64,25 @@ using ProcedureAnalysisFactory =
  *
  * The intraprocedural propagation logic is delegated to the
  * ProcedureAnalysisFactory.
+ *
+ * If :reuse_unchanged_results is set, the result of analyzing a method is kept
+ * across runs, and reused as long as its entry state is the same and
+ * set_whole_program_state did not change the value of any field or method its
+ * code refers to. This is only sound if the analyses from the factory depend
+ * on the WholeProgramState through those values alone, as the
+ * WholeProgramAwareAnalyzer does.
  */
 class FixpointIterator : public sparta::ParallelMonotonicFixpointIterator<
                              call_graph::GraphInterface,
                              Domain> {
  public:
   FixpointIterator(const call_graph::Graph& call_graph,
-                   const ProcedureAnalysisFactory& proc_analysis_factory)
+                   const ProcedureAnalysisFactory& proc_analysis_factory,
+                   bool reuse_unchanged_results = false)
       : ParallelMonotonicFixpointIterator(call_graph),
         m_proc_analysis_factory(proc_analysis_factory),
-        m_call_graph(call_graph) {
+        m_call_graph(call_graph),
+        m_reuse_unchanged_results(reuse_unchanged_results) {
     auto wps = new WholeProgramState();
     wps->set_to_top();
     m_wps.reset(wps);
@@ -84,14 +94,23 @@ class FixpointIterator : public sparta::ParallelMonotonicFixpointIterator<
   Domain analyze_edge(const std::shared_ptr<call_graph::Edge>& edge,
                       const Domain& exit_state_at_source) const override;
 
+  uint64_t estimate_cost(const call_graph::NodeId& node) const override;
+
   std::unique_ptr<intraprocedural::FixpointIterator>
   get_intraprocedural_analysis(const DexMethod*) const;
 
   const WholeProgramState& get_whole_program_state() const { return *m_wps; }
 
-  void set_whole_program_state(std::unique_ptr<WholeProgramState> wps) {
-    m_wps = std::move(wps);
-  }
+  void set_whole_program_state(std::unique_ptr<WholeProgramState> wps);
+
+  // The constant field and return values that WholeProgramState::collect can
+  // take over for :method. Only kept when unchanged results are reused.
+  std::shared_ptr<const MethodContributions> get_contributions(
+      const DexMethod* method) const;
+
+  void set_contributions(
+      const DexMethod* method,
+      std::shared_ptr<const MethodContributions> contributions) const;
 
   const call_graph::Graph& get_call_graph() { return m_call_graph; }
 
@@ -99,6 +118,10 @@ class FixpointIterator : public sparta::ParallelMonotonicFixpointIterator<
   std::unique_ptr<const WholeProgramState> m_wps;
   ProcedureAnalysisFactory m_proc_analysis_factory;
   call_graph::Graph m_call_graph;
+  bool m_reuse_unchanged_results;
+  // The contributions are set by WholeProgramState::collect, which analyzes
+  // each method once while no fixpoint is running.
+  mutable call_graph::NodeResults<Domain, MethodContributions> m_node_results;
 };
 
 } // namespace interprocedural
@@ -504,37 +504,39 @@ Stats CopyPropagation::run(const Scope& scope) {
   return walk::parallel::methods<Stats>(
       scope,
       [this](DexMethod* m) {
-        IRCode* code = m->get_code();
-        if (code == nullptr) {
+        if (m->get_code() == nullptr) {
           return Stats();
         }
-
-        const std::string& before_code =
-            m_config.debug ? show(m->get_code()) : "";
-        const auto& result = run(code, m);
-
-        if (m_config.debug) {
-          // Run the IR type checker
-          IRTypeChecker checker(m);
-          checker.run();
-          if (!checker.good()) {
-            const std::string& msg = checker.what();
-            TRACE(RME,
-                  1,
-                  "%s: Inconsistency in Dex code. %s",
-                  SHOW(m),
-                  msg.c_str());
-            TRACE(RME, 1, "before code:\n%s", before_code.c_str());
-            TRACE(RME, 1, "after  code:\n%s", SHOW(m->get_code()));
-            always_assert(checker.good());
-          }
-        }
-
-        return result;
+        return run_on_method(m);
       },
       m_config.debug ? 1 : redex_parallel::default_num_threads());
 }
 
+Stats CopyPropagation::run_on_method(DexMethod* m) {
+  IRCode* code = m->get_code();
+  const std::string& before_code = m_config.debug ? show(m->get_code()) : "";
+  const auto& result = run(code, m);
+
+  if (m_config.debug) {
+    // Run the IR type checker
+    IRTypeChecker checker(m);
+    checker.run();
+    if (!checker.good()) {
+      const std::string& msg = checker.what();
+      TRACE(RME,
+            1,
+            "%s: Inconsistency in Dex code. %s",
+            SHOW(m),
+            msg.c_str());
+      TRACE(RME, 1, "before code:\n%s", before_code.c_str());
+      TRACE(RME, 1, "after  code:\n%s", SHOW(m->get_code()));
+      always_assert(checker.good());
+    }
+  }
+
+  return result;
+}
+
 Stats CopyPropagation::run(IRCode* code, DexMethod* method) {
   return run(code,
              method ? is_static(method) : true,
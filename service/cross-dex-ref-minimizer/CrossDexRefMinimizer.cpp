@@ -5,6 +5,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <cinttypes>
 #include <cmath>
 #include <numeric>
@@ -70,40 +71,86 @@ uint64_t CrossDexRefMinimizer::ClassInfo::get_priority() const {
   return (primary_priority << 24) | secondary_priority;
 }
 
-void CrossDexRefMinimizer::reprioritize(
-    const std::unordered_map<DexClass*, CrossDexRefMinimizer::ClassInfoDelta>&
-        affected_classes) {
+CrossDexRefMinimizer::ClassInfoDelta& CrossDexRefMinimizer::delta(
+    uint32_t class_index) {
+  auto& class_delta = m_deltas.at(class_index);
+  if (!class_delta.affected) {
+    class_delta.affected = true;
+    m_affected_classes.push_back(class_index);
+  }
+  return class_delta;
+}
+
+void CrossDexRefMinimizer::reprioritize() {
   TRACE(IDEX, 4, "[dex ordering] Reprioritizing %zu classes",
-        affected_classes.size());
-  for (auto p : affected_classes) {
+        m_affected_classes.size());
+  for (auto affected_index : m_affected_classes) {
     ++m_stats.reprioritizations;
-    DexClass* affected_class = p.first;
-    CrossDexRefMinimizer::ClassInfoDelta& delta = p.second;
-    CrossDexRefMinimizer::ClassInfo& affected_class_info =
-        m_class_infos.at(affected_class);
-    affected_class_info.applied_refs_weight += delta.applied_refs_weight;
+    CrossDexRefMinimizer::ClassInfoDelta& delta = m_deltas[affected_index];
+    CrossDexRefMinimizer::ClassInfo* affected_class_info =
+        m_class_infos_by_index.at(affected_index);
+    always_assert(affected_class_info != nullptr);
+    affected_class_info->applied_refs_weight += delta.applied_refs_weight;
     for (size_t i = 0; i < INFREQUENT_REFS_COUNT; ++i) {
-      affected_class_info.infrequent_refs_weight[i] +=
+      affected_class_info->infrequent_refs_weight[i] +=
           delta.infrequent_refs_weight[i];
     }
 
-    const auto priority = affected_class_info.get_priority();
-    m_prioritized_classes.update_priority(affected_class, priority);
+    const auto priority = affected_class_info->get_priority();
+    if (priority != affected_class_info->priority) {
+      push(*affected_class_info);
+    }
     TRACE(
         IDEX, 5,
         "[dex ordering] Reprioritized class {%s} with priority %016" PRIu64
         "; index %u; %" PRIu64 " (delta %" PRId64
         ") applied refs weight, %s (delta %s) infrequent refs weights, %zu "
         "total refs",
-        SHOW(affected_class), priority, affected_class_info.index,
-        affected_class_info.applied_refs_weight, delta.applied_refs_weight,
-        format_infrequent_refs_array(affected_class_info.infrequent_refs_weight)
+        SHOW(affected_class_info->cls), priority, affected_class_info->index,
+        affected_class_info->applied_refs_weight, delta.applied_refs_weight,
+        format_infrequent_refs_array(
+            affected_class_info->infrequent_refs_weight)
             .c_str(),
         format_infrequent_refs_array(delta.infrequent_refs_weight).c_str(),
-        affected_class_info.refs.size());
+        affected_class_info->refs.size());
+    delta = CrossDexRefMinimizer::ClassInfoDelta();
+  }
+  m_affected_classes.clear();
+
+  // Every reprioritization may leave a stale entry behind; once those
+  // outnumber the live ones, it's cheaper to start over.
+  if (m_prioritized_classes.size() > 2 * m_class_infos.size() + 1024) {
+    rebuild_queue();
+  }
+  pop_stale();
+}
+
+void CrossDexRefMinimizer::push(ClassInfo& class_info) {
+  class_info.priority = class_info.get_priority();
+  m_prioritized_classes.emplace(class_info.priority, class_info.index);
+}
+
+void CrossDexRefMinimizer::pop_stale() {
+  while (!m_prioritized_classes.empty()) {
+    const auto& [priority, index] = m_prioritized_classes.top();
+    const auto* class_info = m_class_infos_by_index[index];
+    if (class_info != nullptr && class_info->priority == priority) {
+      break;
+    }
+    m_prioritized_classes.pop();
   }
 }
 
+void CrossDexRefMinimizer::rebuild_queue() {
+  std::vector<std::pair<uint64_t, uint32_t>> entries;
+  entries.reserve(m_class_infos.size());
+  for (const auto& p : m_class_infos) {
+    entries.emplace_back(p.second.priority, p.second.index);
+  }
+  m_prioritized_classes = std::priority_queue<std::pair<uint64_t, uint32_t>>(
+      std::less<std::pair<uint64_t, uint32_t>>(), std::move(entries));
+}
+
 void CrossDexRefMinimizer::gather_refs(DexClass* cls,
                                        std::vector<DexMethodRef*>& method_refs,
                                        std::vector<DexFieldRef*>& field_refs,
@@ -166,8 +213,10 @@ void CrossDexRefMinimizer::insert(DexClass* cls) {
   ++m_stats.classes;
   CrossDexRefMinimizer::ClassInfo& class_info =
       m_class_infos
-          .insert({cls, CrossDexRefMinimizer::ClassInfo(m_next_index++)})
+          .insert({cls, CrossDexRefMinimizer::ClassInfo(cls, m_next_index++)})
           .first->second;
+  m_class_infos_by_index.push_back(&class_info);
+  m_deltas.resize(m_next_index);
 
   // Collect all relevant references that contribute to cross-dex metadata
   // entries.
@@ -185,7 +234,7 @@ void CrossDexRefMinimizer::insert(DexClass* cls) {
   uint64_t& refs_weight = class_info.refs_weight;
   uint64_t& seed_weight = class_info.seed_weight;
 
-  auto add_weight = [&ref_counts = m_ref_counts,
+  auto add_weight = [&ref_counts = m_ref_counts, &ref_indices = m_ref_indices,
                      max_ref_count = m_max_ref_count, &refs, &refs_weight,
                      &seed_weight](const void* ref, size_t item_weight,
                                    size_t item_seed_weight) {
@@ -200,7 +249,9 @@ void CrossDexRefMinimizer::insert(DexClass* cls) {
     TRACE(IDEX, 6, "[dex ordering] %zu/%zu = %lf %s", ref_count, max_ref_count,
           frequency, skipping ? "(skipping)" : "");
     if (!skipping) {
-      refs.emplace_back(ref, item_weight);
+      uint32_t ref_index =
+          ref_indices.emplace(ref, ref_indices.size()).first->second;
+      refs.emplace_back(ref_index, item_weight);
       refs_weight += item_weight;
       seed_weight += item_seed_weight;
     }
@@ -224,21 +275,21 @@ void CrossDexRefMinimizer::insert(DexClass* cls) {
     add_weight(fref, m_config.field_ref_weight, m_config.field_seed_weight);
   }
 
-  std::unordered_map<DexClass*, CrossDexRefMinimizer::ClassInfoDelta>
-      affected_classes;
+  m_ref_classes.resize(m_ref_indices.size());
+  m_applied_refs.resize(m_ref_indices.size());
+
   for (const auto& p : refs) {
-    auto ref = p.first;
+    auto ref_index = p.first;
     uint32_t weight = p.second;
-    auto& classes = m_ref_classes[ref];
+    auto& classes = m_ref_classes[ref_index];
     size_t frequency = classes.size();
     // We record the need to undo (subtract weight of) a previously claimed
     // infrequent ref. The actual undoing happens later in
     // reprioritize.
     if (frequency > 0 && frequency <= INFREQUENT_REFS_COUNT) {
-      for (DexClass* affected_class : classes) {
-        always_assert(affected_class != cls);
-        affected_classes[affected_class]
-            .infrequent_refs_weight[frequency - 1] -= weight;
+      for (auto affected_index : classes) {
+        always_assert(affected_index != class_info.index);
+        delta(affected_index).infrequent_refs_weight[frequency - 1] -= weight;
       }
     }
     ++frequency;
@@ -248,35 +299,35 @@ void CrossDexRefMinimizer::insert(DexClass* cls) {
     // class_info.get_priority() call, while all other change requests happen
     // later in reprioritize.
     if (frequency <= INFREQUENT_REFS_COUNT) {
-      for (DexClass* affected_class : classes) {
-        affected_classes[affected_class]
-            .infrequent_refs_weight[frequency - 1] += weight;
+      for (auto affected_index : classes) {
+        delta(affected_index).infrequent_refs_weight[frequency - 1] += weight;
       }
       class_info.infrequent_refs_weight[frequency - 1] += weight;
     }
 
-    // There's an implicit invariant that class_info and the keys of
-    // affected_classes are disjoint, so we are not going to reprioritize
-    // the class that we are adding here.
-    classes.emplace(cls);
+    // There's an implicit invariant that class_info and the affected classes
+    // are disjoint, so we are not going to reprioritize the class that we are
+    // adding here. As indices are handed out in increasing order, the
+    // classes stay sorted.
+    always_assert(classes.empty() || classes.back() < class_info.index);
+    classes.push_back(class_info.index);
   }
-  const auto priority = class_info.get_priority();
-  m_prioritized_classes.insert(cls, priority);
+  push(class_info);
+  const auto priority = class_info.priority;
   TRACE(IDEX, 4,
         "[dex ordering] Inserting class {%s} with priority %016" PRIu64
         "; index %u; %s infrequent refs weights, %zu total refs",
         SHOW(cls), priority, class_info.index,
         format_infrequent_refs_array(class_info.infrequent_refs_weight).c_str(),
         refs.size());
-  reprioritize(affected_classes);
+  reprioritize();
 }
 
-bool CrossDexRefMinimizer::empty() const {
-  return m_prioritized_classes.empty();
-}
+bool CrossDexRefMinimizer::empty() const { return m_class_infos.empty(); }
 
 DexClass* CrossDexRefMinimizer::front() const {
-  return m_prioritized_classes.front();
+  always_assert(!m_prioritized_classes.empty());
+  return m_class_infos_by_index[m_prioritized_classes.top().second]->cls;
 }
 
 DexClass* CrossDexRefMinimizer::worst(bool generated) {
@@ -338,10 +389,11 @@ size_t CrossDexRefMinimizer::erase(DexClass* cls, bool emitted, bool reset) {
   std::unordered_map<DexClass*, ClassInfo>::const_iterator class_info_it =
       m_class_infos.end();
   if (cls) {
-    m_prioritized_classes.erase(cls);
     class_info_it = m_class_infos.find(cls);
     always_assert(class_info_it != m_class_infos.end());
     const auto& class_info = class_info_it->second;
+    // This makes all its entries in m_prioritized_classes stale.
+    m_class_infos_by_index[class_info.index] = nullptr;
     TRACE(
         IDEX, 3,
         "[dex ordering] Processing class {%s} with priority %016" PRIu64
@@ -362,73 +414,74 @@ size_t CrossDexRefMinimizer::erase(DexClass* cls, bool emitted, bool reset) {
   if (reset) {
     TRACE(IDEX, 3, "[dex ordering] Reset");
     ++m_stats.resets;
-    m_applied_refs.clear();
+    for (auto ref_index : m_applied_ref_indices) {
+      m_applied_refs[ref_index] = false;
+    }
+    m_applied_ref_indices.clear();
   }
 
-  std::unordered_map<DexClass*, CrossDexRefMinimizer::ClassInfoDelta>
-      affected_classes;
-  size_t old_applied_refs = m_applied_refs.size();
+  size_t old_applied_refs = m_applied_ref_indices.size();
   if (class_info_it != m_class_infos.end()) {
     const auto& class_info = class_info_it->second;
     const auto& refs = class_info.refs;
     for (const auto& p : refs) {
-      auto ref = p.first;
+      auto ref_index = p.first;
       uint32_t weight = p.second;
-      auto& classes = m_ref_classes.at(ref);
+      auto& classes = m_ref_classes.at(ref_index);
       size_t frequency = classes.size();
       always_assert(frequency > 0);
-      const auto erased = classes.erase(cls);
-      always_assert(erased);
+      auto class_it =
+          std::lower_bound(classes.begin(), classes.end(), class_info.index);
+      always_assert(class_it != classes.end() && *class_it == class_info.index);
+      classes.erase(class_it);
       if (frequency <= INFREQUENT_REFS_COUNT) {
-        for (DexClass* affected_class : classes) {
-          affected_classes[affected_class]
-              .infrequent_refs_weight[frequency - 1] -= weight;
+        for (auto affected_index : classes) {
+          delta(affected_index).infrequent_refs_weight[frequency - 1] -=
+              weight;
         }
       }
       --frequency;
       if (frequency > 0 && frequency <= INFREQUENT_REFS_COUNT) {
-        for (DexClass* affected_class : classes) {
-          affected_classes[affected_class]
-              .infrequent_refs_weight[frequency - 1] += weight;
+        for (auto affected_index : classes) {
+          delta(affected_index).infrequent_refs_weight[frequency - 1] +=
+              weight;
         }
       }
 
       if (!emitted) {
         continue;
       }
-      if (m_applied_refs.count(ref) != 0) {
+      if (m_applied_refs[ref_index]) {
         continue;
       }
-      m_applied_refs.emplace(ref);
-      for (DexClass* affected_class : classes) {
-        affected_classes[affected_class].applied_refs_weight += weight;
+      m_applied_refs[ref_index] = true;
+      m_applied_ref_indices.push_back(ref_index);
+      for (auto affected_index : classes) {
+        delta(affected_index).applied_refs_weight += weight;
       }
     }
 
-    // Updating m_class_infos and m_prioritized_classes
+    // Updating m_class_infos
 
     m_class_infos.erase(class_info_it);
     always_assert(m_class_infos.count(cls) == 0);
   }
 
   if (reset) {
-    m_prioritized_classes.clear();
     for (auto it = m_class_infos.begin(); it != m_class_infos.end(); ++it) {
-      DexClass* reset_class = it->first;
       CrossDexRefMinimizer::ClassInfo& reset_class_info = it->second;
       reset_class_info.applied_refs_weight = 0;
-      const auto priority = reset_class_info.get_priority();
-      m_prioritized_classes.insert(reset_class, priority);
-      always_assert(reset_class_info.applied_refs_weight == 0);
+      reset_class_info.priority = reset_class_info.get_priority();
     }
+    rebuild_queue();
   }
+  size_t applied_refs = m_applied_ref_indices.size();
   if (emitted) {
     TRACE(IDEX, 4, "[dex ordering] %zu + %zu = %zu applied refs",
-          old_applied_refs, m_applied_refs.size() - old_applied_refs,
-          m_applied_refs.size());
+          old_applied_refs, applied_refs - old_applied_refs, applied_refs);
   }
-  reprioritize(affected_classes);
-  return m_applied_refs.size() - old_applied_refs;
+  reprioritize();
+  return applied_refs - old_applied_refs;
 }
 
 size_t CrossDexRefMinimizer::get_unapplied_refs(DexClass* cls) {
@@ -438,7 +491,7 @@ size_t CrossDexRefMinimizer::get_unapplied_refs(DexClass* cls) {
   }
   size_t unapplied_refs{0};
   for (auto& p : it->second.refs) {
-    if (!m_applied_refs.count(p.first)) {
+    if (!m_applied_refs[p.first]) {
       unapplied_refs++;
     }
   }
@@ -7,12 +7,12 @@
 
 #pragma once
 
+#include <array>
+#include <queue>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
 #include "DexClass.h"
-#include "MutablePriorityQueue.h"
 
 namespace cross_dex_ref_minimizer {
 
@@ -26,7 +26,6 @@ namespace cross_dex_ref_minimizer {
 // minimization, but also causes it to use more memory and run slower.
 constexpr uint64_t INFREQUENT_REFS_COUNT = 6;
 
-using PrioritizedDexClasses = MutablePriorityQueue<DexClass*, uint64_t>;
 struct CrossDexRefMinimizerStats {
   uint64_t classes{0};
   uint64_t resets{0};
@@ -76,20 +75,34 @@ struct CrossDexRefMinimizerConfig {
 // reasonably large to prevent overflows. However, we don't always check for
 // overflows. In any case, all of this flows into a heuristic, so it wouldn't
 // be the end of the world if an overflow ever happens.
+//
+// A note on the data structures:
+// - Classes and refs are numbered densely as they are inserted; the classes
+//   that have a ref are tracked as a sorted vector of class indices, and the
+//   changes to the classes affected by an insertion or erasure are gathered
+//   in a vector indexed by class, and applied in one batch at the end.
+// - The classes are prioritized with a lazy-deletion heap: a changed priority
+//   is pushed as a new entry, and entries that no longer match the current
+//   priority of their class are discarded when they reach the top. As all
+//   priorities are distinct, the order is the same as with a strict priority
+//   queue.
 class CrossDexRefMinimizer {
-  PrioritizedDexClasses m_prioritized_classes;
-  std::unordered_set<const void*> m_applied_refs;
   struct ClassInfo {
+    DexClass* cls;
     uint32_t index;
     // This array stores (the weights of) how many of the *refs of this class
     // have only one, two, ... classes left that reference them.
     std::array<uint32_t, INFREQUENT_REFS_COUNT> infrequent_refs_weight;
-    std::vector<std::pair<const void*, uint32_t>> refs;
+    // Pairs of ref indices and weights.
+    std::vector<std::pair<uint32_t, uint32_t>> refs;
     uint64_t refs_weight;
     uint64_t applied_refs_weight;
     uint64_t seed_weight{0};
-    explicit ClassInfo(uint32_t i)
-        : index(i),
+    // The priority of the live entry of this class in the heap.
+    uint64_t priority{0};
+    ClassInfo(DexClass* c, uint32_t i)
+        : cls(c),
+          index(i),
           infrequent_refs_weight(),
           refs_weight(0),
           applied_refs_weight(0) {}
@@ -97,18 +110,39 @@ class CrossDexRefMinimizer {
     uint64_t get_priority() const;
   };
   std::unordered_map<DexClass*, ClassInfo> m_class_infos;
+  // The infos of the remaining classes by index, or nullptr for the erased
+  // ones.
+  std::vector<ClassInfo*> m_class_infos_by_index;
   uint32_t m_next_index{0};
-  std::unordered_map<const void*, std::unordered_set<DexClass*>> m_ref_classes;
+
+  // Pairs of priorities and class indices; the top entry is always live.
+  std::priority_queue<std::pair<uint64_t, uint32_t>> m_prioritized_classes;
+
+  std::unordered_map<const void*, uint32_t> m_ref_indices;
+  // The indices of the remaining classes that have a ref, by ref index.
+  std::vector<std::vector<uint32_t>> m_ref_classes;
+  std::vector<bool> m_applied_refs;
+  std::vector<uint32_t> m_applied_ref_indices;
+
   CrossDexRefMinimizerStats m_stats;
   const CrossDexRefMinimizerConfig m_config;
 
   struct ClassInfoDelta {
     std::array<int32_t, INFREQUENT_REFS_COUNT> infrequent_refs_weight{};
     int64_t applied_refs_weight{0};
+    bool affected{false};
   };
 
-  void reprioritize(
-      const std::unordered_map<DexClass*, ClassInfoDelta>& affected_classes);
+  // The pending changes of the affected classes by class index, and the
+  // indices of the affected classes in order of first change.
+  std::vector<ClassInfoDelta> m_deltas;
+  std::vector<uint32_t> m_affected_classes;
+
+  ClassInfoDelta& delta(uint32_t class_index);
+  void reprioritize();
+  void push(ClassInfo& class_info);
+  void pop_stale();
+  void rebuild_queue();
   DexClass* worst(bool generated);
 
   std::unordered_map<const void*, size_t> m_ref_counts;
@@ -142,7 +176,7 @@ class CrossDexRefMinimizer {
   void reset() { erase(nullptr, /* emitted */ false, /* reset */ true); }
   const CrossDexRefMinimizerConfig& get_config() const { return m_config; }
   const CrossDexRefMinimizerStats& stats() const { return m_stats; }
-  size_t get_applied_refs() const { return m_applied_refs.size(); }
+  size_t get_applied_refs() const { return m_applied_ref_indices.size(); }
   size_t get_unapplied_refs(DexClass* cls);
 };
 
@@ -51,6 +51,7 @@
 
 #include "CommonSubexpressionElimination.h"
 
+#include <boost/functional/hash.hpp>
 #include <utility>
 
 #include "BaseIRAnalyzer.h"
@@ -1031,59 +1032,190 @@ const method_override_graph::Graph* SharedState::get_method_override_graph()
   return m_method_override_graph.get();
 }
 
-void SharedState::init_method_barriers(const Scope& scope) {
-  Timer t("init_method_barriers");
-  auto iterations = compute_locations_closure(
-      scope, m_method_override_graph.get(),
-      [&](DexMethod* method) -> boost::optional<LocationsAndDependencies> {
-        auto action = get_base_or_overriding_method_action(
-            method, &m_safe_method_defs,
-            /* ignore_methods_with_assumenosideeffects */ true);
-        if (action == MethodOverrideAction::UNKNOWN) {
+namespace {
+
+size_t scope_signature(
+    const Scope& scope,
+    const std::unordered_set<DexMethodRef*>& pure_methods,
+    const std::unordered_set<const DexMethod*>& safe_method_defs) {
+  // Sums are independent of the order of the classes and members.
+  size_t signature = 0;
+  for (auto* cls : scope) {
+    size_t cls_hash = 0;
+    boost::hash_combine(cls_hash, cls);
+    boost::hash_combine(cls_hash, cls->get_super_class());
+    boost::hash_combine(cls_hash, cls->get_interfaces());
+    boost::hash_combine(cls_hash, cls->get_access());
+    signature += cls_hash;
+    for (auto* field : cls->get_all_fields()) {
+      size_t field_hash = 0;
+      boost::hash_combine(field_hash, field);
+      boost::hash_combine(field_hash, field->get_name());
+      boost::hash_combine(field_hash, field->get_type());
+      boost::hash_combine(field_hash, field->get_access());
+      signature += field_hash;
+    }
+    for (auto* method : cls->get_all_methods()) {
+      size_t method_hash = 0;
+      boost::hash_combine(method_hash, method);
+      boost::hash_combine(method_hash, method->get_name());
+      boost::hash_combine(method_hash, method->get_proto());
+      boost::hash_combine(method_hash, method->get_access());
+      boost::hash_combine(method_hash, method->get_code() != nullptr);
+      // Covers the keep rules and other states that decide how the method
+      // and its overrides are treated.
+      boost::hash_combine(
+          method_hash,
+          static_cast<int>(get_base_or_overriding_method_action(
+              method, &safe_method_defs,
+              /* ignore_methods_with_assumenosideeffects */ true)));
+      signature += method_hash;
+    }
+  }
+  for (auto* method_ref : pure_methods) {
+    signature += std::hash<DexMethodRef*>()(method_ref);
+  }
+  return signature;
+}
+
+} // namespace
+
+MethodBarriersCache::Key MethodBarriersCache::make_key(
+    const DexMethod* method) {
+  Key key;
+  auto code = method->get_code();
+  if (code == nullptr) {
+    return key;
+  }
+  // All instructions that may_be_barrier could select, together with what
+  // they reference, which determines what they write.
+  for (const auto& mie : cfg::ConstInstructionIterable(code->cfg())) {
+    auto* insn = mie.insn;
+    auto opcode = insn->opcode();
+    if (insn->has_field()) {
+      key.emplace_back(opcode, insn->get_field());
+    } else if (insn->has_method()) {
+      key.emplace_back(opcode, insn->get_method());
+    } else if (opcode == OPCODE_MONITOR_ENTER ||
+               opcode == OPCODE_MONITOR_EXIT ||
+               opcode == OPCODE_FILL_ARRAY_DATA || opcode::is_an_aput(opcode)) {
+      key.emplace_back(opcode, nullptr);
+    }
+  }
+  return key;
+}
+
+void MethodBarriersCache::begin(
+    const Scope& scope,
+    const std::unordered_set<DexMethodRef*>& pure_methods,
+    const std::unordered_set<const DexMethod*>& safe_method_defs) {
+  auto signature = scope_signature(scope, pure_methods, safe_method_defs);
+  if (signature != m_signature) {
+    m_entries.clear();
+    m_signature = signature;
+  }
+  m_new_entries.clear();
+  m_hits = 0;
+}
+
+const boost::optional<LocationsAndDependencies>* MethodBarriersCache::find(
+    const DexMethod* method, const Key& key) const {
+  auto it = m_entries.find(method);
+  if (it == m_entries.end() || it->second.key != key) {
+    return nullptr;
+  }
+  m_hits++;
+  return &it->second.lads;
+}
+
+void MethodBarriersCache::insert(
+    const DexMethod* method,
+    Key key,
+    const boost::optional<LocationsAndDependencies>& lads) {
+  m_new_entries.emplace(method, Entry{std::move(key), lads});
+}
+
+size_t MethodBarriersCache::end() {
+  m_entries.clear();
+  for (auto& p : m_new_entries) {
+    m_entries.emplace(p.first, std::move(p.second));
+  }
+  m_new_entries.clear();
+  return m_hits;
+}
+
+boost::optional<LocationsAndDependencies> SharedState::infer_method_barriers(
+    DexMethod* method) {
+    auto action = get_base_or_overriding_method_action(
+        method, &m_safe_method_defs,
+        /* ignore_methods_with_assumenosideeffects */ true);
+    if (action == MethodOverrideAction::UNKNOWN) {
+      return boost::none;
+    }
+    LocationsAndDependencies lads;
+    if (action == MethodOverrideAction::EXCLUDE) {
+      return lads;
+    }
+    auto code = method->get_code();
+    for (const auto& mie : cfg::InstructionIterable(code->cfg())) {
+      auto* insn = mie.insn;
+      if (may_be_barrier(insn, nullptr /* exact_virtual_scope */)) {
+        auto barrier = make_barrier(insn);
+        if (!opcode::is_an_invoke(barrier.opcode)) {
+          auto location = get_written_location(barrier);
+          if (location ==
+              CseLocation(CseSpecialLocations::GENERAL_MEMORY_BARRIER)) {
+            return boost::none;
+          }
+          lads.locations.insert(location);
+          continue;
+        }
+
+        if (barrier.opcode == OPCODE_INVOKE_SUPER) {
+          // TODO: Implement
           return boost::none;
         }
-        LocationsAndDependencies lads;
-        if (action == MethodOverrideAction::EXCLUDE) {
-          return lads;
+
+        if (!process_base_and_overriding_methods(
+                m_method_override_graph.get(), barrier.method,
+                &m_safe_method_defs,
+                /* ignore_methods_with_assumenosideeffects */ true,
+                [&](DexMethod* other_method) {
+                  if (other_method != method) {
+                    lads.dependencies.insert(other_method);
+                  }
+                  return true;
+                })) {
+          return boost::none;
         }
-        auto code = method->get_code();
-        for (const auto& mie : cfg::InstructionIterable(code->cfg())) {
-          auto* insn = mie.insn;
-          if (may_be_barrier(insn, nullptr /* exact_virtual_scope */)) {
-            auto barrier = make_barrier(insn);
-            if (!opcode::is_an_invoke(barrier.opcode)) {
-              auto location = get_written_location(barrier);
-              if (location ==
-                  CseLocation(CseSpecialLocations::GENERAL_MEMORY_BARRIER)) {
-                return boost::none;
-              }
-              lads.locations.insert(location);
-              continue;
-            }
+      }
+    }
 
-            if (barrier.opcode == OPCODE_INVOKE_SUPER) {
-              // TODO: Implement
-              return boost::none;
-            }
+    return lads;
+}
 
-            if (!process_base_and_overriding_methods(
-                    m_method_override_graph.get(), barrier.method,
-                    &m_safe_method_defs,
-                    /* ignore_methods_with_assumenosideeffects */ true,
-                    [&](DexMethod* other_method) {
-                      if (other_method != method) {
-                        lads.dependencies.insert(other_method);
-                      }
-                      return true;
-                    })) {
-              return boost::none;
-            }
-          }
+void SharedState::init_method_barriers(const Scope& scope,
+                                       MethodBarriersCache* barriers_cache) {
+  Timer t("init_method_barriers");
+  if (barriers_cache != nullptr) {
+    barriers_cache->begin(scope, m_pure_methods, m_safe_method_defs);
+  }
+  auto iterations = compute_locations_closure(
+      scope, m_method_override_graph.get(),
+      [&](DexMethod* method) -> boost::optional<LocationsAndDependencies> {
+        if (barriers_cache == nullptr) {
+          return infer_method_barriers(method);
         }
-
+        auto key = MethodBarriersCache::make_key(method);
+        auto cached = barriers_cache->find(method, key);
+        auto lads = cached ? *cached : infer_method_barriers(method);
+        barriers_cache->insert(method, std::move(key), lads);
         return lads;
       },
       &m_method_written_locations);
+  if (barriers_cache != nullptr) {
+    m_stats.method_barriers_cache_hits = barriers_cache->end();
+  }
   m_stats.method_barriers_iterations = iterations;
   m_stats.method_barriers = m_method_written_locations.size();
 
@@ -1115,7 +1247,8 @@ void SharedState::init_finalizable_fields(const Scope& scope) {
 
 void SharedState::init_scope(
     const Scope& scope,
-    const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects) {
+    const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects,
+    MethodBarriersCache* barriers_cache) {
   always_assert(!m_method_override_graph);
   m_method_override_graph = method_override_graph::build_graph(scope);
 
@@ -1135,7 +1268,7 @@ void SharedState::init_scope(
     }
   }
 
-  init_method_barriers(scope);
+  init_method_barriers(scope, barriers_cache);
   init_finalizable_fields(scope);
 }
 
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <atomic>
+
 #include "ConcurrentContainers.h"
 #include "IROpcode.h"
 #include "MethodOverrideGraph.h"
@@ -45,6 +47,7 @@ struct SharedStateStats {
   size_t finalizable_fields{0};
   size_t conditionally_pure_methods{0};
   size_t conditionally_pure_methods_iterations{0};
+  size_t method_barriers_cache_hits{0};
 };
 
 // A barrier is defined by a particular opcode, and possibly some extra data
@@ -67,14 +70,64 @@ struct BarrierHasher {
   }
 };
 
+/*
+ * Keeps the barrier locations and dependencies that a SharedState infers for
+ * each method, so that repeated CSE runs don't have to rescan and re-resolve
+ * the methods that did not change in between.
+ *
+ * An entry is reused only while its method's potential barrier instructions
+ * are the same. All entries are dropped when anything else that the inference
+ * depends on changes: the class hierarchy, the declarations and their flags,
+ * and the pure methods.
+ */
+class MethodBarriersCache {
+ public:
+  using Key = std::vector<std::pair<IROpcode, const void*>>;
+
+  static Key make_key(const DexMethod* method);
+
+  // Starts a run over the given scope, after discarding all entries if the
+  // scope's signature differs from the one of the previous run.
+  void begin(const Scope& scope,
+             const std::unordered_set<DexMethodRef*>& pure_methods,
+             const std::unordered_set<const DexMethod*>& safe_method_defs);
+
+  // Returns nullptr if there is no entry for the method with the given key.
+  // May be called concurrently with `insert`.
+  const boost::optional<LocationsAndDependencies>* find(
+      const DexMethod* method, const Key& key) const;
+
+  void insert(const DexMethod* method,
+              Key key,
+              const boost::optional<LocationsAndDependencies>& lads);
+
+  // Keeps only the entries inserted during this run, and returns the number
+  // of methods that were found.
+  size_t end();
+
+ private:
+  struct Entry {
+    Key key;
+    boost::optional<LocationsAndDependencies> lads;
+  };
+
+  size_t m_signature{0};
+  std::unordered_map<const DexMethod*, Entry> m_entries;
+  ConcurrentMap<const DexMethod*, Entry> m_new_entries;
+  mutable std::atomic<size_t> m_hits{0};
+};
+
 class SharedState {
  public:
   explicit SharedState(
       const std::unordered_set<DexMethodRef*>& pure_methods,
       const std::unordered_set<const DexString*>& finalish_field_names);
+  // If a cache is given, it is used and updated to infer the method
+  // barriers.
   void init_scope(const Scope&,
                   const method::ClInitHasNoSideEffectsPredicate&
-                      clinit_has_no_side_effects);
+                      clinit_has_no_side_effects,
+                  MethodBarriersCache* barriers_cache = nullptr);
   CseUnorderedLocationSet get_relevant_written_locations(
       const IRInstruction* insn,
       DexType* exact_virtual_scope,
@@ -107,7 +160,10 @@ class SharedState {
   }
 
  private:
-  void init_method_barriers(const Scope& scope);
+  void init_method_barriers(const Scope& scope,
+                            MethodBarriersCache* barriers_cache);
+  boost::optional<LocationsAndDependencies> infer_method_barriers(
+      DexMethod* method);
   void init_finalizable_fields(const Scope& scope);
   bool may_be_barrier(const IRInstruction* insn, DexType* exact_virtual_scope);
   bool is_invoke_safe(const IRInstruction* insn, DexType* exact_virtual_scope);
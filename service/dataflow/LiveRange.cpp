@@ -118,10 +118,92 @@ DefUseChains get_def_use_chains_impl(const cfg::ControlFlowGraph& cfg,
   return chains;
 }
 
+template <typename Iter>
+std::unordered_set<Use> get_uses_impl(const cfg::ControlFlowGraph& cfg,
+                                      const Iter& iter,
+                                      Def def) {
+  std::unordered_set<Use> uses;
+  replay_analysis_with_callback(
+      cfg, iter,
+      [&uses, def](const Use& use, const reaching_defs::Domain& defs) {
+        if (defs.contains(def)) {
+          uses.emplace(use);
+        }
+      });
+  return uses;
+}
+
 } // namespace
 
 namespace live_range {
 
+template <typename Iter>
+FlatChains::FlatChains(const cfg::ControlFlowGraph& cfg, const Iter& iter) {
+  // Number the instructions in the order of the replay up front, as defs
+  // along back edges are reached before they are replayed.
+  std::vector<IRInstruction*> insns;
+  uint32_t num_srcs = 0;
+  for (cfg::Block* block : cfg.blocks()) {
+    for (const auto& mie : InstructionIterable(block)) {
+      m_index.emplace(mie.insn, insns.size());
+      insns.push_back(mie.insn);
+      m_src_offsets.push_back(num_srcs);
+      num_srcs += mie.insn->srcs_size();
+    }
+  }
+  m_src_offsets.push_back(num_srcs);
+
+  // The replay visits the uses in the order of their indices.
+  m_def_offsets.reserve(num_srcs + 1);
+  m_use_offsets.assign(insns.size() + 1, 0);
+  replay_analysis_with_callback(
+      cfg, iter, [this](const Use&, const reaching_defs::Domain& defs) {
+        m_def_offsets.push_back(m_defs.size());
+        for (auto def : defs.elements()) {
+          m_defs.push_back(def);
+          ++m_use_offsets[index_of(def) + 1];
+        }
+      });
+  m_def_offsets.push_back(m_defs.size());
+
+  // Invert the use-def chains, keeping the uses of a def in replay order.
+  for (size_t i = 1; i < m_use_offsets.size(); ++i) {
+    m_use_offsets[i] += m_use_offsets[i - 1];
+  }
+  std::vector<uint32_t> next_use(m_use_offsets.begin(),
+                                 m_use_offsets.end() - 1);
+  m_uses.resize(m_defs.size());
+  for (uint32_t i = 0; i < insns.size(); ++i) {
+    for (uint32_t u = m_src_offsets[i]; u < m_src_offsets[i + 1]; ++u) {
+      Use use{insns[i], static_cast<src_index_t>(u - m_src_offsets[i])};
+      for (uint32_t d = m_def_offsets[u]; d < m_def_offsets[u + 1]; ++d) {
+        m_uses[next_use[index_of(m_defs[d])]++] = use;
+      }
+    }
+  }
+}
+
+uint32_t FlatChains::index_of(const IRInstruction* insn) const {
+  auto it = m_index.find(insn);
+  always_assert_log(it != m_index.end(), "Not in the CFG: %s", SHOW(insn));
+  return it->second;
+}
+
+FlatChains::Defs FlatChains::get_defs(const IRInstruction* insn,
+                                      src_index_t src_index) const {
+  auto i = index_of(insn);
+  auto u = m_src_offsets[i] + src_index;
+  always_assert(u < m_src_offsets[i + 1]);
+  return {m_defs.data() + m_def_offsets[u],
+          m_defs.data() + m_def_offsets[u + 1]};
+}
+
+FlatChains::Uses FlatChains::get_uses(const IRInstruction* def) const {
+  auto i = index_of(def);
+  return {m_uses.data() + m_use_offsets[i],
+          m_uses.data() + m_use_offsets[i + 1]};
+}
+
 bool Use::operator==(const Use& that) const {
   return insn == that.insn && src_index == that.src_index;
 }
@@ -138,6 +220,14 @@ DefUseChains Chains::get_def_use_chains() const {
   return get_def_use_chains_impl(m_cfg, m_fp_iter);
 }
 
+FlatChains Chains::get_flat_chains() const {
+  return FlatChains(m_cfg, m_fp_iter);
+}
+
+std::unordered_set<Use> Chains::get_uses(Def def) const {
+  return get_uses_impl(m_cfg, m_fp_iter, def);
+}
+
 MoveAwareChains::MoveAwareChains(const cfg::ControlFlowGraph& cfg)
     : m_cfg(cfg), m_fp_iter(cfg) {
   m_fp_iter.run(reaching_defs::Environment());
@@ -151,6 +241,14 @@ DefUseChains MoveAwareChains::get_def_use_chains() const {
   return get_def_use_chains_impl(m_cfg, m_fp_iter);
 }
 
+FlatChains MoveAwareChains::get_flat_chains() const {
+  return FlatChains(m_cfg, m_fp_iter);
+}
+
+std::unordered_set<Use> MoveAwareChains::get_uses(Def def) const {
+  return get_uses_impl(m_cfg, m_fp_iter, def);
+}
+
 void renumber_registers(IRCode* code, bool width_aware) {
   cfg::ScopedCFG cfg(code);
 
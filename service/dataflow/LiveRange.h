@@ -6,9 +6,11 @@
  */
 
 #include <boost/functional/hash.hpp>
+#include <boost/range/iterator_range.hpp>
 #include <cstdint>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "ControlFlow.h"
 #include "IRInstruction.h"
@@ -56,11 +58,50 @@ namespace live_range {
 using UseDefChains = std::unordered_map<Use, sparta::PatriciaTreeSet<Def>>;
 using DefUseChains = std::unordered_map<Def, std::unordered_set<Use>>;
 
+/*
+ * Use-def and def-use chains in flat arrays instead of maps of sets, for
+ * callers that query many of them. Both directions are computed by a single
+ * replay of the reaching definitions, and a chain is a range of an array,
+ * found through the position of its instruction in the CFG.
+ */
+class FlatChains {
+ public:
+  using Defs = boost::iterator_range<const Def*>;
+  using Uses = boost::iterator_range<const Use*>;
+
+  // The defs that reach the source.
+  Defs get_defs(const IRInstruction* insn, src_index_t src_index) const;
+  // The uses that the def reaches, which may be none.
+  Uses get_uses(const IRInstruction* def) const;
+
+ private:
+  friend class Chains;
+  friend class MoveAwareChains;
+
+  template <typename Iter>
+  FlatChains(const cfg::ControlFlowGraph& cfg, const Iter& iter);
+
+  uint32_t index_of(const IRInstruction* insn) const;
+
+  std::unordered_map<const IRInstruction*, uint32_t> m_index;
+  // By instruction index, the index of its first source among all uses.
+  std::vector<uint32_t> m_src_offsets;
+  // By use index, where its defs start in m_defs.
+  std::vector<uint32_t> m_def_offsets;
+  std::vector<Def> m_defs;
+  // By instruction index, where its uses start in m_uses.
+  std::vector<uint32_t> m_use_offsets;
+  std::vector<Use> m_uses;
+};
+
 class Chains {
  public:
   explicit Chains(const cfg::ControlFlowGraph& cfg);
   UseDefChains get_use_def_chains() const;
   DefUseChains get_def_use_chains() const;
+  FlatChains get_flat_chains() const;
+  // The uses of a single def, without building the chains of the other defs.
+  std::unordered_set<Use> get_uses(Def def) const;
 
  private:
   const cfg::ControlFlowGraph& m_cfg;
@@ -72,6 +113,8 @@ class MoveAwareChains {
   explicit MoveAwareChains(const cfg::ControlFlowGraph& cfg);
   UseDefChains get_use_def_chains() const;
   DefUseChains get_def_use_chains() const;
+  FlatChains get_flat_chains() const;
+  std::unordered_set<Use> get_uses(Def def) const;
 
  private:
   const cfg::ControlFlowGraph& m_cfg;
@@ -277,16 +277,32 @@ class WritesAnalyzer {
   }
 
  public:
+  // The field stats are only consulted by get_writes, so they may still be
+  // gathered while the methods are analyzed.
+  WritesAnalyzer(const field_op_tracker::FieldStatsMap& field_stats,
+                 const field_op_tracker::TypeLifetimes* type_lifetimes)
+      : m_type_lifetimes(type_lifetimes), m_field_stats(field_stats) {}
+
   explicit WritesAnalyzer(const Scope& scope,
                           const field_op_tracker::FieldStatsMap& field_stats,
                           const field_op_tracker::TypeLifetimes* type_lifetimes)
-      : m_type_lifetimes(type_lifetimes), m_field_stats(field_stats) {
+      : WritesAnalyzer(field_stats, type_lifetimes) {
+    add_methods(scope);
+    walk::parallel::code(scope, [&](const DexMethod* method, const IRCode&) {
+      analyze_method(method);
+    });
+  }
+
+  // Must be called before the methods of the scope are analyzed.
+  void add_methods(const Scope& scope) {
     walk::code(scope, [this](const DexMethod* method, const IRCode&) {
       m_method_insn_escapes[method];
     });
-    walk::parallel::code(scope, [&](const DexMethod* method, const IRCode&) {
-      m_method_insn_escapes.at(method) = compute_insn_escapes(method);
-    });
+  }
+
+  // Can be called in parallel for different methods.
+  void analyze_method(const DexMethod* method) {
+    m_method_insn_escapes.at(method) = compute_insn_escapes(method);
   }
 
   bool any_read(const std::unordered_set<DexField*>& fields) {
@@ -380,12 +396,92 @@ bool TypeLifetimes::has_lifetime(const DexType* t) const {
   return true;
 }
 
-FieldWrites analyze_writes(const Scope& scope,
-                           const FieldStatsMap& field_stats,
-                           const TypeLifetimes* type_lifetimes) {
+namespace {
+
+// Gathers the read/write counts from the instructions of the method.
+void gather_field_stats(
+    DexMethod* method,
+    ConcurrentMap<DexField*, FieldStats>* concurrent_field_stats) {
+  std::unordered_map<DexField*, FieldStats> field_stats;
+  if (method::is_init(method)) {
+    // compute init_writes by checking receiver of each iput
+    cfg::ScopedCFG cfg(method->get_code());
+    reaching_defs::MoveAwareFixpointIterator reaching_definitions(*cfg);
+    reaching_definitions.run(reaching_defs::Environment());
+    auto first_load_param = cfg->get_param_instructions().begin()->insn;
+    always_assert(first_load_param->opcode() == IOPCODE_LOAD_PARAM_OBJECT);
+    for (cfg::Block* block : cfg->blocks()) {
+      auto env = reaching_definitions.get_entry_state_at(block);
+      auto insns = InstructionIterable(block);
+      for (auto it = insns.begin(); it != insns.end();
+           reaching_definitions.analyze_instruction(it++->insn, &env)) {
+        IRInstruction* insn = it->insn;
+        if (!opcode::is_an_iput(insn->opcode())) {
+          continue;
+        }
+        auto field = resolve_field(insn->get_field());
+        if (field == nullptr || field->get_class() != method->get_class()) {
+          continue;
+        }
+        // We only consider for init_writes those iputs where the obj is the
+        // receiver. I cannot see where the JVM spec this would be enforced,
+        // we'll be conservative to be safe.
+        auto obj_defs = env.get(insn->src(1));
+        if (!obj_defs.is_top() && !obj_defs.is_bottom() &&
+            obj_defs.elements().size() == 1 &&
+            *obj_defs.elements().begin() == first_load_param) {
+          ++field_stats[field].init_writes;
+        }
+      }
+    }
+  }
+  bool is_clinit = method::is_clinit(method);
+  editable_cfg_adapter::iterate(
+      method->get_code(), [&](const MethodItemEntry& mie) {
+        auto insn = mie.insn;
+        auto op = insn->opcode();
+        if (!insn->has_field()) {
+          return editable_cfg_adapter::LOOP_CONTINUE;
+        }
+        auto field = resolve_field(insn->get_field());
+        if (field == nullptr) {
+          return editable_cfg_adapter::LOOP_CONTINUE;
+        }
+        if (opcode::is_an_sget(op) || opcode::is_an_iget(op)) {
+          ++field_stats[field].reads;
+        } else if (opcode::is_an_sput(op) || opcode::is_an_iput(op)) {
+          ++field_stats[field].writes;
+          if (is_clinit && is_static(field) &&
+              field->get_class() == method->get_class()) {
+            ++field_stats[field].init_writes;
+          }
+        }
+        return editable_cfg_adapter::LOOP_CONTINUE;
+      });
+  for (auto& p : field_stats) {
+    concurrent_field_stats->update(
+        p.first, [&](DexField*, FieldStats& fs, bool) { fs += p.second; });
+  }
+}
+
+// Gathers field reads from annotations.
+void gather_annotation_field_reads(const Scope& scope,
+                                   FieldStatsMap* field_stats) {
+  walk::annotations(scope, [&](DexAnnotation* anno) {
+    std::vector<DexFieldRef*> fields_in_anno;
+    anno->gather_fields(fields_in_anno);
+    for (const auto& field_ref : fields_in_anno) {
+      auto field = resolve_field(field_ref);
+      if (field) {
+        ++(*field_stats)[field].reads;
+      }
+    }
+  });
+}
+
+FieldWrites get_writes(const Scope& scope, WritesAnalyzer& analyzer) {
   std::unordered_set<DexField*> non_zero_written_fields;
   std::unordered_set<DexField*> non_vestigial_objects_written_fields;
-  WritesAnalyzer analyzer(scope, field_stats, type_lifetimes);
   walk::code(scope, [&](const DexMethod* method, const IRCode&) {
     auto success = analyzer.get_writes(method,
                                        &non_zero_written_fields,
@@ -396,92 +492,50 @@ FieldWrites analyze_writes(const Scope& scope,
   });
   return FieldWrites{non_zero_written_fields,
                      non_vestigial_objects_written_fields};
+}
+
+} // namespace
+
+FieldWrites analyze_writes(const Scope& scope,
+                           const FieldStatsMap& field_stats,
+                           const TypeLifetimes* type_lifetimes) {
+  WritesAnalyzer analyzer(scope, field_stats, type_lifetimes);
+  return get_writes(scope, analyzer);
 };
 
 FieldStatsMap analyze(const Scope& scope) {
   ConcurrentMap<DexField*, FieldStats> concurrent_field_stats;
-  // Gather the read/write counts from instructions.
   walk::parallel::methods(scope, [&](DexMethod* method) {
     if (!method->get_code()) {
       return;
     }
-    std::unordered_map<DexField*, FieldStats> field_stats;
-    if (method::is_init(method)) {
-      // compute init_writes by checking receiver of each iput
-      cfg::ScopedCFG cfg(method->get_code());
-      reaching_defs::MoveAwareFixpointIterator reaching_definitions(*cfg);
-      reaching_definitions.run(reaching_defs::Environment());
-      auto first_load_param = cfg->get_param_instructions().begin()->insn;
-      always_assert(first_load_param->opcode() == IOPCODE_LOAD_PARAM_OBJECT);
-      for (cfg::Block* block : cfg->blocks()) {
-        auto env = reaching_definitions.get_entry_state_at(block);
-        auto insns = InstructionIterable(block);
-        for (auto it = insns.begin(); it != insns.end();
-             reaching_definitions.analyze_instruction(it++->insn, &env)) {
-          IRInstruction* insn = it->insn;
-          if (!opcode::is_an_iput(insn->opcode())) {
-            continue;
-          }
-          auto field = resolve_field(insn->get_field());
-          if (field == nullptr || field->get_class() != method->get_class()) {
-            continue;
-          }
-          // We only consider for init_writes those iputs where the obj is the
-          // receiver. I cannot see where the JVM spec this would be enforced,
-          // we'll be conservative to be safe.
-          auto obj_defs = env.get(insn->src(1));
-          if (!obj_defs.is_top() && !obj_defs.is_bottom() &&
-              obj_defs.elements().size() == 1 &&
-              *obj_defs.elements().begin() == first_load_param) {
-            ++field_stats[field].init_writes;
-          }
-        }
-      }
-    }
-    bool is_clinit = method::is_clinit(method);
-    editable_cfg_adapter::iterate(
-        method->get_code(), [&](const MethodItemEntry& mie) {
-          auto insn = mie.insn;
-          auto op = insn->opcode();
-          if (!insn->has_field()) {
-            return editable_cfg_adapter::LOOP_CONTINUE;
-          }
-          auto field = resolve_field(insn->get_field());
-          if (field == nullptr) {
-            return editable_cfg_adapter::LOOP_CONTINUE;
-          }
-          if (opcode::is_an_sget(op) || opcode::is_an_iget(op)) {
-            ++field_stats[field].reads;
-          } else if (opcode::is_an_sput(op) || opcode::is_an_iput(op)) {
-            ++field_stats[field].writes;
-            if (is_clinit && is_static(field) &&
-                field->get_class() == method->get_class()) {
-              ++field_stats[field].init_writes;
-            }
-          }
-          return editable_cfg_adapter::LOOP_CONTINUE;
-        });
-    for (auto& p : field_stats) {
-      concurrent_field_stats.update(
-          p.first, [&](DexField*, FieldStats& fs, bool) { fs += p.second; });
-    }
+    gather_field_stats(method, &concurrent_field_stats);
   });
 
   FieldStatsMap field_stats(concurrent_field_stats.begin(),
                             concurrent_field_stats.end());
+  gather_annotation_field_reads(scope, &field_stats);
+  return field_stats;
+}
 
-  // Gather field reads from annotations.
-  walk::annotations(scope, [&](DexAnnotation* anno) {
-    std::vector<DexFieldRef*> fields_in_anno;
-    anno->gather_fields(fields_in_anno);
-    for (const auto& field_ref : fields_in_anno) {
-      auto field = resolve_field(field_ref);
-      if (field) {
-        ++field_stats[field].reads;
-      }
-    }
+FieldOps analyze_with_writes(const Scope& scope,
+                             const TypeLifetimes* type_lifetimes) {
+  FieldOps field_ops;
+  // What escapes where in a method does not depend on the field stats, so it
+  // is computed in the same walk that gathers them.
+  WritesAnalyzer analyzer(field_ops.field_stats, type_lifetimes);
+  analyzer.add_methods(scope);
+  ConcurrentMap<DexField*, FieldStats> concurrent_field_stats;
+  walk::parallel::code(scope, [&](DexMethod* method, IRCode&) {
+    gather_field_stats(method, &concurrent_field_stats);
+    analyzer.analyze_method(method);
   });
-  return field_stats;
+
+  field_ops.field_stats = FieldStatsMap(concurrent_field_stats.begin(),
+                                        concurrent_field_stats.end());
+  gather_annotation_field_reads(scope, &field_ops.field_stats);
+  field_ops.field_writes = get_writes(scope, analyzer);
+  return field_ops;
 }
 
 } // namespace field_op_tracker
@@ -65,4 +65,14 @@ struct FieldWrites {
 FieldWrites analyze_writes(const Scope& scope,
                            const FieldStatsMap& field_stats,
                            const TypeLifetimes* type_lifetimes = nullptr);
+
+struct FieldOps {
+  FieldStatsMap field_stats;
+  FieldWrites field_writes;
+};
+
+// Same as analyze followed by analyze_writes, but walks the code of the scope
+// only once. Like analyze_writes, this requires editable CFGs.
+FieldOps analyze_with_writes(const Scope& scope,
+                             const TypeLifetimes* type_lifetimes = nullptr);
 } // namespace field_op_tracker
@@ -24,21 +24,29 @@ const InitClasses* InitClassesWithSideEffects::compute(
     return res.get();
   }
 
+  // The super types are done first, and each clinit is only analyzed for its
+  // own type, instead of once for each subtype, as
+  // method::clinit_may_have_side_effects would.
   InitClasses classes;
-  const auto* refined_cls = method::clinit_may_have_side_effects(
-      cls, &clinit_has_no_side_effects, non_true_virtuals);
-  if (refined_cls == nullptr) {
-  } else if (refined_cls != cls) {
-    classes =
-        *compute(refined_cls, clinit_has_no_side_effects, non_true_virtuals);
-  } else {
-    classes.push_back(cls);
+  if (!cls->is_external()) {
+    const InitClasses* super_classes = nullptr;
     auto super_cls = type_class(cls->get_super_class());
     if (super_cls) {
-      const auto super_classes =
+      super_classes =
           compute(super_cls, clinit_has_no_side_effects, non_true_virtuals);
-      classes.insert(classes.end(), super_classes->begin(),
-                     super_classes->end());
+    }
+    if (cls->rstate.clinit_has_no_side_effects() ||
+        clinit_has_no_side_effects(cls->get_type())) {
+      always_assert(!super_classes || super_classes->empty());
+    } else {
+      if (method::own_clinit_may_have_side_effects(
+              cls, &clinit_has_no_side_effects, non_true_virtuals)) {
+        classes.push_back(cls);
+      }
+      if (super_classes) {
+        classes.insert(classes.end(), super_classes->begin(),
+                       super_classes->end());
+      }
     }
   }
   m_init_classes.update(
@@ -7,10 +7,12 @@
 
 #include "KotlinInstanceRewriter.h"
 #include "CFGMutation.h"
+#include "KotlinUseSites.h"
 #include "PassManager.h"
 #include "ScopedCFG.h"
 #include "Show.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 DexField* has_instance_field(DexClass* cls, const DexString* instance) {
@@ -63,54 +65,55 @@ KotlinInstanceRewriter::Stats KotlinInstanceRewriter::remove_escaping_instance(
                   std::set<std::pair<IRInstruction*, DexMethod*>>>&
         concurrent_instance_map) {
   ConcurrentSet<DexFieldRef*> remove_list;
+  // Only the methods that reference the classes of the INSTANCE fields can
+  // read or write them.
+  std::unordered_set<const DexType*> instance_types;
+  for (auto& it : concurrent_instance_map) {
+    instance_types.insert(it.first->get_class());
+  }
+  KotlinUseSites use_sites(scope, instance_types);
   // Get all the single uses of the INSTANCE variables
-  KotlinInstanceRewriter::Stats total_stats =
-      walk::parallel::methods<KotlinInstanceRewriter::Stats>(
-          scope, [&](DexMethod* method) {
-            KotlinInstanceRewriter::Stats stats{};
-            auto code = method->get_code();
-            if (!code) {
-              return stats;
-            }
-
-            cfg::ScopedCFG cfg(method->get_code());
-            auto iterable = cfg::InstructionIterable(*cfg);
-            for (auto it = iterable.begin(); it != iterable.end(); it++) {
-              auto insn = it->insn;
-
-              if (!opcode::is_an_sget(insn->opcode()) &&
-                  !opcode::is_an_sput(insn->opcode())) {
-                continue;
-              }
+  KotlinInstanceRewriter::Stats total_stats{};
+  workqueue_run<DexMethod*>(
+      [&](DexMethod* method) {
+        cfg::ScopedCFG cfg(method->get_code());
+        auto iterable = cfg::InstructionIterable(*cfg);
+        for (auto it = iterable.begin(); it != iterable.end(); it++) {
+          auto insn = it->insn;
 
-              auto field = insn->get_field();
-              if (!concurrent_instance_map.count(field)) {
-                continue;
-              }
-              if (remove_list.count(field)) {
-                continue;
-              }
-              // If there is more SPUT otherthan the initial one.
-              if (opcode::is_an_sput(insn->opcode())) {
-                if (method::is_clinit(method) &&
-                    method->get_class() == field->get_type()) {
-                  continue;
-                }
-                // Erase if the field is written elsewhere.
-                remove_list.insert(field);
-                continue;
-              }
+          if (!opcode::is_an_sget(insn->opcode()) &&
+              !opcode::is_an_sput(insn->opcode())) {
+            continue;
+          }
 
-              concurrent_instance_map.update(
-                  field,
-                  [&](DexFieldRef*,
-                      std::set<std::pair<IRInstruction*, DexMethod*>>& s,
-                      bool /* exists */) {
-                    s.insert(std::make_pair(insn, method));
-                  });
+          auto field = insn->get_field();
+          if (!concurrent_instance_map.count(field)) {
+            continue;
+          }
+          if (remove_list.count(field)) {
+            continue;
+          }
+          // If there is more SPUT otherthan the initial one.
+          if (opcode::is_an_sput(insn->opcode())) {
+            if (method::is_clinit(method) &&
+                method->get_class() == field->get_type()) {
+              continue;
             }
-            return stats;
-          });
+            // Erase if the field is written elsewhere.
+            remove_list.insert(field);
+            continue;
+          }
+
+          concurrent_instance_map.update(
+              field,
+              [&](DexFieldRef*,
+                  std::set<std::pair<IRInstruction*, DexMethod*>>& s,
+                  bool /* exists */) {
+                s.insert(std::make_pair(insn, method));
+              });
+        }
+      },
+      use_sites.get_any(instance_types));
   for (auto* field : remove_list) {
     concurrent_instance_map.erase(field);
   }
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "KotlinUseSites.h"
+
+#include "ConcurrentContainers.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "Walkers.h"
+
+KotlinUseSites::KotlinUseSites(
+    const Scope& scope, const std::unordered_set<const DexType*>& types) {
+  if (types.empty()) {
+    return;
+  }
+  ConcurrentMap<const DexType*, std::vector<DexMethod*>> use_sites;
+  walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
+    std::vector<DexType*> refs;
+    method->get_proto()->gather_types(refs);
+    for (const auto& mie : InstructionIterable(code)) {
+      mie.insn->gather_types(refs);
+    }
+    std::unordered_set<const DexType*> referenced;
+    for (auto* ref : refs) {
+      if (types.count(ref)) {
+        referenced.insert(ref);
+      }
+    }
+    for (const auto* type : referenced) {
+      use_sites.update(type,
+                       [method](const DexType*, std::vector<DexMethod*>& v,
+                                bool /* exists */) { v.push_back(method); });
+    }
+  });
+  for (auto& [type, methods] : use_sites) {
+    auto& sorted = m_use_sites[type];
+    sorted = std::move(methods);
+    std::sort(sorted.begin(), sorted.end(), compare_dexmethods);
+  }
+}
+
+const std::vector<DexMethod*>& KotlinUseSites::get(
+    const DexType* type) const {
+  static const std::vector<DexMethod*> no_use_sites;
+  auto it = m_use_sites.find(type);
+  return it == m_use_sites.end() ? no_use_sites : it->second;
+}
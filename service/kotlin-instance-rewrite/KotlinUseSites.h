@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "DexClass.h"
+
+/*
+ * The methods that reference each of a set of Kotlin singleton, lambda or
+ * companion object classes, found in one parallel walk over all the code.
+ *
+ * A method references a class if its proto does, or if one of its
+ * instructions has a type, field or method ref that mentions it. The passes
+ * that rewrite the uses of such classes only need to look at these methods,
+ * instead of building a CFG for every method in the scope.
+ *
+ * This is a snapshot: code that changes after construction, e.g., because
+ * methods are inlined, is not indexed again.
+ */
+class KotlinUseSites {
+ public:
+  KotlinUseSites(const Scope& scope,
+                 const std::unordered_set<const DexType*>& types);
+
+  // The methods with code that reference the type, in sorted order.
+  const std::vector<DexMethod*>& get(const DexType* type) const;
+
+  // The methods with code that reference any of the types, in sorted order.
+  template <typename Types>
+  std::vector<DexMethod*> get_any(const Types& types) const {
+    std::unordered_set<DexMethod*> methods;
+    for (const auto* type : types) {
+      const auto& use_sites = get(type);
+      methods.insert(use_sites.begin(), use_sites.end());
+    }
+    std::vector<DexMethod*> sorted(methods.begin(), methods.end());
+    std::sort(sorted.begin(), sorted.end(), compare_dexmethods);
+    return sorted;
+  }
+
+ private:
+  std::unordered_map<const DexType*, std::vector<DexMethod*>> m_use_sites;
+};
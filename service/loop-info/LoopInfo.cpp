@@ -125,9 +125,7 @@ LoopInfo::LoopInfo(cfg::ControlFlowGraph& cfg) {
     }
 
     // connect the preheader with the header
-    auto edge =
-        new cfg::Edge(loop_preheader, loop_header, cfg::EdgeType::EDGE_GOTO);
-    cfg.add_edge(edge);
+    cfg.add_edge(loop_preheader, loop_header, cfg::EdgeType::EDGE_GOTO);
     return loop_preheader;
   });
 }
@@ -7,61 +7,88 @@
 
 #include "MethodDedup.h"
 
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+#include <iterator>
+#include <numeric>
+
 #include "DexOpcode.h"
 #include "IRCode.h"
 #include "MethodReference.h"
 #include "Show.h"
 #include "Trace.h"
+#include "WorkQueue.h"
 
 namespace {
 
-struct CodeAsKey {
-  const IRCode* code;
-  const bool dedup_throw_blocks;
+// Below this many methods, grouping is not worth spreading over threads.
+constexpr size_t kMinMethodsForParallelGrouping = 1024;
 
-  CodeAsKey(const IRCode* c, bool dedup_throw_blocks)
-      : code(c), dedup_throw_blocks(dedup_throw_blocks) {}
+bool non_throw_instruction_equal(const IRInstruction& left,
+                                 const IRInstruction& right) {
+  return left == right && !opcode::is_throw(left.opcode()) &&
+         !opcode::is_throw(right.opcode());
+}
 
-  static bool non_throw_instruction_equal(const IRInstruction& left,
-                                          const IRInstruction& right) {
-    return left == right && !opcode::is_throw(left.opcode()) &&
-           !opcode::is_throw(right.opcode());
-  }
+bool code_equals(const IRCode* left,
+                 const IRCode* right,
+                 bool dedup_throw_blocks) {
+  return dedup_throw_blocks
+             ? left->structural_equals(*right)
+             : left->structural_equals(*right, non_throw_instruction_equal);
+}
 
-  bool operator==(const CodeAsKey& other) const {
-    return dedup_throw_blocks ? code->structural_equals(*other.code)
-                              : code->structural_equals(
-                                    *other.code, non_throw_instruction_equal);
+// A hash of what makes methods identical: their proto and their code. It does
+// not depend on the order of the instructions, but it agrees with
+// code_equals.
+size_t identity_hash(const DexMethod* method) {
+  const auto* code = method->get_code();
+  always_assert(code);
+  size_t code_hash = 0;
+  for (auto& mie : InstructionIterable(code)) {
+    code_hash ^= mie.insn->hash();
   }
-};
+  size_t result = 0;
+  boost::hash_combine(result, method->get_proto());
+  boost::hash_combine(result, code->sum_opcode_sizes());
+  boost::hash_combine(result, code_hash);
+  return result;
+}
 
-struct CodeHasher {
-  size_t operator()(const CodeAsKey& key) const {
-    size_t result = 0;
-    for (auto& mie : InstructionIterable(key.code)) {
-      result ^= mie.insn->hash();
-    }
-    return result;
-  }
+struct HashedMethod {
+  size_t hash;
+  DexMethod* method;
 };
 
-using DuplicateMethods =
-    std::unordered_map<CodeAsKey, MethodOrderedSet, CodeHasher>;
-
-std::vector<MethodOrderedSet> get_duplicate_methods_simple(
-    const MethodOrderedSet& methods, bool dedup_throw_blocks) {
-  DuplicateMethods duplicates;
-  for (DexMethod* method : methods) {
-    always_assert(method->get_code());
-    duplicates[CodeAsKey(method->get_code(), dedup_throw_blocks)].emplace(
-        method);
+// Groups the identical methods among `methods`. Only methods with the same
+// hash are compared.
+std::vector<MethodOrderedSet> group_hashed_methods(
+    const std::vector<const HashedMethod*>& methods, bool dedup_throw_blocks) {
+  std::unordered_map<size_t, std::vector<MethodOrderedSet>> buckets;
+  for (const auto* hashed : methods) {
+    auto* method = hashed->method;
+    auto& groups = buckets[hashed->hash];
+    auto it = std::find_if(groups.begin(), groups.end(), [&](const auto& g) {
+      if (g.count(method)) {
+        return true;
+      }
+      const auto* other = *g.begin();
+      return other->get_proto() == method->get_proto() &&
+             code_equals(method->get_code(), other->get_code(),
+                         dedup_throw_blocks);
+    });
+    if (it == groups.end()) {
+      groups.emplace_back().emplace(method);
+    } else {
+      it->emplace(method);
+    }
   }
-
   std::vector<MethodOrderedSet> result;
-  for (auto& duplicate : duplicates) {
-    result.push_back(std::move(duplicate.second));
+  for (auto& [hash, groups] : buckets) {
+    for (auto& group : groups) {
+      result.push_back(std::move(group));
+    }
   }
-
   return result;
 }
 
@@ -100,17 +127,49 @@ std::vector<MethodOrderedSet> group_similar_methods(
 
 std::vector<MethodOrderedSet> group_identical_methods(
     const std::vector<DexMethod*>& methods, bool dedup_throw_blocks) {
-  std::vector<MethodOrderedSet> result;
-  std::vector<MethodOrderedSet> same_protos = group_similar_methods(methods);
-
-  // Find actual duplicates.
-  for (const auto& same_proto : same_protos) {
-    std::vector<MethodOrderedSet> duplicates =
-        get_duplicate_methods_simple(same_proto, dedup_throw_blocks);
+  // First hash all the methods, then group the methods of each shard of hash
+  // values on its own thread.
+  const bool parallel = methods.size() >= kMinMethodsForParallelGrouping;
+  std::vector<HashedMethod> hashed(methods.size());
+  auto hash_method = [&](size_t i) {
+    hashed[i] = {identity_hash(methods[i]), methods[i]};
+  };
+  if (parallel) {
+    std::vector<size_t> indices(methods.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    workqueue_run<size_t>(hash_method, indices);
+  } else {
+    for (size_t i = 0; i < methods.size(); ++i) {
+      hash_method(i);
+    }
+  }
 
-    result.insert(result.end(), duplicates.begin(), duplicates.end());
+  const size_t num_shards =
+      parallel ? redex_parallel::default_num_threads() * 4 : 1;
+  std::vector<std::vector<const HashedMethod*>> shards(num_shards);
+  for (const auto& h : hashed) {
+    shards[h.hash % num_shards].push_back(&h);
+  }
+  std::vector<std::vector<MethodOrderedSet>> shard_groups(num_shards);
+  auto group_shard = [&](size_t i) {
+    shard_groups[i] = group_hashed_methods(shards[i], dedup_throw_blocks);
+  };
+  if (parallel) {
+    std::vector<size_t> indices(num_shards);
+    std::iota(indices.begin(), indices.end(), 0);
+    workqueue_run<size_t>(group_shard, indices);
+  } else {
+    group_shard(0);
   }
 
+  std::vector<MethodOrderedSet> result;
+  for (auto& groups : shard_groups) {
+    std::move(groups.begin(), groups.end(), std::back_inserter(result));
+  }
+  // Make the order independent of the hashes, which depend on pointers.
+  std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+    return compare_dexmethods(*a.begin(), *b.begin());
+  });
   return result;
 }
 
@@ -30,6 +30,8 @@ std::vector<MethodOrderedSet> group_similar_methods(
  * Group methods that are identical in that they share the same signature and
  * identical code. We ignore non-opcodes like debug info.
  * Note that there's no side affects other than the grouping here.
+ * Large inputs are hashed and grouped in parallel. The groups are ordered by
+ * their first method.
  */
 std::vector<MethodOrderedSet> group_identical_methods(
     const std::vector<DexMethod*>&, bool dedup_throw_blocks);
@@ -43,14 +43,14 @@ size_t num_interactions(const InstructionIterator& inline_site,
   {
     auto sb_vec = source_blocks::gather_source_blocks(inline_site.block());
     if (!sb_vec.empty()) {
-      return sb_vec[0]->vals.size();
+      return sb_vec[0]->vals_size();
     }
   }
 
   {
     auto sb_vec = source_blocks::gather_source_blocks(callee_cfg.entry_block());
     if (!sb_vec.empty()) {
-      return sb_vec[0]->vals.size();
+      return sb_vec[0]->vals_size();
     }
   }
 
@@ -105,8 +105,9 @@ float get_source_blocks_factor(const InstructionIterator& inline_site,
 void normalize_source_blocks(ControlFlowGraph& cfg, float factor, size_t idx) {
   for (auto* b : cfg.blocks()) {
     source_blocks::foreach_source_block(b, [&](auto* sb) {
-      if (sb->vals[idx]) {
-        sb->vals[idx]->val *= factor;
+      if (auto val = sb->vals()[idx]) {
+        val->val *= factor;
+        sb->set_val(idx, val);
       }
     });
   }
@@ -110,10 +110,16 @@ CallSiteSummarizer::CallSiteSummarizer(
       m_has_callee_other_call_sites_fn(
           std::move(has_callee_other_call_sites_fn)),
       m_filter_fn(filter_fn),
-      m_stats(stats) {}
+      m_stats(stats),
+      m_top_call_site_summaries{
+          {{CallSiteArguments::top(), /* result_used */ false},
+           {CallSiteArguments::top(), /* result_used */ true}}} {}
 
 const CallSiteSummary* CallSiteSummarizer::internalize_call_site_summary(
     const CallSiteSummary& call_site_summary) {
+  if (call_site_summary.arguments.is_top()) {
+    return &m_top_call_site_summaries[call_site_summary.result_used];
+  }
   auto key = call_site_summary.get_key();
   const CallSiteSummary* res;
   m_call_site_summaries.update(
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <array>
+
 #include "Shrinker.h"
 
 using CallSiteArguments = constant_propagation::interprocedural::ArgumentDomain;
@@ -98,6 +100,13 @@ class CallSiteSummarizer {
   ConcurrentMap<std::string, std::unique_ptr<const CallSiteSummary>>
       m_call_site_summaries;
 
+  /**
+   * Call-site summaries without any constant arguments, indexed by
+   * result_used. They are by far the most common ones, and are handed out
+   * without going through (and contending on) the internalization table.
+   */
+  const std::array<CallSiteSummary, 2> m_top_call_site_summaries;
+
   /**
    * For all (reachable) invoke instructions in a given method, collect
    * information about their arguments, i.e. whether particular arguments
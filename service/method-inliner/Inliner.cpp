@@ -23,12 +23,14 @@
 #include "LocalDce.h"
 #include "LoopInfo.h"
 #include "Macros.h"
+#include "MethodAnalysisCache.h"
 #include "MethodProfiles.h"
 #include "MonitorCount.h"
 #include "Mutators.h"
 #include "OptData.h"
 #include "OutlinedMethods.h"
 #include "RecursionPruner.h"
+#include "RedexContext.h"
 #include "StlUtil.h"
 #include "Timer.h"
 #include "UnknownVirtuals.h"
@@ -149,7 +151,8 @@ MultiMethodInliner::MultiMethodInliner(
         std::make_unique<std::vector<std::unique_ptr<RefChecker>>>();
     for (size_t store_idx = 0; store_idx < xstores.size(); store_idx++) {
       m_ref_checkers->emplace_back(
-          std::make_unique<RefChecker>(&xstores, store_idx, min_sdk_api));
+          std::make_unique<RefChecker>(&xstores, store_idx, min_sdk_api,
+                                       scope));
     }
   }
 
@@ -314,8 +317,21 @@ void MultiMethodInliner::inline_methods(bool methods_need_deconstruct) {
     }
   }
 
+  // The work of a task, inlining into a method and shrinking it, grows with
+  // the size of the method. Prioritizing the tasks that unblock the most
+  // work keeps big callers from starting last.
+  m_scheduler.set_weight_fn([](DexMethod* method) -> int {
+    auto code = method->get_code();
+    if (code == nullptr) {
+      return 1;
+    }
+    return 1 + (code->editable_cfg_built() ? code->cfg().sum_opcode_sizes()
+                                           : code->sum_opcode_sizes());
+  });
   info.critical_path_length =
       m_scheduler.run(methods_to_schedule.begin(), methods_to_schedule.end());
+  info.utilization = m_scheduler.get_thread_pool().get_utilization(
+      InliningInfo::UTILIZATION_PERIODS);
 
   m_ab_experiment_context->flush();
   m_ab_experiment_context = nullptr;
@@ -706,7 +722,8 @@ size_t MultiMethodInliner::inline_inlinables(
       if (!not_inlinable && m_config.intermediate_shrinking &&
           m_shrinker.enabled()) {
         intermediate_shrinkings++;
-        m_shrinker.shrink_method(caller_method);
+        m_shrinker.shrink_method(caller_method,
+                                 m_config.fast_intermediate_shrinking);
         cfg_next_caller_reg = caller->cfg().get_registers_size();
         estimated_caller_size = caller->cfg().sum_opcode_sizes();
         recompute_remaining_callsites();
@@ -1367,9 +1384,19 @@ const InlinedCost* MultiMethodInliner::get_fully_inlined_cost(
   if (inlined_cost) {
     return inlined_cost.get();
   }
-  inlined_cost = std::make_shared<InlinedCost>(
-      get_inlined_cost(is_static(callee), callee->get_class(),
-                       callee->get_proto(), callee->get_code()));
+  const IRCode* code = callee->get_code();
+  auto compute = [&]() {
+    return get_inlined_cost(is_static(callee), callee->get_class(),
+                            callee->get_proto(), code);
+  };
+  if (code->editable_cfg_built()) {
+    // The inliners of different passes mostly see the same callees, whose
+    // full costs only depend on their code.
+    inlined_cost = g_redex->method_analysis_cache().get(
+        callee, code->cfg(), "InlinedCost", compute);
+  } else {
+    inlined_cost = std::make_shared<const InlinedCost>(compute());
+  }
   TRACE(INLINE, 4, "get_fully_inlined_cost(%s) = {%zu,%f,%f,%f,%s,%f,%d,%zu}",
         SHOW(callee), inlined_cost->full_code, inlined_cost->code,
         inlined_cost->method_refs, inlined_cost->other_refs,
@@ -1378,7 +1405,8 @@ const InlinedCost* MultiMethodInliner::get_fully_inlined_cost(
         inlined_cost->insn_size);
   m_fully_inlined_costs.update(
       callee,
-      [&](const DexMethod*, std::shared_ptr<InlinedCost>& value, bool exists) {
+      [&](const DexMethod*, std::shared_ptr<const InlinedCost>& value,
+          bool exists) {
         if (exists) {
           // We wasted some work, and some other thread beat us. Oh well...
           always_assert(*value == *inlined_cost);
@@ -104,7 +104,7 @@ struct InlinedCost {
   // Maximum or call-site specific estimated callee size after pruning
   size_t insn_size;
 
-  bool operator==(const InlinedCost& other) {
+  bool operator==(const InlinedCost& other) const {
     // TODO: Also check that reduced_cfg's are equivalent
     return full_code == other.full_code && code == other.code &&
            method_refs == other.method_refs && other_refs == other.other_refs &&
@@ -494,8 +494,9 @@ class MultiMethodInliner {
   std::unordered_set<const DexMethod*> m_x_dex_callees;
 
   // Cache of the inlined costs of fully inlining a calle without using any
-  // summaries for pruning.
-  mutable ConcurrentMap<const DexMethod*, std::shared_ptr<InlinedCost>>
+  // summaries for pruning. Callees with an editable CFG also share them with
+  // later inliners through the method analysis cache.
+  mutable ConcurrentMap<const DexMethod*, std::shared_ptr<const InlinedCost>>
       m_fully_inlined_costs;
 
   // Cache of the average inlined costs of each method.
@@ -565,6 +566,10 @@ class MultiMethodInliner {
     size_t max_call_stack_depth{0};
     size_t waited_seconds{0};
     int critical_path_length{0};
+    // Average fraction of busy scheduler threads over each tenth of the time
+    // spent inlining.
+    static constexpr size_t UTILIZATION_PERIODS = 10;
+    std::vector<double> utilization;
 
     // statistics that may be incremented concurrently
     std::atomic<size_t> kotlin_lambda_inlined{0};
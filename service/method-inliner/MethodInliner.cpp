@@ -8,6 +8,7 @@
 #include "MethodInliner.h"
 
 #include <algorithm>
+#include <cmath>
 #include <map>
 #include <set>
 #include <string>
@@ -540,8 +541,7 @@ void gather_true_virtual_methods(const mog::Graph& method_override_graph,
           live_range::MoveAwareChains chains(code->cfg());
           auto ii = InstructionIterable(code->cfg().get_param_instructions());
           auto first_load_param = ii.begin()->insn;
-          first_load_param_uses =
-              std::move(chains.get_def_use_chains()[first_load_param]);
+          first_load_param_uses = chains.get_uses(first_load_param);
           code->clear_cfg();
         }
         std::unordered_set<DexType*> formal_callee_types;
@@ -831,6 +831,9 @@ void run_inliner(DexStoresVector& stores,
   mgr.incr_metric("inlined_init_count", inlined_init_count);
   mgr.incr_metric("init_classes", inliner.get_info().init_classes);
   mgr.incr_metric("calls_inlined", inliner.get_info().calls_inlined);
+  mgr.incr_metric("resolved_refs_l1_hits", concurrent_resolved_refs.l1_hits());
+  mgr.incr_metric("resolved_refs_l2_hits", concurrent_resolved_refs.l2_hits());
+  mgr.incr_metric("resolved_refs_misses", concurrent_resolved_refs.misses());
   mgr.incr_metric("kotlin_lambda_inlined",
                   inliner.get_info().kotlin_lambda_inlined);
   mgr.incr_metric("calls_not_inlinable",
@@ -870,7 +873,13 @@ void run_inliner(DexStoresVector& stores,
                   inliner.get_info().constant_invoke_callees_unused_results);
   mgr.incr_metric("critical_path_length",
                   inliner.get_info().critical_path_length);
+  const auto& utilization = inliner.get_info().utilization;
+  for (size_t i = 0; i < utilization.size(); ++i) {
+    mgr.incr_metric("scheduler_utilization_percent_" + std::to_string(i),
+                    std::lround(utilization[i] * 100));
+  }
   mgr.incr_metric("methods_shrunk", shrinker.get_methods_shrunk());
+  mgr.incr_metric("methods_fast_shrunk", shrinker.get_methods_fast_shrunk());
   mgr.incr_metric("callers", inliner.get_callers());
   if (intra_dex) {
     mgr.incr_metric("x-dex-callees", inliner.get_x_dex_callees());
@@ -7,6 +7,8 @@
 
 #include "TypeReference.h"
 
+#include <numeric>
+
 #include "MethodReference.h"
 #include "Resolver.h"
 #include "Show.h"
@@ -116,10 +118,9 @@ void add_vmethod_to_group(DexType* old_type_ref,
 void add_vmethod_to_groups(
     const std::unordered_map<const DexType*, DexType*>& old_to_new,
     DexMethod* method,
+    size_t org_signature_hash,
+    const DexString* possible_new_name,
     VMethodsGroups* groups) {
-  size_t org_signature_hash = hash_signature(method);
-  auto possible_new_name = gen_new_name(method->str(), org_signature_hash);
-
   auto proto = method->get_proto();
   auto rtype =
       const_cast<DexType*>(type::get_element_type_if_array(proto->get_rtype()));
@@ -424,61 +425,102 @@ void update_method_signature_type_references(
     const ClassHierarchy& ch,
     boost::optional<std::unordered_map<DexMethod*, std::string>&>
         method_debug_map) {
+  UnorderedTypeSet old_types;
+  for (auto& pair : old_to_new) {
+    old_types.insert(pair.first);
+  }
+
+  // A direct method can only collide with the methods of its class, and the
+  // virtual methods are only updated after all the direct ones. So the direct
+  // methods of each class are updated in order, on their own, with the
+  // classes in parallel.
+  struct VMethodInfo {
+    DexMethod* method;
+    size_t org_signature_hash;
+    const DexString* possible_new_name;
+  };
+  struct ClassUpdates {
+    std::vector<std::pair<DexMethod*, std::string>> debug_signatures;
+    std::vector<std::pair<DexMethod*, DexProto*>> colliding_directs;
+    std::vector<VMethodInfo> vmethods;
+  };
+  std::vector<ClassUpdates> updates(scope.size());
+  std::vector<size_t> indices(scope.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t index) {
+        auto& cls_updates = updates[index];
+        auto update = [&](DexMethod* method) {
+          auto proto = method->get_proto();
+          if (!proto_has_reference_to(proto, old_types)) {
+            return;
+          }
+          if (method_debug_map != boost::none) {
+            cls_updates.debug_signatures.emplace_back(
+                method, get_method_signature(method));
+          }
+          if (!method->is_virtual()) {
+            auto new_proto = get_new_proto(proto, old_to_new);
+            /// A. For direct methods:
+            // If there is no collision, update spec directly.
+            // If it's not constructor and renamable, rename on collision.
+            // Otherwise, add it to colliding_directs.
+            auto collision = DexMethod::get_method(
+                method->get_class(), method->get_name(), new_proto);
+            if (!collision ||
+                (!method::is_init(method) && can_rename(method))) {
+              TRACE(REFU, 8, "sig: updating direct method %s", SHOW(method));
+              DexMethodSpec spec;
+              spec.proto = new_proto;
+              method->change(spec, true /* rename on collision */);
+            } else {
+              cls_updates.colliding_directs.emplace_back(method, new_proto);
+            }
+            return;
+          }
+          // B. For virtual methods: Collect the methods that reference the
+          // old types, along with their possible new names.
+          size_t org_signature_hash = hash_signature(method);
+          cls_updates.vmethods.push_back(
+              {method, org_signature_hash,
+               gen_new_name(method->str(), org_signature_hash)});
+        };
+        for (auto* method : scope[index]->get_dmethods()) {
+          update(method);
+        }
+        for (auto* method : scope[index]->get_vmethods()) {
+          update(method);
+        }
+      },
+      indices);
+
   // Virtual methods.
   // The key is the hash of signature and an old type reference. Group the
   // methods by key.
   VMethodsGroups vmethods_groups;
   // Colliding direct methods.
   std::vector<std::pair<DexMethod*, DexProto*>> colliding_directs;
-
-  // Callback for updating method debug map.
-  std::function<void(DexMethod*)> update_method_debug_map = [](DexMethod*) {};
-  if (method_debug_map != boost::none) {
-    update_method_debug_map = [&method_debug_map](DexMethod* method) {
-      method_debug_map.get()[method] = get_method_signature(method);
-    };
-  }
-
-  UnorderedTypeSet old_types;
-  for (auto& pair : old_to_new) {
-    old_types.insert(pair.first);
-  }
-
-  walk::methods(scope, [&](DexMethod* method) {
-    auto proto = method->get_proto();
-    if (!proto_has_reference_to(proto, old_types)) {
-      return;
-    }
-    update_method_debug_map(method);
-    if (!method->is_virtual()) {
-      auto new_proto = get_new_proto(proto, old_to_new);
-      /// A. For direct methods:
-      // If there is no collision, update spec directly.
-      // If it's not constructor and renamable, rename on collision.
-      // Otherwise, add it to colliding_directs.
-      auto collision = DexMethod::get_method(
-          method->get_class(), method->get_name(), new_proto);
-      if (!collision || (!method::is_init(method) && can_rename(method))) {
-        TRACE(REFU, 8, "sig: updating direct method %s", SHOW(method));
-        DexMethodSpec spec;
-        spec.proto = new_proto;
-        method->change(spec, true /* rename on collision */);
-      } else {
-        colliding_directs.emplace_back(std::make_pair(method, new_proto));
+  for (auto& cls_updates : updates) {
+    if (method_debug_map != boost::none) {
+      for (auto& [method, signature] : cls_updates.debug_signatures) {
+        method_debug_map.get()[method] = std::move(signature);
       }
-      return;
     }
-    // B. For virtual methods: Collect the methods that reference the old
-    // types to oldtype_to_vmethods. Calculate new proto for each method and
-    // store to method_to_new_proto.
-    add_vmethod_to_groups(old_to_new, method, &vmethods_groups);
-  });
+    colliding_directs.insert(colliding_directs.end(),
+                             cls_updates.colliding_directs.begin(),
+                             cls_updates.colliding_directs.end());
+    for (const auto& info : cls_updates.vmethods) {
+      add_vmethod_to_groups(old_to_new, info.method, info.org_signature_hash,
+                            info.possible_new_name, &vmethods_groups);
+    }
+  }
 
   // Solve updating collision for direct methods by appending primitive
   // arguments.
   fix_colliding_dmethods(scope, colliding_directs);
 
-  // Update virtual methods group by group.
+  // Update virtual methods group by group. Renaming a group depends on the
+  // groups updated before it anywhere in the hierarchy, so this stays serial.
   for (auto& key_and_group : vmethods_groups) {
     auto& group = key_and_group.second;
     update_vmethods_group_one_type_ref(group, ch);
@@ -542,40 +584,65 @@ void fix_colliding_dmethods(
   if (colliding_methods.empty()) {
     return;
   }
-  // Fix colliding methods by appending an additional param.
+  // Fix colliding methods by appending an additional param. The new protos
+  // can only collide within a class, so classes are fixed in parallel.
   TRACE(REFU, 9, "sig: colliding_methods %zu", colliding_methods.size());
-  std::unordered_map<DexMethod*, size_t> num_additional_args;
-  for (auto it : colliding_methods) {
-    auto meth = it.first;
-    auto new_proto = it.second;
-    auto new_arg_list = new_proto->get_args()->push_back(type::_int());
-    new_proto = DexProto::make_proto(new_proto->get_rtype(), new_arg_list);
-    size_t arg_count = 1;
-    while (DexMethod::get_method(
-               meth->get_class(), meth->get_name(), new_proto) != nullptr) {
-      new_arg_list = new_proto->get_args()->push_back(type::_int());
-      new_proto = DexProto::make_proto(new_proto->get_rtype(), new_arg_list);
-      ++arg_count;
+  std::vector<std::vector<std::pair<DexMethod*, DexProto*>>> by_class;
+  std::unordered_map<const DexType*, size_t> class_indices;
+  for (const auto& it : colliding_methods) {
+    auto [class_it, inserted] =
+        class_indices.emplace(it.first->get_class(), by_class.size());
+    if (inserted) {
+      by_class.emplace_back();
     }
-
-    DexMethodSpec spec;
-    spec.proto = new_proto;
-    meth->change(spec, false /* rename on collision */);
-    num_additional_args[meth] = arg_count;
-
-    auto code = meth->get_code();
-    for (size_t i = 0; i < arg_count; ++i) {
-      auto new_param_reg = code->allocate_temp();
-      auto params = code->get_param_instructions();
-      auto new_param_load = new IRInstruction(IOPCODE_LOAD_PARAM);
-      new_param_load->set_dest(new_param_reg);
-      code->insert_before(params.end(), new_param_load);
+    by_class[class_it->second].push_back(it);
+  }
+  std::vector<std::vector<size_t>> arg_counts(by_class.size());
+  std::vector<size_t> indices(by_class.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t index) {
+        for (auto it : by_class[index]) {
+          auto meth = it.first;
+          auto new_proto = it.second;
+          auto new_arg_list = new_proto->get_args()->push_back(type::_int());
+          new_proto =
+              DexProto::make_proto(new_proto->get_rtype(), new_arg_list);
+          size_t arg_count = 1;
+          while (DexMethod::get_method(meth->get_class(), meth->get_name(),
+                                       new_proto) != nullptr) {
+            new_arg_list = new_proto->get_args()->push_back(type::_int());
+            new_proto =
+                DexProto::make_proto(new_proto->get_rtype(), new_arg_list);
+            ++arg_count;
+          }
+
+          DexMethodSpec spec;
+          spec.proto = new_proto;
+          meth->change(spec, false /* rename on collision */);
+          arg_counts[index].push_back(arg_count);
+
+          auto code = meth->get_code();
+          for (size_t i = 0; i < arg_count; ++i) {
+            auto new_param_reg = code->allocate_temp();
+            auto params = code->get_param_instructions();
+            auto new_param_load = new IRInstruction(IOPCODE_LOAD_PARAM);
+            new_param_load->set_dest(new_param_reg);
+            code->insert_before(params.end(), new_param_load);
+          }
+          TRACE(REFU,
+                9,
+                "sig: patching colliding method %s with %zu additional args",
+                SHOW(meth),
+                arg_count);
+        }
+      },
+      indices);
+  std::unordered_map<DexMethod*, size_t> num_additional_args;
+  for (size_t index = 0; index < by_class.size(); ++index) {
+    for (size_t i = 0; i < by_class[index].size(); ++i) {
+      num_additional_args[by_class[index][i].first] = arg_counts[index][i];
     }
-    TRACE(REFU,
-          9,
-          "sig: patching colliding method %s with %zu additional args",
-          SHOW(meth),
-          arg_count);
   }
 
   walk::parallel::code(scope, [&](DexMethod* meth, IRCode& code) {
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "BitVectorLiveness.h"
+
+#include <algorithm>
+#include <deque>
+#include <numeric>
+
+#include "IRCode.h"
+
+namespace regalloc {
+
+namespace {
+
+// The analysis holds three sets per block while it runs: the registers used
+// and defined by the block, and the live-in set.
+constexpr size_t kMaxWords = 1 << 22;
+
+uint32_t reverse_bits(uint32_t x) {
+  uint32_t result = 0;
+  for (size_t i = 0; i < 32; ++i) {
+    result = (result << 1) | (x & 1);
+    x >>= 1;
+  }
+  return result;
+}
+
+size_t words(reg_t registers_size) {
+  return (registers_size + 63) / 64;
+}
+
+size_t block_index_size(const std::vector<cfg::Block*>& blocks) {
+  // The blocks are sorted by id.
+  return blocks.empty() ? 0 : blocks.back()->id() + 1;
+}
+
+} // namespace
+
+bool BitVectorLiveness::is_applicable(const cfg::ControlFlowGraph& cfg,
+                                      reg_t registers_size) {
+  return 3 * words(registers_size) * cfg.num_blocks() <= kMaxWords;
+}
+
+BitVectorLiveness::BitVectorLiveness(const cfg::ControlFlowGraph& cfg,
+                                     reg_t registers_size)
+    : m_bits(registers_size), m_registers(registers_size) {
+  // Patricia trees enumerate their keys by increasing bit-reversed value.
+  std::iota(m_registers.begin(), m_registers.end(), 0);
+  std::sort(m_registers.begin(), m_registers.end(), [](reg_t a, reg_t b) {
+    return reverse_bits(a) < reverse_bits(b);
+  });
+  for (size_t bit = 0; bit < m_registers.size(); ++bit) {
+    m_bits[m_registers[bit]] = bit;
+  }
+
+  // The transfer function of a block b is
+  //
+  //   live_in(b) = uses(b) ∪ (live_out(b) - defs(b))
+  //
+  // where uses(b) are the registers read before any write in b.
+  auto blocks = cfg.blocks();
+  size_t index_size = block_index_size(blocks);
+  RegisterSet empty(registers_size);
+  m_live_in.assign(index_size, empty);
+  std::vector<RegisterSet> uses(index_size, empty);
+  std::vector<RegisterSet> defs(index_size, empty);
+  for (cfg::Block* block : blocks) {
+    auto& block_uses = uses[block->id()];
+    auto& block_defs = defs[block->id()];
+    for (auto it = block->rbegin(); it != block->rend(); ++it) {
+      if (it->type != MFLOW_OPCODE) {
+        continue;
+      }
+      auto insn = it->insn;
+      if (insn->has_dest()) {
+        block_uses.reset(m_bits.at(insn->dest()));
+        block_defs.set(m_bits.at(insn->dest()));
+      }
+      for (size_t i = 0; i < insn->srcs_size(); ++i) {
+        block_uses.set(m_bits.at(insn->src(i)));
+      }
+    }
+  }
+
+  // Visiting blocks in reverse order of their ids roughly follows the
+  // backward flow of liveness, so that most blocks are analyzed a few times.
+  std::deque<cfg::Block*> worklist(blocks.rbegin(), blocks.rend());
+  std::vector<bool> in_worklist(index_size, false);
+  for (cfg::Block* block : blocks) {
+    in_worklist[block->id()] = true;
+  }
+  while (!worklist.empty()) {
+    cfg::Block* block = worklist.front();
+    worklist.pop_front();
+    in_worklist[block->id()] = false;
+    RegisterSet live_in = get_live_out_vars_at(block);
+    live_in -= defs[block->id()];
+    live_in |= uses[block->id()];
+    if (live_in == m_live_in[block->id()]) {
+      continue;
+    }
+    m_live_in[block->id()] = std::move(live_in);
+    for (const cfg::Edge* edge : block->preds()) {
+      cfg::Block* pred = edge->src();
+      if (!in_worklist[pred->id()]) {
+        in_worklist[pred->id()] = true;
+        worklist.push_back(pred);
+      }
+    }
+  }
+}
+
+BitVectorLiveness::RegisterSet BitVectorLiveness::get_live_in_vars_at(
+    const cfg::Block* block) const {
+  return m_live_in.at(block->id());
+}
+
+BitVectorLiveness::RegisterSet BitVectorLiveness::get_live_out_vars_at(
+    const cfg::Block* block) const {
+  RegisterSet live_out(m_registers.size());
+  for (const cfg::Edge* edge : block->succs()) {
+    live_out |= m_live_in.at(edge->target()->id());
+  }
+  return live_out;
+}
+
+void BitVectorLiveness::analyze_instruction(const IRInstruction* insn,
+                                            RegisterSet* current_state) const {
+  if (insn->has_dest()) {
+    current_state->reset(m_bits.at(insn->dest()));
+  }
+  for (size_t i = 0; i < insn->srcs_size(); ++i) {
+    current_state->set(m_bits.at(insn->src(i)));
+  }
+}
+
+LivenessDomain BitVectorLiveness::to_domain(const RegisterSet& set) const {
+  LivenessDomain domain;
+  for_each(set, [&](reg_t reg) { domain.add(reg); });
+  return domain;
+}
+
+} // namespace regalloc
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <boost/dynamic_bitset.hpp>
+#include <vector>
+
+#include "ControlFlow.h"
+#include "Liveness.h"
+
+namespace regalloc {
+
+/*
+ * A liveness analysis that represents sets of live registers as dense bit
+ * vectors instead of Patricia trees. It computes the same fixpoint as
+ * LivenessFixpointIterator, but the transfer function of a block and the join
+ * over its successors are word-wide unions and differences, which the
+ * compiler vectorizes. This pays off on methods with thousands of registers,
+ * where the tree operations dominate the cost of register allocation.
+ *
+ * Bits are not indexed by register number: registers are laid out so that
+ * for_each() visits the registers of a set in the order in which
+ * LivenessDomain::elements() would. Clients that are sensitive to that order,
+ * like the construction of the interference graph, thus produce the same
+ * results with either analysis.
+ */
+class BitVectorLiveness final {
+ public:
+  using RegisterSet = boost::dynamic_bitset<uint64_t>;
+
+  /*
+   * Whether the live sets of all blocks fit in a reasonable amount of memory
+   * when represented densely.
+   */
+  static bool is_applicable(const cfg::ControlFlowGraph& cfg,
+                            reg_t registers_size);
+
+  /*
+   * Runs the analysis. Every register of the code must be smaller than
+   * `registers_size`.
+   */
+  BitVectorLiveness(const cfg::ControlFlowGraph& cfg, reg_t registers_size);
+
+  size_t registers_size() const { return m_registers.size(); }
+
+  RegisterSet get_live_in_vars_at(const cfg::Block* block) const;
+
+  RegisterSet get_live_out_vars_at(const cfg::Block* block) const;
+
+  void analyze_instruction(const IRInstruction* insn,
+                           RegisterSet* current_state) const;
+
+  template <typename F>
+  void for_each(const RegisterSet& set, const F& f) const {
+    for (auto bit = set.find_first(); bit != RegisterSet::npos;
+         bit = set.find_next(bit)) {
+      f(m_registers[bit]);
+    }
+  }
+
+  LivenessDomain to_domain(const RegisterSet& set) const;
+
+ private:
+  // The bit that represents each register, and its inverse.
+  std::vector<size_t> m_bits;
+  std::vector<reg_t> m_registers;
+  // Indexed by block id.
+  std::vector<RegisterSet> m_live_in;
+};
+
+} // namespace regalloc
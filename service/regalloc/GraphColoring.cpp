@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <boost/pending/disjoint_sets.hpp>
+#include <memory>
 #include <boost/property_map/property_map.hpp>
 
 #include "ControlFlow.h"
@@ -309,12 +310,19 @@ std::string show(const RegisterTransform& reg_transform) {
 
 Allocator::Stats& Allocator::Stats::operator+=(const Allocator::Stats& that) {
   reiteration_count += that.reiteration_count;
+  reiterated_methods += that.reiterated_methods;
+  max_reiteration_count =
+      std::max(max_reiteration_count, that.max_reiteration_count);
   param_spill_moves += that.param_spill_moves;
   range_spill_moves += that.range_spill_moves;
   global_spill_moves += that.global_spill_moves;
   split_moves += that.split_moves;
   moves_coalesced += that.moves_coalesced;
   params_spill_early += that.params_spill_early;
+  linear_scan_methods += that.linear_scan_methods;
+  linear_scan_moves += that.linear_scan_moves;
+  linear_scan_code_units += that.linear_scan_code_units;
+  graph_coloring_code_units += that.graph_coloring_code_units;
   return *this;
 }
 
@@ -1018,6 +1026,7 @@ void Allocator::allocate(IRCode* code, bool is_static) {
     dedicate_this_register(code, is_static);
   }
   bool first{true};
+  size_t reiterations{0};
   while (true) {
     SplitCosts split_costs;
     SpillPlan spill_plan;
@@ -1026,12 +1035,24 @@ void Allocator::allocate(IRCode* code, bool is_static) {
 
     auto& cfg = code->cfg();
     cfg.calculate_exit_block();
-    LivenessFixpointIterator fixpoint_iter(cfg);
-    fixpoint_iter.run(LivenessDomain());
+    // Live range splitting is the only other client of liveness. With bit
+    // vectors, we only run LivenessFixpointIterator if we end up splitting.
+    std::unique_ptr<LivenessFixpointIterator> fixpoint_iter;
+    bool use_bit_vector_liveness =
+        m_config.use_bit_vector_liveness &&
+        BitVectorLiveness::is_applicable(cfg, code->get_registers_size());
 
     TRACE(REG, 5, "Allocating:\n%s", ::SHOW(code->cfg()));
-    auto ig =
-        interference::build_graph(fixpoint_iter, code, initial_regs, range_set);
+    interference::Graph ig;
+    if (use_bit_vector_liveness) {
+      BitVectorLiveness liveness(cfg, code->get_registers_size());
+      ig = interference::build_graph(liveness, code, initial_regs, range_set);
+    } else {
+      fixpoint_iter = std::make_unique<LivenessFixpointIterator>(cfg);
+      fixpoint_iter->run(LivenessDomain());
+      ig = interference::build_graph(
+          *fixpoint_iter, code, initial_regs, range_set);
+    }
 
     // Make the `this` symreg conflict with every other one so that it never
     // gets overwritten in the method. See check_no_overwrite_this in
@@ -1049,7 +1070,9 @@ void Allocator::allocate(IRCode* code, bool is_static) {
       first = false;
       // After coalesce the live_out and live_in of blocks may change, so run
       // LivenessFixpointIterator again.
-      fixpoint_iter.run(LivenessDomain());
+      if (fixpoint_iter) {
+        fixpoint_iter->run(LivenessDomain());
+      }
       TRACE(REG, 5, "Post-coalesce:\n%s", ::SHOW(code->cfg()));
     } else {
       // TODO we should coalesce here too, but we'll need to avoid removing
@@ -1058,6 +1081,7 @@ void Allocator::allocate(IRCode* code, bool is_static) {
       // If we've hit this many iterations, it's very likely that we've hit
       // some bug that's causing us to loop infinitely.
       always_assert(m_stats.reiteration_count++ < 200);
+      ++reiterations;
     }
     TRACE(REG, 7, "IG:\n%s", SHOW(ig));
 
@@ -1083,7 +1107,11 @@ void Allocator::allocate(IRCode* code, bool is_static) {
     if (!spill_plan.empty()) {
       TRACE(REG, 5, "Spill plan:\n%s", SHOW(spill_plan));
       if (m_config.use_splitting) {
-        calc_split_costs(fixpoint_iter, code, &split_costs);
+        if (!fixpoint_iter) {
+          fixpoint_iter = std::make_unique<LivenessFixpointIterator>(cfg);
+          fixpoint_iter->run(LivenessDomain());
+        }
+        calc_split_costs(*fixpoint_iter, code, &split_costs);
         find_split(ig, split_costs, &reg_transform, &spill_plan, &split_plan);
       }
       split_params(ig, spill_plan.param_spills, code);
@@ -1092,7 +1120,7 @@ void Allocator::allocate(IRCode* code, bool is_static) {
       if (!split_plan.split_around.empty()) {
         TRACE(REG, 5, "Split plan:\n%s", SHOW(split_plan));
         m_stats.split_moves +=
-            split(fixpoint_iter, split_plan, split_costs, ig, code);
+            split(*fixpoint_iter, split_plan, split_costs, ig, code);
       }
 
       // Since we have inserted instructions, we need to rebuild the CFG to
@@ -1105,6 +1133,11 @@ void Allocator::allocate(IRCode* code, bool is_static) {
     }
   }
 
+  if (reiterations > 0) {
+    ++m_stats.reiterated_methods;
+    m_stats.max_reiteration_count =
+        std::max(m_stats.max_reiteration_count, reiterations);
+  }
   TRACE(REG, 3, "Reiteration count: %lu", m_stats.reiteration_count);
   TRACE(REG, 3, "Spill count: %lu", m_stats.moves_inserted());
   TRACE(REG, 3, "  Param spills: %lu", m_stats.param_spill_moves);
@@ -83,16 +83,35 @@ class Allocator {
   struct Config {
     bool no_overwrite_this{false};
     bool use_splitting{false};
+    // Compute liveness with BitVectorLiveness rather than with
+    // LivenessFixpointIterator. The allocation is the same either way.
+    bool use_bit_vector_liveness{false};
+    // Methods with more instructions than this are allocated by linear scan,
+    // which takes linear time but needs more moves. Zero disables it.
+    size_t linear_scan_threshold{0};
+    // Also allocate a copy of each method that is allocated by linear scan
+    // by graph coloring, to measure the difference in code size.
+    bool measure_linear_scan{false};
   };
 
   struct Stats {
     size_t reiteration_count{0};
+    // Methods that needed more than one round of allocation, and the most
+    // rounds beyond the first that any method needed.
+    size_t reiterated_methods{0};
+    size_t max_reiteration_count{0};
     size_t param_spill_moves{0};
     size_t range_spill_moves{0};
     size_t global_spill_moves{0};
     size_t split_moves{0};
     size_t moves_coalesced{0};
     size_t params_spill_early{0};
+    size_t linear_scan_methods{0};
+    size_t linear_scan_moves{0};
+    // The code units of the methods allocated by linear scan, and of the
+    // same methods allocated by graph coloring, if measured.
+    size_t linear_scan_code_units{0};
+    size_t graph_coloring_code_units{0};
     size_t moves_inserted() const {
       return param_spill_moves + range_spill_moves + global_spill_moves +
              split_moves;
@@ -50,6 +50,43 @@ uint32_t edge_weight_helper(uint8_t u_width, uint8_t v_width) {
   return ((v_width - 1) >> (u_width - 1)) + 1;
 }
 
+namespace {
+
+// The bit matrices of a graph over this many registers take 256 KiB.
+constexpr reg_t MAX_DENSE_ADJACENCY_REGISTERS = 1024;
+
+// Gives LivenessFixpointIterator the interface of BitVectorLiveness.
+class PatriciaTreeLiveness {
+ public:
+  explicit PatriciaTreeLiveness(const LivenessFixpointIterator& fixpoint_iter)
+      : m_fixpoint_iter(fixpoint_iter) {}
+
+  LivenessDomain get_live_out_vars_at(cfg::Block* block) const {
+    return m_fixpoint_iter.get_live_out_vars_at(block);
+  }
+
+  void analyze_instruction(IRInstruction* insn,
+                           LivenessDomain* current_state) const {
+    m_fixpoint_iter.analyze_instruction(insn, current_state);
+  }
+
+  template <typename F>
+  void for_each(const LivenessDomain& set, const F& f) const {
+    for (auto reg : set.elements()) {
+      f(reg);
+    }
+  }
+
+  const LivenessDomain& to_domain(const LivenessDomain& set) const {
+    return set;
+  }
+
+ private:
+  const LivenessFixpointIterator& m_fixpoint_iter;
+};
+
+} // namespace
+
 } // namespace impl
 
 using namespace impl;
@@ -89,6 +126,14 @@ void Graph::add_edge(reg_t u, reg_t v, bool can_coalesce) {
   //
   // then the final state of the edge between s0 and s1 must be
   // non-coalesceable.
+  if (is_dense(u, v)) {
+    auto index = dense_index(u, v);
+    m_dense_edges.set(index);
+    if (!can_coalesce) {
+      m_dense_non_coalesceable_edges.set(index);
+    }
+    return;
+  }
   m_adj_matrix[build_edge(u, v)] =
       m_adj_matrix[build_edge(u, v)] || !can_coalesce;
 }
@@ -267,19 +312,13 @@ void GraphBuilder::update_node_constraints(const IRList::iterator& it,
  * register interfere with the live registers in both B0 and B1, so that when
  * the move gets inserted, it does not clobber any live registers.
  */
-Graph GraphBuilder::build(const LivenessFixpointIterator& fixpoint_iter,
-                          IRCode* code,
-                          reg_t initial_regs,
-                          const RangeSet& range_set) {
-  Graph graph;
-  auto ii = InstructionIterable(code);
-  for (auto it = ii.begin(); it != ii.end(); ++it) {
-    GraphBuilder::update_node_constraints(it.unwrap(), range_set, &graph);
-  }
-
+template <typename Liveness>
+void GraphBuilder::add_edges(const Liveness& liveness,
+                             IRCode* code,
+                             Graph* graph) {
   auto& cfg = code->cfg();
   for (cfg::Block* block : cfg.blocks()) {
-    LivenessDomain live_out = fixpoint_iter.get_live_out_vars_at(block);
+    auto live_out = liveness.get_live_out_vars_at(block);
     for (auto it = block->rbegin(); it != block->rend(); ++it) {
       if (it->type != MFLOW_OPCODE) {
         continue;
@@ -287,15 +326,15 @@ Graph GraphBuilder::build(const LivenessFixpointIterator& fixpoint_iter,
       auto insn = it->insn;
       auto op = insn->opcode();
       if (opcode::has_range_form(op)) {
-        graph.m_range_liveness.emplace(insn, live_out);
+        graph->m_range_liveness.emplace(insn, liveness.to_domain(live_out));
       }
       if (insn->has_dest()) {
-        for (auto reg : live_out.elements()) {
+        liveness.for_each(live_out, [&](reg_t reg) {
           if (opcode::is_a_move(op) && reg == insn->src(0)) {
-            continue;
+            return;
           }
-          graph.add_edge(insn->dest(), reg);
-        }
+          graph->add_edge(insn->dest(), reg);
+        });
         // We add interference edges between the dest and wide src operands of
         // an instruction even if the srcs are not live-out. This avoids
         // allocations like `xor-long v1, v0, v9`, where v1 and v0 overlap --
@@ -308,34 +347,37 @@ Graph GraphBuilder::build(const LivenessFixpointIterator& fixpoint_iter,
         // coloring respects.
         for (size_t i = 0; i < insn->srcs_size(); ++i) {
           if (insn->src_is_wide(i)) {
-            graph.add_coalesceable_edge(insn->dest(), insn->src(i));
+            graph->add_coalesceable_edge(insn->dest(), insn->src(i));
           }
         }
       }
       if (op == OPCODE_CHECK_CAST) {
         auto move_result_pseudo = std::prev(it)->insn;
-        for (auto reg : live_out.elements()) {
-          graph.add_edge(move_result_pseudo->dest(), reg);
-        }
+        liveness.for_each(live_out, [&](reg_t reg) {
+          graph->add_edge(move_result_pseudo->dest(), reg);
+        });
       }
       // adding containment edge between liverange defined in insn and elements
       // in live-out set of insn
       if (insn->has_dest()) {
-        for (auto reg : live_out.elements()) {
-          graph.add_containment_edge(insn->dest(), reg);
-        }
+        liveness.for_each(live_out, [&](reg_t reg) {
+          graph->add_containment_edge(insn->dest(), reg);
+        });
       }
-      fixpoint_iter.analyze_instruction(it->insn, &live_out);
+      liveness.analyze_instruction(it->insn, &live_out);
       // adding containment edge between liverange used in insn and elements
       // in live-in set of insn
       for (size_t i = 0; i < insn->srcs_size(); ++i) {
-        for (auto reg : live_out.elements()) {
-          graph.add_containment_edge(insn->src(i), reg);
-        }
+        liveness.for_each(live_out, [&](reg_t reg) {
+          graph->add_containment_edge(insn->src(i), reg);
+        });
       }
     }
   }
-  for (auto& pair : graph.nodes()) {
+}
+
+void GraphBuilder::finalize(IRCode* code, reg_t initial_regs, Graph* graph) {
+  for (auto& pair : graph->nodes()) {
     auto reg = pair.first;
     auto& node = pair.second;
     if (reg >= initial_regs) {
@@ -346,6 +388,36 @@ Graph GraphBuilder::build(const LivenessFixpointIterator& fixpoint_iter,
                reg,
                SHOW(code));
   }
+}
+
+Graph GraphBuilder::build(const LivenessFixpointIterator& fixpoint_iter,
+                          IRCode* code,
+                          reg_t initial_regs,
+                          const RangeSet& range_set) {
+  Graph graph;
+  auto ii = InstructionIterable(code);
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    GraphBuilder::update_node_constraints(it.unwrap(), range_set, &graph);
+  }
+  add_edges(PatriciaTreeLiveness(fixpoint_iter), code, &graph);
+  finalize(code, initial_regs, &graph);
+  return graph;
+}
+
+Graph GraphBuilder::build(const BitVectorLiveness& liveness,
+                          IRCode* code,
+                          reg_t initial_regs,
+                          const RangeSet& range_set) {
+  Graph graph;
+  auto ii = InstructionIterable(code);
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    GraphBuilder::update_node_constraints(it.unwrap(), range_set, &graph);
+  }
+  if (liveness.registers_size() <= MAX_DENSE_ADJACENCY_REGISTERS) {
+    graph.use_dense_adjacency(liveness.registers_size());
+  }
+  add_edges(liveness, code, &graph);
+  finalize(code, initial_regs, &graph);
   return graph;
 }
 
@@ -7,12 +7,14 @@
 
 #pragma once
 
+#include <boost/dynamic_bitset.hpp>
 #include <boost/functional/hash.hpp>
 #include <boost/range/adaptor/filtered.hpp>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "BitVectorLiveness.h"
 #include "IRCode.h"
 #include "Liveness.h"
 #include "RegisterType.h"
@@ -191,10 +193,16 @@ class Graph {
   }
 
   bool is_adjacent(reg_t u, reg_t v) const {
+    if (is_dense(u, v)) {
+      return m_dense_edges.test(dense_index(u, v));
+    }
     return m_adj_matrix.find(impl::build_edge(u, v)) != m_adj_matrix.end();
   }
 
   bool is_coalesceable(reg_t u, reg_t v) const {
+    if (is_dense(u, v)) {
+      return !m_dense_non_coalesceable_edges.test(dense_index(u, v));
+    }
     return !is_adjacent(u, v) || !m_adj_matrix.at(impl::build_edge(u, v));
   }
 
@@ -237,8 +245,32 @@ class Graph {
   }
 
  private:
+  /*
+   * Represents the edges between registers smaller than `size` as bit
+   * matrices instead of in m_adj_matrix.
+   */
+  void use_dense_adjacency(reg_t size) {
+    m_dense_size = size;
+    m_dense_edges.resize(static_cast<size_t>(size) * size);
+    m_dense_non_coalesceable_edges.resize(static_cast<size_t>(size) * size);
+  }
+
+  bool is_dense(reg_t u, reg_t v) const {
+    return u < m_dense_size && v < m_dense_size;
+  }
+
+  size_t dense_index(reg_t u, reg_t v) const {
+    if (u > v) {
+      std::swap(u, v);
+    }
+    return static_cast<size_t>(u) * m_dense_size + v;
+  }
+
   std::unordered_map<reg_t, Node> m_nodes;
   std::unordered_map<reg_pair_t, bool> m_adj_matrix;
+  reg_t m_dense_size{0};
+  boost::dynamic_bitset<uint64_t> m_dense_edges;
+  boost::dynamic_bitset<uint64_t> m_dense_non_coalesceable_edges;
   std::unordered_set<reg_pair_t> m_containment_graph;
   // This map contains the LivenessDomains for all instructions which could
   // potentialy take on the /range format.
@@ -276,12 +308,26 @@ class GraphBuilder {
                                       const RangeSet&,
                                       Graph*);
 
+  template <typename Liveness>
+  static void add_edges(const Liveness&, IRCode*, Graph*);
+
+  static void finalize(IRCode*, reg_t initial_regs, Graph*);
+
  public:
   static Graph build(const LivenessFixpointIterator&,
                      IRCode*,
                      reg_t initial_regs,
                      const RangeSet&);
 
+  /*
+   * Builds the same graph as above. Graphs over few registers keep their
+   * edges in bit matrices.
+   */
+  static Graph build(const BitVectorLiveness&,
+                     IRCode*,
+                     reg_t initial_regs,
+                     const RangeSet&);
+
   // For unit tests
   static Graph create_empty() { return Graph(); }
   static void make_node(Graph*, reg_t, RegisterType, vreg_t max_vreg);
@@ -300,6 +346,13 @@ inline Graph build_graph(const LivenessFixpointIterator& fixpoint_iter,
       fixpoint_iter, code, initial_regs, range_set);
 }
 
+inline Graph build_graph(const BitVectorLiveness& liveness,
+                         IRCode* code,
+                         reg_t initial_regs,
+                         const RangeSet& range_set) {
+  return impl::GraphBuilder::build(liveness, code, initial_regs, range_set);
+}
+
 } // namespace interference
 
 } // namespace regalloc
@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "LinearScanAllocation.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "DexOpcode.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "Interference.h"
+#include "LinearScan.h"
+#include "RegisterType.h"
+#include "Show.h"
+#include "Trace.h"
+
+namespace regalloc {
+namespace linear_scan {
+
+namespace {
+
+using interference::dest_bit_width;
+using interference::max_value_for_src;
+
+// The types of the operands that may have to be moved, with the srcs first
+// and then the dest.
+using OperandTypes =
+    std::unordered_map<const IRInstruction*, std::vector<RegisterType>>;
+
+bool is_movable(RegisterType type) {
+  switch (type) {
+  case RegisterType::ZERO:
+  case RegisterType::NORMAL:
+  case RegisterType::OBJECT:
+  case RegisterType::WIDE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+uint32_t src_width(const IRInstruction* insn, size_t i) {
+  return insn->src_is_wide(i) ? 2 : 1;
+}
+
+bool src_fits(const IRInstruction* insn, size_t i, uint32_t offset) {
+  return insn->src(i) + offset <=
+         max_value_for_src(insn, i, insn->src_is_wide(i));
+}
+
+bool dest_fits(const IRList::iterator& it, uint32_t offset) {
+  return it->insn->dest() + offset <= max_unsigned_value(dest_bit_width(it));
+}
+
+// Instructions whose srcs must be contiguous when they take the /range form.
+// An instruction with a single src can always take it.
+bool is_range_form(const IRInstruction* insn) {
+  return opcode::has_range_form(insn->opcode()) && insn->srcs_size() > 1;
+}
+
+// The number of registers that the srcs take once denormalized.
+uint32_t srcs_width(const IRInstruction* insn) {
+  uint32_t width = 0;
+  for (size_t i = 0; i < insn->srcs_size(); ++i) {
+    width += src_width(insn, i);
+  }
+  return width;
+}
+
+bool has_contiguous_srcs(const IRInstruction* insn) {
+  uint32_t next = insn->src(0);
+  for (size_t i = 0; i < insn->srcs_size(); ++i) {
+    if (insn->src(i) != next) {
+      return false;
+    }
+    next += src_width(insn, i);
+  }
+  return true;
+}
+
+// Whether a range-form instruction can be encoded without moves, either in
+// its regular form or in its /range form.
+bool range_form_fits(const IRInstruction* insn, uint32_t offset) {
+  if (srcs_width(insn) <= dex_opcode::NON_RANGE_MAX) {
+    bool fits = true;
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      fits = fits && src_fits(insn, i, offset);
+    }
+    if (fits) {
+      return true;
+    }
+  }
+  return has_contiguous_srcs(insn);
+}
+
+struct Needs {
+  // The scratch registers at the start of the frame.
+  uint32_t scratch{0};
+  // The contiguous registers for the srcs of long /range instructions.
+  uint32_t block{0};
+};
+
+// The registers that the moves for one instruction need, if all registers are
+// shifted up by the `offset` scratch registers.
+Needs get_needs(const IRList::iterator& it, uint32_t offset) {
+  auto* insn = it->insn;
+  Needs needs;
+  if (is_range_form(insn)) {
+    if (!range_form_fits(insn, offset)) {
+      auto width = srcs_width(insn);
+      (width <= dex_opcode::NON_RANGE_MAX ? needs.scratch : needs.block) =
+          width;
+    }
+    return needs;
+  }
+  for (size_t i = 0; i < insn->srcs_size(); ++i) {
+    if (!src_fits(insn, i, offset)) {
+      needs.scratch += src_width(insn, i);
+    }
+  }
+  if (insn->has_dest() && !dest_fits(it, offset)) {
+    needs.scratch =
+        std::max(needs.scratch, insn->dest_is_wide() ? 2u : 1u);
+  }
+  return needs;
+}
+
+// Renumbers the registers, so that each holds a single value, and records the
+// type of every operand that is constrained to fewer than 16 bits. Returns
+// false if one of them is not known.
+bool collect_operand_types(IRCode* code, OperandTypes* operand_types) {
+  live_range::renumber_registers(code, /* width_aware */ true);
+  std::vector<RegisterTypeDomain> reg_types(code->get_registers_size(),
+                                            RegisterTypeDomain::top());
+  for (auto& mie : InstructionIterable(code)) {
+    auto* insn = mie.insn;
+    if (insn->has_dest()) {
+      reg_types.at(insn->dest())
+          .meet_with(RegisterTypeDomain(dest_reg_type(insn)));
+    }
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      reg_types.at(insn->src(i))
+          .meet_with(RegisterTypeDomain(src_reg_type(insn, i)));
+    }
+  }
+
+  auto ii = InstructionIterable(code);
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    auto* insn = it->insn;
+    if (opcode::is_a_load_param(insn->opcode())) {
+      continue;
+    }
+    bool constrained = false;
+    std::vector<RegisterType> types;
+    types.reserve(insn->srcs_size() + 1);
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      auto type = reg_types.at(insn->src(i)).element();
+      if (max_value_for_src(insn, i, insn->src_is_wide(i)) <
+          max_unsigned_value(16)) {
+        if (!is_movable(type)) {
+          return false;
+        }
+        constrained = true;
+      }
+      types.push_back(type);
+    }
+    if (insn->has_dest()) {
+      auto type = reg_types.at(insn->dest()).element();
+      if (dest_bit_width(it.unwrap()) < 16) {
+        if (!is_movable(type)) {
+          return false;
+        }
+        constrained = true;
+      }
+      types.push_back(type);
+    }
+    if (constrained) {
+      operand_types->emplace(insn, std::move(types));
+    }
+  }
+  return true;
+}
+
+RegisterType get_type(const OperandTypes& operand_types,
+                      const IRInstruction* insn,
+                      size_t index) {
+  auto it = operand_types.find(insn);
+  always_assert_log(it != operand_types.end(), "No operand types for %s",
+                    SHOW(insn));
+  return it->second.at(index);
+}
+
+// Moves the operands that the registers of the linear scan cannot encode,
+// and the params to the end of the frame.
+size_t legalize(IRCode* code, const OperandTypes& operand_types) {
+  // Find how many scratch registers we need. More scratch registers shift the
+  // other registers up, which can only make more operands need them.
+  uint32_t scratch_size = 0;
+  uint32_t block_size = 0;
+  while (true) {
+    Needs needs;
+    auto ii = InstructionIterable(code);
+    for (auto it = ii.begin(); it != ii.end(); ++it) {
+      if (opcode::is_a_load_param(it->insn->opcode())) {
+        continue;
+      }
+      auto insn_needs = get_needs(it.unwrap(), scratch_size);
+      needs.scratch = std::max(needs.scratch, insn_needs.scratch);
+      needs.block = std::max(needs.block, insn_needs.block);
+    }
+    if (needs.scratch <= scratch_size) {
+      block_size = needs.block;
+      break;
+    }
+    scratch_size = needs.scratch;
+  }
+  uint32_t block_base = scratch_size + code->get_registers_size();
+  uint32_t params_base = block_base + block_size;
+
+  size_t moves_inserted = 0;
+  auto ii = InstructionIterable(code);
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    auto* insn = it->insn;
+    if (opcode::is_a_load_param(insn->opcode())) {
+      continue;
+    }
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      insn->set_src(i, insn->src(i) + scratch_size);
+    }
+    if (insn->has_dest()) {
+      insn->set_dest(insn->dest() + scratch_size);
+    }
+
+    if (is_range_form(insn)) {
+      if (range_form_fits(insn, 0)) {
+        continue;
+      }
+      uint32_t next = srcs_width(insn) <= dex_opcode::NON_RANGE_MAX
+                          ? 0
+                          : block_base;
+      for (size_t i = 0; i < insn->srcs_size(); ++i) {
+        code->insert_before(it.unwrap(),
+                            gen_move(get_type(operand_types, insn, i), next,
+                                     insn->src(i)));
+        insn->set_src(i, next);
+        next += src_width(insn, i);
+        ++moves_inserted;
+      }
+      continue;
+    }
+
+    uint32_t next = 0;
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      if (src_fits(insn, i, 0)) {
+        continue;
+      }
+      code->insert_before(it.unwrap(),
+                          gen_move(get_type(operand_types, insn, i), next,
+                                   insn->src(i)));
+      insn->set_src(i, next);
+      next += src_width(insn, i);
+      ++moves_inserted;
+    }
+    if (insn->has_dest() && !dest_fits(it.unwrap(), 0)) {
+      auto dest = insn->dest();
+      insn->set_dest(0);
+      it.reset(code->insert_after(
+          it.unwrap(),
+          gen_move(get_type(operand_types, insn, insn->srcs_size()), dest,
+                   0)));
+      ++moves_inserted;
+    }
+  }
+
+  // The params go at the end of the frame.
+  uint32_t next_param = params_base;
+  auto params = code->get_param_instructions();
+  std::vector<IRInstruction*> param_moves;
+  for (auto& mie : InstructionIterable(params)) {
+    auto* insn = mie.insn;
+    param_moves.push_back(gen_move(dest_reg_type(insn),
+                                   insn->dest() + scratch_size, next_param));
+    insn->set_dest(next_param);
+    next_param += insn->dest_is_wide() ? 2 : 1;
+  }
+  auto insert_it = params.end();
+  for (auto* move : param_moves) {
+    code->insert_before(insert_it, move);
+  }
+  moves_inserted += param_moves.size();
+  always_assert(next_param <= max_unsigned_value(16) + 1);
+  code->set_registers_size(next_param);
+  return moves_inserted;
+}
+
+} // namespace
+
+bool allocate(IRCode* code,
+              bool is_static,
+              const std::function<std::string()>& method_describer,
+              size_t* moves_inserted) {
+  OperandTypes operand_types;
+  if (!collect_operand_types(code, &operand_types)) {
+    TRACE(REG, 2, "Cannot allocate %s by linear scan: unknown register type",
+          method_describer().c_str());
+    return false;
+  }
+  {
+    fastregalloc::LinearScanAllocator allocator(code, is_static,
+                                                method_describer);
+    allocator.allocate();
+  }
+  *moves_inserted = legalize(code, operand_types);
+  TRACE(REG, 3, "Allocated %s by linear scan: %u registers, %zu moves",
+        method_describer().c_str(), code->get_registers_size(),
+        *moves_inserted);
+  return true;
+}
+
+} // namespace linear_scan
+} // namespace regalloc
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+
+class IRCode;
+
+namespace regalloc {
+namespace linear_scan {
+
+/*
+ * Allocates registers with fastregalloc's LinearScanAllocator, which takes
+ * time linear in the size of the method, and then inserts the moves that
+ * make the allocation encodable:
+ *
+ * - The frame starts with a few scratch registers. An operand whose register
+ *   is too large for its instruction is moved through them, as are the srcs
+ *   of an invoke that has to take the /range form but whose srcs are not
+ *   contiguous.
+ * - Longer invokes are moved to a contiguous block of registers after the
+ *   ones that the linear scan allocated.
+ * - The params are loaded into the registers at the end of the frame, and
+ *   moved to the ones that the linear scan allocated.
+ *
+ * This needs more moves and registers than graph coloring does, so it is
+ * meant for the few huge methods where the graph coloring is too slow.
+ *
+ * Returns false, without allocating, if one of the operands that may need a
+ * move has no known register type. The caller must then allocate the
+ * registers of the method in some other way.
+ */
+bool allocate(IRCode* code,
+              bool is_static,
+              const std::function<std::string()>& method_describer,
+              size_t* moves_inserted);
+
+} // namespace linear_scan
+} // namespace regalloc
@@ -7,7 +7,9 @@
 
 #include "RegisterAllocation.h"
 
+#include <boost/optional.hpp>
 #include <iostream>
+#include <memory>
 
 #include "CppUtil.h"
 #include "Debug.h"
@@ -16,6 +18,7 @@
 #include "GraphColoring.h"
 #include "IRAssembler.h"
 #include "IRCode.h"
+#include "LinearScanAllocation.h"
 #include "LiveRange.h"
 #include "PassManager.h"
 #include "Show.h"
@@ -28,6 +31,37 @@ namespace graph_coloring {
 using Config = Allocator::Config;
 using Stats = Allocator::Stats;
 
+namespace {
+
+// Returns none, after renumbering the registers, if the method cannot be
+// allocated by linear scan.
+boost::optional<Stats> allocate_by_linear_scan(
+    const Config& allocator_config,
+    IRCode* code,
+    bool is_static,
+    const std::function<std::string()>& method_describer) {
+  std::unique_ptr<IRCode> reference;
+  if (allocator_config.measure_linear_scan) {
+    reference = std::make_unique<IRCode>(*code);
+  }
+  Stats stats;
+  if (!linear_scan::allocate(code, is_static, method_describer,
+                             &stats.linear_scan_moves)) {
+    return boost::none;
+  }
+  stats.linear_scan_methods = 1;
+  stats.linear_scan_code_units = code->sum_opcode_sizes();
+  if (reference) {
+    auto reference_config = allocator_config;
+    reference_config.linear_scan_threshold = 0;
+    allocate(reference_config, reference.get(), is_static, method_describer);
+    stats.graph_coloring_code_units = reference->sum_opcode_sizes();
+  }
+  return stats;
+}
+
+} // namespace
+
 Stats allocate(const Config& allocator_config, DexMethod* method) {
   return allocate(allocator_config,
                   method->get_code(),
@@ -47,6 +81,14 @@ Allocator::Stats allocate(
   auto scoped = at_scope_exit([code]() { code->clear_cfg(); });
   TRACE(REG, 5, "regs:%d code:\n%s", code->get_registers_size(), SHOW(code));
   try {
+    if (allocator_config.linear_scan_threshold != 0 &&
+        code->count_opcodes() > allocator_config.linear_scan_threshold) {
+      auto stats = allocate_by_linear_scan(allocator_config, code, is_static,
+                                           method_describer);
+      if (stats) {
+        return *stats;
+      }
+    }
     live_range::renumber_registers(code, /* width_aware */ true);
     // The transformations below all require a CFG. Build it once
     // here instead of requiring each transform to build it.
@@ -194,13 +194,15 @@ copy_propagation_impl::Stats Shrinker::copy_propagation(
   return copy_propagation.run(code, is_static, declaring_type, rtype, args,
                               std::move(method_describer));
 }
-void Shrinker::shrink_method(DexMethod* method) {
-  shrink_code(method->get_code(),
-              is_static(method),
-              method::is_init(method) || method::is_clinit(method),
-              method->get_class(),
-              method->get_proto(),
-              [method]() { return show(method); });
+void Shrinker::shrink_method(DexMethod* method, bool fast) {
+  shrink_code(
+      method->get_code(),
+      is_static(method),
+      method::is_init(method) || method::is_clinit(method),
+      method->get_class(),
+      method->get_proto(),
+      [method]() { return show(method); },
+      fast);
 }
 
 void Shrinker::shrink_code(
@@ -209,11 +211,14 @@ void Shrinker::shrink_code(
     bool is_init_or_clinit,
     DexType* declaring_type,
     DexProto* proto,
-    const std::function<std::string()>& method_describer) {
+    const std::function<std::string()>& method_describer,
+    bool fast) {
   bool editable_cfg_built = code->editable_cfg_built();
-  // force simplification/linearization of any existing editable cfg once, and
-  // forget existing cfg for a clean start
-  code->clear_cfg();
+  if (!fast) {
+    // force simplification/linearization of any existing editable cfg once,
+    // and forget existing cfg for a clean start
+    code->clear_cfg();
+  }
 
   constant_propagation::Transform::Stats const_prop_stats;
   cse_impl::Stats cse_stats;
@@ -227,7 +232,7 @@ void Shrinker::shrink_code(
         constant_propagation(is_static, declaring_type, proto, code, {}, {});
   }
 
-  if (m_config.run_cse) {
+  if (m_config.run_cse && !fast) {
     auto timer = m_cse_timer.scope();
     if (!code->editable_cfg_built()) {
       code->build_cfg(/* editable */ true);
@@ -240,7 +245,7 @@ void Shrinker::shrink_code(
     cse_stats = cse.get_stats();
   }
 
-  if (m_config.run_copy_prop) {
+  if (m_config.run_copy_prop && !fast) {
     auto timer = m_copy_prop_timer.scope();
     copy_prop_stats =
         copy_propagation(code, is_static, declaring_type, proto->get_rtype(),
@@ -274,7 +279,7 @@ void Shrinker::shrink_code(
   auto data_before_reg_alloc = get_features(kMMINLDataCollectionLevel);
 
   size_t reg_alloc_inc{0};
-  if (m_config.run_reg_alloc) {
+  if (m_config.run_reg_alloc && !fast) {
     if (should_shrink(code, m_forest) ||
         traceEnabled(MMINL, kMMINLDataCollectionLevel)) {
       auto timer = m_reg_alloc_timer.scope();
@@ -302,14 +307,14 @@ void Shrinker::shrink_code(
     }
   }
 
-  if (m_config.run_fast_reg_alloc) {
+  if (m_config.run_fast_reg_alloc && !fast) {
     auto timer = m_reg_alloc_timer.scope();
     auto allocator =
         fastregalloc::LinearScanAllocator(code, is_static, method_describer);
     allocator.allocate();
   }
 
-  if (m_config.run_dedup_blocks) {
+  if (m_config.run_dedup_blocks && !fast) {
     auto timer = m_dedup_blocks_timer.scope();
     if (!code->editable_cfg_built()) {
       code->build_cfg(/* editable */ true);
@@ -346,6 +351,7 @@ void Shrinker::shrink_code(
   m_local_dce_stats += local_dce_stats;
   m_dedup_blocks_stats += dedup_blocks_stats;
   m_methods_shrunk++;
+  m_methods_fast_shrunk += fast;
   m_methods_reg_alloced += reg_alloc_inc;
 }
 
@@ -59,13 +59,20 @@ class Shrinker {
       DexTypeList* args,
       std::function<std::string()> method_describer);
 
-  void shrink_method(DexMethod* method);
+  /*
+   * A fast shrink only runs the enabled ones of constant-propagation and
+   * local-dce, on the CFG as it is, without linearizing and rebuilding it
+   * first. This is meant for intermediate shrinking, when another full shrink
+   * follows; it trades some code size for time.
+   */
+  void shrink_method(DexMethod* method, bool fast = false);
   void shrink_code(IRCode* code,
                    bool is_static,
                    bool is_init_or_clinit,
                    DexType* declaring_type,
                    DexProto* proto,
-                   const std::function<std::string()>& method_describer);
+                   const std::function<std::string()>& method_describer,
+                   bool fast = false);
   const constant_propagation::Transform::Stats& get_const_prop_stats() const {
     return m_const_prop_stats;
   }
@@ -80,6 +87,7 @@ class Shrinker {
     return m_dedup_blocks_stats;
   }
   size_t get_methods_shrunk() const { return m_methods_shrunk; }
+  size_t get_methods_fast_shrunk() const { return m_methods_fast_shrunk; }
   size_t get_methods_reg_alloced() const { return m_methods_reg_alloced; }
 
   bool enabled() const { return m_enabled; }
@@ -162,6 +170,7 @@ class Shrinker {
   dedup_blocks_impl::Stats m_dedup_blocks_stats;
   AccumulatingTimer m_reg_alloc_timer;
   size_t m_methods_shrunk{0};
+  size_t m_methods_fast_shrunk{0};
   size_t m_methods_reg_alloced{0};
 };
 
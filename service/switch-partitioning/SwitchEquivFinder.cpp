@@ -7,6 +7,9 @@
 
 #include "SwitchEquivFinder.h"
 
+#include <algorithm>
+#include <deque>
+#include <memory>
 #include <queue>
 #include <vector>
 
@@ -144,19 +147,53 @@ std::vector<cfg::Edge*> SwitchEquivFinder::find_leaves() {
   std::vector<cfg::Edge*> leaves;
 
   // Traverse the tree in an depth first order so that the extra loads are
-  // tracked in the same order that they will be executed at runtime
+  // tracked in the same order that they will be executed at runtime. The
+  // traversal uses an explicit stack because generated code can have if-else
+  // chains that are many thousands of blocks deep.
   std::unordered_set<cfg::Block*> non_leaves;
-  std::function<bool(cfg::Block*, InstructionSet,
-                     const std::vector<SourceBlock*>&)>
-      recurse;
   std::vector<std::pair<cfg::Edge*, cfg::Block*>> edges_to_move;
   std::unordered_map<cfg::Block*, std::vector<SourceBlock*>>
       source_blocks_to_move;
-  recurse = [&](cfg::Block* b, const InstructionSet& loads,
-                const std::vector<SourceBlock*>& source_blocks_in) {
-    // `loads` represents the state of the registers after evaluating `b`.
-    for (cfg::Edge* succ : b->succs()) {
+
+  // The source blocks on the path from the root to a block, innermost first.
+  // Paths with a common prefix share it, so that going one block deeper does
+  // not copy all the source blocks above it.
+  struct SourceBlockPath {
+    const SourceBlockPath* parent;
+    SourceBlock* source_block;
+  };
+  std::deque<SourceBlockPath> source_block_paths;
+  const auto& append_path = [](const SourceBlockPath* path,
+                               std::vector<SourceBlock*>* vec) {
+    size_t begin = vec->size();
+    for (; path != nullptr; path = path->parent) {
+      vec->push_back(path->source_block);
+    }
+    std::reverse(vec->begin() + begin, vec->end());
+  };
+
+  struct Frame {
+    cfg::Block* block;
+    // The state of the registers after evaluating `block`. Blocks without
+    // constant loads share the state of their predecessor.
+    std::shared_ptr<const InstructionSet> loads;
+    const SourceBlockPath* source_blocks;
+    size_t next_succ;
+  };
+  const auto& traverse = [&]() {
+    std::vector<Frame> stack;
+    stack.push_back({m_root_branch.block(),
+                     std::make_shared<const InstructionSet>(), nullptr, 0});
+    while (!stack.empty()) {
+      auto& frame = stack.back();
+      const auto& succs = frame.block->succs();
+      if (frame.next_succ == succs.size()) {
+        stack.pop_back();
+        continue;
+      }
+      cfg::Edge* succ = succs[frame.next_succ++];
       cfg::Block* next = succ->target();
+      const InstructionSet& loads = *frame.loads;
 
       uint16_t count = ++m_visit_count[next];
       if (count > next->preds().size()) {
@@ -166,14 +203,9 @@ std::vector<cfg::Edge*> SwitchEquivFinder::find_leaves() {
         return false;
       }
 
-      auto source_blocks_out = std::ref(source_blocks_in);
-
       if (is_leaf(m_cfg, next, m_switching_reg)) {
         leaves.push_back(succ);
-        auto& source_blocks_vec = source_blocks_to_move[succ->target()];
-        source_blocks_vec.insert(source_blocks_vec.end(),
-                                 source_blocks_in.begin(),
-                                 source_blocks_in.end());
+        append_path(frame.source_blocks, &source_blocks_to_move[next]);
         const auto& pair = m_extra_loads.emplace(next, loads);
         bool already_there = !pair.second;
         if (already_there) {
@@ -197,55 +229,51 @@ std::vector<cfg::Edge*> SwitchEquivFinder::find_leaves() {
             }
           }
         }
-      } else {
-        non_leaves.insert(next);
-        boost::optional<InstructionSet> next_loads;
-        std::vector<SourceBlock*> next_source_blocks;
-        for (const auto& mie : *next) {
-          if (mie.type == MFLOW_SOURCE_BLOCK) {
-            if (&source_blocks_out.get() == &source_blocks_in) {
-              next_source_blocks = source_blocks_in;
-              source_blocks_out = next_source_blocks;
-            }
-            next_source_blocks.push_back(mie.src_block.get());
-            continue;
-          }
-
-          if (mie.type != MFLOW_OPCODE) {
-            continue;
-          }
+        continue;
+      }
 
-          // A chain of if-else blocks loads constants into register to do the
-          // comparisons, however, the leaf blocks may also use those registers,
-          // so this function finds any loads that occur in non-leaf blocks that
-          // lead to `leaf`.
-          auto insn = mie.insn;
-          auto op = insn->opcode();
-          if (opcode::is_a_literal_const(op)) {
-            if (next_loads == boost::none) {
-              // Copy loads here because we only want these loads to propagate
-              // to successors of `next`, not any other successors of `b`
-              next_loads = loads;
-            }
-            // Overwrite any previous mapping for this dest register.
-            (*next_loads)[insn->dest()] = insn;
-            if (insn->dest_is_wide()) {
-              // And don't forget to clear out the upper register of wide loads.
-              (*next_loads)[insn->dest() + 1] = nullptr;
-            }
-          }
+      non_leaves.insert(next);
+      std::shared_ptr<InstructionSet> next_loads;
+      const SourceBlockPath* next_source_blocks = frame.source_blocks;
+      for (const auto& mie : *next) {
+        if (mie.type == MFLOW_SOURCE_BLOCK) {
+          source_block_paths.push_back(
+              {next_source_blocks, mie.src_block.get()});
+          next_source_blocks = &source_block_paths.back();
+          continue;
         }
 
-        bool success = false;
-        if (next_loads != boost::none) {
-          success = recurse(next, *next_loads, source_blocks_out.get());
-        } else {
-          success = recurse(next, loads, source_blocks_out.get());
+        if (mie.type != MFLOW_OPCODE) {
+          continue;
         }
-        if (!success) {
-          return false;
+
+        // A chain of if-else blocks loads constants into register to do the
+        // comparisons, however, the leaf blocks may also use those registers,
+        // so this function finds any loads that occur in non-leaf blocks that
+        // lead to `leaf`.
+        auto insn = mie.insn;
+        auto op = insn->opcode();
+        if (opcode::is_a_literal_const(op)) {
+          if (next_loads == nullptr) {
+            // Copy loads here because we only want these loads to propagate
+            // to successors of `next`, not any other successors of
+            // `frame.block`
+            next_loads = std::make_shared<InstructionSet>(loads);
+          }
+          // Overwrite any previous mapping for this dest register.
+          (*next_loads)[insn->dest()] = insn;
+          if (insn->dest_is_wide()) {
+            // And don't forget to clear out the upper register of wide loads.
+            (*next_loads)[insn->dest() + 1] = nullptr;
+          }
         }
       }
+
+      // This invalidates `frame`.
+      stack.push_back({next,
+                       next_loads != nullptr ? std::move(next_loads)
+                                             : frame.loads,
+                       next_source_blocks, 0});
     }
     return true;
   };
@@ -265,7 +293,7 @@ std::vector<cfg::Edge*> SwitchEquivFinder::find_leaves() {
     return leaves;
   };
 
-  bool success = recurse(m_root_branch.block(), {}, {});
+  bool success = traverse();
   if (!success) {
     return bail();
   }
@@ -360,8 +388,7 @@ bool SwitchEquivFinder::move_edges(
     // NOLINTNEXTLINE(performance-unnecessary-copy-initialization)
     const auto orig_succs = orig->succs();
     for (cfg::Edge* orig_succ : orig_succs) {
-      cfg::Edge* copy_succ = new cfg::Edge(*orig_succ);
-      m_cfg->add_edge(copy_succ);
+      cfg::Edge* copy_succ = m_cfg->add_edge(*orig_succ);
       m_cfg->set_edge_source(copy_succ, copy);
     }
     m_cfg->set_edge_target(edge, copy);
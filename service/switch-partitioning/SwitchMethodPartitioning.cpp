@@ -9,6 +9,7 @@
 
 #include <boost/variant.hpp>
 #include <queue>
+#include <unordered_set>
 
 #include "ConstantPropagationAnalysis.h"
 #include "ControlFlow.h"
@@ -213,10 +214,11 @@ boost::optional<SwitchMethodPartitioning> SwitchMethodPartitioning::create(
 
   // Find all the outgoing edges from the prologue blocks
   std::vector<cfg::Edge*> cases;
+  const std::unordered_set<cfg::Block*> prologue_set(prologue_blocks.begin(),
+                                                     prologue_blocks.end());
   for (const cfg::Block* prologue : prologue_blocks) {
     for (cfg::Edge* e : prologue->succs()) {
-      if (std::find(prologue_blocks.begin(), prologue_blocks.end(),
-                    e->target()) == prologue_blocks.end()) {
+      if (!prologue_set.count(e->target())) {
         cases.push_back(e);
       }
     }
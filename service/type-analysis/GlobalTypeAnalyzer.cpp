@@ -128,6 +128,16 @@ DexTypeEnvironment env_with_params(const IRCode* code,
   return env;
 }
 
+uint64_t GlobalTypeAnalyzer::estimate_cost(
+    const call_graph::NodeId& node) const {
+  const DexMethod* method = node->method();
+  if (method == nullptr || method->get_code() == nullptr) {
+    return 1;
+  }
+  // Analyzing a method takes roughly time linear in the size of its code.
+  return 1 + method->get_code()->sum_opcode_sizes();
+}
+
 void GlobalTypeAnalyzer::analyze_node(
     const call_graph::NodeId& node,
     ArgumentTypePartition* current_partition) const {
@@ -140,6 +150,11 @@ void GlobalTypeAnalyzer::analyze_node(
   if (code == nullptr) {
     return;
   }
+  if (m_node_results.reuse(method, current_partition)) {
+    return;
+  }
+  ++m_num_analyzed_methods;
+  auto entry_state = *current_partition;
   auto& cfg = code->cfg();
   auto intra_ta = get_local_analysis(method);
   const auto outgoing_edges =
@@ -165,6 +180,42 @@ void GlobalTypeAnalyzer::analyze_node(
       intra_ta->analyze_instruction(insn, &state);
     }
   }
+  m_node_results.record(method, std::move(entry_state), *current_partition);
+}
+
+std::shared_ptr<const MethodContributions>
+GlobalTypeAnalyzer::get_contributions(const DexMethod* method) const {
+  if (!m_call_graph.has_node(method)) {
+    return nullptr;
+  }
+  return m_node_results.get_contributions(
+      method, this->get_entry_state_at(m_call_graph.node(method)));
+}
+
+void GlobalTypeAnalyzer::set_contributions(
+    const DexMethod* method,
+    std::shared_ptr<const MethodContributions> contributions) const {
+  if (!m_call_graph.has_node(method)) {
+    return;
+  }
+  m_node_results.set_contributions(
+      method, this->get_entry_state_at(m_call_graph.node(method)),
+      std::move(contributions));
+}
+
+void GlobalTypeAnalyzer::set_whole_program_state(
+    std::unique_ptr<WholeProgramState> wps) {
+  std::unordered_set<const DexField*> changed_fields;
+  std::unordered_set<const DexMethod*> changed_methods;
+  m_wps->get_changed_members(*wps, &changed_fields, &changed_methods);
+  auto analyzed = m_node_results.size();
+  auto stale =
+      m_node_results.invalidate(m_call_graph, changed_fields, changed_methods);
+  TRACE(TYPE, 2,
+        "[global] %zu fields and %zu methods changed, invalidating %zu of %zu "
+        "method results",
+        changed_fields.size(), changed_methods.size(), stale, analyzed);
+  m_wps = std::move(wps);
 }
 
 ArgumentTypePartition GlobalTypeAnalyzer::analyze_edge(
@@ -418,6 +469,8 @@ std::unique_ptr<GlobalTypeAnalyzer> GlobalTypeAnalysis::analyze(
   TRACE(TYPE, 2, "[global] Bootstrap run");
   auto gta = std::make_unique<GlobalTypeAnalyzer>(cg);
   gta->run({{CURRENT_PARTITION_LABEL, ArgumentTypeEnvironment()}});
+  TRACE(TYPE, 2, "[global] Bootstrap analyzed %zu methods",
+        gta->reset_num_analyzed_methods());
   auto non_true_virtuals =
       mog::get_non_true_virtuals(*method_override_graph, scope);
   size_t iteration_cnt = 0;
@@ -439,6 +492,8 @@ std::unique_ptr<GlobalTypeAnalyzer> GlobalTypeAnalysis::analyze(
     TRACE(TYPE, 2, "[global] Start a new global analysis run");
     gta->set_whole_program_state(std::move(wps));
     gta->run({{CURRENT_PARTITION_LABEL, ArgumentTypeEnvironment()}});
+    TRACE(TYPE, 2, "[global] Iteration %zu reanalyzed %zu methods", i + 1,
+          gta->reset_num_analyzed_methods());
     ++iteration_cnt;
   }
 
@@ -7,7 +7,10 @@
 
 #pragma once
 
+#include <atomic>
+
 #include "CallGraph.h"
+#include "CallGraphNodeResults.h"
 #include "DexTypeEnvironment.h"
 #include "HashedAbstractPartition.h"
 #include "LocalTypeAnalyzer.h"
@@ -60,6 +63,10 @@ DexTypeEnvironment env_with_params(const IRCode* code,
 /*
  * Performs interprocedural DexType analysis of stack / register values.
  * The intraprocedural propagation logic is delegated to the LocalTypeAnalyzer.
+ *
+ * The result of analyzing a method is kept across runs, and reused as long as
+ * its entry state is the same and set_whole_program_state did not change the
+ * type of any field or method its code refers to.
  */
 class GlobalTypeAnalyzer : public sparta::ParallelMonotonicFixpointIterator<
                                call_graph::GraphInterface,
@@ -80,6 +87,8 @@ class GlobalTypeAnalyzer : public sparta::ParallelMonotonicFixpointIterator<
       const std::shared_ptr<call_graph::Edge>& edge,
       const ArgumentTypePartition& exit_state_at_source) const override;
 
+  uint64_t estimate_cost(const call_graph::NodeId& node) const override;
+
   /*
    * Run local analysis for the given method and return the LocalAnalyzer with
    * the end state.
@@ -89,8 +98,21 @@ class GlobalTypeAnalyzer : public sparta::ParallelMonotonicFixpointIterator<
 
   const WholeProgramState& get_whole_program_state() const { return *m_wps; }
 
-  void set_whole_program_state(std::unique_ptr<WholeProgramState> wps) {
-    m_wps = std::move(wps);
+  void set_whole_program_state(std::unique_ptr<WholeProgramState> wps);
+
+  // The field and return types that WholeProgramState::collect can take over
+  // for :method.
+  std::shared_ptr<const MethodContributions> get_contributions(
+      const DexMethod* method) const;
+
+  void set_contributions(
+      const DexMethod* method,
+      std::shared_ptr<const MethodContributions> contributions) const;
+
+  // The number of methods that analyze_node did not reuse a result for since
+  // the last call.
+  size_t reset_num_analyzed_methods() {
+    return m_num_analyzed_methods.exchange(0);
   }
 
   const call_graph::Graph& get_call_graph() { return m_call_graph; }
@@ -100,6 +122,11 @@ class GlobalTypeAnalyzer : public sparta::ParallelMonotonicFixpointIterator<
  private:
   std::unique_ptr<const WholeProgramState> m_wps;
   call_graph::Graph m_call_graph;
+  // The contributions are set by WholeProgramState::collect, which analyzes
+  // each method once while no fixpoint is running.
+  mutable call_graph::NodeResults<ArgumentTypePartition, MethodContributions>
+      m_node_results;
+  mutable std::atomic<size_t> m_num_analyzed_methods{0};
 
   std::unique_ptr<local::LocalTypeAnalyzer> analyze_method(
       const DexMethod* method,
@@ -239,16 +239,38 @@ void WholeProgramState::collect(const Scope& scope,
     if (!is_reachable(gta, method)) {
       return;
     }
-    auto& cfg = code->cfg();
-    auto lta = gta.get_local_analysis(method);
-    for (cfg::Block* b : cfg.blocks()) {
-      auto env = lta->get_entry_state_at(b);
-      for (auto& mie : InstructionIterable(b)) {
-        auto* insn = mie.insn;
-        lta->analyze_instruction(insn, &env);
-        collect_field_types(insn, env, &fields_tmp);
-        collect_return_types(insn, env, method, &methods_tmp);
+    auto contributions = gta.get_contributions(method);
+    if (contributions == nullptr) {
+      auto new_contributions = std::make_shared<MethodContributions>();
+      auto& cfg = code->cfg();
+      auto lta = gta.get_local_analysis(method);
+      for (cfg::Block* b : cfg.blocks()) {
+        auto env = lta->get_entry_state_at(b);
+        for (auto& mie : InstructionIterable(b)) {
+          auto* insn = mie.insn;
+          lta->analyze_instruction(insn, &env);
+          collect_field_types(insn, env, new_contributions.get());
+          collect_return_types(insn, env, method, new_contributions.get());
+        }
       }
+      gta.set_contributions(method, new_contributions);
+      contributions = std::move(new_contributions);
+    }
+    for (auto& [field, type] : contributions->field_types) {
+      fields_tmp.update(field,
+                        [&type](const DexField*,
+                                std::vector<DexTypeDomain>& s,
+                                bool /* exists */) { s.emplace_back(type); });
+    }
+    if (!contributions->return_types.empty()) {
+      methods_tmp.update(method,
+                         [&](const DexMethod*,
+                             std::vector<DexTypeDomain>& s,
+                             bool /* exists */) {
+                           s.insert(s.end(),
+                                    contributions->return_types.begin(),
+                                    contributions->return_types.end());
+                         });
     }
   });
   for (const auto& pair : fields_tmp) {
@@ -270,7 +292,7 @@ void WholeProgramState::collect(const Scope& scope,
 void WholeProgramState::collect_field_types(
     const IRInstruction* insn,
     const DexTypeEnvironment& env,
-    ConcurrentMap<const DexField*, std::vector<DexTypeDomain>>* field_tmp) {
+    MethodContributions* contributions) {
   if (!opcode::is_an_sput(insn->opcode()) &&
       !opcode::is_an_iput(insn->opcode())) {
     return;
@@ -285,17 +307,14 @@ void WholeProgramState::collect_field_types(
     ss << type;
     TRACE(TYPE, 5, "collecting field %s -> %s", SHOW(field), ss.str().c_str());
   }
-  field_tmp->update(field,
-                    [type](const DexField*,
-                           std::vector<DexTypeDomain>& s,
-                           bool /* exists */) { s.emplace_back(type); });
+  contributions->field_types.emplace_back(field, type);
 }
 
 void WholeProgramState::collect_return_types(
     const IRInstruction* insn,
     const DexTypeEnvironment& env,
     const DexMethod* method,
-    ConcurrentMap<const DexMethod*, std::vector<DexTypeDomain>>* method_tmp) {
+    MethodContributions* contributions) {
   auto op = insn->opcode();
   if (!opcode::is_a_return(op)) {
     return;
@@ -305,18 +324,38 @@ void WholeProgramState::collect_return_types(
     // does indeed return -- even though `void` is not actually a return type,
     // this tells us that the code following any invoke of this method is
     // reachable.
-    method_tmp->update(
-        method,
-        [](const DexMethod*, std::vector<DexTypeDomain>& s, bool /* exists */) {
-          s.emplace_back(DexTypeDomain::top());
-        });
+    contributions->return_types.emplace_back(DexTypeDomain::top());
     return;
   }
-  auto type = env.get(insn->src(0));
-  method_tmp->update(method,
-                     [type](const DexMethod*,
-                            std::vector<DexTypeDomain>& s,
-                            bool /* exists */) { s.emplace_back(type); });
+  contributions->return_types.emplace_back(env.get(insn->src(0)));
+}
+
+void WholeProgramState::get_changed_members(
+    const WholeProgramState& other,
+    std::unordered_set<const DexField*>* fields,
+    std::unordered_set<const DexMethod*>* methods) const {
+  auto check_field = [&](const DexField* field) {
+    if (!get_field_type(field).equals(other.get_field_type(field))) {
+      fields->emplace(field);
+    }
+  };
+  auto check_method = [&](const DexMethod* method) {
+    if (!get_return_type(method).equals(other.get_return_type(method))) {
+      methods->emplace(method);
+    }
+  };
+  for (auto* field : m_known_fields) {
+    check_field(field);
+  }
+  for (auto* field : other.m_known_fields) {
+    check_field(field);
+  }
+  for (auto* method : m_known_methods) {
+    check_method(method);
+  }
+  for (auto* method : other.m_known_methods) {
+    check_method(method);
+  }
 }
 
 bool WholeProgramState::is_reachable(const global::GlobalTypeAnalyzer& gta,
@@ -33,6 +33,16 @@ using DexTypeFieldPartition =
 using DexTypeMethodPartition =
     sparta::HashedAbstractPartition<const DexMethod*, DexTypeDomain>;
 
+/*
+ * The types that a single method writes to fields and returns, as found by
+ * WholeProgramState::collect. They only change when the analysis of the
+ * method does, so they can be kept from one WholeProgramState to the next.
+ */
+struct MethodContributions {
+  std::vector<std::pair<const DexField*, DexTypeDomain>> field_types;
+  std::vector<DexTypeDomain> return_types;
+};
+
 class WholeProgramState {
  public:
   // By default, the field and method partitions are initialized to Bottom.
@@ -89,6 +99,14 @@ class WholeProgramState {
     return domain;
   }
 
+  /*
+   * Collects the fields and methods whose types, as seen through
+   * get_field_type and get_return_type, differ between this state and :other.
+   */
+  void get_changed_members(const WholeProgramState& other,
+                           std::unordered_set<const DexField*>* fields,
+                           std::unordered_set<const DexMethod*>* methods) const;
+
   size_t get_num_resolved_fields() {
     size_t cnt = 0;
     for (auto& pair : m_field_partition.bindings()) {
@@ -151,16 +169,14 @@ class WholeProgramState {
 
   void collect(const Scope& scope, const global::GlobalTypeAnalyzer&);
 
-  void collect_field_types(
-      const IRInstruction* insn,
-      const DexTypeEnvironment& env,
-      ConcurrentMap<const DexField*, std::vector<DexTypeDomain>>* field_tmp);
+  void collect_field_types(const IRInstruction* insn,
+                           const DexTypeEnvironment& env,
+                           MethodContributions* contributions);
 
-  void collect_return_types(
-      const IRInstruction* insn,
-      const DexTypeEnvironment& env,
-      const DexMethod* method,
-      ConcurrentMap<const DexMethod*, std::vector<DexTypeDomain>>* method_tmp);
+  void collect_return_types(const IRInstruction* insn,
+                            const DexTypeEnvironment& env,
+                            const DexMethod* method,
+                            MethodContributions* contributions);
 
   bool is_reachable(const global::GlobalTypeAnalyzer&, const DexMethod*) const;
 
@@ -7,8 +7,14 @@
 
 #include "TypeStringRewriter.h"
 
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+#include "ConcurrentContainers.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -114,6 +120,30 @@ const DexString* make_array(const DexString* name, uint32_t level) {
   array.append(name->str());
   return DexString::make_string(array);
 }
+
+/*
+ * The same strings occur in many places, so the rewriters first collect the
+ * distinct strings and translate each of them once, in parallel. The result
+ * only holds the strings that `translate` maps to a non-null string.
+ */
+template <typename Translate>
+std::unordered_map<const DexString*, const DexString*> translate_strings(
+    const ConcurrentSet<const DexString*>& strings,
+    const Translate& translate) {
+  std::vector<const DexString*> distinct(strings.begin(), strings.end());
+  std::vector<const DexString*> translated(distinct.size());
+  std::vector<size_t> indices(distinct.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) { translated[i] = translate(distinct[i]); }, indices);
+  std::unordered_map<const DexString*, const DexString*> result;
+  for (size_t i = 0; i < distinct.size(); ++i) {
+    if (translated[i] != nullptr) {
+      result.emplace(distinct[i], translated[i]);
+    }
+  }
+  return result;
+}
 } // namespace
 
 namespace rewriter {
@@ -165,59 +195,100 @@ const DexString* TypeStringMap::get_new_type_name(
 
 void rewrite_dalvik_annotation_signature(const Scope& scope,
                                          const TypeStringMap& mapping) {
+  if (mapping.get_class_map().empty()) {
+    return;
+  }
   static DexType* dalviksig =
       DexType::get_type("Ldalvik/annotation/Signature;");
-  walk::parallel::annotations(scope, [&](DexAnnotation* anno) {
-    if (anno->type() != dalviksig) return;
-    auto& elems = anno->anno_elems();
-    for (auto& elem : elems) {
-      auto& ev = elem.encoded_value;
-      if (ev->evtype() != DEVT_ARRAY) continue;
-      auto arrayev = static_cast<DexEncodedValueArray*>(ev.get());
-      auto const& evs = arrayev->evalues();
-      for (auto& strev : *evs) {
-        if (strev->evtype() != DEVT_STRING) continue;
-        auto stringev = static_cast<DexEncodedValueString*>(strev.get());
-        auto* old_str = stringev->string();
-        auto* new_str = lookup_signature_annotation(mapping, old_str);
-        if (new_str != nullptr) {
-          TRACE(RENAME, 5, "Rewriting Signature from '%s' to '%s'",
-                old_str->c_str(), new_str->c_str());
-          stringev->string(new_str);
+  auto for_each_signature_string = [&](const auto& f) {
+    walk::parallel::annotations(scope, [&](DexAnnotation* anno) {
+      if (anno->type() != dalviksig) return;
+      auto& elems = anno->anno_elems();
+      for (auto& elem : elems) {
+        auto& ev = elem.encoded_value;
+        if (ev->evtype() != DEVT_ARRAY) continue;
+        auto arrayev = static_cast<DexEncodedValueArray*>(ev.get());
+        auto const& evs = arrayev->evalues();
+        for (auto& strev : *evs) {
+          if (strev->evtype() != DEVT_STRING) continue;
+          f(static_cast<DexEncodedValueString*>(strev.get()));
         }
       }
+    });
+  };
+
+  ConcurrentSet<const DexString*> strings;
+  for_each_signature_string([&](DexEncodedValueString* stringev) {
+    strings.insert(stringev->string());
+  });
+  auto translations = translate_strings(strings, [&](const DexString* str) {
+    return lookup_signature_annotation(mapping, str);
+  });
+  if (translations.empty()) {
+    return;
+  }
+  for_each_signature_string([&](DexEncodedValueString* stringev) {
+    auto* old_str = stringev->string();
+    auto it = translations.find(old_str);
+    if (it != translations.end()) {
+      TRACE(RENAME, 5, "Rewriting Signature from '%s' to '%s'",
+            old_str->c_str(), it->second->c_str());
+      stringev->string(it->second);
     }
   });
 }
 
 uint32_t rewrite_string_literal_instructions(const Scope& scope,
                                              const TypeStringMap& mapping) {
+  if (mapping.get_class_map().empty()) {
+    return 0;
+  }
+  ConcurrentSet<const DexString*> strings;
+  walk::parallel::code(scope, [&](DexMethod*, IRCode& code) {
+    for (const auto& mie : InstructionIterable(code)) {
+      auto insn = mie.insn;
+      if (insn->opcode() == OPCODE_CONST_STRING) {
+        strings.insert(insn->get_string());
+      }
+    }
+  });
+  auto translations =
+      translate_strings(strings, [&](const DexString* old_str) {
+        auto* internal_str = DexString::get_string(
+            java_names::external_to_internal(old_str->str()));
+        if (!internal_str || !DexType::get_type(internal_str)) {
+          return static_cast<const DexString*>(nullptr);
+        }
+        auto new_type_name = mapping.get_new_type_name(internal_str);
+        if (!new_type_name) {
+          return static_cast<const DexString*>(nullptr);
+        }
+        return DexString::make_string(
+            java_names::internal_to_external(new_type_name->str()));
+      });
+  if (translations.empty()) {
+    return 0;
+  }
+
   std::atomic<uint32_t> total_updates(0);
-  walk::parallel::code(scope, [&](DexMethod* meth, IRCode& code) {
+  walk::parallel::code(scope, [&](DexMethod*, IRCode& code) {
     for (const auto& mie : InstructionIterable(code)) {
       auto insn = mie.insn;
       if (insn->opcode() != OPCODE_CONST_STRING) {
         continue;
       }
       auto* old_str = insn->get_string();
-      auto* internal_str = DexString::get_string(
-          java_names::external_to_internal(old_str->str()));
-      if (!internal_str || !DexType::get_type(internal_str)) {
-        continue;
-      }
-      auto new_type_name = mapping.get_new_type_name(internal_str);
-      if (!new_type_name) {
+      auto it = translations.find(old_str);
+      if (it == translations.end()) {
         continue;
       }
-      auto new_str = DexString::make_string(
-          java_names::internal_to_external(new_type_name->str()));
-      insn->set_string(new_str);
+      insn->set_string(it->second);
       total_updates++;
       TRACE(RENAME,
             5,
             "Replace const-string from %s to %s",
             old_str->c_str(),
-            new_str->c_str());
+            it->second->c_str());
     }
   });
   return total_updates.load();
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+#include "PowersetAbstractDomain.h"
+
+namespace sparta {
+
+namespace bvsad_impl {
+
+/*
+ * A powerset over a dense universe {0, ..., max_size-1} of unsigned integers,
+ * represented as a bit vector. This is meant for small universes whose
+ * elements are indices, like the registers of a method, where a set takes a
+ * few words and the lattice operations are word-wise loops that the compiler
+ * unrolls and vectorizes.
+ *
+ * Bit vectors of up to InlineWords 64-bit words are stored in the value
+ * itself, so that copying a set does not allocate. Larger universes use a
+ * heap-allocated vector. Elements beyond the universe are ignored by `add`,
+ * as for the SparseSetAbstractDomain. Sets over different universes can be
+ * combined: missing words are taken to be empty, and the join grows the
+ * universe to the larger one.
+ */
+template <typename IntegerType, size_t InlineWords>
+class BitVectorSetValue final
+    : public PowersetImplementation<
+          IntegerType,
+          std::vector<IntegerType>,
+          BitVectorSetValue<IntegerType, InlineWords>> {
+ public:
+  using Word = uint64_t;
+  static constexpr size_t kBitsPerWord = 64;
+
+  // This constructor is defined solely to satisfy the requirement that an
+  // AbstractDomain must be default-constructible. It shouldn't be used in
+  // practice.
+  BitVectorSetValue() = default;
+
+  // Returns an empty set over a universe of the given size.
+  explicit BitVectorSetValue(size_t max_size) { resize(max_size); }
+
+  void clear() override { std::fill_n(data(), num_words(), Word(0)); }
+
+  std::vector<IntegerType> elements() const override {
+    std::vector<IntegerType> result;
+    result.reserve(size());
+    const Word* words = data();
+    for (size_t i = 0; i < num_words(); ++i) {
+      for (Word w = words[i]; w != 0; w &= w - 1) {
+        result.push_back(
+            static_cast<IntegerType>(i * kBitsPerWord + __builtin_ctzll(w)));
+      }
+    }
+    return result;
+  }
+
+  AbstractValueKind kind() const override { return AbstractValueKind::Value; }
+
+  bool contains(const IntegerType& element) const override {
+    size_t e = element;
+    return e < m_max_size &&
+           (data()[e / kBitsPerWord] >> (e % kBitsPerWord)) & 1;
+  }
+
+  bool leq(const BitVectorSetValue& other) const override {
+    const Word* words = data();
+    const Word* other_words = other.data();
+    size_t common = std::min(num_words(), other.num_words());
+    // No early exit, so that the loop vectorizes. Universes are small.
+    Word excess = 0;
+    for (size_t i = 0; i < common; ++i) {
+      excess |= words[i] & ~other_words[i];
+    }
+    for (size_t i = common; i < num_words(); ++i) {
+      excess |= words[i];
+    }
+    return excess == 0;
+  }
+
+  bool equals(const BitVectorSetValue& other) const override {
+    const Word* words = data();
+    const Word* other_words = other.data();
+    size_t common = std::min(num_words(), other.num_words());
+    Word diff = 0;
+    for (size_t i = 0; i < common; ++i) {
+      diff |= words[i] ^ other_words[i];
+    }
+    for (size_t i = common; i < num_words(); ++i) {
+      diff |= words[i];
+    }
+    for (size_t i = common; i < other.num_words(); ++i) {
+      diff |= other_words[i];
+    }
+    return diff == 0;
+  }
+
+  void add(const IntegerType& element) override {
+    size_t e = element;
+    if (e < m_max_size) {
+      data()[e / kBitsPerWord] |= Word(1) << (e % kBitsPerWord);
+    }
+  }
+
+  void remove(const IntegerType& element) override {
+    size_t e = element;
+    if (e < m_max_size) {
+      data()[e / kBitsPerWord] &= ~(Word(1) << (e % kBitsPerWord));
+    }
+  }
+
+  AbstractValueKind join_with(const BitVectorSetValue& other) override {
+    if (other.m_max_size > m_max_size) {
+      resize(other.m_max_size);
+    }
+    Word* words = data();
+    const Word* other_words = other.data();
+    for (size_t i = 0; i < other.num_words(); ++i) {
+      words[i] |= other_words[i];
+    }
+    return AbstractValueKind::Value;
+  }
+
+  AbstractValueKind meet_with(const BitVectorSetValue& other) override {
+    Word* words = data();
+    const Word* other_words = other.data();
+    size_t common = std::min(num_words(), other.num_words());
+    for (size_t i = 0; i < common; ++i) {
+      words[i] &= other_words[i];
+    }
+    std::fill(words + common, words + num_words(), Word(0));
+    return AbstractValueKind::Value;
+  }
+
+  AbstractValueKind difference_with(const BitVectorSetValue& other) override {
+    Word* words = data();
+    const Word* other_words = other.data();
+    size_t common = std::min(num_words(), other.num_words());
+    for (size_t i = 0; i < common; ++i) {
+      words[i] &= ~other_words[i];
+    }
+    return AbstractValueKind::Value;
+  }
+
+  size_t size() const override {
+    const Word* words = data();
+    size_t count = 0;
+    for (size_t i = 0; i < num_words(); ++i) {
+      count += __builtin_popcountll(words[i]);
+    }
+    return count;
+  }
+
+  friend std::ostream& operator<<(std::ostream& o,
+                                  const BitVectorSetValue& value) {
+    o << "[#" << value.size() << "]";
+    const auto& elements = value.elements();
+    o << "{";
+    for (auto it = elements.begin(); it != elements.end();) {
+      o << *it++;
+      if (it != elements.end()) {
+        o << ", ";
+      }
+    }
+    o << "}";
+    return o;
+  }
+
+ private:
+  size_t num_words() const {
+    return (m_max_size + kBitsPerWord - 1) / kBitsPerWord;
+  }
+
+  // The words are inline exactly when there are at most InlineWords of them.
+  bool is_inline() const { return num_words() <= InlineWords; }
+
+  Word* data() { return is_inline() ? m_inline.data() : m_heap.data(); }
+
+  const Word* data() const {
+    return is_inline() ? m_inline.data() : m_heap.data();
+  }
+
+  // Grows the universe, keeping the elements.
+  void resize(size_t max_size) {
+    size_t old_num_words = num_words();
+    bool was_inline = is_inline();
+    m_max_size = max_size;
+    if (is_inline()) {
+      return;
+    }
+    if (was_inline) {
+      m_heap.assign(num_words(), Word(0));
+      std::copy_n(m_inline.data(), old_num_words, m_heap.data());
+      m_inline.fill(0);
+    } else {
+      m_heap.resize(num_words(), Word(0));
+    }
+  }
+
+  size_t m_max_size{0};
+  std::array<Word, InlineWords> m_inline{};
+  std::vector<Word> m_heap;
+};
+
+} // namespace bvsad_impl
+
+/*
+ * A powerset abstract domain over a dense universe of unsigned integers, based
+ * on bit vectors. Universes of up to 64 * InlineWords elements are stored
+ * inline; InlineWords can be set to 0 to always allocate the bit vector, which
+ * keeps the size of the domain small when most universes are large.
+ */
+template <typename IntegerType, size_t InlineWords = 1>
+class BitVectorSetAbstractDomain final
+    : public PowersetAbstractDomain<
+          IntegerType,
+          bvsad_impl::BitVectorSetValue<IntegerType, InlineWords>,
+          std::vector<IntegerType>,
+          BitVectorSetAbstractDomain<IntegerType, InlineWords>> {
+ public:
+  using Value = bvsad_impl::BitVectorSetValue<IntegerType, InlineWords>;
+
+  ~BitVectorSetAbstractDomain() {
+    // The destructor is the only method that is guaranteed to be created when
+    // a class template is instantiated. This is a good place to perform all
+    // the sanity checks on the template parameters.
+    static_assert(std::is_unsigned<IntegerType>::value,
+                  "IntegerType is not an unsigned arihmetic type");
+    static_assert(sizeof(IntegerType) <= sizeof(size_t),
+                  "IntegerType is too large");
+  }
+
+  BitVectorSetAbstractDomain()
+      : PowersetAbstractDomain<IntegerType,
+                               Value,
+                               std::vector<IntegerType>,
+                               BitVectorSetAbstractDomain>() {}
+
+  explicit BitVectorSetAbstractDomain(AbstractValueKind kind)
+      : PowersetAbstractDomain<IntegerType,
+                               Value,
+                               std::vector<IntegerType>,
+                               BitVectorSetAbstractDomain>(kind) {}
+
+  explicit BitVectorSetAbstractDomain(size_t max_size) {
+    this->set_to_value(Value(max_size));
+  }
+
+  static BitVectorSetAbstractDomain bottom() {
+    return BitVectorSetAbstractDomain(AbstractValueKind::Bottom);
+  }
+
+  static BitVectorSetAbstractDomain top() {
+    return BitVectorSetAbstractDomain(AbstractValueKind::Top);
+  }
+};
+
+} // namespace sparta
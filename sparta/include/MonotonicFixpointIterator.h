@@ -8,8 +8,10 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <functional>
+#include <memory>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
@@ -59,8 +61,9 @@ class MonotonicFixpointIteratorContext final {
   explicit MonotonicFixpointIteratorContext(const Domain& init)
       : m_init(init) {}
 
-  explicit MonotonicFixpointIteratorContext(
-      const Domain& init, const std::unordered_set<NodeId>& nodes)
+  template <typename Nodes>
+  explicit MonotonicFixpointIteratorContext(const Domain& init,
+                                            const Nodes& nodes)
       : m_init(init) {
     // Pre-populate hash table for all the nodes.
     for (auto& node : nodes) {
@@ -116,9 +119,7 @@ class MonotonicFixpointIteratorBase
    * hashtables during the iteration.
    */
   MonotonicFixpointIteratorBase(const Graph& graph, size_t cfg_size_hint = 4)
-      : m_graph(graph),
-        m_entry_states(cfg_size_hint),
-        m_exit_states(cfg_size_hint) {}
+      : m_graph(graph), m_states(cfg_size_hint) {}
 
   /*
    * This method is invoked on the head of an SCC at each iteration, whenever
@@ -146,15 +147,15 @@ class MonotonicFixpointIteratorBase
    * Returns the invariant computed by the fixpoint iterator at a node entry.
    */
   Domain get_entry_state_at(const NodeId& node) const {
-    auto it = m_entry_states.find(node);
-    return (it == m_entry_states.end()) ? Domain::bottom() : it->second;
+    auto it = m_states.find(node);
+    return (it == m_states.end()) ? Domain::bottom() : it->second.entry;
   }
 
   /*
    * Returns the invariant computed by the fixpoint iterator at a node exit.
    */
   Domain get_exit_state_at(const NodeId& node) const {
-    auto it = m_exit_states.find(node);
+    auto it = m_states.find(node);
     // It's impossible to get rid of this condition by initializing all exit
     // states to _|_ prior to starting the fixpoint iteration. The reason is
     // that we only have a partial view of the control-flow graph, i.e., all
@@ -169,19 +170,15 @@ class MonotonicFixpointIteratorBase
     // When computing the entry state of A, we perform the join of the exit
     // states of all its predecessors, which include U. Since U is invisible to
     // the fixpoint iterator, there is no way to initialize its exit state.
-    return (it == m_exit_states.end()) ? Domain::bottom() : it->second;
+    return (it == m_states.end()) ? Domain::bottom() : it->second.exit;
   }
 
-  void clear() {
-    m_entry_states.clear();
-    m_exit_states.clear();
-  }
+  void clear() { m_states.clear(); }
 
   void set_all_to_bottom(std::unordered_set<NodeId>& all_nodes) {
     // Pre-populate entry and exit states for all nodes.
     for (auto& node : all_nodes) {
-      m_entry_states[node] = Domain::bottom();
-      m_exit_states[node] = Domain::bottom();
+      m_states[node] = States();
     }
   }
 
@@ -198,26 +195,24 @@ class MonotonicFixpointIteratorBase
   }
 
   void analyze_vertex(Context* context, const NodeId& node) {
-    // Retrieve the entry state. If it does not exist, set it to bottom.
-    Domain& entry_state =
-        m_entry_states.emplace(node, Domain::bottom()).first->second;
-    // We should be careful not to access m_exit_states[node] before computing
-    // the entry state, as this may silently initialize it with an unwanted
-    // value (i.e., the default-constructed value of Domain). This can in turn
-    // lead to inaccurate or even incorrect results when the node possesses a
-    // self-loop. Initializing all exit states prior to starting the fixpoint
-    // iteration is not a viable option, since the control-flow graph may
-    // contain unreachable nodes pointing to reachable ones (see the
-    // documentation of `get_exit_state_at`).
-    compute_entry_state(context, node, &entry_state);
-    Domain& exit_state = m_exit_states[node];
-    exit_state = entry_state;
-    this->analyze_node(node, &exit_state);
+    // Retrieve the states. If they do not exist, set them to bottom. An exit
+    // state that has not been computed yet is bottom either way, so this does
+    // not affect the entry state of a node with a self-loop.
+    States& states = m_states[node];
+    compute_entry_state(context, node, &states.entry);
+    states.exit = states.entry;
+    this->analyze_node(node, &states.exit);
   }
 
+  // The entry and exit states of a node share a hash table entry, which halves
+  // the allocations of each run.
+  struct States {
+    Domain entry = Domain::bottom();
+    Domain exit = Domain::bottom();
+  };
+
   const Graph& m_graph;
-  std::unordered_map<NodeId, Domain, NodeHash> m_entry_states;
-  std::unordered_map<NodeId, Domain, NodeHash> m_exit_states;
+  std::unordered_map<NodeId, States, NodeHash> m_states;
 };
 
 } // namespace fp_impl
@@ -261,6 +256,23 @@ class WTOMonotonicFixpointIterator
           return succ_nodes;
         }) {}
 
+  /*
+   * Top-level components of the WTO that are not connected by a path in the
+   * graph don't depend on each other, and can be analyzed concurrently. This
+   * happens if the graph has at least `parallel_threshold` nodes, in which
+   * case analyze_node() and analyze_edge() must be thread-safe. The result is
+   * the same as that of a sequential iteration.
+   */
+  WTOMonotonicFixpointIterator(
+      const Graph& graph,
+      size_t cfg_size_hint,
+      size_t parallel_threshold,
+      size_t num_threads = parallel::default_num_threads())
+      : WTOMonotonicFixpointIterator(graph, cfg_size_hint) {
+    m_num_threads = num_threads;
+    build_component_graph(parallel_threshold);
+  }
+
   /*
    * Executes the fixpoint iterator given an abstract value describing the
    * initial program configuration. This method can be invoked multiple times
@@ -269,6 +281,10 @@ class WTOMonotonicFixpointIterator
    */
   void run(const Domain& init) {
     this->clear();
+    if (m_component_graph != nullptr) {
+      run_in_parallel(init);
+      return;
+    }
     Context context(init);
     for (const WtoComponent<NodeId>& component : m_wto) {
       analyze_component(&context, component);
@@ -276,6 +292,98 @@ class WTOMonotonicFixpointIterator
   }
 
  private:
+  // The dependencies between the top-level components of the WTO.
+  struct ComponentGraph {
+    std::vector<const WtoComponent<NodeId>*> components;
+    std::vector<std::vector<uint32_t>> successors;
+    std::vector<uint32_t> num_predecessors;
+    std::vector<NodeId> nodes;
+  };
+
+  void build_component_graph(size_t parallel_threshold) {
+    auto component_graph = std::make_unique<ComponentGraph>();
+    std::unordered_map<NodeId, uint32_t, NodeHash> component_of;
+    for (const WtoComponent<NodeId>& component : m_wto) {
+      uint32_t index = component_graph->components.size();
+      component_graph->components.push_back(&component);
+      std::vector<const WtoComponent<NodeId>*> stack{&component};
+      while (!stack.empty()) {
+        const WtoComponent<NodeId>* current = stack.back();
+        stack.pop_back();
+        component_graph->nodes.push_back(current->head_node());
+        component_of.emplace(current->head_node(), index);
+        if (current->is_scc()) {
+          for (const auto& inner : *current) {
+            stack.push_back(&inner);
+          }
+        }
+      }
+    }
+    size_t num_components = component_graph->components.size();
+    if (component_graph->nodes.size() < parallel_threshold ||
+        num_components < 2) {
+      return;
+    }
+    component_graph->successors.resize(num_components);
+    component_graph->num_predecessors.resize(num_components);
+    for (const auto& node : component_graph->nodes) {
+      uint32_t index = component_of.at(node);
+      auto& successors = component_graph->successors[index];
+      for (const auto& edge : GraphInterface::successors(this->m_graph, node)) {
+        auto it =
+            component_of.find(GraphInterface::target(this->m_graph, edge));
+        if (it != component_of.end() && it->second != index) {
+          successors.push_back(it->second);
+        }
+      }
+    }
+    for (auto& successors : component_graph->successors) {
+      std::sort(successors.begin(), successors.end());
+      successors.erase(std::unique(successors.begin(), successors.end()),
+                       successors.end());
+      for (auto succ : successors) {
+        ++component_graph->num_predecessors[succ];
+      }
+    }
+    m_component_graph = std::move(component_graph);
+  }
+
+  void run_in_parallel(const Domain& init) {
+    const auto& component_graph = *m_component_graph;
+    // The hash tables are never resized during the iteration, so that
+    // components can be analyzed concurrently.
+    for (const auto& node : component_graph.nodes) {
+      this->m_states[node] = {};
+    }
+    Context context(init, component_graph.nodes);
+    size_t num_components = component_graph.components.size();
+    std::unique_ptr<std::atomic<uint32_t>[]> counters(
+        new std::atomic<uint32_t>[num_components]);
+    for (size_t i = 0; i < num_components; ++i) {
+      counters[i] = component_graph.num_predecessors[i];
+    }
+    auto wq = sparta::work_queue<uint32_t>(
+        [&](SpartaWorkerState<uint32_t>* worker_state, uint32_t index) {
+          analyze_component(&context, *component_graph.components[index]);
+          // A component is scheduled once all the components it depends on
+          // have been analyzed.
+          for (auto succ : component_graph.successors[index]) {
+            if (--counters[succ] == 0) {
+              worker_state->push_task(succ);
+            }
+          }
+          return nullptr;
+        },
+        m_num_threads,
+        /*push_tasks_while_running=*/true);
+    for (uint32_t i = 0; i < num_components; ++i) {
+      if (component_graph.num_predecessors[i] == 0) {
+        wq.add_item(i);
+      }
+    }
+    wq.run_all();
+  }
+
   void analyze_component(Context* context,
                          const WtoComponent<NodeId>& component) {
     if (component.is_vertex()) {
@@ -298,7 +406,7 @@ class WTOMonotonicFixpointIterator
       // slot associated with the head node in the hash table of entry states.
       // The state is updated in place within the hash table via side effects,
       // which avoids costly copies and allocations.
-      Domain* current_state = &this->m_entry_states[head];
+      Domain* current_state = &this->m_states[head].entry;
       Domain new_state = Domain::bottom();
       this->compute_entry_state(context, head, &new_state);
       if (new_state.leq(*current_state)) {
@@ -318,6 +426,9 @@ class WTOMonotonicFixpointIterator
     }
   }
   WeakTopologicalOrdering<NodeId, NodeHash> m_wto;
+  // Only set when top-level components are analyzed in parallel.
+  std::unique_ptr<ComponentGraph> m_component_graph;
+  size_t m_num_threads{1};
 };
 
 /*
@@ -390,6 +501,15 @@ class ParallelMonotonicFixpointIterator
     }
   }
 
+  /*
+   * An estimate of the time it takes to analyze the node, in arbitrary units
+   * that only need to be consistent across nodes. Among the nodes that become
+   * ready at the same time, those with the most work left downstream of them
+   * are scheduled first, so that long chains of expensive nodes do not end up
+   * as a serial tail of the iteration. The default treats all nodes alike.
+   */
+  virtual uint64_t estimate_cost(const NodeId& /* node */) const { return 1; }
+
   /*
    * Executes the fixpoint iterator given an abstract value describing the
    * initial program configuration. This method can be invoked multiple times
@@ -404,13 +524,33 @@ class ParallelMonotonicFixpointIterator
     std::fill_n(wpo_counter.get(), m_wpo.size(), 0);
     auto entry_idx = m_wpo.get_entry();
     assert(m_wpo.get_num_preds(entry_idx) == 0);
+    if (m_priorities.empty()) {
+      compute_priorities();
+    }
+    // Pushes the nodes in order of decreasing priority. The queues of the
+    // workers are FIFO, so the worker picks up the one with the most work
+    // downstream first, and idle workers steal the others.
+    auto push_ready = [this](WPOWorkerState* worker_state,
+                             std::vector<uint32_t>* ready) {
+      if (ready->size() > 1) {
+        std::stable_sort(ready->begin(),
+                         ready->end(),
+                         [this](uint32_t a, uint32_t b) {
+                           return m_priorities[a] > m_priorities[b];
+                         });
+      }
+      for (auto idx : *ready) {
+        worker_state->push_task(idx);
+      }
+    };
     // Prepare work queue.
     auto wq = sparta::work_queue<uint32_t>(
-        [&context, &entry_idx, &wpo_counter, this](WPOWorkerState* worker_state,
-                                                   uint32_t wpo_idx) {
+        [&context, &entry_idx, &wpo_counter, &push_ready, this](
+            WPOWorkerState* worker_state, uint32_t wpo_idx) {
           std::atomic<uint32_t>& current_counter = wpo_counter[wpo_idx];
           assert(current_counter == m_wpo.get_num_preds(wpo_idx));
           current_counter = 0;
+          std::vector<uint32_t> ready;
           // NonExit node
           if (!m_wpo.is_exit(wpo_idx)) {
             this->analyze_vertex(&context, m_wpo.get_node(wpo_idx));
@@ -419,16 +559,17 @@ class ParallelMonotonicFixpointIterator
               // Increase succ node's counter, push succ nodes in work queue if
               // their counter number matches their NumSchedPreds.
               if (++succ_counter == m_wpo.get_num_preds(succ_idx)) {
-                worker_state->push_task(succ_idx);
+                ready.push_back(succ_idx);
               }
             }
+            push_ready(worker_state, &ready);
             return nullptr;
           }
           // Exit node
           // Check if component of the exit node has stabilized.
           auto head_idx = m_wpo.get_head_of_exit(wpo_idx);
           NodeId head = m_wpo.get_node(head_idx);
-          Domain* current_state = &this->m_entry_states[head];
+          Domain* current_state = &this->m_states[head].entry;
           Domain new_state = Domain::bottom();
           this->compute_entry_state(&context, head, &new_state);
           if (new_state.leq(*current_state)) {
@@ -440,9 +581,10 @@ class ParallelMonotonicFixpointIterator
               // Increase succ node's counter, push succ nodes in work queue if
               // their counter number matches their NumSchedPreds.
               if (++succ_counter == m_wpo.get_num_preds(succ_idx)) {
-                worker_state->push_task(succ_idx);
+                ready.push_back(succ_idx);
               }
             }
+            push_ready(worker_state, &ready);
           } else {
             // Component didn't stabilize.
             this->extrapolate(context, head, current_state, new_state);
@@ -467,7 +609,7 @@ class ParallelMonotonicFixpointIterator
               // any other dependent counters.
               if ((component_counter += pred_pair.second) ==
                   m_wpo.get_num_preds(component_idx)) {
-                worker_state->push_task(component_idx);
+                ready.push_back(component_idx);
               }
             }
             if (head_idx == entry_idx) {
@@ -476,8 +618,9 @@ class ParallelMonotonicFixpointIterator
               // get_num_outer_preds the nodes with num_outer_preds are ignored.
               // So we need to manually add entry node back to work queue if
               // the component didn't stabilize.
-              worker_state->push_task(head_idx);
+              ready.push_back(head_idx);
             }
+            push_ready(worker_state, &ready);
           }
           return nullptr;
         },
@@ -491,9 +634,52 @@ class ParallelMonotonicFixpointIterator
   }
 
  private:
+  /*
+   * The priority of a WPO node is its own cost plus the largest priority of
+   * its scheduling successors, i.e. the cost of the most expensive chain of
+   * nodes that cannot start before it. Exits only compare states, and count
+   * for nothing. The scheduling constraints of a WPO are acyclic, and do not
+   * change across runs.
+   */
+  void compute_priorities() {
+    const uint32_t size = m_wpo.size();
+    m_priorities.assign(size, 0);
+    // Iterative post-order traversal from the entry, so that all successors
+    // of a node are done before it.
+    std::vector<bool> visited(size, false);
+    std::vector<std::pair<uint32_t, bool>> stack;
+    stack.emplace_back(m_wpo.get_entry(), false);
+    while (!stack.empty()) {
+      auto [idx, expanded] = stack.back();
+      stack.pop_back();
+      if (expanded) {
+        uint64_t downstream = 0;
+        for (auto succ_idx : m_wpo.get_successors(idx)) {
+          downstream = std::max(downstream, m_priorities[succ_idx]);
+        }
+        uint64_t cost =
+            m_wpo.is_exit(idx) ? 0 : estimate_cost(m_wpo.get_node(idx));
+        m_priorities[idx] = cost + downstream;
+        continue;
+      }
+      if (visited[idx]) {
+        continue;
+      }
+      visited[idx] = true;
+      stack.emplace_back(idx, true);
+      for (auto succ_idx : m_wpo.get_successors(idx)) {
+        if (!visited[succ_idx]) {
+          stack.emplace_back(succ_idx, false);
+        }
+      }
+    }
+  }
+
   WeakPartialOrdering<NodeId, NodeHash> m_wpo;
   size_t m_num_thread;
   std::unordered_set<NodeId> m_all_nodes;
+  // Indexed by WPO node, computed on the first run.
+  std::vector<uint64_t> m_priorities;
 };
 
 /*
@@ -577,7 +763,7 @@ class MonotonicFixpointIterator
       // Check if component of the exit node has stabilized.
       uint32_t head_idx = m_wpo.get_head_of_exit(wpo_idx);
       NodeId head = m_wpo.get_node(head_idx);
-      Domain* current_state = &this->m_entry_states[head];
+      Domain* current_state = &this->m_states[head].entry;
       Domain new_state = Domain::bottom();
       this->compute_entry_state(&context, head, &new_state);
       if (new_state.leq(*current_state)) {
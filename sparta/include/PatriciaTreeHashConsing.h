@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+
+#include <boost/intrusive_ptr.hpp>
+
+namespace sparta {
+
+namespace pt_util {
+
+/*
+ * Tests whether a Value interface of a Patricia-tree map asks for hash-consed
+ * nodes, by declaring
+ *
+ *   static constexpr bool hash_consing = true;
+ *
+ * in which case it must also provide
+ *
+ *   static size_t hash(const type& x);
+ *
+ * that is consistent with Value::equals().
+ */
+template <typename Value, typename = void>
+struct is_hash_consed : std::false_type {};
+
+template <typename Value>
+struct is_hash_consed<Value, std::enable_if_t<Value::hash_consing>>
+    : std::true_type {};
+
+/*
+ * A thread-local cache of freed blocks of memory of small sizes.
+ *
+ * Trees keep being rebuilt during an analysis, and their nodes are all of the
+ * same few sizes. Blocks go back to the cache of the thread that frees them,
+ * which needs not be the thread that allocated them. A thread holds on to a
+ * bounded number of free blocks, and releases them when it terminates.
+ */
+class NodePool final {
+ public:
+  static void* allocate(size_t size) {
+    size_t size_class = get_size_class(size);
+    if (size_class >= kSizeClasses || s_terminated) {
+      return ::operator new(size);
+    }
+    FreeList& free_list = local().free_lists[size_class];
+    if (free_list.head == nullptr) {
+      return ::operator new((size_class + 1) * kGranularity);
+    }
+    Block* block = free_list.head;
+    free_list.head = block->next;
+    --free_list.length;
+    return block;
+  }
+
+  static void deallocate(void* ptr, size_t size) {
+    size_t size_class = get_size_class(size);
+    if (size_class >= kSizeClasses || s_terminated) {
+      ::operator delete(ptr);
+      return;
+    }
+    FreeList& free_list = local().free_lists[size_class];
+    if (free_list.length == kMaxFreeBlocks) {
+      ::operator delete(ptr);
+      return;
+    }
+    auto* block = static_cast<Block*>(ptr);
+    block->next = free_list.head;
+    free_list.head = block;
+    ++free_list.length;
+  }
+
+ private:
+  static constexpr size_t kGranularity = alignof(std::max_align_t);
+  static constexpr size_t kSizeClasses = 16;
+  static constexpr size_t kMaxFreeBlocks = 4096;
+
+  struct Block {
+    Block* next;
+  };
+
+  struct FreeList {
+    Block* head{nullptr};
+    size_t length{0};
+  };
+
+  struct FreeLists {
+    std::array<FreeList, kSizeClasses> free_lists;
+
+    ~FreeLists() {
+      for (auto& free_list : free_lists) {
+        while (free_list.head != nullptr) {
+          Block* next = free_list.head->next;
+          ::operator delete(free_list.head);
+          free_list.head = next;
+        }
+      }
+      // Nodes may still be freed during the destruction of other
+      // thread-local or static objects.
+      s_terminated = true;
+    }
+  };
+
+  static size_t get_size_class(size_t size) {
+    return (size - 1) / kGranularity;
+  }
+
+  static FreeLists& local() {
+    thread_local FreeLists free_lists;
+    return free_lists;
+  }
+
+  // Trivially destructible, hence usable at any time.
+  static inline thread_local bool s_terminated{false};
+};
+
+/*
+ * The table of the live nodes of one type of hash-consed Patricia trees.
+ *
+ * `Node` must provide `size_t hash() const` and `try_add_ref()`, which takes a
+ * reference to a node unless its reference count already dropped to zero. A
+ * node whose count dropped to zero is dead: it is never handed out again, and
+ * its destructor removes it from the table.
+ */
+template <typename Node>
+class HashConsingTable final {
+ public:
+  static HashConsingTable& get() {
+    // Never destroyed, as static trees may outlive it otherwise.
+    static auto* table = new HashConsingTable();
+    return *table;
+  }
+
+  // Returns the live node with the given hash that satisfies `matches`, or
+  // the node returned by `make`, which is then recorded.
+  template <typename Matches, typename Make>
+  boost::intrusive_ptr<Node> intern(size_t hash,
+                                    const Matches& matches,
+                                    const Make& make) {
+    Shard& shard = get_shard(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto range = shard.nodes.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      Node* node = it->second;
+      if (matches(*node) && node->try_add_ref()) {
+        return boost::intrusive_ptr<Node>(node, /* add_ref */ false);
+      }
+    }
+    boost::intrusive_ptr<Node> node = make();
+    shard.nodes.emplace(hash, node.get());
+    return node;
+  }
+
+  // Called by the destructor of an interned node.
+  void erase(const Node* node) {
+    size_t hash = node->hash();
+    Shard& shard = get_shard(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto range = shard.nodes.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == node) {
+        shard.nodes.erase(it);
+        return;
+      }
+    }
+  }
+
+ private:
+  static constexpr size_t kShards = 64;
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_multimap<size_t, Node*> nodes;
+  };
+
+  HashConsingTable() = default;
+
+  Shard& get_shard(size_t hash) {
+    // The low bits select the bucket within the shard.
+    return m_shards[(hash >> 16) % kShards];
+  }
+
+  std::array<Shard, kShards> m_shards;
+};
+
+} // namespace pt_util
+
+} // namespace sparta
@@ -18,9 +18,11 @@
 #include <type_traits>
 #include <utility>
 
+#include <boost/functional/hash.hpp>
 #include <boost/intrusive_ptr.hpp>
 
 #include "AbstractDomain.h"
+#include "PatriciaTreeHashConsing.h"
 #include "PatriciaTreeUtil.h"
 
 // Forward declarations
@@ -71,22 +73,22 @@ inline bool equals(
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& tree1,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& tree2);
 
-template <typename IntegerType, typename Value>
+template <typename IntegerType, typename Value, typename Combine>
 inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> combine_new_leaf(
-    const CombiningFunction<typename Value::type>& combine,
+    const Combine& combine,
     IntegerType key,
     const typename Value::type& value);
 
-template <typename IntegerType, typename Value>
+template <typename IntegerType, typename Value, typename Combine>
 inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> update(
-    const CombiningFunction<typename Value::type>& combine,
+    const Combine& combine,
     IntegerType key,
     const typename Value::type& value,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& tree);
 
-template <typename IntegerType, typename Value>
+template <typename IntegerType, typename Value, typename Mapping>
 inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> map(
-    const MappingFunction<typename Value::type>& f,
+    const Mapping& f,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& tree);
 
 template <typename IntegerType, typename Value>
@@ -95,21 +97,21 @@ erase_all_matching(
     IntegerType key_mask,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& tree);
 
-template <typename IntegerType, typename Value>
+template <typename IntegerType, typename Value, typename Combine>
 inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> merge(
-    const CombiningFunction<typename Value::type>& combine,
+    const Combine& combine,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& s,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& t);
 
-template <typename IntegerType, typename Value>
+template <typename IntegerType, typename Value, typename Combine>
 inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> intersect(
-    const ptmap_impl::CombiningFunction<typename Value::type>& combine,
+    const Combine& combine,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& s,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& t);
 
-template <typename IntegerType, typename Value>
+template <typename IntegerType, typename Value, typename Combine>
 inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> diff(
-    const ptmap_impl::CombiningFunction<typename Value::type>& combine,
+    const Combine& combine,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& s,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& t);
 
@@ -170,6 +172,14 @@ struct SimpleValue {
  *     // must be implemented. Additionally, value::type must be an
  *     // implementation of an AbstractDomain.
  *     static bool leq(const type& x, const type& y);
+ *
+ *     // Optional. Makes structurally equal subtrees share one node, so that
+ *     // equals() is a pointer comparison and leq() skips equal subtrees in
+ *     // constant time. This requires a hash function consistent with
+ *     // equals(). It pays off when equal maps keep being rebuilt, at the cost
+ *     // of a table lookup for each node created.
+ *     static constexpr bool hash_consing = true;
+ *     static size_t hash(const type& x);
  *   }
  *
  * Patricia trees can only handle unsigned integers. Arbitrary objects can be
@@ -287,9 +297,15 @@ class PatriciaTreeMap final {
     return m_tree == other.m_tree;
   }
 
-  PatriciaTreeMap& update(
-      const std::function<mapped_type(const mapped_type&)>& operation,
-      Key key) {
+  /*
+   * The operations below take the functions they apply as template
+   * parameters rather than as std::function objects, so that these can be
+   * inlined into the traversal of the trees. The combining_function and
+   * mapping_function types describe their signatures.
+   */
+
+  template <typename Operation>
+  PatriciaTreeMap& update(const Operation& operation, Key key) {
     m_tree = ptmap_impl::update<IntegerType, Value>(
         [&operation](const mapped_type& x, const mapped_type&) {
           return operation(x);
@@ -300,7 +316,8 @@ class PatriciaTreeMap final {
     return *this;
   }
 
-  bool map(const mapping_function& f) {
+  template <typename Mapping>
+  bool map(const Mapping& f) {
     auto new_tree = ptmap_impl::map<IntegerType, Value>(f, m_tree);
     bool res = new_tree != m_tree;
     m_tree = new_tree;
@@ -321,14 +338,16 @@ class PatriciaTreeMap final {
     return *this;
   }
 
-  PatriciaTreeMap& union_with(const combining_function& combine,
+  template <typename Combine>
+  PatriciaTreeMap& union_with(const Combine& combine,
                               const PatriciaTreeMap& other) {
     m_tree =
         ptmap_impl::merge<IntegerType, Value>(combine, m_tree, other.m_tree);
     return *this;
   }
 
-  PatriciaTreeMap& intersection_with(const combining_function& combine,
+  template <typename Combine>
+  PatriciaTreeMap& intersection_with(const Combine& combine,
                                      const PatriciaTreeMap& other) {
     m_tree = ptmap_impl::intersect<IntegerType, Value>(
         combine, m_tree, other.m_tree);
@@ -336,28 +355,32 @@ class PatriciaTreeMap final {
   }
 
   // Requires that `combine(bottom, ...) = bottom`.
-  PatriciaTreeMap& difference_with(const combining_function& combine,
+  template <typename Combine>
+  PatriciaTreeMap& difference_with(const Combine& combine,
                                    const PatriciaTreeMap& other) {
     m_tree =
         ptmap_impl::diff<IntegerType, Value>(combine, m_tree, other.m_tree);
     return *this;
   }
 
-  PatriciaTreeMap get_union_with(const combining_function& combine,
+  template <typename Combine>
+  PatriciaTreeMap get_union_with(const Combine& combine,
                                  const PatriciaTreeMap& other) const {
     auto result = *this;
     result.union_with(combine, other);
     return result;
   }
 
-  PatriciaTreeMap get_intersection_with(const combining_function& combine,
+  template <typename Combine>
+  PatriciaTreeMap get_intersection_with(const Combine& combine,
                                         const PatriciaTreeMap& other) const {
     auto result = *this;
     result.intersection_with(combine, other);
     return result;
   }
 
-  PatriciaTreeMap get_difference_with(const combining_function& combine,
+  template <typename Combine>
+  PatriciaTreeMap get_difference_with(const Combine& combine,
                                       const PatriciaTreeMap& other) const {
     auto result = *this;
     result.difference_with(combine, other);
@@ -470,6 +493,35 @@ class PatriciaTree {
     }
   }
 
+  // Takes a reference unless the node is already being destroyed.
+  bool try_add_ref() const {
+    size_t count = m_reference_count.load(std::memory_order_relaxed);
+    while (count != 0) {
+      if (m_reference_count.compare_exchange_weak(
+              count, count + 1, std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Hash-consed trees keep being rebuilt, so their nodes come from a pool.
+  static void* operator new(size_t size) {
+    if constexpr (is_hash_consed<Value>::value) {
+      return NodePool::allocate(size);
+    } else {
+      return ::operator new(size);
+    }
+  }
+
+  static void operator delete(void* ptr, size_t size) {
+    if constexpr (is_hash_consed<Value>::value) {
+      NodePool::deallocate(ptr, size);
+    } else {
+      ::operator delete(ptr);
+    }
+  }
+
  private:
   mutable std::atomic<size_t> m_reference_count{0};
 };
@@ -487,6 +539,12 @@ class PatriciaTreeBranch final : public PatriciaTree<IntegerType, Value> {
         m_left_tree(std::move(left_tree)),
         m_right_tree(std::move(right_tree)) {}
 
+  ~PatriciaTreeBranch() override {
+    if constexpr (is_hash_consed<Value>::value) {
+      HashConsingTable<PatriciaTreeBranch>::get().erase(this);
+    }
+  }
+
   bool is_leaf() const override { return false; }
 
   IntegerType prefix() const { return m_prefix; }
@@ -508,11 +566,46 @@ class PatriciaTreeBranch final : public PatriciaTree<IntegerType, Value> {
       IntegerType branching_bit,
       boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> left_tree,
       boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> right_tree) {
-    return new PatriciaTreeBranch<IntegerType, Value>(
-        prefix, branching_bit, std::move(left_tree), std::move(right_tree));
+    if constexpr (is_hash_consed<Value>::value) {
+      // The subtrees are hash-consed already, so they can be compared by
+      // address.
+      return HashConsingTable<PatriciaTreeBranch>::get().intern(
+          hash(prefix, branching_bit, left_tree.get(), right_tree.get()),
+          [&](const PatriciaTreeBranch& branch) {
+            return branch.m_prefix == prefix &&
+                   branch.m_stacking_bit == branching_bit &&
+                   branch.m_left_tree == left_tree &&
+                   branch.m_right_tree == right_tree;
+          },
+          [&]() {
+            return new PatriciaTreeBranch<IntegerType, Value>(
+                prefix, branching_bit, std::move(left_tree),
+                std::move(right_tree));
+          });
+    } else {
+      return new PatriciaTreeBranch<IntegerType, Value>(
+          prefix, branching_bit, std::move(left_tree), std::move(right_tree));
+    }
+  }
+
+  size_t hash() const {
+    return hash(m_prefix, m_stacking_bit, m_left_tree.get(),
+                m_right_tree.get());
   }
 
  private:
+  static size_t hash(IntegerType prefix,
+                     IntegerType branching_bit,
+                     const PatriciaTree<IntegerType, Value>* left_tree,
+                     const PatriciaTree<IntegerType, Value>* right_tree) {
+    size_t seed = 0;
+    boost::hash_combine(seed, prefix);
+    boost::hash_combine(seed, branching_bit);
+    boost::hash_combine(seed, left_tree);
+    boost::hash_combine(seed, right_tree);
+    return seed;
+  }
+
   IntegerType m_prefix;
   IntegerType m_stacking_bit;
   boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> m_left_tree;
@@ -527,6 +620,12 @@ class PatriciaTreeLeaf final : public PatriciaTree<IntegerType, Value> {
   explicit PatriciaTreeLeaf(IntegerType key, const mapped_type& value)
       : m_pair(key, value) {}
 
+  ~PatriciaTreeLeaf() override {
+    if constexpr (is_hash_consed<Value>::value) {
+      HashConsingTable<PatriciaTreeLeaf>::get().erase(this);
+    }
+  }
+
   bool is_leaf() const override { return true; }
 
   const IntegerType& key() const { return m_pair.first; }
@@ -535,10 +634,30 @@ class PatriciaTreeLeaf final : public PatriciaTree<IntegerType, Value> {
 
   static boost::intrusive_ptr<PatriciaTreeLeaf<IntegerType, Value>> make(
       IntegerType key, const mapped_type& value) {
-    return new PatriciaTreeLeaf<IntegerType, Value>(key, value);
+    if constexpr (is_hash_consed<Value>::value) {
+      return HashConsingTable<PatriciaTreeLeaf>::get().intern(
+          hash(key, value),
+          [&](const PatriciaTreeLeaf& leaf) {
+            return leaf.key() == key && Value::equals(leaf.value(), value);
+          },
+          [&]() {
+            return new PatriciaTreeLeaf<IntegerType, Value>(key, value);
+          });
+    } else {
+      return new PatriciaTreeLeaf<IntegerType, Value>(key, value);
+    }
   }
 
+  size_t hash() const { return hash(key(), value()); }
+
  private:
+  static size_t hash(IntegerType key, const mapped_type& value) {
+    size_t seed = 0;
+    boost::hash_combine(seed, key);
+    boost::hash_combine(seed, Value::hash(value));
+    return seed;
+  }
+
   std::pair<IntegerType, mapped_type> m_pair;
 
   template <typename T, typename V>
@@ -712,6 +831,10 @@ template <typename IntegerType, typename Value>
 inline bool equals(
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& tree1,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& tree2) {
+  if constexpr (is_hash_consed<Value>::value) {
+    // Structurally equal trees are the same node.
+    return tree1 == tree2;
+  }
   if (tree1 == tree2) {
     // This conditions allows the equality test to run in sublinear time when
     // comparing Patricia trees that share some structure.
@@ -750,9 +873,9 @@ inline bool equals(
 // Finds the value corresponding to :key in the tree and replaces its bound
 // value with combine(bound_value, :value). Note that the existing value is
 // always the first parameter to :combine and the new value is the second.
-template <typename IntegerType, typename Value>
+template <typename IntegerType, typename Value, typename Combine>
 inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> update(
-    const ptmap_impl::CombiningFunction<typename Value::type>& combine,
+    const Combine& combine,
     IntegerType key,
     const typename Value::type& value,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& tree) {
@@ -804,9 +927,9 @@ inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> update(
 }
 
 // Maps all entries with non-default values, applying a given function.
-template <typename IntegerType, typename Value>
+template <typename IntegerType, typename Value, typename Mapping>
 inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> map(
-    const MappingFunction<typename Value::type>& f,
+    const Mapping& f,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& tree) {
   if (tree == nullptr) {
     return nullptr;
@@ -866,9 +989,9 @@ erase_all_matching(
 
 // We keep the notations of the paper so as to make the implementation easier
 // to follow.
-template <typename IntegerType, typename Value>
+template <typename IntegerType, typename Value, typename Combine>
 inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> merge(
-    const ptmap_impl::CombiningFunction<typename Value::type>& combine,
+    const Combine& combine,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& s,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& t) {
   if (s == t) {
@@ -954,9 +1077,9 @@ inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> merge(
 }
 
 // Combine :value with the value in :leaf with combine(:leaf, :value).
-template <typename IntegerType, typename Value>
+template <typename IntegerType, typename Value, typename Combine>
 inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> combine_leaf(
-    const ptmap_impl::CombiningFunction<typename Value::type>& combine,
+    const Combine& combine,
     const typename Value::type& value,
     const boost::intrusive_ptr<PatriciaTreeLeaf<IntegerType, Value>>& leaf) {
   auto combined_value = combine(leaf->value(), value);
@@ -970,20 +1093,22 @@ inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> combine_leaf(
   return leaf;
 }
 
-// Create a new leaf with the default value and combine :value into it.
-template <typename IntegerType, typename Value>
+// Combine :value into the default value and create a leaf for the result.
+template <typename IntegerType, typename Value, typename Combine>
 inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> combine_new_leaf(
-    const ptmap_impl::CombiningFunction<typename Value::type>& combine,
+    const Combine& combine,
     IntegerType key,
     const typename Value::type& value) {
-  auto new_leaf = boost::intrusive_ptr<PatriciaTreeLeaf<IntegerType, Value>>(
-      PatriciaTreeLeaf<IntegerType, Value>::make(key, Value::default_value()));
-  return combine_leaf(combine, value, new_leaf);
+  auto combined_value = combine(Value::default_value(), value);
+  if (Value::is_default_value(combined_value)) {
+    return nullptr;
+  }
+  return PatriciaTreeLeaf<IntegerType, Value>::make(key, combined_value);
 }
 
-template <typename IntegerType, typename Value>
+template <typename IntegerType, typename Value, typename Combine>
 inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> intersect(
-    const ptmap_impl::CombiningFunction<typename Value::type>& combine,
+    const Combine& combine,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& s,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& t) {
   if (s == t) {
@@ -1058,9 +1183,9 @@ inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> intersect(
   return nullptr;
 }
 
-template <typename IntegerType, typename Value>
+template <typename IntegerType, typename Value, typename Combine>
 inline boost::intrusive_ptr<PatriciaTree<IntegerType, Value>> diff(
-    const ptmap_impl::CombiningFunction<typename Value::type>& combine,
+    const Combine& combine,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& s,
     const boost::intrusive_ptr<PatriciaTree<IntegerType, Value>>& t) {
   if (s == t) {
@@ -108,8 +108,9 @@ class PatriciaTreeMapAbstractPartition final
   /*
    * This is a no-op if the partition is set to Top.
    */
-  PatriciaTreeMapAbstractPartition& update(
-      const Label& label, std::function<Domain(const Domain&)> operation) {
+  template <typename Operation>
+  PatriciaTreeMapAbstractPartition& update(const Label& label,
+                                           const Operation& operation) {
     if (is_top()) {
       return *this;
     }
@@ -117,7 +118,8 @@ class PatriciaTreeMapAbstractPartition final
     return *this;
   }
 
-  bool map(std::function<Domain(const Domain&)> f) {
+  template <typename Mapping>
+  bool map(const Mapping& f) {
     if (is_top()) {
       return false;
     }
@@ -175,9 +177,9 @@ class PatriciaTreeMapAbstractPartition final
         other, [](const Domain& x, const Domain& y) { return x.narrowing(y); });
   }
 
-  void join_like_operation(
-      const PatriciaTreeMapAbstractPartition& other,
-      std::function<Domain(const Domain&, const Domain&)> operation) {
+  template <typename Operation>
+  void join_like_operation(const PatriciaTreeMapAbstractPartition& other,
+                           const Operation& operation) {
     if (is_top()) {
       return;
     }
@@ -188,9 +190,9 @@ class PatriciaTreeMapAbstractPartition final
     m_map.union_with(operation, other.m_map);
   }
 
-  void meet_like_operation(
-      const PatriciaTreeMapAbstractPartition& other,
-      std::function<Domain(const Domain&, const Domain&)> operation) {
+  template <typename Operation>
+  void meet_like_operation(const PatriciaTreeMapAbstractPartition& other,
+                           const Operation& operation) {
     if (is_top()) {
       *this = other;
       return;
@@ -201,9 +203,10 @@ class PatriciaTreeMapAbstractPartition final
     m_map.intersection_with(operation, other.m_map);
   }
 
+  template <typename Operation>
   void difference_like_operation(
       const PatriciaTreeMapAbstractPartition& other,
-      std::function<Domain(const Domain&, const Domain&)> operation) {
+      const Operation& operation) {
     if (other.is_top()) {
       set_to_bottom();
     } else if (is_top()) {
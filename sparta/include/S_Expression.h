@@ -91,6 +91,8 @@ class s_expr final {
    */
   explicit s_expr(const std::string& s);
 
+  explicit s_expr(std::string&& s);
+
   /*
    * Various constructors for a list. The empty list (nil) can be constructed
    * with `s_expr({})`.
@@ -186,6 +188,8 @@ class s_expr final {
   // Appends an element to a list. This operation is used during parsing.
   void add_element(const s_expr& element);
 
+  void add_element(s_expr&& element);
+
   // By construction, m_component can never be null.
   std::shared_ptr<s_expr_impl::Component> m_component;
 
@@ -258,6 +262,11 @@ class s_expr_istream final {
 
   void skip_white_spaces();
 
+  // Character-level access goes straight to the stream buffer, which avoids
+  // the sentry and state bookkeeping of the istream functions. Reaching the
+  // end of the buffer sets eofbit on the stream, as peek() would.
+  int peek_char();
+
   void set_status(Status status, const std::string& what_arg);
 
   std::stack<s_expr> m_stack;
@@ -429,8 +438,8 @@ class Int32Atom final : public Component {
 
 class StringAtom final : public Component {
  public:
-  explicit StringAtom(const std::string& s)
-      : Component(ComponentKind::StringAtom), m_string(s) {}
+  explicit StringAtom(std::string s)
+      : Component(ComponentKind::StringAtom), m_string(std::move(s)) {}
 
   const std::string& get_string() const { return m_string; }
 
@@ -506,6 +515,8 @@ class List final : public Component {
 
   void add_element(const s_expr& element) { m_list.push_back(element); }
 
+  void add_element(s_expr&& element) { m_list.push_back(std::move(element)); }
+
   bool equals(const std::shared_ptr<Component>& other) const {
     if (this == other.get()) {
       // Since S-expressions can share structure, checking for pointer equality
@@ -658,6 +669,9 @@ inline s_expr::s_expr(int32_t n)
 inline s_expr::s_expr(const std::string& s)
     : m_component(std::make_shared<s_expr_impl::StringAtom>(s)) {}
 
+inline s_expr::s_expr(std::string&& s)
+    : m_component(std::make_shared<s_expr_impl::StringAtom>(std::move(s))) {}
+
 inline s_expr::s_expr(std::initializer_list<s_expr> l)
     : m_component(std::make_shared<s_expr_impl::List>(l.begin(), l.end())) {}
 
@@ -741,6 +755,14 @@ inline void s_expr::add_element(const s_expr& element) {
   list->add_element(element);
 }
 
+inline void s_expr::add_element(s_expr&& element) {
+  RUNTIME_CHECK(m_component->kind() == s_expr_impl::ComponentKind::List,
+                invalid_argument() << argument_name("element")
+                                   << operation_name("s_expr::add_element()"));
+  static_cast<s_expr_impl::List*>(m_component.get())
+      ->add_element(std::move(element));
+}
+
 inline s_expr_istream& s_expr_istream::operator>>(s_expr& expr) {
   for (;;) {
     skip_white_spaces();
@@ -752,11 +774,11 @@ inline s_expr_istream& s_expr_istream::operator>>(s_expr& expr) {
       }
       return *this;
     }
-    char next_char = m_input.peek();
+    char next_char = static_cast<char>(peek_char());
     switch (next_char) {
     case '(': {
       m_stack.emplace();
-      m_input.get();
+      m_input.rdbuf()->sbumpc();
       break;
     }
     case ')': {
@@ -764,18 +786,18 @@ inline s_expr_istream& s_expr_istream::operator>>(s_expr& expr) {
         set_status(Status::Fail, "Extra ')' encountered");
         return *this;
       }
-      m_input.get();
-      s_expr list = m_stack.top();
+      m_input.rdbuf()->sbumpc();
+      s_expr list = std::move(m_stack.top());
       m_stack.pop();
       if (m_stack.empty()) {
-        expr = list;
+        expr = std::move(list);
         return *this;
       }
-      m_stack.top().add_element(list);
+      m_stack.top().add_element(std::move(list));
       break;
     }
     case '#': {
-      m_input.get();
+      m_input.rdbuf()->sbumpc();
       int32_t n;
       m_input >> n;
       if (m_input.fail()) {
@@ -797,12 +819,12 @@ inline s_expr_istream& s_expr_istream::operator>>(s_expr& expr) {
         set_status(Status::Fail, "Error parsing string literal");
         return *this;
       }
-      s_expr atom(s);
+      s_expr atom(std::move(s));
       if (m_stack.empty()) {
-        expr = atom;
+        expr = std::move(atom);
         return *this;
       }
-      m_stack.top().add_element(atom);
+      m_stack.top().add_element(std::move(atom));
       break;
     }
     case ';': {
@@ -818,37 +840,56 @@ inline s_expr_istream& s_expr_istream::operator>>(s_expr& expr) {
         set_status(Status::Fail, out.str());
         return *this;
       }
-      std::ostringstream symbol;
-      while (m_input.good() && s_expr_impl::is_symbol_char(next_char)) {
-        symbol << next_char;
-        m_input.get();
-        next_char = m_input.peek();
+      std::string symbol;
+      auto* buf = m_input.rdbuf();
+      for (;;) {
+        symbol.push_back(next_char);
+        buf->sbumpc();
+        int c = peek_char();
+        if (c == std::char_traits<char>::eof() ||
+            !s_expr_impl::is_symbol_char(static_cast<char>(c))) {
+          break;
+        }
+        next_char = static_cast<char>(c);
       }
-      s_expr atom(symbol.str());
+      s_expr atom(std::move(symbol));
       if (m_stack.empty()) {
-        expr = atom;
+        expr = std::move(atom);
         return *this;
       }
-      m_stack.top().add_element(atom);
+      m_stack.top().add_element(std::move(atom));
     }
     }
   }
 }
 
 inline void s_expr_istream::skip_white_spaces() {
+  if (!m_input.good()) {
+    return;
+  }
+  auto* buf = m_input.rdbuf();
   for (;;) {
-    char c = m_input.peek();
-    if (m_input.good() && std::isspace(c)) {
+    int c = peek_char();
+    if (c != std::char_traits<char>::eof() &&
+        std::isspace(static_cast<unsigned char>(c))) {
       if (c == '\n') {
         ++m_line_number;
       }
-      m_input.get();
+      buf->sbumpc();
     } else {
       return;
     }
   }
 }
 
+inline int s_expr_istream::peek_char() {
+  int c = m_input.rdbuf()->sgetc();
+  if (c == std::char_traits<char>::eof()) {
+    m_input.setstate(std::ios_base::eofbit);
+  }
+  return c;
+}
+
 inline void s_expr_istream::set_status(Status status,
                                        const std::string& what_arg) {
   m_status = status;
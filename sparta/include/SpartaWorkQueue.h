@@ -14,14 +14,24 @@
 #include <cassert>
 #include <chrono>
 #include <condition_variable>
+#include <fstream>
 #include <mutex>
 #include <numeric>
 #include <queue>
 #include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "Arity.h"
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace sparta {
 
 namespace parallel {
@@ -36,22 +46,165 @@ static inline unsigned int default_num_threads() {
 
 } // namespace parallel
 
+/*
+ * The data structure backing the per-worker task queues.
+ */
+enum class WorkQueueDeque {
+  // A mutex-guarded FIFO queue per worker. Idle workers steal one task at a
+  // time.
+  Locked,
+  // A lock-free Chase-Lev deque per worker. The owner pushes and pops at the
+  // bottom, idle workers steal half of a victim's tasks from the top. Only
+  // inputs that fit in a lock-free std::atomic (pointers, integers, ...) can
+  // use it; other inputs silently fall back to Locked.
+  LockFree,
+};
+
+/*
+ * The thread time of the workers of all work queues since the start of the
+ * process, in microseconds. A work queue that runs on N threads for T
+ * microseconds has a capacity of N * T, of which its workers are busy for the
+ * time they spend running tasks. The rest is idle time, e.g. waiting for the
+ * last tasks to finish.
+ */
+struct WorkQueueTimes {
+  uint64_t busy_us{0};
+  uint64_t capacity_us{0};
+};
+
 namespace workqueue_impl {
 
+inline std::atomic<bool>& numa_aware_workers() {
+  static std::atomic<bool> enabled{false};
+  return enabled;
+}
+
+// Parses a sysfs CPU list like "0-3,8,10-11".
+inline std::vector<unsigned int> parse_cpu_list(const std::string& list) {
+  std::vector<unsigned int> cpus;
+  std::istringstream ranges(list);
+  std::string range;
+  while (std::getline(ranges, range, ',')) {
+    if (range.empty()) {
+      continue;
+    }
+    auto dash = range.find('-');
+    try {
+      unsigned int first = std::stoul(range.substr(0, dash));
+      unsigned int last = dash == std::string::npos
+                              ? first
+                              : std::stoul(range.substr(dash + 1));
+      for (unsigned int cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    } catch (const std::exception&) {
+      return {};
+    }
+  }
+  return cpus;
+}
+
+/*
+ * The CPUs of each NUMA node that the process may run on. Empty if there are
+ * fewer than two such nodes, or the topology is unknown.
+ */
+inline std::vector<std::vector<unsigned int>> read_numa_nodes() {
+  std::vector<std::vector<unsigned int>> nodes;
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    return {};
+  }
+  for (unsigned int node = 0;; ++node) {
+    std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) +
+                     "/cpulist");
+    if (!in) {
+      break;
+    }
+    std::string list;
+    std::getline(in, list);
+    std::vector<unsigned int> cpus;
+    for (auto cpu : parse_cpu_list(list)) {
+      if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+        cpus.push_back(cpu);
+      }
+    }
+    if (!cpus.empty()) {
+      nodes.push_back(std::move(cpus));
+    }
+  }
+#endif
+  if (nodes.size() < 2) {
+    nodes.clear();
+  }
+  return nodes;
+}
+
+inline const std::vector<std::vector<unsigned int>>& numa_nodes() {
+  static const auto nodes = read_numa_nodes();
+  return nodes;
+}
+
+// Restricts the calling thread to the given CPUs. This is best effort.
+inline void pin_current_thread(const std::vector<unsigned int>& cpus) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+  (void)cpus;
+#endif
+}
+
+// Workers are spread over the nodes in contiguous blocks.
+inline unsigned int node_of_worker(unsigned int worker,
+                                   unsigned int num_workers,
+                                   unsigned int num_nodes) {
+  return static_cast<unsigned int>(static_cast<uint64_t>(worker) * num_nodes /
+                                   num_workers);
+}
+
+struct AtomicWorkQueueTimes {
+  std::atomic<uint64_t> busy_us{0};
+  std::atomic<uint64_t> capacity_us{0};
+};
+
+inline AtomicWorkQueueTimes& workqueue_times() {
+  static AtomicWorkQueueTimes times;
+  return times;
+}
+
+inline uint64_t to_micros(std::chrono::steady_clock::duration d) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
 /**
  * Creates a random ordering of which threads to visit.  This prevents threads
  * from being prematurely emptied (if everyone targets thread 0, for example)
  *
  * Each thread should empty its own queue first, so we explicitly set the
- * thread's index as the first element of the list.
+ * thread's index as the first element of the list. With `num_nodes` NUMA
+ * nodes, the threads of the same node come next.
  */
-inline std::vector<unsigned int> create_permutation(unsigned int num,
-                                                    unsigned int thread_idx) {
+inline std::vector<unsigned int> create_permutation(
+    unsigned int num, unsigned int thread_idx, unsigned int num_nodes = 1) {
   std::vector<unsigned int> attempts(num);
   std::iota(attempts.begin(), attempts.end(), 0);
   auto seed = std::chrono::system_clock::now().time_since_epoch().count();
   std::shuffle(
       attempts.begin(), attempts.end(), std::default_random_engine(seed));
+  if (num_nodes > 1) {
+    // Threads on the same NUMA node come before the others.
+    auto node = node_of_worker(thread_idx, num, num_nodes);
+    std::stable_partition(
+        attempts.begin(), attempts.end(), [&](unsigned int idx) {
+          return node_of_worker(idx, num, num_nodes) == node;
+        });
+  }
   std::iter_swap(attempts.begin(),
                  std::find(attempts.begin(), attempts.end(), thread_idx));
   return attempts;
@@ -91,7 +244,11 @@ class Semaphore {
 };
 
 struct StateCounters {
+  // Number of non-empty Locked queues.
   std::atomic_uint num_non_empty;
+  // Number of tasks sitting in LockFree deques. Tracking non-empty deques
+  // precisely would require a lock, so we count the tasks instead.
+  std::atomic_size_t num_queued;
   std::atomic_uint num_running;
   const unsigned int num_all;
   // Mutexes aren't move-able.
@@ -99,26 +256,208 @@ struct StateCounters {
 
   explicit StateCounters(unsigned int num)
       : num_non_empty(0),
+        num_queued(0),
         num_running(0),
         num_all(num),
         waiter(new Semaphore(0)) {}
   StateCounters(StateCounters&& other)
       : num_non_empty(other.num_non_empty.load()),
+        num_queued(other.num_queued.load()),
         num_running(other.num_running.load()),
         num_all(other.num_all),
         waiter(std::move(other.waiter)) {}
+
+  bool has_pending_tasks() const { return num_non_empty > 0 || num_queued > 0; }
+};
+
+template <typename T, typename = void>
+struct IsLockFreeAtomic : std::false_type {};
+
+template <typename T>
+struct IsLockFreeAtomic<
+    T,
+    typename std::enable_if<std::is_trivially_copyable<T>::value>::type>
+    : std::integral_constant<bool, std::atomic<T>::is_always_lock_free> {};
+
+/*
+ * A work-stealing deque, following "Correct and Efficient Work-Stealing for
+ * Weak Memory Models" (Le, Pop, Cohen, Zappa Nardelli, PPoPP'13).
+ *
+ * Only the owning thread may call push() and pop(); any thread may call
+ * steal(). The buffer grows on demand. Retired buffers may still be read by
+ * concurrent thieves, so they are kept alive until the deque is destroyed; as
+ * the buffer doubles each time, this at most doubles the memory footprint.
+ */
+template <typename T>
+class ChaseLevDeque final {
+  static_assert(IsLockFreeAtomic<T>::value,
+                "ChaseLevDeque requires a lock-free atomic element type");
+
+  class Buffer {
+   public:
+    explicit Buffer(size_t capacity)
+        : m_mask(capacity - 1), m_slots(new std::atomic<T>[capacity]) {
+      assert((capacity & m_mask) == 0);
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+    T get(int64_t i) const {
+      return m_slots[i & m_mask].load(std::memory_order_relaxed);
+    }
+
+    void put(int64_t i, T x) {
+      m_slots[i & m_mask].store(x, std::memory_order_relaxed);
+    }
+
+   private:
+    const size_t m_mask;
+    std::unique_ptr<std::atomic<T>[]> m_slots;
+  };
+
+ public:
+  enum class StealResult { Success, Empty, Abort };
+
+  explicit ChaseLevDeque(size_t initial_capacity = 64)
+      : m_top(0), m_bottom(0) {
+    m_buffers.emplace_back(std::make_unique<Buffer>(initial_capacity));
+    m_buffer.store(m_buffers.back().get(), std::memory_order_relaxed);
+  }
+
+  ChaseLevDeque(const ChaseLevDeque&) = delete;
+  ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+  // Owner only.
+  void push(T x) {
+    int64_t b = m_bottom.load(std::memory_order_relaxed);
+    int64_t t = m_top.load(std::memory_order_acquire);
+    Buffer* buf = m_buffer.load(std::memory_order_relaxed);
+    if (b - t > static_cast<int64_t>(buf->capacity()) - 1) {
+      buf = grow(buf, t, b);
+    }
+    buf->put(b, x);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(b + 1, std::memory_order_relaxed);
+  }
+
+  // Owner only. Pops the most recently pushed task.
+  boost::optional<T> pop() {
+    int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+    Buffer* buf = m_buffer.load(std::memory_order_relaxed);
+    m_bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = m_top.load(std::memory_order_relaxed);
+    if (t > b) {
+      // Empty.
+      m_bottom.store(b + 1, std::memory_order_relaxed);
+      return boost::none;
+    }
+    T x = buf->get(b);
+    if (t == b) {
+      // Last element, race against thieves.
+      bool won = m_top.compare_exchange_strong(t,
+                                               t + 1,
+                                               std::memory_order_seq_cst,
+                                               std::memory_order_relaxed);
+      m_bottom.store(b + 1, std::memory_order_relaxed);
+      if (!won) {
+        return boost::none;
+      }
+    }
+    return x;
+  }
+
+  // Any thread. Steals the oldest task.
+  StealResult steal(T* out) {
+    int64_t t = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = m_bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+      return StealResult::Empty;
+    }
+    Buffer* buf = m_buffer.load(std::memory_order_acquire);
+    T x = buf->get(t);
+    if (!m_top.compare_exchange_strong(t,
+                                       t + 1,
+                                       std::memory_order_seq_cst,
+                                       std::memory_order_relaxed)) {
+      return StealResult::Abort;
+    }
+    *out = x;
+    return StealResult::Success;
+  }
+
+  // Approximate when other threads are operating on the deque.
+  size_t size() const {
+    int64_t b = m_bottom.load(std::memory_order_relaxed);
+    int64_t t = m_top.load(std::memory_order_relaxed);
+    return b > t ? static_cast<size_t>(b - t) : 0;
+  }
+
+  bool empty() const { return size() == 0; }
+
+ private:
+  Buffer* grow(Buffer* old, int64_t t, int64_t b) {
+    auto bigger = std::make_unique<Buffer>(old->capacity() * 2);
+    for (int64_t i = t; i < b; ++i) {
+      bigger->put(i, old->get(i));
+    }
+    Buffer* raw = bigger.get();
+    m_buffers.emplace_back(std::move(bigger));
+    m_buffer.store(raw, std::memory_order_release);
+    return raw;
+  }
+
+  std::atomic<int64_t> m_top;
+  std::atomic<int64_t> m_bottom;
+  std::atomic<Buffer*> m_buffer;
+  // Owns the current buffer and all retired ones. Only touched by the owner.
+  std::vector<std::unique_ptr<Buffer>> m_buffers;
 };
 
 } // namespace workqueue_impl
 
+/*
+ * Whether work queues started from now on pin each worker to the CPUs of one
+ * NUMA node, and have idle workers steal from workers on the same node before
+ * they steal from the others. Workers are spread evenly over the nodes. This
+ * has no effect on hosts with a single node, or outside of Linux.
+ *
+ * Pinned threads keep their memory local when the allocator hands out memory
+ * per CPU; with jemalloc, this is `percpu_arena:percpu` in MALLOC_CONF.
+ */
+inline void set_numa_aware_workers(bool enabled) {
+  workqueue_impl::numa_aware_workers().store(enabled,
+                                             std::memory_order_relaxed);
+}
+
+inline bool numa_aware_workers() {
+  return workqueue_impl::numa_aware_workers().load(std::memory_order_relaxed);
+}
+
+inline WorkQueueTimes get_workqueue_times() {
+  auto& times = workqueue_impl::workqueue_times();
+  WorkQueueTimes result;
+  result.busy_us = times.busy_us.load(std::memory_order_relaxed);
+  result.capacity_us = times.capacity_us.load(std::memory_order_relaxed);
+  return result;
+}
+
 template <class Input, typename Executor>
 class SpartaWorkQueue;
 
 template <class Input>
 class SpartaWorkerState final {
  public:
-  SpartaWorkerState(size_t id, workqueue_impl::StateCounters* sc, bool can_push)
-      : m_id(id), m_state_counters(sc), m_can_push_task(can_push) {}
+  SpartaWorkerState(size_t id,
+                    workqueue_impl::StateCounters* sc,
+                    bool can_push,
+                    WorkQueueDeque deque = WorkQueueDeque::Locked)
+      : m_id(id), m_state_counters(sc), m_can_push_task(can_push) {
+    if (supports_lock_free && deque == WorkQueueDeque::LockFree) {
+      m_deque = std::make_unique<LockFreeDeque>();
+    }
+  }
 
   /*
    * Add more items to the queue of the currently-running worker. When a
@@ -127,6 +466,14 @@ class SpartaWorkerState final {
    */
   void push_task(Input task) {
     assert(m_can_push_task);
+    if (m_deque) {
+      ++m_state_counters->num_queued;
+      if (m_state_counters->num_running < m_state_counters->num_all) {
+        m_state_counters->waiter->give(1u); // May consider waking all.
+      }
+      deque_push(std::move(task));
+      return;
+    }
     std::lock_guard<std::mutex> guard(m_queue_mtx);
     if (m_queue.empty()) {
       ++m_state_counters->num_non_empty;
@@ -150,6 +497,70 @@ class SpartaWorkerState final {
   };
 
  private:
+  static constexpr bool supports_lock_free =
+      workqueue_impl::IsLockFreeAtomic<Input>::value;
+  // Inputs that cannot be stored in the lock-free deque never create one, so
+  // its element type does not matter.
+  using LockFreeDeque = workqueue_impl::ChaseLevDeque<
+      typename std::conditional<supports_lock_free, Input, void*>::type>;
+
+  bool is_lock_free() const { return m_deque != nullptr; }
+
+  bool queue_empty() const {
+    return m_deque ? m_deque->empty() : m_queue.empty();
+  }
+
+  // Must only be called by the owner, or before the threads are started.
+  void deque_push(Input task) {
+    if constexpr (supports_lock_free) {
+      m_deque->push(task);
+    }
+  }
+
+  // Must only be called by the owner.
+  boost::optional<Input> deque_pop() {
+    if constexpr (supports_lock_free) {
+      return m_deque->pop();
+    }
+    return boost::none;
+  }
+
+  /*
+   * Steals about half of the tasks of this worker's deque on behalf of
+   * `thief`. The first stolen task is returned, the others are moved to the
+   * thief's own deque where it will find them without further stealing.
+   */
+  boost::optional<Input> steal_half(SpartaWorkerState<Input>* thief) {
+    if constexpr (supports_lock_free) {
+      using StealResult = typename LockFreeDeque::StealResult;
+      boost::optional<Input> first;
+      size_t batch = std::max<size_t>(1, m_deque->size() / 2);
+      for (size_t i = 0; i < batch;) {
+        Input task;
+        auto res = m_deque->steal(&task);
+        if (res == StealResult::Empty) {
+          break;
+        }
+        if (res == StealResult::Abort) {
+          // Lost a race against the owner or another thief. Only retry if we
+          // have nothing to show for yet.
+          if (first) {
+            break;
+          }
+          continue;
+        }
+        if (!first) {
+          first = task;
+        } else {
+          thief->deque_push(task);
+        }
+        ++i;
+      }
+      return first;
+    }
+    return boost::none;
+  }
+
   boost::optional<Input> pop_task(SpartaWorkerState<Input>* other) {
     std::lock_guard<std::mutex> guard(m_queue_mtx);
     if (!m_queue.empty()) {
@@ -169,6 +580,8 @@ class SpartaWorkerState final {
   bool m_running{false};
   std::queue<Input> m_queue;
   std::mutex m_queue_mtx;
+  // Non-null iff this worker uses WorkQueueDeque::LockFree.
+  std::unique_ptr<LockFreeDeque> m_deque;
   workqueue_impl::StateCounters* m_state_counters;
   const bool m_can_push_task{false};
 
@@ -192,6 +605,19 @@ class SpartaWorkQueue {
     m_executor(state, task);
   }
 
+  void enqueue(Input task, size_t worker_id) {
+    assert(worker_id < m_states.size());
+    auto& state = m_states[worker_id];
+    if (state->is_lock_free()) {
+      state->deque_push(std::move(task));
+    } else {
+      state->m_queue.push(task);
+    }
+  }
+
+  boost::optional<Input> find_task(SpartaWorkerState<Input>* state,
+                                   const std::vector<unsigned int>& attempts);
+
  public:
   SpartaWorkQueue(Executor,
                   unsigned int num_threads = parallel::default_num_threads(),
@@ -202,7 +628,8 @@ class SpartaWorkQueue {
                   // * When this flag is false, threads can
                   //   exit as soon as there is no more work (to avoid
                   //   preempting a thread that has useful work)
-                  bool push_tasks_while_running = false);
+                  bool push_tasks_while_running = false,
+                  WorkQueueDeque deque = WorkQueueDeque::Locked);
 
   // copies are not allowed
   SpartaWorkQueue(const SpartaWorkQueue&) = delete;
@@ -226,7 +653,8 @@ class SpartaWorkQueue {
 template <class Input, typename Executor>
 SpartaWorkQueue<Input, Executor>::SpartaWorkQueue(Executor executor,
                                                   unsigned int num_threads,
-                                                  bool push_tasks_while_running)
+                                                  bool push_tasks_while_running,
+                                                  WorkQueueDeque deque)
     : m_executor(executor),
       m_num_threads(num_threads),
       m_state_counters(num_threads),
@@ -234,21 +662,61 @@ SpartaWorkQueue<Input, Executor>::SpartaWorkQueue(Executor executor,
   assert(num_threads >= 1);
   for (unsigned int i = 0; i < m_num_threads; ++i) {
     m_states.emplace_back(std::make_unique<SpartaWorkerState<Input>>(
-        i, &m_state_counters, m_can_push_task));
+        i, &m_state_counters, m_can_push_task, deque));
   }
 }
 
 template <class Input, typename Executor>
 void SpartaWorkQueue<Input, Executor>::add_item(Input task) {
   m_insert_idx = (m_insert_idx + 1) % m_num_threads;
-  assert(m_insert_idx < m_states.size());
-  m_states[m_insert_idx]->m_queue.push(task);
+  enqueue(std::move(task), m_insert_idx);
 }
 
 template <class Input, typename Executor>
 void SpartaWorkQueue<Input, Executor>::add_item(Input task, size_t worker_id) {
-  assert(worker_id < m_states.size());
-  m_states[worker_id]->m_queue.push(task);
+  enqueue(std::move(task), worker_id);
+}
+
+/*
+ * Looks for a task for `state`, first in its own queue and then in the queues
+ * of the other workers, in the order given by `attempts`. If a task is found,
+ * `state` is marked as running.
+ */
+template <class Input, typename Executor>
+boost::optional<Input> SpartaWorkQueue<Input, Executor>::find_task(
+    SpartaWorkerState<Input>* state,
+    const std::vector<unsigned int>& attempts) {
+  if (!state->is_lock_free()) {
+    for (auto idx : attempts) {
+      auto task = m_states[idx]->pop_task(state);
+      if (task) {
+        return task;
+      }
+    }
+    return boost::none;
+  }
+
+  auto task = state->deque_pop();
+  if (!task) {
+    for (auto idx : attempts) {
+      auto other_state = m_states[idx].get();
+      if (other_state == state) {
+        continue;
+      }
+      task = other_state->steal_half(state);
+      if (task) {
+        break;
+      }
+    }
+  }
+  if (task) {
+    // Mark as running before the task stops being counted as queued, so that
+    // no other worker can observe that all work is done.
+    state->set_running(true);
+    assert(m_state_counters.num_queued > 0);
+    --m_state_counters.num_queued;
+  }
+  return task;
 }
 
 /*
@@ -258,23 +726,38 @@ void SpartaWorkQueue<Input, Executor>::add_item(Input task, size_t worker_id) {
 template <class Input, typename Executor>
 void SpartaWorkQueue<Input, Executor>::run_all() {
   m_state_counters.num_non_empty = 0;
+  m_state_counters.num_queued = 0;
   m_state_counters.num_running = 0;
   m_state_counters.waiter->take_all();
+  using Clock = std::chrono::steady_clock;
+  auto begin = Clock::now();
+  const auto& nodes = workqueue_impl::numa_nodes();
+  unsigned int num_nodes =
+      numa_aware_workers() && m_num_threads > 1 && !nodes.empty()
+          ? nodes.size()
+          : 1;
   auto worker = [&](SpartaWorkerState<Input>* state, size_t state_idx) {
+    if (num_nodes > 1) {
+      workqueue_impl::pin_current_thread(nodes[workqueue_impl::node_of_worker(
+          state_idx, m_num_threads, num_nodes)]);
+    }
     auto attempts =
-        workqueue_impl::create_permutation(m_num_threads, state_idx);
-    while (true) {
-      auto have_task = false;
-      for (auto idx : attempts) {
-        auto other_state = m_states[idx].get();
-        auto task = other_state->pop_task(state);
-        if (task) {
-          have_task = true;
-          consume(state, *task);
-          break;
-        }
+        workqueue_impl::create_permutation(m_num_threads, state_idx, num_nodes);
+    Clock::duration busy{0};
+    // Accounts the busy time once, when the worker quits.
+    struct BusyTime {
+      Clock::duration* busy;
+      ~BusyTime() {
+        workqueue_impl::workqueue_times().busy_us.fetch_add(
+            workqueue_impl::to_micros(*busy), std::memory_order_relaxed);
       }
-      if (have_task) {
+    } busy_time{&busy};
+    while (true) {
+      auto task = find_task(state, attempts);
+      if (task) {
+        auto task_begin = Clock::now();
+        consume(state, *task);
+        busy += Clock::now() - task_begin;
         continue;
       }
 
@@ -288,7 +771,7 @@ void SpartaWorkQueue<Input, Executor>::run_all() {
       // Let the thread quit if all the threads are not running and there
       // is no task in any queue.
       if (m_state_counters.num_running == 0 &&
-          m_state_counters.num_non_empty == 0) {
+          !m_state_counters.has_pending_tasks()) {
         // Wake up everyone who might be waiting, so they can quit.
         m_state_counters.waiter->give(m_state_counters.num_all);
         return;
@@ -299,7 +782,10 @@ void SpartaWorkQueue<Input, Executor>::run_all() {
   };
 
   for (size_t i = 0; i < m_num_threads; ++i) {
-    if (!m_states[i]->m_queue.empty()) {
+    auto& state = m_states[i];
+    if (state->is_lock_free()) {
+      m_state_counters.num_queued += state->m_deque->size();
+    } else if (!state->m_queue.empty()) {
       ++m_state_counters.num_non_empty;
     }
   }
@@ -316,9 +802,12 @@ void SpartaWorkQueue<Input, Executor>::run_all() {
   for (auto& thread : all_threads) {
     thread.join();
   }
+  workqueue_impl::workqueue_times().capacity_us.fetch_add(
+      workqueue_impl::to_micros(Clock::now() - begin) * m_num_threads,
+      std::memory_order_relaxed);
 
   for (size_t i = 0; i < m_num_threads; ++i) {
-    assert(m_states[i]->m_queue.empty());
+    assert(m_states[i]->queue_empty());
   }
 }
 
@@ -343,12 +832,14 @@ template <class Input,
 SpartaWorkQueue<Input, workqueue_impl::NoStateWorkQueueHelper<Input, Fn>>
 work_queue(const Fn& fn,
            unsigned int num_threads = parallel::default_num_threads(),
-           bool push_tasks_while_running = false) {
+           bool push_tasks_while_running = false,
+           WorkQueueDeque deque = WorkQueueDeque::Locked) {
   return SpartaWorkQueue<Input,
                          workqueue_impl::NoStateWorkQueueHelper<Input, Fn>>(
       workqueue_impl::NoStateWorkQueueHelper<Input, Fn>{fn},
       num_threads,
-      push_tasks_while_running);
+      push_tasks_while_running,
+      deque);
 }
 template <class Input,
           typename Fn,
@@ -356,12 +847,14 @@ template <class Input,
 SpartaWorkQueue<Input, workqueue_impl::WithStateWorkQueueHelper<Input, Fn>>
 work_queue(const Fn& fn,
            unsigned int num_threads = parallel::default_num_threads(),
-           bool push_tasks_while_running = false) {
+           bool push_tasks_while_running = false,
+           WorkQueueDeque deque = WorkQueueDeque::Locked) {
   return SpartaWorkQueue<Input,
                          workqueue_impl::WithStateWorkQueueHelper<Input, Fn>>(
       workqueue_impl::WithStateWorkQueueHelper<Input, Fn>{fn},
       num_threads,
-      push_tasks_while_running);
+      push_tasks_while_running,
+      deque);
 }
 
 } // namespace sparta
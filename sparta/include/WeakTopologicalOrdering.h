@@ -8,13 +8,16 @@
 #pragma once
 
 #include <cstddef>
+#include <deque>
 #include <functional>
 #include <future>
 #include <iterator>
 #include <limits>
 #include <ostream>
 #include <stack>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "Exceptions.h"
@@ -247,6 +250,12 @@ class WeakTopologicalOrdering final {
 
 namespace wto_impl {
 
+/*
+ * Bourdoncle's algorithm is recursive, with a depth that can be as large as
+ * the number of nodes. In order not to overflow the stack on huge graphs, we
+ * run it on an explicit stack of frames instead. A frame stands for one call
+ * of either `visit` or `component` in the paper.
+ */
 template <typename NodeId, typename NodeHash, typename SuccFn>
 class WtoBuilder final {
  public:
@@ -261,57 +270,126 @@ class WtoBuilder final {
     visit(root, &partition);
   }
 
+ private:
+  using Successors = std::decay_t<decltype(
+      std::declval<SuccFn&>()(std::declval<const NodeId&>()))>;
+  using SuccessorIterator =
+      decltype(std::begin(std::declval<Successors&>()));
+
+  struct Frame {
+    Frame(const NodeId& vertex, Successors successors, int32_t* partition)
+        : vertex(vertex),
+          successors(std::move(successors)),
+          current(std::begin(this->successors)),
+          partition(partition) {}
+
+    NodeId vertex;
+    Successors successors;
+    SuccessorIterator current;
+    // Where the enclosing call keeps track of the last component it created.
+    int32_t* partition;
+    // Whether we are done visiting the successors and are building the
+    // component that `vertex` is the head of.
+    bool in_component{false};
+    int32_t component_partition{-1};
+    uint32_t head{0};
+    bool loop{false};
+  };
+
   // We keep the notations used by Bourdoncle in the paper to describe the
   // algorithm.
 
-  uint32_t visit(const NodeId& vertex, int32_t* partition) {
-    m_stack.push(vertex);
-    uint32_t head = set_dfn(vertex, ++m_num);
-    bool loop = false;
-    for (const NodeId& succ : m_successors(vertex)) {
-      uint32_t succ_dfn = get_dfn(succ);
-      uint32_t min;
-      if (succ_dfn == 0) {
-        min = visit(succ, partition);
-      } else {
-        min = succ_dfn;
-      };
-      if (min <= head) {
-        head = min;
-        loop = true;
+  uint32_t visit(const NodeId& root, int32_t* partition) {
+    // Frames are never moved, since the successor iterators and partitions
+    // they hold point into one another.
+    std::deque<Frame> frames;
+    push_visit(root, partition, &frames);
+    // The value returned by the last frame that completed.
+    uint32_t result = 0;
+    bool returned = false;
+    while (true) {
+      Frame& frame = frames.back();
+      if (returned) {
+        returned = false;
+        if (!frame.in_component) {
+          update_head(result, &frame);
+        }
+        ++frame.current;
       }
-    }
-    if (head == get_dfn(vertex)) {
-      // We encode the special value +oo used in the paper with UINT32_MAX.
-      set_dfn(vertex, std::numeric_limits<uint32_t>::max());
-      NodeId element = m_stack.top();
-      m_stack.pop();
-      if (loop) {
-        // Nodes are required to be comparable using `operator==()`. We don't
-        // assume `operator!=()` to be defined on nodes.
-        while (!(element == vertex)) {
-          set_dfn(element, 0);
-          element = m_stack.top();
-          m_stack.pop();
+      // Find the next successor that has not been visited yet.
+      bool call = false;
+      for (; frame.current != std::end(frame.successors); ++frame.current) {
+        uint32_t succ_dfn = get_dfn(*frame.current);
+        if (succ_dfn == 0) {
+          call = true;
+          break;
+        }
+        if (!frame.in_component) {
+          update_head(succ_dfn, &frame);
+        }
+      }
+      if (call) {
+        int32_t* succ_partition = frame.in_component
+                                      ? &frame.component_partition
+                                      : frame.partition;
+        push_visit(*frame.current, succ_partition, &frames);
+        continue;
+      }
+      if (!frame.in_component && frame.head == get_dfn(frame.vertex)) {
+        // We encode the special value +oo used in the paper with UINT32_MAX.
+        set_dfn(frame.vertex, std::numeric_limits<uint32_t>::max());
+        NodeId element = m_stack.top();
+        m_stack.pop();
+        if (frame.loop) {
+          // Nodes are required to be comparable using `operator==()`. We
+          // don't assume `operator!=()` to be defined on nodes.
+          while (!(element == frame.vertex)) {
+            set_dfn(element, 0);
+            element = m_stack.top();
+            m_stack.pop();
+          }
+          // Visit the successors again to build the component.
+          frame.in_component = true;
+          frame.component_partition = *frame.partition;
+          frame.current = std::begin(frame.successors);
+          continue;
         }
-        push_component(vertex, *partition);
+        push_component(frame);
+      } else if (frame.in_component) {
+        push_component(frame);
+      }
+      result = frame.head;
+      frames.pop_back();
+      if (frames.empty()) {
+        return result;
       }
-      auto kind = loop ? WtoComponent<NodeId>::Kind::Scc
-                       : WtoComponent<NodeId>::Kind::Vertex;
-      m_wto_space->emplace_back(vertex, kind, m_free_position, *partition);
-      *partition = m_free_position++;
+      returned = true;
     }
-    return head;
   }
 
-  void push_component(const NodeId& vertex, int32_t partition) {
-    for (const NodeId& succ : m_successors(vertex)) {
-      if (get_dfn(succ) == 0) {
-        visit(succ, &partition);
-      }
+  void push_visit(const NodeId& vertex,
+                  int32_t* partition,
+                  std::deque<Frame>* frames) {
+    m_stack.push(vertex);
+    auto& frame = frames->emplace_back(vertex, m_successors(vertex), partition);
+    frame.head = set_dfn(vertex, ++m_num);
+  }
+
+  static void update_head(uint32_t min, Frame* frame) {
+    if (min <= frame->head) {
+      frame->head = min;
+      frame->loop = true;
     }
   }
 
+  void push_component(const Frame& frame) {
+    auto kind = frame.loop ? WtoComponent<NodeId>::Kind::Scc
+                           : WtoComponent<NodeId>::Kind::Vertex;
+    m_wto_space->emplace_back(
+        frame.vertex, kind, m_free_position, *frame.partition);
+    *frame.partition = m_free_position++;
+  }
+
   uint32_t get_dfn(const NodeId& node) {
     auto it = m_dfn.find(node);
     if (it != m_dfn.end()) {
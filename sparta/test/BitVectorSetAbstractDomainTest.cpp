@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "BitVectorSetAbstractDomain.h"
+
+#include <cstdint>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace sparta;
+
+using Domain = BitVectorSetAbstractDomain<uint16_t>;
+using HeapDomain = BitVectorSetAbstractDomain<uint16_t, 0>;
+
+TEST(BitVectorSetAbstractDomainTest, latticeOperations) {
+  Domain e1(16);
+  Domain e2(16);
+  Domain e3(16);
+  e1.add(1);
+  e2.add({1, 2, 3});
+  e3.add({2, 3, 4});
+  EXPECT_THAT(e1.elements(), ::testing::ElementsAre(1));
+  EXPECT_THAT(e2.elements(), ::testing::ElementsAre(1, 2, 3));
+  EXPECT_THAT(e3.elements(), ::testing::ElementsAre(2, 3, 4));
+  e3.add(4);
+  EXPECT_THAT(e3.elements(), ::testing::ElementsAre(2, 3, 4));
+  EXPECT_EQ(e3.size(), 3);
+
+  std::ostringstream out;
+  out << e2;
+  EXPECT_EQ("[#3]{1, 2, 3}", out.str());
+
+  EXPECT_TRUE(Domain::bottom().leq(Domain::top()));
+  EXPECT_FALSE(Domain::top().leq(Domain::bottom()));
+  EXPECT_FALSE(e2.is_top());
+  EXPECT_FALSE(e2.is_bottom());
+
+  Domain e4(16);
+  e4.add({3, 2, 1});
+  EXPECT_TRUE(e1.leq(e2));
+  EXPECT_FALSE(e1.leq(e3));
+  EXPECT_TRUE(e2.equals(e4));
+  EXPECT_FALSE(e2.equals(e3));
+
+  EXPECT_THAT(e2.join(e3).elements(), ::testing::ElementsAre(1, 2, 3, 4));
+  EXPECT_TRUE(e1.join(e2).equals(e2));
+  EXPECT_TRUE(e2.join(Domain::bottom()).equals(e2));
+  EXPECT_TRUE(e2.join(Domain::top()).is_top());
+  EXPECT_TRUE(e1.widening(e2).equals(e2));
+
+  EXPECT_THAT(e2.meet(e3).elements(), ::testing::ElementsAre(2, 3));
+  EXPECT_TRUE(e1.meet(e2).equals(e1));
+  EXPECT_TRUE(e2.meet(Domain::bottom()).is_bottom());
+  EXPECT_TRUE(e2.meet(Domain::top()).equals(e2));
+  EXPECT_FALSE(e1.meet(e3).is_bottom());
+  EXPECT_TRUE(e1.meet(e3).elements().empty());
+  EXPECT_TRUE(e1.narrowing(e2).equals(e1));
+
+  EXPECT_TRUE(e2.contains(1));
+  EXPECT_FALSE(e3.contains(1));
+  EXPECT_FALSE(e3.contains(100));
+
+  // Making sure no side effect happened.
+  EXPECT_THAT(e1.elements(), ::testing::ElementsAre(1));
+  EXPECT_THAT(e2.elements(), ::testing::ElementsAre(1, 2, 3));
+  EXPECT_THAT(e3.elements(), ::testing::ElementsAre(2, 3, 4));
+}
+
+TEST(BitVectorSetAbstractDomainTest, destructiveOperations) {
+  Domain e1(16);
+  Domain e2(16);
+  e2.add({1, 2, 3});
+
+  e1.add({1, 2, 16, 17});
+  EXPECT_THAT(e1.elements(), ::testing::ElementsAre(1, 2));
+  e1.add(3);
+  EXPECT_TRUE(e1.equals(e2));
+  e1.remove({2, 4, 17});
+  EXPECT_THAT(e1.elements(), ::testing::ElementsAre(1, 3));
+  e1.remove({1, 3});
+  EXPECT_TRUE(e1.elements().empty());
+
+  e1.join_with(e2);
+  EXPECT_TRUE(e1.equals(e2));
+  e1.join_with(Domain::top());
+  EXPECT_TRUE(e1.is_top());
+
+  e1 = Domain(16);
+  e1.add({1, 5});
+  e1.meet_with(e2);
+  EXPECT_THAT(e1.elements(), ::testing::ElementsAre(1));
+  e1.meet_with(Domain::bottom());
+  EXPECT_TRUE(e1.is_bottom());
+
+  e1 = Domain(16);
+  e1.add({1, 2, 3});
+  Domain e3(16);
+  e3.add({2, 4});
+  e1.difference_with(e3);
+  EXPECT_THAT(e1.elements(), ::testing::ElementsAre(1, 3));
+  e1.difference_with(Domain::bottom());
+  EXPECT_THAT(e1.elements(), ::testing::ElementsAre(1, 3));
+  e1.difference_with(Domain::top());
+  EXPECT_TRUE(e1.is_bottom());
+}
+
+template <typename D>
+void check_large_universe() {
+  D e1(200);
+  D e2(200);
+  e1.add({0, 63, 64, 130, 199, 200});
+  e2.add({63, 130, 150});
+  EXPECT_THAT(e1.elements(), ::testing::ElementsAre(0, 63, 64, 130, 199));
+  EXPECT_EQ(e1.size(), 5);
+  EXPECT_THAT(e1.join(e2).elements(),
+              ::testing::ElementsAre(0, 63, 64, 130, 150, 199));
+  EXPECT_THAT(e1.meet(e2).elements(), ::testing::ElementsAre(63, 130));
+  EXPECT_TRUE(e1.meet(e2).leq(e1));
+  EXPECT_FALSE(e1.leq(e2));
+
+  D e3 = e1;
+  e3.remove(199);
+  EXPECT_TRUE(e3.leq(e1));
+  EXPECT_FALSE(e3.equals(e1));
+  // The copy does not share the bit vector.
+  EXPECT_TRUE(e1.contains(199));
+}
+
+TEST(BitVectorSetAbstractDomainTest, largeUniverses) {
+  check_large_universe<Domain>();
+  check_large_universe<HeapDomain>();
+}
+
+TEST(BitVectorSetAbstractDomainTest, differentUniverses) {
+  Domain small(10);
+  Domain large(100);
+  small.add({1, 2});
+  large.add({2, 90});
+
+  // The join grows the universe, out of the inline storage.
+  auto joined = small.join(large);
+  EXPECT_THAT(joined.elements(), ::testing::ElementsAre(1, 2, 90));
+  joined.add(99);
+  EXPECT_TRUE(joined.contains(99));
+
+  EXPECT_THAT(large.meet(small).elements(), ::testing::ElementsAre(2));
+  auto difference = large;
+  difference.difference_with(small);
+  EXPECT_THAT(difference.elements(), ::testing::ElementsAre(90));
+  EXPECT_FALSE(large.leq(small));
+  EXPECT_TRUE(small.leq(joined));
+
+  large.remove(90);
+  small.remove(1);
+  EXPECT_TRUE(small.equals(large));
+  EXPECT_TRUE(large.equals(small));
+}
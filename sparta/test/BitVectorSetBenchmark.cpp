@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "BitVectorSetAbstractDomain.h"
+
+#include <chrono>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "PatriciaTreeSetAbstractDomain.h"
+
+using namespace sparta;
+
+/*
+ * Compares the lattice operations of bit vector and Patricia tree sets over
+ * universes the size of the registers of a method, as in a liveness or
+ * reaching definitions analysis.
+ */
+
+namespace {
+
+using BitVectorDomain = BitVectorSetAbstractDomain<uint32_t>;
+using PatriciaTreeDomain = PatriciaTreeSetAbstractDomain<uint32_t>;
+
+constexpr size_t kSets = 1000;
+constexpr size_t kRounds = 5;
+
+// Sets that each hold about half of the universe.
+template <typename Domain>
+std::vector<Domain> make_sets(uint32_t universe, const Domain& empty) {
+  std::mt19937 gen(universe);
+  std::vector<Domain> sets(kSets, empty);
+  for (auto& set : sets) {
+    for (uint32_t i = 0; i < universe; ++i) {
+      if (gen() % 2 == 0) {
+        set.add(i);
+      }
+    }
+  }
+  return sets;
+}
+
+// Runs joins, meets and comparisons of neighbouring sets and returns the time
+// they took, along with a checksum of their results.
+template <typename Domain>
+double time_operations(const std::vector<Domain>& sets, size_t* checksum) {
+  *checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t round = 0; round < kRounds; ++round) {
+    for (size_t i = 0; i + 1 < sets.size(); ++i) {
+      const auto& x = sets[i];
+      const auto& y = sets[i + 1];
+      Domain joined = x.join(y);
+      Domain met = x.meet(y);
+      *checksum += joined.size() + met.size() + met.leq(x) + x.leq(y) +
+                   joined.equals(y);
+    }
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+} // namespace
+
+TEST(BitVectorSetBenchmark, registerSizedUniverses) {
+  for (uint32_t universe : {16, 64, 256}) {
+    auto bit_vector_sets = make_sets(universe, BitVectorDomain(universe));
+    auto patricia_tree_sets = make_sets(universe, PatriciaTreeDomain());
+
+    size_t bit_vector_checksum;
+    size_t patricia_tree_checksum;
+    double bit_vector = time_operations(bit_vector_sets, &bit_vector_checksum);
+    double patricia_tree =
+        time_operations(patricia_tree_sets, &patricia_tree_checksum);
+    EXPECT_EQ(bit_vector_checksum, patricia_tree_checksum);
+
+    std::cout << "universe of " << universe << ": " << bit_vector
+              << "s bit vector, " << patricia_tree << "s Patricia tree"
+              << std::endl;
+  }
+}
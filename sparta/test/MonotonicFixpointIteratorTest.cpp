@@ -139,8 +139,9 @@ class FixpointEngine final
   using EdgeId = typename Base::EdgeId;
 
  public:
-  explicit FixpointEngine(const Program& program)
-      : Base(program), m_program(program) {}
+  template <typename... Args>
+  explicit FixpointEngine(const Program& program, Args&&... args)
+      : Base(program, std::forward<Args>(args)...), m_program(program) {}
 
   void analyze_node(const uint32_t& node,
                     LivenessDomain* current_state) const override {
@@ -463,6 +464,67 @@ TYPED_TEST(MonotonicFixpointIteratorLivenessTest, program3) {
               ::testing::UnorderedElementsAre("z", "c", "b", "y"));
 }
 
+/*
+ * The entry defines x1 ... xn, and then branches to n independent loops that
+ * each read one of the variables, and meet at the exit:
+ *
+ *   0: x1 = ...; ...; xn = ...;
+ *   k: if (yk) {              for k in 1 ... n
+ *   n + k: yk = xk; goto k;
+ *        }
+ *   2n + 1: return z;
+ *
+ * In the reverse graph, the loops are independent top-level components.
+ */
+TEST(MonotonicFixpointIteratorLivenessParallelTest, independentComponents) {
+  using namespace liveness;
+  constexpr uint32_t n = 64;
+  Program program(0);
+  std::vector<std::string> defs;
+  for (uint32_t k = 1; k <= n; ++k) {
+    defs.push_back("x" + std::to_string(k));
+  }
+  Statement entry;
+  entry.def = defs;
+  program.add(0, entry);
+  uint32_t exit = 2 * n + 1;
+  program.add(exit, Statement(/* use: */ {"z"}, /* def: */ {}));
+  program.set_exit(exit);
+  for (uint32_t k = 1; k <= n; ++k) {
+    auto x = "x" + std::to_string(k);
+    auto y = "y" + std::to_string(k);
+    program.add(k, Statement(/* use: */ {y}, /* def: */ {}));
+    Statement body;
+    body.use = {x};
+    body.def = {y};
+    program.add(n + k, body);
+    program.add_edge(0, k);
+    program.add_edge(k, n + k);
+    program.add_edge(n + k, k);
+    program.add_edge(k, exit);
+  }
+
+  FixpointEngine<WTOMonotonicFixpointIterator> sequential(program);
+  sequential.run(LivenessDomain());
+  FixpointEngine<WTOMonotonicFixpointIterator> parallel(
+      program, /* cfg_size_hint */ 4, /* parallel_threshold */ 0,
+      /* num_threads */ 4);
+  for (size_t i = 0; i < 2; ++i) {
+    parallel.run(LivenessDomain());
+    for (uint32_t node = 0; node <= exit; ++node) {
+      EXPECT_EQ(parallel.get_live_in_vars_at(node),
+                sequential.get_live_in_vars_at(node))
+          << node;
+      EXPECT_EQ(parallel.get_live_out_vars_at(node),
+                sequential.get_live_out_vars_at(node))
+          << node;
+    }
+  }
+  EXPECT_THAT(sequential.get_live_in_vars_at(1).elements(),
+              ::testing::UnorderedElementsAre("x1", "y1", "z"));
+  EXPECT_EQ(sequential.get_live_in_vars_at(0).size(), n + 1);
+}
+
 namespace numerical {
 
 using namespace sparta;
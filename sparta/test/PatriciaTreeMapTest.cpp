@@ -12,7 +12,9 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <initializer_list>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 using namespace sparta;
 
@@ -31,6 +33,14 @@ pt_map create_pt_map(
   return map;
 }
 
+struct HashConsedValue : ptmap_impl::SimpleValue<uint32_t> {
+  static constexpr bool hash_consing = true;
+
+  static size_t hash(uint32_t x) { return std::hash<uint32_t>()(x); }
+};
+
+using hc_map = PatriciaTreeMap<uint32_t, uint32_t, HashConsedValue>;
+
 } // namespace
 
 TEST(PatriciaTreeMapTest, basicOperations) {
@@ -209,3 +219,65 @@ TEST(PatriciaTreeMapTest, difference) {
                                      create_pt_map({{2, 1}, {4, 1}, {6, 1}})),
             create_pt_map({{1, 3}, {3, 3}, {5, 3}}));
 }
+
+TEST(PatriciaTreeMapTest, hashConsing) {
+  hc_map m1;
+  hc_map m2;
+  for (uint32_t i = 0; i < 100; ++i) {
+    m1.insert_or_assign(i, i + 1);
+  }
+  // Equal maps are the same tree, whichever way they were built.
+  for (uint32_t i = 100; i > 0; --i) {
+    m2.insert_or_assign(i - 1, i == 50 ? 7 : i);
+  }
+  EXPECT_FALSE(m1.reference_equals(m2));
+  EXPECT_NE(m1, m2);
+  m2.insert_or_assign(49, 50);
+  EXPECT_TRUE(m1.reference_equals(m2));
+  EXPECT_EQ(m1, m2);
+
+  auto combine = [](uint32_t x, uint32_t y) { return std::max(x, y); };
+  auto m3 = m1.get_union_with(combine, m2);
+  EXPECT_TRUE(m3.reference_equals(m1));
+
+  m3.update([](uint32_t x) { return x + 1; }, 3);
+  EXPECT_NE(m3, m1);
+  m3.update([](uint32_t x) { return x - 1; }, 3);
+  EXPECT_TRUE(m3.reference_equals(m1));
+
+  for (uint32_t i = 0; i < 100; ++i) {
+    m2.insert_or_assign(i, 0);
+  }
+  EXPECT_TRUE(m2.empty());
+  EXPECT_EQ(100, m1.size());
+  for (uint32_t i = 0; i < 100; ++i) {
+    EXPECT_EQ(m1.at(i), i + 1);
+  }
+}
+
+TEST(PatriciaTreeMapTest, hashConsingAcrossThreads) {
+  // Threads keep building and dropping the same maps, so nodes get released
+  // while other threads look them up.
+  std::vector<hc_map> maps(8);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < maps.size(); ++t) {
+    threads.emplace_back([&maps, t]() {
+      for (uint32_t round = 0; round < 200; ++round) {
+        hc_map m;
+        for (uint32_t i = 0; i < 64; ++i) {
+          m.insert_or_assign(i, (i + round) % 4);
+        }
+        maps[t] = m;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& m : maps) {
+    EXPECT_TRUE(m.reference_equals(maps[0]));
+  }
+  for (uint32_t i = 0; i < 64; ++i) {
+    EXPECT_EQ(maps[0].at(i), (i + 199) % 4);
+  }
+}
@@ -11,6 +11,7 @@
 #include <chrono>
 #include <gtest/gtest.h>
 #include <random>
+#include <thread>
 
 constexpr unsigned int NUM_INTS = 1000;
 
@@ -99,3 +100,122 @@ TEST(SpartaWorkQueueTest, preciseScheduling) {
     ASSERT_EQ(1, array[idx]);
   }
 }
+
+TEST(SpartaWorkQueueTest, lockFreeForeach) {
+  std::array<int, NUM_INTS> array = {0};
+
+  auto wq = sparta::work_queue<int*>([](int* a) { (*a)++; },
+                                     /* num_threads */ 4,
+                                     /* push_tasks_while_running */ false,
+                                     sparta::WorkQueueDeque::LockFree);
+
+  for (int idx = 0; idx < NUM_INTS; ++idx) {
+    wq.add_item(&array[idx]);
+  }
+  wq.run_all();
+  for (int idx = 0; idx < NUM_INTS; ++idx) {
+    ASSERT_EQ(1, array[idx]);
+  }
+}
+
+// All the work starts on a single worker, so the others have to steal it.
+TEST(SpartaWorkQueueTest, lockFreeStealing) {
+  std::array<std::atomic<int>, NUM_INTS> array;
+  for (auto& a : array) {
+    a = 0;
+  }
+
+  auto wq = sparta::work_queue<std::atomic<int>*>(
+      [](std::atomic<int>* a) { (*a)++; },
+      /* num_threads */ 8,
+      /* push_tasks_while_running */ false,
+      sparta::WorkQueueDeque::LockFree);
+
+  for (int idx = 0; idx < NUM_INTS; ++idx) {
+    wq.add_item(&array[idx], /* worker_id */ 0);
+  }
+  wq.run_all();
+  for (int idx = 0; idx < NUM_INTS; ++idx) {
+    ASSERT_EQ(1, array[idx]);
+  }
+}
+
+TEST(SpartaWorkQueueTest, lockFreeDynamicallyAddingTasks) {
+  std::atomic<int> result{0};
+  auto wq = sparta::work_queue<int>(
+      [&](sparta::SpartaWorkerState<int>* worker_state, int a) {
+        if (a > 0) {
+          // Fan out, so that the deque has to grow and thieves find work.
+          worker_state->push_task(a - 1);
+          worker_state->push_task(a - 1);
+          result += 1;
+        }
+      },
+      /* num_threads */ 4,
+      /* push_tasks_while_running */ true,
+      sparta::WorkQueueDeque::LockFree);
+  wq.add_item(12);
+  wq.run_all();
+
+  // A full binary tree of depth 12 has 2^12 - 1 inner nodes.
+  EXPECT_EQ((1 << 12) - 1, result);
+}
+
+// Inputs that do not fit a lock-free atomic use the locked queues.
+TEST(SpartaWorkQueueTest, lockFreeFallback) {
+  std::atomic<size_t> total{0};
+  auto wq = sparta::work_queue<std::string>(
+      [&](const std::string& s) { total += s.size(); },
+      /* num_threads */ 4,
+      /* push_tasks_while_running */ false,
+      sparta::WorkQueueDeque::LockFree);
+  for (int idx = 0; idx < NUM_INTS; ++idx) {
+    wq.add_item("abc");
+  }
+  wq.run_all();
+  EXPECT_EQ(3 * NUM_INTS, total);
+}
+
+TEST(SpartaWorkQueueTest, workQueueTimes) {
+  auto before = sparta::get_workqueue_times();
+  auto wq = sparta::work_queue<int>(
+      [](int) { std::this_thread::sleep_for(std::chrono::milliseconds(10)); },
+      /* num_threads */ 2);
+  // One worker runs one task, the other two, so their capacity is at least
+  // 2 * 20ms, of which 30ms are busy.
+  wq.add_item(0);
+  wq.add_item(1);
+  wq.add_item(2);
+  wq.run_all();
+  auto after = sparta::get_workqueue_times();
+  auto busy_us = after.busy_us - before.busy_us;
+  auto capacity_us = after.capacity_us - before.capacity_us;
+  EXPECT_GE(busy_us, 30000);
+  EXPECT_GE(capacity_us, 40000);
+  EXPECT_LE(busy_us, capacity_us);
+}
+
+TEST(SpartaWorkQueueTest, numaPermutation) {
+  EXPECT_EQ(sparta::workqueue_impl::parse_cpu_list("0-3,8,10-11"),
+            std::vector<unsigned int>({0, 1, 2, 3, 8, 10, 11}));
+
+  // Workers 0-3 are on node 0, and workers 4-7 on node 1.
+  for (unsigned int idx = 0; idx < 8; ++idx) {
+    auto attempts = sparta::workqueue_impl::create_permutation(8, idx, 2);
+    ASSERT_EQ(attempts.size(), 8);
+    EXPECT_EQ(attempts[0], idx);
+    for (unsigned int i = 0; i < 8; ++i) {
+      EXPECT_EQ(attempts[i] / 4 == idx / 4, i < 4);
+    }
+  }
+
+  sparta::set_numa_aware_workers(true);
+  std::atomic<int> sum{0};
+  auto wq = sparta::work_queue<int>([&](int a) { sum += a; }, 4);
+  for (int i = 1; i <= 100; ++i) {
+    wq.add_item(i);
+  }
+  wq.run_all();
+  sparta::set_numa_aware_workers(false);
+  EXPECT_EQ(sum, 5050);
+}
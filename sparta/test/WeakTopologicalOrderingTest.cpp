@@ -251,3 +251,27 @@ TEST(WeakTopologicalOrderingTest, InvalidIteratorDeref) {
   EXPECT_ANY_THROW(wto.end()->head_node());
   EXPECT_ANY_THROW(wto.end()++);
 }
+
+TEST(WeakTopologicalOrderingTest, DeepGraph) {
+  // A loop over a chain of nodes that is long enough to overflow the stack of
+  // a recursive construction.
+  constexpr uint32_t length = 1000000;
+  auto successors = [](uint32_t n) {
+    return std::vector<uint32_t>{(n + 1) % length};
+  };
+  WeakTopologicalOrdering<uint32_t> wto(0, successors);
+
+  // The WTO is (0 1 2 ... length - 1).
+  auto it = wto.begin();
+  ASSERT_NE(it, wto.end());
+  const WtoComponent<uint32_t>& scc = *it;
+  EXPECT_EQ(++it, wto.end());
+  ASSERT_TRUE(scc.is_scc());
+  EXPECT_EQ(scc.head_node(), 0);
+  uint32_t n = 1;
+  for (const auto& component : scc) {
+    EXPECT_TRUE(component.is_vertex());
+    EXPECT_EQ(component.head_node(), n++);
+  }
+  EXPECT_EQ(n, length);
+}
@@ -27,7 +27,8 @@
 #include "Walkers.h"
 
 struct DexOutputTestHelper {
-  static std::unique_ptr<uint8_t[]> steal_output(DexOutput& output) {
+  static std::unique_ptr<uint8_t[], void (*)(void*)> steal_output(
+      DexOutput& output) {
     return std::move(output.m_output);
   }
 };
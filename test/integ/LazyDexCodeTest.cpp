@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <sstream>
+
+#include "DexClass.h"
+#include "DexLoader.h"
+#include "DexPosition.h"
+#include "RedexContext.h"
+#include "RedexTest.h"
+#include "Show.h"
+#include "Walkers.h"
+
+namespace {
+
+std::string show_code(const DexCode* code) {
+  std::ostringstream ss;
+  ss << show(code) << "tries: " << code->get_tries().size();
+  if (auto* dbg = code->get_debug_item()) {
+    for (auto& entry : dbg->get_entries()) {
+      if (entry.type == DexDebugEntryType::Position) {
+        ss << "\n" << entry.addr << ": " << show(entry.pos.get());
+      }
+    }
+  }
+  return ss.str();
+}
+
+std::map<std::string, std::string> load_and_show(const char* dex_file,
+                                                 bool lazy_code) {
+  DexLoader dl(dex_file);
+  dex_stats_t stats{{0}};
+  auto classes = dl.load_dex(dex_file, &stats, 35, lazy_code);
+  std::map<std::string, std::string> shown;
+  walk::methods(classes, [&](DexMethod* m) {
+    if (m->get_dex_code() != nullptr) {
+      shown.emplace(show(m), show_code(m->get_dex_code()));
+    }
+  });
+  return shown;
+}
+
+} // namespace
+
+class LazyDexCodeTest : public RedexTest {};
+
+TEST_F(LazyDexCodeTest, matchesEagerLoading) {
+  const char* dex_file = std::getenv("dexfile");
+  ASSERT_NE(dex_file, nullptr);
+
+  auto eager = load_and_show(dex_file, /* lazy_code */ false);
+  ASSERT_FALSE(eager.empty());
+
+  // Classes can only be loaded once per context.
+  delete g_redex;
+  g_redex = new RedexContext();
+  auto lazy = load_and_show(dex_file, /* lazy_code */ true);
+
+  EXPECT_EQ(eager, lazy);
+}
+
+TEST_F(LazyDexCodeTest, outlivesLoader) {
+  const char* dex_file = std::getenv("dexfile");
+  ASSERT_NE(dex_file, nullptr);
+
+  auto classes = load_classes_from_dex(dex_file, /* balloon */ false);
+  // The loader is gone; the code keeps the mapped dex alive.
+  walk::parallel::methods(classes, [](DexMethod* m) {
+    if (auto* code = m->get_dex_code()) {
+      EXPECT_FALSE(code->get_instructions().empty());
+    }
+  });
+  walk::parallel::methods(classes, [](DexMethod* m) {
+    if (m->get_dex_code() != nullptr) {
+      m->balloon();
+      EXPECT_NE(m->get_code(), nullptr);
+    }
+  });
+}
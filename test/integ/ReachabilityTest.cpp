@@ -7,8 +7,34 @@
 
 #include <gtest/gtest.h>
 
+#include "IRAssembler.h"
 #include "Reachability.h"
 #include "RedexTest.h"
+#include "Show.h"
+#include "Walkers.h"
+
+namespace {
+
+void expect_same_marks(const Scope& scope,
+                       const reachability::ReachableObjects& expected,
+                       const reachability::ReachableObjects& actual) {
+  auto expect_same_member_marks = [&](const auto& members) {
+    for (const auto* member : members) {
+      EXPECT_EQ(actual.marked_unsafe(member), expected.marked_unsafe(member))
+          << show(member);
+    }
+  };
+  for (const auto* cls : scope) {
+    EXPECT_EQ(actual.marked_unsafe(cls), expected.marked_unsafe(cls))
+        << show(cls);
+    expect_same_member_marks(cls->get_ifields());
+    expect_same_member_marks(cls->get_sfields());
+    expect_same_member_marks(cls->get_dmethods());
+    expect_same_member_marks(cls->get_vmethods());
+  }
+}
+
+} // namespace
 
 class ReachabilityTest : public RedexIntegrationTest {};
 
@@ -48,6 +74,35 @@ TEST_F(ReachabilityTest, ReachabilityFromProguardTest) {
   EXPECT_EQ(after.num_fields, 2);
 }
 
+TEST_F(ReachabilityTest, InstantiationFactsCoverRemainingCode) {
+  const auto& dexen = stores[0].get_dexen();
+  auto pg_config = process_and_get_proguard_config(dexen, R"(
+    -keepclasseswithmembers public class RemoveUnreachableTest {
+      public void testMethod();
+    }
+  )");
+  EXPECT_TRUE(pg_config->ok);
+
+  int num_ignore_check_strings = 0;
+  reachability::IgnoreSets ig_sets;
+  auto reachable_objects = reachability::compute_reachable_objects(
+      stores, ig_sets, &num_ignore_check_strings);
+  reachability::sweep(stores, *reachable_objects, nullptr);
+
+  const auto& facts = *reachable_objects->instantiation_facts();
+  size_t num_instantiations = 0;
+  walk::code(build_class_scope(stores), [&](DexMethod*, IRCode& code) {
+    for (const auto& mie : InstructionIterable(code)) {
+      auto op = mie.insn->opcode();
+      if (op == OPCODE_NEW_INSTANCE || op == OPCODE_CONST_CLASS) {
+        EXPECT_EQ(facts.instantiated_types.count(mie.insn->get_type()), 1);
+        ++num_instantiations;
+      }
+    }
+  });
+  EXPECT_GT(num_instantiations, 0);
+}
+
 TEST_F(ReachabilityTest, ReachabilityMarkAllTest) {
   const auto& dexen = stores[0].get_dexen();
   auto pg_config = process_and_get_proguard_config(dexen, R"(
@@ -85,3 +140,54 @@ TEST_F(ReachabilityTest, ReachabilityMarkAllTest) {
   EXPECT_EQ(after.num_methods, 35);
   EXPECT_EQ(after.num_fields, 3);
 }
+
+TEST_F(ReachabilityTest, IncrementalMarkingMatchesMarkingFromScratch) {
+  const auto& dexen = stores[0].get_dexen();
+  auto pg_config = process_and_get_proguard_config(dexen, R"(
+    -keepclasseswithmembers public class RemoveUnreachableTest {
+      public void testMethod();
+    }
+  )");
+  EXPECT_TRUE(pg_config->ok);
+
+  reachability::IgnoreSets ig_sets;
+  reachability::MarkingHistory history;
+  auto mark = [&](reachability::MarkingHistory* from) {
+    int num_ignore_check_strings = 0;
+    return reachability::compute_reachable_objects(
+        stores, ig_sets, &num_ignore_check_strings,
+        /* record_reachability */ false,
+        /* should_mark_all_as_seed */ false,
+        /* out_method_override_graph */ nullptr,
+        /* remove_no_argument_constructors */ false, from);
+  };
+
+  auto first = mark(&history);
+  EXPECT_EQ(history.num_replayed(), 0);
+  EXPECT_GT(history.num_visited(), 0);
+  reachability::sweep(stores, *first, nullptr);
+  auto scope = build_class_scope(stores);
+
+  // Nothing changed, so all the visits are replayed.
+  auto second = mark(&history);
+  EXPECT_GT(history.num_replayed(), 0);
+  EXPECT_EQ(history.num_visited(), 0);
+  expect_same_marks(scope, *mark(nullptr), *second);
+
+  // What only the test method reaches becomes unreachable without its code.
+  auto* test_method =
+      DexMethod::get_method("LRemoveUnreachableTest;.testMethod:()V")
+          ->as_def();
+  ASSERT_NE(test_method, nullptr);
+  test_method->set_code(assembler::ircode_from_string(R"(
+    (
+      (return-void)
+    )
+  )"));
+  auto third = mark(&history);
+  EXPECT_GT(history.num_replayed(), 0);
+  EXPECT_GT(history.num_visited(), 0);
+  expect_same_marks(scope, *mark(nullptr), *third);
+  EXPECT_FALSE(third->marked_unsafe(type_class(DexType::get_type("LD;"))));
+  EXPECT_TRUE(third->marked_unsafe(test_method));
+}
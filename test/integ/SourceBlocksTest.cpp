@@ -64,10 +64,10 @@ class SourceBlocksTest : public RedexIntegrationTest {
       auto vec = source_blocks::gather_source_blocks(block);
       for (auto* sb : vec) {
         oss << " " << sb->id;
-        if (!sb->vals.empty()) {
+        if (!sb->vals().empty()) {
           oss << "(";
           bool first_val = true;
-          for (const auto& val : sb->vals) {
+          for (const auto& val : sb->vals()) {
             if (!first_val) {
               oss << "|";
             }
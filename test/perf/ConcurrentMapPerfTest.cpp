@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ConcurrentContainers.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+//==========
+// Slot-locked ConcurrentMap vs. lock-free-read ReadOptimizedConcurrentMap
+//==========
+
+namespace {
+
+constexpr size_t kNumKeys = 1 << 16;
+constexpr size_t kLookupsPerThread = 1 << 18;
+
+// Mimics a resolver cache: pre-populated, then hammered with lookups while a
+// small fraction of the accesses insert new keys.
+template <typename Map>
+double run(unsigned int num_threads, unsigned int write_per_mille) {
+  Map map;
+  for (uint32_t k = 0; k < kNumKeys; ++k) {
+    map.emplace(k, k);
+  }
+  std::atomic<size_t> sink{0};
+  std::vector<boost::thread> threads;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      std::mt19937 gen(t);
+      std::uniform_int_distribution<uint32_t> key_dist(0, kNumKeys * 2);
+      std::uniform_int_distribution<unsigned int> op_dist(0, 999);
+      size_t local = 0;
+      for (size_t i = 0; i < kLookupsPerThread; ++i) {
+        uint32_t key = key_dist(gen);
+        if (op_dist(gen) < write_per_mille) {
+          map.emplace(key, key);
+        } else {
+          local += map.get(key, 0);
+        }
+      }
+      sink += local;
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+} // namespace
+
+int main() {
+  for (unsigned int write_per_mille : {0u, 10u}) {
+    for (unsigned int num_threads : {1u, 8u, 32u, 64u}) {
+      double locked =
+          run<ConcurrentMap<uint32_t, uint32_t>>(num_threads, write_per_mille);
+      double lock_free =
+          run<ReadOptimizedConcurrentMap<uint32_t, uint32_t>>(
+              num_threads, write_per_mille);
+      printf("%u threads, %.1f%% writes: ConcurrentMap %.1fms, "
+             "ReadOptimizedConcurrentMap %.1fms (%.2fx)\n",
+             num_threads,
+             write_per_mille / 10.0,
+             locked,
+             lock_free,
+             locked / lock_free);
+    }
+  }
+}
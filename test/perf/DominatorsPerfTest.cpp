@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Dominators.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+//==========
+// Dominance queries: walking immediate dominators vs. a numbered tree
+//==========
+//
+// With SimpleFastDominators alone, asking whether a block dominates another
+// walks up the immediate dominators of the latter, which takes time in the
+// depth of the dominator tree. DominatorTree numbers the tree once so that
+// each query compares two intervals. This measures both the extra cost of
+// building the tree and the cost of the queries, on graphs shaped like the
+// CFGs of large generated methods.
+
+namespace {
+
+constexpr size_t kNumQueries = 1 << 14;
+
+struct Graph {
+  std::vector<std::vector<uint32_t>> succs;
+  std::vector<std::vector<uint32_t>> preds;
+
+  explicit Graph(size_t size) : succs(size), preds(size) {}
+
+  void add_edge(uint32_t pred, uint32_t succ) {
+    succs[pred].push_back(succ);
+    preds[succ].push_back(pred);
+  }
+};
+
+struct GraphInterface {
+  using NodeId = uint32_t;
+  using EdgeId = std::pair<uint32_t, uint32_t>;
+  using Graph = ::Graph;
+
+  static NodeId entry(const Graph&) { return 0; }
+
+  static std::vector<EdgeId> predecessors(const Graph& graph, NodeId node) {
+    std::vector<EdgeId> edges;
+    for (auto pred : graph.preds[node]) {
+      edges.emplace_back(pred, node);
+    }
+    return edges;
+  }
+
+  static std::vector<EdgeId> successors(const Graph& graph, NodeId node) {
+    std::vector<EdgeId> edges;
+    for (auto succ : graph.succs[node]) {
+      edges.emplace_back(node, succ);
+    }
+    return edges;
+  }
+
+  static NodeId source(const Graph&, const EdgeId& edge) { return edge.first; }
+  static NodeId target(const Graph&, const EdgeId& edge) { return edge.second; }
+};
+
+// A chain of `num_diamonds` if-else diamonds, with a loop around every
+// `loop_every` of them and a few random forward edges to make the joins
+// less regular.
+Graph make_graph(uint32_t num_diamonds, uint32_t loop_every) {
+  std::mt19937 gen(num_diamonds);
+  uint32_t size = 3 * num_diamonds + 1;
+  Graph graph(size);
+  for (uint32_t i = 0; i < num_diamonds; ++i) {
+    uint32_t head = 3 * i;
+    graph.add_edge(head, head + 1);
+    graph.add_edge(head, head + 2);
+    graph.add_edge(head + 1, head + 3);
+    graph.add_edge(head + 2, head + 3);
+    if (i % loop_every == loop_every - 1) {
+      graph.add_edge(head + 3, 3 * (i + 1 - loop_every));
+    }
+    if (gen() % 16 == 0) {
+      uint32_t target = head + 3 * (1 + gen() % 8);
+      graph.add_edge(head + 1, std::min(size - 1, target));
+    }
+  }
+  return graph;
+}
+
+template <typename Fn>
+double time_ms(const Fn& fn) {
+  auto start = std::chrono::high_resolution_clock::now();
+  fn();
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+bool walk_dominates(
+    const dominators::SimpleFastDominators<GraphInterface>& doms,
+    uint32_t dominator,
+    uint32_t node) {
+  while (true) {
+    if (node == dominator) {
+      return true;
+    }
+    auto idom = doms.get_idom(node);
+    if (idom == node) {
+      return false;
+    }
+    node = idom;
+  }
+}
+
+void run(uint32_t num_diamonds, uint32_t loop_every) {
+  auto graph = make_graph(num_diamonds, loop_every);
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<uint32_t> node_dist(0,
+                                                    graph.succs.size() - 1);
+  std::vector<std::pair<uint32_t, uint32_t>> queries;
+  for (size_t i = 0; i < kNumQueries; ++i) {
+    queries.emplace_back(node_dist(gen), node_dist(gen));
+  }
+
+  std::unique_ptr<dominators::SimpleFastDominators<GraphInterface>> doms;
+  double doms_build = time_ms([&]() {
+    doms = std::make_unique<dominators::SimpleFastDominators<GraphInterface>>(
+        graph);
+  });
+  std::unique_ptr<dominators::DominatorTree<GraphInterface>> tree;
+  double tree_build = time_ms([&]() {
+    tree = std::make_unique<dominators::DominatorTree<GraphInterface>>(graph);
+  });
+
+  size_t walk_count = 0;
+  double walk = time_ms([&]() {
+    for (const auto& [a, b] : queries) {
+      walk_count += walk_dominates(*doms, a, b);
+    }
+  });
+  size_t tree_count = 0;
+  double numbered = time_ms([&]() {
+    for (const auto& [a, b] : queries) {
+      tree_count += tree->dominates(a, b);
+    }
+  });
+
+  printf(
+      "%u blocks, loop every %u: build %.1fms idoms, %.1fms tree; %zu "
+      "queries: walk %.1fms, tree %.1fms%s (%.1fx)\n",
+      (unsigned)graph.succs.size(),
+      loop_every,
+      doms_build,
+      tree_build,
+      queries.size(),
+      walk,
+      numbered,
+      walk_count == tree_count ? "" : " (wrong)",
+      walk / numbered);
+}
+
+} // namespace
+
+int main() {
+  run(1000, 10);
+  run(10000, 10);
+  run(10000, 1000);
+  run(30000, 100);
+}
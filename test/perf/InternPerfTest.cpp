@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ConcurrentContainers.h"
+#include "DexClass.h"
+#include "InternTable.h"
+#include "RedexContext.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+//==========
+// Interning throughput: slot-locked ConcurrentMap vs. lock-free InternTable
+//==========
+//
+// Every thread interns the same names, as threads of a pass that derive new
+// names from shared inputs do, so most calls find the name of another thread.
+
+namespace {
+
+constexpr size_t kNumNames = 1 << 18;
+
+std::vector<std::string> make_names() {
+  std::vector<std::string> names;
+  names.reserve(kNumNames);
+  for (size_t i = 0; i < kNumNames; ++i) {
+    names.push_back("Lcom/facebook/generated/SomeLongPackageName/Class$" +
+                    std::to_string(i) + ";");
+  }
+  return names;
+}
+
+template <typename Fn>
+double run(unsigned int num_threads, const Fn& fn) {
+  std::vector<boost::thread> threads;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&, t]() {
+      // Start at different names, so that threads also create some.
+      for (size_t i = 0; i < kNumNames; ++i) {
+        fn((i + t * (kNumNames / num_threads)) % kNumNames);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  double ms = std::chrono::duration<double, std::milli>(end - start).count();
+  // Millions of interning calls per second.
+  return num_threads * kNumNames / ms / 1000;
+}
+
+} // namespace
+
+int main() {
+  auto names = make_names();
+  for (unsigned int num_threads : {1u, 8u, 32u, 64u}) {
+    double locked;
+    {
+      ConcurrentMap<std::string_view, const std::string*> map;
+      locked = run(num_threads, [&](size_t i) {
+        std::string_view key(names[i]);
+        if (map.get(key, nullptr) == nullptr) {
+          map.emplace(key, &names[i]);
+        }
+      });
+    }
+    double lock_free;
+    {
+      InternTable<std::string_view, const std::string> table;
+      lock_free = run(num_threads, [&](size_t i) {
+        std::string_view key(names[i]);
+        if (table.get(key) == nullptr) {
+          table.get_or_emplace(key, &names[i]);
+        }
+      });
+    }
+    double types;
+    {
+      g_redex = new RedexContext();
+      types = run(num_threads,
+                  [&](size_t i) { DexType::make_type(names[i]); });
+      delete g_redex;
+    }
+    printf("%u threads: ConcurrentMap %.1fM/s, InternTable %.1fM/s (%.2fx), "
+           "DexType::make_type %.1fM/s\n",
+           num_threads, locked, lock_free, lock_free / locked, types);
+  }
+}
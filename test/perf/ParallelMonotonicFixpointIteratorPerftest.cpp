@@ -11,6 +11,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -212,17 +213,27 @@ class MonotonicFixpointIteratorTest {
   }
 };
 
+// Also returns the share of the capacity of the workers that was spent
+// analyzing nodes, rather than waiting for work.
 double calculate_speedup(const MonotonicFixpointIteratorTest& test,
-                         uint32_t num_core) {
+                         uint32_t num_core,
+                         double* utilization) {
   using namespace std::placeholders;
   ParallelFixpointEngine para_fp(test.m_program1, num_core);
+  auto times_before = sparta::get_workqueue_times();
   auto para_start = std::chrono::high_resolution_clock::now();
   para_fp.run(LivenessDomain());
   auto para_end = std::chrono::high_resolution_clock::now();
+  auto times_after = sparta::get_workqueue_times();
 
   double duration2 = std::chrono::duration_cast<std::chrono::microseconds>(
                          para_end - para_start)
                          .count();
+  auto capacity_us = times_after.capacity_us - times_before.capacity_us;
+  *utilization =
+      capacity_us == 0
+          ? 0
+          : double(times_after.busy_us - times_before.busy_us) / capacity_us;
   return duration2;
 }
 
@@ -237,7 +248,10 @@ int main() {
   double duration1 = std::chrono::duration_cast<std::chrono::microseconds>(
                          single_end - single_start)
                          .count();
+  printf("threads speedup utilization\n");
   for (uint32_t i = 1; i <= redex_parallel::default_num_threads(); ++i) {
-    printf("%u %lf\n", i, duration1 / calculate_speedup(test, i));
+    double utilization;
+    double duration2 = calculate_speedup(test, i, &utilization);
+    printf("%u %lf %lf\n", i, duration1 / duration2, utilization);
   }
 }
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "IRList.h"
+#include "RedexContext.h"
+#include "SourceBlockValsArena.h"
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+//==========
+// Memory of source block values, inline vectors vs. interned arrays
+//==========
+//
+// With 20 interactions, a block used to own a 20-entry vector. Most blocks
+// are cold, so their values are all zero, and inlining copies the values of
+// the callee for each call site. Interned arrays are stored once per distinct
+// set of values.
+
+namespace {
+
+constexpr size_t kNumBlocks = 1 << 20;
+constexpr size_t kNumInteractions = 20;
+// One in this many blocks has values seen nowhere else.
+constexpr size_t kUniqueEvery = 16;
+
+} // namespace
+
+int main() {
+  g_redex = new RedexContext();
+
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> dist(0, 1);
+  std::vector<SourceBlock::Val> zero(kNumInteractions, SourceBlock::Val(0, 0));
+  std::vector<std::unique_ptr<SourceBlock>> blocks;
+  blocks.reserve(kNumBlocks);
+  for (size_t i = 0; i != kNumBlocks; ++i) {
+    if (i % kUniqueEvery != 0) {
+      blocks.push_back(std::make_unique<SourceBlock>(nullptr, i, zero));
+      continue;
+    }
+    std::vector<SourceBlock::Val> vals;
+    vals.reserve(kNumInteractions);
+    for (size_t j = 0; j != kNumInteractions; ++j) {
+      vals.emplace_back(dist(gen), 1);
+    }
+    blocks.push_back(std::make_unique<SourceBlock>(nullptr, i, vals));
+  }
+
+  size_t old_bytes =
+      kNumBlocks * (sizeof(SourceBlock) - sizeof(SourceBlock::Vals) +
+                    sizeof(std::vector<SourceBlock::Val>) +
+                    kNumInteractions * sizeof(SourceBlock::Val));
+  size_t new_bytes = kNumBlocks * sizeof(SourceBlock) +
+                     g_redex->sb_vals_arena().reserved_bytes();
+  printf("%zu blocks, %zu interactions, %zu distinct arrays\n", kNumBlocks,
+         kNumInteractions, g_redex->sb_vals_arena().size());
+  printf("vectors:  %8.1f MiB\n", old_bytes / (1024.0 * 1024.0));
+  printf("interned: %8.1f MiB\n", new_bytes / (1024.0 * 1024.0));
+
+  blocks.clear();
+  delete g_redex;
+  return 0;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <json/json.h>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "Debug.h"
+#include "DexClass.h"
+#include "DexStore.h"
+#include "IRAssembler.h"
+#include "PassManager.h"
+#include "PassRegistry.h"
+#include "RedexContext.h"
+#include "TypeUtil.h"
+
+//==========
+// End-to-end throughput of passes over a synthetic app
+//==========
+//
+// Generates an app of configurable size and shape, and runs each of the given
+// passes on a fresh copy of it, then all of them as one pipeline. Prints one
+// JSON object per line, with the wall and CPU time and the peak resident set
+// size of each run, so that nightly runs can track them.
+//
+// This must be linked with the passes, including their static registration,
+// like redex-all. Usage:
+//
+//   synthetic_app_perf_test [--classes=N] [--methods=N] [--insns=N]
+//       [--depth=N] [--strings=N] [--seed=N] [--passes=A,B,...]
+
+namespace {
+
+struct AppShape {
+  size_t classes{5000};
+  // Per class, half of them virtual.
+  size_t methods{10};
+  // Per method, roughly.
+  size_t insns{40};
+  // Of the chains of subclasses of java.lang.Object.
+  size_t depth{4};
+  size_t strings{10000};
+  uint32_t seed{0};
+};
+
+std::string class_name(size_t i) {
+  return "LSynth/C" + std::to_string(i) + ";";
+}
+
+std::string method_name(size_t cls, size_t m, bool is_virtual) {
+  return class_name(cls) + "." + (is_virtual ? "v" : "s") + std::to_string(m) +
+         ":(I)I";
+}
+
+// A method body that mixes arithmetic, strings, calls and branches.
+std::string make_body(const AppShape& shape,
+                      std::mt19937& gen,
+                      bool is_virtual) {
+  std::ostringstream body;
+  body << "(";
+  if (is_virtual) {
+    body << "(load-param-object v5)";
+  }
+  body << "(load-param v4)(const v0 " << gen() % 100 << ")";
+  size_t label = 0;
+  for (size_t i = 0; i < shape.insns; ++i) {
+    switch (gen() % 6) {
+    case 0:
+      body << "(add-int v0 v0 v4)";
+      break;
+    case 1:
+      body << "(add-int/lit8 v1 v0 " << gen() % 100 << ")(mul-int v0 v0 v1)";
+      break;
+    case 2:
+      body << "(const-string \"str" << gen() % shape.strings
+           << "\")(move-result-pseudo-object v2)";
+      break;
+    case 3:
+      body << "(invoke-static (v0) \""
+           << method_name(gen() % shape.classes, gen() % (shape.methods / 2),
+                          /* is_virtual */ false)
+           << "\")(move-result v0)";
+      break;
+    case 4:
+      body << "(if-lez v0 :L" << label << ")(add-int/lit8 v0 v0 1)(:L"
+           << label << ")";
+      ++label;
+      break;
+    case 5:
+      body << "(move v3 v0)(add-int v0 v3 v4)";
+      break;
+    }
+  }
+  body << "(return v0))";
+  return body.str();
+}
+
+DexClasses generate(const AppShape& shape) {
+  std::mt19937 gen(shape.seed);
+  DexClasses classes;
+  classes.reserve(shape.classes);
+  for (size_t c = 0; c < shape.classes; ++c) {
+    ClassCreator creator(DexType::make_type(class_name(c)));
+    creator.set_super(c % shape.depth == 0
+                          ? type::java_lang_Object()
+                          : DexType::make_type(class_name(c - 1)));
+    for (size_t m = 0; m < shape.methods; ++m) {
+      bool is_virtual = m >= shape.methods / 2;
+      auto* method = DexMethod::make_method(method_name(c, m, is_virtual))
+                         ->make_concrete(is_virtual ? ACC_PUBLIC
+                                                    : ACC_PUBLIC | ACC_STATIC,
+                                         is_virtual);
+      method->set_code(
+          assembler::ircode_from_string(make_body(shape, gen, is_virtual)));
+      creator.add_method(method);
+    }
+    classes.push_back(creator.create());
+  }
+  return classes;
+}
+
+// Runs the passes on a fresh copy of the app, and prints the result.
+void run(const AppShape& shape,
+         const std::string& run_name,
+         const std::vector<std::string>& pass_names) {
+  g_redex = new RedexContext();
+  {
+    DexStore store("classes");
+    store.add_classes(generate(shape));
+    DexStoresVector stores;
+    stores.emplace_back(std::move(store));
+
+    Json::Value config;
+    for (const auto& name : pass_names) {
+      config["redex"]["passes"].append(name);
+    }
+    auto tmp_dir = boost::filesystem::temp_directory_path() /
+                   boost::filesystem::unique_path("SyntheticApp%%%%%%%%");
+    boost::filesystem::create_directories(tmp_dir);
+    ConfigFiles conf(config, tmp_dir.string());
+    conf.parse_global_config();
+    PassManager manager(PassRegistry::get().get_passes(), config);
+    manager.set_testing_mode();
+
+    try_reset_hwm_mem_stat();
+    auto cpu_begin = std::clock();
+    auto wall_begin = std::chrono::steady_clock::now();
+    manager.run_passes(stores, conf);
+    auto wall_s = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - wall_begin)
+                      .count();
+    auto cpu_s = static_cast<double>(std::clock() - cpu_begin) /
+                 CLOCKS_PER_SEC;
+
+    Json::Value result;
+    result["run"] = run_name;
+    result["classes"] = Json::UInt64(shape.classes);
+    result["methods"] = Json::UInt64(shape.classes * shape.methods);
+    result["insns_per_method"] = Json::UInt64(shape.insns);
+    result["wall_s"] = wall_s;
+    result["cpu_s"] = cpu_s;
+    result["vm_hwm_bytes"] = Json::UInt64(get_mem_stats().vm_hwm);
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    printf("%s\n", Json::writeString(writer, result).c_str());
+    fflush(stdout);
+    boost::filesystem::remove_all(tmp_dir);
+  }
+  delete g_redex;
+}
+
+bool parse_size(const char* arg, const char* key, size_t* value) {
+  auto len = strlen(key);
+  if (strncmp(arg, key, len) != 0 || arg[len] != '=') {
+    return false;
+  }
+  *value = std::stoull(arg + len + 1);
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  AppShape shape;
+  std::vector<std::string> pass_names = {
+      "ResultPropagationPass",
+      "CopyPropagationPass",
+      "CommonSubexpressionEliminationPass",
+      "LocalDcePass",
+      "RegAllocPass",
+  };
+  for (int i = 1; i < argc; ++i) {
+    size_t seed;
+    if (parse_size(argv[i], "--classes", &shape.classes) ||
+        parse_size(argv[i], "--methods", &shape.methods) ||
+        parse_size(argv[i], "--insns", &shape.insns) ||
+        parse_size(argv[i], "--depth", &shape.depth) ||
+        parse_size(argv[i], "--strings", &shape.strings)) {
+      continue;
+    }
+    if (parse_size(argv[i], "--seed", &seed)) {
+      shape.seed = seed;
+    } else if (strncmp(argv[i], "--passes=", 9) == 0) {
+      pass_names.clear();
+      boost::split(pass_names, argv[i] + 9, boost::is_any_of(","));
+    } else {
+      fprintf(stderr, "Unknown argument %s\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+  }
+  always_assert(shape.classes > 0 && shape.methods >= 2 && shape.depth > 0 &&
+                shape.strings > 0);
+
+  for (const auto& name : pass_names) {
+    run(shape, name, {name});
+  }
+  if (pass_names.size() > 1) {
+    run(shape, "pipeline", pass_names);
+  }
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "RedexContext.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//==========
+// type_class lookups: hash map vs. the class slot of the type
+//==========
+//
+// Walks the superclass chains of a random hierarchy in random order, as
+// hierarchy building and resolution do, which misses the cache on most
+// lookups.
+
+namespace {
+
+constexpr size_t kNumClasses = 1 << 18;
+constexpr size_t kRounds = 10;
+
+template <typename Lookup>
+double ns_per_lookup(const std::vector<DexType*>& order, const Lookup& lookup) {
+  size_t lookups = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t r = 0; r < kRounds; ++r) {
+    for (const auto* type : order) {
+      while (type != nullptr) {
+        ++lookups;
+        auto cls = lookup(type);
+        type = cls == nullptr ? nullptr : cls->get_super_class();
+      }
+    }
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         lookups;
+}
+
+} // namespace
+
+int main() {
+  g_redex = new RedexContext();
+
+  std::mt19937 gen(0);
+  std::vector<DexType*> types;
+  types.reserve(kNumClasses);
+  for (size_t i = 0; i < kNumClasses; ++i) {
+    auto type = DexType::make_type("LClass" + std::to_string(i) + ";");
+    ClassCreator creator(type);
+    creator.set_super(i == 0 ? type::java_lang_Object() : types[gen() % i]);
+    creator.create();
+    types.push_back(type);
+  }
+
+  std::unordered_map<const DexType*, DexClass*> map;
+  g_redex->walk_type_class(
+      [&](const DexType* type, const DexClass* cls) {
+        map.emplace(type, const_cast<DexClass*>(cls));
+      });
+
+  std::vector<DexType*> order(types);
+  std::shuffle(order.begin(), order.end(), gen);
+  double hashed = ns_per_lookup(order, [&](const DexType* type) {
+    auto it = map.find(type);
+    return it == map.end() ? nullptr : it->second;
+  });
+  double slot = ns_per_lookup(order, [](const DexType* type) {
+    return type_class(type);
+  });
+  printf("%zu classes: hash map %.1f ns/lookup, slot %.1f ns/lookup "
+         "(%.2fx)\n",
+         kNumClasses, hashed, slot, hashed / slot);
+
+  delete g_redex;
+  return 0;
+}
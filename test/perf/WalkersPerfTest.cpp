@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "IRAssembler.h"
+#include "RedexContext.h"
+#include "Walkers.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+//==========
+// walk::parallel::code: a class per work item vs. chunks of classes
+//==========
+//
+// Many classes with a few tiny methods each, whose code is allocated in a
+// random order, as it is after passes have rebuilt some of it.
+
+namespace {
+
+constexpr size_t kNumClasses = 1 << 16;
+constexpr size_t kNumMethods = 4;
+constexpr size_t kRounds = 10;
+
+template <typename Walk>
+double ms_per_walk(const Walk& walk) {
+  // Warm up, so that both runs start with the same caches.
+  walk();
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t r = 0; r < kRounds; ++r) {
+    walk();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() /
+         kRounds;
+}
+
+} // namespace
+
+int main() {
+  g_redex = new RedexContext();
+
+  std::mt19937 gen(0);
+  Scope scope;
+  std::vector<DexMethod*> methods;
+  for (size_t c = 0; c < kNumClasses; ++c) {
+    auto name = "LClass" + std::to_string(c) + ";";
+    auto type = DexType::make_type(name);
+    ClassCreator creator(type);
+    creator.set_super(type::java_lang_Object());
+    for (size_t m = 0; m < kNumMethods; ++m) {
+      auto* method =
+          DexMethod::make_method(name + ".m" + std::to_string(m) + ":()I")
+              ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+      creator.add_method(method);
+      methods.push_back(method);
+    }
+    scope.push_back(creator.create());
+  }
+  std::shuffle(methods.begin(), methods.end(), gen);
+  for (auto* method : methods) {
+    method->set_code(assembler::ircode_from_string(R"(
+      (
+        (const v0 1)
+        (add-int v0 v0 v0)
+        (return v0)
+      )
+    )"));
+  }
+
+  std::atomic<size_t> total{0};
+  auto walker = [&total](DexMethod*, IRCode& code) {
+    size_t count = 0;
+    for (const auto& mie : InstructionIterable(code)) {
+      count += mie.insn->srcs_size();
+    }
+    total.fetch_add(count, std::memory_order_relaxed);
+  };
+  double per_class =
+      ms_per_walk([&]() { walk::parallel::code(scope, walker); });
+  double chunked =
+      ms_per_walk([&]() { walk::parallel::chunked_code(scope, walker); });
+  printf("%zu classes: class per item %.2f ms/walk, chunked %.2f ms/walk "
+         "(%.2fx)\n",
+         kNumClasses, per_class, chunked, per_class / chunked);
+
+  delete g_redex;
+  return 0;
+}
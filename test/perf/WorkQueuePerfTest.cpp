@@ -7,6 +7,7 @@
 
 #include "WorkQueue.h"
 
+#include <atomic>
 #include <chrono>
 #include <random>
 #include <thread>
@@ -73,9 +74,98 @@ void smallLengthTasks() {
   printf("speedup small length tasks: %f\n", speedup);
 }
 
+//==========
+// Locked vs. lock-free deques
+//==========
+
+// Many tiny tasks, as in walk::parallel::code over a large scope. This
+// measures queue overhead rather than useful work.
+template <typename Fn>
+double time_queue(sparta::WorkQueueDeque deque,
+                  unsigned int num_threads,
+                  const Fn& setup) {
+  std::atomic<size_t> sink{0};
+  auto wq = workqueue_foreach<size_t>(
+      [&](size_t a) { sink.fetch_add(a, std::memory_order_relaxed); },
+      num_threads,
+      /* push_tasks_while_running */ false,
+      deque);
+  setup(wq);
+  auto start = std::chrono::high_resolution_clock::now();
+  wq.run_all();
+  auto end = std::chrono::high_resolution_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void compareDeques() {
+  constexpr size_t kNumTasks = 400000;
+  for (unsigned int num_threads : {1u, 8u, 32u, 64u}) {
+    for (bool single_source : {false, true}) {
+      // With a single source, all tasks start out on worker 0 and every other
+      // worker has to steal.
+      auto setup = [&](auto& wq) {
+        for (size_t i = 0; i < kNumTasks; ++i) {
+          if (single_source) {
+            wq.add_item(i, 0);
+          } else {
+            wq.add_item(i);
+          }
+        }
+      };
+      double locked =
+          time_queue(sparta::WorkQueueDeque::Locked, num_threads, setup);
+      double lock_free =
+          time_queue(sparta::WorkQueueDeque::LockFree, num_threads, setup);
+      printf("%zu tiny tasks, %u threads, %s: locked %.1fms, lock-free %.1fms "
+             "(%.2fx)\n",
+             kNumTasks,
+             num_threads,
+             single_source ? "single source" : "round-robin",
+             locked,
+             lock_free,
+             locked / lock_free);
+    }
+  }
+}
+
+// Tasks that spawn tasks, the push_tasks_while_running use case.
+void compareDequesFanOut() {
+  for (unsigned int num_threads : {1u, 8u, 32u, 64u}) {
+    double times[2];
+    for (auto deque :
+         {sparta::WorkQueueDeque::Locked, sparta::WorkQueueDeque::LockFree}) {
+      std::atomic<size_t> count{0};
+      auto wq = workqueue_foreach<int>(
+          [&](sparta::SpartaWorkerState<int>* state, int depth) {
+            count.fetch_add(1, std::memory_order_relaxed);
+            if (depth > 0) {
+              state->push_task(depth - 1);
+              state->push_task(depth - 1);
+            }
+          },
+          num_threads,
+          /* push_tasks_while_running */ true,
+          deque);
+      wq.add_item(18);
+      auto start = std::chrono::high_resolution_clock::now();
+      wq.run_all();
+      auto end = std::chrono::high_resolution_clock::now();
+      times[deque == sparta::WorkQueueDeque::LockFree] =
+          std::chrono::duration<double, std::milli>(end - start).count();
+    }
+    printf("fan-out, %u threads: locked %.1fms, lock-free %.1fms (%.2fx)\n",
+           num_threads,
+           times[0],
+           times[1],
+           times[0] / times[1]);
+  }
+}
+
 int main() {
   printf("Begin!\n");
   profileBusyLoop();
   variableLengthTasks();
   smallLengthTasks();
+  compareDeques();
+  compareDequesFanOut();
 }
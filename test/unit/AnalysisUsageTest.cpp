@@ -220,3 +220,18 @@ TEST_F(AnalysisUsageTest, testDependencyChecking) {
     EXPECT_TRUE(exception_caught);
   }
 }
+
+TEST_F(AnalysisUsageTest, testMethodAnalysisPreservation) {
+  auto preserves_method_analyses = [](const Pass& pass) {
+    AnalysisUsage au;
+    pass.set_analysis_usage(au);
+    return au.preserves_method_analyses();
+  };
+  MyAnalysisPass analysis;
+  EXPECT_TRUE(preserves_method_analyses(analysis));
+  // Preserving the analysis passes says nothing about what the pass edits.
+  ConsumeAnalysisAndPreservePass transformation;
+  EXPECT_FALSE(preserves_method_analyses(transformation));
+  ConsumeAnalysisAndInvalidatePass invalidating;
+  EXPECT_FALSE(preserves_method_analyses(invalidating));
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BinaryContainer.h"
+#include "RedexException.h"
+#include "RedexTestUtils.h"
+
+using namespace binary_serialization;
+
+namespace {
+
+std::string write_container() {
+  std::ostringstream oss;
+  ContainerWriter writer(oss, /* version */ 7);
+  writer.begin_section(1) << "abc";
+  std::vector<uint64_t> values{1, 2, 3, 1ull << 40};
+  writer.write_array_section(2, values);
+  writer.begin_section(3);
+  writer.finish();
+  return oss.str();
+}
+
+} // namespace
+
+TEST(BinaryContainerTest, roundTripInMemory) {
+  auto data = write_container();
+  ContainerReader reader(data.data(), data.size());
+  EXPECT_EQ(reader.version(), 7);
+  EXPECT_TRUE(reader.has_section(1));
+  EXPECT_FALSE(reader.has_section(4));
+  EXPECT_EQ(reader.section(1), "abc");
+  auto values = reader.array_section<uint64_t>(2);
+  EXPECT_EQ(std::vector<uint64_t>(values.begin(), values.end()),
+            std::vector<uint64_t>({1, 2, 3, 1ull << 40}));
+  // The array is read in place.
+  EXPECT_EQ(reinterpret_cast<const char*>(values.begin()),
+            reader.section(2).data());
+  EXPECT_TRUE(reader.section(3).empty());
+}
+
+TEST(BinaryContainerTest, roundTripMapped) {
+  auto tmp_dir = redex::make_tmp_dir("redex_binary_container_test_%%%%%%%%");
+  auto path = tmp_dir.path + "/container.bin";
+  {
+    std::ofstream ofs(path, std::ios::binary);
+    ofs << write_container();
+  }
+  ContainerReader reader(path);
+  EXPECT_EQ(reader.version(), 7);
+  EXPECT_EQ(reader.section(1), "abc");
+  EXPECT_EQ(reader.array_section<uint64_t>(2).size(), 4);
+}
+
+TEST(BinaryContainerTest, rejectsCorruptData) {
+  auto data = write_container();
+  auto bad_magic = data;
+  bad_magic[0] ^= 1;
+  EXPECT_THROW(ContainerReader(bad_magic.data(), bad_magic.size()),
+               RedexException);
+  auto truncated = data.substr(0, data.size() - 8);
+  EXPECT_THROW(ContainerReader(truncated.data(), truncated.size()),
+               RedexException);
+
+  ContainerReader reader(data.data(), data.size());
+  EXPECT_THROW(reader.section(4), RedexException);
+  EXPECT_THROW(reader.array_section<uint32_t>(1), RedexException);
+}
+
+TEST(BinaryContainerTest, rejectsDuplicateSections) {
+  std::ostringstream oss;
+  ContainerWriter writer(oss, /* version */ 1);
+  writer.begin_section(1);
+  EXPECT_THROW(writer.begin_section(1), RedexException);
+}
@@ -336,6 +336,47 @@ TEST_F(CFGMutationTest, MultipleChanges) {
       ))");
 }
 
+TEST_F(CFGMutationTest, ManyChangesInBlocks) {
+  // The first block is edited in place, the second one needs the CFG to split
+  // it for the return.
+  EXPECT_MUTATION(
+      [](ControlFlowGraph& cfg) {
+        CFGMutation m(cfg);
+
+        m.replace(nth_insn(cfg, 0), {});
+        m.insert_before(nth_insn(cfg, 1), {dasm(OPCODE_CONST, {1_v, 1_L})});
+        m.insert_after(nth_insn(cfg, 1), {dasm(OPCODE_CONST, {3_v, 3_L})});
+        m.insert_before(nth_insn(cfg, 2), {dasm(OPCODE_CONST, {4_v, 4_L})});
+        m.replace(nth_insn(cfg, 2), {dasm(OPCODE_CONST, {5_v, 5_L})});
+        m.insert_before(nth_insn(cfg, 4), {dasm(OPCODE_RETURN_VOID)});
+
+        m.flush();
+      },
+      /* ACTUAL */ R"((
+        (const v7 7)
+        (const v2 2)
+        (const v6 6)
+        (if-eqz v0 :l1)
+        (const v1 1)
+        (return-void)
+        (:l1)
+        (const v2 2)
+        (return-void)
+      ))",
+      /* EXPECTED */ R"((
+        (const v1 1)
+        (const v2 2)
+        (const v3 3)
+        (const v4 4)
+        (const v5 5)
+        (if-eqz v0 :l1)
+        (return-void)
+        (:l1)
+        (const v2 2)
+        (return-void)
+      ))");
+}
+
 TEST_F(CFGMutationTest, Positions) {
   EXPECT_MUTATION(
       [](ControlFlowGraph& cfg) {
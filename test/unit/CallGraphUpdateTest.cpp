@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <queue>
+#include <set>
+
+#include "CallGraph.h"
+#include "Creators.h"
+#include "DexClass.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "MethodOverrideGraph.h"
+#include "RedexTest.h"
+#include "Show.h"
+
+namespace {
+
+using Summary = std::map<std::string, std::multiset<std::string>>;
+
+std::string name(const call_graph::NodeId& node) {
+  if (node->is_entry()) {
+    return "entry";
+  } else if (node->is_exit()) {
+    return "exit";
+  }
+  return show(node->method());
+}
+
+// The edges between the nodes reachable from the entry, which are all that
+// the fixpoint iterators see.
+Summary summarize(const call_graph::Graph& graph) {
+  Summary summary;
+  std::set<call_graph::NodeId> visited;
+  std::queue<call_graph::NodeId> queue;
+  queue.push(graph.entry());
+  while (!queue.empty()) {
+    auto node = queue.front();
+    queue.pop();
+    if (!visited.insert(node).second) {
+      continue;
+    }
+    auto& callees = summary[name(node)];
+    for (const auto& edge : node->callees()) {
+      callees.insert(name(edge->callee()) + "@" +
+                     (edge->invoke_insn() ? show(edge->invoke_insn()) : ""));
+      queue.push(edge->callee());
+    }
+  }
+  return summary;
+}
+
+} // namespace
+
+class CallGraphUpdateTest : public RedexTest {
+ protected:
+  void SetUp() override {
+    ClassCreator creator(DexType::make_type("LFoo;"));
+    creator.set_super(type::java_lang_Object());
+    m_a = make_method(R"(
+      (method (public static) "LFoo;.a:()V"
+        (
+          (invoke-static () "LFoo;.b:()V")
+          (return-void)
+        )
+      )
+    )");
+    m_a->rstate.set_root();
+    m_b = make_method(R"(
+      (method (public static) "LFoo;.b:()V"
+        (
+          (invoke-static () "LFoo;.c:()V")
+          (invoke-static () "LFoo;.c:()V")
+          (return-void)
+        )
+      )
+    )");
+    m_c = make_method(R"(
+      (method (public static) "LFoo;.c:()V"
+        (
+          (return-void)
+        )
+      )
+    )");
+    m_d = make_method(R"(
+      (method (public static) "LFoo;.d:()V"
+        (
+          (invoke-static () "LFoo;.c:()V")
+          (return-void)
+        )
+      )
+    )");
+    for (auto* method : {m_a, m_b, m_c, m_d}) {
+      creator.add_method(method);
+    }
+    m_scope.push_back(creator.create());
+    m_method_override_graph = method_override_graph::build_graph(m_scope);
+  }
+
+  static DexMethod* make_method(const std::string& str) {
+    return assembler::method_from_string(str);
+  }
+
+  call_graph::Graph build() const {
+    return call_graph::single_callee_graph(*m_method_override_graph, m_scope);
+  }
+
+  void set_code(DexMethod* method, const std::string& code) {
+    method->set_code(assembler::ircode_from_string(code));
+  }
+
+  void expect_same_as_rebuilt(const call_graph::Graph& graph) const {
+    auto rebuilt = build();
+    EXPECT_EQ(summarize(graph), summarize(rebuilt));
+    for (const auto& [insn, callees] : rebuilt.get_insn_to_callee()) {
+      auto it = graph.get_insn_to_callee().find(insn);
+      ASSERT_NE(it, graph.get_insn_to_callee().end()) << show(insn);
+      EXPECT_EQ(it->second, callees) << show(insn);
+    }
+  }
+
+  DexMethod* m_a;
+  DexMethod* m_b;
+  DexMethod* m_c;
+  DexMethod* m_d;
+  Scope m_scope;
+  std::unique_ptr<const method_override_graph::Graph> m_method_override_graph;
+};
+
+TEST_F(CallGraphUpdateTest, inlining) {
+  auto graph = build();
+  EXPECT_TRUE(graph.has_node(m_b));
+
+  // Inline b into a.
+  set_code(m_a, R"(
+    (
+      (invoke-static () "LFoo;.c:()V")
+      (invoke-static () "LFoo;.c:()V")
+      (return-void)
+    )
+  )");
+  call_graph::SingleCalleeStrategy strategy(*m_method_override_graph, m_scope);
+  auto stats = graph.update_callers(strategy, {m_a});
+  EXPECT_EQ(stats.edges_removed, 1);
+  EXPECT_EQ(stats.edges_added, 2);
+  EXPECT_EQ(stats.nodes_added, 0);
+  expect_same_as_rebuilt(graph);
+
+  // b is now unreachable, but keeps its node until it is deleted.
+  EXPECT_TRUE(graph.node(m_b)->callers().empty());
+  stats = graph.remove_methods({m_b});
+  EXPECT_EQ(stats.nodes_removed, 1);
+  EXPECT_EQ(stats.edges_removed, 2);
+  EXPECT_FALSE(graph.has_node(m_b));
+  EXPECT_EQ(graph.node(m_c)->callers().size(), 2);
+  expect_same_as_rebuilt(graph);
+}
+
+TEST_F(CallGraphUpdateTest, newCallees) {
+  auto graph = build();
+  EXPECT_FALSE(graph.has_node(m_d));
+
+  // A rewritten call, e.g. a devirtualized one, reaches a method that was not
+  // in the graph, and whose callees are visited in turn.
+  set_code(m_c, R"(
+    (
+      (invoke-static () "LFoo;.d:()V")
+      (return-void)
+    )
+  )");
+  set_code(m_d, R"(
+    (
+      (return-void)
+    )
+  )");
+  call_graph::SingleCalleeStrategy strategy(*m_method_override_graph, m_scope);
+  auto stats = graph.update_callers(strategy, {m_c});
+  EXPECT_EQ(stats.nodes_added, 1);
+  // The exit edge of c is replaced by a call to d, which exits.
+  EXPECT_EQ(stats.edges_removed, 1);
+  EXPECT_EQ(stats.edges_added, 2);
+  EXPECT_TRUE(graph.has_node(m_d));
+  expect_same_as_rebuilt(graph);
+}
+
+TEST_F(CallGraphUpdateTest, removedCalleesExit) {
+  auto graph = build();
+
+  // Delete c, after removing the calls to it.
+  set_code(m_b, R"(
+    (
+      (return-void)
+    )
+  )");
+  auto stats = graph.remove_methods({m_c});
+  EXPECT_EQ(stats.nodes_removed, 1);
+  EXPECT_EQ(stats.edges_removed, 3);
+  // b now exits, as it does in a rebuilt graph.
+  EXPECT_EQ(stats.edges_added, 1);
+  expect_same_as_rebuilt(graph);
+}
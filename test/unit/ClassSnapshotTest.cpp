@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "JarLoader.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+#include "Show.h"
+#include "TypeUtil.h"
+
+class ClassSnapshotTest : public RedexTest {};
+
+TEST_F(ClassSnapshotTest, roundTrip) {
+  auto tmp_dir = redex::make_tmp_dir("ClassSnapshotTest%%%%%%%%");
+  auto path = tmp_dir.path + "/library.snapshot";
+  {
+    ClassCreator cc(DexType::make_type("LFoo;"), "foo.jar");
+    cc.set_external();
+    cc.set_super(type::java_lang_Object());
+    cc.set_access(ACC_PUBLIC);
+    cc.add_interface(DexType::make_type("LBar;"));
+    auto* field = static_cast<DexField*>(DexField::make_field("LFoo;.x:I"));
+    field->set_access(ACC_PUBLIC | ACC_STATIC);
+    field->set_external();
+    cc.add_field(field);
+    auto* method = static_cast<DexMethod*>(
+        DexMethod::make_method("LFoo;.run:(ILjava/lang/String;)V"));
+    method->set_access(ACC_PUBLIC);
+    method->set_virtual(true);
+    method->set_external();
+    cc.add_method(method);
+    ASSERT_TRUE(write_class_snapshot(path.c_str(), {cc.create()}));
+  }
+
+  delete g_redex;
+  g_redex = new RedexContext();
+  Scope classes;
+  ASSERT_TRUE(load_jar_file(path.c_str(), &classes));
+  ASSERT_EQ(classes.size(), 1);
+  auto* cls = classes[0];
+  EXPECT_EQ(show(cls), "LFoo;");
+  EXPECT_TRUE(cls->is_external());
+  EXPECT_EQ(cls->get_location(), "foo.jar");
+  EXPECT_EQ(cls->get_access(), ACC_PUBLIC);
+  EXPECT_EQ(cls->get_super_class(), type::java_lang_Object());
+  ASSERT_EQ(cls->get_interfaces()->size(), 1);
+  EXPECT_EQ(show(cls->get_interfaces()->at(0)), "LBar;");
+
+  ASSERT_EQ(cls->get_sfields().size(), 1);
+  auto* field = cls->get_sfields()[0];
+  EXPECT_EQ(show(field), "LFoo;.x:I");
+  EXPECT_EQ(field->get_access(), ACC_PUBLIC | ACC_STATIC);
+  EXPECT_TRUE(field->is_external());
+
+  ASSERT_EQ(cls->get_vmethods().size(), 1);
+  auto* method = cls->get_vmethods()[0];
+  EXPECT_EQ(show(method), "LFoo;.run:(ILjava/lang/String;)V");
+  EXPECT_EQ(method->get_access(), ACC_PUBLIC);
+  EXPECT_TRUE(method->is_external());
+}
+
+TEST_F(ClassSnapshotTest, rejectsTruncated) {
+  auto tmp_dir = redex::make_tmp_dir("ClassSnapshotTest%%%%%%%%");
+  auto path = tmp_dir.path + "/library.snapshot";
+  ClassCreator cc(DexType::make_type("LFoo;"), "foo.jar");
+  cc.set_external();
+  cc.set_super(type::java_lang_Object());
+  ASSERT_TRUE(write_class_snapshot(path.c_str(), {cc.create()}));
+  boost::filesystem::resize_file(path, boost::filesystem::file_size(path) - 4);
+
+  delete g_redex;
+  g_redex = new RedexContext();
+  EXPECT_FALSE(load_jar_file(path.c_str()));
+}
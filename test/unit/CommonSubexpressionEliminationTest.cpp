@@ -2111,3 +2111,65 @@ TEST_F(CommonSubexpressionEliminationTest, const_regression) {
   )";
   test(Scope{type_class(type::java_lang_Object())}, code_str, expected_str, 1);
 }
+
+TEST_F(CommonSubexpressionEliminationTest, method_barriers_cache) {
+  ClassCreator creator(DexType::make_type("LTestCache;"));
+  creator.set_super(type::java_lang_Object());
+  auto field_x = DexField::make_field("LTestCache;.x:I")
+                     ->make_concrete(ACC_PUBLIC | ACC_STATIC);
+  auto field_y = DexField::make_field("LTestCache;.y:I")
+                     ->make_concrete(ACC_PUBLIC | ACC_STATIC);
+  creator.add_field(field_x);
+  creator.add_field(field_y);
+  auto make_writer = [&](const std::string& name) {
+    auto method = DexMethod::make_method("LTestCache;." + name + ":()V")
+                      ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    method->set_code(assembler::ircode_from_string(R"(
+      (
+        (const v0 0)
+        (sput v0 "LTestCache;.x:I")
+        (return-void)
+      )
+    )"));
+    creator.add_method(method);
+    return method;
+  };
+  auto writer0 = make_writer("writer0");
+  make_writer("writer1");
+  Scope scope{type_class(type::java_lang_Object()), creator.create()};
+
+  cse_impl::MethodBarriersCache cache;
+  auto pure_methods = get_pure_methods();
+  const std::unordered_set<const DexString*> finalish_field_names;
+  method::ClInitHasNoSideEffectsPredicate clinit_has_no_side_effects =
+      [&](const DexType*) { return true; };
+  auto run = [&]() {
+    walk::code(scope, [&](DexMethod*, IRCode& code) {
+      code.build_cfg(/* editable */ true);
+    });
+    cse_impl::SharedState shared_state(pure_methods, finalish_field_names);
+    shared_state.init_scope(scope, clinit_has_no_side_effects, &cache);
+    walk::code(scope, [&](DexMethod*, IRCode& code) { code.clear_cfg(); });
+    return shared_state.get_stats();
+  };
+
+  auto stats = run();
+  EXPECT_EQ(stats.method_barriers, 2);
+  EXPECT_EQ(stats.method_barriers_cache_hits, 0);
+
+  stats = run();
+  EXPECT_EQ(stats.method_barriers, 2);
+  auto hits = stats.method_barriers_cache_hits;
+  EXPECT_GE(hits, 2);
+
+  // Writing another field is a different barrier, which must not be taken
+  // from the cache.
+  for (auto& mie : InstructionIterable(writer0->get_code())) {
+    if (mie.insn->has_field()) {
+      mie.insn->set_field(field_y);
+    }
+  }
+  stats = run();
+  EXPECT_EQ(stats.method_barriers, 2);
+  EXPECT_EQ(stats.method_barriers_cache_hits, hits - 1);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ConcurrentArena.h"
+
+TEST(ConcurrentArenaTest, allocatesAlignedDisjointMemory) {
+  ConcurrentArena arena;
+  std::mutex lock;
+  std::vector<std::pair<char*, size_t>> allocations;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 8; ++t) {
+    threads.emplace_back([&, t] {
+      std::vector<std::pair<char*, size_t>> local;
+      for (size_t i = 0; i < 2000; ++i) {
+        size_t size = 1 + (i * 7 + t) % 100;
+        size_t alignment = size_t(1) << (i % 5);
+        auto* p = static_cast<char*>(arena.allocate(size, alignment));
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % alignment, 0);
+        memset(p, static_cast<int>(t), size);
+        local.emplace_back(p, size);
+      }
+      std::lock_guard<std::mutex> guard(lock);
+      allocations.insert(allocations.end(), local.begin(), local.end());
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::sort(allocations.begin(), allocations.end());
+  for (size_t i = 1; i < allocations.size(); ++i) {
+    EXPECT_LE(allocations[i - 1].first + allocations[i - 1].second,
+              allocations[i].first);
+  }
+}
+
+TEST(ConcurrentArenaTest, largeObjectsGetTheirOwnChunk) {
+  ConcurrentArena arena;
+  auto* small = static_cast<char*>(arena.allocate(8, 8));
+  auto* large = arena.allocate(1024 * 1024, 8);
+  memset(large, 0, 1024 * 1024);
+  // The current chunk is not abandoned.
+  EXPECT_EQ(arena.allocate(8, 8), small + 8);
+  EXPECT_GE(arena.reserved_bytes(), 1024 * 1024);
+}
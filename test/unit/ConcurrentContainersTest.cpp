@@ -311,3 +311,98 @@ TEST_F(ConcurrentContainersTest, concurrentMapTest) {
   map.clear();
   EXPECT_EQ(0, map.size());
 }
+
+TEST_F(ConcurrentContainersTest, readOptimizedConcurrentMapTest) {
+  ReadOptimizedConcurrentMap<std::string, uint32_t> map;
+
+  run_on_samples([&map](const std::vector<uint32_t>& sample) {
+    for (size_t i = 0; i < sample.size(); ++i) {
+      std::string s = std::to_string(sample[i]);
+      map.insert({s, sample[i]});
+      EXPECT_EQ(1, map.count(s));
+      EXPECT_EQ(sample[i], map.at(s));
+    }
+  });
+  EXPECT_EQ(m_data_set.size(), map.size());
+  size_t iterated = 0;
+  for (const auto& entry : map) {
+    EXPECT_EQ(std::to_string(entry.second), entry.first);
+    ++iterated;
+  }
+  EXPECT_EQ(m_data_set.size(), iterated);
+
+  std::unordered_map<uint32_t, size_t> occurrences;
+  for (uint32_t x : m_data) {
+    ++occurrences[x];
+  }
+  // Readers run lock-free against concurrent updates, and must always observe
+  // either the old or the new value.
+  run_on_samples([&map](const std::vector<uint32_t>& sample) {
+    for (size_t i = 0; i < sample.size(); ++i) {
+      std::string s = std::to_string(sample[i]);
+      EXPECT_LE(sample[i], map.get(s, 0));
+      map.update(
+          s, [&s](const std::string& key, uint32_t& value, bool key_exists) {
+            EXPECT_EQ(s, key);
+            EXPECT_TRUE(key_exists);
+            ++value;
+          });
+    }
+  });
+  EXPECT_EQ(m_data_set.size(), map.size());
+  auto check_initial_values =
+      [&](const ReadOptimizedConcurrentMap<std::string, uint32_t>& map) {
+        for (uint32_t x : m_data) {
+          std::string s = std::to_string(x);
+          EXPECT_EQ(1, map.count(s));
+          auto it = map.find(s);
+          EXPECT_NE(map.end(), it);
+          EXPECT_EQ(s, it->first);
+          EXPECT_EQ(x + occurrences[x], it->second);
+        }
+      };
+  check_initial_values(map);
+
+  auto copy = map;
+
+  run_on_subset_samples([&map](const std::vector<uint32_t>& sample) {
+    for (size_t i = 0; i < sample.size(); ++i) {
+      map.erase(std::to_string(sample[i]));
+    }
+  });
+
+  for (uint32_t x : m_subset_data) {
+    std::string s = std::to_string(x);
+    EXPECT_EQ(0, map.count(s));
+    EXPECT_EQ(map.end(), map.find(s));
+  }
+
+  run_on_samples([&map](const std::vector<uint32_t>& sample) {
+    for (size_t i = 0; i < sample.size(); ++i) {
+      map.erase(std::to_string(sample[i]));
+    }
+  });
+  EXPECT_EQ(0, map.size());
+  EXPECT_EQ(map.end(), map.begin());
+  for (uint32_t x : m_data) {
+    std::string s = std::to_string(x);
+    EXPECT_EQ(0, map.count(s));
+    EXPECT_EQ(map.end(), map.find(s));
+  }
+
+  // Check that copy is unchanged.
+  check_initial_values(copy);
+
+  auto moved = std::move(copy);
+  check_initial_values(moved);
+
+  map.insert({{"a", 1}, {"b", 2}, {"c", 3}});
+  EXPECT_EQ(3, map.size());
+  map.insert_or_assign({"a", 4});
+  EXPECT_EQ(4, map.at("a"));
+  EXPECT_FALSE(map.emplace("b", 5));
+  EXPECT_EQ(2, map.at("b"));
+  EXPECT_THROW(map.at("d"), std::out_of_range);
+  map.clear();
+  EXPECT_EQ(0, map.size());
+}
@@ -2669,3 +2669,39 @@ TEST_F(ControlFlowTest, non_editable_cfg_case_keys) {
   EXPECT_EQ(case_keys.at(0), 0);
   EXPECT_EQ(case_keys.at(1), 1);
 }
+
+TEST_F(ControlFlowTest, mutationEpoch) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (if-eqz v0 :true)
+      (const v1 0)
+      (return v1)
+      (:true)
+      (const v1 1)
+      (return v1)
+    )
+)");
+  auto epoch = code->mutation_epoch();
+
+  // Building and clearing a CFG without edits doesn't count.
+  code->build_cfg();
+  code->clear_cfg();
+  EXPECT_EQ(code->mutation_epoch(), epoch);
+
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  EXPECT_EQ(code->mutation_epoch(), epoch);
+  auto* insn = new IRInstruction(OPCODE_CONST);
+  insn->set_dest(1)->set_literal(2);
+  cfg.insert_before(cfg.entry_block()->to_cfg_instruction_iterator(
+                        cfg.entry_block()->get_last_insn()),
+                    insn);
+  auto cfg_epoch = code->mutation_epoch();
+  EXPECT_GT(cfg_epoch, epoch);
+  code->clear_cfg();
+  EXPECT_EQ(code->mutation_epoch(), cfg_epoch);
+
+  code->push_back(new IRInstruction(OPCODE_NOP));
+  EXPECT_GT(code->mutation_epoch(), cfg_epoch);
+}
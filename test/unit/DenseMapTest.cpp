@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <atomic>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <unordered_set>
+
+#include "DenseMap.h"
+#include "DexClass.h"
+#include "RedexContext.h"
+#include "RedexTest.h"
+#include "WorkQueue.h"
+
+class DenseMapTest : public RedexTest {};
+
+TEST_F(DenseMapTest, idsAreDenseAndStable) {
+  auto num_ids = g_redex->num_type_ids();
+  auto* foo = DexType::make_type("LFoo;");
+  auto* bar = DexType::make_type("LBar;");
+  EXPECT_EQ(foo->get_id(), num_ids);
+  EXPECT_EQ(bar->get_id(), num_ids + 1);
+  EXPECT_EQ(DexType::make_type("LFoo;"), foo);
+  EXPECT_EQ(g_redex->num_type_ids(), num_ids + 2);
+
+  foo->set_name(DexString::make_string("LBaz;"));
+  EXPECT_EQ(foo->get_id(), num_ids);
+
+  auto* f1 = DexField::make_field("LFoo;.a:I");
+  auto* f2 = DexField::make_field("LFoo;.b:I");
+  EXPECT_NE(f1->get_id(), f2->get_id());
+  EXPECT_LT(f2->get_id(), g_redex->num_field_ids());
+
+  auto* m1 = DexMethod::make_method("LFoo;.a:()V");
+  auto* m2 = DexMethod::make_method("LFoo;.b:()V");
+  EXPECT_NE(m1->get_id(), m2->get_id());
+  EXPECT_LT(m2->get_id(), g_redex->num_method_ids());
+}
+
+TEST_F(DenseMapTest, valuesAcrossSegments) {
+  // Create enough methods to fill a few segments.
+  std::vector<DexMethodRef*> methods;
+  for (size_t i = 0; i < 10000; ++i) {
+    methods.push_back(
+        DexMethod::make_method("LFoo;.m" + std::to_string(i) + ":()V"));
+  }
+
+  DenseMap<DexMethodRef, size_t> map;
+  EXPECT_EQ(map.find(methods[0]), nullptr);
+  for (size_t i = 0; i < methods.size(); ++i) {
+    EXPECT_EQ(map[methods[i]], 0);
+    map[methods[i]] = i + 1;
+  }
+  for (size_t i = 0; i < methods.size(); ++i) {
+    ASSERT_NE(map.find(methods[i]), nullptr);
+    EXPECT_EQ(*map.find(methods[i]), i + 1);
+  }
+}
+
+TEST_F(DenseMapTest, concurrentGrowth) {
+  std::vector<DexType*> types;
+  for (size_t i = 0; i < 20000; ++i) {
+    types.push_back(DexType::make_type("LT" + std::to_string(i) + ";"));
+  }
+  std::unordered_set<uint32_t> ids;
+  for (auto* type : types) {
+    EXPECT_TRUE(ids.insert(type->get_id()).second);
+  }
+
+  DenseMap<DexType, std::atomic<uint32_t>> map;
+  std::vector<size_t> indices(types.size() * 4);
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) { map[types[i % types.size()]].fetch_add(1); }, indices,
+      /* num_threads */ 8);
+  for (auto* type : types) {
+    EXPECT_EQ(map[type].load(), 4);
+  }
+}
@@ -172,3 +172,21 @@ TEST_F(DexClassTest, testObfuscatedNames) {
   EXPECT_EQ(field->get_deobfuscated_name_or_empty(), "Lbaz;.bar:I");
   EXPECT_EQ(field->get_simple_deobfuscated_name(), "bar");
 }
+
+TEST_F(DexClassTest, qualifiedNames) {
+  auto method = DexMethod::make_method("LFoo;.bar:(LBaz;)V");
+  auto field = DexField::make_field("LFoo;.baz:LBaz;");
+  auto method_name = method->get_qualified_name();
+  EXPECT_EQ(method_name->str(), "LFoo;.bar:(LBaz;)V");
+  EXPECT_EQ(method->get_qualified_name(), method_name);
+  EXPECT_EQ(field->get_qualified_name()->str(), "LFoo;.baz:LBaz;");
+
+  DexMethodSpec spec;
+  spec.name = DexString::make_string("qux");
+  method->change(spec, /* rename_on_collision */ false);
+  EXPECT_EQ(method->get_qualified_name()->str(), "LFoo;.qux:(LBaz;)V");
+
+  DexType::make_type("LBaz;")->set_name(DexString::make_string("LQuux;"));
+  EXPECT_EQ(method->get_qualified_name()->str(), "LFoo;.qux:(LQuux;)V");
+  EXPECT_EQ(field->get_qualified_name()->str(), "LFoo;.baz:LQuux;");
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "DexHasher.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+
+namespace {
+
+bool operator==(const hashing::DexHash& a, const hashing::DexHash& b) {
+  return a.positions_hash == b.positions_hash &&
+         a.registers_hash == b.registers_hash && a.code_hash == b.code_hash &&
+         a.signature_hash == b.signature_hash;
+}
+
+} // namespace
+
+struct DexHasherTest : public RedexTest {};
+
+TEST_F(DexHasherTest, codeHashCacheFollowsEdits) {
+  auto method0 = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.bar:(I)I"
+     (
+      (load-param v0)
+      (.pos:dbg_0 "LFoo;.bar:(I)I" "Foo.java" 10)
+      (add-int/lit8 v0 v0 1)
+      (return v0)
+     )
+    )
+  )");
+  auto method1 = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.baz:()V"
+     (
+      (return-void)
+     )
+    )
+  )");
+  Scope scope{assembler::class_with_methods("LFoo;", {method0, method1})};
+
+  auto initial = hashing::DexScopeHasher(scope).run();
+  hashing::CodeHashCache code_hashes;
+  EXPECT_TRUE(hashing::DexScopeHasher(scope, &code_hashes).run() == initial);
+  EXPECT_TRUE(hashing::DexScopeHasher(scope, &code_hashes).run() == initial);
+
+  // An edit through the API of the code is noticed.
+  method0->get_code()->set_registers_size(2);
+  auto edited = hashing::DexScopeHasher(scope).run();
+  EXPECT_FALSE(edited == initial);
+  EXPECT_TRUE(hashing::DexScopeHasher(scope, &code_hashes).run() == edited);
+
+  // So is an edit in place that is marked.
+  for (auto& mie : InstructionIterable(method0->get_code())) {
+    if (mie.insn->opcode() == OPCODE_ADD_INT_LIT8) {
+      mie.insn->set_literal(2);
+    }
+  }
+  method0->get_code()->mark_mutated();
+  auto edited_in_place = hashing::DexScopeHasher(scope).run();
+  EXPECT_FALSE(edited_in_place == edited);
+  EXPECT_TRUE(hashing::DexScopeHasher(scope, &code_hashes).run() ==
+              edited_in_place);
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "DexOutputCache.h"
+#include "IRAssembler.h"
+#include "RedexOptions.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+
+namespace {
+
+DexClass* make_class(const std::string& name, const std::string& method) {
+  ClassCreator cc(DexType::make_type(name));
+  cc.set_super(type::java_lang_Object());
+  cc.add_method(assembler::method_from_string(method));
+  return cc.create();
+}
+
+// The key of `classes` in a cache created from `config`, or "<none>" if the
+// configuration cannot be cached.
+std::string config_key(const Json::Value& config,
+                       const RedexOptions& redex_options,
+                       const std::vector<DexClass*>& classes) {
+  ConfigFiles conf(config);
+  auto cache = DexOutputCache::create(conf, redex_options, "dex\n035",
+                                      /* emit_locators */ false,
+                                      /* post_lowering */ false);
+  return cache ? cache->key(classes) : "<none>";
+}
+
+} // namespace
+
+struct DexOutputCacheTest : public RedexTest {};
+
+TEST_F(DexOutputCacheTest, looksUpRecordedEntry) {
+  auto tmp_dir = redex::make_tmp_dir("redex_dex_output_cache_test_%%%%%%%%");
+  DexOutputCache cache(tmp_dir.path, "salt");
+  auto key = cache.key({});
+
+  DexOutputCache::Entry entry;
+  EXPECT_FALSE(cache.lookup(key, &entry));
+  entry.dex = std::string("dex\n039\0\1\2", 11);
+  entry.stats.num_classes = 3;
+  entry.stats.code_bytes = 1234;
+  entry.bytecode_offsets = {{"LFoo;.bar:()V", 112}, {"LFoo;.baz:()V", 160}};
+  cache.record(key, entry);
+
+  DexOutputCache::Entry cached;
+  EXPECT_TRUE(cache.lookup(key, &cached));
+  EXPECT_EQ(cached.dex, entry.dex);
+  EXPECT_EQ(cached.stats.num_classes, 3);
+  EXPECT_EQ(cached.stats.code_bytes, 1234);
+  EXPECT_EQ(cached.bytecode_offsets, entry.bytecode_offsets);
+
+  // Truncate the entry by rewriting all of its files.
+  for (auto& file :
+       boost::filesystem::recursive_directory_iterator(tmp_dir.path)) {
+    if (boost::filesystem::is_regular_file(file.path())) {
+      std::ofstream out(file.path().string(), std::ofstream::binary);
+      out << "\x04";
+    }
+  }
+  DexOutputCache::Entry truncated;
+  EXPECT_FALSE(cache.lookup(key, &truncated));
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(cache.misses(), 2);
+}
+
+TEST_F(DexOutputCacheTest, keyDependsOnInputDex) {
+  auto* foo = make_class("LFoo;", R"(
+    (method (public static) "LFoo;.get:()I"
+      (
+        (sget "LBar;.f:I")
+        (move-result-pseudo v0)
+        (return v0)
+      )
+    )
+  )");
+  auto* baz = make_class("LBaz;", R"(
+    (method (public static) "LBaz;.get:()I"
+      (
+        (const v0 0)
+        (return v0)
+      )
+    )
+  )");
+  DexOutputCache cache("unused", "salt");
+  auto key = cache.key({foo, baz});
+  EXPECT_EQ(cache.key({foo, baz}), key);
+  EXPECT_NE(cache.key({baz, foo}), key);
+  EXPECT_NE(cache.key({foo}), key);
+
+  foo->set_source_file(DexString::make_string("Foo.java"));
+  EXPECT_NE(cache.key({foo, baz}), key);
+  key = cache.key({foo, baz});
+
+  // A reference to a field of the same name and type in another class.
+  auto* sget = foo->get_dmethods()[0]->get_code()->begin()->insn;
+  sget->set_field(DexField::make_field("LQux;.f:I"));
+  EXPECT_NE(cache.key({foo, baz}), key);
+}
+
+TEST_F(DexOutputCacheTest, keyDependsOnConfig) {
+  auto* foo = make_class("LFoo;", R"(
+    (method (public static) "LFoo;.get:()V"
+      (
+        (return-void)
+      )
+    )
+  )");
+  auto tmp_dir = redex::make_tmp_dir("redex_dex_output_cache_test_%%%%%%%%");
+  Json::Value config;
+  config["dex_output_cache_dir"] = tmp_dir.path;
+  RedexOptions redex_options;
+  auto base = config_key(config, redex_options, {foo});
+  ASSERT_NE(base, "<none>");
+  EXPECT_EQ(config_key(config, redex_options, {foo}), base);
+  EXPECT_NE(DexOutputCache(tmp_dir.path, "other").key({foo}), base);
+
+  auto min_sdk = redex_options;
+  min_sdk.min_sdk = 21;
+  EXPECT_NE(config_key(config, min_sdk, {foo}), base);
+
+  auto string_sort = config;
+  string_sort["string_sort_mode"] = "class_order";
+  EXPECT_NE(config_key(string_sort, redex_options, {foo}), base);
+
+  auto code_sort = config;
+  code_sort["bytecode_sort_mode"] = "method_similarity_order";
+  EXPECT_NE(config_key(code_sort, redex_options, {foo}), base);
+  code_sort["disable_method_similarity_order"] = true;
+  EXPECT_EQ(config_key(code_sort, redex_options, {foo}), base);
+
+  auto lowering = config;
+  lowering["lower_with_cfg"] = false;
+  EXPECT_NE(config_key(lowering, redex_options, {foo}), base);
+
+  // Outputs that depend on profiles or on other dexes are not cached.
+  auto profiled = config;
+  profiled["bytecode_sort_mode"] = "method_profiled_order";
+  EXPECT_EQ(config_key(profiled, redex_options, {foo}), "<none>");
+  auto symbolicated = redex_options;
+  symbolicated.debug_info_kind = DebugInfoKind::PerMethodDebug;
+  EXPECT_EQ(config_key(config, symbolicated, {foo}), "<none>");
+
+  Json::Value disabled;
+  EXPECT_EQ(config_key(disabled, redex_options, {foo}), "<none>");
+}
@@ -6,8 +6,12 @@
  */
 
 #include "DexOutput.h"
+#include <atomic>
 #include <gtest/gtest.h>
 #include <json/json.h>
+#include <vector>
+
+#include "WorkQueue.h"
 
 TEST(DexOutput, checkMethodInstructionSizeLimit) {
 
@@ -24,3 +28,67 @@ TEST(DexOutput, checkMethodInstructionSizeLimit) {
       DexOutput::check_method_instruction_size_limit(conf, 65537, "method"),
       RedexException);
 }
+
+namespace {
+
+constexpr size_t NUM_DEXES = 64;
+constexpr unsigned int NUM_THREADS = 8;
+
+// Runs `fn` for every dex, claiming the dexes in order, like redex-all does.
+template <typename Fn>
+void run_dexes(const Fn& fn) {
+  std::atomic<size_t> next_dex{0};
+  auto wq = workqueue_foreach<size_t>(
+      [&](size_t) {
+        for (size_t i; (i = next_dex.fetch_add(1)) < NUM_DEXES;) {
+          fn(i);
+        }
+      },
+      NUM_THREADS);
+  for (size_t i = 0; i < NUM_THREADS; ++i) {
+    wq.add_item(i);
+  }
+  wq.run_all();
+}
+
+} // namespace
+
+TEST(DexOutput, sequencerRunsStepsInDexOrder) {
+  DexOutputSequencer sequencer;
+  std::vector<size_t> debug_items;
+  std::vector<size_t> symbol_files;
+  run_dexes([&](size_t i) {
+    sequencer.run_in_order(DexOutputSequencer::Step::DebugItems, i,
+                           [&] { debug_items.push_back(i); });
+    sequencer.run_in_order(DexOutputSequencer::Step::SymbolFiles, i,
+                           [&] { symbol_files.push_back(i); });
+  });
+
+  ASSERT_EQ(debug_items.size(), NUM_DEXES);
+  ASSERT_EQ(symbol_files.size(), NUM_DEXES);
+  for (size_t i = 0; i < NUM_DEXES; ++i) {
+    EXPECT_EQ(debug_items[i], i);
+    EXPECT_EQ(symbol_files[i], i);
+  }
+}
+
+TEST(DexOutput, sequencerGuardUnblocksFollowingDexes) {
+  constexpr size_t FAILING_DEX = 5;
+  DexOutputSequencer sequencer;
+  std::vector<size_t> symbol_files;
+  EXPECT_ANY_THROW(run_dexes([&](size_t i) {
+    DexOutputSequencer::Guard guard(&sequencer, i);
+    sequencer.run_in_order(DexOutputSequencer::Step::DebugItems, i, [&] {
+      if (i == FAILING_DEX) {
+        throw std::runtime_error("failed dex");
+      }
+    });
+    sequencer.run_in_order(DexOutputSequencer::Step::SymbolFiles, i,
+                           [&] { symbol_files.push_back(i); });
+  }));
+
+  ASSERT_EQ(symbol_files.size(), NUM_DEXES - 1);
+  for (size_t i = 0; i < NUM_DEXES - 1; ++i) {
+    EXPECT_EQ(symbol_files[i], i < FAILING_DEX ? i : i + 1);
+  }
+}
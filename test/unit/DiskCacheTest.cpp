@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+#include <sstream>
+
+#include "DiskCache.h"
+#include "RedexTestUtils.h"
+
+namespace {
+
+std::string read(DiskCache& cache, const std::string& key) {
+  auto in = cache.open(key);
+  if (!in) {
+    return "<none>";
+  }
+  std::ostringstream oss;
+  oss << in.rdbuf();
+  return oss.str();
+}
+
+} // namespace
+
+TEST(DiskCacheTest, keys) {
+  auto key = DiskCache::key("foo\nbar");
+  EXPECT_EQ(key.size(), 40);
+  EXPECT_EQ(DiskCache::key("foo\nbar"), key);
+  EXPECT_NE(DiskCache::key("foo\nbaz"), key);
+
+  DiskCache::KeyHasher hasher;
+  hasher.update("foo\n");
+  hasher.update("bar", 3);
+  EXPECT_EQ(hasher.finish(), key);
+}
+
+TEST(DiskCacheTest, writesEntriesAtomically) {
+  auto tmp_dir = redex::make_tmp_dir("redex_disk_cache_test_%%%%%%%%");
+  DiskCache cache(tmp_dir.path);
+  auto key = DiskCache::key("foo");
+  EXPECT_EQ(read(cache, key), "<none>");
+
+  cache.write(key, [](std::ostream& out) { out << "first"; });
+  EXPECT_EQ(read(cache, key), "first");
+  cache.write(key, [](std::ostream& out) { out << "second"; });
+  EXPECT_EQ(read(cache, key), "second");
+
+  // A failed write leaves the previous entry, and no temporary file behind.
+  cache.write(key, [](std::ostream& out) {
+    out << "partial";
+    out.setstate(std::ios::failbit);
+  });
+  EXPECT_EQ(read(cache, key), "second");
+
+  // The entry is sharded on the first byte of its key.
+  auto shard = boost::filesystem::path(tmp_dir.path) / key.substr(0, 2);
+  EXPECT_EQ(cache.path(key), (shard / key.substr(2)).string());
+  size_t num_files = 0;
+  for (const auto& file : boost::filesystem::recursive_directory_iterator(
+           tmp_dir.path)) {
+    if (boost::filesystem::is_regular_file(file.path())) {
+      ++num_files;
+    }
+  }
+  EXPECT_EQ(num_files, 1);
+}
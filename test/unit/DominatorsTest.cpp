@@ -39,6 +39,66 @@ TEST(DominatorsTest, loop) {
   EXPECT_EQ(doms.get_idom(3), 0);
 }
 
+TEST(DominatorsTest, dominatorTree) {
+  //     +---+     +---+     +---+
+  //     | 0 | --> | 1 | --> | 3 |
+  //     +---+     +---+     +---+
+  //       |         |  ^
+  //       |         v  |
+  //       |       +---+
+  //       +-----> | 2 |     +---+
+  //               +---+     | 5 | (unreachable)
+  //                 |       +---+
+  //                 v
+  //               +---+
+  //               | 4 |
+  //               +---+
+  GraphInterface::Graph graph;
+  graph.add_edge(0, 1);
+  graph.add_edge(0, 2);
+  graph.add_edge(1, 2);
+  graph.add_edge(2, 1);
+  graph.add_edge(1, 3);
+  graph.add_edge(2, 4);
+  graph.add_edge(5, 4);
+  dominators::DominatorTree<GraphInterface> tree(graph);
+  EXPECT_EQ(tree.get_idom(1), 0);
+  EXPECT_EQ(tree.get_idom(4), 2);
+  for (uint32_t node = 0; node < 5; ++node) {
+    EXPECT_TRUE(tree.dominates(0, node));
+    EXPECT_TRUE(tree.dominates(node, node));
+    EXPECT_FALSE(tree.strictly_dominates(node, node));
+  }
+  EXPECT_TRUE(tree.strictly_dominates(1, 3));
+  EXPECT_TRUE(tree.strictly_dominates(2, 4));
+  EXPECT_FALSE(tree.dominates(1, 2));
+  EXPECT_FALSE(tree.dominates(2, 1));
+  EXPECT_FALSE(tree.dominates(1, 4));
+  EXPECT_FALSE(tree.dominates(3, 1));
+  EXPECT_FALSE(tree.dominates(5, 4));
+  EXPECT_FALSE(tree.dominates(0, 5));
+}
+
+TEST(DominatorsTest, deepDominatorTree) {
+  // A chain of diamonds, where every join node is dominated by all the ones
+  // before it.
+  constexpr uint32_t num_diamonds = 100000;
+  GraphInterface::Graph graph;
+  for (uint32_t i = 0; i < num_diamonds; ++i) {
+    graph.add_edge(3 * i, 3 * i + 1);
+    graph.add_edge(3 * i, 3 * i + 2);
+    graph.add_edge(3 * i + 1, 3 * i + 3);
+    graph.add_edge(3 * i + 2, 3 * i + 3);
+  }
+  dominators::DominatorTree<GraphInterface> tree(graph);
+  uint32_t last = 3 * num_diamonds;
+  EXPECT_EQ(tree.get_idom(last), last - 3);
+  EXPECT_TRUE(tree.dominates(0, last));
+  EXPECT_TRUE(tree.dominates(last / 2, last));
+  EXPECT_FALSE(tree.dominates(last - 1, last));
+  EXPECT_FALSE(tree.dominates(last, last - 3));
+}
+
 TEST(GraphUtilTest, doubleLoop) {
   {
     //                 +---------+
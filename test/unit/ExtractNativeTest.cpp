@@ -15,3 +15,19 @@ TEST(ExtractNativeTest, empty) {
   auto overset = extract_classes_from_native_lib(over);
   EXPECT_EQ(overset.size(), 2);
 }
+
+TEST(ExtractNativeTest, chunks) {
+  std::string lib = std::string(16, '\0') + "com/foo/Bar" +
+                    std::string(3, '\1') + "Lcom/foo/Baz$Inner;" +
+                    std::string(600, 'x') + "\n" + "ABCcom/foo/Qux_1" +
+                    std::string(9, '\377') + "org/sh";
+  auto expected = extract_classes_from_native_lib(lib);
+  EXPECT_EQ(expected.count("Lcom/foo/Bar;"), 1);
+  EXPECT_EQ(expected.count("Lcom/foo/Baz$Inner;"), 1);
+  EXPECT_EQ(expected.count("Lcom/foo/Qux_1;"), 1);
+  EXPECT_EQ(expected.count("Lorg/sh;"), 0);
+  for (size_t chunk_size = 1; chunk_size <= lib.size(); ++chunk_size) {
+    EXPECT_EQ(extract_classes_from_native_lib(lib, chunk_size), expected)
+        << chunk_size;
+  }
+}
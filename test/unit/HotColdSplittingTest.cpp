@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <gtest/gtest.h>
+
+#include "HotColdSplittingPass.h"
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+#include "Show.h"
+
+class HotColdSplittingTest : public RedexTest {
+ public:
+  static DexMethod* create(const std::string& code_str) {
+    ClassCreator cc{DexType::make_type("LFoo;")};
+    cc.set_super(type::java_lang_Object());
+    auto m = DexMethod::make_method("LFoo;.bar:(ILjava/lang/String;)I")
+                 ->make_concrete(ACC_PUBLIC | ACC_STATIC,
+                                 assembler::ircode_from_string(code_str),
+                                 false);
+    cc.add_method(m);
+    cc.create();
+    return m;
+  }
+
+  static std::vector<DexMethod*> split(DexMethod* m,
+                                       HotColdSplittingPass::Stats* stats) {
+    HotColdSplittingPass::Config config;
+    config.min_region_size = 1;
+    return HotColdSplittingPass::split(m, config, stats);
+  }
+
+  static size_t count_invokes_of(DexMethod* m, DexMethod* callee) {
+    size_t count = 0;
+    for (const auto& mie : InstructionIterable(m->get_code())) {
+      if (mie.insn->opcode() == OPCODE_INVOKE_STATIC &&
+          mie.insn->get_method() == callee) {
+        count++;
+      }
+    }
+    return count;
+  }
+};
+
+TEST_F(HotColdSplittingTest, splitsColdRegion) {
+  auto* m = create(R"(
+    (
+      (load-param v0)
+      (load-param-object v1)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 0 (1.0 1.0))
+      (if-eqz v0 :cold)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 1 (1.0 1.0))
+      (return v0)
+      (:cold)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 2 (0.0 0.0))
+      (invoke-virtual (v1) "Ljava/lang/String;.length:()I")
+      (move-result v2)
+      (add-int v2 v2 v0)
+      (return v2)
+    )
+  )");
+  HotColdSplittingPass::Stats stats;
+  auto split_methods = split(m, &stats);
+  ASSERT_EQ(split_methods.size(), 1);
+  EXPECT_EQ(stats.hot_methods, 1);
+  EXPECT_EQ(stats.methods_split, 1);
+  EXPECT_EQ(stats.regions_split, 1);
+  EXPECT_GT(stats.code_units_moved, 0);
+
+  auto* split_method = split_methods.front();
+  EXPECT_EQ(show(split_method->get_proto()), "(ILjava/lang/String;)I");
+  EXPECT_TRUE(is_static(split_method));
+  EXPECT_TRUE(is_private(split_method));
+  EXPECT_EQ(count_invokes_of(m, split_method), 1);
+  for (const auto& mie : InstructionIterable(m->get_code())) {
+    EXPECT_NE(mie.insn->opcode(), OPCODE_INVOKE_VIRTUAL) << show(m);
+  }
+  // The source blocks of the region moved, and the call site has its own.
+  std::vector<uint32_t> source_block_ids;
+  for (const auto& mie : *m->get_code()) {
+    if (mie.type == MFLOW_SOURCE_BLOCK) {
+      source_block_ids.push_back(mie.src_block->id);
+    }
+  }
+  std::sort(source_block_ids.begin(), source_block_ids.end());
+  EXPECT_EQ(source_block_ids,
+            std::vector<uint32_t>({0, 1, SourceBlock::kSyntheticId}));
+
+  auto expected = assembler::ircode_from_string(R"(
+    (
+      (load-param v3)
+      (load-param-object v4)
+      (move v0 v3)
+      (move-object v1 v4)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 2 (0.0 0.0))
+      (invoke-virtual (v1) "Ljava/lang/String;.length:()I")
+      (move-result v2)
+      (add-int v2 v2 v0)
+      (return v2)
+    )
+  )");
+  EXPECT_CODE_EQ(split_method->get_code(), expected.get());
+}
+
+TEST_F(HotColdSplittingTest, ignoresColdMethods) {
+  auto* m = create(R"(
+    (
+      (load-param v0)
+      (load-param-object v1)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 0 (0.0 0.0))
+      (if-eqz v0 :cold)
+      (return v0)
+      (:cold)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 1 (0.0 0.0))
+      (invoke-virtual (v1) "Ljava/lang/String;.length:()I")
+      (move-result v2)
+      (return v2)
+    )
+  )");
+  HotColdSplittingPass::Stats stats;
+  EXPECT_TRUE(split(m, &stats).empty());
+  EXPECT_EQ(stats.hot_methods, 0);
+}
+
+TEST_F(HotColdSplittingTest, ignoresRegionsRejoiningHotCode) {
+  auto* m = create(R"(
+    (
+      (load-param v0)
+      (load-param-object v1)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 0 (1.0 1.0))
+      (if-eqz v0 :cold)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 1 (1.0 1.0))
+      (:join)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 2 (1.0 1.0))
+      (return v0)
+      (:cold)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 3 (0.0 0.0))
+      (invoke-virtual (v1) "Ljava/lang/String;.length:()I")
+      (move-result v0)
+      (goto :join)
+    )
+  )");
+  HotColdSplittingPass::Stats stats;
+  EXPECT_TRUE(split(m, &stats).empty());
+  EXPECT_EQ(stats.hot_methods, 1);
+}
+
+TEST_F(HotColdSplittingTest, ignoresUntypedLiveIns) {
+  auto* m = create(R"(
+    (
+      (load-param v0)
+      (load-param-object v1)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 0 (1.0 1.0))
+      (const v2 0)
+      (if-eqz v0 :cold)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 1 (1.0 1.0))
+      (return v0)
+      (:cold)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 2 (0.0 0.0))
+      (invoke-virtual (v1) "Ljava/lang/String;.length:()I")
+      (move-result v3)
+      (add-int v3 v3 v2)
+      (return v3)
+    )
+  )");
+  HotColdSplittingPass::Stats stats;
+  EXPECT_TRUE(split(m, &stats).empty());
+  EXPECT_EQ(stats.regions_unsupported_live_ins, 1);
+}
+
+TEST_F(HotColdSplittingTest, ignoresCopiesOfNarrowLiveIns) {
+  auto* m = create(R"(
+    (
+      (load-param v0)
+      (load-param-object v1)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 0 (1.0 1.0))
+      (if-eqz v0 :cold)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 1 (1.0 1.0))
+      (return v0)
+      (:cold)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 2 (0.0 0.0))
+      (move v2 v0)
+      (move v3 v2)
+      (invoke-static (v3) "LFoo;.baz:(Z)V")
+      (return v0)
+    )
+  )");
+  HotColdSplittingPass::Stats stats;
+  EXPECT_TRUE(split(m, &stats).empty());
+  EXPECT_EQ(stats.regions_unsupported_live_ins, 1);
+}
+
+TEST_F(HotColdSplittingTest, ignoresCopiesOfUninitializedLiveIns) {
+  auto* m = create(R"(
+    (
+      (load-param v0)
+      (load-param-object v1)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 0 (1.0 1.0))
+      (new-instance "LBar;")
+      (move-result-pseudo-object v2)
+      (if-eqz v0 :cold)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 1 (1.0 1.0))
+      (return v0)
+      (:cold)
+      (.src_block "LFoo;.bar:(ILjava/lang/String;)I" 2 (0.0 0.0))
+      (move-object v3 v2)
+      (invoke-direct (v3) "LBar;.<init>:()V")
+      (return v0)
+    )
+  )");
+  HotColdSplittingPass::Stats stats;
+  EXPECT_TRUE(split(m, &stats).empty());
+  EXPECT_EQ(stats.regions_unsupported_live_ins, 1);
+}
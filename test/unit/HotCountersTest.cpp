@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <map>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "HotCounters.h"
+#include "WorkQueue.h"
+
+#if REDEX_HOT_COUNTERS
+
+namespace {
+
+hot_counters::Counter s_counter("HotCountersTest.counter");
+hot_counters::Counter s_unused("HotCountersTest.unused");
+hot_counters::Histogram s_histogram("HotCountersTest.histogram");
+
+std::map<std::string, int64_t> report_since(
+    const hot_counters::Snapshot& before) {
+  std::map<std::string, int64_t> metrics;
+  hot_counters::report_since(
+      before, [&](const std::string& key, int64_t value) {
+        metrics[key] = value;
+      });
+  return metrics;
+}
+
+} // namespace
+
+TEST(HotCountersTest, countsAcrossThreads) {
+  auto before = hot_counters::snapshot();
+  std::vector<int> items(1000);
+  workqueue_run<int>([](int) { s_counter.add(3); }, items, 8);
+  EXPECT_EQ(s_counter.get(), 3000);
+
+  auto metrics = report_since(before);
+  EXPECT_EQ(metrics.at("HotCountersTest.counter"), 3000);
+  // Counters that did not change are not reported.
+  EXPECT_EQ(metrics.count("HotCountersTest.unused"), 0);
+  EXPECT_EQ(metrics.count("HotCountersTest.histogram.count"), 0);
+}
+
+TEST(HotCountersTest, histogram) {
+  auto before = hot_counters::snapshot();
+  for (uint64_t i = 0; i < 100; ++i) {
+    s_histogram.add(i < 98 ? 5 : 1000);
+  }
+  auto metrics = report_since(before);
+  EXPECT_EQ(metrics.at("HotCountersTest.histogram.count"), 100);
+  EXPECT_EQ(metrics.at("HotCountersTest.histogram.sum"), 98 * 5 + 2 * 1000);
+  // 5 is in the bucket [4, 8), 1000 in [512, 1024).
+  EXPECT_EQ(metrics.at("HotCountersTest.histogram.p50"), 7);
+  EXPECT_EQ(metrics.at("HotCountersTest.histogram.p99"), 1023);
+}
+
+TEST(HotCountersTest, countersDeclaredLater) {
+  auto before = hot_counters::snapshot();
+  static hot_counters::Counter s_later("HotCountersTest.later");
+  s_later.add();
+  EXPECT_EQ(report_since(before).at("HotCountersTest.later"), 1);
+}
+
+#endif // REDEX_HOT_COUNTERS
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "ControlFlow.h"
+#include "IRArena.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "RedexTest.h"
+
+struct IRArenaTest : public RedexTest {
+  IRArenaTest() { IRArena::set_enabled(true); }
+  ~IRArenaTest() { IRArena::set_enabled(false); }
+};
+
+TEST_F(IRArenaTest, objectsOutliveOwner) {
+  auto* arena = IRArena::create(0);
+  std::vector<IRInstruction*> insns;
+  {
+    IRArena::Scope scope(arena);
+    for (size_t i = 0; i < 1000; ++i) {
+      auto* insn = new IRInstruction(OPCODE_INVOKE_STATIC);
+      // Spill the source registers.
+      insn->set_srcs_size(6);
+      for (size_t j = 0; j < 6; ++j) {
+        insn->set_src(j, i + j);
+      }
+      insns.push_back(insn);
+    }
+  }
+  // Not allocated in the arena, as it is out of scope.
+  auto* heap_insn = new IRInstruction(OPCODE_NOP);
+
+  // Objects can be freed individually, before and after the owner lets go.
+  for (size_t i = 0; i < insns.size(); i += 2) {
+    delete insns[i];
+  }
+  arena->release_owner();
+  for (size_t i = 1; i < insns.size(); i += 2) {
+    EXPECT_EQ(6, insns[i]->srcs_size());
+    EXPECT_EQ(i + 5, insns[i]->src(5));
+    delete insns[i];
+  }
+  delete heap_insn;
+}
+
+TEST_F(IRArenaTest, copiedCode) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (const v1 0)
+      (if-eqz v0 :true)
+      (invoke-static (v0 v1 v0 v1 v0 v1) "LFoo;.bar:(IIIIII)V")
+      (:true)
+      (return-void)
+    )
+  )");
+  auto expected = assembler::to_string(code.get());
+
+  auto copy = std::make_unique<IRCode>(*code);
+  code.reset();
+  EXPECT_EQ(expected, assembler::to_string(copy.get()));
+
+  // Editing the copy frees instructions in the CFG, some of them only after
+  // the code is gone.
+  copy->build_cfg(/* editable */ true);
+  auto& cfg = copy->cfg();
+  for (auto& mie : InstructionIterable(cfg)) {
+    if (mie.insn->opcode() == OPCODE_CONST) {
+      cfg.remove_insn(cfg.find_insn(mie.insn));
+      break;
+    }
+  }
+  auto cfg_copy = std::make_unique<IRCode>(*copy);
+  copy->clear_cfg();
+  copy.reset();
+
+  cfg_copy->clear_cfg();
+  EXPECT_EQ(assembler::to_string(cfg_copy.get()),
+            assembler::to_string(
+                assembler::ircode_from_string(R"(
+                  (
+                    (load-param v0)
+                    (if-eqz v0 :true)
+                    (invoke-static (v0 v1 v0 v1 v0 v1) "LFoo;.bar:(IIIIII)V")
+                    (:true)
+                    (return-void)
+                  )
+                )")
+                    .get()));
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "IRCodeEviction.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+
+struct IRCodeEvictionTest : public RedexTest {};
+
+TEST_F(IRCodeEvictionTest, roundTrip) {
+  auto method0 = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.bar:(I)I"
+     (
+      (load-param v0)
+      (.pos:dbg_0 "LFoo;.bar:(I)I" "Foo.java" 10)
+      (.src_block "LFoo;.bar:(I)I" 0 (0.5 1.0) ())
+      (.try_start a)
+      (const-string "hello")
+      (move-result-pseudo-object v1)
+      (invoke-static (v1) "LFoo;.baz:(Ljava/lang/String;)V")
+      (.try_end a)
+      (.pos:dbg_1 "LFoo;.baz:()I" "Foo.java" 20 dbg_0)
+      (switch v0 (:b :c))
+      (const-wide v2 12345678901)
+      (return v0)
+      (:b 0)
+      (return v0)
+      (:c 1)
+      (if-eqz v0 :d)
+      (return v0)
+      (:d)
+      (const v0 1)
+      (return v0)
+      (.catch (a))
+      (const v0 0)
+      (return v0)
+     )
+    )
+  )");
+  auto method1 = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.qux:()V"
+     (
+      (return-void)
+     )
+    )
+  )");
+  auto cls = assembler::class_with_methods("LFoo;", {method0, method1});
+  auto expected0 = assembler::to_string(method0->get_code());
+  auto expected1 = assembler::to_string(method1->get_code());
+
+  auto tmp_dir = redex::make_tmp_dir("redex_ir_code_eviction_test_%%%%%%%%");
+  auto path = tmp_dir.path + "/evicted.bin";
+  ir_eviction::EvictedCode evicted({cls}, path);
+  EXPECT_EQ(evicted.num_methods(), 2);
+  EXPECT_GT(evicted.num_bytes(), 0);
+  EXPECT_EQ(method0->get_code(), nullptr);
+  EXPECT_EQ(method1->get_code(), nullptr);
+  EXPECT_TRUE(boost::filesystem::exists(path));
+
+  evicted.reload();
+  ASSERT_NE(method0->get_code(), nullptr);
+  ASSERT_NE(method1->get_code(), nullptr);
+  EXPECT_EQ(assembler::to_string(method0->get_code()), expected0);
+  EXPECT_EQ(assembler::to_string(method1->get_code()), expected1);
+  EXPECT_FALSE(boost::filesystem::exists(path));
+}
+
+TEST_F(IRCodeEvictionTest, codeWithCfgStaysResident) {
+  auto method = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.bar:()V"
+     (
+      (return-void)
+     )
+    )
+  )");
+  auto cls = assembler::class_with_methods("LFoo;", {method});
+  auto* code = method->get_code();
+  code->build_cfg();
+
+  auto tmp_dir = redex::make_tmp_dir("redex_ir_code_eviction_test_%%%%%%%%");
+  ir_eviction::EvictedCode evicted({cls}, tmp_dir.path + "/evicted.bin");
+  EXPECT_EQ(evicted.num_methods(), 0);
+  EXPECT_EQ(method->get_code(), code);
+  evicted.reload();
+  EXPECT_EQ(method->get_code(), code);
+  code->clear_cfg();
+}
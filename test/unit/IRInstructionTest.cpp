@@ -391,3 +391,32 @@ TEST_F(IRInstructionTest, InvokeSourceIsWideComplex2) {
   EXPECT_FALSE(insn->invoke_src_is_wide(3));
   EXPECT_TRUE(insn->invoke_src_is_wide(4));
 }
+
+TEST_F(IRInstructionTest, SrcsSizeAcrossSpill) {
+  IRInstruction* insn = new IRInstruction(OPCODE_INVOKE_STATIC);
+  insn->set_srcs_size(5);
+  for (size_t i = 0; i < 5; ++i) {
+    insn->set_src(i, i + 10);
+  }
+  // Grow into a spill, shrink within it, and go back to inline storage.
+  insn->set_srcs_size(12);
+  EXPECT_EQ(insn->srcs_size(), 12);
+  insn->set_src(11, 42);
+  insn->set_srcs_size(8);
+  insn->set_srcs_size(9);
+  EXPECT_EQ(insn->src(8), 0);
+  insn->set_srcs_size(2);
+
+  EXPECT_EQ(insn->srcs_size(), 2);
+  EXPECT_EQ(insn->srcs_vec(), std::vector<reg_t>({10, 11}));
+
+  auto copy = std::make_unique<IRInstruction>(*insn);
+  copy->set_srcs_size(5);
+  copy->set_src(4, 14);
+  EXPECT_EQ(copy->src(0), 10);
+  EXPECT_EQ(copy->src(4), 14);
+  EXPECT_FALSE(*copy == *insn);
+  copy->set_srcs_size(2);
+  EXPECT_TRUE(*copy == *insn);
+  delete insn;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "InternTable.h"
+#include "WorkQueue.h"
+
+namespace {
+
+using Table = InternTable<size_t, const std::string>;
+
+} // namespace
+
+TEST(InternTableTest, getOrEmplace) {
+  Table table(/* initial_capacity */ 4);
+  const std::string a = "a";
+  const std::string b = "b";
+  EXPECT_EQ(table.get(1), nullptr);
+  EXPECT_EQ(table.get_or_emplace(1, &a), std::make_pair(&a, true));
+  EXPECT_EQ(table.get_or_emplace(1, &b), std::make_pair(&a, false));
+  EXPECT_EQ(table.get(1), &a);
+  EXPECT_EQ(table.size(), 1);
+}
+
+TEST(InternTableTest, growsAndErases) {
+  std::vector<std::string> values(10000);
+  Table table(/* initial_capacity */ 1);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = std::to_string(i);
+    EXPECT_TRUE(table.get_or_emplace(i, &values[i]).second);
+  }
+  EXPECT_EQ(table.size(), values.size());
+  for (size_t i = 0; i < values.size(); i += 2) {
+    EXPECT_TRUE(table.erase(i));
+  }
+  EXPECT_FALSE(table.erase(0));
+  for (size_t i = 0; i < values.size(); ++i) {
+    EXPECT_EQ(table.get(i), i % 2 ? &values[i] : nullptr);
+  }
+  EXPECT_EQ(table.size(), values.size() / 2);
+
+  // Erased keys can be interned again.
+  const std::string zero = "zero";
+  EXPECT_EQ(table.get_or_emplace(0, &zero), std::make_pair(&zero, true));
+
+  size_t count = 0;
+  table.for_each([&](size_t key, const std::string* value) {
+    EXPECT_EQ(table.get(key), value);
+    ++count;
+  });
+  EXPECT_EQ(count, table.size());
+}
+
+TEST(InternTableTest, concurrentGetOrEmplace) {
+  constexpr size_t kNumKeys = 20000;
+  constexpr size_t kRepeats = 8;
+  std::vector<std::string> values(kNumKeys * kRepeats);
+  Table table(/* initial_capacity */ 16);
+  std::vector<size_t> indices(values.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  std::vector<const std::string*> winners(values.size());
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        winners[i] = table.get_or_emplace(i % kNumKeys, &values[i]).first;
+      },
+      indices,
+      /* num_threads */ 8);
+  EXPECT_EQ(table.size(), kNumKeys);
+  for (size_t i = 0; i < values.size(); ++i) {
+    // Every insertion of a key returned the same value.
+    EXPECT_EQ(winners[i], table.get(i % kNumKeys));
+  }
+}
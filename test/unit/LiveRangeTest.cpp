@@ -5,8 +5,10 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <functional>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <optional>
 
 #include "ControlFlow.h"
 #include "IRAssembler.h"
@@ -208,3 +210,63 @@ TEST_F(LiveRangeTest, testDefUseChainMultiDefinition) {
   EXPECT_THAT(du_chains[const_v1_2],
               ::testing::UnorderedElementsAre(Use{move, 0}));
 }
+
+TEST_F(LiveRangeTest, testFlatChainsMatchMaps) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (const v1 0)
+      (:loop)
+      (if-eqz v0 :end)
+      (add-int/lit8 v1 v1 1)
+      (move v2 v1)
+      (add-int v0 v0 v2)
+      (goto :loop)
+      (:end)
+      (return v1)
+    )
+  )");
+
+  using namespace live_range;
+
+  cfg::ScopedCFG cfg(code.get());
+  for (bool move_aware : {false, true}) {
+    UseDefChains ud_chains;
+    DefUseChains du_chains;
+    std::optional<FlatChains> flat_chains;
+    std::function<std::unordered_set<Use>(Def)> get_uses;
+    std::optional<Chains> chains;
+    std::optional<MoveAwareChains> move_aware_chains;
+    if (move_aware) {
+      move_aware_chains.emplace(*cfg);
+      ud_chains = move_aware_chains->get_use_def_chains();
+      du_chains = move_aware_chains->get_def_use_chains();
+      flat_chains.emplace(move_aware_chains->get_flat_chains());
+      get_uses = [&](Def def) { return move_aware_chains->get_uses(def); };
+    } else {
+      chains.emplace(*cfg);
+      ud_chains = chains->get_use_def_chains();
+      du_chains = chains->get_def_use_chains();
+      flat_chains.emplace(chains->get_flat_chains());
+      get_uses = [&](Def def) { return chains->get_uses(def); };
+    }
+
+    for (const auto& mie : InstructionIterable(*cfg)) {
+      auto insn = mie.insn;
+      for (src_index_t i = 0; i < insn->srcs_size(); ++i) {
+        const auto& defs = ud_chains.at(Use{insn, i});
+        auto flat_defs = flat_chains->get_defs(insn, i);
+        EXPECT_EQ(std::vector<Def>(defs.begin(), defs.end()),
+                  std::vector<Def>(flat_defs.begin(), flat_defs.end()));
+      }
+      auto it = du_chains.find(insn);
+      auto uses = it == du_chains.end() ? std::unordered_set<Use>()
+                                        : it->second;
+      auto flat_uses = flat_chains->get_uses(insn);
+      EXPECT_EQ(std::unordered_set<Use>(flat_uses.begin(), flat_uses.end()),
+                uses);
+      EXPECT_EQ(flat_uses.size(), uses.size());
+      EXPECT_EQ(get_uses(insn), uses);
+    }
+  }
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "DexAnnotation.h"
+#include "IRAssembler.h"
+#include "MemberMemoryStats.h"
+#include "RedexTest.h"
+
+class MemberMemoryStatsTest : public RedexTest {};
+
+TEST_F(MemberMemoryStatsTest, components) {
+  ClassCreator cc(DexType::make_type("LFoo;"));
+  cc.set_super(type::java_lang_Object());
+
+  auto* annotated = static_cast<DexMethod*>(
+      DexMethod::make_method("LFoo;.annotated:(I)V"));
+  annotated->attach_param_annotation_set(
+      0, std::make_unique<DexAnnotationSet>());
+  annotated->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+  cc.add_method(annotated);
+
+  auto* with_code = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.with_code:()V"
+      (
+        (const v0 0)
+        (return-void)
+      )
+    )
+  )");
+  cc.add_method(with_code);
+
+  cc.add_field(DexField::make_field("LFoo;.bar:I")->make_concrete(ACC_PUBLIC));
+  auto* cls = cc.create();
+
+  auto stats = member_memory::compute({cls});
+  EXPECT_EQ(stats.classes.at("objects").count, 1);
+  EXPECT_EQ(stats.fields.at("objects").count, 1);
+  EXPECT_EQ(stats.methods.at("objects").count, 2);
+  EXPECT_EQ(stats.methods.at("objects").bytes, 2 * sizeof(DexMethod));
+  EXPECT_EQ(stats.methods.at("param_annotations").count, 1);
+  EXPECT_EQ(stats.methods.at("ir_code").count, 1);
+  EXPECT_EQ(stats.methods.count("annotations"), 0);
+
+  auto json = member_memory::to_json(stats);
+  EXPECT_EQ(json["methods"]["ir_code"]["count"].asUInt64(), 1);
+  EXPECT_GE(json["methods"]["total"]["bytes"].asUInt64(),
+            2 * sizeof(DexMethod));
+}
+
+TEST_F(MemberMemoryStatsTest, paramAnnotationsAreAllocatedOnDemand) {
+  auto* plain =
+      static_cast<DexMethod*>(DexMethod::make_method("LBar;.plain:(I)V"));
+  plain->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+  EXPECT_EQ(plain->get_param_anno(), nullptr);
+
+  auto* annotated = static_cast<DexMethod*>(
+      DexMethod::make_method("LBar;.annotated:(I)V"));
+  annotated->attach_param_annotation_set(
+      0, std::make_unique<DexAnnotationSet>());
+  annotated->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+  ASSERT_NE(annotated->get_param_anno(), nullptr);
+
+  auto* copy = DexMethod::make_method_from(
+      annotated, DexType::make_type("LBar;"), DexString::make_string("copy"));
+  ASSERT_NE(copy->get_param_anno(), nullptr);
+  EXPECT_EQ(copy->get_param_anno()->size(), 1);
+
+  plain->combine_annotations_with(annotated);
+  ASSERT_NE(plain->get_param_anno(), nullptr);
+  EXPECT_EQ(plain->get_param_anno()->count(0), 1);
+}
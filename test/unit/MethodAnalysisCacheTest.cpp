@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "DexClass.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "IRTypeChecker.h"
+#include "MethodAnalysisCache.h"
+#include "RedexTest.h"
+
+class MethodAnalysisCacheTest : public RedexTest {
+ protected:
+  DexMethod* make_method() {
+    auto method = assembler::method_from_string(R"(
+      (method (public static) "LFoo;.bar:(I)I"
+        (
+          (load-param v0)
+          (if-eqz v0 :true)
+          (const v1 1)
+          (goto :end)
+          (:true)
+          (const v1 2)
+          (:end)
+          (return v1)
+        )
+      )
+    )");
+    method->get_code()->build_cfg(/* editable */ false);
+    return method;
+  }
+
+  // Returns how often the analysis ran.
+  size_t analyze(DexMethod* method) {
+    auto& cfg = method->get_code()->cfg();
+    auto result = m_cache.get(method, cfg, "count", [&]() {
+      return ++m_runs;
+    });
+    EXPECT_EQ(*result, m_runs);
+    return m_runs;
+  }
+
+  MethodAnalysisCache m_cache;
+  size_t m_runs{0};
+};
+
+TEST_F(MethodAnalysisCacheTest, reusesResultsForUnchangedCode) {
+  auto method = make_method();
+  EXPECT_EQ(analyze(method), 1);
+  EXPECT_EQ(analyze(method), 1);
+
+  // Rebuilding the CFG creates new blocks for the same code.
+  method->get_code()->clear_cfg();
+  method->get_code()->build_cfg(/* editable */ false);
+  EXPECT_EQ(analyze(method), 1);
+  EXPECT_EQ(m_cache.hits(), 2);
+  EXPECT_EQ(m_cache.misses(), 1);
+}
+
+TEST_F(MethodAnalysisCacheTest, recomputesResultsForEditedCode) {
+  auto method = make_method();
+  EXPECT_EQ(analyze(method), 1);
+
+  // Changing an operand in place.
+  for (auto& mie : InstructionIterable(method->get_code())) {
+    if (mie.insn->opcode() == OPCODE_CONST) {
+      mie.insn->set_literal(mie.insn->get_literal() + 1);
+      break;
+    }
+  }
+  EXPECT_EQ(analyze(method), 2);
+  EXPECT_EQ(analyze(method), 2);
+
+  // Changing a branch.
+  for (auto& mie : InstructionIterable(method->get_code())) {
+    if (mie.insn->opcode() == OPCODE_IF_EQZ) {
+      mie.insn->set_opcode(OPCODE_IF_NEZ);
+    }
+  }
+  EXPECT_EQ(analyze(method), 3);
+}
+
+TEST_F(MethodAnalysisCacheTest, invalidatesResults) {
+  auto method = make_method();
+  EXPECT_EQ(analyze(method), 1);
+  m_cache.invalidate(method);
+  EXPECT_EQ(analyze(method), 2);
+  m_cache.clear();
+  EXPECT_EQ(m_cache.size(), 0);
+  EXPECT_EQ(analyze(method), 3);
+  EXPECT_EQ(m_cache.size(), 1);
+}
+
+TEST_F(MethodAnalysisCacheTest, typeCheckerReusesInferredTypes) {
+  auto method = make_method();
+  method->get_code()->clear_cfg();
+  auto& cache = g_redex->method_analysis_cache();
+  size_t misses = cache.misses();
+  for (size_t i = 0; i < 2; ++i) {
+    IRTypeChecker checker(method);
+    checker.run();
+    EXPECT_TRUE(checker.good()) << checker.what();
+    method->get_code()->clear_cfg();
+  }
+  EXPECT_EQ(cache.misses(), misses + 1);
+  EXPECT_GE(cache.hits(), 1);
+}
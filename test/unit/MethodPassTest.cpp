@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/value.h>
+#include <mutex>
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "IRAssembler.h"
+#include "Pass.h"
+#include "PassManager.h"
+#include "RedexTest.h"
+#include "Show.h"
+
+namespace {
+
+struct Log {
+  std::mutex mutex;
+  std::vector<std::string> events;
+  std::unordered_map<const DexMethod*, std::vector<std::string>> visits;
+  // The passes that found the editable CFG of the method built.
+  std::unordered_map<const DexMethod*, std::vector<std::string>> cfg_visits;
+
+  void event(const std::string& event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(event);
+  }
+};
+
+struct Count {
+  size_t methods{0};
+  Count& operator+=(const Count& that) {
+    methods += that.methods;
+    return *this;
+  }
+};
+
+class RecordingMethodPass : public MethodPass {
+ public:
+  RecordingMethodPass(const std::string& name, Log* log)
+      : MethodPass(name), m_log(log) {}
+
+  bool uses_editable_cfg{false};
+  bool cfg_legal{false};
+
+  bool is_cfg_legal() const override { return cfg_legal; }
+
+  std::unique_ptr<Run> prepare(DexStoresVector&,
+                               ConfigFiles&,
+                               PassManager&) override {
+    m_log->event("prepare " + name());
+    return std::make_unique<RecordingRun>(this);
+  }
+
+ private:
+  class RecordingRun : public AccumulatingRun<Count> {
+   public:
+    explicit RecordingRun(RecordingMethodPass* pass) : m_pass(pass) {}
+
+    bool uses_editable_cfg() const override {
+      return m_pass->uses_editable_cfg;
+    }
+
+    Count visit(DexMethod* method, IRCode& code) override {
+      std::lock_guard<std::mutex> lock(m_pass->m_log->mutex);
+      m_pass->m_log->visits[method].push_back(m_pass->name());
+      if (code.editable_cfg_built()) {
+        m_pass->m_log->cfg_visits[method].push_back(m_pass->name());
+      }
+      return Count{1};
+    }
+
+    void report(PassManager& mgr, const Count& count) override {
+      m_pass->m_log->event("finish " + m_pass->name());
+      mgr.incr_metric("methods", count.methods);
+    }
+
+   private:
+    RecordingMethodPass* m_pass;
+  };
+
+  Log* m_log;
+};
+
+} // namespace
+
+class MethodPassTest : public RedexTest {
+ protected:
+  void SetUp() override {
+    ClassCreator creator(DexType::make_type("LFoo;"));
+    creator.set_super(type::java_lang_Object());
+    for (const auto* name : {"a", "b", "c"}) {
+      auto method = assembler::method_from_string(std::string(R"(
+        (method (public static) "LFoo;.)") + name + R"(:()V"
+          (
+            (return-void)
+          )
+        )
+      )");
+      creator.add_method(method);
+    }
+    DexStore store("classes");
+    store.add_classes({creator.create()});
+    m_stores.emplace_back(std::move(store));
+  }
+
+  // Returns the metrics of each pass.
+  std::vector<std::unordered_map<std::string, int64_t>> run_passes(
+      bool fuse, bool keep_editable_cfg = false) {
+    Json::Value config(Json::objectValue);
+    config["redex"]["passes"] = Json::arrayValue;
+    config["redex"]["passes"].append("FirstMethodPass");
+    config["redex"]["passes"].append("SecondMethodPass");
+    config["fuse_method_passes"] = fuse;
+    config["keep_editable_cfg"] = keep_editable_cfg;
+    ConfigFiles conf(config);
+    std::vector<Pass*> passes{&m_first, &m_second};
+    PassManager manager(passes, config);
+    manager.set_testing_mode();
+    manager.run_passes(m_stores, conf);
+    std::vector<std::unordered_map<std::string, int64_t>> metrics;
+    for (const auto& pass_info : manager.get_pass_info()) {
+      metrics.push_back(pass_info.metrics);
+    }
+    return metrics;
+  }
+
+  static std::vector<int64_t> get_metric(
+      const std::vector<std::unordered_map<std::string, int64_t>>& metrics,
+      const std::string& name) {
+    std::vector<int64_t> values;
+    for (const auto& pass_metrics : metrics) {
+      auto it = pass_metrics.find(name);
+      values.push_back(it == pass_metrics.end() ? 0 : it->second);
+    }
+    return values;
+  }
+
+  void expect_all_methods_visited_in_order() {
+    ASSERT_EQ(m_log.visits.size(), 3);
+    for (const auto& [method, visits] : m_log.visits) {
+      EXPECT_EQ(visits, std::vector<std::string>({"FirstMethodPass",
+                                                  "SecondMethodPass"}))
+          << show(method);
+    }
+  }
+
+  Log m_log;
+  RecordingMethodPass m_first{"FirstMethodPass", &m_log};
+  RecordingMethodPass m_second{"SecondMethodPass", &m_log};
+  DexStoresVector m_stores;
+};
+
+TEST_F(MethodPassTest, runsOneWalkPerPassByDefault) {
+  auto metrics = run_passes(/* fuse */ false);
+  expect_all_methods_visited_in_order();
+  EXPECT_EQ(m_log.events,
+            std::vector<std::string>({"prepare FirstMethodPass",
+                                      "finish FirstMethodPass",
+                                      "prepare SecondMethodPass",
+                                      "finish SecondMethodPass"}));
+  EXPECT_EQ(get_metric(metrics, "methods"), std::vector<int64_t>({3, 3}));
+}
+
+TEST_F(MethodPassTest, fusesConsecutiveMethodPasses) {
+  auto metrics = run_passes(/* fuse */ true);
+  expect_all_methods_visited_in_order();
+  EXPECT_EQ(m_log.events,
+            std::vector<std::string>({"prepare FirstMethodPass",
+                                      "prepare SecondMethodPass",
+                                      "finish FirstMethodPass",
+                                      "finish SecondMethodPass"}));
+  EXPECT_EQ(get_metric(metrics, "methods"), std::vector<int64_t>({3, 3}));
+}
+
+TEST_F(MethodPassTest, sharesEditableCfgAcrossFusedPasses) {
+  m_first.uses_editable_cfg = true;
+  m_second.uses_editable_cfg = true;
+  auto metrics = run_passes(/* fuse */ true);
+  expect_all_methods_visited_in_order();
+  ASSERT_EQ(m_log.cfg_visits.size(), 3);
+  for (const auto& [method, visits] : m_log.cfg_visits) {
+    EXPECT_EQ(visits, std::vector<std::string>({"FirstMethodPass",
+                                                "SecondMethodPass"}))
+        << show(method);
+    EXPECT_FALSE(method->get_code()->editable_cfg_built()) << show(method);
+  }
+  EXPECT_EQ(get_metric(metrics, "fused_cfg_reused"),
+            std::vector<int64_t>({0, 3}));
+}
+
+TEST_F(MethodPassTest, clearsCfgForPassesOnLinearCode) {
+  m_first.uses_editable_cfg = true;
+  auto metrics = run_passes(/* fuse */ true);
+  expect_all_methods_visited_in_order();
+  ASSERT_EQ(m_log.cfg_visits.size(), 3);
+  for (const auto& [method, visits] : m_log.cfg_visits) {
+    EXPECT_EQ(visits, std::vector<std::string>({"FirstMethodPass"}))
+        << show(method);
+  }
+  EXPECT_EQ(get_metric(metrics, "fused_cfg_reused"),
+            std::vector<int64_t>({0, 0}));
+}
+
+TEST_F(MethodPassTest, keepsEditableCfgBetweenCfgLegalPasses) {
+  m_first.cfg_legal = true;
+  m_second.cfg_legal = true;
+  auto metrics = run_passes(/* fuse */ false, /* keep_editable_cfg */ true);
+  expect_all_methods_visited_in_order();
+  ASSERT_EQ(m_log.cfg_visits.size(), 3);
+  for (const auto& [method, visits] : m_log.cfg_visits) {
+    EXPECT_EQ(visits, std::vector<std::string>({"FirstMethodPass",
+                                                "SecondMethodPass"}))
+        << show(method);
+    EXPECT_FALSE(method->get_code()->editable_cfg_built()) << show(method);
+  }
+  EXPECT_EQ(get_metric(metrics, "cfg_prebuilt"), std::vector<int64_t>({3, 0}));
+  EXPECT_EQ(get_metric(metrics, "cfg_linearizations_avoided"),
+            std::vector<int64_t>({3, 0}));
+  EXPECT_EQ(get_metric(metrics, "cfg_linearized"),
+            std::vector<int64_t>({0, 3}));
+}
+
+TEST_F(MethodPassTest, linearizesCfgBeforePassesThatAreNotCfgLegal) {
+  m_first.cfg_legal = true;
+  auto metrics = run_passes(/* fuse */ false, /* keep_editable_cfg */ true);
+  expect_all_methods_visited_in_order();
+  EXPECT_TRUE(m_log.cfg_visits.empty());
+  EXPECT_EQ(get_metric(metrics, "cfg_prebuilt"), std::vector<int64_t>({0, 0}));
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include "DexClass.h"
+#include "MethodProfiles.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+
+using namespace method_profiles;
+
+class MethodProfilesTest : public RedexTest {
+ public:
+  MethodProfilesTest()
+      : m_tmp_dir(redex::make_tmp_dir("MethodProfilesTest%%%%%%%%")) {}
+
+ protected:
+  std::string write_csv(const std::string& contents) {
+    auto path = m_tmp_dir.path + "/profile.csv";
+    std::ofstream ofs(path);
+    ofs << contents;
+    return path;
+  }
+
+  redex::TempDir m_tmp_dir;
+};
+
+namespace {
+
+const char* kProfile =
+    "interaction,appear#\n"
+    "ColdStart,42\n"
+    "index,name,appear100,appear#,avg_call,avg_order,avg_rank100,"
+    "min_api_level\n"
+    "0,LFoo;.bar:()V,100.0,42,3.5,1,12.25,21\n"
+    "1,LFoo;.baz:(I)I,50.0,21,1,2,80.5,23\n"
+    "2,LFoo;.unknown:()V,10.0,4,1,3,99.0,21\n";
+
+} // namespace
+
+TEST_F(MethodProfilesTest, binaryMatchesCsv) {
+  auto* bar = DexMethod::make_method("LFoo;.bar:()V");
+  auto* baz = DexMethod::make_method("LFoo;.baz:(I)I");
+  auto csv = write_csv(kProfile);
+  auto bin = m_tmp_dir.path + "/profile.bin";
+  ASSERT_TRUE(MethodProfiles::convert_to_binary(csv, bin));
+
+  MethodProfiles from_csv;
+  from_csv.initialize({csv});
+  MethodProfiles from_bin;
+  from_bin.initialize({bin});
+
+  for (const auto* profiles : {&from_csv, &from_bin}) {
+    EXPECT_EQ(profiles->size(), 2);
+    EXPECT_EQ(profiles->unresolved_size(), 1);
+    EXPECT_EQ(*profiles->get_interaction_count(COLD_START), 42);
+    auto bar_stats = profiles->get_method_stat(COLD_START, bar);
+    ASSERT_TRUE(bar_stats);
+    EXPECT_EQ(bar_stats->appear_percent, 100.0);
+    EXPECT_EQ(bar_stats->call_count, 3.5);
+    EXPECT_EQ(bar_stats->order_percent, 12.25);
+    EXPECT_EQ(bar_stats->min_api_level, 21);
+    auto baz_stats = profiles->get_method_stat(COLD_START, baz);
+    ASSERT_TRUE(baz_stats);
+    EXPECT_EQ(baz_stats->order_percent, 80.5);
+    EXPECT_EQ(baz_stats->min_api_level, 23);
+  }
+
+  // Rows that did not resolve are kept until the methods exist.
+  auto* unknown = DexMethod::make_method("LFoo;.unknown:()V");
+  from_bin.process_unresolved_lines();
+  EXPECT_EQ(from_bin.unresolved_size(), 0);
+  auto unknown_stats = from_bin.get_method_stat(COLD_START, unknown);
+  ASSERT_TRUE(unknown_stats);
+  EXPECT_EQ(unknown_stats->appear_percent, 10.0);
+  EXPECT_EQ(unknown_stats->order_percent, 99.0);
+}
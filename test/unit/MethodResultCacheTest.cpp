@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "DexClass.h"
+#include "DexPosition.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "MethodResultCache.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+
+class MethodResultCacheTest : public RedexTest {
+ public:
+  MethodResultCacheTest()
+      : m_tmp_dir(redex::make_tmp_dir("MethodResultCacheTest%%%%%%%%")) {}
+
+ protected:
+  DexMethod* make_method(const std::string& code) {
+    auto method = assembler::method_from_string(R"(
+      (method (public static) "LFoo;.bar:(I)I"
+        ()
+      )
+    )");
+    method->set_code(assembler::ircode_from_string(code));
+    method->get_code()->set_debug_item(std::make_unique<DexDebugItem>());
+    return method;
+  }
+
+  redex::TempDir m_tmp_dir;
+};
+
+namespace {
+
+const char* kInput = R"(
+  (
+    (load-param v0)
+    (.pos:dbg_0 "LFoo;.bar:(I)I" "Foo.java" 10)
+    (if-eqz v0 :true)
+    (const v1 1)
+    (goto :end)
+    (:true)
+    (const v1 2)
+    (:end)
+    (return v1)
+  )
+)";
+
+const char* kOutput = R"(
+  (
+    (load-param v0)
+    (.pos:dbg_0 "LFoo;.bar:(I)I" "Foo.java" 10)
+    (if-eqz v0 :true)
+    (const v0 1)
+    (return v0)
+    (:true)
+    (const v0 2)
+    (return v0)
+  )
+)";
+
+} // namespace
+
+TEST_F(MethodResultCacheTest, replaysRecordedResult) {
+  auto method = make_method(kInput);
+  Json::Value stats;
+  stats["replaced"] = 1;
+  {
+    MethodResultCache cache(m_tmp_dir.path, "v1");
+    auto key = cache.key(method);
+    ASSERT_TRUE(key);
+    EXPECT_FALSE(cache.replay(*key, method));
+    auto output = assembler::ircode_from_string(kOutput);
+    output->set_registers_size(4);
+    cache.record(*key, output.get(), stats);
+    EXPECT_EQ(cache.hits(), 0);
+    EXPECT_EQ(cache.misses(), 1);
+  }
+
+  // A later build with the same input replays the result.
+  MethodResultCache cache(m_tmp_dir.path, "v1");
+  auto key = cache.key(method);
+  ASSERT_TRUE(key);
+  const auto* debug_item = method->get_code()->get_debug_item();
+  auto replayed = cache.replay(*key, method);
+  ASSERT_TRUE(replayed);
+  EXPECT_EQ(*replayed, stats);
+  EXPECT_CODE_EQ(method->get_code(),
+                 assembler::ircode_from_string(kOutput).get());
+  EXPECT_EQ(method->get_code()->get_registers_size(), 4);
+  EXPECT_EQ(cache.hits(), 1);
+
+  // The replayed code keeps its line info.
+  EXPECT_EQ(method->get_code()->get_debug_item(), debug_item);
+  std::vector<const DexPosition*> positions;
+  for (const auto& mie : *method->get_code()) {
+    if (mie.type == MFLOW_POSITION) {
+      positions.push_back(mie.pos.get());
+    }
+  }
+  ASSERT_EQ(positions.size(), 1);
+  EXPECT_EQ(positions[0]->line, 10);
+  EXPECT_EQ(positions[0]->file->str(), "Foo.java");
+}
+
+TEST_F(MethodResultCacheTest, keyDependsOnInputs) {
+  auto method = make_method(kInput);
+  MethodResultCache cache(m_tmp_dir.path, "v1");
+  MethodResultCache other_salt(m_tmp_dir.path, "v2");
+  auto key = cache.key(method);
+  ASSERT_TRUE(key);
+  EXPECT_EQ(*key, *cache.key(method));
+  EXPECT_NE(*key, *other_salt.key(method));
+
+  method->get_code()->set_registers_size(
+      method->get_code()->get_registers_size() + 1);
+  EXPECT_NE(*key, *cache.key(method));
+
+  method->set_code(assembler::ircode_from_string(kOutput));
+  EXPECT_NE(*key, *cache.key(method));
+}
+
+TEST_F(MethodResultCacheTest, editableCfgIsNotCached) {
+  auto method = make_method(kInput);
+  MethodResultCache cache(m_tmp_dir.path, "v1");
+  method->get_code()->build_cfg(/* editable */ true);
+  EXPECT_FALSE(cache.key(method));
+  method->get_code()->clear_cfg();
+  EXPECT_TRUE(cache.key(method));
+}
@@ -32,3 +32,27 @@ TEST_F(MethodUtilTest, test_count_opcodes) {
       method::count_opcode_of_types(code->cfg().entry_block(), {OPCODE_CONST}));
   code->clear_cfg();
 }
+
+TEST_F(MethodUtilTest, test_any_insn) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (const v0 1)
+      (new-array v0 "[I")
+      (move-result-pseudo-object v1)
+      (return-object v1)
+    )
+  )");
+
+  auto is_new_array = [](const IRInstruction* insn) {
+    return insn->opcode() == OPCODE_NEW_ARRAY;
+  };
+  auto is_aput = [](const IRInstruction* insn) {
+    return insn->opcode() == OPCODE_APUT;
+  };
+  EXPECT_TRUE(method::any_insn(*code, is_new_array));
+  EXPECT_FALSE(method::any_insn(*code, is_aput));
+  code->build_cfg();
+  EXPECT_TRUE(method::any_insn(*code, is_new_array));
+  EXPECT_FALSE(method::any_insn(*code, is_aput));
+  code->clear_cfg();
+}
@@ -19,3 +19,17 @@ TEST_F(Mutf8CompareTest, empty) {
   EXPECT_TRUE(compare_dexstrings(s1, s2));
   EXPECT_FALSE(compare_dexstrings(s2, s1));
 }
+
+TEST_F(Mutf8CompareTest, simpleStringsAroundPrefixKey) {
+  std::vector<std::string> strs = {"",         "a",         "ab",
+                                   "abcdefg",  "abcdefgh",  "abcdefghi",
+                                   "abcdefgi", "abcdefghj", "b",
+                                   "\x7f"};
+  for (const auto& x : strs) {
+    for (const auto& y : strs) {
+      auto sx = DexString::make_string(x);
+      auto sy = DexString::make_string(y);
+      EXPECT_EQ(compare_dexstrings(sx, sy), x < y) << x << " < " << y;
+    }
+  }
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "ObjectPool.h"
+
+namespace {
+
+struct Item {
+  explicit Item(std::string name) : name(std::move(name)) {}
+  std::string name;
+};
+
+} // namespace
+
+TEST(ObjectPoolTest, allocatesDistinctAlignedSlots) {
+  ObjectPool<Item> pool;
+  std::unordered_set<void*> seen;
+  std::vector<Item*> items;
+  for (size_t i = 0; i < 5000; ++i) {
+    void* slot = pool.allocate();
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(slot) % alignof(Item), 0);
+    EXPECT_TRUE(seen.insert(slot).second);
+    items.push_back(new (slot) Item(std::to_string(i)));
+  }
+  for (size_t i = 0; i < items.size(); ++i) {
+    EXPECT_EQ(items[i]->name, std::to_string(i));
+    items[i]->~Item();
+    pool.deallocate(items[i]);
+  }
+}
+
+TEST(ObjectPoolTest, reusesDeallocatedSlots) {
+  ObjectPool<Item> pool;
+  auto* a = new (pool.allocate()) Item("a");
+  auto* b = new (pool.allocate()) Item("b");
+  a->~Item();
+  pool.deallocate(a);
+  b->~Item();
+  pool.deallocate(b);
+  // Most recently freed first.
+  EXPECT_EQ(pool.allocate(), b);
+  EXPECT_EQ(pool.allocate(), a);
+}
+
+TEST(ObjectPoolTest, reserveKeepsFirstSlabContiguous) {
+  ObjectPool<uint64_t> pool;
+  pool.reserve(100);
+  auto* first = static_cast<uint64_t*>(pool.allocate());
+  for (size_t i = 1; i < 100; ++i) {
+    EXPECT_EQ(pool.allocate(), first + i);
+  }
+}
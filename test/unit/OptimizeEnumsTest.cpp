@@ -7,6 +7,7 @@
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <sstream>
 
 #include "Creators.h"
 #include "EnumConfig.h"
@@ -202,6 +203,41 @@ TEST_F(OptimizeEnumsTest, if_chain) {
   code->clear_cfg();
 }
 
+TEST_F(OptimizeEnumsTest, deep_if_chain) {
+  // Generated code can have if-else chains that are far deeper than what a
+  // recursive traversal could handle.
+  constexpr int32_t num_cases = 20000;
+  std::ostringstream chain;
+  std::ostringstream cases;
+  for (int32_t i = 0; i < num_cases; i++) {
+    chain << "(const v1 " << i << ")\n(if-eq v0 v1 :case" << i << ")\n";
+    cases << "(:case" << i << ")\n(return v1)\n";
+  }
+  auto code = assembler::ircode_from_string("((load-param v0)\n" +
+                                            chain.str() + "(return v0)\n" +
+                                            cases.str() + ")");
+
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  auto root_branch = cfg::InstructionIterator(cfg, true);
+  while (!opcode::is_branch(root_branch->insn->opcode())) {
+    ++root_branch;
+  }
+  SwitchEquivFinder finder(&cfg, root_branch, 0);
+  ASSERT_TRUE(finder.success());
+  const auto& key_to_case = finder.key_to_case();
+  EXPECT_EQ(num_cases + 1, key_to_case.size());
+  EXPECT_EQ(1, key_to_case.count(boost::none));
+  // The loads in the root block are not extra loads.
+  for (int32_t i = 1; i < num_cases; i += 997) {
+    const auto& loads = finder.extra_loads().at(key_to_case.at(i));
+    ASSERT_EQ(1, loads.size());
+    EXPECT_EQ(1, loads.begin()->first);
+    EXPECT_EQ(i, loads.begin()->second->get_literal());
+  }
+  code->clear_cfg();
+}
+
 TEST_F(OptimizeEnumsTest, extra_loads_intersect) {
   setup();
 
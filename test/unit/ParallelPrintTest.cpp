@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ParallelPrint.h"
+
+namespace {
+
+void print_item(std::ostream& out, size_t i) {
+  out << "item " << i;
+  for (size_t j = 0; j < i % 5; ++j) {
+    out << " " << j;
+  }
+  out << std::endl;
+}
+
+std::string print_serially(const std::vector<size_t>& items) {
+  std::ostringstream out;
+  for (auto i : items) {
+    print_item(out, i);
+  }
+  return out.str();
+}
+
+std::string print_in_parallel(const std::vector<size_t>& items,
+                              size_t items_per_run) {
+  std::ostringstream out;
+  redex::print_in_parallel(out, items, print_item, items_per_run);
+  return out.str();
+}
+
+} // namespace
+
+TEST(ParallelPrintTest, empty) {
+  EXPECT_EQ(print_in_parallel({}, 3), "");
+}
+
+TEST(ParallelPrintTest, sameAsSerial) {
+  std::vector<size_t> items;
+  for (size_t i = 0; i < 10000; ++i) {
+    items.push_back((i * 7919) % 10007);
+  }
+  auto expected = print_serially(items);
+  for (size_t items_per_run : {1, 3, 256, 20000}) {
+    EXPECT_EQ(print_in_parallel(items, items_per_run), expected)
+        << items_per_run << " items per run";
+  }
+}
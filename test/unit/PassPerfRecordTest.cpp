@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Pass.h"
+#include "PassPerfRecord.h"
+#include "RedexException.h"
+#include "RedexTest.h"
+
+namespace {
+
+class FooPass : public Pass {
+ public:
+  FooPass() : Pass("FooPass") {}
+
+  void run_pass(DexStoresVector& /* stores */,
+                ConfigFiles& /* conf */,
+                PassManager& /* mgr */) override {}
+};
+
+// The record of the runs of `pass`, with the given wall times and peak memory
+// deltas.
+Json::Value make_record(const Pass* pass,
+                        const std::vector<std::pair<int64_t, int64_t>>& runs) {
+  std::vector<PassManager::PassInfo> pass_info(runs.size());
+  for (size_t i = 0; i < runs.size(); ++i) {
+    auto [wall_time_ms, vm_hwm_delta] = runs[i];
+    auto& info = pass_info[i];
+    info.pass = pass;
+    info.order = i;
+    info.repeat = i;
+    info.total_repeat = runs.size();
+    info.name = pass->name() + "#" + std::to_string(i + 1);
+    info.metrics["wall_time_ms"] = wall_time_ms;
+    info.metrics["cpu_time_ms"] = 2 * wall_time_ms;
+    info.metrics["vm_hwm_delta"] = vm_hwm_delta;
+    info.metrics["~result~changed~methods~"] = 7 * wall_time_ms;
+  }
+  return pass_perf::to_json(pass_info);
+}
+
+} // namespace
+
+struct PassPerfRecordTest : public RedexTest {};
+
+TEST_F(PassPerfRecordTest, toJson) {
+  FooPass pass;
+  auto record = make_record(&pass, {{1000, 0}, {2000, 0}});
+  EXPECT_EQ(record["schema_version"].asInt64(), pass_perf::SCHEMA_VERSION);
+  ASSERT_EQ(record["passes"].size(), 2);
+  const auto& entry = record["passes"][1];
+  EXPECT_EQ(entry["pass"].asString(), "FooPass");
+  EXPECT_EQ(entry["order"].asUInt64(), 1);
+  EXPECT_EQ(entry["repeat"].asUInt64(), 1);
+  EXPECT_EQ(entry["total_repeat"].asUInt64(), 2);
+  EXPECT_EQ(entry["wall_time_ms"].asInt64(), 2000);
+  EXPECT_EQ(entry["cpu_time_ms"].asInt64(), 4000);
+  EXPECT_EQ(entry["changed_methods"].asInt64(), 14000);
+  // Every field is present, even the ones that were not measured.
+  for (const auto& field : pass_perf::fields()) {
+    EXPECT_TRUE(entry.isMember(field.name)) << field.name;
+  }
+  EXPECT_TRUE(entry["workqueue_busy_ms"].isNull());
+}
+
+TEST_F(PassPerfRecordTest, findRegressions) {
+  FooPass pass;
+  auto before = make_record(&pass, {{1000, 0}, {1000, 1 << 30}});
+  auto after = make_record(&pass, {{1050, 0}, {1500, 1 << 30}});
+  auto regressions = pass_perf::find_regressions(before, after, 0.1);
+  // The first run grew by less than the threshold, and the changed methods
+  // are not a cost.
+  ASSERT_EQ(regressions.size(), 2);
+  EXPECT_EQ(regressions[0].pass, "FooPass#2");
+  EXPECT_EQ(regressions[0].field, "wall_time_ms");
+  EXPECT_EQ(regressions[0].before, 1000);
+  EXPECT_EQ(regressions[0].after, 1500);
+  EXPECT_EQ(regressions[1].pass, "FooPass#2");
+  EXPECT_EQ(regressions[1].field, "cpu_time_ms");
+
+  EXPECT_TRUE(pass_perf::find_regressions(after, before, 0.1).empty());
+}
+
+TEST_F(PassPerfRecordTest, growthBelowNoiseFloorIsIgnored) {
+  FooPass pass;
+  auto before = make_record(&pass, {{10, 0}});
+  auto after = make_record(&pass, {{50, 1 << 20}});
+  EXPECT_TRUE(pass_perf::find_regressions(before, after, 0.1).empty());
+}
+
+TEST_F(PassPerfRecordTest, rejectsOtherSchemaVersions) {
+  FooPass pass;
+  auto record = make_record(&pass, {{10, 0}});
+  auto other = record;
+  other["schema_version"] = (Json::Int64)(pass_perf::SCHEMA_VERSION + 1);
+  EXPECT_THROW(pass_perf::find_regressions(record, other, 0.1),
+               RedexException);
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "DexClass.h"
+#include "DexPosition.h"
+#include "RedexTest.h"
+
+class PositionMapperTest : public RedexTest {};
+
+TEST_F(PositionMapperTest, equalChainsShareLines) {
+  auto* caller = DexString::make_string("LFoo;.caller:()V");
+  auto* callee = DexString::make_string("LFoo;.callee:()V");
+  auto* file = DexString::make_string("Foo.java");
+
+  // Two copies of the same inlined position, as inlining the same caller
+  // twice produces them.
+  DexPosition callsite1(caller, file, 10);
+  DexPosition inlined1(callee, file, 20);
+  inlined1.parent = &callsite1;
+  DexPosition callsite2(caller, file, 10);
+  DexPosition inlined2(callee, file, 20);
+  inlined2.parent = &callsite2;
+  // Same line, different parent.
+  DexPosition callsite3(caller, file, 11);
+  DexPosition inlined3(callee, file, 20);
+  inlined3.parent = &callsite3;
+
+  RealPositionMapper mapper("");
+  mapper.register_position(&inlined1);
+  auto line1 = mapper.position_to_line(&inlined1);
+  mapper.register_position(&inlined2);
+  EXPECT_EQ(mapper.position_to_line(&inlined2), line1);
+  EXPECT_EQ(mapper.position_to_line(&callsite2),
+            mapper.position_to_line(&callsite1));
+  EXPECT_NE(mapper.position_to_line(&inlined3), line1);
+  EXPECT_EQ(mapper.size(), 3);
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <boost/regex.hpp>
+
+#include "ProguardGlob.h"
+#include "ProguardRegex.h"
+
+using namespace keep_rules;
+
+namespace {
+
+std::vector<uint32_t> match(const proguard_parser::GlobSet& globs,
+                            const std::string& name) {
+  std::vector<uint32_t> ids;
+  globs.match(name, &ids);
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+} // namespace
+
+TEST(ProguardGlobTest, matchesLikeRegex) {
+  const std::vector<std::string> patterns = {
+      "Lcom/foo/Bar;",  "Lcom/foo/*;",      "Lcom/foo/**;", "Lcom/*/Bar;",
+      "Lcom/**/Bar;",   "Lcom/foo/Ba?;",    "L*;",          "L**;",
+      "Lcom/foo/*$*;",  "Lcom/**$Builder;", "[Lcom/foo/*;", "Lcom/foo/B*r*;",
+      "Lcom/foo/**r;",  "L?om/*/*;",
+  };
+  const std::vector<std::string> names = {
+      "Lcom/foo/Bar;",
+      "Lcom/foo/Baz;",
+      "Lcom/foo/Bar$1;",
+      "Lcom/foo/bar/Bar;",
+      "Lcom/Bar;",
+      "Lcom/x/y/Bar;",
+      "Lcom/x/Foo$Builder;",
+      "Lorg/Foo;",
+      "[Lcom/foo/Bar;",
+      "Lcom/foo/Br;",
+      "Lcom/foo/Brr;",
+      "Lcom/foo;",
+      "Lcom/foo/Bar",
+      "",
+  };
+
+  proguard_parser::GlobSet globs;
+  std::vector<boost::regex> regexes;
+  for (const auto& pattern : patterns) {
+    ASSERT_TRUE(globs.add(pattern, regexes.size())) << pattern;
+    regexes.emplace_back(proguard_parser::form_type_regex(pattern));
+  }
+  EXPECT_EQ(globs.size(), patterns.size());
+
+  for (const auto& name : names) {
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < regexes.size(); ++i) {
+      if (boost::regex_match(name, regexes[i])) {
+        expected.push_back(i);
+      }
+    }
+    EXPECT_EQ(match(globs, name), expected) << name;
+  }
+}
+
+TEST(ProguardGlobTest, sharedPatterns) {
+  proguard_parser::GlobSet globs;
+  EXPECT_TRUE(globs.add("Lcom/foo/*;", 0));
+  EXPECT_TRUE(globs.add("Lcom/foo/*;", 1));
+  EXPECT_TRUE(globs.add("Lcom/foo/**;", 2));
+  EXPECT_EQ(match(globs, "Lcom/foo/Bar;"), std::vector<uint32_t>({0, 1, 2}));
+  EXPECT_EQ(match(globs, "Lcom/foo/bar/Baz;"), std::vector<uint32_t>({2}));
+  EXPECT_TRUE(match(globs, "Lcom/bar/Baz;").empty());
+}
+
+TEST(ProguardGlobTest, rejectsUnsupportedSyntax) {
+  proguard_parser::GlobSet globs;
+  EXPECT_FALSE(globs.add("", 0));
+  EXPECT_FALSE(globs.add("%", 0));
+  EXPECT_FALSE(globs.add("***", 0));
+  EXPECT_FALSE(globs.add("Lcom/foo/***;", 0));
+  EXPECT_FALSE(globs.add("!Lcom/foo/Bar;", 0));
+  EXPECT_FALSE(globs.add("Lcom/foo/Bar;,Lcom/foo/Baz;", 0));
+  EXPECT_FALSE(globs.add("Lcom/foo/...;", 0));
+  EXPECT_EQ(globs.size(), 0);
+}
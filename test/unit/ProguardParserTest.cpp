@@ -7,11 +7,13 @@
 
 #include <gtest/gtest.h>
 
+#include <fstream>
 #include <istream>
 #include <vector>
 
 #include "ProguardConfiguration.h"
 #include "ProguardParser.h"
+#include "RedexTestUtils.h"
 
 using namespace keep_rules;
 
@@ -886,3 +888,54 @@ TEST(ProguardParserTest, assumenosideeffects_with_field_value) {
               keep_rules::AssumeReturnValue::ValueNone);
   }
 }
+
+// Parsing files in parallel merges them as parsing them one after the other.
+TEST(ProguardParserTest, parse_files) {
+  auto tmp_dir = redex::make_tmp_dir("ProguardParserTest%%%%%%%%");
+  auto write = [&](const std::string& name, const std::string& contents) {
+    auto path = tmp_dir.path + "/" + name;
+    std::ofstream(path) << contents;
+    return path;
+  };
+  auto shared = write("shared.pro",
+                      "-keep class Shared\n"
+                      "-dontwarn shared.**\n");
+  auto nested = write("nested.pro",
+                      "-include " + shared + "\n"
+                      "-keep class Nested\n");
+  auto first = write("first.pro",
+                     "-keep class First\n"
+                     "-include " + nested + "\n"
+                     "-dontshrink\n"
+                     "-dontwarn first.**\n");
+  auto second = write("second.pro",
+                      "-include " + shared + "\n"
+                      "-keep class Second\n"
+                      "-dontwarn second.**\n");
+
+  ProguardConfiguration serial;
+  proguard_parser::parse_file(first, &serial);
+  proguard_parser::parse_file(second, &serial);
+  ProguardConfiguration parallel;
+  proguard_parser::parse_files({first, second}, &parallel);
+
+  auto class_names = [](const ProguardConfiguration& config) {
+    std::vector<std::string> names;
+    for (const auto* keep : config.keep_rules) {
+      names.push_back(keep->class_spec.className);
+    }
+    return names;
+  };
+  std::vector<std::string> expected_names = {"First", "Nested", "Shared",
+                                             "Second"};
+  EXPECT_EQ(class_names(serial), expected_names);
+  EXPECT_EQ(class_names(parallel), expected_names);
+  std::vector<std::string> expected_dontwarn = {"first.**", "shared.**",
+                                                "second.**"};
+  EXPECT_EQ(serial.dontwarn, expected_dontwarn);
+  EXPECT_EQ(parallel.dontwarn, expected_dontwarn);
+  EXPECT_EQ(parallel.includes, serial.includes);
+  EXPECT_EQ(parallel.already_included, serial.already_included);
+  EXPECT_TRUE(parallel.ok);
+  EXPECT_FALSE(parallel.shrink);
+}
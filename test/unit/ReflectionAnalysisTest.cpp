@@ -227,3 +227,57 @@ IOPCODE_MOVE_RESULT_PSEUDO_OBJECT v3 {2, CLASS{Ljava/lang/Object;(LFoo;)}(REFLEC
 INVOKE_VIRTUAL v2, v3, Ljava/lang/Class;.getField:(Ljava/lang/String;)Ljava/lang/reflect/Field; {2, CLASS{Ljava/lang/Object;(LFoo;)}(REFLECTION)}\n\
 MOVE_RESULT_OBJECT v4 {2, CLASS{Ljava/lang/Object;(LFoo;)}(REFLECTION);4294967294, FIELD{Ljava/lang/Object;(LFoo;):bar}}\n");
 }
+
+TEST_F(ReflectionAnalysisTest, wholeScope) {
+  auto make_class = [](const char* name, const char* method) {
+    ClassCreator cc(DexType::make_type(name));
+    cc.set_super(type::java_lang_Object());
+    cc.add_method(assembler::method_from_string(method));
+    return cc.create();
+  };
+  auto* with_const_class = make_class("LA;", R"(
+    (method (public static) "LA;.f:()V"
+      (
+        (const-class "LFoo;")
+        (move-result-pseudo-object v0)
+        (return-void)
+      )
+    )
+  )");
+  auto* with_class_param = make_class("LB;", R"(
+    (method (public static) "LB;.f:(Ljava/lang/Class;)V"
+      (
+        (load-param-object v0)
+        (const-string "bar")
+        (move-result-pseudo-object v1)
+        (invoke-virtual (v0 v1) "Ljava/lang/Class;.getField:(Ljava/lang/String;)Ljava/lang/reflect/Field;")
+        (move-result-object v2)
+        (return-void)
+      )
+    )
+  )");
+  auto* without_reflection = make_class("LC;", R"(
+    (method (public static) "LC;.f:(Ljava/lang/Object;)V"
+      (
+        (load-param-object v0)
+        (invoke-virtual (v0) "Ljava/lang/Object;.hashCode:()I")
+        (return-void)
+      )
+    )
+  )");
+  Scope scope{with_const_class, with_class_param, without_reflection};
+
+  MetadataCache cache;
+  auto* c_method = without_reflection->get_dmethods()[0];
+  EXPECT_FALSE(may_have_reflection_sites(*c_method->get_code(), cache));
+
+  auto sites = get_reflection_sites(scope, &cache);
+  EXPECT_EQ(sites.size(), 2);
+  EXPECT_EQ(to_string(sites.at(with_const_class->get_dmethods()[0])),
+            "IOPCODE_MOVE_RESULT_PSEUDO_OBJECT v0 {4294967294, "
+            "CLASS{LFoo;}(REFLECTION)}\n");
+  EXPECT_EQ(sites.count(with_class_param->get_dmethods()[0]), 1);
+  EXPECT_EQ(sites.count(c_method), 0);
+  // The prefilter kept the analysis from building a CFG.
+  EXPECT_FALSE(c_method->get_code()->cfg_built());
+}
@@ -906,3 +906,235 @@ TEST_F(RegAllocTest, NoOverwriteThis) {
 )");
   EXPECT_CODE_EQ(expected_code.get(), method->get_code());
 }
+
+namespace {
+
+/*
+ * A loop that keeps `n` registers live, which exceeds what add-int can
+ * address for large enough `n`, followed by a range invoke.
+ */
+std::unique_ptr<IRCode> make_high_pressure_code(size_t n) {
+  std::ostringstream ss;
+  ss << "((load-param v0)";
+  for (size_t i = 1; i <= n; ++i) {
+    ss << "(const v" << i << " " << i << ")";
+  }
+  ss << "(:loop)";
+  for (size_t i = 1; i <= n; ++i) {
+    ss << "(add-int v" << i << " v" << i << " v" << (i % n + 1) << ")";
+  }
+  ss << "(if-eqz v0 :loop)";
+  ss << R"((invoke-static (v1 v2 v3 v4 v5 v6) "LFoo;.bar:(IIIIII)V"))";
+  ss << "(return v1))";
+  auto code = assembler::ircode_from_string(ss.str());
+  code->set_registers_size(n + 1);
+  return code;
+}
+
+} // namespace
+
+TEST_F(RegAllocTest, BitVectorLiveness) {
+  auto code = make_high_pressure_code(/* n */ 100);
+  code->build_cfg(/* editable */ false);
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  LivenessFixpointIterator fixpoint_iter(cfg);
+  fixpoint_iter.run(LivenessDomain());
+  ASSERT_TRUE(
+      BitVectorLiveness::is_applicable(cfg, code->get_registers_size()));
+  BitVectorLiveness liveness(cfg, code->get_registers_size());
+
+  for (auto* block : cfg.blocks()) {
+    auto live_in = liveness.get_live_in_vars_at(block);
+    EXPECT_EQ(liveness.to_domain(live_in),
+              fixpoint_iter.get_live_in_vars_at(block))
+        << "B" << block->id();
+    auto live_out = liveness.get_live_out_vars_at(block);
+    EXPECT_EQ(liveness.to_domain(live_out),
+              fixpoint_iter.get_live_out_vars_at(block))
+        << "B" << block->id();
+
+    // Registers are visited in the same order as the elements of a
+    // LivenessDomain.
+    std::vector<reg_t> visited;
+    liveness.for_each(live_out, [&](reg_t reg) { visited.push_back(reg); });
+    auto elements = fixpoint_iter.get_live_out_vars_at(block).elements();
+    EXPECT_EQ(visited, std::vector<reg_t>(elements.begin(), elements.end()))
+        << "B" << block->id();
+  }
+}
+
+TEST_F(RegAllocTest, BitVectorInterferenceGraph) {
+  auto code = make_high_pressure_code(/* n */ 100);
+  code->build_cfg(/* editable */ false);
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  LivenessFixpointIterator fixpoint_iter(cfg);
+  fixpoint_iter.run(LivenessDomain());
+  BitVectorLiveness liveness(cfg, code->get_registers_size());
+
+  RangeSet range_set = init_range_set(code.get());
+  auto expected_ig = interference::build_graph(
+      fixpoint_iter, code.get(), code->get_registers_size(), range_set);
+  auto ig = interference::build_graph(
+      liveness, code.get(), code->get_registers_size(), range_set);
+
+  ASSERT_EQ(ig.nodes().size(), expected_ig.nodes().size());
+  for (auto& [reg, expected_node] : expected_ig.nodes()) {
+    auto& node = ig.get_node(reg);
+    EXPECT_EQ(node.adjacent(), expected_node.adjacent()) << "v" << reg;
+    EXPECT_EQ(node.weight(), expected_node.weight()) << "v" << reg;
+    EXPECT_EQ(node.spill_cost(), expected_node.spill_cost()) << "v" << reg;
+    EXPECT_EQ(node.max_vreg(), expected_node.max_vreg()) << "v" << reg;
+  }
+  for (reg_t u = 0; u < code->get_registers_size(); ++u) {
+    for (reg_t v = 0; v < code->get_registers_size(); ++v) {
+      EXPECT_EQ(ig.is_adjacent(u, v), expected_ig.is_adjacent(u, v));
+      EXPECT_EQ(ig.is_coalesceable(u, v), expected_ig.is_coalesceable(u, v));
+      EXPECT_EQ(ig.has_containment_edge(u, v),
+                expected_ig.has_containment_edge(u, v));
+    }
+  }
+  for (auto* insn : range_set) {
+    EXPECT_EQ(ig.get_liveness(insn), expected_ig.get_liveness(insn));
+  }
+}
+
+TEST_F(RegAllocTest, BitVectorLivenessAllocation) {
+  for (bool use_splitting : {false, true}) {
+    auto expected_code = make_high_pressure_code(/* n */ 300);
+    graph_coloring::Allocator::Config expected_config;
+    expected_config.use_splitting = use_splitting;
+    auto expected_stats = graph_coloring::allocate(
+        expected_config, expected_code.get(), /* is_static */ true,
+        []() { return std::string("expected"); });
+    EXPECT_GT(expected_stats.moves_inserted(), 0);
+
+    auto code = make_high_pressure_code(/* n */ 300);
+    graph_coloring::Allocator::Config config;
+    config.use_splitting = use_splitting;
+    config.use_bit_vector_liveness = true;
+    auto stats = graph_coloring::allocate(config, code.get(),
+                                          /* is_static */ true,
+                                          []() { return std::string("actual"); });
+    EXPECT_CODE_EQ(code.get(), expected_code.get());
+    EXPECT_EQ(stats.moves_inserted(), expected_stats.moves_inserted());
+    EXPECT_EQ(stats.moves_coalesced, expected_stats.moves_coalesced);
+  }
+}
+
+namespace {
+
+/*
+ * Checks that every operand of the allocated `code` can be encoded, and that
+ * the params are at the end of the frame.
+ */
+void expect_encodable(IRCode* code) {
+  auto params = code->get_param_instructions();
+  reg_t params_size = 0;
+  for (auto& mie : InstructionIterable(params)) {
+    params_size += mie.insn->dest_is_wide() ? 2 : 1;
+  }
+  reg_t next_param = code->get_registers_size() - params_size;
+  for (auto& mie : InstructionIterable(params)) {
+    EXPECT_EQ(mie.insn->dest(), next_param) << show(mie.insn);
+    next_param += mie.insn->dest_is_wide() ? 2 : 1;
+  }
+
+  auto ii = InstructionIterable(code);
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    auto* insn = it->insn;
+    if (opcode::is_a_load_param(insn->opcode())) {
+      continue;
+    }
+    if (insn->has_dest()) {
+      EXPECT_LE(insn->dest(),
+                max_unsigned_value(interference::dest_bit_width(it.unwrap())))
+          << show(insn);
+    }
+    IRInstruction denormalized(*insn);
+    denormalized.denormalize_registers();
+    if (opcode::has_range_form(insn->opcode()) &&
+        needs_range_conversion(&denormalized)) {
+      for (size_t i = 1; i < denormalized.srcs_size(); ++i) {
+        EXPECT_EQ(denormalized.src(i), denormalized.src(i - 1) + 1)
+            << show(insn);
+      }
+    } else {
+      for (size_t i = 0; i < insn->srcs_size(); ++i) {
+        EXPECT_LE(insn->src(i), interference::max_value_for_src(
+                                    insn, i, insn->src_is_wide(i)))
+            << show(insn);
+      }
+    }
+  }
+}
+
+/*
+ * Like make_high_pressure_code, but with instructions that can only address
+ * 4-bit registers, and with wide and object registers to move.
+ */
+std::unique_ptr<IRCode> make_constrained_code(size_t n) {
+  std::ostringstream ss;
+  ss << "((load-param-object v0)(load-param-wide v1)";
+  for (size_t i = 3; i < n + 3; ++i) {
+    ss << "(const v" << i << " " << i << ")";
+  }
+  ss << "(:loop)";
+  for (size_t i = 3; i < n + 3; ++i) {
+    ss << "(add-int v" << i << " v" << i << " v" << (i + 1 < n + 3 ? i + 1 : 3)
+       << ")";
+  }
+  ss << R"((iget-object v0 "LFoo;.next:LFoo;"))";
+  ss << "(move-result-pseudo-object v0)";
+  ss << "(add-long v1 v1 v1)";
+  ss << R"((iput v3 v0 "LFoo;.f:I"))";
+  ss << "(if-ne v3 v" << (n + 2) << " :loop)";
+  ss << R"((invoke-virtual (v0 v1 v4) "LFoo;.baz:(JI)V"))";
+  ss << "(return-wide v1))";
+  auto code = assembler::ircode_from_string(ss.str());
+  code->set_registers_size(n + 3);
+  return code;
+}
+
+} // namespace
+
+TEST_F(RegAllocTest, LinearScanAllocation) {
+  for (size_t n : {10, 300}) {
+    for (bool constrained : {false, true}) {
+      auto code = constrained ? make_constrained_code(n)
+                              : make_high_pressure_code(n);
+      graph_coloring::Allocator::Config config;
+      config.linear_scan_threshold = 1;
+      config.measure_linear_scan = true;
+      auto stats = graph_coloring::allocate(
+          config, code.get(), /* is_static */ true,
+          []() { return std::string("linear scan"); });
+      EXPECT_EQ(stats.linear_scan_methods, 1);
+      EXPECT_EQ(stats.moves_inserted(), 0);
+      EXPECT_GT(stats.linear_scan_code_units, 0);
+      EXPECT_GT(stats.graph_coloring_code_units, 0);
+      if (n > 255) {
+        EXPECT_GT(stats.linear_scan_moves, 0);
+      }
+      expect_encodable(code.get());
+    }
+  }
+}
+
+TEST_F(RegAllocTest, LinearScanAllocationThreshold) {
+  auto expected_code = make_high_pressure_code(/* n */ 10);
+  graph_coloring::Allocator::Config expected_config;
+  graph_coloring::allocate(expected_config, expected_code.get(),
+                           /* is_static */ true,
+                           []() { return std::string("expected"); });
+
+  auto code = make_high_pressure_code(/* n */ 10);
+  graph_coloring::Allocator::Config config;
+  config.linear_scan_threshold = code->count_opcodes();
+  auto stats = graph_coloring::allocate(
+      config, code.get(), /* is_static */ true,
+      []() { return std::string("actual"); });
+  EXPECT_EQ(stats.linear_scan_methods, 0);
+  EXPECT_CODE_EQ(code.get(), expected_code.get());
+}
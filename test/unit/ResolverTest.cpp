@@ -7,6 +7,7 @@
 
 #include <gtest/gtest.h>
 #include <memory>
+#include <thread>
 
 #include "Creators.h"
 #include "DexClass.h"
@@ -408,3 +409,35 @@ TEST_F(ResolverTest, ResolveMethod) {
   EXPECT_TRUE(resolve_method(g_method, MethodSearch::InterfaceVirtual) ==
               e_method);
 }
+
+TEST_F(ResolverTest, ConcurrentMethodRefCache) {
+  create_method_scope();
+
+  auto b_method = DexMethod::get_method("B.method:()V");
+  auto c_method = DexMethod::get_method("C.method:()V");
+
+  ConcurrentMethodRefCache ref_cache;
+  EXPECT_EQ(resolve_method(c_method, MethodSearch::Virtual, ref_cache),
+            b_method);
+  EXPECT_EQ(ref_cache.misses(), 1);
+  EXPECT_EQ(resolve_method(c_method, MethodSearch::Virtual, ref_cache),
+            b_method);
+  EXPECT_EQ(ref_cache.l1_hits(), 1);
+
+  // Another thread only finds the entry in the shared map.
+  std::thread([&] {
+    EXPECT_EQ(resolve_method(c_method, MethodSearch::Virtual, ref_cache),
+              b_method);
+  }).join();
+  EXPECT_EQ(ref_cache.l2_hits(), 1);
+
+  // Entries of another cache don't leak into this one, even on the same
+  // thread.
+  ConcurrentMethodRefCache other_cache;
+  EXPECT_EQ(other_cache.get(MethodRefCacheKey{c_method, MethodSearch::Virtual}),
+            nullptr);
+
+  ref_cache.invalidate();
+  EXPECT_EQ(ref_cache.get(MethodRefCacheKey{c_method, MethodSearch::Virtual}),
+            nullptr);
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "RedexTestUtils.h"
+#include "ResourceScanCache.h"
+
+namespace {
+
+void write_file(const std::string& path, const std::string& contents) {
+  std::ofstream out(path, std::ofstream::binary);
+  out << contents;
+}
+
+} // namespace
+
+TEST(ResourceScanCacheTest, entryFollowsFileContents) {
+  auto tmp_dir = redex::make_tmp_dir("redex_resource_scan_cache_test_%%%%%%%%");
+  auto file = tmp_dir.path + "/layout.xml";
+  write_file(file, "<LinearLayout/>");
+  ResourceScanCache cache(tmp_dir.path + "/cache");
+
+  ResourceScanCache::Entry entry;
+  EXPECT_FALSE(cache.lookup(cache.key(file, "layout"), &entry));
+  entry.classes = {"Lcom/foo/Bar;", "Lcom/foo/Baz;"};
+  entry.attributes.emplace("android:onClick", "onBar");
+  entry.attributes.emplace("android:onClick", "onBaz");
+  cache.record(cache.key(file, "layout"), entry);
+
+  ResourceScanCache::Entry cached;
+  EXPECT_TRUE(cache.lookup(cache.key(file, "layout"), &cached));
+  EXPECT_EQ(cached.classes, entry.classes);
+  EXPECT_EQ(cached.attributes, entry.attributes);
+
+  // Another scan of the same file needs its own entry.
+  ResourceScanCache::Entry other;
+  EXPECT_FALSE(cache.lookup(cache.key(file, "layout-attrs"), &other));
+
+  // Changing the file invalidates its entry, and restoring it revalidates it.
+  write_file(file, "<FrameLayout/>");
+  ResourceScanCache::Entry changed;
+  EXPECT_FALSE(cache.lookup(cache.key(file, "layout"), &changed));
+  EXPECT_TRUE(changed.classes.empty());
+  write_file(file, "<LinearLayout/>");
+  ResourceScanCache::Entry restored;
+  EXPECT_TRUE(cache.lookup(cache.key(file, "layout"), &restored));
+  EXPECT_EQ(restored.classes, entry.classes);
+
+  // Entries are keyed on contents, so a copy of the file shares them.
+  auto copy = tmp_dir.path + "/copy.xml";
+  write_file(copy, "<LinearLayout/>");
+  EXPECT_EQ(cache.key(copy, "layout"), cache.key(file, "layout"));
+
+  EXPECT_EQ(cache.hits(), 2);
+  EXPECT_EQ(cache.misses(), 3);
+}
@@ -180,6 +180,30 @@ TEST(ResStringPool, AppendToExistingUTF16) {
   ASSERT_EQ(out_len, 14);
 }
 
+TEST(ResStringPool, StringViews) {
+  android::ResStringPool pool(&example_data_8, example_data_8.size(), false);
+  pool.appendString(android::String8("€666"));
+  android::Vector<char> v;
+  pool.serialize(v);
+  android::ResStringPool after((void*)v.array(), v.size(), false);
+
+  std::string storage;
+  auto view = apk::get_string_view_from_pool(after, 0, &storage);
+  EXPECT_EQ(view, "Hello, world");
+  // Strings of UTF-8 pools are viewed in place.
+  EXPECT_TRUE(storage.empty());
+  EXPECT_GE(view.data(), v.array());
+  EXPECT_LE(view.data() + view.size(), v.array() + v.size());
+  EXPECT_EQ(apk::get_string_view_from_pool(after, 2, &storage), "€666");
+  EXPECT_EQ(apk::get_string_from_pool(after, 2), "€666");
+
+  android::ResStringPool pool16(&example_data_16, example_data_16.size(),
+                                false);
+  EXPECT_EQ(apk::get_string_view_from_pool(pool16, 3, &storage), "layout");
+  EXPECT_EQ(storage, "layout");
+  EXPECT_EQ(apk::get_string_from_pool(pool16, 4), "string");
+}
+
 TEST(ResStringPool, ReplaceStringsInXmlLayout) {
   // Given layout file should have a series of View subclasses in the XML, which
   // we will rename. Parse the resulting binary data, and make sure all tags are
@@ -402,3 +426,29 @@ TEST(ResTableParse, TestUnknownPackageChunks) {
   EXPECT_TRUE(
       are_files_equal(std::getenv("resources_unknown_chunk"), res_path));
 }
+
+TEST(ResTableParse, TestRemapIdsInPlace) {
+  // Remapping IDs edits the file in place, which must give the same result as
+  // serializing the remapped table.
+  auto tmp_dir = redex::make_tmp_dir("ResTableParse%%%%%%%%");
+  auto in_place_path = tmp_dir.path + "/in_place.arsc";
+  auto serialized_path = tmp_dir.path + "/serialized.arsc";
+  copy_file(std::getenv("test_arsc_path"), in_place_path);
+  copy_file(std::getenv("test_arsc_path"), serialized_path);
+  std::map<uint32_t, uint32_t> old_to_new;
+  {
+    ResourcesArscFile res_table(in_place_path);
+    auto& ids = res_table.sorted_res_ids;
+    ASSERT_GE(ids.size(), 2);
+    for (size_t i = 0; i < ids.size(); i++) {
+      old_to_new.emplace(ids[i], ids[ids.size() - 1 - i]);
+    }
+    res_table.remap_res_ids_and_serialize({in_place_path}, old_to_new);
+  }
+  {
+    ResourcesArscFile res_table(serialized_path);
+    res_table.remap_ids(old_to_new);
+    res_table.serialize();
+  }
+  EXPECT_TRUE(are_files_equal(in_place_path, serialized_path));
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "SccCondensation.h"
+
+namespace {
+
+using Graph = std::map<int, std::vector<int>>;
+
+SccCondensation<int> condense(const Graph& graph,
+                              const std::vector<int>& roots) {
+  return SccCondensation<int>(
+      roots, [&](int node) -> const std::vector<int>& {
+        static const std::vector<int> no_succs;
+        auto it = graph.find(node);
+        return it == graph.end() ? no_succs : it->second;
+      });
+}
+
+std::set<int> members(const SccCondensation<int>& sccs, size_t c) {
+  const auto& component = sccs.component(c);
+  return std::set<int>(component.begin(), component.end());
+}
+
+} // namespace
+
+TEST(SccCondensationTest, components) {
+  // 1 -> {2, 3} -> 4, with the cycle 2 <-> 3 and the self loop 5 -> 5.
+  Graph graph{{1, {2}}, {2, {3, 4}}, {3, {2}}, {5, {5, 4}}};
+  auto sccs = condense(graph, {1, 5});
+
+  EXPECT_EQ(sccs.size(), 4);
+  EXPECT_FALSE(sccs.contains(6));
+
+  auto c1 = sccs.component_of(1);
+  auto c23 = sccs.component_of(2);
+  auto c4 = sccs.component_of(4);
+  auto c5 = sccs.component_of(5);
+  EXPECT_EQ(sccs.component_of(3), c23);
+  EXPECT_EQ(members(sccs, c23), std::set<int>({2, 3}));
+  EXPECT_EQ(members(sccs, c1), std::set<int>({1}));
+
+  EXPECT_FALSE(sccs.is_recursive(c1));
+  EXPECT_TRUE(sccs.is_recursive(c23));
+  EXPECT_FALSE(sccs.is_recursive(c4));
+  EXPECT_TRUE(sccs.is_recursive(c5));
+
+  EXPECT_EQ(sccs.successors(c1), std::vector<size_t>({c23}));
+  EXPECT_EQ(sccs.successors(c23), std::vector<size_t>({c4}));
+  EXPECT_EQ(sccs.successors(c5), std::vector<size_t>({c4}));
+  EXPECT_TRUE(sccs.successors(c4).empty());
+}
+
+TEST(SccCondensationTest, bottomUpOrder) {
+  Graph graph{{0, {1, 2}}, {1, {3}}, {2, {3, 0}}, {3, {4}}, {4, {}}};
+  auto sccs = condense(graph, {0});
+  for (size_t c = 0; c < sccs.size(); ++c) {
+    for (auto s : sccs.successors(c)) {
+      EXPECT_LT(s, c);
+    }
+  }
+  EXPECT_EQ(sccs.component_of(4), 0);
+  EXPECT_EQ(sccs.component_of(3), 1);
+  EXPECT_EQ(members(sccs, sccs.size() - 1), std::set<int>({0, 2}));
+}
+
+TEST(SccCondensationTest, deepChain) {
+  // Long enough that a recursive traversal would overflow the stack.
+  constexpr int kLength = 1000000;
+  Graph graph;
+  for (int i = 0; i < kLength; ++i) {
+    graph[i] = {i + 1};
+  }
+  graph[kLength] = {0};
+  auto sccs = condense(graph, {0});
+  EXPECT_EQ(sccs.size(), 1);
+  EXPECT_TRUE(sccs.is_recursive(0));
+  EXPECT_EQ(sccs.component(0).size(), kLength + 1);
+}
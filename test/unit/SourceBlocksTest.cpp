@@ -61,10 +61,10 @@ class SourceBlocksTest : public RedexTest {
       auto vec = gather_source_blocks(block);
       for (auto* sb : vec) {
         oss << " " << show(sb->src) << "@" << sb->id;
-        if (!sb->vals.empty()) {
+        if (!sb->vals().empty()) {
           oss << "(";
           bool first_val = true;
-          for (const auto& val : sb->vals) {
+          for (const auto& val : sb->vals()) {
             if (!first_val) {
               oss << "|";
             }
@@ -221,6 +221,45 @@ B3: LFoo;.bar:()V@2(0.3:0.3)
 B4: LFoo;.bar:()V@3(0.4:0.2))");
 }
 
+TEST_F(SourceBlocksTest, complex_deserialize_whitespace) {
+  auto method = create_method();
+  method->get_code()->build_cfg();
+  auto& cfg = method->get_code()->cfg();
+
+  ASSERT_EQ(cfg.blocks().size(), 1u);
+  auto b = cfg.blocks()[0];
+
+  auto b1 = cfg.create_block();
+  auto b2 = cfg.create_block();
+
+  cfg.add_edge(b, b1, EDGE_GOTO);
+  cfg.add_edge(b, b2, EDGE_BRANCH);
+  cfg.add_edge(b1, b2, EDGE_GOTO);
+
+  // Tokens may be separated by any whitespace, or by none next to
+  // parentheses.
+  auto profile = single_profile(" ( 0.1:0.5\tg (0.2:0.4\ng(0.3:0.3 ))b )");
+
+  auto res = insert_source_blocks(method, &cfg, profile,
+                                  /*serialize=*/true);
+
+  EXPECT_EQ(res.serialized, "(0 g(1 g(2)) b)");
+  EXPECT_TRUE(res.profile_success);
+  EXPECT_EQ(get_blocks_as_txt({b, b1, b2}),
+            R"(B0: LFoo;.bar:()V@0(0.1:0.5)
+B1: LFoo;.bar:()V@1(0.2:0.4)
+B2: LFoo;.bar:()V@2(0.3:0.3))");
+  strip_source_blocks(cfg);
+
+  // Profiles are checked to be well-formed before matching.
+  try {
+    insert_source_blocks(method, &cfg, single_profile("(0.1:0.5 g(0.2:0.4"),
+                         /*serialize=*/true);
+    ADD_FAILURE() << "Expected exception.";
+  } catch (const std::exception& e) {
+  }
+}
+
 TEST_F(SourceBlocksTest, complex_deserialize_default) {
   auto method = create_method();
   method->get_code()->build_cfg();
@@ -700,3 +739,25 @@ B3: LFoo;.bar:()V@4(5:0))");
   EXPECT_EQ(coalesced.first, 1);
   EXPECT_EQ(coalesced.second, 4);
 }
+
+TEST_F(SourceBlocksTest, vals_are_interned) {
+  using Val = SourceBlock::Val;
+  std::vector<Val> vals{Val(1, 0.5), Val::none(), Val(0, 0)};
+  SourceBlock a(nullptr, 0, vals);
+  SourceBlock b(nullptr, 1, vals);
+  EXPECT_EQ(a.vals().begin(), b.vals().begin());
+  EXPECT_EQ(a.vals_size(), 3);
+  EXPECT_EQ(*a.get_val(0), 1);
+  EXPECT_FALSE(a.get_val(1));
+
+  b.set_val(1, Val(2, 1));
+  EXPECT_NE(a.vals().begin(), b.vals().begin());
+  EXPECT_FALSE(a.get_val(1));
+  EXPECT_EQ(*b.get_val(1), 2);
+
+  b.set_val(1, Val::none());
+  EXPECT_EQ(a.vals().begin(), b.vals().begin());
+
+  SourceBlock empty(nullptr, 2, {});
+  EXPECT_TRUE(empty.vals().empty());
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+
+#include "SuffixArray.h"
+
+namespace {
+
+std::vector<uint32_t> naive_suffix_array(const std::vector<uint32_t>& text) {
+  std::vector<uint32_t> sa(text.size());
+  for (size_t i = 0; i < sa.size(); ++i) {
+    sa[i] = i;
+  }
+  std::sort(sa.begin(), sa.end(), [&](uint32_t a, uint32_t b) {
+    return std::lexicographical_compare(text.begin() + a, text.end(),
+                                        text.begin() + b, text.end());
+  });
+  return sa;
+}
+
+std::vector<uint32_t> naive_longest_repeated_prefixes(
+    const std::vector<uint32_t>& text) {
+  std::vector<uint32_t> res(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    for (size_t j = 0; j < text.size(); ++j) {
+      if (i == j) {
+        continue;
+      }
+      uint32_t h = 0;
+      while (i + h < text.size() && j + h < text.size() &&
+             text[i + h] == text[j + h]) {
+        h++;
+      }
+      res[i] = std::max(res[i], h);
+    }
+  }
+  return res;
+}
+
+} // namespace
+
+TEST(SuffixArrayTest, banana) {
+  // b=1, a=0, n=2
+  std::vector<uint32_t> text{1, 0, 2, 0, 2, 0};
+  auto sa = suffix_array::build(text, 3);
+  EXPECT_EQ(sa, std::vector<uint32_t>({5, 3, 1, 0, 4, 2}));
+  auto lcp = suffix_array::build_lcp(text, sa);
+  EXPECT_EQ(lcp, std::vector<uint32_t>({0, 1, 3, 0, 0, 2}));
+  EXPECT_EQ(suffix_array::longest_repeated_prefixes(text, 3),
+            std::vector<uint32_t>({0, 3, 2, 3, 2, 1}));
+}
+
+TEST(SuffixArrayTest, empty) {
+  EXPECT_TRUE(suffix_array::build({}, 1).empty());
+  EXPECT_TRUE(suffix_array::longest_repeated_prefixes({}, 1).empty());
+}
+
+TEST(SuffixArrayTest, matchesNaive) {
+  std::mt19937 rng(0);
+  for (size_t iteration = 0; iteration < 500; ++iteration) {
+    uint32_t alphabet_size = 1 + rng() % 4;
+    std::vector<uint32_t> text(rng() % 50);
+    for (auto& symbol : text) {
+      symbol = rng() % alphabet_size;
+    }
+    EXPECT_EQ(suffix_array::build(text, alphabet_size),
+              naive_suffix_array(text));
+    EXPECT_EQ(suffix_array::longest_repeated_prefixes(text, alphabet_size),
+              naive_longest_repeated_prefixes(text));
+  }
+}
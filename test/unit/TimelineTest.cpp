@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fstream>
+#include <unordered_set>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <json/json.h>
+
+#include "RedexTestUtils.h"
+#include "Timeline.h"
+#include "Timer.h"
+#include "WorkQueue.h"
+
+namespace {
+
+Json::Value read_json(const std::string& path) {
+  std::ifstream in(path);
+  Json::Value root;
+  in >> root;
+  return root;
+}
+
+} // namespace
+
+TEST(TimelineTest, writesTimersAndTaskBatches) {
+  auto tmp_dir = redex::make_tmp_dir("TimelineTest%%%%%%%%");
+  auto path = tmp_dir.path + "/timeline.json";
+
+  timeline::set_enabled(true);
+  { Timer t("outer \"timer\""); }
+  std::vector<int> items(1000);
+  workqueue_run<int>([](int) {}, items, 2);
+  timeline::set_enabled(false);
+  // Not recorded.
+  { Timer t("disabled timer"); }
+  timeline::write_chrome_trace(path);
+
+  auto root = read_json(path);
+  const auto& events = root["traceEvents"];
+  ASSERT_TRUE(events.isArray());
+  size_t timers = 0;
+  size_t tasks = 0;
+  std::unordered_set<int> threads;
+  for (const auto& event : events) {
+    auto ph = event["ph"].asString();
+    if (ph == "M") {
+      threads.insert(event["tid"].asInt());
+      continue;
+    }
+    EXPECT_EQ(ph, "X");
+    EXPECT_GE(event["dur"].asInt64(), 0);
+    EXPECT_EQ(threads.count(event["tid"].asInt()), 1);
+    auto cat = event["cat"].asString();
+    if (cat == "timer") {
+      EXPECT_EQ(event["name"].asString(), "outer \"timer\"");
+      ++timers;
+    } else if (cat == "workqueue") {
+      tasks += event["args"]["tasks"].asUInt64();
+    }
+  }
+  EXPECT_EQ(timers, 1);
+  EXPECT_EQ(tasks, items.size());
+}
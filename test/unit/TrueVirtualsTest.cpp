@@ -507,3 +507,23 @@ TEST_F(DevirtualizerTest, GenericRichHierarchy) {
                   "LA;.final1:()V", "LABA;.final2:()V", "LAA;.final1:(I)V",
                   "LAAB;.final2:()V", "LAAA;.final2:()V"));
 }
+
+TEST_F(DevirtualizerTest, GraphIsReusedUntilHierarchyChanges) {
+  std::vector<DexClass*> scope = create_scope_3();
+  auto graph1 = mog::build_graph(scope);
+  auto graph2 = mog::build_graph(scope);
+  // The second graph shares the storage of the first one.
+  EXPECT_EQ(&graph1->nodes(), &graph2->nodes());
+
+  auto b_cls = type_class(DexType::get_type("LB;"));
+  auto a_meth = DexMethod::get_method("LA;.intf_meth1:()V")->as_def();
+  auto void_void =
+      DexProto::make_proto(type::_void(), DexTypeList::make_type_list({}));
+  auto b_meth = create_empty_method(b_cls, "intf_meth1", void_void);
+  auto graph3 = mog::build_graph(scope);
+  EXPECT_NE(&graph1->nodes(), &graph3->nodes());
+  EXPECT_TRUE(graph1->get_node(b_meth).parents.empty());
+  EXPECT_THAT(graph3->get_node(a_meth).children,
+              ::testing::Contains(b_meth));
+  EXPECT_THAT(graph3->get_node(b_meth).parents, ::testing::Contains(a_meth));
+}
@@ -1578,3 +1578,80 @@ TEST_F(VirtScopeTest, VitualInterfaceResolutionTest) {
   EXPECT_EQ(*methods.begin(), DexMethod::get_method(g_t, g, void_int));
   methods.clear();
 }
+
+/**
+ * A hierarchy wide enough for the children of A to be merged in parallel
+ *
+ * class A { void f() {} }
+ * class Bi extends A { void f() {} void gi_j() {} ... }
+ */
+TEST_F(VirtScopeTest, WideHierarchy) {
+  constexpr size_t kNumChildren = 8;
+  constexpr size_t kNumMethods = 600;
+  Scope scope = create_empty_scope();
+  auto void_void =
+      DexProto::make_proto(type::_void(), DexTypeList::make_type_list({}));
+  auto a_t = DexType::make_type("LA;");
+  auto a_cls = create_internal_class(a_t, type::java_lang_Object(), {});
+  scope.push_back(a_cls);
+  auto a_f = create_empty_method(a_cls, "f", void_void);
+  std::vector<DexMethod*> b_fs;
+  for (size_t i = 0; i < kNumChildren; i++) {
+    auto b_t = DexType::make_type("LB" + std::to_string(i) + ";");
+    auto b_cls = create_internal_class(b_t, a_t, {});
+    scope.push_back(b_cls);
+    b_fs.push_back(create_empty_method(b_cls, "f", void_void));
+    for (size_t j = 0; j < kNumMethods; j++) {
+      auto name = "g" + std::to_string(i) + "_" + std::to_string(j);
+      create_empty_method(b_cls, name.c_str(), void_void);
+    }
+  }
+
+  ClassHierarchy ch = build_type_hierarchy(scope);
+  SignatureMap sm = build_signature_map(ch);
+  ASSERT_EQ(sm.size(), OBJ_METH_NAMES + 1 + kNumChildren * kNumMethods);
+
+  const auto& f_scopes = sm.at(DexString::get_string("f")).at(void_void);
+  ASSERT_EQ(f_scopes.size(), 1);
+  const auto& f_methods = f_scopes[0].methods;
+  ASSERT_EQ(f_methods.size(), kNumChildren + 1);
+  EXPECT_EQ(f_methods[0].first, a_f);
+  EXPECT_EQ(f_methods[0].second, TOP_DEF);
+  for (size_t i = 0; i < kNumChildren; i++) {
+    EXPECT_EQ(f_methods[i + 1].first, b_fs[i]);
+    EXPECT_EQ(f_methods[i + 1].second, OVERRIDE | FINAL);
+  }
+
+  for_every_scope(sm,
+                  [&](const DexString* name,
+                      const DexProto* proto,
+                      const VirtualScopes& scopes) {
+                    EXPECT_EQ(scopes.size(), 1);
+                    if (name->str()[0] == 'g') {
+                      EXPECT_EQ(scopes[0].methods.size(), 1);
+                      EXPECT_EQ(scopes[0].methods[0].second, TOP_DEF | FINAL);
+                    }
+                  });
+
+  ClassScopes cs(scope);
+  EXPECT_EQ(cs.get(a_t).size(), 1);
+  EXPECT_EQ(cs.get(b_fs[0]->get_class()).size(), kNumMethods);
+}
+
+TEST_F(VirtScopeTest, ClassScopesAreReused) {
+  std::vector<DexClass*> scope = create_scope_2();
+  auto class_scopes = ClassScopes::get_or_build(scope);
+  EXPECT_EQ(ClassScopes::get_or_build(scope), class_scopes);
+  TypeSystem type_system(scope);
+  EXPECT_EQ(&type_system.get_class_scopes(), class_scopes.get());
+
+  // Adding a virtual method changes the scopes.
+  auto void_void =
+      DexProto::make_proto(type::_void(), DexTypeList::make_type_list({}));
+  auto d_cls = type_class(DexType::get_type("LD;"));
+  auto d_g = create_empty_method(d_cls, "g", void_void);
+  auto new_class_scopes = ClassScopes::get_or_build(scope);
+  EXPECT_NE(new_class_scopes, class_scopes);
+  EXPECT_EQ(new_class_scopes->find_virtual_scope(d_g).methods[0].first, d_g);
+  EXPECT_EQ(ClassScopes::get_or_build(scope), new_class_scopes);
+}
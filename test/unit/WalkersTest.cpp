@@ -7,14 +7,29 @@
 
 #include "Walkers.h"
 
+#include <atomic>
 #include <gmock/gmock.h>
 
+#include "ConcurrentContainers.h"
 #include "DexUtil.h"
+#include "IRAssembler.h"
 #include "RedexTest.h"
 #include "Show.h"
 
 struct WalkersTest : public RedexTest {};
 
+namespace {
+
+using Names = std::vector<std::string>;
+
+struct AppendNames {
+  void operator()(const Names& addend, Names* accumulator) const {
+    accumulator->insert(accumulator->end(), addend.begin(), addend.end());
+  }
+};
+
+} // namespace
+
 TEST_F(WalkersTest, accumlate) {
   ClassCreator cc(DexType::make_type("LFoo;"));
   cc.set_super(type::java_lang_Object());
@@ -37,3 +52,75 @@ TEST_F(WalkersTest, accumlate) {
       ::testing::UnorderedElementsAre(
           "LFoo;.bar:()V", "LFoo;.baz:()V", "LFoo;.qux:()V", "LFoo;.quux:()V"));
 }
+
+TEST_F(WalkersTest, methodsByCost) {
+  ClassCreator cc(DexType::make_type("LFoo;"));
+  cc.set_super(type::java_lang_Object());
+  auto make_method = [&](const std::string& name, size_t num_insns) {
+    auto* method = DexMethod::make_method("LFoo;." + name + ":()V")
+                       ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    std::string body = "(";
+    for (size_t i = 0; i < num_insns; ++i) {
+      body += "(const v0 0)";
+    }
+    body += "(return-void))";
+    method->set_code(assembler::ircode_from_string(body));
+    cc.add_method(method);
+  };
+  make_method("small", 1);
+  make_method("large", 20);
+  make_method("medium", 5);
+  cc.add_method(DexMethod::make_method("LFoo;.abstract:()V")
+                    ->make_concrete(ACC_PUBLIC | ACC_ABSTRACT, true));
+
+  Scope scope{cc.create()};
+  // With a single thread, the methods are visited in order of decreasing
+  // size.
+  auto names = walk::parallel::methods_by_cost<Names, AppendNames>(
+      scope,
+      [&](DexMethod* m, Names* acc) { acc->push_back(m->get_name()->str()); },
+      1);
+  EXPECT_THAT(names,
+              ::testing::ElementsAre("large", "medium", "small", "abstract"));
+
+  auto counts = walk::parallel::methods_by_cost<size_t>(
+      scope, [&](DexMethod* m) -> size_t { return 1; }, 2);
+  EXPECT_EQ(counts, 4);
+}
+
+TEST_F(WalkersTest, chunked) {
+  Scope scope;
+  for (size_t c = 0; c < 100; ++c) {
+    auto name = "LChunked" + std::to_string(c) + ";";
+    ClassCreator cc(DexType::make_type(name));
+    cc.set_super(type::java_lang_Object());
+    for (size_t m = 0; m < c % 4; ++m) {
+      auto* method =
+          DexMethod::make_method(name + ".m" + std::to_string(m) + ":()V")
+              ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+      if (m != 0) {
+        method->set_code(assembler::ircode_from_string("((return-void))"));
+      }
+      cc.add_method(method);
+    }
+    scope.push_back(cc.create());
+  }
+
+  ConcurrentSet<DexMethod*> methods;
+  std::atomic<size_t> num_methods{0};
+  walk::parallel::chunked_methods(
+      scope,
+      [&](DexMethod* m) {
+        methods.insert(m);
+        num_methods++;
+      },
+      3);
+  EXPECT_EQ(num_methods, 150);
+  EXPECT_EQ(methods.size(), 150);
+
+  std::atomic<size_t> num_code{0};
+  walk::parallel::chunked_code(
+      scope, [](DexMethod*) { return true; },
+      [&](DexMethod*, IRCode&) { num_code++; }, 3);
+  EXPECT_EQ(num_code, 75);
+}
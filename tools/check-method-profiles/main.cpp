@@ -15,10 +15,26 @@ int main(int argc, char* argv[]) {
       std::string("-h") == argv[1]) {
     // No args (or help), print usage.
     std::cerr << "Usage: check-method-profiles PROF-FILE [PROF-FILE...]"
+              << std::endl
+              << "       check-method-profiles --to-binary CSV-FILE OUT-FILE"
               << std::endl;
     return argc == 1 ? 1 : 0;
   }
 
+  if (std::string("--to-binary") == argv[1]) {
+    if (argc != 4) {
+      std::cerr << "--to-binary expects an input and an output file"
+                << std::endl;
+      return 1;
+    }
+    RedexContext rc;
+    g_redex = &rc;
+    bool success =
+        method_profiles::MethodProfiles::convert_to_binary(argv[2], argv[3]);
+    g_redex = nullptr;
+    return success ? 0 : 1;
+  }
+
   std::vector<std::string> files;
   for (int i = 1; i < argc; ++i) {
     files.push_back(argv[i]);
@@ -16,8 +16,11 @@
 #ifdef __GNUC__
 #pragma GCC diagnostic pop
 #endif
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <json/json.h>
+#include <string_view>
 
 #include "CommentFilter.h"
 #include "DexLoader.h"
@@ -34,6 +37,9 @@
 
 #if IS_WINDOWS
 #include <io.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
 #endif
 
 namespace {
@@ -42,10 +48,6 @@ namespace {
  * line arguments.
  */
 const std::string ENTRY_FILE = "/entry.json";
-void load_entry_file(const std::string& input_ir_dir, Json::Value* entry_data) {
-  std::ifstream istrm(input_ir_dir + ENTRY_FILE);
-  istrm >> *entry_data;
-}
 
 void write_entry_file(const std::string& output_ir_dir,
                       const Json::Value& entry_data) {
@@ -181,10 +183,80 @@ bool is_zip(const std::string& filename) {
   // the first two bytes of a ZIP file are usually "PK"
   return buffer[0] == 'P' && buffer[1] == 'K';
 }
+
+// The position of a root store dex in an APK, classes.dex being 1 and
+// classesN.dex being N, or 0 for other entries.
+size_t apk_dex_index(const std::string& name) {
+  constexpr std::string_view kPrefix = "classes";
+  constexpr std::string_view kSuffix = ".dex";
+  if (name.size() < kPrefix.size() + kSuffix.size() ||
+      name.compare(0, kPrefix.size(), kPrefix) != 0 ||
+      name.compare(name.size() - kSuffix.size(), kSuffix.size(), kSuffix) !=
+          0) {
+    return 0;
+  }
+  auto number = name.substr(kPrefix.size(),
+                            name.size() - kPrefix.size() - kSuffix.size());
+  if (number.empty()) {
+    return 1;
+  }
+  if (number[0] == '0' || number.find_first_not_of("0123456789") !=
+                              std::string::npos) {
+    return 0;
+  }
+  return std::stoul(number);
+}
+
+/**
+ * Loads the root store dexes of an APK straight from memory. They are
+ * inflated in parallel, without extracting them to disk first. The dexes of
+ * other stores, which the APK holds in nested jars, are not loaded.
+ */
+void load_classes_from_apk(const std::string& filename,
+                           DexStore& root_store,
+                           dex_stats_t& input_totals,
+                           std::vector<dex_stats_t>& input_dexes_stats) {
+  zip_entries_t dexes;
+  always_assert_log(
+      inflate_zip_entries(
+          filename.c_str(),
+          [](const std::string& name) { return apk_dex_index(name) != 0; },
+          &dexes),
+      "Cannot read the dexes of %s", filename.c_str());
+  always_assert_log(!dexes.empty(), "APK %s contains no dex file",
+                    filename.c_str());
+  std::sort(dexes.begin(), dexes.end(), [](const auto& a, const auto& b) {
+    return apk_dex_index(a.first) < apk_dex_index(b.first);
+  });
+  for (auto& [name, buffer] : dexes) {
+    auto location = filename + "!/" + name;
+    std::string magic(buffer->data(),
+                      strnlen(buffer->data(), std::min<size_t>(
+                                                  buffer->size(),
+                                                  sizeof(dex_header::magic))));
+    // The dex magic of an APK input is only known once it is inflated.
+    if (root_store.get_dex_magic().empty()) {
+      root_store.set_dex_magic(magic);
+    }
+    assert_dex_magic_consistency(root_store.get_dex_magic(), magic);
+    dex_stats_t dex_stats;
+    DexClasses classes = load_classes_from_dex(std::move(buffer),
+                                               location.c_str(), &dex_stats);
+    input_totals += dex_stats;
+    input_dexes_stats.push_back(dex_stats);
+    root_store.add_classes(std::move(classes));
+  }
+}
 } // namespace
 
 namespace redex {
 
+bool is_apk(const std::string& filename) {
+  bool is_dex = filename.size() >= 5 &&
+                filename.compare(filename.size() - 4, 4, ".dex") == 0;
+  return !is_dex && is_zip(filename);
+}
+
 bool dir_is_writable(const std::string& dir) {
   if (!boost::filesystem::is_directory(dir)) {
     return false;
@@ -211,6 +283,75 @@ Json::Value parse_config(const std::string& config_file) {
   return ret;
 }
 
+void merge_variant_config(const Json::Value& patch, Json::Value& config) {
+  for (const auto& key : patch.getMemberNames()) {
+    const auto& value = patch[key];
+    if (value.isObject() && config[key].isObject()) {
+      for (const auto& inner_key : value.getMemberNames()) {
+        config[key][inner_key] = value[inner_key];
+      }
+    } else {
+      config[key] = value;
+    }
+  }
+}
+
+#if !IS_WINDOWS
+std::vector<pid_t> fork_variants(
+    const Variants& variants,
+    const std::function<void(const std::string& out_dir,
+                             const Json::Value& config)>& run_variant) {
+  std::vector<pid_t> pids;
+  for (const auto& [out_dir, config] : variants) {
+    // Don't let buffered output get written twice.
+    std::cout.flush();
+    std::cerr.flush();
+    fflush(nullptr);
+    pid_t pid = fork();
+    if (pid < 0) {
+      int errsv = errno;
+      std::cerr << "error: cannot fork variant for " << out_dir
+                << ". errno = " << errsv << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    if (pid > 0) {
+      TRACE(MAIN, 1, "Forked variant %d for %s", pid, out_dir.c_str());
+      pids.push_back(pid);
+      continue;
+    }
+
+    run_variant(out_dir, config);
+    // Skip the destructors. Tearing down the shared RedexContext would only
+    // touch, and so copy, all of its pages.
+    std::cout.flush();
+    std::cerr.flush();
+    fflush(nullptr);
+    _exit(EXIT_SUCCESS);
+  }
+  return pids;
+}
+
+bool wait_for_variants(const Variants& variants,
+                       const std::vector<pid_t>& pids) {
+  bool success = true;
+  for (size_t i = 0; i < pids.size(); ++i) {
+    int status;
+    if (waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != EXIT_SUCCESS) {
+      std::cerr << "error: variant for " << variants[i].first << " failed"
+                << std::endl;
+      success = false;
+    }
+  }
+  return success;
+}
+#endif
+
+void load_entry_file(const std::string& input_ir_dir, Json::Value* entry_data) {
+  std::ifstream istrm(input_ir_dir + ENTRY_FILE);
+  istrm >> *entry_data;
+}
+
 /**
  * Dumping dex, IR meta data and entry file
  */
@@ -260,7 +401,7 @@ void load_all_intermediate(const std::string& input_ir_dir,
 
 /**
  * Helper to load classes from a list of input dex files into a DexStoresVector.
- * Processes dex (.dex) files as well as DexMetadata files (.json)
+ * Processes dex (.dex) files, APKs as well as DexMetadata files (.json)
  */
 void load_classes_from_dexes_and_metadata(
     const std::vector<std::string>& dex_files,
@@ -269,9 +410,35 @@ void load_classes_from_dexes_and_metadata(
     std::vector<dex_stats_t>& input_dexes_stats) {
   always_assert_log(!stores.empty(),
                     "Cannot load classes into empty DexStoresVector");
+  // The dexes of consecutive stores are loaded together, in parallel. Their
+  // classes are still claimed in order, so the same duplicates are dropped as
+  // when loading the dexes one after the other.
+  std::vector<DexStore> pending_stores;
+  std::vector<std::string> pending_files;
+  std::vector<size_t> pending_store_sizes;
+  auto load_pending_stores = [&]() {
+    if (pending_stores.empty()) {
+      return;
+    }
+    std::vector<dex_stats_t> dexes_stats;
+    auto dexes = load_classes_from_dexes(pending_files, &dexes_stats);
+    size_t dex_idx = 0;
+    for (size_t i = 0; i < pending_stores.size(); ++i) {
+      for (size_t j = 0; j < pending_store_sizes[i]; ++j, ++dex_idx) {
+        input_totals += dexes_stats[dex_idx];
+        input_dexes_stats.push_back(dexes_stats[dex_idx]);
+        pending_stores[i].add_classes(std::move(dexes[dex_idx]));
+      }
+      stores.emplace_back(std::move(pending_stores[i]));
+    }
+    pending_stores.clear();
+    pending_files.clear();
+    pending_store_sizes.clear();
+  };
   for (const auto& filename : dex_files) {
     if (filename.size() >= 5 &&
         filename.compare(filename.size() - 4, 4, ".dex") == 0) {
+      load_pending_stores();
       assert_dex_magic_consistency(stores[0].get_dex_magic(),
                                    load_dex_magic_from_dex(filename.c_str()));
       dex_stats_t dex_stats;
@@ -280,32 +447,23 @@ void load_classes_from_dexes_and_metadata(
       input_dexes_stats.push_back(dex_stats);
       stores[0].add_classes(std::move(classes));
     } else if (is_zip(filename)) {
-      std::cerr << "error: Input files are expected to be DEX (with filename "
-                   "ending in "
-                   ".dex), or a JSON metadata file. However, \""
-                << filename
-                << "\" is a ZIP. If this is an APK, please extract "
-                   "the DEX files from it and pass those as the inputs.";
-      exit(EXIT_FAILURE);
+      load_pending_stores();
+      load_classes_from_apk(filename, stores[0], input_totals,
+                            input_dexes_stats);
     } else {
       DexMetadata store_metadata;
       store_metadata.parse(filename);
-      DexStore store(store_metadata);
       for (const auto& file_path : store_metadata.get_files()) {
         assert_dex_magic_consistency(
             stores[0].get_dex_magic(),
             load_dex_magic_from_dex(file_path.c_str()));
-        dex_stats_t dex_stats;
-        DexClasses classes =
-            load_classes_from_dex(file_path.c_str(), &dex_stats);
-
-        input_totals += dex_stats;
-        input_dexes_stats.push_back(dex_stats);
-        store.add_classes(std::move(classes));
+        pending_files.push_back(file_path);
       }
-      stores.emplace_back(std::move(store));
+      pending_store_sizes.push_back(store_metadata.get_files().size());
+      pending_stores.emplace_back(store_metadata);
     }
   }
+  load_pending_stores();
 }
 
 /**
@@ -5,23 +5,67 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "ConfigFiles.h"
 #include "DexStats.h"
 #include "DexStore.h"
+#include "Macros.h"
 #include "PassManager.h"
 
+#if !IS_WINDOWS
+#include <sys/types.h>
+#endif
+
 namespace redex {
 
 bool dir_is_writable(const std::string& dir);
 
+// Whether the input `filename` is an APK rather than a dex or metadata file.
+bool is_apk(const std::string& filename);
+
 Json::Value parse_config(const std::string& config_file);
 
+// Overrides the settings of `config` with those of a variant's `patch`. Pass
+// configs and other objects are merged key by key, like -J does, so that a
+// variant only needs to list the settings it changes.
+void merge_variant_config(const Json::Value& patch, Json::Value& config);
+
+#if !IS_WINDOWS
+// The output directories and configs of the variants of a run, see --variant.
+using Variants = std::vector<std::pair<std::string, Json::Value>>;
+
+/*
+ * Forks a worker for each variant, which calls `run_variant` with its output
+ * directory and config and then exits, it never returns. The workers share
+ * the pages of the loaded input copy-on-write with this process, so the input
+ * is only loaded once, and each only pays for the parts of the IR that its
+ * passes modify. Returns the pids of the workers, in the order of `variants`.
+ *
+ * This must be called while no other threads are running, as only the
+ * calling thread survives in the workers.
+ */
+std::vector<pid_t> fork_variants(
+    const Variants& variants,
+    const std::function<void(const std::string& out_dir,
+                             const Json::Value& config)>& run_variant);
+
+// Waits for the workers of fork_variants. Returns whether all succeeded.
+bool wait_for_variants(const Variants& variants,
+                       const std::vector<pid_t>& pids);
+#endif
+
 void write_all_intermediate(ConfigFiles& conf,
                             const std::string& output_ir_dir,
                             const RedexOptions& redex_options,
                             DexStoresVector& stores,
                             Json::Value& entry_data);
 
+void load_entry_file(const std::string& input_ir_dir, Json::Value* entry_data);
+
 void load_all_intermediate(const std::string& input_ir_dir,
                            DexStoresVector& stores,
                            Json::Value* entry_data);
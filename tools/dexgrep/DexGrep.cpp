@@ -5,28 +5,302 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <getopt.h>
+#include <optional>
+#include <queue>
 #include <regex>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <thread>
+#include <vector>
 
 #include "DexCommon.h"
 
+namespace {
+
 void print_usage() {
-  fprintf(stderr, "Usage: dexgrep <classname> <dexfile 1> <dexfile 2> ...\n");
+  fprintf(stderr,
+          "Usage: dexgrep [options] <pattern> <dexfile 1> <dexfile 2> ...\n"
+          "       dexgrep [options] -e <pattern> [-e ...] <dexfile 1> ...\n"
+          "Options:\n"
+          "  -e, --regexp=PATTERN     search for PATTERN, may be repeated\n"
+          "  -f, --file=FILE          read patterns from FILE, one per line\n"
+          "  -F, --fixed-strings      treat all patterns as literal strings\n"
+          "  -k, --kinds=KINDS        comma-separated names to search among:\n"
+          "                           classes (default), types, strings,\n"
+          "                           methods, fields\n"
+          "  -j, --jobs=N             number of dex files to scan at once\n"
+          "  -l, --files-with-matches print only the names of matching "
+          "files\n");
+}
+
+enum Kind : unsigned {
+  CLASSES = 1 << 0,
+  TYPES = 1 << 1,
+  STRINGS = 1 << 2,
+  METHODS = 1 << 3,
+  FIELDS = 1 << 4,
+};
+
+bool parse_kinds(const char* arg, unsigned* kinds) {
+  *kinds = 0;
+  std::string_view rest(arg);
+  while (!rest.empty()) {
+    auto comma = rest.find(',');
+    auto kind = rest.substr(0, comma);
+    if (kind == "classes") {
+      *kinds |= CLASSES;
+    } else if (kind == "types") {
+      *kinds |= TYPES;
+    } else if (kind == "strings") {
+      *kinds |= STRINGS;
+    } else if (kind == "methods") {
+      *kinds |= METHODS;
+    } else if (kind == "fields") {
+      *kinds |= FIELDS;
+    } else {
+      return false;
+    }
+    rest = comma == std::string_view::npos ? "" : rest.substr(comma + 1);
+  }
+  return *kinds != 0;
+}
+
+bool is_literal(const std::string& pattern) {
+  return pattern.find_first_of("\\^$.|?*+()[]{}") == std::string::npos;
+}
+
+/*
+ * Matches names against all patterns at once. Literal patterns are compiled
+ * into one Aho-Corasick automaton, which finds any of them in a single pass
+ * over a name. The other patterns are alternated into one regex, which only
+ * runs when no literal matched.
+ */
+class Matcher {
+ public:
+  Matcher(const std::vector<std::string>& patterns, bool fixed_strings) {
+    std::string alternation;
+    m_goto.emplace_back();
+    m_goto.back().fill(0);
+    m_accepts.push_back(false);
+    for (const auto& pattern : patterns) {
+      if (fixed_strings || is_literal(pattern)) {
+        add_literal(pattern);
+      } else {
+        alternation += (alternation.empty() ? "(?:" : "|(?:") + pattern + ")";
+      }
+    }
+    build_automaton();
+    if (!alternation.empty()) {
+      m_regex.emplace(alternation, std::regex::optimize);
+    }
+  }
+
+  bool matches(const char* name) const {
+    if (m_accepts[0]) {
+      // The empty literal.
+      return true;
+    }
+    if (m_has_literals) {
+      uint32_t state = 0;
+      for (const char* p = name; *p != '\0'; ++p) {
+        state = m_goto[state][static_cast<unsigned char>(*p)];
+        if (m_accepts[state]) {
+          return true;
+        }
+      }
+    }
+    return m_regex && std::regex_search(name, *m_regex);
+  }
+
+ private:
+  using Transitions = std::array<uint32_t, 256>;
+
+  void add_literal(const std::string& literal) {
+    m_has_literals = true;
+    uint32_t state = 0;
+    for (unsigned char c : literal) {
+      if (m_goto[state][c] == 0) {
+        m_goto[state][c] = m_goto.size();
+        m_goto.emplace_back();
+        m_goto.back().fill(0);
+        m_accepts.push_back(false);
+      }
+      state = m_goto[state][c];
+    }
+    m_accepts[state] = true;
+  }
+
+  // Turns the trie into a DFA: the missing transitions of a state are those
+  // of its longest proper suffix that is also in the trie.
+  void build_automaton() {
+    std::vector<uint32_t> fail(m_goto.size(), 0);
+    std::queue<uint32_t> queue;
+    for (uint32_t child : m_goto[0]) {
+      if (child != 0) {
+        queue.push(child);
+      }
+    }
+    while (!queue.empty()) {
+      uint32_t state = queue.front();
+      queue.pop();
+      m_accepts[state] = m_accepts[state] || m_accepts[fail[state]];
+      for (size_t c = 0; c < 256; ++c) {
+        uint32_t child = m_goto[state][c];
+        if (child != 0) {
+          fail[child] = m_goto[fail[state]][c];
+          queue.push(child);
+        } else {
+          m_goto[state][c] = m_goto[fail[state]][c];
+        }
+      }
+    }
+  }
+
+  std::vector<Transitions> m_goto;
+  std::vector<bool> m_accepts;
+  bool m_has_literals{false};
+  std::optional<std::regex> m_regex;
+};
+
+std::string type_name(ddump_data* rd, uint16_t typeidx) {
+  return dex_string_by_type_idx(rd, typeidx);
+}
+
+std::string method_name(ddump_data* rd, const dex_method_id& method) {
+  const auto& proto = rd->dex_proto_ids[method.protoidx];
+  std::string name = type_name(rd, method.classidx) + "." +
+                     dex_string_by_idx(rd, method.nameidx) + ":(";
+  if (proto.param_off != 0) {
+    auto* params = reinterpret_cast<uint32_t*>(rd->dexmmap + proto.param_off);
+    auto* types = reinterpret_cast<uint16_t*>(params + 1);
+    for (uint32_t i = 0; i < *params; ++i) {
+      name += type_name(rd, types[i]);
+    }
+  }
+  return name + ")" + type_name(rd, proto.rtypeidx);
 }
 
+std::string field_name(ddump_data* rd, const dex_field_id& field) {
+  return type_name(rd, field.classidx) + "." +
+         dex_string_by_idx(rd, field.nameidx) + ":" +
+         type_name(rd, field.typeidx);
+}
+
+// The matching names of one dex file, in the order of the dex tables.
+std::vector<std::string> grep_dex(const char* dexfile,
+                                  const Matcher& matcher,
+                                  unsigned kinds,
+                                  bool files_only) {
+  std::vector<std::string> matches;
+  ddump_data rd;
+  open_dex_file(dexfile, &rd);
+  // Only tag the matches with their kind when several kinds are searched.
+  const bool tag = (kinds & (kinds - 1)) != 0;
+  auto check = [&](const char* kind, const char* name) {
+    if (!files_only || matches.empty()) {
+      if (matcher.matches(name)) {
+        matches.push_back(tag ? std::string(kind) + ": " + name : name);
+      }
+    }
+  };
+  if (kinds & CLASSES) {
+    for (uint32_t j = 0; j < rd.dexh->class_defs_size; j++) {
+      check("class", dex_string_by_type_idx(&rd, rd.dex_class_defs[j].typeidx));
+    }
+  }
+  if (kinds & TYPES) {
+    for (uint32_t j = 0; j < rd.dexh->type_ids_size; j++) {
+      check("type", dex_string_by_type_idx(&rd, j));
+    }
+  }
+  if (kinds & STRINGS) {
+    for (uint32_t j = 0; j < rd.dexh->string_ids_size; j++) {
+      check("string", dex_string_by_idx(&rd, j));
+    }
+  }
+  if (kinds & METHODS) {
+    for (uint32_t j = 0; j < rd.dexh->method_ids_size; j++) {
+      check("method", method_name(&rd, rd.dex_method_ids[j]).c_str());
+    }
+  }
+  if (kinds & FIELDS) {
+    for (uint32_t j = 0; j < rd.dexh->field_ids_size; j++) {
+      check("field", field_name(&rd, rd.dex_field_ids[j]).c_str());
+    }
+  }
+  munmap(rd.dexmmap, rd.dex_size);
+  return matches;
+}
+
+} // namespace
+
 int main(int argc, char* argv[]) {
   bool files_only = false;
-  char c;
+  bool fixed_strings = false;
+  unsigned kinds = CLASSES;
+  size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::string> patterns;
+  bool patterns_given = false;
+  int c;
   static const struct option options[] = {
+      {"files-with-matches", no_argument, nullptr, 'l'},
+      // The historical name of the option.
       {"files-without-match", no_argument, nullptr, 'l'},
+      {"regexp", required_argument, nullptr, 'e'},
+      {"file", required_argument, nullptr, 'f'},
+      {"fixed-strings", no_argument, nullptr, 'F'},
+      {"kinds", required_argument, nullptr, 'k'},
+      {"jobs", required_argument, nullptr, 'j'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
   };
-  while ((c = getopt_long(argc, argv, "hl", &options[0], nullptr)) != -1) {
+  while ((c = getopt_long(argc, argv, "hle:f:Fk:j:", &options[0], nullptr)) !=
+         -1) {
     switch (c) {
     case 'l':
       files_only = true;
       break;
+    case 'e':
+      patterns.emplace_back(optarg);
+      patterns_given = true;
+      break;
+    case 'f': {
+      std::ifstream in(optarg);
+      if (!in) {
+        fprintf(stderr, "%s: cannot read %s\n", argv[0], optarg);
+        return 1;
+      }
+      std::string line;
+      while (std::getline(in, line)) {
+        if (!line.empty()) {
+          patterns.push_back(line);
+        }
+      }
+      patterns_given = true;
+      break;
+    }
+    case 'F':
+      fixed_strings = true;
+      break;
+    case 'k':
+      if (!parse_kinds(optarg, &kinds)) {
+        fprintf(stderr, "%s: bad kinds %s\n", argv[0], optarg);
+        print_usage();
+        return 1;
+      }
+      break;
+    case 'j':
+      jobs = std::max(1, atoi(optarg));
+      break;
     case 'h':
       print_usage();
       return 0;
@@ -36,31 +310,47 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  if (!patterns_given) {
+    if (optind == argc) {
+      fprintf(stderr, "%s: no pattern given\n", argv[0]);
+      print_usage();
+      return 1;
+    }
+    patterns.emplace_back(argv[optind++]);
+  }
   if (optind == argc) {
     fprintf(stderr, "%s: no dex files given\n", argv[0]);
     print_usage();
     return 1;
   }
 
-  const char* search_str = argv[optind];
-  std::regex re(search_str);
-
-  for (int i = optind + 1; i < argc; ++i) {
-    const char* dexfile = argv[i];
-    ddump_data rd;
-    open_dex_file(dexfile, &rd);
+  Matcher matcher(patterns, fixed_strings);
+  std::vector<const char*> dexfiles(argv + optind, argv + argc);
+  std::vector<std::vector<std::string>> results(dexfiles.size());
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    for (size_t i = next++; i < dexfiles.size(); i = next++) {
+      results[i] = grep_dex(dexfiles[i], matcher, kinds, files_only);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < std::min(jobs, dexfiles.size()); ++t) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
 
-    auto size = rd.dexh->class_defs_size;
-    for (uint32_t j = 0; j < size; j++) {
-      dex_class_def* cls_def = rd.dex_class_defs + j;
-      char* name = dex_string_by_type_idx(&rd, cls_def->typeidx);
-      if (std::regex_search(name, re)) {
-        if (files_only) {
-          printf("%s\n", dexfile);
-        } else {
-          printf("%s: %s\n", dexfile, name);
-        }
+  for (size_t i = 0; i < dexfiles.size(); ++i) {
+    if (files_only) {
+      if (!results[i].empty()) {
+        printf("%s\n", dexfiles[i]);
       }
+      continue;
+    }
+    for (const auto& match : results[i]) {
+      printf("%s: %s\n", dexfiles[i], match.c_str());
     }
   }
 }
@@ -0,0 +1,480 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * dexpagesim replays a list of executed methods against an emitted dex, and
+ * counts the 4KiB pages of the dex that this touches for the first time, i.e.
+ * the page faults of a cold page cache. This estimates the effect of layout
+ * changes without running on a device.
+ *
+ * Executing a method touches
+ *  - its code item,
+ *  - the string ids and string data of the strings it loads, and
+ *  - on the first method of a class, the class_def and class_data of the
+ *    class.
+ *
+ * A page fault is attributed to the section that first touched the page.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "DexCommon.h"
+#include "DexEncoding.h"
+#include "DexOpcodeDefs.h"
+
+namespace {
+
+constexpr uint32_t kPageSize = 4096;
+
+enum Section : uint8_t { CODE, STRINGS, CLASSES, NUM_SECTIONS };
+const char* const kSectionNames[NUM_SECTIONS] = {"code", "strings",
+                                                 "classes"};
+
+uint8_t format_units(OpcodeFormat fmt) {
+  switch (fmt) {
+  case FMT_f20t:
+  case FMT_f20bc:
+  case FMT_f22x:
+  case FMT_f21t:
+  case FMT_f21s:
+  case FMT_f21h:
+  case FMT_f21c_d:
+  case FMT_f21c_s:
+  case FMT_f23x_d:
+  case FMT_f23x_s:
+  case FMT_f22b:
+  case FMT_f22t:
+  case FMT_f22s:
+  case FMT_f22c_d:
+  case FMT_f22c_s:
+  case FMT_f22cs:
+    return 2;
+  case FMT_f30t:
+  case FMT_f32x:
+  case FMT_f31i:
+  case FMT_f31t:
+  case FMT_f31c:
+  case FMT_f35c:
+  case FMT_f35ms:
+  case FMT_f35mi:
+  case FMT_f3rc:
+  case FMT_f3rms:
+  case FMT_f3rmi:
+    return 3;
+  case FMT_f41c_d:
+  case FMT_f41c_s:
+  case FMT_f45cc:
+  case FMT_f4rcc:
+    return 4;
+  case FMT_f51l:
+  case FMT_f52c_d:
+  case FMT_f52c_s:
+  case FMT_f5rc:
+  case FMT_f57c:
+    return 5;
+  default:
+    return 1;
+  }
+}
+
+// The number of code units of the instruction or payload at `insns`.
+uint32_t insn_units(const uint16_t* insns) {
+  switch (*insns) {
+  case FOPCODE_PACKED_SWITCH:
+    return insns[1] * 2 + 4;
+  case FOPCODE_SPARSE_SWITCH:
+    return insns[1] * 4 + 2;
+  case FOPCODE_FILLED_ARRAY: {
+    uint32_t size = insns[2] | (uint32_t(insns[3]) << 16);
+    return (insns[1] * size + 1) / 2 + 4;
+  }
+  default:
+    break;
+  }
+  switch (*insns & 0xff) {
+#define OP(op, code, fmt, ...) \
+  case code:                   \
+    return format_units(FMT_##fmt);
+    DOPS
+    QDOPS
+#undef OP
+  default:
+    return 1;
+  }
+}
+
+struct MethodInfo {
+  uint32_t class_def_idx;
+  uint32_t code_off;
+};
+
+struct Phase {
+  std::string name;
+  size_t methods{0};
+  size_t missing_methods{0};
+  size_t faults[NUM_SECTIONS]{};
+};
+
+class PageSimulator {
+ public:
+  explicit PageSimulator(ddump_data* rd) : m_rd(rd) {
+    for (uint32_t i = 0; i < rd->dexh->class_defs_size; ++i) {
+      const auto* cls_def = rd->dex_class_defs + i;
+      if (cls_def->class_data_offset == 0) {
+        continue;
+      }
+      auto* ptr = (const uint8_t*)(rd->dexmmap + cls_def->class_data_offset);
+      uint32_t sfields = read_uleb128(&ptr);
+      uint32_t ifields = read_uleb128(&ptr);
+      uint32_t dmethods = read_uleb128(&ptr);
+      uint32_t vmethods = read_uleb128(&ptr);
+      for (uint32_t j = 0; j < sfields + ifields; ++j) {
+        read_uleb128(&ptr);
+        read_uleb128(&ptr);
+      }
+      for (auto count : {dmethods, vmethods}) {
+        uint32_t method_idx = 0;
+        for (uint32_t j = 0; j < count; ++j) {
+          method_idx += read_uleb128(&ptr);
+          read_uleb128(&ptr);
+          uint32_t code_off = read_uleb128(&ptr);
+          if (code_off != 0) {
+            m_methods.emplace(method_name(method_idx), MethodInfo{i, code_off});
+          }
+        }
+      }
+      m_class_data_sizes.emplace(
+          i, ptr - (const uint8_t*)(rd->dexmmap + cls_def->class_data_offset));
+    }
+  }
+
+  void start_phase(const std::string& name) {
+    if (!m_phases.empty() && m_phases.back().methods == 0) {
+      m_phases.back().name = name;
+      return;
+    }
+    m_phases.push_back(Phase{name});
+  }
+
+  void execute(const std::string& method) {
+    if (m_phases.empty()) {
+      start_phase("startup");
+    }
+    auto& phase = m_phases.back();
+    phase.methods++;
+    auto it = m_methods.find(method);
+    if (it == m_methods.end()) {
+      phase.missing_methods++;
+      return;
+    }
+    const auto& info = it->second;
+    if (m_loaded_classes.insert(info.class_def_idx).second) {
+      const auto* cls_def = m_rd->dex_class_defs + info.class_def_idx;
+      touch(CLASSES, (const char*)cls_def - m_rd->dexmmap,
+            sizeof(dex_class_def));
+      if (cls_def->class_data_offset != 0) {
+        touch(CLASSES, cls_def->class_data_offset,
+              m_class_data_sizes.at(info.class_def_idx));
+      }
+    }
+    if (!m_executed_code.insert(info.code_off).second) {
+      return;
+    }
+    const auto* code_item =
+        (const dex_code_item*)(m_rd->dexmmap + info.code_off);
+    touch(CODE, info.code_off,
+          sizeof(dex_code_item) + code_item->insns_size * sizeof(uint16_t));
+    const auto* insns = (const uint16_t*)(code_item + 1);
+    const auto* end = insns + code_item->insns_size;
+    while (insns < end) {
+      switch (*insns & 0xff) {
+      case DOPCODE_CONST_STRING:
+        touch_string(insns[1]);
+        break;
+      case DOPCODE_CONST_STRING_JUMBO:
+        touch_string(insns[1] | (uint32_t(insns[2]) << 16));
+        break;
+      default:
+        break;
+      }
+      insns += insn_units(insns);
+    }
+  }
+
+  void print() const {
+    size_t total[NUM_SECTIONS]{};
+    for (const auto& phase : m_phases) {
+      print_phase(phase.name, phase.methods, phase.missing_methods,
+                  phase.faults);
+      for (size_t i = 0; i < NUM_SECTIONS; ++i) {
+        total[i] += phase.faults[i];
+      }
+    }
+    size_t methods = 0;
+    size_t missing_methods = 0;
+    for (const auto& phase : m_phases) {
+      methods += phase.methods;
+      missing_methods += phase.missing_methods;
+    }
+    print_phase("total", methods, missing_methods, total);
+  }
+
+ private:
+  std::string type_name(uint32_t type_idx) const {
+    return dex_string_by_type_idx(m_rd, type_idx);
+  }
+
+  std::string method_name(uint32_t method_idx) const {
+    const auto& method_id = m_rd->dex_method_ids[method_idx];
+    const auto& proto_id = m_rd->dex_proto_ids[method_id.protoidx];
+    std::string name = type_name(method_id.classidx) + "." +
+                       dex_string_by_idx(m_rd, method_id.nameidx) + ":(";
+    if (proto_id.param_off != 0) {
+      const auto* params =
+          (const uint32_t*)(m_rd->dexmmap + proto_id.param_off);
+      const auto* types = (const dex_type_item*)(params + 1);
+      for (uint32_t i = 0; i < *params; ++i) {
+        name += type_name(types[i].type_idx);
+      }
+    }
+    return name + ")" + type_name(proto_id.rtypeidx);
+  }
+
+  void touch_string(uint32_t string_idx) {
+    touch(STRINGS, (const char*)(m_rd->dex_string_ids + string_idx) -
+                       m_rd->dexmmap,
+          sizeof(dex_string_id));
+    uint32_t offset = m_rd->dex_string_ids[string_idx].offset;
+    const char* data = dex_string_by_idx(m_rd, string_idx);
+    uint32_t size = (data - (m_rd->dexmmap + offset)) + strlen(data) + 1;
+    touch(STRINGS, offset, size);
+  }
+
+  void touch(Section section, uint32_t offset, uint32_t size) {
+    if (size == 0) {
+      return;
+    }
+    for (uint32_t page = offset / kPageSize;
+         page <= (offset + size - 1) / kPageSize;
+         ++page) {
+      if (m_touched_pages.insert(page).second) {
+        m_phases.back().faults[section]++;
+      }
+    }
+  }
+
+  static void print_phase(const std::string& name,
+                          size_t methods,
+                          size_t missing_methods,
+                          const size_t* faults) {
+    size_t total = 0;
+    for (size_t i = 0; i < NUM_SECTIONS; ++i) {
+      total += faults[i];
+    }
+    printf("%s: %zu page faults (", name.c_str(), total);
+    for (size_t i = 0; i < NUM_SECTIONS; ++i) {
+      printf("%s%s: %zu", i == 0 ? "" : ", ", kSectionNames[i], faults[i]);
+    }
+    printf("), %zu methods, %zu not in the dex\n", methods, missing_methods);
+  }
+
+  ddump_data* m_rd;
+  std::unordered_map<std::string, MethodInfo> m_methods;
+  std::unordered_map<uint32_t, size_t> m_class_data_sizes;
+  std::unordered_set<uint32_t> m_loaded_classes;
+  std::unordered_set<uint32_t> m_executed_code;
+  std::unordered_set<uint32_t> m_touched_pages;
+  std::vector<Phase> m_phases;
+};
+
+std::vector<std::string> split_csv(const std::string& line) {
+  std::vector<std::string> cells;
+  std::stringstream ss(line);
+  std::string cell;
+  while (std::getline(ss, cell, ',')) {
+    cells.push_back(cell);
+  }
+  return cells;
+}
+
+// A phase and the methods executed in it, in order.
+using Trace = std::vector<std::pair<std::string, std::vector<std::string>>>;
+
+// Method profiles have an optional metadata section, followed by a header
+// that names the columns. Each interaction becomes a phase, with the methods
+// that appear in enough samples in the order of their first call.
+Trace read_method_profile(std::istream& in,
+                          const std::string& header,
+                          const std::string& default_phase,
+                          double min_appear) {
+  auto columns = split_csv(header);
+  auto column = [&](const std::string& name) -> int {
+    auto it = std::find(columns.begin(), columns.end(), name);
+    return it == columns.end() ? -1 : it - columns.begin();
+  };
+  int name_col = column("name");
+  int appear_col = column("appear100");
+  int rank_col = column("avg_rank100");
+  int interaction_col = column("interaction");
+  if (name_col < 0 || appear_col < 0 || rank_col < 0) {
+    fprintf(stderr, "Method profile lacks name, appear100 or avg_rank100\n");
+    exit(1);
+  }
+
+  std::vector<std::string> phase_names;
+  std::unordered_map<std::string, std::vector<std::pair<double, std::string>>>
+      phases;
+  std::string line;
+  while (std::getline(in, line)) {
+    auto cells = split_csv(line);
+    if ((int)cells.size() <= std::max({name_col, appear_col, rank_col})) {
+      continue;
+    }
+    if (atof(cells[appear_col].c_str()) < min_appear) {
+      continue;
+    }
+    std::string phase = interaction_col >= 0 &&
+                                (int)cells.size() > interaction_col &&
+                                !cells[interaction_col].empty()
+                            ? cells[interaction_col]
+                            : default_phase;
+    auto& methods = phases[phase];
+    if (methods.empty()) {
+      phase_names.push_back(phase);
+    }
+    methods.emplace_back(atof(cells[rank_col].c_str()), cells[name_col]);
+  }
+
+  Trace trace;
+  for (const auto& name : phase_names) {
+    auto& methods = phases.at(name);
+    std::stable_sort(methods.begin(), methods.end(),
+                     [](const auto& a, const auto& b) {
+                       return a.first < b.first;
+                     });
+    trace.emplace_back(name, std::vector<std::string>{});
+    for (auto& [rank, method] : methods) {
+      trace.back().second.push_back(std::move(method));
+    }
+  }
+  return trace;
+}
+
+// Trace lists name one method per line, in order of execution. Lines of the
+// form "@phase <name>" start a new phase; empty lines and lines starting with
+// '#' are ignored.
+Trace read_trace(const char* filename, double min_appear) {
+  std::ifstream in(filename);
+  if (!in) {
+    fprintf(stderr, "Cannot open trace %s, bailing\n", filename);
+    exit(1);
+  }
+  Trace trace;
+  std::string default_phase = "ColdStart";
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.rfind("interaction,", 0) == 0) {
+      // Method profile metadata, which names the interaction of the rows
+      // without an interaction column.
+      while (std::getline(in, line) && line.rfind("index,", 0) != 0) {
+        auto cells = split_csv(line);
+        if (!cells.empty() && !cells[0].empty()) {
+          default_phase = cells[0];
+        }
+      }
+    }
+    if (line.rfind("index,", 0) == 0) {
+      return read_method_profile(in, line, default_phase, min_appear);
+    }
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    if (line.rfind("@phase ", 0) == 0) {
+      trace.emplace_back(line.substr(strlen("@phase ")),
+                         std::vector<std::string>{});
+      continue;
+    }
+    if (trace.empty()) {
+      trace.emplace_back("startup", std::vector<std::string>{});
+    }
+    trace.back().second.push_back(line.substr(0, line.find_first_of(", \t")));
+  }
+  return trace;
+}
+
+void print_usage() {
+  fprintf(stderr,
+          "Usage: dexpagesim [--min-appear <percent>] <trace or method "
+          "profile> <dexfile 1> <dexfile 2> ...\n"
+          "\nEstimates the page faults that executing the traced methods "
+          "causes in each dex file.\n"
+          "\noptions:\n"
+          "--min-appear: methods of a method profile that appear in fewer "
+          "samples are ignored (default: 10)\n");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  double min_appear = 10.0;
+  char c;
+  static const struct option options[] = {
+      {"min-appear", required_argument, nullptr, 'm'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
+  };
+  while ((c = getopt_long(argc, argv, "m:h", &options[0], nullptr)) != -1) {
+    switch (c) {
+    case 'm':
+      min_appear = atof(optarg);
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    default:
+      print_usage();
+      return 1;
+    }
+  }
+
+  if (argc - optind < 2) {
+    fprintf(stderr, "%s: no trace or dex files given\n", argv[0]);
+    print_usage();
+    return 1;
+  }
+
+  auto trace = read_trace(argv[optind], min_appear);
+  for (int i = optind + 1; i < argc; ++i) {
+    const char* dexfile = argv[i];
+    ddump_data rd;
+    open_dex_file(dexfile, &rd);
+    PageSimulator simulator(&rd);
+    for (const auto& [phase, methods] : trace) {
+      simulator.start_phase(phase);
+      for (const auto& method : methods) {
+        simulator.execute(method);
+      }
+    }
+    printf("%s\n", dexfile);
+    simulator.print();
+  }
+  return 0;
+}
@@ -0,0 +1,539 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * dump-classes-from-hprof prints the classes of an Android heap dump in the
+ * order in which they were loaded, as `com/foo/Bar.class` lines that can serve
+ * as the coldstart class list of a Redex config. It prints the same list as
+ * dump_classes_from_hprof.py, but only looks at the records that it needs.
+ *
+ * The file is mapped into memory. The top-level records are scanned in one
+ * pass, and the heap dump segments, which make up almost all of a dump, are
+ * then walked in parallel. Optionally, the number of instances of each class
+ * is written to a second file.
+ */
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+void print_usage() {
+  fprintf(stderr,
+          "Usage: dump-classes-from-hprof [options] <hprof file>\n"
+          "Options:\n"
+          "  -c, --instance-counts <file>  write the number of instances of\n"
+          "                                each class to file\n"
+          "  -j, --jobs <n>                walk heap dump segments on n "
+          "threads\n"
+          "  -m, --allow-missing-ids       only warn about classes without a\n"
+          "                                load class record\n");
+}
+
+// Tags of top-level records.
+constexpr uint8_t TAG_STRING = 0x01;
+constexpr uint8_t TAG_LOAD_CLASS = 0x02;
+constexpr uint8_t TAG_HEAP_DUMP = 0x0C;
+constexpr uint8_t TAG_HEAP_DUMP_SEGMENT = 0x1C;
+constexpr uint8_t TAG_HEAP_DUMP_END = 0x2C;
+
+// Tags of the sub-records of heap dumps.
+constexpr uint8_t HEAP_ROOT_UNKNOWN = 0xFF;
+constexpr uint8_t HEAP_ROOT_JNI_GLOBAL = 0x01;
+constexpr uint8_t HEAP_ROOT_JNI_LOCAL = 0x02;
+constexpr uint8_t HEAP_ROOT_JAVA_FRAME = 0x03;
+constexpr uint8_t HEAP_ROOT_NATIVE_STACK = 0x04;
+constexpr uint8_t HEAP_ROOT_STICKY_CLASS = 0x05;
+constexpr uint8_t HEAP_ROOT_THREAD_BLOCK = 0x06;
+constexpr uint8_t HEAP_ROOT_MONITOR_USED = 0x07;
+constexpr uint8_t HEAP_ROOT_THREAD_OBJECT = 0x08;
+constexpr uint8_t HEAP_CLASS_DUMP = 0x20;
+constexpr uint8_t HEAP_INSTANCE_DUMP = 0x21;
+constexpr uint8_t HEAP_OBJECT_ARRAY_DUMP = 0x22;
+constexpr uint8_t HEAP_PRIMITIVE_ARRAY_DUMP = 0x23;
+constexpr uint8_t HEAP_DUMP_INFO = 0xFE;
+constexpr uint8_t HEAP_ROOT_INTERNED_STRING = 0x89;
+constexpr uint8_t HEAP_ROOT_FINALIZING = 0x8A;
+constexpr uint8_t HEAP_ROOT_DEBUGGER = 0x8B;
+constexpr uint8_t HEAP_ROOT_REFERENCE_CLEANUP = 0x8C;
+constexpr uint8_t HEAP_ROOT_VM_INTERNAL = 0x8D;
+constexpr uint8_t HEAP_ROOT_JNI_MONITOR = 0x8E;
+constexpr uint8_t HEAP_PRIMITIVE_ARRAY_NODATA_DUMP = 0xC3;
+
+// Reads big-endian values from a range of the dump. Reading past the end of
+// the range puts the reader into a failed state, in which it reads zeros.
+class Reader {
+ public:
+  Reader(const uint8_t* begin, const uint8_t* end, uint32_t id_size)
+      : m_cur(begin), m_end(end), m_id_size(id_size) {}
+
+  bool at_end() const { return m_cur == m_end; }
+  bool failed() const { return m_failed; }
+  const uint8_t* position() const { return m_cur; }
+  uint32_t id_size() const { return m_id_size; }
+
+  void fail() {
+    m_failed = true;
+    m_cur = m_end;
+  }
+
+  void skip(uint64_t n) {
+    if (static_cast<uint64_t>(m_end - m_cur) < n) {
+      fail();
+      return;
+    }
+    m_cur += n;
+  }
+
+  uint64_t read(size_t n) {
+    if (static_cast<size_t>(m_end - m_cur) < n) {
+      fail();
+      return 0;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < n; ++i) {
+      value = (value << 8) | m_cur[i];
+    }
+    m_cur += n;
+    return value;
+  }
+
+  uint8_t u1() { return static_cast<uint8_t>(read(1)); }
+  uint16_t u2() { return static_cast<uint16_t>(read(2)); }
+  uint32_t u4() { return static_cast<uint32_t>(read(4)); }
+  uint64_t id() { return read(m_id_size); }
+
+  // Skips a value of the given basic type.
+  void skip_value(uint8_t type) {
+    switch (type) {
+    case 2: // object
+      skip(m_id_size);
+      break;
+    case 4: // boolean
+    case 8: // byte
+      skip(1);
+      break;
+    case 5: // char
+    case 9: // short
+      skip(2);
+      break;
+    case 6: // float
+    case 10: // int
+      skip(4);
+      break;
+    case 7: // double
+    case 11: // long
+      skip(8);
+      break;
+    default:
+      fail();
+    }
+  }
+
+  // The size of a value of the given basic type, or 0 if the type is invalid.
+  size_t value_size(uint8_t type) const {
+    switch (type) {
+    case 2:
+      return m_id_size;
+    case 4:
+    case 8:
+      return 1;
+    case 5:
+    case 9:
+      return 2;
+    case 6:
+    case 10:
+      return 4;
+    case 7:
+    case 11:
+      return 8;
+    default:
+      return 0;
+    }
+  }
+
+ private:
+  const uint8_t* m_cur;
+  const uint8_t* m_end;
+  uint32_t m_id_size;
+  bool m_failed{false};
+};
+
+struct LoadClass {
+  uint32_t serial;
+  uint64_t name_id;
+};
+
+struct Segment {
+  const uint8_t* begin;
+  const uint8_t* end;
+};
+
+struct SegmentResult {
+  // Class objects in the order of their class dumps.
+  std::vector<uint64_t> classes;
+  // Number of instance dumps per class object.
+  std::unordered_map<uint64_t, uint64_t> instance_counts;
+  // Offset of the sub-record that could not be parsed, if any.
+  const uint8_t* error{nullptr};
+};
+
+void walk_segment(const Segment& segment,
+                  uint32_t id_size,
+                  SegmentResult* result) {
+  Reader r(segment.begin, segment.end, id_size);
+  while (!r.at_end()) {
+    const uint8_t* record = r.position();
+    switch (r.u1()) {
+    case HEAP_ROOT_UNKNOWN:
+    case HEAP_ROOT_STICKY_CLASS:
+    case HEAP_ROOT_MONITOR_USED:
+    case HEAP_ROOT_INTERNED_STRING:
+    case HEAP_ROOT_FINALIZING:
+    case HEAP_ROOT_DEBUGGER:
+    case HEAP_ROOT_REFERENCE_CLEANUP:
+    case HEAP_ROOT_VM_INTERNAL:
+      r.skip(id_size);
+      break;
+    case HEAP_ROOT_JNI_GLOBAL:
+      r.skip(2 * id_size);
+      break;
+    case HEAP_ROOT_JNI_LOCAL:
+    case HEAP_ROOT_JAVA_FRAME:
+    case HEAP_ROOT_JNI_MONITOR:
+    case HEAP_ROOT_THREAD_OBJECT:
+      // Object, thread serial and stack trace serial or frame number.
+      r.skip(id_size + 8);
+      break;
+    case HEAP_ROOT_NATIVE_STACK:
+    case HEAP_ROOT_THREAD_BLOCK:
+      r.skip(id_size + 4);
+      break;
+    case HEAP_DUMP_INFO:
+      // Heap type and name.
+      r.skip(4 + id_size);
+      break;
+    case HEAP_CLASS_DUMP: {
+      result->classes.push_back(r.id());
+      // Stack trace serial, super class, class loader, signers, protection
+      // domain, two reserved ids and instance size.
+      r.skip(4 + 6 * id_size + 4);
+      uint16_t num_constants = r.u2();
+      for (uint16_t i = 0; i < num_constants && !r.failed(); ++i) {
+        r.skip(2);
+        r.skip_value(r.u1());
+      }
+      uint16_t num_static_fields = r.u2();
+      for (uint16_t i = 0; i < num_static_fields && !r.failed(); ++i) {
+        r.skip(id_size);
+        r.skip_value(r.u1());
+      }
+      uint16_t num_instance_fields = r.u2();
+      r.skip(static_cast<uint64_t>(num_instance_fields) * (id_size + 1));
+      break;
+    }
+    case HEAP_INSTANCE_DUMP: {
+      r.skip(id_size + 4);
+      uint64_t cls = r.id();
+      r.skip(r.u4());
+      ++result->instance_counts[cls];
+      break;
+    }
+    case HEAP_OBJECT_ARRAY_DUMP: {
+      r.skip(id_size + 4);
+      uint32_t length = r.u4();
+      r.skip(id_size);
+      r.skip(static_cast<uint64_t>(length) * id_size);
+      break;
+    }
+    case HEAP_PRIMITIVE_ARRAY_DUMP:
+    case HEAP_PRIMITIVE_ARRAY_NODATA_DUMP: {
+      bool has_data = *record == HEAP_PRIMITIVE_ARRAY_DUMP;
+      r.skip(id_size + 4);
+      uint32_t length = r.u4();
+      size_t size = r.value_size(r.u1());
+      if (size == 0) {
+        r.fail();
+      } else if (has_data) {
+        r.skip(static_cast<uint64_t>(length) * size);
+      }
+      break;
+    }
+    default:
+      r.fail();
+    }
+    if (r.failed()) {
+      result->error = record;
+      return;
+    }
+  }
+}
+
+class MappedFile {
+ public:
+  explicit MappedFile(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+      void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED) {
+        m_data = static_cast<const uint8_t*>(data);
+        m_size = st.st_size;
+      }
+    }
+    close(fd);
+  }
+
+  ~MappedFile() {
+    if (m_data != nullptr) {
+      munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t* data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+ private:
+  const uint8_t* m_data{nullptr};
+  size_t m_size{0};
+};
+
+std::string to_class_file_name(std::string_view name) {
+  std::string result(name);
+  std::replace(result.begin(), result.end(), '.', '/');
+  result += ".class";
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  const char* instance_counts_path = nullptr;
+  size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+  bool allow_missing_ids = false;
+  static const struct option options[] = {
+      {"instance-counts", required_argument, nullptr, 'c'},
+      {"jobs", required_argument, nullptr, 'j'},
+      {"allow-missing-ids", no_argument, nullptr, 'm'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "c:j:mh", &options[0], nullptr)) !=
+         -1) {
+    switch (c) {
+    case 'c':
+      instance_counts_path = optarg;
+      break;
+    case 'j':
+      num_threads = std::max(1l, strtol(optarg, nullptr, 10));
+      break;
+    case 'm':
+      allow_missing_ids = true;
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    default:
+      print_usage();
+      return 1;
+    }
+  }
+  if (argc - optind != 1) {
+    print_usage();
+    return 1;
+  }
+
+  const char* path = argv[optind];
+  MappedFile file(path);
+  if (file.data() == nullptr) {
+    fprintf(stderr, "Cannot map %s\n", path);
+    return 1;
+  }
+  const uint8_t* begin = file.data();
+  const uint8_t* end = begin + file.size();
+
+  // The header is a NUL-terminated format name, the size of ids and a
+  // timestamp.
+  const uint8_t* format_end =
+      static_cast<const uint8_t*>(memchr(begin, 0, file.size()));
+  if (format_end == nullptr) {
+    fprintf(stderr, "%s is not an hprof file\n", path);
+    return 1;
+  }
+  Reader header(format_end + 1, end, 0);
+  uint32_t id_size = header.u4();
+  header.skip(8);
+  if (header.failed() || id_size == 0 || id_size > 8) {
+    fprintf(stderr, "%s is not an hprof file\n", path);
+    return 1;
+  }
+
+  // Top-level records: strings and load class records are needed to name the
+  // classes, heap dumps are walked later.
+  std::unordered_map<uint64_t, std::string_view> strings;
+  std::unordered_map<uint64_t, LoadClass> load_classes;
+  std::vector<Segment> segments;
+  Reader r(header.position(), end, id_size);
+  while (!r.at_end()) {
+    uint8_t tag = r.u1();
+    r.skip(4); // Time offset.
+    uint32_t length = r.u4();
+    const uint8_t* body = r.position();
+    r.skip(length);
+    if (r.failed()) {
+      fprintf(stderr, "Truncated record at offset %zu\n",
+              static_cast<size_t>(body - begin));
+      return 1;
+    }
+    Reader body_reader(body, body + length, id_size);
+    if (tag == TAG_STRING) {
+      uint64_t string_id = body_reader.id();
+      if (!body_reader.failed()) {
+        strings.emplace(string_id,
+                        std::string_view(reinterpret_cast<const char*>(
+                                             body_reader.position()),
+                                         length - id_size));
+      }
+    } else if (tag == TAG_LOAD_CLASS) {
+      LoadClass load_class;
+      load_class.serial = body_reader.u4();
+      uint64_t cls = body_reader.id();
+      body_reader.skip(4); // Stack trace serial.
+      load_class.name_id = body_reader.id();
+      if (!body_reader.failed()) {
+        load_classes.emplace(cls, load_class);
+      }
+    } else if (tag == TAG_HEAP_DUMP || tag == TAG_HEAP_DUMP_SEGMENT) {
+      segments.push_back(Segment{body, body + length});
+    } else if (tag == TAG_HEAP_DUMP_END) {
+      break;
+    }
+  }
+
+  std::vector<SegmentResult> results(segments.size());
+  {
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+      for (size_t i = next++; i < segments.size(); i = next++) {
+        walk_segment(segments[i], id_size, &results[i]);
+      }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(num_threads, segments.size()); ++i) {
+      threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  // Like dump_classes_from_hprof.py: the first class of each name, without
+  // array classes, in the order of their serial numbers, which on Dalvik
+  // correspond to the order in which classes were loaded.
+  std::vector<std::pair<uint32_t, std::string_view>> classes;
+  std::unordered_set<std::string_view> seen;
+  std::unordered_map<std::string_view, uint64_t> instance_counts;
+  auto class_name = [&](uint64_t cls, std::string_view* name,
+                        uint32_t* serial) {
+    auto load_class = load_classes.find(cls);
+    if (load_class == load_classes.end()) {
+      return false;
+    }
+    auto string = strings.find(load_class->second.name_id);
+    if (string == strings.end()) {
+      return false;
+    }
+    *name = string->second;
+    *serial = load_class->second.serial;
+    return true;
+  };
+  for (const auto& result : results) {
+    if (result.error != nullptr) {
+      fprintf(stderr, "Cannot parse heap dump record at offset %zu\n",
+              static_cast<size_t>(result.error - begin));
+      return 1;
+    }
+    for (uint64_t cls : result.classes) {
+      std::string_view name;
+      uint32_t serial;
+      if (!class_name(cls, &name, &serial)) {
+        fprintf(stderr, "%s: class object 0x%llx has no name\n",
+                allow_missing_ids ? "Warning" : "Error",
+                static_cast<unsigned long long>(cls));
+        if (!allow_missing_ids) {
+          return 1;
+        }
+        continue;
+      }
+      if (name.size() >= 2 && name.substr(name.size() - 2) == "[]") {
+        continue;
+      }
+      if (seen.insert(name).second) {
+        classes.emplace_back(serial, name);
+      }
+    }
+    if (instance_counts_path != nullptr) {
+      for (const auto& [cls, count] : result.instance_counts) {
+        std::string_view name;
+        uint32_t serial;
+        if (class_name(cls, &name, &serial)) {
+          instance_counts[name] += count;
+        }
+      }
+    }
+  }
+
+  std::stable_sort(
+      classes.begin(), classes.end(),
+      [](const auto& a, const auto& b) { return a.first < b.first; });
+  for (const auto& [serial, name] : classes) {
+    printf("%s\n", to_class_file_name(name).c_str());
+  }
+
+  if (instance_counts_path != nullptr) {
+    FILE* out = fopen(instance_counts_path, "w");
+    if (out == nullptr) {
+      fprintf(stderr, "Cannot write %s\n", instance_counts_path);
+      return 1;
+    }
+    std::vector<std::pair<std::string_view, uint64_t>> counts(
+        instance_counts.begin(), instance_counts.end());
+    std::sort(counts.begin(), counts.end(), [](const auto& a, const auto& b) {
+      return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    for (const auto& [name, count] : counts) {
+      fprintf(out, "%s %llu\n", to_class_file_name(name).c_str(),
+              static_cast<unsigned long long>(count));
+    }
+    fclose(out);
+  }
+  return 0;
+}
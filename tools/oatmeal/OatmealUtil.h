@@ -11,9 +11,12 @@
 #include "DexOpcodeDefs.h"
 #include "file-utils.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -54,6 +57,28 @@ static void foreach_pair(const T1& t1, const T2& t2, const L& fn) {
   }
 }
 
+// Calls fn(i) for every i in [0, n), spread over the available cores. fn must
+// only write state that belongs to its own index.
+template <typename L>
+void parallel_for(size_t n, const L& fn) {
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    for (size_t i = next++; i < n; i = next++) {
+      fn(i);
+    }
+  };
+  size_t num_threads =
+      std::min<size_t>(n, std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < num_threads; t++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
 template <uint32_t Width>
 uint32_t align(uint32_t in) {
   return (in + (Width - 1)) & -Width;
@@ -32,6 +32,7 @@
 #include "vdex.h"
 
 #include <algorithm>
+#include <cinttypes>
 #include <cerrno>
 #include <cstdint>
 #include <cstdio>
@@ -983,6 +984,11 @@ class DexFileListing_064 : public DexFileListing {
 
   using ClassInfo = OatClasses::ClassInfo;
 
+  struct ClassCodeSize {
+    uint32_t num_methods = 0;
+    uint32_t code_size = 0;
+  };
+
   struct DexFile_064 : public DexFile {
     DexFile_064() = default;
     DexFile_064(const std::string& location_,
@@ -999,6 +1005,7 @@ class DexFileListing_064 : public DexFileListing {
     uint32_t lookup_table_offset;
     std::vector<uint32_t> class_offsets;
     std::vector<ClassInfo> class_info;
+    std::vector<ClassCodeSize> class_code_sizes;
     std::vector<std::string> class_names;
   };
 
@@ -1019,6 +1026,8 @@ class DexFileListing_064 : public DexFileListing {
       CHECK(false, "Invalid oat version for DexFileListing_064");
     }
 
+    std::vector<DexFileHeader> dex_headers;
+    std::vector<const char*> class_offsets;
     auto ptr = buf.ptr;
     while (numDexFiles > 0) {
       numDexFiles--;
@@ -1048,67 +1057,117 @@ class DexFileListing_064 : public DexFileListing {
       }
 
       auto dex_header = DexFileHeader::parse(oat_buf.slice(file.file_offset));
-      const auto num_classes = dex_header.class_defs_size;
-      if (!dex_files_only) {
-        file.class_info.reserve(num_classes);
-
-        DexIdBufs id_bufs(oat_buf, file.file_offset, dex_header);
-
-        for (unsigned int i = 0; i < num_classes; i++) {
-          uint32_t class_info_offset;
-          READ_WORD(&class_info_offset, ptr);
-
-          ClassInfo class_info;
-          cur_ma()->memcpyAndMark(
-              &class_info, oat_buf.ptr + class_info_offset, sizeof(ClassInfo));
-
-          // Note: So far I haven't found this pattern in version 064, so I'm
-          // not 100% sure this will work for 064. It definitely works for 045,
-          // where this pattern appears to occur more frequently.
-          if (class_info.type ==
-              static_cast<uint16_t>(OatClasses::Type::kOatClassSomeCompiled)) {
-            auto bitmap_size_ptr =
-                oat_buf.ptr + class_info_offset + sizeof(ClassInfo);
-            uint32_t bitmap_size = 0;
-            cur_ma()->memcpyAndMark(
-                &bitmap_size, bitmap_size_ptr, sizeof(uint32_t));
-            auto bitmap_ptr = bitmap_size_ptr + sizeof(uint32_t);
-            cur_ma()->markRangeConsumed(bitmap_ptr, bitmap_size);
-
-            int method_count = 0;
-            for (unsigned int j = 0; j < (bitmap_size / 4); j++) {
-              uint32_t bitmap_element = 0;
-              READ_WORD(&bitmap_element, bitmap_ptr);
-              method_count += countSetBits(bitmap_element);
-            }
+      // The offsets to the class info of the dex file, which are read below.
+      cur_ma()->markRangeConsumed(
+          ptr, dex_header.class_defs_size * sizeof(uint32_t));
+      class_offsets.push_back(ptr);
+      ptr += dex_header.class_defs_size * sizeof(uint32_t);
 
-            auto methods_ptr = bitmap_ptr;
-            cur_ma()->markRangeConsumed(methods_ptr,
-                                        method_count * oat_method_offset_size);
-
-          } else if (class_info.type ==
-                     static_cast<uint16_t>(
-                         OatClasses::Type::kOatClassAllCompiled)) {
-            auto method_count = id_bufs.get_num_methods(i);
-            auto methods_ptr =
-                oat_buf.ptr + class_info_offset + sizeof(ClassInfo);
-            cur_ma()->markRangeConsumed(methods_ptr,
-                                        method_count * oat_method_offset_size);
-          }
-
-          file.class_info.push_back(class_info);
-          file.class_names.push_back(id_bufs.get_class_name(i));
-        }
-      } else {
-        // must consume the class info.
-        for (unsigned int i = 0; i < num_classes; i++) {
-          uint32_t class_info_offset;
-          READ_WORD(&class_info_offset, ptr);
+      dex_files_.push_back(file);
+      dex_headers.push_back(dex_header);
+    }
+
+    if (!dex_files_only) {
+      // Oat files can embed hundreds of dex files; their classes are parsed
+      // in parallel.
+      parallel_for(dex_files_.size(), [&](size_t i) {
+        parse_classes(&dex_files_[i],
+                      dex_headers[i],
+                      class_offsets[i],
+                      oat_buf,
+                      oat_method_offset_size);
+      });
+    }
+  }
+
+  // Reads the class info of all classes of a dex file, and sums up the size of
+  // their compiled code.
+  static void parse_classes(DexFile_064* file,
+                            const DexFileHeader& dex_header,
+                            const char* class_offsets,
+                            ConstBuffer oat_buf,
+                            size_t oat_method_offset_size) {
+    const auto num_classes = dex_header.class_defs_size;
+    file->class_info.reserve(num_classes);
+    file->class_code_sizes.reserve(num_classes);
+
+    DexIdBufs id_bufs(oat_buf, file->file_offset, dex_header);
+
+    for (unsigned int i = 0; i < num_classes; i++) {
+      uint32_t class_info_offset;
+      memcpy(&class_info_offset, class_offsets + i * sizeof(uint32_t), 4);
+
+      ClassInfo class_info;
+      cur_ma()->memcpyAndMark(
+          &class_info, oat_buf.ptr + class_info_offset, sizeof(ClassInfo));
+
+      ClassCodeSize code_size;
+      // Note: So far I haven't found this pattern in version 064, so I'm
+      // not 100% sure this will work for 064. It definitely works for 045,
+      // where this pattern appears to occur more frequently.
+      if (class_info.type ==
+          static_cast<uint16_t>(OatClasses::Type::kOatClassSomeCompiled)) {
+        auto bitmap_size_ptr =
+            oat_buf.ptr + class_info_offset + sizeof(ClassInfo);
+        uint32_t bitmap_size = 0;
+        cur_ma()->memcpyAndMark(
+            &bitmap_size, bitmap_size_ptr, sizeof(uint32_t));
+        auto bitmap_ptr = bitmap_size_ptr + sizeof(uint32_t);
+        cur_ma()->markRangeConsumed(bitmap_ptr, bitmap_size);
+
+        int method_count = 0;
+        for (unsigned int j = 0; j < (bitmap_size / 4); j++) {
+          uint32_t bitmap_element = 0;
+          READ_WORD(&bitmap_element, bitmap_ptr);
+          method_count += countSetBits(bitmap_element);
         }
+
+        auto methods_ptr = bitmap_ptr;
+        cur_ma()->markRangeConsumed(methods_ptr,
+                                    method_count * oat_method_offset_size);
+        code_size = compiled_code_size(
+            oat_buf, methods_ptr, method_count, oat_method_offset_size);
+
+      } else if (class_info.type ==
+                 static_cast<uint16_t>(
+                     OatClasses::Type::kOatClassAllCompiled)) {
+        auto method_count = id_bufs.get_num_methods(i);
+        auto methods_ptr = oat_buf.ptr + class_info_offset + sizeof(ClassInfo);
+        cur_ma()->markRangeConsumed(methods_ptr,
+                                    method_count * oat_method_offset_size);
+        code_size = compiled_code_size(
+            oat_buf, methods_ptr, method_count, oat_method_offset_size);
       }
 
-      dex_files_.push_back(file);
+      file->class_info.push_back(class_info);
+      file->class_code_sizes.push_back(code_size);
+      file->class_names.push_back(id_bufs.get_class_name(i));
+    }
+  }
+
+  // Sums up the code sizes of the compiled methods in an OatMethodOffsets
+  // table. The code size is the last field of the OatQuickMethodHeader that
+  // precedes the code. Code that is shared by several methods is counted for
+  // each of them.
+  static ClassCodeSize compiled_code_size(ConstBuffer oat_buf,
+                                          const char* methods_ptr,
+                                          uint32_t method_count,
+                                          size_t oat_method_offset_size) {
+    ClassCodeSize ret;
+    for (uint32_t i = 0; i < method_count; i++) {
+      uint32_t code_offset;
+      memcpy(&code_offset, methods_ptr + i * oat_method_offset_size, 4);
+      // The low bit is set for thumb2 code.
+      code_offset &= ~1u;
+      if (code_offset < sizeof(uint32_t) || code_offset > oat_buf.len) {
+        continue;
+      }
+      uint32_t code_size;
+      memcpy(&code_size, oat_buf.ptr + code_offset - sizeof(uint32_t), 4);
+      ret.num_methods++;
+      ret.code_size += code_size;
     }
+    return ret;
   }
 
   void print() {
@@ -1121,6 +1180,37 @@ class DexFileListing_064 : public DexFileListing {
     }
   }
 
+  // Prints the classes that have compiled code, the biggest first.
+  void print_class_code_sizes() {
+    std::vector<std::pair<ClassCodeSize, const std::string*>> sizes;
+    uint64_t total_methods = 0;
+    uint64_t total_code_size = 0;
+    for (const auto& e : dex_files_) {
+      foreach_pair(e.class_code_sizes,
+                   e.class_names,
+                   [&](const ClassCodeSize& size, const std::string& name) {
+                     if (size.num_methods > 0) {
+                       sizes.emplace_back(size, &name);
+                       total_methods += size.num_methods;
+                       total_code_size += size.code_size;
+                     }
+                   });
+    }
+    std::stable_sort(sizes.begin(), sizes.end(), [](const auto& a, auto& b) {
+      return a.first.code_size > b.first.code_size;
+    });
+    printf("  %10s %8s class\n", "code_size", "methods");
+    for (const auto& e : sizes) {
+      printf("  %10u %8u %s\n",
+             e.first.code_size,
+             e.first.num_methods,
+             e.second->c_str());
+    }
+    printf("  %10" PRIu64 " %8" PRIu64 " total\n",
+           total_code_size,
+           total_methods);
+  }
+
   void print_classes() {
     for (const auto& e : dex_files_) {
       printf("  { Classes for dex %s\n", e.location.c_str());
@@ -1321,38 +1411,39 @@ OatClasses_124::OatClasses_124(const DexFileListing_079& dex_file_listing,
                                const DexFiles& dex_files,
                                ConstBuffer oat_buf,
                                ConstBuffer dex_buf) {
-  foreach_pair(dex_file_listing.dex_files(),
-               dex_files.headers(),
-               [&](const DexFileListing_079::DexFile_079& listing,
-                   const DexFileHeader& header) {
-                 auto classes_offset = listing.classes_offset;
-
-                 DexClasses dex_classes;
-                 dex_classes.dex_file = listing.location;
-
-                 DexIdBufs id_bufs(dex_buf, listing.file_offset, header);
-
-                 // classes_offset points to an array of pointers (offsets) to
-                 // ClassInfo
-                 for (unsigned int i = 0; i < header.class_defs_size; i++) {
-
-                   ClassInfo info;
-                   uint32_t info_offset;
-                   cur_ma()->memcpyAndMark(
-                       &info_offset,
-                       oat_buf.slice(classes_offset + i * sizeof(uint32_t)).ptr,
-                       sizeof(uint32_t));
-                   cur_ma()->memcpyAndMark(&info,
-                                           oat_buf.slice(info_offset).ptr,
-                                           sizeof(ClassInfo));
-
-                   // TODO: Handle compiled classes. Need to read method bitmap
-                   // size, and method bitmap.
-                   dex_classes.class_info.push_back(info);
-                   dex_classes.class_names.push_back(id_bufs.get_class_name(i));
-                 }
-                 classes_.push_back(dex_classes);
-               });
+  const auto& listings = dex_file_listing.dex_files();
+  const auto& headers = dex_files.headers();
+  CHECK(listings.size() == headers.size());
+  classes_.resize(listings.size());
+  parallel_for(listings.size(), [&](size_t dex) {
+    const auto& listing = listings[dex];
+    const auto& header = headers[dex];
+    auto classes_offset = listing.classes_offset;
+
+    DexClasses& dex_classes = classes_[dex];
+    dex_classes.dex_file = listing.location;
+
+    DexIdBufs id_bufs(dex_buf, listing.file_offset, header);
+
+    // classes_offset points to an array of pointers (offsets) to
+    // ClassInfo
+    for (unsigned int i = 0; i < header.class_defs_size; i++) {
+
+      ClassInfo info;
+      uint32_t info_offset;
+      cur_ma()->memcpyAndMark(
+          &info_offset,
+          oat_buf.slice(classes_offset + i * sizeof(uint32_t)).ptr,
+          sizeof(uint32_t));
+      cur_ma()->memcpyAndMark(
+          &info, oat_buf.slice(info_offset).ptr, sizeof(ClassInfo));
+
+      // TODO: Handle compiled classes. Need to read method bitmap
+      // size, and method bitmap.
+      dex_classes.class_info.push_back(info);
+      dex_classes.class_names.push_back(id_bufs.get_class_name(i));
+    }
+  });
 }
 
 class OatClasses_064 : public OatClasses {
@@ -1376,41 +1467,42 @@ class OatClasses_064 : public OatClasses {
 OatClasses_079::OatClasses_079(const DexFileListing_079& dex_file_listing,
                                const DexFiles& dex_files,
                                ConstBuffer oat_buf) {
-  foreach_pair(
-      dex_file_listing.dex_files(),
-      dex_files.headers(),
-      [&](const DexFileListing_079::DexFile_079& listing,
-          const DexFileHeader& header) {
-        auto classes_offset = listing.classes_offset;
-
-        DexClasses dex_classes;
-        dex_classes.dex_file = listing.location;
-
-        DexIdBufs id_bufs(oat_buf, listing.file_offset, header);
-
-        // classes_offset points to an array of pointers (offsets) to
-        // ClassInfo
-        for (unsigned int i = 0; i < header.class_defs_size; i++) {
-
-          ClassInfo info;
-          uint32_t info_offset;
-          cur_ma()->memcpyAndMark(
-              &info_offset,
-              oat_buf.slice(classes_offset + i * sizeof(uint32_t)).ptr,
-              sizeof(uint32_t));
-          cur_ma()->memcpyAndMark(
-              &info, oat_buf.slice(info_offset).ptr, sizeof(ClassInfo));
-
-          // TODO: Handle compiled classes. Need to read method bitmap size,
-          // and method bitmap.
-          CHECK(info.type == static_cast<uint16_t>(Type::kOatClassNoneCompiled),
-                "Parsing for compiled classes not implemented");
-
-          dex_classes.class_info.push_back(info);
-          dex_classes.class_names.push_back(id_bufs.get_class_name(i));
-        }
-        classes_.push_back(dex_classes);
-      });
+  const auto& listings = dex_file_listing.dex_files();
+  const auto& headers = dex_files.headers();
+  CHECK(listings.size() == headers.size());
+  classes_.resize(listings.size());
+  parallel_for(listings.size(), [&](size_t dex) {
+    const auto& listing = listings[dex];
+    const auto& header = headers[dex];
+    auto classes_offset = listing.classes_offset;
+
+    DexClasses& dex_classes = classes_[dex];
+    dex_classes.dex_file = listing.location;
+
+    DexIdBufs id_bufs(oat_buf, listing.file_offset, header);
+
+    // classes_offset points to an array of pointers (offsets) to
+    // ClassInfo
+    for (unsigned int i = 0; i < header.class_defs_size; i++) {
+
+      ClassInfo info;
+      uint32_t info_offset;
+      cur_ma()->memcpyAndMark(
+          &info_offset,
+          oat_buf.slice(classes_offset + i * sizeof(uint32_t)).ptr,
+          sizeof(uint32_t));
+      cur_ma()->memcpyAndMark(
+          &info, oat_buf.slice(info_offset).ptr, sizeof(ClassInfo));
+
+      // TODO: Handle compiled classes. Need to read method bitmap size,
+      // and method bitmap.
+      CHECK(info.type == static_cast<uint16_t>(Type::kOatClassNoneCompiled),
+            "Parsing for compiled classes not implemented");
+
+      dex_classes.class_info.push_back(info);
+      dex_classes.class_names.push_back(id_bufs.get_class_name(i));
+    }
+  });
 }
 
 void OatClasses_079::print() {
@@ -2020,6 +2112,10 @@ class OatFile_064 : public OatFile {
     }
   }
 
+  void print_class_code_sizes() override {
+    dex_file_listing_.print_class_code_sizes();
+  }
+
   Status status() override { return Status::PARSE_SUCCESS; }
 
   std::vector<OatDexFile> get_oat_dexfiles() override {
@@ -2628,6 +2724,11 @@ class OatFile_Bad : public OatFile {
 
 OatFile::~OatFile() = default;
 
+void OatFile::print_class_code_sizes() {
+  printf("  compiled code is not parsed for oat version %s\n",
+         version_string().c_str());
+}
+
 static std::unique_ptr<OatFile> parse_oatfile_impl(
     bool dex_files_only,
     ConstBuffer oatfile_buffer,
@@ -87,6 +87,10 @@ class OatFile {
                      bool dump_tables,
                      bool print_unverified_classes) = 0;
 
+  // Prints the size of the compiled code of every class that has any, as
+  // found through the method offsets of the oat classes.
+  virtual void print_class_code_sizes();
+
   virtual Status status() = 0;
 
   // Return the version number as a string, e.g. "039", "079", etc.
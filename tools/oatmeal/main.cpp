@@ -8,9 +8,11 @@
 #include "OatmealUtil.h"
 #include "dump-oat.h"
 #include "memory-accounter.h"
+#include "mmap.h"
 #include "vdex.h"
 
 #include <getopt.h>
+#include <sys/mman.h>
 
 #ifndef ANDROID
 #include <wordexp.h>
@@ -48,6 +50,7 @@ struct Arguments {
   bool dump_code = false;
   bool dump_tables = false;
   bool dump_memory_usage = false;
+  bool dump_code_sizes = false;
 
   bool print_unverified_classes = false;
 
@@ -94,6 +97,7 @@ Arguments parse_args(int argc, char* argv[]) {
       {"dump-code", no_argument, nullptr, 'w'},
       {"dump-tables", no_argument, nullptr, 't'},
       {"dump-memory-usage", no_argument, nullptr, 'm'},
+      {"dump-code-sizes", no_argument, nullptr, 's'},
       {"print-unverified-classes", no_argument, nullptr, 'p'},
       {"arch", required_argument, nullptr, 'a'},
       {"art-image-location", required_argument, nullptr, 0},
@@ -109,7 +113,7 @@ Arguments parse_args(int argc, char* argv[]) {
 
   int c;
   while ((c = getopt_long(
-              argc, argv, "cetmpdbx:l:o:v:a:", &options[0], nullptr)) != -1) {
+              argc, argv, "cetmspdbx:l:o:v:a:", &options[0], nullptr)) != -1) {
     switch (c) {
     case 'd':
       if (ret.action != Action::DUMP && ret.action != Action::NONE) {
@@ -167,6 +171,10 @@ Arguments parse_args(int argc, char* argv[]) {
       ret.dump_memory_usage = true;
       break;
 
+    case 's':
+      ret.dump_code_sizes = true;
+      break;
+
     case 'v':
       ret.oat_version = optarg;
       break;
@@ -249,20 +257,24 @@ int dump(const Arguments& args) {
 
   auto oat_file_size = get_filesize(oat_file);
 
-  // We don't run dumping during install on device, so it is allowed to consume
-  // lots of memory.
-  auto oat_file_contents = std::make_unique<char[]>(oat_file_size);
-  auto oatFileBytesRead =
-      fread(oat_file_contents.get(), 1, oat_file_size, oat_file.get());
-  if (oatFileBytesRead != oat_file_size) {
-    fprintf(stderr,
-            "Failed to read file %s (%zd)\n",
-            std::strerror(errno),
-            oatFileBytesRead);
+  // The file is mapped rather than read, so that only the parts that are
+  // parsed are paged in.
+  std::string error_msg;
+  std::unique_ptr<MappedFile> oat_file_contents(
+      MappedFile::mmap_file(oat_file_size,
+                            PROT_READ,
+                            MAP_PRIVATE,
+                            fileno(oat_file.get()),
+                            oat_file_name.c_str(),
+                            &error_msg));
+  if (oat_file_contents == nullptr) {
+    fprintf(stderr, "%s\n", error_msg.c_str());
     return 1;
   }
 
-  ConstBuffer oatfile_buffer{oat_file_contents.get(), oat_file_size};
+  ConstBuffer oatfile_buffer{
+      reinterpret_cast<const char*>(oat_file_contents->begin()),
+      oat_file_size};
   auto ma_scope = MemoryAccounter::NewScope(oatfile_buffer);
 
   CHECK(oatfile_buffer.len > 4);
@@ -287,6 +299,11 @@ int dump(const Arguments& args) {
   oatfile->print(
       args.dump_classes, args.dump_tables, args.print_unverified_classes);
 
+  if (args.dump_code_sizes) {
+    printf("Compiled code sizes:\n");
+    oatfile->print_class_code_sizes();
+  }
+
   if (args.dump_memory_usage) {
     cur_ma()->print();
   }
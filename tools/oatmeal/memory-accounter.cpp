@@ -10,6 +10,7 @@
 
 #include <algorithm>
 #include <cstring>
+#include <mutex>
 #include <vector>
 
 namespace {
@@ -154,12 +155,15 @@ class MultiBufferMemoryAccounter : public MemoryAccounter {
   ~MultiBufferMemoryAccounter() override = default;
 
  private:
+  // Dex files may be parsed on several threads at once.
+  std::mutex lock_;
   std::vector<MemoryAccounterImpl> accounters_;
 };
 
 void MultiBufferMemoryAccounter::memcpyAndMark(void* dest,
                                                const char* src,
                                                size_t count) {
+  std::lock_guard<std::mutex> guard(lock_);
   for (auto& a : accounters_) {
     auto ptr = a.buf_.ptr;
     char* dst_ptr = reinterpret_cast<char*>(dest);
@@ -173,6 +177,7 @@ void MultiBufferMemoryAccounter::memcpyAndMark(void* dest,
 
 void MultiBufferMemoryAccounter::markRangeConsumed(const char* ptr,
                                                    uint32_t count) {
+  std::lock_guard<std::mutex> guard(lock_);
   for (auto& a : accounters_) {
     auto base_ptr = a.buf_.ptr;
     if (base_ptr <= ptr && ptr + count <= base_ptr + a.buf_.len) {
@@ -184,6 +189,7 @@ void MultiBufferMemoryAccounter::markRangeConsumed(const char* ptr,
 }
 
 void MultiBufferMemoryAccounter::markBufferConsumed(ConstBuffer subBuffer) {
+  std::lock_guard<std::mutex> guard(lock_);
   for (auto& a : accounters_) {
     auto base_ptr = a.buf_.ptr;
     auto base_len = a.buf_.len;
@@ -201,12 +207,14 @@ void MultiBufferMemoryAccounter::markBufferConsumed(ConstBuffer subBuffer) {
 }
 
 void MultiBufferMemoryAccounter::print() {
+  std::lock_guard<std::mutex> guard(lock_);
   for (auto& a : accounters_) {
     a.print();
   }
 }
 
 void MultiBufferMemoryAccounter::addBuffer(ConstBuffer buf) {
+  std::lock_guard<std::mutex> guard(lock_);
   // Make sure this is no-ones sub-buffer in the currently accounted set.
   for (const auto& a : accounters_) {
     auto a_end = a.buf_.ptr + a.buf_.len;
@@ -0,0 +1,244 @@
+#!/usr/bin/env python3
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+# Diffs two jemalloc heap profiles by allocation site, e.g. the ones that
+# Redex dumps before and after each pass when run with
+# `MALLOC_PROFILE_DUMP_DIR=<dir> MALLOC_CONF=prof:true,prof_active:false`:
+#
+#   heap_profile_diff.py <dir>/004.SomePass.heap <dir>/005.OtherPass.heap
+#
+# prints the sites whose live bytes grew the most during OtherPass, i.e. what
+# the pass retained after it finished. Frames are symbolized with addr2line,
+# using the mappings recorded in the profiles.
+
+import argparse
+import bisect
+import collections
+import math
+import re
+import subprocess
+import sys
+
+
+# The frames of allocator internals, which are skipped to find the site.
+DEFAULT_SKIP = (
+    r"^(je_|_{0,2}malloc|calloc|realloc|free|posix_memalign|aligned_alloc|"
+    r"imalloc|prof_|operator new|std::allocator|__gnu_cxx::new_allocator|"
+    r"std::__new_allocator)"
+)
+
+Mapping = collections.namedtuple("Mapping", ["start", "end", "offset", "path"])
+
+
+class Profile:
+    def __init__(self):
+        # Stack (tuple of addresses) -> [objects, bytes], unsampled.
+        self.stacks = collections.defaultdict(lambda: [0.0, 0.0])
+        self.mappings = []
+
+
+def _unsample(objs, size, sample_period):
+    # The probability that an allocation of the average size is sampled, see
+    # jeprof.
+    if objs == 0 or sample_period <= 1:
+        return objs, size
+    ratio = (size / objs) / sample_period
+    scale = 1.0 / (1.0 - math.exp(-ratio))
+    return objs * scale, size * scale
+
+
+def parse_profile(filename):
+    profile = Profile()
+    header = re.compile(r"^heap_v2/(\d+)")
+    counts = re.compile(r"^\s*t\*:\s*(\d+):\s*(\d+)")
+    mapping = re.compile(
+        r"^([0-9a-f]+)-([0-9a-f]+)\s+\S*x\S*\s+([0-9a-f]+)\s+\S+\s+\d+\s+(/.+)$"
+    )
+    sample_period = 1
+    stack = None
+    in_mappings = False
+    with open(filename) as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if in_mappings:
+                m = mapping.match(line)
+                if m:
+                    profile.mappings.append(
+                        Mapping(
+                            int(m.group(1), 16),
+                            int(m.group(2), 16),
+                            int(m.group(3), 16),
+                            m.group(4),
+                        )
+                    )
+                continue
+            if line.startswith("MAPPED_LIBRARIES:"):
+                in_mappings = True
+                continue
+            m = header.match(line)
+            if m:
+                sample_period = int(m.group(1))
+                continue
+            if line.startswith("@"):
+                stack = tuple(int(a, 16) for a in line[1:].split())
+                continue
+            m = counts.match(line)
+            if m and stack is not None:
+                objs, size = _unsample(
+                    int(m.group(1)), int(m.group(2)), sample_period
+                )
+                entry = profile.stacks[stack]
+                entry[0] += objs
+                entry[1] += size
+                stack = None
+    profile.mappings.sort()
+    return profile
+
+
+class Symbolizer:
+    def __init__(self, mappings, enabled):
+        self.mappings = mappings
+        self.starts = [m.start for m in mappings]
+        self.enabled = enabled
+        self.cache = {}
+
+    def _find_mapping(self, addr):
+        i = bisect.bisect_right(self.starts, addr) - 1
+        if i >= 0 and addr < self.mappings[i].end:
+            return self.mappings[i]
+        return None
+
+    def prefetch(self, addrs):
+        if not self.enabled:
+            return
+        by_path = collections.defaultdict(set)
+        for addr in addrs:
+            if addr in self.cache:
+                continue
+            mapping = self._find_mapping(addr)
+            if mapping is None:
+                continue
+            by_path[mapping.path].add(addr)
+        for path, path_addrs in by_path.items():
+            path_addrs = sorted(path_addrs)
+            mapping_of = {a: self._find_mapping(a) for a in path_addrs}
+            offsets = [
+                "0x%x" % (a - mapping_of[a].start + mapping_of[a].offset)
+                for a in path_addrs
+            ]
+            try:
+                output = subprocess.run(
+                    ["addr2line", "-f", "-C", "-e", path] + offsets,
+                    stdout=subprocess.PIPE,
+                    stderr=subprocess.DEVNULL,
+                    universal_newlines=True,
+                    check=False,
+                ).stdout.splitlines()
+            except OSError:
+                return
+            for i, addr in enumerate(path_addrs):
+                if 2 * i < len(output) and output[2 * i] != "??":
+                    self.cache[addr] = output[2 * i]
+
+    def symbolize(self, addr):
+        return self.cache.get(addr, "0x%x" % addr)
+
+
+def site_of(stack, symbolizer, skip, depth):
+    frames = []
+    for i, addr in enumerate(stack):
+        # Return addresses point after the call.
+        name = symbolizer.symbolize(addr if i == 0 else addr - 1)
+        if not frames and skip.match(name):
+            continue
+        frames.append(name)
+        if len(frames) == depth:
+            break
+    return " <- ".join(frames) if frames else "<unknown>"
+
+
+def group_by_site(profile, symbolizer, skip, depth):
+    sites = collections.defaultdict(lambda: [0.0, 0.0])
+    for stack, (objs, size) in profile.stacks.items():
+        site = sites[site_of(stack, symbolizer, skip, depth)]
+        site[0] += objs
+        site[1] += size
+    return sites
+
+
+def pretty_bytes(size):
+    for unit in ["B", "KB", "MB"]:
+        if abs(size) < 1024:
+            return "%.1f%s" % (size, unit)
+        size /= 1024.0
+    return "%.1fGB" % size
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Diff two jemalloc heap profiles by allocation site."
+    )
+    parser.add_argument("before", help="the earlier profile")
+    parser.add_argument("after", help="the later profile")
+    parser.add_argument(
+        "--depth",
+        type=int,
+        default=3,
+        help="number of frames, from the allocation, that make up a site",
+    )
+    parser.add_argument(
+        "--top", type=int, default=30, help="number of sites to print"
+    )
+    parser.add_argument(
+        "--skip",
+        default=DEFAULT_SKIP,
+        help="regex of the innermost frames to skip, e.g. allocator internals",
+    )
+    parser.add_argument(
+        "--no-symbolize", action="store_true", help="print raw addresses"
+    )
+    args = parser.parse_args()
+
+    before = parse_profile(args.before)
+    after = parse_profile(args.after)
+    # The dumps of one run share the mappings.
+    symbolizer = Symbolizer(after.mappings or before.mappings, not args.no_symbolize)
+    addrs = set()
+    for stack in list(before.stacks) + list(after.stacks):
+        addrs.update(a if i == 0 else a - 1 for i, a in enumerate(stack))
+    symbolizer.prefetch(addrs)
+
+    skip = re.compile(args.skip)
+    before_sites = group_by_site(before, symbolizer, skip, args.depth)
+    after_sites = group_by_site(after, symbolizer, skip, args.depth)
+
+    rows = []
+    for site in set(before_sites) | set(after_sites):
+        b = before_sites.get(site, [0.0, 0.0])
+        a = after_sites.get(site, [0.0, 0.0])
+        rows.append((a[1] - b[1], a[0] - b[0], b[1], a[1], site))
+    rows.sort(key=lambda row: -abs(row[0]))
+
+    total_before = sum(size for _, size in before.stacks.values())
+    total_after = sum(size for _, size in after.stacks.values())
+    print(
+        "Live: %s -> %s (%s)"
+        % (
+            pretty_bytes(total_before),
+            pretty_bytes(total_after),
+            pretty_bytes(total_after - total_before),
+        )
+    )
+    print("%12s %12s %12s %12s  %s" % ("delta", "objects", "before", "after", "site"))
+    for delta, objs, b, a, site in rows[: args.top]:
+        print(
+            "%12s %+12d %12s %12s  %s"
+            % (pretty_bytes(delta), objs, pretty_bytes(b), pretty_bytes(a), site)
+        )
+
+
+if __name__ == "__main__":
+    sys.exit(main())
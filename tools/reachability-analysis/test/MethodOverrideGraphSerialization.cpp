@@ -28,11 +28,8 @@ std::unique_ptr<mog::Graph> generate_graph() {
   auto m4 = DexMethod::make_method("LQux;.bar:()V")
                 ->make_concrete(ACC_PUBLIC, /* is_virtual */ true);
 
-  auto graph = std::make_unique<mog::Graph>();
-  graph->add_edge(m1, m2);
-  graph->add_edge(m1, m3);
-  graph->add_edge(m2, m4);
-  graph->add_edge(m3, m4);
+  auto graph = std::make_unique<mog::Graph>(
+      mog::Graph::Edges{{m1, m2}, {m1, m3}, {m2, m4}, {m3, m4}});
 
   return graph;
 }
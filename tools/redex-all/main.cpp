@@ -5,12 +5,14 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <atomic>
 #include <boost/format.hpp>
 #include <boost/thread/thread.hpp>
 #include <cinttypes>
 #include <cstring>
 #include <ctime>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <regex>
@@ -28,6 +30,7 @@
 #ifdef _MSC_VER
 #include <io.h>
 #else
+#include <sys/wait.h>
 #include <unistd.h>
 #endif
 
@@ -45,19 +48,24 @@
 #include "DexHasher.h"
 #include "DexLoader.h"
 #include "DexOutput.h"
+#include "DexOutputCache.h"
 #include "DexPosition.h"
 #include "DuplicateClasses.h"
 #include "GlobalConfig.h"
 #include "IODIMetadata.h"
 #include "IOUtil.h"
+#include "IRArena.h"
+#include "IRCodeEviction.h"
 #include "InstructionLowering.h"
 #include "JarLoader.h"
 #include "JemallocUtil.h"
 #include "KeepReason.h"
 #include "Macros.h"
+#include "MemberMemoryStats.h"
 #include "MonitorCount.h"
 #include "NoOptimizationsMatcher.h"
 #include "OptData.h"
+#include "PassPerfRecord.h"
 #include "PassRegistry.h"
 #include "PostLowering.h"
 #include "ProguardConfiguration.h" // New ProGuard configuration
@@ -70,6 +78,7 @@
 #include "RedexResources.h"
 #include "SanitizersConfig.h"
 #include "Show.h"
+#include "Timeline.h"
 #include "Timer.h"
 #include "ToolsCommon.h"
 #include "Walkers.h"
@@ -103,6 +112,11 @@ struct Arguments {
   // command line arguments. For development usage
   Json::Value entry_data;
   boost::optional<int> stop_pass_idx;
+  // A checkpoint written with --stop-pass to resume from, if any.
+  std::string input_ir_dir;
+  // Output directories and complete configs of the variants that are forked
+  // off after the frontend, see --variant.
+  std::vector<std::pair<std::string, Json::Value>> variants;
   RedexOptions redex_options;
 };
 
@@ -174,6 +188,25 @@ bool add_value_to_config(Json::Value& config,
   return true;
 }
 
+void make_meta_dir(const std::string& out_dir) {
+  std::string metafiles = out_dir + "/meta/";
+  int status = [&metafiles]() -> int {
+#if !IS_WINDOWS
+    return mkdir(metafiles.c_str(), 0755);
+#else
+    return mkdir(metafiles.c_str());
+#endif
+  }();
+  if (status != 0 && errno != EEXIST) {
+    // Attention: errno may get changed by syscalls or lib functions.
+    // Saving before printing is a conventional way of using errno.
+    int errsv = errno;
+    std::cerr << "error: cannot mkdir meta in outdir. errno = " << errsv
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
 Json::Value default_config() {
   const auto passes = {
       "ReBindRefsPass",        "BridgePass",
@@ -330,7 +363,8 @@ Arguments parse_args(int argc, char* argv[]) {
       "be quoted.");
   od.add_options()("show-passes", "show registered passes");
   od.add_options()("dex-files", po::value<std::vector<std::string>>(),
-                   "dex files");
+                   "dex files, dex store metadata files or APKs, whose root "
+                   "store dexes are read without extracting them");
 
   // Development usage only, and Python script will generate the following
   // arguments.
@@ -338,9 +372,22 @@ Arguments parse_args(int argc, char* argv[]) {
                    "Stop before pass n and output IR to file");
   od.add_options()("output-ir", po::value<std::string>(),
                    "IR output directory, used with --stop-pass");
+  od.add_options()("input-ir", po::value<std::string>(),
+                   "Resume from the IR written with --stop-pass and "
+                   "--output-ir with the same passes list, skipping the "
+                   "passes that already ran");
   od.add_options()("jni-summary",
                    po::value<std::string>(),
                    "Path to JNI summary directory of json files.");
+  od.add_options()(
+      "variant",
+      po::value<std::vector<std::string>>(), // Accumulation
+      "--variant outdir=config\n"
+      "  \tAfter loading the input, fork a worker that runs the passes and "
+      "writes its output to outdir, with the settings of the JSON file config "
+      "merged over the main config. Workers share the loaded input with the "
+      "main run. Settings read while loading the input, e.g. keep rules, "
+      "always come from the main config.");
   po::positional_options_description pod;
   pod.add("dex-files", -1);
   po::variables_map vm;
@@ -391,7 +438,7 @@ Arguments parse_args(int argc, char* argv[]) {
 
   if (vm.count("dex-files")) {
     args.dex_files = vm["dex-files"].as<std::vector<std::string>>();
-  } else {
+  } else if (!vm.count("input-ir")) {
     std::cerr << "error: no input dex files" << std::endl << std::endl;
     print_usage();
     exit(EXIT_SUCCESS);
@@ -505,15 +552,74 @@ Arguments parse_args(int argc, char* argv[]) {
     args.redex_options.jni_summary_path = vm["jni-summary"].as<std::string>();
   }
 
+  // The passes before the stop pass of the checkpoint already ran, so drop
+  // them. Pass indices given with --stop-pass still refer to the full list.
+  int skipped_passes = 0;
+  Json::Value skipped_passes_list = Json::arrayValue;
+  if (vm.count("input-ir")) {
+    args.input_ir_dir = vm["input-ir"].as<std::string>();
+    if (!boost::filesystem::is_directory(args.input_ir_dir)) {
+      std::cerr << "error: input-ir is not a directory: " << args.input_ir_dir
+                << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    Json::Value checkpoint;
+    redex::load_entry_file(args.input_ir_dir, &checkpoint);
+    if (!checkpoint.isMember("stop_pass_idx") ||
+        !checkpoint.isMember("passes_before") ||
+        !checkpoint.isMember("passes_after")) {
+      std::cerr << "error: input-ir was not written with --stop-pass"
+                << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    if (checkpoint["config"] != args.entry_data["config"]) {
+      std::cerr << "warning: input-ir was written with config "
+                << checkpoint["config"].asString() << std::endl;
+    }
+    skipped_passes = checkpoint["stop_pass_idx"].asInt();
+    auto& passes_list = args.config["redex"]["passes"];
+    if ((size_t)skipped_passes > passes_list.size()) {
+      std::cerr << "error: input-ir stopped after the end of the passes list"
+                << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    Json::Value remaining_passes = Json::arrayValue;
+    for (Json::ArrayIndex i = 0; i < passes_list.size(); ++i) {
+      (i < (Json::ArrayIndex)skipped_passes ? skipped_passes_list
+                                            : remaining_passes)
+          .append(passes_list[i]);
+    }
+    // The checkpoint already ran MakePublicPass and RegAllocPass, which the
+    // remaining passes would not see in a full run. Only resume the pipeline
+    // that the checkpoint was written for, so that this does not go unnoticed.
+    if (skipped_passes_list != checkpoint["passes_before"] ||
+        remaining_passes != checkpoint["passes_after"]) {
+      std::cerr << "error: input-ir was written with another passes list"
+                << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    passes_list = std::move(remaining_passes);
+  }
+
   if (args.stop_pass_idx != boost::none) {
     // Resize the passes list and append an additional RegAllocPass if its final
     // pass is not RegAllocPass.
     auto& passes_list = args.config["redex"]["passes"];
-    int idx = *args.stop_pass_idx;
+    int idx = *args.stop_pass_idx - skipped_passes;
     if (idx < 0 || (size_t)idx > passes_list.size()) {
       std::cerr << "Invalid stop_pass value\n";
       exit(EXIT_FAILURE);
     }
+    // Recorded so that --input-ir can resume from here, with the same passes
+    // list.
+    args.entry_data["stop_pass_idx"] = *args.stop_pass_idx;
+    Json::Value passes_after = Json::arrayValue;
+    for (Json::ArrayIndex i = 0; i < passes_list.size(); ++i) {
+      (i < (Json::ArrayIndex)idx ? skipped_passes_list : passes_after)
+          .append(passes_list[i]);
+    }
+    args.entry_data["passes_before"] = skipped_passes_list;
+    args.entry_data["passes_after"] = passes_after;
     if (passes_list.size() > (size_t)idx) {
       passes_list.resize(idx);
     }
@@ -526,21 +632,38 @@ Arguments parse_args(int argc, char* argv[]) {
     }
   }
 
-  std::string metafiles = args.out_dir + "/meta/";
-  int status = [&metafiles]() -> int {
-#if !IS_WINDOWS
-    return mkdir(metafiles.c_str(), 0755);
-#else
-    return mkdir(metafiles.c_str());
-#endif
-  }();
-  if (status != 0 && errno != EEXIST) {
-    // Attention: errno may get changed by syscalls or lib functions.
-    // Saving before printing is a conventional way of using errno.
-    int errsv = errno;
-    std::cerr << "error: cannot mkdir meta in outdir. errno = " << errsv
-              << std::endl;
+  make_meta_dir(args.out_dir);
+
+  if (vm.count("variant")) {
+#if IS_WINDOWS
+    std::cerr << "error: --variant is not supported on Windows" << std::endl;
     exit(EXIT_FAILURE);
+#endif
+    if (args.stop_pass_idx || !args.input_ir_dir.empty()) {
+      std::cerr << "error: --variant cannot be combined with --stop-pass or "
+                   "--input-ir"
+                << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    for (auto& dir_config : vm["variant"].as<std::vector<std::string>>()) {
+      const size_t equals_idx = dir_config.find('=');
+      if (equals_idx == std::string::npos) {
+        std::cerr << "error: cannot parse --variant " << dir_config
+                  << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      std::string out_dir = dir_config.substr(0, equals_idx);
+      if (!redex::dir_is_writable(out_dir)) {
+        std::cerr << "error: variant outdir is not a writable directory: "
+                  << out_dir << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      make_meta_dir(out_dir);
+      Json::Value config = args.config;
+      redex::merge_variant_config(
+          redex::parse_config(dir_config.substr(equals_idx + 1)), config);
+      args.variants.emplace_back(std::move(out_dir), std::move(config));
+    }
   }
 
   TRACE(MAIN, 2, "Verify-none mode: %s",
@@ -585,6 +708,8 @@ Json::Value get_stats(const dex_stats_t& stats) {
   val["dbg_total_size"] = stats.dbg_total_size;
 
   val["instruction_bytes"] = stats.instruction_bytes;
+  val["num_startup_code_items"] = stats.num_startup_code_items;
+  val["startup_code_pages"] = stats.startup_code_pages;
 
   val["header_item_count"] = stats.header_item_count;
   val["header_item_bytes"] = stats.header_item_bytes;
@@ -728,6 +853,7 @@ Json::Value get_output_stats(
   d["dexes_stats"] = get_detailed_stats(dexes_stats);
   d["pass_stats"] = get_pass_stats(mgr);
   d["pass_hashes"] = get_pass_hashes(mgr);
+  d["pass_perf"] = pass_perf::to_json(mgr.get_pass_info());
   d["lowering_stats"] = get_lowering_stats(instruction_lowering_stats);
   d["position_stats"] = get_position_stats(pos_mapper);
   return d;
@@ -817,6 +943,10 @@ void write_debug_line_mapping(
 
 std::string get_dex_magic(std::vector<std::string>& dex_files) {
   always_assert_log(!dex_files.empty(), "APK contains no dex file\n");
+  if (redex::is_apk(dex_files[0])) {
+    // Set once the dexes of the APK are inflated.
+    return "";
+  }
   // Get dex magic from the first dex file since all dex magic
   // should be consistent within one APK.
   return load_dex_magic_from_dex(dex_files[0].c_str());
@@ -887,10 +1017,34 @@ void redex_frontend(ConfigFiles& conf, /* input */
 
   g_redex->load_pointers_cache();
 
-  for (const auto& pg_config_path : args.proguard_config_paths) {
-    Timer time_pg_parsing("Parsed ProGuard config file");
-    keep_rules::proguard_parser::parse_file(pg_config_path, &pg_config);
-  }
+  // The ProGuard config files don't depend on the dexes, so they are parsed
+  // in the background while the dexes are loaded. The library jars named in
+  // them are only loaded after the dexes.
+  auto pg_parsing = std::async(std::launch::async, [&]() {
+    Timer time_pg_parsing("Parsed ProGuard config files");
+    keep_rules::proguard_parser::parse_files(args.proguard_config_paths,
+                                             &pg_config);
+  });
+
+  DexStore root_store("classes");
+  // Only set dex magic to root DexStore since all dex magic
+  // should be consistent within one APK.
+  root_store.set_dex_magic(get_dex_magic(args.dex_files));
+  stores.emplace_back(std::move(root_store));
+
+  const JsonWrapper& json_config = conf.get_json_config();
+  dup_classes::read_dup_class_allowlist(json_config);
+
+  run_rethrow_first_aggregate([&]() {
+    Timer t("Load classes from dexes");
+    dex_stats_t input_totals;
+    std::vector<dex_stats_t> input_dexes_stats;
+    redex::load_classes_from_dexes_and_metadata(
+        args.dex_files, stores, input_totals, input_dexes_stats);
+    stats["input_stats"] = get_input_stats(input_totals, input_dexes_stats);
+  });
+
+  pg_parsing.get();
   keep_rules::proguard_parser::remove_blocklisted_rules(&pg_config);
 
   const auto& pg_libs = pg_config.libraryjars;
@@ -915,24 +1069,6 @@ void redex_frontend(ConfigFiles& conf, /* input */
     }
   }
 
-  DexStore root_store("classes");
-  // Only set dex magic to root DexStore since all dex magic
-  // should be consistent within one APK.
-  root_store.set_dex_magic(get_dex_magic(args.dex_files));
-  stores.emplace_back(std::move(root_store));
-
-  const JsonWrapper& json_config = conf.get_json_config();
-  dup_classes::read_dup_class_allowlist(json_config);
-
-  run_rethrow_first_aggregate([&]() {
-    Timer t("Load classes from dexes");
-    dex_stats_t input_totals;
-    std::vector<dex_stats_t> input_dexes_stats;
-    redex::load_classes_from_dexes_and_metadata(
-        args.dex_files, stores, input_totals, input_dexes_stats);
-    stats["input_stats"] = get_input_stats(input_totals, input_dexes_stats);
-  });
-
   Scope external_classes;
   args.entry_data["jars"] = Json::arrayValue;
   if (!library_jars.empty()) {
@@ -1015,6 +1151,38 @@ void redex_frontend(ConfigFiles& conf, /* input */
   }
 }
 
+/**
+ * Pre processing steps when resuming from a checkpoint: the keep rules were
+ * already applied, and their effect on the rstate is restored with the IR meta.
+ */
+void redex_frontend_from_ir(ConfigFiles& conf, /* input */
+                            Arguments& args, /* inout */
+                            keep_rules::ProguardConfiguration& pg_config,
+                            DexStoresVector& stores) {
+  Timer redex_frontend_timer("Redex_frontend_from_ir");
+
+  g_redex->load_pointers_cache();
+
+  // Passes look at the configuration, e.g. to know if there are keep rules.
+  {
+    Timer time_pg_parsing("Parsed ProGuard config files");
+    keep_rules::proguard_parser::parse_files(args.proguard_config_paths,
+                                             &pg_config);
+  }
+  keep_rules::proguard_parser::remove_blocklisted_rules(&pg_config);
+
+  dup_classes::read_dup_class_allowlist(conf.get_json_config());
+
+  Json::Value checkpoint;
+  redex::load_all_intermediate(args.input_ir_dir, stores, &checkpoint);
+  if (!stores.empty()) {
+    auto first_dex_path = boost::filesystem::path(args.input_ir_dir) /
+                          checkpoint["dex_list"][0]["list"][0].asString();
+    stores[0].set_dex_magic(load_dex_magic_from_dex(first_dex_path.c_str()));
+  }
+  args.entry_data["jars"] = checkpoint["jars"];
+}
+
 void write_out_resid_to_name(ConfigFiles& conf) {
   std::string apk_dir;
   conf.get_json_config().get("apk_dir", "", apk_dir);
@@ -1064,17 +1232,77 @@ void redex_backend(ConfigFiles& conf,
   write_out_resid_to_name(conf);
   finalize_resource_table(conf);
 
+  const JsonWrapper& json_config = conf.get_json_config();
+  auto dex_output_cache = DexOutputCache::create(
+      conf, redex_options, stores[0].get_dex_magic(),
+      json_config.get("emit_locator_strings", false), redex_options.redacted);
+  // The keys hash IR code, so they are computed before lowering.
+  std::vector<std::vector<std::string>> dex_output_cache_keys(stores.size());
+  if (dex_output_cache) {
+    Timer t("Computing dex output cache keys");
+    std::vector<std::pair<size_t, size_t>> dexes;
+    for (size_t store_number = 0; store_number < stores.size();
+         ++store_number) {
+      auto num_dexes = stores[store_number].get_dexen().size();
+      dex_output_cache_keys[store_number].resize(num_dexes);
+      for (size_t i = 0; i < num_dexes; ++i) {
+        dexes.emplace_back(store_number, i);
+      }
+    }
+    workqueue_run<std::pair<size_t, size_t>>(
+        [&](const std::pair<size_t, size_t>& dex) {
+          auto [store_number, i] = dex;
+          dex_output_cache_keys[store_number][i] = dex_output_cache->key(
+              stores[store_number].get_dexen()[i]);
+        },
+        dexes);
+  }
+
+  // With "evict_store_code", the code of the non-root stores is moved to spill
+  // files until their turn to be lowered and written comes, so that only the
+  // IR of one store is resident at a time. The steps that need the lowered
+  // code of all stores before writing any are not supported with it.
+  auto dik = redex_options.debug_info_kind;
+  bool evict_store_code = json_config.get("evict_store_code", false);
+  if (evict_store_code && (redex_options.redacted ||
+                           json_config.get("emit_locator_strings", false) ||
+                           is_iodi(dik))) {
+    fprintf(stderr,
+            "WARNING: evict_store_code is not supported with redaction, "
+            "locator strings or IODI, and is ignored\n");
+    evict_store_code = false;
+  }
+  std::vector<std::unique_ptr<ir_eviction::EvictedCode>> evicted_code(
+      stores.size());
+  size_t num_evicted_methods = 0;
+  uint64_t num_evicted_bytes = 0;
+  if (evict_store_code) {
+    Timer t("Evicting store code");
+    for (size_t store_number = 1; store_number < stores.size();
+         ++store_number) {
+      auto& store = stores[store_number];
+      evicted_code[store_number] = std::make_unique<ir_eviction::EvictedCode>(
+          build_class_scope(store.get_dexen()),
+          conf.metafile("evicted_code_" + store.get_name() + ".bin"));
+      num_evicted_methods += evicted_code[store_number]->num_methods();
+      num_evicted_bytes += evicted_code[store_number]->num_bytes();
+    }
+  }
+
   instruction_lowering::Stats instruction_lowering_stats;
+  bool lower_with_cfg = true;
+  conf.get_json_config().get("lower_with_cfg", true, lower_with_cfg);
   {
-    bool lower_with_cfg = true;
-    conf.get_json_config().get("lower_with_cfg", true, lower_with_cfg);
     Timer t("Instruction lowering");
+    // The other stores are lowered as they are reloaded.
     instruction_lowering_stats =
-        instruction_lowering::run(stores, lower_with_cfg);
+        evict_store_code
+            ? instruction_lowering::run(
+                  build_class_scope(stores[0].get_dexen()), lower_with_cfg)
+            : instruction_lowering::run(stores, lower_with_cfg);
   }
 
   TRACE(MAIN, 1, "Writing out new DexClasses...");
-  const JsonWrapper& json_config = conf.get_json_config();
 
   LocatorIndex* locator_index = nullptr;
   if (json_config.get("emit_locator_strings", false)) {
@@ -1093,7 +1321,6 @@ void redex_backend(ConfigFiles& conf,
   const std::string& debug_line_map_filename = conf.metafile(DEBUG_LINE_MAP);
   const std::string& iodi_metadata_filename = conf.metafile(IODI_METADATA);
 
-  auto dik = redex_options.debug_info_kind;
   bool needs_addresses = dik == DebugInfoKind::NoPositions || is_iodi(dik);
 
   std::unique_ptr<PositionMapper> pos_mapper(PositionMapper::make(
@@ -1125,22 +1352,41 @@ void redex_backend(ConfigFiles& conf,
     Timer t("Compute initial IODI metadata");
     iodi_metadata.mark_methods(stores);
   }
+  // The post-lowering hooks are not known to be thread-safe.
+  bool parallel_dex_output =
+      json_config.get("parallel_dex_output", false) && !post_lowering;
+  if (parallel_dex_output) {
+    // Loaded lazily; make sure this doesn't happen concurrently.
+    conf.get_method_profiles();
+  }
   for (size_t store_number = 0; store_number < stores.size(); ++store_number) {
     auto& store = stores[store_number];
+    if (evicted_code[store_number]) {
+      Timer t("Reloading and lowering store code");
+      evicted_code[store_number]->reload();
+      evicted_code[store_number].reset();
+      instruction_lowering_stats += instruction_lowering::run(
+          build_class_scope(store.get_dexen()), lower_with_cfg);
+    }
     Timer t("Writing optimized dexes");
-    for (size_t i = 0; i < store.get_dexen().size(); i++) {
-      auto gtypes = std::make_shared<GatheredTypes>(&store.get_dexen()[i]);
+    auto& dexen = store.get_dexen();
+    std::vector<dex_stats_t> store_dexes_stats(dexen.size());
+    DexOutputSequencer sequencer;
+    auto write_dex = [&](size_t i) {
+      DexOutputSequencer::Guard sequencer_guard(
+          parallel_dex_output ? &sequencer : nullptr, i);
+      auto gtypes = std::make_shared<GatheredTypes>(&dexen[i]);
 
       if (post_lowering) {
         post_lowering->load_dex_indexes(
-            conf, manager.get_redex_options().min_sdk, &store.get_dexen()[i],
-            *gtypes, store.get_name(), i);
+            conf, manager.get_redex_options().min_sdk, &dexen[i], *gtypes,
+            store.get_name(), i);
       }
 
-      auto this_dex_stats = write_classes_to_dex(
+      store_dexes_stats[i] = write_classes_to_dex(
           redex_options,
           redex::get_dex_output_name(output_dir, store, i),
-          &store.get_dexen()[i],
+          &dexen[i],
           gtypes,
           locator_index,
           store_number,
@@ -1153,11 +1399,40 @@ void redex_backend(ConfigFiles& conf,
           stores[0].get_dex_magic(),
           symbolicate_detached_methods ? post_lowering.get() : nullptr,
           manager.get_redex_options().min_sdk,
-          disable_method_similarity_order);
+          disable_method_similarity_order,
+          parallel_dex_output ? &sequencer : nullptr,
+          dex_output_cache.get(),
+          dex_output_cache ? dex_output_cache_keys[store_number][i] : "");
+    };
+
+    if (parallel_dex_output) {
+      // Each worker claims the next dex in order, so the dex that a waiting
+      // step depends on has always been started by some worker.
+      std::atomic<size_t> next_dex{0};
+      auto num_threads =
+          std::min<size_t>(redex_parallel::default_num_threads(), dexen.size());
+      auto wq = workqueue_foreach<size_t>(
+          [&](size_t) {
+            for (size_t i; (i = next_dex.fetch_add(1)) < dexen.size();) {
+              write_dex(i);
+            }
+          },
+          num_threads);
+      for (size_t i = 0; i < num_threads; ++i) {
+        wq.add_item(i);
+      }
+      wq.run_all();
+    } else {
+      for (size_t i = 0; i < dexen.size(); i++) {
+        write_dex(i);
+      }
+    }
 
+    for (const auto& this_dex_stats : store_dexes_stats) {
       output_totals += this_dex_stats;
       output_dexes_stats.push_back(this_dex_stats);
-      signatures.insert(*reinterpret_cast<uint32_t*>(this_dex_stats.signature));
+      signatures.insert(
+          *reinterpret_cast<const uint32_t*>(this_dex_stats.signature));
     }
   }
 
@@ -1206,6 +1481,21 @@ void redex_backend(ConfigFiles& conf,
     stats["output_stats"] =
         get_output_stats(output_totals, output_dexes_stats, manager,
                          instruction_lowering_stats, pos_mapper.get());
+    if (dex_output_cache) {
+      auto& cache_stats = stats["output_stats"]["dex_output_cache"];
+      cache_stats["hits"] = (Json::UInt64)dex_output_cache->hits();
+      cache_stats["misses"] = (Json::UInt64)dex_output_cache->misses();
+    }
+    if (evict_store_code) {
+      auto& evicted_stats = stats["output_stats"]["evicted_code"];
+      evicted_stats["methods"] = (Json::UInt64)num_evicted_methods;
+      evicted_stats["bytes"] = (Json::UInt64)num_evicted_bytes;
+    }
+    // The peak resident memory of the whole run, which output usually tops.
+    stats["output_stats"]["vm_hwm"] = (Json::UInt64)get_mem_stats().vm_hwm;
+    stats["output_stats"]["member_memory"] =
+        member_memory::to_json(
+            member_memory::compute(build_class_scope(stores)));
     print_warning_summary();
   }
 }
@@ -1281,6 +1571,101 @@ void maybe_dump_jemalloc_profile(const char* env_name) {
   }
 }
 
+// Runs the passes and the backend on the loaded input.
+void run_optimizations(
+    ConfigFiles& conf,
+    Arguments& args,
+    std::unique_ptr<keep_rules::ProguardConfiguration> pg_config,
+    DexStoresVector& stores,
+    Json::Value& stats) {
+  // Initialize purity defaults, if set.
+  purity::CacheConfig::parse_default(conf);
+
+  auto const& passes = PassRegistry::get().get_passes();
+  PassManager manager(passes, std::move(pg_config), args.config,
+                      args.redex_options);
+
+  ab_test::ABExperimentContext::parse_experiments_states(
+      conf, !manager.get_redex_options().redacted);
+
+  {
+    Timer t("Running optimization passes");
+    manager.run_passes(stores, conf);
+    maybe_dump_jemalloc_profile("MALLOC_PROFILE_DUMP_AFTER_ALL_PASSES");
+  }
+
+  if (args.stop_pass_idx == boost::none) {
+    // Call redex_backend by default
+    auto profile_backend =
+        ScopedCommandProfiling::maybe_from_env("BACKEND_", "backend");
+    redex_backend(conf, manager, stores, stats);
+    if (args.config.get("emit_class_method_info_map", false).asBool()) {
+      dump_class_method_info_map(conf.metafile(CLASS_METHOD_INFO_MAP), stores);
+    }
+  } else {
+    redex::write_all_intermediate(conf, args.out_dir, args.redex_options,
+                                  stores, args.entry_data);
+  }
+  maybe_dump_jemalloc_profile("MALLOC_PROFILE_DUMP_BACKEND");
+}
+
+std::string get_stats_output_path(const ConfigFiles& conf,
+                                  const Arguments& args) {
+  return conf.metafile(
+      args.config.get("stats_output", "redex-stats.txt").asString());
+}
+
+// The path of the Chrome trace-event timeline, or empty if it is disabled.
+std::string get_timeline_output_path(const ConfigFiles& conf,
+                                     const Arguments& args) {
+  auto output = args.config.get("timeline_output", "").asString();
+  return output.empty() ? output : conf.metafile(output);
+}
+
+void write_stats(Json::Value& stats,
+                 double cpu_time_s,
+                 const std::string& stats_output_path) {
+  stats["output_stats"]["time_stats"] = get_times(cpu_time_s);
+
+  auto vm_stats = get_mem_stats();
+  stats["output_stats"]["mem_stats"]["vm_peak"] =
+      (Json::UInt64)vm_stats.vm_peak;
+  stats["output_stats"]["mem_stats"]["vm_hwm"] = (Json::UInt64)vm_stats.vm_peak;
+
+  stats["output_stats"]["threads"] = get_threads_stats();
+
+  std::ofstream out(stats_output_path);
+  out << stats;
+}
+
+#if !IS_WINDOWS
+// Runs the passes and the backend of a variant in its forked worker, see
+// redex::fork_variants.
+void run_variant(const ConfigFiles& parent_conf,
+                 const Arguments& args,
+                 const std::string& out_dir,
+                 const Json::Value& config,
+                 std::unique_ptr<keep_rules::ProguardConfiguration> pg_config,
+                 DexStoresVector& stores,
+                 const Json::Value& stats) {
+  Arguments variant_args = args;
+  variant_args.config = config;
+  variant_args.out_dir = out_dir;
+  variant_args.variants.clear();
+  Json::Value variant_stats = stats;
+  ConfigFiles conf(parent_conf, variant_args.config, variant_args.out_dir);
+  conf.parse_global_config();
+  run_optimizations(conf, variant_args, std::move(pg_config), stores,
+                    variant_stats);
+  write_stats(variant_stats, ((double)std::clock()) / CLOCKS_PER_SEC,
+              get_stats_output_path(conf, variant_args));
+  auto timeline_output_path = get_timeline_output_path(conf, variant_args);
+  if (!timeline_output_path.empty()) {
+    timeline::write_chrome_trace(timeline_output_path);
+  }
+}
+#endif
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -1300,8 +1685,10 @@ int main(int argc, char* argv[]) {
       ScopedCommandProfiling::maybe_from_env("GLOBAL_", "global");
 
   std::string stats_output_path;
+  std::string timeline_output_path;
   Json::Value stats;
   double cpu_time_s;
+  bool variants_succeeded = true;
   {
     Timer redex_all_main_timer("redex-all main()");
 
@@ -1319,12 +1706,21 @@ int main(int argc, char* argv[]) {
     //       list of library JARS.
     Arguments args = parse_args(argc, argv);
 
+    // Start recording as early as possible, the path is resolved later.
+    timeline::set_enabled(
+        !args.config.get("timeline_output", "").asString().empty());
+
     keep_reason::Reason::set_record_keep_reasons(
         args.config.get("record_keep_reasons", false).asBool());
 
+    sparta::set_numa_aware_workers(
+        args.config.get("numa_aware_workqueues", false).asBool());
+
     // For convenience.
     g_redex->instrument_mode = args.redex_options.instrument_pass_enabled;
 
+    IRArena::set_enabled(args.config.get("ir_arena", false).asBool());
+
     slow_invariants_debug =
         args.config.get("slow_invariants_debug", false).asBool();
     cfg::ControlFlowGraph::DEBUG =
@@ -1349,72 +1745,60 @@ int main(int argc, char* argv[]) {
     {
       auto profile_frontend =
           ScopedCommandProfiling::maybe_from_env("FRONTEND_", "frontend");
-      redex_frontend(conf, args, *pg_config, stores, stats);
+      if (args.input_ir_dir.empty()) {
+        redex_frontend(conf, args, *pg_config, stores, stats);
+      } else {
+        redex_frontend_from_ir(conf, args, *pg_config, stores);
+      }
       conf.parse_global_config();
       maybe_dump_jemalloc_profile("MALLOC_PROFILE_DUMP_FRONTEND");
     }
 
-    // Initialize purity defaults, if set.
-    purity::CacheConfig::parse_default(conf);
-
-    auto const& passes = PassRegistry::get().get_passes();
-    PassManager manager(passes, std::move(pg_config), args.config,
-                        args.redex_options);
+#if !IS_WINDOWS
+    auto variant_pids = redex::fork_variants(
+        args.variants,
+        [&](const std::string& out_dir, const Json::Value& config) {
+          // The worker has its own copy of the parent's state, so it can take
+          // over the ProGuard configuration.
+          run_variant(conf, args, out_dir, config, std::move(pg_config),
+                      stores, stats);
+        });
+#endif
 
-    ab_test::ABExperimentContext::parse_experiments_states(
-        conf, !manager.get_redex_options().redacted);
+    run_optimizations(conf, args, std::move(pg_config), stores, stats);
 
+#if !IS_WINDOWS
     {
-      Timer t("Running optimization passes");
-      manager.run_passes(stores, conf);
-      maybe_dump_jemalloc_profile("MALLOC_PROFILE_DUMP_AFTER_ALL_PASSES");
-    }
-
-    if (args.stop_pass_idx == boost::none) {
-      // Call redex_backend by default
-      auto profile_backend =
-          ScopedCommandProfiling::maybe_from_env("BACKEND_", "backend");
-      redex_backend(conf, manager, stores, stats);
-      if (args.config.get("emit_class_method_info_map", false).asBool()) {
-        dump_class_method_info_map(conf.metafile(CLASS_METHOD_INFO_MAP),
-                                   stores);
-      }
-    } else {
-      redex::write_all_intermediate(conf, args.out_dir, args.redex_options,
-                                    stores, args.entry_data);
+      Timer t("Waiting for variants");
+      variants_succeeded =
+          redex::wait_for_variants(args.variants, variant_pids);
     }
-    maybe_dump_jemalloc_profile("MALLOC_PROFILE_DUMP_BACKEND");
+#endif
 
-    stats_output_path = conf.metafile(
-        args.config.get("stats_output", "redex-stats.txt").asString());
+    stats_output_path = get_stats_output_path(conf, args);
+    timeline_output_path = get_timeline_output_path(conf, args);
 
-    {
+    // Tearing down the context of a large app takes seconds, and the process
+    // exits right after, so it can be left to the OS.
+    if (conf.get_json_config().get("free_global_memory", true)) {
       Timer t("Freeing global memory");
       delete g_redex;
     }
     cpu_time_s = ((double)std::clock()) / CLOCKS_PER_SEC;
   }
   // now that all the timers are done running, we can collect the data
-  stats["output_stats"]["time_stats"] = get_times(cpu_time_s);
-
-  auto vm_stats = get_mem_stats();
-  stats["output_stats"]["mem_stats"]["vm_peak"] =
-      (Json::UInt64)vm_stats.vm_peak;
-  stats["output_stats"]["mem_stats"]["vm_hwm"] = (Json::UInt64)vm_stats.vm_peak;
-
-  stats["output_stats"]["threads"] = get_threads_stats();
-
-  {
-    std::ofstream out(stats_output_path);
-    out << stats;
+  write_stats(stats, cpu_time_s, stats_output_path);
+  if (!timeline_output_path.empty()) {
+    timeline::write_chrome_trace(timeline_output_path);
   }
 
   TRACE(MAIN, 1, "Done.");
   if (traceEnabled(MAIN, 1) || traceEnabled(STATS, 1)) {
+    auto vm_stats = get_mem_stats();
     TRACE(STATS, 0, "Memory stats: VmPeak=%s VmHWM=%s",
           pretty_bytes(vm_stats.vm_peak).c_str(),
           pretty_bytes(vm_stats.vm_hwm).c_str());
   }
 
-  return 0;
+  return variants_succeeded ? 0 : EXIT_FAILURE;
 }
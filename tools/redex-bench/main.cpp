@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <json/json.h>
+#include <map>
+
+#include "DexClass.h"
+#include "DexLoader.h"
+#include "PassRegistry.h"
+#include "RedexContext.h"
+#include "ToolsCommon.h"
+
+/*
+ * Runs passes on an IR snapshot, as written by `redex-all --output-ir`, a
+ * number of times, each time on a fresh copy of the snapshot, and prints the
+ * distribution of the time and memory metrics of each pass as JSON:
+ *
+ *   redex-bench -i <ir dir> -p CommonSubexpressionEliminationPass -n 10
+ *
+ * Unlike redex-opt, no RegAllocPass is appended and nothing is written out, so
+ * that only the given passes are measured.
+ */
+
+namespace {
+
+// The metrics of each pass run that are summarized, when a run reports them.
+const char* const kMetrics[] = {
+    "wall_time_ms",
+    "cpu_time_ms",
+    "effective_parallelism_pct",
+    "vm_hwm_after",
+    "vm_hwm_delta",
+    "mem_allocated_delta",
+    "mem_resident_delta",
+    "vm_rss_delta",
+};
+
+struct Arguments {
+  std::string input_ir_dir;
+  std::vector<std::string> pass_names;
+  size_t iterations{5};
+  RedexOptions redex_options;
+  std::string config_file;
+};
+
+Arguments parse_args(int argc, char* argv[]) {
+  namespace po = boost::program_options;
+  po::options_description desc(
+      "Benchmark passes with dex and IR meta as input");
+  desc.add_options()("help,h", "produce help message");
+  desc.add_options()("input-ir,i", po::value<std::string>(),
+                     "input dex and IR meta directory");
+  desc.add_options()("pass-name,p", po::value<std::vector<std::string>>(),
+                     "pass name, may be given several times to run a "
+                     "sequence of passes");
+  desc.add_options()("iterations,n", po::value<size_t>(),
+                     "number of runs on fresh copies of the input (default 5)");
+  desc.add_options()("config,c",
+                     po::value<std::string>(),
+                     "A JSON-formatted config file to replace the one from "
+                     "{input-ir}/entry.json");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    desc.print(std::cout);
+    exit(EXIT_SUCCESS);
+  }
+
+  Arguments args;
+
+  if (vm.count("input-ir")) {
+    args.input_ir_dir = vm["input-ir"].as<std::string>();
+  }
+  if (args.input_ir_dir.empty()) {
+    std::cerr << "input-ir is empty\n";
+    exit(EXIT_FAILURE);
+  }
+
+  if (vm.count("pass-name")) {
+    args.pass_names = vm["pass-name"].as<std::vector<std::string>>();
+  }
+  if (args.pass_names.empty()) {
+    std::cerr << "no pass-name given\n";
+    exit(EXIT_FAILURE);
+  }
+
+  if (vm.count("iterations")) {
+    args.iterations = vm["iterations"].as<size_t>();
+  }
+  if (args.iterations == 0) {
+    std::cerr << "iterations must be positive\n";
+    exit(EXIT_FAILURE);
+  }
+
+  if (vm.count("config")) {
+    args.config_file = vm["config"].as<std::string>();
+  }
+
+  return args;
+}
+
+// The values of each metric of each pass, over all iterations, keyed by the
+// pass name with its repeat, e.g. "LocalDcePass#1".
+using Samples =
+    std::map<std::string, std::map<std::string, std::vector<int64_t>>>;
+
+void run_iteration(const Arguments& args,
+                   const std::string& out_dir,
+                   Samples* samples) {
+  g_redex = new RedexContext();
+  {
+    Json::Value entry_data;
+    DexStoresVector stores;
+    redex::load_all_intermediate(args.input_ir_dir, stores, &entry_data);
+
+    // Set input dex magic to the first DexStore from the first dex file
+    if (!stores.empty()) {
+      auto first_dex_path = boost::filesystem::path(args.input_ir_dir) /
+                            entry_data["dex_list"][0]["list"][0].asString();
+      stores[0].set_dex_magic(load_dex_magic_from_dex(first_dex_path.c_str()));
+    }
+
+    if (!args.config_file.empty()) {
+      entry_data["config"] = args.config_file;
+    }
+    RedexOptions redex_options = args.redex_options;
+    redex_options.deserialize(entry_data);
+
+    Json::Value config_data =
+        redex::parse_config(entry_data["config"].asString());
+    config_data["redex"]["passes"] = Json::arrayValue;
+    for (const auto& pass_name : args.pass_names) {
+      config_data["redex"]["passes"].append(pass_name);
+    }
+    if (entry_data.isMember("apk_dir")) {
+      config_data["apk_dir"] = entry_data["apk_dir"].asString();
+    }
+    ConfigFiles conf(config_data, out_dir);
+
+    PassManager manager(PassRegistry::get().get_passes(), config_data,
+                        redex_options);
+    manager.set_testing_mode();
+    manager.run_passes(stores, conf);
+
+    for (const auto& info : manager.get_pass_info()) {
+      auto& pass_samples = (*samples)[info.name];
+      for (const char* metric : kMetrics) {
+        auto it = info.metrics.find(metric);
+        if (it != info.metrics.end()) {
+          pass_samples[metric].push_back(it->second);
+        }
+      }
+    }
+  }
+  delete g_redex;
+  g_redex = nullptr;
+}
+
+Json::Value summarize(std::vector<int64_t> values) {
+  std::sort(values.begin(), values.end());
+  int64_t sum = 0;
+  for (auto v : values) {
+    sum += v;
+  }
+  Json::Value result;
+  result["min"] = Json::Int64(values.front());
+  result["median"] = Json::Int64(values[values.size() / 2]);
+  result["mean"] = static_cast<double>(sum) / values.size();
+  result["max"] = Json::Int64(values.back());
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  Arguments args = parse_args(argc, argv);
+
+  auto out_dir = boost::filesystem::temp_directory_path() /
+                 boost::filesystem::unique_path("redex-bench-%%%%%%%%");
+  boost::filesystem::create_directories(out_dir / "meta");
+
+  Samples samples;
+  for (size_t i = 0; i < args.iterations; ++i) {
+    std::cerr << "Iteration " << (i + 1) << " of " << args.iterations
+              << std::endl;
+    run_iteration(args, out_dir.string(), &samples);
+  }
+  boost::filesystem::remove_all(out_dir);
+
+  Json::Value result;
+  result["iterations"] = Json::UInt64(args.iterations);
+  for (const auto& [pass, metrics] : samples) {
+    for (const auto& [metric, values] : metrics) {
+      result["passes"][pass][metric] = summarize(values);
+    }
+  }
+  Json::StreamWriterBuilder writer;
+  writer["indentation"] = "  ";
+  std::cout << Json::writeString(writer, result) << std::endl;
+  return 0;
+}
@@ -12,7 +12,9 @@
 
 #include "DexClass.h"
 #include "DexLoader.h"
+#include "Macros.h"
 #include "PassRegistry.h"
+#include "RedexContext.h"
 #include "Timer.h"
 #include "ToolsCommon.h"
 
@@ -26,8 +28,20 @@ struct Arguments {
   std::string config_file;
   std::vector<std::string> s_args;
   std::vector<std::string> j_args;
+  // Output directories and config patches of the variants that are forked
+  // off after loading, see --variant.
+  std::vector<std::pair<std::string, Json::Value>> variants;
 };
 
+void make_output_ir_dir(const std::string& output_ir_dir) {
+  std::string meta_dir = output_ir_dir + "/meta";
+  boost::filesystem::create_directories(meta_dir);
+  if (!boost::filesystem::is_directory(meta_dir)) {
+    std::cerr << "Could not create " << meta_dir << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
 Arguments parse_args(int argc, char* argv[]) {
   namespace po = boost::program_options;
   po::options_description desc(
@@ -67,6 +81,14 @@ Arguments parse_args(int argc, char* argv[]) {
       "    \te.g. -JMyPass.config=[1, 2, 3]\n"
       "Note: Be careful to properly escape JSON parameters, e.g., strings must "
       "be quoted.");
+  desc.add_options()(
+      "variant",
+      po::value<std::vector<std::string>>(), // Accumulation
+      "--variant outdir=config\n"
+      "  \tAfter loading the input IR, fork a worker that runs the passes and "
+      "writes its output IR to outdir, with the settings of the JSON file "
+      "config merged over the main config. Workers share the loaded IR with "
+      "the main run, so that one run can try out several pass settings.");
 
   po::variables_map vm;
   po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -90,12 +112,7 @@ Arguments parse_args(int argc, char* argv[]) {
     std::cerr << "output-dir is empty\n";
     exit(EXIT_FAILURE);
   }
-  std::string meta_dir = args.output_ir_dir + "/meta";
-  boost::filesystem::create_directories(meta_dir);
-  if (!boost::filesystem::is_directory(meta_dir)) {
-    std::cerr << "Could not create " << meta_dir << std::endl;
-    exit(EXIT_FAILURE);
-  }
+  make_output_ir_dir(args.output_ir_dir);
 
   if (vm.count("pass-name")) {
     args.pass_names = vm["pass-name"].as<std::vector<std::string>>();
@@ -112,6 +129,26 @@ Arguments parse_args(int argc, char* argv[]) {
     args.j_args = vm["-J"].as<std::vector<std::string>>();
   }
 
+  if (vm.count("variant")) {
+#if IS_WINDOWS
+    std::cerr << "error: --variant is not supported on Windows" << std::endl;
+    exit(EXIT_FAILURE);
+#endif
+    for (auto& dir_config : vm["variant"].as<std::vector<std::string>>()) {
+      const size_t equals_idx = dir_config.find('=');
+      if (equals_idx == std::string::npos) {
+        std::cerr << "error: cannot parse --variant " << dir_config
+                  << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      std::string out_dir = dir_config.substr(0, equals_idx);
+      make_output_ir_dir(out_dir);
+      args.variants.emplace_back(
+          std::move(out_dir),
+          redex::parse_config(dir_config.substr(equals_idx + 1)));
+    }
+  }
+
   return args;
 }
 
@@ -197,6 +234,23 @@ Json::Value process_entry_data(const Json::Value& entry_data,
 
   return config_data;
 }
+
+void run_passes(const Arguments& args,
+                const Json::Value& config_data,
+                const std::string& output_ir_dir,
+                DexStoresVector& stores,
+                Json::Value& entry_data) {
+  ConfigFiles conf(config_data, output_ir_dir);
+
+  const auto& passes = PassRegistry::get().get_passes();
+  PassManager manager(passes, config_data, args.redex_options);
+  manager.set_testing_mode();
+  manager.run_passes(stores, conf);
+
+  redex::write_all_intermediate(conf, output_ir_dir, args.redex_options,
+                                stores, entry_data);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -225,16 +279,27 @@ int main(int argc, char* argv[]) {
   args.redex_options.deserialize(entry_data);
 
   Json::Value config_data = process_entry_data(entry_data, args);
-  ConfigFiles conf(config_data, args.output_ir_dir);
-
-  const auto& passes = PassRegistry::get().get_passes();
-  PassManager manager(passes, config_data, args.redex_options);
-  manager.set_testing_mode();
-  manager.run_passes(stores, conf);
 
-  redex::write_all_intermediate(conf, args.output_ir_dir, args.redex_options,
-                                stores, entry_data);
+  bool variants_succeeded = true;
+#if !IS_WINDOWS
+  auto variant_pids = redex::fork_variants(
+      args.variants, [&](const std::string& out_dir, const Json::Value& patch) {
+        Json::Value variant_config = config_data;
+        redex::merge_variant_config(patch, variant_config);
+        Json::Value variant_entry_data = entry_data;
+        run_passes(args, variant_config, out_dir, stores, variant_entry_data);
+      });
+#endif
+
+  run_passes(args, config_data, args.output_ir_dir, stores, entry_data);
+
+#if !IS_WINDOWS
+  {
+    Timer t("Waiting for variants");
+    variants_succeeded = redex::wait_for_variants(args.variants, variant_pids);
+  }
+#endif
 
   delete g_redex;
-  return 0;
+  return variants_succeeded ? 0 : EXIT_FAILURE;
 }
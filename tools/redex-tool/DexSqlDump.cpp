@@ -21,7 +21,9 @@ $ ./native/redex/tools/redex-tool/DexSqlQuery.py dex.db
 
 */
 
+#include <array>
 #include <boost/algorithm/string/replace.hpp>
+#include <cstdarg>
 #include <queue>
 #include <unordered_map>
 #include <vector>
@@ -34,6 +36,7 @@ $ ./native/redex/tools/redex-tool/DexSqlQuery.py dex.db
 #include "Show.h"
 #include "Tool.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -42,94 +45,165 @@ static std::unordered_map<DexMethod*, int> method_ids;
 static std::unordered_map<DexField*, int> field_ids;
 static std::unordered_map<const DexString*, int> string_ids;
 
-void dump_field_refs(FILE* fdout,
-                     const char* prefix,
-                     DexField* field,
-                     int field_id) {
-  static int next_string_ref = 0;
+// sqlite limits the number of rows of a single VALUES clause to 500 by
+// default.
+constexpr size_t kRowsPerInsert = 500;
+
+enum Table {
+  STRINGS,
+  CLASSES,
+  FIELDS,
+  METHODS,
+  METHOD_STRING_REFS,
+  METHOD_CLASS_REFS,
+  METHOD_FIELD_REFS,
+  METHOD_METHOD_REFS,
+  FIELD_STRING_REFS,
+  IS_A,
+  NUM_TABLES,
+};
+
+const char* const kTableNames[NUM_TABLES] = {
+    "strings",
+    "classes",
+    "fields",
+    "methods",
+    "method_string_refs",
+    "method_class_refs",
+    "method_field_refs",
+    "method_method_refs",
+    "field_string_refs",
+    "is_a",
+};
+
+// The rows of the reference tables leave out their id, which only the writer
+// assigns, so that the rows of the dexes can be rendered in parallel.
+bool has_implicit_id(Table table) { return table >= METHOD_STRING_REFS; }
+
+using TableRows = std::array<std::vector<std::string>, NUM_TABLES>;
+
+struct DexDump {
+  std::string dex_id;
+  DexClasses* classes;
+  std::vector<const DexString*> strings;
+  TableRows rows;
+};
+
+void add_row(TableRows& rows, Table table, const char* format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+void add_row(TableRows& rows, Table table, const char* format, ...) {
+  va_list ap;
+  va_start(ap, format);
+  va_list ap_copy;
+  va_copy(ap_copy, ap);
+  int size = vsnprintf(nullptr, 0, format, ap_copy);
+  va_end(ap_copy);
+  always_assert(size >= 0);
+  std::string row(size, '\0');
+  vsnprintf(row.data(), size + 1, format, ap);
+  va_end(ap);
+  rows[table].push_back(std::move(row));
+}
+
+// Writes the rows as multi-row INSERT statements, which sqlite loads much
+// faster than one statement per row.
+void write_rows(FILE* fdout,
+                const char* prefix,
+                Table table,
+                const std::vector<std::string>& rows,
+                int* next_id) {
+  for (size_t i = 0; i < rows.size(); ++i) {
+    if (i % kRowsPerInsert == 0) {
+      fprintf(fdout, "INSERT INTO %s%s VALUES\n", prefix, kTableNames[table]);
+    } else {
+      fprintf(fdout, ",\n");
+    }
+    if (has_implicit_id(table)) {
+      fprintf(fdout, "(%d, %s)", (*next_id)++, rows[i].c_str());
+    } else {
+      fprintf(fdout, "(%s)", rows[i].c_str());
+    }
+    if (i % kRowsPerInsert == kRowsPerInsert - 1 || i + 1 == rows.size()) {
+      fprintf(fdout, ";\n");
+    }
+  }
+}
+
+void dump_field_refs(TableRows& rows, DexField* field, int field_id) {
   auto* static_value = field->get_static_value();
   if (!static_value || (static_value->evtype() != DEVT_STRING)) return;
   auto* static_string_value = static_cast<DexEncodedValueString*>(static_value);
-  auto string_id = string_ids[static_string_value->string()];
-  fprintf(fdout,
-          "INSERT INTO %sfield_string_refs VALUES (%d, %d, %d);\n",
-          prefix,
-          next_string_ref++,
-          field_id,
-          string_id);
+  auto it = string_ids.find(static_string_value->string());
+  if (it == string_ids.end()) return;
+  add_row(rows, FIELD_STRING_REFS, "%d, %d", field_id, it->second);
 }
 
-void dump_method_refs(FILE* fdout,
-                      const char* prefix,
-                      DexMethod* method,
-                      int method_id) {
+void dump_method_refs(TableRows& rows, DexMethod* method, int method_id) {
   auto code = method->get_code();
   if (!code) return;
 
-  static int next_string_ref = 0;
-  static int next_class_ref = 0;
-  static int next_field_ref = 0;
-  static int next_method_ref = 0;
-
   for (auto& mie : InstructionIterable(code)) {
     auto insn = mie.insn;
     if (insn->has_string()) {
-      if (string_ids.count(insn->get_string())) {
-        auto string_id = string_ids[insn->get_string()];
-        fprintf(fdout,
-                "INSERT INTO %smethod_string_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_string_ref++,
+      auto it = string_ids.find(insn->get_string());
+      if (it != string_ids.end()) {
+        add_row(rows,
+                METHOD_STRING_REFS,
+                "%d, %d, %d",
                 method_id,
-                string_id,
+                it->second,
                 insn->opcode());
       }
     }
     if (insn->has_type()) {
       auto cls = type_class(insn->get_type());
-      if (cls && class_ids.count(cls)) {
-        auto class_id = class_ids[cls];
-        fprintf(fdout,
-                "INSERT INTO %smethod_class_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_class_ref++,
+      auto it = class_ids.find(cls);
+      if (cls && it != class_ids.end()) {
+        add_row(rows,
+                METHOD_CLASS_REFS,
+                "%d, %d, %d",
                 method_id,
-                class_id,
+                it->second,
                 insn->opcode());
       }
     }
     if (insn->has_field()) {
       auto field = resolve_field(insn->get_field());
-      if (field != nullptr && field_ids.count(field)) {
-        auto field_id = field_ids[field];
-        fprintf(fdout,
-                "INSERT INTO %smethod_field_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_field_ref++,
+      auto it = field_ids.find(field);
+      if (field != nullptr && it != field_ids.end()) {
+        add_row(rows,
+                METHOD_FIELD_REFS,
+                "%d, %d, %d",
                 method_id,
-                field_id,
+                it->second,
                 insn->opcode());
       }
     }
     if (insn->has_method()) {
       auto meth =
           resolve_method(insn->get_method(), opcode_to_search(insn), method);
-      if (meth != nullptr && method_ids.count(meth)) {
-        auto method_ref_id = method_ids[meth];
-        fprintf(fdout,
-                "INSERT INTO %smethod_method_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_method_ref++,
+      auto it = method_ids.find(meth);
+      if (meth != nullptr && it != method_ids.end()) {
+        add_row(rows,
+                METHOD_METHOD_REFS,
+                "%d, %d, %d",
                 method_id,
-                method_ref_id,
+                it->second,
                 insn->opcode());
       }
     }
   }
 }
 
-void dump_class(FILE* fdout,
-                const char* prefix,
+void dump_string(TableRows& rows, const DexString* dexstr) {
+  // Escape string before inserting. ' -> ''
+  std::string esc(dexstr->c_str());
+  boost::replace_all(esc, "'", "''");
+  add_row(rows, STRINGS, "%d, '%s'", string_ids.at(dexstr), esc.c_str());
+}
+
+void dump_class(TableRows& rows,
                 const char* dex_id,
                 DexClass* cls,
                 int class_id) {
@@ -138,9 +212,9 @@ void dump_class(FILE* fdout,
   // TODO: string usage
   // TODO: size estimate
   const auto& deobfuscated_name = cls->get_deobfuscated_name();
-  fprintf(fdout,
-          "INSERT INTO %sclasses VALUES (%d,'%s','%s','%s',%u);\n",
-          prefix,
+  add_row(rows,
+          CLASSES,
+          "%d,'%s','%s','%s',%u",
           class_id,
           dex_id,
           deobfuscated_name.c_str(),
@@ -148,8 +222,7 @@ void dump_class(FILE* fdout,
           cls->get_access());
 }
 
-void dump_field(FILE* fdout,
-                const char* prefix,
+void dump_field(TableRows& rows,
                 int class_id,
                 DexField* field,
                 int field_id) {
@@ -159,9 +232,9 @@ void dump_field(FILE* fdout,
   // TODO: string usage (encoded_value for static fields)
   const auto& deobfuscated_name = field->get_deobfuscated_name();
   auto field_name = strchr(deobfuscated_name.c_str(), ';');
-  fprintf(fdout,
-          "INSERT INTO %sfields VALUES(%d, %d, '%s', '%s', %u);\n",
-          prefix,
+  add_row(rows,
+          FIELDS,
+          "%d, %d, '%s', '%s', %u",
           field_id,
           class_id,
           field_name,
@@ -169,8 +242,7 @@ void dump_field(FILE* fdout,
           field->get_access());
 }
 
-void dump_method(FILE* fdout,
-                 const char* prefix,
+void dump_method(TableRows& rows,
                  int class_id,
                  DexMethod* method,
                  int method_id) {
@@ -182,9 +254,9 @@ void dump_method(FILE* fdout,
   // TODO: size estimate
   auto deobfuscated_name = method->get_deobfuscated_name();
   auto method_name = strchr(deobfuscated_name.c_str(), ';');
-  fprintf(fdout,
-          "INSERT INTO %smethods VALUES (%d,%d,'%s','%s',%d,%lu);\n",
-          prefix,
+  add_row(rows,
+          METHODS,
+          "%d,%d,'%s','%s',%d,%lu",
           method_id,
           class_id,
           method_name,
@@ -193,12 +265,81 @@ void dump_method(FILE* fdout,
           method->get_code() ? method->get_code()->sum_opcode_sizes() : 0);
 }
 
+// Assigns the ids of all dex items, in the order in which their rows are
+// written.
+void assign_ids(std::vector<DexDump>& dumps) {
+  int next_class_id = 0;
+  int next_method_id = 0;
+  int next_field_id = 0;
+  int next_string_id = 0;
+  for (auto& dump : dumps) {
+    for (auto dexstr : dump.strings) {
+      string_ids[dexstr] = next_string_id++;
+    }
+    for (const auto& cls : *dump.classes) {
+      class_ids[cls] = next_class_id++;
+      for (auto field : cls->get_ifields()) {
+        field_ids[field] = next_field_id++;
+      }
+      for (auto field : cls->get_sfields()) {
+        field_ids[field] = next_field_id++;
+      }
+      for (const auto& meth : cls->get_dmethods()) {
+        method_ids[meth] = next_method_id++;
+      }
+      for (auto& meth : cls->get_vmethods()) {
+        method_ids[meth] = next_method_id++;
+      }
+    }
+  }
+}
+
+void dump_dex(DexDump& dump) {
+  auto& rows = dump.rows;
+  for (auto dexstr : dump.strings) {
+    dump_string(rows, dexstr);
+  }
+  const char* dex_id = dump.dex_id.c_str();
+  for (const auto& cls : *dump.classes) {
+    int class_id = class_ids.at(cls);
+    dump_class(rows, dex_id, cls, class_id);
+    for (auto field : cls->get_ifields()) {
+      dump_field(rows, class_id, field, field_ids.at(field));
+    }
+    for (auto field : cls->get_sfields()) {
+      dump_field(rows, class_id, field, field_ids.at(field));
+    }
+    for (const auto& meth : cls->get_dmethods()) {
+      dump_method(rows, class_id, meth, method_ids.at(meth));
+    }
+    for (auto& meth : cls->get_vmethods()) {
+      dump_method(rows, class_id, meth, method_ids.at(meth));
+    }
+  }
+  for (const auto& cls : *dump.classes) {
+    for (const auto& meth : cls->get_dmethods()) {
+      dump_method_refs(rows, meth, method_ids.at(meth));
+    }
+    for (auto& meth : cls->get_vmethods()) {
+      dump_method_refs(rows, meth, method_ids.at(meth));
+    }
+    for (const auto& field : cls->get_sfields()) {
+      dump_field_refs(rows, field, field_ids.at(field));
+    }
+    for (const auto& field : cls->get_ifields()) {
+      dump_field_refs(rows, field, field_ids.at(field));
+    }
+  }
+}
+
 void dump_sql(FILE* fdout,
               DexStoresVector& stores,
               ProguardMap& pg_map,
               const char* prefix) {
   fprintf(fdout,
           R"___(
+PRAGMA journal_mode = OFF;
+PRAGMA synchronous = OFF;
 DROP TABLE IF EXISTS %1$sfield_string_refs;
 DROP TABLE IF EXISTS %1$smethod_string_refs;
 DROP TABLE IF EXISTS %1$smethod_field_refs;
@@ -271,112 +412,70 @@ CREATE TABLE %1$smethod_string_refs (
 );
 )___",
           prefix);
-  int next_class_id = 0;
-  int next_method_id = 0;
-  int next_field_id = 0;
-  int next_string_id = 0;
 
-  // Dump all dex items
-  fprintf(fdout, "BEGIN TRANSACTION;\n");
+  std::vector<DexDump> dumps;
   for (auto& store : stores) {
-    auto store_name = store.get_name();
     auto& dexen = store.get_dexen();
     apply_deobfuscated_names(dexen, pg_map);
     for (size_t dex_idx = 0; dex_idx < dexen.size(); ++dex_idx) {
-      auto& dex = dexen[dex_idx];
-      GatheredTypes gtypes(&dex);
-      auto strings = gtypes.get_cls_order_dexstring_emitlist();
-      for (auto dexstr : strings) {
-        int id = next_string_id++;
-        string_ids[dexstr] = id;
-        // Escape string before inserting. ' -> ''
-        std::string esc(dexstr->c_str());
-        boost::replace_all(esc, "'", "''");
-        fprintf(fdout,
-                "INSERT INTO %sstrings VALUES(%d, '%s');\n",
-                prefix,
-                id,
-                esc.c_str());
-      }
-      std::string dex_id_str(store_name + "/" + std::to_string(dex_idx));
-      const char* dex_id = dex_id_str.c_str();
-      for (const auto& cls : dex) {
-        int class_id = next_class_id++;
-        dump_class(fdout, prefix, dex_id, cls, class_id);
-        class_ids[cls] = class_id;
-        for (auto field : cls->get_ifields()) {
-          int field_id = next_field_id++;
-          field_ids[field] = field_id;
-          dump_field(fdout, prefix, class_id, field, field_id);
-        }
-        for (auto field : cls->get_sfields()) {
-          int field_id = next_field_id++;
-          field_ids[field] = field_id;
-          dump_field(fdout, prefix, class_id, field, field_id);
-        }
-        for (const auto& meth : cls->get_dmethods()) {
-          int meth_id = next_method_id++;
-          method_ids[meth] = meth_id;
-          dump_method(fdout, prefix, class_id, meth, meth_id);
-        }
-        for (auto& meth : cls->get_vmethods()) {
-          int meth_id = next_method_id++;
-          method_ids[meth] = meth_id;
-          dump_method(fdout, prefix, class_id, meth, meth_id);
-        }
-      }
+      dumps.push_back(DexDump{store.get_name() + "/" + std::to_string(dex_idx),
+                              &dexen[dex_idx],
+                              {},
+                              {}});
     }
   }
-  fprintf(fdout, "END TRANSACTION;\n");
+  std::vector<DexDump*> dump_ptrs;
+  for (auto& dump : dumps) {
+    dump_ptrs.push_back(&dump);
+  }
+  workqueue_run<DexDump*>(
+      [](DexDump* dump) {
+        GatheredTypes gtypes(dump->classes);
+        dump->strings = gtypes.get_cls_order_dexstring_emitlist();
+      },
+      dump_ptrs);
+  assign_ids(dumps);
+  // The id maps are only read from here on.
+  workqueue_run<DexDump*>([](DexDump* dump) { dump_dex(*dump); }, dump_ptrs);
 
-  // Dump references
-  fprintf(fdout, "BEGIN TRANSACTION;\n");
-  for (auto& store : stores) {
-    auto& dexen = store.get_dexen();
-    for (size_t dex_idx = 0; dex_idx < dexen.size(); ++dex_idx) {
-      auto& dex = dexen[dex_idx];
-      for (const auto& cls : dex) {
-        for (const auto& meth : cls->get_dmethods()) {
-          int meth_id = method_ids[meth];
-          dump_method_refs(fdout, prefix, meth, meth_id);
-        }
-        for (auto& meth : cls->get_vmethods()) {
-          int meth_id = method_ids[meth];
-          dump_method_refs(fdout, prefix, meth, meth_id);
-        }
-        for (const auto& field : cls->get_sfields()) {
-          int field_id = field_ids[field];
-          dump_field_refs(fdout, prefix, field, field_id);
-        }
-        for (const auto& field : cls->get_ifields()) {
-          int field_id = field_ids[field];
-          dump_field_refs(fdout, prefix, field, field_id);
-        }
+  // Dump all dex items, then the references between them
+  std::array<int, NUM_TABLES> next_ids{};
+  for (auto tables : {std::make_pair(STRINGS, METHOD_STRING_REFS),
+                      std::make_pair(METHOD_STRING_REFS, IS_A)}) {
+    fprintf(fdout, "BEGIN TRANSACTION;\n");
+    for (auto& dump : dumps) {
+      for (int table = tables.first; table < tables.second; ++table) {
+        write_rows(fdout,
+                   prefix,
+                   static_cast<Table>(table),
+                   dump.rows[table],
+                   &next_ids[table]);
+        std::vector<std::string>().swap(dump.rows[table]);
       }
     }
+    fprintf(fdout, "END TRANSACTION;\n");
   }
-  fprintf(fdout, "END TRANSACTION;\n");
 
   // Dump hierarchy
   auto scope = build_class_scope(stores);
   ClassHierarchy ch = build_type_hierarchy(scope);
-  int next_is_a_id = 0;
-  fprintf(fdout, "BEGIN TRANSACTION;\n");
+  TableRows hierarchy_rows;
   for (auto& cls : scope) {
     TypeSet results;
     get_all_children_or_implementors(ch, scope, cls, results);
     for (auto type : results) {
       auto type_cls = type_class(type);
       if (type_cls) {
-        fprintf(fdout,
-                "INSERT INTO %sis_a VALUES(%d, %d, %d);\n",
-                prefix,
-                next_is_a_id++,
+        add_row(hierarchy_rows,
+                IS_A,
+                "%d, %d",
                 class_ids[type_cls],
                 class_ids[cls]);
       }
     }
   }
+  fprintf(fdout, "BEGIN TRANSACTION;\n");
+  write_rows(fdout, prefix, IS_A, hierarchy_rows[IS_A], &next_ids[IS_A]);
   fprintf(fdout, "END TRANSACTION;\n");
 }
 
@@ -6,7 +6,10 @@
  */
 
 #include "DexClass.h"
+#include "DexCommon.h"
+#include "DexEncoding.h"
 #include "DexInstruction.h"
+#include "DexOpcode.h"
 #include "DexUtil.h"
 #include "JarLoader.h"
 #include "ProguardConfiguration.h"
@@ -16,11 +19,15 @@
 #include "Show.h"
 #include "Tool.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 #include <algorithm>
+#include <boost/filesystem.hpp>
 #include <iostream>
 #include <map>
+#include <numeric>
 #include <string>
+#include <sys/mman.h>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -187,10 +194,211 @@ DexMethodInfoMap load_dex_method_move_info(const std::string& dir) {
   return result;
 }
 
-void dump_method_sizes_from_dexen_dir(const std::string& dexen_dir) {
+// The number of 16-bit code units of an instruction of the given format.
+size_t code_units(OpcodeFormat format) {
+  switch (format) {
+  case FMT_f00x:
+  case FMT_f10x:
+  case FMT_f12x:
+  case FMT_f12x_2:
+  case FMT_f11n:
+  case FMT_f11x_d:
+  case FMT_f11x_s:
+  case FMT_f10t:
+    return 1;
+  case FMT_f20t:
+  case FMT_f20bc:
+  case FMT_f22x:
+  case FMT_f21t:
+  case FMT_f21s:
+  case FMT_f21h:
+  case FMT_f21c_d:
+  case FMT_f21c_s:
+  case FMT_f23x_d:
+  case FMT_f23x_s:
+  case FMT_f22b:
+  case FMT_f22t:
+  case FMT_f22s:
+  case FMT_f22c_d:
+  case FMT_f22c_s:
+  case FMT_f22cs:
+    return 2;
+  case FMT_f30t:
+  case FMT_f32x:
+  case FMT_f31i:
+  case FMT_f31t:
+  case FMT_f31c:
+  case FMT_f35c:
+  case FMT_f35ms:
+  case FMT_f35mi:
+  case FMT_f3rc:
+  case FMT_f3rms:
+  case FMT_f3rmi:
+    return 3;
+  case FMT_f41c_d:
+  case FMT_f41c_s:
+  case FMT_f45cc:
+  case FMT_f4rcc:
+    return 4;
+  case FMT_f51l:
+  case FMT_f52c_d:
+  case FMT_f52c_s:
+  case FMT_f5rc:
+  case FMT_f57c:
+    return 5;
+  case FMT_fopcode:
+  case FMT_iopcode:
+    not_reached();
+  }
+  not_reached();
+}
+
+// The same numbers as load_dex_method_info and load_dex_method_move_info
+// compute for a method, read from its code item. Like DexCode::size(), the
+// code size does not count switch and array payloads.
+std::tuple<int, int> read_code_info(ddump_data* rd,
+                                    uint32_t code_off,
+                                    bool is_comparing_dex_size) {
+  const auto* code =
+      reinterpret_cast<const dex_code_item*>(rd->dexmmap + code_off);
+  const auto* insns = reinterpret_cast<const uint16_t*>(code + 1);
+  const auto* end = insns + code->insns_size;
+  int code_size = 0;
+  int num_moves = 0;
+  int moves_size = 0;
+  while (insns < end) {
+    size_t units;
+    if (*insns == FOPCODE_PACKED_SWITCH) {
+      units = insns[1] * 2 + 4;
+    } else if (*insns == FOPCODE_SPARSE_SWITCH) {
+      units = insns[1] * 4 + 2;
+    } else if (*insns == FOPCODE_FILLED_ARRAY) {
+      uint32_t size;
+      memcpy(&size, insns + 2, sizeof(size));
+      units = (insns[1] * size + 1) / 2 + 4;
+    } else {
+      auto op = static_cast<DexOpcode>(*insns & 0xff);
+      units = code_units(dex_opcode::format(op));
+      code_size += units;
+      if (dex_opcode::is_move(op)) {
+        ++num_moves;
+        moves_size += units;
+      }
+    }
+    insns += units;
+  }
+  return is_comparing_dex_size
+             ? std::make_tuple(code_size, int(code->registers_size))
+             : std::make_tuple(num_moves, moves_size);
+}
+
+// Formats a method id like show(DexMethod*).
+std::string method_name(ddump_data* rd, const dex_method_id& method) {
+  const auto& proto = rd->dex_proto_ids[method.protoidx];
+  std::string name = std::string(dex_string_by_type_idx(rd, method.classidx)) +
+                     "." + dex_string_by_idx(rd, method.nameidx) + ":(";
+  if (proto.param_off != 0) {
+    auto* params = reinterpret_cast<uint32_t*>(rd->dexmmap + proto.param_off);
+    auto* types = reinterpret_cast<uint16_t*>(params + 1);
+    for (uint32_t i = 0; i < *params; ++i) {
+      name += dex_string_by_type_idx(rd, types[i]);
+    }
+  }
+  return name + ")" + dex_string_by_type_idx(rd, proto.rtypeidx);
+}
+
+using DexMethodInfoList =
+    std::vector<std::pair<std::string, std::tuple<int, int>>>;
+
+// Walks the class data of a mapped dex file; neither its classes nor its
+// code are loaded.
+DexMethodInfoList read_dex_method_info(const std::string& dex_file,
+                                       bool is_comparing_dex_size) {
+  ddump_data rd;
+  open_dex_file(dex_file.c_str(), &rd);
+  DexMethodInfoList result;
+  for (uint32_t i = 0; i < rd.dexh->class_defs_size; ++i) {
+    auto class_data_off = rd.dex_class_defs[i].class_data_offset;
+    if (class_data_off == 0) {
+      continue;
+    }
+    const auto* ptr =
+        reinterpret_cast<const uint8_t*>(rd.dexmmap + class_data_off);
+    uint32_t num_fields = read_uleb128(&ptr);
+    num_fields += read_uleb128(&ptr);
+    uint32_t num_dmethods = read_uleb128(&ptr);
+    uint32_t num_methods = num_dmethods + read_uleb128(&ptr);
+    for (uint32_t j = 0; j < num_fields; ++j) {
+      read_uleb128(&ptr); // field_idx_diff
+      read_uleb128(&ptr); // access_flags
+    }
+    uint32_t method_idx = 0;
+    for (uint32_t j = 0; j < num_methods; ++j) {
+      if (j == num_dmethods) {
+        method_idx = 0;
+      }
+      method_idx += read_uleb128(&ptr);
+      read_uleb128(&ptr); // access_flags
+      uint32_t code_off = read_uleb128(&ptr);
+      result.emplace_back(
+          method_name(&rd, rd.dex_method_ids[method_idx]),
+          code_off == 0 ? std::make_tuple(0, 0)
+                        : read_code_info(&rd, code_off, is_comparing_dex_size));
+    }
+  }
+  munmap(rd.dexmmap, rd.dex_size);
+  return result;
+}
+
+// Reads the method info of the given dexen directories straight from the dex
+// files, all files of all directories in parallel.
+std::vector<DexMethodInfoMap> read_dexen_method_info(
+    const std::vector<std::string>& dirs, bool is_comparing_dex_size) {
+  namespace fs = boost::filesystem;
+  std::vector<std::pair<size_t, std::string>> dex_files;
+  for (size_t i = 0; i < dirs.size(); ++i) {
+    for (fs::directory_iterator it(dirs[i]), end; it != end; ++it) {
+      auto file = it->path();
+      if (fs::is_regular_file(file) && file.extension() == ".dex") {
+        dex_files.emplace_back(i, file.string());
+      }
+    }
+  }
+  std::vector<DexMethodInfoList> lists(dex_files.size());
+  std::vector<size_t> indices(dex_files.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        lists[i] =
+            read_dex_method_info(dex_files[i].second, is_comparing_dex_size);
+      },
+      indices);
+  std::vector<DexMethodInfoMap> result(dirs.size());
+  for (size_t i = 0; i < dex_files.size(); ++i) {
+    auto& info = result[dex_files[i].first];
+    for (auto& pair : lists[i]) {
+      auto inserted = info.emplace(std::move(pair)).second;
+      always_assert(inserted);
+    }
+  }
+  return result;
+}
+
+DexMethodInfoMap load_dex_method_info(const std::string& dir,
+                                      bool is_comparing_dex_size,
+                                      bool fast) {
+  if (fast) {
+    return std::move(read_dexen_method_info({dir}, is_comparing_dex_size)[0]);
+  }
+  return is_comparing_dex_size ? load_dex_method_info(dir)
+                               : load_dex_method_move_info(dir);
+}
+
+void dump_method_sizes_from_dexen_dir(const std::string& dexen_dir,
+                                      bool fast) {
   std::cout << "INFO: "
             << "Loading directory " << dexen_dir << " ... " << std::endl;
-  auto info = load_dex_method_info(dexen_dir);
+  auto info = load_dex_method_info(dexen_dir, true, fast);
   std::cout << "INFO: " << info.size() << " method information loaded"
             << std::endl;
   for (const auto& pair : info) {
@@ -201,23 +409,37 @@ void dump_method_sizes_from_dexen_dir(const std::string& dexen_dir) {
 
 void diff_from_two_dexen_dirs(const std::string& dexen_dir_A,
                               const std::string& dexen_dir_B,
-                              bool is_comparing_dex_size) {
-  std::cout << "INFO: "
-            << "Loading directory " << dexen_dir_A << " ... " << std::endl;
+                              bool is_comparing_dex_size,
+                              bool fast) {
   RedexContext* A_context = g_redex;
-  auto A_info = is_comparing_dex_size ? load_dex_method_info(dexen_dir_A)
-                                      : load_dex_method_move_info(dexen_dir_A);
-  std::cout << "INFO: " << A_info.size() << " method information loaded"
-            << std::endl;
+  std::unique_ptr<RedexContext> B_context;
+  DexMethodInfoMap A_info;
+  DexMethodInfoMap B_info;
+  if (fast) {
+    std::cout << "INFO: "
+              << "Reading directories " << dexen_dir_A << " and "
+              << dexen_dir_B << " ... " << std::endl;
+    auto infos = read_dexen_method_info({dexen_dir_A, dexen_dir_B},
+                                        is_comparing_dex_size);
+    A_info = std::move(infos[0]);
+    B_info = std::move(infos[1]);
+    std::cout << "INFO: " << A_info.size() << " and " << B_info.size()
+              << " method information loaded" << std::endl;
+  } else {
+    std::cout << "INFO: "
+              << "Loading directory " << dexen_dir_A << " ... " << std::endl;
+    A_info = load_dex_method_info(dexen_dir_A, is_comparing_dex_size, false);
+    std::cout << "INFO: " << A_info.size() << " method information loaded"
+              << std::endl;
 
-  std::cout << "INFO: "
-            << "Loading directory " << dexen_dir_B << " ... " << std::endl;
-  std::unique_ptr<RedexContext> B_context(new RedexContext());
-  g_redex = B_context.get();
-  auto B_info = is_comparing_dex_size ? load_dex_method_info(dexen_dir_B)
-                                      : load_dex_method_move_info(dexen_dir_B);
-  std::cout << "INFO: " << B_info.size() << " method information loaded"
-            << std::endl;
+    std::cout << "INFO: "
+              << "Loading directory " << dexen_dir_B << " ... " << std::endl;
+    B_context = std::make_unique<RedexContext>();
+    g_redex = B_context.get();
+    B_info = load_dex_method_info(dexen_dir_B, is_comparing_dex_size, false);
+    std::cout << "INFO: " << B_info.size() << " method information loaded"
+              << std::endl;
+  }
 
   std::cout << "Diffing A and B... " << std::endl;
   DexMethodInfoMap diff;
@@ -267,10 +489,11 @@ void diff_from_two_dexen_dirs(const std::string& dexen_dir_A,
   g_redex = A_context;
 }
 
-void dump_method_move_info_from_dex_dir(const std::string& dex_dir) {
+void dump_method_move_info_from_dex_dir(const std::string& dex_dir,
+                                        bool fast) {
   std::cout << "INFO: "
             << "Loading directory " << dex_dir << " ... " << std::endl;
-  auto info = load_dex_method_move_info(dex_dir);
+  auto info = load_dex_method_info(dex_dir, false, fast);
   std::cout << "INFO: " << info.size() << " method information loaded"
             << std::endl;
   for (const auto& pair : info) {
@@ -299,10 +522,15 @@ class DiffMethodSizes : public Tool {
                                                            "show number of "
                                                            "move code and "
                                                            "their size for "
-                                                           "each methods");
+                                                           "each methods")(
+        "fast,f",
+        po::bool_switch(),
+        "with --dexendir or --show-moves, read the method sizes straight "
+        "from the dex files, in parallel, instead of loading them");
   }
 
   void run(const po::variables_map& options) override {
+    bool fast = options["fast"].as<bool>();
     if (!options["commandline"].empty()) {
       diff_in_out_jars_from_command_line(
           options["commandline"].as<std::string>());
@@ -311,11 +539,13 @@ class DiffMethodSizes : public Tool {
           options["dexendir"].as<std::vector<std::string>>();
       switch (dexen_dirs.size()) {
       case 1:
-        dump_method_sizes_from_dexen_dir(dexen_dirs[0]);
+        dump_method_sizes_from_dexen_dir(dexen_dirs[0], fast);
         break;
       case 2:
-        diff_from_two_dexen_dirs(
-            dexen_dirs[0], dexen_dirs[1], true /* is_comparing_dex_size */);
+        diff_from_two_dexen_dirs(dexen_dirs[0],
+                                 dexen_dirs[1],
+                                 true /* is_comparing_dex_size */,
+                                 fast);
         break;
       default:
         std::cerr << "Only one or two --dexendir can be provided" << std::endl;
@@ -326,11 +556,13 @@ class DiffMethodSizes : public Tool {
           options["show-moves"].as<std::vector<std::string>>();
       switch (dex_dirs.size()) {
       case 1:
-        dump_method_move_info_from_dex_dir(dex_dirs[0]);
+        dump_method_move_info_from_dex_dir(dex_dirs[0], fast);
         break;
       case 2:
-        diff_from_two_dexen_dirs(
-            dex_dirs[0], dex_dirs[1], false /* is_comparing_dex_size */);
+        diff_from_two_dexen_dirs(dex_dirs[0],
+                                 dex_dirs[1],
+                                 false /* is_comparing_dex_size */,
+                                 fast);
         break;
       default:
         std::cerr << "Only one or two --dexendir can be provided" << std::endl;
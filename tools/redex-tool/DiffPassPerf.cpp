@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <json/json.h>
+
+#include "PassPerfRecord.h"
+#include "Tool.h"
+
+/*
+ * This tool compares the per-pass performance records (the "pass_perf"
+ * section) of the stats of two builds, and lists the passes that got slower or
+ * used more memory by more than a threshold. It exits with a failure if it
+ * found any, so that it can gate a build.
+ */
+namespace {
+
+Json::Value read_pass_perf(const std::string& path) {
+  std::ifstream ifs(path);
+  if (!ifs) {
+    std::cerr << "error: cannot open " << path << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  Json::Value stats;
+  ifs >> stats;
+  // Accept both whole stats files and bare records.
+  if (stats.isMember("output_stats")) {
+    return stats["output_stats"]["pass_perf"];
+  }
+  return stats;
+}
+
+class DiffPassPerf : public Tool {
+ public:
+  DiffPassPerf()
+      : Tool("diff-pass-perf",
+             "flag per-pass performance regressions between two builds") {}
+
+  void add_options(po::options_description& options) const override {
+    options.add_options()(
+        "before,b",
+        po::value<std::string>()->value_name("redex-stats.json")->required(),
+        "stats of the baseline build")(
+        "after,a",
+        po::value<std::string>()->value_name("redex-stats.json")->required(),
+        "stats of the build to check")(
+        "threshold,t",
+        po::value<double>()->default_value(10),
+        "percentage by which a value must grow to be a regression");
+  }
+
+  void run(const po::variables_map& options) override {
+    auto before = read_pass_perf(options["before"].as<std::string>());
+    auto after = read_pass_perf(options["after"].as<std::string>());
+    auto regressions = pass_perf::find_regressions(
+        before, after, options["threshold"].as<double>() / 100);
+    for (const auto& regression : regressions) {
+      std::cout << regression.pass << " " << regression.field << ": "
+                << regression.before << " -> " << regression.after
+                << std::endl;
+    }
+    if (!regressions.empty()) {
+      std::cerr << regressions.size() << " regressions found" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+};
+
+static DiffPassPerf s_tool;
+
+} // namespace
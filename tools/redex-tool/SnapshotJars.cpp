@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <boost/algorithm/string.hpp>
+#include <iostream>
+
+#include "DexClass.h"
+#include "JarLoader.h"
+#include "Tool.h"
+
+/*
+ * This tool loads library jars, and writes the external classes they define
+ * to a class snapshot. redex-all and the other tools accept the snapshot in
+ * place of the jars, and load it without parsing class files.
+ */
+namespace {
+
+class SnapshotJars : public Tool {
+ public:
+  SnapshotJars()
+      : Tool("snapshot-jars", "write library jars to a class snapshot") {}
+
+  void add_options(po::options_description& options) const override {
+    options.add_options()(
+        "jars,j",
+        po::value<std::string>()->value_name("foo.jar:bar.jar")->required(),
+        "colon-separated list of jars, loaded in order")(
+        "output,o",
+        po::value<std::string>()->value_name("library.snapshot")->required(),
+        "path to the class snapshot to write");
+  }
+
+  void run(const po::variables_map& options) override {
+    std::vector<std::string> jars;
+    boost::split(jars, options["jars"].as<std::string>(),
+                 boost::is_any_of(":"));
+    Scope classes;
+    for (const auto& jar : jars) {
+      if (!load_jar_file(jar.c_str(), &classes)) {
+        std::cerr << "error: jar could not be loaded: " << jar << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    }
+    const auto& output = options["output"].as<std::string>();
+    if (!write_class_snapshot(output.c_str(), classes)) {
+      exit(EXIT_FAILURE);
+    }
+    std::cout << "Wrote " << classes.size() << " classes to " << output
+              << std::endl;
+  }
+};
+
+static SnapshotJars s_tool;
+
+} // namespace
@@ -13,25 +13,69 @@ bool clean = false;
 bool raw = false;
 bool escape = false;
 
+namespace {
+
+// The buffer that redump() appends to on this thread, or null for stdout.
+thread_local std::string* t_buffer = nullptr;
+
+void vredump(const char* format, va_list va) {
+  if (t_buffer == nullptr) {
+    vprintf(format, va);
+    return;
+  }
+  char buf[256];
+  va_list copy;
+  va_copy(copy, va);
+  int len = vsnprintf(buf, sizeof(buf), format, copy);
+  va_end(copy);
+  if (len < 0) {
+    return;
+  }
+  if (static_cast<size_t>(len) < sizeof(buf)) {
+    t_buffer->append(buf, len);
+    return;
+  }
+  auto size = t_buffer->size();
+  t_buffer->resize(size + len + 1);
+  vsnprintf(&(*t_buffer)[size], len + 1, format, va);
+  t_buffer->resize(size + len);
+}
+
+void redump_prefix(const char* format, ...) {
+  va_list va;
+  va_start(va, format);
+  vredump(format, va);
+  va_end(va);
+}
+
+} // namespace
+
 void redump(const char* format, ...) {
   va_list va;
   va_start(va, format);
-  vprintf(format, va);
+  vredump(format, va);
   va_end(va);
 }
 
 void redump(uint32_t off, const char* format, ...) {
   va_list va;
   va_start(va, format);
-  if (!clean) printf("[0x%x] ", off);
-  vprintf(format, va);
+  if (!clean) redump_prefix("[0x%x] ", off);
+  vredump(format, va);
   va_end(va);
 }
 
 void redump(uint32_t pos, uint32_t off, const char* format, ...) {
   va_list va;
   va_start(va, format);
-  if (!clean) printf("(0x%x) [0x%x] ", pos, off);
-  vprintf(format, va);
+  if (!clean) redump_prefix("(0x%x) [0x%x] ", pos, off);
+  vredump(format, va);
   va_end(va);
 }
+
+ScopedRedumpBuffer::ScopedRedumpBuffer(std::string* buffer)
+    : m_prev(t_buffer) {
+  t_buffer = buffer;
+}
+
+ScopedRedumpBuffer::~ScopedRedumpBuffer() { t_buffer = m_prev; }
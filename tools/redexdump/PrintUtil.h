@@ -8,6 +8,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <string>
 
 extern bool clean;
 extern bool raw;
@@ -16,3 +17,18 @@ extern bool escape;
 void redump(const char* format, ...);
 void redump(uint32_t off, const char* format, ...);
 void redump(uint32_t pos, uint32_t off, const char* format, ...);
+
+// While in scope, redump() on the current thread appends to the given buffer
+// instead of printing to stdout, so that several dex files can be dumped at
+// once and printed in order.
+class ScopedRedumpBuffer {
+ public:
+  explicit ScopedRedumpBuffer(std::string* buffer);
+  ~ScopedRedumpBuffer();
+
+  ScopedRedumpBuffer(const ScopedRedumpBuffer&) = delete;
+  ScopedRedumpBuffer& operator=(const ScopedRedumpBuffer&) = delete;
+
+ private:
+  std::string* m_prev;
+};
@@ -6,10 +6,18 @@
  */
 
 #include "RedexDump.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <getopt.h>
+#include <mutex>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <thread>
+#include <vector>
 
 #include "Formatters.h"
 #include "PrintUtil.h"
@@ -45,6 +53,7 @@ static const char ddump_usage_string[] =
     "-D, --ddebug=<addr>: disassemble debug info item at <addr>\n"
     "\n"
     "printing options:\n"
+    "-j, --jobs=<n>: dump up to n dex files at once; output stays in order\n"
     "--clean: suppress indices and offsets\n"
     "--no-headers: suppress headers\n"
     "--raw: print all bytes, even control characters\n";
@@ -68,6 +77,7 @@ int main(int argc, char* argv[]) {
   bool redexdump_debug = false;
   uint32_t ddebug_offset = 0;
   int no_headers = 0;
+  unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
 
   char c;
   static const struct option options[] = {
@@ -87,6 +97,7 @@ int main(int argc, char* argv[]) {
       {"anno", no_argument, nullptr, 'A'},
       {"debug", no_argument, nullptr, 'd'},
       {"ddebug", required_argument, nullptr, 'D'},
+      {"jobs", required_argument, nullptr, 'j'},
       {"clean", no_argument, (int*)&clean, 1},
       {"raw", no_argument, (int*)&raw, 1},
       {"escape", no_argument, (int*)&escape, 1},
@@ -95,7 +106,7 @@ int main(int argc, char* argv[]) {
       {nullptr, 0, nullptr, 0},
   };
 
-  while ((c = getopt_long(argc, argv, "asStpfmcCxeAdDh", &options[0],
+  while ((c = getopt_long(argc, argv, "asStpfmcCxeAdDj:h", &options[0],
                           nullptr)) != -1) {
     switch (c) {
     case 'a':
@@ -146,6 +157,9 @@ int main(int argc, char* argv[]) {
     case 'D':
       sscanf(optarg, "%x", &ddebug_offset);
       break;
+    case 'j':
+      jobs = std::max(1, atoi(optarg));
+      break;
     case 'h':
       puts(ddump_usage_string);
       return 0;
@@ -164,8 +178,7 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
-  while (optind < argc) {
-    const char* dexfile = argv[optind++];
+  auto dump_dex = [&](const char* dexfile) {
     ddump_data rd;
     open_dex_file(dexfile, &rd);
     if (!no_headers) {
@@ -217,9 +230,59 @@ int main(int argc, char* argv[]) {
     if (ddebug_offset != 0) {
       disassemble_debug(&rd, ddebug_offset);
     }
-    fprintf(stdout, "\n");
+    redump("\n");
+    munmap(rd.dexmmap, rd.dex_size);
+  };
+
+  // The dump is written in large blocks rather than line by line.
+  setvbuf(stdout, nullptr, _IOFBF, 1 << 20);
+
+  std::vector<const char*> dexfiles(argv + optind, argv + argc);
+  if (jobs == 1 || dexfiles.size() == 1) {
+    for (const char* dexfile : dexfiles) {
+      dump_dex(dexfile);
+      fflush(stdout);
+    }
+    return 0;
+  }
+
+  // Workers dump the dex files into buffers, which are printed in the order
+  // of the arguments as soon as they are complete.
+  std::vector<std::string> outputs(dexfiles.size());
+  std::vector<bool> done(dexfiles.size(), false);
+  std::mutex outputs_lock;
+  std::condition_variable output_done;
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    for (size_t i = next++; i < dexfiles.size(); i = next++) {
+      std::string output;
+      {
+        ScopedRedumpBuffer buffer(&output);
+        dump_dex(dexfiles[i]);
+      }
+      std::lock_guard<std::mutex> guard(outputs_lock);
+      outputs[i] = std::move(output);
+      done[i] = true;
+      output_done.notify_one();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < std::min<size_t>(jobs, dexfiles.size()); t++) {
+    threads.emplace_back(worker);
+  }
+  for (size_t i = 0; i < dexfiles.size(); i++) {
+    std::string output;
+    {
+      std::unique_lock<std::mutex> lock(outputs_lock);
+      output_done.wait(lock, [&]() { return done[i]; });
+      output = std::move(outputs[i]);
+    }
+    fwrite(output.data(), 1, output.size(), stdout);
     fflush(stdout);
   }
+  for (auto& thread : threads) {
+    thread.join();
+  }
 
   return 0;
 }
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * trace-formatter turns a trace written with TRACE_BUFFERED=1 into the text
+ * that unbuffered tracing would have written. The records of all threads are
+ * merged in the order of their timestamps. Records with the same timestamp
+ * are ordered by thread, and each thread keeps its own order.
+ *
+ * The options match the SHOW_TIMESTAMPS and SHOW_TRACEMODULE environment
+ * variables of the tracer, which do not change what a buffered trace holds.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "TraceRecord.h"
+
+namespace {
+
+void print_usage() {
+  fprintf(stderr,
+          "Usage: trace-formatter [-t] [-m] <trace file>\n"
+          "Options:\n"
+          "  -t, --show-timestamps   prefix records with their time\n"
+          "  -m, --show-tracemodule  prefix records with module and level\n");
+}
+
+struct Record {
+  trace_record::Header header;
+  std::string message;
+};
+
+template <typename T>
+bool read(FILE* in, T* value) {
+  return fread(value, sizeof(T), 1, in) == 1;
+}
+
+bool read_string(FILE* in, size_t length, std::string* str) {
+  str->resize(length);
+  return length == 0 || fread(&(*str)[0], 1, length, in) == length;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  bool show_timestamps = false;
+  bool show_tracemodule = false;
+  static const struct option options[] = {
+      {"show-timestamps", no_argument, nullptr, 't'},
+      {"show-tracemodule", no_argument, nullptr, 'm'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "tmh", &options[0], nullptr)) != -1) {
+    switch (c) {
+    case 't':
+      show_timestamps = true;
+      break;
+    case 'm':
+      show_tracemodule = true;
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    default:
+      print_usage();
+      return 1;
+    }
+  }
+  if (argc - optind != 1) {
+    print_usage();
+    return 1;
+  }
+
+  FILE* in = fopen(argv[optind], "rb");
+  if (in == nullptr) {
+    fprintf(stderr, "Cannot open %s\n", argv[optind]);
+    return 1;
+  }
+  std::array<char, sizeof(trace_record::MAGIC)> magic;
+  uint32_t version;
+  uint32_t num_modules;
+  if (fread(magic.data(), 1, magic.size(), in) != magic.size() ||
+      memcmp(magic.data(), trace_record::MAGIC, magic.size()) != 0 ||
+      !read(in, &version) || version != trace_record::VERSION ||
+      !read(in, &num_modules)) {
+    fprintf(stderr, "%s is not a buffered trace of version %u\n",
+            argv[optind], trace_record::VERSION);
+    return 1;
+  }
+  std::vector<std::string> modules(num_modules);
+  for (auto& module : modules) {
+    uint32_t length;
+    if (!read(in, &length) || !read_string(in, length, &module)) {
+      fprintf(stderr, "Truncated module names\n");
+      return 1;
+    }
+  }
+
+  std::vector<Record> records;
+  Record record;
+  while (read(in, &record.header)) {
+    if (!read_string(in, record.header.length, &record.message)) {
+      fprintf(stderr, "Truncated record, ignoring the rest of the trace\n");
+      break;
+    }
+    records.push_back(std::move(record));
+  }
+  fclose(in);
+
+  std::sort(records.begin(), records.end(),
+            [](const Record& a, const Record& b) {
+              return std::tie(a.header.timestamp_ns, a.header.thread,
+                              a.header.seq) <
+                     std::tie(b.header.timestamp_ns, b.header.thread,
+                              b.header.seq);
+            });
+
+  for (const auto& r : records) {
+    if (show_timestamps) {
+      time_t t = r.header.timestamp_ns / 1000000000;
+      struct tm local_tm;
+      localtime_r(&t, &local_tm);
+      std::array<char, 40> buf;
+      strftime(buf.data(), buf.size(), "%c", &local_tm);
+      printf("[%s]", buf.data());
+      if (!show_tracemodule) {
+        printf(" ");
+      }
+    }
+    if (show_tracemodule) {
+      const char* module = r.header.module < modules.size()
+                               ? modules[r.header.module].c_str()
+                               : "?";
+      printf("[%s:%d] ", module, r.header.level);
+    }
+    fwrite(r.message.data(), 1, r.message.size(), stdout);
+    if (!r.header.suppress_newline) {
+      printf("\n");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,429 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+/*
+ * zip-repack writes the files of an extracted APK directory into a new APK,
+ * like the zip path of the Python driver, but compresses the entries in
+ * parallel.
+ *
+ * Each file keeps the compression method of the same entry in the input APK,
+ * and is deflated if it is new. A file that is unchanged from its input entry,
+ * i.e. with the same size and CRC, has the compressed bytes of the entry
+ * copied without recompressing them.
+ *
+ * The output is deterministic: entries are written in the order of a sorted
+ * directory walk (the files of a directory, then its subdirectories), and all
+ * carry the same timestamp and attributes.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace {
+
+constexpr uint32_t kLocalFileSignature = 0x04034b50;
+constexpr uint32_t kCentralFileSignature = 0x02014b50;
+constexpr uint32_t kCentralDirEndSignature = 0x06054b50;
+constexpr size_t kLocalFileHeaderSize = 30;
+constexpr size_t kCentralFileHeaderSize = 46;
+constexpr size_t kCentralDirEndSize = 22;
+constexpr uint16_t kCompMethodStore = 0;
+constexpr uint16_t kCompMethodDeflate = 8;
+constexpr uint16_t kVersion = 20;
+// 1980-01-01 00:00, the earliest DOS date.
+constexpr uint16_t kDosDate = (1 << 5) | 1;
+constexpr uint16_t kDosTime = 0;
+
+void print_usage() {
+  fprintf(stderr,
+          "Usage: zip-repack [-j <jobs>] <input apk> <extracted apk dir> "
+          "<output apk>\n"
+          "Options:\n"
+          "  -j, --jobs=N  number of entries to compress at once\n");
+}
+
+uint16_t read16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+uint32_t read32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void write16(std::string* out, uint16_t value) {
+  out->push_back(value & 0xff);
+  out->push_back(value >> 8);
+}
+
+void write32(std::string* out, uint32_t value) {
+  write16(out, value & 0xffff);
+  write16(out, value >> 16);
+}
+
+// An entry of the input APK.
+struct InputEntry {
+  uint16_t method;
+  uint32_t crc;
+  uint32_t compressed_size;
+  uint32_t size;
+  // The compressed bytes, in the mapped input.
+  const uint8_t* data;
+};
+
+bool read_input_entries(const uint8_t* zip,
+                        size_t size,
+                        std::unordered_map<std::string, InputEntry>* entries) {
+  if (size < kCentralDirEndSize) {
+    return false;
+  }
+  // The end of central directory record, followed by at most a 64KiB comment.
+  const uint8_t* end = nullptr;
+  size_t min_pos = size > kCentralDirEndSize + 0xffff
+                       ? size - kCentralDirEndSize - 0xffff
+                       : 0;
+  for (size_t pos = size - kCentralDirEndSize + 1; pos-- > min_pos;) {
+    if (read32(zip + pos) == kCentralDirEndSignature) {
+      end = zip + pos;
+      break;
+    }
+  }
+  if (end == nullptr) {
+    return false;
+  }
+  uint16_t count = read16(end + 10);
+  uint32_t offset = read32(end + 16);
+  const uint8_t* limit = zip + size;
+  const uint8_t* cd = zip + offset;
+  for (uint16_t i = 0; i < count; ++i) {
+    if (cd + kCentralFileHeaderSize > limit ||
+        read32(cd) != kCentralFileSignature) {
+      return false;
+    }
+    uint16_t name_len = read16(cd + 28);
+    uint16_t extra_len = read16(cd + 30);
+    uint16_t comment_len = read16(cd + 32);
+    uint32_t local_offset = read32(cd + 42);
+    const uint8_t* local = zip + local_offset;
+    if (cd + kCentralFileHeaderSize + name_len > limit ||
+        local + kLocalFileHeaderSize > limit ||
+        read32(local) != kLocalFileSignature) {
+      return false;
+    }
+    InputEntry entry;
+    entry.method = read16(cd + 10);
+    entry.crc = read32(cd + 16);
+    entry.compressed_size = read32(cd + 20);
+    entry.size = read32(cd + 24);
+    entry.data = local + kLocalFileHeaderSize + read16(local + 26) +
+                 read16(local + 28);
+    if (entry.data + entry.compressed_size > limit) {
+      return false;
+    }
+    std::string name((const char*)cd + kCentralFileHeaderSize, name_len);
+    entries->emplace(std::move(name), entry);
+    cd += kCentralFileHeaderSize + name_len + extra_len + comment_len;
+  }
+  return true;
+}
+
+// Lists the files under `dir` in the order of a sorted top-down walk.
+void list_files(const boost::filesystem::path& dir,
+                const std::string& prefix,
+                std::vector<std::string>* names) {
+  std::vector<std::string> files;
+  std::vector<std::string> subdirs;
+  for (const auto& item : boost::filesystem::directory_iterator(dir)) {
+    auto name = item.path().filename().string();
+    if (boost::filesystem::is_directory(item.status())) {
+      subdirs.push_back(std::move(name));
+    } else {
+      files.push_back(std::move(name));
+    }
+  }
+  std::sort(files.begin(), files.end());
+  std::sort(subdirs.begin(), subdirs.end());
+  for (const auto& file : files) {
+    names->push_back(prefix + file);
+  }
+  for (const auto& subdir : subdirs) {
+    list_files(dir / subdir, prefix + subdir + "/", names);
+  }
+}
+
+bool read_file(const std::string& path, std::string* contents) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  in.seekg(0, std::ios::end);
+  contents->resize(in.tellg());
+  in.seekg(0, std::ios::beg);
+  in.read(&(*contents)[0], contents->size());
+  return (bool)in;
+}
+
+bool deflate_raw(const std::string& in, std::string* out) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  out->resize(deflateBound(&stream, in.size()));
+  stream.next_in = (Bytef*)in.data();
+  stream.avail_in = in.size();
+  stream.next_out = (Bytef*)&(*out)[0];
+  stream.avail_out = out->size();
+  int err = deflate(&stream, Z_FINISH);
+  out->resize(stream.total_out);
+  deflateEnd(&stream);
+  return err == Z_STREAM_END;
+}
+
+// An entry of the output APK, ready to be written.
+struct OutputEntry {
+  std::string name;
+  uint16_t method;
+  uint32_t crc;
+  uint32_t size;
+  // The compressed bytes, either owned or in the mapped input.
+  std::string compressed;
+  const uint8_t* data;
+  uint32_t compressed_size;
+  std::string error;
+};
+
+void make_entry(const std::string& dir,
+                const std::unordered_map<std::string, InputEntry>& inputs,
+                OutputEntry* entry) {
+  std::string contents;
+  if (!read_file(dir + "/" + entry->name, &contents)) {
+    entry->error = "cannot read " + entry->name;
+    return;
+  }
+  if (contents.size() > UINT32_MAX) {
+    entry->error = entry->name + " needs zip64, which is not supported";
+    return;
+  }
+  entry->size = contents.size();
+  entry->crc =
+      crc32(crc32(0, nullptr, 0), (const Bytef*)contents.data(), entry->size);
+  entry->method = kCompMethodDeflate;
+  auto it = inputs.find(entry->name);
+  if (it != inputs.end()) {
+    const auto& input = it->second;
+    entry->method = input.method;
+    if (input.size == entry->size && input.crc == entry->crc) {
+      entry->data = input.data;
+      entry->compressed_size = input.compressed_size;
+      return;
+    }
+  }
+  if (entry->method == kCompMethodStore) {
+    entry->compressed = std::move(contents);
+  } else {
+    entry->method = kCompMethodDeflate;
+    if (!deflate_raw(contents, &entry->compressed)) {
+      entry->error = "cannot deflate " + entry->name;
+      return;
+    }
+  }
+  entry->data = (const uint8_t*)entry->compressed.data();
+  entry->compressed_size = entry->compressed.size();
+}
+
+void write_header(std::string* out,
+                  bool central,
+                  const OutputEntry& entry,
+                  uint32_t local_offset) {
+  write32(out, central ? kCentralFileSignature : kLocalFileSignature);
+  if (central) {
+    write16(out, kVersion); // version made by
+  }
+  write16(out, kVersion); // version needed to extract
+  write16(out, 0); // flags
+  write16(out, entry.method);
+  write16(out, kDosTime);
+  write16(out, kDosDate);
+  write32(out, entry.crc);
+  write32(out, entry.compressed_size);
+  write32(out, entry.size);
+  write16(out, entry.name.size());
+  write16(out, 0); // extra field length
+  if (central) {
+    write16(out, 0); // comment length
+    write16(out, 0); // disk number
+    write16(out, 0); // internal attributes
+    write32(out, 0); // external attributes
+    write32(out, local_offset);
+  }
+  out->append(entry.name);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+  static const struct option options[] = {
+      {"jobs", required_argument, nullptr, 'j'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "j:h", &options[0], nullptr)) != -1) {
+    switch (c) {
+    case 'j':
+      jobs = std::max(1, atoi(optarg));
+      break;
+    case 'h':
+      print_usage();
+      return 0;
+    default:
+      print_usage();
+      return 1;
+    }
+  }
+  if (argc - optind != 3) {
+    print_usage();
+    return 1;
+  }
+  const char* input_apk = argv[optind];
+  const std::string dir = argv[optind + 1];
+  const char* output_apk = argv[optind + 2];
+
+  boost::iostreams::mapped_file input;
+  std::unordered_map<std::string, InputEntry> inputs;
+  try {
+    input.open(input_apk, boost::iostreams::mapped_file::readonly);
+  } catch (const std::exception& e) {
+    fprintf(stderr, "error: cannot open %s\n", input_apk);
+    return 1;
+  }
+  if (!read_input_entries((const uint8_t*)input.const_data(), input.size(),
+                          &inputs)) {
+    fprintf(stderr, "error: cannot read the entries of %s\n", input_apk);
+    return 1;
+  }
+
+  std::vector<std::string> names;
+  list_files(dir, "", &names);
+  if (names.size() > UINT16_MAX) {
+    fprintf(stderr, "error: %zu entries need zip64, which is not supported\n",
+            names.size());
+    return 1;
+  }
+  std::vector<OutputEntry> entries(names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    entries[i].name = std::move(names[i]);
+  }
+
+  FILE* out = fopen(output_apk, "wb");
+  if (out == nullptr) {
+    fprintf(stderr, "error: cannot create %s\n", output_apk);
+    return 1;
+  }
+
+  // Workers compress entries in parallel, at most `window` entries ahead of
+  // the one being written, which bounds the memory of compressed entries.
+  const size_t window = 4 * jobs;
+  std::mutex mutex;
+  std::condition_variable cv;
+  size_t next = 0;
+  size_t written = 0;
+  std::vector<bool> done(entries.size(), false);
+  auto worker = [&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      cv.wait(lock, [&]() {
+        return next >= entries.size() || next < written + window;
+      });
+      if (next >= entries.size()) {
+        break;
+      }
+      size_t i = next++;
+      lock.unlock();
+      make_entry(dir, inputs, &entries[i]);
+      lock.lock();
+      done[i] = true;
+      cv.notify_all();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < std::min(jobs, entries.size()); ++t) {
+    threads.emplace_back(worker);
+  }
+
+  std::string central_dir;
+  uint32_t offset = 0;
+  bool ok = true;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&]() { return done[i]; });
+    }
+    auto& entry = entries[i];
+    if (ok && !entry.error.empty()) {
+      fprintf(stderr, "error: %s\n", entry.error.c_str());
+      ok = false;
+    }
+    if (ok) {
+      std::string header;
+      write_header(&header, /* central */ false, entry, 0);
+      write_header(&central_dir, /* central */ true, entry, offset);
+      uint64_t end = (uint64_t)offset + header.size() + entry.compressed_size;
+      if (end > UINT32_MAX) {
+        fprintf(stderr, "error: %s needs zip64, which is not supported\n",
+                output_apk);
+        ok = false;
+      } else {
+        fwrite(header.data(), 1, header.size(), out);
+        fwrite(entry.data, 1, entry.compressed_size, out);
+        offset = end;
+      }
+    }
+    entry.compressed = std::string();
+    std::lock_guard<std::mutex> lock(mutex);
+    ++written;
+    cv.notify_all();
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  if (ok) {
+    std::string end;
+    write32(&end, kCentralDirEndSignature);
+    write16(&end, 0); // disk number
+    write16(&end, 0); // disk of the central directory
+    write16(&end, entries.size());
+    write16(&end, entries.size());
+    write32(&end, central_dir.size());
+    write32(&end, offset);
+    write16(&end, 0); // comment length
+    fwrite(central_dir.data(), 1, central_dir.size(), out);
+    fwrite(end.data(), 1, end.size(), out);
+  }
+  if (fclose(out) != 0 || !ok) {
+    fprintf(stderr, "error: cannot write %s\n", output_apk);
+    remove(output_apk);
+    return 1;
+  }
+  return 0;
+}
@@ -12,6 +12,7 @@
 #include <iostream>
 
 #include "Debug.h"
+#include "JemallocUtil.h"
 
 extern "C" {
 
@@ -37,10 +38,51 @@ void set_profile_active(bool active) {
   always_assert_log(err == 0, "mallctl failed with: %d", err);
 }
 
+bool read_stat(const char* name, uint64_t* value) {
+  size_t stat;
+  size_t size = sizeof(stat);
+  if (mallctl(name, &stat, &size, nullptr, 0) != 0) {
+    return false;
+  }
+  *value = stat;
+  return true;
+}
+
 } // namespace
 
 namespace jemalloc_util {
 
+boost::optional<Stats> get_stats() {
+  if (mallctl == nullptr) {
+    return boost::none;
+  }
+  // The statistics are a snapshot taken when the epoch is advanced.
+  uint64_t epoch = 1;
+  size_t size = sizeof(epoch);
+  if (mallctl("epoch", &epoch, &size, &epoch, size) != 0) {
+    return boost::none;
+  }
+  Stats stats;
+  if (!read_stat("stats.allocated", &stats.allocated) ||
+      !read_stat("stats.active", &stats.active) ||
+      !read_stat("stats.resident", &stats.resident)) {
+    return boost::none;
+  }
+  return stats;
+}
+
+bool is_profiling_active() {
+  if (mallctl == nullptr) {
+    return false;
+  }
+  bool active = false;
+  size_t size = sizeof(active);
+  if (mallctl("prof.active", &active, &size, nullptr, 0) != 0) {
+    return false;
+  }
+  return active;
+}
+
 void enable_profiling() { set_profile_active(true); }
 
 void disable_profiling() { set_profile_active(false); }
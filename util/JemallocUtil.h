@@ -5,27 +5,63 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#pragma once
+
+#include <boost/optional.hpp>
+#include <cstdint>
 #include <cstdio>
 #include <string>
 
 namespace jemalloc_util {
 
+// Allocator-wide statistics, in bytes. See the `stats.*` mallctls in the
+// jemalloc manual.
+struct Stats {
+  // Allocated by the application.
+  uint64_t allocated{0};
+  // In active pages, i.e. allocated plus the fragmentation within pages.
+  uint64_t active{0};
+  // In physically resident pages mapped by the allocator, including its
+  // metadata and the dirty pages that it has not returned to the system.
+  uint64_t resident{0};
+};
+
+// Returns the current statistics, or none if the process does not use
+// jemalloc or jemalloc was built without statistics.
+boost::optional<Stats> get_stats();
+
+// Whether allocations are currently sampled.
+bool is_profiling_active();
+
 void enable_profiling();
 
 void disable_profiling();
 
 void dump(const std::string& file_name);
 
+// Enables profiling for the scope, unless it was already active, in which case
+// it stays active after the scope.
 class ScopedProfiling final {
  public:
-  explicit ScopedProfiling(bool enable) {
-    if (enable) {
+  explicit ScopedProfiling(bool enable)
+      : m_enabled(enable && !is_profiling_active()) {
+    if (m_enabled) {
       fprintf(stderr, "Enabling memory profiling...\n");
       enable_profiling();
     }
   }
 
-  ~ScopedProfiling() { disable_profiling(); }
+  ~ScopedProfiling() {
+    if (m_enabled) {
+      disable_profiling();
+    }
+  }
+
+  ScopedProfiling(const ScopedProfiling&) = delete;
+  ScopedProfiling& operator=(const ScopedProfiling&) = delete;
+
+ private:
+  bool m_enabled;
 };
 
 } // namespace jemalloc_util
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PerfCounters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+namespace perf_counters {
+
+#if defined(__linux__)
+
+namespace {
+
+constexpr std::array<uint64_t, 4> kEvents = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+int open_counter(uint64_t config) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, /* pid */ 0,
+                                  /* cpu */ -1, /* group_fd */ -1,
+                                  /* flags */ 0));
+}
+
+boost::optional<uint64_t> read_counter(int fd) {
+  // The value, then the times enabled and running.
+  uint64_t values[3];
+  if (::read(fd, values, sizeof(values)) != sizeof(values)) {
+    return boost::none;
+  }
+  if (values[2] == 0) {
+    return uint64_t(0);
+  }
+  if (values[2] == values[1]) {
+    return values[0];
+  }
+  return static_cast<uint64_t>(static_cast<double>(values[0]) * values[1] /
+                               values[2]);
+}
+
+} // namespace
+
+ScopedPerfCounters::ScopedPerfCounters() {
+  for (auto event : kEvents) {
+    int fd = open_counter(event);
+    if (fd == -1) {
+      static std::once_flag warned;
+      int errsv = errno;
+      std::call_once(warned, [errsv] {
+        std::cerr << "Warning: cannot open perf counters: " << strerror(errsv)
+                  << std::endl;
+      });
+      for (int open_fd : m_fds) {
+        close(open_fd);
+      }
+      m_fds.clear();
+      return;
+    }
+    m_fds.push_back(fd);
+  }
+  for (int fd : m_fds) {
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+ScopedPerfCounters::~ScopedPerfCounters() {
+  for (int fd : m_fds) {
+    close(fd);
+  }
+}
+
+boost::optional<Counts> ScopedPerfCounters::read() const {
+  if (m_fds.empty()) {
+    return boost::none;
+  }
+  std::array<uint64_t, kEvents.size()> values;
+  for (size_t i = 0; i < m_fds.size(); ++i) {
+    auto value = read_counter(m_fds[i]);
+    if (!value) {
+      return boost::none;
+    }
+    values[i] = *value;
+  }
+  Counts counts;
+  counts.cycles = values[0];
+  counts.instructions = values[1];
+  counts.cache_misses = values[2];
+  counts.branch_misses = values[3];
+  return counts;
+}
+
+#else
+
+ScopedPerfCounters::ScopedPerfCounters() {}
+
+ScopedPerfCounters::~ScopedPerfCounters() {}
+
+boost::optional<Counts> ScopedPerfCounters::read() const {
+  return boost::none;
+}
+
+#endif
+
+} // namespace perf_counters
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace perf_counters {
+
+// Hardware event counts. When the kernel multiplexes the counters, the counts
+// are scaled up to the whole time that they were enabled.
+struct Counts {
+  uint64_t cycles{0};
+  uint64_t instructions{0};
+  // Last-level cache misses.
+  uint64_t cache_misses{0};
+  uint64_t branch_misses{0};
+};
+
+/*
+ * Counts hardware events with perf_event_open, in the calling thread and in
+ * the threads that it creates while the scope is alive, like the workers of
+ * the work queues. Events of threads that were created before, e.g. the ones
+ * of a thread pool, are not counted.
+ *
+ * Counting is only supported on Linux, and needs a perf_event_paranoid setting
+ * that allows it for the user. Otherwise `read` returns none.
+ */
+class ScopedPerfCounters final {
+ public:
+  ScopedPerfCounters();
+  ~ScopedPerfCounters();
+
+  ScopedPerfCounters(const ScopedPerfCounters&) = delete;
+  ScopedPerfCounters& operator=(const ScopedPerfCounters&) = delete;
+
+  // The counts since the start of the scope. The counts of a created thread
+  // are only included once it has exited.
+  boost::optional<Counts> read() const;
+
+ private:
+  // One file descriptor per event, in the order of the fields of Counts.
+  std::vector<int> m_fds;
+};
+
+} // namespace perf_counters
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Suffix arrays over strings of integer symbols, and what can be derived from
+ * them in linear time.
+ */
+namespace suffix_array {
+
+/*
+ * Returns the start positions of all suffixes of `text`, in lexicographic
+ * order of the suffixes. All symbols must be less than `alphabet_size`.
+ *
+ * This sorts by prefix doubling, with a radix sort per round, in
+ * O(n log n) time.
+ */
+inline std::vector<uint32_t> build(const std::vector<uint32_t>& text,
+                                   uint32_t alphabet_size) {
+  const size_t n = text.size();
+  std::vector<uint32_t> sa(n);
+  if (n == 0) {
+    return sa;
+  }
+  std::vector<uint32_t> rank(n);
+  std::vector<uint32_t> tmp(n);
+  std::vector<uint32_t> counts(std::max<size_t>(alphabet_size, n) + 1);
+
+  // Sort by the first symbol.
+  for (auto symbol : text) {
+    counts[symbol]++;
+  }
+  for (size_t i = 1; i < counts.size(); ++i) {
+    counts[i] += counts[i - 1];
+  }
+  for (size_t i = n; i-- > 0;) {
+    sa[--counts[text[i]]] = i;
+  }
+  rank[sa[0]] = 0;
+  for (size_t i = 1; i < n; ++i) {
+    rank[sa[i]] = rank[sa[i - 1]] + (text[sa[i]] != text[sa[i - 1]] ? 1 : 0);
+  }
+
+  // Each round sorts by the first 2k symbols, as pairs of the ranks of the
+  // first k symbols and of the k symbols that follow them. Suffixes that are
+  // shorter than that sort first among those with the same first k symbols.
+  for (size_t k = 1; rank[sa[n - 1]] < n - 1; k *= 2) {
+    size_t p = 0;
+    for (size_t i = n - std::min(k, n); i < n; ++i) {
+      tmp[p++] = i;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      if (sa[i] >= k) {
+        tmp[p++] = sa[i] - k;
+      }
+    }
+    std::fill(counts.begin(), counts.begin() + n, 0);
+    for (size_t i = 0; i < n; ++i) {
+      counts[rank[i]]++;
+    }
+    for (size_t i = 1; i < n; ++i) {
+      counts[i] += counts[i - 1];
+    }
+    for (size_t i = n; i-- > 0;) {
+      sa[--counts[rank[tmp[i]]]] = tmp[i];
+    }
+    auto second = [&](size_t i) -> int64_t {
+      return i + k < n ? rank[i + k] : -1;
+    };
+    tmp[sa[0]] = 0;
+    for (size_t i = 1; i < n; ++i) {
+      auto prev = sa[i - 1];
+      auto cur = sa[i];
+      bool same = rank[prev] == rank[cur] && second(prev) == second(cur);
+      tmp[cur] = tmp[prev] + (same ? 0 : 1);
+    }
+    rank.swap(tmp);
+  }
+  return sa;
+}
+
+/*
+ * Returns the lengths of the longest common prefixes of neighboring suffixes
+ * in the suffix array `sa` of `text`: the i-th entry is that of the suffixes
+ * at sa[i - 1] and sa[i], and the first entry is zero. This is Kasai's
+ * algorithm, in O(n) time.
+ */
+inline std::vector<uint32_t> build_lcp(const std::vector<uint32_t>& text,
+                                       const std::vector<uint32_t>& sa) {
+  const size_t n = text.size();
+  std::vector<uint32_t> rank(n);
+  for (size_t i = 0; i < n; ++i) {
+    rank[sa[i]] = i;
+  }
+  std::vector<uint32_t> lcp(n);
+  size_t h = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (rank[i] == 0) {
+      h = 0;
+      continue;
+    }
+    size_t j = sa[rank[i] - 1];
+    while (i + h < n && j + h < n && text[i + h] == text[j + h]) {
+      h++;
+    }
+    lcp[rank[i]] = h;
+    if (h > 0) {
+      h--;
+    }
+  }
+  return lcp;
+}
+
+/*
+ * Returns, for each position of `text`, the length of the longest prefix of
+ * the suffix at that position which also starts at some other position.
+ */
+inline std::vector<uint32_t> longest_repeated_prefixes(
+    const std::vector<uint32_t>& text, uint32_t alphabet_size) {
+  auto sa = build(text, alphabet_size);
+  auto lcp = build_lcp(text, sa);
+  const size_t n = text.size();
+  std::vector<uint32_t> res(n);
+  for (size_t i = 0; i < n; ++i) {
+    res[sa[i]] = std::max(lcp[i], i + 1 < n ? lcp[i + 1] : 0);
+  }
+  return res;
+}
+
+} // namespace suffix_array